@@ -3,23 +3,38 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <pthread.h>
+#include <math.h>
 
 #include <bench_storage.h>
 #include <time/cc_timer.h>
 #include <cc_debug.h>
+#include <cc_histogram.h>
 #include <cc_mm.h>
-#include <cc_array.h>
+#include <cc_util.h>
 
-static __thread unsigned int rseed = 1234; /* XXX: make this an option */
+/*
+ * splitmix64, which is simple enough for other benchmark runners (such as the
+ * Rust one in src/storage/segcache/benches/storage.rs) to generate the very
+ * same entries and key stream from the same seed
+ */
+static __thread uint64_t rstate;
 
-#define RRAND(min, max) (rand_r(&(rseed)) % ((max) - (min) + 1) + (min))
+static inline uint64_t
+_rand(void)
+{
+    uint64_t z = (rstate += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+#define RRAND(min, max) (_rand() % ((max) - (min) + 1) + (min))
 
-#define SWAP(a, b) do {\
-    __typeof__(a) _tmp = (a);\
-    (a) = (b);\
-    (b) = _tmp;\
-} while (0)
+/* a double in [0, 1) */
+#define DRAND() ((_rand() >> 11) * 0x1.0p-53)
 
 #define BENCHMARK_OPTION(ACTION)\
     ACTION(entry_min_size,  OPTION_TYPE_UINT, 64,    "Min size of cache entry")\
@@ -29,10 +44,28 @@ static __thread unsigned int rseed = 1234; /* XXX: make this an option */
     ACTION(pct_get,         OPTION_TYPE_UINT, 80,    "% of gets")\
     ACTION(pct_put,         OPTION_TYPE_UINT, 10,    "% of puts")\
     ACTION(pct_rem,         OPTION_TYPE_UINT, 10,    "% of removes")\
-    ACTION(latency,         OPTION_TYPE_BOOL, true,  "Collect latency samples")
+    ACTION(nthread,         OPTION_TYPE_UINT, 1,     "Number of threads running operations")\
+    ACTION(key_dist,        OPTION_TYPE_STR,  "uniform", "Key distribution: uniform, zipf or hotspot")\
+    ACTION(size_dist,       OPTION_TYPE_STR,  "uniform", "Entry size distribution: uniform or zipf")\
+    ACTION(zipf_theta,      OPTION_TYPE_FPN,  0.99,  "Skew of zipf distributions, in (0, 1)")\
+    ACTION(hotspot_pct_key, OPTION_TYPE_UINT, 20,    "% of keys in the hotspot")\
+    ACTION(hotspot_pct_op,  OPTION_TYPE_UINT, 80,    "% of operations on the hotspot")\
+    ACTION(latency,         OPTION_TYPE_BOOL, true,  "Collect latency samples")\
+    ACTION(seed,            OPTION_TYPE_UINT, 1234,  "Seed of the entries and key streams")
 
 #define O(b, opt) option_uint(&(b->options->benchmark.opt))
 #define O_BOOL(b, opt) option_bool(&(b->options->benchmark.opt))
+#define O_FPN(b, opt) option_fpn(&(b->options->benchmark.opt))
+#define O_STR(b, opt) option_str(&(b->options->benchmark.opt))
+
+/* 16ns resolution under 1us, within 1/32 of the value above, up to ~1s */
+#define HISTO_M 4
+#define HISTO_R 10
+#define HISTO_N 30
+#define LATENCY_MAX ((1ULL << HISTO_N) - 1) /* longer ones are recorded as max */
+
+static const double percentiles[] = {50, 90, 99, 99.9};
+#define NPERCENTILE (sizeof(percentiles) / sizeof(percentiles[0]))
 
 enum benchmark_operation {
     BENCHMARK_GET,
@@ -44,6 +77,30 @@ enum benchmark_operation {
 
 static const char *op_names[MAX_BENCHMARK_OPERATION] = {"get", "put", "rem"};
 
+enum benchmark_distribution {
+    BENCHMARK_UNIFORM,
+    BENCHMARK_ZIPF,
+    BENCHMARK_HOTSPOT,
+
+    MAX_BENCHMARK_DISTRIBUTION
+};
+
+static const char *dist_names[MAX_BENCHMARK_DISTRIBUTION] =
+    {"uniform", "zipf", "hotspot"};
+
+/*
+ * Zipf distribution over [0, n), where value i is drawn with a probability
+ * proportional to 1 / (i + 1)^theta, sampled in constant time as described in
+ * "Quickly Generating Billion-Record Synthetic Databases" (Gray et al.)
+ */
+struct zipf {
+    size_t n;
+    double theta;
+    double alpha;
+    double zetan;
+    double eta;
+};
+
 struct benchmark_specific {
     BENCHMARK_OPTION(OPTION_DECLARE)
 };
@@ -57,12 +114,65 @@ struct benchmark {
     struct benchmark_entry *entries;
     struct benchmark_options *options;
 
-    struct operation_latency {
-        struct duration *samples;
-        size_t count;
-    } latency[MAX_BENCHMARK_OPERATION];
+    enum benchmark_distribution key_dist;
+    struct zipf key_zipf;
+    size_t nhot; /* # keys in the hotspot */
+
+    struct benchmark_worker {
+        struct benchmark *b;
+        pthread_t tid;
+        uint64_t seed;
+        size_t nops;
+        size_t nfail[MAX_BENCHMARK_OPERATION];
+        struct histo_u32 *latency[MAX_BENCHMARK_OPERATION];
+    } *workers;
 };
 
+static void
+zipf_init(struct zipf *z, size_t n, double theta)
+{
+    double zeta2 = 1 + pow(0.5, theta);
+
+    z->n = n;
+    z->theta = theta;
+    z->alpha = 1 / (1 - theta);
+    z->zetan = 0;
+    for (size_t i = 1; i <= n; ++i) {
+        z->zetan += 1 / pow(i, theta);
+    }
+    z->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / z->zetan);
+}
+
+static size_t
+zipf_next(const struct zipf *z)
+{
+    double u = DRAND();
+    double uz = u * z->zetan;
+    size_t v;
+
+    if (uz < 1) {
+        return 0;
+    }
+    if (uz < 1 + pow(0.5, z->theta)) {
+        return MIN(1, z->n - 1);
+    }
+
+    v = (size_t)(z->n * pow(z->eta * u - z->eta + 1, z->alpha));
+    return MIN(v, z->n - 1);
+}
+
+static int
+benchmark_distribution(const char *name)
+{
+    for (int dist = 0; dist < MAX_BENCHMARK_DISTRIBUTION; ++dist) {
+        if (name != NULL && strcmp(name, dist_names[dist]) == 0) {
+            return dist;
+        }
+    }
+
+    return -1;
+}
+
 static rstatus_i
 benchmark_create(struct benchmark *b, const char *config)
 {
@@ -101,10 +211,67 @@ benchmark_create(struct benchmark *b, const char *config)
         return CC_EINVAL;
     }
 
-    for (int op = 0; op < MAX_BENCHMARK_OPERATION; ++op) {
-        b->latency[op].samples = O_BOOL(b, latency) ?
-            cc_alloc(O(b, nops) * sizeof(struct duration)) : NULL;
-        b->latency[op].count = 0;
+    if (O(b, pct_get) + O(b, pct_put) + O(b, pct_rem) != 100) {
+        log_crit("pct_get, pct_put and pct_rem must add up to 100");
+        cc_free(b->options);
+
+        return CC_EINVAL;
+    }
+
+    if (O(b, nthread) == 0 ||
+            (O(b, nthread) > 1 && !bench_storage_thread_safe())) {
+        log_crit("nthread must be 1 for storage that is not thread-safe");
+        cc_free(b->options);
+
+        return CC_EINVAL;
+    }
+
+    int key_dist = benchmark_distribution(O_STR(b, key_dist));
+    int size_dist = benchmark_distribution(O_STR(b, size_dist));
+    if (key_dist < 0 || size_dist < 0 || size_dist == BENCHMARK_HOTSPOT) {
+        log_crit("unknown key or size distribution");
+        cc_free(b->options);
+
+        return CC_EINVAL;
+    }
+
+    if ((key_dist == BENCHMARK_ZIPF || size_dist == BENCHMARK_ZIPF) &&
+            (O_FPN(b, zipf_theta) <= 0 || O_FPN(b, zipf_theta) >= 1)) {
+        log_crit("zipf_theta must be in (0, 1)");
+        cc_free(b->options);
+
+        return CC_EINVAL;
+    }
+
+    if (key_dist == BENCHMARK_HOTSPOT &&
+            (O(b, hotspot_pct_key) > 100 || O(b, hotspot_pct_op) > 100)) {
+        log_crit("hotspot_pct_key and hotspot_pct_op must be at most 100");
+        cc_free(b->options);
+
+        return CC_EINVAL;
+    }
+
+    b->key_dist = key_dist;
+    if (key_dist == BENCHMARK_ZIPF) {
+        zipf_init(&b->key_zipf, O(b, nentries), O_FPN(b, zipf_theta));
+    }
+    b->nhot = MAX(1, O(b, nentries) * O(b, hotspot_pct_key) / 100);
+
+    b->workers = cc_zalloc(sizeof(struct benchmark_worker) * O(b, nthread));
+    ASSERT(b->workers != NULL);
+
+    for (unsigned i = 0; i < O(b, nthread); ++i) {
+        struct benchmark_worker *w = &b->workers[i];
+
+        w->b = b;
+        w->seed = O(b, seed) + i + 1;
+        /* operations are split evenly, the first thread takes the remainder */
+        w->nops = O(b, nops) / O(b, nthread) +
+            (i == 0 ? O(b, nops) % O(b, nthread) : 0);
+        for (int op = 0; op < MAX_BENCHMARK_OPERATION; ++op) {
+            w->latency[op] = O_BOOL(b, latency) ?
+                histo_u32_create(HISTO_M, HISTO_R, HISTO_N) : NULL;
+        }
     }
 
     return CC_OK;
@@ -113,9 +280,12 @@ benchmark_create(struct benchmark *b, const char *config)
 static void
 benchmark_destroy(struct benchmark *b)
 {
-    for (int op = 0; op < MAX_BENCHMARK_OPERATION; ++op) {
-        cc_free(b->latency[op].samples);
+    for (unsigned i = 0; i < O(b, nthread); ++i) {
+        for (int op = 0; op < MAX_BENCHMARK_OPERATION; ++op) {
+            histo_u32_destroy(&b->workers[i].latency[op]);
+        }
     }
+    cc_free(b->workers);
     cc_free(b->options);
 }
 
@@ -150,11 +320,24 @@ static void
 benchmark_entries_populate(struct benchmark *b)
 {
     size_t nentries = O(b, nentries);
+    size_t min_size = O(b, entry_min_size);
+    size_t max_size = MAX(min_size, O(b, entry_max_size));
+    bool zipf = strcmp(O_STR(b, size_dist), "zipf") == 0;
+    struct zipf size_zipf;
+
     b->entries = cc_alloc(sizeof(struct benchmark_entry) * nentries);
     ASSERT(b->entries != NULL);
 
+    rstate = O(b, seed);
+
+    /* with zipf, smaller sizes are more common */
+    if (zipf) {
+        zipf_init(&size_zipf, max_size - min_size + 1, O_FPN(b, zipf_theta));
+    }
+
     for (size_t i = 1; i <= nentries; ++i) {
-        size_t size = RRAND(O(b, entry_min_size), O(b, entry_max_size));
+        size_t size = zipf ? min_size + zipf_next(&size_zipf) :
+            RRAND(min_size, max_size);
         b->entries[i - 1] = benchmark_entry_create(i, size);
     }
 }
@@ -172,40 +355,84 @@ static void
 benchmark_print_summary(struct benchmark *b, struct duration *d)
 {
     printf("total benchmark runtime: %f s\n", duration_sec(d));
-    printf("average operation latency: %f ns\n", duration_ns(d) / O(b, nops));
+    printf("throughput: %f ops/s with %u thread(s)\n",
+        O(b, nops) / duration_sec(d), (unsigned)O(b, nthread));
+    printf("average operation latency: %f ns\n",
+        duration_ns(d) * O(b, nthread) / O(b, nops));
+
+    for (int op = 0; op < MAX_BENCHMARK_OPERATION; ++op) {
+        size_t nfail = 0;
+
+        for (unsigned i = 0; i < O(b, nthread); ++i) {
+            nfail += b->workers[i].nfail[op];
+        }
+        if (nfail > 0) {
+            printf("%s failed %zu times\n", op_names[op], nfail);
+        }
+    }
+
     if (!O_BOOL(b, latency))
         return;
 
+    struct histo_u32 *merged = histo_u32_create(HISTO_M, HISTO_R, HISTO_N);
+    struct percentile_profile *profile = percentile_profile_create(NPERCENTILE);
+    ASSERT(merged != NULL && profile != NULL);
+    percentile_profile_set(profile, percentiles, NPERCENTILE);
+
     for (int op = 0; op < MAX_BENCHMARK_OPERATION; ++op) {
-        struct operation_latency *latency = &b->latency[op];
-        qsort(latency->samples, latency->count,
-            sizeof(struct duration), duration_compare);
-        struct duration *p50 =
-            &latency->samples[(size_t)(latency->count * 0.5)];
-        struct duration *p99 =
-            &latency->samples[(size_t)(latency->count * 0.99)];
-        struct duration *p999 =
-            &latency->samples[(size_t)(latency->count * 0.999)];
-        printf("Latency p50, p99, p99.9 for %s (%lu samples): %f, %f, %f\n",
+        histo_u32_reset(merged);
+        for (unsigned i = 0; i < O(b, nthread); ++i) {
+            histo_u32_merge(merged, b->workers[i].latency[op]);
+        }
+        if (histo_u32_report_multi(profile, merged) != HISTO_OK) {
+            continue; /* not recorded */
+        }
+
+        printf("Latency p50, p90, p99, p99.9, max for %s (%"PRIu64" samples): "
+            "%"PRIu64", %"PRIu64", %"PRIu64", %"PRIu64", %"PRIu64" ns\n",
             op_names[op],
-            latency->count,
-            duration_ns(p50),
-            duration_ns(p99),
-            duration_ns(p999));
+            merged->nrecord,
+            bucket_high(merged, profile->result[0]),
+            bucket_high(merged, profile->result[1]),
+            bucket_high(merged, profile->result[2]),
+            bucket_high(merged, profile->result[3]),
+            bucket_high(merged, profile->max));
+    }
+
+    percentile_profile_destroy(&profile);
+    histo_u32_destroy(&merged);
+}
+
+static size_t
+benchmark_next_key(struct benchmark *b)
+{
+    size_t nentries = O(b, nentries);
+
+    switch (b->key_dist) {
+        case BENCHMARK_UNIFORM:
+            return RRAND(0, nentries - 1);
+        case BENCHMARK_ZIPF:
+            return zipf_next(&b->key_zipf);
+        case BENCHMARK_HOTSPOT:
+            if (b->nhot == nentries || RRAND(0, 99) < O(b, hotspot_pct_op)) {
+                return RRAND(0, b->nhot - 1);
+            }
+            return RRAND(b->nhot, nentries - 1);
+        default:
+            NOT_REACHED();
+            return 0;
     }
 }
 
 static rstatus_i
-benchmark_run_operation(struct benchmark *b,
+benchmark_run_operation(struct benchmark_worker *w,
     struct benchmark_entry *e, enum benchmark_operation op)
 {
     rstatus_i status = CC_OK;
+    struct duration d;
 
-    struct operation_latency *latency = &b->latency[op];
-    size_t nsample = latency->count++;
-
-    if (O_BOOL(b, latency))
-        duration_start_type(&latency->samples[nsample], DURATION_FAST);
+    if (O_BOOL(w->b, latency))
+        duration_start_type(&d, DURATION_FAST);
 
     switch (op) {
         case BENCHMARK_GET:
@@ -221,99 +448,96 @@ benchmark_run_operation(struct benchmark *b,
             NOT_REACHED();
     }
 
-    if (O_BOOL(b, latency))
-        duration_stop(&latency->samples[nsample]);
+    if (O_BOOL(w->b, latency)) {
+        duration_stop(&d);
+        histo_u32_record(w->latency[op],
+            MIN((uint64_t)duration_ns(&d), LATENCY_MAX), 1);
+    }
 
     return status;
 }
 
-static struct duration
-benchmark_run(struct benchmark *b)
+static void *
+benchmark_worker_run(void *arg)
 {
-    struct array *in;
-    struct array *in2;
-    struct array *out;
-
-    size_t nentries = O(b, nentries);
+    struct benchmark_worker *w = arg;
+    struct benchmark *b = w->b;
+    unsigned pct_get = O(b, pct_get);
+    unsigned pct_put = O(b, pct_put);
+
+    rstate = w->seed;
+
+    for (size_t i = 0; i < w->nops; ++i) {
+        struct benchmark_entry *e = &b->entries[benchmark_next_key(b)];
+        unsigned pct = RRAND(0, 99);
+        enum benchmark_operation op;
+
+        if (pct < pct_get) {
+            op = BENCHMARK_GET;
+        } else if (pct < pct_get + pct_put) {
+            op = BENCHMARK_PUT;
+        } else {
+            op = BENCHMARK_REM;
+        }
 
-    bench_storage_init(b->options->engine, O(b, entry_max_size), nentries);
+        /* gets and removes of removed entries fail, and are still counted */
+        if (benchmark_run_operation(w, e, op) != CC_OK) {
+            w->nfail[op]++;
+        }
+    }
 
-    array_create(&in, nentries, sizeof(struct benchmark_entry *));
-    array_create(&in2, nentries, sizeof(struct benchmark_entry *));
-    array_create(&out, nentries, sizeof(struct benchmark_entry *));
+    return NULL;
+}
 
-    for (size_t i = 0; i < nentries; ++i) {
-        struct benchmark_entry **e = array_push(in);
-        *e = &b->entries[i];
+/* DRAM held per byte of key and value stored, once all entries are in */
+static void
+benchmark_print_memory(struct benchmark *b)
+{
+    size_t payload = 0, heap, metadata;
 
-        ASSERT(bench_storage_put(*e) == CC_OK);
+    for (size_t i = 0; i < O(b, nentries); ++i) {
+        payload += strlen(b->entries[i].key) + strlen(b->entries[i].value);
     }
 
-    struct duration d;
-    duration_start(&d);
-
-    for (size_t i = 0; i < O(b, nops); ++i) {
-        if (array_nelem(in) == 0) {
-            SWAP(in, in2);
-            /* XXX: array_shuffle(in) */
-        }
-
-        unsigned pct = RRAND(0, 100);
+    bench_storage_memory(&heap, &metadata);
 
-        unsigned pct_sum = 0;
-        if (pct_sum <= pct && pct < O(b, pct_get) + pct_sum) {
-            ASSERT(array_nelem(in) != 0);
-            struct benchmark_entry **e = array_pop(in);
+    printf("memory: %zu B of heap and %zu B of metadata for %zu B of "
+        "payload, %f B per payload byte\n", heap, metadata, payload,
+        (double)(heap + metadata) / payload);
+}
 
-            if (benchmark_run_operation(b, *e, BENCHMARK_GET) != CC_OK) {
-                log_info("benchmark get() failed");
-            }
+static struct duration
+benchmark_run(struct benchmark *b)
+{
+    size_t nentries = O(b, nentries);
+    unsigned nthread = O(b, nthread);
 
-            struct benchmark_entry **e2 = array_push(in2);
-            *e2 = *e;
-        }
-        pct_sum += O(b, pct_get);
-        if (pct_sum <= pct && pct < O(b, pct_put) + pct_sum) {
-            struct benchmark_entry **e;
-            if (array_nelem(out) != 0) {
-                e = array_pop(out);
-            } else {
-                ASSERT(array_nelem(in) != 0);
-                e = array_pop(in);
-                if (bench_storage_rem(*e) != CC_OK) {
-                    log_info("benchmark rem() failed");
-                }
-            }
+    bench_storage_init(b->options->engine, O(b, entry_max_size), nentries,
+        nthread);
 
-            if (benchmark_run_operation(b, *e, BENCHMARK_PUT) != CC_OK) {
-                log_info("benchmark put() failed");
-            }
+    for (size_t i = 0; i < nentries; ++i) {
+        ASSERT(bench_storage_put(&b->entries[i]) == CC_OK);
+    }
 
-            struct benchmark_entry **e2 = array_push(in2);
-            *e2 = *e;
-        }
-        pct_sum += O(b, pct_put);
-        if (pct_sum < pct && pct <= O(b, pct_rem) + pct_sum) {
-            ASSERT(array_nelem(in) != 0);
-            struct benchmark_entry **e = array_pop(in);
+    benchmark_print_memory(b);
 
-            if (benchmark_run_operation(b, *e, BENCHMARK_REM) != CC_OK) {
-                log_info("benchmark rem() failed");
-            }
+    struct duration d;
+    duration_start(&d);
 
-            struct benchmark_entry **e2 = array_push(out);
-            *e2 = *e;
-        }
+    for (unsigned i = 1; i < nthread; ++i) {
+        int ret = pthread_create(&b->workers[i].tid, NULL,
+            benchmark_worker_run, &b->workers[i]);
+        ASSERT(ret == 0);
+    }
+    benchmark_worker_run(&b->workers[0]);
+    for (unsigned i = 1; i < nthread; ++i) {
+        pthread_join(b->workers[i].tid, NULL);
     }
 
     duration_stop(&d);
 
     bench_storage_deinit();
 
-    array_destroy(&in);
-    array_destroy(&in2);
-    array_destroy(&out);
-
     return d;
 }
 
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cc_define.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 typedef size_t benchmark_key_u;
 
@@ -12,11 +14,16 @@ struct benchmark_entry {
     size_t value_size;
 };
 
-rstatus_i bench_storage_init(void *opts, size_t item_size, size_t nentries);
+rstatus_i bench_storage_init(void *opts, size_t item_size, size_t nentries,
+    uint32_t nthread);
 rstatus_i bench_storage_deinit(void);
 rstatus_i bench_storage_put(struct benchmark_entry *e);
 rstatus_i bench_storage_get(struct benchmark_entry *e);
 rstatus_i bench_storage_rem(struct benchmark_entry *e);
 unsigned bench_storage_config_nopts(void);
 void bench_storage_config_init(void *opts);
+/* whether operations can be run from several threads at once */
+bool bench_storage_thread_safe(void);
+/* bytes of the heap in use by items, and of the metadata kept outside of it */
+void bench_storage_memory(size_t *heap, size_t *metadata);
 
@@ -4,6 +4,7 @@
 #include <storage/cuckoo/cuckoo.h>
 
 static cuckoo_metrics_st metrics = { CUCKOO_METRIC(METRIC_INIT) };
+static size_t heap_size;
 
 unsigned
 bench_storage_config_nopts(void)
@@ -20,8 +21,15 @@ bench_storage_config_init(void *options)
     option_load_default(options, OPTION_CARDINALITY(cuckoo_options_st));
 }
 
+bool
+bench_storage_thread_safe(void)
+{
+    return false;
+}
+
 rstatus_i
-bench_storage_init(void *opts, size_t item_size, size_t nentries)
+bench_storage_init(void *opts, size_t item_size, size_t nentries,
+    uint32_t nthread)
 {
     cuckoo_options_st *options = opts;
     options->cuckoo_policy.val.vuint = CUCKOO_POLICY_EXPIRE;
@@ -29,10 +37,21 @@ bench_storage_init(void *opts, size_t item_size, size_t nentries)
     options->cuckoo_nitem.val.vuint = nentries;
 
     cuckoo_setup(options, &metrics);
+    heap_size = option_uint(&options->cuckoo_item_size) *
+        option_uint(&options->cuckoo_nitem);
 
     return CC_OK;
 }
 
+void
+bench_storage_memory(size_t *heap, size_t *metadata)
+{
+    /* items are stored in the hash table itself, which is allocated whole at
+     * setup; its tag words (a word per 4 items) are left out */
+    *heap = heap_size;
+    *metadata = 0;
+}
+
 rstatus_i
 bench_storage_deinit(void)
 {
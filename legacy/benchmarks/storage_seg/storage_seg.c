@@ -0,0 +1,120 @@
+#include <bench_storage.h>
+
+#include <storage/seg/item.h>
+#include <storage/seg/seg.h>
+
+static seg_metrics_st metrics = { SEG_METRIC(METRIC_INIT) };
+static uint32_t hash_power;
+
+unsigned
+bench_storage_config_nopts(void)
+{
+    return OPTION_CARDINALITY(seg_options_st);
+}
+
+void
+bench_storage_config_init(void *options)
+{
+    seg_options_st *opts = options;
+    *opts = (seg_options_st){ SEG_OPTION(OPTION_INIT) };
+
+    option_load_default(options, OPTION_CARDINALITY(seg_options_st));
+}
+
+bool
+bench_storage_thread_safe(void)
+{
+    return true;
+}
+
+rstatus_i
+bench_storage_init(void *opts, size_t entry_size, size_t nentries,
+    uint32_t nthread)
+{
+    seg_options_st *options = opts;
+    size_t seg_size = option_uint(&options->seg_size);
+
+    hash_power = option_uint(&options->hash_power);
+
+    /* twice the room needed by all entries, so puts rarely evict, and a seg
+     * for each of the threads to write to */
+    options->heap_mem.val.vuint = CC_ALIGN(2 * nentries *
+        item_size(sizeof(benchmark_key_u), entry_size, 0), seg_size) +
+        (nthread + 2) * seg_size;
+    while ((1ULL << hash_power) < 2 * nentries) {
+        hash_power++;
+    }
+    options->hash_power.val.vuint = hash_power;
+    options->seg_n_thread.val.vuint = nthread;
+
+    seg_setup(options, &metrics);
+
+    return CC_OK;
+}
+
+void
+bench_storage_memory(size_t *heap_used, size_t *metadata)
+{
+    int32_t nseg = 0;
+
+    /* segs handed out to a thread but not written to yet are not in use */
+    for (int32_t i = 0; i < heap.max_nseg; i++) {
+        if (heap.segs[i].write_offset > 0) {
+            nseg++;
+        }
+    }
+
+    *heap_used = nseg * heap.seg_size;
+    *metadata = (1ULL << hash_power) * sizeof(uint64_t) +
+        heap.max_nseg * sizeof(struct seg);
+}
+
+rstatus_i
+bench_storage_deinit(void)
+{
+    seg_teardown();
+    return CC_OK;
+}
+
+rstatus_i
+bench_storage_put(struct benchmark_entry *e)
+{
+    struct bstring key;
+    struct bstring val;
+    struct item *it;
+
+    bstring_set_cstr(&val, e->value);
+    bstring_set_cstr(&key, e->key);
+
+    item_rstatus_e status = item_reserve(&it, &key, &val, val.len, 0, INT32_MAX);
+    if (status != ITEM_OK)
+        return CC_ENOMEM;
+
+    item_insert(it);
+
+    return CC_OK;
+}
+
+rstatus_i
+bench_storage_get(struct benchmark_entry *e)
+{
+    struct bstring key;
+    bstring_set_cstr(&key, e->key);
+    struct item *it = item_get(&key, NULL);
+
+    if (it == NULL)
+        return CC_EEMPTY;
+
+    item_release(it);
+
+    return CC_OK;
+}
+
+rstatus_i
+bench_storage_rem(struct benchmark_entry *e)
+{
+    struct bstring key;
+    bstring_set_cstr(&key, e->key);
+
+    return item_delete(&key) ? CC_OK : CC_EEMPTY;
+}
@@ -20,8 +20,15 @@ bench_storage_config_init(void *options)
     option_load_default(options, OPTION_CARDINALITY(slab_options_st));
 }
 
+bool
+bench_storage_thread_safe(void)
+{
+    return false;
+}
+
 rstatus_i
-bench_storage_init(void *opts, size_t item_size, size_t nentries)
+bench_storage_init(void *opts, size_t item_size, size_t nentries,
+    uint32_t nthread)
 {
     slab_options_st *options = opts;
     options->slab_mem.val.vuint =
@@ -33,6 +40,18 @@ bench_storage_init(void *opts, size_t item_size, size_t nentries)
     return CC_OK;
 }
 
+void
+bench_storage_memory(size_t *heap, size_t *metadata)
+{
+    /* slab headers live in the slabs, and are part of the heap */
+    *heap = metrics.slab_memory.gauge;
+    *metadata = HASHSIZE(hash_table->hash_power) * sizeof(struct item_slh);
+    if (hash_table->old_table != NULL) {
+        *metadata += HASHSIZE(hash_table->hash_power - 1) *
+            sizeof(struct item_slh);
+    }
+}
+
 rstatus_i
 bench_storage_deinit(void)
 {
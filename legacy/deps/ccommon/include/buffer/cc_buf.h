@@ -56,14 +56,22 @@ typedef struct {
     ACTION( buf_borrow,       METRIC_COUNTER, "# buf borrows"                          )\
     ACTION( buf_borrow_ex,    METRIC_COUNTER, "# buf borrow exceptions"                )\
     ACTION( buf_return,       METRIC_COUNTER, "# buf returns"                          )\
+    ACTION( buf_chain,        METRIC_COUNTER, "# buf chained to another"               )\
+    ACTION( buf_ref,          METRIC_COUNTER, "# buf referring to data not its own"    )\
+    ACTION( buf_unref,        METRIC_COUNTER, "# buf copying data it referred to"      )\
     ACTION( buf_memory,       METRIC_GAUGE,   "memory alloc'd to buf including header" )
 
 typedef struct {
     BUF_METRIC(METRIC_DECLARE)
 } buf_metrics_st;
 
+typedef void (*buf_release_fn)(void *);
+
 struct buf {
     STAILQ_ENTRY(buf) next;     /* next buf in pool */
+    struct buf        *chain;   /* next buf holding data after this one */
+    buf_release_fn    release;  /* releases data referred to, NULL if owned */
+    void              *ref;     /* what release is called on */
     char              *rpos;    /* read marker */
     char              *wpos;    /* write marker */
     char              *end;     /* end of buffer */
@@ -101,6 +109,37 @@ void buf_return(struct buf **buf);
 struct buf *buf_create(void);
 void buf_destroy(struct buf **buf);
 
+/**
+ * A buffer can have more buffers chained after it, which hold the data that
+ * did not fit, so that large content is spread over several buffers instead
+ * of growing one and copying what it already holds. Chained buffers are
+ * borrowed from the pool, and returned when the buffer is reset or returned.
+ */
+struct buf *buf_chain_extend(struct buf *buf); /* chain a new buf after buf */
+void buf_chain_return(struct buf *buf); /* return every buf after buf */
+
+/**
+ * A chained buffer can also refer to data it does not hold, such as a value
+ * in storage, which is only to be read (written out) and not copied. The
+ * data must stay valid until release(ref) is called, which happens when the
+ * buffer is returned, or when buf_chain_unref copies the data into buffers
+ * of its own because it cannot wait for the data to be written out.
+ */
+struct buf *buf_chain_ref(struct buf *buf, char *data, uint32_t len,
+        buf_release_fn release, void *ref);
+rstatus_i buf_chain_unref(struct buf *buf);
+
+/* last buf in the chain, which new data is written to */
+static inline struct buf **
+buf_chain_tail(struct buf **buf)
+{
+    while ((*buf)->chain != NULL) {
+        buf = &(*buf)->chain;
+    }
+
+    return buf;
+}
+
 /* Size of data that has yet to be read */
 static inline uint32_t
 buf_rsize(const struct buf *buf)
@@ -110,6 +149,19 @@ buf_rsize(const struct buf *buf)
     return (uint32_t)(buf->wpos - buf->rpos);
 }
 
+/* Size of data that has yet to be read, including the chained bufs */
+static inline uint32_t
+buf_chain_rsize(const struct buf *buf)
+{
+    uint32_t size = 0;
+
+    for (; buf != NULL; buf = buf->chain) {
+        size += buf_rsize(buf);
+    }
+
+    return size;
+}
+
 /* Amount of room left in buffer for writing new data */
 static inline uint32_t
 buf_wsize(const struct buf *buf)
@@ -149,6 +201,11 @@ buf_new_cap(const struct buf *buf, uint32_t count)
 static inline void
 buf_reset(struct buf *buf)
 {
+    ASSERT(buf->release == NULL);
+
+    if (buf->chain != NULL) {
+        buf_chain_return(buf);
+    }
     STAILQ_NEXT(buf, next) = NULL;
     buf->free = 0;
     buf->rpos = buf->wpos = buf->begin;
@@ -30,12 +30,20 @@ extern "C" {
 #define DEBUG_LOG_LEVEL 4       /* default log level */
 #define DEBUG_LOG_FILE  NULL    /* default log file */
 #define DEBUG_LOG_NBUF  0       /* default log buf size */
+#define DEBUG_LOG_LOCAL false   /* default to one buf shared by all threads */
 
+/*
+ * With debug_log_local set, each thread logs into a buf of its own of
+ * debug_log_nbuf bytes, which debug_log_flush drains from the background. A
+ * thread never writes to the log file or contends with other threads, and
+ * drops (and counts as log_skip) the messages which do not fit in its buf.
+ */
 /*          name             type              default           description */
-#define DEBUG_OPTION(ACTION)                                                            \
-    ACTION( debug_log_level, OPTION_TYPE_UINT, DEBUG_LOG_LEVEL,  "debug log level"     )\
-    ACTION( debug_log_file,  OPTION_TYPE_STR,  DEBUG_LOG_FILE,   "debug log file"      )\
-    ACTION( debug_log_nbuf,  OPTION_TYPE_UINT, DEBUG_LOG_NBUF,   "debug log buf size"  )
+#define DEBUG_OPTION(ACTION)                                                                     \
+    ACTION( debug_log_level, OPTION_TYPE_UINT, DEBUG_LOG_LEVEL,  "debug log level"              )\
+    ACTION( debug_log_file,  OPTION_TYPE_STR,  DEBUG_LOG_FILE,   "debug log file"               )\
+    ACTION( debug_log_nbuf,  OPTION_TYPE_UINT, DEBUG_LOG_NBUF,   "debug log buf size"           )\
+    ACTION( debug_log_local, OPTION_TYPE_BOOL, DEBUG_LOG_LOCAL,  "debug log buf for each thread")
 
 typedef struct {
     DEBUG_OPTION(OPTION_DECLARE)
@@ -67,6 +67,22 @@ int event_add_read(struct event_base *evb, int fd, void *data);
 int event_add_write(struct event_base *evb, int fd, void *data);
 int event_del(struct event_base *evb, int fd);
 
+/**
+ * Edge-triggered registration of both read and write events, which is done
+ * once for the lifetime of the fd: an event is only returned when the fd
+ * becomes readable or writable again, so the caller has to read (write) until
+ * it would block before waiting for the next read (write) event.
+ */
+int event_add_edge(struct event_base *evb, int fd, void *data);
+/**
+ * Read event on a fd that is shared by more than one event base, e.g. a
+ * listening socket, which only wakes up one of them (where supported).
+ */
+int event_add_exclusive(struct event_base *evb, int fd, void *data);
+
+/* busy poll for up to usec before sleeping in event_wait, 0 to disable */
+int event_busy_poll(struct event_base *evb, uint32_t usec);
+
 /* event wait */
 int event_wait(struct event_base *evb, int timeout);
 
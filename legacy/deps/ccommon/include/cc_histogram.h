@@ -14,6 +14,7 @@ typedef enum histo_rstatus {
     HISTO_EUNDERFLOW = -2,
     HISTO_EEMPTY     = -3,
     HISTO_EORDER     = -4,
+    HISTO_EMISMATCH  = -5,
 } histo_rstatus_e;
 
 struct percentile_profile
@@ -84,7 +85,16 @@ bucket_high(const struct histo_u32 *h, uint64_t bucket)
  * Non-thread-safe APIs *
  ************************/
 void histo_u32_reset(struct histo_u32 *h);
+/* a histogram recorded into by one thread can still be read by others: each
+ * bucket and nrecord are updated with a (relaxed) atomic store, so a reader
+ * sees a count either before or after a record, never a torn value
+ */
 histo_rstatus_e histo_u32_record(struct histo_u32 *h, uint64_t value, uint32_t count);
+/* add the counts of src, which may be recorded into meanwhile, to dst; both
+ * must have been created with the same m, r and n. This allows per-thread
+ * histograms to be reported together without locking them.
+ */
+histo_rstatus_e histo_u32_merge(struct histo_u32 *dst, const struct histo_u32 *src);
 /* the following functions return the bucket for the percentile(s) requested.
  * If the histogram is too sparse for the percentile specified, the next
  * (higher) non-empty bucket is returned.
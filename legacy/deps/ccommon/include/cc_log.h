@@ -29,6 +29,8 @@ extern "C" {
 
 #define LOG_MAX_LEN 2560 /* max length of log message to STDOUT/STDERR */
 
+struct rbuf;
+
 struct logger {
     char *name;                 /* log file name */
     int  fd;                    /* log file descriptor */
@@ -84,9 +86,18 @@ rstatus_i log_reopen(struct logger *logger, char *target);
 /* _log_write returns true if msg written, false if skipped or failed */
 bool log_write(struct logger *logger, char *buf, uint32_t len);
 
+/**
+ * log_write_buf and log_flush_buf are log_write and log_flush through a ring
+ * other than the buffer of the logger, such as one for each thread that logs.
+ * A ring takes one writer and one flusher in different threads. A NULL ring
+ * is treated as full, so the message is skipped.
+ */
+bool log_write_buf(struct logger *logger, struct rbuf *buf, char *msg, uint32_t len);
+
 void _log_fd(int fd, const char *fmt, ...);
 
 size_t log_flush(struct logger *logger);
+size_t log_flush_buf(struct logger *logger, struct rbuf *buf);
 
 #ifdef __cplusplus
 }
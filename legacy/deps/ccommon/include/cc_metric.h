@@ -38,9 +38,28 @@ extern "C" {
 } while(0)
 #define metric_incr(_metric) metric_incr_n(_metric, 1)
 
+/* a shard is only updated by the thread it belongs to, so no atomic add */
+#define metric_shard_add(_metric, _delta) do {                              \
+    if ((_metric).type == METRIC_COUNTER) {                                 \
+         __atomic_store_n(&(_metric).counter, __atomic_load_n(              \
+             &(_metric).counter, __ATOMIC_RELAXED) + (uint64_t)(_delta),    \
+             __ATOMIC_RELAXED);                                             \
+    } else if ((_metric).type == METRIC_GAUGE) {                            \
+         __atomic_store_n(&(_metric).gauge, __atomic_load_n(                \
+             &(_metric).gauge, __ATOMIC_RELAXED) + (_delta),                \
+             __ATOMIC_RELAXED);                                             \
+    } else { /* error  */                                                   \
+    }                                                                       \
+} while(0)
+
 #define INCR_N(_base, _metric, _delta) do {                                 \
     if ((_base) != NULL) {                                                  \
-         metric_incr_n((_base)->_metric, _delta);                           \
+        struct metric *_shard = metric_shard(&(_base)->_metric);            \
+        if (_shard != NULL) {                                               \
+            metric_shard_add(*_shard, (int64_t)(_delta));                   \
+        } else {                                                            \
+            metric_incr_n((_base)->_metric, _delta);                        \
+        }                                                                   \
     }                                                                       \
 } while(0)
 #define INCR(_base, _metric) INCR_N(_base, _metric, 1)
@@ -55,7 +74,14 @@ extern "C" {
 
 #define DECR_N(_base, _metric, _delta) do {                                 \
     if ((_base) != NULL) {                                                  \
-         metric_decr_n((_base)->_metric, _delta);                           \
+        struct metric *_shard = metric_shard(&(_base)->_metric);            \
+        if (_shard != NULL) {                                               \
+            if (_shard->type == METRIC_GAUGE) {                             \
+                metric_shard_add(*_shard, -(int64_t)(_delta));              \
+            }                                                               \
+        } else {                                                            \
+            metric_decr_n((_base)->_metric, _delta);                        \
+        }                                                                   \
     }                                                                       \
 } while(0)
 #define DECR(_base, _metric) DECR_N(_base, _metric, 1)
@@ -135,6 +161,44 @@ struct metric {
     };
 };
 
+/**
+ * Metrics which many threads update on their hot path can be sharded, so that
+ * the threads don't contend on the cache lines of the metrics they share.
+ * A shard is a copy of a contiguous range of metrics, e.g. all metrics of an
+ * application, and a thread that has taken a shard with metric_shard_thread
+ * has INCR/DECR update its copy of metrics in the range, without an atomic
+ * read-modify-write. Other threads, and metrics outside the range, update
+ * the shared metrics as before. Each shard starts at a cache line.
+ *
+ * The value of a sharded metric is the shared value plus that of every
+ * shard, which is what metric_counter/metric_gauge and metric_print return.
+ * UPDATE_VAL always sets the shared value, so metrics set this way should
+ * not also be INCR/DECR'ed by threads with a shard.
+ */
+extern char *metric_shard_begin;
+extern char *metric_shard_end;
+extern __thread ptrdiff_t metric_shard_offset; /* of the thread's shard */
+
+/* the thread's copy of a metric if it is sharded, NULL otherwise */
+static inline struct metric *
+metric_shard(struct metric *m)
+{
+    if (metric_shard_offset == 0 || (char *)m < metric_shard_begin ||
+            (char *)m >= metric_shard_end) {
+        return NULL;
+    }
+
+    return (struct metric *)((char *)m + metric_shard_offset);
+}
+
+rstatus_i metric_shard_setup(struct metric metrics[], unsigned int nmetric,
+        unsigned int nshard);
+void metric_shard_teardown(void);
+void metric_shard_thread(unsigned int idx); /* calling thread takes shard idx */
+
+uint64_t metric_counter(struct metric *m);
+int64_t metric_gauge(struct metric *m);
+
 void metric_reset(struct metric sarr[], unsigned int nmetric);
 size_t metric_print(char *buf, size_t nbuf, char *fmt, struct metric *m);
 void metric_describe_all(struct metric metrics[], unsigned int nmetric);
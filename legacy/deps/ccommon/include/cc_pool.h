@@ -22,19 +22,53 @@ extern "C" {
 #endif
 
 #include <cc_debug.h>
+#include <cc_mm.h>
 #include <cc_queue.h>
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdbool.h>
 
+/*
+ * A pool is a free list of objects which are created on demand, up to nmax.
+ * FREEPOOL_BORROW and FREEPOOL_RETURN do not lock, so they are for pools used
+ * by one thread, or under a lock of the caller.
+ *
+ * Pools used by several threads can instead be accessed through a cache of the
+ * calling thread with FREEPOOL_CACHE_BORROW and FREEPOOL_CACHE_RETURN. Each
+ * thread keeps a `static __thread struct <pool>_local`, which holds its cache
+ * once the thread first uses the pool. Objects are moved between a cache and
+ * the shared free list FREEPOOL_MAGAZINE at a time under the lock of the pool,
+ * so most borrows and returns touch nothing but the cache of the thread. An
+ * object may be returned by a different thread than the one which borrowed it.
+ *
+ * Objects held by caches count as used by the pool, so a thread may keep up to
+ * 2 * FREEPOOL_MAGAZINE - 1 idle objects which no other thread can borrow. The
+ * caches are emptied into the pool and freed by FREEPOOL_DESTROY, which must
+ * not race with any other access to the pool.
+ */
+#define FREEPOOL_MAGAZINE 32
+
 #define FREEPOOL(pool, name, type)                                  \
 STAILQ_HEAD(name, type);                                            \
+struct pool##_cache {                                               \
+    struct name         freeq;                                      \
+    uint32_t            nfree;                                      \
+    struct pool##_cache *next;      /* next cache of the pool */    \
+};                                                                  \
+struct pool##_local {                                               \
+    struct pool##_cache *cache;                                     \
+    uint32_t            gen;        /* gen of the pool it is for */ \
+};                                                                  \
 struct pool {                                                       \
     struct name     freeq;                                          \
     uint32_t        nfree;                                          \
     uint32_t        nused;                                          \
     uint32_t        nmax;                                           \
     bool            initialized;                                    \
+    pthread_mutex_t lock;           /* for access through caches */ \
+    struct pool##_cache *caches;                                    \
+    uint32_t        gen;            /* incremented on each create */\
 }
 
 #define FREEPOOL_CREATE(pool, max) do {                             \
@@ -43,17 +77,29 @@ struct pool {                                                       \
     (pool)->nmax = (max) > 0 ? (max) : UINT32_MAX;                  \
     (pool)->nfree = 0;                                              \
     (pool)->nused = 0;                                              \
+    pthread_mutex_init(&(pool)->lock, NULL);                        \
+    (pool)->caches = NULL;                                          \
+    (pool)->gen++;                                                  \
     (pool)->initialized = true;                                     \
 } while (0)
 
 #define FREEPOOL_DESTROY(var, tvar, pool, field, destroy) do {      \
     ASSERT((pool)->initialized);                                    \
+    while ((pool)->caches != NULL) {                                \
+        __typeof__((pool)->caches) _c = (pool)->caches;             \
+        (pool)->caches = _c->next;                                  \
+        STAILQ_CONCAT(&(pool)->freeq, &_c->freeq);                  \
+        (pool)->nfree += _c->nfree;                                 \
+        (pool)->nused -= _c->nfree;                                 \
+        cc_free(_c);                                                \
+    }                                                               \
     ASSERT((pool)->nused == 0);                                     \
     STAILQ_FOREACH_SAFE(var, &(pool)->freeq, field, tvar) {         \
         STAILQ_REMOVE_HEAD(&(pool)->freeq, next);                   \
         (pool)->nfree--;                                            \
         destroy(&var);                                              \
     }                                                               \
+    pthread_mutex_destroy(&(pool)->lock);                           \
     (pool)->initialized = false;                                    \
     ASSERT((pool)->nfree == 0);                                     \
     ASSERT(STAILQ_EMPTY(&(pool)->freeq));                           \
@@ -96,6 +142,85 @@ struct pool {                                                       \
     (pool)->nused--;                                                \
 } while (0)
 
+/* set up the cache of the calling thread, which is left NULL on OOM so that
+ * the thread falls back to borrowing from the pool under its lock */
+#define _FREEPOOL_CACHE_JOIN(local, pool) do {                      \
+    (local)->cache = cc_zalloc(sizeof(*(local)->cache));            \
+    (local)->gen = (pool)->gen;                                     \
+    if ((local)->cache != NULL) {                                   \
+        STAILQ_INIT(&(local)->cache->freeq);                        \
+        pthread_mutex_lock(&(pool)->lock);                          \
+        (local)->cache->next = (pool)->caches;                      \
+        (pool)->caches = (local)->cache;                            \
+        pthread_mutex_unlock(&(pool)->lock);                        \
+    }                                                               \
+} while (0)
+
+/* move up to n objects from the head of freeq src to freeq dst */
+#define _FREEPOOL_MOVE(var, dst, src, n, field) do {                \
+    uint32_t _i;                                                    \
+    for (_i = 0; _i < (n) && !STAILQ_EMPTY(src); _i++) {            \
+        (var) = STAILQ_FIRST(src);                                  \
+        STAILQ_REMOVE_HEAD(src, field);                             \
+        STAILQ_INSERT_HEAD(dst, var, field);                        \
+    }                                                               \
+    (n) = _i;                                                       \
+} while (0)
+
+#define FREEPOOL_CACHE_BORROW(var, local, pool, field, create) do { \
+    ASSERT((pool)->initialized);                                    \
+    if ((local)->gen != (pool)->gen) {                              \
+        _FREEPOOL_CACHE_JOIN(local, pool);                          \
+    }                                                               \
+    if ((local)->cache != NULL &&                                   \
+            STAILQ_EMPTY(&(local)->cache->freeq)) {                 \
+        uint32_t _n = FREEPOOL_MAGAZINE;                            \
+        pthread_mutex_lock(&(pool)->lock);                          \
+        _FREEPOOL_MOVE(var, &(local)->cache->freeq, &(pool)->freeq, \
+                _n, field);                                         \
+        (pool)->nfree -= _n;                                        \
+        (pool)->nused += _n;                                        \
+        pthread_mutex_unlock(&(pool)->lock);                        \
+        (local)->cache->nfree = _n;                                 \
+    }                                                               \
+    if ((local)->cache != NULL &&                                   \
+            !STAILQ_EMPTY(&(local)->cache->freeq)) {                \
+        (var) = STAILQ_FIRST(&(local)->cache->freeq);               \
+        STAILQ_REMOVE_HEAD(&(local)->cache->freeq, field);          \
+        (local)->cache->nfree--;                                    \
+        STAILQ_NEXT((var), field) = NULL;                           \
+    } else {                                                        \
+        pthread_mutex_lock(&(pool)->lock);                          \
+        FREEPOOL_BORROW(var, pool, field, create);                  \
+        pthread_mutex_unlock(&(pool)->lock);                        \
+    }                                                               \
+} while (0)
+
+#define FREEPOOL_CACHE_RETURN(var, local, pool, field) do {         \
+    ASSERT((pool)->initialized);                                    \
+    if ((local)->gen != (pool)->gen) {                              \
+        _FREEPOOL_CACHE_JOIN(local, pool);                          \
+    }                                                               \
+    if ((local)->cache == NULL) {                                   \
+        pthread_mutex_lock(&(pool)->lock);                          \
+        FREEPOOL_RETURN(var, pool, field);                          \
+        pthread_mutex_unlock(&(pool)->lock);                        \
+    } else {                                                        \
+        STAILQ_INSERT_HEAD(&(local)->cache->freeq, var, field);     \
+        if (++(local)->cache->nfree >= 2 * FREEPOOL_MAGAZINE) {     \
+            __typeof__(var) _v;                                     \
+            uint32_t _n = FREEPOOL_MAGAZINE;                        \
+            pthread_mutex_lock(&(pool)->lock);                      \
+            _FREEPOOL_MOVE(_v, &(pool)->freeq,                      \
+                    &(local)->cache->freeq, _n, field);             \
+            (pool)->nfree += _n;                                    \
+            (pool)->nused -= _n;                                    \
+            pthread_mutex_unlock(&(pool)->lock);                    \
+            (local)->cache->nfree -= _n;                            \
+        }                                                           \
+    }                                                               \
+} while (0)
+
 #ifdef __cplusplus
 }
 #endif
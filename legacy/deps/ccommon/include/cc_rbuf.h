@@ -17,6 +17,10 @@
 
 /*
  * rbuf: a ring buffer designed for logging use (NOT THREADSAFE!)
+ *
+ * It does take one writer and one reader in different threads: either side
+ * only updates its own offset, after the bytes it covers are copied, and the
+ * offset of the other side is loaded before those bytes are touched.
  */
 
 #pragma once
@@ -53,25 +57,25 @@ struct rbuf {
 static inline uint32_t
 get_rpos(struct rbuf *buf)
 {
-    return __atomic_load_n(&(buf->rpos), __ATOMIC_RELAXED);
+    return __atomic_load_n(&(buf->rpos), __ATOMIC_ACQUIRE);
 }
 
 static inline uint32_t
 get_wpos(struct rbuf *buf)
 {
-    return __atomic_load_n(&(buf->wpos), __ATOMIC_RELAXED);
+    return __atomic_load_n(&(buf->wpos), __ATOMIC_ACQUIRE);
 }
 
 static inline void
 set_rpos(struct rbuf *buf, uint32_t rpos)
 {
-    __atomic_store_n(&(buf->rpos), rpos, __ATOMIC_RELAXED);
+    __atomic_store_n(&(buf->rpos), rpos, __ATOMIC_RELEASE);
 }
 
 static inline void
 set_wpos(struct rbuf *buf, uint32_t wpos)
 {
-    __atomic_store_n(&(buf->wpos), wpos, __ATOMIC_RELAXED);
+    __atomic_store_n(&(buf->wpos), wpos, __ATOMIC_RELEASE);
 }
 
 /* setup/teardown */
@@ -22,6 +22,14 @@
  * thread does all of the popping. Given these conditions are met, the ring
  * array can guarantee that all pushes and pops will be valid and leave the
  * array in a valid state.
+ *
+ * The array also tracks whether the consumer may be sleeping, so the producer
+ * only needs to wake it up (e.g. by writing to an eventfd) after the first of
+ * a run of pushes, instead of after each of them:
+ *
+ *   producer:  push; if (ring_array_wakeup(arr)) { signal the consumer }
+ *   consumer:  do { pop until empty } while (!ring_array_sleep(arr));
+ *              wait for the signal
  */
 
 #pragma once
@@ -43,6 +51,7 @@ struct ring_array {
     uint32_t    cap;               /* total capacity */
     uint32_t    rpos;              /* read offset */
     uint32_t    wpos;              /* write offset */
+    uint32_t    sleeping;          /* consumer may be waiting for a wakeup */
     union {
         size_t  pad;               /* using a size_t member to force alignment at
                                       native word boundary */
@@ -57,6 +66,13 @@ struct ring_array {
 /* push an element into the array */
 rstatus_i ring_array_push(const void *elem, struct ring_array *arr);
 
+/* push up to n elements stored one after another, returns # pushed */
+uint32_t ring_array_push_batch(const void *elem, uint32_t n,
+        struct ring_array *arr);
+
+/* after pushing, returns true if the consumer has to be woken up */
+bool ring_array_wakeup(struct ring_array *arr);
+
 /* check if array is full */
 bool ring_array_full(const struct ring_array *arr);
 
@@ -68,6 +84,14 @@ bool ring_array_full(const struct ring_array *arr);
 /* pop an element from the array */
 rstatus_i ring_array_pop(void *elem, struct ring_array *arr);
 
+/* pop up to n elements into a buffer of n elements, returns # popped */
+uint32_t ring_array_pop_batch(void *elem, uint32_t n, struct ring_array *arr);
+
+/* before waiting for a wakeup, returns false if the array is not empty
+ * anymore, in which case the consumer should pop before trying again
+ */
+bool ring_array_sleep(struct ring_array *arr);
+
 /* check if array is empty */
 bool ring_array_empty(const struct ring_array *arr);
 
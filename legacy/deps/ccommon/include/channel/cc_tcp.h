@@ -40,11 +40,15 @@ extern "C" {
 
 #define TCP_BACKLOG  128
 #define TCP_POOLSIZE 0 /* unlimited */
+#define TCP_FASTOPEN_QLEN 0 /* disabled */
+#define TCP_DEFER_SEC     0 /* disabled */
 
-/*          name            type                default         description */
-#define TCP_OPTION(ACTION)                                                                \
-    ACTION( tcp_backlog,    OPTION_TYPE_UINT,   TCP_BACKLOG,    "tcp conn backlog limit" )\
-    ACTION( tcp_poolsize,   OPTION_TYPE_UINT,   TCP_POOLSIZE,   "tcp conn pool size"     )
+/*          name                type                default             description */
+#define TCP_OPTION(ACTION)                                                                          \
+    ACTION( tcp_backlog,        OPTION_TYPE_UINT,   TCP_BACKLOG,        "tcp conn backlog limit"   )\
+    ACTION( tcp_poolsize,       OPTION_TYPE_UINT,   TCP_POOLSIZE,       "tcp conn pool size"       )\
+    ACTION( tcp_fastopen,       OPTION_TYPE_UINT,   TCP_FASTOPEN_QLEN,  "tcp fast open queue len"  )\
+    ACTION( tcp_defer_accept,   OPTION_TYPE_UINT,   TCP_DEFER_SEC,      "sec to defer accept"      )
 
 typedef struct {
     TCP_OPTION(OPTION_DECLARE)
@@ -62,6 +66,7 @@ typedef struct {
     ACTION( tcp_conn_active,    METRIC_GAUGE,   "# tcp conn being borrowed"    )\
     ACTION( tcp_accept,         METRIC_COUNTER, "# tcp connection accepts"     )\
     ACTION( tcp_accept_ex,      METRIC_COUNTER, "# tcp accept exceptions"      )\
+    ACTION( tcp_accept_ns,      METRIC_COUNTER, "# ns spent in tcp accepts"    )\
     ACTION( tcp_reject,         METRIC_COUNTER, "# tcp connection rejects"     )\
     ACTION( tcp_reject_ex,      METRIC_COUNTER, "# tcp reject exceptions"      )\
     ACTION( tcp_connect,        METRIC_COUNTER, "# tcp connects made"          )\
@@ -121,6 +126,7 @@ static inline ch_id_i tcp_write_id(struct tcp_conn *c)
 /* basic channel maintenance */
 bool tcp_connect(struct addrinfo *ai, struct tcp_conn *c);  /* channel_open_fn, client */
 bool tcp_listen(struct addrinfo *ai, struct tcp_conn *c);   /* channel_open_fn, server */
+bool tcp_listen_reuseport(struct addrinfo *ai, struct tcp_conn *c); /* channel_open_fn, with SO_REUSEPORT */
 void tcp_close(struct tcp_conn *c);                         /* channel_perm_fn */
 ssize_t tcp_recv(struct tcp_conn *c, void *buf, size_t nbyte); /* channel_recv_fn */
 ssize_t tcp_send(struct tcp_conn *c, void *buf, size_t nbyte); /* channel_send_fn */
@@ -135,6 +141,11 @@ void tcp_reject_all(struct tcp_conn *sc);                   /* channel_reject_fn
 int tcp_set_blocking(int sd);
 int tcp_set_nonblocking(int sd);
 int tcp_set_reuseaddr(int sd);
+int tcp_set_reuseport(int sd);
+int tcp_set_incoming_cpu(int sd, int cpu);
+int tcp_set_busy_poll(int sd, int usec);
+int tcp_set_fastopen(int sd, int qlen);
+int tcp_set_defer_accept(int sd, int sec);
 int tcp_set_tcpnodelay(int sd);
 int tcp_set_keepalive(int sd);
 int tcp_set_linger(int sd, int timeout);
@@ -78,6 +78,8 @@ typedef struct {
     SOCKIO_METRIC(METRIC_DECLARE)
 } sockio_metrics_st;
 
+struct timeout_event;
+
 struct buf_sock {
     /* these fields are useful for resource managmenet */
     STAILQ_ENTRY(buf_sock)  next;
@@ -87,6 +89,8 @@ struct buf_sock {
     uint64_t                flag;   /* generic flag field to be used by app */
     void                    *data;  /* generic data field to be used by app */
     channel_handler_st       *hdl;   /* use can specify per-channel action */
+    struct timeout_event    *tev;   /* timeout of the channel, set by app */
+    int64_t                 active; /* when the channel was last active */
 
     struct tcp_conn         *ch;
     struct buf              *rbuf;
@@ -45,6 +45,7 @@ extern "C" {
     ACTION( timing_wheel_remove,    METRIC_COUNTER, "# tevent removal"             )\
     ACTION( timing_wheel_event,     METRIC_GAUGE,   "# tevents in timing wheels"   )\
     ACTION( timing_wheel_process,   METRIC_COUNTER, "# tevents processed"          )\
+    ACTION( timing_wheel_cascade,   METRIC_COUNTER, "# tevents moved down a level" )\
     ACTION( timing_wheel_tick,      METRIC_COUNTER, "# ticks processed"            )\
     ACTION( timing_wheel_exec,      METRIC_COUNTER, "# timing wheel executions "   )
 
@@ -100,24 +101,36 @@ typedef void (*timeout_cb_fn)(void *); /* timeout callback */
  */
 struct timeout_event;
 
+/**
+ * A timing wheel can have more than one level, each of cap slots, to cover
+ * timeouts much longer than cap ticks: a slot of level 0 is one tick, and a
+ * slot of level l spans all of level l - 1, i.e. cap^l ticks, so nlevel levels
+ * cover cap^nlevel ticks. When level l - 1 wraps around, the events in the
+ * next slot of level l are moved (cascaded) down to where they are due, so an
+ * event is moved at most nlevel - 1 times over its lifetime, while insertion
+ * and removal remain O(1).
+ */
 struct timing_wheel {
     /* basic properties of the timing wheel */
     struct timeout      tick;       /* tick interval */
-    size_t              cap;        /* capacity as # ticks in the time wheel */
+    size_t              cap;        /* capacity as # ticks in each level */
+    size_t              nlevel;     /* # levels */
     size_t              max_ntick;  /* max # ticks to cover in one execution */
     /* the following is used internally */
     uint64_t            tick_ns;    /* tick in nanoseconds */
+    uint64_t            span;       /* # ticks covered by all levels */
     /* state of the wheel */
     bool                active;     /* is the wheel supposed to be turning? */
     struct timeout      due;        /* next trigger time */
-    size_t              curr;       /* index of current tick */
+    size_t              curr;       /* index of current tick in level 0 */
     uint64_t            nevent;     /* # of timeout_event objects in wheel */
 
     struct tevent_tqh   *table;     /* an array of header each points to a list
-                                     * of timeouts expiring in the same tick.
-                                     * table should contain exactly cap entries,
+                                     * of timeouts expiring in the same slot.
+                                     * table should contain exactly
+                                     * cap * nlevel entries, level by level,
                                      * each corresponding to a TALQ for the
-                                     * corresponding tick
+                                     * corresponding slot
                                      */
     /* some metrics of the most important aspects */
     uint64_t            nprocess;   /* total # timeout events processed */
@@ -125,7 +138,10 @@ struct timing_wheel {
     uint64_t            ntick;      /* total # ticks processed */
 };
 
+/* a timing wheel of a single level, covering cap ticks */
 struct timing_wheel *timing_wheel_create(struct timeout *tick, size_t cap, size_t ntick);
+/* a hierarchical timing wheel covering cap^nlevel ticks, see above */
+struct timing_wheel *timing_wheel_create_level(struct timeout *tick, size_t cap, size_t nlevel, size_t ntick);
 void timing_wheel_destroy(struct timing_wheel **tw);
 
 struct timeout_event * timing_wheel_insert(struct timing_wheel *tw, struct timeout *delay, bool recur, timeout_cb_fn cb, void *arg);
@@ -21,11 +21,14 @@
 #include <cc_mm.h>
 #include <cc_pool.h>
 
+#include <pthread.h>
+
 
 #define BUF_MODULE_NAME "ccommon::buffer:buf"
 
 FREEPOOL(buf_pool, bufq, buf);
 static struct buf_pool bufp;
+static pthread_mutex_t bufp_mtx = PTHREAD_MUTEX_INITIALIZER;
 
 static bool buf_init = false;
 static bool bufp_init = false;
@@ -85,7 +88,9 @@ buf_borrow(void)
 {
     struct buf *buf;
 
+    pthread_mutex_lock(&bufp_mtx);
     FREEPOOL_BORROW(buf, &bufp, next, buf_create);
+    pthread_mutex_unlock(&bufp_mtx);
 
     if (buf == NULL) {
         log_warn("borrow buf failed, OOM or over limit");
@@ -115,10 +120,26 @@ buf_return(struct buf **buf)
     ASSERT(STAILQ_NEXT(elm, next) == NULL);
     ASSERT(elm->wpos <= elm->end);
 
+    if (elm->chain != NULL) {
+        buf_chain_return(elm);
+    }
+
+    if (elm->release != NULL) { /* not pooled, see buf_chain_ref */
+        log_verb("release data %p referred to by buf %p", elm->ref, elm);
+        elm->release(elm->ref);
+        cc_free(elm);
+        *buf = NULL;
+        DECR(buf_metrics, buf_active);
+
+        return;
+    }
+
     log_verb("return buf %p", elm);
 
     elm->free = true;
+    pthread_mutex_lock(&bufp_mtx);
     FREEPOOL_RETURN(elm, &bufp, next);
+    pthread_mutex_unlock(&bufp_mtx);
 
     *buf = NULL;
     INCR(buf_metrics, buf_return);
@@ -138,6 +159,9 @@ buf_create(void)
     }
 
     buf->end = (char *)buf + buf_init_size;
+    buf->chain = NULL;
+    buf->release = NULL;
+    buf->ref = NULL;
     buf_reset(buf);
     INCR(buf_metrics, buf_create);
     INCR(buf_metrics, buf_curr);
@@ -148,6 +172,109 @@ buf_create(void)
     return buf;
 }
 
+struct buf *
+buf_chain_extend(struct buf *buf)
+{
+    struct buf *nbuf;
+
+    ASSERT(buf != NULL && buf->chain == NULL);
+
+    nbuf = buf_borrow();
+    if (nbuf == NULL) {
+        return NULL;
+    }
+
+    buf->chain = nbuf;
+    INCR(buf_metrics, buf_chain);
+
+    log_verb("chain buf %p after buf %p", nbuf, buf);
+
+    return nbuf;
+}
+
+struct buf *
+buf_chain_ref(struct buf *buf, char *data, uint32_t len,
+        buf_release_fn release, void *ref)
+{
+    struct buf *nbuf;
+
+    ASSERT(buf != NULL && buf->chain == NULL);
+    ASSERT(release != NULL);
+
+    /* only the header is needed, the data is read directly from storage */
+    nbuf = (struct buf *)cc_alloc(BUF_HDR_SIZE);
+    if (nbuf == NULL) {
+        log_info("buf ref creation failed due to OOM");
+        release(ref);
+
+        return NULL;
+    }
+
+    STAILQ_NEXT(nbuf, next) = NULL;
+    nbuf->chain = NULL;
+    nbuf->release = release;
+    nbuf->ref = ref;
+    nbuf->free = false;
+    nbuf->rpos = data;
+    nbuf->wpos = nbuf->end = data + len;
+
+    buf->chain = nbuf;
+    INCR(buf_metrics, buf_ref);
+    INCR(buf_metrics, buf_active);
+
+    log_verb("chain buf %p referring to %"PRIu32" bytes at %p after buf %p",
+            nbuf, len, data, buf);
+
+    return nbuf;
+}
+
+rstatus_i
+buf_chain_unref(struct buf *buf)
+{
+    struct buf *prev = buf, *elm, *nbuf;
+
+    for (elm = buf->chain; elm != NULL; elm = prev->chain) {
+        if (elm->release == NULL) {
+            prev = elm;
+            continue;
+        }
+
+        /* copy what is left after the buf before, then into new ones */
+        while (buf_rsize(elm) > 0) {
+            elm->rpos += buf_write(prev, elm->rpos, buf_rsize(elm));
+            if (buf_rsize(elm) > 0) {
+                nbuf = buf_borrow();
+                if (nbuf == NULL) {
+                    return CC_ENOMEM;
+                }
+                nbuf->chain = elm;
+                prev->chain = nbuf;
+                prev = nbuf;
+            }
+        }
+
+        prev->chain = elm->chain;
+        elm->chain = NULL;
+        buf_return(&elm);
+        INCR(buf_metrics, buf_unref);
+    }
+
+    return CC_OK;
+}
+
+void
+buf_chain_return(struct buf *buf)
+{
+    struct buf *elm, *nelm;
+
+    for (elm = buf->chain; elm != NULL; elm = nelm) {
+        nelm = elm->chain;
+        elm->chain = NULL;
+        buf_return(&elm);
+    }
+    buf->chain = NULL;
+}
+
 void
 buf_destroy(struct buf **buf)
 {
@@ -157,6 +284,12 @@ buf_destroy(struct buf **buf)
         return;
     }
 
+    if ((*buf)->chain != NULL) {
+        buf_chain_return(*buf);
+    }
+
+    ASSERT((*buf)->release == NULL);
+
     cap = buf_size(*buf);
     log_verb("destroy buf %p size %"PRIu32, *buf, cap);
 
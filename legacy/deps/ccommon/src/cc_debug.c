@@ -20,6 +20,7 @@
 #include <cc_log.h>
 #include <cc_mm.h>
 #include <cc_print.h>
+#include <cc_rbuf.h>
 
 #include <ctype.h>
 #include <errno.h>
@@ -36,6 +37,8 @@
 #define BACKTRACE_DEPTH 64
 #define DEBUG_MODULE_NAME "ccommon::debug"
 
+#define LOCAL_MAX_NBUF 64   /* max # threads with a buf of their own */
+
 
 struct debug_logger default_logger;
 struct debug_logger *dlog = &default_logger;
@@ -51,7 +54,18 @@ static char * level_str[] = {
     "VVERB"
 };
 
-static char tname_buf[16];
+/* the bufs of the threads, when debug_log_local is set. a thread joins once
+ * per setup, which is told apart by its generation */
+static struct rbuf *local_bufs[LOCAL_MAX_NBUF];
+static uint32_t local_nbuf = 0;
+static uint32_t local_cap = 0;
+static uint32_t local_gen = 0;
+static pthread_mutex_t local_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread struct rbuf *local_buf = NULL;
+static __thread uint32_t local_joined = 0;
+
+static __thread char tname_buf[16];
 
 static inline char *
 _thread_name(void)
@@ -119,9 +133,64 @@ _logrotate(int signo)
     log_reopen(dlog->logger, NULL);
 }
 
+/* the calling thread creates its buf, which is left NULL if it can't be */
+static void
+_local_join(void)
+{
+    struct rbuf *buf = NULL;
+
+    pthread_mutex_lock(&local_mtx);
+    local_joined = local_gen;
+    if (local_nbuf < LOCAL_MAX_NBUF) {
+        buf = rbuf_create(local_cap);
+        if (buf != NULL) {
+            __atomic_store_n(&local_bufs[local_nbuf], buf, __ATOMIC_RELEASE);
+            __atomic_store_n(&local_nbuf, local_nbuf + 1, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&local_mtx);
+
+    if (buf == NULL) {
+        log_stderr("debug log of thread %s is dropped, cannot create its buf",
+                _thread_name());
+    }
+    local_buf = buf;
+}
+
+static void
+_local_destroy(void)
+{
+    uint32_t i;
+
+    pthread_mutex_lock(&local_mtx);
+    for (i = 0; i < local_nbuf; i++) {
+        log_flush_buf(dlog->logger, local_bufs[i]);
+        rbuf_destroy(&local_bufs[i]);
+    }
+    local_nbuf = 0;
+    local_cap = 0;
+    local_gen++;
+    pthread_mutex_unlock(&local_mtx);
+}
+
+static inline void
+_log_write(struct debug_logger *dl, char *buf, uint32_t len)
+{
+    if (dl == dlog && local_cap > 0) {
+        if (local_joined != local_gen) {
+            _local_join();
+        }
+        log_write_buf(dl->logger, local_buf, buf, len);
+    } else {
+        log_write(dl->logger, buf, len);
+    }
+}
+
 void
 debug_log_flush(void *arg)
 {
+    uint32_t i, n;
+
     /*
      * arg is unused but necessary for debug_log_flush to be used in conjunction
      * with cc_timer and cc_wheel facilities, since to be inserted into a timing
@@ -129,6 +198,12 @@ debug_log_flush(void *arg)
      */
     (void)arg;
     log_flush(dlog->logger);
+
+    n = __atomic_load_n(&local_nbuf, __ATOMIC_ACQUIRE);
+    for (i = 0; i < n; i++) {
+        log_flush_buf(dlog->logger,
+                __atomic_load_n(&local_bufs[i], __ATOMIC_ACQUIRE));
+    }
 }
 
 rstatus_i
@@ -136,6 +211,7 @@ debug_setup(debug_options_st *options)
 {
     size_t log_nbuf = DEBUG_LOG_NBUF;
     char *filename = DEBUG_LOG_FILE;
+    bool local = DEBUG_LOG_LOCAL;
 
     /* since logs are not setup yet, we have to log to stderr */
     log_stderr("Set up the %s module", DEBUG_MODULE_NAME);
@@ -143,6 +219,7 @@ debug_setup(debug_options_st *options)
     if (debug_init) {
         log_stderr("%s has already been setup, overwrite", DEBUG_MODULE_NAME);
         if (dlog->logger != NULL) {
+            _local_destroy();
             log_destroy(&dlog->logger);
         }
     }
@@ -152,9 +229,16 @@ debug_setup(debug_options_st *options)
         filename = option_str(&options->debug_log_file);
         log_nbuf = option_uint(&options->debug_log_nbuf);
         dlog->level = option_uint(&options->debug_log_level);
+        local = option_bool(&options->debug_log_local);
     }
 
-    dlog->logger = log_create(filename, log_nbuf);
+    if (local && log_nbuf == 0) {
+        log_stderr("debug_log_local needs a debug_log_nbuf, ignored");
+        local = false;
+    }
+
+    /* with a buf for each thread the logger needs none of its own */
+    dlog->logger = log_create(filename, local ? 0 : log_nbuf);
     if (dlog->logger == NULL) {
         log_stderr("Could not create logger");
         goto error;
@@ -171,6 +255,11 @@ debug_setup(debug_options_st *options)
         goto error;
     }
 
+    pthread_mutex_lock(&local_mtx);
+    local_cap = local ? log_nbuf : 0;
+    local_gen++;
+    pthread_mutex_unlock(&local_mtx);
+
     debug_init = true;
     return CC_OK;
 
@@ -189,6 +278,7 @@ debug_teardown(void)
     }
 
     if (dlog->logger != NULL) {
+        _local_destroy();
         log_destroy(&dlog->logger);
     }
 
@@ -199,9 +289,9 @@ void
 _log(struct debug_logger *dl, const char *file, int line, int level, const char *fmt, ...)
 {
     int len, size, errno_save;
-    char buf[LOG_MAX_LEN], *timestr;
+    char buf[LOG_MAX_LEN], timestr[32];
     va_list args;
-    struct tm *local;
+    struct tm local;
     time_t t;
 
     if (dl == NULL || dl->logger == NULL || dl->level < level) {
@@ -212,9 +302,10 @@ _log(struct debug_logger *dl, const char *file, int line, int level, const char
     len = 0;            /* length of output buffer */
     size = LOG_MAX_LEN; /* size of output buffer */
 
+    /* the reentrant versions, as threads log concurrently */
     t = time(NULL);
-    local = localtime(&t);
-    timestr = asctime(local);
+    localtime_r(&t, &local);
+    asctime_r(&local, timestr);
 
     len += cc_scnprintf(buf + len, size - len, "[%.*s][%s][%s] %s:%d ",
             strlen(timestr) - 1, timestr, _thread_name(), level_str[level], file, line);
@@ -225,7 +316,7 @@ _log(struct debug_logger *dl, const char *file, int line, int level, const char
 
     buf[len++] = '\n';
 
-    log_write(dl->logger, buf, len);
+    _log_write(dl, buf, len);
 
     errno = errno_save;
 }
@@ -285,7 +376,7 @@ _log_hexdump(struct debug_logger *dl, int level, char *data, int datalen)
         off += 16;
     }
 
-    log_write(dl->logger, buf, len);
+    _log_write(dl, buf, len);
 
     errno = errno_save;
 }
@@ -193,19 +193,27 @@ log_reopen(struct logger *logger, char *target)
     return CC_OK;
 }
 
+bool
+log_write_buf(struct logger *logger, struct rbuf *buf, char *msg, uint32_t len)
+{
+    if (buf == NULL || rbuf_wcap(buf) < len) {
+        INCR(log_metrics, log_skip);
+        INCR_N(log_metrics, log_skip_byte, len);
+        return false;
+    }
+
+    rbuf_write(buf, msg, len);
+    INCR(log_metrics, log_write);
+    INCR_N(log_metrics, log_write_byte, len);
+
+    return true;
+}
+
 bool
 log_write(struct logger *logger, char *buf, uint32_t len)
 {
     if (logger->buf != NULL) {
-        if (rbuf_wcap(logger->buf) >= len) {
-            rbuf_write(logger->buf, buf, len);
-            INCR(log_metrics, log_write);
-            INCR_N(log_metrics, log_write_byte, len);
-        } else {
-            INCR(log_metrics, log_skip);
-            INCR_N(log_metrics, log_skip_byte, len);
-            return false;
-        }
+        return log_write_buf(logger, logger->buf, buf, len);
     } else {
         if (logger->fd < 0) {
             INCR(log_metrics, log_write_ex);
@@ -308,11 +316,17 @@ _rbuf_flush(struct rbuf *buf, int fd)
 
 size_t
 log_flush(struct logger *logger)
+{
+    return log_flush_buf(logger, logger->buf);
+}
+
+size_t
+log_flush_buf(struct logger *logger, struct rbuf *buf)
 {
     ssize_t n;
     size_t buf_len;
 
-    if (logger->buf == NULL) {
+    if (buf == NULL) {
         return 0;
     }
 
@@ -322,8 +336,8 @@ log_flush(struct logger *logger)
         return 0;
     }
 
-    buf_len = rbuf_rcap(logger->buf);
-    n = _rbuf_flush(logger->buf, logger->fd);
+    buf_len = rbuf_rcap(buf);
+    n = _rbuf_flush(buf, logger->fd);
 
     if (n < (ssize_t)buf_len) {
         INCR(log_metrics, log_flush_ex);
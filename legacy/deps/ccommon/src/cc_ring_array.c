@@ -20,6 +20,7 @@
 #include <cc_bstring.h>
 #include <cc_debug.h>
 #include <cc_mm.h>
+#include <cc_util.h>
 
 #include <stdbool.h>
 
@@ -68,6 +69,10 @@
  *           |             |
  *           wpos          rpos
  *
+ * The producer publishes the elements it pushed by storing wpos with release
+ * ordering, and the consumer frees up the slots it popped by storing rpos
+ * with release ordering, so elements are never read or overwritten before
+ * their copy is complete.
  */
 
 static inline uint32_t
@@ -94,11 +99,54 @@ ring_array_push(const void *elem, struct ring_array *arr)
 
     /* update wpos atomically */
     new_wpos = (arr->wpos + 1) % (arr->cap + 1);
-    __atomic_store_n(&(arr->wpos), new_wpos, __ATOMIC_RELAXED);
+    __atomic_store_n(&(arr->wpos), new_wpos, __ATOMIC_RELEASE);
 
     return CC_OK;
 }
 
+uint32_t
+ring_array_push_batch(const void *elem, uint32_t n, struct ring_array *arr)
+{
+    uint32_t rpos = __atomic_load_n(&(arr->rpos), __ATOMIC_ACQUIRE);
+    uint32_t wpos = arr->wpos;
+    uint32_t nslot = arr->cap + 1;
+    uint32_t i, len;
+
+    n = MIN(n, arr->cap - ring_array_nelem(rpos, wpos, arr->cap));
+
+    /* copy in at most two runs, up to the end of data and from its start */
+    for (i = 0; i < n; i += len) {
+        len = MIN(n - i, nslot - wpos);
+        cc_memcpy(arr->data + arr->elem_size * wpos,
+                (const uint8_t *)elem + arr->elem_size * i,
+                arr->elem_size * len);
+        wpos = (wpos + len) % nslot;
+    }
+
+    if (n > 0) {
+        __atomic_store_n(&(arr->wpos), wpos, __ATOMIC_RELEASE);
+    }
+
+    return n;
+}
+
+bool
+ring_array_wakeup(struct ring_array *arr)
+{
+    /*
+     * The consumer flags itself sleeping before checking for elements one last
+     * time, and we check the flag only after pushing, so either it sees what
+     * we pushed, or we see it may be sleeping. Both sides need sequentially
+     * consistent ordering for this to hold.
+     */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&(arr->sleeping), __ATOMIC_RELAXED)) {
+        return false;
+    }
+
+    return __atomic_exchange_n(&(arr->sleeping), 0, __ATOMIC_ACQ_REL) != 0;
+}
+
 bool
 ring_array_full(const struct ring_array *arr)
 {
@@ -108,7 +156,7 @@ ring_array_full(const struct ring_array *arr)
      * only pops and does not push; in other words, only one thread updates
      * either rpos or wpos.
      */
-    uint32_t rpos = __atomic_load_n(&(arr->rpos), __ATOMIC_RELAXED);
+    uint32_t rpos = __atomic_load_n(&(arr->rpos), __ATOMIC_ACQUIRE);
     return ring_array_nelem(rpos, arr->wpos, arr->cap) == arr->cap;
 }
 
@@ -128,19 +176,60 @@ ring_array_pop(void *elem, struct ring_array *arr)
 
     /* update rpos atomically */
     new_rpos = (arr->rpos + 1) % (arr->cap + 1);
-    __atomic_store_n(&(arr->rpos), new_rpos, __ATOMIC_RELAXED);
+    __atomic_store_n(&(arr->rpos), new_rpos, __ATOMIC_RELEASE);
 
     return CC_OK;
 }
 
+uint32_t
+ring_array_pop_batch(void *elem, uint32_t n, struct ring_array *arr)
+{
+    uint32_t wpos = __atomic_load_n(&(arr->wpos), __ATOMIC_ACQUIRE);
+    uint32_t rpos = arr->rpos;
+    uint32_t nslot = arr->cap + 1;
+    uint32_t i, len;
+
+    n = MIN(n, ring_array_nelem(rpos, wpos, arr->cap));
+
+    /* copy out in at most two runs, up to the end of data and from its start */
+    for (i = 0; i < n; i += len) {
+        len = MIN(n - i, nslot - rpos);
+        cc_memcpy((uint8_t *)elem + arr->elem_size * i,
+                arr->data + arr->elem_size * rpos, arr->elem_size * len);
+        rpos = (rpos + len) % nslot;
+    }
+
+    if (n > 0) {
+        __atomic_store_n(&(arr->rpos), rpos, __ATOMIC_RELEASE);
+    }
+
+    return n;
+}
+
 bool
 ring_array_empty(const struct ring_array *arr)
 {
     /* take snapshot of wpos, since another thread might be pushing */
-    uint32_t wpos = __atomic_load_n(&(arr->wpos), __ATOMIC_RELAXED);
+    uint32_t wpos = __atomic_load_n(&(arr->wpos), __ATOMIC_ACQUIRE);
     return ring_array_nelem(arr->rpos, wpos, arr->cap) == 0;
 }
 
+bool
+ring_array_sleep(struct ring_array *arr)
+{
+    /* see ring_array_wakeup on the ordering */
+    __atomic_store_n(&(arr->sleeping), 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (ring_array_empty(arr)) {
+        return true;
+    }
+
+    /* elements were pushed meanwhile, and may not come with a wakeup */
+    __atomic_store_n(&(arr->sleeping), 0, __ATOMIC_RELAXED);
+
+    return false;
+}
+
 void
 ring_array_flush(struct ring_array *arr)
 {
@@ -166,6 +255,7 @@ ring_array_create(size_t elem_size, uint32_t cap)
     arr->elem_size = elem_size;
     arr->cap = cap;
     arr->rpos = arr->wpos = 0;
+    arr->sleeping = 1; /* until the consumer first pops */
     return arr;
 }
 
@@ -23,6 +23,7 @@
 #include <cc_pool.h>
 #include <cc_util.h>
 #include <cc_event.h>
+#include <time/cc_timer.h>
 
 #include <errno.h>
 #include <fcntl.h>
@@ -43,6 +44,8 @@ static bool tcp_init = false;
 static bool cp_init = false;
 static tcp_metrics_st *tcp_metrics = NULL;
 static int max_backlog = TCP_BACKLOG;
+static int fastopen_qlen = TCP_FASTOPEN_QLEN;
+static int defer_sec = TCP_DEFER_SEC;
 
 void
 tcp_conn_reset(struct tcp_conn *c)
@@ -244,8 +247,8 @@ error:
     return false;
 }
 
-bool
-tcp_listen(struct addrinfo *ai, struct tcp_conn *c)
+static bool
+_tcp_listen(struct addrinfo *ai, struct tcp_conn *c, bool reuseport)
 {
     int ret;
     int sd;
@@ -264,12 +267,39 @@ tcp_listen(struct addrinfo *ai, struct tcp_conn *c)
         goto error;
     }
 
+    if (reuseport) {
+        ret = tcp_set_reuseport(sd);
+        if (ret < 0) {
+            log_error("reuse port of sd %d failed: %s", sd, strerror(errno));
+            goto error;
+        }
+    }
+
     ret = bind(sd, ai->ai_addr, ai->ai_addrlen);
     if (ret < 0) {
         log_error("bind on sd %d failed: %s", sd, strerror(errno));
         goto error;
     }
 
+    /* both options only save work on connection setup, so the listener is
+     * still usable without them
+     */
+    if (fastopen_qlen > 0) {
+        ret = tcp_set_fastopen(sd, fastopen_qlen);
+        if (ret < 0) {
+            log_warn("set tcp fast open on sd %d failed, ignored: %s", sd,
+                     strerror(errno));
+        }
+    }
+
+    if (defer_sec > 0) {
+        ret = tcp_set_defer_accept(sd, defer_sec);
+        if (ret < 0) {
+            log_warn("set tcp defer accept on sd %d failed, ignored: %s", sd,
+                     strerror(errno));
+        }
+    }
+
     ret = listen(sd, max_backlog);
     if (ret < 0) {
         log_error("listen on sd %d failed: %s", sd, strerror(errno));
@@ -302,6 +332,18 @@ error:
     return false;
 }
 
+bool
+tcp_listen(struct addrinfo *ai, struct tcp_conn *c)
+{
+    return _tcp_listen(ai, c, false);
+}
+
+bool
+tcp_listen_reuseport(struct addrinfo *ai, struct tcp_conn *c)
+{
+    return _tcp_listen(ai, c, true);
+}
+
 void
 tcp_close(struct tcp_conn *c)
 {
@@ -390,12 +432,16 @@ tcp_accept(struct tcp_conn *sc, struct tcp_conn *c)
 {
     int ret;
     int sd;
+    struct duration d;
 
+    duration_start(&d);
     sd = _tcp_accept(sc);
-    INCR(tcp_metrics, tcp_accept);
     if (sd < 0) {
         return false;
     }
+    duration_stop(&d);
+    INCR(tcp_metrics, tcp_accept);
+    INCR_N(tcp_metrics, tcp_accept_ns, (uint64_t)duration_ns(&d));
 
     c->sd = sd;
     c->level = CHANNEL_BASE;
@@ -518,6 +564,89 @@ tcp_set_reuseaddr(int sd)
     return setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, &reuse, len);
 }
 
+/*
+ * Allow other sockets to bind to the same address and port, so each of a few
+ * threads can listen and accept on a socket of its own, while the kernel
+ * spreads the incoming connections across the sockets.
+ */
+int
+tcp_set_reuseport(int sd)
+{
+#ifdef SO_REUSEPORT
+    int reuse;
+    socklen_t len;
+
+    reuse = 1;
+    len = sizeof(reuse);
+
+    return setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, &reuse, len);
+#else
+    errno = ENOPROTOOPT;
+    return -1;
+#endif
+}
+
+/*
+ * Prefer this socket, among the listening sockets sharing a port, for
+ * connections whose packets are received on the cpu.
+ */
+int
+tcp_set_incoming_cpu(int sd, int cpu)
+{
+#ifdef SO_INCOMING_CPU
+    return setsockopt(sd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu));
+#else
+    errno = ENOPROTOOPT;
+    return -1;
+#endif
+}
+
+/*
+ * Busy poll the device queue for up to usec when receiving on the socket
+ * would block; raising it beyond net.core.busy_read needs CAP_NET_ADMIN.
+ */
+int
+tcp_set_busy_poll(int sd, int usec)
+{
+#ifdef SO_BUSY_POLL
+    return setsockopt(sd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec));
+#else
+    errno = ENOPROTOOPT;
+    return -1;
+#endif
+}
+
+/*
+ * Let clients which connected before send data along with the SYN, with up to
+ * qlen such connections pending; takes effect if net.ipv4.tcp_fastopen allows
+ * it for servers.
+ */
+int
+tcp_set_fastopen(int sd, int qlen)
+{
+#ifdef TCP_FASTOPEN
+    return setsockopt(sd, IPPROTO_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen));
+#else
+    errno = ENOPROTOOPT;
+    return -1;
+#endif
+}
+
+/*
+ * Only wake the listener for a connection once its first data arrives, or
+ * after about sec seconds, so that accepted connections have a request ready.
+ */
+int
+tcp_set_defer_accept(int sd, int sec)
+{
+#ifdef TCP_DEFER_ACCEPT
+    return setsockopt(sd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &sec, sizeof(sec));
+#else
+    errno = ENOPROTOOPT;
+    return -1;
+#endif
+}
+
 /*
  * Disable Nagle algorithm on TCP socket.
  *
@@ -911,6 +1040,8 @@ tcp_setup(tcp_options_st *options, tcp_metrics_st *metrics)
     if (options != NULL) {
         max_backlog = option_uint(&options->tcp_backlog);
         max = option_uint(&options->tcp_poolsize);
+        fastopen_qlen = option_uint(&options->tcp_fastopen);
+        defer_sec = option_uint(&options->tcp_defer_accept);
     }
     tcp_conn_pool_create(max);
 
@@ -27,6 +27,7 @@
 #include <string.h>
 #include <sys/epoll.h>
 #include <sys/errno.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
 #include "cc_shared.h"
@@ -39,6 +40,26 @@
 # define EPOLLRDHUP 0x2000
 #endif
 
+#ifndef EPOLLEXCLUSIVE
+# define EPOLLEXCLUSIVE (1u << 28)
+#endif
+
+/*
+ * busy poll parameters of an epoll instance are available since Linux 6.9,
+ * which is again later than what most glibc versions know about
+ */
+#ifndef EPIOCSPARAMS
+struct epoll_params {
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t  prefer_busy_poll;
+    uint8_t  __pad;
+};
+# define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+
+#define BUSY_POLL_BUDGET 8 /* packets per poll, larger needs CAP_NET_ADMIN */
+
 struct event_base {
     int                ep;      /* epoll descriptor */
 
@@ -191,6 +212,74 @@ event_del(struct event_base *evb, int fd)
     return status;
 }
 
+int
+event_add_edge(struct event_base *evb, int fd, void *data)
+{
+    int status;
+
+    ASSERT(evb != NULL && evb->ep > 0);
+    ASSERT(fd >= 0);
+
+    status = _event_update(evb, fd, EPOLL_CTL_ADD,
+            EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, data);
+    if (status < 0 && errno != EEXIST) {
+        log_error("ctl (add edge) w/ epoll fd %d on fd %d failed: %s", evb->ep,
+                fd, strerror(errno));
+    }
+
+    INCR(event_metrics, event_read);
+    INCR(event_metrics, event_write);
+    log_verb("add edge-triggered event to epoll fd %d on fd %d", evb->ep, fd);
+
+    return status;
+}
+
+int
+event_add_exclusive(struct event_base *evb, int fd, void *data)
+{
+    int status;
+
+    ASSERT(evb != NULL && evb->ep > 0);
+    ASSERT(fd >= 0);
+
+    /* EPOLLEXCLUSIVE cannot be modified later, so there is no EEXIST case */
+    status = _event_update(evb, fd, EPOLL_CTL_ADD, EPOLLIN | EPOLLEXCLUSIVE,
+            data);
+    if (status < 0) {
+        log_error("ctl (add exclusive) w/ epoll fd %d on fd %d failed: %s",
+                evb->ep, fd, strerror(errno));
+    }
+
+    INCR(event_metrics, event_read);
+    log_verb("add exclusive read event to epoll fd %d on fd %d", evb->ep, fd);
+
+    return status;
+}
+
+int
+event_busy_poll(struct event_base *evb, uint32_t usec)
+{
+    int status;
+    struct epoll_params params;
+
+    ASSERT(evb != NULL && evb->ep > 0);
+
+    memset(&params, 0, sizeof(params));
+    params.busy_poll_usecs = usec;
+    params.busy_poll_budget = usec > 0 ? BUSY_POLL_BUDGET : 0;
+    params.prefer_busy_poll = usec > 0;
+
+    status = ioctl(evb->ep, EPIOCSPARAMS, &params);
+    if (status < 0) {
+        log_warn("set busy poll %"PRIu32" usec on epoll fd %d failed: %s",
+                usec, evb->ep, strerror(errno));
+        return status;
+    }
+
+    log_info("busy poll %"PRIu32" usec on epoll fd %d", usec, evb->ep);
+
+    return status;
+}
 
 /*
  * create a timed event with event base function and timeout (in millisecond)
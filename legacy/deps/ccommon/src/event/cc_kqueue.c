@@ -180,6 +180,38 @@ event_del(struct event_base *evb, int fd)
     return 0;
 }
 
+/* EV_CLEAR resets the state of the filter once the event is returned */
+int
+event_add_edge(struct event_base *evb, int fd, void *data)
+{
+    _event_update(evb, fd, EVFILT_READ, EV_ADD | EV_CLEAR, data);
+    _event_update(evb, fd, EVFILT_WRITE, EV_ADD | EV_CLEAR, data);
+    INCR(event_metrics, event_read);
+    INCR(event_metrics, event_write);
+
+    log_verb("adding edge-triggered event to fd %d", fd);
+
+    return 0;
+}
+
+/* kqueue has no way to wake up only one of the waiters */
+int
+event_add_exclusive(struct event_base *evb, int fd, void *data)
+{
+    return event_add_read(evb, fd, data);
+}
+
+int
+event_busy_poll(struct event_base *evb, uint32_t usec)
+{
+    if (usec > 0) {
+        log_warn("busy poll is not supported by kqueue, ignored");
+        return -1;
+    }
+
+    return 0;
+}
+
 int
 event_wait(struct event_base *evb, int timeout)
 {
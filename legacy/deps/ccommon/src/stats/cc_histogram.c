@@ -113,8 +113,38 @@ histo_u32_record(struct histo_u32 *h, uint64_t value, uint32_t count)
     }
 
     offset = _bucket_offset(value, h->m, h->r, h->G);
-    *(h->buckets + offset) += count;
-    h->nrecord += count;
+    __atomic_store_n(h->buckets + offset, __atomic_load_n(h->buckets + offset,
+                __ATOMIC_RELAXED) + count, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->nrecord, __atomic_load_n(&h->nrecord,
+                __ATOMIC_RELAXED) + count, __ATOMIC_RELAXED);
+
+    return HISTO_OK;
+}
+
+histo_rstatus_e
+histo_u32_merge(struct histo_u32 *dst, const struct histo_u32 *src)
+{
+    ASSERT(dst != NULL);
+    ASSERT(src != NULL);
+
+    uint64_t offset;
+
+    if (dst->m != src->m || dst->r != src->r || dst->n != src->n) {
+        log_error("Cannot merge histograms with different parameters");
+
+        return HISTO_EMISMATCH;
+    }
+
+    /* nrecord is summed from the buckets read, which src may have recorded
+     * into since its own nrecord was updated
+     */
+    for (offset = 0; offset < src->nbucket; ++offset) {
+        uint32_t count = __atomic_load_n(src->buckets + offset,
+                __ATOMIC_RELAXED);
+
+        dst->buckets[offset] += count;
+        dst->nrecord += count;
+    }
 
     return HISTO_OK;
 }
@@ -237,7 +267,7 @@ histo_u32_report_multi(struct percentile_profile *pp, const struct histo_u32 *h)
     pp->max = offset;
     for (;curr < h->nbucket; ++curr, ++bucket) {
         bool empty = (*bucket == 0);
-        pp->max = pp->max * empty + offset * !empty;
+        pp->max = pp->max * empty + curr * !empty;
     }
 
     return HISTO_OK;
@@ -17,8 +17,10 @@
 
 #include <cc_metric.h>
 
+#include <cc_bstring.h>
 #include <cc_debug.h>
 #include <cc_log.h>
+#include <cc_mm.h>
 #include <cc_print.h>
 
 #include <stdbool.h>
@@ -26,17 +28,36 @@
 #define VALUE_PRINT_LEN 30
 #define METRIC_DESCRIBE_FMT  "%-31s %-15s %s"
 
+#define SHARD_ALIGN 64 /* cache line size */
+
 char *metric_type_str[] = {"counter", "gauge", "floating point"};
 
-void
-metric_reset(struct metric sarr[], unsigned int n)
-{
-    unsigned int i;
+char *metric_shard_begin = NULL;
+char *metric_shard_end = NULL;
+__thread ptrdiff_t metric_shard_offset = 0;
 
-    if (sarr == NULL) {
-        return;
+static void *shard_mem = NULL; /* as allocated, shards are aligned within */
+static char *shards = NULL;
+static size_t shard_size = 0; /* rounded up to SHARD_ALIGN */
+static unsigned int nshard = 0;
+
+/* the offset of a sharded metric in the shards, or -1 if not sharded */
+static inline ptrdiff_t
+_shard_off(struct metric *m)
+{
+    if (nshard == 0 || (char *)m < metric_shard_begin ||
+            (char *)m >= metric_shard_end) {
+        return -1;
     }
 
+    return (char *)m - metric_shard_begin;
+}
+
+static void
+_metric_reset(struct metric sarr[], unsigned int n)
+{
+    unsigned int i;
+
     for (i = 0; i < n; i++) {
         switch (sarr[i].type) {
         case METRIC_COUNTER:
@@ -58,6 +79,117 @@ metric_reset(struct metric sarr[], unsigned int n)
     }
 }
 
+void
+metric_reset(struct metric sarr[], unsigned int n)
+{
+    ptrdiff_t off;
+    unsigned int i;
+
+    if (sarr == NULL) {
+        return;
+    }
+
+    /* metrics that are sharded have their shards reset too */
+    off = _shard_off(sarr);
+    for (i = 0; off >= 0 && i < nshard; i++) {
+        _metric_reset((struct metric *)(shards + i * shard_size + off), n);
+    }
+
+    _metric_reset(sarr, n);
+}
+
+rstatus_i
+metric_shard_setup(struct metric metrics[], unsigned int nmetric,
+        unsigned int n)
+{
+    size_t len = sizeof(struct metric) * nmetric;
+    unsigned int i;
+
+    ASSERT(shard_mem == NULL);
+
+    if (metrics == NULL || nmetric == 0 || n == 0) {
+        return CC_OK;
+    }
+
+    shard_size = (len + SHARD_ALIGN - 1) / SHARD_ALIGN * SHARD_ALIGN;
+    shard_mem = cc_alloc(shard_size * n + SHARD_ALIGN);
+    if (shard_mem == NULL) {
+        log_error("cannot allocate %u metric shards: OOM", n);
+        return CC_ENOMEM;
+    }
+    shards = (char *)(((uintptr_t)shard_mem + SHARD_ALIGN - 1) /
+            SHARD_ALIGN * SHARD_ALIGN);
+
+    /* each shard starts out a copy of the metrics, with zero values */
+    for (i = 0; i < n; i++) {
+        cc_memcpy(shards + i * shard_size, metrics, len);
+        _metric_reset((struct metric *)(shards + i * shard_size), nmetric);
+    }
+
+    metric_shard_begin = (char *)metrics;
+    metric_shard_end = (char *)metrics + len;
+    nshard = n;
+
+    log_info("%u shards set up for %u metrics", n, nmetric);
+
+    return CC_OK;
+}
+
+void
+metric_shard_teardown(void)
+{
+    metric_shard_begin = NULL;
+    metric_shard_end = NULL;
+    metric_shard_offset = 0;
+    nshard = 0;
+    shards = NULL;
+    shard_size = 0;
+    cc_free(shard_mem);
+}
+
+void
+metric_shard_thread(unsigned int idx)
+{
+    if (idx >= nshard) {
+        metric_shard_offset = 0;
+        return;
+    }
+
+    metric_shard_offset = shards + idx * shard_size - metric_shard_begin;
+}
+
+uint64_t
+metric_counter(struct metric *m)
+{
+    uint64_t val = __atomic_load_n(&m->counter, __ATOMIC_RELAXED);
+    ptrdiff_t off = _shard_off(m);
+    unsigned int i;
+
+    for (i = 0; off >= 0 && i < nshard; i++) {
+        struct metric *s = (struct metric *)(shards + i * shard_size + off);
+
+        val += __atomic_load_n(&s->counter, __ATOMIC_RELAXED);
+    }
+
+    return val;
+}
+
+int64_t
+metric_gauge(struct metric *m)
+{
+    int64_t val = __atomic_load_n(&m->gauge, __ATOMIC_RELAXED);
+    ptrdiff_t off = _shard_off(m);
+    unsigned int i;
+
+    for (i = 0; off >= 0 && i < nshard; i++) {
+        struct metric *s = (struct metric *)(shards + i * shard_size + off);
+
+        val += __atomic_load_n(&s->gauge, __ATOMIC_RELAXED);
+    }
+
+    return val;
+}
+
 size_t
 metric_print(char *buf, size_t nbuf, char *fmt, struct metric *m)
 {
@@ -74,13 +206,11 @@ metric_print(char *buf, size_t nbuf, char *fmt, struct metric *m)
          * and negatively impact readability, and since this function should not
          * be called often enough to make it absolutely performance critical.
          */
-        cc_scnprintf(val_buf, VALUE_PRINT_LEN, "%llu", __atomic_load_n(
-                    &m->counter, __ATOMIC_RELAXED));
+        cc_scnprintf(val_buf, VALUE_PRINT_LEN, "%llu", metric_counter(m));
         break;
 
     case METRIC_GAUGE:
-        cc_scnprintf(val_buf, VALUE_PRINT_LEN, "%lld", __atomic_load_n(
-                    &m->gauge, __ATOMIC_RELAXED));
+        cc_scnprintf(val_buf, VALUE_PRINT_LEN, "%lld", metric_gauge(m));
         break;
 
     case METRIC_FPN:
@@ -22,6 +22,7 @@
 #include <cc_debug.h>
 #include <cc_define.h>
 #include <cc_mm.h>
+#include <cc_array.h>
 #include <cc_pool.h>
 #include <cc_util.h>
 #include <channel/cc_tcp.h>
@@ -29,13 +30,11 @@
 #include <limits.h>
 #include <sys/uio.h>
 
-/*
 #if (IOV_MAX > 128)
 #define CC_IOV_MAX 128
 #else
 #define CC_IOV_MAX IOV_MAX
 #endif
-*/
 
 #define SOCKIO_MODULE_NAME "ccommon::sockio"
 
@@ -44,6 +43,9 @@ struct buf_sock_pool bsp;
 
 static bool sockio_init = false;
 static bool bsp_init = false;
+/* threads accepting on listeners of their own borrow concurrently, each from
+ * a cache of its own */
+static __thread struct buf_sock_pool_local bsl;
 static sockio_metrics_st *sockio_metrics = NULL;
 
 rstatus_i
@@ -93,6 +95,74 @@ buf_tcp_read(struct buf_sock *s)
     return status;
 }
 
+/*
+ * write a buffer and the buffers chained after it with a single writev
+ */
+static rstatus_i
+_buf_tcp_writev(struct buf_sock *s)
+{
+    struct tcp_conn *c = (struct tcp_conn *)s->ch;
+    struct iovec iov[CC_IOV_MAX];
+    struct array bufv = {sizeof(struct iovec), 0, 0, (uint8_t *)iov};
+    struct buf *buf, *nbuf;
+    rstatus_i status = CC_OK;
+    size_t cap = 0, len;
+    ssize_t n;
+
+    for (buf = s->wbuf; buf != NULL && bufv.nelem < CC_IOV_MAX;
+            buf = buf->chain) {
+        iov[bufv.nelem].iov_base = buf->rpos;
+        iov[bufv.nelem].iov_len = buf_rsize(buf);
+        cap += buf_rsize(buf);
+        bufv.nelem++;
+    }
+    bufv.nalloc = bufv.nelem;
+
+    if (cap == 0) {
+        log_verb("no data to send in buf chain at %p ", s->wbuf);
+
+        return CC_EEMPTY;
+    }
+
+    n = tcp_sendv(c, &bufv, cap);
+    if (n < 0) {
+        if (n == CC_EAGAIN) {
+            log_verb("sendv on conn returns rescuable error: EAGAIN", c);
+            status = CC_EAGAIN;
+        } else {
+            log_info("sendv on conn %p returns other error: %d", c, n);
+            status = CC_ERROR;
+            c->state = CHANNEL_ERROR;
+        }
+    } else if ((size_t)n < cap || buf != NULL) {
+        log_debug("unwritten data remain on conn %p, should retry", c);
+        status = CC_ERETRY;
+    } else {
+        status = CC_OK;
+    }
+
+    /* bufs chained after the write buffer are returned once written out */
+    if (n > 0) {
+        buf = s->wbuf;
+        len = MIN(buf_rsize(buf), (size_t)n);
+        buf->rpos += len;
+        n -= len;
+        while ((nbuf = buf->chain) != NULL) {
+            len = MIN(buf_rsize(nbuf), (size_t)n);
+            nbuf->rpos += len;
+            n -= len;
+            if (buf_rsize(nbuf) > 0) {
+                break;
+            }
+            buf->chain = nbuf->chain;
+            nbuf->chain = NULL;
+            buf_return(&nbuf);
+        }
+    }
+
+    return status;
+}
+
 rstatus_i
 buf_tcp_write(struct buf_sock *s)
 {
@@ -108,6 +178,10 @@ buf_tcp_write(struct buf_sock *s)
     ASSERT(c != NULL && h != NULL && buf != NULL);
     ASSERT(h->send != NULL);
 
+    if (buf->chain != NULL) {
+        return _buf_tcp_writev(s);
+    }
+
     cap = buf_rsize(buf);
 
     if (cap == 0) {
@@ -327,6 +401,8 @@ buf_sock_reset(struct buf_sock *s)
     s->flag = 0;
     s->data = NULL;
     s->hdl = NULL;
+    s->tev = NULL;
+    s->active = 0;
 
     tcp_conn_reset(s->ch);
     buf_reset(s->rbuf);
@@ -338,7 +414,7 @@ buf_sock_borrow(void)
 {
     struct buf_sock *s;
 
-    FREEPOOL_BORROW(s, &bsp, next, buf_sock_create);
+    FREEPOOL_CACHE_BORROW(s, &bsl, &bsp, next, buf_sock_create);
     if (s == NULL) {
         log_debug("borrow buffered socket failed: OOM or over limit");
         INCR(sockio_metrics, buf_sock_borrow_ex);
@@ -364,7 +440,7 @@ buf_sock_return(struct buf_sock **s)
     log_verb("return buffered socket %p", *s);
 
     (*s)->free = true;
-    FREEPOOL_RETURN(*s, &bsp, next);
+    FREEPOOL_CACHE_RETURN(*s, &bsl, &bsp, next);
 
     *s = NULL;
     INCR(sockio_metrics, buf_sock_return);
@@ -16,7 +16,8 @@ struct timeout_event {
     bool                        recur;  /* will be reinserted upon firing */
     struct timeout              delay;  /* delay */
     /* the following is set internally */
-    size_t                      offset; /* bucket offset in the timing wheel */
+    uint64_t                    due;    /* tick the event is due at */
+    size_t                      slot;   /* slot in the timing wheel table */
     bool                        free;   /* is this object free to reuse? */
     TAILQ_ENTRY(timeout_event)  tqe;    /* entry in the wheel TAILQ */
     STAILQ_ENTRY(timeout_event) next;   /* next timeout_event in pool */
@@ -25,9 +26,13 @@ struct timeout_event {
 STAILQ_HEAD(tevent_sqh, timeout_event); /* corresponding header type for the STAILQ */
 TAILQ_HEAD(tevent_tqh, timeout_event);  /* head type for timeout events */
 
+/* timing wheels are not shared between threads, and neither are the timeout
+ * events they hold, so each thread borrows from a pool of its own, which is
+ * created the first time the thread borrows
+ */
 FREEPOOL(tevent_pool, teventq, timeout_event);
-static struct tevent_pool teventp;
-static bool teventp_init = false;
+static __thread struct tevent_pool teventp;
+static __thread bool teventp_init = false;
 
 static timing_wheel_metrics_st *timing_wheel_metrics = NULL;
 static bool timing_wheel_init = false;
@@ -43,7 +48,8 @@ timeout_event_reset(struct timeout_event *t)
     t->data = NULL;
     t->recur = false;
     timeout_reset(&t->delay);
-    t->offset = 0;
+    t->due = 0;
+    t->slot = 0;
     t->free = false;
     /* queue-related members are set/cleared by timing wheel ops */
 }
@@ -79,11 +85,16 @@ timeout_event_destroy(struct timeout_event **t)
     DECR(timing_wheel_metrics, timeout_event_curr);
 }
 
+static void timeout_event_pool_create(uint32_t max);
+
 static struct timeout_event *
 timeout_event_borrow(void)
 {
     struct timeout_event *t;
 
+    if (!teventp_init) {
+        timeout_event_pool_create(0);
+    }
     FREEPOOL_BORROW(t, &teventp, next, timeout_event_create);
 
     if (t == NULL) {
@@ -198,11 +209,30 @@ timing_wheel_teardown(void)
 struct timing_wheel *
 timing_wheel_create(struct timeout *tick, size_t cap, size_t ntick)
 {
-    struct timing_wheel *tw = (struct timing_wheel *)cc_alloc(sizeof(*tw));
+    return timing_wheel_create_level(tick, cap, 1, ntick);
+}
+
+struct timing_wheel *
+timing_wheel_create_level(struct timeout *tick, size_t cap, size_t nlevel,
+                          size_t ntick)
+{
+    struct timing_wheel *tw;
+    uint64_t span = 1;
 
     ASSERT(tick != NULL);
-    ASSERT(cap > 0);
+    ASSERT(cap > 0 && nlevel > 0);
 
+    for (size_t i = 0; i < nlevel; i++) {
+        if (span > UINT64_MAX / cap) {
+            log_error("timing_wheel creation failed: %zu levels of %zu ticks "
+                    "cannot be covered", nlevel, cap);
+
+            return NULL;
+        }
+        span *= cap;
+    }
+
+    tw = (struct timing_wheel *)cc_alloc(sizeof(*tw));
     if (tw == NULL) {
         log_error("timing_wheel creation failed due to OOM");
 
@@ -211,21 +241,24 @@ timing_wheel_create(struct timeout *tick, size_t cap, size_t ntick)
 
     tw->tick = *tick;
     tw->tick_ns = timeout_ns(tick);
+    tw->span = span;
     tw->cap = cap;
+    tw->nlevel = nlevel;
     tw->max_ntick = ntick; /* if ntick is 0, there's no limit */
     tw->active = false;
     timeout_reset(&tw->due);
     tw->curr = 0;
     tw->nevent = 0;
 
-    tw->table = (struct tevent_tqh *)cc_alloc(cap * sizeof(struct tevent_tqh));
+    tw->table = (struct tevent_tqh *)cc_alloc(cap * nlevel *
+            sizeof(struct tevent_tqh));
     if (tw->table == NULL) {
         log_error("timing_wheel creation failed due to table allocation OOM");
         cc_free(tw);
 
         return NULL;
     }
-    for (size_t i = 0; i < cap; i++) {
+    for (size_t i = 0; i < cap * nlevel; i++) {
         TAILQ_INIT(&tw->table[i]);
     }
 
@@ -233,7 +266,8 @@ timing_wheel_create(struct timeout *tick, size_t cap, size_t ntick)
     tw->ntick = 0;
     tw->nexec = 0;
 
-    log_info("created timing_wheel %p", tw);
+    log_info("created timing_wheel %p with %zu levels of %zu ticks", tw, nlevel,
+            cap);
 
     return tw;
 }
@@ -258,6 +292,28 @@ _offset(struct timing_wheel *tw, struct timeout *delay) {
     return (delay_ns == 0) ? 0 : (delay_ns - 1) / tw->tick_ns + 1;
 }
 
+/*
+ * An event due offset ticks from now goes into level l if cap^l <= offset <
+ * cap^(l+1), in the slot covering the tick it is due at, which is cascaded
+ * down (or processed, for level 0) no later than that tick.
+ */
+static inline void
+_slot(struct timing_wheel *tw, struct timeout_event *tev, uint64_t offset)
+{
+    uint64_t span = 1;
+    size_t level = 0;
+
+    ASSERT(offset < tw->span);
+
+    while (offset >= span * tw->cap) {
+        span *= tw->cap;
+        level++;
+    }
+
+    tev->due = tw->ntick + offset;
+    tev->slot = level * tw->cap + (tev->due / span) % tw->cap;
+}
+
 /**
  * Since timing wheel is discrete, the events are bucket'ed approximately.
  * Here we treat ms == 0 as a special case and add event to the current slot,
@@ -266,7 +322,7 @@ _offset(struct timing_wheel *tw, struct timeout *delay) {
 static void
 _timing_wheel_insert(struct timing_wheel *tw, struct timeout_event *tev)
 {
-    TAILQ_INSERT_TAIL(&tw->table[tev->offset], tev, tqe);
+    TAILQ_INSERT_TAIL(&tw->table[tev->slot], tev, tqe);
     tw->nevent++;
 
     INCR(timing_wheel_metrics, timing_wheel_insert);
@@ -278,7 +334,7 @@ timing_wheel_insert(struct timing_wheel *tw, struct timeout *delay, bool recur,
                     timeout_cb_fn cb, void *arg)
 {
     struct timeout_event *tev;
-    size_t offset;
+    uint64_t offset;
 
     ASSERT(tw != NULL && delay != NULL && cb != NULL);
     ASSERT(delay->is_intvl);
@@ -294,10 +350,10 @@ timing_wheel_insert(struct timing_wheel *tw, struct timeout *delay, bool recur,
     tev->delay = *delay;
 
     offset = _offset(tw, delay);
-    if (offset >= tw->cap) { /* wraps around */
+    if (offset >= tw->span) { /* wraps around */
         log_error("insert timeout event into timing wheel failed: timeout "
                 "%"PRIi64"ns too long for wheel capacity %"PRIu64"ns",
-                timeout_ns(delay), tw->tick_ns * tw->cap);
+                timeout_ns(delay), tw->tick_ns * tw->span);
         goto error;
     }
     if (recur && offset == 0) {
@@ -306,9 +362,9 @@ timing_wheel_insert(struct timing_wheel *tw, struct timeout *delay, bool recur,
         goto error;
     }
 
-    tev->offset = (tw->curr + offset) % tw->cap; /* convert to absolute offset */
+    _slot(tw, tev, offset); /* convert to absolute slot */
     log_verb("inserting timeout event %p into timing wheel %p: curr tick %zu, "
-            "scheduled offset %zu", tev, tw, tw->curr, tev->offset);
+            "scheduled slot %zu", tev, tw, tw->curr, tev->slot);
     _timing_wheel_insert(tw, tev);
 
     return tev;
@@ -324,7 +380,7 @@ _timing_wheel_remove(struct timing_wheel *tw, struct timeout_event *tev)
 {
     ASSERT(tw != NULL && tev != NULL);
 
-    TAILQ_REMOVE(&tw->table[tev->offset], tev, tqe);
+    TAILQ_REMOVE(&tw->table[tev->slot], tev, tqe);
     tw->nevent--;
 
     INCR(timing_wheel_metrics, timing_wheel_remove);
@@ -336,7 +392,7 @@ timing_wheel_remove(struct timing_wheel *tw, struct timeout_event **tev)
 {
     /* consider the timeout event canceled if removed externally, and recycle */
     log_verb("removing timeout event %p from timing wheel %p: curr tick %zu, "
-            "scheduled offset %zu", *tev, tw, tw->curr, (*tev)->offset);
+            "scheduled slot %zu", *tev, tw, tw->curr, (*tev)->slot);
 
     _timing_wheel_remove(tw, *tev);
     timeout_event_return(tev);
@@ -383,13 +439,43 @@ _advance_curr(struct timing_wheel *tw)
     INCR(timing_wheel_metrics, timing_wheel_tick);
 }
 
+/*
+ * Once level l - 1 wraps around, i.e. on every cap^l-th tick, the events in
+ * the next slot of level l are all due within the next cap^l ticks, and are
+ * moved down to the levels below. Since level l - 1 can only wrap around when
+ * all levels below it do, this stops at the first level that did not.
+ */
 static inline void
-_process_tick(struct timing_wheel *tw, bool endmode)
+_cascade(struct timing_wheel *tw)
+{
+    struct timeout_event *t, *tt;
+    struct tevent_tqh *head;
+    uint64_t span = tw->cap;
+
+    for (size_t level = 1; level < tw->nlevel && tw->ntick % span == 0;
+            level++, span *= tw->cap) {
+        head = &tw->table[level * tw->cap + (tw->ntick / span) % tw->cap];
+        TAILQ_FOREACH_SAFE(t, head, tqe, tt) {
+            ASSERT(t->due >= tw->ntick);
+
+            TAILQ_REMOVE(head, t, tqe);
+            _slot(tw, t, t->due - tw->ntick);
+            TAILQ_INSERT_TAIL(&tw->table[t->slot], t, tqe);
+            INCR(timing_wheel_metrics, timing_wheel_cascade);
+
+            log_vverb("(internal) cascading timeout event %p in timing wheel "
+                    "%p from level %zu to slot %zu", t, tw, level, t->slot);
+        }
+    }
+}
+
+static inline void
+_process_slot(struct timing_wheel *tw, size_t slot, bool endmode)
 {
     struct timeout_event *t, *tt;
     uint64_t nprocess = tw->nprocess;
 
-    TAILQ_FOREACH_SAFE(t, &tw->table[tw->curr], tqe, tt) {
+    TAILQ_FOREACH_SAFE(t, &tw->table[slot], tqe, tt) {
         tw->nprocess++;
         INCR(timing_wheel_metrics, timing_wheel_process);
 
@@ -401,18 +487,18 @@ _process_tick(struct timing_wheel *tw, bool endmode)
             t->cb(t->data);
         }
         if (!endmode && t->recur) {
-            /* re-calculate offset & insert if recurring and not ending */
-            t->offset = (tw->curr + _offset(tw, &t->delay)) % tw->cap;
+            /* re-calculate slot & insert if recurring and not ending */
+            _slot(tw, t, _offset(tw, &t->delay));
             log_vverb("(internal) inserting timeout event %p into timing wheel "
-                    "%p: scheduled offset %zu", t, tw, t->offset);
+                    "%p: scheduled slot %zu", t, tw, t->slot);
             _timing_wheel_insert(tw, t);
         } else {
             timeout_event_return(&t);
         }
     }
 
-    log_vverb("processed %"PRIu64" timeout events during tick %zu of timing "
-            "wheel %p", tw->nprocess - nprocess, tw->curr, tw);
+    log_vverb("processed %"PRIu64" timeout events in slot %zu of timing "
+            "wheel %p", tw->nprocess - nprocess, slot, tw);
 }
 
 static inline bool
@@ -449,8 +535,9 @@ timing_wheel_execute(struct timing_wheel *tw)
         duration_start(&d);
 
         ntick++;
-        _process_tick(tw, false);
+        _process_slot(tw, tw->curr, false);
         _advance_curr(tw);
+        _cascade(tw);
 
         duration_stop(&d);
         elapsed += duration_ns(&d);
@@ -479,7 +566,12 @@ timing_wheel_flush(struct timing_wheel *tw)
     log_info("flushing all remaining ticks in timing wheel %p", tw);
 
     do {
-        _process_tick(tw, true);
+        _process_slot(tw, tw->curr, true);
         _advance_curr(tw);
     } while (tw->curr != start);
+
+    /* what is left is due beyond the lowest level, in no particular order */
+    for (size_t i = tw->cap; i < tw->cap * tw->nlevel; i++) {
+        _process_slot(tw, i, true);
+    }
 }
@@ -245,6 +245,95 @@ START_TEST(test_rshift)
 }
 END_TEST
 
+START_TEST(test_chain)
+{
+    struct buf *buf = NULL, *nbuf;
+
+    test_reset();
+
+    buf = buf_borrow();
+    ck_assert_ptr_ne(buf, NULL);
+    ck_assert_ptr_eq(buf->chain, NULL);
+    ck_assert_ptr_eq(*buf_chain_tail(&buf), buf);
+
+    /* chained bufs are borrowed from the pool */
+    nbuf = buf_chain_extend(buf);
+    ck_assert_ptr_ne(nbuf, NULL);
+    ck_assert_ptr_eq(buf->chain, nbuf);
+    ck_assert_ptr_eq(buf_chain_extend(nbuf), nbuf->chain);
+    ck_assert_ptr_eq(*buf_chain_tail(&buf), nbuf->chain);
+    ck_assert_uint_eq(bmetrics.buf_chain.counter, 2);
+    ck_assert_int_eq(bmetrics.buf_active.gauge, 3);
+
+    /* and returned along with the buf they are chained to */
+    buf_return(&buf);
+    ck_assert_ptr_eq(buf, NULL);
+    ck_assert_int_eq(bmetrics.buf_active.gauge, 0);
+
+    /* or when it is reset */
+    buf = buf_borrow();
+    ck_assert_ptr_ne(buf_chain_extend(buf), NULL);
+    ck_assert_int_eq(bmetrics.buf_active.gauge, 2);
+    buf_reset(buf);
+    ck_assert_ptr_eq(buf->chain, NULL);
+    ck_assert_int_eq(bmetrics.buf_active.gauge, 1);
+    buf_return(&buf);
+}
+END_TEST
+
+static int nrelease;
+
+static void
+_release(void *ref)
+{
+    ck_assert_ptr_eq(ref, &nrelease);
+    nrelease++;
+}
+
+START_TEST(test_chain_ref)
+{
+#define DATA "the data referred to"
+    char data[] = DATA;
+    struct buf *buf = NULL, *rbuf;
+
+    test_reset();
+    nrelease = 0;
+
+    /* a ref buf reads the data it refers to in place */
+    buf = buf_borrow();
+    buf_write(buf, "head", 4);
+    rbuf = buf_chain_ref(buf, data, sizeof(DATA) - 1, _release, &nrelease);
+    ck_assert_ptr_ne(rbuf, NULL);
+    ck_assert_ptr_eq(buf->chain, rbuf);
+    ck_assert_ptr_eq(rbuf->rpos, data);
+    ck_assert_uint_eq(buf_rsize(rbuf), sizeof(DATA) - 1);
+    ck_assert_uint_eq(buf_wsize(rbuf), 0);
+    ck_assert_uint_eq(buf_chain_rsize(buf), 4 + sizeof(DATA) - 1);
+    ck_assert_uint_eq(bmetrics.buf_ref.counter, 1);
+
+    /* and releases it when returned */
+    buf_return(&buf);
+    ck_assert_int_eq(nrelease, 1);
+    ck_assert_int_eq(bmetrics.buf_active.gauge, 0);
+
+    /* or copies it, after which the data is no longer needed */
+    buf = buf_borrow();
+    buf_write(buf, "head", 4);
+    ck_assert_ptr_ne(buf_chain_ref(buf, data, sizeof(DATA) - 1, _release,
+                &nrelease), NULL);
+    ck_assert_int_eq(buf_chain_unref(buf), CC_OK);
+    ck_assert_int_eq(nrelease, 2);
+    ck_assert_uint_eq(bmetrics.buf_unref.counter, 1);
+    memset(data, 0, sizeof(data));
+    ck_assert_uint_eq(buf_chain_rsize(buf), 4 + sizeof(DATA) - 1);
+    ck_assert_int_eq(cc_bcmp(buf->rpos, "head" DATA, 4 + sizeof(DATA) - 1), 0);
+    buf_return(&buf);
+    ck_assert_int_eq(nrelease, 2);
+    ck_assert_int_eq(bmetrics.buf_active.gauge, 0);
+#undef DATA
+}
+END_TEST
+
 START_TEST(test_dbuf_double_basic)
 {
 #define EXPECTED_BUF_SIZE                (TEST_BUF_SIZE * 2)
@@ -395,6 +484,8 @@ buf_suite(void)
     tcase_add_test(tc_buf, test_create_write_read_destroy_long);
     tcase_add_test(tc_buf, test_lshift);
     tcase_add_test(tc_buf, test_rshift);
+    tcase_add_test(tc_buf, test_chain);
+    tcase_add_test(tc_buf, test_chain_ref);
 
     TCase *tc_dbuf = tcase_create("dbuf test");
     suite_add_tcase(s, tc_dbuf);
@@ -142,6 +142,80 @@ START_TEST(test_write)
 }
 END_TEST
 
+START_TEST(test_edge)
+{
+#define DATA "foo bar baz"
+    struct event_base *event_base;
+    int random_pointer[1] = {1};
+    struct pipe_conn *pipe;
+
+    test_reset();
+
+    event_base = event_base_create(1024, log_event);
+
+    pipe = pipe_conn_create();
+    ck_assert_int_eq(pipe_open(NULL, pipe), true);
+    ck_assert_int_eq(pipe_send(pipe, DATA, sizeof(DATA)), sizeof(DATA));
+
+    ck_assert_int_eq(event_add_edge(event_base, pipe_read_id(pipe),
+                random_pointer), 0);
+
+    event_wait(event_base, -1);
+
+    ck_assert_int_eq(event_log_count, 1);
+    ck_assert_ptr_eq(event_log[0].arg, random_pointer);
+    ck_assert_int_eq(event_log[0].events & EVENT_READ, EVENT_READ);
+
+    /* data left unread does not trigger another event */
+    event_wait(event_base, 100);
+    ck_assert_int_eq(event_log_count, 1);
+
+    /* but more data does */
+    ck_assert_int_eq(pipe_send(pipe, DATA, sizeof(DATA)), sizeof(DATA));
+    event_wait(event_base, -1);
+    ck_assert_int_eq(event_log_count, 2);
+    ck_assert_int_eq(event_log[1].events & EVENT_READ, EVENT_READ);
+
+    ck_assert_int_eq(event_del(event_base, pipe_read_id(pipe)), 0);
+    event_base_destroy(&event_base);
+    pipe_close(pipe);
+    pipe_conn_destroy(&pipe);
+#undef DATA
+}
+END_TEST
+
+START_TEST(test_exclusive)
+{
+#define DATA "foo bar baz"
+    struct event_base *event_base;
+    int random_pointer[1] = {1};
+    struct pipe_conn *pipe;
+
+    test_reset();
+
+    event_base = event_base_create(1024, log_event);
+
+    pipe = pipe_conn_create();
+    ck_assert_int_eq(pipe_open(NULL, pipe), true);
+    ck_assert_int_eq(pipe_send(pipe, DATA, sizeof(DATA)), sizeof(DATA));
+
+    ck_assert_int_eq(event_add_exclusive(event_base, pipe_read_id(pipe),
+                random_pointer), 0);
+
+    event_wait(event_base, -1);
+
+    ck_assert_int_eq(event_log_count, 1);
+    ck_assert_ptr_eq(event_log[0].arg, random_pointer);
+    ck_assert_int_eq(event_log[0].events, EVENT_READ);
+
+    ck_assert_int_eq(event_del(event_base, pipe_read_id(pipe)), 0);
+    event_base_destroy(&event_base);
+    pipe_close(pipe);
+    pipe_conn_destroy(&pipe);
+#undef DATA
+}
+END_TEST
+
 /*
  * test suite
  */
@@ -157,6 +231,8 @@ event_suite(void)
     tcase_add_test(tc_event, test_read);
     tcase_add_test(tc_event, test_cannot_read);
     tcase_add_test(tc_event, test_write);
+    tcase_add_test(tc_event, test_edge);
+    tcase_add_test(tc_event, test_exclusive);
 
     return s;
 }
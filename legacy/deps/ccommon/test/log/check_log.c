@@ -1,4 +1,5 @@
 #include <cc_log.h>
+#include <cc_rbuf.h>
 
 #include <check.h>
 
@@ -240,6 +241,38 @@ START_TEST(test_write_skip_metrics)
 }
 END_TEST
 
+START_TEST(test_write_flush_buf)
+{
+#define LOGSTR "foo bar baz"
+    struct logger *logger;
+    struct rbuf *buf;
+    char *tmpname = tmpname_create();
+
+    test_reset();
+
+    /* the ring is written and flushed apart from the logger's own */
+    logger = log_create(tmpname, 0);
+    buf = rbuf_create(100);
+    ck_assert_ptr_ne(buf, NULL);
+
+    ck_assert_int_eq(log_write_buf(logger, buf, LOGSTR, sizeof(LOGSTR) - 1), 1);
+    assert_file_contents(tmpname, "", 0);
+    ck_assert_uint_eq(log_flush_buf(logger, buf), sizeof(LOGSTR) - 1);
+    assert_file_contents(tmpname, LOGSTR, sizeof(LOGSTR) - 1);
+    ck_assert_uint_eq(rbuf_rcap(buf), 0);
+
+    /* a missing ring drops the message */
+    ck_assert_int_eq(log_write_buf(logger, NULL, LOGSTR, sizeof(LOGSTR) - 1), 0);
+    ck_assert_uint_eq(metrics.log_skip.counter, 1);
+    ck_assert_uint_eq(log_flush_buf(logger, NULL), 0);
+
+    rbuf_destroy(&buf);
+    log_destroy(&logger);
+    tmpname_destroy(tmpname);
+#undef LOGSTR
+}
+END_TEST
+
 /*
  * test suite
  */
@@ -261,6 +294,7 @@ log_suite(void)
     tcase_add_test(tc_log, test_write_metrics_file_nobuf);
     tcase_add_test(tc_log, test_write_metrics_stderr_nobuf);
     tcase_add_test(tc_log, test_write_skip_metrics);
+    tcase_add_test(tc_log, test_write_flush_buf);
 
     return s;
 }
@@ -3,6 +3,7 @@
 
 #include <check.h>
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -17,6 +18,7 @@ struct foo {
 
 FREEPOOL(foo_pool, fooq, foo);
 static struct foo_pool foop;
+static __thread struct foo_pool_local fool;
 
 static struct foo *
 foo_create(void)
@@ -145,6 +147,109 @@ START_TEST(test_noprealloc_borrow_return)
 }
 END_TEST
 
+START_TEST(test_cache_borrow_return)
+{
+    struct foo *foo = NULL, *bar = NULL;
+    struct foo *foos[2 * FREEPOOL_MAGAZINE];
+    uint32_t max = 4 * FREEPOOL_MAGAZINE;
+    int i;
+
+    test_reset();
+
+    FREEPOOL_CREATE(&foop, max);
+    FREEPOOL_PREALLOC(foo, &foop, max, next, foo_create);
+
+    /* the first borrow moves a magazine into the cache of the thread */
+    FREEPOOL_CACHE_BORROW(foo, &fool, &foop, next, foo_create);
+    ck_assert(foo != NULL);
+    ck_assert(fool.cache != NULL);
+    ck_assert_int_eq(foop.nfree, max - FREEPOOL_MAGAZINE);
+    ck_assert_int_eq(fool.cache->nfree, FREEPOOL_MAGAZINE - 1);
+    FREEPOOL_CACHE_RETURN(foo, &fool, &foop, next);
+    ck_assert_int_eq(fool.cache->nfree, FREEPOOL_MAGAZINE);
+
+    /* returns past two magazines move one back to the pool */
+    for (i = 0; i < 2 * FREEPOOL_MAGAZINE; i++) {
+        FREEPOOL_CACHE_BORROW(foos[i], &fool, &foop, next, foo_create);
+        ck_assert(foos[i] != NULL);
+    }
+    ck_assert_int_eq(foop.nfree, max - 2 * FREEPOOL_MAGAZINE);
+    for (i = 0; i < 2 * FREEPOOL_MAGAZINE; i++) {
+        FREEPOOL_CACHE_RETURN(foos[i], &fool, &foop, next);
+    }
+    ck_assert_int_eq(foop.nfree, max - FREEPOOL_MAGAZINE);
+    ck_assert_int_eq(fool.cache->nfree, FREEPOOL_MAGAZINE);
+    ck_assert_int_eq(foop.nused, FREEPOOL_MAGAZINE);
+
+    /* destroying the pool empties the caches */
+    FREEPOOL_DESTROY(foo, bar, &foop, next, foo_destroy);
+    ck_assert_int_eq(foop.nfree, 0);
+    ck_assert(foop.caches == NULL);
+
+    /* a cache is not reused across pools, nor past the limit of the pool */
+    FREEPOOL_CREATE(&foop, 1);
+    FREEPOOL_CACHE_BORROW(foo, &fool, &foop, next, foo_create);
+    ck_assert(foo != NULL);
+    ck_assert_int_eq(foop.nused, 1);
+    FREEPOOL_CACHE_BORROW(bar, &fool, &foop, next, foo_create);
+    ck_assert(bar == NULL);
+    FREEPOOL_CACHE_RETURN(foo, &fool, &foop, next);
+    FREEPOOL_DESTROY(foo, bar, &foop, next, foo_destroy);
+}
+END_TEST
+
+#define NTHREAD 4
+#define NLOOP   10000
+
+static void *
+_borrow_return(void *arg)
+{
+    struct foo *foos[FREEPOOL_MAGAZINE + 1];
+    int i, j;
+
+    for (i = 0; i < NLOOP; i++) {
+        for (j = 0; j < FREEPOOL_MAGAZINE + 1; j++) {
+            FREEPOOL_CACHE_BORROW(foos[j], &fool, &foop, next, foo_create);
+            if (foos[j] == NULL) {
+                return arg;
+            }
+            foos[j]->d = i;
+        }
+        for (j = 0; j < FREEPOOL_MAGAZINE + 1; j++) {
+            FREEPOOL_CACHE_RETURN(foos[j], &fool, &foop, next);
+        }
+    }
+
+    return NULL;
+}
+
+START_TEST(test_cache_threads)
+{
+    struct foo *foo, *bar;
+    pthread_t threads[NTHREAD];
+    void *ret;
+    int i;
+
+    test_reset();
+
+    FREEPOOL_CREATE(&foop, 0);
+    for (i = 0; i < NTHREAD; i++) {
+        ck_assert_int_eq(pthread_create(&threads[i], NULL, _borrow_return,
+                    NULL), 0);
+    }
+    for (i = 0; i < NTHREAD; i++) {
+        pthread_join(threads[i], &ret);
+        ck_assert(ret == NULL);
+    }
+
+    /* every object is back in a cache or the pool */
+    FREEPOOL_DESTROY(foo, bar, &foop, next, foo_destroy);
+    ck_assert_int_eq(foop.nused, 0);
+    ck_assert_int_eq(foop.nfree, 0);
+}
+END_TEST
+#undef NTHREAD
+#undef NLOOP
 
 /*
  * test suite
@@ -158,6 +263,8 @@ pool_suite(void)
     tcase_add_test(tc_pool, test_create_prealloc_destroy);
     tcase_add_test(tc_pool, test_prealloc_borrow_return);
     tcase_add_test(tc_pool, test_noprealloc_borrow_return);
+    tcase_add_test(tc_pool, test_cache_borrow_return);
+    tcase_add_test(tc_pool, test_cache_threads);
 
     suite_add_tcase(s, tc_pool);
 
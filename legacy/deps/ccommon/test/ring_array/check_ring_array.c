@@ -215,6 +215,77 @@ START_TEST(test_thread)
 }
 END_TEST
 
+START_TEST(test_push_pop_batch)
+{
+#define ELEM_SIZE sizeof(uint32_t)
+#define CAP 10
+    struct ring_array *arr;
+    uint32_t in[CAP + 2], out[CAP + 2];
+    uint32_t i, round;
+
+    for (i = 0; i < CAP + 2; ++i) {
+        in[i] = i;
+    }
+
+    arr = ring_array_create(ELEM_SIZE, CAP);
+
+    /* only CAP of the elements fit */
+    ck_assert_int_eq(ring_array_push_batch(in, CAP + 2, arr), CAP);
+    ck_assert(ring_array_full(arr));
+    ck_assert_int_eq(ring_array_pop_batch(out, CAP + 2, arr), CAP);
+    ck_assert(ring_array_empty(arr));
+    for (i = 0; i < CAP; ++i) {
+        ck_assert_int_eq(out[i], i);
+    }
+
+    /* batches of 7 wrap around the end of the array in different places */
+    for (round = 0; round < CAP; ++round) {
+        ck_assert_int_eq(ring_array_push_batch(in, 7, arr), 7);
+        ck_assert_int_eq(ring_array_pop_batch(out, 3, arr), 3);
+        ck_assert_int_eq(ring_array_pop_batch(out + 3, 7, arr), 4);
+        for (i = 0; i < 7; ++i) {
+            ck_assert_int_eq(out[i], i);
+        }
+    }
+
+    ring_array_destroy(&arr);
+#undef ELEM_SIZE
+#undef CAP
+}
+END_TEST
+
+START_TEST(test_sleep_wakeup)
+{
+#define ELEM_SIZE sizeof(uint8_t)
+#define CAP 10
+    struct ring_array *arr;
+    uint8_t data = 0;
+
+    arr = ring_array_create(ELEM_SIZE, CAP);
+
+    /* the consumer starts out sleeping, only the first push wakes it up */
+    ring_array_push(&data, arr);
+    ck_assert(ring_array_wakeup(arr));
+    ring_array_push(&data, arr);
+    ck_assert(!ring_array_wakeup(arr));
+
+    /* the consumer cannot sleep until it pops everything */
+    ck_assert(!ring_array_sleep(arr));
+    ck_assert(!ring_array_wakeup(arr));
+    ck_assert_int_eq(ring_array_pop_batch(&data, 1, arr), 1);
+    ck_assert(!ring_array_sleep(arr));
+    ck_assert_int_eq(ring_array_pop_batch(&data, 1, arr), 1);
+    ck_assert(ring_array_sleep(arr));
+
+    ring_array_push(&data, arr);
+    ck_assert(ring_array_wakeup(arr));
+
+    ring_array_destroy(&arr);
+#undef ELEM_SIZE
+#undef CAP
+}
+END_TEST
+
 /*
  * test suite
  */
@@ -234,6 +305,8 @@ ring_array_suite(void)
     tcase_add_test(tc_ring_array, test_push_pop_many);
     tcase_add_test(tc_ring_array, test_flush);
     tcase_add_test(tc_ring_array, test_thread);
+    tcase_add_test(tc_ring_array, test_push_pop_batch);
+    tcase_add_test(tc_ring_array, test_sleep_wakeup);
 
     return s;
 }
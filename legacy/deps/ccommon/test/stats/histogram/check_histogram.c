@@ -114,6 +114,35 @@ START_TEST(test_record)
 }
 END_TEST
 
+START_TEST(test_merge)
+{
+#define m 0
+#define r 10
+#define n 20
+    struct histo_u32 *histo = histo_u32_create(m, r, n);
+    struct histo_u32 *other = histo_u32_create(m, r, n);
+    struct histo_u32 *bad = histo_u32_create(m, r, n + 1);
+
+    histo_u32_record(histo, 1, 1);
+    histo_u32_record(other, 1, 2);
+    histo_u32_record(other, 2048, 1);
+    ck_assert(histo_u32_merge(histo, other) == HISTO_OK);
+    ck_assert_int_eq(*(histo->buckets + 1), 3);
+    ck_assert_int_eq(*(histo->buckets + 1536), 1);
+    ck_assert_int_eq(histo->nrecord, 4);
+    ck_assert_int_eq(other->nrecord, 3);
+    ck_assert(histo_u32_merge(histo, bad) == HISTO_EMISMATCH);
+    ck_assert_int_eq(histo->nrecord, 4);
+
+    histo_u32_destroy(&bad);
+    histo_u32_destroy(&other);
+    histo_u32_destroy(&histo);
+#undef n
+#undef r
+#undef m
+}
+END_TEST
+
 START_TEST(test_report_sparse)
 {
 #define m 1
@@ -158,6 +187,11 @@ START_TEST(test_report_sparse)
     ck_assert_int_eq(pp->max, 7);
     ck_assert_int_eq(*(pp->result + 4), 7);
 
+    /* max is found past the last percentile too */
+    ck_assert_int_eq(percentile_profile_set(pp, percentiles, 1), HISTO_OK);
+    ck_assert(histo_u32_report_multi(pp, histo) == HISTO_OK);
+    ck_assert_int_eq(pp->max, 7);
+
     percentile_profile_destroy(&pp);
     histo_u32_destroy(&histo);
 #undef n
@@ -222,6 +256,7 @@ metric_suite(void)
     tcase_add_test(tc_histogram, test_histo_basic);
     tcase_add_test(tc_histogram, test_percentile_basic);
     tcase_add_test(tc_histogram, test_record);
+    tcase_add_test(tc_histogram, test_merge);
     tcase_add_test(tc_histogram, test_report_sparse);
     tcase_add_test(tc_histogram, test_report_exact);
     tcase_add_test(tc_histogram, test_bucket);
@@ -94,6 +94,56 @@ START_TEST(test_fpn)
 }
 END_TEST
 
+START_TEST(test_shard)
+{
+#define NSHARD 2
+    test_reset();
+    ck_assert_int_eq(metric_shard_setup((struct metric *)test_metrics,
+                METRIC_CARDINALITY(*test_metrics), NSHARD), CC_OK);
+
+    /* threads without a shard update the shared metrics */
+    INCR(test_metrics, c);
+    INCR_N(test_metrics, g, 2);
+    ck_assert_int_eq(test_metrics->c.counter, 1);
+    ck_assert_int_eq(test_metrics->g.gauge, 2);
+
+    /* those with a shard update their own, read together with the rest */
+    metric_shard_thread(0);
+    INCR_N(test_metrics, c, 2);
+    DECR_N(test_metrics, g, 3);
+    UPDATE_VAL(test_metrics, f, 2.1);
+    ck_assert_int_eq(test_metrics->c.counter, 1);
+    ck_assert_int_eq(test_metrics->g.gauge, 2);
+    ck_assert(test_metrics->f.fpn == 2.1);
+    ck_assert_int_eq(metric_counter(&test_metrics->c), 3);
+    ck_assert_int_eq(metric_gauge(&test_metrics->g), -1);
+
+    metric_shard_thread(1);
+    INCR(test_metrics, c);
+    DECR(test_metrics, c);
+    INCR(test_metrics, g);
+    ck_assert_int_eq(metric_counter(&test_metrics->c), 4);
+    ck_assert_int_eq(metric_gauge(&test_metrics->g), 0);
+
+    /* no such shard */
+    metric_shard_thread(NSHARD);
+    INCR(test_metrics, c);
+    ck_assert_int_eq(test_metrics->c.counter, 2);
+    ck_assert_int_eq(metric_counter(&test_metrics->c), 5);
+
+    /* resetting metrics resets their shards too */
+    metric_reset((struct metric *)test_metrics,
+            METRIC_CARDINALITY(*test_metrics));
+    ck_assert_int_eq(metric_counter(&test_metrics->c), 0);
+    ck_assert_int_eq(metric_gauge(&test_metrics->g), 0);
+
+    metric_shard_teardown();
+    INCR(test_metrics, c);
+    ck_assert_int_eq(metric_counter(&test_metrics->c), 1);
+#undef NSHARD
+}
+END_TEST
+
 /*
  * test suite
  */
@@ -109,6 +159,7 @@ metric_suite(void)
     tcase_add_test(tc_metric, test_counter);
     tcase_add_test(tc_metric, test_gauge);
     tcase_add_test(tc_metric, test_fpn);
+    tcase_add_test(tc_metric, test_shard);
 
     return s;
 }
@@ -180,6 +180,71 @@ START_TEST(test_timing_wheel_recur)
 }
 END_TEST
 
+START_TEST(test_timing_wheel_level)
+{
+#define TICK_NS 10000000
+#define NSLOT 4
+#define NLEVEL 3 /* covering 64 ticks */
+
+    struct timeout tick, delay;
+    struct timing_wheel *tw;
+    struct timeout_event *tev;
+    struct timespec ts = (struct timespec){0, TICK_NS * 12};
+    int i = 0, j = 0;
+
+    test_reset();
+
+    timeout_set_ns(&tick, TICK_NS);
+    tw = timing_wheel_create_level(&tick, NSLOT, NLEVEL, 0);
+    timing_wheel_start(tw);
+
+    /* beyond all levels */
+    timeout_set_ns(&delay, TICK_NS * NSLOT * NSLOT * NSLOT);
+    ck_assert(timing_wheel_insert(tw, &delay, false, _incr_cb, &i) == NULL);
+
+    /* one event in each of the upper levels, and one to be removed */
+    timeout_set_ns(&delay, TICK_NS * 6);
+    ck_assert(timing_wheel_insert(tw, &delay, false, _incr_cb, &i) != NULL);
+    timeout_set_ns(&delay, TICK_NS * 20);
+    ck_assert(timing_wheel_insert(tw, &delay, false, _incr_cb, &i) != NULL);
+    timeout_set_ns(&delay, TICK_NS * 50);
+    tev = timing_wheel_insert(tw, &delay, false, _incr_cb, &j);
+    ck_assert(tev != NULL);
+    ck_assert_int_eq(tw->nevent, 3);
+
+    /* between 12 and 20 ticks, the event due in 6 ticks was cascaded */
+    nanosleep(&ts, NULL);
+    timing_wheel_execute(tw);
+    ck_assert_int_eq(i, 1);
+    ck_assert_int_eq(tw->nevent, 2);
+    ck_assert_uint_ge(metrics.timing_wheel_cascade.counter, 1);
+
+    /* past 24 ticks, the event due in 20 ticks was cascaded twice */
+    nanosleep(&ts, NULL);
+    timing_wheel_execute(tw);
+    ck_assert_int_eq(i, 2);
+    ck_assert_int_eq(tw->nevent, 1);
+    ck_assert_uint_ge(metrics.timing_wheel_cascade.counter, 3);
+
+    timing_wheel_remove(tw, &tev);
+    ck_assert_int_eq(tw->nevent, 0);
+
+    /* flushing triggers events in the upper levels, too */
+    timeout_set_ns(&delay, TICK_NS * 60);
+    ck_assert(timing_wheel_insert(tw, &delay, false, _incr_cb, &j) != NULL);
+    timing_wheel_stop(tw);
+    timing_wheel_flush(tw);
+    ck_assert_int_eq(tw->nevent, 0);
+    ck_assert_int_eq(j, 1);
+
+    timing_wheel_destroy(&tw);
+
+#undef NLEVEL
+#undef NSLOT
+#undef TICK_NS
+}
+END_TEST
+
 START_TEST(test_timing_wheel_edge_case)
 {
 #define TICK_NS 100000000
@@ -230,6 +295,7 @@ wheel_suite(void)
 
     tcase_add_test(tc_wheel, test_timing_wheel_basic);
     tcase_add_test(tc_wheel, test_timing_wheel_recur);
+    tcase_add_test(tc_wheel, test_timing_wheel_level);
     tcase_add_test(tc_wheel, test_timing_wheel_edge_case);
 
     return s;
@@ -0,0 +1,93 @@
+#include <protocol/data/memcache/klog.h>
+
+#include <cc_debug.h>
+#include <cc_define.h>
+#include <cc_log.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#define INPUT_NBUF (1 * MiB)
+#define LINE_MAXLEN (KLOG_RECORD_MAXLEN + 128)
+
+static void
+show_usage(void)
+{
+    log_stdout(
+            "Usage:" CRLF
+            "  pelikan_klog-decode [klog]" CRLF
+            );
+    log_stdout(
+            "Description:" CRLF
+            "  pelikan_klog-decode prints the binary records of a command" CRLF
+            "  log as text, one line per command. It reads from stdin if no" CRLF
+            "  file is given." CRLF
+            );
+    log_stdout(
+            "Example:" CRLF
+            "  pelikan_klog-decode /var/log/pelikan/klog.log" CRLF
+            );
+}
+
+int
+main(int argc, char **argv)
+{
+    static char in[INPUT_NBUF];
+    char line[LINE_MAXLEN];
+    struct klog_record rec;
+    size_t len = 0, off, n;
+    FILE *fp = stdin;
+
+    if (argc > 2 || (argc == 2 && (strcmp(argv[1], "-h") == 0 ||
+                    strcmp(argv[1], "--help") == 0))) {
+        show_usage();
+        exit(argc > 2 ? EX_USAGE : EX_OK);
+    }
+
+    if (argc == 2) {
+        fp = fopen(argv[1], "r");
+        if (fp == NULL) {
+            log_stderr("cannot open klog file %s: %s", argv[1],
+                    strerror(errno));
+            exit(EX_NOINPUT);
+        }
+    }
+
+    /* records may span the end of what has been read, which is kept */
+    while ((n = fread(in + len, 1, sizeof(in) - len, fp)) > 0) {
+        len += n;
+        for (off = 0; len - off >= sizeof(rec); off += rec.size) {
+            memcpy(&rec, in + off, sizeof(rec));
+            if (rec.size < sizeof(rec) || rec.size > KLOG_RECORD_MAXLEN) {
+                log_stderr("invalid record of %u bytes at offset %zu",
+                        rec.size, off);
+                exit(EX_DATAERR);
+            }
+            if (len - off < rec.size) {
+                break;
+            }
+
+            n = klog_print(line, sizeof(line), &rec, in + off + sizeof(rec));
+            if (n == 0) {
+                log_stderr("cannot print record of type %u", rec.req_type);
+                continue;
+            }
+            fwrite(line, 1, n, stdout);
+        }
+        len -= off;
+        memmove(in, in + off, len);
+    }
+
+    if (len > 0) {
+        log_stderr("log ends within a record, last %zu bytes ignored", len);
+    }
+
+    if (fp != stdin) {
+        fclose(fp);
+    }
+
+    return EX_OK;
+}
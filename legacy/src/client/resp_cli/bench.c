@@ -0,0 +1,478 @@
+#include "bench.h"
+
+#include "../network/cli_network.h"
+
+#include <cc_debug.h>
+#include <cc_histogram.h>
+#include <cc_mm.h>
+#include <cc_print.h>
+#include <cc_util.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+
+#define BENCH_MODULE_NAME "resp-cli::bench"
+
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+
+/* 16ns resolution under 1us, within 1/32 of the value above, up to ~1s */
+#define HISTO_M 4
+#define HISTO_R 10
+#define HISTO_N 30
+#define LATENCY_MAX ((1ULL << HISTO_N) - 1) /* longer ones are recorded as max */
+
+#define BENCH_NWORD 16      /* max # words in the command template */
+#define BENCH_KEY_LEN 16    /* "key:" followed by up to 11 digits */
+#define BENCH_NUM_LEN 24
+#define BENCH_POLL_MS 100   /* longest wait in one poll */
+#define BENCH_DRAIN_SEC 1   /* how long to wait for responses at the end */
+
+static const double percentiles[] = {50, 90, 99, 99.9};
+#define NPERCENTILE (sizeof(percentiles) / sizeof(percentiles[0]))
+
+typedef enum bench_word {
+    WORD_LITERAL,
+    WORD_KEY,
+    WORD_VAL,
+    WORD_NUM,
+} bench_word_e;
+
+struct bench_conn {
+    struct buf_sock     *s;
+    struct response     *rsp;
+    uint32_t            inflight;   /* # responses still expected */
+    uint64_t            start;      /* when the batch in flight was due */
+    uint64_t            next;       /* when the next batch is due */
+    bool                active;
+};
+
+static bool bench_init = false;
+
+static uint32_t nconn;
+static uint32_t pipeline;
+static uint64_t interval;           /* between batches on a connection, in ns */
+static uint64_t duration;           /* in ns */
+static uint32_t nkey;
+static uint32_t vlen;
+
+static char *template = NULL;       /* the words of the template point here */
+static struct bstring words[BENCH_NWORD];
+static bench_word_e kinds[BENCH_NWORD];
+static uint32_t nword;
+
+static struct bench_conn *conns = NULL;
+static struct pollfd *fds = NULL;
+static struct request *req = NULL;
+static char *val = NULL;
+static char key[BENCH_KEY_LEN];
+static char num[BENCH_NUM_LEN];
+static uint64_t seed = 0x9e3779b97f4a7c15ULL;
+
+static struct histo_u32 *histo = NULL;
+static struct percentile_profile *profile = NULL;
+
+static uint64_t nsent;
+static uint64_t ncomplete;
+static uint64_t nerror;
+
+static uint64_t
+_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/* xorshift64*, good enough to spread the keys */
+static uint64_t
+_rand(void)
+{
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+
+    return seed * 0x2545f4914f6cdd1dULL;
+}
+
+static void
+_bench_parse_template(const char *cmd)
+{
+    char *p, *token;
+    size_t len;
+
+    len = strlen(cmd);
+    template = cc_alloc(len + 1);
+    if (template == NULL) {
+        return;
+    }
+    cc_memcpy(template, cmd, len + 1);
+
+    p = template;
+    nword = 0;
+    while ((token = strsep(&p, " \t\r\n")) != NULL) {
+        if (*token == '\0') {
+            continue;
+        }
+        if (nword == BENCH_NWORD) {
+            log_stderr("bench command has more than %u words, the rest are "
+                    "dropped", BENCH_NWORD);
+            break;
+        }
+        words[nword].data = token;
+        words[nword].len = strlen(token);
+        if (strcmp(token, "__key__") == 0) {
+            kinds[nword] = WORD_KEY;
+        } else if (strcmp(token, "__val__") == 0) {
+            kinds[nword] = WORD_VAL;
+        } else if (strcmp(token, "__num__") == 0) {
+            kinds[nword] = WORD_NUM;
+        } else {
+            kinds[nword] = WORD_LITERAL;
+        }
+        nword++;
+    }
+}
+
+void
+bench_setup(respcli_options_st *options)
+{
+    uint64_t rate;
+    uint32_t i;
+
+    log_info("set up the %s module", BENCH_MODULE_NAME);
+
+    if (bench_init) {
+        log_warn("%s has already been setup, overwrite", BENCH_MODULE_NAME);
+    }
+
+    network_config.host = options->server_host.val.vstr;
+    network_config.port = options->data_port.val.vstr;
+    network_config.mode = (network_config.host == NULL) ? LOCAL : REMOTE;
+
+    nconn = MAX(option_uint(&options->bench_nconn), 1);
+    pipeline = MAX(option_uint(&options->bench_pipeline), 1);
+    rate = option_uint(&options->bench_rate);
+    duration = option_uint(&options->bench_duration) * NSEC_PER_SEC;
+    nkey = MAX(option_uint(&options->bench_nkey), 1);
+    vlen = option_uint(&options->bench_vlen);
+
+    /* each connection sends its share of the rate, a batch at a time */
+    interval = (rate == 0) ? 0 : NSEC_PER_SEC * pipeline * nconn / rate;
+
+    _bench_parse_template(options->bench_command.val.vstr == NULL ? "" :
+            options->bench_command.val.vstr);
+
+    /* slacking on NULL check of the single objects, as the cli does */
+    req = request_create();
+    val = cc_alloc(vlen + 1);
+    histo = histo_u32_create(HISTO_M, HISTO_R, HISTO_N);
+    profile = percentile_profile_create(NPERCENTILE);
+    conns = cc_zalloc(sizeof(*conns) * nconn);
+    fds = cc_zalloc(sizeof(*fds) * nconn);
+    if (template == NULL || val == NULL || histo == NULL || profile == NULL ||
+            conns == NULL || fds == NULL) {
+        log_stderr("cannot allocate the benchmark of %u connections", nconn);
+        exit(EX_OSERR);
+    }
+    cc_memset(val, 'x', vlen);
+    percentile_profile_set(profile, percentiles, NPERCENTILE);
+
+    for (i = 0; i < nconn; ++i) {
+        conns[i].s = buf_sock_create();
+        conns[i].rsp = response_create();
+        if (conns[i].s == NULL || conns[i].rsp == NULL) {
+            log_stderr("cannot allocate connection %u of the benchmark", i);
+            exit(EX_OSERR);
+        }
+        conns[i].s->hdl = &tcp_handler;
+    }
+
+    bench_init = true;
+}
+
+void
+bench_teardown(void)
+{
+    uint32_t i;
+
+    log_info("tear down the %s module", BENCH_MODULE_NAME);
+
+    if (!bench_init) {
+        log_warn("%s has never been setup", BENCH_MODULE_NAME);
+    }
+
+    for (i = 0; conns != NULL && i < nconn; ++i) {
+        if (conns[i].active) {
+            cli_disconnect(conns[i].s);
+        }
+        buf_sock_destroy(&conns[i].s);
+        response_destroy(&conns[i].rsp);
+    }
+    cc_free(conns);
+    cc_free(fds);
+    cc_free(template);
+    cc_free(val);
+    request_destroy(&req);
+    histo_u32_destroy(&histo);
+    percentile_profile_destroy(&profile);
+
+    bench_init = false;
+}
+
+static void
+_bench_close(struct bench_conn *c, const char *reason)
+{
+    log_stderr("closing connection: %s, %u requests lost", reason,
+            c->inflight);
+
+    cli_disconnect(c->s);
+    c->active = false;
+    c->inflight = 0;
+}
+
+static void
+_bench_compose(struct bench_conn *c)
+{
+    struct element *el;
+    uint32_t i;
+    int status;
+
+    /* the server only takes requests as arrays of bulk strings */
+    request_reset(req);
+    el = array_push(req->token);
+    el->type = ELEM_ARRAY;
+    el->num = nword;
+    for (i = 0; i < nword; ++i) {
+        el = array_push(req->token);
+        el->type = ELEM_BULK;
+        switch (kinds[i]) {
+            case WORD_KEY:
+                el->bstr.len = cc_scnprintf(key, BENCH_KEY_LEN, "key:%"PRIu64,
+                        _rand() % nkey);
+                el->bstr.data = key;
+                break;
+
+            case WORD_VAL:
+                el->bstr.len = vlen;
+                el->bstr.data = val;
+                break;
+
+            case WORD_NUM:
+                el->bstr.len = cc_scnprintf(num, BENCH_NUM_LEN, "%"PRIu64,
+                        _rand() % nkey);
+                el->bstr.data = num;
+                break;
+
+            case WORD_LITERAL:
+                el->bstr = words[i];
+                break;
+
+            default:
+                NOT_REACHED();
+        }
+    }
+
+    status = compose_req(&c->s->wbuf, req);
+    if (status < 0) {
+        log_stderr("cannot compose request, buffer is full");
+    }
+}
+
+static void
+_bench_write(struct bench_conn *c)
+{
+    rstatus_i status;
+
+    do {
+        status = buf_tcp_write(c->s);
+    } while (status == CC_ERETRY);
+
+    if (status == CC_EEMPTY || status == CC_OK || status == CC_EAGAIN) {
+        buf_lshift(c->s->wbuf);
+        return;
+    }
+
+    _bench_close(c, "send error");
+}
+
+/* sends the next batch on the connection */
+static void
+_bench_send(struct bench_conn *c, uint64_t now)
+{
+    uint32_t i;
+
+    for (i = 0; i < pipeline; ++i) {
+        _bench_compose(c);
+    }
+    c->inflight = pipeline;
+    nsent += pipeline;
+
+    if (interval == 0) {
+        c->start = now;
+        c->next = now;
+    } else {
+        c->start = c->next;
+        c->next += interval;
+    }
+
+    _bench_write(c);
+}
+
+static void
+_bench_read(struct bench_conn *c)
+{
+    struct buf *rbuf;
+    parse_rstatus_e pstatus;
+    rstatus_i status;
+    uint64_t now;
+
+    do {
+        if (buf_wsize(c->s->rbuf) == 0 && dbuf_double(&c->s->rbuf) != CC_OK) {
+            _bench_close(c, "response too large");
+            return;
+        }
+        status = buf_tcp_read(c->s);
+    } while (status == CC_ERETRY);
+
+    if (status != CC_OK) {
+        _bench_close(c, status == CC_ERDHUP ? "server hung up" : "recv error");
+        return;
+    }
+
+    now = _now_ns();
+    rbuf = c->s->rbuf;
+    while (c->inflight > 0) {
+        response_reset(c->rsp);
+        pstatus = parse_rsp(c->rsp, rbuf);
+        if (pstatus == PARSE_EUNFIN) {
+            break;
+        }
+        if (pstatus != PARSE_OK) {
+            _bench_close(c, "invalid response");
+            return;
+        }
+
+        if (c->rsp->type == ELEM_ERR) {
+            nerror++;
+        }
+        histo_u32_record(histo, MIN(now - c->start, LATENCY_MAX), 1);
+        ncomplete++;
+        c->inflight--;
+    }
+    buf_lshift(rbuf);
+}
+
+static void
+_bench_report(uint64_t elapsed)
+{
+    uint64_t v[NPERCENTILE] = {0};
+    uint64_t max = 0;
+    uint32_t i;
+
+    log_stdout("bench: %u connections, pipeline %u, %.3f sec", nconn,
+            pipeline, (double)elapsed / NSEC_PER_SEC);
+    log_stdout("requests: sent %"PRIu64" completed %"PRIu64" errors %"PRIu64,
+            nsent, ncomplete, nerror);
+    log_stdout("throughput: %.1f requests/sec",
+            (double)ncomplete * NSEC_PER_SEC / MAX(elapsed, 1));
+
+    if (histo_u32_report_multi(profile, histo) == HISTO_OK) {
+        for (i = 0; i < NPERCENTILE; ++i) {
+            v[i] = bucket_high(histo, profile->result[i]);
+        }
+        max = bucket_high(histo, profile->max);
+    }
+    log_stdout("latency (us): p50 %.1f p90 %.1f p99 %.1f p999 %.1f max %.1f",
+            v[0] / 1e3, v[1] / 1e3, v[2] / 1e3, v[3] / 1e3, max / 1e3);
+}
+
+void
+bench_run(void)
+{
+    uint64_t begin, end, now;
+    uint32_t i, nactive, nbusy;
+    int timeout;
+
+    for (i = 0; i < nconn; ++i) {
+        conns[i].active = cli_connect(conns[i].s);
+        if (!conns[i].active) {
+            log_stderr("cannot connect to %s:%s", network_config.host == NULL ?
+                    "localhost" : network_config.host, network_config.port);
+            return;
+        }
+    }
+
+    /* stagger the connections so the batches are spread over the interval */
+    begin = _now_ns();
+    end = begin + duration;
+    for (i = 0; i < nconn; ++i) {
+        conns[i].next = begin + interval * i / nconn;
+    }
+
+    for (;;) {
+        now = _now_ns();
+        nactive = 0;
+        nbusy = 0;
+        timeout = BENCH_POLL_MS;
+
+        for (i = 0; i < nconn; ++i) {
+            struct bench_conn *c = &conns[i];
+
+            if (c->active && c->inflight == 0 && now < end && now >= c->next) {
+                _bench_send(c, now);
+            }
+
+            fds[i].fd = c->active ? ((struct tcp_conn *)c->s->ch)->sd : -1;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+            if (!c->active) {
+                continue;
+            }
+            nactive++;
+            if (buf_rsize(c->s->wbuf) > 0) {
+                fds[i].events |= POLLOUT;
+            }
+            if (c->inflight > 0) {
+                nbusy++;
+            } else if (now < end) {
+                /* poll may oversleep, so the last ms before a batch is spun */
+                timeout = MIN(timeout,
+                        (int)((c->next - now) / NSEC_PER_MSEC) - 1);
+            }
+        }
+
+        if (nactive == 0 || (now >= end && nbusy == 0)) {
+            break;
+        }
+        if (now >= end + BENCH_DRAIN_SEC * NSEC_PER_SEC) {
+            log_stderr("responses to %"PRIu64" requests did not arrive in "
+                    "time", nsent - ncomplete);
+            break;
+        }
+
+        if (poll(fds, nconn, MAX(timeout, 0)) < 0 && errno != EINTR) {
+            log_stderr("poll failed: %s", strerror(errno));
+            break;
+        }
+
+        for (i = 0; i < nconn; ++i) {
+            if (!conns[i].active) {
+                continue;
+            }
+            if (fds[i].revents & POLLOUT) {
+                _bench_write(&conns[i]);
+            }
+            if (conns[i].active && fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                _bench_read(&conns[i]);
+            }
+        }
+    }
+
+    _bench_report(_now_ns() - begin);
+}
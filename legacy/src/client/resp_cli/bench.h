@@ -0,0 +1,17 @@
+#pragma once
+
+/* The bench mode opens bench_nconn connections and keeps sending the command
+ * template on each of them in batches of bench_pipeline requests, one batch
+ * in flight per connection, at bench_rate requests per second in total. The
+ * latency of a request is measured from when its batch was due rather than
+ * when it was sent, so a server falling behind the rate is not hidden by the
+ * client waiting on it. Throughput and latency percentiles are printed at the
+ * end of the run.
+ */
+
+#include "setting.h"
+
+void bench_run(void);
+
+void bench_setup(respcli_options_st *options);
+void bench_teardown(void);
@@ -1,5 +1,6 @@
 #include "setting.h"
 
+#include "bench.h"
 #include "cli.h"
 #include "util/util.h"
 
@@ -15,6 +16,7 @@ show_usage(void)
     log_stdout(
             "Usage:" CRLF
             "  pelikan_resp-cli [option|config]" CRLF
+            "  pelikan_resp-cli -b config" CRLF
             );
     log_stdout(
             "Description:" CRLF
@@ -27,18 +29,26 @@ show_usage(void)
             "  -h, --help        show this message" CRLF
             "  -v, --version     show version number" CRLF
             "  -c, --config      list & describe all options in config" CRLF
+            "  -b, --bench       benchmark the server with the bench_* options" CRLF
             );
     log_stdout(
             "Example:" CRLF
-            "  pelikan_resp-cli resp-cli.conf" CRLF CRLF
+            "  pelikan_resp-cli resp-cli.conf" CRLF
+            "  pelikan_resp-cli -b resp-cli.conf" CRLF CRLF
             "Sample config files can be found under the config dir." CRLF
             );
 }
 
+static bool bench = false;
+
 static void
 teardown(void)
 {
-    cli_teardown();
+    if (bench) {
+        bench_teardown();
+    } else {
+        cli_teardown();
+    }
 
     compose_teardown();
     parse_teardown();
@@ -80,7 +90,11 @@ setup(void)
     parse_setup(NULL, NULL);
     compose_setup(NULL, NULL);
 
-    cli_setup(&setting.respcli);
+    if (bench) {
+        bench_setup(&setting.respcli);
+    } else {
+        cli_setup(&setting.respcli);
+    }
 
     return;
 }
@@ -91,11 +105,18 @@ main(int argc, char **argv)
     rstatus_i status = CC_OK;;
     FILE *fp = NULL;
 
-    if (argc > 2) {
+    if (argc > 3 || (argc == 3 && strcmp(argv[1], "-b") != 0 &&
+                strcmp(argv[1], "--bench") != 0)) {
         show_usage();
         exit(EX_USAGE);
     }
 
+    if (argc == 3) {
+        bench = true;
+        argv++;
+        argc--;
+    }
+
     if (argc > 1) {
         /* argc == 2 */
         if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
@@ -137,7 +158,11 @@ main(int argc, char **argv)
 
     setup();
 
-    cli_run();
+    if (bench) {
+        bench_run();
+    } else {
+        cli_run();
+    }
 
     exit(EX_OK);
 }
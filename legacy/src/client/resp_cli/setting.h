@@ -12,10 +12,31 @@
 #include <channel/cc_tcp.h>
 #include <stream/cc_sockio.h>
 
-/*          name            type                default description */
-#define RESPCLI_OPTION(ACTION)                                                            \
-    ACTION( server_host,    OPTION_TYPE_STR,    NULL,           "server, NULL is loopback" )\
-    ACTION( data_port,      OPTION_TYPE_STR,    SERVER_PORT,    "data plane server port"   )
+/* the bench mode sends the command in batches of bench_pipeline requests on
+ * every connection, where the words __key__, __val__ and __num__ are replaced
+ * by a random key, a value of bench_vlen bytes and a random number, e.g.
+ *   "set __key__ __val__", "SArray.insert __key__ __num__",
+ *   "zadd __key__ __num__ __val__" or "List.push __key__ __val__"
+ */
+#define BENCH_NCONN     1
+#define BENCH_PIPELINE  1
+#define BENCH_RATE      0
+#define BENCH_DURATION  10
+#define BENCH_NKEY      1000
+#define BENCH_VLEN      32
+#define BENCH_COMMAND   "get __key__"
+
+/*          name            type                default             description */
+#define RESPCLI_OPTION(ACTION)                                                                          \
+    ACTION( server_host,    OPTION_TYPE_STR,    NULL,               "server, NULL is loopback"      )\
+    ACTION( data_port,      OPTION_TYPE_STR,    SERVER_PORT,        "data plane server port"        )\
+    ACTION( bench_nconn,    OPTION_TYPE_UINT,   BENCH_NCONN,        "bench: # connections"          )\
+    ACTION( bench_pipeline, OPTION_TYPE_UINT,   BENCH_PIPELINE,     "bench: # requests per batch"   )\
+    ACTION( bench_rate,     OPTION_TYPE_UINT,   BENCH_RATE,         "bench: requests/sec, 0 is max" )\
+    ACTION( bench_duration, OPTION_TYPE_UINT,   BENCH_DURATION,     "bench: duration in seconds"    )\
+    ACTION( bench_nkey,     OPTION_TYPE_UINT,   BENCH_NKEY,         "bench: # distinct keys"        )\
+    ACTION( bench_vlen,     OPTION_TYPE_UINT,   BENCH_VLEN,         "bench: value length"           )\
+    ACTION( bench_command,  OPTION_TYPE_STR,    BENCH_COMMAND,      "bench: command template"       )
 
 typedef struct {
     RESPCLI_OPTION(OPTION_DECLARE)
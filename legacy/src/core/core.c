@@ -17,6 +17,7 @@ void
 core_run(void *arg_worker)
 {
     pthread_t worker, server;
+    uint32_t i;
     int ret;
 
     if (!admin_init || !server_init || !worker_init) {
@@ -24,10 +25,13 @@ core_run(void *arg_worker)
         return;
     }
 
-    ret = pthread_create(&worker, NULL, core_worker_evloop, arg_worker);
-    if (ret != 0) {
-        log_crit("pthread create failed for worker thread: %s", strerror(ret));
-        goto error;
+    for (i = 0; i < nworker; ++i) {
+        ret = pthread_create(&worker, NULL, core_worker_evloop, arg_worker);
+        if (ret != 0) {
+            log_crit("pthread create failed for worker thread: %s",
+                    strerror(ret));
+            goto error;
+        }
     }
 
     ret = pthread_create(&server, NULL, core_server_evloop, NULL);
@@ -17,23 +17,11 @@
 #include <string.h>
 #include <sysexits.h>
 
-#ifdef USE_EVENT_FD
-#include <sys/eventfd.h>
-#endif
-
 #define SERVER_MODULE_NAME "core::server"
 
-#ifdef USE_EVENT_FD
-int efd_server_to_worker = -1;       /* server(w) -> worker(r) */
-int efd_worker_to_server = -1;       /* worker(w) -> server(r) */
-#else
-struct pipe_conn *pipe_new = NULL;   /* server(w) -> worker(r) */
-struct pipe_conn *pipe_term = NULL;  /* worker(w) -> server(r) */
-#endif
-struct ring_array *conn_new = NULL;  /* server(w) -> worker(r) */
-struct ring_array *conn_term = NULL; /* worker(w) -> server(r) */
-
 static server_metrics_st *server_metrics = NULL;
+static uint32_t dispatch = SERVER_DISPATCH;
+static uint32_t next_worker; /* for round-robin dispatch */
 
 static struct context context;
 static struct context *ctx = &context;
@@ -44,6 +32,8 @@ static channel_handler_st *hdl = &handlers;
 static struct addrinfo *server_ai;
 static struct buf_sock *server_sock; /* server buf_sock */
 
+struct addrinfo *reuseport_ai = NULL;
+
 /* Note: server thread currently owns the stream (buf_sock) pool. Other threads
  * either need to get the connection from server (the case for worker thread) or
  * have to directly create their own, instead of borrowing (the case for admin
@@ -63,81 +53,97 @@ _server_close(struct buf_sock *s)
 }
 
 static inline void
-_server_write_notification(void)
+_server_write_notification(struct worker_queue *q)
 {
 #ifdef USE_EVENT_FD
-    ASSERT(efd_server_to_worker != -1);
+    ASSERT(q->efd_server_to_worker != -1);
 
     uint64_t u = 1;
-    ssize_t status = write(efd_server_to_worker, &u, sizeof(uint64_t));
+    ssize_t status = write(q->efd_server_to_worker, &u, sizeof(uint64_t));
 
     if (status == CC_EAGAIN) {
         /* retry write */
         log_verb("server core: retry write to eventfd");
-        event_add_write(ctx->evb, efd_server_to_worker, NULL);
+        event_add_write(ctx->evb, q->efd_server_to_worker, q);
     } else if (status == CC_ERROR) {
         log_error("could not write to eventfd - %d", status);
     }
 #else
-    ASSERT(pipe_new != NULL);
+    ASSERT(q->pipe_new != NULL);
 
-    ssize_t status = pipe_send(pipe_new, "", 1);
+    ssize_t status = pipe_send(q->pipe_new, "", 1);
 
     if (status == 0 || status == CC_EAGAIN) {
         /* retry write */
         log_verb("server core: retry send on pipe");
-        event_add_write(ctx->evb, pipe_write_id(pipe_new), NULL);
+        event_add_write(ctx->evb, pipe_write_id(q->pipe_new), q);
     } else if (status == CC_ERROR) {
-        log_error("could not write to pipe - %s", strerror(pipe_new->err));
+        log_error("could not write to pipe - %s", strerror(q->pipe_new->err));
     }
 #endif
 }
 
-/* pipe_read recycles returned streams from worker thread */
-static inline void
-_server_read_notification(void)
+/* pipe_read recycles returned streams from a worker thread */
+static void
+_server_read_notification(struct worker_queue *q)
 {
+    struct buf_sock *s[QUEUE_BATCH];
+    uint32_t i, n;
+
 #ifdef USE_EVENT_FD
-    ASSERT(efd_worker_to_server != -1);
+    ASSERT(q->efd_worker_to_server != -1);
+
+    uint64_t u;
 
-    uint64_t i;
+    if (read(q->efd_worker_to_server, &u, sizeof(uint64_t)) < 0 &&
+            errno != EAGAIN) {
+        log_warn("could not read from eventfd: %s", strerror(errno));
+    }
 #else
-    ASSERT(pipe_term != NULL);
+    ASSERT(q->pipe_term != NULL);
 
     char buf[RING_ARRAY_DEFAULT_CAP]; /* buffer for discarding pipe data */
-    int i;
-#endif
-
-    struct buf_sock *s;
-    rstatus_i status;
 
-#ifdef USE_EVENT_FD
-    int rc = read(efd_worker_to_server, &i, sizeof(uint64_t));
-    if (rc < 0) {
-        log_warn("not adding new connections due to eventfd error");
-        return;
-    }
-#else
-    i = pipe_recv(pipe_term, buf, RING_ARRAY_DEFAULT_CAP);
-    if (i < 0) { /* errors, do not read from ring array */
-        log_warn("not reclaiming connections due to pipe error");
-        return;
+    if (pipe_recv(q->pipe_term, buf, RING_ARRAY_DEFAULT_CAP) < 0) {
+        log_warn("could not read from pipe: %s", strerror(q->pipe_term->err));
     }
 #endif
 
-    /* each byte in the pipe corresponds to a connection in the array */
-    for (; i > 0; --i) {
-        status = ring_array_pop(&s, conn_term);
-        if (status != CC_OK) {
-            log_warn("event number does not match conn queue: missing %d conns",
-                    i);
-            return;
+    /* see _worker_read_notification on draining the array */
+    do {
+        while ((n = ring_array_pop_batch(s, QUEUE_BATCH, q->conn_term)) > 0) {
+            q->nconn -= n;
+            for (i = 0; i < n; ++i) {
+                log_verb("Recycling buf_sock %p from worker thread", s[i]);
+                hdl->term(s[i]->ch);
+                buf_sock_reset(s[i]);
+                buf_sock_return(&s[i]);
+            }
         }
-        log_verb("Recycling buf_sock %p from worker thread", s);
-        hdl->term(s->ch);
-        buf_sock_reset(s);
-        buf_sock_return(&s);
+    } while (!ring_array_sleep(q->conn_term));
+}
+
+/* the worker thread to hand the next accepted connection to */
+static inline struct worker_queue *
+_server_pick_worker(void)
+{
+    struct worker_queue *q;
+    uint32_t i;
+
+    if (dispatch == SERVER_DISPATCH_LEAST) {
+        for (q = &worker_queue[0], i = 1; i < nworker; ++i) {
+            if (worker_queue[i].nconn < q->nconn) {
+                q = &worker_queue[i];
+            }
+        }
+
+        return q;
     }
+
+    q = &worker_queue[next_worker];
+    next_worker = (next_worker + 1) % nworker;
+
+    return q;
 }
 
 /* returns true if a connection is present, false if no more pending */
@@ -146,6 +152,7 @@ _tcp_accept(struct buf_sock *ss)
 {
     struct buf_sock *s;
     struct tcp_conn *sc = ss->ch;
+    struct worker_queue *q;
 
     s = buf_sock_borrow();
     if (s == NULL) {
@@ -196,15 +203,22 @@ _tcp_accept(struct buf_sock *ss)
     }
 
     /* push buf_sock to queue */
-    if (ring_array_push(&s, conn_new) != CC_OK) { /* close if can't enqueue */
+    q = _server_pick_worker();
+    if (ring_array_push(&s, q->conn_new) != CC_OK) { /* close if can't enqueue */
         log_error("new connection queue is full, closing connection");
+        hdl->term(s->ch);
         buf_sock_reset(s);
         buf_sock_return(&s);
         return false;
     }
+    q->nconn++;
 
-    /* notify worker, note this may fail and will be retried via write event */
-    _server_write_notification();
+    /* notify worker if it may be sleeping, note this may fail and will be
+     * retried via write event
+     */
+    if (ring_array_wakeup(q->conn_new)) {
+        _server_write_notification(q);
+    }
 
     return true;
 }
@@ -225,16 +239,18 @@ _server_event(void *arg, uint32_t events)
     struct buf_sock *s = arg;
     log_verb("server event %06"PRIX32" with data %p", events, s);
 
-    if (s == NULL) { /* event on pipe */
+    if (s != server_sock) { /* event on the pipe of a worker */
+        struct worker_queue *q = arg;
+
         if (events & EVENT_READ) { /* terminating connection from worker */
             log_verb("processing server read event on pipe");
             INCR(server_metrics, server_event_read);
-            _server_read_notification();
+            _server_read_notification(q);
         }
         if (events & EVENT_WRITE) { /* retrying worker notification */
             log_verb("processing server write event on pipe");
             INCR(server_metrics, server_event_write);
-            _server_write_notification();
+            _server_write_notification(q);
         }
         if (events & EVENT_ERR) {
             log_debug("processing server error event on pipe");
@@ -262,6 +278,7 @@ core_server_setup(server_options_st *options, server_metrics_st *metrics)
     char *port = SERVER_PORT;
     int timeout = SERVER_TIMEOUT;
     int nevent = SERVER_NEVENT;
+    bool reuseport = SERVER_REUSEPORT;
 
     log_info("set up the %s module", SERVER_MODULE_NAME);
 
@@ -277,56 +294,12 @@ core_server_setup(server_options_st *options, server_metrics_st *metrics)
         port = option_str(&options->server_port);
         timeout = option_uint(&options->server_timeout);
         nevent = option_uint(&options->server_nevent);
+        dispatch = option_uint(&options->server_dispatch);
+        reuseport = option_bool(&options->server_reuseport);
     }
 
-    /* setup shared data structures between server and worker */
-#ifdef USE_EVENT_FD
-    efd_server_to_worker = eventfd(0 /* intval */, EFD_CLOEXEC | EFD_NONBLOCK);
-    if (efd_server_to_worker < 0) {
-        int err = errno;
-        log_error("Could not create event fd %s, abort", strerror(err));
-        goto error;
-    }
-    efd_worker_to_server = eventfd(0 /* intval */, EFD_CLOEXEC | EFD_NONBLOCK);
-    if (efd_worker_to_server < 0) {
-        int err = errno;
-        log_error("Could not create event fd %s, abort", strerror(err));
-        goto error;
-    }
-#else
-    pipe_new = pipe_conn_create();
-    if (pipe_new == NULL) {
-        log_error("Could not create connection for pipe, abort");
-        goto error;
-    }
-    pipe_term = pipe_conn_create();
-    if (pipe_term == NULL) {
-        log_error("Could not create connection for pipe, abort");
-        goto error;
-    }
-
-    if (!pipe_open(NULL, pipe_new)) {
-        log_error("Could not open pipe for new connection: %s",
-                strerror(pipe_new->err));
-        goto error;
-    }
-    if (!pipe_open(NULL, pipe_term)) {
-        log_error("Could not open pipe for terminated connection: %s",
-                strerror(pipe_term->err));
-        goto error;
-    }
-
-    /* event_fd is set to nonblocking during creation */
-    pipe_set_nonblocking(pipe_new);
-    pipe_set_nonblocking(pipe_term);
-#endif
-
-    conn_new = ring_array_create(sizeof(struct buf_sock *),
-            RING_ARRAY_DEFAULT_CAP);
-    conn_term = ring_array_create(sizeof(struct buf_sock *),
-            RING_ARRAY_DEFAULT_CAP);
-    if (conn_new == NULL || conn_term == NULL) {
-        log_error("core setup failed: could not allocate conn array(s)");
+    if (dispatch >= SERVER_DISPATCH_SENTINEL) {
+        log_crit("invalid server dispatch policy %"PRIu32, dispatch);
         goto error;
     }
 
@@ -346,6 +319,19 @@ core_server_setup(server_options_st *options, server_metrics_st *metrics)
     hdl->rid = (channel_id_fn)tcp_read_id;
     hdl->wid = (channel_id_fn)tcp_write_id;
 
+    if (CC_OK != getaddr(&server_ai, host, port)) {
+        log_crit("failed to resolve address for server host & port");
+        goto error;
+    }
+
+    if (reuseport) {
+        /* workers listen on sockets of their own, set up by worker setup */
+        reuseport_ai = server_ai;
+        server_init = true;
+
+        return;
+    }
+
     /**
      * Here we give server socket a buf_sock purely because it is difficult to
      * write code in the core event loop that would accommodate different types
@@ -361,11 +347,6 @@ core_server_setup(server_options_st *options, server_metrics_st *metrics)
     }
 
     server_sock->hdl = hdl;
-    if (CC_OK != getaddr(&server_ai, host, port)) {
-        log_crit("failed to resolve address for admin host & port");
-        goto error;
-    }
-
     c = server_sock->ch;
     if (!hdl->open(server_ai, c)) {
         log_crit("server connection setup failed");
@@ -374,11 +355,6 @@ core_server_setup(server_options_st *options, server_metrics_st *metrics)
     c->level = CHANNEL_META;
 
     event_add_read(ctx->evb, hdl->rid(c), server_sock);
-#ifdef USE_EVENT_FD
-    event_add_read(ctx->evb, efd_worker_to_server, NULL);
-#else
-    event_add_read(ctx->evb, pipe_read_id(pipe_term), NULL);
-#endif
 
     server_init = true;
 
@@ -400,15 +376,7 @@ core_server_teardown(void)
         freeaddrinfo(server_ai);
         buf_sock_return(&server_sock);
     }
-    ring_array_destroy(&conn_term);
-    ring_array_destroy(&conn_new);
-#ifdef USE_EVENT_FD
-    close(efd_server_to_worker);
-    close(efd_worker_to_server);
-#else
-    pipe_conn_destroy(&pipe_new);
-    pipe_conn_destroy(&pipe_term);
-#endif
+    reuseport_ai = NULL;
     server_metrics = NULL;
     server_init = false;
 }
@@ -432,6 +400,19 @@ _server_evwait(void)
 void *
 core_server_evloop(void *arg)
 {
+    uint32_t i;
+
+    /* the worker queues are created by the worker setup, after server setup */
+    for (i = 0; i < nworker; ++i) {
+#ifdef USE_EVENT_FD
+        event_add_read(ctx->evb, worker_queue[i].efd_worker_to_server,
+                &worker_queue[i]);
+#else
+        event_add_read(ctx->evb, pipe_read_id(worker_queue[i].pipe_term),
+                &worker_queue[i]);
+#endif
+    }
+
     for(;;) {
         if (_server_evwait() != CC_OK) {
             log_crit("server core event loop exited due to failure");
@@ -9,12 +9,21 @@
 #define SERVER_TIMEOUT  100     /* in ms */
 #define SERVER_NEVENT   1024
 
-/*          name            type                default         description */
-#define SERVER_OPTION(ACTION)                                                                   \
-    ACTION( server_host,    OPTION_TYPE_STR,    SERVER_HOST,    "interfaces listening on"      )\
-    ACTION( server_port,    OPTION_TYPE_STR,    SERVER_PORT,    "port listening on"            )\
-    ACTION( server_timeout, OPTION_TYPE_UINT,   SERVER_TIMEOUT, "evwait timeout"               )\
-    ACTION( server_nevent,  OPTION_TYPE_UINT,   SERVER_NEVENT,  "evwait max nevent returned"   )
+/* how accepted connections are spread across worker threads */
+#define SERVER_DISPATCH_RR          0   /* round-robin */
+#define SERVER_DISPATCH_LEAST       1   /* the worker with fewest connections */
+#define SERVER_DISPATCH_SENTINEL    2
+#define SERVER_DISPATCH SERVER_DISPATCH_RR
+#define SERVER_REUSEPORT false
+
+/*          name                type                default             description */
+#define SERVER_OPTION(ACTION)                                                                           \
+    ACTION( server_host,        OPTION_TYPE_STR,    SERVER_HOST,        "interfaces listening on"      )\
+    ACTION( server_port,        OPTION_TYPE_STR,    SERVER_PORT,        "port listening on"            )\
+    ACTION( server_timeout,     OPTION_TYPE_UINT,   SERVER_TIMEOUT,     "evwait timeout"               )\
+    ACTION( server_nevent,      OPTION_TYPE_UINT,   SERVER_NEVENT,      "evwait max nevent returned"   )\
+    ACTION( server_dispatch,    OPTION_TYPE_UINT,   SERVER_DISPATCH,    "0: round-robin, 1: least conn")\
+    ACTION( server_reuseport,   OPTION_TYPE_BOOL,   SERVER_REUSEPORT,   "workers listen w/ SO_REUSEPORT")
 
 typedef struct {
     SERVER_OPTION(OPTION_DECLARE)
@@ -1,17 +1,44 @@
 #pragma once
 
+#include <stdint.h>
+
+struct addrinfo;
 struct pipe_conn;
 struct ring_array;
 
-/* pipe for server/worker thread communication */
+#define QUEUE_BATCH 64 /* # connections taken off a ring array at a time */
+
+/*
+ * Each worker thread has its own queues with the server thread: the server
+ * pushes accepted connections onto conn_new of a worker and notifies it, the
+ * worker pushes connections to be closed onto conn_term and notifies the
+ * server back. Notifications are only sent when the other side may be
+ * sleeping, i.e. after it took everything off the ring array last time, so a
+ * run of connections costs one notification rather than one each.
+ */
+struct worker_queue {
+    /* pipe for server/worker thread communication */
 #ifdef USE_EVENT_FD
-extern int efd_server_to_worker;
-extern int efd_worker_to_server;
+    int                 efd_server_to_worker;
+    int                 efd_worker_to_server;
 #else
-extern struct pipe_conn *pipe_new;
-extern struct pipe_conn *pipe_term;
+    struct pipe_conn    *pipe_new;
+    struct pipe_conn    *pipe_term;
 #endif
 
-/* array holding accepted connections */
-extern struct ring_array *conn_new;
-extern struct ring_array *conn_term;
+    /* array holding accepted connections */
+    struct ring_array   *conn_new;
+    struct ring_array   *conn_term;
+
+    /* # connections given to the worker and not yet returned, server only */
+    uint32_t            nconn;
+};
+
+extern struct worker_queue *worker_queue; /* one per worker thread */
+extern uint32_t nworker;
+
+/*
+ * The address each worker thread listens on with SO_REUSEPORT to accept
+ * connections itself, or NULL if the server thread accepts them
+ */
+extern struct addrinfo *reuseport_ai;
@@ -9,12 +9,14 @@
 #include <buffer/cc_dbuf.h>
 #include <cc_debug.h>
 #include <cc_event.h>
+#include <cc_mm.h>
 #include <cc_ring_array.h>
 #include <channel/cc_channel.h>
 #include <channel/cc_pipe.h>
 #include <channel/cc_tcp.h>
 
 #include <stream/cc_sockio.h>
+#include <time/cc_wheel.h>
 
 #include <sched.h>
 #include <pthread.h>
@@ -23,13 +25,40 @@
 #include <stdlib.h>
 #include <sysexits.h>
 
+#ifdef USE_EVENT_FD
+#include <sys/eventfd.h>
+#endif
+
 #define WORKER_MODULE_NAME "core::worker"
 
+/* connection timeouts are kept in wheels of a tick each worker_timeout, with
+ * enough levels to cover any timeout the options allow even at 1ms ticks
+ */
+#define WHEEL_NSLOT  64
+#define WHEEL_NLEVEL 6
+
 worker_metrics_st *worker_metrics = NULL;
 worker_options_st *worker_options = NULL;
-
-static struct context context;
-static struct context *ctx = &context;
+perworker_metrics_st *perworker = NULL;
+
+struct worker_queue *worker_queue = NULL;
+uint32_t nworker = WORKER_NTHREAD;
+
+static struct context *contexts;
+static struct buf_sock **listeners; /* with reuseport_ai only */
+static uint32_t nstarted; /* # worker threads started */
+static bool edge; /* connection events are edge-triggered */
+static uint32_t busy_poll; /* in us, 0 if not busy polling */
+static struct timing_wheel **wheels; /* with connection timeouts only */
+static uint32_t idle_timeout; /* in ms, 0 if never */
+static uint32_t write_timeout; /* in ms, 0 if never */
+
+/* each worker thread runs with its own context, queue and metrics */
+static __thread struct context *ctx;
+static __thread struct worker_queue *queue;
+static __thread struct buf_sock *listener;
+static __thread struct timing_wheel *wheel;
+static __thread perworker_metrics_st *local_metrics;
 
 static channel_handler_st handlers;
 static channel_handler_st *hdl = &handlers;
@@ -50,13 +79,16 @@ _worker_event_write(struct buf_sock *s)
 
     log_verb("writing on buf_sock %p", s);
     status = buf_tcp_write(s);
-    if (status == CC_ERETRY || status == CC_EAGAIN) { /* retry write */
+    if ((status == CC_ERETRY || status == CC_EAGAIN) && !edge) { /* retry write */
         /* by removing current masks and only listen to write event(s), we are
          * effectively stopping processing incoming data until we can write
          * something to the (kernel) buffer for the channel. This is sensible
          * because either the local network or the client is backed up when
          * kernel write buffer is full, and this allows us to propagate back
          * pressure to the sending side.
+         *
+         * With edge-triggered events both are registered all along, and the
+         * same is achieved by not reading until the write backlog is cleared.
          */
 
         event_del(ctx->evb, hdl->wid(c));
@@ -80,73 +112,174 @@ _worker_event_read(struct buf_sock *s)
 {
     ASSERT(s != NULL);
 
-    log_verb("reading on buf_sock %p", s);
-    /* TODO(kyang): consider refactoring dbuf_tcp_read and buf_tcp_read to have no return status
-       at all, since the return status is already given by the connection state */
-    buf_tcp_read(s);
-    if (processor->read(&s->rbuf, &s->wbuf, &s->data) < 0) {
-        log_debug("handler signals channel termination");
-        s->ch->state = CHANNEL_TERM;
+    rstatus_i status;
+
+    /* edge-triggered events don't return again for data that is left, so we
+     * keep reading as long as the last read filled up the buffer, unless the
+     * write side gets backed up, when we resume after the backlog is cleared
+     */
+    s->active = time_proc_ms();
+    do {
+        log_verb("reading on buf_sock %p", s);
+        /* TODO(kyang): consider refactoring dbuf_tcp_read and buf_tcp_read to have no return status
+           at all, since the return status is already given by the connection state */
+        status = buf_tcp_read(s);
+        if (processor->read(&s->rbuf, &s->wbuf, &s->data) < 0) {
+            log_debug("handler signals channel termination");
+            s->ch->state = CHANNEL_TERM;
+            return;
+        }
+        if (buf_chain_rsize(s->wbuf) > 0) {
+            log_verb("attempt to write");
+            _worker_event_write(s);
+        }
+    } while (edge && s->ch->state == CHANNEL_ESTABLISHED &&
+            buf_chain_rsize(s->wbuf) == 0 && (status == CC_ERETRY ||
+            (status == CC_ENOMEM && buf_wsize(s->rbuf) > 0)));
+}
+
+static void worker_ret_stream(struct buf_sock *s);
+static void _worker_timeout(void *arg);
+
+/*
+ * Each connection has at most one timeout event, due when the connection
+ * would have been idle for idle_timeout, or, with a write backlog, when it
+ * would have been waiting for the backlog to clear for write_timeout. The
+ * event is not moved with every request, which only records when the
+ * connection was last active; instead, once due, the event checks how long
+ * the connection has really been waiting, and is inserted again if not long
+ * enough, so the wheel is touched about once per timeout per connection.
+ */
+static void
+_worker_timeout_insert(struct buf_sock *s, proc_time_fine_i due)
+{
+    struct timeout delay;
+    proc_time_fine_i now = time_proc_ms();
+
+    timeout_set_ms(&delay, due > now ? due - now : 0);
+    s->tev = timing_wheel_insert(wheel, &delay, false, _worker_timeout, s);
+    if (s->tev == NULL) {
+        log_warn("no timeout for buf_sock %p: cannot insert timeout event", s);
+    }
+}
+
+static void
+_worker_timeout(void *arg)
+{
+    struct buf_sock *s = arg;
+    bool backlog = buf_chain_rsize(s->wbuf) > 0;
+    uint32_t limit = backlog ? write_timeout : idle_timeout;
+
+    s->tev = NULL; /* the wheel returns the event once fired */
+
+    if (limit == 0) { /* no limit in the current state, check again later */
+        _worker_timeout_insert(s, time_proc_ms() + idle_timeout +
+                write_timeout);
         return;
     }
-    if (buf_rsize(s->wbuf) > 0) {
-        log_verb("attempt to write");
-        _worker_event_write(s);
+    if (time_proc_ms() < s->active + limit) {
+        _worker_timeout_insert(s, s->active + limit);
+        return;
+    }
+
+    if (backlog) {
+        log_info("closing buf_sock %p, write backlog stuck for %"PRIu32"ms",
+                s, limit);
+        INCR(worker_metrics, worker_write_close);
+    } else {
+        log_info("closing buf_sock %p, idle for %"PRIu32"ms", s, limit);
+        INCR(worker_metrics, worker_idle_close);
+    }
+    s->ch->state = CHANNEL_TERM;
+    worker_ret_stream(s);
+}
+
+static void
+_worker_add_stream(struct buf_sock *s)
+{
+    INCR(worker_metrics, worker_add_stream);
+    INCR(local_metrics, conn_curr);
+    log_verb("Adding new buf_sock %p to worker thread", s);
+    s->owner = ctx;
+    s->hdl = hdl;
+    s->active = time_proc_ms();
+    if (wheel != NULL) {
+        _worker_timeout_insert(s, s->active + (idle_timeout > 0 ?
+                idle_timeout : write_timeout));
+    }
+    if (busy_poll > 0 && tcp_set_busy_poll(s->ch->sd, busy_poll) < 0) {
+        log_debug("set busy poll on buf_sock %p failed, ignored: %s", s,
+                strerror(errno));
+    }
+    if (edge) {
+        event_add_edge(ctx->evb, hdl->rid(s->ch), s); /* event activated */
+    } else {
+        event_add_read(ctx->evb, hdl->rid(s->ch), s); /* event activated */
     }
 }
 
 static void
 _worker_read_notification(void)
 {
-    struct buf_sock *s;
+    struct buf_sock *s[QUEUE_BATCH];
+    uint32_t i, n;
 
 #ifdef USE_EVENT_FD
-    uint64_t i;
+    uint64_t u;
 #else
     char buf[RING_ARRAY_DEFAULT_CAP]; /* buffer for discarding pipe data */
-    int i;
 #endif
 
-    rstatus_i status;
-
-    /* server pushes connection on to the ring array before writing to the pipe,
-     * therefore, we should read from the pipe first and take the connections
-     * off the ring array to match the number of bytes received.
-     *
-     * Once we move server to its own thread, it is possible that there are more
-     * connections added to the queue when we are processing, it is OK to wait
-     * for the next read event in that case.
+    /* server pushes connections on to the ring array before notifying, and
+     * only notifies when we may be sleeping, so the notification itself only
+     * needs to be cleared, after which we take every connection off the ring
+     * array before flagging ourselves sleeping again.
      */
 #ifdef USE_EVENT_FD
-    int rc = read(efd_server_to_worker, &i, sizeof(uint64_t));
-    if (rc < 0) {
-        log_warn("not adding new connections due to eventfd error");
-        return;
+    if (read(queue->efd_server_to_worker, &u, sizeof(uint64_t)) < 0 &&
+            errno != EAGAIN) {
+        log_warn("could not read from eventfd: %s", strerror(errno));
     }
 #else
-    i = pipe_recv(pipe_new, buf, RING_ARRAY_DEFAULT_CAP);
-    if (i < 0) { /* errors, do not read from ring array */
-        log_warn("not adding new connections due to pipe error");
-        return;
+    if (pipe_recv(queue->pipe_new, buf, RING_ARRAY_DEFAULT_CAP) < 0) {
+        log_warn("could not read from pipe: %s",
+                strerror(queue->pipe_new->err));
     }
 #endif
 
-    /* each byte in the pipe corresponds to a new connection, which we will
-     * now get from the ring array
-     */
-    for (; i > 0; --i) {
-        status = ring_array_pop(&s, conn_new);
-        if (status != CC_OK) {
-            log_warn("event number does not match conn queue: missing %d conns",
-                    i);
-            return;
+    do {
+        while ((n = ring_array_pop_batch(s, QUEUE_BATCH, queue->conn_new)) > 0) {
+            for (i = 0; i < n; ++i) {
+                _worker_add_stream(s[i]);
+            }
         }
-        INCR(worker_metrics, worker_add_stream);
-        log_verb("Adding new buf_sock %p to worker thread", s);
-        s->owner = ctx;
-        s->hdl = hdl;
-        event_add_read(ctx->evb, hdl->rid(s->ch), s); /* event activated */
+    } while (!ring_array_sleep(queue->conn_new));
+}
+
+/* returns true if a connection is present, false if no more pending */
+static inline bool
+_worker_accept(struct buf_sock *ss)
+{
+    struct buf_sock *s;
+
+    s = buf_sock_borrow();
+    if (s == NULL) {
+        /* see _tcp_accept in server.c on responding to running out */
+        log_error("establish connection failed: cannot allocate buf_sock, "
+                "reject connection request");
+        ss->hdl->reject(ss->ch);
+        return false;
     }
+
+    if (!ss->hdl->accept(ss->ch, s->ch)) {
+        buf_sock_reset(s);
+        buf_sock_return(&s);
+        return false;
+    }
+
+    _worker_add_stream(s);
+
+    return true;
 }
 
 
@@ -154,29 +287,30 @@ static inline void
 _worker_write_notification(void)
 {
 #ifdef USE_EVENT_FD
-    ASSERT(efd_worker_to_server != -1);
+    ASSERT(queue->efd_worker_to_server != -1);
 
     uint64_t u = 1;
-    ssize_t status = write(efd_worker_to_server, &u, sizeof(uint64_t));
+    ssize_t status = write(queue->efd_worker_to_server, &u, sizeof(uint64_t));
 
     if (status == CC_EAGAIN) {
         /* retry write */
         log_verb("server core: retry write to eventfd");
-        event_add_write(ctx->evb, efd_server_to_worker, NULL);
+        event_add_write(ctx->evb, queue->efd_worker_to_server, NULL);
     } else if (status == CC_ERROR) {
         log_error("could not write to eventfd - %d", status);
     }
 #else
-    ASSERT(pipe_term != NULL);
+    ASSERT(queue->pipe_term != NULL);
 
-    ssize_t status = pipe_send(pipe_term, "", 1);
+    ssize_t status = pipe_send(queue->pipe_term, "", 1);
 
     if (status == 0 || status == CC_EAGAIN) {
         /* retry write */
         log_verb("server core: retry send on pipe");
-        event_add_write(ctx->evb, pipe_write_id(pipe_term), NULL);
+        event_add_write(ctx->evb, pipe_write_id(queue->pipe_term), NULL);
     } else if (status == CC_ERROR) {
-        log_error("could not write to pipe - %s", strerror(pipe_term->err));
+        log_error("could not write to pipe - %s",
+                strerror(queue->pipe_term->err));
     }
 #endif
 }
@@ -191,10 +325,21 @@ worker_ret_stream(struct buf_sock *s)
      */
     processor->error(&s->rbuf, &s->wbuf, &s->data);
     event_del(ctx->evb, hdl->rid(s->ch));
+    if (s->tev != NULL) {
+        timing_wheel_remove(wheel, &s->tev);
+    }
 
     /* push buf_sock to queue */
     INCR(worker_metrics, worker_ret_stream);
-    if (ring_array_push(&s, conn_term) != CC_OK) {
+    DECR(local_metrics, conn_curr);
+    if (listener != NULL) { /* accepted here, so closed here */
+        hdl->term(s->ch);
+        buf_sock_reset(s);
+        buf_sock_return(&s);
+
+        return;
+    }
+    if (ring_array_push(&s, queue->conn_term) != CC_OK) {
         /* here we have no choice but to clean up the stream to avoid leak */
         log_error("term connection queue is full");
         hdl->term(s->ch);
@@ -204,7 +349,9 @@ worker_ret_stream(struct buf_sock *s)
         return;
     }
     /* conn_term */
-    _worker_write_notification();
+    if (ring_array_wakeup(queue->conn_term)) {
+        _worker_write_notification();
+    }
 }
 
 static void
@@ -226,20 +373,43 @@ _worker_event(void *arg, uint32_t events)
             INCR(worker_metrics, worker_event_error);
             log_error("error event received on pipe");
         }
+    } else if (s == listener) { /* event on the listening socket */
+        if (events & EVENT_READ) {
+            INCR(worker_metrics, worker_event_read);
+            while (_worker_accept(s));
+        }
+        if (events & EVENT_ERR) {
+            INCR(worker_metrics, worker_event_error);
+            log_error("error event received on listening socket");
+        }
     } else {
         /* event on one of the connections */
 
         if (events & EVENT_READ) {
             log_verb("processing worker read event on buf_sock %p", s);
             INCR(worker_metrics, worker_event_read);
-            _worker_event_read(s);
+            if (!edge || buf_chain_rsize(s->wbuf) == 0) {
+                _worker_event_read(s);
+            }
         }
-        if (events & EVENT_WRITE) {
+        if ((events & EVENT_WRITE) && edge) {
+            /* returned whenever the socket becomes writable, which only
+             * matters if there is a backlog, after which reading resumes
+             */
+            if (buf_chain_rsize(s->wbuf) > 0) {
+                log_verb("processing worker write event on buf_sock %p", s);
+                INCR(worker_metrics, worker_event_write);
+                if (_worker_event_write(s) == CC_OK) {
+                    _worker_event_read(s);
+                }
+            }
+        } else if (events & EVENT_WRITE) {
             /* got here only when a previous write was incompleted/retried */
             log_verb("processing worker write event on buf_sock %p", s);
             INCR(worker_metrics, worker_event_write);
             if (_worker_event_write(s) == CC_OK) {
                 /* write backlog cleared up, re-add read event (only) */
+                s->active = time_proc_ms();
                 event_del(ctx->evb, hdl->wid(s->ch));
                 event_add_read(ctx->evb, hdl->rid(s->ch), s);
             }
@@ -264,11 +434,113 @@ _worker_event(void *arg, uint32_t events)
     }
 }
 
+/*
+ * Listen on a socket of the worker's own, which shares the server address
+ * with the sockets of other workers. If the worker is pinned to a core, the
+ * kernel is asked to steer connections received on that core to it.
+ */
+static void
+_worker_listen(uint32_t id, struct context *c)
+{
+    struct buf_sock *s;
+    uint32_t binding_core = WORKER_BINDING_CORE;
+
+    if (worker_options != NULL) {
+        binding_core = option_uint(&worker_options->worker_binding_core);
+    }
+
+    s = listeners[id] = buf_sock_borrow();
+    if (s == NULL) {
+        log_crit("failed to setup worker thread core; could not get buf_sock");
+        exit(EX_CONFIG);
+    }
+
+    s->hdl = hdl;
+    if (!hdl->open(reuseport_ai, s->ch)) {
+        log_crit("worker %"PRIu32" listen setup failed", id);
+        exit(EX_CONFIG);
+    }
+
+    if (binding_core != WORKER_BINDING_CORE &&
+            tcp_set_incoming_cpu(s->ch->sd, binding_core + id) < 0) {
+        log_warn("set incoming cpu of worker %"PRIu32" listener failed, "
+                "ignored: %s", id, strerror(errno));
+    }
+
+    event_add_read(c->evb, hdl->rid(s->ch), s);
+}
+
+static rstatus_i
+_worker_queue_create(struct worker_queue *q)
+{
+#ifdef USE_EVENT_FD
+    q->efd_server_to_worker = eventfd(0 /* intval */, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (q->efd_server_to_worker < 0) {
+        log_error("Could not create event fd %s, abort", strerror(errno));
+        return CC_ERROR;
+    }
+    q->efd_worker_to_server = eventfd(0 /* intval */, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (q->efd_worker_to_server < 0) {
+        log_error("Could not create event fd %s, abort", strerror(errno));
+        return CC_ERROR;
+    }
+#else
+    q->pipe_new = pipe_conn_create();
+    q->pipe_term = pipe_conn_create();
+    if (q->pipe_new == NULL || q->pipe_term == NULL) {
+        log_error("Could not create connection for pipe, abort");
+        return CC_ERROR;
+    }
+
+    if (!pipe_open(NULL, q->pipe_new)) {
+        log_error("Could not open pipe for new connection: %s",
+                strerror(q->pipe_new->err));
+        return CC_ERROR;
+    }
+    if (!pipe_open(NULL, q->pipe_term)) {
+        log_error("Could not open pipe for terminated connection: %s",
+                strerror(q->pipe_term->err));
+        return CC_ERROR;
+    }
+
+    /* event_fd is set to nonblocking during creation */
+    pipe_set_nonblocking(q->pipe_new);
+    pipe_set_nonblocking(q->pipe_term);
+#endif
+
+    q->conn_new = ring_array_create(sizeof(struct buf_sock *),
+            RING_ARRAY_DEFAULT_CAP);
+    q->conn_term = ring_array_create(sizeof(struct buf_sock *),
+            RING_ARRAY_DEFAULT_CAP);
+    if (q->conn_new == NULL || q->conn_term == NULL) {
+        log_error("core setup failed: could not allocate conn array(s)");
+        return CC_ERROR;
+    }
+    q->nconn = 0;
+
+    return CC_OK;
+}
+
+static void
+_worker_queue_destroy(struct worker_queue *q)
+{
+    ring_array_destroy(&q->conn_term);
+    ring_array_destroy(&q->conn_new);
+#ifdef USE_EVENT_FD
+    close(q->efd_server_to_worker);
+    close(q->efd_worker_to_server);
+#else
+    pipe_conn_destroy(&q->pipe_new);
+    pipe_conn_destroy(&q->pipe_term);
+#endif
+}
+
 void
 core_worker_setup(worker_options_st *options, worker_metrics_st *metrics)
 {
     int timeout = WORKER_TIMEOUT;
     int nevent = WORKER_NEVENT;
+    uint32_t i;
 
     log_info("set up the %s module", WORKER_MODULE_NAME);
 
@@ -280,46 +552,123 @@ core_worker_setup(worker_options_st *options, worker_metrics_st *metrics)
     worker_metrics = metrics;
     worker_options = options;
 
+    nworker = WORKER_NTHREAD;
+    edge = WORKER_EDGE_TRIGGER;
+    busy_poll = WORKER_BUSY_POLL;
+    idle_timeout = WORKER_IDLE_TIMEOUT;
+    write_timeout = WORKER_WRITE_TIMEOUT;
     if (options != NULL) {
         timeout = option_uint(&options->worker_timeout);
         nevent = option_uint(&options->worker_nevent);
+        nworker = option_uint(&options->worker_nthread);
+        edge = option_bool(&options->worker_edge_trigger);
+        busy_poll = option_uint(&options->worker_busy_poll);
+        idle_timeout = option_uint(&options->worker_idle_timeout);
+        write_timeout = option_uint(&options->worker_write_timeout);
     }
 
-    ctx->timeout = timeout;
-    ctx->evb = event_base_create(nevent, _worker_event);
-    if (ctx->evb == NULL) {
-        log_crit("failed to setup worker thread core; could not create event_base");
+    if (nworker == 0) {
+        log_crit("failed to setup worker thread core; need at least 1 thread");
         exit(EX_CONFIG);
     }
 
-    /* worker thread does not handle accept/reject/open/term directly */
-    hdl->accept = NULL;
-    hdl->reject = NULL;
-    hdl->open = NULL;
+    contexts = cc_zalloc(sizeof(*contexts) * nworker);
+    worker_queue = cc_zalloc(sizeof(*worker_queue) * nworker);
+    listeners = cc_zalloc(sizeof(*listeners) * nworker);
+    perworker = cc_alloc(sizeof(*perworker) * nworker);
+    wheels = cc_zalloc(sizeof(*wheels) * nworker);
+    if (contexts == NULL || worker_queue == NULL || listeners == NULL ||
+            perworker == NULL || wheels == NULL) {
+        log_crit("failed to setup worker thread core; could not allocate %"
+                PRIu32" workers", nworker);
+        exit(EX_CONFIG);
+    }
+
+    /* worker threads only accept connections when listening themselves */
+    hdl->accept = (channel_accept_fn)tcp_accept;
+    hdl->reject = (channel_reject_fn)tcp_reject_all;
+    hdl->open = (channel_open_fn)tcp_listen_reuseport;
     hdl->term = (channel_term_fn)tcp_close;
     hdl->recv = (channel_recv_fn)tcp_recv;
     hdl->send = (channel_send_fn)tcp_send;
     hdl->rid = (channel_id_fn)tcp_read_id;
     hdl->wid = (channel_id_fn)tcp_write_id;
 
+    for (i = 0; i < nworker; ++i) {
+        perworker[i] = (perworker_metrics_st){PERWORKER_METRIC(METRIC_INIT)};
+
+        if (_worker_queue_create(&worker_queue[i]) != CC_OK) {
+            log_crit("failed to setup worker thread core; could not create "
+                    "queues with server");
+            exit(EX_CONFIG);
+        }
+
+        contexts[i].timeout = timeout;
+        contexts[i].evb = event_base_create(nevent, _worker_event);
+        if (contexts[i].evb == NULL) {
+            log_crit("failed to setup worker thread core; could not create "
+                    "event_base");
+            exit(EX_CONFIG);
+        }
+        if (busy_poll > 0) {
+            event_busy_poll(contexts[i].evb, busy_poll);
+        }
 #ifdef USE_EVENT_FD
-    event_add_read(ctx->evb, efd_server_to_worker, NULL);
+        event_add_read(contexts[i].evb, worker_queue[i].efd_server_to_worker,
+                NULL);
 #else
-    event_add_read(ctx->evb, pipe_read_id(pipe_new), NULL);
+        event_add_read(contexts[i].evb,
+                pipe_read_id(worker_queue[i].pipe_new), NULL);
 #endif
 
+        if (idle_timeout > 0 || write_timeout > 0) {
+            struct timeout tick;
+
+            timeout_set_ms(&tick, timeout > 0 ? timeout : 1);
+            wheels[i] = timing_wheel_create_level(&tick, WHEEL_NSLOT,
+                    WHEEL_NLEVEL, 0);
+            if (wheels[i] == NULL) {
+                log_crit("failed to setup worker thread core; could not "
+                        "create timing wheel");
+                exit(EX_CONFIG);
+            }
+        }
+
+        if (reuseport_ai != NULL) {
+            _worker_listen(i, &contexts[i]);
+        }
+    }
+
+    nstarted = 0;
     worker_init = true;
 }
 
 void
 core_worker_teardown(void)
 {
+    uint32_t i;
+
     log_info("tear down the %s module", WORKER_MODULE_NAME);
 
     if (!worker_init) {
         log_warn("%s has never been setup", WORKER_MODULE_NAME);
     } else {
-        event_base_destroy(&(ctx->evb));
+        for (i = 0; i < nworker; ++i) {
+            event_base_destroy(&(contexts[i].evb));
+            _worker_queue_destroy(&worker_queue[i]);
+            if (listeners[i] != NULL) {
+                hdl->term(listeners[i]->ch);
+                buf_sock_return(&listeners[i]);
+            }
+            if (wheels[i] != NULL) {
+                timing_wheel_destroy(&wheels[i]);
+            }
+        }
+        cc_free(wheels);
+        cc_free(contexts);
+        cc_free(listeners);
+        cc_free(worker_queue);
+        cc_free(perworker);
     }
     worker_metrics = NULL;
     worker_init = false;
@@ -337,7 +686,12 @@ _worker_evwait(void)
 
     INCR(worker_metrics, worker_event_loop);
     INCR_N(worker_metrics, worker_event_total, n);
+    INCR(local_metrics, event_loop);
+    INCR_N(local_metrics, event_total, n);
     time_update();
+    if (wheel != NULL) {
+        timing_wheel_execute(wheel);
+    }
 
     return CC_OK;
 }
@@ -345,22 +699,38 @@ _worker_evwait(void)
 void *
 core_worker_evloop(void *arg)
 {
+    /* each thread running the loop takes the next worker */
+    uint32_t id = __atomic_fetch_add(&nstarted, 1, __ATOMIC_RELAXED);
+
+    ASSERT(id < nworker);
+
     processor = arg;
+    ctx = &contexts[id];
+    queue = &worker_queue[id];
+    listener = listeners[id];
+    local_metrics = &perworker[id];
+    wheel = wheels[id];
+    if (wheel != NULL) {
+        timing_wheel_start(wheel);
+    }
+    metric_shard_thread(id);
 
     int binding_core = option_uint(&worker_options->worker_binding_core);
 
 #ifndef __APPLE__
     if (binding_core != 0xffffffff) {
-      /* bind worker to the core */
+      /* bind worker to the core, and each next worker to the next core */
       cpu_set_t cpuset;
       pthread_t thread = pthread_self();
 
+      binding_core += id;
       CPU_ZERO(&cpuset);
       CPU_SET(binding_core, &cpuset);
 
-      if (pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset) != 0) {
+      int ret = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
+      if (ret != 0) {
           log_warn("fail to bind worker thread to core %d: %s",
-                 binding_core, strerror(errno));
+                 binding_core, strerror(ret));
       } else {
         log_info("binding worker thread to core %d", binding_core);
       }
@@ -8,12 +8,22 @@
 #define WORKER_TIMEOUT        100     /* in ms */
 #define WORKER_NEVENT         1024
 #define WORKER_BINDING_CORE   0xffffffff
+#define WORKER_NTHREAD        1
+#define WORKER_EDGE_TRIGGER   false
+#define WORKER_BUSY_POLL      0       /* in us */
+#define WORKER_IDLE_TIMEOUT   0       /* in ms, 0 if never */
+#define WORKER_WRITE_TIMEOUT  0       /* in ms, 0 if never */
 
 /*          name                  type                default               description */
 #define WORKER_OPTION(ACTION)                                                                                      \
     ACTION( worker_timeout,       OPTION_TYPE_UINT,   WORKER_TIMEOUT,       "evwait timeout"                      )\
     ACTION( worker_nevent,        OPTION_TYPE_UINT,   WORKER_NEVENT,        "evwait max nevent returned"          )\
-    ACTION( worker_binding_core,  OPTION_TYPE_UINT,   WORKER_BINDING_CORE,  "which core pin the worker thread to" )
+    ACTION( worker_binding_core,  OPTION_TYPE_UINT,   WORKER_BINDING_CORE,  "which core pin the worker thread to" )\
+    ACTION( worker_nthread,       OPTION_TYPE_UINT,   WORKER_NTHREAD,       "# worker threads"                    )\
+    ACTION( worker_edge_trigger,  OPTION_TYPE_BOOL,   WORKER_EDGE_TRIGGER,  "edge-triggered connection events"    )\
+    ACTION( worker_busy_poll,     OPTION_TYPE_UINT,   WORKER_BUSY_POLL,     "busy poll time before evwait sleeps" )\
+    ACTION( worker_idle_timeout,  OPTION_TYPE_UINT,   WORKER_IDLE_TIMEOUT,  "close conns idle for this long (ms)" )\
+    ACTION( worker_write_timeout, OPTION_TYPE_UINT,   WORKER_WRITE_TIMEOUT, "close conns w/ writes stalled (ms)"  )
 
 typedef struct {
     WORKER_OPTION(OPTION_DECLARE)
@@ -27,12 +37,29 @@ typedef struct {
     ACTION( worker_event_write,     METRIC_COUNTER, "# worker core_write events"    )\
     ACTION( worker_event_error,     METRIC_COUNTER, "# worker core_error events"    )\
     ACTION( worker_add_stream,      METRIC_COUNTER, "# worker adding a stream"      )\
-    ACTION( worker_ret_stream,      METRIC_COUNTER, "# worker returning a stream"   )
+    ACTION( worker_ret_stream,      METRIC_COUNTER, "# worker returning a stream"   )\
+    ACTION( worker_idle_close,      METRIC_COUNTER, "# conns closed for idling"     )\
+    ACTION( worker_write_close,     METRIC_COUNTER, "# conns closed w/ stuck write" )
 
 typedef struct {
     CORE_WORKER_METRIC(METRIC_DECLARE)
 } worker_metrics_st;
 
+/*          name            type            description */
+#define PERWORKER_METRIC(ACTION)                                    \
+    ACTION( conn_curr,      METRIC_GAUGE,   "# conns owned"        )\
+    ACTION( event_total,    METRIC_COUNTER, "# events returned"    )\
+    ACTION( event_loop,     METRIC_COUNTER, "# event loops"        )
+
+typedef struct {
+    PERWORKER_METRIC(METRIC_DECLARE)
+} perworker_metrics_st;
+
+/* metrics of each of the nworker worker threads, the totals are in
+ * worker_metrics_st
+ */
+extern perworker_metrics_st *perworker;
+
 /*
  * To allow the use application-specific logic in the handling of read/write
  * events, each application is expected to implement their own versions of
@@ -49,6 +76,12 @@ struct data_processor {
     data_fn error;
 };
 
+/*
+ * core_worker_setup creates the worker threads' event bases and their queues
+ * with the server thread, which core_run starts one thread each for; the
+ * processor is shared by all threads, so it has to be thread-safe when there
+ * is more than one.
+ */
 void core_worker_setup(worker_options_st *options, worker_metrics_st *metrics);
 void core_worker_teardown(void);
 void *core_worker_evloop(void *arg);
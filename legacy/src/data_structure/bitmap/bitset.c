@@ -5,7 +5,7 @@
 
 
 #define DATA_POS(_bs) ((uint8_t *)(_bs) + offsetof(struct bitset, data))
-#define SEGMENT_OFFSET(_col) ((uint8_t)(_col) >> 5) /* uint32_t, 2^5 bits per segment */
+#define SEGMENT_OFFSET(_col) ((uint16_t)(_col) >> 5) /* uint32_t, 2^5 bits per segment */
 #define BIT_OFFSET(_col) ((uint8_t)(_col) & 0x1f)
 #define GET_SEGMENT(_bs, _col)  \
         ((uint32_t *)DATA_POS(_bs) + SEGMENT_OFFSET(_col))
@@ -45,3 +45,58 @@ bitset_set(struct bitset *bs, uint16_t col, uint8_t val)
     /* set column */
     *d |= (uint32_t)val << offset;
 }
+
+/* the segment loops below are simple enough for compilers to vectorize, and
+ * __builtin_popcount becomes a single instruction where the target has one
+ */
+uint16_t
+bitset_count(struct bitset *bs, uint16_t start, uint16_t end)
+{
+    uint32_t *d = (uint32_t *)DATA_POS(bs);
+    uint16_t first = SEGMENT_OFFSET(start), last = SEGMENT_OFFSET(end);
+    uint32_t head = ~0U << BIT_OFFSET(start); /* columns from start on */
+    uint32_t tail = (1U << BIT_OFFSET(end)) - 1; /* columns before end */
+    uint16_t i, count = 0;
+
+    if (start >= end) {
+        return 0;
+    }
+
+    if (first == last) {
+        return __builtin_popcount(d[first] & head & tail);
+    }
+
+    count += __builtin_popcount(d[first] & head);
+    for (i = first + 1; i < last; i++) {
+        count += __builtin_popcount(d[i]);
+    }
+    if (tail != 0) { /* end may be right past the last segment */
+        count += __builtin_popcount(d[last] & tail);
+    }
+
+    return count;
+}
+
+void
+bitset_and(struct bitset *dst, struct bitset *src)
+{
+    uint32_t *d = (uint32_t *)DATA_POS(dst), *s = (uint32_t *)DATA_POS(src);
+    uint8_t i;
+
+    for (i = 0; i < dst->size; i++) {
+        d[i] &= s[i];
+    }
+    dst->count = bitset_count(dst, 0, size2bit(dst->size));
+}
+
+void
+bitset_or(struct bitset *dst, struct bitset *src)
+{
+    uint32_t *d = (uint32_t *)DATA_POS(dst), *s = (uint32_t *)DATA_POS(src);
+    uint8_t i;
+
+    for (i = 0; i < dst->size; i++) {
+        d[i] |= s[i];
+    }
+    dst->count = bitset_count(dst, 0, size2bit(dst->size));
+}
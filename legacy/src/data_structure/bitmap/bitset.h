@@ -32,3 +32,11 @@ uint8_t bitset_get(struct bitset *bs, uint16_t col);
  * multi-bit columns (up to a byte), so the values may go beyond 0 & 1
  */
 void bitset_set(struct bitset *bs, uint16_t col, uint8_t val);
+
+/* bulk operations, which work on a whole 32-bit segment at a time */
+
+/* # non-zero columns in [start, end) */
+uint16_t bitset_count(struct bitset *bs, uint16_t start, uint16_t end);
+/* dst = dst & src / dst = dst | src, both bitsets must have the same size */
+void bitset_and(struct bitset *dst, struct bitset *src);
+void bitset_or(struct bitset *dst, struct bitset *src);
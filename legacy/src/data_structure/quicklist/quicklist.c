@@ -0,0 +1,493 @@
+#include "quicklist.h"
+
+#include <cc_debug.h>
+
+#include <string.h>
+
+/* an entry in the index of chunks */
+struct ql_chunk {
+    uint32_t slot;
+    uint32_t nentry;
+};
+
+static inline ziplist_p
+_slot(const quicklist_p ql, uint32_t slot)
+{
+    return ql + QUICKLIST_HEADER_SIZE + slot * QUICKLIST_CHUNK_SIZE;
+}
+
+/* the index follows the chunks, right after the ziplist of a lone chunk */
+static inline struct ql_chunk *
+_index(const quicklist_p ql, uint32_t nchunk)
+{
+    if (nchunk == 1) {
+        return (struct ql_chunk *)(_slot(ql, 0) + ziplist_size(_slot(ql, 0)));
+    }
+
+    return (struct ql_chunk *)_slot(ql, nchunk);
+}
+
+static inline ziplist_p
+_chunk(const quicklist_p ql, uint32_t k)
+{
+    return _slot(ql, _index(ql, QL_NCHUNK(ql))[k].slot);
+}
+
+static inline bool
+_chunk_fits(const quicklist_p ql, uint32_t k, uint8_t sz)
+{
+    return ziplist_size(_chunk(ql, k)) + sz <= QUICKLIST_CHUNK_SIZE;
+}
+
+/* # bytes it takes to add a chunk, which pads a lone chunk to a full slot */
+static inline uint32_t
+_chunk_delta(const quicklist_p ql)
+{
+    uint32_t nchunk = QL_NCHUNK(ql);
+
+    if (nchunk == 0) {
+        return ZIPLIST_HEADER_SIZE + QUICKLIST_INDEX_SIZE;
+    }
+
+    return QUICKLIST_CHUNK_SIZE + QUICKLIST_INDEX_SIZE + (nchunk == 1) *
+        (QUICKLIST_CHUNK_SIZE - ziplist_size(_slot(ql, 0)));
+}
+
+/*
+ * Update the index after chunk k has been changed to zl. The index entry of a
+ * lone chunk moves with the end of its ziplist, and may have been overwritten,
+ * so it is written anew.
+ */
+static inline void
+_chunk_sync(quicklist_p ql, uint32_t k, const ziplist_p zl)
+{
+    struct ql_chunk *chunk = _index(ql, QL_NCHUNK(ql));
+
+    if (QL_NCHUNK(ql) == 1) {
+        chunk->slot = 0;
+        QL_NENTRY(ql) = ziplist_nentry(zl);
+    } else {
+        QL_NENTRY(ql) += ziplist_nentry(zl) - chunk[k].nentry;
+    }
+    chunk[k].nentry = ziplist_nentry(zl);
+}
+
+/* add an empty chunk before chunk k, which takes the next free slot */
+static ziplist_p
+_chunk_add(quicklist_p ql, uint32_t k)
+{
+    uint32_t nchunk = QL_NCHUNK(ql);
+    struct ql_chunk *chunk;
+    ziplist_p zl = _slot(ql, nchunk);
+
+    ASSERT(k <= nchunk);
+
+    if (nchunk == 0) {
+        ziplist_reset(zl);
+        chunk = _index(ql, 1);
+    } else {
+        /* the new slot may hold the index, including that of a lone chunk */
+        chunk = (struct ql_chunk *)_slot(ql, nchunk + 1);
+        memmove(chunk, _index(ql, nchunk), nchunk * QUICKLIST_INDEX_SIZE);
+        ziplist_reset(zl);
+        memmove(chunk + k + 1, chunk + k, (nchunk - k) * QUICKLIST_INDEX_SIZE);
+    }
+
+    chunk[k].slot = nchunk;
+    chunk[k].nentry = 0;
+    QL_NCHUNK(ql) = nchunk + 1;
+
+    return zl;
+}
+
+/* remove chunk k, and move the chunk in the last slot into the slot freed */
+static void
+_chunk_remove(quicklist_p ql, uint32_t k)
+{
+    uint32_t nchunk = QL_NCHUNK(ql), last = nchunk - 1, slot, j;
+    struct ql_chunk *chunk = _index(ql, nchunk);
+
+    ASSERT(k < nchunk);
+
+    slot = chunk[k].slot;
+    QL_NENTRY(ql) -= chunk[k].nentry;
+    memmove(chunk + k, chunk + k + 1, (last - k) * QUICKLIST_INDEX_SIZE);
+
+    if (slot != last) {
+        memcpy(_slot(ql, slot), _slot(ql, last), ziplist_size(_slot(ql, last)));
+        for (j = 0; chunk[j].slot != last; ++j);
+        chunk[j].slot = slot;
+    }
+
+    QL_NCHUNK(ql) = last;
+    memmove(_index(ql, last), chunk, last * QUICKLIST_INDEX_SIZE);
+}
+
+/* the chunk that entry idx (or the tail, if idx == nentry) is in, and the
+ * position of the entry in that chunk
+ */
+static uint32_t
+_chunk_locate(uint32_t *pos, const quicklist_p ql, uint32_t idx)
+{
+    struct ql_chunk *chunk = _index(ql, QL_NCHUNK(ql));
+    uint32_t k, ridx;
+
+    ASSERT(QL_NCHUNK(ql) > 0 && idx <= QL_NENTRY(ql));
+
+    if (idx < QL_NENTRY(ql) / 2) {
+        for (k = 0; idx >= chunk[k].nentry; idx -= chunk[k++].nentry);
+        *pos = idx;
+    } else { /* ridx is the # entries from idx to the end */
+        ridx = QL_NENTRY(ql) - idx;
+        for (k = QL_NCHUNK(ql) - 1; ridx > chunk[k].nentry;
+                ridx -= chunk[k--].nentry);
+        *pos = chunk[k].nentry - ridx;
+    }
+
+    return k;
+}
+
+/* where an entry of sz bytes inserted at idx goes, which is into chunk k at pos
+ * if it returns true; otherwise a chunk has to be added first
+ */
+static bool
+_insert_locate(uint32_t *k, uint32_t *pos, const quicklist_p ql, uint32_t idx,
+        uint8_t sz)
+{
+    *k = _chunk_locate(pos, ql, idx);
+    if (_chunk_fits(ql, *k, sz)) {
+        return true;
+    }
+
+    /* an entry at the head of a chunk may also go to the tail of the previous */
+    if (*pos == 0 && *k > 0 && _chunk_fits(ql, *k - 1, sz)) {
+        *k -= 1;
+        *pos = _index(ql, QL_NCHUNK(ql))[*k].nentry;
+
+        return true;
+    }
+
+    return false;
+}
+
+static inline bool
+_val_valid(const struct blob *val)
+{
+    return !(val->type == BLOB_TYPE_UNKNOWN || val->type >= BLOB_TYPE_SENTINEL ||
+            (val->type == BLOB_TYPE_STR && val->vstr.len > ZE_STR_MAXLEN));
+}
+
+
+quicklist_rstatus_e
+quicklist_locate(zipentry_p *ze, const quicklist_p ql, int64_t idx)
+{
+    uint32_t nentry, k, pos;
+    ziplist_rstatus_e status;
+
+    if (ql == NULL || ze == NULL) {
+        return QUICKLIST_ERROR;
+    }
+
+    nentry = quicklist_nentry(ql);
+    idx += (idx < 0) * nentry;
+    if (idx < 0 || idx >= nentry) {
+        *ze = NULL;
+        return QUICKLIST_EOOB;
+    }
+
+    k = _chunk_locate(&pos, ql, (uint32_t)idx);
+    status = ziplist_locate(ze, _chunk(ql, k), pos);
+    ASSERT(status == ZIPLIST_OK);
+
+    return QUICKLIST_OK;
+}
+
+quicklist_rstatus_e
+quicklist_seek(struct quicklist_iter *iter, const quicklist_p ql, int64_t idx)
+{
+    uint32_t nentry, pos;
+    ziplist_rstatus_e status;
+
+    if (ql == NULL || iter == NULL) {
+        return QUICKLIST_ERROR;
+    }
+
+    nentry = quicklist_nentry(ql);
+    idx += (idx < 0) * nentry;
+    if (idx < 0 || idx >= nentry) {
+        iter->ze = NULL;
+        return QUICKLIST_EOOB;
+    }
+
+    iter->k = _chunk_locate(&pos, ql, (uint32_t)idx);
+    status = ziplist_locate(&iter->ze, _chunk(ql, iter->k), pos);
+    ASSERT(status == ZIPLIST_OK);
+
+    return QUICKLIST_OK;
+}
+
+quicklist_rstatus_e
+quicklist_next(struct quicklist_iter *iter, const quicklist_p ql)
+{
+    ziplist_rstatus_e status;
+
+    if (ql == NULL || iter == NULL || iter->ze == NULL) {
+        return QUICKLIST_ERROR;
+    }
+
+    if (ziplist_next(&iter->ze, _chunk(ql, iter->k), iter->ze) == ZIPLIST_OK) {
+        return QUICKLIST_OK;
+    }
+
+    /* chunks are never empty, so the next entry is the head of the next one */
+    if (++iter->k == QL_NCHUNK(ql)) {
+        iter->ze = NULL;
+        return QUICKLIST_EOOB;
+    }
+    status = ziplist_locate(&iter->ze, _chunk(ql, iter->k), 0);
+    ASSERT(status == ZIPLIST_OK);
+
+    return QUICKLIST_OK;
+}
+
+uint32_t
+quicklist_insert_delta(const quicklist_p ql, int64_t idx, uint8_t sz)
+{
+    uint32_t k, pos;
+
+    ASSERT(ql != NULL);
+
+    idx += (idx < 0) * quicklist_nentry(ql);
+    ASSERT(idx >= 0 && idx <= quicklist_nentry(ql));
+
+    if (QL_NCHUNK(ql) == 0) {
+        return _chunk_delta(ql) + sz;
+    }
+
+    if (_insert_locate(&k, &pos, ql, (uint32_t)idx, sz)) {
+        return (QL_NCHUNK(ql) == 1) * sz;
+    }
+
+    return _chunk_delta(ql);
+}
+
+void
+quicklist_tail(struct quicklist_tail *tail, const quicklist_p ql)
+{
+    ASSERT(tail != NULL && ql != NULL);
+
+    tail->nchunk = QL_NCHUNK(ql);
+    tail->size = (tail->nchunk == 0) ? 0 :
+        ziplist_size(_chunk(ql, tail->nchunk - 1));
+}
+
+uint32_t
+quicklist_push_delta(struct quicklist_tail *tail, uint8_t sz)
+{
+    uint32_t delta;
+
+    if (tail->nchunk == 0) {
+        delta = ZIPLIST_HEADER_SIZE + QUICKLIST_INDEX_SIZE + sz;
+        tail->size = ZIPLIST_HEADER_SIZE + sz;
+        tail->nchunk = 1;
+    } else if (tail->size + sz <= QUICKLIST_CHUNK_SIZE) {
+        delta = (tail->nchunk == 1) * sz;
+        tail->size += sz;
+    } else {
+        delta = QUICKLIST_CHUNK_SIZE + QUICKLIST_INDEX_SIZE + (tail->nchunk ==
+                1) * (QUICKLIST_CHUNK_SIZE - tail->size);
+        tail->size = ZIPLIST_HEADER_SIZE + sz;
+        tail->nchunk++;
+    }
+
+    return delta;
+}
+
+quicklist_rstatus_e
+quicklist_reset(quicklist_p ql)
+{
+    if (ql == NULL) {
+        return QUICKLIST_ERROR;
+    }
+
+    QL_NENTRY(ql) = 0;
+    QL_NCHUNK(ql) = 0;
+
+    return QUICKLIST_OK;
+}
+
+quicklist_rstatus_e
+quicklist_remove_val(uint32_t *removed, quicklist_p ql, const struct blob *val,
+        int64_t count)
+{
+    bool forward = (count > 0);
+    uint32_t nrem = 0, n;
+    uint32_t k;
+    ziplist_p zl;
+
+    if (ql == NULL || val == NULL) {
+        return QUICKLIST_ERROR;
+    }
+
+    if (!_val_valid(val)) {
+        return QUICKLIST_EINVALID;
+    }
+
+    /* chunks after the one being removed from shift down in the index, so k is
+     * only moved forward when the chunk stays
+     */
+    k = forward ? 0 : QL_NCHUNK(ql);
+    while (count != 0 && (forward ? k < QL_NCHUNK(ql) : k-- > 0)) {
+        zl = _chunk(ql, k);
+        ziplist_remove_val(&n, zl, val, count);
+        _chunk_sync(ql, k, zl);
+        nrem += n;
+        count += forward ? -(int64_t)n : n;
+
+        if (ziplist_nentry(zl) == 0) {
+            _chunk_remove(ql, k);
+        } else if (forward) {
+            k++;
+        }
+    }
+
+    if (removed != NULL) {
+        *removed = nrem;
+    }
+
+    return QUICKLIST_OK;
+}
+
+/* move entries from pos on of chunk k into a new chunk after it */
+static void
+_chunk_split(quicklist_p ql, uint32_t k, uint32_t pos)
+{
+    ziplist_p zl, nzl;
+    zipentry_p ze;
+    uint32_t len, n;
+
+    nzl = _chunk_add(ql, k + 1);
+    zl = _chunk(ql, k);
+    n = ziplist_nentry(zl) - pos;
+
+    ziplist_locate(&ze, zl, pos);
+    len = ziplist_size(zl) - (uint32_t)(ze - zl);
+    memcpy(nzl + ZIPLIST_HEADER_SIZE, ze, len);
+    ZL_NENTRY(nzl) = n;
+    ZL_NEND(nzl) = ZIPLIST_HEADER_SIZE + len - 1;
+    ziplist_truncate(zl, -(int64_t)n);
+
+    _chunk_sync(ql, k, zl);
+    _chunk_sync(ql, k + 1, nzl);
+}
+
+quicklist_rstatus_e
+quicklist_insert(quicklist_p ql, struct blob *val, int64_t idx)
+{
+    uint32_t nentry, k, pos, n;
+    uint8_t sz;
+    ziplist_p zl;
+
+    if (ql == NULL || val == NULL) {
+        return QUICKLIST_ERROR;
+    }
+
+    if (zipentry_size(&sz, val) != ZIPLIST_OK) {
+        return QUICKLIST_EINVALID;
+    }
+
+    nentry = quicklist_nentry(ql);
+    idx += (idx < 0) * nentry;
+    if (idx < 0 || idx > nentry) {
+        return QUICKLIST_EOOB;
+    }
+
+    if (QL_NCHUNK(ql) == 0) {
+        k = pos = 0;
+        _chunk_add(ql, 0);
+    } else if (!_insert_locate(&k, &pos, ql, (uint32_t)idx, sz)) {
+        n = _index(ql, QL_NCHUNK(ql))[k].nentry;
+        if (pos == n) {         /* new chunk after */
+            _chunk_add(ql, ++k);
+            pos = 0;
+        } else if (pos == 0) {  /* new chunk before */
+            _chunk_add(ql, k);
+        } else {                /* split, and insert into the smaller half */
+            _chunk_split(ql, k, pos);
+            if (ziplist_size(_chunk(ql, k)) > ziplist_size(_chunk(ql, k + 1))) {
+                k++;
+                pos = 0;
+            }
+        }
+    }
+
+    zl = _chunk(ql, k);
+    ziplist_insert(zl, val, pos);
+    _chunk_sync(ql, k, zl);
+
+    return QUICKLIST_OK;
+}
+
+quicklist_rstatus_e
+quicklist_push(quicklist_p ql, struct blob *val)
+{
+    if (ql == NULL) {
+        return QUICKLIST_ERROR;
+    }
+
+    return quicklist_insert(ql, val, quicklist_nentry(ql));
+}
+
+/* remove count entries from the head if count is positive, or -count entries
+ * from the tail if negative
+ */
+static void
+_truncate(quicklist_p ql, int64_t count)
+{
+    uint32_t k, n;
+    ziplist_p zl;
+
+    while (count != 0) {
+        k = (count > 0) ? 0 : QL_NCHUNK(ql) - 1;
+        n = _index(ql, QL_NCHUNK(ql))[k].nentry;
+        if (n <= (count > 0 ? count : -count)) {
+            _chunk_remove(ql, k);
+            count += (count > 0) ? -(int64_t)n : n;
+        } else {
+            zl = _chunk(ql, k);
+            ziplist_truncate(zl, count);
+            _chunk_sync(ql, k, zl);
+            count = 0;
+        }
+    }
+}
+
+quicklist_rstatus_e
+quicklist_trim(quicklist_p ql, int64_t idx, int64_t count)
+{
+    int64_t nentry, lo, hi;
+
+    if (ql == NULL) {
+        return QUICKLIST_ERROR;
+    }
+
+    nentry = quicklist_nentry(ql);
+    idx += (idx < 0) * nentry;
+    if (idx < 0 || idx >= nentry) {
+        return QUICKLIST_EOOB;
+    }
+
+    /* keep entries in [lo, hi) */
+    if (count > 0) {
+        lo = idx;
+        hi = (idx + count < nentry) ? idx + count : nentry;
+    } else {
+        lo = (idx + count > 0) ? idx + count : 0;
+        hi = idx;
+    }
+
+    _truncate(ql, -(nentry - hi));
+    _truncate(ql, lo);
+
+    return QUICKLIST_OK;
+}
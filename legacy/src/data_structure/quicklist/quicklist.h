@@ -0,0 +1,136 @@
+#pragma once
+
+/* The quicklist is a list of ziplists, named after a similar structure in
+ * Redis. A single ziplist has to move every entry after the one being inserted
+ * or removed, and can only be seeked from either end by walking the entries,
+ * which makes long lists expensive to update anywhere but near the tail. The
+ * quicklist instead splits a list into chunks, each a ziplist of at most
+ * QUICKLIST_CHUNK_SIZE bytes, ordered by a small index of chunks.
+ *
+ * Like the ziplist, the quicklist lives in a single contiguous piece of memory
+ * (e.g. an item value), and none of the APIs tries to allocate or free any
+ * memory: the caller makes room for the number of bytes returned by
+ * quicklist_insert_delta or quicklist_push_delta before updating the list.
+ *
+ * ----------------------------------------------------------------------------
+ *
+ * QUICKLIST OVERALL LAYOUT
+ * ========================
+ *
+ * <nentry><nchunk> <chunk> ... <chunk> <index> ... <index>
+ * ╰--------------╯ ╰-----------------╯ ╰-----------------╯
+ *       header            chunks          index of chunks
+ *
+ * Overhead: 8 bytes
+ *
+ * <uint32_t nentry> is the number of entries in the list.
+ * <uint32_t nchunk> is the number of chunks.
+ *
+ * Each chunk is a ziplist stored in a slot of QUICKLIST_CHUNK_SIZE bytes, in no
+ * particular order. The index has an entry of 8 bytes for each chunk, in list
+ * order, which holds the slot of the chunk and the number of entries in it. A
+ * list that fits in a single chunk does not take a whole slot, so short lists
+ * cost no more than 16 bytes on top of a plain ziplist.
+ *
+ * Chunks are never empty. When a chunk is removed, the chunk in the last slot
+ * is moved into its slot, so slots are always in use from the first one on.
+ *
+ *
+ * RUNTIME
+ * =======
+ *
+ * Finding an entry by index walks the index of chunks from the nearer end, and
+ * then the entries of a single chunk. So updates and lookups near either end of
+ * the list take O(chunk) no matter how long the list is, and those elsewhere
+ * O(nchunk + chunk). Walking a range of entries with quicklist_next takes
+ * O(1) per entry after the first one is located.
+ *
+ * Inserting into a full chunk either adds a chunk before or after it, if the
+ * entry goes to either end of the chunk, or otherwise splits it in two. So
+ * pushing to either end of a list keeps chunks full, while inserting in the
+ * middle leaves chunks half full at worst.
+ */
+
+#include "../ziplist/ziplist.h"
+
+#include <stdint.h>
+
+#define QUICKLIST_HEADER_SIZE 8
+#define QUICKLIST_INDEX_SIZE  8      /* per chunk */
+#define QUICKLIST_CHUNK_SIZE  1024   /* max size of a chunk, in bytes */
+
+#define QL_NENTRY(_ql)  (*((uint32_t *)(_ql)))
+#define QL_NCHUNK(_ql)  (*((uint32_t *)(_ql) + 1))
+
+typedef uint8_t * quicklist_p;
+
+typedef enum {
+    QUICKLIST_OK,
+    QUICKLIST_EOOB,       /* out-of-bound error */
+    QUICKLIST_EINVALID,   /* invalid data error */
+    QUICKLIST_ERROR,
+    QUICKLIST_SENTINEL
+} quicklist_rstatus_e;
+
+/* an entry of a quicklist, and the chunk it is in, valid until the list is
+ * updated
+ */
+struct quicklist_iter {
+    uint32_t k;         /* chunk, in list order */
+    zipentry_p ze;
+};
+
+/* tail of a quicklist, to size several pushes before making them */
+struct quicklist_tail {
+    uint32_t nchunk;
+    uint32_t size;      /* size of the tail chunk */
+};
+
+static inline uint32_t
+quicklist_nentry(const quicklist_p ql)
+{
+    return QL_NENTRY(ql);
+}
+
+static inline uint32_t
+quicklist_size(const quicklist_p ql)
+{
+    uint32_t nchunk = QL_NCHUNK(ql);
+
+    if (nchunk == 1) {
+        return QUICKLIST_HEADER_SIZE + QUICKLIST_INDEX_SIZE +
+            ziplist_size(ql + QUICKLIST_HEADER_SIZE);
+    }
+
+    return QUICKLIST_HEADER_SIZE + nchunk *
+        (QUICKLIST_CHUNK_SIZE + QUICKLIST_INDEX_SIZE);
+}
+
+/* quicklist APIs: seek */
+quicklist_rstatus_e quicklist_locate(zipentry_p *ze, const quicklist_p ql, int64_t idx);
+/* walking a range of entries from the one at idx only locates the first one,
+ * each call to quicklist_next then moves iter to the entry after it
+ */
+quicklist_rstatus_e quicklist_seek(struct quicklist_iter *iter, const quicklist_p ql, int64_t idx);
+quicklist_rstatus_e quicklist_next(struct quicklist_iter *iter, const quicklist_p ql);
+
+/* quicklist APIs: sizing
+ * # bytes the quicklist grows by when an entry of sz bytes (see zipentry_size)
+ * is inserted at idx, which must be valid for quicklist_insert
+ */
+uint32_t quicklist_insert_delta(const quicklist_p ql, int64_t idx, uint8_t sz);
+/* # bytes the quicklist grows by when an entry of sz bytes is pushed after
+ * tail, which is then updated as if the entry was pushed
+ */
+void quicklist_tail(struct quicklist_tail *tail, const quicklist_p ql);
+uint32_t quicklist_push_delta(struct quicklist_tail *tail, uint8_t sz);
+
+/* quicklist APIs: modify, all of which work the same as their ziplist
+ * counterparts
+ */
+quicklist_rstatus_e quicklist_reset(quicklist_p ql);
+quicklist_rstatus_e quicklist_remove_val(uint32_t *removed, quicklist_p ql, const struct blob *val, int64_t count);
+/* CALLER MUST MAKE SURE THERE IS ENOUGH MEMORY!!! */
+quicklist_rstatus_e quicklist_insert(quicklist_p ql, struct blob *val, int64_t idx);
+quicklist_rstatus_e quicklist_push(quicklist_p ql, struct blob *val);
+quicklist_rstatus_e quicklist_trim(quicklist_p ql, int64_t idx, int64_t count);
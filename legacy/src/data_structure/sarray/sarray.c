@@ -43,7 +43,7 @@ _get_value(char *p, uint32_t esize)
     case 2:
         return *((uint16_t *)p);
     case 1:
-        return *p;
+        return *((uint8_t *)p);
     default:
         NOT_REACHED();
         return 0;
@@ -64,96 +64,47 @@ _set_value(char *p, uint32_t esize, uint64_t val)
         *((uint16_t *)p) = val;
         break;
     case 1:
-        *p = val;
+        *((uint8_t *)p) = val;
         break;
     default:
         NOT_REACHED();
     }
 }
 
-static inline bool
-_should_scan(uint32_t nentry, uint32_t esize) {
-    return nentry * esize <= SCAN_THRESHOLD;
+/*
+ * The # entries below val, found with a branchless binary search, which
+ * narrows the range down until it fits in SCAN_THRESHOLD bytes, and then a
+ * scan of the range. Neither has a branch that depends on the data, and the
+ * scan counts instead of stopping early, so compilers can vectorize it.
+ */
+#define SARRAY_LOWER_BOUND(_type)                                              \
+static inline uint32_t                                                         \
+_lower_bound_##_type(const _type *body, uint32_t nentry, _type val)            \
+{                                                                              \
+    const _type *base = body;                                                  \
+    uint32_t n = nentry, half, nbelow = 0;                                     \
+                                                                               \
+    while (n * sizeof(_type) > SCAN_THRESHOLD) {                               \
+        half = n / 2;                                                          \
+        base += (base[half] < val) * half;                                     \
+        n -= half;                                                             \
+    }                                                                          \
+    for (uint32_t i = 0; i < n; ++i) {                                         \
+        nbelow += (base[i] < val);                                             \
+    }                                                                          \
+                                                                               \
+    return (uint32_t)(base - body) + nbelow;                                   \
 }
 
+SARRAY_LOWER_BOUND(uint8_t)
+SARRAY_LOWER_BOUND(uint16_t)
+SARRAY_LOWER_BOUND(uint32_t)
+SARRAY_LOWER_BOUND(uint64_t)
+
 /* returns true if an exact match is found, false otherwise.
  * If a match is found, the index of the element is stored in idx;
  * otherwise, idx contains the index of the insertion spot
  */
-static inline bool
-_linear_search(uint32_t *idx, char *body, uint32_t nentry, uint32_t esize, uint64_t val)
-{
-    uint32_t i;
-
-    *idx = 0;
-
-    if (nentry == 0) {
-        return false;
-    }
-
-
-    for (i = 0; i < nentry; ++i, ++*idx) {
-        if (val <= _get_value(_position(body, esize, i), esize)) {
-            break;
-        }
-    }
-
-    if (val == _get_value(_position(body, esize, *idx), esize)) {
-        return true;
-    } else {
-        return false;
-    }
-}
-
-static inline bool
-_binary_search(uint32_t *idx, char *body, uint32_t nentry, uint32_t esize, uint64_t val)
-{
-    uint32_t id = 0, imin, imax;
-    uint32_t curr;
-
-    *idx = 0;
-
-    if (nentry == 0) {
-        return false;
-    }
-
-    if (val == _get_value(_position(body, esize, 0), esize)) {
-        return true;
-    }
-    if (val < _get_value(_position(body, esize, 0), esize)) {
-        return false;
-    }
-    if (val > _get_value(_position(body, esize, nentry - 1), esize)) {
-        *idx = nentry;
-        return false;
-    }
-
-    imin = 1;
-    imax = nentry - 1;
-    while (imin <= imax) {
-        id = (imin + imax) / 2;
-        curr = _get_value(_position(body, esize, id), esize);
-        if (val == curr) {
-            *idx = id;
-            return true;
-        }
-
-        if (val > curr) {
-            imin = id + 1;
-        } else {
-            if (val <= _get_value(_position(body, esize, id - 1), esize)) {
-                imax = id - 1;
-            } else {
-                break;
-            }
-        }
-    }
-
-    *idx = id;
-
-    return false;
-}
-
 static inline bool
 _locate(uint32_t *idx, char *body, uint32_t nentry, uint32_t esize, uint64_t val)
 {
@@ -164,11 +115,27 @@ _locate(uint32_t *idx, char *body, uint32_t nentry, uint32_t esize, uint64_t val
         return false;
     }
 
-    if (_should_scan(nentry, esize)) { /* linear scan */
-        return _linear_search(idx, body, nentry, esize, val);
-    } else { /* otherwise, binary search  */
-        return _binary_search(idx, body, nentry, esize, val);
+    switch (esize) {
+    case 8:
+        *idx = _lower_bound_uint64_t((uint64_t *)body, nentry, val);
+        break;
+    case 4:
+        *idx = _lower_bound_uint32_t((uint32_t *)body, nentry, (uint32_t)val);
+        break;
+    case 2:
+        *idx = _lower_bound_uint16_t((uint16_t *)body, nentry, (uint16_t)val);
+        break;
+    case 1:
+        *idx = _lower_bound_uint8_t((uint8_t *)body, nentry, (uint8_t)val);
+        break;
+    default:
+        NOT_REACHED();
+        *idx = nentry;
+
+        return false;
     }
+
+    return _get_value(_position(body, esize, *idx), esize) == val;
 }
 
 
@@ -283,6 +250,62 @@ sarray_insert(sarray_p sa, uint64_t val)
     return SARRAY_OK;
 }
 
+sarray_rstatus_e
+sarray_insert_many(uint32_t *ninserted, sarray_p sa, const uint64_t *vals,
+        uint32_t nval)
+{
+    char *body;
+    uint32_t idx, esize, nentry, nnew = 0;
+    int64_t i, j, w;
+    uint64_t curr = 0;
+
+    if (sa == NULL || ninserted == NULL || (vals == NULL && nval > 0)) {
+        log_debug("NULL pointer encountered for sa %p, vals %p, or ninserted %p",
+                sa, vals, ninserted);
+
+        return SARRAY_ERROR;
+    }
+
+    esize = sarray_esize(sa);
+    body = SA_BODY(sa);
+    nentry = sarray_nentry(sa);
+
+    /* validate everything and count the new values before moving any data */
+    for (j = 0; j < nval; ++j) {
+        if (!_validate_range(esize, vals[j]) || (j > 0 && vals[j] < vals[j - 1])) {
+            log_debug("value %"PRIu64" at %"PRId64" is out of range or order",
+                    vals[j], j);
+
+            return SARRAY_EINVALID;
+        }
+        if ((j == 0 || vals[j] != vals[j - 1]) &&
+                !_locate(&idx, body, nentry, esize, vals[j])) {
+            nnew++;
+        }
+    }
+
+    /* merge from the end, so every entry is moved at most once */
+    i = (int64_t)nentry - 1;
+    w = (int64_t)nentry + nnew - 1;
+    for (j = (int64_t)nval - 1; j >= 0 && w > i; --j) {
+        if (j < nval - 1 && vals[j] == vals[j + 1]) {
+            continue;
+        }
+        for (; i >= 0 && (curr = _get_value(_position(body, esize, i), esize))
+                > vals[j]; --i, --w) {
+            _set_value(_position(body, esize, w), esize, curr);
+        }
+        if (i < 0 || curr != vals[j]) {
+            _set_value(_position(body, esize, w--), esize, vals[j]);
+        }
+    }
+
+    SA_NENTRY(sa) += nnew;
+    *ninserted = nnew;
+
+    return SARRAY_OK;
+}
+
 sarray_rstatus_e
 sarray_remove(sarray_p sa, uint64_t val)
 {
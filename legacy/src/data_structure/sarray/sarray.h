@@ -39,9 +39,10 @@
  * RUNTIME
  * =======
  *
- * Entry lookup takes O(log N) where N is the number of entries in the list. If
- * the entry size are below a threshold (64-bytes for now), then a linear scan
- * is performed instead of binary lookup.
+ * Entry lookup takes O(log N) where N is the number of entries in the list.
+ * The binary search is branchless, and stops once the range left is below a
+ * threshold (64-bytes for now), which is then scanned in a way that compilers
+ * can vectorize.
  *
  * Insertion and removal of entries involve index-based lookup, as well as
  * shifting data. So in additional to the considerations above, the amount of
@@ -98,6 +99,11 @@ sarray_rstatus_e sarray_index(uint32_t *idx, const sarray_p sa, uint64_t val);
 
 /* sarray APIs: modify */
 sarray_rstatus_e sarray_insert(sarray_p sa, uint64_t val);
+/* insert nval values sorted in ASC order, skipping those already present, and
+ * move each existing entry at most once; ninserted is the # values inserted
+ * CALLER MUST MAKE SURE THERE IS ENOUGH MEMORY FOR nval MORE ENTRIES!!!
+ */
+sarray_rstatus_e sarray_insert_many(uint32_t *ninserted, sarray_p sa, const uint64_t *vals, uint32_t nval);
 sarray_rstatus_e sarray_remove(sarray_p sa, uint64_t val);
 
 /*
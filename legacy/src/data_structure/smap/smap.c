@@ -71,91 +71,39 @@ _set_key(char *p, uint16_t ksize, uint64_t key)
     }
 }
 
-static inline bool
-_should_scan(uint32_t nentry, uint32_t esize) {
-    return nentry * esize <= SCAN_THRESHOLD;
+/*
+ * The # entries with a key below key, found with a branchless binary search,
+ * which narrows the range down until it fits in SCAN_THRESHOLD bytes, and then
+ * a scan of the range that counts instead of stopping early.
+ */
+#define SMAP_LOWER_BOUND(_type)                                                \
+static inline uint32_t                                                         \
+_lower_bound_##_type(const char *body, uint32_t nentry, uint32_t esize,        \
+        _type key)                                                             \
+{                                                                              \
+    uint32_t lo = 0, n = nentry, half, nbelow = 0;                             \
+                                                                               \
+    while (n * esize > SCAN_THRESHOLD) {                                       \
+        half = n / 2;                                                          \
+        lo += (*(const _type *)(body + esize * (lo + half)) < key) * half;     \
+        n -= half;                                                             \
+    }                                                                          \
+    for (uint32_t i = lo; i < lo + n; ++i) {                                   \
+        nbelow += (*(const _type *)(body + esize * i) < key);                  \
+    }                                                                          \
+                                                                               \
+    return lo + nbelow;                                                        \
 }
 
+SMAP_LOWER_BOUND(uint8_t)
+SMAP_LOWER_BOUND(uint16_t)
+SMAP_LOWER_BOUND(uint32_t)
+SMAP_LOWER_BOUND(uint64_t)
+
 /* returns true if an exact match is found, false otherwise.
  * If a match is found, the index of the element is stored in idx;
  * otherwise, idx contains the index of the insertion spot
  */
-static inline bool
-_linear_search(uint32_t *idx, char *body, uint32_t nentry, uint32_t esize,
-        uint16_t ksize, uint64_t key)
-{
-    uint32_t i;
-
-    *idx = 0;
-
-    if (nentry == 0) {
-        return false;
-    }
-
-
-    for (i = 0; i < nentry; ++i, ++*idx) {
-        if (key <= _get_key(_position(body, esize, i), ksize)) {
-            break;
-        }
-    }
-
-    if (key == _get_key(_position(body, esize, *idx), ksize)) {
-        return true;
-    } else {
-        return false;
-    }
-}
-
-static inline bool
-_binary_search(uint32_t *idx, char *body, uint32_t nentry, uint32_t esize,
-        uint16_t ksize, uint64_t key)
-{
-    uint32_t id = 0, imin, imax;
-    uint32_t curr;
-
-    *idx = 0;
-
-    if (nentry == 0) {
-        return false;
-    }
-
-    if (key == _get_key(_position(body, esize, 0), ksize)) {
-        return true;
-    }
-    if (key < _get_key(_position(body, esize, 0), ksize)) {
-        return false;
-    }
-    if (key > _get_key(_position(body, esize, nentry - 1), ksize)) {
-        *idx = nentry;
-        return false;
-    }
-
-    imin = 1;
-    imax = nentry - 1;
-    while (imin <= imax) {
-        id = (imin + imax) / 2;
-        curr = _get_key(_position(body, esize, id), ksize);
-        if (key == curr) {
-            *idx = id;
-            return true;
-        }
-
-        if (key > curr) {
-            imin = id + 1;
-        } else {
-            if (key <= _get_key(_position(body, esize, id - 1), ksize)) {
-                imax = id - 1;
-            } else {
-                break;
-            }
-        }
-    }
-
-    *idx = id;
-
-    return false;
-}
-
 static inline bool
 _locate(uint32_t *idx, char *body, uint32_t nentry, uint32_t esize,
         uint16_t ksize, uint64_t key)
@@ -167,11 +115,27 @@ _locate(uint32_t *idx, char *body, uint32_t nentry, uint32_t esize,
         return false;
     }
 
-    if (_should_scan(nentry, esize)) { /* linear scan */
-        return _linear_search(idx, body, nentry, esize, ksize, key);
-    } else { /* otherwise, binary search  */
-        return _binary_search(idx, body, nentry, esize, ksize, key);
+    switch (ksize) {
+    case 8:
+        *idx = _lower_bound_uint64_t(body, nentry, esize, key);
+        break;
+    case 4:
+        *idx = _lower_bound_uint32_t(body, nentry, esize, (uint32_t)key);
+        break;
+    case 2:
+        *idx = _lower_bound_uint16_t(body, nentry, esize, (uint16_t)key);
+        break;
+    case 1:
+        *idx = _lower_bound_uint8_t(body, nentry, esize, (uint8_t)key);
+        break;
+    default:
+        NOT_REACHED();
+        *idx = nentry;
+
+        return false;
     }
+
+    return _get_key(_position(body, esize, *idx), ksize) == key;
 }
 
 
@@ -54,9 +54,9 @@
  * RUNTIME
  * =======
  *
- * Entry lookup takes O(log N) where N is the number of entries in the list. If
- * the entry size are below a threshold (64-bytes for now), then a linear scan
- * is performed instead of binary lookup.
+ * Entry lookup takes O(log N) where N is the number of entries in the list.
+ * The binary search is branchless, and stops once the range left is below a
+ * threshold (64-bytes for now), which is then scanned.
  *
  * Insertion and removal of entries involve index-based lookup, as well as
  * shifting data. So in additional to the considerations above, the amount of
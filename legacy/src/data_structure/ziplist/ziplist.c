@@ -385,6 +385,18 @@ ziplist_remove_val(uint32_t *removed, ziplist_p zl, const struct blob *val,
 
         _ziplist_remove(zl, z, _ziplist_next(z), 1);
         ++nrem;
+
+        /* z is now the entry after the one removed, which may be past the end */
+        if (forward) {
+            if (z > _ziplist_end(zl)) {
+                goto done;
+            }
+        } else {
+            if (z == _ziplist_head(zl)) {
+                goto done;
+            }
+            z = _ziplist_prev(z);
+        }
     }
 
 done:
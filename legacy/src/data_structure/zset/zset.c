@@ -0,0 +1,438 @@
+#include "zset.h"
+
+#include <cc_debug.h>
+
+#include <math.h>
+
+
+#define ZS_HEAP(_zs) ((char *)(_zs) + ZSET_HEADER_SIZE)
+#define SCAN_THRESHOLD 8 /* # members, up to which offsets are scanned */
+
+#define ENTRY_LEN_OFFSET sizeof(double)
+#define ENTRY_MEMBER_OFFSET (sizeof(double) + sizeof(uint16_t))
+
+/* what entries are compared against when searching through the offsets */
+struct target {
+    double                  score;
+    const struct bstring    *member;
+    bool                    inclusive;
+};
+
+typedef bool (*before_fn)(const char *entry, const struct target *t);
+
+static inline uint32_t *
+_by_rank(const zset_p zs)
+{
+    return (uint32_t *)(ZS_HEAP(zs) + ZS_NBYTE(zs));
+}
+
+static inline uint32_t *
+_by_member(const zset_p zs)
+{
+    return _by_rank(zs) + ZS_NENTRY(zs);
+}
+
+static inline double
+_score(const char *entry)
+{
+    double score;
+
+    cc_memcpy(&score, entry, sizeof(double));
+
+    return score;
+}
+
+static inline void
+_set_score(char *entry, double score)
+{
+    cc_memcpy(entry, &score, sizeof(double));
+}
+
+static inline void
+_member(struct bstring *member, const char *entry)
+{
+    member->len = *((uint16_t *)(entry + ENTRY_LEN_OFFSET));
+    member->data = (char *)entry + ENTRY_MEMBER_OFFSET;
+}
+
+/* return <0, 0, >0 like memcmp, with shorter strings going first on a tie */
+static inline int
+_compare_member(const char *entry, const struct bstring *member)
+{
+    struct bstring m;
+    int ret;
+
+    _member(&m, entry);
+    ret = cc_memcmp(m.data, member->data, MIN(m.len, member->len));
+    if (ret == 0) {
+        return (int)m.len - (int)member->len;
+    }
+
+    return ret;
+}
+
+static inline bool
+_before_member(const char *entry, const struct target *t)
+{
+    return _compare_member(entry, t->member) < 0;
+}
+
+static inline bool
+_before_rank(const char *entry, const struct target *t)
+{
+    double score = _score(entry);
+
+    return score < t->score ||
+        (score == t->score && _compare_member(entry, t->member) < 0);
+}
+
+static inline bool
+_before_score(const char *entry, const struct target *t)
+{
+    return t->inclusive ? _score(entry) <= t->score : _score(entry) < t->score;
+}
+
+/* the first position in offsets of an entry that is not before target */
+static inline uint32_t
+_lower_bound(const uint32_t *offset, uint32_t nentry, const char *heap,
+        before_fn before, const struct target *t)
+{
+    uint32_t imin = 0, imax = nentry, id;
+
+    if (nentry <= SCAN_THRESHOLD) { /* linear scan */
+        for (; imin < nentry && before(heap + offset[imin], t); ++imin);
+
+        return imin;
+    }
+
+    while (imin < imax) { /* otherwise, binary search */
+        id = imin + (imax - imin) / 2;
+        if (before(heap + offset[id], t)) {
+            imin = id + 1;
+        } else {
+            imax = id;
+        }
+    }
+
+    return imin;
+}
+
+/* returns true if member is found, with its position in the member offsets */
+static inline bool
+_locate(uint32_t *pos, const zset_p zs, const struct bstring *member)
+{
+    struct target t = {.member = member};
+    uint32_t *offset = _by_member(zs);
+    uint32_t nentry = ZS_NENTRY(zs);
+
+    *pos = _lower_bound(offset, nentry, ZS_HEAP(zs), _before_member, &t);
+
+    return *pos < nentry &&
+        _compare_member(ZS_HEAP(zs) + offset[*pos], member) == 0;
+}
+
+/* position in the rank offsets an entry of score & member belongs at */
+static inline uint32_t
+_rank(const zset_p zs, double score, const struct bstring *member)
+{
+    struct target t = {.score = score, .member = member};
+
+    return _lower_bound(_by_rank(zs), ZS_NENTRY(zs), ZS_HEAP(zs), _before_rank,
+            &t);
+}
+
+static inline bool
+_validate_member(const struct bstring *member)
+{
+    return member->len <= ZSET_MEMBER_MAXLEN;
+}
+
+/* remove the entry at offset, which is at rank and at position pos of the
+ * member offsets
+ */
+static void
+_remove(zset_p zs, uint32_t offset, uint32_t rank, uint32_t pos)
+{
+    char *entry = ZS_HEAP(zs) + offset;
+    uint32_t *by_rank = _by_rank(zs), *by_member = _by_member(zs);
+    uint32_t *nrank, *nmember;
+    uint32_t esize, nentry = ZS_NENTRY(zs);
+    struct bstring member;
+
+    _member(&member, entry);
+    esize = ZS_ENTRY_SIZE(member.len);
+
+    /* close the gap in the heap, then move the offsets down after it, minus
+     * the ones of the entry removed, all to lower addresses
+     */
+    cc_memmove(entry, entry + esize, ZS_NBYTE(zs) - offset - esize);
+    nrank = (uint32_t *)((char *)by_rank - esize);
+    nmember = nrank + nentry - 1;
+    cc_memmove(nrank, by_rank, sizeof(uint32_t) * rank);
+    cc_memmove(nrank + rank, by_rank + rank + 1,
+            sizeof(uint32_t) * (nentry - rank - 1));
+    cc_memmove(nmember, by_member, sizeof(uint32_t) * pos);
+    cc_memmove(nmember + pos, by_member + pos + 1,
+            sizeof(uint32_t) * (nentry - pos - 1));
+
+    /* both arrays of offsets are now contiguous */
+    for (uint32_t i = 0; i < 2 * (nentry - 1); ++i) {
+        if (nrank[i] > offset) {
+            nrank[i] -= esize;
+        }
+    }
+
+    ZS_NBYTE(zs) -= esize;
+    ZS_NENTRY(zs)--;
+}
+
+
+zset_rstatus_e
+zset_init(zset_p zs)
+{
+    if (zs == NULL) {
+        log_debug("NULL pointer encountered for zs");
+
+        return ZSET_ERROR;
+    }
+
+    ZS_NENTRY(zs) = 0;
+    ZS_NBYTE(zs) = 0;
+
+    return ZSET_OK;
+}
+
+
+zset_rstatus_e
+zset_score(double *score, const zset_p zs, const struct bstring *member)
+{
+    uint32_t pos;
+
+    if (score == NULL || zs == NULL || member == NULL) {
+        log_debug("NULL pointer encountered for zs %p, score %p, or member %p",
+                zs, score, member);
+
+        return ZSET_ERROR;
+    }
+
+    if (!_locate(&pos, zs, member)) {
+        return ZSET_ENOTFOUND;
+    }
+
+    *score = _score(ZS_HEAP(zs) + _by_member(zs)[pos]);
+
+    return ZSET_OK;
+}
+
+zset_rstatus_e
+zset_rank(uint32_t *rank, const zset_p zs, const struct bstring *member)
+{
+    uint32_t pos;
+
+    if (rank == NULL || zs == NULL || member == NULL) {
+        log_debug("NULL pointer encountered for zs %p, rank %p, or member %p",
+                zs, rank, member);
+
+        return ZSET_ERROR;
+    }
+
+    if (!_locate(&pos, zs, member)) {
+        return ZSET_ENOTFOUND;
+    }
+
+    *rank = _rank(zs, _score(ZS_HEAP(zs) + _by_member(zs)[pos]), member);
+    ASSERT(*rank < ZS_NENTRY(zs));
+
+    return ZSET_OK;
+}
+
+zset_rstatus_e
+zset_entry(double *score, struct bstring *member, const zset_p zs,
+        uint32_t rank)
+{
+    char *entry;
+
+    if (score == NULL || member == NULL || zs == NULL) {
+        log_debug("NULL pointer encountered for zs %p, score %p, or member %p",
+                zs, score, member);
+
+        return ZSET_ERROR;
+    }
+
+    if (rank >= ZS_NENTRY(zs)) {
+        return ZSET_EOOB;
+    }
+
+    entry = ZS_HEAP(zs) + _by_rank(zs)[rank];
+    *score = _score(entry);
+    _member(member, entry);
+
+    return ZSET_OK;
+}
+
+uint32_t
+zset_count_below(const zset_p zs, double score, bool inclusive)
+{
+    struct target t = {.score = score, .inclusive = inclusive};
+
+    ASSERT(zs != NULL);
+
+    return _lower_bound(_by_rank(zs), ZS_NENTRY(zs), ZS_HEAP(zs),
+            _before_score, &t);
+}
+
+
+zset_rstatus_e
+zset_insert(zset_p zs, const struct bstring *member, double score)
+{
+    char *entry;
+    uint32_t *by_rank, *by_member, *nrank, *nmember;
+    uint32_t pos, rank, esize, nentry, nbyte;
+
+    if (zs == NULL || member == NULL) {
+        log_debug("NULL pointer encountered for zs %p or member %p", zs,
+                member);
+
+        return ZSET_ERROR;
+    }
+
+    if (!_validate_member(member) || isnan(score)) {
+        log_debug("member of length %"PRIu32" or score %f is invalid",
+                member->len, score);
+
+        return ZSET_EINVALID;
+    }
+
+    if (_locate(&pos, zs, member)) {
+        return ZSET_EDUP;
+    }
+    rank = _rank(zs, score, member);
+
+    nentry = ZS_NENTRY(zs);
+    nbyte = ZS_NBYTE(zs);
+    esize = ZS_ENTRY_SIZE(member->len);
+    by_rank = _by_rank(zs);
+    by_member = by_rank + nentry;
+
+    /* make room for the entry at the end of the heap, and one more offset in
+     * each array, moving data to higher addresses starting from the end
+     */
+    nrank = (uint32_t *)((char *)by_rank + esize);
+    nmember = nrank + nentry + 1;
+    cc_memmove(nmember + pos + 1, by_member + pos,
+            sizeof(uint32_t) * (nentry - pos));
+    cc_memmove(nmember, by_member, sizeof(uint32_t) * pos);
+    cc_memmove(nrank + rank + 1, by_rank + rank,
+            sizeof(uint32_t) * (nentry - rank));
+    cc_memmove(nrank, by_rank, sizeof(uint32_t) * rank);
+
+    entry = ZS_HEAP(zs) + nbyte;
+    _set_score(entry, score);
+    *((uint16_t *)(entry + ENTRY_LEN_OFFSET)) = (uint16_t)member->len;
+    cc_memcpy(entry + ENTRY_MEMBER_OFFSET, member->data, member->len);
+    nrank[rank] = nbyte;
+    nmember[pos] = nbyte;
+
+    ZS_NBYTE(zs) += esize;
+    ZS_NENTRY(zs)++;
+
+    return ZSET_OK;
+}
+
+zset_rstatus_e
+zset_update(zset_p zs, const struct bstring *member, double score)
+{
+    char *entry;
+    uint32_t *by_rank;
+    uint32_t pos, offset, rank, nrank;
+
+    if (zs == NULL || member == NULL) {
+        log_debug("NULL pointer encountered for zs %p or member %p", zs,
+                member);
+
+        return ZSET_ERROR;
+    }
+
+    if (isnan(score)) {
+        log_debug("score is not a number");
+
+        return ZSET_EINVALID;
+    }
+
+    if (!_locate(&pos, zs, member)) {
+        return ZSET_ENOTFOUND;
+    }
+
+    offset = _by_member(zs)[pos];
+    entry = ZS_HEAP(zs) + offset;
+    if (_score(entry) == score) {
+        return ZSET_OK;
+    }
+
+    /* the new rank is found while the entry still has its old score, so it
+     * is one off if the entry moves up
+     */
+    by_rank = _by_rank(zs);
+    rank = _rank(zs, _score(entry), member);
+    nrank = _rank(zs, score, member);
+    if (nrank > rank) {
+        nrank--;
+        cc_memmove(by_rank + rank, by_rank + rank + 1,
+                sizeof(uint32_t) * (nrank - rank));
+    } else {
+        cc_memmove(by_rank + nrank + 1, by_rank + nrank,
+                sizeof(uint32_t) * (rank - nrank));
+    }
+    by_rank[nrank] = offset;
+    _set_score(entry, score);
+
+    return ZSET_OK;
+}
+
+zset_rstatus_e
+zset_remove(zset_p zs, const struct bstring *member)
+{
+    uint32_t pos, offset;
+
+    if (zs == NULL || member == NULL) {
+        log_debug("NULL pointer encountered for zs %p or member %p", zs,
+                member);
+
+        return ZSET_ERROR;
+    }
+
+    if (!_locate(&pos, zs, member)) {
+        return ZSET_ENOTFOUND;
+    }
+
+    offset = _by_member(zs)[pos];
+    _remove(zs, offset, _rank(zs, _score(ZS_HEAP(zs) + offset), member), pos);
+
+    return ZSET_OK;
+}
+
+zset_rstatus_e
+zset_remove_rank(zset_p zs, uint32_t rank)
+{
+    struct bstring member;
+    uint32_t pos, offset;
+    bool found;
+
+    if (zs == NULL) {
+        log_debug("NULL pointer encountered for zs");
+
+        return ZSET_ERROR;
+    }
+
+    if (rank >= ZS_NENTRY(zs)) {
+        return ZSET_EOOB;
+    }
+
+    offset = _by_rank(zs)[rank];
+    _member(&member, ZS_HEAP(zs) + offset);
+    found = _locate(&pos, zs, &member);
+    ASSERT(found);
+    _remove(zs, offset, rank, pos);
+
+    return ZSET_OK;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+/* The zset (sorted set) holds unique members, which are byte strings, each with
+ * a score, and orders them by score, then by member for equal scores, with the
+ * same semantics as sorted sets in Redis. Like other data structures here, it
+ * lives in a single contiguous piece of memory (e.g. an item value), and none
+ * of the APIs tries to allocate or free any memory: the caller makes room for
+ * zset_esize bytes before inserting a member.
+ *
+ * Members are kept once, in the order they are inserted, and are reached
+ * through two sorted arrays of their offsets: one ordered by rank, and one by
+ * member. This keeps every lookup, whether by member, by rank or by score, at
+ * O(log N), with updates only moving around 4-byte offsets, and costs much
+ * less memory per member than a skiplist or a tree with pointers, which would
+ * also not survive the memory being moved.
+ *
+ * ----------------------------------------------------------------------------
+ *
+ * ZSET OVERALL LAYOUT
+ * ====================
+ *
+ * <nentry><nbyte> <entry> ... <entry> <offset> ... <offset> <offset> ... <offset>
+ * ╰-------------╯ ╰-----------------╯ ╰-------------------╯ ╰-------------------╯
+ *      header             heap               by rank              by member
+ *
+ * Overhead: 8 bytes
+ *
+ * <uint32_t nentry> is the number of members.
+ * <uint32_t nbyte> is the size of the heap in bytes.
+ *
+ *
+ * ZSET ENTRIES
+ * =============
+ *
+ * <double score><uint16_t len><member>
+ *
+ * Each entry is padded to a multiple of 4 bytes, so the offsets after the heap
+ * stay aligned. Scores are copied in and out, since they are not aligned to 8.
+ *
+ * In addition to the member itself, each member costs 10 bytes of entry header,
+ * 8 bytes of offsets, and up to 3 bytes of padding.
+ *
+ *
+ * RUNTIME
+ * =======
+ *
+ * Finding the score or rank of a member, and the rank of a score, take
+ * O(log N); if the set is small enough (SCAN_THRESHOLD), members are found by
+ * a linear scan instead. The member at a rank is found in O(1).
+ *
+ * Inserting a member moves both arrays of offsets; removing one also moves the
+ * heap after it, and renumbers the offsets past it. Changing the score of a
+ * member only moves the offsets between its old and its new rank.
+ */
+
+#include <cc_bstring.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ZSET_HEADER_SIZE 8
+#define ZSET_MEMBER_MAXLEN UINT16_MAX
+
+typedef char * zset_p;
+
+typedef enum {
+    ZSET_OK,
+    ZSET_ENOTFOUND,  /* member not found error */
+    ZSET_EOOB,       /* out-of-bound error */
+    ZSET_EINVALID,   /* invalid data error */
+    ZSET_EDUP,       /* duplicate member found */
+    ZSET_ERROR,
+    ZSET_SENTINEL
+} zset_rstatus_e;
+
+#define ZS_NENTRY(_zs) (*((uint32_t *)(_zs)))
+#define ZS_NBYTE(_zs) (*((uint32_t *)((_zs) + sizeof(uint32_t))))
+
+/* heap size of the entry of a member of length len */
+#define ZS_ENTRY_SIZE(_len)                                                    \
+    ((sizeof(double) + sizeof(uint16_t) + (_len) + 3) & ~(uint32_t)3)
+
+static inline uint32_t
+zset_nentry(const zset_p zs)
+{
+    return ZS_NENTRY(zs);
+}
+
+static inline uint32_t
+zset_size(const zset_p zs)
+{
+    return ZSET_HEADER_SIZE + ZS_NBYTE(zs) + ZS_NENTRY(zs) * 2 *
+        sizeof(uint32_t);
+}
+
+/* # bytes a zset grows by when member is inserted */
+static inline uint32_t
+zset_esize(const struct bstring *member)
+{
+    return ZS_ENTRY_SIZE(member->len) + 2 * sizeof(uint32_t);
+}
+
+/* initialize an empty zset */
+zset_rstatus_e zset_init(zset_p zs);
+
+/* zset APIs: seek */
+zset_rstatus_e zset_score(double *score, const zset_p zs, const struct bstring *member);
+zset_rstatus_e zset_rank(uint32_t *rank, const zset_p zs, const struct bstring *member);
+zset_rstatus_e zset_entry(double *score, struct bstring *member, const zset_p zs, uint32_t rank);
+/* # members of score below score, or not above it if inclusive */
+uint32_t zset_count_below(const zset_p zs, double score, bool inclusive);
+
+/* zset APIs: modify */
+zset_rstatus_e zset_insert(zset_p zs, const struct bstring *member, double score);
+zset_rstatus_e zset_update(zset_p zs, const struct bstring *member, double score);
+zset_rstatus_e zset_remove(zset_p zs, const struct bstring *member);
+zset_rstatus_e zset_remove_rank(zset_p zs, uint32_t rank);
@@ -12,3 +12,20 @@ void *datapool_addr(struct datapool *pool);
 size_t datapool_size(struct datapool *pool);
 void datapool_set_user_data(const struct datapool *pool, const void *user_data, size_t user_size);
 void datapool_get_user_data(const struct datapool *pool, void *user_data, size_t user_size);
+
+/*
+ * Flush a range of the pool to the persistent media, and fence, so that it is
+ * retained if the process crashes. A no-op for pools which are not backed by
+ * a file.
+ */
+void datapool_persist(const struct datapool *pool, const void *addr, size_t len);
+
+/*
+ * Mark the pool as crash-consistent: the user persists its data in an order
+ * which is consistent at any point, so the pool retains its contents even if
+ * it is not closed correctly.
+ */
+void datapool_set_crash_consistent(struct datapool *pool);
+
+/* whether the pool was not closed correctly before it was opened */
+bool datapool_dirty(const struct datapool *pool);
@@ -28,7 +28,8 @@
 #define DATAPOOL_VERSION 1
 
 #define DATAPOOL_FLAG_DIRTY (1 << 0)
-#define DATAPOOL_VALID_FLAGS (DATAPOOL_FLAG_DIRTY)
+#define DATAPOOL_FLAG_CRASH_CONSISTENT (1 << 1)
+#define DATAPOOL_VALID_FLAGS (DATAPOOL_FLAG_DIRTY | DATAPOOL_FLAG_CRASH_CONSISTENT)
 
 #define PAGE_SIZE 4096
 
@@ -55,10 +56,11 @@ struct datapool {
     size_t mapped_len;
     int is_pmem;
     int file_backed;
+    int dirty;
 };
 
 static void
-datapool_sync_hdr(struct datapool *pool)
+datapool_sync_hdr(const struct datapool *pool)
 {
     int ret = pmem_msync(pool->hdr, DATAPOOL_HEADER_LEN);
     ASSERT(ret == 0);
@@ -111,7 +113,8 @@ datapool_valid(struct datapool *pool)
         return false;
     }
 
-    if (pool->hdr->flags & DATAPOOL_FLAG_DIRTY) {
+    if ((pool->hdr->flags & DATAPOOL_FLAG_DIRTY) &&
+        !(pool->hdr->flags & DATAPOOL_FLAG_CRASH_CONSISTENT)) {
         log_info("datapool has a valid header but is dirty");
         return false;
     }
@@ -222,10 +225,17 @@ datapool_open(const char *path, const char *user_signature, size_t size, int *fr
             *fresh = 1;
         }
 
+        pool->dirty = 0;
         datapool_initialize(pool, user_signature);
     } else if (!datapool_valid_user_signature(pool, user_signature)) {
         log_error("wrong user signature (%s) used for pool", user_signature);
         goto err_map_adr;
+    } else {
+        pool->dirty = (pool->hdr->flags & DATAPOOL_FLAG_DIRTY) != 0;
+        if (pool->dirty) {
+            log_warn("datapool was not closed correctly, recovering it as "
+                "crash-consistent");
+        }
     }
 
     datapool_flag_set(pool, DATAPOOL_FLAG_DIRTY);
@@ -278,6 +288,9 @@ datapool_set_user_data(const struct datapool *pool, const void *user_data, size_
 {
     ASSERT(user_size < DATAPOOL_USER_HEADER_LEN - DATAPOOL_USER_LAYOUT_LEN);
     cc_memcpy(pool->hdr->user_data, user_data, user_size);
+    if (pool->file_backed) {
+        datapool_sync_hdr(pool);
+    }
 }
 
 void
@@ -286,3 +299,32 @@ datapool_get_user_data(const struct datapool *pool, void *user_data, size_t user
     ASSERT(user_size < DATAPOOL_USER_HEADER_LEN - DATAPOOL_USER_LAYOUT_LEN);
     cc_memcpy(user_data, pool->hdr->user_data, user_size);
 }
+
+void
+datapool_persist(const struct datapool *pool, const void *addr, size_t len)
+{
+    if (!pool->file_backed) {
+        return;
+    }
+
+    if (pool->is_pmem) {
+        pmem_persist(addr, len);
+    } else {
+        int ret = pmem_msync(addr, len);
+        ASSERT(ret == 0);
+    }
+}
+
+void
+datapool_set_crash_consistent(struct datapool *pool)
+{
+    if (pool->file_backed) {
+        datapool_flag_set(pool, DATAPOOL_FLAG_CRASH_CONSISTENT);
+    }
+}
+
+bool
+datapool_dirty(const struct datapool *pool)
+{
+    return pool->dirty;
+}
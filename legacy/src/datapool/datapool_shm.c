@@ -1,44 +1,82 @@
 /*
  * Anonymous shared memory backed datapool.
  * Loses all its contents after closing.
+ *
+ * The pool is mapped rather than allocated, so its pages are only faulted in
+ * once touched, unless it is prefaulted when opened. This leaves the user
+ * free to advise on or place the pages before they are faulted in.
  */
 #include "datapool.h"
 
 #include <cc_debug.h>
 #include <cc_mm.h>
 
+#include <unistd.h>
+
+struct datapool {
+    void   *addr;
+    size_t size;
+};
+
 struct datapool *
 datapool_open(const char *path, const char *user_signature, size_t size, int *fresh, bool prefault)
 {
+    struct datapool *pool;
+
     if (path != NULL) {
         log_warn("attempted to open a file-based data pool without"
             "pmem features enabled");
         return NULL;
     }
 
+    pool = cc_alloc(sizeof(*pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    /* anonymous mappings are zeroed */
+    pool->addr = cc_mmap(size);
+    if (pool->addr == NULL) {
+        cc_free(pool);
+        return NULL;
+    }
+    pool->size = size;
+
+    if (prefault) {
+        size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        volatile char *cur_addr = pool->addr;
+        char *addr_end = (char *)pool->addr + size;
+
+        log_info("prefault datapool");
+        for (; cur_addr < addr_end; cur_addr += page_size) {
+            *cur_addr = *cur_addr;
+        }
+    }
+
     if (fresh) {
         *fresh = 1;
     }
 
-    return cc_zalloc(size);
+    return pool;
 }
 
 void
 datapool_close(struct datapool *pool)
 {
+    cc_munmap(pool->addr, pool->size);
     cc_free(pool);
 }
 
 void *
 datapool_addr(struct datapool *pool)
 {
-    return pool;
+    return pool->addr;
 }
 
 size_t
 datapool_size(struct datapool *pool)
 {
-    return cc_alloc_usable_size(pool);
+    return pool->size;
 }
 
 /*
@@ -57,3 +95,21 @@ datapool_get_user_data(const struct datapool *pool, void *user_data, size_t user
 {
     NOT_REACHED();
 }
+
+void
+datapool_persist(const struct datapool *pool, const void *addr, size_t len)
+{
+
+}
+
+void
+datapool_set_crash_consistent(struct datapool *pool)
+{
+
+}
+
+bool
+datapool_dirty(const struct datapool *pool)
+{
+    return false;
+}
@@ -1,83 +1,233 @@
 #include "hotkey.h"
 
 #include "constant.h"
-#include "kc_map.h"
-#include "key_window.h"
+#include "sketch.h"
 
 #include <cc_bstring.h>
 #include <cc_debug.h>
+#include <cc_mm.h>
+#include <cc_print.h>
+#include <cc_util.h>
+
+#include <stdlib.h>
 
 #define HOTKEY_MODULE_NAME "hotkey::hotkey"
 
-bool hotkey_enabled = false;
+/* rows are wide enough to overestimate by well under the threshold */
+#define HOTKEY_WIDTH_FACTOR 16
+
+#define HOTKEY_PRINT_LEN (MAX_KEY_LEN + 40) /* max length of the report of a key */
+#define HOTKEY_FMT "HOTKEY %.*s: count %"PRIu64 CRLF
+
+/* a key as reported, merged over all the threads keeping it */
+struct hotkey_merged {
+    uint64_t                    fp;
+    uint64_t                    count;
+    const struct sketch_entry   *entry;
+};
 
-static uint64_t hotkey_counter;
+bool hotkey_enabled = false;
 
 static bool hotkey_init = false;
 static uint32_t hotkey_window_size = HOTKEY_WINDOW_SIZE;
 static uint32_t hotkey_rate = HOTKEY_RATE;
 static uint32_t hotkey_threshold = HOTKEY_THRESHOLD;
-static uint32_t hotkey_window_size_cur = 0;
+static uint32_t hotkey_ntop = HOTKEY_NTOP;
+static uint32_t nthread = 0;
+static struct sketch **sketches = NULL; /* one for each of the threads */
+static uint32_t njoined = 0;
+
+/* only used by the thread reporting */
+static struct hotkey_merged *merged = NULL;
+
+static __thread struct sketch *local = NULL;
+static __thread bool joined = false;
+static __thread uint64_t hotkey_counter = 0;
 
 void
-hotkey_setup(hotkey_options_st *options)
+hotkey_setup(hotkey_options_st *options, uint32_t n)
 {
+    double ratio = HOTKEY_THRESHOLD_RATIO;
+    uint32_t width, i;
+
     log_info("Set up the %s module", HOTKEY_MODULE_NAME);
 
+    if (hotkey_init) {
+        log_warn("%s has already been setup, overwrite", HOTKEY_MODULE_NAME);
+    }
+
+    hotkey_enabled = false;
     if (options != NULL) {
         hotkey_enabled = option_bool(&options->hotkey_enable);
         hotkey_window_size = option_uint(&options->hotkey_sample_size);
         hotkey_rate = option_uint(&options->hotkey_sample_rate);
-        hotkey_threshold = (uint32_t)(option_fpn(&options->hotkey_threshold_ratio) * hotkey_window_size);
+        ratio = option_fpn(&options->hotkey_threshold_ratio);
+        hotkey_threshold = (uint32_t)(ratio * hotkey_window_size);
+        hotkey_ntop = option_uint(&options->hotkey_ntop);
+    }
+
+    if (!hotkey_enabled) {
+        hotkey_init = true;
+        return;
+    }
+
+    if (hotkey_window_size == 0 || hotkey_rate == 0 || hotkey_ntop == 0) {
+        log_error("hotkey sample size, rate and # keys reported cannot be 0");
+        goto error;
+    }
+
+    width = ratio * hotkey_window_size >= 1 ?
+        (uint32_t)MIN(HOTKEY_WIDTH_FACTOR / ratio, UINT32_MAX) :
+        hotkey_window_size;
+
+    nthread = n;
+    njoined = 0;
+    sketches = cc_zalloc(sizeof(*sketches) * nthread);
+    merged = cc_alloc(sizeof(*merged) * nthread * hotkey_ntop);
+    if (sketches == NULL || merged == NULL) {
+        goto error;
+    }
+    for (i = 0; i < nthread; ++i) {
+        sketches[i] = sketch_create(width, hotkey_window_size, hotkey_ntop);
+        if (sketches[i] == NULL) {
+            goto error;
+        }
     }
 
-    hotkey_window_size_cur = 0;
-    hotkey_counter = 0;
-    key_window_setup(hotkey_window_size);
-    /* TODO: determine whether table size should be a tunable parameter */
-    kc_map_setup(hotkey_window_size, hotkey_window_size);
     hotkey_init = true;
+
+    return;
+
+error:
+    log_error("cannot set up hotkey detection for %"PRIu32" threads, hotkeys "
+            "are not detected", n);
+    hotkey_teardown();
 }
 
 void
 hotkey_teardown(void)
 {
+    uint32_t i;
+
     log_info("Tear down the %s module", HOTKEY_MODULE_NAME);
 
     if (!hotkey_init) {
         log_warn("%s was not setup", HOTKEY_MODULE_NAME);
-        return;
     }
 
+    if (sketches != NULL) {
+        for (i = 0; i < nthread; ++i) {
+            sketch_destroy(&sketches[i]);
+        }
+        cc_free(sketches);
+        sketches = NULL;
+    }
+    cc_free(merged);
+    merged = NULL;
     hotkey_enabled = false;
-    key_window_teardown();
-    kc_map_teardown();
+    nthread = 0;
     hotkey_init = false;
 }
 
+/* the thread takes the next sketch, if there is one left */
+static void
+_hotkey_join(void)
+{
+    uint32_t idx = __atomic_fetch_add(&njoined, 1, __ATOMIC_RELAXED);
+
+    joined = true;
+    if (idx >= nthread) {
+        log_warn("hotkeys of thread %"PRIu32" not detected, only %"PRIu32
+                " threads are", idx, nthread);
+        return;
+    }
+
+    local = sketches[idx];
+}
+
 bool
 hotkey_sample(const struct bstring *key)
 {
-    if (++hotkey_counter % hotkey_rate == 0) {
-        /* sample this key */
-        uint32_t freq;
+    if (!joined) {
+        _hotkey_join();
+    }
 
-        if (key_window_len() == hotkey_window_size) {
-            char buf[MAX_KEY_LEN];
-            struct bstring popped;
+    if (local == NULL) {
+        return false;
+    }
 
-            popped.data = buf;
+    if (hotkey_rate > 1 && ++hotkey_counter % hotkey_rate != 0) {
+        return false;
+    }
+
+    return sketch_incr(local, key) >= hotkey_threshold;
+}
+
+size_t
+hotkey_print_cap(void)
+{
+    return hotkey_enabled ? HOTKEY_PRINT_LEN * hotkey_ntop : 0;
+}
+
+static int
+_compare_fp(const void *a, const void *b)
+{
+    const struct hotkey_merged *x = a, *y = b;
 
-            /* pop from key_window, decrement in counter table */
-            popped.len = key_window_pop(popped.data);
-            kc_map_decr(&popped);
+    return (x->fp > y->fp) - (x->fp < y->fp);
+}
+
+static int
+_compare_count(const void *a, const void *b)
+{
+    const struct hotkey_merged *x = a, *y = b;
+
+    return (x->count < y->count) - (x->count > y->count);
+}
+
+size_t
+hotkey_print(char *buf, size_t cap)
+{
+    size_t offset = 0;
+    uint32_t n = 0, m, i, j;
+
+    if (!hotkey_enabled) {
+        return 0;
+    }
+
+    /*
+     * threads keep sampling while their keys are read, so a key may be
+     * reported with a count that is slightly off
+     */
+    for (i = 0; i < nthread; ++i) {
+        struct sketch *sk = sketches[i];
+        uint32_t nentry = MIN(sk->nentry, sk->ntop);
+
+        for (j = 0; j < nentry; ++j) {
+            merged[n].fp = sk->fp[j];
+            merged[n].count = sk->top[j].count;
+            merged[n].entry = &sk->top[j];
+            n++;
         }
+    }
+
+    /* add up the counts of a key kept by more than one thread */
+    qsort(merged, n, sizeof(*merged), _compare_fp);
+    for (m = 0, i = 0; i < n; ++i) {
+        if (m > 0 && merged[m - 1].fp == merged[i].fp) {
+            merged[m - 1].count += merged[i].count;
+        } else {
+            merged[m++] = merged[i];
+        }
+    }
 
-        key_window_push(key);
-        freq = kc_map_incr(key);
+    qsort(merged, m, sizeof(*merged), _compare_count);
+    for (i = 0; i < MIN(m, hotkey_ntop); ++i) {
+        const struct sketch_entry *e = merged[i].entry;
 
-        return freq >= hotkey_threshold;
+        offset += cc_scnprintf(buf + offset, cap - offset, HOTKEY_FMT,
+                (int)MIN(e->klen, MAX_KEY_LEN), e->key, merged[i].count);
     }
 
-    return false;
+    return offset;
 }
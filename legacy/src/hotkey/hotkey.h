@@ -3,21 +3,32 @@
 #include <cc_option.h>
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/*
+ * Keys sampled by a thread are counted in its own sketch (see sketch.h), which
+ * only the thread itself writes to, so sampling takes no lock and copies no
+ * key unless it becomes one of the hottest. A thread is given its sketch the
+ * first time it samples a key. The hottest keys of all threads are merged
+ * when they are reported.
+ */
+
 /* TODO(kevyang): add stats for hotkey module */
 
-#define HOTKEY_WINDOW_SIZE     10000 /* keep last 10000 keys sampled by default */
-#define HOTKEY_RATE            100   /* sample one in every 100 keys by default */
+#define HOTKEY_WINDOW_SIZE     10000 /* counts decay by half every 10000 keys sampled by default */
+#define HOTKEY_RATE            1     /* sample every key by default */
 #define HOTKEY_THRESHOLD_RATIO 0.01  /* signal hotkey if key takes up >= 0.01 of all keys by default */
 #define HOTKEY_THRESHOLD       (uint32_t)(HOTKEY_THRESHOLD_RATIO * HOTKEY_WINDOW_SIZE)
+#define HOTKEY_NTOP            16    /* report the 16 hottest keys by default */
 
 /*          name                    type                default                 description */
 #define HOTKEY_OPTION(ACTION)                                                                                 \
     ACTION( hotkey_enable,          OPTION_TYPE_BOOL,   false,                  "use hotkey detection?"      )\
-    ACTION( hotkey_sample_size,     OPTION_TYPE_UINT,   HOTKEY_WINDOW_SIZE,     "number of keys to maintain" )\
+    ACTION( hotkey_sample_size,     OPTION_TYPE_UINT,   HOTKEY_WINDOW_SIZE,     "# samples counts decay over")\
     ACTION( hotkey_sample_rate,     OPTION_TYPE_UINT,   HOTKEY_RATE,            "hotkey sample ratio"        )\
-    ACTION( hotkey_threshold_ratio, OPTION_TYPE_FPN,    HOTKEY_THRESHOLD_RATIO, "threshold for hotkey signal")
+    ACTION( hotkey_threshold_ratio, OPTION_TYPE_FPN,    HOTKEY_THRESHOLD_RATIO, "threshold for hotkey signal")\
+    ACTION( hotkey_ntop,            OPTION_TYPE_UINT,   HOTKEY_NTOP,            "# hottest keys to report"   )
 
 typedef struct {
     HOTKEY_OPTION(OPTION_DECLARE)
@@ -25,6 +36,11 @@ typedef struct {
 
 extern bool hotkey_enabled;
 
-void hotkey_setup(hotkey_options_st *options);
+/* nthread threads can sample keys */
+void hotkey_setup(hotkey_options_st *options, uint32_t nthread);
 void hotkey_teardown(void);
 bool hotkey_sample(const struct bstring *key);
+
+/* print the hottest keys, merged over all threads */
+size_t hotkey_print(char *buf, size_t cap);
+size_t hotkey_print_cap(void); /* the most hotkey_print may print */
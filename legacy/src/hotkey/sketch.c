@@ -0,0 +1,188 @@
+#include "sketch.h"
+
+#include <cc_bstring.h>
+#include <cc_debug.h>
+#include <cc_mm.h>
+#include <cc_util.h>
+
+#define XXH_INLINE_ALL
+#include <hash/xxhash.h>
+
+#define SKETCH_WIDTH_MAX (1U << 20)
+
+struct sketch *
+sketch_create(uint32_t width, uint32_t window, uint32_t ntop)
+{
+    struct sketch *sk;
+    uint32_t w = 1;
+
+    ASSERT(window > 0 && ntop > 0);
+
+    while (w < width && w < SKETCH_WIDTH_MAX) {
+        w <<= 1;
+    }
+
+    sk = cc_zalloc(sizeof(*sk));
+    if (sk == NULL) {
+        return NULL;
+    }
+    sk->width = w;
+    sk->window = window;
+    sk->ntop = ntop;
+    sk->counter = cc_zalloc(sizeof(*sk->counter) * SKETCH_DEPTH * w);
+    sk->fp = cc_zalloc(sizeof(*sk->fp) * ntop);
+    sk->top = cc_zalloc(sizeof(*sk->top) * ntop);
+    if (sk->counter == NULL || sk->fp == NULL || sk->top == NULL) {
+        sketch_destroy(&sk);
+        return NULL;
+    }
+
+    return sk;
+}
+
+void
+sketch_destroy(struct sketch **sketch)
+{
+    struct sketch *sk = *sketch;
+
+    if (sk == NULL) {
+        return;
+    }
+
+    cc_free(sk->counter);
+    cc_free(sk->fp);
+    cc_free(sk->top);
+    cc_free(sk);
+    *sketch = NULL;
+}
+
+void
+sketch_reset(struct sketch *sk)
+{
+    cc_memset(sk->counter, 0, sizeof(*sk->counter) * SKETCH_DEPTH * sk->width);
+    sk->nsample = 0;
+    sk->nentry = 0;
+    sk->min = 0;
+}
+
+/* the counter of key in each row, derived from two halves of its hash */
+static inline void
+_locate(uint32_t **counter, const struct sketch *sk, uint64_t hv)
+{
+    uint32_t h1 = (uint32_t)hv, h2 = (uint32_t)(hv >> 32) | 1;
+    uint32_t i;
+
+    for (i = 0; i < SKETCH_DEPTH; ++i) {
+        counter[i] = &sk->counter[i * sk->width + ((h1 + i * h2) &
+                (sk->width - 1))];
+    }
+}
+
+static inline void
+_find_min(struct sketch *sk)
+{
+    uint32_t i;
+
+    sk->min = 0;
+    for (i = 1; i < sk->nentry; ++i) {
+        if (sk->top[i].count < sk->top[sk->min].count) {
+            sk->min = i;
+        }
+    }
+}
+
+static inline void
+_top_update(struct sketch *sk, uint64_t fp, const struct bstring *key,
+        uint32_t count)
+{
+    uint32_t i;
+
+    /*
+     * a key kept was last counted at least at the lowest count, and its
+     * estimate has grown since, so most keys sampled can be skipped early
+     */
+    if (sk->nentry == sk->ntop && count <= sk->top[sk->min].count) {
+        return;
+    }
+
+    for (i = 0; i < sk->nentry; ++i) {
+        if (sk->fp[i] == fp) {
+            sk->top[i].count = count;
+            if (i == sk->min) {
+                _find_min(sk);
+            }
+            return;
+        }
+    }
+
+    if (sk->nentry < sk->ntop) {
+        i = sk->nentry++;
+    } else if (count > sk->top[sk->min].count) {
+        i = sk->min;
+    } else {
+        return;
+    }
+
+    sk->fp[i] = fp;
+    sk->top[i].count = count;
+    sk->top[i].klen = MIN(key->len, MAX_KEY_LEN);
+    cc_memcpy(sk->top[i].key, key->data, sk->top[i].klen);
+    _find_min(sk);
+}
+
+static void
+_decay(struct sketch *sk)
+{
+    uint32_t i;
+
+    for (i = 0; i < SKETCH_DEPTH * sk->width; ++i) {
+        sk->counter[i] >>= 1;
+    }
+    for (i = 0; i < sk->nentry; ++i) {
+        sk->top[i].count >>= 1;
+    }
+    sk->nsample = 0;
+}
+
+uint32_t
+sketch_incr(struct sketch *sk, const struct bstring *key)
+{
+    uint64_t hv = XXH3_64bits(key->data, key->len);
+    uint32_t *counter[SKETCH_DEPTH];
+    uint32_t est = UINT32_MAX, i;
+
+    _locate(counter, sk, hv);
+    for (i = 0; i < SKETCH_DEPTH; ++i) {
+        est = MIN(est, *counter[i]);
+    }
+
+    /* conservative update: only raise the counters that were the lowest */
+    est++;
+    for (i = 0; i < SKETCH_DEPTH; ++i) {
+        if (*counter[i] < est) {
+            *counter[i] = est;
+        }
+    }
+
+    _top_update(sk, hv, key, est);
+
+    if (++sk->nsample == sk->window) {
+        _decay(sk);
+    }
+
+    return est;
+}
+
+uint32_t
+sketch_estimate(const struct sketch *sk, const struct bstring *key)
+{
+    uint32_t *counter[SKETCH_DEPTH];
+    uint32_t est = UINT32_MAX, i;
+
+    _locate(counter, sk, XXH3_64bits(key->data, key->len));
+    for (i = 0; i < SKETCH_DEPTH; ++i) {
+        est = MIN(est, *counter[i]);
+    }
+
+    return est;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "constant.h"
+
+#include <stdint.h>
+
+/*
+ * The sketch module counts how often keys are sampled in a fixed amount of
+ * memory, and keeps the keys counted the most. Counting is done in a count-min
+ * sketch: each key is hashed to one counter in each of SKETCH_DEPTH rows, and
+ * its count is estimated as the smallest of them. With conservative update,
+ * only the counters at that smallest value are incremented, which keeps the
+ * estimate from growing faster than the true count. Estimates never count a
+ * key less than it was sampled, and may count it more by a fraction of the
+ * samples taken that shrinks with the width of the rows.
+ *
+ * Next to the sketch, the ntop keys with the highest estimates are kept as in
+ * the Space-Saving algorithm: a key replaces the one with the lowest estimate
+ * when its own estimate gets higher. The 64-bit hash of a key doubles as its
+ * fingerprint, so only keys entering the top are ever copied.
+ *
+ * Counts decay by half every window samples, so keys that are no longer
+ * sampled age out. A key that takes up a fraction f of the samples is then
+ * estimated at between f * window and 2 * f * window.
+ *
+ * A sketch is not thread-safe, each thread is expected to keep its own.
+ */
+
+#define SKETCH_DEPTH 4
+
+struct sketch_entry {
+    uint32_t    count;
+    uint32_t    klen;
+    char        key[MAX_KEY_LEN];
+};
+
+struct sketch {
+    uint32_t            width;      /* # counters per row, a power of 2 */
+    uint32_t            window;     /* # samples between decays */
+    uint32_t            nsample;    /* # samples since the last decay */
+    uint32_t            ntop;       /* max # keys kept */
+    uint32_t            nentry;     /* # keys kept */
+    uint32_t            min;        /* entry with the lowest count */
+    uint32_t            *counter;   /* SKETCH_DEPTH rows of width counters */
+    uint64_t            *fp;        /* fingerprints of the keys kept */
+    struct sketch_entry *top;       /* keys kept, in no particular order */
+};
+
+struct bstring;
+
+/* width is rounded up to a power of 2 */
+struct sketch *sketch_create(uint32_t width, uint32_t window, uint32_t ntop);
+void sketch_destroy(struct sketch **sketch);
+void sketch_reset(struct sketch *sk);
+
+/* count a sample of key, and return its estimated count */
+uint32_t sketch_incr(struct sketch *sk, const struct bstring *key);
+/* estimated count of key, without sampling it */
+uint32_t sketch_estimate(const struct sketch *sk, const struct bstring *key);
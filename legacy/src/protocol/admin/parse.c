@@ -43,6 +43,14 @@ _get_req_type(struct request *req, struct bstring *type)
 
         break;
 
+    case 6:
+        if (str6cmp(type->data, 'r', 'e', 'l', 'o', 'a', 'd')) {
+            req->type = REQ_RELOAD;
+            break;
+        }
+
+        break;
+
     case 7:
         if (str7cmp(type->data, 'v', 'e', 'r', 's', 'i', 'o', 'n')) {
             req->type = REQ_VERSION;
@@ -25,6 +25,7 @@
     ACTION( REQ_UNKNOWN,       ""          )\
     ACTION( REQ_STATS,         "stats"     )\
     ACTION( REQ_VERSION,       "version"   )\
+    ACTION( REQ_RELOAD,        "reload"    )\
     ACTION( REQ_QUIT,          "quit"      )
 
 #define GET_TYPE(_name, _str) _name,
@@ -0,0 +1,65 @@
+#pragma once
+
+/*
+ * The memcached binary protocol. Every request and response starts with a
+ * fixed size header, which holds the lengths of the extras, key and value that
+ * follow it in the body. A request starts with a magic byte that never starts
+ * a text command, so both protocols are served on the same port.
+ *
+ * Binary requests are parsed into the same request types as text commands,
+ * and their responses are composed from the same response objects. The quiet
+ * opcodes only respond when there is something the client needs to know, so
+ * that they can be pipelined and ended with a noop.
+ */
+
+#define BIN_HEADER_LEN          24
+
+#define BIN_REQ_MAGIC           0x80
+#define BIN_RSP_MAGIC           0x81
+
+/* extras of a storage command: flag and expiry */
+#define BIN_STORE_EXTRAS_LEN    8
+/* extras of an arithmetic command: delta, initial value and expiry */
+#define BIN_DELTA_EXTRAS_LEN    20
+/* extras of a get response: flag */
+#define BIN_GET_EXTRAS_LEN      4
+
+/* incr and decr with this expiry do not create missing keys */
+#define BIN_NO_VIVIFY           0xffffffff
+
+#define BIN_OP_GET              0x00
+#define BIN_OP_SET              0x01
+#define BIN_OP_ADD              0x02
+#define BIN_OP_REPLACE          0x03
+#define BIN_OP_DELETE           0x04
+#define BIN_OP_INCR             0x05
+#define BIN_OP_DECR             0x06
+#define BIN_OP_QUIT             0x07
+#define BIN_OP_FLUSH            0x08
+#define BIN_OP_GETQ             0x09
+#define BIN_OP_NOOP             0x0a
+#define BIN_OP_VERSION          0x0b
+#define BIN_OP_GETK             0x0c
+#define BIN_OP_GETKQ            0x0d
+#define BIN_OP_APPEND           0x0e
+#define BIN_OP_PREPEND          0x0f
+#define BIN_OP_SETQ             0x11
+#define BIN_OP_ADDQ             0x12
+#define BIN_OP_REPLACEQ         0x13
+#define BIN_OP_DELETEQ          0x14
+#define BIN_OP_INCRQ            0x15
+#define BIN_OP_DECRQ            0x16
+#define BIN_OP_QUITQ            0x17
+#define BIN_OP_FLUSHQ           0x18
+#define BIN_OP_APPENDQ          0x19
+#define BIN_OP_PREPENDQ         0x1a
+
+#define BIN_STATUS_OK           0x0000
+#define BIN_STATUS_ENOENT       0x0001
+#define BIN_STATUS_EEXISTS      0x0002
+#define BIN_STATUS_E2BIG        0x0003
+#define BIN_STATUS_EINVAL       0x0004
+#define BIN_STATUS_NOT_STORED   0x0005
+#define BIN_STATUS_DELTA_BADVAL 0x0006
+#define BIN_STATUS_UNKNOWN_CMD  0x0081
+#define BIN_STATUS_ENOMEM       0x0082
@@ -1,9 +1,11 @@
 #include "compose.h"
 
+#include "binary.h"
 #include "request.h"
 #include "response.h"
 #include "time/time.h"
 
+#include <cc_array.h>
 #include <cc_debug.h>
 #include <cc_print.h>
 
@@ -63,6 +65,30 @@ _check_buf_size(struct buf **buf, uint32_t n)
     return CC_OK;
 }
 
+/*
+ * new content goes to the last buffer in the chain, which another buffer is
+ * chained after if it holds data and runs out of room for the n bytes,
+ * so that what is already written is not copied to grow the buffer
+ */
+static inline struct buf **
+_buf_tail(struct buf **buf, uint32_t n)
+{
+    buf = buf_chain_tail(buf);
+    /* a buf referring to a value has no room of its own and cannot grow */
+    if (n > buf_wsize(*buf) && ((buf_rsize(*buf) > 0 &&
+            n <= buf_init_size - BUF_HDR_SIZE) || (*buf)->release != NULL)) {
+        if (buf_chain_extend(*buf) == NULL) {
+            log_debug("failed to write %u bytes to buf %p: cannot chain "
+                    "another buf", n, *buf);
+
+            return NULL;
+        }
+        buf = &(*buf)->chain;
+    }
+
+    return (_check_buf_size(buf, n) == COMPOSE_OK) ? buf : NULL;
+}
+
 static inline int
 _write_uint64(struct buf **buf, uint64_t val)
 {
@@ -95,6 +121,31 @@ _write_bstring(struct buf **buf, const struct bstring *str)
     return buf_write(*buf, str->data, str->len);
 }
 
+/*
+ * a value goes to as many buffers chained after the last one as it takes,
+ * instead of growing a buffer to hold it whole
+ */
+static inline int
+_write_value(struct buf **buf, const struct bstring *str)
+{
+    uint32_t n;
+
+    buf = buf_chain_tail(buf);
+    n = buf_write(*buf, str->data, str->len);
+    while (n < str->len) {
+        if (buf_chain_extend(*buf) == NULL) {
+            log_debug("failed to write %u bytes to buf %p: cannot chain "
+                    "another buf", str->len - n, *buf);
+
+            return COMPOSE_ENOMEM;
+        }
+        buf = &(*buf)->chain;
+        n += buf_write(*buf, str->data + n, str->len - n);
+    }
+
+    return n;
+}
+
 static inline int
 _delim(struct buf **buf)
 {
@@ -130,7 +181,7 @@ compose_req(struct buf **buf, const struct request *req)
     switch (type) {
     case REQ_FLUSH:
     case REQ_QUIT:
-        if (_check_buf_size(buf, str->len) != COMPOSE_OK) {
+        if ((buf = _buf_tail(buf, str->len)) == NULL) {
             goto error;
         }
         n += _write_bstring(buf, str);
@@ -142,7 +193,7 @@ compose_req(struct buf **buf, const struct request *req)
             key = array_get(req->keys, i);
             sz += 1 + key->len;
         }
-        if (_check_buf_size(buf, str->len + sz + CRLF_LEN) != COMPOSE_OK) {
+        if ((buf = _buf_tail(buf, str->len + sz + CRLF_LEN)) == NULL) {
             goto error;
         }
         n += _write_bstring(buf, str);
@@ -154,8 +205,8 @@ compose_req(struct buf **buf, const struct request *req)
         break;
 
     case REQ_DELETE:
-        if (_check_buf_size(buf, str->len + key->len + noreply_len + CRLF_LEN)
-                != COMPOSE_OK) {
+        if ((buf = _buf_tail(buf, str->len + key->len + noreply_len + CRLF_LEN))
+                == NULL) {
             goto error;
         }
         n += _write_bstring(buf, str);
@@ -173,11 +224,11 @@ compose_req(struct buf **buf, const struct request *req)
     case REQ_PREPEND:
     case REQ_CAS:
         /* here we may overestimate the size of message header because we
-         * estimate the int size based on max value
+         * estimate the int size based on max value, the value is written
+         * separately as it may need more buffers
          */
-        if (_check_buf_size(buf, str->len + key->len + CC_UINT32_MAXLEN * 3 +
-                    cas_len + req->vstr.len + noreply_len + CRLF_LEN * 2)
-                != COMPOSE_OK) {
+        if ((buf = _buf_tail(buf, str->len + key->len + CC_UINT32_MAXLEN * 3 +
+                    cas_len + noreply_len + CRLF_LEN)) == NULL) {
             goto error;
         }
         n += _write_bstring(buf, str);
@@ -196,14 +247,18 @@ compose_req(struct buf **buf, const struct request *req)
             n += _noreply(buf);
         }
         n += _crlf(buf);
-        n += _write_bstring(buf, &req->vstr);
+        if ((sz = _write_value(buf, &req->vstr)) < 0 ||
+                (buf = _buf_tail(buf, CRLF_LEN)) == NULL) {
+            goto error;
+        }
+        n += sz;
         n += _crlf(buf);
         break;
 
     case REQ_INCR:
     case REQ_DECR:
-        if (_check_buf_size(buf, str->len + key->len + CC_UINT64_MAXLEN +
-                    noreply_len + CRLF_LEN) != COMPOSE_OK) {
+        if ((buf = _buf_tail(buf, str->len + key->len + CC_UINT64_MAXLEN +
+                    noreply_len + CRLF_LEN)) == NULL) {
             goto error;
         }
         n += _write_bstring(buf, str);
@@ -235,10 +290,32 @@ error:
  * response specific functions
  */
 
+/* the header of a VALUE response is written in full after a size check */
+static inline int
+_write_value_header(struct buf **buf, const struct response *rsp,
+        uint32_t vlen)
+{
+    int n = 0;
+
+    n += _write_bstring(buf, &rsp_strings[RSP_VALUE]);
+    n += _write_bstring(buf, &rsp->key);
+    n += _delim(buf);
+    n += _write_uint64(buf, rsp->flag);
+    n += _delim(buf);
+    n += _write_uint64(buf, vlen);
+    if (rsp->cas) {
+        n += _delim(buf);
+        n += _write_uint64(buf, rsp->vcas);
+    }
+    n += _crlf(buf);
+
+    return n;
+}
+
 int
 compose_rsp(struct buf **buf, const struct response *rsp)
 {
-    int n = 0;
+    int sz, n = 0;
     uint32_t vlen;
     response_type_t type = rsp->type;
     struct bstring *str = &rsp_strings[type];
@@ -269,7 +346,7 @@ compose_rsp(struct buf **buf, const struct response *rsp)
     case RSP_DELETED:
     case RSP_NOT_FOUND:
     case RSP_NOT_STORED:
-        if (_check_buf_size(buf, str->len) != COMPOSE_OK) {
+        if ((buf = _buf_tail(buf, str->len)) == NULL) {
             goto error;
         }
         n += _write_bstring(buf, str);
@@ -278,8 +355,8 @@ compose_rsp(struct buf **buf, const struct response *rsp)
 
     case RSP_CLIENT_ERROR:
     case RSP_SERVER_ERROR:
-        if (_check_buf_size(buf, str->len + rsp->vstr.len + CRLF_LEN) !=
-                COMPOSE_OK) {
+        if ((buf = _buf_tail(buf, str->len + rsp->vstr.len + CRLF_LEN)) ==
+                NULL) {
             goto error;
         }
         n += _write_bstring(buf, str);
@@ -290,7 +367,7 @@ compose_rsp(struct buf **buf, const struct response *rsp)
 
     case RSP_NUMERIC:
         /* the **_MAXLEN constants include an extra byte for delimiter */
-        if (_check_buf_size(buf, CC_UINT64_MAXLEN + CRLF_LEN) != COMPOSE_OK) {
+        if ((buf = _buf_tail(buf, CC_UINT64_MAXLEN + CRLF_LEN)) == NULL) {
             goto error;
         }
         n += _write_uint64(buf, rsp->vint);
@@ -305,25 +382,22 @@ compose_rsp(struct buf **buf, const struct response *rsp)
             vlen = rsp->vstr.len;
         }
 
-        if (_check_buf_size(buf, str->len + rsp->key.len + CC_UINT32_MAXLEN * 2
-                    + cas_len + vlen + CRLF_LEN * 2) != COMPOSE_OK) {
+        /* a value that is not a number is written separately, as it may
+         * need more buffers
+         */
+        if ((buf = _buf_tail(buf, str->len + rsp->key.len + CC_UINT32_MAXLEN * 2
+                    + cas_len + (rsp->num ? vlen : 0) + CRLF_LEN * 2)) == NULL) {
             goto error;
         }
-        n += _write_bstring(buf, str);
-        n += _write_bstring(buf, &rsp->key);
-        n += _delim(buf);
-        n += _write_uint64(buf, rsp->flag);
-        n += _delim(buf);
-        n += _write_uint64(buf, vlen);
-        if (rsp->cas) {
-            n += _delim(buf);
-            n += _write_uint64(buf, rsp->vcas);
-        }
-        n += _crlf(buf);
+        n += _write_value_header(buf, rsp, vlen);
         if (rsp->num) {
             n += _write_uint64(buf, rsp->vint);
         } else {
-            n += _write_bstring(buf, &rsp->vstr);
+            if ((sz = _write_value(buf, &rsp->vstr)) < 0 ||
+                    (buf = _buf_tail(buf, CRLF_LEN)) == NULL) {
+                goto error;
+            }
+            n += sz;
         }
         n += _crlf(buf);
         log_verb("response type %d, total length %d", rsp->type, n);
@@ -343,3 +417,230 @@ error:
 
     return CC_ENOMEM;
 }
+
+int
+compose_rsp_ref(struct buf **buf, const struct response *rsp,
+        buf_release_fn release, void *ref)
+{
+    int n = 0;
+    struct bstring *str = &rsp_strings[RSP_VALUE];
+    int cas_len = rsp->cas * CC_UINT64_MAXLEN;
+
+    ASSERT(rsp->type == RSP_VALUE && !rsp->num);
+
+    log_verb("composing rsp into buf %p referring to the value of rsp object "
+            "%p", *buf, rsp);
+
+    if ((buf = _buf_tail(buf, str->len + rsp->key.len + CC_UINT32_MAXLEN * 2
+                + cas_len + CRLF_LEN)) == NULL) {
+        release(ref);
+        goto error;
+    }
+    n += _write_value_header(buf, rsp, rsp->vstr.len);
+    if (buf_chain_ref(*buf, rsp->vstr.data, rsp->vstr.len, release, ref) ==
+            NULL || (buf = _buf_tail(buf, CRLF_LEN)) == NULL) {
+        goto error;
+    }
+    n += rsp->vstr.len;
+    n += _crlf(buf);
+    log_verb("response type %d, total length %d", rsp->type, n);
+
+    INCR(compose_rsp_metrics, response_compose);
+
+    return n;
+
+error:
+    INCR(compose_rsp_metrics, response_compose_ex);
+
+    return CC_ENOMEM;
+}
+
+/*
+ * binary response specific functions
+ */
+
+static inline void
+_write_bin_uint16(uint8_t *p, uint16_t val)
+{
+    p[0] = val >> 8;
+    p[1] = val;
+}
+
+static inline void
+_write_bin_uint32(uint8_t *p, uint32_t val)
+{
+    p[0] = val >> 24;
+    p[1] = val >> 16;
+    p[2] = val >> 8;
+    p[3] = val;
+}
+
+static inline void
+_write_bin_uint64(uint8_t *p, uint64_t val)
+{
+    _write_bin_uint32(p, val >> 32);
+    _write_bin_uint32(p + 4, val);
+}
+
+static uint16_t
+_bin_status(const struct request *req, const struct response *rsp)
+{
+    if (req->opcode == BIN_OP_NOOP || req->opcode == BIN_OP_VERSION) {
+        return BIN_STATUS_OK;
+    }
+    if (req->type == REQ_UNKNOWN) {
+        return BIN_STATUS_UNKNOWN_CMD;
+    }
+
+    switch (rsp->type) {
+    case RSP_OK:
+    case RSP_VALUE:
+    case RSP_STORED:
+    case RSP_DELETED:
+    case RSP_NUMERIC:
+        return BIN_STATUS_OK;
+
+    case RSP_END:
+    case RSP_NOT_FOUND:
+        return BIN_STATUS_ENOENT;
+
+    case RSP_EXISTS:
+        return BIN_STATUS_EEXISTS;
+
+    /* the binary protocol reports why a store was refused */
+    case RSP_NOT_STORED:
+        if (req->type == REQ_ADD) {
+            return BIN_STATUS_EEXISTS;
+        }
+        if (req->type == REQ_REPLACE) {
+            return BIN_STATUS_ENOENT;
+        }
+        return BIN_STATUS_NOT_STORED;
+
+    case RSP_CLIENT_ERROR:
+        if (req->type == REQ_INCR || req->type == REQ_DECR) {
+            return BIN_STATUS_DELTA_BADVAL;
+        }
+        return req->val ? BIN_STATUS_E2BIG : BIN_STATUS_EINVAL;
+
+    default:
+        return BIN_STATUS_ENOMEM;
+    }
+}
+
+static struct bstring
+_bin_status_msg(uint16_t status)
+{
+    switch (status) {
+    case BIN_STATUS_ENOENT:
+        return str2bstr("Not found");
+    case BIN_STATUS_EEXISTS:
+        return str2bstr("Data exists for key");
+    case BIN_STATUS_E2BIG:
+        return str2bstr("Too large");
+    case BIN_STATUS_EINVAL:
+        return str2bstr("Invalid arguments");
+    case BIN_STATUS_NOT_STORED:
+        return str2bstr("Not stored");
+    case BIN_STATUS_DELTA_BADVAL:
+        return str2bstr("Non-numeric server-side value for incr or decr");
+    case BIN_STATUS_UNKNOWN_CMD:
+        return str2bstr("Unknown command");
+    default:
+        return str2bstr("Out of memory");
+    }
+}
+
+/* the quiet opcodes only respond on a failure, except for the gets, which only
+ * respond on a hit
+ */
+static inline bool
+_bin_hidden(uint8_t opcode, uint16_t status)
+{
+    if (opcode == BIN_OP_GETQ || opcode == BIN_OP_GETKQ) {
+        return status == BIN_STATUS_ENOENT;
+    }
+
+    return opcode >= BIN_OP_SETQ && opcode <= BIN_OP_PREPENDQ &&
+        status == BIN_STATUS_OK;
+}
+
+int
+compose_bin_rsp(struct buf **buf, const struct request *req,
+        const struct response *rsp)
+{
+    uint8_t header[BIN_HEADER_LEN] = { 0 };
+    uint8_t extras[BIN_GET_EXTRAS_LEN];
+    uint8_t number[sizeof(uint64_t)];
+    char digits[CC_UINT64_MAXLEN];
+    uint16_t status = _bin_status(req, rsp);
+    struct bstring key = null_bstring;
+    struct bstring val = null_bstring;
+    uint8_t elen = 0;
+    uint32_t n;
+
+    log_verb("composing binary rsp into buf %p from rsp object %p", *buf, rsp);
+
+    if (_bin_hidden(req->opcode, status)) {
+        return 0;
+    }
+
+    if (req->opcode == BIN_OP_GETK || req->opcode == BIN_OP_GETKQ) {
+        key = *(struct bstring *)array_first(req->keys);
+    }
+
+    if (status != BIN_STATUS_OK) {
+        /* a miss on a get which returns the key carries only the key */
+        if (key.len == 0) {
+            val = _bin_status_msg(status);
+        }
+    } else if (req->type == REQ_GETS) {
+        _write_bin_uint32(extras, rsp->flag);
+        elen = BIN_GET_EXTRAS_LEN;
+        if (rsp->num) {
+            val.len = cc_print_uint64_unsafe(digits, rsp->vint);
+            val.data = digits;
+        } else {
+            val = rsp->vstr;
+        }
+    } else if (req->type == REQ_INCR || req->type == REQ_DECR) {
+        /* the new value is returned as an integer rather than as digits */
+        _write_bin_uint64(number, rsp->vint);
+        val.len = sizeof(number);
+        val.data = (char *)number;
+    } else if (req->opcode == BIN_OP_VERSION) {
+        val = str2bstr(VERSION_STRING);
+    }
+
+    header[0] = BIN_RSP_MAGIC;
+    header[1] = req->opcode;
+    _write_bin_uint16(header + 2, key.len);
+    header[4] = elen;
+    _write_bin_uint16(header + 6, status);
+    _write_bin_uint32(header + 8, elen + key.len + val.len);
+    _write_bin_uint32(header + 12, req->opaque);
+    _write_bin_uint64(header + 16, (req->type == REQ_GETS) ? rsp->vcas : 0);
+
+    n = BIN_HEADER_LEN + elen + key.len + val.len;
+    if ((buf = _buf_tail(buf, n - val.len)) == NULL) {
+        goto error;
+    }
+    buf_write(*buf, (char *)header, BIN_HEADER_LEN);
+    buf_write(*buf, (char *)extras, elen);
+    _write_bstring(buf, &key);
+    if (_write_value(buf, &val) < 0) {
+        goto error;
+    }
+
+    log_verb("binary response opcode %"PRIu8", status %"PRIu16", total length %"
+            PRIu32, req->opcode, status, n);
+
+    INCR(compose_rsp_metrics, response_compose);
+
+    return n;
+
+error:
+    INCR(compose_rsp_metrics, response_compose_ex);
+
+    return CC_ENOMEM;
+}
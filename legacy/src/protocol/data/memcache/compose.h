@@ -42,3 +42,17 @@ void compose_teardown(void);
 int compose_req(struct buf **buf, const struct request *req);
 
 int compose_rsp(struct buf **buf, const struct response *rsp);
+/**
+ * compose a VALUE response that refers to the value instead of copying it,
+ * which takes over ref: release(ref) is called once the value has been
+ * written out or copied, or if composing fails
+ */
+int compose_rsp_ref(struct buf **buf, const struct response *rsp,
+        buf_release_fn release, void *ref);
+
+/*
+ * compose the response to a binary request, a response which a quiet opcode
+ * does not return is skipped and 0 returned
+ */
+int compose_bin_rsp(struct buf **buf, const struct request *req,
+        const struct response *rsp);
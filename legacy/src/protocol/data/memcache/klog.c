@@ -7,19 +7,23 @@
 #include <cc_bstring.h>
 #include <cc_debug.h>
 #include <cc_log.h>
+#include <cc_mm.h>
 #include <cc_print.h>
+#include <cc_rbuf.h>
+#include <cc_util.h>
 #include <time/cc_timer.h>
 #include <time/cc_wheel.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <sys/uio.h>
 #include <sysexits.h>
 #include <time.h>
 
 #define KLOG_MODULE_NAME   "protocol::memcache:klog"
 #define KLOG_MAX_LEN       KiB
 
-/* TODO(yao): Use a cheaper way to format the command logs, e.g. print_uint64 */
 /* TODO(yao): timestamp can be optimized by not reformatting within a second */
 #define KLOG_TIME_FMT      "[%d/%b/%Y:%T %z] "
 #define KLOG_STORE_FMT     "\"%.*s%.*s %u %u %u\" %d %u\n"
@@ -27,8 +31,19 @@
 #define KLOG_GET_FMT       "\"%.*s %.*s\" %d %u\n"
 #define KLOG_DELTA_FMT     "\"%.*s%.*s %llu\" %d %u\n"
 
+/* the log file, records are buffered per thread instead of by the logger */
 static struct logger *klogger;
-static uint64_t klog_cmds;
+static uint32_t nthread = 0;
+static struct rbuf **bufs = NULL; /* one for each of the threads */
+static uint32_t njoined = 0;
+
+/* only used by the thread flushing */
+static struct iovec *iov = NULL;
+static size_t *iov_len = NULL; /* # bytes to flush per thread */
+
+static __thread struct rbuf *local = NULL;
+static __thread bool joined = false;
+static __thread uint64_t klog_cmds = 0;
 
 static char backup_path[PATH_MAX + 1];
 static char *klog_backup = NULL;
@@ -41,14 +56,85 @@ bool klog_enabled = false;
 static bool klog_init = false;
 static klog_metrics_st *klog_metrics;
 
+/*
+ * the bytes of buf that are ready to be flushed, in up to two pieces when
+ * they wrap around the end of the buffer
+ */
+static inline int
+_rbuf_iov(struct iovec *v, struct rbuf *buf)
+{
+    uint32_t rpos = get_rpos(buf), wpos = get_wpos(buf);
+
+    if (wpos >= rpos) {
+        v[0].iov_base = buf->data + rpos;
+        v[0].iov_len = wpos - rpos;
+        return wpos > rpos;
+    }
+
+    v[0].iov_base = buf->data + rpos;
+    v[0].iov_len = buf->cap + 1 - rpos;
+    v[1].iov_base = buf->data;
+    v[1].iov_len = wpos;
+
+    return wpos > 0 ? 2 : 1;
+}
+
+static inline void
+_rbuf_consume(struct rbuf *buf, size_t n)
+{
+    set_rpos(buf, (get_rpos(buf) + n) % (buf->cap + 1));
+}
+
 void
 klog_flush(void *arg)
 {
+    size_t total = 0, left;
+    ssize_t n;
+    uint32_t i, first, last;
+    int niov;
+
     if (klogger == NULL) {
         return;
     }
 
-    klog_size += log_flush(klogger);
+    /* write out the buffers of all threads, up to IOV_MAX pieces at a time */
+    for (first = 0; first < nthread; first = last) {
+        niov = 0;
+        left = 0;
+        for (last = first; last < nthread && niov + 2 <= IOV_MAX; ++last) {
+            int k = _rbuf_iov(&iov[niov], bufs[last]);
+
+            iov_len[last] = 0;
+            for (; k > 0; --k, ++niov) {
+                iov_len[last] += iov[niov].iov_len;
+            }
+            left += iov_len[last];
+        }
+        if (left == 0) {
+            continue;
+        }
+
+        n = writev(klogger->fd, iov, niov);
+        if (n < 0) {
+            log_error("klog failed to write %zu bytes: %s", left,
+                    strerror(errno));
+            break;
+        }
+        total += n;
+
+        /* threads only flushed in part are left with the rest for next time */
+        for (i = first, left -= n; i < last && n > 0; ++i) {
+            size_t m = MIN(iov_len[i], (size_t)n);
+
+            _rbuf_consume(bufs[i], m);
+            n -= m;
+        }
+        if (left > 0) {
+            break;
+        }
+    }
+
+    klog_size += total;
     if (klog_size >= klog_max) {
         if (log_reopen(klogger, klog_backup) != CC_OK) {
             log_error("klog rotation failed to reopen log file, stop logging");
@@ -58,17 +144,38 @@ klog_flush(void *arg)
     }
 }
 
+static void
+_klog_free(void)
+{
+    uint32_t i;
+
+    if (bufs != NULL) {
+        for (i = 0; i < nthread; ++i) {
+            rbuf_destroy(&bufs[i]);
+        }
+        cc_free(bufs);
+        bufs = NULL;
+    }
+    cc_free(iov);
+    iov = NULL;
+    cc_free(iov_len);
+    iov_len = NULL;
+    nthread = 0;
+}
+
 void
-klog_setup(klog_options_st *options, klog_metrics_st *metrics)
+klog_setup(klog_options_st *options, klog_metrics_st *metrics, uint32_t n)
 {
     size_t nbuf = KLOG_NBUF;
     char *filename = NULL;
+    uint32_t i;
 
     log_info("Set up the %s module", KLOG_MODULE_NAME);
 
     if (klog_init) {
         log_warn("%s has already been setup, overwrite", KLOG_MODULE_NAME);
         log_destroy(&klogger);
+        _klog_free();
     }
 
     klog_metrics = metrics;
@@ -99,12 +206,31 @@ klog_setup(klog_options_st *options, klog_metrics_st *metrics)
         return;
     }
 
-    klogger = log_create(filename, nbuf);
+    klogger = log_create(filename, 0);
     if (klogger == NULL) {
         log_crit("Could not create klogger!");
         goto error;
     }
 
+    nthread = n;
+    njoined = 0;
+    bufs = cc_zalloc(sizeof(*bufs) * nthread);
+    iov = cc_alloc(sizeof(*iov) * 2 * nthread);
+    iov_len = cc_alloc(sizeof(*iov_len) * nthread);
+    if (bufs == NULL || iov == NULL || iov_len == NULL) {
+        log_crit("Could not allocate klog buffers for %"PRIu32" threads",
+                nthread);
+        goto error;
+    }
+    for (i = 0; i < nthread; ++i) {
+        bufs[i] = rbuf_create(nbuf);
+        if (bufs[i] == NULL) {
+            log_crit("Could not allocate klog buffers for %"PRIu32" threads",
+                    nthread);
+            goto error;
+        }
+    }
+
     klog_enabled = true;
 
     klog_init = true;
@@ -113,6 +239,7 @@ klog_setup(klog_options_st *options, klog_metrics_st *metrics)
 
 error:
     log_destroy(&klogger);
+    _klog_free();
     exit(EX_CONFIG);
 }
 
@@ -125,13 +252,13 @@ klog_teardown(void)
         log_warn("%s was not setup", KLOG_MODULE_NAME);
     }
 
+    klog_flush(NULL);
     log_destroy(&klogger);
+    _klog_free();
+    klog_enabled = false;
     klog_backup = NULL;
     klog_sample = KLOG_SAMPLE;
     klog_max = KLOG_MAX;
-    if (klog_backup != NULL) {
-        cc_free(klog_backup);
-    }
     klog_metrics = NULL;
 
     klog_init = false;
@@ -147,11 +274,45 @@ _get_val_rsp_len(struct response *rsp, struct bstring *key)
         + (rsp->num ? digits(rsp->vint) : rsp->vstr.len) + CRLF_LEN;
 }
 
+/* the thread takes the next buffer, if there is one left */
+static void
+_klog_join(void)
+{
+    uint32_t idx = __atomic_fetch_add(&njoined, 1, __ATOMIC_RELAXED);
+
+    joined = true;
+    if (idx >= nthread) {
+        log_warn("commands of thread %"PRIu32" not logged, only %"PRIu32
+                " threads are", idx, nthread);
+        return;
+    }
+
+    local = bufs[idx];
+}
+
 static inline void
-_klog_write_get(struct request *req, struct response *rsp, char *buf, int len)
+_klog_log_write(struct klog_record *rec, const struct bstring *key)
+{
+    char buf[KLOG_RECORD_MAXLEN];
+    uint8_t klen = MIN(key->len, KLOG_KEY_MAXLEN);
+
+    rec->size = sizeof(*rec) + klen;
+    cc_memcpy(buf, rec, sizeof(*rec));
+    cc_memcpy(buf + sizeof(*rec), key->data, klen);
+
+    if (local != NULL && rbuf_wcap(local) >= rec->size) {
+        rbuf_write(local, buf, rec->size);
+        INCR(klog_metrics, klog_logged);
+    } else {
+        INCR(klog_metrics, klog_discard);
+    }
+}
+
+static inline void
+_klog_write_get(struct request *req, struct response *rsp,
+        struct klog_record *rec)
 {
     struct response *nr = rsp;
-    int suffix_len;
     uint32_t i;
     struct bstring *key;
 
@@ -160,153 +321,141 @@ _klog_write_get(struct request *req, struct response *rsp, char *buf, int len)
 
         if (nr->type != RSP_END && bstring_compare(key, &nr->key) == 0) {
             /* key was found, rsp at nr */
-            suffix_len = cc_scnprintf(buf + len, KLOG_MAX_LEN - len, KLOG_GET_FMT,
-                                      req_strings[req->type].len, req_strings[req->type].data,
-                                      key->len, key->data, rsp->type, _get_val_rsp_len(nr, key));
+            rec->rsp_type = rsp->type;
+            rec->rsp_len = _get_val_rsp_len(nr, key);
             nr = STAILQ_NEXT(nr, next);
         } else {
             /* key not found */
-            suffix_len = cc_scnprintf(buf + len, KLOG_MAX_LEN - len, KLOG_GET_FMT,
-                                      req_strings[req->type].len, req_strings[req->type].data,
-                                      key->len, key->data, RSP_UNKNOWN, 0);
+            rec->rsp_type = RSP_UNKNOWN;
+            rec->rsp_len = 0;
         }
 
-        ASSERT(len + suffix_len <= KLOG_MAX_LEN);
-
-        if (log_write(klogger, buf, len + suffix_len)) {
-            INCR(klog_metrics, klog_logged);
-        } else {
-            INCR(klog_metrics, klog_discard);
-        }
+        _klog_log_write(rec, key);
     }
 
     ASSERT(nr ->type == RSP_END);
 }
 
-static inline int
-_klog_fmt_delete(struct request *req, struct response *rsp, char *buf, int len)
-{
-    struct bstring *key = array_get(req->keys, 0);
-
-    len += cc_scnprintf(buf + len, KLOG_MAX_LEN - len, KLOG_GET_FMT, req_strings[req->type].len,
-                        req_strings[req->type].data, key->len, key->data, rsp->type,
-                        req->noreply ? 0 : rsp_strings[rsp->type].len);
-
-    return len;
-}
-
-static inline int
-_klog_fmt_store(struct request *req, struct response *rsp, char *buf, int len)
-{
-    struct bstring *key = array_get(req->keys, 0);
-
-    len += cc_scnprintf(buf + len, KLOG_MAX_LEN - len, KLOG_STORE_FMT, req_strings[req->type].len,
-                        req_strings[req->type].data, key->len, key->data, req->flag,
-                        req->expiry, req->vlen, rsp->type,
-                        req->noreply ? 0 : rsp_strings[rsp->type].len);
-
-    return len;
-}
-
-static inline int
-_klog_fmt_cas(struct request *req, struct response *rsp, char *buf, int len)
-{
-    struct bstring *key = array_get(req->keys, 0);
-
-    len += cc_scnprintf(buf + len, KLOG_MAX_LEN - len, KLOG_CAS_FMT, req_strings[req->type].len,
-                        req_strings[req->type].data, key->len, key->data, req->flag,
-                        req->expiry, req->vlen, req->vcas, rsp->type,
-                        req->noreply ? 0 : rsp_strings[rsp->type].len);
-
-    return len;
-}
-
-static inline int
-_klog_fmt_delta(struct request *req, struct response *rsp, char *buf, int len)
+static inline uint32_t
+_delta_rsp_len(struct request *req, struct response *rsp)
 {
-    uint32_t rsp_len;
-    struct bstring *key = array_get(req->keys, 0);
-
     if (req->noreply) {
-        rsp_len = 0;
+        return 0;
     } else if (rsp->type == RSP_NUMERIC) {
-        rsp_len = digits(rsp->vint) + CRLF_LEN;
+        return digits(rsp->vint) + CRLF_LEN;
     } else {
-        rsp_len = rsp_strings[rsp->type].len;
+        return rsp_strings[rsp->type].len;
     }
-
-    len += cc_scnprintf(buf + len, KLOG_MAX_LEN - len, KLOG_DELTA_FMT, req_strings[req->type].len,
-                        req_strings[req->type].data, key->len, key->data, req->delta,
-                        rsp->type, rsp_len);
-
-    return len;
 }
 
 /* TODO(kyang): update peer to log the peer instead of placeholder (CACHE-3492) */
 void
 _klog_write(struct request *req, struct response *rsp)
 {
-    int len, time_len, errno_save;
-    char buf[KLOG_MAX_LEN], *peer = "-";
-    time_t t;
+    struct klog_record rec = {0};
 
     if (klogger == NULL) {
         return;
     }
 
-    ++klog_cmds;
+    if (!joined) {
+        _klog_join();
+    }
 
-    if (klog_cmds % klog_sample != 0) {
+    if (++klog_cmds % klog_sample != 0) {
         INCR(klog_metrics, klog_skip);
         return;
     }
 
-    errno_save = errno;
+    rec.req_type = req->type;
+    rec.rsp_type = rsp->type;
+    rec.time = time_unix_sec();
+    rec.rsp_len = req->noreply ? 0 : rsp_strings[rsp->type].len;
+
+    switch (req->type) {
+    case REQ_GET:
+    case REQ_GETS:
+        _klog_write_get(req, rsp, &rec);
+        return;
+    case REQ_DELETE:
+        break;
+    case REQ_CAS:
+        rec.num = req->vcas;
+        /* fall-through */
+    case REQ_SET:
+    case REQ_ADD:
+    case REQ_REPLACE:
+    case REQ_APPEND:
+    case REQ_PREPEND:
+        rec.flag = req->flag;
+        rec.expiry = req->expiry;
+        rec.vlen = req->vlen;
+        break;
+    case REQ_INCR:
+    case REQ_DECR:
+        rec.num = req->delta;
+        rec.rsp_len = _delta_rsp_len(req, rsp);
+        break;
+    default:
+        return;
+    }
+
+    _klog_log_write(&rec, array_get(req->keys, 0));
+}
+
+size_t
+klog_print(char *buf, size_t cap, const struct klog_record *rec,
+        const char *key)
+{
+    size_t len, time_len;
+    int klen = rec->size - sizeof(*rec);
+    struct bstring *req_str;
+    time_t t = rec->time;
+    struct tm tm;
+
+    if (rec->req_type >= REQ_SENTINEL || rec->size < sizeof(*rec)) {
+        return 0;
+    }
+    req_str = &req_strings[rec->req_type];
 
-    t = time_unix_sec();
-    len = cc_scnprintf(buf, KLOG_MAX_LEN, "%s - ", peer);
-    time_len = strftime(buf + len, KLOG_MAX_LEN - len, KLOG_TIME_FMT, localtime(&t));
+    len = cc_scnprintf(buf, cap, "- ");
+    time_len = strftime(buf + len, cap - len, KLOG_TIME_FMT,
+            localtime_r(&t, &tm));
     if (time_len == 0) {
-        log_error("strftime failed: %s", strerror(errno));
-        goto done;
+        return 0;
     }
     len += time_len;
 
-    switch (req->type) {
+    switch (rec->req_type) {
     case REQ_GET:
     case REQ_GETS:
-        _klog_write_get(req, rsp, buf, len);
-        goto done;
-        break;
     case REQ_DELETE:
-        len = _klog_fmt_delete(req, rsp, buf, len);
+        len += cc_scnprintf(buf + len, cap - len, KLOG_GET_FMT, req_str->len,
+                req_str->data, klen, key, rec->rsp_type, rec->rsp_len);
         break;
     case REQ_SET:
     case REQ_ADD:
     case REQ_REPLACE:
     case REQ_APPEND:
     case REQ_PREPEND:
-        len = _klog_fmt_store(req, rsp, buf, len);
+        len += cc_scnprintf(buf + len, cap - len, KLOG_STORE_FMT, req_str->len,
+                req_str->data, klen, key, rec->flag, rec->expiry, rec->vlen,
+                rec->rsp_type, rec->rsp_len);
         break;
     case REQ_CAS:
-        len = _klog_fmt_cas(req, rsp, buf, len);
+        len += cc_scnprintf(buf + len, cap - len, KLOG_CAS_FMT, req_str->len,
+                req_str->data, klen, key, rec->flag, rec->expiry, rec->vlen,
+                (unsigned long long)rec->num, rec->rsp_type, rec->rsp_len);
         break;
     case REQ_INCR:
     case REQ_DECR:
-        len = _klog_fmt_delta(req, rsp, buf, len);
+        len += cc_scnprintf(buf + len, cap - len, KLOG_DELTA_FMT, req_str->len,
+                req_str->data, klen, key, (unsigned long long)rec->num,
+                rec->rsp_type, rec->rsp_len);
         break;
     default:
-        goto done;
+        return 0;
     }
 
-    ASSERT(len <= KLOG_MAX_LEN);
-
-    if (log_write(klogger, buf, len)) {
-        INCR(klog_metrics, klog_logged);
-    } else {
-        INCR(klog_metrics, klog_discard);
-    }
-
-done:
-    errno = errno_save;
+    return len;
 }
@@ -4,9 +4,23 @@
 #include <cc_metric.h>
 #include <cc_option.h>
 
+#include <stddef.h>
 #include <stdint.h>
 
-#define KLOG_NBUF   2 * MiB    /* default log buf size */
+/*
+ * The command logger samples requests and logs each of them, with the
+ * response, as a binary record (see struct klog_record below), which takes far
+ * less effort than formatting it as text. Each worker thread writes records
+ * to a ring buffer of its own, so no lock is taken on the request path, and a
+ * thread is given its buffer the first time it logs a command. klog_flush,
+ * which runs on a timer outside of the workers, writes out the records of all
+ * threads in a single system call.
+ *
+ * Logs are turned back into text, one line per record as they used to be
+ * written, offline by klog-decode (see klog_print).
+ */
+
+#define KLOG_NBUF   2 * MiB    /* default log buf size, per thread */
 #define KLOG_INTVL  100        /* flush every 100 milliseconds */
 #define KLOG_SAMPLE 100        /* log one in every 100 commands */
 #define KLOG_MAX    GiB        /* max klog file size */
@@ -15,7 +29,7 @@
 #define KLOG_OPTION(ACTION)                                                                     \
     ACTION( klog_file,   OPTION_TYPE_STR,  NULL,         "command log file"                    )\
     ACTION( klog_backup, OPTION_TYPE_STR,  NULL,         "command log backup file"             )\
-    ACTION( klog_nbuf,   OPTION_TYPE_UINT, KLOG_NBUF,    "command log buf size"                )\
+    ACTION( klog_nbuf,   OPTION_TYPE_UINT, KLOG_NBUF,    "command log buf size per thread"     )\
     ACTION( klog_sample, OPTION_TYPE_UINT, KLOG_SAMPLE,  "command log sample ratio"            )\
     ACTION( klog_max,    OPTION_TYPE_UINT, KLOG_MAX,     "klog file size to trigger rotation"  )
 
@@ -33,12 +47,33 @@ typedef struct {
     KLOG_METRIC(METRIC_DECLARE)
 } klog_metrics_st;
 
+/*
+ * A record, in host byte order, is immediately followed by the key. Fields
+ * that do not apply to the command, e.g. flag of a get, are 0.
+ */
+struct klog_record {
+    uint16_t    size;       /* # bytes in the record, key included */
+    uint8_t     req_type;
+    uint8_t     rsp_type;
+    uint32_t    time;       /* unix time, in sec */
+    uint32_t    rsp_len;    /* # bytes in the response */
+    uint32_t    flag;
+    uint32_t    expiry;
+    uint32_t    vlen;
+    uint64_t    num;        /* cas value or delta */
+};
+
+#define KLOG_KEY_MAXLEN UINT8_MAX
+#define KLOG_RECORD_MAXLEN (sizeof(struct klog_record) + KLOG_KEY_MAXLEN)
+
 struct request;
 struct response;
 
 extern bool klog_enabled;
 
-void klog_setup(klog_options_st *options, klog_metrics_st *metrics);
+/* nthread threads can log commands */
+void klog_setup(klog_options_st *options, klog_metrics_st *metrics,
+        uint32_t nthread);
 void klog_teardown(void);
 
 #define klog_write(req, rsp) do {   \
@@ -50,3 +85,7 @@ void klog_teardown(void);
 void _klog_write(struct request *req, struct response *rsp);
 
 void klog_flush(void *arg); /* compatible type: timeout_cb_fn */
+
+/* print rec, of the key, as a line of text; returns # bytes printed */
+size_t klog_print(char *buf, size_t cap, const struct klog_record *rec,
+        const char *key);
@@ -1,5 +1,6 @@
 #include "parse.h"
 
+#include "binary.h"
 #include "request.h"
 #include "response.h"
 #include "time/time.h"
@@ -12,6 +13,7 @@
 #include <cc_util.h>
 
 #include <ctype.h>
+#include <string.h>
 
 #define PARSE_MODULE_NAME "protocol::memcache::parse"
 
@@ -303,6 +305,44 @@ _parse_val(struct bstring *val, struct buf *buf, uint32_t nbyte)
     return status;
 }
 
+/* binary values are sized by the header and not terminated by CRLF */
+static inline parse_rstatus_e
+_parse_bin_val(struct bstring *val, struct buf *buf, uint32_t nbyte)
+{
+    uint32_t rsize = buf_rsize(buf);
+
+    log_verb("parsing binary val at %p", buf->rpos);
+
+    val->len = MIN(nbyte, rsize);
+    val->data = (val->len > 0) ? buf->rpos : NULL;
+    buf->rpos += val->len;
+
+    log_verb("buf %p has %"PRIu32" out of the %"PRIu32" bytes expected", buf,
+            rsize, nbyte);
+
+    return (rsize < nbyte) ? PARSE_EUNFIN : PARSE_OK;
+}
+
+/* integers in binary headers and extras are in network byte order */
+static inline uint16_t
+_read_uint16(const uint8_t *p)
+{
+    return (uint16_t)p[0] << 8 | p[1];
+}
+
+static inline uint32_t
+_read_uint32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 |
+        p[3];
+}
+
+static inline uint64_t
+_read_uint64(const uint8_t *p)
+{
+    return (uint64_t)_read_uint32(p) << 32 | _read_uint32(p + 4);
+}
+
 /*
  * request specific functions
  */
@@ -724,6 +764,241 @@ _subrequest_retrieve(struct request *req, struct buf *buf, bool *end)
     }
 }
 
+/*
+ * get/gets make up most of the pipelined traffic, so they get a fast path once
+ * the whole line has been received: the line end and then each key delimiter
+ * are found with memchr, which libc vectorizes, instead of checking each byte
+ * for the end of the buffer and CRLF. Returns false, with nothing changed,
+ * for other requests and for anything the state machine has to look at, such
+ * as an incomplete line or a CR or LF that is not the line end; otherwise the
+ * outcome is in status, the same as it would be from the state machine.
+ */
+static bool
+_parse_retrieve_line(parse_rstatus_e *status, struct request *req,
+        struct buf *buf)
+{
+    char *p = buf->rpos, *lf, *eol, *k, *q;
+    size_t n = buf_rsize(buf);
+    struct bstring t;
+    request_type_t type;
+
+    if (n > 4 && str4cmp(p, 'g', 'e', 't', ' ')) {
+        type = REQ_GET;
+        p += 4;
+    } else if (n > 5 && str5cmp(p, 'g', 'e', 't', 's', ' ')) {
+        type = REQ_GETS;
+        p += 5;
+    } else {
+        return false;
+    }
+
+    lf = memchr(p, LF, buf->wpos - p);
+    if (lf == NULL || lf == p || *(lf - 1) != CR ||
+            memchr(p, CR, lf - 1 - p) != NULL) {
+        return false;
+    }
+    eol = lf - 1;
+
+    req->type = type;
+    *status = PARSE_OK;
+    /* p is where the state machine would start chasing the next key */
+    for (;; p = q + 1) {
+        for (k = p; k < eol && *k == ' '; k++); /* pre-key spaces */
+        q = (k == eol) ? NULL : memchr(k, ' ', eol - k);
+        q = (q == NULL) ? eol : q;
+        if (q - p > MAX_TOKEN_LEN) {
+            *status = PARSE_EOVERSIZE;
+            return true;
+        }
+
+        if (k == q) { /* only spaces up to the line end */
+            break;
+        }
+        t.data = k;
+        t.len = q - k;
+        *status = _push_key(req, &t);
+        if (*status != PARSE_OK || q == eol) {
+            break;
+        }
+    }
+
+    if (*status == PARSE_OK && array_nelem(req->keys) == 0) {
+        log_warn("ill formatted request: missing field(s) in retrieve command");
+        *status = PARSE_EOTHER;
+    }
+    buf->rpos = lf + 1;
+
+    return true;
+}
+
+/*
+ * parse the fixed size header, extras and key of a binary request into the
+ * request type of the equivalent text command, the value (if any) is parsed
+ * the same way as for text, except it is not followed by CRLF
+ */
+static parse_rstatus_e
+_parse_bin_req_hdr(struct request *req, struct buf *buf)
+{
+    uint8_t *p = (uint8_t *)buf->rpos;
+    uint8_t *extras;
+    uint8_t elen;
+    uint16_t klen;
+    uint32_t blen;
+    struct bstring t;
+
+    if (buf_rsize(buf) < BIN_HEADER_LEN) {
+        return PARSE_EUNFIN;
+    }
+
+    req->binary = 1;
+    req->opcode = p[1];
+    klen = _read_uint16(p + 2);
+    elen = p[4];
+    blen = _read_uint32(p + 8);
+    req->opaque = _read_uint32(p + 12);
+
+    if (klen > MAX_KEY_LEN || (uint32_t)klen + elen > blen) {
+        log_warn("ill formatted binary request: key length %"PRIu16", extras "
+                "length %"PRIu8", body length %"PRIu32, klen, elen, blen);
+
+        return PARSE_EINVALID;
+    }
+
+    /* extras and key are parsed as part of the header, not the value */
+    if (buf_rsize(buf) < BIN_HEADER_LEN + elen + klen) {
+        return PARSE_EUNFIN;
+    }
+    extras = p + BIN_HEADER_LEN;
+    t.len = klen;
+    t.data = (char *)extras + elen;
+    req->vlen = blen - elen - klen;
+
+    switch (req->opcode) {
+    case BIN_OP_GET:
+    case BIN_OP_GETQ:
+    case BIN_OP_GETK:
+    case BIN_OP_GETKQ:
+        /* binary gets always return the cas value */
+        req->type = REQ_GETS;
+        break;
+
+    case BIN_OP_SET:
+    case BIN_OP_SETQ:
+        /* a set which carries a cas value is a cas */
+        req->vcas = _read_uint64(p + 16);
+        req->type = (req->vcas == 0) ? REQ_SET : REQ_CAS;
+        break;
+
+    case BIN_OP_ADD:
+    case BIN_OP_ADDQ:
+        req->type = REQ_ADD;
+        break;
+
+    case BIN_OP_REPLACE:
+    case BIN_OP_REPLACEQ:
+        req->type = REQ_REPLACE;
+        break;
+
+    case BIN_OP_APPEND:
+    case BIN_OP_APPENDQ:
+        req->type = REQ_APPEND;
+        break;
+
+    case BIN_OP_PREPEND:
+    case BIN_OP_PREPENDQ:
+        req->type = REQ_PREPEND;
+        break;
+
+    case BIN_OP_DELETE:
+    case BIN_OP_DELETEQ:
+        req->type = REQ_DELETE;
+        break;
+
+    case BIN_OP_INCR:
+    case BIN_OP_INCRQ:
+        req->type = REQ_INCR;
+        break;
+
+    case BIN_OP_DECR:
+    case BIN_OP_DECRQ:
+        req->type = REQ_DECR;
+        break;
+
+    case BIN_OP_FLUSH:
+    case BIN_OP_FLUSHQ:
+        req->type = REQ_FLUSHALL;
+        break;
+
+    case BIN_OP_QUIT:
+    case BIN_OP_QUITQ:
+        req->type = REQ_QUIT;
+        break;
+
+    /* noop, version and unknown opcodes are answered from the opcode alone */
+    default:
+        req->type = REQ_UNKNOWN;
+        break;
+    }
+
+    switch (req->type) {
+    case REQ_GETS:
+    case REQ_DELETE:
+        if (klen == 0 || elen != 0 || req->vlen != 0) {
+            goto invalid;
+        }
+        break;
+
+    case REQ_SET:
+    case REQ_CAS:
+    case REQ_ADD:
+    case REQ_REPLACE:
+        if (klen == 0 || elen != BIN_STORE_EXTRAS_LEN) {
+            goto invalid;
+        }
+        req->flag = _read_uint32(extras);
+        req->expiry = _read_uint32(extras + 4);
+        req->val = 1;
+        break;
+
+    case REQ_APPEND:
+    case REQ_PREPEND:
+        if (klen == 0 || elen != 0) {
+            goto invalid;
+        }
+        req->val = 1;
+        break;
+
+    /* the initial value and expiry are ignored, missing keys are not created */
+    case REQ_INCR:
+    case REQ_DECR:
+        if (klen == 0 || elen != BIN_DELTA_EXTRAS_LEN || req->vlen != 0) {
+            goto invalid;
+        }
+        req->delta = _read_uint64(extras);
+        break;
+
+    default:
+        if (req->vlen != 0) {
+            goto invalid;
+        }
+        break;
+    }
+
+    if (klen > 0 && _push_key(req, &t) != PARSE_OK) {
+        return PARSE_EOTHER;
+    }
+    req->nremain = req->vlen;
+    buf->rpos += BIN_HEADER_LEN + elen + klen;
+
+    return PARSE_OK;
+
+invalid:
+    log_warn("ill formatted binary request: unexpected field(s) for opcode "
+            "%"PRIu8, req->opcode);
+
+    return PARSE_EINVALID;
+}
+
 /* parse the first line("header") according to memcache ASCII protocol */
 static parse_rstatus_e
 _parse_req_hdr(struct request *req, struct buf *buf)
@@ -736,6 +1011,14 @@ _parse_req_hdr(struct request *req, struct buf *buf)
 
     log_verb("parsing hdr at %p into req %p", buf->rpos, req);
 
+    if ((uint8_t)*buf->rpos == BIN_REQ_MAGIC) {
+        return _parse_bin_req_hdr(req, buf);
+    }
+
+    if (_parse_retrieve_line(&status, req, buf)) {
+        return status;
+    }
+
     /* get the verb first */
     status = _chase_req_type(req, buf, &end);
     if (status != PARSE_OK) {
@@ -832,7 +1115,11 @@ parse_req(struct request *req, struct buf *buf)
         /* fall-through intended */
 
     case REQ_PARTIAL: /* continuation of value parsing for the current request */
-        status = _parse_val(&(req->vstr), buf, req->nremain);
+        if (req->binary) {
+            status = _parse_bin_val(&(req->vstr), buf, req->nremain);
+        } else {
+            status = _parse_val(&(req->vstr), buf, req->nremain);
+        }
         req->nremain -= req->vstr.len;
         log_verb("this value segment: %"PRIu32", remain: %"PRIu32, req->vstr.len,
                 req->nremain);
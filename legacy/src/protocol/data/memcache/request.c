@@ -3,6 +3,8 @@
 #include <cc_debug.h>
 #include <cc_pool.h>
 
+#include <pthread.h>
+
 #define REQUEST_MODULE_NAME "protocol::memcache::request"
 
 static bool request_init = false;
@@ -17,6 +19,8 @@ struct bstring req_strings[] = {
 FREEPOOL(req_pool, reqq, request);
 static struct req_pool reqp;
 static bool reqp_init = false;
+/* worker threads borrow and return concurrently */
+static pthread_mutex_t reqp_mtx = PTHREAD_MUTEX_INITIALIZER;
 
 void
 request_reset(struct request *req)
@@ -39,6 +43,9 @@ request_reset(struct request *req)
     req->delta = 0;
     req->vcas = 0;
 
+    req->opaque = 0;
+    req->opcode = 0;
+
     req->nremain = 0;
     req->reserved = NULL;
     req->rsp = NULL;
@@ -50,6 +57,7 @@ request_reset(struct request *req)
     req->val = 0;
     req->serror = 0;
     req->cerror = 0;
+    req->binary = 0;
 }
 
 struct request *
@@ -129,7 +137,9 @@ request_borrow(void)
 {
     struct request *req;
 
+    pthread_mutex_lock(&reqp_mtx);
     FREEPOOL_BORROW(req, &reqp, next, request_create);
+    pthread_mutex_unlock(&reqp_mtx);
     if (req == NULL) {
         log_debug("borrow req failed: OOM %d");
 
@@ -158,7 +168,9 @@ request_return(struct request **request)
     log_vverb("return req %p", req);
 
     req->free = true;
+    pthread_mutex_lock(&reqp_mtx);
     FREEPOOL_RETURN(req, &reqp, next);
+    pthread_mutex_unlock(&reqp_mtx);
 
     *request = NULL;
 }
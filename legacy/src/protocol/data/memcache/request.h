@@ -92,6 +92,9 @@ struct request {
     uint64_t                delta;
     uint64_t                vcas;
 
+    uint32_t                opaque;     /* binary: echoed back in response */
+    uint8_t                 opcode;     /* binary: opcode of the request */
+
     uint32_t                nremain;
     void                    *reserved;  /* storage reserved for partial value */
     struct response         *rsp;       /* response object(s) reserved */
@@ -103,6 +106,7 @@ struct request {
     unsigned                val:1;      /* value needed? */
     unsigned                serror:1;   /* server error */
     unsigned                cerror:1;   /* client error */
+    unsigned                binary:1;   /* binary protocol? */
 };
 
 void request_setup(request_options_st *options, request_metrics_st *metrics);
@@ -4,6 +4,8 @@
 #include <cc_mm.h>
 #include <cc_pool.h>
 
+#include <pthread.h>
+
 #define RESPONSE_MODULE_NAME "protocol::memcache::response"
 
 static bool response_init = false;
@@ -18,6 +20,8 @@ struct bstring rsp_strings[] = {
 FREEPOOL(rsp_pool, rspq, response);
 static struct rsp_pool rspp;
 static bool rspp_init = false;
+/* worker threads borrow and return concurrently */
+static pthread_mutex_t rspp_mtx = PTHREAD_MUTEX_INITIALIZER;
 
 void
 response_reset(struct response *rsp)
@@ -115,7 +119,9 @@ response_borrow(void)
 {
     struct response *rsp;
 
+    pthread_mutex_lock(&rspp_mtx);
     FREEPOOL_BORROW(rsp, &rspp, next, response_create);
+    pthread_mutex_unlock(&rspp_mtx);
     if (rsp == NULL) {
         log_debug("borrow rsp failed: OOM %d");
 
@@ -149,7 +155,9 @@ response_return(struct response **response)
     log_vverb("return rsp %p", rsp);
 
     rsp->free = true;
+    pthread_mutex_lock(&rspp_mtx);
     FREEPOOL_RETURN(rsp, &rspp, next);
+    pthread_mutex_unlock(&rspp_mtx);
 
     *response = NULL;
 }
@@ -1,3 +1,4 @@
+#include "memcache/binary.h"
 #include "memcache/compose.h"
 #include "memcache/klog.h"
 #include "memcache/parse.h"
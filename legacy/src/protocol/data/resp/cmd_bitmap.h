@@ -16,6 +16,21 @@
  *
  * set: set value of a column in a bitmap
  * BitMap.set KEY columnId val
+ *
+ * mget: get values of one or more columns in a bitmap
+ * BitMap.mget KEY columnId [columnId ...]
+ *
+ * mset: set values of one or more columns in a bitmap, none is set if any of
+ * the columns or values is invalid
+ * BitMap.mset KEY columnId val [columnId val ...]
+ *
+ * count: count columns with a non-zero value, within [start, end] if given
+ * BitMap.count KEY [start end]
+ *
+ * and/or: update a bitmap to the bitwise AND/OR of itself and other bitmaps of
+ * the same size, and return the number of non-zero columns in the result
+ * BitMap.and KEY srcKey [srcKey ...]
+ * BitMap.or KEY srcKey [srcKey ...]
  */
 
 /* TODO:
@@ -28,13 +43,21 @@
 
 /*          type                string              #arg    #opt */
 #define REQ_BITMAP(ACTION)                                      \
-    ACTION( REQ_BITMAP_CREATE,  "BitMap.create",    3,      0  )\
-    ACTION( REQ_BITMAP_DELETE,  "BitMap.delete",    2,      0  )\
-    ACTION( REQ_BITMAP_GET,     "BitMap.get",       3,      0  )\
-    ACTION( REQ_BITMAP_SET,     "BitMap.set",       4,      0  )
+    ACTION( REQ_BITMAP_CREATE,  "BitMap.create",    3,      0           )\
+    ACTION( REQ_BITMAP_DELETE,  "BitMap.delete",    2,      0           )\
+    ACTION( REQ_BITMAP_GET,     "BitMap.get",       3,      0           )\
+    ACTION( REQ_BITMAP_SET,     "BitMap.set",       4,      0           )\
+    ACTION( REQ_BITMAP_MGET,    "BitMap.mget",      3,      OPT_VARIED  )\
+    ACTION( REQ_BITMAP_MSET,    "BitMap.mset",      4,      OPT_VARIED  )\
+    ACTION( REQ_BITMAP_COUNT,   "BitMap.count",     2,      2           )\
+    ACTION( REQ_BITMAP_AND,     "BitMap.and",       3,      OPT_VARIED  )\
+    ACTION( REQ_BITMAP_OR,      "BitMap.or",        3,      OPT_VARIED  )
 
 typedef enum bitmap_elem {
     BITMAP_KEY = 2,
     BITMAP_COL = 3,
     BITMAP_VAL = 4,
+    BITMAP_START = 3,
+    BITMAP_END = 4,
+    BITMAP_SRC = 3,
 } bitmap_elem_e;
@@ -18,7 +18,8 @@
  * find: find entry in list
  * List.find KEY VALUE
  *
- * get: get entry/entries at an index
+ * get: get entry/entries at an index, the whole list if no index is given, or
+ * up to COUNT entries starting at INDEX
  * List.get KEY [INDEX [COUNT]]
  *
  * insert: insert entry at an index
@@ -2,6 +2,47 @@
 
 #include "cmd.h"
 
+/**
+ * Sorted sets follow the semantics of Redis, with scores that are doubles and
+ * members that are byte strings. A missing KEY is an empty set, and a set that
+ * becomes empty is deleted.
+ *
+ * MIN/MAX: a score, inclusive unless prefixed with `(', or one of -inf/+inf
+ * START/STOP: a rank, which counts from the end of the set if negative
+ */
+
+/**
+ * add: add members, or update their scores, return # members added (or changed
+ * with CH); NX only adds, XX only updates
+ * zadd KEY [NX|XX] [CH] SCORE MEMBER [SCORE MEMBER ...]
+ *
+ * incrby: increment the score of a member, adding it if missing
+ * zincrby KEY INCREMENT MEMBER
+ *
+ * rem/remrangebyrank/remrangebyscore: remove members, return # removed
+ * zrem KEY MEMBER [MEMBER ...]
+ * zremrangebyrank KEY START STOP
+ * zremrangebyscore KEY MIN MAX
+ *
+ * range/revrange/rangebyscore/revrangebyscore: get members in (reverse) order
+ * zrange KEY START STOP [WITHSCORES]
+ * zrevrange KEY START STOP [WITHSCORES]
+ * zrangebyscore KEY MIN MAX [WITHSCORES] [LIMIT OFFSET COUNT]
+ * zrevrangebyscore KEY MAX MIN [WITHSCORES] [LIMIT OFFSET COUNT]
+ *
+ * count/card: return # members of scores within range, or in total
+ * zcount KEY MIN MAX
+ * zcard KEY
+ *
+ * score/rank/revrank: return the score or (reverse) rank of a member
+ * zscore KEY MEMBER
+ * zrank KEY MEMBER
+ * zrevrank KEY MEMBER
+ *
+ * The lexicographical ranges, set operations (zunionstore, zinterstore) and
+ * zscan are not implemented yet.
+ */
+
 /*          type                    string              # of args */
 #define REQ_ZSET(ACTION)                                                \
     ACTION( REQ_ZADD,               "zadd",             4,  OPT_VARIED )\
@@ -25,3 +66,15 @@
     ACTION( REQ_ZRANK,              "zrank",            3,  0          )\
     ACTION( REQ_ZREVRANK,           "zrevrank",         3,  0          )\
     ACTION( REQ_ZSCAN,              "zscan",            3,  OPT_VARIED )
+
+typedef enum zset_elem {
+    ZSET_KEY = 2,
+    ZSET_SCORE = 3, /* first score of zadd, or increment of zincrby */
+    ZSET_MEMBER = 3,
+    ZSET_IMEMBER = 4, /* when an increment is also present */
+    ZSET_START = 3,
+    ZSET_STOP = 4,
+    ZSET_MIN = 3,
+    ZSET_MAX = 4,
+    ZSET_OPT = 5, /* first option of ranges, e.g. WITHSCORES */
+} zset_elem_e;
@@ -62,8 +62,11 @@ _parse_cmd(struct request *req)
     el = array_get(req->token, CMD_OFFSET);
 
     ASSERT (el->type == ELEM_BULK);
+    /* most names differ in length, so skip those before comparing bytes */
     while (++type < REQ_SENTINEL &&
-            bstring_compare(&command_table[type].bstr, &el->bstr) != 0) {}
+            (command_table[type].bstr.len != el->bstr.len ||
+             cc_bcmp(command_table[type].bstr.data, el->bstr.data,
+                     el->bstr.len) != 0)) {}
     if (type == REQ_SENTINEL) {
         log_warn("unrecognized command detected: %.*s", el->bstr.len,
                 el->bstr.data);
@@ -9,8 +9,6 @@
 #include <cc_print.h>
 #include <cc_util.h>
 
-#include <ctype.h>
-
 #define STR_MAXLEN 255 /* max length for simple string or error */
 #define BULK_MAXLEN (512 * MiB)
 #define TOKEN_MAXLEN (32 * MiB)
@@ -74,49 +72,64 @@ _read_int(int64_t *num, struct buf *buf, int64_t min, int64_t max)
     /*
      * Note: buf->rpos is updated in this function, the caller is responsible
      * for resetting the pointer if necessary.
+     *
+     * Digits are accumulated as an unsigned magnitude, which cannot overflow
+     * as long as it stays below INT64_MAX / 10 before each digit. So instead
+     * of checking against the bounds on every digit, which costs a division,
+     * we check the magnitude against them once all the digits are read.
      */
-    size_t len = 0;
-    int64_t sign = 1;
+    char *p = buf->rpos;
+    char *end = buf->wpos;
+    bool neg = false;
+    uint64_t val = 0, lim;
+    uint8_t d;
+
+    if (p < end && *p == '-') {
+        neg = true;
+        p++;
+    }
+
+    for (buf->rpos = p; p < end && (d = (uint8_t)(*p - '0')) < 10; p++) {
+        if (val > INT64_MAX / 10) {
+            log_warn("ill formatted token: integer out of bounds");
 
-    if (*buf->rpos == '-') {
-        sign = -1;
-        buf->rpos++;
+            return PARSE_EINVALID;
+        }
+        val = val * 10 + d;
     }
 
-    *num = 0;
-    for (; buf_rsize(buf) > 0; buf->rpos++) {
-        if (isdigit(*buf->rpos)) {
-            if (*num < min / 10 || *num > max / 10) {
-                /* TODO(yao): catch the few numbers that will still overflow */
-                log_warn("ill formatted token: integer out of bounds");
+    /* the largest magnitude allowed for the sign we got, 0 if none fits */
+    if (neg) {
+        lim = min < 0 ? 0 - (uint64_t)min : 0;
+    } else {
+        lim = max > 0 ? (uint64_t)max : 0;
+    }
+    if (val > lim) {
+        log_warn("ill formatted token: integer out of bounds");
 
-                return PARSE_EINVALID;
-            }
+        return PARSE_EINVALID;
+    }
+    *num = neg ? (int64_t)(0 - val) : (int64_t)val;
 
-            len++;
-            *num = *num * 10ULL + sign * (*buf->rpos - '0');
-        } else {
-            if (len == 0 || *buf->rpos != CR) {
-                log_warn("invalid character encountered: %c", *buf->rpos);
+    if (p == end) {
+        return PARSE_EUNFIN;
+    }
+    if (p == buf->rpos || *p != CR) {
+        log_warn("invalid character encountered: %c", *p);
 
-                return PARSE_EINVALID;
-            }
-            if (line_end(buf)) {
-                log_vverb("parsed integer, value %"PRIi64, *num);
+        return PARSE_EINVALID;
+    }
+    if (end - p < CRLF_LEN || *(p + 1) != LF) {
+        return PARSE_EUNFIN;
+    }
 
-                buf->rpos += CRLF_LEN;
-                if (*num > max || *num < min) {
-                    return PARSE_EINVALID;
-                } else {
-                    return PARSE_OK;
-                }
-            } else {
-                return PARSE_EUNFIN;
-            }
-        }
+    buf->rpos = p + CRLF_LEN;
+    if (*num > max || *num < min) {
+        return PARSE_EINVALID;
     }
+    log_vverb("parsed integer, value %"PRIi64, *num);
 
-    return PARSE_EUNFIN;
+    return PARSE_OK;
 }
 
 static parse_rstatus_e
@@ -1,11 +1,15 @@
 #include "process.h"
 
+#include "../data/process.h"
+
 #include "protocol/admin/admin_include.h"
 #include "util/procinfo.h"
 
 #include <cc_mm.h>
 #include <cc_print.h>
 
+#include <limits.h>
+
 #define CDB_ADMIN_MODULE_NAME "cdb::admin"
 
 extern struct stats stats;
@@ -58,6 +62,28 @@ _admin_stats(struct response *rsp, struct request *req)
     }
 }
 
+/* reload the cdb file being served, or switch to the one at the path given
+ * as argument */
+static void
+_admin_reload(struct response *rsp, struct request *req)
+{
+    char path[PATH_MAX];
+    rstatus_i status;
+
+    if (bstring_empty(&req->arg)) {
+        status = process_reload(NULL);
+    } else if (req->arg.len >= sizeof(path)) {
+        status = CC_ERROR;
+    } else {
+        /* the argument starts with the space after the command */
+        cc_scnprintf(path, sizeof(path), "%.*s", (int)req->arg.len - 1,
+                req->arg.data + 1);
+        status = process_reload(path);
+    }
+
+    rsp->type = (status == CC_OK) ? RSP_OK : RSP_INVALID;
+}
+
 void
 admin_process_request(struct response *rsp, struct request *req)
 {
@@ -70,6 +96,9 @@ admin_process_request(struct response *rsp, struct request *req)
     case REQ_VERSION:
         rsp->data = str2bstr(VERSION_PRINTED);
         break;
+    case REQ_RELOAD:
+        _admin_reload(rsp, req);
+        break;
     default:
         rsp->type = RSP_INVALID;
         break;
@@ -3,6 +3,7 @@
 #include "process.h"
 
 #include "protocol/data/memcache_include.h"
+#include "storage/cdb/cdb_mmap.h"
 #include "storage/cdb/cdb_rs.h"
 
 #include <cc_array.h>
@@ -10,6 +11,8 @@
 #include <cc_print.h>
 #include <cc_bstring.h>
 
+#include <unistd.h>
+
 #define CDB_PROCESS_MODULE_NAME "cdb::process"
 
 #define OVERSIZE_ERR_MSG    "oversized value, cannot be stored"
@@ -28,8 +31,18 @@ static process_metrics_st *process_metrics = NULL;
 
 static struct cdb_handle *cdb_handle = NULL;
 
+/* the mmapped engine is swapped by the admin thread while the worker reads it.
+ * the worker increments cdb_reading as it starts and as it finishes processing
+ * the requests of a read event, so it holds no value of a file while the count
+ * is even, and a file which was swapped out may be closed once the count is
+ * even or has moved on */
+static struct cdb_mmap *cdb_db = NULL;
+static uint64_t cdb_reading = 0;
+
+#define RELOAD_WAIT_US 100
+
 void
-process_setup(process_options_st *options, process_metrics_st *metrics, struct cdb_handle *handle)
+process_setup(process_options_st *options, process_metrics_st *metrics, struct cdb_handle *handle, struct cdb_mmap *db)
 {
     log_info("set up the %s module", CDB_PROCESS_MODULE_NAME);
 
@@ -38,10 +51,11 @@ process_setup(process_options_st *options, process_metrics_st *metrics, struct c
                  CDB_PROCESS_MODULE_NAME);
     }
 
-    if (handle == NULL) {
+    if (handle == NULL && db == NULL) {
         log_panic("cdb_handle was null, cannot continue");
     }
     cdb_handle = handle;
+    cdb_db = db;
 
     if (options->vbuf_size.val.vuint > UINT_MAX) {
         log_panic("Value for vbuf_size was too large. Must be < %ld", UINT_MAX);
@@ -70,6 +84,7 @@ process_teardown(void)
     if (cdb_handle != NULL) {
         cdb_handle_destroy(&cdb_handle);
     }
+    cdb_mmap_close(&cdb_db);
 
     if (value_buf.data != NULL) {
         char *p = value_buf.data;
@@ -81,6 +96,53 @@ process_teardown(void)
     process_init = false;
 }
 
+static inline void
+_set_value(struct response *rsp, struct bstring *key, struct bstring *vstr)
+{
+    rsp->type = RSP_VALUE;
+    rsp->key = *key;
+    rsp->flag = 0;
+    rsp->vcas = 0;
+    rsp->vstr = *vstr;
+}
+
+rstatus_i
+process_reload(const char *path)
+{
+    struct cdb_mmap *db, *old;
+    uint64_t reading;
+
+    if (cdb_db == NULL) {
+        log_warn("cannot reload: only a mmapped cdb can be reloaded");
+        INCR(process_metrics, reload_ex);
+        return CC_ERROR;
+    }
+
+    db = cdb_mmap_reopen(cdb_db, path);
+    if (db == NULL) {
+        log_error("cannot reload, still serving the previous file");
+        INCR(process_metrics, reload_ex);
+        return CC_ERROR;
+    }
+    cdb_mmap_warm(db);
+
+    old = __atomic_exchange_n(&cdb_db, db, __ATOMIC_SEQ_CST);
+
+    /* a read event which started before the swap may still hold values of the
+     * old file, any later one sees the new file */
+    reading = __atomic_load_n(&cdb_reading, __ATOMIC_SEQ_CST);
+    while ((reading & 1) &&
+            __atomic_load_n(&cdb_reading, __ATOMIC_SEQ_CST) == reading) {
+        usleep(RELOAD_WAIT_US);
+    }
+    cdb_mmap_close(&old);
+
+    log_info("reloaded cdb");
+    INCR(process_metrics, reload);
+
+    return CC_OK;
+}
+
 static bool
 _get_key(struct response *rsp, struct bstring *key)
 {
@@ -94,11 +156,7 @@ _get_key(struct response *rsp, struct bstring *key)
     struct bstring *vstr = cdb_get(cdb_handle, key, &(rsp->vstr));
 
     if (vstr != NULL) {
-        rsp->type = RSP_VALUE;
-        rsp->key = *key;
-        rsp->flag = 0;
-        rsp->vcas = 0;
-        rsp->vstr = *vstr;
+        _set_value(rsp, key, vstr);
 
         log_verb("found key at %p, location %p", key, vstr);
         return true;
@@ -108,6 +166,52 @@ _get_key(struct response *rsp, struct bstring *key)
     }
 }
 
+/* the values of the mmapped engine point into the file, so they are not
+ * copied. the keys are looked up CDB_MMAP_BATCH at a time, which overlaps the
+ * cache and page misses of the keys of a multiget */
+static void
+_process_get_batch(struct response *rsp, struct request *req)
+{
+    struct cdb_mmap *db = __atomic_load_n(&cdb_db, __ATOMIC_SEQ_CST);
+    struct bstring *keys[CDB_MMAP_BATCH];
+    struct bstring vals[CDB_MMAP_BATCH];
+    struct response *r = rsp;
+    uint32_t nkey = array_nelem(req->keys);
+    uint32_t i, j, n;
+
+    INCR(process_metrics, get);
+    for (i = 0; i < nkey; i += n) {
+        n = MIN(nkey - i, CDB_MMAP_BATCH);
+        for (j = 0; j < n; ++j) {
+            keys[j] = array_get(req->keys, i + j);
+        }
+        cdb_mmap_get_batch(db, keys, n, vals);
+
+        /* use chained responses, move to the next response if key is found. */
+        for (j = 0; j < n; ++j) {
+            INCR(process_metrics, get_key);
+            if (vals[j].data == NULL) {
+                INCR(process_metrics, get_key_miss);
+                continue;
+            }
+
+            _set_value(r, keys[j], &vals[j]);
+            req->nfound++;
+            r->cas = false;
+            r = STAILQ_NEXT(r, next);
+            if (r == NULL) {
+                INCR(process_metrics, get_ex);
+                log_warn("get response incomplete due to lack of rsp objects");
+                return;
+            }
+            INCR(process_metrics, get_key_hit);
+        }
+    }
+    r->type = RSP_END;
+
+    log_verb("get req %p processed, %d out of %d keys found", req, req->nfound, nkey);
+}
+
 static void
 _process_get(struct response *rsp, struct request *req)
 {
@@ -115,6 +219,11 @@ _process_get(struct response *rsp, struct request *req)
     struct response *r = rsp;
     uint32_t i;
 
+    if (cdb_db != NULL) {
+        _process_get_batch(rsp, req);
+        return;
+    }
+
     INCR(process_metrics, get);
     /* use chained responses, move to the next response if key is found. */
     for (i = 0; i < array_nelem(req->keys); ++i) {
@@ -180,8 +289,8 @@ _cleanup(struct request *req, struct response *rsp)
     req->rsp = rsp;
 }
 
-int
-cdb_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
+static int
+_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
 {
     parse_rstatus_e status;
     struct request *req; /* data should be NULL or hold a req pointer */
@@ -300,6 +409,18 @@ cdb_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
     return 0;
 }
 
+int
+cdb_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
+{
+    int ret;
+
+    __atomic_fetch_add(&cdb_reading, 1, __ATOMIC_SEQ_CST);
+    ret = _process_read(rbuf, wbuf, data);
+    __atomic_fetch_add(&cdb_reading, 1, __ATOMIC_SEQ_CST);
+
+    return ret;
+}
+
 
 int
 cdb_process_write(struct buf **rbuf, struct buf **wbuf, void **data)
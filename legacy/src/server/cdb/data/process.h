@@ -1,5 +1,6 @@
 #pragma once
 
+#include "storage/cdb/cdb_mmap.h"
 #include "storage/cdb/cdb_rs.h"
 
 #include <buffer/cc_buf.h>
@@ -27,15 +28,25 @@ typedef struct {
     ACTION( get_key_hit,       METRIC_COUNTER, "# key hits by get"     )\
     ACTION( get_key_miss,      METRIC_COUNTER, "# key misses by get"   )\
     ACTION( get_ex,            METRIC_COUNTER, "# get errors"          )\
-    ACTION( invalid,           METRIC_COUNTER, "# invalid command"     )
+    ACTION( invalid,           METRIC_COUNTER, "# invalid command"     )\
+    ACTION( reload,            METRIC_COUNTER, "# cdb files reloaded"  )\
+    ACTION( reload_ex,         METRIC_COUNTER, "# cdb reload errors"   )
 
 typedef struct {
     PROCESS_METRIC(METRIC_DECLARE)
 } process_metrics_st;
 
-void process_setup(process_options_st *options, process_metrics_st *metrics, struct cdb_handle *cdb_handle);
+/* values are served by the mmapped engine if db is set, by the cdb handle
+ * otherwise */
+void process_setup(process_options_st *options, process_metrics_st *metrics, struct cdb_handle *cdb_handle, struct cdb_mmap *db);
 void process_teardown(void);
 
+/* open and warm up the cdb file at the path, or the file being served if the
+ * path is NULL, then swap it in for the one being served, which is closed once
+ * no request reads it. only the mmapped engine can be reloaded. called from
+ * the admin thread */
+rstatus_i process_reload(const char *path);
+
 int cdb_process_read(struct buf **rbuf, struct buf **wbuf, void **data);
 int cdb_process_write(struct buf **rbuf, struct buf **wbuf, void **data);
 int cdb_process_error(struct buf **rbuf, struct buf **wbuf, void **data);
@@ -1,6 +1,7 @@
 #include "admin/process.h"
 #include "setting.h"
 #include "stats.h"
+#include "storage/cdb/cdb_mmap.h"
 #include "storage/cdb/cdb_rs.h"
 
 #include "time/time.h"
@@ -100,6 +101,19 @@ setup_cdb_handle(cdb_options_st *opt)
     return cdb_handle_create(&cfg);
 }
 
+static struct cdb_mmap *
+setup_cdb_mmap(cdb_options_st *opt)
+{
+    char *path = option_str(&opt->cdb_file_path);
+
+    if (path == NULL) {
+        log_stderr("cdb_file_path option not set, cannot continue");
+        exit(EX_CONFIG);
+    }
+
+    return cdb_mmap_open(path, option_bool(&opt->cdb_index_copy));
+}
+
 static void
 setup(void)
 {
@@ -145,15 +159,24 @@ setup(void)
     response_setup(&setting.response, &stats.response);
     parse_setup(&stats.parse_req, NULL);
     compose_setup(NULL, &stats.compose_rsp);
-    klog_setup(&setting.klog, &stats.klog);
-
-    struct cdb_handle *cdb_handle = setup_cdb_handle(&setting.cdb);
-    if (cdb_handle == NULL) {
+    klog_setup(&setting.klog, &stats.klog,
+            option_uint(&setting.worker.worker_nthread));
+
+    /* a mmapped file is served by the native engine, which prefetches the
+     * keys of a multiget and returns values without copying them */
+    struct cdb_handle *cdb_handle = NULL;
+    struct cdb_mmap *cdb_db = NULL;
+    if (option_bool(&setting.cdb.use_mmap)) {
+        cdb_db = setup_cdb_mmap(&setting.cdb);
+    } else {
+        cdb_handle = setup_cdb_handle(&setting.cdb);
+    }
+    if (cdb_handle == NULL && cdb_db == NULL) {
         log_stderr("failed to set up cdb");
         goto error;
     }
 
-    process_setup(&setting.process, &stats.process, cdb_handle);
+    process_setup(&setting.process, &stats.process, cdb_handle, cdb_db);
     admin_process_setup();
     core_admin_setup(&setting.admin);
     core_server_setup(&setting.server, &stats.server);
@@ -236,6 +259,12 @@ main(int argc, char **argv)
         exit(EX_DATAERR);
     }
 
+    /* the cdb processor is not thread-safe, so there is only one worker thread */
+    if (option_uint(&setting.worker.worker_nthread) > 1) {
+        log_stderr("cdb runs one worker thread, ignoring worker_nthread");
+        setting.worker.worker_nthread.val.vuint = 1;
+    }
+
     setup();
     option_print_all((struct option *)&setting, nopt);
 
@@ -23,6 +23,7 @@
     ACTION( pid_filename,   OPTION_TYPE_STR,    NULL,       "file storing the pid"                           )\
     ACTION( cdb_file_path,  OPTION_TYPE_STR,    "db.cdb",   "location of the .cdb file"                      )\
     ACTION( use_mmap,       OPTION_TYPE_BOOL,   false,      "use mmap to load the file, false: use the heap" )\
+    ACTION( cdb_index_copy, OPTION_TYPE_BOOL,   false,      "copy the mmapped hash tables to huge pages"     )\
     ACTION( dlog_intvl,     OPTION_TYPE_UINT,   500,        "debug log flush interval(ms)"                   )\
     ACTION( klog_intvl,     OPTION_TYPE_UINT,   100,        "cmd log flush interval(ms)"                     )
 
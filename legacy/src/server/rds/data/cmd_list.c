@@ -1,6 +1,6 @@
 #include "process.h"
 
-#include "data_structure/ziplist/ziplist.h"
+#include "data_structure/quicklist/quicklist.h"
 #include "protocol/data/resp_include.h"
 #include "storage/slab/item.h"
 #include "storage/slab/slab.h"
@@ -95,7 +95,8 @@ _add_key(struct response *rsp, const struct bstring *key)
         return NULL;
     } else {
         /* TODO: figure out a TTL story here */
-        istatus = item_reserve(&it, key, NULL, ZIPLIST_HEADER_SIZE, 0, INT32_MAX);
+        istatus = item_reserve(&it, key, NULL, QUICKLIST_HEADER_SIZE, 0,
+                INT32_MAX);
         if (istatus != ITEM_OK) {
             rsp->type = reply->type = ELEM_ERR;
             reply->bstr = str2bstr(RSP_ERR_STORAGE);
@@ -115,28 +116,28 @@ _add_key(struct response *rsp, const struct bstring *key)
  * require a larger item to fit.
  *  - If no, then returns OK status without altering item.
  *  - If yes, then attempts to reserve an item that would be large enough. If
- *    this succeeds, then it and zl are updated to the new item and its payload
+ *    this succeeds, then it and ql are updated to the new item and its payload
  *    respectively. If this fails, then a failure status is returned, and it
- *    and zl remain unchanged.
+ *    and ql remain unchanged.
  */
 static inline item_rstatus_e
-_realloc_list_item(struct item **it, ziplist_p *zl, const struct bstring *key,
+_realloc_list_item(struct item **it, quicklist_p *ql, const struct bstring *key,
         uint32_t delta)
 {
     ASSERT(it != NULL && *it != NULL);
-    ASSERT(zl != NULL && *zl != NULL);
+    ASSERT(ql != NULL && *ql != NULL);
     ASSERT(key != NULL);
 
     if (!item_will_fit(*it, delta)) {
         /* must alloc new item, cannot fit in place */
         struct item *nit;
-        struct bstring zl_str;
+        struct bstring ql_str;
         item_rstatus_e istatus;
 
-        zl_str.len = ziplist_size(*zl);
-        zl_str.data = (char *)*zl;
+        ql_str.len = quicklist_size(*ql);
+        ql_str.data = (char *)*ql;
 
-        istatus = item_reserve(&nit, key, &zl_str, item_nval(*it) + delta,
+        istatus = item_reserve(&nit, key, &ql_str, item_nval(*it) + delta,
                 0, INT32_MAX);
 
         if (istatus != ITEM_OK) {
@@ -144,7 +145,7 @@ _realloc_list_item(struct item **it, ziplist_p *zl, const struct bstring *key,
         }
 
         *it = nit;
-        *zl = (ziplist_p)item_data(nit);
+        *ql = (quicklist_p)item_data(nit);
         item_insert(nit, key);
     }
 
@@ -223,8 +224,8 @@ cmd_list_create(struct response *rsp, const struct request *req, const struct
     }
 
     /* initialize data structure */
-    ziplist_reset((ziplist_p)item_data(it));
-    it->vlen = ZIPLIST_HEADER_SIZE;
+    quicklist_reset((quicklist_p)item_data(it));
+    it->vlen = QUICKLIST_HEADER_SIZE;
 
     /* link into index */
     item_insert(it, key);
@@ -250,8 +251,8 @@ _delete_list_vals(struct element *reply, struct response *rsp, const struct bstr
         const struct element *val, const struct command *cmd, int64_t cnt)
 {
     struct item *it = item_get(key);
-    ziplist_p zl;
-    ziplist_rstatus_e status;
+    quicklist_p ql;
+    quicklist_rstatus_e status;
     struct blob vblob;
     uint32_t removed;
 
@@ -264,20 +265,21 @@ _delete_list_vals(struct element *reply, struct response *rsp, const struct bstr
     /* count == 0 means remove all */
     cnt = cnt == 0 ? INT64_MAX : cnt;
 
-    zl = (ziplist_p)item_data(it);
+    ql = (quicklist_p)item_data(it);
     _elem2blob(&vblob, val);
-    status = ziplist_remove_val(&removed, zl, &vblob, cnt);
+    status = quicklist_remove_val(&removed, ql, &vblob, cnt);
 
     switch (status) {
-    case ZIPLIST_OK:
+    case QUICKLIST_OK:
         /* TODO: should we try to "fit" to a smaller item here? */
+        it->vlen = quicklist_size(ql);
         rsp->type = reply->type = ELEM_INT;
         reply->num = removed;
         INCR(process_metrics, list_delete_deleted);
         log_verb("command '%.*s' '%.*s' succeeded, %u entries deleted",
                 cmd->bstr.len, cmd->bstr.data, key->len, key->data, removed);
         break;
-    case ZIPLIST_EINVALID:
+    case QUICKLIST_EINVALID:
         /* client error, bad argument */
         rsp->type = reply->type = ELEM_ERR;
         reply->bstr = str2bstr(RSP_ERR_ARG);
@@ -286,8 +288,8 @@ _delete_list_vals(struct element *reply, struct response *rsp, const struct bstr
                 cmd->bstr.len, cmd->bstr.data, key->len, key->data);
         break;
     default:
-        /* should never return ZIPLIST_ERROR, because
-           zl and val should never be NULL */
+        /* should never return QUICKLIST_ERROR, because
+           ql and val should never be NULL */
         NOT_REACHED();
     }
 }
@@ -336,8 +338,8 @@ cmd_list_trim(struct response *rsp, const struct request *req, const struct
     struct bstring *key = _get_key(req);
     struct element *reply = (struct element *)array_push(rsp->token);
     struct item *it = item_get(key);
-    ziplist_p zl;
-    ziplist_rstatus_e status;
+    quicklist_p ql;
+    quicklist_rstatus_e status;
     int64_t idx, cnt;
 
     /* client error from wrong # args should be handled in parse phase */
@@ -351,7 +353,7 @@ cmd_list_trim(struct response *rsp, const struct request *req, const struct
         return;
     }
 
-    zl = (ziplist_p)item_data(it);
+    ql = (quicklist_p)item_data(it);
 
     if (!_get_idx(&idx, req)) {
         _rsp_client_err(rsp, reply, cmd, key);
@@ -363,18 +365,19 @@ cmd_list_trim(struct response *rsp, const struct request *req, const struct
         return;
     }
 
-    status = ziplist_trim(zl, idx, cnt);
+    status = quicklist_trim(ql, idx, cnt);
 
-    if (status != ZIPLIST_OK) {
-        /* other ziplist errs should not occur, since we
+    if (status != QUICKLIST_OK) {
+        /* other quicklist errs should not occur, since we
            have already done all of our input checking */
-        ASSERT(status == ZIPLIST_EOOB);
+        ASSERT(status == QUICKLIST_EOOB);
         _rsp_oob(rsp, reply, cmd, key, idx);
         INCR(process_metrics, list_trim_oob);
         return;
     }
 
     /* TODO: should we try to "fit" to a smaller item here? */
+    it->vlen = quicklist_size(ql);
 
     _rsp_ok(rsp, reply, cmd, key);
 }
@@ -386,7 +389,6 @@ cmd_list_len(struct response *rsp, const struct request *req, const struct
     struct bstring *key = _get_key(req);
     struct element *reply = (struct element *)array_push(rsp->token);
     struct item *it = item_get(key);
-    ziplist_p zl;
     uint32_t nentry;
 
     /* client error from wrong # args should be handled in parse phase */
@@ -400,8 +402,7 @@ cmd_list_len(struct response *rsp, const struct request *req, const struct
         return;
     }
 
-    zl = (ziplist_p)item_data(it);
-    nentry = ziplist_nentry(zl);
+    nentry = quicklist_nentry((quicklist_p)item_data(it));
 
     rsp->type = reply->type = ELEM_INT;
     reply->num = (int64_t)nentry;
@@ -422,6 +423,74 @@ cmd_list_find(struct response *rsp, const struct request *req, const struct
     reply->bstr = str2bstr(RSP_ERR_NOSUPPORT);
 }
 
+static inline void
+_zipentry2elem(struct element *elem, const zipentry_p ze)
+{
+    struct blob val;
+
+    /* val should be valid if it was inserted properly */
+    zipentry_get(&val, ze);
+
+    switch (val.type) {
+    case (BLOB_TYPE_INT):
+        elem->type = ELEM_INT;
+        elem->num = (int64_t)val.vint;
+        break;
+    case (BLOB_TYPE_STR):
+        elem->type = ELEM_BULK;
+        elem->bstr = val.vstr;
+        break;
+    default:
+        NOT_REACHED();
+    }
+}
+
+/* reply with up to cnt entries starting at idx, which is walked to once */
+static inline void
+_get_list_range(struct element *reply, struct response *rsp,
+        const struct bstring *key, const struct command *cmd,
+        const quicklist_p ql, int64_t idx, int64_t cnt)
+{
+    struct quicklist_iter iter;
+    quicklist_rstatus_e status;
+    uint32_t nentry = quicklist_nentry(ql);
+    int64_t n;
+
+    if (cnt < 0) {
+        _rsp_client_err(rsp, reply, cmd, key);
+        return;
+    }
+
+    rsp->type = reply->type = ELEM_ARRAY;
+    reply->num = 0;
+    if (nentry == 0 || cnt == 0) {
+        return;
+    }
+
+    status = quicklist_seek(&iter, ql, idx);
+    if (status != QUICKLIST_OK) {
+        ASSERT(status == QUICKLIST_EOOB);
+        _rsp_oob(rsp, reply, cmd, key, idx);
+        INCR(process_metrics, list_get_oob);
+        return;
+    }
+
+    /* reply may move as tokens are pushed, so it is not used past here */
+    idx += (idx < 0) * nentry;
+    n = (cnt < nentry - idx) ? cnt : nentry - idx;
+    reply->num = n;
+    for (int64_t i = 0; i < n; ++i) {
+        if (i > 0) {
+            status = quicklist_next(&iter, ql);
+            ASSERT(status == QUICKLIST_OK);
+        }
+        _zipentry2elem((struct element *)array_push(rsp->token), iter.ze);
+    }
+
+    log_verb("command '%.*s' '%.*s' succeeded, returning %"PRIi64" entries",
+            cmd->bstr.len, cmd->bstr.data, key->len, key->data, n);
+}
+
 void
 cmd_list_get(struct response *rsp, const struct request *req, const struct
         command *cmd)
@@ -429,14 +498,14 @@ cmd_list_get(struct response *rsp, const struct request *req, const struct
     struct bstring *key = _get_key(req);
     struct element *reply = (struct element *)array_push(rsp->token);
     struct item *it = item_get(key);
-    ziplist_p zl;
+    uint32_t narg = array_nelem(req->token);
+    quicklist_p ql;
     zipentry_p ze;
-    ziplist_rstatus_e status;
-    int64_t idx;
-    struct blob val;
+    quicklist_rstatus_e status;
+    int64_t idx, cnt;
 
-    /* client error from wrong # args should be handled in parse phase */
-    ASSERT(array_nelem(req->token) == cmd->narg);
+    /* client error from not enough args should be handled in parse phase */
+    ASSERT(narg >= cmd->narg);
 
     INCR(process_metrics, list_get);
 
@@ -446,40 +515,44 @@ cmd_list_get(struct response *rsp, const struct request *req, const struct
         return;
     }
 
-    zl = (ziplist_p)item_data(it);
+    ql = (quicklist_p)item_data(it);
+
+    switch (narg - 1) {
+    case LIST_KEY:
+        /* only key given, get entire list */
+        _get_list_range(reply, rsp, key, cmd, ql, 0, quicklist_nentry(ql));
+        return;
+    case LIST_IDX:
+        break;
+    case LIST_CNT:
+        if (!_get_idx(&idx, req) || !_get_cnt(&cnt, req)) {
+            _rsp_client_err(rsp, reply, cmd, key);
+            return;
+        }
+        _get_list_range(reply, rsp, key, cmd, ql, idx, cnt);
+        return;
+    default:
+        /* client error from too many args should be handled in parse phase */
+        NOT_REACHED();
+    }
 
     if (!_get_idx(&idx, req)) {
         _rsp_client_err(rsp, reply, cmd, key);
         return;
     }
 
-    status = ziplist_locate(&ze, zl, idx);
+    status = quicklist_locate(&ze, ql, idx);
 
-    if (status != ZIPLIST_OK) {
+    if (status != QUICKLIST_OK) {
         /* other error status should not happen, we have checked all our input */
-        ASSERT(status == ZIPLIST_EOOB);
+        ASSERT(status == QUICKLIST_EOOB);
         _rsp_oob(rsp, reply, cmd, key, idx);
         INCR(process_metrics, list_get_oob);
         return;
     }
 
-    status = zipentry_get(&val, ze);
-
-    /* val should be valid if it was inserted properly */
-    ASSERT(status == ZIPLIST_OK);
-
-    switch (val.type) {
-    case (BLOB_TYPE_INT):
-        rsp->type = reply->type = ELEM_INT;
-        reply->num = (int64_t)val.vint;
-        break;
-    case (BLOB_TYPE_STR):
-        rsp->type = reply->type = ELEM_BULK;
-        reply->bstr = val.vstr;
-        break;
-    default:
-        NOT_REACHED();
-    }
+    _zipentry2elem(reply, ze);
+    rsp->type = reply->type;
 
     log_verb("command '%.*s' '%.*s' succeeded",
             cmd->bstr.len, cmd->bstr.data, key->len, key->data);
@@ -492,10 +565,11 @@ cmd_list_insert(struct response *rsp, const struct request *req, const struct
     struct bstring *key = _get_key(req);
     struct element *reply = (struct element *)array_push(rsp->token);
     struct item *it = item_get(key);
-    ziplist_p zl;
-    ziplist_rstatus_e status;
+    quicklist_p ql;
+    quicklist_rstatus_e status;
     struct blob vblob;
-    int64_t idx;
+    int64_t idx, nentry;
+    uint32_t delta;
     uint8_t ze_len;
 
     /* client error from wrong # args should be handled in parse phase */
@@ -509,7 +583,7 @@ cmd_list_insert(struct response *rsp, const struct request *req, const struct
         return;
     }
 
-    zl = (ziplist_p)item_data(it);
+    ql = (quicklist_p)item_data(it);
     _elem2blob(&vblob, _get_val(req));
 
     if (!_get_vidx(&idx, req)) {
@@ -518,7 +592,8 @@ cmd_list_insert(struct response *rsp, const struct request *req, const struct
     }
 
     /* pre-emptively check idx is in bounds, so we don't do extra work if not */
-    if (idx >= ziplist_nentry(zl)) {
+    nentry = quicklist_nentry(ql);
+    if (idx >= nentry || idx < -nentry) {
         _rsp_oob(rsp, reply, cmd, key, idx);
         INCR(process_metrics, list_insert_oob);
         return;
@@ -530,18 +605,20 @@ cmd_list_insert(struct response *rsp, const struct request *req, const struct
         return;
     }
 
-    if (_realloc_list_item(&it, &zl, key, (uint32_t)ze_len) != ITEM_OK) {
+    delta = quicklist_insert_delta(ql, idx, ze_len);
+    if (_realloc_list_item(&it, &ql, key, delta) != ITEM_OK) {
         _rsp_storage_err(rsp, reply, cmd, key);
         INCR(process_metrics, list_insert_ex);
         return;
     }
 
-    ASSERT(item_will_fit(it, (uint32_t)ze_len));
+    ASSERT(item_will_fit(it, delta));
 
-    status = ziplist_insert(zl, &vblob, idx);
+    status = quicklist_insert(ql, &vblob, idx);
+    it->vlen = quicklist_size(ql);
 
     /* any errs should not occur, given the input checking above */
-    ASSERT(status == ZIPLIST_OK);
+    ASSERT(status == QUICKLIST_OK);
 
     _rsp_ok(rsp, reply, cmd, key);
 }
@@ -554,8 +631,9 @@ cmd_list_push(struct response *rsp, const struct request *req, const struct
     struct element *reply = (struct element *)array_push(rsp->token);
     struct item *it = item_get(key);
     uint32_t i, delta = 0;
-    ziplist_p zl;
-    ziplist_rstatus_e status;
+    quicklist_p ql;
+    quicklist_rstatus_e status;
+    struct quicklist_tail tail;
 
     /* client error from wrong # args should be handled in parse phase */
     ASSERT(array_nelem(req->token) >= cmd->narg);
@@ -568,9 +646,10 @@ cmd_list_push(struct response *rsp, const struct request *req, const struct
         return;
     }
 
-    zl = (ziplist_p)item_data(it);
+    ql = (quicklist_p)item_data(it);
 
-    /* calculate additional length of ziplist after pushing all vals */
+    /* calculate additional length of quicklist after pushing all vals */
+    quicklist_tail(&tail, ql);
     for (i = LIST_VAL; i < array_nelem(req->token); ++i) {
         struct blob vblob;
         uint8_t ze_sz;
@@ -582,10 +661,10 @@ cmd_list_push(struct response *rsp, const struct request *req, const struct
             return;
         }
 
-        delta += ze_sz;
+        delta += quicklist_push_delta(&tail, ze_sz);
     }
 
-    if (_realloc_list_item(&it, &zl, key, delta) != ITEM_OK) {
+    if (_realloc_list_item(&it, &ql, key, delta) != ITEM_OK) {
         _rsp_storage_err(rsp, reply, cmd, key);
         INCR(process_metrics, list_push_ex);
         return;
@@ -596,11 +675,12 @@ cmd_list_push(struct response *rsp, const struct request *req, const struct
     for (i = LIST_VAL; i < array_nelem(req->token); ++i) {
         struct blob vblob;
         _elem2blob(&vblob, array_get(req->token, i));
-        status = ziplist_push(zl, &vblob);
+        status = quicklist_push(ql, &vblob);
 
         /* invalid val errs should have been taken care of above */
-        ASSERT(status == ZIPLIST_OK);
+        ASSERT(status == QUICKLIST_OK);
     }
+    it->vlen = quicklist_size(ql);
 
     _rsp_ok(rsp, reply, cmd, key);
 }
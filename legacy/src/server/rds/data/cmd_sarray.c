@@ -18,6 +18,14 @@ static uint64_t vals[MAX_NVAL];
 static struct bstring null_key = null_bstring;
 
 
+static int
+_compare_val(const void *a, const void *b)
+{
+    uint64_t va = *(const uint64_t *)a, vb = *(const uint64_t *)b;
+
+    return (va > vb) - (va < vb);
+}
+
 static inline uint32_t
 _watermark_low(uint32_t *opt)
 {
@@ -330,8 +338,8 @@ cmd_sarray_insert(struct response *rsp, const struct request *req, const struct
     struct element *reply = (struct element *)array_push(rsp->token);
     struct bstring *key = &null_key;
     struct item *it;
-    uint32_t nval = 0, esize;
-    int64_t delta, wml, wmh, nentry, ninserted = 0;
+    uint32_t nval = 0, esize, ninserted;
+    int64_t delta, wml, wmh, nentry;
     uint64_t val;
     sarray_p sa;
     sarray_rstatus_e status;
@@ -423,24 +431,19 @@ cmd_sarray_insert(struct response *rsp, const struct request *req, const struct
         item_insert(nit, key);
     }
 
+    /* inserting values in order merges them in one pass over the array */
+    qsort(vals, nval, sizeof(uint64_t), _compare_val);
     sa = (sarray_p)item_data(it); /* item might have changed */
-    for (uint32_t i = 0; i < nval; ++i) {
-        status = sarray_insert(sa, vals[i]);
-        if (status == SARRAY_EINVALID) {
-            log_debug("value %"PRIu32" out of %"PRIu32" is invalid", i, nval);
-            compose_rsp_client_err(rsp, reply, cmd, key);
-            INCR(process_metrics, sarray_insert_ex);
-            return;
-        }
-
-        if (status == SARRAY_EDUP) {
-            INCR(process_metrics, sarray_insert_noop);
-        } else {
-            INCR(process_metrics, sarray_insert_ok);
-            ninserted++;
-            it->vlen += esize;
-        }
+    status = sarray_insert_many(&ninserted, sa, vals, nval);
+    if (status == SARRAY_EINVALID) {
+        log_debug("some of the %"PRIu32" values are invalid", nval);
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, sarray_insert_ex);
+        return;
     }
+    INCR_N(process_metrics, sarray_insert_ok, ninserted);
+    INCR_N(process_metrics, sarray_insert_noop, nval - ninserted);
+    it->vlen += esize * ninserted;
 
     if (it->olen > 0) {
         wml = _watermark_low((uint32_t *)item_optional(it));
@@ -0,0 +1,849 @@
+#include "process.h"
+#include "shared.h"
+
+#include "data_structure/zset/zset.h"
+#include "storage/slab/item.h"
+#include "storage/slab/slab.h"
+
+#include <cc_array.h>
+#include <cc_bstring.h>
+#include <cc_debug.h>
+#include <cc_mm.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#define SCORE_MAXLEN 32   /* max length of a score in a response, w/ nul */
+#define SCORE_ARGLEN 128  /* max length of a score in a request */
+
+/* scores of a response, which have to last until the response is composed */
+static char *scores = NULL;
+static uint32_t nscore = 0;
+static struct bstring null_key = null_bstring;
+
+
+static inline bool
+_opt_is(const struct bstring *opt, const char *name)
+{
+    size_t len = strlen(name);
+
+    return opt->len == len && strncasecmp(opt->data, name, len) == 0;
+}
+
+/* a score may be -inf/+inf, or be exclusive (prefixed with `(') in ranges */
+static inline bool
+_req_get_score(double *score, bool *exclusive, const struct request *req,
+        uint32_t offset)
+{
+    struct bstring *bstr;
+    char str[SCORE_ARGLEN], *end;
+    char *data;
+    uint32_t len;
+
+    if (!req_get_bstr(&bstr, req, offset)) {
+        return false;
+    }
+
+    data = bstr->data;
+    len = bstr->len;
+    if (exclusive != NULL) {
+        *exclusive = (len > 0 && *data == '(');
+        data += *exclusive;
+        len -= *exclusive;
+    }
+    if (len == 0 || len >= SCORE_ARGLEN) {
+        return false;
+    }
+
+    cc_memcpy(str, data, len);
+    str[len] = '\0';
+    *score = strtod(str, &end);
+
+    return end == str + len && !isnan(*score);
+}
+
+static inline bool
+_score_reserve(uint32_t n)
+{
+    char *buf;
+
+    if (n <= nscore) {
+        return true;
+    }
+
+    buf = cc_realloc(scores, (size_t)n * SCORE_MAXLEN);
+    if (buf == NULL) {
+        log_error("cannot allocate buffer for %"PRIu32" scores", n);
+
+        return false;
+    }
+    scores = buf;
+    nscore = n;
+
+    return true;
+}
+
+/* format the score into slot i of the buffer, which has been reserved */
+static inline void
+_score_bstr(struct bstring *bstr, uint32_t i, double score)
+{
+    ASSERT(i < nscore);
+
+    bstr->data = scores + (size_t)i * SCORE_MAXLEN;
+    bstr->len = snprintf(bstr->data, SCORE_MAXLEN, "%.17g", score);
+}
+
+static inline void
+_rsp_score(struct response *rsp, struct element *reply,
+        const struct command *cmd, const struct bstring *key, double score)
+{
+    rsp->type = reply->type = ELEM_BULK;
+    _score_bstr(&reply->bstr, 0, score);
+    log_verb("command '%.*s' '%.*s' succeeded, score is %.*s", cmd->bstr.len,
+            cmd->bstr.data, key->len, key->data, reply->bstr.len,
+            reply->bstr.data);
+}
+
+/* write members of rank in [lo, hi), from lo up, or from hi down if reverse,
+ * as an array, which reply is the header of
+ */
+static void
+_rsp_range(struct response *rsp, struct element *reply, zset_p zs,
+        uint32_t lo, uint32_t hi, bool reverse, bool withscores)
+{
+    uint32_t n = hi - lo;
+    double score;
+    zset_rstatus_e status;
+
+    rsp->type = reply->type = ELEM_ARRAY;
+    reply->num = (int64_t)n * (1 + withscores);
+
+    for (uint32_t i = 0; i < n; ++i) {
+        reply = (struct element *)array_push(rsp->token);
+        reply->type = ELEM_BULK;
+        status = zset_entry(&score, &reply->bstr, zs, reverse ? hi - 1 - i :
+                lo + i);
+        ASSERT(status == ZSET_OK);
+        if (withscores) {
+            reply = (struct element *)array_push(rsp->token);
+            reply->type = ELEM_BULK;
+            _score_bstr(&reply->bstr, i, score);
+        }
+    }
+}
+
+/* ranks from start to stop, both inclusive and counting from the end if
+ * negative, as [lo, hi), which is empty if lo >= hi
+ */
+static inline void
+_rank_range(uint32_t *lo, uint32_t *hi, int64_t start, int64_t stop,
+        uint32_t nentry)
+{
+    start += (start < 0) * (int64_t)nentry;
+    stop += (stop < 0) * (int64_t)nentry;
+    start = (start < 0) ? 0 : start;
+    stop = (stop >= (int64_t)nentry) ? (int64_t)nentry - 1 : stop;
+
+    *lo = *hi = 0;
+    if (start <= stop) {
+        *lo = (uint32_t)start;
+        *hi = (uint32_t)stop + 1;
+    }
+}
+
+/* ranks of scores between min and max as [lo, hi) */
+static inline void
+_score_range(uint32_t *lo, uint32_t *hi, zset_p zs, double min, bool min_ex,
+        double max, bool max_ex)
+{
+    *lo = zset_count_below(zs, min, min_ex);
+    *hi = zset_count_below(zs, max, !max_ex);
+    *hi = (*hi < *lo) ? *lo : *hi;
+}
+
+/* options of ranges, LIMIT is only allowed when limit is passed in */
+static inline bool
+_range_opts(bool *withscores, int64_t *limit, int64_t *count,
+        const struct request *req)
+{
+    struct bstring *opt;
+    uint32_t narg = array_nelem(req->token);
+
+    *withscores = false;
+    for (uint32_t i = ZSET_OPT; i < narg; ++i) {
+        if (!req_get_bstr(&opt, req, i)) {
+            return false;
+        }
+
+        if (_opt_is(opt, "withscores")) {
+            *withscores = true;
+        } else if (limit != NULL && _opt_is(opt, "limit") && i + 2 < narg &&
+                req_get_int(limit, req, i + 1) &&
+                req_get_int(count, req, i + 2)) {
+            i += 2;
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Attempt to make room for delta more bytes in the zset of key, in place if
+ * possible, otherwise by moving it into a larger item; the item is created
+ * with an empty zset if it is NULL.
+ */
+static item_rstatus_e
+_zset_fit(struct item **it_p, const struct bstring *key, uint32_t delta)
+{
+    struct item *it = *it_p, *nit;
+    item_rstatus_e status;
+
+    if (it != NULL && item_will_fit(it, delta)) {
+        return ITEM_OK;
+    }
+
+    if (it == NULL) {
+        /* TODO: figure out a TTL story here */
+        status = item_reserve(&nit, key, NULL, ZSET_HEADER_SIZE + delta, 0,
+                INT32_MAX);
+        if (status != ITEM_OK) {
+            return status;
+        }
+
+        zset_init((zset_p)item_data(nit));
+        nit->vlen = ZSET_HEADER_SIZE;
+    } else {
+        /* carry over all applicable item metadata */
+        status = item_reserve(&nit, key, NULL, item_nval(it) + delta, it->olen,
+                it->expire_at);
+        if (status != ITEM_OK) {
+            return status;
+        }
+
+        cc_memcpy(nit->end, it->end, item_npayload(it));
+        nit->vlen = it->vlen;
+    }
+
+    log_verb("successfully resized item for key '%.*s' to allow delta of %"
+            PRIu32" bytes", key->len, key->data, delta);
+
+    item_insert(nit, key);
+    *it_p = nit;
+
+    return ITEM_OK;
+}
+
+/* sets that become empty are deleted */
+static inline void
+_zset_shrunk(struct item *it, const struct bstring *key)
+{
+    zset_p zs = (zset_p)item_data(it);
+
+    if (zset_nentry(zs) == 0) {
+        item_delete(key);
+    } else {
+        it->vlen = zset_size(zs);
+    }
+}
+
+
+void
+cmd_zset_add(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key, *member = &null_key, *opt;
+    struct item *it;
+    bool nx = false, xx = false, ch = false;
+    uint32_t narg, first, delta = 0;
+    int64_t nadded = 0, nchanged = 0;
+    double score = 0.0, old;
+    zset_p zs;
+
+    narg = array_nelem(req->token);
+    ASSERT(narg > cmd->narg);
+
+    INCR(process_metrics, zset_add);
+
+    if (!req_get_bstr(&key, req, ZSET_KEY)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_add_ex);
+
+        return;
+    }
+
+    for (first = ZSET_SCORE; first < narg; ++first) {
+        if (!req_get_bstr(&opt, req, first)) {
+            break;
+        }
+        if (_opt_is(opt, "nx")) {
+            nx = true;
+        } else if (_opt_is(opt, "xx")) {
+            xx = true;
+        } else if (_opt_is(opt, "ch")) {
+            ch = true;
+        } else {
+            break;
+        }
+    }
+    if ((nx && xx) || first == narg || ((narg - first) & 0x1)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_add_ex);
+
+        return;
+    }
+
+    it = item_get(key);
+    zs = (it == NULL) ? NULL : (zset_p)item_data(it);
+
+    /* validate everything and find out how much the set may grow first, so
+     * the request is never applied partially
+     */
+    for (uint32_t i = first; i < narg; i += 2) {
+        if (!_req_get_score(&score, NULL, req, i) ||
+                !req_get_bstr(&member, req, i + 1) ||
+                member->len > ZSET_MEMBER_MAXLEN) {
+            log_debug("score or member at offset %"PRIu32" is invalid", i);
+            compose_rsp_client_err(rsp, reply, cmd, key);
+            INCR(process_metrics, zset_add_ex);
+
+            return;
+        }
+        if (!xx && (zs == NULL || zset_score(&old, zs, member) != ZSET_OK)) {
+            delta += zset_esize(member);
+        }
+    }
+
+    if (delta > 0 && _zset_fit(&it, key, delta) != ITEM_OK) {
+        compose_rsp_storage_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_add_ex);
+
+        return;
+    }
+
+    if (it != NULL) {
+        zs = (zset_p)item_data(it); /* item might have changed */
+        for (uint32_t i = first; i < narg; i += 2) {
+            _req_get_score(&score, NULL, req, i);
+            req_get_bstr(&member, req, i + 1);
+            if (zset_score(&old, zs, member) == ZSET_OK) {
+                if (!nx && old != score) {
+                    zset_update(zs, member, score);
+                    nchanged++;
+                    INCR(process_metrics, zset_add_update);
+                }
+            } else if (!xx) {
+                zset_insert(zs, member, score);
+                nadded++;
+                INCR(process_metrics, zset_add_ok);
+            }
+        }
+        it->vlen = zset_size(zs);
+    }
+
+    compose_rsp_numeric(rsp, reply, cmd, key, nadded + ch * nchanged);
+}
+
+void
+cmd_zset_incrby(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key, *member;
+    struct item *it;
+    double incr, score;
+    zset_p zs;
+
+    ASSERT(array_nelem(req->token) > cmd->narg);
+
+    INCR(process_metrics, zset_incrby);
+
+    if (!req_get_bstr(&key, req, ZSET_KEY) ||
+            !_req_get_score(&incr, NULL, req, ZSET_SCORE) ||
+            !req_get_bstr(&member, req, ZSET_IMEMBER) ||
+            member->len > ZSET_MEMBER_MAXLEN) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_incrby_ex);
+
+        return;
+    }
+
+    if (!_score_reserve(1)) {
+        compose_rsp_server_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_incrby_ex);
+
+        return;
+    }
+
+    it = item_get(key);
+    if (it != NULL && zset_score(&score, (zset_p)item_data(it), member) ==
+            ZSET_OK) {
+        score += incr;
+        if (zset_update((zset_p)item_data(it), member, score) != ZSET_OK) {
+            /* e.g. adding -inf to +inf */
+            compose_rsp_client_err(rsp, reply, cmd, key);
+            INCR(process_metrics, zset_incrby_ex);
+
+            return;
+        }
+    } else {
+        if (_zset_fit(&it, key, zset_esize(member)) != ITEM_OK) {
+            compose_rsp_storage_err(rsp, reply, cmd, key);
+            INCR(process_metrics, zset_incrby_ex);
+
+            return;
+        }
+        score = incr;
+        zs = (zset_p)item_data(it);
+        zset_insert(zs, member, score);
+        it->vlen = zset_size(zs);
+    }
+
+    _rsp_score(rsp, reply, cmd, key, score);
+}
+
+void
+cmd_zset_rem(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key, *member = &null_key;
+    struct item *it;
+    uint32_t narg;
+    int64_t nremoved = 0;
+    zset_p zs;
+
+    narg = array_nelem(req->token);
+    ASSERT(narg > cmd->narg);
+
+    INCR(process_metrics, zset_rem);
+
+    if (!req_get_bstr(&key, req, ZSET_KEY)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_rem_ex);
+
+        return;
+    }
+    for (uint32_t i = ZSET_MEMBER; i < narg; ++i) {
+        if (!req_get_bstr(&member, req, i)) {
+            compose_rsp_client_err(rsp, reply, cmd, key);
+            INCR(process_metrics, zset_rem_ex);
+
+            return;
+        }
+    }
+
+    it = item_get(key);
+    if (it == NULL) {
+        compose_rsp_numeric(rsp, reply, cmd, key, 0);
+        INCR(process_metrics, zset_rem_notfound);
+
+        return;
+    }
+
+    zs = (zset_p)item_data(it);
+    for (uint32_t i = ZSET_MEMBER; i < narg; ++i) {
+        req_get_bstr(&member, req, i);
+        if (zset_remove(zs, member) == ZSET_OK) {
+            nremoved++;
+            INCR(process_metrics, zset_rem_ok);
+        }
+    }
+    _zset_shrunk(it, key);
+
+    compose_rsp_numeric(rsp, reply, cmd, key, nremoved);
+}
+
+/* remove members of rank in [lo, hi) */
+static inline void
+_zset_remove_range(struct response *rsp, struct element *reply,
+        const struct command *cmd, const struct bstring *key, struct item *it,
+        uint32_t lo, uint32_t hi)
+{
+    zset_p zs = (zset_p)item_data(it);
+
+    for (uint32_t rank = hi; rank > lo; --rank) {
+        zset_remove_rank(zs, rank - 1);
+    }
+    INCR_N(process_metrics, zset_rem_ok, hi - lo);
+    _zset_shrunk(it, key);
+
+    compose_rsp_numeric(rsp, reply, cmd, key, (int64_t)(hi - lo));
+}
+
+void
+cmd_zset_remrangebyrank(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key;
+    struct item *it;
+    int64_t start, stop;
+    uint32_t lo, hi;
+
+    ASSERT(array_nelem(req->token) > cmd->narg);
+
+    INCR(process_metrics, zset_rem);
+
+    if (!req_get_bstr(&key, req, ZSET_KEY) ||
+            !req_get_int(&start, req, ZSET_START) ||
+            !req_get_int(&stop, req, ZSET_STOP)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_rem_ex);
+
+        return;
+    }
+
+    it = item_get(key);
+    if (it == NULL) {
+        compose_rsp_numeric(rsp, reply, cmd, key, 0);
+        INCR(process_metrics, zset_rem_notfound);
+
+        return;
+    }
+
+    _rank_range(&lo, &hi, start, stop, zset_nentry((zset_p)item_data(it)));
+    _zset_remove_range(rsp, reply, cmd, key, it, lo, hi);
+}
+
+void
+cmd_zset_remrangebyscore(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key;
+    struct item *it;
+    double min, max;
+    bool min_ex, max_ex;
+    uint32_t lo, hi;
+
+    ASSERT(array_nelem(req->token) > cmd->narg);
+
+    INCR(process_metrics, zset_rem);
+
+    if (!req_get_bstr(&key, req, ZSET_KEY) ||
+            !_req_get_score(&min, &min_ex, req, ZSET_MIN) ||
+            !_req_get_score(&max, &max_ex, req, ZSET_MAX)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_rem_ex);
+
+        return;
+    }
+
+    it = item_get(key);
+    if (it == NULL) {
+        compose_rsp_numeric(rsp, reply, cmd, key, 0);
+        INCR(process_metrics, zset_rem_notfound);
+
+        return;
+    }
+
+    _score_range(&lo, &hi, (zset_p)item_data(it), min, min_ex, max, max_ex);
+    _zset_remove_range(rsp, reply, cmd, key, it, lo, hi);
+}
+
+static void
+_zset_range(struct response *rsp, const struct request *req,
+        const struct command *cmd, bool reverse)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key;
+    struct item *it;
+    int64_t start, stop;
+    uint32_t nentry, lo, hi;
+    bool withscores;
+
+    ASSERT(array_nelem(req->token) > cmd->narg);
+
+    INCR(process_metrics, zset_range);
+
+    if (!req_get_bstr(&key, req, ZSET_KEY) ||
+            !req_get_int(&start, req, ZSET_START) ||
+            !req_get_int(&stop, req, ZSET_STOP) ||
+            !_range_opts(&withscores, NULL, NULL, req)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_range_ex);
+
+        return;
+    }
+
+    it = item_get(key);
+    if (it == NULL) {
+        _rsp_range(rsp, reply, NULL, 0, 0, reverse, withscores);
+        INCR(process_metrics, zset_range_notfound);
+
+        return;
+    }
+
+    nentry = zset_nentry((zset_p)item_data(it));
+    _rank_range(&lo, &hi, start, stop, nentry);
+    if (reverse) { /* ranks count from the highest score */
+        uint32_t rlo = lo;
+
+        lo = nentry - hi;
+        hi = nentry - rlo;
+    }
+    if (withscores && !_score_reserve(hi - lo)) {
+        compose_rsp_server_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_range_ex);
+
+        return;
+    }
+
+    _rsp_range(rsp, reply, (zset_p)item_data(it), lo, hi, reverse, withscores);
+    log_verb("command '%.*s' '%.*s' succeeded, returning %"PRIu32" members",
+            cmd->bstr.len, cmd->bstr.data, key->len, key->data, hi - lo);
+}
+
+void
+cmd_zset_range(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    _zset_range(rsp, req, cmd, false);
+}
+
+void
+cmd_zset_revrange(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    _zset_range(rsp, req, cmd, true);
+}
+
+static void
+_zset_rangebyscore(struct response *rsp, const struct request *req,
+        const struct command *cmd, bool reverse)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key;
+    struct item *it;
+    int64_t limit = 0, count = -1;
+    double min, max;
+    bool min_ex, max_ex, withscores;
+    uint32_t lo, hi;
+
+    ASSERT(array_nelem(req->token) > cmd->narg);
+
+    INCR(process_metrics, zset_range);
+
+    /* the reverse range goes from max to min */
+    if (!req_get_bstr(&key, req, ZSET_KEY) ||
+            !_req_get_score(&min, &min_ex, req, reverse ? ZSET_MAX : ZSET_MIN) ||
+            !_req_get_score(&max, &max_ex, req, reverse ? ZSET_MIN : ZSET_MAX) ||
+            !_range_opts(&withscores, &limit, &count, req)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_range_ex);
+
+        return;
+    }
+
+    it = item_get(key);
+    if (it == NULL) {
+        _rsp_range(rsp, reply, NULL, 0, 0, reverse, withscores);
+        INCR(process_metrics, zset_range_notfound);
+
+        return;
+    }
+
+    _score_range(&lo, &hi, (zset_p)item_data(it), min, min_ex, max, max_ex);
+    /* LIMIT skips and counts from where the range starts */
+    if (limit < 0 || limit >= hi - lo) {
+        lo = hi;
+    } else if (reverse) {
+        hi -= limit;
+        if (count >= 0 && count < hi - lo) {
+            lo = hi - count;
+        }
+    } else {
+        lo += limit;
+        if (count >= 0 && count < hi - lo) {
+            hi = lo + count;
+        }
+    }
+    if (withscores && !_score_reserve(hi - lo)) {
+        compose_rsp_server_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_range_ex);
+
+        return;
+    }
+
+    _rsp_range(rsp, reply, (zset_p)item_data(it), lo, hi, reverse, withscores);
+    log_verb("command '%.*s' '%.*s' succeeded, returning %"PRIu32" members",
+            cmd->bstr.len, cmd->bstr.data, key->len, key->data, hi - lo);
+}
+
+void
+cmd_zset_rangebyscore(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    _zset_rangebyscore(rsp, req, cmd, false);
+}
+
+void
+cmd_zset_revrangebyscore(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    _zset_rangebyscore(rsp, req, cmd, true);
+}
+
+void
+cmd_zset_count(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key;
+    struct item *it;
+    double min, max;
+    bool min_ex, max_ex;
+    uint32_t lo, hi;
+
+    ASSERT(array_nelem(req->token) > cmd->narg);
+
+    INCR(process_metrics, zset_count);
+
+    if (!req_get_bstr(&key, req, ZSET_KEY) ||
+            !_req_get_score(&min, &min_ex, req, ZSET_MIN) ||
+            !_req_get_score(&max, &max_ex, req, ZSET_MAX)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_count_ex);
+
+        return;
+    }
+
+    it = item_get(key);
+    if (it == NULL) {
+        compose_rsp_numeric(rsp, reply, cmd, key, 0);
+        INCR(process_metrics, zset_count_notfound);
+
+        return;
+    }
+
+    _score_range(&lo, &hi, (zset_p)item_data(it), min, min_ex, max, max_ex);
+    compose_rsp_numeric(rsp, reply, cmd, key, (int64_t)(hi - lo));
+}
+
+void
+cmd_zset_card(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key;
+    struct item *it;
+
+    ASSERT(array_nelem(req->token) > cmd->narg);
+
+    INCR(process_metrics, zset_count);
+
+    if (!req_get_bstr(&key, req, ZSET_KEY)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_count_ex);
+
+        return;
+    }
+
+    it = item_get(key);
+    if (it == NULL) {
+        compose_rsp_numeric(rsp, reply, cmd, key, 0);
+        INCR(process_metrics, zset_count_notfound);
+
+        return;
+    }
+
+    compose_rsp_numeric(rsp, reply, cmd, key,
+            (int64_t)zset_nentry((zset_p)item_data(it)));
+}
+
+void
+cmd_zset_score(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key, *member;
+    struct item *it;
+    double score;
+
+    ASSERT(array_nelem(req->token) > cmd->narg);
+
+    INCR(process_metrics, zset_find);
+
+    if (!req_get_bstr(&key, req, ZSET_KEY) ||
+            !req_get_bstr(&member, req, ZSET_MEMBER)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_find_ex);
+
+        return;
+    }
+    if (!_score_reserve(1)) {
+        compose_rsp_server_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_find_ex);
+
+        return;
+    }
+
+    it = item_get(key);
+    if (it == NULL ||
+            zset_score(&score, (zset_p)item_data(it), member) != ZSET_OK) {
+        compose_rsp_nil(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_find_notfound);
+
+        return;
+    }
+
+    _rsp_score(rsp, reply, cmd, key, score);
+    INCR(process_metrics, zset_find_ok);
+}
+
+static void
+_zset_rank(struct response *rsp, const struct request *req,
+        const struct command *cmd, bool reverse)
+{
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bstring *key = &null_key, *member;
+    struct item *it;
+    uint32_t rank;
+    zset_p zs;
+
+    ASSERT(array_nelem(req->token) > cmd->narg);
+
+    INCR(process_metrics, zset_find);
+
+    if (!req_get_bstr(&key, req, ZSET_KEY) ||
+            !req_get_bstr(&member, req, ZSET_MEMBER)) {
+        compose_rsp_client_err(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_find_ex);
+
+        return;
+    }
+
+    it = item_get(key);
+    zs = (it == NULL) ? NULL : (zset_p)item_data(it);
+    if (zs == NULL || zset_rank(&rank, zs, member) != ZSET_OK) {
+        compose_rsp_nil(rsp, reply, cmd, key);
+        INCR(process_metrics, zset_find_notfound);
+
+        return;
+    }
+
+    if (reverse) {
+        rank = zset_nentry(zs) - 1 - rank;
+    }
+    compose_rsp_numeric(rsp, reply, cmd, key, (int64_t)rank);
+    INCR(process_metrics, zset_find_ok);
+}
+
+void
+cmd_zset_rank(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    _zset_rank(rsp, req, cmd, false);
+}
+
+void
+cmd_zset_revrank(struct response *rsp, const struct request *req,
+        const struct command *cmd)
+{
+    _zset_rank(rsp, req, cmd, true);
+}
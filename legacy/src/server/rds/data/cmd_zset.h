@@ -0,0 +1,44 @@
+#pragma once
+
+/*          name                    type            description */
+#define PROCESS_ZSET_METRIC(ACTION)                                                  \
+    ACTION( zset_add,               METRIC_COUNTER, "# zset add requests"           )\
+    ACTION( zset_add_ok,            METRIC_COUNTER, "# zset members added"          )\
+    ACTION( zset_add_update,        METRIC_COUNTER, "# zset members updated"        )\
+    ACTION( zset_add_ex,            METRIC_COUNTER, "# zset add exceptions"         )\
+    ACTION( zset_incrby,            METRIC_COUNTER, "# zset incrby requests"        )\
+    ACTION( zset_incrby_ex,         METRIC_COUNTER, "# zset incrby exceptions"      )\
+    ACTION( zset_rem,               METRIC_COUNTER, "# zset rem requests"           )\
+    ACTION( zset_rem_ok,            METRIC_COUNTER, "# zset members removed"        )\
+    ACTION( zset_rem_notfound,      METRIC_COUNTER, "# zset rem miss"               )\
+    ACTION( zset_rem_ex,            METRIC_COUNTER, "# zset rem exceptions"         )\
+    ACTION( zset_range,             METRIC_COUNTER, "# zset range requests"         )\
+    ACTION( zset_range_notfound,    METRIC_COUNTER, "# zset range miss"             )\
+    ACTION( zset_range_ex,          METRIC_COUNTER, "# zset range exceptions"       )\
+    ACTION( zset_count,             METRIC_COUNTER, "# zset count/card requests"    )\
+    ACTION( zset_count_notfound,    METRIC_COUNTER, "# zset count/card miss"        )\
+    ACTION( zset_count_ex,          METRIC_COUNTER, "# zset count/card exceptions"  )\
+    ACTION( zset_find,              METRIC_COUNTER, "# zset score/rank requests"    )\
+    ACTION( zset_find_ok,           METRIC_COUNTER, "# zset score/rank success"     )\
+    ACTION( zset_find_notfound,     METRIC_COUNTER, "# zset score/rank miss"        )\
+    ACTION( zset_find_ex,           METRIC_COUNTER, "# zset score/rank exceptions"  )
+
+struct request;
+struct response;
+struct command;
+
+/* cmd_* functions must be command_fn (process.c) compatible */
+void cmd_zset_add(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_incrby(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_rem(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_remrangebyrank(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_remrangebyscore(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_range(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_revrange(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_rangebyscore(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_revrangebyscore(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_count(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_card(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_score(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_rank(struct response *rsp, const struct request *req, const struct command *cmd);
+void cmd_zset_revrank(struct response *rsp, const struct request *req, const struct command *cmd);
@@ -64,6 +64,21 @@ process_setup(process_options_st *options, process_metrics_st *metrics)
     command_registry[REQ_SMAP_INSERT] = cmd_smap_insert;
     command_registry[REQ_SMAP_REMOVE] = cmd_smap_remove;
 
+    command_registry[REQ_ZADD] = cmd_zset_add;
+    command_registry[REQ_ZINCRBY] = cmd_zset_incrby;
+    command_registry[REQ_ZREM] = cmd_zset_rem;
+    command_registry[REQ_ZREMRANGEBYRANK] = cmd_zset_remrangebyrank;
+    command_registry[REQ_ZREMRANGEBYSCORE] = cmd_zset_remrangebyscore;
+    command_registry[REQ_ZRANGE] = cmd_zset_range;
+    command_registry[REQ_ZREVRANGE] = cmd_zset_revrange;
+    command_registry[REQ_ZRANGEBYSCORE] = cmd_zset_rangebyscore;
+    command_registry[REQ_ZREVRANGEBYSCORE] = cmd_zset_revrangebyscore;
+    command_registry[REQ_ZCOUNT] = cmd_zset_count;
+    command_registry[REQ_ZCARD] = cmd_zset_card;
+    command_registry[REQ_ZSCORE] = cmd_zset_score;
+    command_registry[REQ_ZRANK] = cmd_zset_rank;
+    command_registry[REQ_ZREVRANK] = cmd_zset_revrank;
+
     command_registry[REQ_PING] = cmd_ping;
 
     process_init = true;
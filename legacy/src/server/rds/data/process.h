@@ -4,6 +4,7 @@
 #include "cmd_list.h"
 #include "cmd_sarray.h"
 #include "cmd_smap.h"
+#include "cmd_zset.h"
 
 #include <buffer/cc_buf.h>
 #include <cc_metric.h>
@@ -31,6 +32,7 @@ typedef struct {
     PROCESS_LIST_METRIC(METRIC_DECLARE)
     PROCESS_SARRAY_METRIC(METRIC_DECLARE)
     PROCESS_SMAP_METRIC(METRIC_DECLARE)
+    PROCESS_ZSET_METRIC(METRIC_DECLARE)
     PROCESS_MISC_METRIC(METRIC_DECLARE)
 } process_metrics_st;
 
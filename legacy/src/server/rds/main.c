@@ -202,6 +202,12 @@ main(int argc, char **argv)
         exit(EX_DATAERR);
     }
 
+    /* slab storage is not thread-safe, so there is only one worker thread */
+    if (option_uint(&setting.worker.worker_nthread) > 1) {
+        log_stderr("rds runs one worker thread, ignoring worker_nthread");
+        setting.worker.worker_nthread.val.vuint = 1;
+    }
+
     setup();
     option_print_all((struct option *)&setting, nopt);
 
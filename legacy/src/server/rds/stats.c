@@ -5,6 +5,8 @@ struct stats stats = {
     { PROCESS_METRIC(METRIC_INIT)
       PROCESS_LIST_METRIC(METRIC_INIT)
       PROCESS_SARRAY_METRIC(METRIC_INIT)
+      PROCESS_SMAP_METRIC(METRIC_INIT)
+      PROCESS_ZSET_METRIC(METRIC_INIT)
       PROCESS_MISC_METRIC(METRIC_INIT)  },
     { PARSE_REQ_METRIC(METRIC_INIT)     },
     { COMPOSE_RSP_METRIC(METRIC_INIT)   },
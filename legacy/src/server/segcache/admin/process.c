@@ -1,6 +1,10 @@
 #include "process.h"
 
+#include "core/core.h"
+#include "hotkey/hotkey.h"
 #include "protocol/admin/admin_include.h"
+#include "util/latency.h"
+#include "util/slowlog.h"
 #include "util/procinfo.h"
 
 #include <cc_mm.h>
@@ -15,11 +19,14 @@
 
 #define PERTTL_PREFIX_FMT "TTL_BUCKET (ttl %u):"
 #define PERTTL_METRIC_FMT " %s %s"
+#define PERWORKER_PREFIX_FMT "WORKER %u:"
 
 extern struct stats stats;
 extern unsigned int nmetric;
 extern seg_perttl_metrics_st perttl[MAX_N_TTL_BUCKET];
 static unsigned int nmetric_perttl = METRIC_CARDINALITY(seg_perttl_metrics_st);
+static unsigned int nmetric_perworker =
+    METRIC_CARDINALITY(perworker_metrics_st);
 extern struct ttl_bucket ttl_buckets[MAX_N_TTL_BUCKET];
 
 
@@ -37,8 +44,11 @@ admin_process_setup(void)
     }
 
     nmetric_perttl = METRIC_CARDINALITY(perttl[0]);
-    cap = MAX(nmetric, nmetric_perttl * MAX_N_TTL_BUCKET) * METRIC_PRINT_LEN +
-            METRIC_END_LEN;
+    /* called after the worker setup, which decides nworker */
+    cap = MAX(MAX(MAX(nmetric, nmetric_perttl * MAX_N_TTL_BUCKET),
+            (nmetric_perworker + 1) * nworker) * METRIC_PRINT_LEN,
+            MAX(MAX(latency_print_cap(), hotkey_print_cap()),
+            slowlog_print_cap())) + METRIC_END_LEN;
     buf = cc_alloc(cap);
     if (buf == NULL) {
         log_crit("cannot allocate buffer for admin stat string");
@@ -89,6 +99,68 @@ _admin_stats_ttl(struct response *rsp, struct request *req)
     rsp->data.len = offset;
 }
 
+static void
+_admin_stats_worker(struct response *rsp, struct request *req)
+{
+    uint32_t idx;
+    size_t offset = 0;
+
+    for (idx = 0; idx < nworker; idx++) {
+        struct metric *metrics = (struct metric *)&perworker[idx];
+        offset += cc_scnprintf(buf + offset, cap - offset,
+                PERWORKER_PREFIX_FMT, idx);
+        for (int i = 0; i < nmetric_perworker; i++) {
+            offset += metric_print(buf + offset, cap - offset,
+                   PERTTL_METRIC_FMT, &metrics[i]);
+        }
+        offset += cc_scnprintf(buf + offset, cap - offset, CRLF);
+    }
+    offset += cc_scnprintf(buf + offset, cap - offset, METRIC_END);
+
+    rsp->type = RSP_GENERIC;
+    rsp->data.data = buf;
+    rsp->data.len = offset;
+}
+
+static void
+_admin_stats_latency(struct response *rsp, struct request *req)
+{
+    size_t offset;
+
+    offset = latency_print(buf, cap);
+    offset += cc_scnprintf(buf + offset, cap - offset, METRIC_END);
+
+    rsp->type = RSP_GENERIC;
+    rsp->data.data = buf;
+    rsp->data.len = offset;
+}
+
+static void
+_admin_stats_hotkey(struct response *rsp, struct request *req)
+{
+    size_t offset;
+
+    offset = hotkey_print(buf, cap);
+    offset += cc_scnprintf(buf + offset, cap - offset, METRIC_END);
+
+    rsp->type = RSP_GENERIC;
+    rsp->data.data = buf;
+    rsp->data.len = offset;
+}
+
+static void
+_admin_stats_slowlog(struct response *rsp, struct request *req)
+{
+    size_t offset;
+
+    offset = slowlog_print(buf, cap);
+    offset += cc_scnprintf(buf + offset, cap - offset, METRIC_END);
+
+    rsp->type = RSP_GENERIC;
+    rsp->data.data = buf;
+    rsp->data.len = offset;
+}
+
 static void
 _admin_stats_default(struct response *rsp, struct request *req)
 {
@@ -106,6 +178,18 @@ _admin_stats(struct response *rsp, struct request *req)
     }
     if (req->arg.len == 4 && str4cmp(req->arg.data, ' ', 's', 'e', 'g')) {
         _admin_stats_ttl(rsp, req);
+    } else if (req->arg.len == 7 && str7cmp(req->arg.data, ' ', 'w', 'o',
+                'r', 'k', 'e', 'r')) {
+        _admin_stats_worker(rsp, req);
+    } else if (req->arg.len == 8 && str8cmp(req->arg.data, ' ', 'l', 'a',
+                't', 'e', 'n', 'c', 'y')) {
+        _admin_stats_latency(rsp, req);
+    } else if (req->arg.len == 7 && str7cmp(req->arg.data, ' ', 'h', 'o',
+                't', 'k', 'e', 'y')) {
+        _admin_stats_hotkey(rsp, req);
+    } else if (req->arg.len == 8 && str8cmp(req->arg.data, ' ', 's', 'l', 'o',
+                'w', 'l', 'o', 'g')) {
+        _admin_stats_slowlog(rsp, req);
     } else {
         rsp->type = RSP_INVALID;
     }
@@ -3,6 +3,8 @@
 #include "hotkey/hotkey.h"
 #include "protocol/data/memcache_include.h"
 #include "storage/seg/seg.h"
+#include "util/latency.h"
+#include "util/slowlog.h"
 
 #include <cc_array.h>
 #include <cc_debug.h>
@@ -17,6 +19,9 @@
 #define CMD_ERR_MSG "command not supported"
 #define OTHER_ERR_MSG "unknown server error"
 
+/* keys looked up together, so their hash buckets and items are prefetched */
+#define GET_BATCH 16
+
 typedef enum put_rstatus {
     PUT_OK,
     PUT_PARTIAL,
@@ -32,6 +37,7 @@ static char                 prefill_kbuf[UINT8_MAX];
 static uint32_t             prefill_vsize;
 static char                 prefill_vbuf[ITEM_SIZE_MAX];
 static uint64_t             prefill_nkey;
+static uint32_t             value_ref_min = VALUE_REF_MIN;
 
 static void
 _prefill_seg(void)
@@ -83,6 +89,7 @@ process_setup(process_options_st *options, process_metrics_st *metrics)
         prefill_ksize = (uint32_t)option_uint(&options->prefill_ksize);
         prefill_vsize = (uint32_t)option_uint(&options->prefill_vsize);
         prefill_nkey = (uint64_t)option_uint(&options->prefill_nkey);
+        value_ref_min = (uint32_t)option_uint(&options->value_ref_min);
     }
 
     if (prefill) {
@@ -101,6 +108,7 @@ process_teardown(void)
     }
 
     allow_flush = false;
+    value_ref_min = VALUE_REF_MIN;
     process_metrics = NULL;
     process_init = false;
 }
@@ -125,12 +133,9 @@ _set_dataflag(struct item *it, uint32_t flag)
 }
 
 static bool
-_get_key(struct response *rsp, struct bstring *key, bool cas)
+_get_key(struct response *rsp, struct bstring *key, struct item *it,
+        uint64_t cas_v, bool cas)
 {
-    struct item *it;
-    uint64_t cas_v;
-
-    it = item_get(key, &cas_v);
     if (it != NULL) {
         rsp->type = RSP_VALUE;
         rsp->key = *key;
@@ -152,30 +157,49 @@ _get_key(struct response *rsp, struct bstring *key, bool cas)
     }
 }
 
+/* release the items of a batch that no response was left for */
+static void
+_release_items(struct item **its, uint32_t n)
+{
+    for (; n > 0; its++, n--) {
+        if (*its != NULL) {
+            item_release(*its);
+        }
+    }
+}
+
 static void
 _process_get(struct response *rsp, struct request *req)
 {
     struct bstring *key;
     struct response *r = rsp;
-    uint32_t i;
+    struct item *its[GET_BATCH];
+    uint64_t cas_v[GET_BATCH];
+    uint32_t i, j, n, nkey = array_nelem(req->keys);
 
     INCR(process_metrics, get);
-    /* use chained responses, move to the next response if key is found. */
-    for (i = 0; i < array_nelem(req->keys); ++i) {
-        INCR(process_metrics, get_key);
-        key = array_get(req->keys, i);
-        if (_get_key(r, key, false)) {
-            req->nfound++;
-            r->cas = false;
-            r = STAILQ_NEXT(r, next);
-            if (r == NULL) {
-                INCR(process_metrics, get_ex);
-                log_warn("get response incomplete due to lack of rsp objects");
-                return;
+    /* keys are looked up in batches, and use chained responses, move to the
+     * next response if key is found. */
+    for (i = 0; i < nkey; i += n) {
+        n = MIN(nkey - i, GET_BATCH);
+        item_get_multi(its, cas_v, array_get(req->keys, i), n);
+        for (j = 0; j < n; ++j) {
+            INCR(process_metrics, get_key);
+            key = array_get(req->keys, i + j);
+            if (_get_key(r, key, its[j], cas_v[j], false)) {
+                req->nfound++;
+                r->cas = false;
+                r = STAILQ_NEXT(r, next);
+                if (r == NULL) {
+                    INCR(process_metrics, get_ex);
+                    log_warn("get response incomplete due to lack of rsp objects");
+                    _release_items(its + j + 1, n - j - 1);
+                    return;
+                }
+                INCR(process_metrics, get_key_hit);
+            } else {
+                INCR(process_metrics, get_key_miss);
             }
-            INCR(process_metrics, get_key_hit);
-        } else {
-            INCR(process_metrics, get_key_miss);
         }
     }
     r->type = RSP_END;
@@ -189,24 +213,33 @@ _process_gets(struct response *rsp, struct request *req)
 {
     struct bstring *key;
     struct response *r = rsp;
-    uint32_t i;
+    struct item *its[GET_BATCH];
+    uint64_t cas_v[GET_BATCH];
+    uint32_t i, j, n, nkey = array_nelem(req->keys);
 
     INCR(process_metrics, gets);
-    /* use chained responses, move to the next response if key is found. */
-    for (i = 0; i < array_nelem(req->keys); ++i) {
-        INCR(process_metrics, gets_key);
-        key = array_get(req->keys, i);
-        if (_get_key(r, key, true)) {
-            r->cas = true;
-            r = STAILQ_NEXT(r, next);
-            if (r == NULL) {
-                INCR(process_metrics, gets_ex);
-                log_warn("gets response incomplete due to lack of rsp objects");
+    /* keys are looked up in batches, and use chained responses, move to the
+     * next response if key is found. */
+    for (i = 0; i < nkey; i += n) {
+        n = MIN(nkey - i, GET_BATCH);
+        item_get_multi(its, cas_v, array_get(req->keys, i), n);
+        for (j = 0; j < n; ++j) {
+            INCR(process_metrics, gets_key);
+            key = array_get(req->keys, i + j);
+            if (_get_key(r, key, its[j], cas_v[j], true)) {
+                r->cas = true;
+                r = STAILQ_NEXT(r, next);
+                req->nfound++;
+                if (r == NULL) {
+                    INCR(process_metrics, gets_ex);
+                    log_warn("gets response incomplete due to lack of rsp objects");
+                    _release_items(its + j + 1, n - j - 1);
+                    return;
+                }
+                INCR(process_metrics, gets_key_hit);
+            } else {
+                INCR(process_metrics, gets_key_miss);
             }
-            req->nfound++;
-            INCR(process_metrics, gets_key_hit);
-        } else {
-            INCR(process_metrics, gets_key_miss);
         }
     }
     r->type = RSP_END;
@@ -650,6 +683,34 @@ process_request(struct response *rsp, struct request *req)
     }
 }
 
+/* an item a response refers to once its value is written out or copied */
+static void
+_release_ref(void *it)
+{
+    item_release((struct item *)it);
+}
+
+/*
+ * a value at least value_ref_min long is left in the seg it is stored in, and
+ * the write buffer refers to it, keeping the seg from being evicted. To never
+ * wait on our own references, such as when a later request in rbuf needs to
+ * evict, they are only kept across gets, and until the write that follows.
+ */
+static inline int
+_compose_value(struct buf **wbuf, struct response *rsp)
+{
+    struct item *it = rsp->item;
+
+    if (value_ref_min == 0 || it == NULL || rsp->type != RSP_VALUE ||
+            rsp->num || rsp->vstr.len < value_ref_min) {
+        return compose_rsp(wbuf, rsp);
+    }
+
+    rsp->item = NULL; /* released along with the buffer referring to it */
+
+    return compose_rsp_ref(wbuf, rsp, _release_ref, it);
+}
+
 static inline void
 _cleanup(struct request *req, struct response *rsp, int card)
 {
@@ -674,12 +735,45 @@ _cleanup(struct request *req, struct response *rsp, int card)
     req->rsp = rsp;
 }
 
+/* the time since *t, which is moved to now */
+static inline uint64_t
+_lap(uint64_t *t)
+{
+    uint64_t now = slowlog_now();
+    uint64_t ns = now - *t;
+
+    *t = now;
+
+    return ns;
+}
+
+static void
+_slowlog_request(struct slowlog_request *slow, struct request *req,
+        struct response *rsp, uint64_t total)
+{
+    struct response *nr = rsp;
+    uint32_t i;
+
+    slow->cmd = req->type;
+    slow->nkey = array_nelem(req->keys);
+    slow->key = slow->nkey > 0 ? array_first(req->keys) : NULL;
+    slow->vlen = req->vlen;
+    for (i = 0; i < req->nfound && nr != NULL; ++i, nr = STAILQ_NEXT(nr, next)) {
+        if (nr->type == RSP_VALUE) {
+            slow->vlen += nr->vstr.len;
+        }
+    }
+
+    slowlog_record(slow, total);
+}
+
 int
 segcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
 {
     parse_rstatus_e status;
     struct request *req; /* data should be NULL or hold a req pointer */
     struct response *rsp;
+    uint64_t start = (latency_enabled || slowlog_enabled) ? latency_now() : 0;
 
     log_verb("post-read processing");
 
@@ -708,11 +802,17 @@ segcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
     /* keep parse-process-compose until running out of data in rbuf */
     while (buf_rsize(*rbuf) > 0) {
         struct response *nr;
+        struct slowlog_request slow;
+        uint64_t t = 0, evict = 0;
         int i, card;
 
         /* stage 1: parsing */
         log_verb("%" PRIu32 " bytes left", buf_rsize(*rbuf));
 
+        if (slowlog_enabled) {
+            t = start;
+            slow.ns[SLOWLOG_WAIT] = _lap(&t);
+        }
         status = parse_req(req, *rbuf);
         if (status == PARSE_EUNFIN) {
             buf_lshift(*rbuf);
@@ -731,9 +831,20 @@ segcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
         if (req->swallow) { /* skip to the end of current request */
             continue;
         }
+        if (slowlog_enabled) {
+            slow.ns[SLOWLOG_PARSE] = _lap(&t);
+        }
 
         /* stage 2: processing- check for quit, allocate response(s), process */
 
+        /* nothing but a get keeps the values of earlier ones referred to */
+        if (req->type != REQ_GET && req->type != REQ_GETS &&
+                (*wbuf)->chain != NULL && buf_chain_unref(*wbuf) != CC_OK) {
+            log_error("cannot copy referred values: OOM");
+            INCR(process_metrics, process_ex);
+            return -1;
+        }
+
         /* quit is special, no response expected */
         if (req->type == REQ_QUIT) {
             log_info("peer called quit");
@@ -758,6 +869,9 @@ segcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
         }
 
         /* actual processing */
+        if (slowlog_enabled) {
+            evict = seg_evict_ns;
+        }
         process_request(rsp, req);
         if (req->partial) { /* implies end of rbuf w/o complete processing */
             /* in this case, do not attempt to log or write response */
@@ -765,18 +879,31 @@ segcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
             return 0;
         }
 
+        if (slowlog_enabled) {
+            slow.ns[SLOWLOG_PROCESS] = _lap(&t);
+            slow.ns[SLOWLOG_EVICT] = seg_evict_ns - evict;
+        }
+
         /* stage 3: write response(s) if necessary */
 
         /* noreply means no need to write to buffers */
         card++;
-        if (!req->noreply) {
+        if (req->binary) {
+            /* a binary request has one response, which may be left out */
+            if (compose_bin_rsp(wbuf, req, rsp) < 0) {
+                log_error("composing rsp erred");
+                INCR(process_metrics, process_ex);
+                _cleanup(req, rsp, card);
+                return -1;
+            }
+        } else if (!req->noreply) {
             nr = rsp;
             if (req->type == REQ_GET || req->type == REQ_GETS) {
                 /* for get/gets, card is determined by number of values */
                 card = req->nfound + 1;
             }
             for (i = 0; i < card; nr = STAILQ_NEXT(nr, next), ++i) {
-                if (compose_rsp(wbuf, nr) < 0) {
+                if (_compose_value(wbuf, nr) < 0) {
                     log_error("composing rsp erred");
                     INCR(process_metrics, process_ex);
                     _cleanup(req, rsp, card);
@@ -784,6 +911,17 @@ segcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
                 }
             }
         }
+        /* latency includes the wait behind earlier requests in rbuf */
+        if (latency_enabled) {
+            latency_record(req->type, latency_now() - start);
+        }
+        if (slowlog_enabled) {
+            slow.ns[SLOWLOG_COMPOSE] = _lap(&t);
+            if (slowlog_slow(t - start)) {
+                _slowlog_request(&slow, req, rsp, t - start);
+            }
+        }
+
         /* logging, clean-up */
         klog_write(req, rsp);
         _cleanup(req, rsp, card);
@@ -797,6 +935,13 @@ segcache_process_write(struct buf **rbuf, struct buf **wbuf, void **data)
 {
     log_verb("post-write processing");
 
+    /* values not written out yet are copied, see _compose_value */
+    if ((*wbuf)->chain != NULL && buf_chain_unref(*wbuf) != CC_OK) {
+        log_error("cannot copy referred values: OOM");
+        INCR(process_metrics, process_ex);
+        return -1;
+    }
+
     buf_lshift(*rbuf);
     dbuf_shrink(rbuf);
     buf_lshift(*wbuf);
@@ -51,8 +51,11 @@ static void
 teardown(void)
 {
     core_worker_teardown();
+    latency_teardown();
+    metric_shard_teardown();
     core_server_teardown();
     core_admin_teardown();
+    slowlog_teardown(); /* flushed by the admin thread */
     admin_process_teardown();
     process_teardown();
     seg_teardown();
@@ -121,14 +124,25 @@ setup(void)
     response_setup(&setting.response, &stats.response);
     parse_setup(&stats.parse_req, NULL);
     compose_setup(NULL, &stats.compose_rsp);
-    klog_setup(&setting.klog, &stats.klog);
-    hotkey_setup(&setting.hotkey);
+    klog_setup(&setting.klog, &stats.klog,
+            option_uint(&setting.worker.worker_nthread));
+    hotkey_setup(&setting.hotkey,
+            option_uint(&setting.worker.worker_nthread));
     seg_setup(&setting.seg, &stats.seg);
     process_setup(&setting.process, &stats.process);
-    admin_process_setup();
     core_admin_setup(&setting.admin);
     core_server_setup(&setting.server, &stats.server);
     core_worker_setup(&setting.worker, &stats.worker);
+    latency_setup(&setting.latency, nworker, req_strings, REQ_SENTINEL);
+    slowlog_setup(&setting.slowlog, nworker, req_strings, REQ_SENTINEL);
+    admin_process_setup();
+
+    /* each worker thread updates its own shard of the metrics */
+    if (metric_shard_setup((struct metric *)&stats, nmetric, nworker) !=
+            CC_OK) {
+        log_stderr("failed to set up metric shards");
+        goto error;
+    }
 
     /* adding recurring events to maintenance/admin thread */
     intvl = option_uint(&setting.segcache.dlog_intvl);
@@ -143,6 +157,12 @@ setup(void)
         goto error;
     }
 
+    intvl = option_uint(&setting.segcache.slowlog_intvl);
+    if (core_admin_register(intvl, slowlog_flush, NULL) == NULL) {
+        log_error("Could not register timed event to flush slow log");
+        goto error;
+    }
+
     intvl = option_uint(&setting.segcache.stats_intvl);
     if (core_admin_register(intvl, stats_dump, NULL) == NULL) {
         log_error("Could not register timed event to dump stats");
@@ -165,6 +185,7 @@ main(int argc, char **argv)
 {
     rstatus_i status = CC_OK;;
     FILE *fp = NULL;
+    uint32_t n;
 
     if (argc > 2) {
         show_usage();
@@ -216,6 +237,12 @@ main(int argc, char **argv)
         exit(EX_DATAERR);
     }
 
+    /* every worker thread may hold a seg being written to */
+    n = option_uint(&setting.worker.worker_nthread);
+    if (option_uint(&setting.seg.seg_n_thread) < n) {
+        setting.seg.seg_n_thread.val.vuint = n;
+    }
+
     setup();
     option_print_all((struct option *)&setting, nopt);
 
@@ -8,6 +8,8 @@ struct setting setting = {
     { PROCESS_OPTION(OPTION_INIT)   },
     { KLOG_OPTION(OPTION_INIT)      },
     { HOTKEY_OPTION(OPTION_INIT)    },
+    { LATENCY_OPTION(OPTION_INIT)   },
+    { SLOWLOG_OPTION(OPTION_INIT)   },
     { REQUEST_OPTION(OPTION_INIT)   },
     { RESPONSE_OPTION(OPTION_INIT)  },
     { SEG_OPTION(OPTION_INIT)      },
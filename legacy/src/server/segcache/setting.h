@@ -8,6 +8,8 @@
 #include "storage/seg/item.h"
 #include "storage/seg/seg.h"
 #include "time/time.h"
+#include "util/latency.h"
+#include "util/slowlog.h"
 
 #include <buffer/cc_buf.h>
 #include <buffer/cc_dbuf.h>
@@ -25,6 +27,7 @@
     ACTION( pid_filename,   OPTION_TYPE_STR,    NULL,   "file storing the pid"         )\
     ACTION( dlog_intvl,     OPTION_TYPE_UINT,   500,    "debug log flush interval(ms)" )\
     ACTION( klog_intvl,     OPTION_TYPE_UINT,   100,    "cmd log flush interval(ms)"   )\
+    ACTION( slowlog_intvl,  OPTION_TYPE_UINT,   1000,   "slow log flush interval(ms)"  )\
     ACTION( stats_intvl,    OPTION_TYPE_UINT,   100,    "stats dump interval(ms)"      )
 
 typedef struct {
@@ -41,6 +44,8 @@ struct setting {
     process_options_st      process;
     klog_options_st         klog;
     hotkey_options_st       hotkey;
+    latency_options_st      latency;
+    slowlog_options_st      slowlog;
     request_options_st      request;
     response_options_st     response;
     seg_options_st          seg;
@@ -1,9 +1,11 @@
 #include "process.h"
 
+#include "hotkey/hotkey.h"
 #include "protocol/admin/admin_include.h"
 #include "util/procinfo.h"
 
 #include <cc_mm.h>
+#include <cc_print.h>
 #include <cc_stats_log.h>
 
 #define SLIMCACHE_ADMIN_MODULE_NAME "slimcache::admin"
@@ -24,7 +26,7 @@ admin_process_setup(void)
                  SLIMCACHE_ADMIN_MODULE_NAME);
     }
 
-    cap = METRIC_PRINT_LEN * nmetric + METRIC_END_LEN;
+    cap = MAX(METRIC_PRINT_LEN * nmetric, hotkey_print_cap()) + METRIC_END_LEN;
     buf = cc_alloc(cap);
     /* TODO: check return status of cc_alloc */
 
@@ -43,13 +45,41 @@ admin_process_teardown(void)
 }
 
 static void
-_admin_stats(struct response *rsp, struct request *req)
+_admin_stats_hotkey(struct response *rsp, struct request *req)
+{
+    size_t offset;
+
+    offset = hotkey_print(buf, cap);
+    offset += cc_scnprintf(buf + offset, cap - offset, METRIC_END);
+
+    rsp->type = RSP_GENERIC;
+    rsp->data.data = buf;
+    rsp->data.len = offset;
+}
+
+static void
+_admin_stats_default(struct response *rsp, struct request *req)
 {
     procinfo_update();
     rsp->data.data = buf;
     rsp->data.len = print_stats(buf, cap, (struct metric *)&stats, nmetric);
 }
 
+static void
+_admin_stats(struct response *rsp, struct request *req)
+{
+    if (bstring_empty(&req->arg)) {
+        _admin_stats_default(rsp, req);
+        return;
+    }
+    if (req->arg.len == 7 && str7cmp(req->arg.data, ' ', 'h', 'o', 't', 'k',
+                'e', 'y')) {
+        _admin_stats_hotkey(rsp, req);
+    } else {
+        rsp->type = RSP_INVALID;
+    }
+}
+
 void
 admin_process_request(struct response *rsp, struct request *req)
 {
@@ -6,6 +6,7 @@
 
 #include <cc_array.h>
 #include <cc_debug.h>
+#include <cc_mm.h>
 #include <cc_print.h>
 
 #define SLIMCACHE_PROCESS_MODULE_NAME "slimcache::process"
@@ -18,6 +19,10 @@ static bool process_init = false;
 static process_metrics_st *process_metrics = NULL;
 static bool allow_flush = ALLOW_FLUSH;
 
+/* copies of the items found by a get, if the table is shared by threads */
+static __thread char *copy = NULL;
+static __thread size_t copy_size = 0;
+
 void
 process_setup(process_options_st *options, process_metrics_st *metrics)
 {
@@ -50,13 +55,34 @@ process_teardown(void)
 }
 
 
+/* room for copies of nkey items, which last until the next get */
 static bool
-_get_key(struct response *rsp, struct bstring *key)
+_copy_reserve(uint32_t nkey)
+{
+    size_t size = cuckoo_read_size() * nkey;
+    char *p;
+
+    if (size > copy_size) {
+        p = cc_realloc(copy, size);
+        if (p == NULL) {
+            log_error("cannot allocate copies of %"PRIu32" items", nkey);
+            return false;
+        }
+        copy = p;
+        copy_size = size;
+    }
+
+    return true;
+}
+
+static bool
+_get_key(struct response *rsp, struct bstring *key, uint32_t idx)
 {
     struct item *it;
     struct val val;
 
-    it = cuckoo_get(key);
+    it = cuckoo_read(key, copy == NULL ? NULL :
+            copy + (size_t)idx * cuckoo_read_size());
     if (it != NULL) {
         rsp->type = RSP_VALUE;
         rsp->key = *key;
@@ -90,11 +116,16 @@ _process_get(struct response *rsp, struct request *req)
     uint32_t i;
 
     INCR(process_metrics, get);
+    if (!_copy_reserve(array_nelem(req->keys))) {
+        INCR(process_metrics, get_ex);
+        rsp->type = RSP_END;
+        return;
+    }
     /* use chained responses, move to the next response if key is found. */
     for (i = 0; i < array_nelem(req->keys); ++i) {
         INCR(process_metrics, get_key);
         key = array_get(req->keys, i);
-        if (_get_key(r, key)) {
+        if (_get_key(r, key, req->nfound)) {
             r->cas = false;
             r = STAILQ_NEXT(r, next);
             if (r == NULL) {
@@ -121,11 +152,16 @@ _process_gets(struct response *rsp, struct request *req)
     uint32_t i;
 
     INCR(process_metrics, gets);
+    if (!_copy_reserve(array_nelem(req->keys))) {
+        INCR(process_metrics, gets_ex);
+        rsp->type = RSP_END;
+        return;
+    }
     /* use chained responses, move to the next response if key is found. */
     for (i = 0; i < array_nelem(req->keys); ++i) {
         INCR(process_metrics, gets_key);
         key = array_get(req->keys, i);
-        if (_get_key(r, key)) {
+        if (_get_key(r, key, req->nfound)) {
             r->cas = true;
             r = STAILQ_NEXT(r, next);
             if (r == NULL) {
@@ -392,12 +428,37 @@ _process_flush(struct response *rsp, struct request *req)
     }
 }
 
+/* whether the command changes its key, which it then holds until done */
+static inline bool
+_locks_key(struct request *req)
+{
+    switch (req->type) {
+    case REQ_DELETE:
+    case REQ_SET:
+    case REQ_ADD:
+    case REQ_REPLACE:
+    case REQ_CAS:
+    case REQ_INCR:
+    case REQ_DECR:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
 void
 process_request(struct response *rsp, struct request *req)
 {
+    bool locked = _locks_key(req);
+
     log_verb("processing req %p, write rsp to %p", req, rsp);
     INCR(process_metrics, process_req);
 
+    if (locked) {
+        cuckoo_lock(array_first(req->keys));
+    }
+
     switch (req->type) {
     case REQ_GET:
         _process_get(rsp, req);
@@ -444,6 +505,10 @@ process_request(struct response *rsp, struct request *req)
         rsp->vstr = str2bstr(OTHER_ERR_MSG);
         break;
     }
+
+    if (locked) {
+        cuckoo_unlock();
+    }
 }
 
 static inline void
@@ -539,7 +604,14 @@ slimcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
         /* stage 3: write response(s) */
 
         /* noreply means no need to write to buffers */
-        if (!req->noreply) {
+        if (req->binary) {
+            /* a binary request has one response, which may be left out */
+            if (compose_bin_rsp(wbuf, req, rsp) < 0) {
+                log_error("composing rsp erred");
+                INCR(process_metrics, process_ex);
+                goto error;
+            }
+        } else if (!req->noreply) {
             nr = rsp;
             if (req->type == REQ_GET || req->type == REQ_GETS) {
                 /* for get/gets, card is determined by number of values */
@@ -125,8 +125,10 @@ setup(void)
     response_setup(&setting.response, &stats.response);
     parse_setup(&stats.parse_req, NULL);
     compose_setup(NULL, &stats.compose_rsp);
-    klog_setup(&setting.klog, &stats.klog);
-    hotkey_setup(&setting.hotkey);
+    klog_setup(&setting.klog, &stats.klog,
+            option_uint(&setting.worker.worker_nthread));
+    hotkey_setup(&setting.hotkey,
+            option_uint(&setting.worker.worker_nthread));
     cuckoo_setup(&setting.cuckoo, &stats.cuckoo);
     process_setup(&setting.process, &stats.process);
     admin_process_setup();
@@ -219,6 +221,11 @@ main(int argc, char **argv)
         exit(EX_DATAERR);
     }
 
+    /* worker threads share the cuckoo table, which then locks by key */
+    if (option_uint(&setting.worker.worker_nthread) > 1) {
+        setting.cuckoo.cuckoo_concurrent.val.vbool = true;
+    }
+
     setup();
     option_print_all((struct option *)&setting, nopt);
 
@@ -10,7 +10,7 @@
 #include <cc_debug.h>
 
 
-#define it2bitset(_it) ((struct bitset *)ITEM_VAL_POS(it))
+#define it2bitset(_it) ((struct bitset *)ITEM_VAL_POS(_it))
 
 static inline struct bstring *
 _get_key(struct request *req)
@@ -21,12 +21,12 @@ _get_key(struct request *req)
 }
 
 static inline int32_t
-_get_col(struct response *rsp, struct request *req, uint16_t max)
+_get_col(struct response *rsp, struct request *req, uint32_t idx, uint16_t max)
 {
     uint64_t col = 0;
     rstatus_i status;
     struct element *reply = (struct element *)array_first(rsp->token);
-    struct element *arg = (struct element *)array_get(req->token, BITMAP_COL);
+    struct element *arg = (struct element *)array_get(req->token, idx);
 
     status = bstring_atou64(&col, &arg->bstr);
     if (status != CC_OK || col > max) {
@@ -42,12 +42,12 @@ _get_col(struct response *rsp, struct request *req, uint16_t max)
 }
 
 static inline int16_t
-_get_bitval(struct response *rsp, struct request *req, uint8_t max)
+_get_bitval(struct response *rsp, struct request *req, uint32_t idx, uint8_t max)
 {
     uint64_t val = 0;
     rstatus_i status;
     struct element *reply = (struct element *)array_first(rsp->token);
-    struct element *arg = (struct element *)array_get(req->token, BITMAP_VAL);
+    struct element *arg = (struct element *)array_get(req->token, idx);
 
     status = bstring_atou64(&val, &arg->bstr);
     if (status != CC_OK || val > max) {
@@ -63,7 +63,7 @@ _get_bitval(struct response *rsp, struct request *req, uint8_t max)
 }
 
 static inline struct item *
-_add_key(struct response *rsp, struct bstring *key)
+_add_key(struct response *rsp, struct bstring *key, struct val *val)
 {
     struct element *reply = (struct element *)array_first(rsp->token);
     struct item *it;
@@ -78,7 +78,7 @@ _add_key(struct response *rsp, struct bstring *key)
     } else { /* cuckoo insert current won't fail as long as size is valid */
         /* Set expire to be a large number, since redis protocol sets expiry
            in a separate command. */
-        it = cuckoo_insert(key, NULL, INT32_MAX);
+        it = cuckoo_insert(key, val, INT32_MAX);
         if (it == NULL) {
             rsp->type = reply->type = ELEM_ERR;
             reply->bstr = str2bstr(RSP_ERR_STORAGE);
@@ -99,11 +99,13 @@ cmd_bitmap_create(struct response *rsp, struct request *req, struct command *cmd
     int32_t ncol;
     struct bstring *key = _get_key(req);
     struct element *reply = (struct element *)array_push(rsp->token);
+    uint32_t bs[bit2long(BITSET_COL_MAX) + 1]; /* header takes one uint32_t */
+    struct val val;
 
     INCR(process_metrics, bitmap_create);
 
     /* check column size first so we don't have to undo storage op if invalid */
-    ncol = _get_col(rsp, req, BITSET_COL_MAX);
+    ncol = _get_col(rsp, req, BITMAP_COL, BITSET_COL_MAX);
     if (ncol <= 0) {
         log_debug("command '%.*s' '%.*s' failed: invalid arg", cmd->bstr.len,
                 cmd->bstr.data, key->len, key->data);
@@ -111,16 +113,18 @@ cmd_bitmap_create(struct response *rsp, struct request *req, struct command *cmd
         return;
     }
 
-    it = _add_key(rsp, key);
+    /* initialize data structure, which is then stored as the value */
+    val.type = VAL_TYPE_STR;
+    val.vstr.data = (char *)bs;
+    val.vstr.len = bitset_init((struct bitset *)bs, (uint16_t)ncol);
+
+    it = _add_key(rsp, key, &val);
     if (it == NULL) {
         log_debug("command '%.*s' '%.*s' failed: cannot store", cmd->bstr.len,
                 cmd->bstr.data, key->len, key->data);
         return;
     }
 
-    /* initialize data structure */
-    it->vlen = bitset_init((struct bitset *)ITEM_VAL_POS(it), (uint16_t)ncol);
-
     rsp->type = reply->type = ELEM_STR;
     reply->bstr = str2bstr(RSP_OK);
 
@@ -166,7 +170,7 @@ cmd_bitmap_get(struct response *rsp, struct request *req, struct command *cmd)
     struct element *reply = (struct element *)array_push(rsp->token);
     struct bitset *bs;
 
-    INCR(process_metrics, bitmap_set);
+    INCR(process_metrics, bitmap_get);
 
     it = cuckoo_get(key);
     if (it == NULL) {
@@ -181,7 +185,7 @@ cmd_bitmap_get(struct response *rsp, struct request *req, struct command *cmd)
 
     bs = it2bitset(it);
 
-    col = _get_col(rsp, req, size2bit(bs->size) - 1);
+    col = _get_col(rsp, req, BITMAP_COL, size2bit(bs->size) - 1);
     if (col < 0) {
         log_warn("command '%.*s' on key '%.*s' failed: invalid column id",
                 cmd->bstr.len, cmd->bstr.data, key->len, key->data);
@@ -225,7 +229,7 @@ cmd_bitmap_set(struct response *rsp, struct request *req, struct command *cmd)
 
     bs = it2bitset(it);
 
-    col = _get_col(rsp, req, size2bit(bs->size) - 1);
+    col = _get_col(rsp, req, BITMAP_COL, size2bit(bs->size) - 1);
     if (col < 0) {
         log_warn("command '%.*s' on key '%.*s' failed: invalid column id",
                 cmd->bstr.len, cmd->bstr.data, key->len, key->data);
@@ -234,7 +238,7 @@ cmd_bitmap_set(struct response *rsp, struct request *req, struct command *cmd)
         return;
     }
 
-    val = _get_bitval(rsp, req, (1 << bs->col_w) - 1);
+    val = _get_bitval(rsp, req, BITMAP_VAL, (1 << bs->col_w) - 1);
     if (val < 0) {
         log_warn("command '%.*s' on key '%.*s' failed: invalid value",
                 cmd->bstr.len, cmd->bstr.data, key->len, key->data);
@@ -251,3 +255,249 @@ cmd_bitmap_set(struct response *rsp, struct request *req, struct command *cmd)
             key->len, key->data);
     INCR(process_metrics, bitmap_set_stored);
 }
+
+void
+cmd_bitmap_mget(struct response *rsp, struct request *req, struct command *cmd)
+{
+    struct item *it;
+    int32_t col;
+    uint32_t i, ntoken = array_nelem(req->token);
+    struct bstring *key = _get_key(req);
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bitset *bs;
+
+    INCR(process_metrics, bitmap_mget);
+
+    it = cuckoo_get(key);
+    if (it == NULL) {
+        rsp->type = reply->type = ELEM_STR;
+        reply->bstr = str2bstr(RSP_NOTFOUND);
+        log_verb("command '%.*s' on key '%.*s' : key not found", cmd->bstr.len,
+                cmd->bstr.data, key->len, key->data);
+        INCR(process_metrics, bitmap_mget_notfound);
+
+        return;
+    }
+
+    bs = it2bitset(it);
+
+    /* check all columns first, so an invalid one is the only reply */
+    for (i = BITMAP_COL; i < ntoken; i++) {
+        col = _get_col(rsp, req, i, size2bit(bs->size) - 1);
+        if (col < 0) {
+            log_warn("command '%.*s' on key '%.*s' failed: invalid column id",
+                    cmd->bstr.len, cmd->bstr.data, key->len, key->data);
+            INCR(process_metrics, bitmap_mget_ex);
+
+            return;
+        }
+    }
+
+    rsp->type = reply->type = ELEM_ARRAY;
+    reply->num = (int64_t)(ntoken - BITMAP_COL);
+    for (i = BITMAP_COL; i < ntoken; i++) {
+        col = _get_col(rsp, req, i, size2bit(bs->size) - 1);
+        reply = (struct element *)array_push(rsp->token);
+        reply->type = ELEM_INT;
+        reply->num = (int64_t)bitset_get(bs, col);
+    }
+
+    log_verb("command '%.*s' key '%.*s' succeeded", cmd->bstr.len, cmd->bstr.data,
+            key->len, key->data);
+    INCR(process_metrics, bitmap_mget_found);
+}
+
+void
+cmd_bitmap_mset(struct response *rsp, struct request *req, struct command *cmd)
+{
+    struct item *it;
+    int32_t col;
+    int16_t val;
+    uint32_t i, ntoken = array_nelem(req->token);
+    struct bstring *key = _get_key(req);
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bitset *bs;
+
+    INCR(process_metrics, bitmap_mset);
+
+    it = cuckoo_get(key);
+    if (it == NULL) {
+        rsp->type = reply->type = ELEM_STR;
+        reply->bstr = str2bstr(RSP_NOTFOUND);
+        log_verb("command '%.*s' on key '%.*s' : key not found", cmd->bstr.len,
+                cmd->bstr.data, key->len, key->data);
+        INCR(process_metrics, bitmap_mset_notfound);
+
+        return;
+    }
+
+    bs = it2bitset(it);
+
+    if ((ntoken - BITMAP_COL) % 2 != 0) {
+        rsp->type = reply->type = ELEM_ERR;
+        reply->bstr = str2bstr(RSP_ERR_ARG);
+        log_warn("command '%.*s' on key '%.*s' failed: unpaired column id",
+                cmd->bstr.len, cmd->bstr.data, key->len, key->data);
+        INCR(process_metrics, bitmap_mset_ex);
+        INCR(process_metrics, process_ex);
+
+        return;
+    }
+
+    /* check all columns and values first, so the update is all or nothing */
+    for (i = BITMAP_COL; i < ntoken; i += 2) {
+        if (_get_col(rsp, req, i, size2bit(bs->size) - 1) < 0 ||
+                _get_bitval(rsp, req, i + 1, (1 << bs->col_w) - 1) < 0) {
+            log_warn("command '%.*s' on key '%.*s' failed: invalid column id "
+                    "or value", cmd->bstr.len, cmd->bstr.data, key->len,
+                    key->data);
+            INCR(process_metrics, bitmap_mset_ex);
+
+            return;
+        }
+    }
+
+    for (i = BITMAP_COL; i < ntoken; i += 2) {
+        col = _get_col(rsp, req, i, size2bit(bs->size) - 1);
+        val = _get_bitval(rsp, req, i + 1, (1 << bs->col_w) - 1);
+        bitset_set(bs, (uint16_t)col, val);
+    }
+
+    rsp->type = reply->type = ELEM_STR;
+    reply->bstr = str2bstr(RSP_OK);
+
+    log_verb("command '%.*s' key '%.*s' succeeded", cmd->bstr.len, cmd->bstr.data,
+            key->len, key->data);
+    INCR(process_metrics, bitmap_mset_stored);
+}
+
+void
+cmd_bitmap_count(struct response *rsp, struct request *req, struct command *cmd)
+{
+    struct item *it;
+    int32_t start, end;
+    struct bstring *key = _get_key(req);
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct bitset *bs;
+
+    INCR(process_metrics, bitmap_count);
+
+    it = cuckoo_get(key);
+    if (it == NULL) {
+        rsp->type = reply->type = ELEM_STR;
+        reply->bstr = str2bstr(RSP_NOTFOUND);
+        log_verb("command '%.*s' on key '%.*s' : key not found", cmd->bstr.len,
+                cmd->bstr.data, key->len, key->data);
+        INCR(process_metrics, bitmap_count_notfound);
+
+        return;
+    }
+
+    bs = it2bitset(it);
+
+    rsp->type = reply->type = ELEM_INT;
+    if (cmd->nopt == 0) { /* the whole bitmap, which is kept up to date */
+        reply->num = (int64_t)bs->count;
+        INCR(process_metrics, bitmap_count_found);
+
+        return;
+    }
+
+    if (cmd->nopt != 2 ||
+            (start = _get_col(rsp, req, BITMAP_START, size2bit(bs->size) - 1)) < 0 ||
+            (end = _get_col(rsp, req, BITMAP_END, size2bit(bs->size) - 1)) < 0) {
+        rsp->type = reply->type = ELEM_ERR;
+        reply->bstr = str2bstr(RSP_ERR_ARG);
+        log_warn("command '%.*s' on key '%.*s' failed: invalid column range",
+                cmd->bstr.len, cmd->bstr.data, key->len, key->data);
+        INCR(process_metrics, bitmap_count_ex);
+
+        return;
+    }
+
+    /* the range given is inclusive of both ends */
+    reply->num = (int64_t)bitset_count(bs, (uint16_t)start, (uint16_t)end + 1);
+
+    log_verb("command '%.*s' key '%.*s' succeeded", cmd->bstr.len, cmd->bstr.data,
+            key->len, key->data);
+    INCR(process_metrics, bitmap_count_found);
+}
+
+static void
+_bitmap_op(struct response *rsp, struct request *req, struct command *cmd,
+        void (*op)(struct bitset *, struct bitset *))
+{
+    struct item *it, *src;
+    uint32_t i, ntoken = array_nelem(req->token);
+    struct bstring *key = _get_key(req);
+    struct element *reply = (struct element *)array_push(rsp->token);
+    struct element *arg;
+    struct bitset *bs;
+
+    INCR(process_metrics, bitmap_op);
+
+    it = cuckoo_get(key);
+    if (it == NULL) {
+        rsp->type = reply->type = ELEM_STR;
+        reply->bstr = str2bstr(RSP_NOTFOUND);
+        log_verb("command '%.*s' on key '%.*s' : key not found", cmd->bstr.len,
+                cmd->bstr.data, key->len, key->data);
+        INCR(process_metrics, bitmap_op_notfound);
+
+        return;
+    }
+
+    bs = it2bitset(it);
+
+    /* look up all sources first, so the update is all or nothing */
+    for (i = BITMAP_SRC; i < ntoken; i++) {
+        arg = (struct element *)array_get(req->token, i);
+        src = cuckoo_get(&arg->bstr);
+        if (src == NULL) {
+            rsp->type = reply->type = ELEM_STR;
+            reply->bstr = str2bstr(RSP_NOTFOUND);
+            log_verb("command '%.*s' on key '%.*s' : source '%.*s' not found",
+                    cmd->bstr.len, cmd->bstr.data, key->len, key->data,
+                    arg->bstr.len, arg->bstr.data);
+            INCR(process_metrics, bitmap_op_notfound);
+
+            return;
+        }
+        if (it2bitset(src)->size != bs->size) {
+            rsp->type = reply->type = ELEM_ERR;
+            reply->bstr = str2bstr(RSP_ERR_ARG);
+            log_warn("command '%.*s' on key '%.*s' failed: source '%.*s' has a "
+                    "different size", cmd->bstr.len, cmd->bstr.data, key->len,
+                    key->data, arg->bstr.len, arg->bstr.data);
+            INCR(process_metrics, bitmap_op_ex);
+            INCR(process_metrics, process_ex);
+
+            return;
+        }
+    }
+
+    for (i = BITMAP_SRC; i < ntoken; i++) {
+        arg = (struct element *)array_get(req->token, i);
+        src = cuckoo_get(&arg->bstr);
+        op(bs, it2bitset(src));
+    }
+
+    rsp->type = reply->type = ELEM_INT;
+    reply->num = (int64_t)bs->count;
+
+    log_verb("command '%.*s' key '%.*s' succeeded", cmd->bstr.len, cmd->bstr.data,
+            key->len, key->data);
+    INCR(process_metrics, bitmap_op_stored);
+}
+
+void
+cmd_bitmap_and(struct response *rsp, struct request *req, struct command *cmd)
+{
+    _bitmap_op(rsp, req, cmd, bitset_and);
+}
+
+void
+cmd_bitmap_or(struct response *rsp, struct request *req, struct command *cmd)
+{
+    _bitmap_op(rsp, req, cmd, bitset_or);
+}
@@ -16,7 +16,23 @@
     ACTION( bitmap_set,             METRIC_COUNTER, "# bitmap set requests"    )\
     ACTION( bitmap_set_stored,      METRIC_COUNTER, "# bitmap set value set"   )\
     ACTION( bitmap_set_notfound,    METRIC_COUNTER, "# bitmap set notfound"    )\
-    ACTION( bitmap_set_ex,          METRIC_COUNTER, "# bitmap set exception"   )
+    ACTION( bitmap_set_ex,          METRIC_COUNTER, "# bitmap set exception"   )\
+    ACTION( bitmap_mget,            METRIC_COUNTER, "# bitmap mget requests"   )\
+    ACTION( bitmap_mget_found,      METRIC_COUNTER, "# bitmap mget found"      )\
+    ACTION( bitmap_mget_notfound,   METRIC_COUNTER, "# bitmap mget notfound"   )\
+    ACTION( bitmap_mget_ex,         METRIC_COUNTER, "# bitmap mget exception"  )\
+    ACTION( bitmap_mset,            METRIC_COUNTER, "# bitmap mset requests"   )\
+    ACTION( bitmap_mset_stored,     METRIC_COUNTER, "# bitmap mset value set"  )\
+    ACTION( bitmap_mset_notfound,   METRIC_COUNTER, "# bitmap mset notfound"   )\
+    ACTION( bitmap_mset_ex,         METRIC_COUNTER, "# bitmap mset exception"  )\
+    ACTION( bitmap_count,           METRIC_COUNTER, "# bitmap count requests"  )\
+    ACTION( bitmap_count_found,     METRIC_COUNTER, "# bitmap count found"     )\
+    ACTION( bitmap_count_notfound,  METRIC_COUNTER, "# bitmap count notfound"  )\
+    ACTION( bitmap_count_ex,        METRIC_COUNTER, "# bitmap count exception" )\
+    ACTION( bitmap_op,              METRIC_COUNTER, "# bitmap and/or requests" )\
+    ACTION( bitmap_op_stored,       METRIC_COUNTER, "# bitmap and/or stored"   )\
+    ACTION( bitmap_op_notfound,     METRIC_COUNTER, "# bitmap and/or notfound" )\
+    ACTION( bitmap_op_ex,           METRIC_COUNTER, "# bitmap and/or exception")
 
 struct request;
 struct response;
@@ -27,3 +43,8 @@ void cmd_bitmap_create(struct response *rsp, struct request *req, struct command
 void cmd_bitmap_delete(struct response *rsp, struct request *req, struct command *cmd);
 void cmd_bitmap_get(struct response *rsp, struct request *req, struct command *cmd);
 void cmd_bitmap_set(struct response *rsp, struct request *req, struct command *cmd);
+void cmd_bitmap_mget(struct response *rsp, struct request *req, struct command *cmd);
+void cmd_bitmap_mset(struct response *rsp, struct request *req, struct command *cmd);
+void cmd_bitmap_count(struct response *rsp, struct request *req, struct command *cmd);
+void cmd_bitmap_and(struct response *rsp, struct request *req, struct command *cmd);
+void cmd_bitmap_or(struct response *rsp, struct request *req, struct command *cmd);
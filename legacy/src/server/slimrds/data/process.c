@@ -42,6 +42,11 @@ process_setup(process_options_st *options, process_metrics_st *metrics)
     command_registry[REQ_BITMAP_CREATE] = cmd_bitmap_create;
     command_registry[REQ_BITMAP_SET] = cmd_bitmap_set;
     command_registry[REQ_BITMAP_GET] = cmd_bitmap_get;
+    command_registry[REQ_BITMAP_MGET] = cmd_bitmap_mget;
+    command_registry[REQ_BITMAP_MSET] = cmd_bitmap_mset;
+    command_registry[REQ_BITMAP_COUNT] = cmd_bitmap_count;
+    command_registry[REQ_BITMAP_AND] = cmd_bitmap_and;
+    command_registry[REQ_BITMAP_OR] = cmd_bitmap_or;
 
     process_init = true;
 }
@@ -1,7 +1,9 @@
 #include "process.h"
 
+#include "hotkey/hotkey.h"
 #include "protocol/admin/admin_include.h"
 #include "storage/slab/slab.h"
+#include "util/latency.h"
 #include "util/procinfo.h"
 
 #include <cc_mm.h>
@@ -32,7 +34,8 @@ admin_process_setup(void)
 
     nmetric_perslab = METRIC_CARDINALITY(perslab[0]);
     /* perslab metric size <(32 + 20)B, prefix/suffix 12B, total < 64 */
-    cap = MAX(nmetric, nmetric_perslab * SLABCLASS_MAX_ID) * METRIC_PRINT_LEN +
+    cap = MAX(MAX(MAX(nmetric, nmetric_perslab * SLABCLASS_MAX_ID) *
+        METRIC_PRINT_LEN, latency_print_cap()), hotkey_print_cap()) +
         METRIC_END_LEN;
     buf = cc_alloc(cap);
     /* TODO: check return status of cc_alloc */
@@ -77,6 +80,32 @@ _admin_stats_slab(struct response *rsp, struct request *req)
     rsp->data.len = offset;
 }
 
+static void
+_admin_stats_latency(struct response *rsp, struct request *req)
+{
+    size_t offset;
+
+    offset = latency_print(buf, cap);
+    offset += cc_scnprintf(buf + offset, cap - offset, METRIC_END);
+
+    rsp->type = RSP_GENERIC;
+    rsp->data.data = buf;
+    rsp->data.len = offset;
+}
+
+static void
+_admin_stats_hotkey(struct response *rsp, struct request *req)
+{
+    size_t offset;
+
+    offset = hotkey_print(buf, cap);
+    offset += cc_scnprintf(buf + offset, cap - offset, METRIC_END);
+
+    rsp->type = RSP_GENERIC;
+    rsp->data.data = buf;
+    rsp->data.len = offset;
+}
+
 static void
 _admin_stats_default(struct response *rsp, struct request *req)
 {
@@ -94,6 +123,12 @@ _admin_stats(struct response *rsp, struct request *req)
     }
     if (req->arg.len == 5 && str5cmp(req->arg.data, ' ', 's', 'l', 'a', 'b')) {
         _admin_stats_slab(rsp, req);
+    } else if (req->arg.len == 8 && str8cmp(req->arg.data, ' ', 'l', 'a',
+                't', 'e', 'n', 'c', 'y')) {
+        _admin_stats_latency(rsp, req);
+    } else if (req->arg.len == 7 && str7cmp(req->arg.data, ' ', 'h', 'o',
+                't', 'k', 'e', 'y')) {
+        _admin_stats_hotkey(rsp, req);
     } else {
         rsp->type = RSP_INVALID;
     }
@@ -3,6 +3,7 @@
 #include "hotkey/hotkey.h"
 #include "protocol/data/memcache_include.h"
 #include "storage/slab/slab.h"
+#include "util/latency.h"
 
 #include <cc_array.h>
 #include <cc_debug.h>
@@ -34,6 +35,7 @@ static uint32_t prefill_vsize;
 /* val_buf size is arbitrary , update if want to warm up with larger objects */
 static char prefill_vbuf[ITEM_SIZE_MAX];
 static uint64_t prefill_nkey;
+static uint32_t value_ref_min = VALUE_REF_MIN;
 
 static void
 _prefill_slab(void)
@@ -59,7 +61,9 @@ _prefill_slab(void)
         istatus = item_reserve(&it, &key, &val, val.len, DATAFLAG_SIZE,
                 time_convert_proc_sec((time_i)INT32_MAX));
         ASSERT(istatus == ITEM_OK);
+        item_lock(&key);
         item_insert(it, &key);
+        item_unlock();
     }
     duration_stop(&d);
 
@@ -86,6 +90,7 @@ process_setup(process_options_st *options, process_metrics_st *metrics)
         prefill_ksize = (uint32_t)option_uint(&options->prefill_ksize);
         prefill_vsize = (uint32_t)option_uint(&options->prefill_vsize);
         prefill_nkey = (uint64_t)option_uint(&options->prefill_nkey);
+        value_ref_min = (uint32_t)option_uint(&options->value_ref_min);
     }
 
     if (prefill) {
@@ -104,6 +109,7 @@ process_teardown(void)
     }
 
     allow_flush = false;
+    value_ref_min = VALUE_REF_MIN;
     process_metrics = NULL;
     process_init = false;
 }
@@ -125,7 +131,8 @@ _get_key(struct response *rsp, struct bstring *key)
 {
     struct item *it;
 
-    it = item_get(key);
+    /* the item stays pinned until the response is cleaned up */
+    it = item_borrow(key);
     if (it != NULL) {
         rsp->type = RSP_VALUE;
         rsp->key = *key;
@@ -133,6 +140,7 @@ _get_key(struct response *rsp, struct bstring *key)
         rsp->vcas = item_get_cas(it);
         rsp->vstr.len = it->vlen;
         rsp->vstr.data = item_data(it);
+        rsp->item = it;
 
         if (hotkey_enabled && hotkey_sample(key)) {
             log_debug("hotkey detected: %.*s", key->len, key->data);
@@ -473,7 +481,9 @@ _process_delta(struct response *rsp, struct item *it, struct request *req,
     rsp->vint = vint;
     nval.len = cc_print_uint64_unsafe(buf, vint);
     nval.data = buf;
-    if (item_slabid(it->klen, nval.len, it->olen) == it->id) {
+    /* a pinned item may be being written out, so it is not updated in place */
+    if (item_slabid(it->klen, nval.len, it->olen) == it->id &&
+            !item_pinned(it)) {
         item_update(it, &nval);
         return ITEM_OK;
     }
@@ -629,12 +639,47 @@ _process_flushall(struct response *rsp, struct request *req)
     }
 }
 
+/* commands which change the item of their key hold the lock of the key */
+static inline bool
+_locks_key(struct request *req)
+{
+    switch (req->type) {
+    case REQ_DELETE:
+    case REQ_SET:
+    case REQ_ADD:
+    case REQ_REPLACE:
+    case REQ_CAS:
+    case REQ_INCR:
+    case REQ_DECR:
+    case REQ_APPEND:
+    case REQ_PREPEND:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
 void
 process_request(struct response *rsp, struct request *req)
 {
+    bool locked = _locks_key(req);
+
     log_verb("processing req %p, write rsp to %p", req, rsp);
     INCR(process_metrics, process_req);
 
+    if (locked) {
+        /* later segments of a value only have the key of the reserved item */
+        if (req->reserved != NULL) {
+            struct item *it = req->reserved;
+            struct bstring key = {it->klen, item_key(it)};
+
+            item_lock(&key);
+        } else {
+            item_lock(array_first(req->keys));
+        }
+    }
+
     switch (req->type) {
     case REQ_GET:
         _process_get(rsp, req);
@@ -694,6 +739,38 @@ process_request(struct response *rsp, struct request *req)
         rsp->vstr = str2bstr(CMD_ERR_MSG);
         break;
     }
+
+    if (locked) {
+        item_unlock();
+    }
+}
+
+/* the slab an item is in no longer needs to stay, see _compose_value */
+static void
+_release_ref(void *it)
+{
+    item_unpin(it);
+}
+
+/*
+ * a value at least value_ref_min long is left in the slab it is stored in,
+ * and the write buffer refers to it, keeping the item pinned and the slab
+ * from being evicted. As a slab item can also be freed and reused, the
+ * references are only kept across gets, and until the write that follows.
+ */
+static inline int
+_compose_value(struct buf **wbuf, struct response *rsp)
+{
+    struct item *it = rsp->item;
+
+    if (value_ref_min == 0 || it == NULL || rsp->type != RSP_VALUE ||
+            rsp->num || rsp->vstr.len < value_ref_min) {
+        return compose_rsp(wbuf, rsp);
+    }
+
+    item_pin(it);
+
+    return compose_rsp_ref(wbuf, rsp, _release_ref, it);
 }
 
 static inline void
@@ -701,6 +778,15 @@ _cleanup(struct request *req, struct response *rsp)
 {
     struct response *nr = STAILQ_NEXT(rsp, next);
 
+    /* give back the items borrowed by gets */
+    for (; nr != NULL; nr = STAILQ_NEXT(nr, next)) {
+        item_return(nr->item);
+        nr->item = NULL;
+    }
+    item_return(rsp->item);
+    rsp->item = NULL;
+    nr = STAILQ_NEXT(rsp, next);
+
     request_reset(req);
     /* return all but the first response */
     if (nr != NULL) {
@@ -716,6 +802,7 @@ twemcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
     parse_rstatus_e status;
     struct request *req; /* data should be NULL or hold a req pointer */
     struct response *rsp;
+    uint64_t start = latency_enabled ? latency_now() : 0;
 
     log_verb("post-read processing");
 
@@ -770,6 +857,14 @@ twemcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
 
         /* stage 2: processing- check for quit, allocate response(s), process */
 
+        /* nothing but a get keeps the values of earlier ones referred to */
+        if (req->type != REQ_GET && req->type != REQ_GETS &&
+                (*wbuf)->chain != NULL && buf_chain_unref(*wbuf) != CC_OK) {
+            log_error("cannot copy referred values: OOM");
+            INCR(process_metrics, process_ex);
+            return -1;
+        }
+
         /* quit is special, no response expected */
         if (req->type == REQ_QUIT) {
             log_info("peer called quit");
@@ -806,14 +901,22 @@ twemcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
 
         /* noreply means no need to write to buffers */
         card++;
-        if (!req->noreply) {
+        if (req->binary) {
+            /* a binary request has one response, which may be left out */
+            if (compose_bin_rsp(wbuf, req, rsp) < 0) {
+                log_error("composing rsp erred");
+                INCR(process_metrics, process_ex);
+                _cleanup(req, rsp);
+                return -1;
+            }
+        } else if (!req->noreply) {
             nr = rsp;
             if (req->type == REQ_GET || req->type == REQ_GETS) {
                 /* for get/gets, card is determined by number of values */
                 card = req->nfound + 1;
             }
             for (i = 0; i < card; nr = STAILQ_NEXT(nr, next), ++i) {
-                if (compose_rsp(wbuf, nr) < 0) {
+                if (_compose_value(wbuf, nr) < 0) {
                     log_error("composing rsp erred");
                     INCR(process_metrics, process_ex);
                     _cleanup(req, rsp);
@@ -822,6 +925,11 @@ twemcache_process_read(struct buf **rbuf, struct buf **wbuf, void **data)
             }
         }
 
+        /* latency includes the wait behind earlier requests in rbuf */
+        if (latency_enabled) {
+            latency_record(req->type, latency_now() - start);
+        }
+
         /* logging, clean-up */
         klog_write(req, rsp);
         _cleanup(req, rsp);
@@ -836,6 +944,13 @@ twemcache_process_write(struct buf **rbuf, struct buf **wbuf, void **data)
 {
     log_verb("post-write processing");
 
+    /* values not written out yet are copied, see _compose_value */
+    if ((*wbuf)->chain != NULL && buf_chain_unref(*wbuf) != CC_OK) {
+        log_error("cannot copy referred values: OOM");
+        INCR(process_metrics, process_ex);
+        return -1;
+    }
+
     buf_lshift(*rbuf);
     dbuf_shrink(rbuf);
     buf_lshift(*wbuf);
@@ -862,6 +977,10 @@ twemcache_process_error(struct buf **rbuf, struct buf **wbuf, void **data)
     /* release request data & associated reserved data */
     if (req != NULL) {
         rsp = req->rsp;
+        for (struct response *nr = rsp; nr != NULL; nr = STAILQ_NEXT(nr, next)) {
+            item_return(nr->item);
+            nr->item = NULL;
+        }
         if (req->reserved != NULL) {
             item_release((struct item **)&req->reserved);
         }
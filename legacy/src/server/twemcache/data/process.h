@@ -10,6 +10,7 @@
 #define PREFILL_KSIZE 32
 #define PREFILL_VSIZE 32
 #define PREFILL_NKEY 400000000 /* 40M keys roughly fills up a 4GB heap with default slab & data sizes */
+#define VALUE_REF_MIN 0 /* values are always copied into the write buffer */
 
 /*          name           type              default        description */
 #define PROCESS_OPTION(ACTION)                                                         \
@@ -17,7 +18,8 @@
     ACTION( prefill,       OPTION_TYPE_BOOL, PREFILL,       "prefill slabs with data" )\
     ACTION( prefill_ksize, OPTION_TYPE_UINT, PREFILL_KSIZE, "prefill key size"        )\
     ACTION( prefill_vsize, OPTION_TYPE_UINT, PREFILL_VSIZE, "prefill val size"        )\
-    ACTION( prefill_nkey,  OPTION_TYPE_UINT, PREFILL_NKEY,  "prefill keys inserted"   )
+    ACTION( prefill_nkey,  OPTION_TYPE_UINT, PREFILL_NKEY,  "prefill keys inserted"   )\
+    ACTION( value_ref_min, OPTION_TYPE_UINT, VALUE_REF_MIN, "min vlen sent w/o copy"  )
 /* prefilling can potentially follow a fairly complex config wrt key/value size
  * distribution and schema. However, basic performance testing around IO and
  * heap size can be greatly sped up without lengthy client-drive warm-up if we
@@ -51,6 +51,7 @@ static void
 teardown(void)
 {
     core_worker_teardown();
+    latency_teardown();
     core_server_teardown();
     core_admin_teardown();
     admin_process_teardown();
@@ -121,10 +122,15 @@ setup(void)
     response_setup(&setting.response, &stats.response);
     parse_setup(&stats.parse_req, NULL);
     compose_setup(NULL, &stats.compose_rsp);
-    klog_setup(&setting.klog, &stats.klog);
-    hotkey_setup(&setting.hotkey);
+    klog_setup(&setting.klog, &stats.klog,
+            option_uint(&setting.worker.worker_nthread));
+    hotkey_setup(&setting.hotkey,
+            option_uint(&setting.worker.worker_nthread));
     slab_setup(&setting.slab, &stats.slab);
     process_setup(&setting.process, &stats.process);
+    latency_setup(&setting.latency,
+            option_uint(&setting.worker.worker_nthread), req_strings,
+            REQ_SENTINEL);
     admin_process_setup();
     core_admin_setup(&setting.admin);
     core_server_setup(&setting.server, &stats.server);
@@ -216,6 +222,11 @@ main(int argc, char **argv)
         exit(EX_DATAERR);
     }
 
+    /* worker threads share the slab heap, which then locks by key */
+    if (option_uint(&setting.worker.worker_nthread) > 1) {
+        setting.slab.slab_concurrent.val.vbool = true;
+    }
+
     setup();
     option_print_all((struct option *)&setting, nopt);
 
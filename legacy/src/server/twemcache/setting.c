@@ -8,6 +8,7 @@ struct setting setting = {
     { PROCESS_OPTION(OPTION_INIT)   },
     { KLOG_OPTION(OPTION_INIT)      },
     { HOTKEY_OPTION(OPTION_INIT)    },
+    { LATENCY_OPTION(OPTION_INIT)   },
     { REQUEST_OPTION(OPTION_INIT)   },
     { RESPONSE_OPTION(OPTION_INIT)  },
     { SLAB_OPTION(OPTION_INIT)      },
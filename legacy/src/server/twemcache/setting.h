@@ -8,6 +8,7 @@
 #include "storage/slab/item.h"
 #include "storage/slab/slab.h"
 #include "time/time.h"
+#include "util/latency.h"
 
 #include <buffer/cc_buf.h>
 #include <buffer/cc_dbuf.h>
@@ -41,6 +42,7 @@ struct setting {
     process_options_st      process;
     klog_options_st         klog;
     hotkey_options_st       hotkey;
+    latency_options_st      latency;
     request_options_st      request;
     response_options_st     response;
     slab_options_st         slab;
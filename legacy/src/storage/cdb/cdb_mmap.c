@@ -0,0 +1,349 @@
+#include "cdb_mmap.h"
+
+#include <cc_debug.h>
+#include <cc_mm.h>
+#include <cc_util.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CDB_MMAP_MODULE_NAME "storage::cdb_mmap"
+
+#define NTABLE          256
+#define POINTER_SIZE    8   /* position and number of slots of a table */
+#define SLOT_SIZE       8   /* hash and position of a record */
+#define RECORD_HDR_SIZE 8   /* key length and value length */
+#define HEADER_SIZE     (NTABLE * POINTER_SIZE)
+
+#define INDEX_ALIGN     (2 * MiB)
+
+struct cdb_mmap {
+    char        *path;
+    char        *base;              /* the mapped file */
+    size_t      size;
+    const char  *index;             /* the hash tables, in the file or a copy */
+    char        *index_copy;
+    size_t      index_copy_size;
+    uint32_t    index_start;        /* file position of the first hash table */
+    uint32_t    tpos[NTABLE];
+    uint32_t    tlen[NTABLE];
+};
+
+/* state of the lookup of one key */
+struct probe {
+    uint32_t hash;
+    uint32_t table;
+    uint32_t slot;                  /* the next slot to read */
+    uint32_t nleft;                 /* slots of the table left to read */
+    uint32_t pos;                   /* position of the candidate record */
+};
+
+static inline uint32_t
+_unpack(const char *p)
+{
+    const uint8_t *b = (const uint8_t *)p;
+
+    return (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 |
+        (uint32_t)b[3] << 24;
+}
+
+static inline uint32_t
+_hash(const struct bstring *key)
+{
+    uint32_t h = 5381;
+    uint32_t i;
+
+    for (i = 0; i < key->len; i++) {
+        h = ((h << 5) + h) ^ (uint8_t)key->data[i];
+    }
+
+    return h;
+}
+
+static inline const char *
+_slot(const struct cdb_mmap *db, const struct probe *p)
+{
+    return db->index + (db->tpos[p->table] - db->index_start) +
+        (size_t)p->slot * SLOT_SIZE;
+}
+
+static inline void
+_probe_init(const struct cdb_mmap *db, const struct bstring *key,
+        struct probe *p)
+{
+    p->hash = _hash(key);
+    p->table = p->hash % NTABLE;
+    p->nleft = db->tlen[p->table];
+    p->slot = p->nleft > 0 ? (p->hash / NTABLE) % p->nleft : 0;
+    p->pos = 0;
+}
+
+/* read slots until one with the hash of the key, returns false once an empty
+ * slot is reached or the whole table was read */
+static inline bool
+_probe_next(const struct cdb_mmap *db, struct probe *p)
+{
+    while (p->nleft > 0) {
+        const char *slot = _slot(db, p);
+        uint32_t hash = _unpack(slot);
+        uint32_t pos = _unpack(slot + 4);
+
+        p->nleft--;
+        if (++p->slot == db->tlen[p->table]) {
+            p->slot = 0;
+        }
+
+        if (pos == 0) {
+            return false;
+        }
+        if (hash == p->hash) {
+            p->pos = pos;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* compare the key of the record at the position, which is bounds checked as
+ * the file may be malformed */
+static inline bool
+_match(const struct cdb_mmap *db, const struct bstring *key, uint32_t pos,
+        struct bstring *val)
+{
+    const char *record = db->base + pos;
+    uint32_t klen, vlen;
+
+    if ((uint64_t)pos + RECORD_HDR_SIZE > db->size) {
+        return false;
+    }
+
+    klen = _unpack(record);
+    vlen = _unpack(record + 4);
+    if ((uint64_t)pos + RECORD_HDR_SIZE + klen + vlen > db->size) {
+        log_warn("record at %"PRIu32" is past the end of the file", pos);
+        return false;
+    }
+
+    if (klen != key->len ||
+            cc_memcmp(record + RECORD_HDR_SIZE, key->data, klen) != 0) {
+        return false;
+    }
+
+    val->data = (char *)record + RECORD_HDR_SIZE + klen;
+    val->len = vlen;
+
+    return true;
+}
+
+static bool
+_index_copy(struct cdb_mmap *db)
+{
+    size_t len = db->size - db->index_start;
+
+    db->index_copy_size = (len + INDEX_ALIGN - 1) / INDEX_ALIGN * INDEX_ALIGN;
+    db->index_copy = cc_mmap(db->index_copy_size);
+    if (db->index_copy == NULL) {
+        return false;
+    }
+
+#ifdef MADV_HUGEPAGE
+    /* USE_HUGEPAGE */
+    madvise(db->index_copy, db->index_copy_size, MADV_HUGEPAGE);
+#endif
+
+    cc_memcpy(db->index_copy, db->base + db->index_start, len);
+    db->index = db->index_copy;
+
+    return true;
+}
+
+struct cdb_mmap *
+cdb_mmap_open(const char *path, bool index_copy)
+{
+    struct cdb_mmap *db;
+    struct stat st;
+    uint32_t i;
+    int fd;
+
+    log_info("open %s with the %s module", path, CDB_MMAP_MODULE_NAME);
+
+    db = cc_zalloc(sizeof(*db));
+    if (db == NULL) {
+        log_error("cannot allocate cdb: OOM");
+        return NULL;
+    }
+
+    db->path = cc_alloc(strlen(path) + 1);
+    if (db->path == NULL) {
+        log_error("cannot allocate cdb: OOM");
+        goto error;
+    }
+    strcpy(db->path, path);
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_error("cannot open %s: %s", path, strerror(errno));
+        goto error;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_size < HEADER_SIZE) {
+        log_error("%s is not a cdb file", path);
+        close(fd);
+        goto error;
+    }
+    db->size = (size_t)st.st_size;
+
+    db->base = mmap(NULL, db->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (db->base == MAP_FAILED) {
+        log_error("cannot mmap %s: %s", path, strerror(errno));
+        db->base = NULL;
+        goto error;
+    }
+
+    /* lookups hit random pages, so reading ahead only evicts other pages */
+    madvise(db->base, db->size, MADV_RANDOM);
+
+    db->index_start = UINT32_MAX;
+    for (i = 0; i < NTABLE; i++) {
+        db->tpos[i] = _unpack(db->base + i * POINTER_SIZE);
+        db->tlen[i] = _unpack(db->base + i * POINTER_SIZE + 4);
+
+        if (db->tpos[i] < HEADER_SIZE ||
+                (uint64_t)db->tpos[i] + (uint64_t)db->tlen[i] * SLOT_SIZE >
+                db->size) {
+            log_error("hash table %"PRIu32" of %s is out of bounds", i, path);
+            goto error;
+        }
+        db->index_start = MIN(db->index_start, db->tpos[i]);
+    }
+
+    if (index_copy) {
+        if (!_index_copy(db)) {
+            log_error("cannot copy the hash tables of %s", path);
+            goto error;
+        }
+    } else {
+        db->index = db->base + db->index_start;
+        madvise(db->base + db->index_start, db->size - db->index_start,
+                MADV_WILLNEED);
+    }
+
+    log_info("mapped %zu bytes of %s, %zu bytes of hash tables%s", db->size,
+            path, db->size - db->index_start, index_copy ? " copied" : "");
+
+    return db;
+
+error:
+    cdb_mmap_close(&db);
+    return NULL;
+}
+
+void
+cdb_mmap_close(struct cdb_mmap **db)
+{
+    if (*db == NULL) {
+        return;
+    }
+
+    if ((*db)->index_copy != NULL) {
+        cc_munmap((*db)->index_copy, (*db)->index_copy_size);
+    }
+    if ((*db)->base != NULL) {
+        munmap((*db)->base, (*db)->size);
+    }
+    if ((*db)->path != NULL) {
+        cc_free((*db)->path);
+    }
+
+    cc_free(*db);
+}
+
+struct cdb_mmap *
+cdb_mmap_reopen(const struct cdb_mmap *db, const char *path)
+{
+    return cdb_mmap_open(path != NULL ? path : db->path,
+            db->index_copy != NULL);
+}
+
+void
+cdb_mmap_warm(struct cdb_mmap *db)
+{
+    long pagesize = sysconf(_SC_PAGESIZE);
+    volatile char sum = 0;
+    size_t off;
+
+    /* start the reads of the whole file before any page is waited on */
+    madvise(db->base, db->size, MADV_WILLNEED);
+
+    for (off = 0; off < db->size; off += pagesize) {
+        sum += db->base[off];
+    }
+    (void)sum;
+
+    log_info("warmed up %zu bytes", db->size);
+}
+
+bool
+cdb_mmap_get(struct cdb_mmap *db, const struct bstring *key,
+        struct bstring *val)
+{
+    struct probe p;
+
+    _probe_init(db, key, &p);
+    while (_probe_next(db, &p)) {
+        if (_match(db, key, p.pos, val)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+cdb_mmap_get_batch(struct cdb_mmap *db, struct bstring *const *keys,
+        uint32_t nkey, struct bstring *vals)
+{
+    struct probe p[CDB_MMAP_BATCH];
+    bool candidate[CDB_MMAP_BATCH];
+    uint32_t n, i;
+
+    for (; nkey > 0; keys += n, vals += n, nkey -= n) {
+        n = MIN(nkey, CDB_MMAP_BATCH);
+
+        /* the first slot of each key */
+        for (i = 0; i < n; i++) {
+            _probe_init(db, keys[i], &p[i]);
+            if (p[i].nleft > 0) {
+                __builtin_prefetch(_slot(db, &p[i]), 0);
+            }
+        }
+
+        /* the first record with a matching hash */
+        for (i = 0; i < n; i++) {
+            candidate[i] = _probe_next(db, &p[i]);
+            if (candidate[i]) {
+                __builtin_prefetch(db->base + p[i].pos, 0);
+            }
+        }
+
+        /* the keys, probing on for the rare collisions of the whole hash */
+        for (i = 0; i < n; i++) {
+            bstring_init(&vals[i]);
+            if (!candidate[i]) {
+                continue;
+            }
+            do {
+                if (_match(db, keys[i], p[i].pos, &vals[i])) {
+                    break;
+                }
+            } while (_probe_next(db, &p[i]));
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+ * A reader of djb's constant database (cdb) format which maps the file and
+ * serves values straight out of the mapping.
+ *
+ * A cdb file starts with 256 pointers to hash tables, each the position and
+ * the number of slots of a table, which follow all the records at the end of
+ * the file. The low byte of the hash of a key picks its table, and the rest
+ * of the hash its first slot, from which the slots are probed linearly. Each
+ * slot holds the hash and the position of a record, which is the lengths of
+ * the key and the value followed by the key and the value. All numbers are 32
+ * bit little endian, so a file is at most 4GiB.
+ *
+ * The pointers are copied out of the file on open. The hash tables may also be
+ * copied into anonymous memory backed by huge pages, which keeps the index of
+ * a large file resident and cheap to translate while the records are served
+ * from the page cache.
+ */
+
+#include <cc_bstring.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* the most keys which are looked up together, with their memory accesses
+ * overlapped */
+#define CDB_MMAP_BATCH 16
+
+struct cdb_mmap;
+
+/* map the cdb file at the path, optionally copying its hash tables into
+ * memory, returns NULL if the file can't be mapped or is malformed */
+struct cdb_mmap *cdb_mmap_open(const char *path, bool index_copy);
+void cdb_mmap_close(struct cdb_mmap **db);
+
+/* open the file at the path the same way as db, or db's own file if the path
+ * is NULL, which picks up a file which was replaced at the same path */
+struct cdb_mmap *cdb_mmap_reopen(const struct cdb_mmap *db, const char *path);
+
+/* read the whole file into the page cache and fault in its pages, so that a
+ * file which is about to be served does not start out cold */
+void cdb_mmap_warm(struct cdb_mmap *db);
+
+/* look up the key, on a hit val points at the value within the mapping */
+bool cdb_mmap_get(struct cdb_mmap *db, const struct bstring *key, struct bstring *val);
+
+/* look up nkey keys, prefetching the slots and then the records of up to
+ * CDB_MMAP_BATCH keys at a time. vals[i].data is NULL if keys[i] is missing */
+void cdb_mmap_get_batch(struct cdb_mmap *db, struct bstring *const *keys,
+        uint32_t nkey, struct bstring *vals);
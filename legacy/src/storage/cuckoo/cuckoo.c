@@ -10,12 +10,59 @@
 
 /* TODO(yao): make D and iv[] configurable */
 #include <stdlib.h>
+#include <string.h>
 #include <sysexits.h>
 
 #define CUCKOO_MODULE_NAME "storage::cuckoo"
 
 /* D is the degree/cardinality of the hash values computed for each key */
-#define D       4
+#define D       2
+
+/**
+ * Items are stored in buckets of CUCKOO_NSLOT slots, and each key can live in
+ * any slot of D candidate buckets. Besides the items, every bucket has a tag
+ * word, which holds one tag (a byte of the hash value, never 0) per slot, or
+ * 0 if the slot is empty. A lookup compares the tag of the key against all
+ * slots of a bucket at once, and only compares the key of items whose tags
+ * match.
+ *
+ *   <------------------ nbucket * CUCKOO_NSLOT * item_size ------------------>
+ *   +-----------------------------------------------------+-----------------+
+ *   | bucket 0: slot 0 | slot 1 | ... | bucket 1: slot 0  | ... | tag words |
+ *   +-----------------------------------------------------+-----------------+
+ *
+ * The tag words are stored in the datapool after the items, so they are
+ * recovered along with the items.
+ *
+ * There can be a few tiers of different item sizes, each a table as above,
+ * laid out one after another in the datapool. An item is inserted into the
+ * tier of the smallest item size that fits it, and lives in only one tier.
+ * A key is looked up in the tier which the size hint of its hash points to
+ * first, which is the tier where a key of the same hint was last stored, and
+ * in the other tiers after.
+ *
+ * With cuckoo_concurrent, the buckets are guarded by stripes of a version
+ * word each, which is odd while a writer holds the stripe. A writer locks the
+ * stripes of the candidate buckets of its key in all tiers, in order, so that
+ * writers of different keys only wait for each other when their buckets
+ * share a stripe. A reader takes no lock: it notes the versions of the
+ * stripes of its key, copies the item out, and starts over if any version has
+ * changed meanwhile. A displacement path is found before any stripe of it is
+ * locked, and is then locked with try-locks, which never wait and so cannot
+ * deadlock with writers locking in order. If a stripe is held by another
+ * writer, or the path changed before it was locked, the insert evicts from
+ * its candidate buckets instead.
+ */
+#define CUCKOO_NSLOT        4
+#define CUCKOO_BFS_MAX      256     /* max # slots visited to find a path */
+#define CUCKOO_DISPLACE_MAX 8       /* max # items moved to insert one */
+#define CUCKOO_DISPLACE_LOAD 0.95   /* max load to look for a path at */
+#define TAG_ONES            0x01010101u
+#define TAG_HIGHS           0x80808080u
+#define CUCKOO_NTIER_MAX    8
+#define CUCKOO_HINT_POWER   16      /* # entries (power of 2) of size hints */
+#define CUCKOO_STRIPE_POWER 14      /* # stripes (power of 2) of buckets */
+#define CUCKOO_KEY_STRIPE   (D * CUCKOO_NTIER_MAX)  /* max # stripes of a key */
 
 uint64_t cas_val;
 bool cas_enabled = CUCKOO_ITEM_CAS;
@@ -36,17 +83,36 @@ static uint32_t iv[D] = {
     /* these numbers can be picked arbitrarily as long as they are different */
     0x3ac5d673,
     0x6d7839d0,
-    0x2b581cf5,
-    0x4dd2be0a
+};
+
+struct cuckoo_tier {
+    void        *ds;        /* items of the tier */
+    uint32_t    *tags;      /* tag word of each bucket, stored after the items */
+    size_t      item_size;
+    uint32_t    stripe;     /* stripe of the first bucket */
+    uint32_t    nbucket;    /* # items / CUCKOO_NSLOT (rounded up) */
+    uint32_t    nused;      /* # slots with a tag, valid or expired */
+    uint32_t    max_nused;  /* # slots used beyond which to evict directly */
 };
 
 static struct datapool *pool; /* data pool mapping for the hash table */
 static void* ds; /* data store is also the hash table */
-static size_t item_size = CUCKOO_ITEM_SIZE;
-static uint32_t max_nitem = CUCKOO_NITEM;
-static size_t hash_size; /* item_size * max_nitem, computed at setup */
-
-#define OFFSET2ITEM(o) ((struct item *)((ds) + (o) * item_size))
+static struct cuckoo_tier tier[CUCKOO_NTIER_MAX];
+static uint32_t ntier;
+static uint8_t *hint; /* tier of the key last stored per hint, if ntier > 1 */
+static uint32_t max_displace = CUCKOO_DISPLACE;
+static bool prefetch = CUCKOO_PREFETCH;
+static size_t hash_size; /* items and tag words of all tiers, computed at setup */
+static uint32_t *stripe; /* version of each stripe, if shared by threads */
+static __thread uint32_t held[CUCKOO_KEY_STRIPE]; /* stripes locked, sorted */
+static __thread uint32_t nheld;
+
+#define OFFSET2ITEM(t, o) ((struct item *)((t)->ds + (o) * (t)->item_size))
+#define ITEM2OFFSET(t, it)                                                  \
+    ((uint32_t)(((char *)(it) - (char *)(t)->ds) / (t)->item_size))
+#define SLOT(b, s) ((b) * CUCKOO_NSLOT + (s))
+#define HINT(hv) ((hv) & ((1u << CUCKOO_HINT_POWER) - 1))
+#define STRIPE(t, b) (((t)->stripe + (b)) & ((1u << CUCKOO_STRIPE_POWER) - 1))
 #define RANDOM(k) (random() % k)
 
 #define ITEM_METRICS_INCR(it)   do {                                        \
@@ -86,40 +152,235 @@ cuckoo_hit(struct item *it, struct bstring *key)
     return item_valid(it) && item_matched(it, key);
 }
 
+/* the D hash values of a key, which are shared by all tiers */
+static void
+cuckoo_hash(uint32_t hv[], struct bstring *key)
+{
+    int i;
+
+    for (i = 0; i < D; ++i) {
+        hash_murmur3_32(key->data, key->len, iv[i], &hv[i]);
+    }
+}
+
+/* the tag of a key, the high byte is independent of the bucket */
+static inline uint8_t
+cuckoo_tag(const uint32_t hv[])
+{
+    uint8_t tag = (uint8_t)(hv[0] >> 24);
+
+    return tag + (tag == 0); /* 0 marks empty */
+}
+
+/* the D candidate buckets of a key in a tier */
 static void
-cuckoo_hash(uint32_t offset[], struct bstring *key)
+cuckoo_bucket(uint32_t bucket[], const uint32_t hv[], struct cuckoo_tier *t)
 {
     int i;
-    uint32_t hv;
 
     for (i = 0; i < D; ++i) {
-        hash_murmur3_32(key->data, key->len, iv[i], &hv);
-        offset[i] = hv % max_nitem;
+        bucket[i] = hv[i] % t->nbucket;
+    }
+
+    /* make sure the candidates differ, unless there is only one bucket */
+    if (bucket[1] == bucket[0]) {
+        bucket[1] = (bucket[0] + 1) % t->nbucket;
+    }
+}
+
+static inline uint8_t
+_tag_get(struct cuckoo_tier *t, uint32_t slot)
+{
+    return (uint8_t)(t->tags[slot / CUCKOO_NSLOT] >> (slot % CUCKOO_NSLOT * 8));
+}
+
+static inline void
+_tag_set(struct cuckoo_tier *t, uint32_t slot, uint8_t tag)
+{
+    uint32_t shift = slot % CUCKOO_NSLOT * 8;
+    uint32_t *word = &t->tags[slot / CUCKOO_NSLOT];
+
+    int32_t delta = (tag != 0) - (_tag_get(t, slot) != 0);
+
+    if (delta != 0) {
+        __atomic_add_fetch(&t->nused, delta, __ATOMIC_RELAXED);
+    }
+    *word = (*word & ~(0xffu << shift)) | ((uint32_t)tag << shift);
+}
+
+/*
+ * Compare a tag against all tags of a bucket in one go: the returned mask has
+ * the high bit set in the byte of each slot whose tag matches. A slot may be
+ * reported when it does not match (if a lower slot does), which costs a key
+ * comparison but never misses a match.
+ */
+static inline uint32_t
+_tag_match(uint32_t word, uint8_t tag)
+{
+    uint32_t x = word ^ (TAG_ONES * tag);
+
+    return (x - TAG_ONES) & ~x & TAG_HIGHS;
+}
+
+static inline uint32_t
+_tag_first_slot(uint32_t mask)
+{
+    return __builtin_ctz(mask) / 8;
+}
+
+static inline void
+_prefetch_bucket(struct cuckoo_tier *t, uint32_t bucket)
+{
+    uint32_t s;
+
+    __builtin_prefetch(&t->tags[bucket]);
+    for (s = 0; s < CUCKOO_NSLOT; ++s) {
+        __builtin_prefetch(OFFSET2ITEM(t, SLOT(bucket, s)));
+    }
+}
+
+static struct item *
+_bucket_get(struct cuckoo_tier *t, uint32_t bucket, uint8_t tag,
+        struct bstring *key)
+{
+    uint32_t mask = _tag_match(t->tags[bucket], tag);
+    struct item *it;
+
+    for (; mask != 0; mask &= mask - 1) {
+        it = OFFSET2ITEM(t, SLOT(bucket, _tag_first_slot(mask)));
+        if (cuckoo_hit(it, key)) {
+            return it;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Find a slot in the bucket which does not hold a valid item, which is either
+ * empty or expired, preferring the former. Returns UINT32_MAX if none.
+ */
+static uint32_t
+_bucket_find_free(struct cuckoo_tier *t, uint32_t bucket)
+{
+    uint32_t mask = _tag_match(t->tags[bucket], 0);
+    uint32_t s;
+
+    if (mask != 0) {
+        return SLOT(bucket, _tag_first_slot(mask));
     }
 
-    return;
+    for (s = 0; s < CUCKOO_NSLOT; ++s) {
+        if (!item_valid(OFFSET2ITEM(t, SLOT(bucket, s)))) {
+            return SLOT(bucket, s);
+        }
+    }
+
+    return UINT32_MAX;
 }
 
+/* the metrics of an item in a slot which is about to be written over */
+static void
+_slot_reclaim(struct cuckoo_tier *t, uint32_t slot)
+{
+    struct item *it = OFFSET2ITEM(t, slot);
+
+    if (_tag_get(t, slot) != 0 && item_expired(it)) {
+        INCR(cuckoo_metrics, item_expire);
+        ITEM_METRICS_DECR(it);
+    }
+}
+
+/* the candidate bucket of the item in slot, other than the one it is in */
+static uint32_t
+_alt_bucket(struct cuckoo_tier *t, uint32_t slot)
+{
+    struct item *it = OFFSET2ITEM(t, slot);
+    struct bstring key;
+    uint32_t hv[D], bucket[D];
+
+    item_key(&key, it);
+    /* an item read while it is written may be torn, see cuckoo_displace */
+    key.len = MIN(key.len, t->item_size - ITEM_OVERHEAD);
+    cuckoo_hash(hv, &key);
+    cuckoo_bucket(bucket, hv, t);
+
+    return bucket[0] == slot / CUCKOO_NSLOT ? bucket[1] : bucket[0];
+}
+
+/* the version of a stripe once no writer holds it */
 static inline uint32_t
-_select_candidate(const uint32_t offset[])
+_stripe_begin(uint32_t s)
+{
+    uint32_t v;
+
+    while ((v = __atomic_load_n(&stripe[s], __ATOMIC_ACQUIRE)) & 1);
+
+    return v;
+}
+
+static inline void
+_stripe_lock(uint32_t s)
+{
+    uint32_t v;
+
+    do {
+        v = _stripe_begin(s);
+    } while (!__atomic_compare_exchange_n(&stripe[s], &v, v + 1, false,
+                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+}
+
+static inline bool
+_stripe_trylock(uint32_t s)
 {
-    uint32_t selected = offset[0];
+    uint32_t v = __atomic_load_n(&stripe[s], __ATOMIC_RELAXED);
+
+    return (v & 1) == 0 && __atomic_compare_exchange_n(&stripe[s], &v, v + 1,
+            false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void
+_stripe_unlock(uint32_t s)
+{
+    __atomic_add_fetch(&stripe[s], 1, __ATOMIC_RELEASE);
+}
+
+static bool
+_stripe_held(uint32_t s, const uint32_t locked[], uint32_t nlocked)
+{
+    uint32_t i;
+
+    for (i = 0; i < nheld && held[i] != s; ++i);
+    if (i < nheld) {
+        return true;
+    }
+    for (i = 0; i < nlocked && locked[i] != s; ++i);
+
+    return i < nlocked;
+}
+
+static inline uint32_t
+_select_candidate(struct cuckoo_tier *t, const uint32_t bucket[])
+{
+    uint32_t selected = SLOT(bucket[0], 0);
 
     if (cuckoo_policy == CUCKOO_POLICY_RANDOM) {
-        selected = offset[RANDOM(D)];
+        selected = SLOT(bucket[RANDOM(D)], RANDOM(CUCKOO_NSLOT));
     } else if (cuckoo_policy == CUCKOO_POLICY_EXPIRE) {
         /*
          * Selection prefers the item expiring soonest, followed by the one
          * with the smallest offset.
          */
         proc_time_i expire, min = INT32_MAX;
-        uint32_t i;
+        uint32_t i, s;
 
         for (i = 0; i < D; ++i) {
-            expire = item_expire(OFFSET2ITEM(offset[i]));
-            if (expire < min) {
-                min = expire;
-                selected = offset[i];
+            for (s = 0; s < CUCKOO_NSLOT; ++s) {
+                expire = item_expire(OFFSET2ITEM(t, SLOT(bucket[i], s)));
+                if (expire < min) {
+                    min = expire;
+                    selected = SLOT(bucket[i], s);
+                }
             }
         }
     } else {
@@ -131,143 +392,233 @@ _select_candidate(const uint32_t offset[])
     return selected;
 }
 
-/* sorts candidate offsets based on policy */
-static void
-_sort_candidate(uint32_t ordered[], const uint32_t offset[])
-{
-    uint32_t i;
-    /* offset always holds D elements */
+struct cuckoo_step {
+    uint32_t slot;
+    int32_t parent;         /* index of the previous step, -1 if none */
+    uint32_t depth;
+};
 
-    if (cuckoo_policy == CUCKOO_POLICY_RANDOM) {
-        /* only pick the first item randomly, and "sort" the rest linearly */
-        uint32_t j = RANDOM(D);
+/*
+ * Lock the stripes of the buckets on a path which the candidate buckets don't
+ * already hold, without waiting for any of them, and check that the path is
+ * still what it was when it was found: each item is still one whose alternate
+ * bucket is the next on the path, and the slot at the end is still free.
+ * Returns the number of stripes locked into locked[], or UINT32_MAX (with
+ * nothing left locked) if some stripe is held or the path has changed.
+ */
+static uint32_t
+_path_lock(struct cuckoo_tier *t, const struct cuckoo_step queue[],
+        int32_t head, uint32_t dst, uint32_t locked[])
+{
+    uint32_t nlocked = 0, s, slot = dst;
+    int32_t n = head;
+    bool valid = true;
+
+    /* the bucket of the free slot, then those of the items to move */
+    for (;;) {
+        s = STRIPE(t, slot / CUCKOO_NSLOT);
+        if (!_stripe_held(s, locked, nlocked)) {
+            if (!_stripe_trylock(s)) {
+                valid = false;
+                break;
+            }
+            locked[nlocked++] = s;
+        }
+        if (n < 0) {
+            break;
+        }
+        slot = queue[n].slot;
+        n = queue[n].parent;
+    }
 
-        for (i = 0; i < D; ++i, j = (j + 1) % D) {
-            ordered[i] = offset[j];
+    if (valid) {
+        valid = !item_valid(OFFSET2ITEM(t, dst)) || _tag_get(t, dst) == 0;
+        for (n = head, slot = dst; valid && n >= 0; n = queue[n].parent) {
+            valid = _alt_bucket(t, queue[n].slot) == slot / CUCKOO_NSLOT;
+            slot = queue[n].slot;
         }
-    } else if (cuckoo_policy == CUCKOO_POLICY_EXPIRE) {
-        proc_time_i expire[D];
+    }
 
-        for (i = 0; i < D; ++i) {
-            uint32_t j = i;
-            proc_time_i te;
-            uint32_t to;
-
-            /* basically an insert sort */
-            expire[i] = item_expire(OFFSET2ITEM(offset[i]));
-            ordered[i] = offset[i];
-            while (j > 0 && expire[j] < expire[j - 1]) {
-                /* swap */
-                te = expire[j - 1];
-                expire[j - 1] = expire[j];
-                expire[j] = te;
-                to = ordered[j - 1];
-                ordered[j - 1] = ordered[j];
-                ordered[j] = to;
-                j--;
-            }
+    if (!valid) {
+        for (s = 0; s < nlocked; ++s) {
+            _stripe_unlock(locked[s]);
         }
-    } else {
-        NOT_REACHED();
+        return UINT32_MAX;
     }
+
+    return nlocked;
 }
 
-static void
-cuckoo_displace(uint32_t displaced)
+/*
+ * Breadth-first search for the shortest path of displacements, starting from
+ * any slot of the candidate buckets and ending at a free slot. Each step moves
+ * the item in a slot to its alternate bucket, and the path is limited to
+ * max_displace steps and CUCKOO_BFS_MAX slots visited.
+ *
+ * If a path is found, the items are moved along it and the freed slot in one
+ * of the candidate buckets is returned; UINT32_MAX is returned otherwise.
+ * When the table is shared, the path is found without locks and only locked
+ * once it is to be moved along, as described at the top.
+ */
+static uint32_t
+cuckoo_displace(struct cuckoo_tier *t, const uint32_t bucket[])
 {
-    long int i, j, k, step;
-    struct bstring key;
-    struct item *it;
-    /* both offset and ordered may have duplicates, treat with care */
-    uint32_t offset[D];
-    uint32_t ordered[D];
-    uint32_t path[CUCKOO_DISPLACE + 1];
-    bool ended = false;
-    bool evict = true;
+    struct cuckoo_step queue[CUCKOO_BFS_MAX];
+    uint32_t locked[CUCKOO_DISPLACE_MAX + 1], nlocked = 0;
+    uint32_t head = 0, tail = 0;
+    uint32_t i, s, alt, dst = UINT32_MAX;
+    int32_t n;
 
     INCR(cuckoo_metrics, cuckoo_displace);
 
-    step = 0;
-    path[0] = displaced;
-    while (!ended && step < CUCKOO_DISPLACE) {
-        step++;
-        it = OFFSET2ITEM(displaced);
-        key.len = it->klen;
-        key.data = ITEM_KEY_POS(it);
-        cuckoo_hash(offset, &key);
+    for (i = 0; i < D; ++i) {
+        for (s = 0; s < CUCKOO_NSLOT; ++s) {
+            queue[tail].slot = SLOT(bucket[i], s);
+            queue[tail].parent = -1;
+            queue[tail].depth = 1;
+            tail++;
+        }
+    }
 
-        /* first try to find an empty item */
-        for (i = 0; i < D; ++i) {
-            it = OFFSET2ITEM(offset[i]);
-            if (item_valid(it)) {
+    for (; head < tail; head++) {
+        alt = _alt_bucket(t, queue[head].slot);
+        dst = _bucket_find_free(t, alt);
+        if (dst != UINT32_MAX) {
+            break;
+        }
+
+        if (queue[head].depth >= max_displace) {
+            continue;
+        }
+        for (s = 0; s < CUCKOO_NSLOT && tail < CUCKOO_BFS_MAX; ++s) {
+            /* a path moves each item once, so it can't visit a slot twice */
+            for (n = head; n >= 0 && queue[n].slot != SLOT(alt, s);
+                    n = queue[n].parent);
+            if (n >= 0) {
                 continue;
             }
-            log_verb("item at %p is unoccupied", it);
 
-            ended = true;
-            evict = false;
-            path[step] = offset[i];
-            INCR(cuckoo_metrics, item_displace);
+            queue[tail].slot = SLOT(alt, s);
+            queue[tail].parent = head;
+            queue[tail].depth = queue[head].depth + 1;
+            tail++;
+        }
+    }
 
-            if (item_expired(it)) {
-                INCR(cuckoo_metrics, item_expire);
-                ITEM_METRICS_DECR(it);
-            }
+    if (dst == UINT32_MAX) {
+        log_debug("no displacement path within %"PRIu32" steps", max_displace);
 
-            break;
+        return UINT32_MAX;
+    }
+
+    if (stripe != NULL) {
+        nlocked = _path_lock(t, queue, head, dst, locked);
+        if (nlocked == UINT32_MAX) {
+            log_debug("displacement path is contended or has changed");
+            INCR(cuckoo_metrics, cuckoo_displace_ex);
+
+            return UINT32_MAX;
         }
+    }
 
-        /* no empty item, proceed to displacement */
-        if (D == i) {
-            _sort_candidate(ordered, offset);
-            /* need to find another item that's at a different location. */
-            for (j = 0; j < D; ++j) {
-                for (k = 0; k < step; k++) { /* there can be no circle */
-                    if (path[k] == ordered[j]) {
-                        continue;
-                    }
-                }
-                break; /* otherwise we have a candidate */
-            }
+    /* move items along the path, from the free slot back to a candidate */
+    _slot_reclaim(t, dst);
+    for (n = head; n >= 0; n = queue[n].parent) {
+        log_vverb("move item at %p to %p", OFFSET2ITEM(t, queue[n].slot),
+                OFFSET2ITEM(t, dst));
+
+        cc_memcpy(OFFSET2ITEM(t, dst), OFFSET2ITEM(t, queue[n].slot),
+                t->item_size);
+        _tag_set(t, dst, _tag_get(t, queue[n].slot));
+        INCR(cuckoo_metrics, item_displace);
+        dst = queue[n].slot;
+    }
+
+    for (i = 0; i < nlocked; ++i) {
+        _stripe_unlock(locked[i]);
+    }
+
+    return dst;
+}
 
-            if (D == j) {
-                /* all offsets are the same. no candidate for eviction. */
-                log_debug("running out of displacement candidates");
 
-                ended = true;
-                --step; /* discard last step */
-            } else {
-                INCR(cuckoo_metrics, item_displace);
-                displaced = ordered[j]; /* next displaced item */
-                path[step] = displaced;
+/*
+ * Parse the tiers from a space separated list of <item size>:<# items>, in
+ * increasing item sizes. Without the list, there is a single tier of
+ * item_size and nitem.
+ */
+static rstatus_i
+_cuckoo_tier_setup(const char *tiers, size_t item_size, uint32_t nitem)
+{
+    const char *p = tiers;
+    char *end;
+    uint32_t i;
+
+    if (tiers != NULL) {
+        p += strspn(p, " \t");
+    }
+
+    for (ntier = 0; tiers == NULL || *p != '\0'; ntier++) {
+        if (ntier == CUCKOO_NTIER_MAX) {
+            log_error("more than %u cuckoo tiers", CUCKOO_NTIER_MAX);
+            return CC_ERROR;
+        }
+
+        if (tiers != NULL) {
+            item_size = strtoul(p, &end, 10);
+            if (end == p || *end != ':') {
+                log_error("invalid cuckoo tier '%s'", p);
+                return CC_ERROR;
             }
+            p = end + 1;
+            nitem = strtoul(p, &end, 10);
+            if (end == p) {
+                log_error("invalid cuckoo tier '%s'", p);
+                return CC_ERROR;
+            }
+            p = end + strspn(end, " \t");
         }
-    }
 
-    if (evict) {
-        log_verb("one item evicted during replacement");
+        if (item_size < MIN_ITEM_CHUNK_SIZE || nitem == 0 || (ntier > 0 &&
+                item_size <= tier[ntier - 1].item_size)) {
+            log_error("invalid cuckoo tier of item size %zu, %"PRIu32" items",
+                    item_size, nitem);
+            return CC_ERROR;
+        }
 
-        it = OFFSET2ITEM(path[step]);
-        INCR(cuckoo_metrics, item_evict);
-        ITEM_METRICS_DECR(it);
+        tier[ntier].item_size = item_size;
+        tier[ntier].nbucket = (nitem + CUCKOO_NSLOT - 1) / CUCKOO_NSLOT;
+
+        if (tiers == NULL) {
+            ntier++;
+            break;
+        }
     }
 
-    /* move items along the path we have found */
-    for (i = step; i > 0; --i) {
-        log_vverb("move item at %p to %p", OFFSET2ITEM(path[i - 1]),
-                OFFSET2ITEM(path[i]));
+    if (ntier == 0) {
+        log_error("no cuckoo tier is specified");
+        return CC_ERROR;
+    }
 
-        cc_memcpy(OFFSET2ITEM(path[i]), OFFSET2ITEM(path[i - 1]), item_size);
+    hash_size = 0;
+    for (i = 0; i < ntier; ++i) {
+        hash_size += tier[i].item_size * tier[i].nbucket * CUCKOO_NSLOT +
+            sizeof(*tier[i].tags) * tier[i].nbucket;
     }
 
-    OFFSET2ITEM(path[0])->expire = 0;
-    return;
+    return CC_OK;
 }
 
-
 void
 cuckoo_setup(cuckoo_options_st *options, cuckoo_metrics_st *metrics)
 {
+    size_t item_size = CUCKOO_ITEM_SIZE;
+    uint32_t max_nitem = CUCKOO_NITEM;
+    char *tiers = CUCKOO_TIERS;
+    bool concurrent = CUCKOO_CONCURRENT;
+    void *addr;
+    uint32_t i, j;
+
     log_info("set up the %s module", CUCKOO_MODULE_NAME);
 
     if (cuckoo_init) {
@@ -280,12 +631,26 @@ cuckoo_setup(cuckoo_options_st *options, cuckoo_metrics_st *metrics)
     if (options != NULL) {
         item_size = option_uint(&options->cuckoo_item_size);
         max_nitem = option_uint(&options->cuckoo_nitem);
+        tiers = option_str(&options->cuckoo_tiers);
         cuckoo_policy = option_uint(&options->cuckoo_policy);
         cas_enabled = option_bool(&options->cuckoo_item_cas);
         max_ttl = option_uint(&options->cuckoo_max_ttl);
+        max_displace = option_uint(&options->cuckoo_displace);
+        prefetch = option_bool(&options->cuckoo_prefetch);
+        concurrent = option_bool(&options->cuckoo_concurrent);
+    }
+
+    if (max_displace > CUCKOO_DISPLACE_MAX) {
+        log_warn("cuckoo displace %"PRIu32" is capped at %u", max_displace,
+                CUCKOO_DISPLACE_MAX);
+        max_displace = CUCKOO_DISPLACE_MAX;
+    }
+
+    if (_cuckoo_tier_setup(tiers, item_size, max_nitem) != CC_OK) {
+        log_crit("cuckoo tier setup failed");
+        exit(EX_CONFIG);
     }
 
-    hash_size = item_size * max_nitem;
     pool = datapool_open(option_str(&options->cuckoo_datapool),
         option_str(&options->cuckoo_datapool_name), hash_size,
         NULL, option_bool(&options->cuckoo_datapool_prefault));
@@ -295,6 +660,42 @@ cuckoo_setup(cuckoo_options_st *options, cuckoo_metrics_st *metrics)
     }
     ds = datapool_addr(pool);
 
+    for (addr = ds, i = 0; i < ntier; ++i) {
+        tier[i].ds = addr;
+        tier[i].stripe = i == 0 ? 0 : tier[i - 1].stripe + tier[i - 1].nbucket;
+        tier[i].tags = (uint32_t *)OFFSET2ITEM(&tier[i],
+                tier[i].nbucket * CUCKOO_NSLOT);
+        addr = tier[i].tags + tier[i].nbucket;
+        for (tier[i].nused = 0, j = 0; j < tier[i].nbucket * CUCKOO_NSLOT;
+                ++j) {
+            tier[i].nused += (_tag_get(&tier[i], j) != 0);
+        }
+        tier[i].max_nused = tier[i].nbucket * CUCKOO_NSLOT *
+            CUCKOO_DISPLACE_LOAD;
+        log_info("cuckoo tier %"PRIu32": item size %zu, %"PRIu32" items", i,
+                tier[i].item_size, tier[i].nbucket * CUCKOO_NSLOT);
+    }
+
+    if (ntier > 1) {
+        hint = cc_alloc(1u << CUCKOO_HINT_POWER);
+        if (hint == NULL) {
+            log_crit("cuckoo size hint allocation failed");
+            exit(EX_CONFIG);
+        }
+        cc_memset(hint, 0, 1u << CUCKOO_HINT_POWER);
+    }
+
+    if (concurrent) {
+        stripe = cc_alloc(sizeof(*stripe) << CUCKOO_STRIPE_POWER);
+        if (stripe == NULL) {
+            log_crit("cuckoo stripe allocation failed");
+            exit(EX_CONFIG);
+        }
+        cc_memset(stripe, 0, sizeof(*stripe) << CUCKOO_STRIPE_POWER);
+        log_info("cuckoo table is shared by threads, %u stripes",
+                1u << CUCKOO_STRIPE_POWER);
+    }
+
     cc_create_itt_malloc(cuckoo_malloc);
     cc_create_itt_free(cuckoo_free);
 
@@ -310,6 +711,10 @@ cuckoo_teardown(void)
         log_warn("%s has never been setup", CUCKOO_MODULE_NAME);
     } else {
         datapool_close(pool);
+        cc_free(hint);
+        hint = NULL;
+        cc_free(stripe);
+        stripe = NULL;
     }
 
     cuckoo_metrics = NULL;
@@ -319,106 +724,348 @@ cuckoo_teardown(void)
 void
 cuckoo_reset(void) /* reset hash table */
 {
+    uint32_t i;
+
     log_info("reset the main hash table in cuckoo");
 
     if (!cuckoo_init || ds == NULL) {
         log_warn("hash table has never been initialized");
     } else {
+        /* in order, like writers lock the stripes of a key */
+        for (i = 0; stripe != NULL && i < 1u << CUCKOO_STRIPE_POWER; ++i) {
+            _stripe_lock(i);
+        }
         cc_memset(ds, 0, hash_size);
+        for (i = 0; i < ntier; ++i) {
+            tier[i].nused = 0;
+        }
+        for (i = 0; stripe != NULL && i < 1u << CUCKOO_STRIPE_POWER; ++i) {
+            _stripe_unlock(i);
+        }
     }
 }
 
-struct item *
-cuckoo_get(struct bstring *key)
+/* the tier of the item, found by address as there are only a few tiers */
+static struct cuckoo_tier *
+_item_tier(struct item *it)
 {
-    uint32_t offset[D];
+    uint32_t i;
+
+    for (i = ntier - 1; i > 0 && (void *)it < tier[i].ds; --i);
+
+    return &tier[i];
+}
+
+/* the smallest tier which fits an item, or NULL if none */
+static struct cuckoo_tier *
+_fit_tier(uint32_t nbyte)
+{
+    uint32_t i;
+
+    for (i = 0; i < ntier; ++i) {
+        if (nbyte <= tier[i].item_size) {
+            return &tier[i];
+        }
+    }
+
+    return NULL;
+}
+
+static struct item *
+_tier_get(struct cuckoo_tier *t, const uint32_t hv[], struct bstring *key)
+{
+    uint32_t bucket[D];
+    uint8_t tag = cuckoo_tag(hv);
     int i;
     struct item *it;
 
-    ASSERT(cuckoo_init == true && key != NULL);
+    INCR(cuckoo_metrics, cuckoo_probe);
 
-    INCR(cuckoo_metrics, cuckoo_get);
+    cuckoo_bucket(bucket, hv, t);
 
-    cuckoo_hash(offset, key);
+    if (prefetch) {
+        _prefetch_bucket(t, bucket[1]);
+    }
 
     for (i = 0; i < D; ++i) {
-        it = OFFSET2ITEM(offset[i]);
-        if (cuckoo_hit(it, key)) {
-        log_verb("found item at location: %p", it);
+        it = _bucket_get(t, bucket[i], tag, key);
+        if (it != NULL) {
             return it;
         }
     }
 
-    log_verb("item not found");
-
     return NULL;
 }
 
-/* insert applies to a key that doesn't exist validly in our array */
+static struct item *
+_get(const uint32_t hv[], struct bstring *key)
+{
+    uint32_t i, first = 0;
+    struct item *it;
+
+    /* the hinted tier first, then the others */
+    if (hint != NULL) {
+        first = hint[HINT(hv[1])];
+    }
+    it = _tier_get(&tier[first], hv, key);
+    for (i = 0; it == NULL && i < ntier; ++i) {
+        if (i != first) {
+            it = _tier_get(&tier[i], hv, key);
+        }
+    }
+
+    return it;
+}
+
 struct item *
-cuckoo_insert(struct bstring *key, struct val *val, proc_time_i expire)
+cuckoo_get(struct bstring *key)
 {
+    uint32_t hv[D];
     struct item *it;
-    uint32_t offset[D];
-    uint32_t displaced;
-    int i;
 
-    ASSERT(key != NULL && val != NULL);
+    ASSERT(cuckoo_init == true && key != NULL);
 
-    INCR(cuckoo_metrics, cuckoo_insert);
+    INCR(cuckoo_metrics, cuckoo_get);
 
-    if (key->len + vlen(val) + ITEM_OVERHEAD > item_size) {
-        log_warn("key value exceed chunk size %zu: key len %"PRIu32", vlen %"
-                PRIu32", item overhead %u", item_size, key->len, vlen(val),
-                ITEM_OVERHEAD);
-        INCR(cuckoo_metrics, cuckoo_insert_ex);
+    cuckoo_hash(hv, key);
+    it = _get(hv, key);
 
-        return NULL;
+    if (it != NULL) {
+        log_verb("found item at location: %p", it);
+    } else {
+        log_verb("item not found");
     }
 
-    cuckoo_hash(offset, key);
+    return it;
+}
 
-    for (i = 0; i < D; ++i) {
-        it = OFFSET2ITEM(offset[i]);
-        if (item_valid(it)) {
-            continue;
+/* the stripes of the candidate buckets of a key in all tiers, sorted */
+static uint32_t
+_key_stripes(uint32_t s[], const uint32_t hv[])
+{
+    uint32_t bucket[D];
+    uint32_t i, j, k, l, n = 0, x;
+
+    for (i = 0; i < ntier; ++i) {
+        cuckoo_bucket(bucket, hv, &tier[i]);
+        for (j = 0; j < D; ++j) {
+            x = STRIPE(&tier[i], bucket[j]);
+            for (k = 0; k < n && s[k] < x; ++k);
+            if (k < n && s[k] == x) {
+                continue;
+            }
+            for (l = n; l > k; --l) {
+                s[l] = s[l - 1];
+            }
+            s[k] = x;
+            n++;
+        }
+    }
+
+    return n;
+}
+
+struct item *
+cuckoo_read(struct bstring *key, void *buf)
+{
+    uint32_t hv[D], s[CUCKOO_KEY_STRIPE], v[CUCKOO_KEY_STRIPE];
+    uint32_t i, n;
+    struct item *it;
+
+    if (stripe == NULL) {
+        return cuckoo_get(key);
+    }
+
+    ASSERT(cuckoo_init == true && key != NULL && buf != NULL);
+
+    INCR(cuckoo_metrics, cuckoo_get);
+
+    cuckoo_hash(hv, key);
+    n = _key_stripes(s, hv);
+
+    for (;;) {
+        for (i = 0; i < n; ++i) {
+            v[i] = _stripe_begin(s[i]);
         }
-        if (item_expired(it)) {
-            INCR(cuckoo_metrics, item_expire);
-            ITEM_METRICS_DECR(it);
+
+        it = _get(hv, key);
+        if (it != NULL) {
+            cc_memcpy(buf, it, _item_tier(it)->item_size);
         }
 
-        log_verb("inserting into location: %p", it);
+        /* the copy is only good if no writer got to any stripe meanwhile */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        for (i = 0; i < n && __atomic_load_n(&stripe[s[i]], __ATOMIC_RELAXED)
+                == v[i]; ++i);
+        if (i == n) {
+            break;
+        }
 
-        break;
+        INCR(cuckoo_metrics, cuckoo_read_retry);
     }
 
-    if (D == i) {
-        displaced = _select_candidate(offset);
-        it = OFFSET2ITEM(displaced); /* we are writing into this item */
-        cuckoo_displace(displaced);
+    if (it != NULL) {
+        log_verb("copied item at location %p", it);
+    } else {
+        log_verb("item not found");
     }
 
+    return it == NULL ? NULL : buf;
+}
+
+size_t
+cuckoo_read_size(void)
+{
+    return stripe == NULL ? 0 : tier[ntier - 1].item_size;
+}
+
+void
+cuckoo_lock(struct bstring *key)
+{
+    uint32_t hv[D];
+    uint32_t i;
+
+    if (stripe == NULL) {
+        return;
+    }
+
+    ASSERT(nheld == 0);
+
+    cuckoo_hash(hv, key);
+    nheld = _key_stripes(held, hv);
+    for (i = 0; i < nheld; ++i) {
+        _stripe_lock(held[i]);
+    }
+}
+
+void
+cuckoo_unlock(void)
+{
+    for (; nheld > 0; --nheld) {
+        _stripe_unlock(held[nheld - 1]);
+    }
+}
+
+/* clear the slot of an item that is deleted or moved to another tier */
+static void
+_item_remove(struct item *it)
+{
+    struct cuckoo_tier *t = _item_tier(it);
+
+    ITEM_METRICS_DECR(it);
+    item_delete(it);
+    _tag_set(t, ITEM2OFFSET(t, it), 0);
+    cc_itt_free(cuckoo_free, it);
+}
+
+static struct item *
+_tier_insert(struct cuckoo_tier *t, struct bstring *key, struct val *val,
+        proc_time_i expire)
+{
+    struct item *it;
+    uint32_t hv[D], bucket[D];
+    uint32_t slot = UINT32_MAX;
+    int i;
+
+    cuckoo_hash(hv, key);
+    cuckoo_bucket(bucket, hv, t);
+
+    if (prefetch) {
+        _prefetch_bucket(t, bucket[1]);
+    }
+
+    for (i = 0; i < D && slot == UINT32_MAX; ++i) {
+        slot = _bucket_find_free(t, bucket[i]);
+    }
+
+    if (slot != UINT32_MAX) {
+        _slot_reclaim(t, slot);
+    } else if (t->nused < t->max_nused) {
+        /*
+         * a path is rarely found once the table is this full, while
+         * looking for one costs a hash per slot visited
+         */
+        slot = cuckoo_displace(t, bucket);
+    }
+
+    if (slot == UINT32_MAX) {
+        log_verb("one item evicted during replacement");
+
+        slot = _select_candidate(t, bucket);
+        INCR(cuckoo_metrics, item_evict);
+        ITEM_METRICS_DECR(OFFSET2ITEM(t, slot));
+    }
+
+    it = OFFSET2ITEM(t, slot); /* we are writing into this item */
+    log_verb("inserting into location: %p", it);
+
     item_set(it, key, val, expire);
+    _tag_set(t, slot, cuckoo_tag(hv));
+    if (hint != NULL) {
+        hint[HINT(hv[1])] = (uint8_t)(t - tier);
+    }
     INCR(cuckoo_metrics, item_insert);
     ITEM_METRICS_INCR(it);
-    cc_itt_alloc(cuckoo_malloc, it, item_size);
+    cc_itt_alloc(cuckoo_malloc, it, t->item_size);
 
     return it;
 }
 
+/* insert applies to a key that doesn't exist validly in our array */
+struct item *
+cuckoo_insert(struct bstring *key, struct val *val, proc_time_i expire)
+{
+    struct cuckoo_tier *t;
+
+    ASSERT(key != NULL && val != NULL);
+
+    INCR(cuckoo_metrics, cuckoo_insert);
+
+    t = _fit_tier(key->len + vlen(val) + ITEM_OVERHEAD);
+    if (t == NULL) {
+        log_warn("key value exceed chunk size %zu: key len %"PRIu32", vlen %"
+                PRIu32", item overhead %u", tier[ntier - 1].item_size,
+                key->len, vlen(val), ITEM_OVERHEAD);
+        INCR(cuckoo_metrics, cuckoo_insert_ex);
+
+        return NULL;
+    }
+
+    return _tier_insert(t, key, val, expire);
+}
+
 rstatus_i
 cuckoo_update(struct item *it, struct val *val, proc_time_i expire)
 {
+    struct cuckoo_tier *t, *nt;
+    struct bstring key;
+    uint32_t nbyte;
+
     ASSERT(it != NULL && val != NULL);
 
     INCR(cuckoo_metrics, cuckoo_update);
 
-    if (item_klen(it) + vlen(val) + ITEM_OVERHEAD > item_size) {
-        log_warn("key value exceed chunk size");
-        INCR(cuckoo_metrics, cuckoo_update_ex);
+    t = _item_tier(it);
+    nbyte = item_klen(it) + vlen(val) + ITEM_OVERHEAD;
+    if (nbyte > t->item_size) {
+        /* move the item to a tier that fits */
+        nt = _fit_tier(nbyte);
+        if (nt == NULL) {
+            log_warn("key value exceed chunk size");
+            INCR(cuckoo_metrics, cuckoo_update_ex);
 
-        return CC_ERROR;
+            return CC_ERROR;
+        }
+
+        log_verb("moving item at %p to tier of item size %zu", it,
+                nt->item_size);
+
+        /* the key is read from the old item, which is in another tier */
+        item_key(&key, it);
+        _tier_insert(nt, &key, val, expire);
+        _item_remove(it);
+
+        return CC_OK;
     }
 
     DECR_N(cuckoo_metrics, item_val_curr, item_vlen(it));
@@ -443,10 +1090,8 @@ cuckoo_delete(struct bstring *key)
 
     if (it != NULL) {
         INCR(cuckoo_metrics, item_delete);
-        ITEM_METRICS_DECR(it);
-        item_delete(it);
         log_verb("deleting item at location %p", it);
-        cc_itt_free(cuckoo_free, it);
+        _item_remove(it);
 
         return true;
     } else {
@@ -11,27 +11,33 @@
 #define CUCKOO_POLICY_RANDOM 1
 #define CUCKOO_POLICY_EXPIRE 2
 
-#define CUCKOO_DISPLACE 2
+#define CUCKOO_DISPLACE 4
 #define CUCKOO_ITEM_CAS true
 #define CUCKOO_ITEM_SIZE 64
 #define CUCKOO_NITEM 1024
+#define CUCKOO_TIERS NULL
 #define CUCKOO_POLICY CUCKOO_POLICY_RANDOM
 #define CUCKOO_MAX_TTL (30 * 24 * 60 * 60) /* 30 days */
 #define CUCKOO_DATAPOOL NULL
 #define CUCKOO_DATAPOOL_NAME "cuckoo_datapool"
 #define CUCKOO_PREFAULT false
+#define CUCKOO_PREFETCH true
+#define CUCKOO_CONCURRENT false
 
 /*          name                      type                default                  description */
 #define CUCKOO_OPTION(ACTION)                                                                          \
     ACTION( cuckoo_displace,          OPTION_TYPE_UINT,   CUCKOO_DISPLACE,         "# displaces allowed"   )\
+    ACTION( cuckoo_prefetch,          OPTION_TYPE_BOOL,   CUCKOO_PREFETCH,         "prefetch 2nd bucket"   )\
     ACTION( cuckoo_item_cas,          OPTION_TYPE_BOOL,   CUCKOO_ITEM_CAS,         "support cas in items"  )\
     ACTION( cuckoo_item_size,         OPTION_TYPE_UINT,   CUCKOO_ITEM_SIZE,        "item size (inclusive)" )\
     ACTION( cuckoo_nitem,             OPTION_TYPE_UINT,   CUCKOO_NITEM,            "# items allocated"     )\
+    ACTION( cuckoo_tiers,             OPTION_TYPE_STR,    CUCKOO_TIERS,            "item size:nitem tiers" )\
     ACTION( cuckoo_policy,            OPTION_TYPE_UINT,   CUCKOO_POLICY,           "evict policy"          )\
     ACTION( cuckoo_max_ttl,           OPTION_TYPE_UINT,   CUCKOO_MAX_TTL,          "max ttl in seconds"    )\
     ACTION( cuckoo_datapool,          OPTION_TYPE_STR,    CUCKOO_DATAPOOL,         "path to data pool"     )\
     ACTION( cuckoo_datapool_name,     OPTION_TYPE_STR,    CUCKOO_DATAPOOL_NAME,    "cuckoo datapool name"  )\
-    ACTION( cuckoo_datapool_prefault, OPTION_TYPE_BOOL,   CUCKOO_PREFAULT,         "prefault data pool"    )
+    ACTION( cuckoo_datapool_prefault, OPTION_TYPE_BOOL,   CUCKOO_PREFAULT,         "prefault data pool"    )\
+    ACTION( cuckoo_concurrent,        OPTION_TYPE_BOOL,   CUCKOO_CONCURRENT,       "shared by threads"     )
 
 
 typedef struct {
@@ -41,9 +47,12 @@ typedef struct {
 /*          name            type            description */
 #define CUCKOO_METRIC(ACTION)                                           \
     ACTION( cuckoo_get,         METRIC_COUNTER, "# cuckoo lookups"     )\
+    ACTION( cuckoo_probe,       METRIC_COUNTER, "# tiers looked up"    )\
     ACTION( cuckoo_insert,      METRIC_COUNTER, "# cuckoo inserts"     )\
     ACTION( cuckoo_insert_ex,   METRIC_COUNTER, "# insert errors"      )\
     ACTION( cuckoo_displace,    METRIC_COUNTER, "# displacements"      )\
+    ACTION( cuckoo_displace_ex, METRIC_COUNTER, "# displaces contended")\
+    ACTION( cuckoo_read_retry,  METRIC_COUNTER, "# reads retried"      )\
     ACTION( cuckoo_update,      METRIC_COUNTER, "# cuckoo updates"     )\
     ACTION( cuckoo_update_ex,   METRIC_COUNTER, "# update errors"      )\
     ACTION( cuckoo_delete,      METRIC_COUNTER, "# cuckoo deletes"     )\
@@ -72,3 +81,16 @@ struct item * cuckoo_get(struct bstring *key);
 struct item * cuckoo_insert(struct bstring *key, struct val *val, proc_time_i expire);
 rstatus_i cuckoo_update(struct item *it, struct val *val, proc_time_i expire);
 bool cuckoo_delete(struct bstring *key);
+
+/*
+ * With cuckoo_concurrent, the table is shared by threads. A thread which
+ * changes a key locks it first, and holds the lock from looking up the item
+ * until it is done with it; it may only change the key it holds. Keys which
+ * are not locked are read with cuckoo_read, which copies the item into buf of
+ * (at least) cuckoo_read_size() bytes. Without cuckoo_concurrent, locking does
+ * nothing, cuckoo_read_size() is 0 and cuckoo_read returns the item in place.
+ */
+void cuckoo_lock(struct bstring *key);
+void cuckoo_unlock(void);
+struct item * cuckoo_read(struct bstring *key, void *buf);
+size_t cuckoo_read_size(void);
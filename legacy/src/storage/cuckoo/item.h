@@ -218,8 +218,9 @@ static inline void
 item_value_update(struct item *it, struct val *val)
 {
     if (cas_enabled) {
-        cas_val++;
-        *(uint64_t *)ITEM_CAS_POS(it) = cas_val;
+        /* items of different keys may be updated by threads at once */
+        *(uint64_t *)ITEM_CAS_POS(it) = __atomic_add_fetch(&cas_val, 1,
+                __ATOMIC_RELAXED);
     }
 
     if (val->type == VAL_TYPE_INT) {
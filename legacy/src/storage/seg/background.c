@@ -2,19 +2,30 @@
 #include "background.h"
 #include "item.h"
 #include "seg.h"
+#include "segpersist.h"
 #include "ttlbucket.h"
 
 #include "cc_debug.h"
 #include "time/cc_wheel.h"
 
 #include <pthread.h>
+#include <sched.h>
 #include <sysexits.h>
 #include <time.h>
+#include <unistd.h>
 
-extern volatile bool        stop;
-extern volatile proc_time_i flush_at;
-extern pthread_t            bg_tid;
-extern struct ttl_bucket    ttl_buckets[MAX_N_TTL_BUCKET];
+/* expired segs are removed every EXPIRE_INTVL_US, the free pool is topped up
+ * every EVICT_INTVL_US, at most EVICT_BATCH segs at a time */
+#define EXPIRE_INTVL_US 200000
+#define EVICT_INTVL_US  1000
+#define EVICT_BATCH     8
+
+extern volatile bool          stop;
+extern volatile proc_time_i   flush_at;
+extern pthread_t              bg_tid;
+extern struct ttl_bucket      ttl_buckets[MAX_N_TTL_BUCKET];
+extern struct seg_evict_info  evict_info;
+extern seg_metrics_st         *seg_metrics;
 
 
 static void
@@ -40,9 +51,12 @@ check_seg_expire(void)
 
             next_seg_id = seg->next_seg_id;
 
-            status = expire_seg(seg_id);
-            if (status != CC_OK) {
-                log_error("error removing expired seg %d", seg_id);
+            /* a local seg is expired once its thread moves on from it */
+            if (!seg->local) {
+                status = expire_seg(seg_id);
+                if (status != CC_OK) {
+                    log_error("error removing expired seg %d", seg_id);
+                }
             }
 
             if (next_seg_id == -1) {
@@ -55,6 +69,51 @@ check_seg_expire(void)
     }
 }
 
+static inline bool
+free_seg_below_target(void)
+{
+    return __atomic_load_n(&heap.n_free_seg, __ATOMIC_RELAXED) <
+        heap.n_reserved_seg + heap.n_bg_free_seg;
+}
+
+/**
+ * evict segs ahead of demand and return them to the free pool, so that
+ * worker threads can get a free seg without evicting one themselves
+ *
+ * only a few segs are evicted each time, and the thread yields after each
+ * one, so that workers are not kept waiting on the ttl bucket and heap locks
+ *
+ * return false if no seg could be evicted
+ */
+static bool
+evict_ahead(void)
+{
+    evict_rstatus_e status;
+    int32_t         seg_id;
+
+    for (int i = 0; i < EVICT_BATCH && !stop && free_seg_below_target(); i++) {
+        if (evict_info.policy == EVICT_MERGE_FIFO) {
+            status = seg_merge_evict(&seg_id);
+        } else {
+            status = seg_evict(&seg_id);
+        }
+
+        if (status != EVICT_OK) {
+            return false;
+        }
+
+        pthread_mutex_lock(&heap.mtx);
+        seg_add_to_freepool(seg_id, SEG_EVICTION);
+        pthread_mutex_unlock(&heap.mtx);
+
+        INCR(seg_metrics, seg_bg_evict);
+
+        sched_yield();
+    }
+
+    return true;
+}
+
 static void *
 background_main(void *data)
 {
@@ -66,13 +125,31 @@ background_main(void *data)
 
     log_info("Segcache background thread started");
 
+    int n_tick = EXPIRE_INTVL_US / EVICT_INTVL_US;
+    int tick   = 0;
+
     while (!stop) {
-        check_seg_expire();
+        if (heap.n_bg_free_seg == 0) {
+            check_seg_expire();
+            seg_persist_sealed();
+            usleep(EXPIRE_INTVL_US);
+            continue;
+        }
+
+        if (tick == 0) {
+            check_seg_expire();
+            seg_persist_sealed();
+        }
+        tick = (tick + 1) % n_tick;
 
-        // do we want to enable background eviction?
-        // merge_based_eviction();
+        if (!evict_ahead()) {
+            /* nothing is evictable yet, try again after the next expiration */
+            tick = 0;
+            usleep(EXPIRE_INTVL_US);
+            continue;
+        }
 
-        usleep(200000);
+        usleep(EVICT_INTVL_US);
     }
 
     log_info("seg background thread stopped");
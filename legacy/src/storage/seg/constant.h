@@ -50,5 +50,3 @@
 /* use some PMEM specific functions */
 //#define USE_PMEM
 
-//#define USE_THREAD_LOCAL_SEG    1
-
@@ -3,6 +3,7 @@
 #include "hashtable.h"
 #include "item.h"
 #include "seg.h"
+#include "segpersist.h"
 
 #include <cc_mm.h>
 #define XXH_INLINE_ALL
@@ -41,6 +42,9 @@ extern int n_thread;
 #define SEG_ID_BIT_SHIFT        20ul
 #define OFFSET_UNIT_IN_BIT      3ul     /* offset is in 8-byte unit */
 
+/* one in FREQ_SAMPLE_RATE reads updates the frequency of the item */
+#define FREQ_SAMPLE_RATE        8u
+
 /* this bit indicates whether the frequency has increased in the current sec */
 #define FREQ_INC_INDICATOR_MASK  0x0008000000000000ul
 #define CLEAR_FREQ_SMOOTH_MASK   0xfff7fffffffffffful
@@ -112,7 +116,7 @@ static __thread __uint128_t g_lehmer64_state       = 1;
         __ATOMIC_RELEASE, __ATOMIC_RELAXED                                     \
     )
 
-#define use_atomic_set
+#define use_seqlock
 /* we assume little-endian here */
 #define lock(bucket_ptr)                                                       \
     do {                                                                       \
@@ -160,6 +164,39 @@ static __thread __uint128_t g_lehmer64_state       = 1;
     } while (0)
 #endif
 
+#ifdef use_seqlock
+#undef lock
+#undef unlock
+#undef unlock_and_update_cas
+/* the lock byte is also the version of a seqlock, it is odd while a writer
+ * holds the lock, and is bumped to the next even number when the lock is
+ * released, so that readers can scan a bucket without taking the lock */
+#define VERSION_PTR(bucket_ptr) ((uint8_t *)(bucket_ptr) + 7)
+
+#define lock(bucket_ptr)                                                        \
+    do {                                                                        \
+        uint8_t v = __atomic_load_n(VERSION_PTR(bucket_ptr), __ATOMIC_RELAXED); \
+        while ((v & 1u) || !__atomic_compare_exchange_n(                        \
+            VERSION_PTR(bucket_ptr), &v, v + 1, true,                           \
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {                              \
+            v = __atomic_load_n(VERSION_PTR(bucket_ptr), __ATOMIC_RELAXED);     \
+        }                                                                       \
+        /* readers must not see the bucket change before the version does */   \
+        __atomic_thread_fence(__ATOMIC_RELEASE);                                \
+    } while (0)
+
+#define unlock(bucket_ptr)                                                      \
+    do {                                                                        \
+        __atomic_fetch_add(VERSION_PTR(bucket_ptr), 1, __ATOMIC_RELEASE);       \
+    } while (0)
+
+#define unlock_and_update_cas(bucket_ptr)                                       \
+    do {                                                                        \
+        *bucket_ptr += 1;                                                       \
+        __atomic_fetch_add(VERSION_PTR(bucket_ptr), 1, __ATOMIC_RELEASE);       \
+    } while (0)
+#endif
+
 #ifdef no_lock
 #undef lock
 #undef unlock
@@ -169,6 +206,31 @@ static __thread __uint128_t g_lehmer64_state       = 1;
 #define unlock_and_update_cas(bucket_ptr) ((*(bucket_ptr)) += 1)
 #endif
 
+/* wait for the writer holding the lock, and return the version of the
+ * bucket at the start of a read */
+static inline uint8_t
+_read_begin(uint64_t *bucket_ptr)
+{
+    uint8_t ver;
+
+    while ((ver = __atomic_load_n(((uint8_t *)(bucket_ptr) + 7),
+                __ATOMIC_ACQUIRE)) & 1u) {
+        ;
+    }
+
+    return ver;
+}
+
+/* whether a writer has held the lock of the bucket since the read began */
+static inline bool
+_read_retry(uint64_t *bucket_ptr, uint8_t ver)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(((uint8_t *)(bucket_ptr) + 7), __ATOMIC_RELAXED)
+        != ver;
+}
+
 /**
  * this is placed here because it is called within bucket lock and it
  * needs to parse item_info
@@ -212,8 +274,10 @@ _item_free(uint64_t item_info, bool mark_tombstone)
 //    if (mark_tombstone) {
 //        it->deleted = true;
 //    }
-    /* let's always mark the tombstone */
+    /* let's always mark the tombstone, it is persisted so that deleted
+     * items are not recovered */
     it->deleted = true;
+    seg_persist(it, ITEM_HDR_SIZE);
 }
 
 static inline bool
@@ -574,28 +638,32 @@ hashtable_evict(const char *oit_key, const uint32_t oit_klen,
 }
 
 
-#ifdef STORE_FREQ_IN_HASHTABLE
-struct item *
-hashtable_get(const char *key, const uint32_t klen,
-              int32_t *seg_id,
-              uint64_t *cas)
+/* lookup of a key whose hash value is already calculated */
+static struct item *
+_get(const char *key, const uint32_t klen, const uint64_t hv,
+     int32_t *seg_id, uint64_t *cas)
 {
     INCR(seg_metrics, hash_lookup);
 
-    uint64_t    hv         = CAL_HV(key, klen);
     uint64_t    tag        = CAL_TAG_FROM_HV(hv);
     uint64_t    *first_bkt = GET_BUCKET(hv);
-    uint64_t    *bkt       = first_bkt;
-    uint64_t    offset;
+    uint64_t    *bkt;
+    uint64_t    bkt_info;
+    uint8_t     ver;
     struct item *it;
 
     uint64_t item_info;
 
-    int bkt_chain_len = GET_BUCKET_CHAIN_LEN(first_bkt) - 1;
+    int bkt_chain_len;
     int n_item_slot;
 
+#ifdef STORE_FREQ_IN_HASHTABLE
+    /* only a sample of reads update the frequency, the rest of the reads
+     * do not write to the bucket */
+    bool update_freq = (prand() >> 56u) % FREQ_SAMPLE_RATE == 0;
+
     uint64_t curr_ts = ((uint64_t) time_proc_sec()) & PROC_TS_MASK;
-    if (curr_ts != GET_TS(first_bkt)) {
+    if (update_freq && curr_ts != GET_TS(first_bkt)) {
         /* clear the indicator of all items in the bucket that
          * the frequency has increased in curr sec */
         lock(first_bkt);
@@ -603,6 +671,8 @@ hashtable_get(const char *key, const uint32_t klen,
         if (curr_ts != GET_TS(first_bkt)) {
             /* update ts */
             *first_bkt = ((*first_bkt) & (~TS_MASK)) | (curr_ts << TS_BIT_SHIFT);
+            bkt           = first_bkt;
+            bkt_chain_len = GET_BUCKET_CHAIN_LEN(first_bkt) - 1;
             do {
                 n_item_slot = bkt_chain_len > 0 ?
                               N_SLOT_PER_BUCKET - 1 :
@@ -620,13 +690,18 @@ hashtable_get(const char *key, const uint32_t klen,
         }
 
         unlock(first_bkt);
-
-        /* reset bucket and bucket chain length */
-        bkt           = first_bkt;
-        bkt_chain_len = GET_BUCKET_CHAIN_LEN(first_bkt) - 1;
     }
+#endif
+
+retry:
+    /* the bucket is scanned without the lock, if a writer has held the lock
+     * in the meantime, the scan is retried */
+    ver      = _read_begin(first_bkt);
+    bkt_info = __atomic_load_n(first_bkt, __ATOMIC_RELAXED);
+    bkt      = first_bkt;
+
+    bkt_chain_len = GET_BUCKET_CHAIN_LEN(&bkt_info) - 1;
 
-    lock(first_bkt);
     /* try to find the item in the hash table */
     do {
         n_item_slot = bkt_chain_len > 0 ?
@@ -647,21 +722,19 @@ hashtable_get(const char *key, const uint32_t klen,
                 INCR(seg_metrics, hash_tag_collision);
                 continue;
             }
-            if (cas) {
-                *cas = GET_CAS(first_bkt);
-            }
-
-#if defined DEBUG_MODE
-            *seg_id = GET_SEG_ID_NON_DECR(item_info);
-            ASSERT(heap.segs[GET_SEG_ID(item_info)].seg_id_non_decr == *seg_id);
-#else
-            *seg_id = GET_SEG_ID(item_info);
-#endif
 
             struct seg *seg = &heap.segs[GET_SEG_ID(item_info)];
             int ref_cnt = __atomic_add_fetch(&seg->r_refcount, 1, __ATOMIC_RELAXED);
             ASSERT(ref_cnt <= n_thread);
 
+            if (_read_retry(first_bkt, ver)) {
+                /* the bucket has changed since the scan started */
+                __atomic_sub_fetch(&seg->r_refcount, 1, __ATOMIC_RELAXED);
+
+                INCR(seg_metrics, hash_lookup_retry);
+                goto retry;
+            }
+
             if (!seg_is_accessible(GET_SEG_ID(item_info)) ||
                     __atomic_load_n(&bkt[i], __ATOMIC_RELAXED) != item_info) {
                 /* not accessible: it will be removed by other threads,
@@ -669,16 +742,27 @@ hashtable_get(const char *key, const uint32_t klen,
 
                 __atomic_sub_fetch(&seg->r_refcount, 1, __ATOMIC_RELAXED);
 
-                unlock(first_bkt);
                 return NULL;
             }
 
-            offset = GET_OFFSET(item_info);
-            it = (struct item *) (heap.base + heap.seg_size * GET_SEG_ID(item_info) + offset);
+            if (cas) {
+                *cas = GET_CAS(&bkt_info);
+            }
 
+#if defined DEBUG_MODE
+            *seg_id = GET_SEG_ID_NON_DECR(item_info);
+            ASSERT(heap.segs[GET_SEG_ID(item_info)].seg_id_non_decr == *seg_id);
+#else
+            *seg_id = GET_SEG_ID(item_info);
+#endif
+
+            it = (struct item *) (heap.base + heap.seg_size *
+                        GET_SEG_ID(item_info) + GET_OFFSET(item_info));
+
+#ifdef STORE_FREQ_IN_HASHTABLE
             /* item found, try to update the frequency */
             uint64_t freq = GET_FREQ(item_info);
-            if (freq < 127) {
+            if (update_freq && freq < 127) {
                 /* counter caps at 127 */
                 if (freq <= 16 || prand() % freq == 0) {
                     /* increase frequency by 1
@@ -695,104 +779,71 @@ hashtable_get(const char *key, const uint32_t klen,
                 /* we can also use atomics here, but it comes with caveat,
                  * if we use atomic, then we cannot use compare_exchange in
                  * other func because the compare will fail due to freq incr */
-//                lock(first_bkt);
                 __atomic_compare_exchange_n(&bkt[i], &item_info, new_val, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
-//                unlock(first_bkt);
-
             }
             /* done frequency update section */
+#endif
 
-            unlock(first_bkt);
             return it;
         }
         bkt_chain_len -= 1;
-        bkt        = (uint64_t *) (bkt[N_SLOT_PER_BUCKET - 1]);
+        bkt        = (uint64_t *) __atomic_load_n(
+            &bkt[N_SLOT_PER_BUCKET - 1], __ATOMIC_RELAXED);
     } while (bkt_chain_len >= 0);
 
-    unlock(first_bkt);
+    if (_read_retry(first_bkt, ver)) {
+        INCR(seg_metrics, hash_lookup_retry);
+        goto retry;
+    }
+
     return NULL;
 }
-#else
+
 struct item *
 hashtable_get(const char *key, const uint32_t klen,
               int32_t *seg_id,
               uint64_t *cas)
 {
-    INCR(seg_metrics, hash_lookup);
-
-    uint64_t    hv         = CAL_HV(key, klen);
-    uint64_t    tag        = CAL_TAG_FROM_HV(hv);
-    uint64_t    *first_bkt = GET_BUCKET(hv);
-    uint64_t    *bkt       = first_bkt;
-    struct item *it;
-    int i;
-
-    uint64_t item_info;
-    lock(first_bkt);
-
-    int bkt_chain_len = GET_BUCKET_CHAIN_LEN(first_bkt) - 1;
-    int n_item_slot;
-
-    /* try to find the item in the hash table */
-    do {
-        n_item_slot = bkt_chain_len > 0 ?
-                      N_SLOT_PER_BUCKET - 1 :
-                      N_SLOT_PER_BUCKET;
-
-        for (i = 0; i < n_item_slot; i++) {
-            if (bkt == first_bkt && i == 0) {
-                continue;
-            }
-
-            item_info = bkt[i];
-            if (GET_TAG(item_info) != tag) {
-                continue;
-            }
-            /* a potential hit */
-            if (!_same_item(key, klen, item_info)) {
-                INCR(seg_metrics, hash_tag_collision);
-                continue;
-            }
-            if (cas) {
-                *cas = GET_CAS(first_bkt);
-            }
-
-#if defined DEBUG_MODE
-            *seg_id = GET_SEG_ID_NON_DECR(item_info);
-            ASSERT(heap.segs[GET_SEG_ID(item_info)].seg_id_non_decr == *seg_id);
-#else
-            *seg_id = GET_SEG_ID(item_info);
-#endif
+    return _get(key, klen, CAL_HV(key, klen), seg_id, cas);
+}
 
-            struct seg *seg = &heap.segs[GET_SEG_ID(item_info)];
-            int ref_cnt = __atomic_add_fetch(&seg->r_refcount, 1, __ATOMIC_RELAXED);
-            ASSERT(ref_cnt <= n_thread);
+void
+hashtable_get_multi(struct item **its, int32_t *seg_ids, uint64_t *cas,
+                    const struct bstring *keys, const uint32_t nkey)
+{
+    uint64_t hv[HASHTABLE_GET_MULTI_MAX];
+    uint64_t *bkt, item_info, tag;
+    uint32_t i;
 
-            if (!seg_is_accessible(GET_SEG_ID(item_info)) ||
-                __atomic_load_n(&bkt[i], __ATOMIC_RELAXED) != item_info) {
-                /* not accessible: it will be removed by other threads,
-                 * item_info change: updated/deleted/accessed by other thread */
+    ASSERT(nkey <= HASHTABLE_GET_MULTI_MAX);
 
-                __atomic_sub_fetch(&seg->r_refcount, 1, __ATOMIC_RELAXED);
+    /* hash all the keys first, so their buckets are fetched in parallel */
+    for (i = 0; i < nkey; i++) {
+        hv[i] = CAL_HV(keys[i].data, keys[i].len);
+        __builtin_prefetch(GET_BUCKET(hv[i]), 0);
+    }
 
-                unlock(first_bkt);
-                return NULL;
+    /* then fetch the headers (and keys) of the items the tags point to in
+     * the head buckets, which are compared against the keys in the lookups;
+     * the last slot may point to the next bucket instead, and is skipped */
+    for (i = 0; i < nkey; i++) {
+        bkt = GET_BUCKET(hv[i]);
+        tag = CAL_TAG_FROM_HV(hv[i]);
+        for (int j = 1; j < N_SLOT_PER_BUCKET - 1; j++) {
+            item_info = __atomic_load_n(&bkt[j], __ATOMIC_RELAXED);
+            if (GET_TAG(item_info) == tag) {
+                __builtin_prefetch(heap.base + heap.seg_size *
+                        GET_SEG_ID(item_info) + GET_OFFSET(item_info), 0);
+                break;
             }
-
-            it = (struct item *) (heap.base + heap.seg_size *
-                        GET_SEG_ID(item_info) + GET_OFFSET(item_info));
-
-            unlock(first_bkt);
-            return it;
         }
-        bkt_chain_len -= 1;
-        bkt        = (uint64_t *) (bkt[N_SLOT_PER_BUCKET - 1]);
-    } while (bkt_chain_len >= 0);
+    }
 
-    unlock(first_bkt);
-    return NULL;
+    for (i = 0; i < nkey; i++) {
+        its[i] = _get(keys[i].data, keys[i].len, hv[i], &seg_ids[i],
+                cas == NULL ? NULL : &cas[i]);
+    }
 }
-#endif
 
 
 /**
@@ -853,6 +904,12 @@ hashtable_get_no_freq_incr(const char *key, const uint32_t klen,
     return NULL;
 }
 
+void
+hashtable_prefetch(const char *key, const uint32_t klen)
+{
+    __builtin_prefetch(GET_BUCKET(CAL_HV(key, klen)), 1);
+}
+
 /**
  * get item frequency
  *
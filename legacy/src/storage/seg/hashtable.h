@@ -160,6 +160,14 @@ struct item *
 hashtable_get(const char *key, uint32_t klen, int32_t *seg_id,
         uint64_t *cas);
 
+#define HASHTABLE_GET_MULTI_MAX 16
+
+/* look up nkey keys, up to HASHTABLE_GET_MULTI_MAX of them, in one batch, so
+ * the memory accesses of the lookups overlap; cas may be NULL */
+void
+hashtable_get_multi(struct item **its, int32_t *seg_ids, uint64_t *cas,
+        const struct bstring *keys, uint32_t nkey);
+
 
 bool
 hashtable_relink_it(const char *oit_key, uint32_t oit_klen,
@@ -185,6 +193,10 @@ void
 hashtable_stat(int *item_cnt_ptr, int *bucket_cnt_ptr);
 
 
+/* prefetch the head bucket of the key, ahead of a lookup or an update */
+void
+hashtable_prefetch(const char *key, uint32_t klen);
+
 int hashtable_get_it_freq(const char *oit_key, uint32_t oit_klen,
                           uint64_t old_seg_id, uint64_t old_offset);
 
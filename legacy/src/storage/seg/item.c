@@ -1,6 +1,7 @@
 #include "item.h"
 #include "hashtable.h"
 #include "seg.h"
+#include "segpersist.h"
 #include "ttlbucket.h"
 
 #include <cc_debug.h>
@@ -205,6 +206,43 @@ item_get(const struct bstring *key, uint64_t *cas)
     return it;
 }
 
+void
+item_get_multi(struct item **its, uint64_t *cas, const struct bstring *keys,
+        uint32_t nkey)
+{
+    int32_t seg_ids[HASHTABLE_GET_MULTI_MAX];
+    uint32_t i, n;
+
+    for (; nkey > 0; its += n, keys += n, nkey -= n) {
+        n = MIN(nkey, HASHTABLE_GET_MULTI_MAX);
+        hashtable_get_multi(its, seg_ids, cas, keys, n);
+        if (cas != NULL) {
+            cas += n;
+        }
+
+        for (i = 0; i < n; i++) {
+            if (its[i] == NULL) {
+                log_vverb("get it '%.*s' not found", keys[i].len, keys[i].data);
+                continue;
+            }
+
+#if defined DEBUG_MODE
+            ASSERT(seg_ids[i] ==
+                heap.segs[seg_ids[i] % heap.max_nseg].seg_id_non_decr);
+#endif
+#if defined CC_ASSERT_PANIC || defined CC_ASSERT_LOG
+            ASSERT(its[i]->magic == ITEM_MAGIC);
+#endif
+
+#ifndef STORE_FREQ_IN_HASHTABLE
+            _item_freq_incr(its[i]);
+#endif
+
+            log_vverb("get it key %.*s", keys[i].len, keys[i].data);
+        }
+    }
+}
+
 void
 item_release(struct item *it)
 {
@@ -329,6 +367,7 @@ item_incr(uint64_t *vint, struct item *it, uint64_t delta)
     }
 
     *(uint64_t *)item_val(it) = *vint;
+    seg_persist(it, item_ntotal(it));
     return ITEM_OK;
 }
 
@@ -352,6 +391,7 @@ item_decr(uint64_t *vint, struct item *it, uint64_t delta)
         }
     }
     *(uint64_t *)item_val(it) = *vint;
+    seg_persist(it, item_ntotal(it));
     return ITEM_OK;
 }
 
@@ -368,5 +408,6 @@ item_flush(void)
 {
     time_update();
     flush_at = time_proc_sec();
+    seg_persist_flush();
     log_info("all keys flushed at %" PRIu32, flush_at);
 }
@@ -203,6 +203,12 @@ item_release(struct item *it);
 struct item *
 item_get(const struct bstring *key, uint64_t *cas);
 
+/* acquire the items of nkey keys, NULL for those not found, looking them up
+ * in batches so their memory accesses overlap; cas may be NULL */
+void
+item_get_multi(struct item **its, uint64_t *cas, const struct bstring *keys,
+        uint32_t nkey);
+
 /* this function does insert or update */
 void
 item_insert(struct item *it);
@@ -4,6 +4,7 @@
 #include "hashtable.h"
 #include "item.h"
 #include "segevict.h"
+#include "segpersist.h"
 #include "ttlbucket.h"
 #include "datapool/datapool.h"
 
@@ -16,6 +17,10 @@
 #include <string.h>
 #include <sysexits.h>
 #include <stdio.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #ifdef USE_PMEM
 #include "libpmem.h"
@@ -23,6 +28,10 @@
 
 #define SEG_MODULE_NAME "storage::seg"
 
+/* from <numaif.h>, which comes with libnuma */
+#define SEG_MPOL_PREFERRED  1
+#define SEG_MPOL_MF_MOVE    (1 << 1)
+
 extern struct setting        setting;
 extern struct seg_evict_info evict_info;
 extern char                  *eviction_policy_names[];
@@ -41,6 +50,21 @@ pthread_t     bg_tid;
 int           n_thread = 1;
 volatile bool stop     = false;
 
+__thread uint64_t seg_evict_ns = 0;
+
+/* worker threads take free segs from the free pool in batches and keep them
+ * in a thread local cache, so that the heap lock is taken once per batch
+ * instead of once per seg; the generation is bumped at every setup so that
+ * segs cached from a previous heap are dropped */
+#define FREE_SEG_BATCH 4
+static uint32_t          free_seg_gen = 0;
+static __thread uint32_t local_free_seg_gen = 0;
+static __thread int32_t  local_free_seg[FREE_SEG_BATCH];
+static __thread int      n_local_free_seg = 0;
+static __thread int      next_local_free_seg = 0;
+/* the NUMA node the thread runs on, looked up on its first free seg */
+static __thread int      local_numa_node     = -1;
+
 static char *seg_state_change_str[] = {
     "allocation",
     "concurrent_get",
@@ -213,6 +237,7 @@ seg_init(int32_t seg_id)
     seg->merge_at  = 0;
 
     seg->accessible = 1;
+    seg->persisted  = 0;
 
     seg->n_hit         = 0;
     seg->n_active      = 0;
@@ -226,20 +251,22 @@ rm_seg_from_ttl_bucket(int32_t seg_id)
     struct ttl_bucket *ttl_bucket = &ttl_buckets[find_ttl_bucket_idx(seg->ttl)];
     ASSERT(seg->ttl == ttl_bucket->ttl);
 
-    /* all modification to seg chain needs to be protected by lock
-     * TODO(juncheng): can change to the TTL lock? */
-    ASSERT(pthread_mutex_trylock(&heap.mtx) != 0);
+    /* all modification to seg chain needs to be protected by lock */
+    ASSERT(pthread_mutex_trylock(&ttl_bucket->chain_mtx) != 0);
 
     int32_t prev_seg_id = seg->prev_seg_id;
     int32_t next_seg_id = seg->next_seg_id;
 
+    /* the seg is skipped in the persisted chain before it can be reused */
     if (prev_seg_id == -1) {
         ASSERT(ttl_bucket->first_seg_id == seg_id);
 
         ttl_bucket->first_seg_id = next_seg_id;
+        seg_persist_first_seg(find_ttl_bucket_idx(seg->ttl));
     }
     else {
         heap.segs[prev_seg_id].next_seg_id = next_seg_id;
+        seg_persist_hdr(prev_seg_id);
     }
 
     if (next_seg_id == -1) {
@@ -335,9 +362,10 @@ rm_all_item_on_seg(int32_t seg_id, enum seg_state_change reason)
 #endif
 
     /* remove segment from TTL bucket */
-    pthread_mutex_lock(&heap.mtx);
+    struct ttl_bucket *tb = &ttl_buckets[find_ttl_bucket_idx(seg->ttl)];
+    pthread_mutex_lock(&tb->chain_mtx);
     rm_seg_from_ttl_bucket(seg_id);
-    pthread_mutex_unlock(&heap.mtx);
+    pthread_mutex_unlock(&tb->chain_mtx);
 
     while (curr - seg_data < offset) {
         /* check both offset and n_live_item is because when a segment is expiring
@@ -451,16 +479,103 @@ expire_seg(int32_t seg_id)
     return CC_OK;
 }
 
+/**
+ * the NUMA node whose memory holds the seg
+ */
+static inline uint32_t
+seg_numa_node(int32_t seg_id)
+{
+    return (uint32_t)(seg_id / heap.n_node_seg);
+}
+
+/**
+ * the NUMA node of the calling thread, which is stable for threads pinned to
+ * a core, e.g. workers with worker_binding_core set. Threads on a node the
+ * heap is not split across use node 0
+ */
+static inline uint32_t
+thread_numa_node(void)
+{
+    if (heap.n_numa_node == 1) {
+        return 0;
+    }
+
+    if (local_numa_node == -1) {
+        unsigned int cpu = 0, node = 0;
+
+#if defined(__linux__) && defined(SYS_getcpu)
+        if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+            node = 0;
+        }
+#endif
+        local_numa_node = (int)node;
+        log_verb("thread on cpu %u uses segs of NUMA node %u", cpu, node);
+    }
+
+    return (uint32_t)local_numa_node < heap.n_numa_node ? local_numa_node : 0;
+}
+
+/**
+ * take the first seg off the free pool of the given NUMA node, or of the next
+ * node with free segs if it has none,
+ * caller should grab the heap lock and make sure the pool is not empty
+ */
+static inline int32_t
+freepool_pop(uint32_t node)
+{
+    int32_t seg_id_ret, next_seg_id;
+
+    heap.n_free_seg -= 1;
+    ASSERT(heap.n_free_seg >= 0);
+
+    for (uint32_t i = 0; i < heap.n_numa_node; i++) {
+        if (heap.free_seg_id[node] != -1) {
+            break;
+        }
+        node = (node + 1) % heap.n_numa_node;
+    }
+
+    seg_id_ret = heap.free_seg_id[node];
+    ASSERT(seg_id_ret >= 0);
+
+    next_seg_id = heap.segs[seg_id_ret].next_seg_id;
+    heap.free_seg_id[node] = next_seg_id;
+    if (next_seg_id != -1) {
+        heap.segs[next_seg_id].prev_seg_id = -1;
+    }
+
+    ASSERT(heap.segs[seg_id_ret].write_offset == 0);
+
+    return seg_id_ret;
+}
+
 /**
  * get a seg from free pool,
  *
  * use_reserved: merge-based eviction reserves one seg per thread
  * return the segment id if there are free segment, -1 if not
+ *
+ * without use_reserved, segs are served from the thread local cache, which
+ * is refilled with up to FREE_SEG_BATCH segs from the free pool when empty
  */
 int32_t
 seg_get_from_freepool(bool use_reserved)
 {
-    int32_t seg_id_ret, next_seg_id;
+    int32_t seg_id_ret;
+    int32_t n_batch;
+    uint32_t node = thread_numa_node();
+
+    if (!use_reserved) {
+        if (local_free_seg_gen != free_seg_gen) {
+            local_free_seg_gen  = free_seg_gen;
+            n_local_free_seg    = 0;
+            next_local_free_seg = 0;
+        }
+
+        if (next_local_free_seg < n_local_free_seg) {
+            return local_free_seg[next_local_free_seg++];
+        }
+    }
 
     int status = pthread_mutex_lock(&heap.mtx);
 
@@ -478,23 +593,24 @@ seg_get_from_freepool(bool use_reserved)
         return -1;
     }
 
-    heap.n_free_seg -= 1;
-    ASSERT(heap.n_free_seg >= 0);
-
-    seg_id_ret = heap.free_seg_id;
-    ASSERT(seg_id_ret >= 0);
+    if (use_reserved) {
+        seg_id_ret = freepool_pop(node);
+        pthread_mutex_unlock(&heap.mtx);
 
-    next_seg_id = heap.segs[seg_id_ret].next_seg_id;
-    heap.free_seg_id = next_seg_id;
-    if (next_seg_id != -1) {
-        heap.segs[next_seg_id].prev_seg_id = -1;
+        return seg_id_ret;
     }
 
-    ASSERT(heap.segs[seg_id_ret].write_offset == 0);
+    n_batch = MIN(FREE_SEG_BATCH, heap.n_free_seg - heap.n_reserved_seg);
+    for (int32_t i = 0; i < n_batch; i++) {
+        local_free_seg[i] = freepool_pop(node);
+    }
 
     pthread_mutex_unlock(&heap.mtx);
 
-    return seg_id_ret;
+    n_local_free_seg    = n_batch;
+    next_local_free_seg = 1;
+
+    return local_free_seg[0];
 }
 
 /**
@@ -507,13 +623,14 @@ seg_add_to_freepool(int32_t seg_id, enum seg_state_change reason)
     ASSERT(pthread_mutex_trylock(&heap.mtx) != 0);
 
     struct seg *seg = &heap.segs[seg_id];
-    seg->next_seg_id = heap.free_seg_id;
+    int32_t *free_seg_id = &heap.free_seg_id[seg_numa_node(seg_id)];
+    seg->next_seg_id = *free_seg_id;
     seg->prev_seg_id = -1;
-    if (heap.free_seg_id != -1) {
-        ASSERT(heap.segs[heap.free_seg_id].prev_seg_id == -1);
-        heap.segs[heap.free_seg_id].prev_seg_id = seg_id;
+    if (*free_seg_id != -1) {
+        ASSERT(heap.segs[*free_seg_id].prev_seg_id == -1);
+        heap.segs[*free_seg_id].prev_seg_id = seg_id;
     }
-    heap.free_seg_id = seg_id;
+    *free_seg_id = seg_id;
 
     /* we set all free segs as locked to prevent it being evicted
      * before finishing setup */
@@ -545,11 +662,13 @@ seg_get_new(void)
     int32_t         seg_id_ret;
     /* eviction may fail if other threads pick the same seg */
     int             n_retries_left = MAX_RETRIES;
+    uint64_t        start;
 
     INCR(seg_metrics, seg_get);
 
     seg_id_ret = seg_get_from_freepool(false);
 
+    start = seg_id_ret == -1 ? (uint64_t)time_now_ns() : 0;
     while (seg_id_ret == -1 && n_retries_left >= 0) {
         /* evict seg */
         if (evict_info.policy == EVICT_MERGE_FIFO) {
@@ -568,6 +687,9 @@ seg_get_new(void)
             INCR(seg_metrics, seg_evict_retry);
         }
     }
+    if (start > 0) {
+        seg_evict_ns += (uint64_t)time_now_ns() - start;
+    }
 
     if (seg_id_ret == -1) {
         INCR(seg_metrics, seg_get_ex);
@@ -592,14 +714,75 @@ heap_init(void)
         log_crit("%s only support prealloc", SEG_MODULE_NAME);
         exit(EX_CONFIG);
     }
+
+    if (heap.n_numa_node == 0) {
+        heap.n_numa_node = 1;
+    }
+    if (heap.n_numa_node > SEG_MAX_NUMA_NODE) {
+        log_warn("heap can span at most %d NUMA nodes, not %" PRIu32,
+            SEG_MAX_NUMA_NODE, heap.n_numa_node);
+        heap.n_numa_node = SEG_MAX_NUMA_NODE;
+    }
+    if ((int32_t)heap.n_numa_node > heap.max_nseg) {
+        heap.n_numa_node = heap.max_nseg > 0 ? heap.max_nseg : 1;
+    }
+    heap.n_node_seg = (heap.max_nseg + heap.n_numa_node - 1) / heap.n_numa_node;
+}
+
+/* the segs of each NUMA node are a contiguous range of the heap, whose pages
+ * are placed on the node, which moves those that were prefaulted already. This
+ * is a preference rather than a binding, so a node that is short of memory
+ * falls back to another one. A file backed datapool is left where it is */
+static void
+bind_heap_mem(void)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (heap.n_numa_node == 1 || heap.persistent) {
+        return;
+    }
+
+    for (uint32_t node = 0; node < heap.n_numa_node; node++) {
+        size_t start = (size_t)heap.n_node_seg * node * heap.seg_size;
+        size_t end = MIN(start + (size_t)heap.n_node_seg * heap.seg_size,
+            heap.heap_size);
+        unsigned long nodemask = 1UL << node;
+
+        /* a page on the boundary of two nodes goes to the first of them */
+        start = (start + page_size - 1) / page_size * page_size;
+        end = (end + page_size - 1) / page_size * page_size;
+        if (start >= end) {
+            continue;
+        }
+
+        if (syscall(SYS_mbind, heap.base + start, end - start,
+                SEG_MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8,
+                SEG_MPOL_MF_MOVE) != 0) {
+            log_warn("fail to place %zu bytes of segs on NUMA node %" PRIu32
+                ": %s", end - start, node, strerror(errno));
+        } else {
+            log_info("placed %zu bytes of segs on NUMA node %" PRIu32,
+                end - start, node);
+        }
+    }
+#else
+    if (heap.n_numa_node > 1) {
+        log_warn("segs can only be placed on NUMA nodes on linux");
+    }
+#endif
 }
 
+/* the datapool holds the seg data, followed by the seg headers and the first
+ * seg of each ttl bucket */
 static int
 setup_heap_mem(void)
 {
-    int datapool_fresh = 1;
+    int    datapool_fresh = 1;
+    size_t pool_size      = heap.heap_size + SEG_HDR_SIZE * heap.max_nseg +
+        sizeof(int32_t) * MAX_N_TTL_BUCKET;
 
-    heap.pool = datapool_open(heap.poolpath, heap.poolname, heap.heap_size,
+    heap.pool = datapool_open(heap.poolpath, heap.poolname, pool_size,
         &datapool_fresh, heap.prefault);
 
     if (heap.pool == NULL || datapool_addr(heap.pool) == NULL) {
@@ -611,7 +794,12 @@ setup_heap_mem(void)
     log_info("pre-allocated %zu bytes for %" PRIu32 " segs", heap.heap_size,
         heap.max_nseg);
 
-    heap.base = datapool_addr(heap.pool);
+    heap.base          = datapool_addr(heap.pool);
+    heap.segs          = (struct seg *)(heap.base + heap.heap_size);
+    heap.first_seg_ids = (int32_t *)(heap.segs + heap.max_nseg);
+    heap.persistent    = heap.poolpath != NULL;
+
+    bind_heap_mem();
 
     return datapool_fresh;
 }
@@ -627,13 +815,17 @@ seg_heap_setup(void)
     dram_fresh = setup_heap_mem();
     pthread_mutex_init(&heap.mtx, NULL);
 
-    heap.segs = cc_zalloc(seg_hdr_sz);
+    /* the segs are recovered once the ttl buckets are set up */
+    heap.recover = !dram_fresh && seg_recoverable();
+
+    if (!heap.recover) {
+        /* empty the chains before the headers are reset */
+        for (int32_t i = 0; i < MAX_N_TTL_BUCKET; i++) {
+            heap.first_seg_ids[i] = -1;
+        }
+        seg_persist(heap.first_seg_ids, sizeof(int32_t) * MAX_N_TTL_BUCKET);
+        cc_memset(heap.segs, 0, seg_hdr_sz);
 
-    if (!dram_fresh) {
-        /* TODO(jason): recover */
-        ;
-    }
-    else {
         pthread_mutex_lock(&heap.mtx);
         heap.n_free_seg = 0;
         for (int32_t i = heap.max_nseg - 1; i >= 0; i--) {
@@ -647,6 +839,7 @@ seg_heap_setup(void)
             seg_add_to_freepool(i, SEG_ALLOCATION);
         }
         pthread_mutex_unlock(&heap.mtx);
+        seg_persist(heap.segs, seg_hdr_sz);
     }
 
     return CC_OK;
@@ -670,6 +863,7 @@ seg_teardown(void)
 
     segevict_teardown();
     ttl_bucket_teardown();
+    seg_persist_teardown();
 
     seg_metrics = NULL;
 
@@ -696,6 +890,7 @@ seg_setup(seg_options_st *options, seg_metrics_st *metrics)
 
     flush_at = -1;
     stop     = false;
+    free_seg_gen++;
 
     seg_options = options;
     n_thread    = option_uint(&seg_options->seg_n_thread);
@@ -704,7 +899,10 @@ seg_setup(seg_options_st *options, seg_metrics_st *metrics)
     heap.heap_size = option_uint(&seg_options->heap_mem);
     log_verb("cache size %" PRIu64, heap.heap_size);
 
-    heap.free_seg_id = -1;
+    for (uint32_t i = 0; i < SEG_MAX_NUMA_NODE; i++) {
+        heap.free_seg_id[i] = -1;
+    }
+    heap.n_numa_node = option_uint(&seg_options->seg_numa_node);
     heap.prealloc    = option_bool(&seg_options->seg_prealloc);
     heap.prefault    = option_bool(&seg_options->datapool_prefault);
 
@@ -712,6 +910,7 @@ seg_setup(seg_options_st *options, seg_metrics_st *metrics)
     heap.poolname = option_str(&seg_options->datapool_name);
 
     heap.n_reserved_seg = 0;
+    heap.n_bg_free_seg  = 0;
 
     use_cas = option_bool(&seg_options->seg_use_cas);
 
@@ -722,7 +921,7 @@ seg_setup(seg_options_st *options, seg_metrics_st *metrics)
         goto error;
     }
 
-    ttl_bucket_setup();
+    ttl_bucket_setup(option_bool(&seg_options->seg_local_seg));
 
     evict_info.merge_opt.seg_n_merge     =
         option_uint(&seg_options->seg_n_merge);
@@ -730,9 +929,18 @@ seg_setup(seg_options_st *options, seg_metrics_st *metrics)
         option_uint(&seg_options->seg_n_max_merge);
     segevict_setup(option_uint(&options->seg_evict_opt),
         option_uint(&seg_options->seg_mature_time));
+    if (evict_info.policy != EVICT_NONE) {
+        heap.n_bg_free_seg = option_uint(&seg_options->seg_n_bg_free);
+    }
     if (evict_info.policy == EVICT_MERGE_FIFO) {
-        heap.n_reserved_seg = n_thread;
+        /* the background thread needs a reserved seg to merge into as well */
+        heap.n_reserved_seg = n_thread + (heap.n_bg_free_seg > 0);
+    }
+
+    if (heap.recover) {
+        seg_recover(option_uint(&seg_options->seg_recover_thread));
     }
+    seg_persist_setup();
 
     start_background_thread(NULL);
 
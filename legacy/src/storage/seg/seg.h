@@ -30,9 +30,11 @@
  * the start of segment data can be calculated from the segment id because
  * all cache space is preallocated and segment is of fixed size.
  *
- * note that although segment header is always kept in DRAM,
- * the actual segment data can be in other storage media, such as PMem.
- * Storing the seg_header in DRAM requires
+ * segment headers are kept right after the segment data in the datapool,
+ * when the datapool is backed by a file (e.g., on PMem), headers and TTL
+ * bucket chains are persisted in an order that is consistent at any point,
+ * so that the cache can be recovered after a restart or a crash,
+ * see segpersist.h
  *
  * see the following for more details
  *
@@ -83,11 +85,18 @@ struct seg {
 
     uint8_t         recovered : 1; /* whether the items on this seg have been
                                     * recovered */
+    uint8_t         local : 1;     /* owned and written by one thread, not
+                                    * evictable until the thread moves on */
+    uint8_t         persisted : 1; /* the seg data has been persisted, so
+                                    * the seg survives a crash */
 
     uint16_t        unused;       /* unused, must be 0 */
 };
 
 
+/* the most NUMA nodes the heap can be split across */
+#define SEG_MAX_NUMA_NODE 8
+
 /**
  * the order of field is optimized for CPU cacheline
  **/
@@ -100,18 +109,31 @@ struct seg_heapinfo {
     int32_t             max_nseg;       /* max # seg allowed */
     size_t              heap_size;
 
-    int32_t             free_seg_id;    /* this is the head of free pool */
+    int32_t             free_seg_id[SEG_MAX_NUMA_NODE];
+                                        /* heads of the free pool, one per
+                                         * NUMA node */
+    uint32_t            n_numa_node;    /* # NUMA nodes the heap spans */
+    int32_t             n_node_seg;     /* # segs on each NUMA node */
 
     char                *poolpath;
     char                *poolname;
     struct datapool     *pool;
 
+    int32_t             *first_seg_ids; /* first seg of each ttl bucket,
+                                         * persisted with the seg headers */
+
     uint32_t            prealloc : 1;
     uint32_t            prefault : 1;
+    uint32_t            persistent : 1; /* the datapool is backed by a file */
+    uint32_t            recover : 1;    /* recover the segs at setup */
 
-    int32_t             n_reserved_seg;
+    int32_t             n_reserved_seg; /* # free segs kept for merging */
+    int32_t             n_bg_free_seg;  /* # free segs the background
+                                         * thread keeps on top of the
+                                         * reserved ones */
 
-    pthread_mutex_t     mtx;
+    pthread_mutex_t     mtx;            /* protects the free pool, seg chains
+                                         * are protected by ttl bucket locks */
 
     proc_time_i         time_started;
 };
@@ -146,6 +168,10 @@ enum seg_state_change {
 #define SEG_MATURE_TIME 20
 #define SEG_N_MAX_MERGE 8
 #define SEG_N_MERGE     4
+#define SEG_N_BG_FREE   0
+#define SEG_LOCAL_SEG   false
+#define SEG_N_RECOVER_THREAD 4
+#define SEG_N_NUMA_NODE 1
 
 
 /*          name                    type            default                 description */
@@ -155,14 +181,18 @@ enum seg_state_change {
     ACTION(seg_prealloc,        OPTION_TYPE_BOOL,   SEG_PREALLOC,           "Pre-allocate segs at setup"                                                                                )\
     ACTION(seg_evict_opt,       OPTION_TYPE_UINT,   SEG_EVICT_OPT,          "Eviction strategy (0: no eviction, 1: random, 2: FIFO, 3: close to expire, 4: utilization, 5: merge fifo"  )\
     ACTION(seg_use_cas,         OPTION_TYPE_BOOL,   SEG_USE_CAS,            "whether use cas, should be true"                                                                           )\
+    ACTION(seg_local_seg,       OPTION_TYPE_BOOL,   SEG_LOCAL_SEG,          "each thread writes to its own seg in each ttl bucket, one seg per thread per ttl"                          )\
     ACTION(seg_mature_time,     OPTION_TYPE_UINT,   SEG_MATURE_TIME,        "min time before a segment can be considered for eviction"                                                  )\
     ACTION(seg_n_max_merge,     OPTION_TYPE_UINT,   SEG_N_MAX_MERGE,        "max number of segments can be evicted/merged in one eviction"                                              )\
     ACTION(seg_n_merge,         OPTION_TYPE_UINT,   SEG_N_MERGE,            "the target number of segment to be evicted/merge in one eviction"                                          )\
+    ACTION(seg_n_bg_free,       OPTION_TYPE_UINT,   SEG_N_BG_FREE,          "# free segs the background thread evicts ahead of demand (0: disabled)"                                    )\
     ACTION(hash_power,          OPTION_TYPE_UINT,   HASH_POWER,             "Power for lookup hash table"                                                                               )\
     ACTION(seg_n_thread,        OPTION_TYPE_UINT,   N_THREAD,               "number of threads"                                                                                         )\
     ACTION(datapool_path,       OPTION_TYPE_STR,    SEG_DATAPOOL,           "Path to DRAM data pool"                                                                                    )\
     ACTION(datapool_name,       OPTION_TYPE_STR,    SEG_DATAPOOL_NAME,      "Seg DRAM data pool name"                                                                                   )\
-    ACTION(datapool_prefault,   OPTION_TYPE_BOOL,   SEG_DATAPOOL_PREFAULT,  "Prefault Pmem"                                                                                             )
+    ACTION(datapool_prefault,   OPTION_TYPE_BOOL,   SEG_DATAPOOL_PREFAULT,  "Prefault Pmem"                                                                                             )\
+    ACTION(seg_recover_thread,  OPTION_TYPE_UINT,   SEG_N_RECOVER_THREAD,   "# threads rebuilding the hash table from a recovered datapool"                                             )\
+    ACTION(seg_numa_node,       OPTION_TYPE_UINT,   SEG_N_NUMA_NODE,        "# NUMA nodes the heap is split across, threads prefer segs on their own node"                              )
 
 typedef struct {
     SEG_OPTION(OPTION_DECLARE)
@@ -177,16 +207,28 @@ typedef struct {
     ACTION(seg_evict,           METRIC_COUNTER,     "# seg evictions"                       )\
     ACTION(seg_evict_retry,     METRIC_COUNTER,     "# retried seg eviction"                )\
     ACTION(seg_evict_ex,        METRIC_COUNTER,     "# segs evict exceptions"               )\
+    ACTION(seg_bg_evict,        METRIC_COUNTER,     "# segs evicted by background thread"   )\
     ACTION(seg_expire,          METRIC_COUNTER,     "# segs removed due to expiration"      )\
     ACTION(seg_merge,           METRIC_COUNTER,     "# seg merge"                           )\
+    ACTION(seg_merge_us,        METRIC_COUNTER,     "time spent merging segs (us)"          )\
+    ACTION(seg_merge_us_p50,    METRIC_GAUGE,       "p50 of merge duration (us)"            )\
+    ACTION(seg_merge_us_p99,    METRIC_GAUGE,       "p99 of merge duration (us)"            )\
+    ACTION(seg_merge_byte,      METRIC_COUNTER,     "# bytes copied by merges"              )\
+    ACTION(seg_merge_byte_p50,  METRIC_GAUGE,       "p50 of bytes copied per merge"         )\
+    ACTION(seg_merge_byte_p99,  METRIC_GAUGE,       "p99 of bytes copied per merge"         )\
     ACTION(seg_evict_age_sum,   METRIC_COUNTER,     "sum of ages of all evicted seg"        )\
     ACTION(seg_evict_seg_cnt,   METRIC_COUNTER,     "# evicted segs"                        )\
     ACTION(seg_curr,            METRIC_GAUGE,       "# active segs"                         )\
+    ACTION(seg_persist,         METRIC_COUNTER,     "# sealed segs persisted to datapool"   )\
+    ACTION(seg_recover_seg,     METRIC_GAUGE,       "# segs recovered at setup"             )\
+    ACTION(seg_recover_item,    METRIC_GAUGE,       "# items recovered at setup"            )\
+    ACTION(seg_recover_us,      METRIC_GAUGE,       "time spent recovering segs (us)"       )\
     ACTION(item_curr,           METRIC_GAUGE,       "# current items"                       )\
     ACTION(item_curr_bytes,     METRIC_GAUGE,       "# used bytes including item header"    )\
     ACTION(item_alloc,          METRIC_COUNTER,     "# items allocated"                     )\
     ACTION(item_alloc_ex,       METRIC_COUNTER,     "# item alloc errors"                   )\
     ACTION(hash_lookup,         METRIC_COUNTER,     "# hash lookups"                        )\
+    ACTION(hash_lookup_retry,   METRIC_COUNTER,     "# hash lookups retried after a write"  )\
     ACTION(hash_insert,         METRIC_COUNTER,     "# hash inserts"                        )\
     ACTION(hash_remove,         METRIC_COUNTER,     "# hash deletes"                        )\
     ACTION(hash_remove_it,      METRIC_COUNTER,     "# hash item deletes"                   )\
@@ -221,6 +263,9 @@ typedef struct {
 
 extern struct seg_heapinfo heap; /* info of all allocated segs */
 
+/* time the thread has spent evicting segs, in ns */
+extern __thread uint64_t seg_evict_ns;
+
 void
 seg_setup(seg_options_st *options, seg_metrics_st *metrics);
 
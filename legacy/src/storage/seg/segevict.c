@@ -248,6 +248,7 @@ void
 segevict_teardown(void)
 {
     cc_free(evict_info.ranked_seg_id);
+    segmerge_teardown();
 
     segevict_initialized = false;
 }
@@ -280,6 +281,7 @@ segevict_setup(evict_policy_e ev_policy, uintmax_t seg_mature_time)
     /* stop if the bytes on the merged seg is more than the threshold */
     mopt->stop_ratio   = mopt->target_ratio * (mopt->seg_n_merge - 1) + 0.05;
     mopt->stop_bytes   = (int32_t) (heap.seg_size * mopt->stop_ratio);
+    segmerge_setup();
 
     srand(time(NULL));
     segevict_initialized = true;
@@ -83,3 +83,10 @@ segevict_setup(evict_policy_e ev_policy, uintmax_t seg_mature_time);
 void
 segevict_teardown(void);
 
+/* set up the histograms of merge duration and bytes copied */
+void
+segmerge_setup(void);
+
+void
+segmerge_teardown(void);
+
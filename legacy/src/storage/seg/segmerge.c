@@ -3,17 +3,40 @@
 #include "hashtable.h"
 #include "item.h"
 #include "segevict.h"
+#include "segpersist.h"
 #include "ttlbucket.h"
 
+#include <cc_histogram.h>
 #include <cc_mm.h>
+#include <time/cc_timer.h>
 
+#include <pthread.h>
 #include <sys/types.h>
 
+/* the number of items ahead of the one being copied, whose hash buckets are
+ * prefetched during merge */
+#define MERGE_PREFETCH_DIST 8
+
+/* merge duration in us, 1 us resolution up to 1 ms, capped at ~134 s */
+#define MERGE_US_HISTO_M    0
+#define MERGE_US_HISTO_R    10
+#define MERGE_US_HISTO_N    27
+
+/* bytes copied per merge, 64 B resolution up to 8 KiB, capped at 2 GiB */
+#define MERGE_BYTE_HISTO_M  6
+#define MERGE_BYTE_HISTO_R  13
+#define MERGE_BYTE_HISTO_N  31
+
 extern struct seg_evict_info evict_info;
 extern struct ttl_bucket     ttl_buckets[MAX_N_TTL_BUCKET];
 extern seg_metrics_st        *seg_metrics;
 extern seg_perttl_metrics_st perttl[MAX_N_TTL_BUCKET];
 
+/* merges can run on any thread, so the histograms are guarded by a lock */
+static struct histo_u32 *merge_us_histo   = NULL;
+static struct histo_u32 *merge_byte_histo = NULL;
+static pthread_mutex_t  merge_histo_mtx   = PTHREAD_MUTEX_INITIALIZER;
+
 static inline void
 seg_copy(int32_t seg_id_dest, int32_t seg_id_src,
          double *cutoff_freq, double target_ratio);
@@ -26,17 +49,14 @@ merge_segs(struct seg *segs_to_merge[],
 static inline uint64_t
 n_evicted_seg(void)
 {
-    return __atomic_load_n(
-        &seg_metrics->seg_evict_seg_cnt.counter, __ATOMIC_RELAXED);
+    return metric_counter(&seg_metrics->seg_evict_seg_cnt);
 }
 
 static inline uint64_t
 cal_mean_eviction_age(void)
 {
-    uint64_t evict_age_sum = __atomic_load_n(
-        &seg_metrics->seg_evict_age_sum.counter, __ATOMIC_RELAXED);
-    uint64_t evict_seg_cnt = __atomic_load_n(
-        &seg_metrics->seg_evict_seg_cnt.counter, __ATOMIC_RELAXED);
+    uint64_t evict_age_sum = metric_counter(&seg_metrics->seg_evict_age_sum);
+    uint64_t evict_seg_cnt = metric_counter(&seg_metrics->seg_evict_seg_cnt);
 
     if (evict_seg_cnt == 0) {
         return 86400;
@@ -111,8 +131,10 @@ prep_seg_to_merge(int32_t start_seg_id,
     int32_t    curr_seg_id = start_seg_id;
     struct seg *curr_seg;
 
-    /* TODO(juncheng): do we need lock */
-    pthread_mutex_lock(&heap.mtx);
+    struct ttl_bucket *tb =
+        &ttl_buckets[find_ttl_bucket_idx(heap.segs[start_seg_id].ttl)];
+
+    pthread_mutex_lock(&tb->chain_mtx);
     for (int i = 0; i < evict_info.merge_opt.seg_n_max_merge; i++) {
         if (curr_seg_id == -1) {
             break;
@@ -130,7 +152,7 @@ prep_seg_to_merge(int32_t start_seg_id,
         segs_to_merge[(*n_evictable_seg)++] = curr_seg;
         curr_seg_id = curr_seg->next_seg_id;
     }
-    pthread_mutex_unlock(&heap.mtx);
+    pthread_mutex_unlock(&tb->chain_mtx);
 
     /* calculate how many bytes should be retained from each seg */
     int target_n_seg_to_merge = evict_info.merge_opt.seg_n_merge;
@@ -154,25 +176,30 @@ replace_seg_in_chain(int32_t new_seg_id, int32_t old_seg_id)
     struct ttl_bucket *tb = &ttl_buckets[find_ttl_bucket_idx(old_seg->ttl)];
 
     /* all modification to seg chain needs to be protected by lock */
-    ASSERT(pthread_mutex_trylock(&heap.mtx) != 0);
+    ASSERT(pthread_mutex_trylock(&tb->chain_mtx) != 0);
 
     int32_t prev_seg_id = old_seg->prev_seg_id;
     int32_t next_seg_id = old_seg->next_seg_id;
 
+    ASSERT(next_seg_id != -1);
+
+    /* the new seg is persisted before it is linked */
+    new_seg->prev_seg_id = prev_seg_id;
+    new_seg->next_seg_id = next_seg_id;
+    seg_persist_hdr(new_seg_id);
+
     if (prev_seg_id == -1) {
         ASSERT(tb->first_seg_id == old_seg_id);
 
         tb->first_seg_id = new_seg_id;
+        seg_persist_first_seg(find_ttl_bucket_idx(old_seg->ttl));
     }
     else {
         heap.segs[prev_seg_id].next_seg_id = new_seg_id;
+        seg_persist_hdr(prev_seg_id);
     }
 
-    ASSERT(next_seg_id != -1);
     heap.segs[next_seg_id].prev_seg_id = new_seg_id;
-
-    new_seg->prev_seg_id = prev_seg_id;
-    new_seg->next_seg_id = next_seg_id;
 }
 
 
@@ -323,6 +350,27 @@ seg_merge_evict(int32_t *seg_id_ret)
     return EVICT_NO_AVAILABLE_SEG;
 }
 
+/**
+ * prefetch the hash bucket of the item at pos and the start of the item after
+ * it, return the position of the next item
+ */
+static inline uint8_t *
+prefetch_item(uint8_t *pos, uint8_t *end)
+{
+    struct item *it = (struct item *) pos;
+
+    if (pos >= end || (it->klen == 0 && it->vlen == 0)) {
+        return pos;
+    }
+
+    hashtable_prefetch(item_key(it), it->klen);
+
+    pos += item_ntotal(it);
+    __builtin_prefetch(pos);
+
+    return pos;
+}
+
 static void
 seg_copy(int32_t seg_id_dest, int32_t seg_id_src,
          double *cutoff_freq, double target_ratio)
@@ -375,9 +423,17 @@ seg_copy(int32_t seg_id_dest, int32_t seg_id_src,
     int    update_intvl = (int) heap.seg_size / 10;
     int    n_th_update  = 1;
 
+    /* each item is looked up and relinked in the hash table, so the buckets
+     * of the items a few ahead are prefetched to overlap the cache misses */
+    uint8_t *ahead = curr_src;
+    for (int i = 0; i < MERGE_PREFETCH_DIST; i++) {
+        ahead = prefetch_item(ahead, seg_data_src + offset);
+    }
+
     while (curr_src - seg_data_src < offset) {
         last_it = it;
         it      = (struct item *) curr_src;
+        ahead   = prefetch_item(ahead, seg_data_src + offset);
 
         if (it->klen == 0 && it->vlen == 0) {
 #if defined CC_ASSERT_PANIC || defined CC_ASSERT_LOG
@@ -515,6 +571,47 @@ seg_copy(int32_t seg_id_dest, int32_t seg_id_src,
  * return the number of segs that are merged
  *
  **/
+static void
+merge_record(struct duration *d, int32_t n_byte)
+{
+    uint64_t bucket;
+    uint64_t us;
+
+    duration_stop(d);
+    us = (uint64_t) duration_us(d);
+
+    INCR_N(seg_metrics, seg_merge_us, us);
+    INCR_N(seg_metrics, seg_merge_byte, n_byte);
+
+    if (merge_us_histo == NULL || merge_byte_histo == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&merge_histo_mtx);
+
+    histo_u32_record(merge_us_histo, MIN(us, merge_us_histo->N), 1);
+    histo_u32_record(merge_byte_histo, n_byte, 1);
+
+    if (histo_u32_report(&bucket, merge_us_histo, 0.5) == HISTO_OK) {
+        UPDATE_VAL(seg_metrics, seg_merge_us_p50,
+            bucket_high(merge_us_histo, bucket));
+    }
+    if (histo_u32_report(&bucket, merge_us_histo, 0.99) == HISTO_OK) {
+        UPDATE_VAL(seg_metrics, seg_merge_us_p99,
+            bucket_high(merge_us_histo, bucket));
+    }
+    if (histo_u32_report(&bucket, merge_byte_histo, 0.5) == HISTO_OK) {
+        UPDATE_VAL(seg_metrics, seg_merge_byte_p50,
+            bucket_high(merge_byte_histo, bucket));
+    }
+    if (histo_u32_report(&bucket, merge_byte_histo, 0.99) == HISTO_OK) {
+        UPDATE_VAL(seg_metrics, seg_merge_byte_p99,
+            bucket_high(merge_byte_histo, bucket));
+    }
+
+    pthread_mutex_unlock(&merge_histo_mtx);
+}
+
 int32_t
 merge_segs(struct seg *segs_to_merge[],
            int n_evictable,
@@ -522,6 +619,10 @@ merge_segs(struct seg *segs_to_merge[],
 {
     INCR(seg_metrics, seg_merge);
 
+    struct duration d;
+    duration_reset(&d);
+    duration_start(&d);
+
     struct merge_opts *mopt = &evict_info.merge_opt;
 
     static int empty_merge      = 0;
@@ -532,6 +633,9 @@ merge_segs(struct seg *segs_to_merge[],
     uint8_t    accessible;
     int        n_merged         = 0;
 
+    struct ttl_bucket *tb =
+        &ttl_buckets[find_ttl_bucket_idx(segs_to_merge[0]->ttl)];
+
     /* this is the next seg_id of the last evictable segment, we keep it
      * in case there are no active objects in all evictable segments (so no merged seg),
      * we return this seg */
@@ -544,6 +648,9 @@ merge_segs(struct seg *segs_to_merge[],
     struct seg *new_seg = &heap.segs[new_seg_id];
     ASSERT(new_seg->evictable == 0);
 
+    /* the seg magic may have been written at init */
+    int32_t init_offset = new_seg->write_offset;
+
     new_seg->create_at   = segs_to_merge[0]->create_at;
     new_seg->merge_at    = time_proc_sec();
     new_seg->ttl         = segs_to_merge[0]->ttl;
@@ -577,19 +684,22 @@ merge_segs(struct seg *segs_to_merge[],
 
         seg_wait_refcnt(curr_seg_id);
 
-        pthread_mutex_lock(&heap.mtx);
+        pthread_mutex_lock(&tb->chain_mtx);
         if (n_merged == 0) {
             /* place the new seg at the position of the first evicted seg and
              * not return this seg to freepool, keep it for the immediate use */
             replace_seg_in_chain(new_seg_id, curr_seg_id);
+            pthread_mutex_unlock(&tb->chain_mtx);
         }
         else {
             rm_seg_from_ttl_bucket(curr_seg_id);
+            pthread_mutex_unlock(&tb->chain_mtx);
+
+            pthread_mutex_lock(&heap.mtx);
             seg_add_to_freepool(curr_seg_id, SEG_EVICTION);
+            pthread_mutex_unlock(&heap.mtx);
         }
 
-        pthread_mutex_unlock(&heap.mtx);
-
         n_merged++;
 
         INCR_N(seg_metrics, seg_evict_age_sum,
@@ -603,8 +713,11 @@ merge_segs(struct seg *segs_to_merge[],
         /* if the evicted segs all have no live object */
         new_seg->accessible = 0;
 
-        pthread_mutex_lock(&heap.mtx);
+        pthread_mutex_lock(&tb->chain_mtx);
         rm_seg_from_ttl_bucket(new_seg_id);
+        pthread_mutex_unlock(&tb->chain_mtx);
+
+        pthread_mutex_lock(&heap.mtx);
         seg_add_to_freepool(new_seg_id, SEG_EVICTION);
         pthread_mutex_unlock(&heap.mtx);
 
@@ -616,6 +729,8 @@ merge_segs(struct seg *segs_to_merge[],
 
         empty_merge += 1;
 
+        merge_record(&d, 0);
+
         return last_seg_next_seg_id;
     }
     else {
@@ -632,6 +747,7 @@ merge_segs(struct seg *segs_to_merge[],
          * set the part that written to 0 */
         memset(get_seg_data_start(new_seg_id) + new_seg->write_offset,
             0, heap.seg_size - new_seg->write_offset);
+        seg_persist_data(new_seg_id);
         __atomic_store_n(&new_seg->evictable, 1, __ATOMIC_RELAXED);
         successful_merge += 1;
 
@@ -651,11 +767,28 @@ merge_segs(struct seg *segs_to_merge[],
 
         log_verb("***************************************************");
 
+        merge_record(&d, new_seg->write_offset - init_offset);
+
         return heap.segs[new_seg_id].next_seg_id;
     }
 
     ASSERT(0);
 }
 
+void
+segmerge_setup(void)
+{
+    segmerge_teardown();
 
+    merge_us_histo   = histo_u32_create(MERGE_US_HISTO_M, MERGE_US_HISTO_R,
+        MERGE_US_HISTO_N);
+    merge_byte_histo = histo_u32_create(MERGE_BYTE_HISTO_M,
+        MERGE_BYTE_HISTO_R, MERGE_BYTE_HISTO_N);
+}
 
+void
+segmerge_teardown(void)
+{
+    histo_u32_destroy(&merge_us_histo);
+    histo_u32_destroy(&merge_byte_histo);
+}
@@ -0,0 +1,519 @@
+#include "segpersist.h"
+#include "hashtable.h"
+#include "item.h"
+#include "ttlbucket.h"
+
+#include <cc_debug.h>
+#include <cc_mm.h>
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+#include <sysexits.h>
+
+/* a sealed seg is only persisted PERSIST_DELAY_SEC after the next seg is
+ * linked, because a slow writer may still be copying an item which it has
+ * reserved right before the seg is sealed */
+#define PERSIST_DELAY_SEC 2
+
+extern struct ttl_bucket     ttl_buckets[MAX_N_TTL_BUCKET];
+extern seg_metrics_st        *seg_metrics;
+extern seg_perttl_metrics_st perttl[MAX_N_TTL_BUCKET];
+extern proc_time_i           flush_at;
+
+/* stored as the user data of the datapool */
+struct seg_pool_metadata {
+    uint64_t    seg_size;
+    uint64_t    heap_size;
+    int64_t     time_started; /* unix time of proc time 0 in the last run */
+    int64_t     flush_at;     /* unix time of the last flush, -1 if none */
+};
+
+/* the state of each seg during recovery */
+#define RECOVER_UNSEEN  0
+#define RECOVER_DROPPED 1
+#define RECOVER_LINKED  2
+
+/* segs to scan at recovery, each recovery thread takes the next one */
+static int32_t *recover_seg_ids = NULL;
+static int32_t n_recover_seg    = 0;
+static int32_t next_recover_seg = 0;
+
+static void
+persist_metadata(void)
+{
+    struct seg_pool_metadata meta = {
+        .seg_size     = heap.seg_size,
+        .heap_size    = heap.heap_size,
+        .time_started = time_started(),
+        .flush_at     = flush_at < 0 ? -1 : time_started() + flush_at,
+    };
+
+    if (heap.persistent) {
+        datapool_set_user_data(heap.pool, &meta, sizeof(meta));
+    }
+}
+
+void
+seg_persist_first_seg(uint32_t ttl_bucket_idx)
+{
+    heap.first_seg_ids[ttl_bucket_idx] = ttl_buckets[ttl_bucket_idx].first_seg_id;
+    seg_persist(&heap.first_seg_ids[ttl_bucket_idx], sizeof(int32_t));
+}
+
+void
+seg_persist_data(int32_t seg_id)
+{
+    struct seg *seg = &heap.segs[seg_id];
+
+    if (!heap.persistent) {
+        return;
+    }
+
+    seg_persist(get_seg_data_start(seg_id),
+        MIN(__atomic_load_n(&seg->write_offset, __ATOMIC_RELAXED),
+            heap.seg_size));
+    seg->persisted = 1;
+    seg_persist_hdr(seg_id);
+
+    INCR(seg_metrics, seg_persist);
+}
+
+void
+seg_persist_sealed(void)
+{
+    struct seg *seg;
+    int32_t    seg_id, next_seg_id;
+
+    if (!heap.persistent) {
+        return;
+    }
+
+    for (int i = 0; i < MAX_N_TTL_BUCKET; i++) {
+        seg_id = ttl_buckets[i].first_seg_id;
+
+        while (seg_id != -1) {
+            seg         = &heap.segs[seg_id];
+            next_seg_id = seg->next_seg_id;
+
+            /* the last seg of a chain or a seg owned by a thread is not
+             * sealed yet */
+            if (next_seg_id == -1 || seg->local) {
+                break;
+            }
+
+            if (seg->persisted || heap.segs[next_seg_id].create_at +
+                PERSIST_DELAY_SEC >= time_proc_sec()) {
+                seg_id = next_seg_id;
+                continue;
+            }
+
+            /* lock the seg so that it is not evicted while being persisted */
+            if (__atomic_exchange_n(&seg->evictable, 0, __ATOMIC_RELAXED) == 0) {
+                seg_id = next_seg_id;
+                continue;
+            }
+
+            if (seg_is_accessible(seg_id) &&
+                __atomic_load_n(&seg->w_refcount, __ATOMIC_RELAXED) == 0) {
+                seg_persist_data(seg_id);
+            }
+
+            __atomic_store_n(&seg->evictable, 1, __ATOMIC_RELAXED);
+
+            seg_id = next_seg_id;
+        }
+    }
+}
+
+void
+seg_persist_flush(void)
+{
+    persist_metadata();
+}
+
+bool
+seg_recoverable(void)
+{
+    struct seg_pool_metadata meta;
+
+    if (!heap.persistent) {
+        return false;
+    }
+
+    datapool_get_user_data(heap.pool, &meta, sizeof(meta));
+
+    if (meta.seg_size != heap.seg_size || meta.heap_size != heap.heap_size) {
+        log_warn("datapool has seg size %" PRIu64 " and heap size %" PRIu64
+                 ", expecting %zu and %zu, segs are not recovered",
+            meta.seg_size, meta.heap_size, heap.seg_size, heap.heap_size);
+
+        return false;
+    }
+
+    return true;
+}
+
+/* whether the seg read from the datapool can be linked into the ttl bucket */
+static bool
+recover_seg_valid(int32_t seg_id, bool dirty,
+                  const struct seg_pool_metadata *meta, int64_t delta)
+{
+    struct seg *seg = &heap.segs[seg_id];
+
+    /* after a crash, only persisted segs have all their data */
+    if (dirty && !seg->persisted) {
+        return false;
+    }
+
+    if (meta->flush_at != -1 &&
+        meta->time_started + seg->create_at <= meta->flush_at) {
+        return false;
+    }
+
+    return seg->create_at + delta + seg->ttl > time_proc_sec();
+}
+
+/**
+ * walk the seg chain of the ttl bucket from its persisted first seg, and link
+ * the segs which can be recovered into the ttl bucket
+ *
+ * dropped segs are skipped by persisting the link from the previous seg,
+ * so that the chain stays consistent if we crash during recovery
+ */
+static void
+recover_chain(uint32_t ttl_bucket_idx, bool dirty,
+              const struct seg_pool_metadata *meta, int64_t delta,
+              uint8_t *state)
+{
+    struct ttl_bucket *ttl_bucket = &ttl_buckets[ttl_bucket_idx];
+    struct seg        *seg;
+    int32_t           seg_id      = heap.first_seg_ids[ttl_bucket_idx];
+    int32_t           prev_seg_id = -1;
+    int32_t           next_seg_id;
+
+    while (seg_id >= 0 && seg_id < heap.max_nseg &&
+        state[seg_id] == RECOVER_UNSEEN) {
+        seg         = &heap.segs[seg_id];
+        next_seg_id = seg->next_seg_id;
+
+        if (seg->ttl != ttl_bucket->ttl) {
+            log_warn("seg %" PRId32 " has ttl %" PRId32 " in ttl bucket %" PRIu32
+                     ", dropping the rest of the chain", seg_id, seg->ttl,
+                ttl_bucket_idx);
+            break;
+        }
+
+        if (!recover_seg_valid(seg_id, dirty, meta, delta)) {
+            state[seg_id] = RECOVER_DROPPED;
+            seg_id = next_seg_id;
+            continue;
+        }
+
+        state[seg_id] = RECOVER_LINKED;
+
+        /* if we crash before the metadata of this run is persisted, the
+         * create time is rebased again at the next recovery, which makes
+         * the seg look older than it is, it only expires early */
+        seg->create_at   += delta;
+        seg->prev_seg_id = prev_seg_id;
+        seg->w_refcount  = 0;
+        seg->r_refcount  = 0;
+        seg->local       = 0;
+        seg->recovered   = 0;
+        seg->persisted   = 1;
+        seg->n_live_item = 0;
+#if defined CC_ASSERT_PANIC || defined CC_ASSERT_LOG
+        seg->live_bytes  = 8;
+#else
+        seg->live_bytes  = 0;
+#endif
+        seg->accessible  = 1;
+        seg->evictable   = 1;
+        seg_persist_hdr(seg_id);
+
+        if (prev_seg_id == -1) {
+            ttl_bucket->first_seg_id = seg_id;
+            seg_persist_first_seg(ttl_bucket_idx);
+        }
+        else {
+            heap.segs[prev_seg_id].next_seg_id = seg_id;
+            seg_persist_hdr(prev_seg_id);
+        }
+
+        ttl_bucket->last_seg_id = seg_id;
+        ttl_bucket->n_seg++;
+        PERTTL_INCR(ttl_bucket_idx, seg_curr);
+
+        recover_seg_ids[n_recover_seg++] = seg_id;
+        prev_seg_id = seg_id;
+        seg_id      = next_seg_id;
+    }
+
+    if (prev_seg_id == -1) {
+        ttl_bucket->first_seg_id = -1;
+        seg_persist_first_seg(ttl_bucket_idx);
+
+        return;
+    }
+
+    seg = &heap.segs[prev_seg_id];
+    seg->next_seg_id = -1;
+
+    /* no more items are appended to a recovered seg, since its data is
+     * already persisted, mark the end of data so that it is sealed */
+    if (seg->write_offset < heap.seg_size) {
+        memset(get_seg_data_start(prev_seg_id) + seg->write_offset, 0,
+            heap.seg_size - seg->write_offset);
+        seg_persist(get_seg_data_start(prev_seg_id) + seg->write_offset,
+            heap.seg_size - seg->write_offset);
+        seg->write_offset = heap.seg_size;
+    }
+    seg_persist_hdr(prev_seg_id);
+}
+
+/* insert the items on the seg into the hash table */
+static void
+recover_items(int32_t seg_id, uint64_t *n_item)
+{
+    struct seg  *seg     = &heap.segs[seg_id];
+    uint8_t     *seg_data = get_seg_data_start(seg_id);
+    uint8_t     *curr    = seg_data;
+    uint32_t    offset   = MIN(seg->write_offset, heap.seg_size) - ITEM_HDR_SIZE;
+    struct item *it;
+    uint32_t    sz;
+    int32_t     n_live_item = 0, live_bytes = 0;
+
+#if defined CC_ASSERT_PANIC || defined CC_ASSERT_LOG
+    curr += sizeof(uint64_t);
+#endif
+
+    while (curr - seg_data < offset) {
+        it = (struct item *) curr;
+        if (it->klen == 0 && it->vlen == 0) {
+            break;
+        }
+
+        sz = item_ntotal(it);
+        if (curr - seg_data + sz > heap.seg_size) {
+            log_warn("item at offset %td of seg %" PRId32 " is truncated",
+                curr - seg_data, seg_id);
+            break;
+        }
+
+        if (!it->deleted) {
+            /* the stats are updated first, because the put decrements
+             * them on the seg of an older copy of the key */
+            __atomic_add_fetch(&seg->n_live_item, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&seg->live_bytes, sz, __ATOMIC_RELAXED);
+#if defined DEBUG_MODE
+            hashtable_put(it, (uint64_t)seg->seg_id_non_decr,
+                (uint64_t)(curr - seg_data));
+#else
+            hashtable_put(it, (uint64_t)seg_id, (uint64_t)(curr - seg_data));
+#endif
+            n_live_item++;
+            live_bytes += sz;
+        }
+
+        curr += sz;
+    }
+
+    seg->recovered = 1;
+
+    INCR_N(seg_metrics, item_curr, n_live_item);
+    INCR_N(seg_metrics, item_curr_bytes, live_bytes);
+    PERTTL_INCR_N(find_ttl_bucket_idx(seg->ttl), item_curr, n_live_item);
+    PERTTL_INCR_N(find_ttl_bucket_idx(seg->ttl), item_curr_bytes, live_bytes);
+
+    *n_item += n_live_item;
+}
+
+static void *
+recover_main(void *arg)
+{
+    uint64_t *n_item = arg;
+    int32_t  idx;
+
+    while ((idx = __atomic_fetch_add(&next_recover_seg, 1, __ATOMIC_RELAXED))
+        < n_recover_seg) {
+        recover_items(recover_seg_ids[idx], n_item);
+    }
+
+    return NULL;
+}
+
+/* insert the items of the recovered segs into the hash table in parallel */
+static uint64_t
+recover_hashtable(uint32_t n_thread)
+{
+    pthread_t *tids    = cc_alloc(sizeof(pthread_t) * n_thread);
+    uint64_t  *n_items = cc_zalloc(sizeof(uint64_t) * n_thread);
+    uint64_t  n_item   = 0;
+    uint32_t  n_started;
+    int       ret;
+
+    if (tids == NULL || n_items == NULL) {
+        log_crit("cannot allocate %" PRIu32 " seg recovery threads", n_thread);
+        exit(EX_OSERR);
+    }
+
+    next_recover_seg = 0;
+
+    for (n_started = 0; n_started < n_thread; n_started++) {
+        ret = pthread_create(&tids[n_started], NULL, recover_main,
+            &n_items[n_started]);
+        if (ret != 0) {
+            log_warn("pthread create failed for seg recovery thread: %s",
+                strerror(ret));
+            break;
+        }
+    }
+
+    /* scan the rest on this thread if some threads cannot be started */
+    if (n_started < n_thread) {
+        recover_main(&n_item);
+    }
+
+    for (uint32_t i = 0; i < n_started; i++) {
+        pthread_join(tids[i], NULL);
+        n_item += n_items[i];
+    }
+
+    cc_free(tids);
+    cc_free(n_items);
+
+    return n_item;
+}
+
+void
+seg_recover(uint32_t n_thread)
+{
+    struct seg_pool_metadata meta;
+    struct duration          d;
+    uint8_t                  *state;
+    bool                     dirty;
+    int64_t                  delta;
+    proc_time_i              min_create_at = 0;
+    uint64_t                 n_item;
+
+    duration_reset(&d);
+    duration_start(&d);
+
+    dirty = datapool_dirty(heap.pool);
+    datapool_get_user_data(heap.pool, &meta, sizeof(meta));
+    /* the create time of segs is relative to the start of the last run */
+    delta = meta.time_started - (int64_t)time_started();
+
+    state           = cc_zalloc(heap.max_nseg);
+    recover_seg_ids = cc_alloc(sizeof(int32_t) * heap.max_nseg);
+    if (state == NULL || recover_seg_ids == NULL) {
+        log_crit("cannot allocate memory to recover %" PRId32 " segs",
+            heap.max_nseg);
+        exit(EX_OSERR);
+    }
+    n_recover_seg = 0;
+
+    for (uint32_t i = 0; i < MAX_N_TTL_BUCKET; i++) {
+        recover_chain(i, dirty, &meta, delta, state);
+    }
+
+    /* everything else goes back to the free pool */
+    pthread_mutex_lock(&heap.mtx);
+    for (uint32_t i = 0; i < SEG_MAX_NUMA_NODE; i++) {
+        heap.free_seg_id[i] = -1;
+    }
+    heap.n_free_seg  = 0;
+    for (int32_t i = heap.max_nseg - 1; i >= 0; i--) {
+        if (state[i] == RECOVER_LINKED) {
+            continue;
+        }
+
+        heap.segs[i].seg_id     = i;
+        heap.segs[i].evictable  = 0;
+        heap.segs[i].accessible = 0;
+        heap.segs[i].local      = 0;
+        heap.segs[i].persisted  = 0;
+        seg_add_to_freepool(i, SEG_ALLOCATION);
+    }
+    pthread_mutex_unlock(&heap.mtx);
+    seg_persist(heap.segs, SEG_HDR_SIZE * heap.max_nseg);
+
+    cc_free(state);
+
+    /* keep the free segs which merges rely on */
+    for (uint32_t i = 0; heap.n_free_seg < heap.n_reserved_seg &&
+        n_recover_seg > 0; i = (i + 1) % MAX_N_TTL_BUCKET) {
+        struct ttl_bucket *ttl_bucket = &ttl_buckets[i];
+        int32_t           seg_id      = ttl_bucket->first_seg_id;
+
+        if (seg_id == -1) {
+            continue;
+        }
+
+        pthread_mutex_lock(&ttl_bucket->chain_mtx);
+        rm_seg_from_ttl_bucket(seg_id);
+        pthread_mutex_unlock(&ttl_bucket->chain_mtx);
+
+        heap.segs[seg_id].evictable = 0;
+        pthread_mutex_lock(&heap.mtx);
+        seg_add_to_freepool(seg_id, SEG_EVICTION);
+        pthread_mutex_unlock(&heap.mtx);
+
+        for (int32_t j = 0; j < n_recover_seg; j++) {
+            if (recover_seg_ids[j] == seg_id) {
+                recover_seg_ids[j] = recover_seg_ids[--n_recover_seg];
+                break;
+            }
+        }
+    }
+
+    for (int32_t i = 0; i < n_recover_seg; i++) {
+        min_create_at = MIN(min_create_at, heap.segs[recover_seg_ids[i]].create_at);
+    }
+    /* segs created before the flush have been dropped, and recovered segs
+     * may be created before the start of this run */
+    flush_at = MIN(-1, min_create_at - 1);
+
+    n_item = recover_hashtable(MAX(n_thread, 1));
+
+    cc_free(recover_seg_ids);
+    recover_seg_ids = NULL;
+
+    duration_stop(&d);
+
+    UPDATE_VAL(seg_metrics, seg_recover_seg, n_recover_seg);
+    UPDATE_VAL(seg_metrics, seg_recover_item, n_item);
+    UPDATE_VAL(seg_metrics, seg_recover_us, (uint64_t)duration_us(&d));
+
+    log_info("recovered %" PRId32 " segs and %" PRIu64 " items from %s "
+             "datapool in %.3f seconds, %" PRId32 " free segs", n_recover_seg,
+        n_item, dirty ? "dirty" : "clean", duration_sec(&d), heap.n_free_seg);
+}
+
+void
+seg_persist_setup(void)
+{
+    if (!heap.persistent) {
+        return;
+    }
+
+    persist_metadata();
+    datapool_set_crash_consistent(heap.pool);
+}
+
+void
+seg_persist_teardown(void)
+{
+    if (heap.pool == NULL) {
+        return;
+    }
+
+    persist_metadata();
+    datapool_close(heap.pool);
+
+    heap.pool          = NULL;
+    heap.base          = NULL;
+    heap.segs          = NULL;
+    heap.first_seg_ids = NULL;
+}
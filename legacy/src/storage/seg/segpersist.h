@@ -0,0 +1,103 @@
+#pragma once
+
+#include "seg.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/**
+ * When the datapool is backed by a file, e.g., on a DAX file system on PMem,
+ * the seg data, the seg headers and the first seg of each TTL bucket all
+ * live in the datapool, and are persisted such that the datapool can be
+ * recovered at any point, not only after the pool is closed correctly:
+ *
+ * 1. the header of a seg is persisted before the seg is linked into a TTL
+ *      bucket chain, and the link (the next seg of the previous seg, or the
+ *      first seg of the bucket) is persisted after
+ * 2. when a seg is removed from a chain, the link which skipped it is
+ *      persisted before the seg is reused
+ * 3. the data of a seg is persisted after it is sealed and no writer is left
+ *      on it, which is marked by the persisted bit of the seg header.
+ *      segs written by merge are persisted once the merge is done,
+ *      other segs are persisted by the background thread
+ * 4. deletes and in-place updates (incr/decr) are persisted as they happen
+ *
+ * After a crash, only the segs reachable from the first seg of each TTL
+ * bucket and persisted are recovered; after the datapool is closed
+ * correctly, all segs in the chains are recovered.
+ * Items of the recovered segs are inserted into the hash table by
+ * seg_recover_thread threads, each scanning a share of the segs.
+ **/
+
+
+/* flush a range of the heap to the datapool if it is persistent */
+static inline void
+seg_persist(const void *addr, size_t len)
+{
+    if (heap.persistent) {
+        datapool_persist(heap.pool, addr, len);
+    }
+}
+
+/* persist the header of the seg */
+static inline void
+seg_persist_hdr(int32_t seg_id)
+{
+    seg_persist(&heap.segs[seg_id], sizeof(struct seg));
+}
+
+/**
+ * persist the first seg of the TTL bucket, needs to be called after each
+ * change of the first seg, with the seg chain locked
+ */
+void
+seg_persist_first_seg(uint32_t ttl_bucket_idx);
+
+/**
+ * persist the data of a sealed seg, then mark it as persisted
+ */
+void
+seg_persist_data(int32_t seg_id);
+
+/**
+ * persist the data of the sealed segs which have not been persisted,
+ * called periodically by the background thread
+ */
+void
+seg_persist_sealed(void);
+
+/**
+ * persist the flush time, needs to be called after each flush
+ */
+void
+seg_persist_flush(void);
+
+/**
+ * check whether the segs in the datapool can be recovered, which requires
+ * the datapool to be created with the same heap layout
+ */
+bool
+seg_recoverable(void);
+
+/**
+ * rebuild the TTL bucket chains, the free pool and the hash table from the
+ * segs in the datapool, needs to be called after the TTL buckets and the
+ * hash table are set up
+ *
+ * @param n_thread the number of threads scanning segs
+ */
+void
+seg_recover(uint32_t n_thread);
+
+/**
+ * mark the datapool as crash-consistent, called once the heap is set up
+ */
+void
+seg_persist_setup(void);
+
+/**
+ * persist everything and close the datapool
+ */
+void
+seg_persist_teardown(void);
@@ -2,6 +2,7 @@
 #include "ttlbucket.h"
 #include "item.h"
 #include "seg.h"
+#include "segpersist.h"
 
 #include <pthread.h>
 #include <sys/errno.h>
@@ -9,7 +10,16 @@
 extern struct ttl_bucket     ttl_buckets[MAX_N_TTL_BUCKET];
 extern seg_metrics_st        *seg_metrics;
 extern seg_perttl_metrics_st perttl[MAX_N_TTL_BUCKET];
-__thread int32_t             local_last_seg[MAX_N_TTL_BUCKET] = {0};
+
+/* local seg requires reserving one seg per thread per active TTL bucket,
+ * which is expensive when there is no need for high scalability,
+ * Segcache can scale to 8 cores without turning this on */
+static bool                  use_local_seg = false;
+/* bumped at every setup, so that threads forget the segs they owned */
+static uint32_t              ttl_bucket_gen = 0;
+/* seg id + 1 of the seg owned by this thread in each TTL bucket, 0 if none */
+static __thread int32_t      local_last_seg[MAX_N_TTL_BUCKET] = {0};
+static __thread uint32_t     local_last_seg_gen = 0;
 
 
 /* reserve the size of an incoming item in the last segment of the TTL bucket,
@@ -18,12 +28,8 @@ __thread int32_t             local_last_seg[MAX_N_TTL_BUCKET] = {0};
  * seg_id is used to return the id of the segment which the object will be
  * written to
  */
-#ifndef USE_THREAD_LOCAL_SEG
-/* use thread local seg requires reserving one seg per thread per active TTL
- * bucket, which is expensive when there is no need for high scalability,
- * Segcache can scale to 8 cores without turning this on */
-struct item *
-ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
+static struct item *
+_reserve_item_shared(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
 {
     struct item       *it;
     struct ttl_bucket *ttl_bucket = &ttl_buckets[ttl_bucket_idx];
@@ -83,8 +89,7 @@ ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
         new_seg = &heap.segs[new_seg_id];
         new_seg->ttl = ttl_bucket->ttl;
 
-        /* TODO(juncheng): update to TTL lock */
-        if (pthread_mutex_lock(&heap.mtx) != 0) {
+        if (pthread_mutex_lock(&ttl_bucket->chain_mtx) != 0) {
             log_error("unable to lock mutex");
             return NULL;
         }
@@ -98,23 +103,29 @@ ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
             /* roll back */
             INCR(seg_metrics, seg_return);
 
+            pthread_mutex_lock(&heap.mtx);
             seg_add_to_freepool(new_seg_id, SEG_CONCURRENT_GET);
+            pthread_mutex_unlock(&heap.mtx);
             new_seg_id = ttl_bucket->last_seg_id;
 
         }
         else {
-            /* last seg has not changed */
+            /* last seg has not changed,
+             * the new seg is persisted before it is linked */
+            seg_persist_hdr(new_seg_id);
             if (ttl_bucket->first_seg_id == -1) {
                 /* the first seg of the bucket */
                 ASSERT(ttl_bucket->last_seg_id == -1);
 
                 ttl_bucket->first_seg_id = new_seg_id;
+                seg_persist_first_seg(ttl_bucket_idx);
             }
             else {
                 ASSERT(curr_seg != NULL);
                 ASSERT(ttl_bucket->last_seg_id != -1);
 
                 heap.segs[curr_seg_id].next_seg_id = new_seg_id;
+                seg_persist_hdr(curr_seg_id);
             }
 
             /* it prev seg has a short TTL and has expired,
@@ -146,7 +157,7 @@ ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
                 ttl_bucket->first_seg_id, ttl_bucket->last_seg_id);
         }
 
-        pthread_mutex_unlock(&heap.mtx);
+        pthread_mutex_unlock(&ttl_bucket->chain_mtx);
 
         curr_seg_id = new_seg_id;
         curr_seg    = &heap.segs[curr_seg_id];
@@ -166,9 +177,15 @@ ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
 
     return it;
 }
-#else
-struct item *
-ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
+/* reserve the item in the seg which this thread owns in the TTL bucket,
+ * so that appends do not contend with other threads, and a full seg is never
+ * raced for and given back to the free pool.
+ *
+ * the seg is linked to the seg chain as soon as it is taken, but it is not
+ * evictable and is skipped by expiration until this thread moves on to a new
+ * seg, so that it is not reused while this thread may still write to it */
+static struct item *
+_reserve_item_local(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
 {
     struct item       *it;
     struct ttl_bucket *ttl_bucket = &ttl_buckets[ttl_bucket_idx];
@@ -179,61 +196,35 @@ ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
     int32_t offset     = 0; /* offset of the reserved item in the seg */
     uint8_t accessible = false;
 
+    if (local_last_seg_gen != ttl_bucket_gen) {
+        /* the segs owned before the last setup are gone */
+        local_last_seg_gen = ttl_bucket_gen;
+        memset(local_last_seg, 0, sizeof(local_last_seg));
+    }
+
     curr_seg_id = local_last_seg[ttl_bucket_idx] - 1;
 
     if (curr_seg_id != -1) {
         curr_seg   = &heap.segs[curr_seg_id];
         accessible = seg_is_accessible(curr_seg_id);
-        if (accessible) {
-            offset = curr_seg->write_offset;
-        }
+        offset     = curr_seg->write_offset;
     }
 
     if (curr_seg_id == -1 || offset + sz > heap.seg_size || (!accessible)) {
-        if (offset + sz > heap.seg_size) {
-            ASSERT(offset <= heap.seg_size);
-            seg_data = get_seg_data_start(curr_seg_id);
-            memset(seg_data + offset, 0, heap.seg_size - offset);
-        }
-
         if (curr_seg_id != -1) {
-            /* curr seg is not linked to segment chain at this time,
-             * link it now */
-            if (pthread_mutex_lock(&heap.mtx) != 0) {
-                log_error("unable to lock mutex");
-                return NULL;
-            }
-
-            /* last seg id could be -1 */
-            if (ttl_bucket->first_seg_id == -1) {
-                ASSERT(ttl_bucket->last_seg_id == -1);
-
-                ttl_bucket->first_seg_id = curr_seg_id;
+            if (offset + sz > heap.seg_size && offset < heap.seg_size) {
+                /* mark the end of seg, segs are not zeroed at init */
+                seg_data = get_seg_data_start(curr_seg_id);
+                memset(seg_data + offset, 0, heap.seg_size - offset);
             }
-            else {
-                heap.segs[ttl_bucket->last_seg_id].next_seg_id = curr_seg_id;
-            }
-
-            curr_seg->prev_seg_id   = ttl_bucket->last_seg_id;
-            ttl_bucket->last_seg_id = curr_seg_id;
-            ASSERT(curr_seg->next_seg_id == -1);
-
-            ttl_bucket->n_seg += 1;
 
+            /* hand the seg over to expiration and eviction */
+            curr_seg->local = 0;
             bool evictable = __atomic_exchange_n(
                 &curr_seg->evictable, 1, __ATOMIC_RELAXED);
             ASSERT(evictable == 0);
 
-            PERTTL_INCR(ttl_bucket_idx, seg_curr);
-
-            log_debug("link seg %d (offset %d occupied_size %d) to "
-                      "ttl bucket %d, total %d segments, "
-                      "prev seg %d, first seg %d, last seg %d",
-                curr_seg_id, curr_seg->write_offset, curr_seg->live_bytes,
-                ttl_bucket_idx, ttl_bucket->n_seg, curr_seg->prev_seg_id,
-                ttl_bucket->first_seg_id, ttl_bucket->last_seg_id);
-
-            pthread_mutex_unlock(&heap.mtx);
+            local_last_seg[ttl_bucket_idx] = 0;
         }
 
         curr_seg_id = seg_get_new();
@@ -245,10 +236,45 @@ ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
             return NULL;
         }
 
-        local_last_seg[ttl_bucket_idx] = curr_seg_id + 1;
         curr_seg = &heap.segs[curr_seg_id];
-        curr_seg->ttl         = ttl_bucket->ttl;
-        curr_seg->next_seg_id = -1;
+        curr_seg->ttl   = ttl_bucket->ttl;
+        curr_seg->local = 1;
+
+        if (pthread_mutex_lock(&ttl_bucket->chain_mtx) != 0) {
+            log_error("unable to lock mutex");
+            return NULL;
+        }
+
+        /* last seg id could be -1 */
+        seg_persist_hdr(curr_seg_id);
+        if (ttl_bucket->first_seg_id == -1) {
+            ASSERT(ttl_bucket->last_seg_id == -1);
+
+            ttl_bucket->first_seg_id = curr_seg_id;
+            seg_persist_first_seg(ttl_bucket_idx);
+        }
+        else {
+            heap.segs[ttl_bucket->last_seg_id].next_seg_id = curr_seg_id;
+            seg_persist_hdr(ttl_bucket->last_seg_id);
+        }
+
+        curr_seg->prev_seg_id   = ttl_bucket->last_seg_id;
+        ttl_bucket->last_seg_id = curr_seg_id;
+        ASSERT(curr_seg->next_seg_id == -1);
+
+        ttl_bucket->n_seg += 1;
+
+        log_debug("link local seg %d to ttl bucket %d, total %d segments, "
+                  "prev seg %d, first seg %d, last seg %d",
+            curr_seg_id, ttl_bucket_idx, ttl_bucket->n_seg,
+            curr_seg->prev_seg_id, ttl_bucket->first_seg_id,
+            ttl_bucket->last_seg_id);
+
+        pthread_mutex_unlock(&ttl_bucket->chain_mtx);
+
+        PERTTL_INCR(ttl_bucket_idx, seg_curr);
+
+        local_last_seg[ttl_bucket_idx] = curr_seg_id + 1;
         offset = curr_seg->write_offset;
     }
 
@@ -262,16 +288,28 @@ ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
 
     return it;
 }
-#endif
+
+struct item *
+ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id)
+{
+    if (use_local_seg) {
+        return _reserve_item_local(ttl_bucket_idx, sz, seg_id);
+    }
+
+    return _reserve_item_shared(ttl_bucket_idx, sz, seg_id);
+}
 
 void
-ttl_bucket_setup(void)
+ttl_bucket_setup(bool local_seg)
 {
     struct ttl_bucket *ttl_bucket;
 
     delta_time_i ttl_bucket_intvls[] = {TTL_BUCKET_INTVL1, TTL_BUCKET_INTVL2,
                                         TTL_BUCKET_INTVL3, TTL_BUCKET_INTVL4};
 
+    use_local_seg = local_seg;
+    ttl_bucket_gen++;
+
     for (uint32_t i = 0; i < 4; i++) {
         for (uint32_t j = 0; j < N_BUCKET_PER_STEP; j++) {
             ttl_bucket = &(ttl_buckets[i * N_BUCKET_PER_STEP + j]);
@@ -282,6 +320,7 @@ ttl_bucket_setup(void)
             ttl_bucket->next_seg_to_merge = -1;
             ttl_bucket->last_cutoff_freq  = 0;
             pthread_mutex_init(&(ttl_bucket->mtx), NULL);
+            pthread_mutex_init(&(ttl_bucket->chain_mtx), NULL);
         }
     }
 }
@@ -110,7 +110,8 @@ struct ttl_bucket {
     uint32_t            n_seg;
     int32_t             next_seg_to_merge;
     delta_time_i        last_cutoff_freq;
-    pthread_mutex_t     mtx;
+    pthread_mutex_t     mtx;           /* serializes merges on the bucket */
+    pthread_mutex_t     chain_mtx;     /* protects the seg chain */
 };
 
 
@@ -149,8 +150,12 @@ find_ttl_bucket_idx(delta_time_i ttl)
 }
 
 
+/**
+ * @param local_seg whether each thread writes to its own seg in each TTL
+ * bucket, instead of all threads sharing the last seg of the bucket
+ */
 void
-ttl_bucket_setup(void);
+ttl_bucket_setup(bool local_seg);
 
 void
 ttl_bucket_teardown(void);
@@ -161,6 +166,7 @@ ttl_bucket_teardown(void);
  * we will get an empty segment
  * then link the seg into ttl_bucket, make it the current active seg.
  *
+ * With local segs, the active segment is the one owned by this thread.
  */
 struct item *
 ttl_bucket_reserve_item(int32_t ttl_bucket_idx, size_t sz, int32_t *seg_id);
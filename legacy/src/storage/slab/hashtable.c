@@ -1,10 +1,18 @@
 #include "slab.h"
+#include "slabmem.h"
 
 #include <hash/cc_murmur3.h>
 #include <cc_mm.h>
 
+#define STRIPE_NONE UINT32_MAX
+#define STRIPE(ht, hv) ((hv) & HASHMASK((ht)->stripe_power))
+
 static uint32_t murmur3_iv = 0x3ac5d673;
 
+static __thread uint32_t held = STRIPE_NONE;  /* stripe locked by the thread */
+static __thread uint32_t tried = STRIPE_NONE; /* stripe tried by the thread */
+static __thread bool held_all = false;        /* all stripes locked */
+
 /*
  * Allocate table given size
  */
@@ -12,11 +20,14 @@ static struct item_slh *
 _hashtable_alloc(uint64_t size)
 {
     struct item_slh *table;
-    uint32_t i;
+    uint64_t i;
 
     table = cc_alloc(sizeof(*table) * size);
 
     if (table != NULL) {
+        /* a large table is mapped afresh, so it is placed before it is
+         * first touched */
+        slabmem_place(table, sizeof(*table) * size);
         for (i = 0; i < size; ++i) {
             SLIST_INIT(&table[i]);
         }
@@ -25,13 +36,27 @@ _hashtable_alloc(uint64_t size)
     return table;
 }
 
+static void
+_hashtable_set_nexpand(struct hash_table *ht)
+{
+    double nexpand = ht->load_factor * HASHSIZE(ht->hash_power);
+
+    if (ht->load_factor == 0 || ht->hash_power >= HASH_POWER_MAX ||
+            nexpand >= UINT32_MAX) {
+        ht->nexpand_item = UINT32_MAX;
+    } else {
+        ht->nexpand_item = (uint32_t)nexpand;
+    }
+}
+
 struct hash_table *
-hashtable_create(uint32_t hash_power)
+hashtable_create(uint32_t hash_power, double load_factor, bool concurrent)
 {
     struct hash_table *ht;
-    uint64_t size;
+    uint64_t size, i;
 
-    ASSERT(hash_power > 0);
+    ASSERT(hash_power > 0 && hash_power <= HASH_POWER_MAX);
+    ASSERT(load_factor >= 0);
 
     /* alloc struct */
     ht = cc_alloc(sizeof(struct hash_table));
@@ -42,9 +67,17 @@ hashtable_create(uint32_t hash_power)
 
     /* init members */
     ht->table = NULL;
+    ht->old_table = NULL;
+    ht->migrate_idx = 0;
     ht->hash_power = hash_power;
+    ht->load_factor = load_factor;
     ht->nhash_item = 0;
+    _hashtable_set_nexpand(ht);
     size = HASHSIZE(ht->hash_power);
+    ht->stripe = NULL;
+    ht->stripe_power = hash_power < HASH_STRIPE_POWER ? hash_power :
+            HASH_STRIPE_POWER;
+    pthread_mutex_init(&ht->mtx, NULL);
 
     /* alloc table */
     ht->table = _hashtable_alloc(size);
@@ -53,6 +86,21 @@ hashtable_create(uint32_t hash_power)
         return NULL;
     }
 
+    if (concurrent) {
+        ht->stripe = cc_alloc(sizeof(*ht->stripe) *
+                HASHSIZE(ht->stripe_power));
+        if (ht->stripe == NULL) {
+            cc_free(ht->table);
+            cc_free(ht);
+            return NULL;
+        }
+        for (i = 0; i < HASHSIZE(ht->stripe_power); ++i) {
+            pthread_mutex_init(&ht->stripe[i], NULL);
+        }
+    }
+
+    UPDATE_VAL(slab_metrics, hash_power, hash_power);
+
     return ht;
 }
 
@@ -60,23 +108,179 @@ void
 hashtable_destroy(struct hash_table **ht_p)
 {
     struct hash_table *ht = *ht_p;
-    if (ht != NULL && ht->table != NULL) {
+    uint64_t i;
+
+    if (ht != NULL) {
+        if (ht->stripe != NULL) {
+            for (i = 0; i < HASHSIZE(ht->stripe_power); ++i) {
+                pthread_mutex_destroy(&ht->stripe[i]);
+            }
+            cc_free(ht->stripe);
+        }
+        pthread_mutex_destroy(&ht->mtx);
         cc_free(ht->table);
+        cc_free(ht->old_table);
+        cc_free(ht);
     }
 
     *ht_p = NULL;
 }
 
-static struct item_slh *
-_get_bucket(const char *key, size_t klen, struct hash_table *ht)
+static inline uint32_t
+_get_hv(const char *key, size_t klen)
 {
     uint32_t hv;
 
     hash_murmur3_32(key, klen, murmur3_iv, &hv);
 
+    return hv;
+}
+
+/*
+ * The old table and the migrated buckets change while other threads hold
+ * other stripes, but not the state of a bucket whose stripe the caller holds.
+ */
+static inline struct item_slh *
+_old_table(struct hash_table *ht)
+{
+    return __atomic_load_n(&ht->old_table, __ATOMIC_ACQUIRE);
+}
+
+static struct item_slh *
+_get_bucket(const char *key, size_t klen, struct hash_table *ht)
+{
+    uint32_t hv = _get_hv(key, klen);
+    struct item_slh *old_table = _old_table(ht);
+    uint64_t idx;
+
+    if (old_table != NULL) {
+        idx = hv & HASHMASK(ht->hash_power - 1);
+        if (idx >= __atomic_load_n(&ht->migrate_idx, __ATOMIC_ACQUIRE)) {
+            return &old_table[idx];
+        }
+    }
+
     return &(ht->table[hv & HASHMASK(ht->hash_power)]);
 }
 
+static inline bool
+_stripe_held(struct hash_table *ht, uint32_t s)
+{
+    return ht->stripe == NULL || held_all || s == held || s == tried;
+}
+
+/*
+ * Migrate up to nbucket buckets from the old table to the new one, the old
+ * table is freed once all of its buckets are migrated. If the table is shared,
+ * migration stops at a bucket whose stripe is held by another thread, and is
+ * skipped while another thread migrates, unless all stripes are held.
+ */
+static void
+_hashtable_migrate(struct hash_table *ht, uint64_t nbucket)
+{
+    uint64_t old_size = HASHSIZE(ht->hash_power - 1);
+    struct item_slh *bucket;
+    struct item *it;
+    uint32_t s;
+    bool locked;
+
+    ASSERT(ht->old_table != NULL);
+
+    if (ht->stripe != NULL) {
+        if (held_all) {
+            pthread_mutex_lock(&ht->mtx);
+        } else if (pthread_mutex_trylock(&ht->mtx) != 0) {
+            return;
+        }
+    }
+
+    for (; nbucket > 0 && ht->migrate_idx < old_size; nbucket--) {
+        s = STRIPE(ht, ht->migrate_idx);
+        locked = !_stripe_held(ht, s);
+        if (locked && pthread_mutex_trylock(&ht->stripe[s]) != 0) {
+            break;
+        }
+
+        bucket = &ht->old_table[ht->migrate_idx];
+        while ((it = SLIST_FIRST(bucket)) != NULL) {
+            SLIST_REMOVE_HEAD(bucket, i_sle);
+            SLIST_INSERT_HEAD(&ht->table[_get_hv(item_key(it), it->klen) &
+                    HASHMASK(ht->hash_power)], it, i_sle);
+        }
+        __atomic_store_n(&ht->migrate_idx, ht->migrate_idx + 1,
+                __ATOMIC_RELEASE);
+        INCR(slab_metrics, hash_migrate);
+
+        if (locked) {
+            pthread_mutex_unlock(&ht->stripe[s]);
+        }
+    }
+
+    if (ht->migrate_idx == old_size) {
+        cc_free(ht->old_table);
+        __atomic_store_n(&ht->old_table, NULL, __ATOMIC_RELEASE);
+
+        log_info("hash table expanded to power %"PRIu32" with %"PRIu32" items",
+                ht->hash_power, ht->nhash_item);
+    }
+
+    if (ht->stripe != NULL) {
+        pthread_mutex_unlock(&ht->mtx);
+    }
+}
+
+/*
+ * Start expanding the hash table to the next power of 2, the buckets of the
+ * current table are migrated incrementally by later updates.
+ */
+static void
+_hashtable_expand(struct hash_table *ht)
+{
+    struct item_slh *table;
+
+    ASSERT(ht->old_table == NULL);
+    ASSERT(ht->hash_power < HASH_POWER_MAX);
+
+    table = _hashtable_alloc(HASHSIZE(ht->hash_power + 1));
+    if (table == NULL) {
+        /* try again once the table is twice as loaded */
+        log_warn("cannot expand hash table to power %"PRIu32" with %"PRIu32
+                " items", ht->hash_power + 1, ht->nhash_item);
+        ht->nexpand_item = ht->nexpand_item > UINT32_MAX / 2 ? UINT32_MAX :
+                ht->nexpand_item * 2;
+        return;
+    }
+
+    log_info("expanding hash table to power %"PRIu32" with %"PRIu32" items",
+            ht->hash_power + 1, ht->nhash_item);
+
+    ht->old_table = ht->table;
+    ht->table = table;
+    ht->migrate_idx = 0;
+    ht->hash_power++;
+    _hashtable_set_nexpand(ht);
+
+    INCR(slab_metrics, hash_expand);
+    UPDATE_VAL(slab_metrics, hash_power, ht->hash_power);
+}
+
+/* whether the table is above its load, and not already being expanded */
+static inline bool
+_hashtable_full(struct hash_table *ht)
+{
+    return _old_table(ht) == NULL &&
+            __atomic_load_n(&ht->nhash_item, __ATOMIC_RELAXED) >=
+            __atomic_load_n(&ht->nexpand_item, __ATOMIC_RELAXED);
+}
+
+void
+hashtable_migrate_all(struct hash_table *ht)
+{
+    if (_old_table(ht) != NULL) {
+        _hashtable_migrate(ht, HASHSIZE(ht->hash_power - 1));
+    }
+}
+
 void
 hashtable_put(struct item *it, struct hash_table *ht)
 {
@@ -84,10 +288,17 @@ hashtable_put(struct item *it, struct hash_table *ht)
 
     ASSERT(hashtable_get(item_key(it), it->klen, ht) == NULL);
 
+    if (_old_table(ht) != NULL) {
+        _hashtable_migrate(ht, HASHTABLE_NMIGRATE);
+    } else if (ht->stripe == NULL && _hashtable_full(ht)) {
+        /* a shared table is expanded in hashtable_unlock */
+        _hashtable_expand(ht);
+    }
+
     bucket = _get_bucket(item_key(it), it->klen, ht);
     SLIST_INSERT_HEAD(bucket, it, i_sle);
 
-    ++(ht->nhash_item);
+    __atomic_add_fetch(&ht->nhash_item, 1, __ATOMIC_RELAXED);
     INCR(slab_metrics, hash_insert);
 }
 
@@ -99,6 +310,10 @@ hashtable_delete(const char *key, uint32_t klen, struct hash_table *ht)
 
     ASSERT(hashtable_get(key, klen, ht) != NULL);
 
+    if (_old_table(ht) != NULL) {
+        _hashtable_migrate(ht, HASHTABLE_NMIGRATE);
+    }
+
     bucket = _get_bucket(key, klen, ht);
     for (prev = NULL, it = SLIST_FIRST(bucket); it != NULL;
         prev = it, it = SLIST_NEXT(it, i_sle)) {
@@ -117,7 +332,7 @@ hashtable_delete(const char *key, uint32_t klen, struct hash_table *ht)
         SLIST_REMOVE_AFTER(prev, i_sle);
     }
 
-    --(ht->nhash_item);
+    __atomic_sub_fetch(&ht->nhash_item, 1, __ATOMIC_RELAXED);
     INCR(slab_metrics, hash_remove);
 }
 
@@ -146,42 +361,105 @@ hashtable_get(const char *key, uint32_t klen, struct hash_table *ht)
     return NULL;
 }
 
-/*
- * Expand the hashtable to the next power of 2.
- * This is an expensive operation and should _not_ be used in production or
- * during latency-related tests. It is included mostly for simulation around
- * the storage component.
- */
-struct hash_table *
-hashtable_double(struct hash_table *ht)
+void
+hashtable_lock(const char *key, uint32_t klen, struct hash_table *ht)
 {
-    struct hash_table *new_ht;
-    uint32_t new_hash_power;
-    uint64_t new_size;
+    if (ht->stripe == NULL) {
+        return;
+    }
 
-    new_hash_power = ht->hash_power + 1;
-    new_size = HASHSIZE(new_hash_power);
+    ASSERT(held == STRIPE_NONE && !held_all);
+
+    held = STRIPE(ht, _get_hv(key, klen));
+    pthread_mutex_lock(&ht->stripe[held]);
+}
 
-    new_ht = hashtable_create(new_size);
-    if (new_ht == NULL) {
-        return ht;
+void
+hashtable_unlock(struct hash_table *ht)
+{
+    if (ht->stripe == NULL) {
+        return;
     }
 
-    /* copy to new hash table */
-    for  (uint32_t i = 0; i < HASHSIZE(ht->hash_power); ++i) {
-        struct item *it, *next;
-        struct item_slh *bucket, *new_bucket;
+    ASSERT(held != STRIPE_NONE);
+
+    pthread_mutex_unlock(&ht->stripe[held]);
+    held = STRIPE_NONE;
 
-        bucket = &ht->table[i];
-        SLIST_FOREACH_SAFE(it, bucket, i_sle, next) {
-            new_bucket = _get_bucket(item_key(it), it->klen, new_ht);
-            SLIST_REMOVE(bucket, it, item, i_sle);
-            SLIST_INSERT_HEAD(new_bucket, it, i_sle);
+    /* expand with no stripe held, as it waits for all of them */
+    if (_hashtable_full(ht)) {
+        hashtable_lock_all(ht);
+        pthread_mutex_lock(&ht->mtx);
+        if (_hashtable_full(ht)) {
+            _hashtable_expand(ht);
         }
+        pthread_mutex_unlock(&ht->mtx);
+        hashtable_unlock_all(ht);
     }
+}
+
+bool
+hashtable_trylock(const char *key, uint32_t klen, struct hash_table *ht)
+{
+    uint32_t s;
+
+    if (ht->stripe == NULL) {
+        return true;
+    }
+
+    ASSERT(tried == STRIPE_NONE);
+
+    s = STRIPE(ht, _get_hv(key, klen));
+    if (_stripe_held(ht, s)) {
+        return true;
+    }
+    if (pthread_mutex_trylock(&ht->stripe[s]) != 0) {
+        return false;
+    }
+    tried = s;
+
+    return true;
+}
+
+void
+hashtable_untry(struct hash_table *ht)
+{
+    if (tried != STRIPE_NONE) {
+        pthread_mutex_unlock(&ht->stripe[tried]);
+        tried = STRIPE_NONE;
+    }
+}
+
+void
+hashtable_lock_all(struct hash_table *ht)
+{
+    uint64_t s;
 
-    hashtable_destroy(&ht);
+    if (ht->stripe == NULL) {
+        return;
+    }
+
+    ASSERT(held == STRIPE_NONE && !held_all);
 
-    return new_ht;
+    for (s = 0; s < HASHSIZE(ht->stripe_power); ++s) {
+        pthread_mutex_lock(&ht->stripe[s]);
+    }
+    held_all = true;
 }
 
+void
+hashtable_unlock_all(struct hash_table *ht)
+{
+    uint64_t s;
+
+    if (ht->stripe == NULL) {
+        return;
+    }
+
+    ASSERT(held_all);
+
+    for (s = 0; s < HASHSIZE(ht->stripe_power); ++s) {
+        pthread_mutex_unlock(&ht->stripe[s]);
+    }
+    held_all = false;
+}
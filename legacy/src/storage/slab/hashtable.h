@@ -2,21 +2,67 @@
 
 #include "item.h"
 
+#include <pthread.h>
+
+/*
+ * The hash table is expanded incrementally: once the number of items exceeds
+ * load_factor per bucket, a table of twice the size is allocated, and every
+ * update migrates a few buckets from the old table to the new one. Buckets
+ * below migrate_idx in the old table have been migrated, so a key is looked
+ * up in the old table if its bucket there is not yet migrated, and in the new
+ * table otherwise.
+ *
+ * When the table is shared by threads, buckets are guarded by stripes of
+ * mutexes, the stripe of a key being the low bits of its hash value. As there
+ * are no more stripes than buckets in the old table, all items of a bucket
+ * share a stripe, and moving a bucket to the new table keeps its stripe. A
+ * thread holds the stripe of a key while it looks up or changes the key.
+ * Migrating a bucket takes its stripe with a try-lock, leaving the bucket to a
+ * later update if the stripe is held. Expanding the table remaps every bucket,
+ * so it takes all stripes, which is done once the thread which saw the table
+ * above its load has released its own.
+ */
 struct hash_table {
-    struct item_slh *table;
+    struct item_slh *table;         /* table sized by hash_power */
+    struct item_slh *old_table;     /* table being migrated, NULL if none */
+    uint64_t migrate_idx;           /* next bucket to migrate in old_table */
     uint32_t nhash_item;
+    uint32_t nexpand_item;          /* # items beyond which to expand */
     uint32_t hash_power;
+    double load_factor;             /* 0 to never expand */
+    pthread_mutex_t *stripe;        /* stripe locks, NULL if not shared */
+    uint32_t stripe_power;
+    pthread_mutex_t mtx;            /* serializes migration */
 };
 
 #define HASHSIZE(_n) (1ULL << (_n))
 #define HASHMASK(_n) (HASHSIZE(_n) - 1)
 
-struct hash_table *hashtable_create(uint32_t hash_power);
+#define HASH_POWER_MAX      32  /* the hash value is 32-bit */
+#define HASHTABLE_NMIGRATE  4   /* # buckets migrated per update */
+#define HASH_STRIPE_POWER   10  /* max # stripes (power of 2) of buckets */
+
+struct hash_table *hashtable_create(uint32_t hash_power, double load_factor,
+        bool concurrent);
 void hashtable_destroy(struct hash_table **ht_p);
 
 void hashtable_put(struct item *it, struct hash_table *ht);
 void hashtable_delete(const char *key, uint32_t klen, struct hash_table *ht);
 struct item *hashtable_get(const char *key, uint32_t klen, struct hash_table *ht);
 
+/* finish migrating the old table if the hash table is being expanded */
+void hashtable_migrate_all(struct hash_table *ht);
 
-struct hash_table *hashtable_double(struct hash_table *ht); /* best effort expansion */
+/*
+ * Stripes are only locked if the table is shared. A thread holds at most one
+ * stripe with hashtable_lock, and may try one more with hashtable_trylock,
+ * which succeeds at once if the thread already holds it. Holding all stripes
+ * excludes every other thread from the table: hashtable_lock_all waits for
+ * them, and must not be called with a stripe or any other lock held.
+ */
+void hashtable_lock(const char *key, uint32_t klen, struct hash_table *ht);
+void hashtable_unlock(struct hash_table *ht);
+bool hashtable_trylock(const char *key, uint32_t klen, struct hash_table *ht);
+void hashtable_untry(struct hash_table *ht);
+void hashtable_lock_all(struct hash_table *ht);
+void hashtable_unlock_all(struct hash_table *ht);
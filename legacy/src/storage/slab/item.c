@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+/* set in the refcount of an unlinked item, which is freed when unpinned */
+#define ITEM_UNLINKED 0x80000000u
+
 extern delta_time_i max_ttl;
 proc_time_i flush_at = -1;
 
@@ -33,6 +36,8 @@ item_hdr_init(struct item *it, uint32_t offset, uint8_t id)
     it->offset = offset;
     it->id = id;
     it->is_linked = it->in_freeq = it->is_raligned = 0;
+    it->accessed = 0;
+    it->refcount = 0;
 }
 
 static inline void
@@ -41,6 +46,8 @@ _item_reset(struct item *it)
     it->is_linked = 0;
     it->in_freeq = 0;
     it->is_raligned = 0;
+    it->accessed = 0;
+    it->refcount = 0;
     it->vlen = 0;
     it->klen = 0;
     it->olen = 0;
@@ -175,6 +182,21 @@ _item_unlink(struct item *it)
     PERSLAB_DECR_N(it->id, item_val_byte, it->vlen);
 }
 
+static void
+_item_delete(struct item **it)
+{
+    log_verb("delete it %p of id %"PRIu8, *it, (*it)->id);
+
+    _item_unlink(*it);
+
+    /* a pinned item is freed by the last item_unpin instead */
+    if (!slab_concurrent || __atomic_fetch_or(&(*it)->refcount, ITEM_UNLINKED,
+                __ATOMIC_ACQ_REL) == 0) {
+        _item_dealloc(it);
+    }
+    *it = NULL;
+}
+
 /**
  * Return an item if it hasn't been marked as expired, lazily expiring
  * item as-and-when needed
@@ -195,13 +217,17 @@ item_get(const struct bstring *key)
 
     if (_item_expired(it)) {
         log_verb("get it '%.*s' expired and nuked", key->len, key->data);
-        _item_unlink(it);
-        _item_dealloc(&it);
+        _item_delete(&it);
         return NULL;
     }
 
     log_verb("get it %p of id %"PRIu8, it, it->id);
 
+    /* only written when unset, so hits on hot items don't dirty the header */
+    if (!it->accessed) {
+        it->accessed = 1;
+    }
+
     return it;
 }
 
@@ -289,7 +315,7 @@ item_annex(struct item *oit, const struct bstring *key, const struct bstring
          * the existing data. Otherwise, allocate a new item and store the
          * payload left-aligned.
          */
-        if (id == oit->id && !(oit->is_raligned)) {
+        if (id == oit->id && !(oit->is_raligned) && !item_pinned(oit)) {
             cc_memcpy(item_data(oit) + oit->vlen, val->data, val->len);
             oit->vlen = ntotal;
             INCR_N(slab_metrics, item_keyval_byte, val->len);
@@ -317,7 +343,7 @@ item_annex(struct item *oit, const struct bstring *key, const struct bstring
          * data. Otherwise, allocate a new item and store the payload
          * right-aligned, assuming more prepends will happen in the future.
          */
-        if (id == oit->id && oit->is_raligned) {
+        if (id == oit->id && oit->is_raligned && !item_pinned(oit)) {
             cc_memcpy(item_data(oit) - val->len, val->data, val->len);
             oit->vlen = ntotal;
             INCR_N(slab_metrics, item_keyval_byte, val->len);
@@ -360,15 +386,6 @@ item_update(struct item *it, const struct bstring *val)
     log_verb("update it %p of id %"PRIu8, it, it->id);
 }
 
-static void
-_item_delete(struct item **it)
-{
-    log_verb("delete it %p of id %"PRIu8, *it, (*it)->id);
-
-    _item_unlink(*it);
-    _item_dealloc(it);
-}
-
 bool
 item_delete(const struct bstring *key)
 {
@@ -384,6 +401,41 @@ item_delete(const struct bstring *key)
     }
 }
 
+/*
+ * An item which was accessed since the CLOCK hand last passed it gets a second
+ * chance, and is only evicted the next time around unless it is accessed again.
+ * Expired items are evicted right away. If the heap is shared, the hand passes
+ * items of any key, so an item is skipped if its key is locked by another
+ * thread, or if it is pinned.
+ */
+bool
+item_reclaim(struct item *it)
+{
+    bool reclaimed = false;
+
+    if (!it->is_linked || !hashtable_trylock(item_key(it), it->klen,
+                hash_table)) {
+        return false;
+    }
+
+    if (!it->is_linked || item_pinned(it)) {
+        /* unlinked or read by another thread since it was checked */
+    } else if (it->accessed && !_item_expired(it)) {
+        it->accessed = 0;
+    } else {
+        log_verb("reclaim it %p of id %"PRIu8" at offset %"PRIu32, it, it->id,
+                it->offset);
+
+        INCR(slab_metrics, item_evict);
+        _item_delete(&it);
+        reclaimed = true;
+    }
+
+    hashtable_untry(hash_table);
+
+    return reclaimed;
+}
+
 void
 item_flush(void)
 {
@@ -396,9 +448,14 @@ item_flush(void)
 size_t
 item_expire(struct bstring *prefix)
 {
-    uint32_t nbucket = HASHSIZE(hash_table->hash_power);
+    uint32_t nbucket;
     size_t nkey, klen, vlen;
 
+    /* scan a single table, which no other thread uses meanwhile */
+    hashtable_lock_all(hash_table);
+    hashtable_migrate_all(hash_table);
+    nbucket = HASHSIZE(hash_table->hash_power);
+
     log_info("start scanning all %"PRIu32" keys", hash_table->nhash_item);
 
     nkey = 0;
@@ -423,8 +480,71 @@ item_expire(struct bstring *prefix)
         }
     }
 
+    hashtable_unlock_all(hash_table);
+
     log_info("finish scanning all keys");
 
     return nkey;
 }
 
+void
+item_lock(const struct bstring *key)
+{
+    hashtable_lock(key->data, key->len, hash_table);
+}
+
+void
+item_unlock(void)
+{
+    hashtable_unlock(hash_table);
+}
+
+struct item *
+item_borrow(const struct bstring *key)
+{
+    struct item *it;
+
+    if (!slab_concurrent) {
+        return item_get(key);
+    }
+
+    hashtable_lock(key->data, key->len, hash_table);
+    it = item_get(key);
+    if (it != NULL) {
+        item_pin(it);
+    }
+    hashtable_unlock(hash_table);
+
+    return it;
+}
+
+void
+item_return(struct item *it)
+{
+    if (slab_concurrent && it != NULL) {
+        item_unpin(it);
+    }
+}
+
+void
+item_pin(struct item *it)
+{
+    if (slab_concurrent) {
+        __atomic_add_fetch(&it->refcount, 1, __ATOMIC_RELAXED);
+    }
+    slab_ref(item_to_slab(it));
+}
+
+void
+item_unpin(struct item *it)
+{
+    struct slab *slab = item_to_slab(it);
+
+    /* free the item before releasing its slab, which may then be evicted */
+    if (slab_concurrent && __atomic_sub_fetch(&it->refcount, 1,
+                __ATOMIC_ACQ_REL) == ITEM_UNLINKED) {
+        _item_dealloc(&it);
+    }
+    slab_deref(slab);
+}
+
@@ -69,7 +69,8 @@ struct item {
     uint8_t           id;            /* slab class id */
     uint8_t           klen;          /* key length */
     uint8_t           olen;          /* optional length (right after cas) */
-    uint8_t           padding;       /* keep end 64-bit aligned */
+    uint8_t           accessed;      /* CLOCK reference bit, set on access */
+    uint32_t          refcount;      /* # pins, if the heap is shared */
     char              end[1];        /* item data */
 };
 
@@ -105,7 +106,9 @@ item_set_cas(struct item *it)
     ASSERT(it->magic == ITEM_MAGIC);
 
     if (use_cas) {
-        *((uint64_t *)it->end) = ++cas_id;
+        /* items of different keys may be updated by threads at once */
+        *((uint64_t *)it->end) = __atomic_add_fetch(&cas_id, 1,
+                __ATOMIC_RELAXED);
     }
 }
 
@@ -197,6 +200,13 @@ item_atou64(uint64_t *vint, struct item *it)
         return ITEM_ENAN;
     }
 }
+/* whether the item is pinned, in which case it must not be changed in place */
+static inline bool
+item_pinned(struct item *it)
+{
+    return __atomic_load_n(&it->refcount, __ATOMIC_ACQUIRE) != 0;
+}
+
 /* return true if item can fit len additional bytes in val in place, false otherwise */
 static inline bool
 item_will_fit(const struct item *it, uint32_t delta)
@@ -241,7 +251,28 @@ bool item_delete(const struct bstring *key);
 /* Relink item */
 void item_relink(struct item *it);
 
+/* evict a linked item for CLOCK, unless it was accessed since the last pass */
+bool item_reclaim(struct item *it);
+
 size_t item_expire(struct bstring *prefix);
 
 /* flush the cache */
 void item_flush(void);
+
+/*
+ * With slab_concurrent, the heap is shared by threads. A thread which changes
+ * a key locks it first, and holds the lock from looking up the item until it
+ * is done with it; it may only change the key it holds. Keys which are not
+ * locked are read with item_borrow, which returns the item pinned, until it
+ * is given back with item_return. A pinned item is neither freed nor changed
+ * in place: deleting it defers freeing it until the last pin is released.
+ * item_pin adds a pin, which also keeps the slab of the item from being
+ * evicted. Without slab_concurrent, locking does nothing, item_borrow is
+ * item_get, and a pin only refers to the slab.
+ */
+void item_lock(const struct bstring *key);
+void item_unlock(void);
+struct item *item_borrow(const struct bstring *key);
+void item_return(struct item *it);
+void item_pin(struct item *it);
+void item_unpin(struct item *it);
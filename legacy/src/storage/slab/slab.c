@@ -2,12 +2,14 @@
 
 #include "hashtable.h"
 #include "item.h"
+#include "slabmem.h"
 #include <datapool/datapool.h>
 #include <cc_mm.h>
 #include <cc_util.h>
 
 #include <errno.h>
 #include <math.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sysexits.h>
@@ -23,6 +25,7 @@ struct slab_heapinfo {
     uint32_t        max_nslab;   /* max # slab allowed */
     struct slab     **slab_table;/* table of all slabs */
     struct slab_tqh slab_lruq;   /* lru slab q */
+    pthread_mutex_t mtx;         /* guards the heap, if shared */
 };
 
 struct slab_pool_metadata {
@@ -48,11 +51,20 @@ static size_t item_min = ITEM_SIZE_MIN; /* min item size */
 static size_t item_max = ITEM_SIZE_MAX; /* max item size */
 static double item_growth = ITEM_FACTOR;/* item size growth factor */
 static uint32_t hash_power = HASH_POWER;/* power (of 2) entries for hashtable */
+static double hash_load_factor = HASH_LOAD_FACTOR; /* load to expand hashtable */
 static char *slab_datapool = SLAB_DATAPOOL;   /* slab datapool path */
 static bool prefault = SLAB_PREFAULT;         /* slab datapool prefault option */
 static char *slab_datapool_name = SLAB_DATAPOOL_NAME;   /* slab datapool name */
+static uint32_t prefault_nthread = SLAB_PREFAULT_NTHR;  /* # threads prefaulting */
+static bool hugepage = SLAB_HUGEPAGE;         /* back slabs with huge pages? */
+static char *numa = SLAB_NUMA;                /* NUMA policy of slabs */
+static bool automove = SLAB_AUTOMOVE;         /* rebalance slabs across classes? */
+static uint32_t automove_intvl = SLAB_AUTOMOVE_INTVL; /* automove interval (sec) */
+static double automove_ratio = SLAB_AUTOMOVE_RATIO;   /* max age ratio of dst to src */
+static proc_time_i automove_next;             /* time of the next automove */
 
 bool use_cas = SLAB_USE_CAS;
+bool slab_concurrent = SLAB_CONCURRENT;
 struct hash_table *hash_table = NULL;
 uint64_t cas_id;
 
@@ -66,6 +78,52 @@ extern proc_time_i flush_at;
 cc_declare_itt_function(,slab_malloc);
 cc_declare_itt_function(,slab_free);
 
+/*
+ * With slab_concurrent, each slabclass has a lock for allocating and freeing
+ * its items, and the heap has one for getting, evicting and moving slabs,
+ * which is taken with the lock of the class the slab is for. Evicting a slab
+ * also needs the lock of the class it is taken from, and the hash stripe of
+ * each of its items in turn. The heap lock is held by then, so other locks
+ * are only tried, as their holders may be waiting for the heap: a slab whose
+ * class is busy is skipped, and one with an item whose stripe is busy is kept,
+ * with the items unlinked so far going to the free queue of its class.
+ */
+static __thread uint8_t held_class = SLABCLASS_INVALID_ID;
+
+static inline void
+_slabclass_lock(uint8_t id)
+{
+    if (slab_concurrent) {
+        pthread_mutex_lock(&slabclass[id].mtx);
+        held_class = id;
+    }
+}
+
+static inline void
+_slabclass_unlock(uint8_t id)
+{
+    if (slab_concurrent) {
+        held_class = SLABCLASS_INVALID_ID;
+        pthread_mutex_unlock(&slabclass[id].mtx);
+    }
+}
+
+/* try a lock for a few yields, for a thread which must not wait on it */
+static bool
+_slab_trylock(pthread_mutex_t *mtx)
+{
+    int i;
+
+    for (i = 0; pthread_mutex_trylock(mtx) != 0; ++i) {
+        if (i == TRIES_MAX) {
+            return false;
+        }
+        sched_yield();
+    }
+
+    return true;
+}
+
 void
 slab_print(void)
 {
@@ -173,7 +231,7 @@ _slab_put_item_into_freeq(struct item *it, uint8_t id)
 static inline bool
 _slab_check_no_refcount(struct slab *slab)
 {
-    return (slab->refcount == 0);
+    return (__atomic_load_n(&slab->refcount, __ATOMIC_ACQUIRE) == 0);
 }
 
 /*
@@ -190,6 +248,7 @@ _slab_recreate_items(struct slab *slab)
     p->nfree_item = p->nitem;
     for (i = 0; i < p->nitem; i++) {
         it = _slab_to_item(slab, i, p->size);
+        it->refcount = 0; /* pins do not outlive the process */
         if (it->is_linked) {
             p->next_item_in_slab = (struct item *)&slab->data[0];
             INCR(slab_metrics, item_curr);
@@ -218,7 +277,8 @@ _slab_table_update(struct slab *slab)
     ASSERT(heapinfo.nslab < heapinfo.max_nslab);
 
     heapinfo.slab_table[heapinfo.nslab] = slab;
-    heapinfo.nslab++;
+    /* the table is read by CLOCK without the heap lock */
+    __atomic_store_n(&heapinfo.nslab, heapinfo.nslab + 1, __ATOMIC_RELEASE);
 
     log_verb("new slab %p allocated at pos %u", slab,
               heapinfo.nslab - 1);
@@ -312,6 +372,13 @@ _slab_slabclass_setup(void)
 
         p->nfree_item = 0;
         p->next_item_in_slab = NULL;
+
+        p->nreq_full = 0;
+
+        p->clock_slab = 0;
+        p->clock_item = 0;
+
+        pthread_mutex_init(&p->mtx, NULL);
     }
 
     if (pool_slab_state == 0) {
@@ -324,6 +391,11 @@ _slab_slabclass_setup(void)
 static void
 _slab_slabclass_teardown(void)
 {
+    uint8_t id;
+
+    for (id = SLABCLASS_MIN_ID; id <= profile_last_id; id++) {
+        pthread_mutex_destroy(&slabclass[id].mtx);
+    }
 }
 
 /*
@@ -342,8 +414,11 @@ _slab_heapinfo_setup(void)
 
     heapinfo.base = NULL;
     if (prealloc) {
+        /* an anonymous heap is placed before it is prefaulted, and then
+         * prefaulted here so that it can be spread across threads */
         pool_slab = datapool_open(slab_datapool, slab_datapool_name,
-                 heapinfo.max_nslab * slab_size, &pool_slab_state, prefault);
+                 heapinfo.max_nslab * slab_size, &pool_slab_state,
+                 prefault && slab_datapool != NULL);
         if (pool_slab == NULL) {
             log_crit("Could not create pool_slab");
             exit(EX_CONFIG);
@@ -355,6 +430,12 @@ _slab_heapinfo_setup(void)
                       strerror(errno));
             return CC_ENOMEM;
         }
+        if (slab_datapool == NULL) {
+            slabmem_place(heapinfo.base, heapinfo.max_nslab * slab_size);
+            if (prefault) {
+                slabmem_prefault(heapinfo.base, heapinfo.max_nslab * slab_size);
+            }
+        }
 
         log_info("pre-allocated %zu bytes for %"PRIu32" slabs",
                   slab_mem, heapinfo.max_nslab);
@@ -371,6 +452,7 @@ _slab_heapinfo_setup(void)
         return CC_ENOMEM;
     }
     TAILQ_INIT(&heapinfo.slab_lruq);
+    pthread_mutex_init(&heapinfo.mtx, NULL);
 
     log_vverb("created slab table with %"PRIu32" entries",
               heapinfo.max_nslab);
@@ -391,6 +473,7 @@ _slab_heapinfo_teardown(void)
         datapool_set_user_data(pool_slab, &pool_metadata, sizeof(struct slab_pool_metadata));
         datapool_close(pool_slab);
     }
+    pthread_mutex_destroy(&heapinfo.mtx);
 }
 
 static rstatus_i
@@ -593,12 +676,32 @@ slab_setup(slab_options_st *options, slab_metrics_st *metrics)
         max_ttl = option_uint(&options->slab_item_max_ttl);
         use_cas = option_bool(&options->slab_use_cas);
         hash_power = option_uint(&options->slab_hash_power);
+        hash_load_factor = option_fpn(&options->slab_hash_load_factor);
         slab_datapool = option_str(&options->slab_datapool);
         slab_datapool_name = option_str(&options->slab_datapool_name);
         prefault = option_bool(&options->slab_datapool_prefault);
+        prefault_nthread = option_uint(&options->slab_prefault_nthread);
+        hugepage = option_bool(&options->slab_hugepage);
+        numa = option_str(&options->slab_numa);
+        automove = option_bool(&options->slab_automove);
+        automove_intvl = option_uint(&options->slab_automove_intvl);
+        automove_ratio = option_fpn(&options->slab_automove_ratio);
+        slab_concurrent = option_bool(&options->slab_concurrent);
+    }
+
+    if ((evict_opt & EVICT_CLOCK) && !use_freeq) {
+        log_warn("CLOCK eviction reclaims items into the free queue, which is "
+                "not used; falling back to slab eviction");
+        evict_opt &= ~EVICT_CLOCK;
+    }
+
+    if (slabmem_setup(hugepage, numa, prefault_nthread) != CC_OK) {
+        log_crit("Could not set up placement of slab memory");
+        goto error;
     }
 
-    hash_table = hashtable_create(hash_power);
+    hash_table = hashtable_create(hash_power, hash_load_factor,
+            slab_concurrent);
     if (hash_table == NULL) {
         log_crit("Could not create hash table");
         goto error;
@@ -623,6 +726,7 @@ slab_setup(slab_options_st *options, slab_metrics_st *metrics)
      cc_create_itt_free(slab_free);
 
     flush_at = -1;
+    automove_next = time_proc_sec() + automove_intvl;
 
     slab_init = true;
 
@@ -722,6 +826,35 @@ _slab_get_new(void)
     return slab;
 }
 
+/*
+ * All the prep work before start using a slab.
+ */
+static void
+_slab_init(struct slab *slab, uint8_t id)
+{
+    struct slabclass *p;
+    struct item *it;
+    uint32_t i, offset;
+
+    p = &slabclass[id];
+
+    /* initialize slab header */
+    _slab_hdr_init(slab, id);
+
+    _slab_lruq_append(slab);
+
+    /* initialize all slab items */
+    for (i = 0; i < p->nitem; i++) {
+        it = _slab_to_item(slab, i, p->size);
+        offset = (uint32_t)((char *)it - (char *)slab);
+        item_hdr_init(it, offset, id);
+    }
+
+    /* make this slab as the current slab */
+    p->nfree_item = p->nitem;
+    p->next_item_in_slab = (struct item *)&slab->data[0];
+}
+
 /*
  * Evict a slab by evicting all the items within it. This means that the
  * items that are carved out of the slab must either be deleted from their
@@ -769,92 +902,167 @@ _slab_evict_one(struct slab *slab)
     _slab_lruq_remove(slab);
 }
 
+/* take the locks to evict a slab of class id, with the heap lock held */
+static bool
+_slab_evict_lock(uint8_t id)
+{
+    if (!slab_concurrent) {
+        return true;
+    }
+
+    if (id != held_class && !_slab_trylock(&slabclass[id].mtx)) {
+        INCR(slab_metrics, slab_evict_ex);
+        return false;
+    }
+
+    return true;
+}
+
+static void
+_slab_evict_unlock(uint8_t id)
+{
+    if (slab_concurrent && id != held_class) {
+        pthread_mutex_unlock(&slabclass[id].mtx);
+    }
+}
+
 /*
- * Get a random slab from all active slabs and evict it for new allocation.
- *
- * Note that the slab_table enables us to have O(1) lookup for every slab in
- * the system. The inserts into the table are just appends - O(1) and there
- * are no deletes from the slab_table. These two constraints allows us to keep
- * our random choice uniform.
+ * Unlink the items of a slab of a shared heap, with the lock of its class held,
+ * trying the stripe of each. If one is busy, the slab is kept, and the items
+ * unlinked go to its free queue, up to the items not yet carved out of it.
  */
-static struct slab *
-_slab_evict_rand(void)
+static bool
+_slab_unlink_items(struct slab *slab)
 {
-    struct slab *slab;
-    int i = 0;
+    struct slabclass *p = &slabclass[slab->id];
+    struct item *it, *next = p->next_item_in_slab;
+    bool done = true;
+    uint32_t i;
 
-    do {
-        slab = _slab_table_rand();
-    } while (slab != NULL && ++i < TRIES_MAX && !_slab_check_no_refcount(slab));
+    if (!slab_concurrent) {
+        return true;
+    }
 
-    if (slab == NULL) {
-        /* warning here because eviction failure should be rare. This can
-         * indicate there are dead/idle connections hanging onto items and
-         * slab refcounts.
-         */
-        log_warn("can't find a slab for random-evicting slab with %d tries", i);
-    } else {
-        log_verb("random-evicting slab %p with id %u", slab, slab->id);
-        _slab_evict_one(slab);
+    for (i = 0; i < p->nitem; i++) {
+        it = _slab_to_item(slab, i, p->size);
+        if (!it->is_linked) {
+            continue;
+        }
+        if (!hashtable_trylock(item_key(it), it->klen, hash_table)) {
+            done = false;
+            continue;
+        }
+        if (item_pinned(it)) {
+            done = false;
+        } else {
+            it->is_linked = 0;
+            hashtable_delete(item_key(it), it->klen, hash_table);
+        }
+        hashtable_untry(hash_table);
     }
 
-    return slab;
+    if (done) {
+        return true;
+    }
+
+    INCR(slab_metrics, slab_evict_ex);
+    for (i = 0; i < p->nitem; i++) {
+        it = _slab_to_item(slab, i, p->size);
+        if (next != NULL && item_to_slab(next) == slab && it >= next) {
+            break;
+        }
+        if (!it->is_linked && !it->in_freeq) {
+            _slab_put_item_into_freeq(it, slab->id);
+        }
+    }
+
+    return false;
 }
 
 /*
- * Evict by looking into least recently used queue of all slabs.
+ * Evict a slab and reuse it for class id, unless some of its items can't be
+ * evicted, or its locks are held by other threads.
  */
-static struct slab *
-_slab_evict_lru(int id)
+static bool
+_slab_evict(struct slab *slab, uint8_t id)
 {
-    struct slab *slab = _slab_lruq_head();
-    int i = 0;
+    uint8_t victim = slab->id;
 
-    while (slab != NULL && ++i < TRIES_MAX && !_slab_check_no_refcount(slab)) {
-        slab = TAILQ_NEXT(slab, s_tqe);
-    };
+    if (!_slab_check_no_refcount(slab) || !_slab_evict_lock(victim)) {
+        return false;
+    }
 
-    if (slab == NULL) {
-        /* warning here because eviction failure should be rare. This can
-         * indicate there are dead/idle connections hanging onto items and
-         * slab refcounts.
-         */
-        log_warn("can't find a slab for lru-evicting slab with %d tries", i);
-    } else {
-        log_verb("lru-evicting slab %p with id %u", slab, slab->id);
-        _slab_evict_one(slab);
+    /* items are reserved with the lock of the class, and pinned with their
+     * stripes, which are tried as they are unlinked */
+    if (!_slab_check_no_refcount(slab) || !_slab_unlink_items(slab)) {
+        _slab_evict_unlock(victim);
+        return false;
     }
 
-    return slab;
+    _slab_evict_one(slab);
+    /* CLOCK sweeps of the old class see the slab in one class or the other */
+    _slab_init(slab, id);
+    _slab_evict_unlock(victim);
+
+    return true;
 }
 
 /*
- * All the prep work before start using a slab.
+ * Get a random slab from all active slabs and evict it for new allocation.
+ *
+ * Note that the slab_table enables us to have O(1) lookup for every slab in
+ * the system. The inserts into the table are just appends - O(1) and there
+ * are no deletes from the slab_table. These two constraints allows us to keep
+ * our random choice uniform.
  */
-static void
-_slab_init(struct slab *slab, uint8_t id)
+static struct slab *
+_slab_evict_rand(uint8_t id)
 {
-    struct slabclass *p;
-    struct item *it;
-    uint32_t i, offset;
+    struct slab *slab;
+    int i;
 
-    p = &slabclass[id];
+    for (i = 0; i < TRIES_MAX && SLIST_EMPTY(&slabclass[id].free_itemq); i++) {
+        slab = _slab_table_rand();
+        if (slab != NULL && _slab_evict(slab, id)) {
+            log_verb("random-evicted slab %p for id %u", slab, id);
+            return slab;
+        }
+    }
 
-    /* initialize slab header */
-    _slab_hdr_init(slab, id);
+    /* warning here because eviction failure should be rare. This can
+     * indicate there are dead/idle connections hanging onto items and
+     * slab refcounts.
+     */
+    log_warn("can't find a slab for random-evicting slab with %d tries", i);
 
-    _slab_lruq_append(slab);
+    return NULL;
+}
 
-    /* initialize all slab items */
-    for (i = 0; i < p->nitem; i++) {
-        it = _slab_to_item(slab, i, p->size);
-        offset = (uint32_t)((char *)it - (char *)slab);
-        item_hdr_init(it, offset, id);
+/*
+ * Evict by looking into least recently used queue of all slabs.
+ */
+static struct slab *
+_slab_evict_lru(uint8_t id)
+{
+    struct slab *slab;
+    int i = 0;
+
+    for (slab = _slab_lruq_head(); slab != NULL && i < TRIES_MAX &&
+            SLIST_EMPTY(&slabclass[id].free_itemq);
+            slab = TAILQ_NEXT(slab, s_tqe), i++) {
+        if (_slab_evict(slab, id)) {
+            log_verb("lru-evicted slab %p for id %u", slab, id);
+            return slab;
+        }
     }
 
-    /* make this slab as the current slab */
-    p->nfree_item = p->nitem;
-    p->next_item_in_slab = (struct item *)&slab->data[0];
+    /* warning here because eviction failure should be rare. This can
+     * indicate there are dead/idle connections hanging onto items and
+     * slab refcounts.
+     */
+    log_warn("can't find a slab for lru-evicting slab with %d tries", i);
+
+    return NULL;
 }
 
 /*
@@ -874,18 +1082,34 @@ _slab_get(uint8_t id)
     ASSERT(slabclass[id].next_item_in_slab == NULL);
     ASSERT(SLIST_EMPTY(&slabclass[id].free_itemq));
 
+    if (slab_concurrent) {
+        pthread_mutex_lock(&heapinfo.mtx);
+    }
+
     slab = _slab_get_new();
+    if (slab != NULL) {
+        _slab_init(slab, id);
+    }
+
+    if (slab == NULL && _slab_heap_full()) {
+        /* the class is under pressure, which is what automove balances */
+        slabclass[id].nreq_full++;
+        PERSLAB_INCR(id, slab_req_full);
+    }
 
     if (slab == NULL && (evict_opt & EVICT_CS)) {
         slab = _slab_evict_lru(id);
     }
 
     if (slab == NULL && (evict_opt & EVICT_RS)) {
-        slab = _slab_evict_rand();
+        slab = _slab_evict_rand(id);
+    }
+
+    if (slab_concurrent) {
+        pthread_mutex_unlock(&heapinfo.mtx);
     }
 
     if (slab != NULL) {
-        _slab_init(slab, id);
         status = CC_OK;
     } else {
         status = CC_ENOMEM;
@@ -935,12 +1159,62 @@ _slab_get_item_from_freeq(uint8_t id)
     return it;
 }
 
+/*
+ * Evict a single item of the given class with CLOCK: the hand of the class
+ * sweeps over the items in its slabs, and the first linked item that has not
+ * been accessed since the last sweep is reclaimed into the item free Q, from
+ * which it is returned. Accessed items have their reference bit cleared as the
+ * hand passes. The sweep gives up after TRIES_MAX slabs worth of items, in
+ * which case the caller may evict a slab instead.
+ */
+static struct item *
+_slab_evict_item(uint8_t id)
+{
+    struct slabclass *p = &slabclass[id];
+    struct slab *slab;
+    struct item *it;
+    uint32_t nitem = 0, nslab = 0;
+    /* slabs are appended to the table with the heap lock, which isn't held,
+     * while those of this class only change with the lock of the class */
+    uint32_t ntable = __atomic_load_n(&heapinfo.nslab, __ATOMIC_ACQUIRE);
+
+    while (ntable > 0 && nitem < TRIES_MAX * p->nitem &&
+            nslab <= 2 * ntable) {
+        if (p->clock_slab >= ntable) {
+            p->clock_slab = 0;
+            p->clock_item = 0;
+        }
+
+        slab = heapinfo.slab_table[p->clock_slab];
+        if (slab->id != id || p->clock_item >= p->nitem) {
+            /* slabs of other classes are skipped, which bounds a sweep */
+            p->clock_slab++;
+            p->clock_item = 0;
+            nslab++;
+            continue;
+        }
+
+        it = _slab_to_item(slab, p->clock_item++, p->size);
+        nitem++;
+        if (item_reclaim(it)) {
+            return _slab_get_item_from_freeq(id);
+        }
+    }
+
+    log_verb("CLOCK found no item to evict in class %"PRIu8" after %"PRIu32
+            " items", id, nitem);
+
+    return NULL;
+}
+
 /*
  * Get an item from the slab with a given id. We get an item either from:
  * 1. item free Q of given slab with id. or,
  * 2. current slab.
  * If the current slab is empty, we get a new slab from the slab allocator
- * and return the next item from this new slab.
+ * and return the next item from this new slab. With CLOCK eviction, once the
+ * heap is full an item of the class is evicted before getting a slab, which
+ * would evict a whole slab.
  */
 static struct item *
 _slab_get_item(uint8_t id)
@@ -955,8 +1229,17 @@ _slab_get_item(uint8_t id)
         return it;
     }
 
+    if (p->next_item_in_slab == NULL && (evict_opt & EVICT_CLOCK) &&
+            _slab_heap_full()) {
+        it = _slab_evict_item(id);
+        if (it != NULL) {
+            return it;
+        }
+    }
+
     if (p->next_item_in_slab == NULL && (_slab_get(id) != CC_OK)) {
-        return NULL;
+        /* slabs evicted in part may have refilled the free queue */
+        return _slab_get_item_from_freeq(id);
     }
 
     /* return item from current slab */
@@ -973,14 +1256,176 @@ _slab_get_item(uint8_t id)
     return it;
 }
 
+/*
+ * Age of the items in a slab, which is (approximately) the age of its first
+ * linked item. A slab without any linked item is as old as it can be.
+ */
+static delta_time_i
+_slab_age(struct slab *slab, proc_time_i now)
+{
+    struct slabclass *p = &slabclass[slab->id];
+    struct item *it;
+    uint32_t i;
+
+    for (i = 0; i < p->nitem; i++) {
+        it = _slab_to_item(slab, i, p->size);
+        if (it->is_linked) {
+            return now - it->create_at;
+        }
+    }
+
+    return now;
+}
+
+/*
+ * Move a slab from class src to class dst: the oldest slab of src is evicted
+ * and its items are handed to dst, through the item free Q if it is in use,
+ * or as the current slab of dst otherwise.
+ */
+static bool
+_slab_move(uint8_t src, uint8_t dst)
+{
+    struct slabclass *p = &slabclass[dst];
+    struct slab *slab;
+    struct item *it;
+    uint32_t i, offset;
+
+    if (!use_freeq && p->next_item_in_slab != NULL) {
+        return false;
+    }
+
+    TAILQ_FOREACH(slab, &heapinfo.slab_lruq, s_tqe) {
+        if (slab->id == src && _slab_check_no_refcount(slab)) {
+            break;
+        }
+    }
+    if (slab == NULL || !_slab_evict_lock(src)) {
+        return false;
+    }
+    if (!_slab_check_no_refcount(slab) || !_slab_unlink_items(slab)) {
+        _slab_evict_unlock(src);
+        return false;
+    }
+
+    log_verb("automove slab %p from id %"PRIu8" to id %"PRIu8, slab, src, dst);
+
+    _slab_evict_one(slab);
+
+    if (!use_freeq) {
+        _slab_init(slab, dst);
+    } else {
+        _slab_hdr_init(slab, dst);
+        _slab_lruq_append(slab);
+        for (i = 0; i < p->nitem; i++) {
+            it = _slab_to_item(slab, i, p->size);
+            offset = (uint32_t)((char *)it - (char *)slab);
+            item_hdr_init(it, offset, dst);
+            _slab_put_item_into_freeq(it, dst);
+        }
+    }
+    _slab_evict_unlock(src);
+
+    INCR(slab_metrics, slab_move);
+    PERSLAB_DECR(src, slab_curr);
+    PERSLAB_INCR(dst, slab_curr);
+    PERSLAB_INCR(src, slab_move_out);
+    PERSLAB_INCR(dst, slab_move_in);
+
+    return true;
+}
+
+/*
+ * Rebalance slabs across classes, by moving (at most) one slab per interval.
+ *
+ * The destination is the class which requested the most slabs with a full
+ * heap since the last interval; the source is the class with the oldest items
+ * among those with more than one slab. A slab is moved only if the items of
+ * the destination are younger than those of the source by automove_ratio,
+ * i.e., the source holds on to memory that serves colder items.
+ *
+ * The age of a class is that of its least recently created slab, which is
+ * found by a pass over the slab lruq, O(#slabs) once per interval.
+ */
+static void
+_slab_automove(proc_time_i now)
+{
+    struct slab *slab, *oldest[SLABCLASS_MAX_ID + 1] = { NULL };
+    uint32_t nslab[SLABCLASS_MAX_ID + 1] = { 0 };
+    delta_time_i age[SLABCLASS_MAX_ID + 1] = { 0 };
+    uint32_t nreq_full = 0;
+    uint8_t id, src = SLABCLASS_INVALID_ID, dst = SLABCLASS_INVALID_ID;
+
+    automove_next = now + automove_intvl;
+
+    TAILQ_FOREACH(slab, &heapinfo.slab_lruq, s_tqe) {
+        if (nslab[slab->id]++ == 0) {
+            oldest[slab->id] = slab;
+        }
+    }
+
+    for (id = SLABCLASS_MIN_ID; id <= profile_last_id; id++) {
+        if (oldest[id] != NULL) {
+            age[id] = _slab_age(oldest[id], now);
+        }
+        UPDATE_VAL(&perslab[id], item_age, age[id]);
+
+        if (slabclass[id].nreq_full > nreq_full) {
+            nreq_full = slabclass[id].nreq_full;
+            dst = id;
+        }
+    }
+
+    if (dst == SLABCLASS_INVALID_ID) {
+        return;
+    }
+
+    for (id = SLABCLASS_MIN_ID; id <= profile_last_id; id++) {
+        slabclass[id].nreq_full = 0;
+
+        if (id != dst && nslab[id] > 1 && (src == SLABCLASS_INVALID_ID ||
+                age[id] > age[src])) {
+            src = id;
+        }
+    }
+
+    if (src == SLABCLASS_INVALID_ID || age[dst] >= automove_ratio * age[src]) {
+        return;
+    }
+
+    /* the heap lock is held, so the lock of dst is only tried */
+    if (!slab_concurrent) {
+        _slab_move(src, dst);
+    } else if (_slab_trylock(&slabclass[dst].mtx)) {
+        _slab_move(src, dst);
+        pthread_mutex_unlock(&slabclass[dst].mtx);
+    } else {
+        INCR(slab_metrics, slab_evict_ex);
+    }
+}
+
 struct item *
 slab_get_item(uint8_t id)
 {
     struct item *it;
+    proc_time_i now;
 
     ASSERT(id >= SLABCLASS_MIN_ID && id <= profile_last_id);
 
+    /* a thread which finds the heap locked leaves automove to its holder */
+    if (automove && (now = time_proc_sec()) >= automove_next) {
+        if (!slab_concurrent) {
+            _slab_automove(now);
+        } else if (pthread_mutex_trylock(&heapinfo.mtx) == 0) {
+            if (now >= automove_next) {
+                _slab_automove(now);
+            }
+            pthread_mutex_unlock(&heapinfo.mtx);
+        }
+    }
+
+    _slabclass_lock(id);
     it = _slab_get_item(id);
+    _slabclass_unlock(id);
 
     return it;
 }
@@ -991,6 +1436,14 @@ slab_get_item(uint8_t id)
 void
 slab_put_item(struct item *it, uint8_t id)
 {
-     ASSERT(!(it->in_freeq));
-    _slab_put_item_into_freeq(it, id);
+    ASSERT(!(it->in_freeq));
+
+    /* CLOCK frees items of the class it holds the lock of */
+    if (held_class == id) {
+        _slab_put_item_into_freeq(it, id);
+    } else {
+        _slabclass_lock(id);
+        _slab_put_item_into_freeq(it, id);
+        _slabclass_unlock(id);
+    }
 }
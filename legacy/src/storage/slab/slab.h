@@ -29,15 +29,24 @@
 #define ITEM_FACTOR     1.25
 #define ITEM_MAX_TTL    (30 * 24 * 60 * 60) /* 30 days */
 #define HASH_POWER      16
+#define HASH_LOAD_FACTOR 1.5
 #define SLAB_DATAPOOL   NULL
 #define SLAB_PREFAULT   false
+#define SLAB_PREFAULT_NTHR 1
+#define SLAB_HUGEPAGE   false
+#define SLAB_NUMA       NULL
 #define SLAB_DATAPOOL_NAME "slab_datapool"
+#define SLAB_AUTOMOVE   false
+#define SLAB_AUTOMOVE_INTVL 1   /* 1 second */
+#define SLAB_AUTOMOVE_RATIO 0.8
+#define SLAB_CONCURRENT false
 
 /* Eviction options */
 #define EVICT_NONE    0 /* throw OOM, no eviction */
 #define EVICT_RS      1 /* random slab eviction */
 #define EVICT_CS      2 /* lrc (least recently created) slab eviction */
-#define EVICT_INVALID 4 /* go no further! */
+#define EVICT_CLOCK   4 /* CLOCK item eviction, before any slab eviction */
+#define EVICT_INVALID 8 /* go no further! */
 
 /* The defaults here are placeholder values for now */
 /* TODO: consider moving item options to item.[h|c] */
@@ -55,9 +64,17 @@
     ACTION( slab_item_max_ttl,      OPTION_TYPE_UINT,   ITEM_MAX_TTL,        "Max ttl in seconds"            )\
     ACTION( slab_use_cas,           OPTION_TYPE_BOOL,   SLAB_USE_CAS,        "Store CAS value in item"       )\
     ACTION( slab_hash_power,        OPTION_TYPE_UINT,   HASH_POWER,          "Power for lookup hash table"   )\
+    ACTION( slab_hash_load_factor,  OPTION_TYPE_FPN,    HASH_LOAD_FACTOR,    "Items per bucket to expand"    )\
     ACTION( slab_datapool,          OPTION_TYPE_STR,    SLAB_DATAPOOL,       "Path to data pool"             )\
     ACTION( slab_datapool_name,     OPTION_TYPE_STR,    SLAB_DATAPOOL_NAME,  "Slab data pool name"           )\
-    ACTION( slab_datapool_prefault, OPTION_TYPE_BOOL,   SLAB_PREFAULT,       "Prefault data pool"            )
+    ACTION( slab_datapool_prefault, OPTION_TYPE_BOOL,   SLAB_PREFAULT,       "Prefault data pool"            )\
+    ACTION( slab_prefault_nthread,  OPTION_TYPE_UINT,   SLAB_PREFAULT_NTHR,  "# threads prefaulting slabs"   )\
+    ACTION( slab_hugepage,          OPTION_TYPE_BOOL,   SLAB_HUGEPAGE,       "Back slabs, hash table w/ THP" )\
+    ACTION( slab_numa,              OPTION_TYPE_STR,    SLAB_NUMA,           "NUMA: interleave or node id"   )\
+    ACTION( slab_automove,          OPTION_TYPE_BOOL,   SLAB_AUTOMOVE,       "Rebalance slabs across classes")\
+    ACTION( slab_automove_intvl,    OPTION_TYPE_UINT,   SLAB_AUTOMOVE_INTVL, "Automove interval (sec)"       )\
+    ACTION( slab_automove_ratio,    OPTION_TYPE_FPN,    SLAB_AUTOMOVE_RATIO, "Max age ratio of dst to src"   )\
+    ACTION( slab_concurrent,        OPTION_TYPE_BOOL,   SLAB_CONCURRENT,     "Shared by threads"             )
 
 
 typedef struct {
@@ -69,6 +86,9 @@ typedef struct {
     ACTION( slab_req,           METRIC_COUNTER, "# req for new slab"       )\
     ACTION( slab_req_ex,        METRIC_COUNTER, "# slab get exceptions"    )\
     ACTION( slab_evict,         METRIC_COUNTER, "# slabs evicted"          )\
+    ACTION( slab_evict_ex,      METRIC_COUNTER, "# evictions contended"    )\
+    ACTION( item_evict,         METRIC_COUNTER, "# items evicted by CLOCK" )\
+    ACTION( slab_move,          METRIC_COUNTER, "# slabs moved by automove")\
     ACTION( slab_memory,        METRIC_GAUGE,   "memory allocated to slab" )\
     ACTION( slab_curr,          METRIC_GAUGE,   "# currently active slabs" )\
     ACTION( item_curr,          METRIC_GAUGE,   "# current items"          )\
@@ -83,7 +103,10 @@ typedef struct {
     ACTION( hash_lookup,        METRIC_COUNTER, "# of hash lookups"        )\
     ACTION( hash_insert,        METRIC_COUNTER, "# of hash inserts"        )\
     ACTION( hash_remove,        METRIC_COUNTER, "# of hash deletes"        )\
-    ACTION( hash_traverse,      METRIC_COUNTER, "# of nodes touched"       )
+    ACTION( hash_traverse,      METRIC_COUNTER, "# of nodes touched"       )\
+    ACTION( hash_power,         METRIC_GAUGE,   "power of the hash table"  )\
+    ACTION( hash_expand,        METRIC_COUNTER, "# of hash expansions"     )\
+    ACTION( hash_migrate,       METRIC_COUNTER, "# of buckets migrated"    )
 
 typedef struct {
     SLAB_METRIC(METRIC_DECLARE)
@@ -96,7 +119,11 @@ typedef struct {
     ACTION( item_val_byte,      METRIC_GAUGE,   "value portion of data")\
     ACTION( item_curr,          METRIC_GAUGE,   "# items stored"       )\
     ACTION( item_free,          METRIC_GAUGE,   "# free items"         )\
-    ACTION( slab_curr,          METRIC_GAUGE,   "# slabs"              )
+    ACTION( slab_curr,          METRIC_GAUGE,   "# slabs"              )\
+    ACTION( slab_req_full,      METRIC_COUNTER, "# slab req, heap full")\
+    ACTION( slab_move_in,       METRIC_COUNTER, "# slabs moved in"     )\
+    ACTION( slab_move_out,      METRIC_COUNTER, "# slabs moved out"    )\
+    ACTION( item_age,           METRIC_GAUGE,   "oldest item age (sec)")
 
 typedef struct {
     PERSLAB_METRIC(METRIC_DECLARE)
@@ -150,6 +177,7 @@ TAILQ_HEAD(slab_tqh, slab);
 
 extern struct hash_table *hash_table;
 extern size_t slab_size;
+extern bool slab_concurrent;
 extern slab_metrics_st *slab_metrics;
 cc_declare_itt_function(extern, slab_malloc);
 cc_declare_itt_function(extern, slab_free);
@@ -181,10 +209,11 @@ item_to_slab(struct item *it)
     return slab;
 }
 
+/* items of a slab may be referred to by threads sharing the heap at once */
 static inline void
 slab_ref(struct slab *slab)
 {
-    slab->refcount++;
+    __atomic_add_fetch(&slab->refcount, 1, __ATOMIC_RELAXED);
 }
 
 static inline void
@@ -192,7 +221,7 @@ slab_deref(struct slab *slab)
 {
     ASSERT(slab->refcount > 0);
 
-    slab->refcount--;
+    __atomic_sub_fetch(&slab->refcount, 1, __ATOMIC_RELEASE);
 }
 
 void slab_print(void);
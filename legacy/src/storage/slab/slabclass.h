@@ -3,6 +3,7 @@
 #include <cc_queue.h>
 
 #include <limits.h>
+#include <pthread.h>
 #include <stdint.h>
 
 /* Queues for handling items */
@@ -73,6 +74,13 @@ struct slabclass {
 
     uint32_t        nfree_item;            /* # free item (in current slab) */
     struct item     *next_item_in_slab;    /* next free item (in current slab, not freeq) */
+
+    uint32_t        nreq_full;             /* # slab req with a full heap (in automove window) */
+
+    uint32_t        clock_slab;            /* slab table index of the CLOCK hand */
+    uint32_t        clock_item;            /* item index of the CLOCK hand in that slab */
+
+    pthread_mutex_t mtx;                   /* guards the class, if the heap is shared */
 };
 
 /*
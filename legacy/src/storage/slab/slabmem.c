@@ -0,0 +1,201 @@
+#include "slabmem.h"
+
+#include <cc_debug.h>
+#include <cc_mm.h>
+#include <cc_util.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+/* from <numaif.h>, which comes with libnuma */
+#define SLABMEM_MPOL_DEFAULT        0
+#define SLABMEM_MPOL_BIND           2
+#define SLABMEM_MPOL_INTERLEAVE     3
+#define SLABMEM_MPOL_F_MEMS_ALLOWED (1 << 2)
+#define SLABMEM_MPOL_MF_MOVE        (1 << 1)
+
+/* each thread prefaults a share aligned to the size of a huge page, so that
+ * no huge page is faulted in by two threads */
+#define SLABMEM_PREFAULT_ALIGN      (2 * MiB)
+
+struct slabmem_prefault_arg {
+    pthread_t     tid;
+    volatile char *start;
+    volatile char *end;
+};
+
+static bool hugepage = false;
+static int mpol = SLABMEM_MPOL_DEFAULT;
+static unsigned long nodemask = 0;
+static uint32_t prefault_nthread = 1;
+static size_t page_size;
+
+rstatus_i
+slabmem_setup(bool use_hugepage, const char *numa, uint32_t nthread)
+{
+    char *end;
+    unsigned long node;
+
+    page_size = (size_t)sysconf(_SC_PAGESIZE);
+    hugepage = use_hugepage;
+    prefault_nthread = nthread == 0 ? 1 : nthread;
+    mpol = SLABMEM_MPOL_DEFAULT;
+    nodemask = 0;
+
+#ifndef MADV_HUGEPAGE
+    if (hugepage) {
+        log_warn("slabs can only be backed with huge pages on linux");
+        hugepage = false;
+    }
+#endif
+
+    if (numa == NULL || *numa == '\0') {
+        return CC_OK;
+    }
+
+    if (strcmp(numa, "interleave") == 0) {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+        unsigned long allowed = 0;
+
+        if (syscall(SYS_get_mempolicy, NULL, &allowed, sizeof(allowed) * 8,
+                NULL, SLABMEM_MPOL_F_MEMS_ALLOWED) != 0) {
+            log_warn("fail to get the NUMA nodes allowed: %s", strerror(errno));
+            return CC_OK;
+        }
+        if ((allowed & (allowed - 1)) == 0) {
+            log_info("only one NUMA node is allowed, slabs are not "
+                "interleaved");
+            return CC_OK;
+        }
+
+        mpol = SLABMEM_MPOL_INTERLEAVE;
+        nodemask = allowed;
+        log_info("slabs are interleaved across NUMA nodes 0x%lx", nodemask);
+#else
+        log_warn("slabs can only be placed on NUMA nodes on linux");
+#endif
+        return CC_OK;
+    }
+
+    errno = 0;
+    node = strtoul(numa, &end, 10);
+    if (errno != 0 || end == numa || *end != '\0' ||
+            node >= sizeof(nodemask) * 8) {
+        log_error("invalid slab NUMA policy '%s', expect 'interleave' or the "
+            "number of a node", numa);
+        return CC_EINVAL;
+    }
+
+#if defined(__linux__) && defined(SYS_mbind)
+    mpol = SLABMEM_MPOL_BIND;
+    nodemask = 1UL << node;
+    log_info("slabs are bound to NUMA node %lu", node);
+#else
+    log_warn("slabs can only be placed on NUMA nodes on linux");
+#endif
+
+    return CC_OK;
+}
+
+void
+slabmem_place(void *addr, size_t size)
+{
+    /* advice and policies apply to whole pages, so only the pages which lie
+     * entirely within the memory are placed */
+    uintptr_t start = ((uintptr_t)addr + page_size - 1) / page_size * page_size;
+    uintptr_t end = ((uintptr_t)addr + size) / page_size * page_size;
+
+    if (page_size == 0 || start >= end) {
+        return;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (hugepage && madvise((void *)start, end - start, MADV_HUGEPAGE) != 0) {
+        log_warn("fail to back %zu bytes with huge pages: %s", end - start,
+            strerror(errno));
+    }
+#endif
+
+#if defined(__linux__) && defined(SYS_mbind)
+    if (mpol != SLABMEM_MPOL_DEFAULT && syscall(SYS_mbind, (void *)start,
+            end - start, mpol, &nodemask, sizeof(nodemask) * 8,
+            SLABMEM_MPOL_MF_MOVE) != 0) {
+        log_warn("fail to place %zu bytes on NUMA nodes 0x%lx: %s",
+            end - start, nodemask, strerror(errno));
+    }
+#endif
+}
+
+static void
+_slabmem_touch(volatile char *start, volatile char *end)
+{
+    for (; start < end; start += page_size) {
+        *start = *start;
+    }
+}
+
+static void *
+_slabmem_prefault_thread(void *arg)
+{
+    struct slabmem_prefault_arg *share = arg;
+
+    _slabmem_touch(share->start, share->end);
+
+    return NULL;
+}
+
+void
+slabmem_prefault(void *addr, size_t size)
+{
+    struct slabmem_prefault_arg *shares;
+    char *begin = addr;
+    char *end = begin + size;
+    size_t share;
+    uint32_t i, nthread = prefault_nthread;
+
+    if (size == 0) {
+        return;
+    }
+
+    share = (size + nthread - 1) / nthread;
+    share = (share + SLABMEM_PREFAULT_ALIGN - 1) / SLABMEM_PREFAULT_ALIGN *
+        SLABMEM_PREFAULT_ALIGN;
+    nthread = (uint32_t)((size + share - 1) / share);
+
+    log_info("prefault %zu bytes of slabs with %"PRIu32" threads", size,
+        nthread);
+
+    if (nthread == 1 || (shares = cc_alloc(sizeof(*shares) * nthread)) == NULL) {
+        _slabmem_touch(begin, end);
+        return;
+    }
+
+    for (i = 0; i < nthread; i++) {
+        shares[i].start = begin + share * i;
+        shares[i].end = MIN(begin + share * (i + 1), end);
+        if (pthread_create(&shares[i].tid, NULL, _slabmem_prefault_thread,
+                &shares[i]) != 0) {
+            log_warn("fail to create prefault thread, prefault inline");
+            _slabmem_touch(shares[i].start, shares[i].end);
+            shares[i].start = NULL;
+        }
+    }
+
+    for (i = 0; i < nthread; i++) {
+        if (shares[i].start != NULL) {
+            pthread_join(shares[i].tid, NULL);
+        }
+    }
+
+    cc_free(shares);
+
+    log_info("prefaulted %zu bytes of slabs", size);
+}
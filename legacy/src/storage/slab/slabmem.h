@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cc_define.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Placement of the memory of the slab heap and the hash table.
+ *
+ * A large heap is mapped with transparent huge pages when slab_hugepage is
+ * set, which takes far fewer TLB entries than the same heap in base pages.
+ * slab_numa either interleaves the pages across the NUMA nodes the process
+ * may use ("interleave"), or binds them to a single node (its number). Both
+ * are applied to memory before it is first touched, so that its pages are
+ * faulted in where and how they were asked for. The hash table is placed the
+ * same way each time it is allocated, as it is when expanded.
+ *
+ * The heap is prefaulted with slab_prefault_nthread threads, each touching a
+ * contiguous share of it, as faulting in tens of GiB from a single thread
+ * takes over a minute, most of it in the kernel zeroing pages.
+ **/
+
+/* set up how memory is placed, returns CC_EINVAL if slab_numa is invalid */
+rstatus_i slabmem_setup(bool hugepage, const char *numa, uint32_t prefault_nthread);
+
+/* advise on and place the pages of memory which is yet to be touched */
+void slabmem_place(void *addr, size_t size);
+
+/* fault in every page of the memory, with several threads if set up so */
+void slabmem_prefault(void *addr, size_t size);
@@ -5,44 +5,119 @@
 
 #include <sysexits.h>
 
+#ifdef TIME_HAVE_TSC
+#include <cpuid.h>
+#endif
+
+#define TSC_CALIBRATE_NS 10000000 /* 10ms */
+
 time_t time_start;
 proc_time_i proc_sec;
 proc_time_fine_i proc_ms;
 proc_time_fine_i proc_us;
 proc_time_fine_i proc_ns;
 
+bool time_tsc = false;
+uint64_t tsc_mult = 0;
+__thread uint64_t local_tsc = 0;
+__thread proc_time_fine_i local_ns = 0;
+
 static struct duration start;
-static struct duration proc_snapshot;
 
 uint8_t time_type = TIME_UNIX;
 
+#ifdef TIME_HAVE_TSC
+/* an invariant TSC ticks at the same rate in all P-, C- and T-states */
+static bool
+_tsc_invariant(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) {
+        return false;
+    }
+
+    return (edx & (1U << 8)) != 0;
+}
+
+/* ns per cycle as a 32.32 fixed point, or 0 if the TSC cannot be used */
+static uint64_t
+_tsc_calibrate(void)
+{
+    struct timespec t0, t1, wait = {0, TSC_CALIBRATE_NS};
+    uint64_t c0, c1, ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    c0 = __rdtsc();
+    nanosleep(&wait, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    c1 = __rdtsc();
+
+    ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * NSEC_PER_SEC + t1.tv_nsec -
+        t0.tv_nsec;
+    if (c1 <= c0) {
+        return 0;
+    }
+
+    return (ns << 32) / (c1 - c0);
+}
+#endif
+
 void
-time_update(void)
+time_anchor(void)
 {
+    /* on the stack, as every thread anchors its own time */
+    struct duration proc_snapshot;
+
     duration_snapshot(&proc_snapshot, &start);
+#ifdef TIME_HAVE_TSC
+    local_tsc = __rdtsc();
+#endif
+    local_ns = (proc_time_fine_i)duration_ns(&proc_snapshot);
+}
 
-    __atomic_store_n(&proc_sec, (proc_time_i)duration_sec(&proc_snapshot),
-            __ATOMIC_RELAXED);
-    __atomic_store_n(&proc_ms, (proc_time_fine_i)duration_ms(&proc_snapshot),
+void
+time_update(void)
+{
+    /* the thread's anchor, as every worker thread updates the time */
+    time_anchor();
+
+    __atomic_store_n(&proc_sec, (proc_time_i)(local_ns / NSEC_PER_SEC),
             __ATOMIC_RELAXED);
-    __atomic_store_n(&proc_us, (proc_time_fine_i)duration_us(&proc_snapshot),
+    __atomic_store_n(&proc_ms, local_ns / (NSEC_PER_SEC / MSEC_PER_SEC),
             __ATOMIC_RELAXED);
-    __atomic_store_n(&proc_ns, (proc_time_fine_i)duration_ns(&proc_snapshot),
+    __atomic_store_n(&proc_us, local_ns / (NSEC_PER_SEC / USEC_PER_SEC),
             __ATOMIC_RELAXED);
+    __atomic_store_n(&proc_ns, local_ns, __ATOMIC_RELAXED);
 }
 
 void
 time_setup(time_options_st *options)
 {
+    bool tsc = true;
+
     if (options != NULL) {
         time_type = option_uint(&options->time_type);
+        tsc = option_bool(&options->time_tsc);
+    }
+
+    time_tsc = false;
+#ifdef TIME_HAVE_TSC
+    if (tsc && _tsc_invariant()) {
+        tsc_mult = _tsc_calibrate();
+        time_tsc = (tsc_mult > 0);
+    }
+#endif
+    if (tsc && !time_tsc) {
+        log_info("no invariant TSC, timing with the clock");
     }
 
     time_start = time(NULL);
     duration_start(&start);
     time_update();
 
-    log_info("timer started at %"PRIu64, (uint64_t)time_start);
+    log_info("timer started at %"PRIu64", TSC at %"PRIu64" ns/2^32 cycles",
+            (uint64_t)time_start, tsc_mult);
 
     if (time_type >= TIME_SENTINEL) {
         exit(EX_CONFIG);
@@ -53,7 +128,8 @@ void
 time_teardown(void)
 {
     duration_reset(&start);
-    duration_reset(&proc_snapshot);
+    time_tsc = false;
+    local_tsc = 0;
 
     log_info("timer ended at %"PRIu64, (uint64_t)time(NULL));
 }
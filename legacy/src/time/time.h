@@ -1,11 +1,17 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <time.h>
 
 #include <cc_debug.h>
 #include <cc_option.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TIME_HAVE_TSC 1
+#endif
+
 /*********
  * Types *
  *********
@@ -69,7 +75,8 @@ enum {
 
 /*          name          type                default           description */
 #define TIME_OPTION(ACTION) \
-    ACTION( time_type,    OPTION_TYPE_UINT,   TIME_MEMCACHE,    "Expiry timestamp mode" )
+    ACTION( time_type,    OPTION_TYPE_UINT,   TIME_MEMCACHE,    "Expiry timestamp mode" )\
+    ACTION( time_tsc,     OPTION_TYPE_BOOL,   true,             "Time w/ TSC if invariant")
 
 typedef struct {
     TIME_OPTION(OPTION_DECLARE)
@@ -97,6 +104,20 @@ extern proc_time_fine_i proc_ms;
 extern proc_time_fine_i proc_us;
 extern proc_time_fine_i proc_ns;
 
+/*
+ * With an invariant TSC, time_now_ns() reads the TSC instead of the clock:
+ * cycles since the calling thread last called time_update() are converted to
+ * ns (with tsc_mult, a 32.32 fixed point calibrated at setup) and added to
+ * the time of that update, which the thread keeps for itself. Anchoring to
+ * the thread's own update keeps the drift from the clock small, and the
+ * thread doesn't share the cache line with other threads.
+ * Without one, time_now_ns() reads the clock.
+ */
+extern bool time_tsc;
+extern uint64_t tsc_mult;
+extern __thread uint64_t local_tsc;
+extern __thread proc_time_fine_i local_ns;
+
 /*******
  * API *
  *******/
@@ -141,6 +162,34 @@ time_proc_ns(void)
     return __atomic_load_n(&proc_ns, __ATOMIC_RELAXED);
 }
 
+void time_anchor(void);
+
+/*
+ * Precise time since the process started, for timing requests; unlike the
+ * above, it is read now rather than as of the last time_update()
+ */
+static inline proc_time_fine_i
+time_now_ns(void)
+{
+#ifdef TIME_HAVE_TSC
+    if (time_tsc) {
+        uint64_t cycles;
+
+        if (local_tsc == 0) {
+            time_anchor();
+        }
+        cycles = __rdtsc() - local_tsc;
+
+        return local_ns +
+            (proc_time_fine_i)(((__uint128_t)cycles * tsc_mult) >> 32);
+    }
+#endif
+
+    time_anchor();
+
+    return local_ns;
+}
+
 /*
  * Current unix timestamp
  */
@@ -0,0 +1,193 @@
+#include "latency.h"
+
+#include <cc_debug.h>
+#include <cc_histogram.h>
+#include <cc_mm.h>
+#include <cc_print.h>
+#include <cc_util.h>
+
+#define LATENCY_MODULE_NAME "util::latency"
+
+/* 16ns resolution under 1us, within 1/32 of the value above, up to ~1s */
+#define HISTO_M 4
+#define HISTO_R 10
+#define HISTO_N 30
+#define LATENCY_MAX ((1ULL << HISTO_N) - 1) /* longer ones are recorded as max */
+
+#define LATENCY_NAME_LEN 32
+#define LATENCY_PRINT_LEN 160 /* max length of the report of one command */
+#define LATENCY_FMT "LATENCY %.*s: count %"PRIu64" p50 %"PRIu64" p90 %"PRIu64 \
+    " p99 %"PRIu64" p999 %"PRIu64" max %"PRIu64 CRLF
+
+static const double percentiles[] = {50, 90, 99, 99.9};
+#define NPERCENTILE (sizeof(percentiles) / sizeof(percentiles[0]))
+
+bool latency_enabled = LATENCY_ENABLE;
+
+static bool latency_init = false;
+static uint32_t nthread = 0;
+static uint32_t ncmd = 0;
+static const struct bstring *cmd_names = NULL;
+static struct histo_u32 **histos = NULL; /* ncmd for each of the threads */
+static uint32_t njoined = 0;
+
+/* only used by the thread reporting */
+static struct histo_u32 *merged = NULL;
+static struct percentile_profile *profile = NULL;
+
+static __thread struct histo_u32 **local = NULL;
+static __thread bool joined = false;
+
+void
+latency_setup(latency_options_st *options, uint32_t n,
+        const struct bstring names[], uint32_t ncommand)
+{
+    uint32_t i;
+
+    log_info("set up the %s module", LATENCY_MODULE_NAME);
+
+    if (latency_init) {
+        log_warn("%s has already been setup, overwrite", LATENCY_MODULE_NAME);
+    }
+
+    latency_enabled = LATENCY_ENABLE;
+    if (options != NULL) {
+        latency_enabled = option_bool(&options->latency_enable);
+    }
+
+    if (!latency_enabled) {
+        latency_init = true;
+        return;
+    }
+
+    nthread = n;
+    ncmd = ncommand;
+    cmd_names = names;
+    njoined = 0;
+    histos = cc_zalloc(sizeof(*histos) * nthread * ncmd);
+    merged = histo_u32_create(HISTO_M, HISTO_R, HISTO_N);
+    profile = percentile_profile_create(NPERCENTILE);
+    if (histos == NULL || merged == NULL || profile == NULL) {
+        goto error;
+    }
+    percentile_profile_set(profile, percentiles, NPERCENTILE);
+
+    for (i = 0; i < nthread * ncmd; ++i) {
+        histos[i] = histo_u32_create(HISTO_M, HISTO_R, HISTO_N);
+        if (histos[i] == NULL) {
+            goto error;
+        }
+    }
+
+    latency_init = true;
+
+    return;
+
+error:
+    log_error("cannot allocate latency histograms for %"PRIu32" threads, "
+            "latency is not recorded", nthread);
+    latency_teardown();
+}
+
+void
+latency_teardown(void)
+{
+    uint32_t i;
+
+    log_info("tear down the %s module", LATENCY_MODULE_NAME);
+
+    if (!latency_init) {
+        log_warn("%s has never been setup", LATENCY_MODULE_NAME);
+    }
+
+    if (histos != NULL) {
+        for (i = 0; i < nthread * ncmd; ++i) {
+            histo_u32_destroy(&histos[i]);
+        }
+        cc_free(histos);
+        histos = NULL;
+    }
+    histo_u32_destroy(&merged);
+    percentile_profile_destroy(&profile);
+    latency_enabled = false;
+    nthread = 0;
+    ncmd = 0;
+    latency_init = false;
+}
+
+/* the thread takes the next set of histograms, if there is one left */
+static void
+_latency_join(void)
+{
+    uint32_t idx = __atomic_fetch_add(&njoined, 1, __ATOMIC_RELAXED);
+
+    joined = true;
+    if (idx >= nthread) {
+        log_warn("latency of thread %"PRIu32" not recorded, only %"PRIu32
+                " threads are", idx, nthread);
+        return;
+    }
+
+    local = &histos[idx * ncmd];
+}
+
+void
+latency_record(uint32_t cmd, uint64_t ns)
+{
+    if (!joined) {
+        _latency_join();
+    }
+
+    if (local == NULL || cmd >= ncmd) {
+        return;
+    }
+
+    histo_u32_record(local[cmd], MIN(ns, LATENCY_MAX), 1);
+}
+
+size_t
+latency_print_cap(void)
+{
+    return latency_enabled ? LATENCY_PRINT_LEN * ncmd : 0;
+}
+
+size_t
+latency_print(char *buf, size_t cap)
+{
+    size_t offset = 0;
+    uint32_t cmd, i;
+
+    if (!latency_enabled) {
+        return 0;
+    }
+
+    for (cmd = 0; cmd < ncmd; ++cmd) {
+        uint32_t len = MIN(cmd_names[cmd].len, LATENCY_NAME_LEN);
+        uint64_t v[NPERCENTILE];
+
+        histo_u32_reset(merged);
+        for (i = 0; i < nthread; ++i) {
+            histo_u32_merge(merged, histos[i * ncmd + cmd]);
+        }
+        if (histo_u32_report_multi(profile, merged) != HISTO_OK) {
+            continue; /* not recorded */
+        }
+
+        for (i = 0; i < NPERCENTILE; ++i) {
+            v[i] = bucket_high(merged, profile->result[i]);
+        }
+
+        /* names may end with the space or CRLF following the command */
+        while (len > 0 && (cmd_names[cmd].data[len - 1] == ' ' ||
+                    cmd_names[cmd].data[len - 1] == '\r' ||
+                    cmd_names[cmd].data[len - 1] == '\n')) {
+            len--;
+        }
+
+        offset += cc_scnprintf(buf + offset, cap - offset, LATENCY_FMT, len,
+                cmd_names[cmd].data, merged->nrecord, v[0], v[1], v[2], v[3],
+                bucket_high(merged, profile->max));
+    }
+
+    return offset;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "time/time.h"
+
+#include <cc_bstring.h>
+#include <cc_option.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Request latency, as seen by the server, is recorded per thread and per
+ * command in log-linear histograms (see cc_histogram.h), which only the
+ * thread itself writes to, and which are merged when they are reported.
+ * A thread is given its histograms the first time it records a latency.
+ */
+
+#define LATENCY_ENABLE false
+
+/*          name            type              default         description */
+#define LATENCY_OPTION(ACTION)                                                 \
+    ACTION( latency_enable, OPTION_TYPE_BOOL, LATENCY_ENABLE, "record request latency" )
+
+typedef struct {
+    LATENCY_OPTION(OPTION_DECLARE)
+} latency_options_st;
+
+extern bool latency_enabled;
+
+/* the time request latency is measured with, in ns */
+static inline uint64_t
+latency_now(void)
+{
+    return (uint64_t)time_now_ns();
+}
+
+/* nthread threads can record latencies of ncmd commands, which are named */
+void latency_setup(latency_options_st *options, uint32_t nthread,
+        const struct bstring names[], uint32_t ncmd);
+void latency_teardown(void);
+
+void latency_record(uint32_t cmd, uint64_t ns);
+
+/* print percentiles of every command recorded, merged over all threads */
+size_t latency_print(char *buf, size_t cap);
+size_t latency_print_cap(void); /* the most latency_print may print */
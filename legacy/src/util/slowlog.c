@@ -0,0 +1,312 @@
+#include "slowlog.h"
+
+#include <cc_debug.h>
+#include <cc_log.h>
+#include <cc_mm.h>
+#include <cc_print.h>
+#include <cc_util.h>
+
+#include <ctype.h>
+#include <string.h>
+
+#define SLOWLOG_MODULE_NAME "util::slowlog"
+
+#define SLOWLOG_KEY_LEN 64   /* longer keys are truncated */
+#define SLOWLOG_NAME_LEN 32
+#define SLOWLOG_PRINT_LEN 384 /* max length of the report of one request */
+#define SLOWLOG_FMT "SLOWLOG %"PRIu64" thread %"PRIu32" %.*s key %.*s nkey %" \
+    PRIu32" vlen %"PRIu32" total %"PRIu64" wait %"PRIu64" parse %"PRIu64      \
+    " process %"PRIu64" evict %"PRIu64" compose %"PRIu64 CRLF
+
+struct slowlog_entry {
+    uint64_t    seq;        /* 2 * index + 1 while written, + 2 after */
+    uint64_t    time;       /* unix time in ms */
+    uint64_t    total;
+    uint64_t    ns[SLOWLOG_NPHASE];
+    uint32_t    cmd;
+    uint32_t    nkey;
+    uint32_t    vlen;
+    uint32_t    klen;
+    char        key[SLOWLOG_KEY_LEN];
+};
+
+struct slowlog_ring {
+    uint64_t                head;   /* # records logged */
+    uint64_t                tail;   /* # records flushed, by the flushing thread */
+    struct slowlog_entry    *entry;
+};
+
+bool slowlog_enabled = false;
+uint64_t slowlog_threshold = 0;
+
+static bool slowlog_init = false;
+static uint32_t nthread = 0;
+static uint32_t nentry = 0;
+static uint32_t ncmd = 0;
+static const struct bstring *cmd_names = NULL;
+static struct slowlog_ring *rings = NULL;
+static uint32_t njoined = 0;
+static struct logger *slowlog_logger = NULL;
+static char *slowlog_buf = NULL; /* for flushing, one record at a time */
+
+static __thread struct slowlog_ring *local = NULL;
+static __thread bool joined = false;
+
+void
+slowlog_setup(slowlog_options_st *options, uint32_t n,
+        const struct bstring names[], uint32_t ncommand)
+{
+    uint32_t i;
+    char *filename = NULL;
+
+    log_info("set up the %s module", SLOWLOG_MODULE_NAME);
+
+    if (slowlog_init) {
+        log_warn("%s has already been setup, overwrite", SLOWLOG_MODULE_NAME);
+    }
+
+    slowlog_enabled = false;
+    slowlog_threshold = SLOWLOG_THRESHOLD * 1000ULL;
+    nentry = SLOWLOG_NENTRY;
+    if (options != NULL) {
+        slowlog_threshold = option_uint(&options->slowlog_threshold) * 1000ULL;
+        nentry = option_uint(&options->slowlog_nentry);
+        filename = option_str(&options->slowlog_file);
+    }
+
+    if (slowlog_threshold == 0 || nentry == 0) {
+        slowlog_init = true;
+        return;
+    }
+
+    nthread = n;
+    ncmd = ncommand;
+    cmd_names = names;
+    njoined = 0;
+    rings = cc_zalloc(sizeof(*rings) * nthread);
+    if (rings == NULL) {
+        goto error;
+    }
+    for (i = 0; i < nthread; ++i) {
+        rings[i].entry = cc_zalloc(sizeof(struct slowlog_entry) * nentry);
+        if (rings[i].entry == NULL) {
+            goto error;
+        }
+    }
+
+    if (filename != NULL) {
+        slowlog_buf = cc_alloc(SLOWLOG_PRINT_LEN);
+        slowlog_logger = log_create(filename, 0);
+        if (slowlog_buf == NULL || slowlog_logger == NULL) {
+            log_error("cannot open slow request log file %s", filename);
+            goto error;
+        }
+    }
+
+    slowlog_enabled = true;
+    slowlog_init = true;
+
+    return;
+
+error:
+    log_error("cannot set up the slow request log for %"PRIu32" threads, "
+            "slow requests are not logged", nthread);
+    slowlog_teardown();
+}
+
+void
+slowlog_teardown(void)
+{
+    uint32_t i;
+
+    log_info("tear down the %s module", SLOWLOG_MODULE_NAME);
+
+    if (!slowlog_init) {
+        log_warn("%s has never been setup", SLOWLOG_MODULE_NAME);
+    }
+
+    if (rings != NULL) {
+        for (i = 0; i < nthread; ++i) {
+            cc_free(rings[i].entry);
+        }
+        cc_free(rings);
+        rings = NULL;
+    }
+    if (slowlog_logger != NULL) {
+        log_destroy(&slowlog_logger);
+    }
+    cc_free(slowlog_buf);
+    slowlog_buf = NULL;
+    slowlog_enabled = false;
+    nthread = 0;
+    ncmd = 0;
+    slowlog_init = false;
+}
+
+/* the thread takes the next ring, if there is one left */
+static void
+_slowlog_join(void)
+{
+    uint32_t idx = __atomic_fetch_add(&njoined, 1, __ATOMIC_RELAXED);
+
+    joined = true;
+    if (idx >= nthread) {
+        log_warn("slow requests of thread %"PRIu32" not logged, only %"PRIu32
+                " threads are", idx, nthread);
+        return;
+    }
+
+    local = &rings[idx];
+}
+
+void
+slowlog_record(const struct slowlog_request *req, uint64_t total)
+{
+    struct slowlog_entry *e;
+    uint64_t head;
+
+    if (!joined) {
+        _slowlog_join();
+    }
+
+    if (local == NULL) {
+        return;
+    }
+
+    /* only this thread writes head, the oldest record is overwritten */
+    head = local->head;
+    e = &local->entry[head % nentry];
+    __atomic_store_n(&e->seq, 2 * head + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    e->time = time_unix_ms();
+    e->total = total;
+    cc_memcpy(e->ns, req->ns, sizeof(e->ns));
+    e->cmd = req->cmd;
+    e->nkey = req->nkey;
+    e->vlen = req->vlen;
+    e->klen = 0;
+    if (req->key != NULL) {
+        e->klen = MIN(req->key->len, SLOWLOG_KEY_LEN);
+        cc_memcpy(e->key, req->key->data, e->klen);
+    }
+
+    __atomic_store_n(&e->seq, 2 * head + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&local->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* copy the record of the given index, false if it is no longer kept */
+static bool
+_slowlog_read(struct slowlog_ring *ring, uint64_t idx, struct slowlog_entry *e)
+{
+    struct slowlog_entry *src = &ring->entry[idx % nentry];
+    uint64_t seq = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE);
+
+    if (seq != 2 * idx + 2) {
+        return false;
+    }
+    cc_memcpy(e, src, sizeof(*e));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&src->seq, __ATOMIC_RELAXED) == seq;
+}
+
+static size_t
+_slowlog_print_entry(char *buf, size_t cap, uint32_t thread,
+        const struct slowlog_entry *e)
+{
+    uint32_t len = 0, i;
+    const char *name = "unknown";
+    char key[SLOWLOG_KEY_LEN];
+
+    if (e->cmd < ncmd) {
+        name = cmd_names[e->cmd].data;
+        len = MIN(cmd_names[e->cmd].len, SLOWLOG_NAME_LEN);
+        /* names may end with the space or CRLF following the command */
+        while (len > 0 && (name[len - 1] == ' ' || name[len - 1] == '\r' ||
+                    name[len - 1] == '\n')) {
+            len--;
+        }
+    } else {
+        len = strlen(name);
+    }
+
+    /* binary keys may hold anything, keep each record on its own line */
+    for (i = 0; i < e->klen; ++i) {
+        key[i] = isgraph((unsigned char)e->key[i]) ? e->key[i] : '.';
+    }
+
+    return cc_scnprintf(buf, cap, SLOWLOG_FMT, e->time, thread, (int)len, name,
+            (int)e->klen, key, e->nkey, e->vlen, e->total, e->ns[SLOWLOG_WAIT],
+            e->ns[SLOWLOG_PARSE], e->ns[SLOWLOG_PROCESS], e->ns[SLOWLOG_EVICT],
+            e->ns[SLOWLOG_COMPOSE]);
+}
+
+void
+slowlog_flush(void *arg)
+{
+    struct slowlog_entry e;
+    uint64_t nlost = 0; /* overwritten before they were flushed */
+    uint32_t i;
+
+    if (!slowlog_enabled || slowlog_logger == NULL) {
+        return;
+    }
+
+    for (i = 0; i < nthread; ++i) {
+        struct slowlog_ring *ring = &rings[i];
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        if (head - ring->tail > nentry) {
+            nlost += head - ring->tail - nentry;
+            ring->tail = head - nentry;
+        }
+        for (; ring->tail < head; ++ring->tail) {
+            size_t len;
+
+            if (!_slowlog_read(ring, ring->tail, &e)) {
+                nlost++;
+                continue;
+            }
+            len = _slowlog_print_entry(slowlog_buf, SLOWLOG_PRINT_LEN, i, &e);
+            log_write(slowlog_logger, slowlog_buf, len);
+        }
+    }
+
+    if (nlost > 0) {
+        log_warn("%"PRIu64" slow requests were not flushed in time", nlost);
+    }
+}
+
+size_t
+slowlog_print_cap(void)
+{
+    return slowlog_enabled ? SLOWLOG_PRINT_LEN * nentry * nthread : 0;
+}
+
+size_t
+slowlog_print(char *buf, size_t cap)
+{
+    struct slowlog_entry e;
+    size_t offset = 0;
+    uint32_t i;
+
+    if (!slowlog_enabled) {
+        return 0;
+    }
+
+    for (i = 0; i < nthread; ++i) {
+        struct slowlog_ring *ring = &rings[i];
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t idx = head > nentry ? head - nentry : 0;
+
+        for (; idx < head; ++idx) {
+            if (_slowlog_read(ring, idx, &e)) {
+                offset += _slowlog_print_entry(buf + offset, cap - offset, i,
+                        &e);
+            }
+        }
+    }
+
+    return offset;
+}
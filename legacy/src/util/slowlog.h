@@ -0,0 +1,84 @@
+#pragma once
+
+#include "time/time.h"
+
+#include <cc_bstring.h>
+#include <cc_option.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Requests that take longer than a threshold are logged, with the time they
+ * spent in each phase, to a ring of the most recent ones kept per thread,
+ * which only the thread itself writes to, so logging takes no lock. Each
+ * record carries a sequence number which is odd while the record is written,
+ * readers skip records that are being or were overwritten while they read
+ * them. A thread is given its ring the first time it logs a request.
+ *
+ * The records of all threads are printed on request, and when a file is
+ * given, slowlog_flush, which runs on a timer outside of the workers, appends
+ * the records logged since it last ran, one line per record.
+ */
+
+#define SLOWLOG_THRESHOLD 0     /* in us, requests aren't logged by default */
+#define SLOWLOG_NENTRY    128   /* keep the last 128 slow requests per thread */
+
+/*          name                type                default             description */
+#define SLOWLOG_OPTION(ACTION)                                                                       \
+    ACTION( slowlog_threshold,  OPTION_TYPE_UINT,   SLOWLOG_THRESHOLD,  "log requests slower (us)"  )\
+    ACTION( slowlog_nentry,     OPTION_TYPE_UINT,   SLOWLOG_NENTRY,     "slow requests per thread"  )\
+    ACTION( slowlog_file,       OPTION_TYPE_STR,    NULL,               "slow request log file"     )
+
+typedef struct {
+    SLOWLOG_OPTION(OPTION_DECLARE)
+} slowlog_options_st;
+
+/* the phases of a request, in the order they take place */
+typedef enum slowlog_phase {
+    SLOWLOG_WAIT,       /* behind earlier requests read along with it */
+    SLOWLOG_PARSE,
+    SLOWLOG_PROCESS,    /* includes eviction */
+    SLOWLOG_EVICT,      /* making room for the values written */
+    SLOWLOG_COMPOSE,
+    SLOWLOG_NPHASE
+} slowlog_phase_e;
+
+struct slowlog_request {
+    uint32_t                cmd;
+    const struct bstring    *key;   /* the first key, if any */
+    uint32_t                nkey;
+    uint32_t                vlen;   /* bytes of value received and sent */
+    uint64_t                ns[SLOWLOG_NPHASE];
+};
+
+extern bool slowlog_enabled;
+extern uint64_t slowlog_threshold; /* in ns */
+
+/* the time phases are measured with, in ns */
+static inline uint64_t
+slowlog_now(void)
+{
+    return (uint64_t)time_now_ns();
+}
+
+/* nthread threads can log requests of ncmd commands, which are named */
+void slowlog_setup(slowlog_options_st *options, uint32_t nthread,
+        const struct bstring names[], uint32_t ncmd);
+void slowlog_teardown(void);
+
+/* log a request which took total ns, if that is above the threshold */
+static inline bool
+slowlog_slow(uint64_t total)
+{
+    return slowlog_enabled && total >= slowlog_threshold;
+}
+void slowlog_record(const struct slowlog_request *req, uint64_t total);
+
+/* append the records logged since the last flush to the file */
+void slowlog_flush(void *arg);
+
+/* print the records kept by all threads, oldest first for each thread */
+size_t slowlog_print(char *buf, size_t cap);
+size_t slowlog_print_cap(void); /* the most slowlog_print may print */
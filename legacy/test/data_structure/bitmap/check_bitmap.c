@@ -63,6 +63,62 @@ START_TEST(test_bitset_getset)
 }
 END_TEST
 
+START_TEST(test_bitset_count)
+{
+    int i;
+
+    bitset_init(bs, NCOL1);
+    for (i = 0; i < COLS_SIZE; i++) {
+        bitset_set(bs, cols[i], 1);
+    }
+
+    ck_assert_int_eq(bitset_count(bs, 0, NCOL1), COLS_SIZE);
+    ck_assert_int_eq(bitset_count(bs, 0, 1), 1);
+    ck_assert_int_eq(bitset_count(bs, 1, 7), 0);
+    ck_assert_int_eq(bitset_count(bs, 1, 8), 1);
+    ck_assert_int_eq(bitset_count(bs, 7, 30), 2);
+    ck_assert_int_eq(bitset_count(bs, 8, 32), 1);
+    ck_assert_int_eq(bitset_count(bs, 29, 43), 2);
+    ck_assert_int_eq(bitset_count(bs, 30, 42), 0);
+    ck_assert_int_eq(bitset_count(bs, 32, NCOL1), 1);
+    ck_assert_int_eq(bitset_count(bs, 7, 7), 0);
+}
+END_TEST
+
+START_TEST(test_bitset_and_or)
+{
+#define NCOL2 1000
+    static uint32_t buf1[bit2long(NCOL2) + 1], buf2[bit2long(NCOL2) + 1];
+    struct bitset *bs1 = (struct bitset *)buf1, *bs2 = (struct bitset *)buf2;
+    int i;
+
+    bitset_init(bs1, NCOL2);
+    bitset_init(bs2, NCOL2);
+    for (i = 0; i < NCOL2; i++) {
+        bitset_set(bs1, i, i % 2 == 0);
+        bitset_set(bs2, i, i % 3 == 0);
+    }
+    ck_assert_int_eq(bs1->count, NCOL2 / 2);
+    /* columns past 255 used to wrap around to the first segments */
+    ck_assert_int_eq(bitset_count(bs1, 0, 256), 128);
+    ck_assert_int_eq(bitset_count(bs1, 256, NCOL2), NCOL2 / 2 - 128);
+
+    bitset_or(bs2, bs1); /* i % 2 == 0 || i % 3 == 0 */
+    ck_assert_int_eq(bs2->count, NCOL2 / 2 + 334 - 167);
+    bitset_and(bs1, bs2);
+    ck_assert_int_eq(bs1->count, NCOL2 / 2);
+    bitset_init(bs2, NCOL2);
+    bitset_set(bs2, 999, 1);
+    bitset_set(bs2, 500, 1);
+    bitset_set(bs2, 3, 1);
+    bitset_and(bs1, bs2);
+    ck_assert_int_eq(bs1->count, 1);
+    ck_assert_int_eq(bitset_get(bs1, 500), 1);
+    ck_assert_int_eq(bitset_count(bs1, 0, 500), 0);
+#undef NCOL2
+}
+END_TEST
+
 /*
  * test suite
  */
@@ -76,6 +132,8 @@ bitmap_suite(void)
 
     tcase_add_test(tc_bitset, test_bitset_init);
     tcase_add_test(tc_bitset, test_bitset_getset);
+    tcase_add_test(tc_bitset, test_bitset_count);
+    tcase_add_test(tc_bitset, test_bitset_and_or);
 
     return s;
 }
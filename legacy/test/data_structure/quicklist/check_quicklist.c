@@ -0,0 +1,329 @@
+#include <data_structure/quicklist/quicklist.h>
+
+#include <cc_bstring.h>
+#include <cc_mm.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+
+/* define for each suite, local scope due to macro visibility rule */
+#define SUITE_NAME "quicklist"
+#define DEBUG_LOG  SUITE_NAME ".log"
+
+#define BUF_SIZE (1024 * 1024)
+#define NENTRY   3000
+
+static uint8_t buf[BUF_SIZE];
+static uint64_t model[NENTRY]; /* values of the list, in order */
+
+static uint64_t
+_get(quicklist_p ql, int64_t idx)
+{
+    zipentry_p ze;
+    struct blob val;
+
+    ck_assert_int_eq(quicklist_locate(&ze, ql, idx), QUICKLIST_OK);
+    ck_assert_int_eq(zipentry_get(&val, ze), ZIPLIST_OK);
+    ck_assert_int_eq(val.type, BLOB_TYPE_INT);
+
+    return val.vint;
+}
+
+static void
+_check(quicklist_p ql, uint32_t n)
+{
+    uint32_t i;
+
+    ck_assert_int_eq(quicklist_nentry(ql), n);
+    for (i = 0; i < n; ++i) {
+        ck_assert_int_eq(_get(ql, i), model[i]);
+    }
+}
+
+/* insert v at idx, and check the quicklist grows by the size predicted */
+static void
+_insert(quicklist_p ql, uint32_t n, uint64_t v, int64_t idx)
+{
+    struct blob val = {.type = BLOB_TYPE_INT, .vint = v};
+    uint32_t size = quicklist_size(ql), delta;
+    uint8_t sz;
+
+    zipentry_size(&sz, &val);
+    delta = quicklist_insert_delta(ql, idx, sz);
+    ck_assert_int_eq(quicklist_insert(ql, &val, idx), QUICKLIST_OK);
+    ck_assert_int_eq(quicklist_size(ql), size + delta);
+
+    idx += (idx < 0) * n;
+    memmove(model + idx + 1, model + idx, (n - idx) * sizeof(uint64_t));
+    model[idx] = v;
+}
+
+
+/*
+ * quicklist tests
+ */
+
+START_TEST(test_quicklist_create)
+{
+    ck_assert_int_eq(quicklist_reset(buf), QUICKLIST_OK);
+    ck_assert_int_eq(quicklist_nentry(buf), 0);
+    ck_assert_int_eq(quicklist_size(buf), QUICKLIST_HEADER_SIZE);
+    ck_assert_int_eq(quicklist_reset(NULL), QUICKLIST_ERROR);
+}
+END_TEST
+
+START_TEST(test_quicklist_push_locate)
+{
+    struct blob val = {.type = BLOB_TYPE_STR, .vstr = str2bstr("foo")};
+    struct quicklist_tail tail;
+    uint32_t i, delta = 0, size;
+    uint8_t sz;
+    zipentry_p ze;
+
+    quicklist_reset(buf);
+    zipentry_size(&sz, &val);
+    quicklist_tail(&tail, buf);
+    for (i = 0; i < 1000; ++i) {
+        delta += quicklist_push_delta(&tail, sz);
+    }
+    for (i = 0; i < 1000; ++i) {
+        ck_assert_int_eq(quicklist_push(buf, &val), QUICKLIST_OK);
+    }
+    size = quicklist_size(buf);
+    ck_assert_int_eq(size, QUICKLIST_HEADER_SIZE + delta);
+    ck_assert_int_eq(quicklist_nentry(buf), 1000);
+    /* chunks are filled up when pushing */
+    ck_assert_int_le(size, QUICKLIST_HEADER_SIZE + (1000 * sz /
+            (QUICKLIST_CHUNK_SIZE - ZIPLIST_HEADER_SIZE - sz) + 1) *
+            (QUICKLIST_CHUNK_SIZE + QUICKLIST_INDEX_SIZE));
+
+    ck_assert_int_eq(quicklist_locate(&ze, buf, -1), QUICKLIST_OK);
+    ck_assert_int_eq(zipentry_compare(ze, &val), 0);
+    ck_assert_int_eq(quicklist_locate(&ze, buf, 1000), QUICKLIST_EOOB);
+    ck_assert_int_eq(quicklist_locate(&ze, buf, -1001), QUICKLIST_EOOB);
+
+    val.vstr.len = ZE_STR_MAXLEN + 1;
+    ck_assert_int_eq(quicklist_push(buf, &val), QUICKLIST_EINVALID);
+    ck_assert_int_eq(quicklist_nentry(buf), 1000);
+}
+END_TEST
+
+START_TEST(test_quicklist_insert_head)
+{
+    uint32_t i;
+
+    quicklist_reset(buf);
+    for (i = 0; i < NENTRY; ++i) {
+        _insert(buf, i, i, 0);
+    }
+    _check(buf, NENTRY);
+    ck_assert_int_eq(_get(buf, 0), NENTRY - 1);
+    ck_assert_int_eq(_get(buf, -1), 0);
+    /* inserts at the head also fill up chunks */
+    ck_assert_int_le(QL_NCHUNK(buf), NENTRY * 4 /
+            (QUICKLIST_CHUNK_SIZE - ZIPLIST_HEADER_SIZE - 4) + 1);
+}
+END_TEST
+
+START_TEST(test_quicklist_short)
+{
+    uint32_t i;
+
+    /* a list of a single chunk costs no more than a ziplist and its index */
+    quicklist_reset(buf);
+    for (i = 0; i < 10; ++i) {
+        _insert(buf, i, i, i / 2);
+    }
+    _check(buf, 10);
+    ck_assert_int_eq(QL_NCHUNK(buf), 1);
+    ck_assert_int_eq(quicklist_size(buf), QUICKLIST_HEADER_SIZE +
+            QUICKLIST_INDEX_SIZE + ZIPLIST_HEADER_SIZE + 10 * 2);
+}
+END_TEST
+
+START_TEST(test_quicklist_remove_val)
+{
+    struct blob val = {.type = BLOB_TYPE_INT};
+    uint32_t i, removed;
+
+    quicklist_reset(buf);
+    for (i = 0; i < NENTRY; ++i) {
+        _insert(buf, i, i % 3, i);
+    }
+
+    /* remove the last 10 occurrences of 1 */
+    val.vint = 1;
+    ck_assert_int_eq(quicklist_remove_val(&removed, buf, &val, -10),
+            QUICKLIST_OK);
+    ck_assert_int_eq(removed, 10);
+    ck_assert_int_eq(_get(buf, -1), 2);
+    ck_assert_int_eq(_get(buf, -2), 0);
+    ck_assert_int_eq(_get(buf, -21), 2);
+    ck_assert_int_eq(_get(buf, -22), 1);
+
+    /* then all occurrences of 0 */
+    val.vint = 0;
+    ck_assert_int_eq(quicklist_remove_val(&removed, buf, &val, NENTRY),
+            QUICKLIST_OK);
+    ck_assert_int_eq(removed, NENTRY / 3);
+    ck_assert_int_eq(quicklist_nentry(buf), NENTRY * 2 / 3 - 10);
+    ck_assert_int_eq(_get(buf, 0), 1);
+    ck_assert_int_eq(_get(buf, 1), 2);
+
+    val.vint = 2;
+    ck_assert_int_eq(quicklist_remove_val(&removed, buf, &val, NENTRY),
+            QUICKLIST_OK);
+    val.vint = 1;
+    ck_assert_int_eq(quicklist_remove_val(&removed, buf, &val, -NENTRY),
+            QUICKLIST_OK);
+    ck_assert_int_eq(quicklist_nentry(buf), 0);
+    ck_assert_int_eq(QL_NCHUNK(buf), 0);
+    ck_assert_int_eq(quicklist_size(buf), QUICKLIST_HEADER_SIZE);
+}
+END_TEST
+
+START_TEST(test_quicklist_trim)
+{
+    uint32_t i;
+
+    quicklist_reset(buf);
+    for (i = 0; i < NENTRY; ++i) {
+        _insert(buf, i, i, i);
+    }
+
+    ck_assert_int_eq(quicklist_trim(buf, 1000, 1500), QUICKLIST_OK);
+    ck_assert_int_eq(quicklist_nentry(buf), 1500);
+    ck_assert_int_eq(_get(buf, 0), 1000);
+    ck_assert_int_eq(_get(buf, -1), 2499);
+
+    ck_assert_int_eq(quicklist_trim(buf, -100, -200), QUICKLIST_OK);
+    ck_assert_int_eq(quicklist_nentry(buf), 200);
+    ck_assert_int_eq(_get(buf, 0), 2200);
+    ck_assert_int_eq(_get(buf, -1), 2399);
+
+    ck_assert_int_eq(quicklist_trim(buf, 150, 1000), QUICKLIST_OK);
+    ck_assert_int_eq(quicklist_nentry(buf), 50);
+    for (i = 0; i < 50; ++i) {
+        ck_assert_int_eq(_get(buf, i), 2350 + i);
+    }
+
+    ck_assert_int_eq(quicklist_trim(buf, 50, 1), QUICKLIST_EOOB);
+    ck_assert_int_eq(quicklist_trim(buf, 0, 0), QUICKLIST_OK);
+    ck_assert_int_eq(quicklist_nentry(buf), 0);
+}
+END_TEST
+
+START_TEST(test_quicklist_seek_next)
+{
+    struct quicklist_iter iter;
+    struct blob val;
+    uint32_t i;
+    int64_t start;
+
+    quicklist_reset(buf);
+    ck_assert_int_eq(quicklist_seek(&iter, buf, 0), QUICKLIST_EOOB);
+    for (i = 0; i < NENTRY; ++i) {
+        _insert(buf, i, i, i / 2);
+    }
+    ck_assert_int_gt(QL_NCHUNK(buf), 2);
+
+    /* walking across chunk boundaries matches locating each entry */
+    for (start = 0; start < NENTRY; start += 997) {
+        ck_assert_int_eq(quicklist_seek(&iter, buf, start), QUICKLIST_OK);
+        for (i = start; i < NENTRY; ++i) {
+            ck_assert_int_eq(zipentry_get(&val, iter.ze), ZIPLIST_OK);
+            ck_assert_int_eq(val.vint, model[i]);
+            ck_assert_int_eq(quicklist_next(&iter, buf),
+                    i + 1 < NENTRY ? QUICKLIST_OK : QUICKLIST_EOOB);
+        }
+    }
+
+    ck_assert_int_eq(quicklist_seek(&iter, buf, -1), QUICKLIST_OK);
+    ck_assert_int_eq(zipentry_get(&val, iter.ze), ZIPLIST_OK);
+    ck_assert_int_eq(val.vint, model[NENTRY - 1]);
+    ck_assert_int_eq(quicklist_next(&iter, buf), QUICKLIST_EOOB);
+    ck_assert_int_eq(quicklist_next(&iter, buf), QUICKLIST_ERROR);
+    ck_assert_int_eq(quicklist_seek(&iter, buf, NENTRY), QUICKLIST_EOOB);
+    ck_assert_int_eq(quicklist_seek(&iter, buf, -NENTRY - 1), QUICKLIST_EOOB);
+}
+END_TEST
+
+/* the quicklist against a plain array, inserting everywhere and removing */
+START_TEST(test_quicklist_random)
+{
+    struct blob val = {.type = BLOB_TYPE_INT};
+    uint32_t i, j, n = 0, removed, expected;
+
+    srand(0);
+    quicklist_reset(buf);
+    for (i = 0; i < 4 * NENTRY; ++i) {
+        if (n < NENTRY && rand() % 4 != 0) {
+            /* big values take 9 bytes, so chunks split at different spots */
+            _insert(buf, n, (rand() % 2) ? rand() % 10 : (1ULL << 60) + rand() %
+                    10, rand() % (n + 1));
+            n++;
+            continue;
+        }
+
+        val.vint = rand() % 10;
+        expected = 0;
+        for (j = 0; j < n; ++j) {
+            if (model[j] == val.vint && expected < 5) {
+                memmove(model + j, model + j + 1, (n - j - 1) *
+                        sizeof(uint64_t));
+                n--;
+                j--;
+                expected++;
+            }
+        }
+        ck_assert_int_eq(quicklist_remove_val(&removed, buf, &val, 5),
+                QUICKLIST_OK);
+        ck_assert_int_eq(removed, expected);
+    }
+    _check(buf, n);
+
+    for (i = 0; i < n; ++i) {
+        ck_assert_int_eq(_get(buf, -(int64_t)i - 1), model[n - i - 1]);
+    }
+}
+END_TEST
+
+
+/*
+ * test suite
+ */
+static Suite *
+quicklist_suite(void)
+{
+    Suite *s = suite_create(SUITE_NAME);
+
+    TCase *tc_quicklist = tcase_create("quicklist");
+    suite_add_tcase(s, tc_quicklist);
+
+    tcase_add_test(tc_quicklist, test_quicklist_create);
+    tcase_add_test(tc_quicklist, test_quicklist_push_locate);
+    tcase_add_test(tc_quicklist, test_quicklist_insert_head);
+    tcase_add_test(tc_quicklist, test_quicklist_short);
+    tcase_add_test(tc_quicklist, test_quicklist_remove_val);
+    tcase_add_test(tc_quicklist, test_quicklist_trim);
+    tcase_add_test(tc_quicklist, test_quicklist_seek_next);
+    tcase_add_test(tc_quicklist, test_quicklist_random);
+
+    return s;
+}
+
+int
+main(void)
+{
+    int nfail;
+
+    Suite *suite = quicklist_suite();
+    SRunner *srunner = srunner_create(suite);
+    srunner_set_log(srunner, DEBUG_LOG);
+    srunner_run_all(srunner, CK_ENV); /* set CK_VEBOSITY in ENV to customize */
+    nfail = srunner_ntests_failed(srunner);
+    srunner_free(srunner);
+
+    return (nfail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -122,6 +122,73 @@ START_TEST(test_sarray_truncate)
 }
 END_TEST
 
+START_TEST(test_sarray_insert_many)
+{
+    uint64_t vals[] = {1, 4, 4, 6, 9};
+    uint64_t unsorted[] = {2, 1};
+    uint64_t expected[] = {1, 3, 4, 6, 9};
+    uint32_t idx, ninserted;
+    uint64_t val;
+
+    sarray_init(buf, 2);
+    sarray_insert(buf, 3);
+    sarray_insert(buf, 6);
+    ck_assert_int_eq(sarray_insert_many(&ninserted, buf, vals, 5), SARRAY_OK);
+    ck_assert_int_eq(ninserted, 3); /* [1, 3, 4, 6, 9] */
+    ck_assert_int_eq(sarray_nentry(buf), 5);
+    for (idx = 0; idx < 5; ++idx) {
+        ck_assert_int_eq(sarray_value(&val, buf, idx), SARRAY_OK);
+        ck_assert_int_eq(val, expected[idx]);
+    }
+    ck_assert_int_eq(sarray_insert_many(&ninserted, buf, vals, 5), SARRAY_OK);
+    ck_assert_int_eq(ninserted, 0);
+
+    ck_assert_int_eq(sarray_insert_many(&ninserted, buf, unsorted, 2),
+            SARRAY_EINVALID);
+    vals[4] = 1 << 16;
+    ck_assert_int_eq(sarray_insert_many(&ninserted, buf, vals, 5),
+            SARRAY_EINVALID);
+    ck_assert_int_eq(sarray_nentry(buf), 5);
+}
+END_TEST
+
+/* lookups of every width against a plain array, past the scan threshold */
+START_TEST(test_sarray_many)
+{
+    static uint64_t model[NENTRY];
+    static const uint32_t esize[] = {1, 2, 4, 8};
+    uint32_t i, j, n, idx;
+    uint64_t val, max;
+
+    srand(0);
+    for (i = 0; i < 4; ++i) {
+        max = (esize[i] == 8) ? UINT64_MAX : (1ULL << (esize[i] * 8)) - 1;
+        sarray_init(buf, esize[i]);
+        n = 0;
+        for (j = 0; j < NENTRY; ++j) {
+            val = (((uint64_t)rand() << 32) ^ rand()) & max;
+            if (sarray_index(&idx, buf, val) == SARRAY_OK) {
+                ck_assert_int_eq(sarray_insert(buf, val), SARRAY_EDUP);
+                continue;
+            }
+            ck_assert_int_eq(sarray_insert(buf, val), SARRAY_OK);
+            model[n++] = val;
+        }
+        ck_assert_int_eq(sarray_nentry(buf), n);
+
+        for (j = 0; j < n; ++j) {
+            ck_assert_int_eq(sarray_index(&idx, buf, model[j]), SARRAY_OK);
+            ck_assert_int_eq(sarray_value(&val, buf, idx), SARRAY_OK);
+            ck_assert(val == model[j]);
+            if (idx > 0) {
+                ck_assert_int_eq(sarray_value(&val, buf, idx - 1), SARRAY_OK);
+                ck_assert(val < model[j]);
+            }
+        }
+    }
+}
+END_TEST
+
 
 /*
  * test suite
@@ -138,6 +205,8 @@ sarray_suite(void)
     tcase_add_test(tc_sarray, test_sarray_insert_seek);
     tcase_add_test(tc_sarray, test_sarray_remove);
     tcase_add_test(tc_sarray, test_sarray_truncate);
+    tcase_add_test(tc_sarray, test_sarray_insert_many);
+    tcase_add_test(tc_sarray, test_sarray_many);
 
     return s;
 }
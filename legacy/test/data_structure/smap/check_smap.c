@@ -156,6 +156,45 @@ START_TEST(test_smap_value)
 }
 END_TEST
 
+/* lookups of every key width against a plain array, past the scan threshold */
+START_TEST(test_smap_many)
+{
+    static uint64_t model[NENTRY];
+    static const uint16_t ksize[] = {1, 2, 4, 8};
+    uint32_t i, j, n, idx;
+    uint64_t key, max;
+
+    srand(0);
+    for (i = 0; i < 4; ++i) {
+        max = (ksize[i] == 8) ? UINT64_MAX : (1ULL << (ksize[i] * 8)) - 1;
+        smap_init(buf, ksize[i], 4);
+        n = 0;
+        for (j = 0; j < NENTRY; ++j) {
+            key = (((uint64_t)rand() << 32) ^ rand()) & max;
+            if (smap_index(&idx, buf, key) == SMAP_OK) {
+                ck_assert_int_eq(smap_insert(buf, key, &str2bstr("abcd")),
+                        SMAP_EDUP);
+                continue;
+            }
+            ck_assert_int_eq(smap_insert(buf, key, &str2bstr("abcd")), SMAP_OK);
+            model[n++] = key;
+        }
+        ck_assert_int_eq(smap_nentry(buf), n);
+
+        for (j = 0; j < n; ++j) {
+            ck_assert_int_eq(smap_index(&idx, buf, model[j]), SMAP_OK);
+            ck_assert_int_eq(smap_keyval(&key, &val_read, buf, idx), SMAP_OK);
+            ck_assert(key == model[j]);
+            if (idx > 0) {
+                ck_assert_int_eq(smap_keyval(&key, &val_read, buf, idx - 1),
+                        SMAP_OK);
+                ck_assert(key < model[j]);
+            }
+        }
+    }
+}
+END_TEST
+
 
 /*
  * test suite
@@ -173,6 +212,7 @@ smap_suite(void)
     tcase_add_test(tc_smap, test_smap_remove);
     tcase_add_test(tc_smap, test_smap_truncate);
     tcase_add_test(tc_smap, test_smap_value);
+    tcase_add_test(tc_smap, test_smap_many);
 
     return s;
 }
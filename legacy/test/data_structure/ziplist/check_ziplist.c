@@ -343,6 +343,16 @@ START_TEST(test_ziplist_removeval)
     ck_assert(ziplist_find(NULL, NULL, (ziplist_p)buf, &ze_examples[3].decoded)
             == ZIPLIST_ENOTFOUND);
 
+    /* removing the tail going forward, or the head going backward */
+    cc_memcpy(buf, ref, ziplist_size((ziplist_p)ref));
+    ck_assert(ziplist_remove_val(&removed, (ziplist_p)buf,
+                &ze_examples[n_ze - 1].decoded, n_ze) == ZIPLIST_OK);
+    ck_assert_int_eq(removed, 1);
+    ck_assert_uint_eq(ziplist_nentry((ziplist_p)buf), n_ze - 1);
+    ck_assert(ziplist_remove_val(&removed, (ziplist_p)buf,
+                &ze_examples[0].decoded, -n_ze) == ZIPLIST_OK);
+    ck_assert_int_eq(removed, 1);
+    ck_assert_uint_eq(ziplist_nentry((ziplist_p)buf), n_ze - 2);
 }
 END_TEST
 
@@ -0,0 +1,269 @@
+#include <data_structure/zset/zset.h>
+
+#include <cc_bstring.h>
+#include <cc_mm.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <check.h>
+
+/* define for each suite, local scope due to macro visibility rule */
+#define SUITE_NAME "zset"
+#define DEBUG_LOG  SUITE_NAME ".log"
+
+#define NENTRY 1024
+#define MLEN   16
+
+#define BUF_SIZE (NENTRY * (ZS_ENTRY_SIZE(MLEN) + 8) + ZSET_HEADER_SIZE)
+
+static char buf[BUF_SIZE];
+static char mbuf[NENTRY][MLEN];
+
+/* member i is "m" followed by i in decimal */
+static struct bstring
+_member(int i)
+{
+    struct bstring m;
+
+    m.len = snprintf(mbuf[i], MLEN, "m%d", i);
+    m.data = mbuf[i];
+
+    return m;
+}
+
+
+/*
+ * zset tests
+ */
+
+START_TEST(test_zset_create)
+{
+    ck_assert_int_eq(zset_init(buf), ZSET_OK);
+    ck_assert_int_eq(zset_nentry(buf), 0);
+    ck_assert_int_eq(zset_size(buf), ZSET_HEADER_SIZE);
+    ck_assert_int_eq(zset_esize(&str2bstr("a")), 20);
+    ck_assert_int_eq(zset_esize(&str2bstr("ab")), 20);
+    ck_assert_int_eq(zset_esize(&str2bstr("abc")), 24);
+    ck_assert_int_eq(zset_init(NULL), ZSET_ERROR);
+}
+END_TEST
+
+START_TEST(test_zset_insert_seek)
+{
+    struct bstring m = str2bstr("b"), m_read;
+    double score;
+    uint32_t rank, size;
+
+    zset_init(buf);
+    ck_assert_int_eq(zset_insert(buf, &m, 2.0), ZSET_OK);
+    ck_assert_int_eq(zset_insert(buf, &str2bstr("a"), 2.0), ZSET_OK);
+    ck_assert_int_eq(zset_insert(buf, &str2bstr("c"), -1.5), ZSET_OK);
+    ck_assert_int_eq(zset_insert(buf, &str2bstr("cc"), INFINITY), ZSET_OK);
+    ck_assert_int_eq(zset_insert(buf, &m, 3.0), ZSET_EDUP);
+    ck_assert_int_eq(zset_insert(buf, &str2bstr("d"), NAN), ZSET_EINVALID);
+    ck_assert_int_eq(zset_nentry(buf), 4);
+    size = ZSET_HEADER_SIZE + zset_esize(&m) * 3 + zset_esize(&str2bstr("cc"));
+    ck_assert_int_eq(zset_size(buf), size);
+
+    /* [(-1.5, c), (2, a), (2, b), (inf, cc)] */
+    ck_assert_int_eq(zset_entry(&score, &m_read, buf, 0), ZSET_OK);
+    ck_assert(score == -1.5);
+    ck_assert_int_eq(bstring_compare(&m_read, &str2bstr("c")), 0);
+    ck_assert_int_eq(zset_entry(&score, &m_read, buf, 1), ZSET_OK);
+    ck_assert_int_eq(bstring_compare(&m_read, &str2bstr("a")), 0);
+    ck_assert_int_eq(zset_entry(&score, &m_read, buf, 3), ZSET_OK);
+    ck_assert(score == INFINITY);
+    ck_assert_int_eq(zset_entry(&score, &m_read, buf, 4), ZSET_EOOB);
+
+    ck_assert_int_eq(zset_score(&score, buf, &m), ZSET_OK);
+    ck_assert(score == 2.0);
+    ck_assert_int_eq(zset_score(&score, buf, &str2bstr("x")), ZSET_ENOTFOUND);
+    ck_assert_int_eq(zset_rank(&rank, buf, &m), ZSET_OK);
+    ck_assert_int_eq(rank, 2);
+    ck_assert_int_eq(zset_rank(&rank, buf, &str2bstr("cc")), ZSET_OK);
+    ck_assert_int_eq(rank, 3);
+    ck_assert_int_eq(zset_rank(&rank, buf, &str2bstr("x")), ZSET_ENOTFOUND);
+
+    ck_assert_int_eq(zset_count_below(buf, 2.0, false), 1);
+    ck_assert_int_eq(zset_count_below(buf, 2.0, true), 3);
+    ck_assert_int_eq(zset_count_below(buf, -INFINITY, true), 0);
+    ck_assert_int_eq(zset_count_below(buf, INFINITY, true), 4);
+}
+END_TEST
+
+START_TEST(test_zset_update)
+{
+    struct bstring m = str2bstr("b"), m_read;
+    double score;
+    uint32_t rank;
+
+    zset_init(buf);
+    zset_insert(buf, &str2bstr("a"), 1.0);
+    zset_insert(buf, &m, 2.0);
+    zset_insert(buf, &str2bstr("c"), 3.0);
+
+    ck_assert_int_eq(zset_update(buf, &m, 4.0), ZSET_OK);
+    ck_assert_int_eq(zset_rank(&rank, buf, &m), ZSET_OK);
+    ck_assert_int_eq(rank, 2);
+    ck_assert_int_eq(zset_update(buf, &m, 0.0), ZSET_OK);
+    ck_assert_int_eq(zset_rank(&rank, buf, &m), ZSET_OK);
+    ck_assert_int_eq(rank, 0);
+    ck_assert_int_eq(zset_update(buf, &m, 1.0), ZSET_OK); /* ties go by member */
+    ck_assert_int_eq(zset_rank(&rank, buf, &m), ZSET_OK);
+    ck_assert_int_eq(rank, 1);
+    ck_assert_int_eq(zset_entry(&score, &m_read, buf, 0), ZSET_OK);
+    ck_assert_int_eq(bstring_compare(&m_read, &str2bstr("a")), 0);
+    ck_assert_int_eq(zset_update(buf, &m, NAN), ZSET_EINVALID);
+    ck_assert_int_eq(zset_update(buf, &str2bstr("x"), 1.0), ZSET_ENOTFOUND);
+    ck_assert_int_eq(zset_nentry(buf), 3);
+}
+END_TEST
+
+START_TEST(test_zset_remove)
+{
+    struct bstring m_read;
+    double score;
+    uint32_t rank;
+
+    zset_init(buf);
+    zset_insert(buf, &str2bstr("a"), 1.0);
+    zset_insert(buf, &str2bstr("bb"), 2.0);
+    zset_insert(buf, &str2bstr("ccc"), 3.0);
+    zset_insert(buf, &str2bstr("dddd"), 4.0);
+
+    ck_assert_int_eq(zset_remove(buf, &str2bstr("bb")), ZSET_OK);
+    ck_assert_int_eq(zset_remove(buf, &str2bstr("bb")), ZSET_ENOTFOUND);
+    ck_assert_int_eq(zset_nentry(buf), 3);
+    ck_assert_int_eq(zset_rank(&rank, buf, &str2bstr("dddd")), ZSET_OK);
+    ck_assert_int_eq(rank, 2);
+    ck_assert_int_eq(zset_score(&score, buf, &str2bstr("ccc")), ZSET_OK);
+    ck_assert(score == 3.0);
+
+    ck_assert_int_eq(zset_remove_rank(buf, 0), ZSET_OK);
+    ck_assert_int_eq(zset_remove_rank(buf, 2), ZSET_EOOB);
+    ck_assert_int_eq(zset_entry(&score, &m_read, buf, 0), ZSET_OK);
+    ck_assert_int_eq(bstring_compare(&m_read, &str2bstr("ccc")), 0);
+    ck_assert_int_eq(zset_entry(&score, &m_read, buf, 1), ZSET_OK);
+    ck_assert_int_eq(bstring_compare(&m_read, &str2bstr("dddd")), 0);
+    ck_assert_int_eq(zset_size(buf), ZSET_HEADER_SIZE +
+            zset_esize(&str2bstr("ccc")) + zset_esize(&str2bstr("dddd")));
+
+    zset_remove_rank(buf, 1);
+    zset_remove_rank(buf, 0);
+    ck_assert_int_eq(zset_nentry(buf), 0);
+    ck_assert_int_eq(zset_size(buf), ZSET_HEADER_SIZE);
+}
+END_TEST
+
+/* the zset against scores kept on the side, past the linear scan threshold */
+START_TEST(test_zset_many)
+{
+#define N 500
+    static double scores[N]; /* NAN if not a member */
+    struct bstring m, m_read;
+    double score, prev;
+    uint32_t rank, below;
+    int i, j, n = 0;
+
+    srand(0);
+    zset_init(buf);
+    for (i = 0; i < N; ++i) {
+        scores[i] = NAN;
+    }
+
+    for (j = 0; j < 20 * N; ++j) {
+        i = rand() % N;
+        m = _member(i);
+        score = (double)(rand() % 50);
+        switch (rand() % 3) {
+        case 0:
+            ck_assert_int_eq(zset_insert(buf, &m, score),
+                    isnan(scores[i]) ? ZSET_OK : ZSET_EDUP);
+            if (isnan(scores[i])) {
+                scores[i] = score;
+                n++;
+            }
+            break;
+        case 1:
+            ck_assert_int_eq(zset_update(buf, &m, score),
+                    isnan(scores[i]) ? ZSET_ENOTFOUND : ZSET_OK);
+            if (!isnan(scores[i])) {
+                scores[i] = score;
+            }
+            break;
+        default:
+            ck_assert_int_eq(zset_remove(buf, &m),
+                    isnan(scores[i]) ? ZSET_ENOTFOUND : ZSET_OK);
+            if (!isnan(scores[i])) {
+                scores[i] = NAN;
+                n--;
+            }
+        }
+    }
+
+    ck_assert_int_eq(zset_nentry(buf), n);
+    prev = -INFINITY;
+    for (rank = 0; rank < (uint32_t)n; ++rank) {
+        uint32_t r;
+
+        ck_assert_int_eq(zset_entry(&score, &m_read, buf, rank), ZSET_OK);
+        ck_assert(score >= prev);
+        ck_assert_int_eq(zset_rank(&r, buf, &m_read), ZSET_OK);
+        ck_assert_int_eq(r, rank);
+        prev = score;
+    }
+    for (i = 0; i < N; ++i) {
+        m = _member(i);
+        if (isnan(scores[i])) {
+            ck_assert_int_eq(zset_score(&score, buf, &m), ZSET_ENOTFOUND);
+            continue;
+        }
+        ck_assert_int_eq(zset_score(&score, buf, &m), ZSET_OK);
+        ck_assert(score == scores[i]);
+
+        below = 0;
+        for (j = 0; j < N; ++j) {
+            below += !isnan(scores[j]) && scores[j] < scores[i];
+        }
+        ck_assert_int_eq(zset_count_below(buf, scores[i], false), below);
+    }
+#undef N
+}
+END_TEST
+
+
+/*
+ * test suite
+ */
+static Suite *
+zset_suite(void)
+{
+    Suite *s = suite_create(SUITE_NAME);
+
+    TCase *tc_zset = tcase_create("zset");
+    suite_add_tcase(s, tc_zset);
+
+    tcase_add_test(tc_zset, test_zset_create);
+    tcase_add_test(tc_zset, test_zset_insert_seek);
+    tcase_add_test(tc_zset, test_zset_update);
+    tcase_add_test(tc_zset, test_zset_remove);
+    tcase_add_test(tc_zset, test_zset_many);
+
+    return s;
+}
+
+int
+main(void)
+{
+    int nfail;
+
+    Suite *suite = zset_suite();
+    SRunner *srunner = srunner_create(suite);
+    srunner_set_log(srunner, DEBUG_LOG);
+    srunner_run_all(srunner, CK_ENV); /* set CK_VEBOSITY in ENV to customize */
+    nfail = srunner_ntests_failed(srunner);
+    srunner_free(srunner);
+
+    return (nfail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
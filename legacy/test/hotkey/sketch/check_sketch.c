@@ -0,0 +1,190 @@
+#include <hotkey/sketch.h>
+
+#include <hotkey/constant.h>
+
+#include <check.h>
+
+#include <cc_bstring.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SUITE_NAME "sketch"
+#define DEBUG_LOG  SUITE_NAME ".log"
+
+#define TEST_WIDTH  1024
+#define TEST_WINDOW 10000
+#define TEST_NTOP   8
+
+static struct sketch *sk = NULL;
+
+/*
+ * utilities
+ */
+static void
+test_setup(void)
+{
+    sk = sketch_create(TEST_WIDTH, TEST_WINDOW, TEST_NTOP);
+}
+
+static void
+test_teardown(void)
+{
+    sketch_destroy(&sk);
+}
+
+static void
+test_reset(void)
+{
+    sketch_reset(sk);
+}
+
+/* position of key among the keys kept, or -1 */
+static int
+_find_top(const struct bstring *key)
+{
+    uint32_t i;
+
+    for (i = 0; i < sk->nentry; ++i) {
+        if (sk->top[i].klen == key->len &&
+                memcmp(sk->top[i].key, key->data, key->len) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**************
+ * test cases *
+ **************/
+
+START_TEST(test_basic)
+{
+#define KEY1 "key1"
+#define KEY2 "key22"
+    uint32_t count;
+    struct bstring key1 = str2bstr(KEY1), key2 = str2bstr(KEY2);
+
+    test_reset();
+
+    ck_assert_int_eq(sketch_estimate(sk, &key1), 0);
+
+    count = sketch_incr(sk, &key1);
+    ck_assert_int_eq(count, 1);
+
+    count = sketch_incr(sk, &key2);
+    ck_assert_int_eq(count, 1);
+
+    count = sketch_incr(sk, &key1);
+    ck_assert_int_eq(count, 2);
+    ck_assert_int_eq(sketch_estimate(sk, &key1), 2);
+    ck_assert_int_eq(sketch_estimate(sk, &key2), 1);
+
+    ck_assert_int_eq(sk->nentry, 2);
+    ck_assert_int_ge(_find_top(&key1), 0);
+    ck_assert_int_eq(sk->top[_find_top(&key1)].count, 2);
+    ck_assert_int_ge(_find_top(&key2), 0);
+#undef KEY1
+#undef KEY2
+}
+END_TEST
+
+START_TEST(test_top)
+{
+#define NHOT 4
+#define NCOLD 1500
+    char buf[MAX_KEY_LEN];
+    struct bstring key = {0, buf};
+    uint32_t i, j, est;
+
+    test_reset();
+
+    /* a few keys sampled often among many sampled once */
+    for (i = 0; i < NCOLD; ++i) {
+        key.len = sprintf(buf, "cold%u", i);
+        est = sketch_incr(sk, &key);
+        ck_assert_int_ge(est, 1);
+        for (j = 0; j < NHOT; ++j) {
+            key.len = sprintf(buf, "hot%u", j);
+            est = sketch_incr(sk, &key);
+            ck_assert_int_ge(est, i + 1);
+        }
+    }
+
+    ck_assert_int_eq(sk->nentry, TEST_NTOP);
+    for (j = 0; j < NHOT; ++j) {
+        key.len = sprintf(buf, "hot%u", j);
+        ck_assert_int_ge(_find_top(&key), 0);
+        ck_assert_int_ge(sk->top[_find_top(&key)].count, NCOLD);
+    }
+#undef NCOLD
+#undef NHOT
+}
+END_TEST
+
+START_TEST(test_decay)
+{
+#define KEY1 "key1"
+#define KEY2 "key22"
+    struct bstring key1 = str2bstr(KEY1), key2 = str2bstr(KEY2);
+    uint32_t i;
+
+    test_reset();
+
+    for (i = 0; i < TEST_WINDOW - 1; ++i) {
+        sketch_incr(sk, &key1);
+    }
+    ck_assert_int_eq(sketch_estimate(sk, &key1), TEST_WINDOW - 1);
+
+    /* the last sample of the window halves all counts */
+    sketch_incr(sk, &key2);
+    ck_assert_int_eq(sketch_estimate(sk, &key1), (TEST_WINDOW - 1) / 2);
+    ck_assert_int_eq(sketch_estimate(sk, &key2), 0);
+    ck_assert_int_eq(sk->top[_find_top(&key1)].count, (TEST_WINDOW - 1) / 2);
+    ck_assert_int_eq(sk->nsample, 0);
+#undef KEY1
+#undef KEY2
+}
+END_TEST
+
+/*
+ * test suite
+ */
+static Suite *
+sketch_suite(void)
+{
+    Suite *s = suite_create(SUITE_NAME);
+
+    /* basic functionality */
+    TCase *tc_basic_sketch = tcase_create("basic sketch");
+    suite_add_tcase(s, tc_basic_sketch);
+
+    tcase_add_test(tc_basic_sketch, test_basic);
+    tcase_add_test(tc_basic_sketch, test_top);
+    tcase_add_test(tc_basic_sketch, test_decay);
+
+    return s;
+}
+
+int
+main(void)
+{
+    int nfail;
+
+    /* setup */
+    test_setup();
+
+    Suite *suite = sketch_suite();
+    SRunner *srunner = srunner_create(suite);
+    srunner_set_log(srunner, DEBUG_LOG);
+    srunner_run_all(srunner, CK_ENV); /* set CK_VERBOSITY in ENV to customize */
+    nfail = srunner_ntests_failed(srunner);
+    srunner_free(srunner);
+
+    /* teardown */
+    test_teardown();
+
+    return (nfail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -24,6 +24,7 @@ struct buf *buf;
 static void
 test_setup(void)
 {
+    buf_setup(NULL, NULL);
     req = request_create();
     rsp = response_create();
     buf = buf_create();
@@ -43,6 +44,7 @@ test_teardown(void)
     buf_destroy(&buf);
     response_destroy(&rsp);
     request_destroy(&req);
+    buf_teardown();
 }
 
 /**************
@@ -263,6 +265,93 @@ START_TEST(test_gets)
 }
 END_TEST
 
+START_TEST(test_get_pipelined)
+{
+#define SERIALIZED "get a  b \r\ngets c\r\nget d\re\r\nget \r\nget f"
+
+    int ret;
+    char *pos;
+    struct bstring key;
+
+    test_reset();
+    buf_write(buf, SERIALIZED, sizeof(SERIALIZED) - 1);
+
+    /* complete lines go through the same as they would byte by byte */
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_OK);
+    ck_assert(req->type == REQ_GET);
+    ck_assert_int_eq(array_nelem(req->keys), 2);
+    key = str2bstr("a");
+    ck_assert_int_eq(bstring_compare(&key, array_get(req->keys, 0)), 0);
+    key = str2bstr("b");
+    ck_assert_int_eq(bstring_compare(&key, array_get(req->keys, 1)), 0);
+
+    request_reset(req);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_OK);
+    ck_assert(req->type == REQ_GETS);
+    ck_assert_int_eq(array_nelem(req->keys), 1);
+    key = str2bstr("c");
+    ck_assert_int_eq(bstring_compare(&key, array_first(req->keys)), 0);
+
+    /* a CR that does not end the line is part of the key */
+    request_reset(req);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_OK);
+    ck_assert_int_eq(array_nelem(req->keys), 1);
+    key = str2bstr("d\re");
+    ck_assert_int_eq(bstring_compare(&key, array_first(req->keys)), 0);
+
+    request_reset(req);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_EOTHER);
+
+    /* an incomplete line is left for later */
+    request_reset(req);
+    pos = buf->rpos;
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_EUNFIN);
+    ck_assert(buf->rpos == pos);
+#undef SERIALIZED
+}
+END_TEST
+
+START_TEST(test_get_limits)
+{
+    char line[MAX_TOKEN_LEN + 16];
+    int i, ret;
+
+    /* the key, with any spaces before it, can take up to MAX_TOKEN_LEN bytes */
+    test_reset();
+    buf_write(buf, "get  ", 5);
+    for (i = 0; i < MAX_TOKEN_LEN - 1; i++) {
+        line[i] = 'k';
+    }
+    buf_write(buf, line, MAX_TOKEN_LEN - 1);
+    buf_write(buf, "\r\n", CRLF_LEN);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_OK);
+    ck_assert_int_eq(((struct bstring *)array_first(req->keys))->len,
+            MAX_TOKEN_LEN - 1);
+
+    test_reset();
+    buf_write(buf, "get  ", 5);
+    buf_write(buf, line, MAX_TOKEN_LEN);
+    buf_write(buf, "\r\n", CRLF_LEN);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_EOVERSIZE);
+
+    test_reset();
+    buf_write(buf, "get", 3);
+    for (i = 0; i <= MAX_BATCH_SIZE; i++) {
+        buf_write(buf, " k", 2);
+    }
+    buf_write(buf, "\r\n", CRLF_LEN);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_EOTHER);
+}
+END_TEST
+
 START_TEST(test_set)
 {
 #define SERIALIZED "set foo 123 86400 3\r\nXYZ\r\n"
@@ -986,6 +1075,117 @@ START_TEST(test_value)
 }
 END_TEST
 
+START_TEST(test_value_chained)
+{
+#define HEADER "VALUE foo 0 40000\r\n"
+#define KEY "foo"
+#define VLEN 40000
+
+    int ret;
+    int len = sizeof(HEADER) - 1 + VLEN + CRLF_LEN;
+    char val[VLEN];
+    struct bstring key = str2bstr(KEY);
+    struct buf *b;
+    uint32_t i, n = 0, nbuf = 0;
+
+    test_reset();
+
+    for (i = 0; i < VLEN; ++i) {
+        val[i] = 'a' + i % 26;
+    }
+
+    /* a value larger than the buffer is spread over chained buffers */
+    rsp->type = RSP_VALUE;
+    rsp->key = key;
+    rsp->vstr.len = VLEN;
+    rsp->vstr.data = val;
+    ret = compose_rsp(&buf, rsp);
+    ck_assert_msg(ret == len, "expected: %d, returned: %d", len, ret);
+    ck_assert_ptr_ne(buf->chain, NULL);
+    ck_assert_int_eq(cc_bcmp(buf->rpos, HEADER, sizeof(HEADER) - 1), 0);
+
+    /* what follows goes to the last buffer */
+    response_reset(rsp);
+    rsp->type = RSP_END;
+    ret = compose_rsp(&buf, rsp);
+    ck_assert_int_eq(ret, sizeof("END\r\n") - 1);
+    ck_assert_int_eq(cc_bcmp((*buf_chain_tail(&buf))->wpos - ret, "END\r\n",
+                ret), 0);
+
+    for (b = buf; b != NULL; b = b->chain) {
+        uint32_t off = (b == buf) ? sizeof(HEADER) - 1 : 0;
+        uint32_t vpart = MIN(buf_rsize(b) - off, VLEN - n);
+
+        ck_assert_int_eq(cc_bcmp(b->rpos + off, val + n, vpart), 0);
+        n += vpart;
+        nbuf++;
+    }
+    ck_assert_int_eq(n, VLEN);
+    ck_assert_int_ge(nbuf, 3);
+
+    /* chained buffers are returned on reset */
+    buf_reset(buf);
+    ck_assert_ptr_eq(buf->chain, NULL);
+#undef VLEN
+#undef KEY
+#undef HEADER
+}
+END_TEST
+
+static int nrelease;
+
+static void
+_release(void *ref)
+{
+    ck_assert_ptr_eq(ref, &nrelease);
+    nrelease++;
+}
+
+START_TEST(test_value_ref)
+{
+#define SERIALIZED "VALUE foo 0 3\r\nXYZ\r\n"
+#define KEY "foo"
+#define VAL "XYZ"
+
+    int ret;
+    int len = sizeof(SERIALIZED) - 1;
+    char val[] = VAL;
+    struct bstring key = str2bstr(KEY);
+    struct buf *ref;
+
+    test_reset();
+    nrelease = 0;
+
+    /* the value is referred to by a buffer chained between header and CRLF */
+    rsp->type = RSP_VALUE;
+    rsp->key = key;
+    rsp->vstr.len = sizeof(VAL) - 1;
+    rsp->vstr.data = val;
+    ret = compose_rsp_ref(&buf, rsp, _release, &nrelease);
+    ck_assert_msg(ret == len, "expected: %d, returned: %d", len, ret);
+    ref = buf->chain;
+    ck_assert_ptr_ne(ref, NULL);
+    ck_assert_ptr_eq(ref->rpos, val);
+    ck_assert_ptr_ne(ref->chain, NULL);
+    ck_assert_int_eq(cc_bcmp(ref->chain->rpos, CRLF, CRLF_LEN), 0);
+    ck_assert_uint_eq(buf_chain_rsize(buf), len);
+    ck_assert_int_eq(nrelease, 0);
+
+    /* once copied, the buffers hold what was composed */
+    ck_assert_int_eq(buf_chain_unref(buf), CC_OK);
+    ck_assert_int_eq(nrelease, 1);
+    ck_assert_uint_eq(buf_chain_rsize(buf), len);
+    ck_assert_int_eq(cc_bcmp(buf->rpos, SERIALIZED, buf_rsize(buf)), 0);
+
+    buf_reset(buf);
+    ck_assert_ptr_eq(buf->chain, NULL);
+    ck_assert_int_eq(nrelease, 1);
+#undef VAL
+#undef KEY
+#undef SERIALIZED
+}
+END_TEST
+
 START_TEST(test_numeric)
 {
 #define SERIALIZED "9223372036854775807\r\n"
@@ -1290,6 +1490,155 @@ START_TEST(test_req_pool_basic)
 }
 END_TEST
 
+/*
+ * binary protocol
+ */
+START_TEST(test_binary_set)
+{
+/* SETQ, key "foo", flag 123, expiry 86400, value "XYZ", opaque 7 */
+#define HEADER "\x80\x11\x00\x03\x08\x00\x00\x00\x00\x00\x00\x0e\x00\x00\x00\x07" \
+    "\x00\x00\x00\x00\x00\x00\x00\x00"
+#define EXTRAS "\x00\x00\x00\x7b\x00\x01\x51\x80"
+#define KEY "foo"
+#define VAL1 "X"
+#define VAL2 "YZ"
+#define FLAG 123
+#define EXPIRY 86400
+
+    int ret;
+    struct bstring key = str2bstr(KEY);
+    struct bstring val = str2bstr(VAL2);
+
+    test_reset();
+
+    /* the value is allowed to arrive over multiple reads */
+    buf_write(buf, HEADER EXTRAS KEY VAL1, sizeof(HEADER EXTRAS KEY VAL1) - 1);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_OK);
+    ck_assert(req->rstate == REQ_PARTIAL);
+    ck_assert(req->binary);
+    ck_assert(req->type == REQ_SET);
+    ck_assert_int_eq(req->opcode, BIN_OP_SETQ);
+    ck_assert_int_eq(req->opaque, 7);
+    ck_assert_int_eq(bstring_compare(&key, array_first(req->keys)), 0);
+    ck_assert_int_eq(req->flag, FLAG);
+    ck_assert_int_eq(req->expiry, EXPIRY);
+    ck_assert_int_eq(req->vlen, 3);
+    ck_assert_int_eq(req->nremain, 2);
+
+    buf_write(buf, VAL2, sizeof(VAL2) - 1);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_OK);
+    ck_assert(req->rstate == REQ_PARSED);
+    ck_assert_int_eq(bstring_compare(&val, &req->vstr), 0);
+    ck_assert(buf->rpos == buf->wpos);
+
+    /* a stored quiet request is not responded to */
+    rsp->type = RSP_STORED;
+    buf_reset(buf);
+    ret = compose_bin_rsp(&buf, req, rsp);
+    ck_assert_int_eq(ret, 0);
+    ck_assert_int_eq(buf_rsize(buf), 0);
+#undef EXPIRY
+#undef FLAG
+#undef VAL2
+#undef VAL1
+#undef KEY
+#undef EXTRAS
+#undef HEADER
+}
+END_TEST
+
+START_TEST(test_binary_get)
+{
+/* GETK, key "foo", opaque 7 */
+#define SERIALIZED "\x80\x0c\x00\x03\x00\x00\x00\x00\x00\x00\x00\x03\x00\x00\x00\x07" \
+    "\x00\x00\x00\x00\x00\x00\x00\x00" "foo"
+#define RESPONSE "\x81\x0c\x00\x03\x04\x00\x00\x00\x00\x00\x00\x0a\x00\x00\x00\x07" \
+    "\x00\x00\x00\x00\x00\x00\x00\x09" "\x00\x00\x00\x7b" "foo" "XYZ"
+#define MISS "\x81\x0c\x00\x03\x00\x00\x00\x01\x00\x00\x00\x03\x00\x00\x00\x07" \
+    "\x00\x00\x00\x00\x00\x00\x00\x00" "foo"
+#define KEY "foo"
+#define VAL "XYZ"
+
+    int ret;
+    int len = sizeof(RESPONSE) - 1;
+    struct bstring key = str2bstr(KEY);
+
+    test_reset();
+
+    buf_write(buf, SERIALIZED, sizeof(SERIALIZED) - 1);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_OK);
+    ck_assert(req->rstate == REQ_PARSED);
+    ck_assert(req->type == REQ_GETS);
+    ck_assert_int_eq(array_nelem(req->keys), 1);
+    ck_assert_int_eq(bstring_compare(&key, array_first(req->keys)), 0);
+    ck_assert(buf->rpos == buf->wpos);
+    /* the parsed key refers to buf, which is reused for the response */
+    *(struct bstring *)array_first(req->keys) = key;
+
+    /* a hit returns the flag as extras, followed by the key and value */
+    rsp->type = RSP_VALUE;
+    rsp->key = key;
+    rsp->flag = 123;
+    rsp->vcas = 9;
+    rsp->vstr = str2bstr(VAL);
+    buf_reset(buf);
+    ret = compose_bin_rsp(&buf, req, rsp);
+    ck_assert_msg(ret == len, "expected: %d, returned: %d", len, ret);
+    ck_assert_int_eq(cc_bcmp(buf->rpos, RESPONSE, ret), 0);
+
+    /* a miss returns only the key */
+    len = sizeof(MISS) - 1;
+    response_reset(rsp);
+    rsp->type = RSP_END;
+    buf_reset(buf);
+    ret = compose_bin_rsp(&buf, req, rsp);
+    ck_assert_msg(ret == len, "expected: %d, returned: %d", len, ret);
+    ck_assert_int_eq(cc_bcmp(buf->rpos, MISS, ret), 0);
+#undef VAL
+#undef KEY
+#undef MISS
+#undef RESPONSE
+#undef SERIALIZED
+}
+END_TEST
+
+START_TEST(test_binary_unknown)
+{
+#define SERIALIZED "\x80\x20\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00" \
+    "\x00\x00\x00\x00\x00\x00\x00\x00"
+#define MESSAGE "Unknown command"
+
+    int ret;
+    int len = 24 + sizeof(MESSAGE) - 1;
+
+    test_reset();
+
+    /* an incomplete header is left in the buffer */
+    buf_write(buf, SERIALIZED, 10);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_EUNFIN);
+    ck_assert(buf->rpos == buf->begin);
+
+    buf_write(buf, SERIALIZED + 10, sizeof(SERIALIZED) - 11);
+    ret = parse_req(req, buf);
+    ck_assert_int_eq(ret, PARSE_OK);
+    ck_assert(req->type == REQ_UNKNOWN);
+
+    rsp->type = RSP_CLIENT_ERROR;
+    buf_reset(buf);
+    ret = compose_bin_rsp(&buf, req, rsp);
+    ck_assert_msg(ret == len, "expected: %d, returned: %d", len, ret);
+    ck_assert_int_eq(buf->rpos[1], 0x20);
+    ck_assert_int_eq(buf->rpos[7], (char)BIN_STATUS_UNKNOWN_CMD);
+    ck_assert_int_eq(cc_bcmp(buf->rpos + 24, MESSAGE, ret - 24), 0);
+#undef MESSAGE
+#undef SERIALIZED
+}
+END_TEST
+
 /*
  * test suite
  */
@@ -1308,6 +1657,8 @@ memcache_suite(void)
     tcase_add_test(tc_basic_req, test_get);
     tcase_add_test(tc_basic_req, test_multikey);
     tcase_add_test(tc_basic_req, test_gets);
+    tcase_add_test(tc_basic_req, test_get_pipelined);
+    tcase_add_test(tc_basic_req, test_get_limits);
     tcase_add_test(tc_basic_req, test_set);
     tcase_add_test(tc_basic_req, test_add_noreply);
     tcase_add_test(tc_basic_req, test_replace_noreply);
@@ -1332,6 +1683,8 @@ memcache_suite(void)
     tcase_add_test(tc_basic_rsp, test_notstored);
     tcase_add_test(tc_basic_rsp, test_stat);
     tcase_add_test(tc_basic_rsp, test_value);
+    tcase_add_test(tc_basic_rsp, test_value_chained);
+    tcase_add_test(tc_basic_rsp, test_value_ref);
     tcase_add_test(tc_basic_rsp, test_numeric);
     tcase_add_test(tc_basic_rsp, test_servererror);
     tcase_add_test(tc_basic_rsp, test_clienterror);
@@ -1344,6 +1697,13 @@ memcache_suite(void)
     tcase_add_test(tc_basic_rsp, test_rsp_incomplete_flag);
     tcase_add_test(tc_basic_rsp, test_rsp_incomplete_cas);
 
+    TCase *tc_binary = tcase_create("binary protocol");
+    suite_add_tcase(s, tc_binary);
+
+    tcase_add_test(tc_binary, test_binary_set);
+    tcase_add_test(tc_binary, test_binary_get);
+    tcase_add_test(tc_binary, test_binary_unknown);
+
     TCase *tc_rsp_pool = tcase_create("response pool");
     suite_add_tcase(s, tc_rsp_pool);
 
@@ -123,6 +123,9 @@ START_TEST(test_integer)
 #define OVERSIZE ":19223372036854775807\r\n"
 #define INVALID1 ":123lOl456\r\n"
 #define INVALID2 ":\r\n"
+#define INVALID3 ":-\r\n"
+#define LOWEST ":-9223372036854775808\r\n"
+#define UNDERSIZE ":-9223372036854775809\r\n"
 
     struct element el_c, el_p;
     int ret;
@@ -130,15 +133,16 @@ START_TEST(test_integer)
     struct int_pair {
         char *serialized;
         uint64_t num;
-    } pairs[3] = {
+    } pairs[4] = {
         {":-1\r\n", -1},
         {":9223372036854775807\r\n", 9223372036854775807},
-        {":128\r\n", 128}
+        {":128\r\n", 128},
+        {":0\r\n", 0}
     };
 
 
     test_reset();
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < 4; i++) {
         size_t len = strlen(pairs[i].serialized);
 
         buf_reset(buf);
@@ -156,6 +160,12 @@ START_TEST(test_integer)
         ck_assert(el_p.num == pairs[i].num);
     }
 
+    buf_reset(buf);
+    buf_write(buf, LOWEST, sizeof(LOWEST) - 1);
+    ret = parse_element(&el_p, buf);
+    ck_assert_int_eq(ret, PARSE_OK);
+    ck_assert(el_p.num == INT64_MIN);
+
     buf_reset(buf);
     buf_write(buf, OVERSIZE, sizeof(OVERSIZE) - 1);
     ret = parse_element(&el_p, buf);
@@ -171,6 +181,19 @@ START_TEST(test_integer)
     ret = parse_element(&el_p, buf);
     ck_assert_int_eq(ret, PARSE_EINVALID);
 
+    buf_reset(buf);
+    buf_write(buf, INVALID3, sizeof(INVALID3) - 1);
+    ret = parse_element(&el_p, buf);
+    ck_assert_int_eq(ret, PARSE_EINVALID);
+
+    buf_reset(buf);
+    buf_write(buf, UNDERSIZE, sizeof(UNDERSIZE) - 1);
+    ret = parse_element(&el_p, buf);
+    ck_assert_int_eq(ret, PARSE_EINVALID);
+
+#undef UNDERSIZE
+#undef LOWEST
+#undef INVALID3
 #undef INVALID2
 #undef INVALID1
 #undef OVERSIZE
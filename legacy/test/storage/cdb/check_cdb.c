@@ -0,0 +1,273 @@
+#include <storage/cdb/cdb_mmap.h>
+
+#include <cc_bstring.h>
+#include <cc_debug.h>
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* define for each suite, local scope due to macro visibility rule */
+#define SUITE_NAME "cdb"
+#define DEBUG_LOG SUITE_NAME ".log"
+#define DB_PATH SUITE_NAME ".cdb"
+
+#define NKEY 1000
+
+/*
+ * utilities
+ */
+static uint32_t
+_hash(const char *key, uint32_t len)
+{
+    uint32_t h = 5381;
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        h = ((h << 5) + h) ^ (uint8_t)key[i];
+    }
+
+    return h;
+}
+
+static void
+_pack(FILE *fp, uint32_t v)
+{
+    uint8_t b[4] = {v, v >> 8, v >> 16, v >> 24};
+
+    fwrite(b, 1, sizeof(b), fp);
+}
+
+static int
+_key(char *buf, uint32_t i)
+{
+    return sprintf(buf, "key%"PRIu32, i);
+}
+
+static int
+_val(char *buf, uint32_t i)
+{
+    return sprintf(buf, "val%"PRIu32, i * 7);
+}
+
+/* writes NKEY keys to a cdb file, in the same way as djb's cdbmake */
+static void
+test_write_db(void)
+{
+    static uint32_t hash[NKEY], pos[NKEY];
+    uint32_t tpos[256], tlen[256];
+    char zero[2048] = {0};
+    char key[32], val[32];
+    uint32_t off = sizeof(zero);
+    uint32_t i, t, s;
+    FILE *fp = fopen(DB_PATH, "wb");
+
+    ck_assert_ptr_ne(fp, NULL);
+    fwrite(zero, 1, sizeof(zero), fp);
+
+    for (i = 0; i < NKEY; i++) {
+        int klen = _key(key, i);
+        int vlen = _val(val, i);
+
+        hash[i] = _hash(key, klen);
+        pos[i] = off;
+        _pack(fp, klen);
+        _pack(fp, vlen);
+        fwrite(key, 1, klen, fp);
+        fwrite(val, 1, vlen, fp);
+        off += 8 + klen + vlen;
+    }
+
+    for (t = 0; t < 256; t++) {
+        uint32_t len = 0;
+
+        for (i = 0; i < NKEY; i++) {
+            len += (hash[i] % 256 == t) ? 2 : 0;
+        }
+
+        uint32_t *slot = calloc(len * 2 + 1, sizeof(uint32_t));
+        for (i = 0; i < NKEY; i++) {
+            if (hash[i] % 256 != t) {
+                continue;
+            }
+            for (s = (hash[i] >> 8) % len; slot[s * 2 + 1] != 0; s = (s + 1) % len);
+            slot[s * 2] = hash[i];
+            slot[s * 2 + 1] = pos[i];
+        }
+        for (s = 0; s < len * 2; s++) {
+            _pack(fp, slot[s]);
+        }
+        free(slot);
+
+        tpos[t] = off;
+        tlen[t] = len;
+        off += len * 8;
+    }
+
+    fseek(fp, 0, SEEK_SET);
+    for (t = 0; t < 256; t++) {
+        _pack(fp, tpos[t]);
+        _pack(fp, tlen[t]);
+    }
+    fclose(fp);
+}
+
+static void
+test_get(bool index_copy)
+{
+    struct cdb_mmap *db;
+    struct bstring key, val;
+    char kbuf[32], vbuf[32];
+    uint32_t i;
+
+    test_write_db();
+    db = cdb_mmap_open(DB_PATH, index_copy);
+    ck_assert_ptr_ne(db, NULL);
+
+    for (i = 0; i < NKEY; i++) {
+        key.data = kbuf;
+        key.len = _key(kbuf, i);
+        ck_assert(cdb_mmap_get(db, &key, &val));
+        ck_assert_int_eq(val.len, _val(vbuf, i));
+        ck_assert_int_eq(cc_memcmp(val.data, vbuf, val.len), 0);
+    }
+
+    key = str2bstr("absent");
+    ck_assert(!cdb_mmap_get(db, &key, &val));
+
+    cdb_mmap_close(&db);
+    ck_assert_ptr_eq(db, NULL);
+}
+
+/*
+ * tests
+ */
+START_TEST(test_get_basic)
+{
+    test_get(false);
+}
+END_TEST
+
+START_TEST(test_get_index_copy)
+{
+    test_get(true);
+}
+END_TEST
+
+START_TEST(test_get_batch)
+{
+#define NBATCH (CDB_MMAP_BATCH * 2 + 5)
+    struct cdb_mmap *db;
+    struct bstring keys[NBATCH], vals[NBATCH];
+    struct bstring *kp[NBATCH];
+    char kbuf[NBATCH][32], vbuf[32];
+    uint32_t i;
+
+    test_write_db();
+    db = cdb_mmap_open(DB_PATH, false);
+    ck_assert_ptr_ne(db, NULL);
+
+    /* every fifth key is missing */
+    for (i = 0; i < NBATCH; i++) {
+        keys[i].data = kbuf[i];
+        keys[i].len = (i % 5 == 0) ? sprintf(kbuf[i], "absent%"PRIu32, i) :
+            _key(kbuf[i], i * 10);
+        kp[i] = &keys[i];
+    }
+
+    cdb_mmap_get_batch(db, kp, NBATCH, vals);
+
+    for (i = 0; i < NBATCH; i++) {
+        if (i % 5 == 0) {
+            ck_assert_ptr_eq(vals[i].data, NULL);
+            continue;
+        }
+        ck_assert_int_eq(vals[i].len, _val(vbuf, i * 10));
+        ck_assert_int_eq(cc_memcmp(vals[i].data, vbuf, vals[i].len), 0);
+    }
+
+    cdb_mmap_close(&db);
+#undef NBATCH
+}
+END_TEST
+
+START_TEST(test_reopen)
+{
+    struct cdb_mmap *db, *next;
+    struct bstring key, val;
+    char kbuf[32];
+
+    test_write_db();
+    db = cdb_mmap_open(DB_PATH, true);
+    ck_assert_ptr_ne(db, NULL);
+
+    next = cdb_mmap_reopen(db, NULL);
+    ck_assert_ptr_ne(next, NULL);
+    cdb_mmap_warm(next);
+    cdb_mmap_close(&db);
+
+    key.data = kbuf;
+    key.len = _key(kbuf, NKEY - 1);
+    ck_assert(cdb_mmap_get(next, &key, &val));
+
+    ck_assert_ptr_eq(cdb_mmap_reopen(next, SUITE_NAME ".absent"), NULL);
+
+    cdb_mmap_close(&next);
+}
+END_TEST
+
+START_TEST(test_open_invalid)
+{
+    FILE *fp = fopen(DB_PATH, "wb");
+
+    ck_assert_ptr_ne(fp, NULL);
+    fputs("not a cdb file", fp);
+    fclose(fp);
+
+    ck_assert_ptr_eq(cdb_mmap_open(DB_PATH, false), NULL);
+    ck_assert_ptr_eq(cdb_mmap_open(SUITE_NAME ".absent", false), NULL);
+}
+END_TEST
+
+/*
+ * test suite
+ */
+static Suite *
+cdb_suite(void)
+{
+    Suite *s = suite_create(SUITE_NAME);
+
+    TCase *tc_cdb = tcase_create("cdb_mmap api");
+    suite_add_tcase(s, tc_cdb);
+    tcase_add_test(tc_cdb, test_get_basic);
+    tcase_add_test(tc_cdb, test_get_index_copy);
+    tcase_add_test(tc_cdb, test_get_batch);
+    tcase_add_test(tc_cdb, test_reopen);
+    tcase_add_test(tc_cdb, test_open_invalid);
+
+    return s;
+}
+
+int
+main(void)
+{
+    int nfail;
+
+    /* turn on during debug */
+    debug_options_st debug_opts = {DEBUG_OPTION(OPTION_INIT)};
+    option_load_default(
+            (struct option *)&debug_opts, OPTION_CARDINALITY(debug_options_st));
+    debug_setup(&debug_opts);
+
+    Suite *suite = cdb_suite();
+    SRunner *srunner = srunner_create(suite);
+    srunner_set_log(srunner, DEBUG_LOG);
+    srunner_run_all(srunner, CK_ENV); /* set CK_VEBOSITY in ENV to customize */
+    nfail = srunner_ntests_failed(srunner);
+    srunner_free(srunner);
+
+    remove(DB_PATH);
+
+    return (nfail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
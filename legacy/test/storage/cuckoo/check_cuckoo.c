@@ -7,6 +7,7 @@
 #include <cc_mm.h>
 
 #include <check.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -442,6 +443,195 @@ START_TEST(test_insert_insert_expire_swap)
 #undef TIME
 }
 END_TEST
+START_TEST(test_insert_load_factor)
+{
+    struct bstring key;
+    struct val val;
+    char keystring[30];
+    uint64_t i;
+
+    metrics = (cuckoo_metrics_st) { CUCKOO_METRIC(METRIC_INIT) };
+    test_reset(CUCKOO_POLICY_RANDOM, true, CUCKOO_MAX_TTL);
+
+    time_update();
+    for (i = 0; metrics.item_evict.counter == 0; i++) {
+        key.len = sprintf(keystring, "%"PRIu64, i);
+        key.data = keystring;
+
+        val.type = VAL_TYPE_INT;
+        val.vint = i;
+
+        ck_assert_msg(cuckoo_insert(&key, &val, INT32_MAX) != NULL,
+                "cuckoo_insert not OK");
+    }
+
+    /* displacement fills most of the table before anything is evicted */
+    ck_assert_msg(i > (double)CUCKOO_NITEM * 9 / 10,
+            "first eviction after %"PRIu64" inserts", i);
+    ck_assert_int_eq(metrics.item_curr.gauge, i - 1);
+}
+END_TEST
+
+START_TEST(test_tiers)
+{
+#define KEY "key"
+#define SMALL "small"
+#define LARGE "a value which only fits into the tier of larger items"
+#define HUGE_LEN 200 /* too large for any of the tiers */
+    char huge[HUGE_LEN];
+    struct bstring key, testval;
+    struct val val;
+    struct item *it;
+
+    metrics = (cuckoo_metrics_st) { CUCKOO_METRIC(METRIC_INIT) };
+    test_teardown();
+    option_load_default((struct option *)&options, OPTION_CARDINALITY(options));
+    options.cuckoo_tiers.val.vstr = "64:64 128:64";
+    cuckoo_setup(&options, &metrics);
+
+    time_update();
+    key = str2bstr(KEY);
+    val.type = VAL_TYPE_STR;
+    val.vstr = str2bstr(SMALL);
+    it = cuckoo_insert(&key, &val, INT32_MAX);
+    ck_assert_msg(it != NULL, "cuckoo_insert not OK");
+
+    /* the value grows out of the tier, and the item moves to the next one */
+    val.vstr = str2bstr(LARGE);
+    ck_assert_int_eq(cuckoo_update(it, &val, INT32_MAX), CC_OK);
+    it = cuckoo_get(&key);
+    ck_assert_msg(it != NULL, "cuckoo_get returned NULL");
+    item_value_str(&testval, it);
+    ck_assert_int_eq(testval.len, sizeof(LARGE) - 1);
+    ck_assert_int_eq(cc_memcmp(testval.data, LARGE, testval.len), 0);
+    ck_assert_int_eq(metrics.item_curr.gauge, 1);
+
+    cc_memset(huge, 'x', HUGE_LEN);
+    val.vstr.len = HUGE_LEN;
+    val.vstr.data = huge;
+    ck_assert_int_eq(cuckoo_update(it, &val, INT32_MAX), CC_ERROR);
+    key = str2bstr("other");
+    ck_assert_msg(cuckoo_insert(&key, &val, INT32_MAX) == NULL,
+            "cuckoo_insert should fail");
+
+    key = str2bstr(KEY);
+    ck_assert_msg(cuckoo_delete(&key), "cuckoo_delete failed");
+    ck_assert_msg(cuckoo_get(&key) == NULL, "item found after delete");
+    ck_assert_int_eq(metrics.item_curr.gauge, 0);
+
+    options.cuckoo_tiers.val.vstr = NULL;
+    test_reset(CUCKOO_POLICY_RANDOM, true, CUCKOO_MAX_TTL);
+#undef KEY
+#undef SMALL
+#undef LARGE
+#undef HUGE_LEN
+}
+END_TEST
+
+#define CONCURRENT_NTHREAD 4
+#define CONCURRENT_NINCR 10000
+#define CONCURRENT_NKEY 200 /* keys inserted by each thread */
+
+static void *
+_concurrent_worker(void *arg)
+{
+    uintptr_t idx = (uintptr_t)arg;
+    char keystring[30], buf[CUCKOO_ITEM_SIZE];
+    struct bstring key;
+    struct val val;
+    struct item *it;
+    uint64_t last = 0;
+    uint32_t i;
+
+    /* distinct keys of this thread, which displace items of the others */
+    val.type = VAL_TYPE_INT;
+    for (i = 0; i < CONCURRENT_NKEY; ++i) {
+        key.len = sprintf(keystring, "%"PRIuPTR"-%"PRIu32, idx, i);
+        key.data = keystring;
+        val.vint = i;
+        cuckoo_lock(&key);
+        ck_assert_msg(cuckoo_insert(&key, &val, INT32_MAX) != NULL,
+                "cuckoo_insert not OK");
+        cuckoo_unlock();
+    }
+
+    /* one counter incremented by all threads, and read without the lock */
+    key = str2bstr("counter");
+    for (i = 0; i < CONCURRENT_NINCR; ++i) {
+        cuckoo_lock(&key);
+        it = cuckoo_get(&key);
+        ck_assert_msg(it != NULL, "cuckoo_get returned NULL");
+        val.vint = item_value_int(it) + 1;
+        item_value_update(it, &val);
+        cuckoo_unlock();
+
+        it = cuckoo_read(&key, buf);
+        ck_assert_msg(it == (struct item *)buf, "cuckoo_read did not copy");
+        ck_assert_msg(item_value_int(it) >= last, "counter went backwards");
+        last = item_value_int(it);
+    }
+
+    return NULL;
+}
+
+/**
+ * Tests that threads sharing the table see the updates of each other to a key
+ * they lock, and don't lose keys while they insert concurrently.
+ */
+START_TEST(test_concurrent)
+{
+    pthread_t thread[CONCURRENT_NTHREAD];
+    char keystring[30], buf[CUCKOO_ITEM_SIZE];
+    struct bstring key;
+    struct val val;
+    struct item *it;
+    uintptr_t i, j;
+
+    metrics = (cuckoo_metrics_st) { CUCKOO_METRIC(METRIC_INIT) };
+    test_teardown();
+    option_load_default((struct option *)&options, OPTION_CARDINALITY(options));
+    options.cuckoo_concurrent.val.vbool = true;
+    cuckoo_setup(&options, &metrics);
+    ck_assert_int_eq(cuckoo_read_size(), CUCKOO_ITEM_SIZE);
+
+    time_update();
+    key = str2bstr("counter");
+    val.type = VAL_TYPE_INT;
+    val.vint = 0;
+    ck_assert_msg(cuckoo_insert(&key, &val, INT32_MAX) != NULL,
+            "cuckoo_insert not OK");
+
+    for (i = 0; i < CONCURRENT_NTHREAD; ++i) {
+        ck_assert_int_eq(pthread_create(&thread[i], NULL, _concurrent_worker,
+                    (void *)i), 0);
+    }
+    for (i = 0; i < CONCURRENT_NTHREAD; ++i) {
+        pthread_join(thread[i], NULL);
+    }
+
+    it = cuckoo_read(&key, buf);
+    ck_assert_msg(it != NULL, "cuckoo_read returned NULL");
+    ck_assert_int_eq(item_value_int(it), CONCURRENT_NTHREAD * CONCURRENT_NINCR);
+
+    /* the table is far from full, so no key has been evicted */
+    ck_assert_int_eq(metrics.item_evict.counter, 0);
+    for (i = 0; i < CONCURRENT_NTHREAD; ++i) {
+        for (j = 0; j < CONCURRENT_NKEY; ++j) {
+            key.len = sprintf(keystring, "%"PRIuPTR"-%"PRIuPTR, i, j);
+            key.data = keystring;
+            it = cuckoo_read(&key, buf);
+            ck_assert_msg(it != NULL, "key %.*s was lost", key.len, key.data);
+            ck_assert_int_eq(item_value_int(it), j);
+        }
+    }
+
+    test_reset(CUCKOO_POLICY_RANDOM, true, CUCKOO_MAX_TTL);
+}
+END_TEST
+#undef CONCURRENT_NTHREAD
+#undef CONCURRENT_NINCR
+#undef CONCURRENT_NKEY
+
 /*
  * test suite
  */
@@ -472,6 +662,9 @@ cuckoo_suite(void)
     tcase_add_test(tc_basic_req, test_expire_truncated_random_false);
     tcase_add_test(tc_basic_req, test_insert_replace_expired);
     tcase_add_test(tc_basic_req, test_insert_insert_expire_swap);
+    tcase_add_test(tc_basic_req, test_insert_load_factor);
+    tcase_add_test(tc_basic_req, test_tiers);
+    tcase_add_test(tc_basic_req, test_concurrent);
 
     return s;
 }
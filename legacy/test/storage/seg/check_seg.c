@@ -790,6 +790,36 @@ START_TEST(test_seg_basic)
 }
 END_TEST
 
+START_TEST(test_seg_numa)
+{
+#define N_NODE "2"
+    int32_t seg_id;
+    uint32_t node;
+
+    proc_sec = 0;
+    option_load_default((struct option *)&options, OPTION_CARDINALITY(options));
+    option_set(&options.seg_numa_node, N_NODE);
+    seg_setup(&options, &metrics);
+
+    ck_assert_int_eq(heap.n_numa_node, 2);
+    ck_assert_int_eq(heap.n_node_seg, heap.max_nseg / 2);
+
+    /* the segs of the thread's node are used up before those of the other */
+    seg_id = seg_get_new();
+    node = seg_id / heap.n_node_seg;
+    for (int32_t i = 1; i < heap.n_node_seg; i++) {
+        seg_id = seg_get_new();
+        ck_assert_int_eq(seg_id / heap.n_node_seg, node);
+    }
+    seg_id = seg_get_new();
+    ck_assert_int_ne(seg_id, -1);
+    ck_assert_int_ne(seg_id / heap.n_node_seg, node);
+
+    test_teardown();
+#undef N_NODE
+}
+END_TEST
+
 START_TEST(test_seg_more)
 {
 #define KEY "test_seg_more"
@@ -1312,6 +1342,7 @@ seg_suite(void)
     TCase *tc_seg = tcase_create("seg api");
     suite_add_tcase(s, tc_seg);
     tcase_add_test(tc_seg, test_seg_basic);
+    tcase_add_test(tc_seg, test_seg_numa);
     tcase_add_test(tc_seg, test_seg_more);
     tcase_add_test(tc_seg, test_segevict_FIFO);
     tcase_add_test(tc_seg, test_segevict_CTE);
@@ -7,6 +7,8 @@
 #include <cc_mm.h>
 
 #include <check.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -648,6 +650,164 @@ START_TEST(test_evict_lru_basic)
 }
 END_TEST
 
+START_TEST(test_evict_clock_basic)
+{
+#define MY_SLAB_SIZE 160
+#define MY_SLAB_MAXBYTES 160
+    /**
+     * With the same parameters as test_evict_lru_basic, class 1 holds two
+     * items in the only slab. The first item is accessed after both are
+     * stored, so storing a third one evicts the second, rather than the slab.
+     **/
+#define KEY_LENGTH 2
+#define VALUE_LENGTH 8
+#define NUM_ITEMS 2
+
+    size_t i;
+    struct bstring key[NUM_ITEMS + 1] = {
+        {KEY_LENGTH, "aa"},
+        {KEY_LENGTH, "bb"},
+        {KEY_LENGTH, "cc"},
+    };
+    struct bstring val[NUM_ITEMS + 1] = {
+        {VALUE_LENGTH, "aaaaaaaa"},
+        {VALUE_LENGTH, "bbbbbbbb"},
+        {VALUE_LENGTH, "cccccccc"},
+    };
+    item_rstatus_e status;
+    struct item *it;
+    uint64_t nitem_evict = metrics.item_evict.counter;
+    uint64_t nslab_evict = metrics.slab_evict.counter;
+
+    option_load_default((struct option *)&options, OPTION_CARDINALITY(options));
+    options.slab_size.val.vuint = MY_SLAB_SIZE;
+    options.slab_mem.val.vuint = MY_SLAB_MAXBYTES;
+    options.slab_evict_opt.val.vuint = EVICT_CLOCK;
+    options.slab_item_max.val.vuint = MY_SLAB_SIZE - SLAB_HDR_SIZE;
+
+    test_teardown();
+    slab_setup(&options, &metrics);
+
+    for (i = 0; i < NUM_ITEMS; i++) {
+        time_update();
+        status = item_reserve(&it, &key[i], &val[i], val[i].len, 0, INT32_MAX);
+        ck_assert_msg(status == ITEM_OK, "item_reserve not OK - return status %d", status);
+        item_insert(it, &key[i]);
+    }
+
+    ck_assert_msg(item_get(&key[0]) != NULL, "item 0 not found");
+
+    status = item_reserve(&it, &key[2], &val[2], val[2].len, 0, INT32_MAX);
+    ck_assert_msg(status == ITEM_OK, "item_reserve not OK - return status %d", status);
+    item_insert(it, &key[2]);
+
+    ck_assert_int_eq(metrics.item_evict.counter, nitem_evict + 1);
+    ck_assert_int_eq(metrics.slab_evict.counter, nslab_evict);
+    ck_assert_msg(item_get(&key[0]) != NULL,
+        "item 0 not found, expected to get a second chance");
+    ck_assert_msg(item_get(&key[1]) == NULL,
+        "item 1 found, expected to be evicted");
+    ck_assert_msg(item_get(&key[2]) != NULL,
+        "item 2 not found");
+
+#undef KEY_LENGTH
+#undef VALUE_LENGTH
+#undef NUM_ITEMS
+#undef MY_SLAB_SIZE
+#undef MY_SLAB_MAXBYTES
+}
+END_TEST
+
+START_TEST(test_automove_basic)
+{
+#define MY_SLAB_SIZE 160
+#define MY_SLAB_MAXBYTES 480
+#define TIME 12345678
+    /**
+     * Slabs hold either two small items or one large item. The small items
+     * fill two of the three slabs, and a large item, which is stored later,
+     * takes the last. Another large item cannot be stored without eviction,
+     * so the next automove moves the oldest slab of the small items, which
+     * are older, to the class of the large items.
+     **/
+#define KEY_LENGTH 2
+#define VALUE_LENGTH 8
+#define LARGE_VALUE_LENGTH 40
+#define NUM_ITEMS 4
+
+    size_t i;
+    struct bstring key[NUM_ITEMS] = {
+        {KEY_LENGTH, "aa"},
+        {KEY_LENGTH, "bb"},
+        {KEY_LENGTH, "cc"},
+        {KEY_LENGTH, "dd"},
+    };
+    struct bstring val = {VALUE_LENGTH, "aaaaaaaa"};
+    struct bstring large_key[2] = {
+        {KEY_LENGTH, "xx"},
+        {KEY_LENGTH, "yy"},
+    };
+    struct bstring large_val = {LARGE_VALUE_LENGTH,
+        "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"};
+    uint64_t nmove = metrics.slab_move.counter;
+    item_rstatus_e status;
+    struct item *it;
+
+    option_load_default((struct option *)&options, OPTION_CARDINALITY(options));
+    options.slab_size.val.vuint = MY_SLAB_SIZE;
+    options.slab_mem.val.vuint = MY_SLAB_MAXBYTES;
+    options.slab_evict_opt.val.vuint = EVICT_NONE;
+    options.slab_item_max.val.vuint = MY_SLAB_SIZE - SLAB_HDR_SIZE;
+    options.slab_automove.val.vbool = true;
+
+    test_teardown();
+    proc_sec = TIME;
+    slab_setup(&options, &metrics);
+
+    for (i = 0; i < NUM_ITEMS; i++) {
+        status = item_reserve(&it, &key[i], &val, val.len, 0, INT32_MAX);
+        ck_assert_msg(status == ITEM_OK, "item_reserve not OK - return status %d", status);
+        item_insert(it, &key[i]);
+    }
+
+    proc_sec += 10;
+    status = item_reserve(&it, &large_key[0], &large_val, large_val.len, 0,
+            INT32_MAX);
+    ck_assert_msg(status == ITEM_OK, "item_reserve not OK - return status %d", status);
+    item_insert(it, &large_key[0]);
+
+    /* the heap is full, and nothing is evicted without automove */
+    status = item_reserve(&it, &large_key[1], &large_val, large_val.len, 0,
+            INT32_MAX);
+    ck_assert_msg(status == ITEM_ENOMEM, "item_reserve should fail - return status %d", status);
+    ck_assert_int_eq(metrics.slab_move.counter, nmove);
+
+    proc_sec += 2;
+    status = item_reserve(&it, &large_key[1], &large_val, large_val.len, 0,
+            INT32_MAX);
+    ck_assert_msg(status == ITEM_OK, "item_reserve not OK - return status %d", status);
+    item_insert(it, &large_key[1]);
+    ck_assert_int_eq(metrics.slab_move.counter, nmove + 1);
+
+    ck_assert_msg(item_get(&key[0]) == NULL,
+        "item 0 found, expected to be moved out");
+    ck_assert_msg(item_get(&key[1]) == NULL,
+        "item 1 found, expected to be moved out");
+    ck_assert_msg(item_get(&key[2]) != NULL, "item 2 not found");
+    ck_assert_msg(item_get(&key[3]) != NULL, "item 3 not found");
+    ck_assert_msg(item_get(&large_key[0]) != NULL, "large item 0 not found");
+    ck_assert_msg(item_get(&large_key[1]) != NULL, "large item 1 not found");
+
+#undef KEY_LENGTH
+#undef VALUE_LENGTH
+#undef LARGE_VALUE_LENGTH
+#undef NUM_ITEMS
+#undef TIME
+#undef MY_SLAB_SIZE
+#undef MY_SLAB_MAXBYTES
+}
+END_TEST
+
 START_TEST(test_refcount)
 {
 #define KEY "key"
@@ -725,6 +885,231 @@ START_TEST(test_evict_refcount)
 }
 END_TEST
 
+START_TEST(test_hash_expand)
+{
+#define MY_HASH_POWER 2
+#define NUM_ITEMS 1000
+#define KEY_LEN 8
+#define VAL "val"
+    struct bstring key, val;
+    char keystr[KEY_LEN + 1];
+    item_rstatus_e status;
+    struct item *it;
+    uint32_t i;
+
+    option_load_default((struct option *)&options, OPTION_CARDINALITY(options));
+    options.slab_hash_power.val.vuint = MY_HASH_POWER;
+
+    test_teardown();
+    slab_setup(&options, &metrics);
+
+    val = str2bstr(VAL);
+    key.data = keystr;
+    key.len = KEY_LEN;
+
+    /* every item is found while the table is being expanded */
+    for (i = 0; i < NUM_ITEMS; i++) {
+        snprintf(keystr, sizeof(keystr), "%08"PRIu32, i);
+        status = item_reserve(&it, &key, &val, val.len, 0, INT32_MAX);
+        ck_assert_msg(status == ITEM_OK, "item_reserve not OK - return status %d", status);
+        item_insert(it, &key);
+        snprintf(keystr, sizeof(keystr), "%08"PRIu32, i / 2);
+        ck_assert_msg(item_get(&key) != NULL, "item %"PRIu32" not found", i / 2);
+    }
+    ck_assert_int_gt(hash_table->hash_power, MY_HASH_POWER);
+    ck_assert_uint_eq(hash_table->nhash_item, NUM_ITEMS);
+
+    for (i = 0; i < NUM_ITEMS; i += 2) {
+        snprintf(keystr, sizeof(keystr), "%08"PRIu32, i);
+        ck_assert_msg(item_delete(&key), "item %"PRIu32" not deleted", i);
+    }
+
+    hashtable_migrate_all(hash_table);
+    ck_assert_ptr_eq(hash_table->old_table, NULL);
+    for (i = 0; i < NUM_ITEMS; i++) {
+        snprintf(keystr, sizeof(keystr), "%08"PRIu32, i);
+        it = item_get(&key);
+        if (i % 2 == 0) {
+            ck_assert_msg(it == NULL, "item %"PRIu32" found after delete", i);
+        } else {
+            ck_assert_msg(it != NULL, "item %"PRIu32" not found", i);
+        }
+    }
+#undef MY_HASH_POWER
+#undef NUM_ITEMS
+#undef KEY_LEN
+#undef VAL
+}
+END_TEST
+
+/**
+ * Tests that a heap backed with huge pages and prefaulted by several threads,
+ * with a share left over for the last of them, holds every slab.
+ */
+START_TEST(test_prefault)
+{
+#define MY_SLAB_SIZE MiB
+#define MY_SLAB_MAXBYTES (9 * MiB)
+#define KEY_LEN 8
+    char keystr[KEY_LEN + 1];
+    struct bstring key, val;
+    item_rstatus_e status;
+    struct item *it;
+    uint32_t i, nitem = MY_SLAB_MAXBYTES / MY_SLAB_SIZE;
+
+    option_load_default((struct option *)&options, OPTION_CARDINALITY(options));
+    options.slab_size.val.vuint = MY_SLAB_SIZE;
+    options.slab_mem.val.vuint = MY_SLAB_MAXBYTES;
+    options.slab_item_max.val.vuint = MY_SLAB_SIZE - SLAB_HDR_SIZE;
+    options.slab_datapool_prefault.val.vbool = true;
+    options.slab_prefault_nthread.val.vuint = 4;
+    options.slab_hugepage.val.vbool = true;
+
+    test_teardown();
+    slab_setup(&options, &metrics);
+
+    /* one item fills each slab, so each is taken from the heap */
+    val.len = MY_SLAB_SIZE / 10 * 9;
+    val.data = cc_alloc(val.len);
+    cc_memset(val.data, 'A', val.len);
+    key.data = keystr;
+    key.len = KEY_LEN;
+    for (i = 0; i < nitem; i++) {
+        snprintf(keystr, sizeof(keystr), "%08"PRIu32, i);
+        status = item_reserve(&it, &key, &val, val.len, 0, INT32_MAX);
+        ck_assert_msg(status == ITEM_OK, "item_reserve not OK - return status %d", status);
+        item_insert(it, &key);
+    }
+    for (i = 0; i < nitem; i++) {
+        snprintf(keystr, sizeof(keystr), "%08"PRIu32, i);
+        ck_assert_msg(item_get(&key) != NULL, "item %"PRIu32" not found", i);
+    }
+    cc_free(val.data);
+
+    test_reset();
+#undef MY_SLAB_SIZE
+#undef MY_SLAB_MAXBYTES
+#undef KEY_LEN
+}
+END_TEST
+
+#define CONCURRENT_NTHREAD 4
+#define CONCURRENT_NINCR 1000
+#define CONCURRENT_NKEY 2000
+static void *
+_concurrent_worker(void *arg)
+{
+    uintptr_t idx = (uintptr_t)arg;
+    char keystring[30], valstring[CC_UINT64_MAXLEN];
+    struct bstring key, val;
+    item_rstatus_e status;
+    struct item *it;
+    uint64_t vint, last = 0;
+    uint32_t i;
+
+    /* distinct keys of this thread, which grow the hash table meanwhile */
+    for (i = 0; i < CONCURRENT_NKEY; ++i) {
+        key.len = sprintf(keystring, "%"PRIuPTR"-%"PRIu32, idx, i);
+        key.data = keystring;
+        val.len = sprintf(valstring, "%"PRIu32, i);
+        val.data = valstring;
+        item_lock(&key);
+        status = item_reserve(&it, &key, &val, val.len, 0, INT32_MAX);
+        ck_assert_msg(status == ITEM_OK, "item_reserve not OK - return status %d", status);
+        item_insert(it, &key);
+        item_unlock();
+    }
+
+    /* one counter replaced by all threads, and borrowed without the lock */
+    key = str2bstr("counter");
+    for (i = 0; i < CONCURRENT_NINCR; ++i) {
+        item_lock(&key);
+        it = item_get(&key);
+        ck_assert_msg(it != NULL, "item_get returned NULL");
+        ck_assert_int_eq(item_atou64(&vint, it), ITEM_OK);
+        val.len = sprintf(valstring, "%"PRIu64, vint + 1);
+        val.data = valstring;
+        status = item_reserve(&it, &key, &val, val.len, 0, INT32_MAX);
+        ck_assert_msg(status == ITEM_OK, "item_reserve not OK - return status %d", status);
+        item_insert(it, &key);
+        item_unlock();
+
+        it = item_borrow(&key);
+        ck_assert_msg(it != NULL, "item_borrow returned NULL");
+        ck_assert_int_eq(item_atou64(&vint, it), ITEM_OK);
+        item_return(it);
+        ck_assert_msg(vint >= last, "counter went backwards");
+        last = vint;
+    }
+
+    return NULL;
+}
+
+/**
+ * Tests that threads sharing the heap see the updates of each other to a key
+ * they lock, and don't lose keys while they insert concurrently.
+ */
+START_TEST(test_concurrent)
+{
+#define MY_HASH_POWER 4
+    pthread_t thread[CONCURRENT_NTHREAD];
+    char keystring[30];
+    struct bstring key, val;
+    item_rstatus_e status;
+    struct item *it;
+    uint64_t vint;
+    uintptr_t i, j;
+
+    metrics = (slab_metrics_st) { SLAB_METRIC(METRIC_INIT) };
+    option_load_default((struct option *)&options, OPTION_CARDINALITY(options));
+    options.slab_hash_power.val.vuint = MY_HASH_POWER;
+    options.slab_concurrent.val.vbool = true;
+
+    test_teardown();
+    slab_setup(&options, &metrics);
+
+    key = str2bstr("counter");
+    val = str2bstr("0");
+    status = item_reserve(&it, &key, &val, val.len, 0, INT32_MAX);
+    ck_assert_msg(status == ITEM_OK, "item_reserve not OK - return status %d", status);
+    item_insert(it, &key);
+
+    for (i = 0; i < CONCURRENT_NTHREAD; ++i) {
+        ck_assert_int_eq(pthread_create(&thread[i], NULL, _concurrent_worker,
+                    (void *)i), 0);
+    }
+    for (i = 0; i < CONCURRENT_NTHREAD; ++i) {
+        pthread_join(thread[i], NULL);
+    }
+
+    it = item_get(&key);
+    ck_assert_msg(it != NULL, "item_get returned NULL");
+    ck_assert_int_eq(item_atou64(&vint, it), ITEM_OK);
+    ck_assert_int_eq(vint, CONCURRENT_NTHREAD * CONCURRENT_NINCR);
+
+    /* the heap is far from full, so no key has been evicted */
+    ck_assert_int_eq(metrics.slab_evict.counter, 0);
+    ck_assert_int_gt(hash_table->hash_power, MY_HASH_POWER);
+    ck_assert_uint_eq(hash_table->nhash_item, CONCURRENT_NTHREAD * CONCURRENT_NKEY + 1);
+    for (i = 0; i < CONCURRENT_NTHREAD; ++i) {
+        for (j = 0; j < CONCURRENT_NKEY; ++j) {
+            key.len = sprintf(keystring, "%"PRIuPTR"-%"PRIuPTR, i, j);
+            key.data = keystring;
+            it = item_get(&key);
+            ck_assert_msg(it != NULL, "key %.*s was lost", key.len, key.data);
+            ck_assert_int_eq(item_atou64(&vint, it), ITEM_OK);
+            ck_assert_int_eq(vint, j);
+        }
+    }
+
+    test_reset();
+#undef MY_HASH_POWER
+}
+END_TEST
+#undef CONCURRENT_NTHREAD
+#undef CONCURRENT_NINCR
+#undef CONCURRENT_NKEY
+
 /*
  * test suite
  */
@@ -753,8 +1138,13 @@ slab_suite(void)
     TCase *tc_slab = tcase_create("slab api");
     suite_add_tcase(s, tc_slab);
     tcase_add_test(tc_slab, test_evict_lru_basic);
+    tcase_add_test(tc_slab, test_evict_clock_basic);
     tcase_add_test(tc_slab, test_refcount);
     tcase_add_test(tc_slab, test_evict_refcount);
+    tcase_add_test(tc_slab, test_automove_basic);
+    tcase_add_test(tc_slab, test_hash_expand);
+    tcase_add_test(tc_slab, test_prefault);
+    tcase_add_test(tc_slab, test_concurrent);
 
     return s;
 }
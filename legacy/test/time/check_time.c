@@ -289,6 +289,35 @@ START_TEST(test_long_duration)
 }
 END_TEST
 
+START_TEST(test_now_duration)
+{
+#define NOW_NS 1000000
+
+    proc_time_fine_i ns_before, ns_after, ns_update;
+    struct timespec ts = (struct timespec){0, NOW_NS};
+
+    test_reset();
+
+    /* read now, not as of the last update */
+    time_update();
+    ns_before = time_now_ns();
+    ck_assert_int_ge(ns_before, time_proc_ns());
+
+    nanosleep(&ts, NULL);
+
+    ns_after = time_now_ns();
+    ck_assert_int_ge(ns_after - ns_before, NOW_NS);
+
+    /* and agrees with the clock, whether or not the TSC is used */
+    time_update();
+    ns_update = time_proc_ns();
+    ck_assert_int_ge(ns_update, ns_after - NOW_NS / 10);
+    ck_assert_int_le(ns_update - ns_after, NOW_NS);
+
+#undef NOW_NS
+}
+END_TEST
+
 /*
  * test suite
  */
@@ -309,6 +338,7 @@ time_suite(void)
     suite_add_tcase(s, tc_duration);
     tcase_add_test(tc_duration, test_short_duration);
     tcase_add_test(tc_duration, test_long_duration);
+    tcase_add_test(tc_duration, test_now_duration);
 
     return s;
 }
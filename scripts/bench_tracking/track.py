@@ -0,0 +1,265 @@
+"""Runs the fixed suite of criterion benchmarks, stores the results along with
+the commit they were measured at, and compares results against a baseline to
+flag statistically significant regressions.
+
+    python3 track.py run [--output DIR] [--baseline FILE]
+    python3 track.py compare BASELINE CURRENT
+
+Results are JSON documents with the commit metadata and, for each benchmark,
+criterion's estimates and the time per iteration of every sample, which is
+what the comparison is based on.
+"""
+
+from __future__ import print_function
+import argparse
+import json
+import math
+import os
+import platform
+import subprocess
+import sys
+import time
+
+
+# the benchmarks tracked, as (package, bench target)
+SUITE = [
+    ('segcache', 'benchmark'),
+    ('protocol-memcache', 'request-parsing'),
+    ('bloom', 'bloom'),
+    ('protocol-admin', 'admin'),
+    ('protocol-resp', 'resp'),
+]
+
+FORMAT_VERSION = 1
+
+# defaults: a change is reported when it is both significant and large enough
+DEFAULT_ALPHA = 0.01
+DEFAULT_THRESHOLD = 5.0  # % change of the median time per iteration
+
+
+def git(*args):
+    try:
+        return subprocess.check_output(('git',) + args,
+                                       stderr=subprocess.DEVNULL).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def cpu_model():
+    try:
+        with open('/proc/cpuinfo') as f:
+            for line in f:
+                if line.startswith('model name'):
+                    return line.split(':', 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or None
+
+
+def metadata():
+    rustc = subprocess.check_output(('rustc', '--version')).decode().strip()
+    return {
+        'commit': git('rev-parse', 'HEAD'),
+        'commit_time': git('log', '-1', '--format=%cI'),
+        'branch': git('rev-parse', '--abbrev-ref', 'HEAD'),
+        'dirty': bool(git('status', '--porcelain', '--untracked-files=no')),
+        'time': time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime()),
+        'host': platform.node(),
+        'cpu': cpu_model(),
+        'os': platform.platform(),
+        'rustc': rustc,
+    }
+
+
+def load_json(path):
+    with open(path) as f:
+        return json.load(f)
+
+
+def collect(criterion_dir, since):
+    """The results of the benchmarks criterion wrote after `since`."""
+    results = {}
+
+    for root, _, files in os.walk(criterion_dir):
+        if os.path.basename(root) != 'new' or 'sample.json' not in files:
+            continue
+        if os.path.getmtime(os.path.join(root, 'sample.json')) < since:
+            continue  # left over from an earlier run
+
+        benchmark = load_json(os.path.join(root, 'benchmark.json'))
+        estimates = load_json(os.path.join(root, 'estimates.json'))
+        sample = load_json(os.path.join(root, 'sample.json'))
+
+        results[benchmark['full_id']] = {
+            'mean': estimates['mean']['point_estimate'],
+            'median': estimates['median']['point_estimate'],
+            'std_dev': estimates['std_dev']['point_estimate'],
+            'throughput': benchmark.get('throughput'),
+            # ns per iteration of each sample
+            'samples': [t / n for t, n in zip(sample['times'], sample['iters'])],
+        }
+
+    return results
+
+
+def run(args):
+    toplevel = git('rev-parse', '--show-toplevel') or '.'
+    target = os.environ.get('CARGO_TARGET_DIR', os.path.join(toplevel, 'target'))
+    start = time.time()
+
+    for package, bench in SUITE:
+        cmd = ['cargo', 'bench', '-p', package, '--bench', bench, '--',
+               '--noplot'] + args.criterion_args
+        print('running:', ' '.join(cmd), file=sys.stderr)
+        subprocess.check_call(cmd, cwd=toplevel)
+
+    results = {
+        'version': FORMAT_VERSION,
+        'metadata': metadata(),
+        'benchmarks': collect(os.path.join(target, 'criterion'), start),
+    }
+
+    os.makedirs(args.output, exist_ok=True)
+    commit = (results['metadata']['commit'] or 'unknown')[:12]
+    path = os.path.join(args.output, '{}-{}.json'.format(
+        time.strftime('%Y%m%dT%H%M%S', time.gmtime(start)), commit))
+    with open(path, 'w') as f:
+        json.dump(results, f, indent=1, sort_keys=True)
+    print('results written to', path, file=sys.stderr)
+
+    if args.baseline:
+        return report(load_json(args.baseline), results, args.alpha,
+                      args.threshold)
+    return 0
+
+
+def median(values):
+    values = sorted(values)
+    n = len(values)
+    return (values[(n - 1) // 2] + values[n // 2]) / 2.0
+
+
+def mann_whitney(a, b):
+    """Two-sided p-value of the Mann-Whitney U test, using the normal
+    approximation with a tie correction, which holds for criterion's default
+    of 100 samples. Unlike a t-test it does not assume the times are normally
+    distributed, and is robust to the outliers benchmark samples often have."""
+    n1, n2 = len(a), len(b)
+    values = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+
+    # rank all values, giving ties their average rank
+    ranks = [0.0] * len(values)
+    ties = 0.0
+    i = 0
+    while i < len(values):
+        j = i
+        while j + 1 < len(values) and values[j + 1][0] == values[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+
+    r1 = sum(r for r, (_, group) in zip(ranks, values) if group == 0)
+    u = r1 - n1 * (n1 + 1) / 2.0
+    n = n1 + n2
+    var = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if var <= 0:
+        return 1.0
+
+    z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(var)
+    return math.erfc(max(z, 0) / math.sqrt(2))
+
+
+def compare(baseline, current, alpha, threshold):
+    """Yields (name, change %, p-value, verdict) of the benchmarks in both."""
+    for name in sorted(current['benchmarks']):
+        if name not in baseline['benchmarks']:
+            continue
+        old = baseline['benchmarks'][name]['samples']
+        new = current['benchmarks'][name]['samples']
+        if len(old) < 2 or len(new) < 2:
+            continue
+
+        change = (median(new) / median(old) - 1) * 100
+        p = mann_whitney(old, new)
+        if p >= alpha or abs(change) < threshold:
+            verdict = ''
+        elif change > 0:
+            verdict = 'REGRESSION'
+        else:
+            verdict = 'improvement'
+        yield name, change, p, verdict
+
+
+def describe(results):
+    meta = results['metadata']
+    return '{} ({}{})'.format((meta['commit'] or 'unknown')[:12], meta['time'],
+                              ', dirty' if meta['dirty'] else '')
+
+
+def report(baseline, current, alpha, threshold):
+    print('baseline: {}'.format(describe(baseline)))
+    print('current:  {}'.format(describe(current)))
+    for key in ('host', 'cpu', 'rustc'):
+        if baseline['metadata'].get(key) != current['metadata'].get(key):
+            print('warning: {} differs, {!r} vs {!r}'.format(
+                key, baseline['metadata'].get(key), current['metadata'].get(key)))
+    print()
+
+    regressions = 0
+    print('{:<60} {:>9} {:>9}  {}'.format('benchmark', 'change', 'p-value', ''))
+    for name, change, p, verdict in compare(baseline, current, alpha, threshold):
+        print('{:<60} {:>+8.2f}% {:>9.2g}  {}'.format(name, change, p, verdict))
+        if verdict == 'REGRESSION':
+            regressions += 1
+
+    missing = set(baseline['benchmarks']) - set(current['benchmarks'])
+    for name in sorted(missing):
+        print('{:<60} {:>9} {:>9}  missing'.format(name, '', ''))
+
+    print()
+    print('{} regression(s), threshold {}%, alpha {}'.format(
+        regressions, threshold, alpha))
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Track the performance of the benchmark suite.')
+    subparsers = parser.add_subparsers(dest='command')
+
+    parser_run = subparsers.add_parser('run', help='run the benchmark suite')
+    parser_run.add_argument('--output', default='bench-results',
+                            help='directory the results are written to')
+    parser_run.add_argument('--baseline',
+                            help='results to compare the new results against')
+    parser_run.add_argument('criterion_args', nargs='*',
+                            help='passed to criterion, after a --')
+
+    parser_compare = subparsers.add_parser('compare',
+                                           help='compare two sets of results')
+    parser_compare.add_argument('baseline')
+    parser_compare.add_argument('current')
+
+    for p in (parser_run, parser_compare):
+        p.add_argument('--alpha', type=float, default=DEFAULT_ALPHA,
+                       help='significance level of a change')
+        p.add_argument('--threshold', type=float, default=DEFAULT_THRESHOLD,
+                       help='smallest change of the median, in %%, reported')
+
+    args = parser.parse_args()
+
+    if args.command == 'run':
+        return run(args)
+    if args.command == 'compare':
+        return report(load_json(args.baseline), load_json(args.current),
+                      args.alpha, args.threshold)
+
+    parser.print_help()
+    return 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
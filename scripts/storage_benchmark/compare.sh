@@ -0,0 +1,88 @@
+#!/bin/bash
+
+# Runs the same bench_storage workloads with the legacy storage engines and the
+# Rust segcache, and prints the results side by side. The legacy benchmarks
+# must be built first (they are built along with the tests, see
+# legacy/README.md), and the script is run from the root of the repository.
+
+bin_dir="legacy/_build/_bin"
+engines="bench_seg bench_slab bench_cuckoo"
+
+show_help()
+{
+    echo "compare.sh [-b <dir with the legacy bench_* binaries>] [-e \"<legacy engines>\"] <workload>..."
+}
+
+get_args()
+{
+    while getopts ":b:e:h" opt; do
+        case "$opt" in
+        b)  bin_dir=$OPTARG
+            ;;
+        e)  engines=$OPTARG
+            ;;
+        h)
+            show_help
+            exit 0
+            ;;
+        \?)
+            echo "unrecognized option $opt"
+            show_help
+            exit 1
+            ;;
+        esac
+    done
+}
+
+# turns the output of a benchmark into a row of the table
+summarize()
+{
+    local output
+    output=$(cat)
+    if [ -z "$output" ]; then
+        echo "$1 failed to run, skipped" >&2
+        return
+    fi
+
+    echo "$output" | awk -v engine="$1" '
+        /^throughput:/ { ops = $2 }
+        /^memory:/ { bpb = $(NF - 4) }
+        /^Latency/ {
+            op = $8
+            gsub(/,/, "", $0)
+            split($0, f, ": ")
+            split(f[2], v, " ")
+            p50[op] = v[1]; p99[op] = v[3]
+        }
+        END {
+            printf "%-14s %12.0f %8s %8s %8s %8s %8s %8s %8.3f\n", engine, ops,
+                p50["get"], p99["get"], p50["put"], p99["put"],
+                p50["rem"], p99["rem"], bpb
+        }'
+}
+
+get_args "${@}"
+shift $((OPTIND - 1))
+
+if [ $# -eq 0 ]; then
+    show_help
+    exit 1
+fi
+
+for workload in "$@"; do
+    echo "workload: $workload"
+    printf "%-14s %12s %8s %8s %8s %8s %8s %8s %8s\n" engine ops/s \
+        get_p50 get_p99 put_p50 put_p99 rem_p50 rem_p99 B/B
+
+    for engine in $engines; do
+        if [ ! -x "$bin_dir/$engine" ]; then
+            echo "$engine not found in $bin_dir, skipped" >&2
+            continue
+        fi
+        "$bin_dir/$engine" "$workload" | summarize "$engine"
+    done
+
+    cargo bench -q -p segcache --bench storage -- "$workload" 2>/dev/null |
+        summarize "segcache (rs)"
+    echo
+done
@@ -0,0 +1,19 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use serde::{Deserialize, Serialize};
+
+/// The eviction policy of segment-structured storage.
+#[derive(Copy, Clone, Debug, Serialize, Deserialize, PartialEq, Eq)]
+pub enum Eviction {
+    None,
+    Random,
+    RandomFifo,
+    Fifo,
+    Cte,
+    Util,
+    Score,
+    S3Fifo,
+    Merge,
+}
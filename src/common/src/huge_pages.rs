@@ -0,0 +1,14 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use serde::{Deserialize, Serialize};
+
+/// The size of the pages which back in-memory storage.
+#[derive(Copy, Clone, Debug, Serialize, Deserialize, PartialEq, Eq)]
+pub enum HugePages {
+    Disabled,
+    Transparent,
+    Huge2M,
+    Huge1G,
+}
@@ -3,7 +3,9 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 pub mod bytes;
+pub mod eviction;
 pub mod expiry;
+pub mod huge_pages;
 pub mod metrics;
 pub mod signal;
 #[cfg(feature = "boringssl")]
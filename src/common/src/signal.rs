@@ -2,8 +2,38 @@
 // Licensed under the Apache License, Version 2.0
 // http://www.apache.org/licenses/LICENSE-2.0
 
+use crate::eviction::Eviction;
+use std::sync::Arc;
+
 #[derive(Clone)]
 pub enum Signal {
     FlushAll,
+    /// Invalidates every item whose key starts with the prefix.
+    Invalidate(Arc<[u8]>),
+    /// Applies the tunables reloaded from the config.
+    Reload(Arc<Tunables>),
     Shutdown,
 }
+
+/// The options which can be changed while the process runs by reloading its
+/// config. Each thread applies the ones which concern it. Options which are
+/// only read at startup, such as the size of the storage, are not included.
+#[derive(Clone, Debug)]
+pub struct Tunables {
+    /// The timeout of the event loop of the worker and storage threads, in
+    /// milliseconds.
+    pub timeout: usize,
+    /// The number of events handled by each poll of the worker and storage
+    /// threads.
+    pub nevent: usize,
+    /// The number of idle session buffers held by each thread.
+    pub poolsize: usize,
+    /// 1 in how many commands, or keys, are logged by the klog.
+    pub klog_sample: usize,
+    /// The eviction policy of segment-structured storage, and the options of
+    /// merge eviction.
+    pub eviction: Option<Eviction>,
+    pub merge_target: usize,
+    pub merge_max: usize,
+    pub compact_target: usize,
+}
@@ -15,6 +15,18 @@ pub trait TlsConfig {
     fn certificate(&self) -> Option<String>;
 
     fn ca_file(&self) -> Option<String>;
+
+    /// Whether record encryption of negotiated sessions should be offloaded
+    /// to the kernel where possible.
+    fn ktls(&self) -> bool {
+        false
+    }
+
+    /// The number of sessions kept for resumption, where `None` keeps the
+    /// default of the library and zero disables resumption from the cache.
+    fn session_cache_size(&self) -> Option<usize> {
+        None
+    }
 }
 
 /// Create an `TlsTcpAcceptor` from the given `TlsConfig`. Returns an error if
@@ -59,5 +71,9 @@ pub fn tls_acceptor(config: &dyn TlsConfig) -> Result<Option<TlsTcpAcceptor>, Io
         builder = builder.certificate_chain_file(f);
     }
 
+    builder = builder
+        .ktls(config.ktls())
+        .session_cache_size(config.session_cache_size());
+
     Ok(Some(builder.build()?))
 }
@@ -13,11 +13,13 @@ const ADMIN_HTTP_ENABLED: bool = false;
 const ADMIN_HTTP_HOST: &str = "127.0.0.1";
 const ADMIN_HTTP_PORT: &str = "9998";
 const ADMIN_TIMEOUT: usize = 100;
+const ADMIN_SNAPSHOT_INTERVAL: usize = 1000;
 const ADMIN_NEVENT: usize = 1024;
 const ADMIN_TW_TICK: usize = 10;
 const ADMIN_TW_CAP: usize = 1000;
 const ADMIN_TW_NTICK: usize = 100;
 const ADMIN_USE_TLS: bool = false;
+const ADMIN_CORE: Option<usize> = None;
 
 // TODO(bmartin): we will eventually migrate to HTTP by default and make the
 // legacy admin port as optional. At that time, we should consider consolidating
@@ -51,6 +53,10 @@ fn timeout() -> usize {
     ADMIN_TIMEOUT
 }
 
+fn snapshot_interval() -> usize {
+    ADMIN_SNAPSHOT_INTERVAL
+}
+
 fn nevent() -> usize {
     ADMIN_NEVENT
 }
@@ -71,6 +77,10 @@ fn use_tls() -> bool {
     ADMIN_USE_TLS
 }
 
+fn core() -> Option<usize> {
+    ADMIN_CORE
+}
+
 // definitions
 #[derive(Clone, Serialize, Deserialize, Debug)]
 pub struct Admin {
@@ -86,6 +96,8 @@ pub struct Admin {
     http_port: String,
     #[serde(default = "timeout")]
     timeout: usize,
+    #[serde(default = "snapshot_interval")]
+    snapshot_interval: usize,
     #[serde(default = "nevent")]
     nevent: usize,
     #[serde(default = "tw_tick")]
@@ -96,6 +108,8 @@ pub struct Admin {
     tw_ntick: usize,
     #[serde(default = "use_tls")]
     use_tls: bool,
+    #[serde(default = "core")]
+    core: Option<usize>,
 }
 
 // implementation
@@ -120,6 +134,12 @@ impl Admin {
         self.timeout
     }
 
+    /// How often histograms are snapshotted, in milliseconds. Percentiles
+    /// are reported over the interval between the last two snapshots.
+    pub fn snapshot_interval(&self) -> usize {
+        self.snapshot_interval
+    }
+
     pub fn nevent(&self) -> usize {
         self.nevent
     }
@@ -145,6 +165,11 @@ impl Admin {
     pub fn use_tls(&self) -> bool {
         self.use_tls
     }
+
+    /// The core to pin the admin thread to, if any.
+    pub fn core(&self) -> Option<usize> {
+        self.core
+    }
 }
 
 // trait implementations
@@ -157,11 +182,13 @@ impl Default for Admin {
             http_host: http_host(),
             http_port: http_port(),
             timeout: timeout(),
+            snapshot_interval: snapshot_interval(),
             nevent: nevent(),
             tw_tick: tw_tick(),
             tw_cap: tw_cap(),
             tw_ntick: tw_ntick(),
             use_tls: use_tls(),
+            core: core(),
         }
     }
 }
@@ -9,6 +9,7 @@ use serde::{Deserialize, Serialize};
 // constants to define default values
 const BUF_DEFAULT_SIZE: usize = 16 * KB;
 const BUF_POOLSIZE: usize = 0;
+const BUF_LIMIT: usize = 0;
 
 // helper functions
 fn size() -> usize {
@@ -19,6 +20,10 @@ fn poolsize() -> usize {
     BUF_POOLSIZE
 }
 
+fn limit() -> usize {
+    BUF_LIMIT
+}
+
 // struct definitions
 #[derive(Serialize, Deserialize, Debug)]
 pub struct Buf {
@@ -26,6 +31,8 @@ pub struct Buf {
     size: usize,
     #[serde(default = "poolsize")]
     poolsize: usize,
+    #[serde(default = "limit")]
+    limit: usize,
 }
 
 // implementation
@@ -37,6 +44,13 @@ impl Buf {
     pub fn poolsize(&self) -> usize {
         self.poolsize
     }
+
+    /// The most bytes which the session buffers may hold in total. Once
+    /// reached, new sessions are refused and sessions whose requests need
+    /// their buffers to grow are closed. Zero means there is no limit.
+    pub fn limit(&self) -> usize {
+        self.limit
+    }
 }
 
 // trait implementations
@@ -45,6 +59,7 @@ impl Default for Buf {
         Self {
             size: size(),
             poolsize: poolsize(),
+            limit: limit(),
         }
     }
 }
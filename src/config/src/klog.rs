@@ -30,6 +30,12 @@ const SAMPLE: usize = 100;
 // single message buffer size in bytes
 const SINGLE_MESSAGE_SIZE: usize = KB;
 
+// log the hash of each key rather than the key, for the binary format
+const HASH_KEYS: bool = false;
+
+// size of the blocks of binary records which are compressed, in bytes
+const BLOCK_SIZE: usize = 64 * KB;
+
 ////////////////////////////////////////////////////////////////////////////////
 // helper functions
 ////////////////////////////////////////////////////////////////////////////////
@@ -62,16 +68,54 @@ fn single_message_size() -> usize {
     SINGLE_MESSAGE_SIZE
 }
 
+fn hash_keys() -> bool {
+    HASH_KEYS
+}
+
+fn block_size() -> usize {
+    BLOCK_SIZE
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // struct definitions
 ////////////////////////////////////////////////////////////////////////////////
 
+/// How commands are written to the klog file.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum KlogFormat {
+    /// One line of text per command.
+    #[default]
+    Text,
+    /// Compact binary records, compressed in blocks, which may be read back
+    /// with the `klog-decode` tool.
+    Binary,
+}
+
+/// How the commands which are logged are chosen.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum KlogSampling {
+    /// 1 in `sample` commands, regardless of their keys.
+    #[default]
+    Uniform,
+    /// Every command for 1 in `sample` keys, chosen by the hash of the key, so
+    /// that the reuse of the sampled keys is kept intact.
+    Key,
+}
+
 #[derive(Serialize, Deserialize, Debug, Clone)]
 pub struct Klog {
     #[serde(default = "backup")]
     backup: Option<String>,
     #[serde(default = "file")]
     file: Option<String>,
+    #[serde(default)]
+    format: KlogFormat,
+    #[serde(default = "hash_keys")]
+    hash_keys: bool,
+    #[serde(default = "block_size")]
+    block_size: usize,
     #[serde(default = "interval")]
     interval: usize,
     #[serde(default = "max_size")]
@@ -80,6 +124,8 @@ pub struct Klog {
     queue_depth: usize,
     #[serde(default = "sample")]
     sample: usize,
+    #[serde(default)]
+    sampling: KlogSampling,
     #[serde(default = "single_message_size")]
     single_message_size: usize,
 }
@@ -116,9 +162,27 @@ impl Klog {
         self.sample
     }
 
+    pub fn sampling(&self) -> KlogSampling {
+        self.sampling
+    }
+
     pub fn single_message_size(&self) -> usize {
         self.single_message_size
     }
+
+    pub fn format(&self) -> KlogFormat {
+        self.format
+    }
+
+    /// Whether binary records hold the hash of each key rather than the key.
+    pub fn hash_keys(&self) -> bool {
+        self.hash_keys
+    }
+
+    /// The size at which a block of binary records is compressed and written.
+    pub fn block_size(&self) -> usize {
+        self.block_size
+    }
 }
 
 // trait implementations
@@ -131,7 +195,11 @@ impl Default for Klog {
             max_size: max_size(),
             queue_depth: queue_depth(),
             sample: sample(),
+            sampling: KlogSampling::default(),
             single_message_size: single_message_size(),
+            format: KlogFormat::default(),
+            hash_keys: hash_keys(),
+            block_size: block_size(),
         }
     }
 }
@@ -16,8 +16,9 @@ mod pingproxy;
 mod pingserver;
 pub mod proxy;
 mod rds;
+mod replication;
 pub mod seg;
-mod segcache;
+pub mod segcache;
 mod server;
 mod sockio;
 mod stats_log;
@@ -33,11 +34,12 @@ pub use array::ArrayConfig;
 pub use buf::{Buf, BufConfig};
 pub use dbuf::DbufConfig;
 pub use debug::{Debug, DebugConfig};
-pub use klog::{Klog, KlogConfig};
+pub use klog::{Klog, KlogConfig, KlogFormat, KlogSampling};
 pub use momento_proxy::MomentoProxyConfig;
 pub use pingproxy::PingproxyConfig;
 pub use pingserver::PingserverConfig;
 pub use rds::RdsConfig;
+pub use replication::{Replication, ReplicationConfig};
 pub use seg::{Seg, SegConfig};
 pub use segcache::SegcacheConfig;
 pub use server::{Server, ServerConfig};
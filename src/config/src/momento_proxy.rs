@@ -21,6 +21,29 @@ impl Default for Protocol {
     }
 }
 
+// constants to define default values
+const NEAR_CACHE_TTL: u64 = 1;
+const NEGATIVE_CACHE_TTL_MS: u64 = 500;
+const CONNECTIONS_PER_CHANNEL: usize = 64;
+const MAX_CHANNELS: usize = 16;
+
+// helper functions
+fn near_cache_ttl() -> NonZeroU64 {
+    NonZeroU64::new(NEAR_CACHE_TTL).unwrap()
+}
+
+fn connections_per_channel() -> usize {
+    CONNECTIONS_PER_CHANNEL
+}
+
+fn max_channels() -> usize {
+    MAX_CHANNELS
+}
+
+fn negative_cache_ttl_ms() -> NonZeroU64 {
+    NonZeroU64::new(NEGATIVE_CACHE_TTL_MS).unwrap()
+}
+
 // struct definitions
 #[derive(Clone, Serialize, Default, Deserialize, Debug)]
 pub struct MomentoProxyConfig {
@@ -37,9 +60,23 @@ pub struct MomentoProxyConfig {
     klog: Klog,
 }
 
-#[derive(Default, Clone, Copy, Serialize, Deserialize, Debug)]
+#[derive(Clone, Copy, Serialize, Deserialize, Debug)]
 pub struct Proxy {
     threads: Option<usize>,
+    #[serde(default = "connections_per_channel")]
+    connections_per_channel: usize,
+    #[serde(default = "max_channels")]
+    max_channels: usize,
+}
+
+impl Default for Proxy {
+    fn default() -> Self {
+        Self {
+            threads: None,
+            connections_per_channel: connections_per_channel(),
+            max_channels: max_channels(),
+        }
+    }
 }
 
 // definitions
@@ -51,6 +88,14 @@ pub struct Cache {
     default_ttl: NonZeroU64,
     #[serde(default)]
     protocol: Protocol,
+    #[serde(default)]
+    near_cache_size: Option<usize>,
+    #[serde(default = "near_cache_ttl")]
+    near_cache_ttl: NonZeroU64,
+    #[serde(default)]
+    negative_cache_size: Option<usize>,
+    #[serde(default = "negative_cache_ttl_ms")]
+    negative_cache_ttl_ms: NonZeroU64,
 }
 
 // implementation
@@ -83,6 +128,31 @@ impl Cache {
     pub fn protocol(&self) -> Protocol {
         self.protocol
     }
+
+    /// The size in bytes of the local cache which holds recently read and
+    /// written items, if it is enabled
+    pub fn near_cache_size(&self) -> Option<usize> {
+        self.near_cache_size
+    }
+
+    /// The longest time (in seconds) that an item is served from the local
+    /// cache before it must be read again from Momento
+    pub fn near_cache_ttl(&self) -> Duration {
+        Duration::from_secs(self.near_cache_ttl.get())
+    }
+
+    /// The number of keys which were recently found to be missing from
+    /// Momento that are remembered, so that gets for them are answered
+    /// locally, if it is enabled
+    pub fn negative_cache_size(&self) -> Option<usize> {
+        self.negative_cache_size
+    }
+
+    /// The longest time (in milliseconds) that a missing key is remembered
+    /// before it must be read again from Momento
+    pub fn negative_cache_ttl(&self) -> Duration {
+        Duration::from_millis(self.negative_cache_ttl_ms.get())
+    }
 }
 
 // implementation
@@ -110,6 +180,18 @@ impl MomentoProxyConfig {
     pub fn threads(&self) -> Option<usize> {
         self.proxy.threads
     }
+
+    /// The number of client connections which share a gRPC channel to
+    /// Momento before another channel is opened
+    pub fn connections_per_channel(&self) -> usize {
+        self.proxy.connections_per_channel.max(1)
+    }
+
+    /// The most gRPC channels which are opened to Momento for each default
+    /// TTL, shared by the listeners of every cache
+    pub fn max_channels(&self) -> usize {
+        self.proxy.max_channels.max(1)
+    }
 }
 
 impl AdminConfig for MomentoProxyConfig {
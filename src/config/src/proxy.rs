@@ -4,21 +4,28 @@
 
 use serde::{Deserialize, Serialize};
 
+use std::collections::BTreeMap;
 use std::net::{AddrParseError, SocketAddr, ToSocketAddrs};
 
 // constants to define default values
 const LISTEN_ADDRESS: &str = "0.0.0.0:12322";
+const LISTEN_SOCKET: Option<String> = None;
 const TIMEOUT_MS: usize = 100;
 const NEVENT_MAX: usize = 1024;
 const FRONTEND_THREADS: usize = 1;
 const BACKEND_THREADS: usize = 1;
 const BACKEND_POOLSIZE: usize = 1;
+const BACKEND_PIPELINE_DEPTH: usize = 1;
 
 // helper functions
 fn address() -> String {
     LISTEN_ADDRESS.to_string()
 }
 
+fn socket() -> Option<String> {
+    LISTEN_SOCKET
+}
+
 fn timeout() -> usize {
     TIMEOUT_MS
 }
@@ -39,11 +46,17 @@ fn backend_poolsize() -> usize {
     BACKEND_POOLSIZE
 }
 
+fn backend_pipeline_depth() -> usize {
+    BACKEND_PIPELINE_DEPTH
+}
+
 // definitions
 #[derive(Serialize, Deserialize, Debug)]
 pub struct Listener {
     #[serde(default = "address")]
     address: String,
+    #[serde(default = "socket")]
+    socket: Option<String>,
     #[serde(default = "timeout")]
     timeout: usize,
     #[serde(default = "nevent")]
@@ -60,6 +73,34 @@ pub struct Frontend {
     threads: usize,
 }
 
+/// How requests are spread across the default endpoints of a backend.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum Distribution {
+    /// Any endpoint may serve any request.
+    #[default]
+    None,
+    /// Each endpoint is a shard which owns the keys hashed onto its points on
+    /// a ring.
+    Ketama,
+    /// Each endpoint is a shard, chosen with jump consistent hashing.
+    Jump,
+    /// Each endpoint is a shard, chosen from a maglev lookup table.
+    Maglev,
+}
+
+/// How a connection is chosen from a pool for each request.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum Selection {
+    /// The connection with the fewest requests in flight.
+    #[default]
+    LeastOutstanding,
+    /// The connection with the lowest recent latency, weighted by the number
+    /// of requests in flight.
+    Ewma,
+}
+
 #[derive(Serialize, Deserialize, Debug)]
 pub struct Backend {
     #[serde(default = "timeout")]
@@ -70,7 +111,21 @@ pub struct Backend {
     threads: usize,
     #[serde(default = "backend_poolsize")]
     poolsize: usize,
+    #[serde(default = "backend_pipeline_depth")]
+    pipeline_depth: usize,
+    #[serde(default)]
+    spares: usize,
     endpoints: Vec<String>,
+    #[serde(default)]
+    selection: Selection,
+    #[serde(default)]
+    hedge: bool,
+    #[serde(default)]
+    distribution: Distribution,
+    #[serde(default)]
+    weights: Vec<usize>,
+    #[serde(default)]
+    routes: BTreeMap<String, Vec<String>>,
 }
 
 // implementation
@@ -80,6 +135,13 @@ impl Listener {
         self.address.parse()
     }
 
+    /// The path of a Unix domain socket to listen on instead of the address,
+    /// for clients on the same host such as the application the proxy runs
+    /// alongside. Not supported with tls.
+    pub fn socket(&self) -> Option<&str> {
+        self.socket.as_deref()
+    }
+
     /// The poll timeout in milliseconds
     pub fn timeout(&self) -> usize {
         self.timeout
@@ -119,6 +181,18 @@ impl Backend {
         self.poolsize
     }
 
+    /// Maximum number of requests in flight on each connection to a server
+    /// endpoint. Above one, requests are pipelined on the connection.
+    pub fn pipeline_depth(&self) -> usize {
+        self.pipeline_depth
+    }
+
+    /// Number of spare connections to each server endpoint from each backend
+    /// thread, which are kept open to replace a connection which is lost
+    pub fn spares(&self) -> usize {
+        self.spares
+    }
+
     /// The poll timeout in milliseconds
     pub fn timeout(&self) -> usize {
         self.timeout
@@ -129,6 +203,30 @@ impl Backend {
         self.nevent
     }
 
+    /// How a connection is chosen from a pool for each request
+    pub fn selection(&self) -> Selection {
+        self.selection
+    }
+
+    /// Whether requests which may safely be sent more than once are sent to
+    /// a second connection when the first is slower than most to respond
+    pub fn hedge(&self) -> bool {
+        self.hedge
+    }
+
+    /// How requests are spread across the default endpoints
+    pub fn distribution(&self) -> Distribution {
+        self.distribution
+    }
+
+    /// The relative weight of each default endpoint when requests are spread
+    /// by key. Endpoints without a weight have a weight of one.
+    pub fn weights(&self) -> Vec<usize> {
+        (0..self.endpoints.len())
+            .map(|i| self.weights.get(i).copied().unwrap_or(1))
+            .collect()
+    }
+
     // TODO(bmartin): the handling of ZK service discovery is based on how
     // Aurora serversets work and needs to be factored out into some more
     // general way of handling service discovery. We may want to allow for
@@ -136,25 +234,7 @@ impl Backend {
     // used to handle service discovery.
     pub fn socket_addrs(&self) -> Result<Vec<SocketAddr>, std::io::Error> {
         if !self.endpoints.is_empty() {
-            let mut endpoints = Vec::new();
-            for endpoint in &self.endpoints {
-                match endpoint.to_socket_addrs() {
-                    Ok(mut addrs) => {
-                        if let Some(addr) = addrs.next() {
-                            endpoints.push(addr)
-                        } else {
-                            return Err(std::io::Error::new(
-                                std::io::ErrorKind::Other,
-                                "failed to resolve endpoint address",
-                            ));
-                        }
-                    }
-                    Err(e) => {
-                        return Err(e);
-                    }
-                }
-            }
-            Ok(endpoints)
+            resolve(&self.endpoints)
         } else {
             Err(std::io::Error::new(
                 std::io::ErrorKind::Other,
@@ -162,6 +242,31 @@ impl Backend {
             ))
         }
     }
+
+    /// Endpoints which requests for particular methods are routed to instead
+    /// of the default endpoints, for protocols which name a method in each
+    /// request.
+    pub fn routes(&self) -> Result<Vec<(String, Vec<SocketAddr>)>, std::io::Error> {
+        self.routes
+            .iter()
+            .map(|(method, endpoints)| Ok((method.clone(), resolve(endpoints)?)))
+            .collect()
+    }
+}
+
+fn resolve(endpoints: &[String]) -> Result<Vec<SocketAddr>, std::io::Error> {
+    let mut addrs = Vec::new();
+    for endpoint in endpoints {
+        if let Some(addr) = endpoint.to_socket_addrs()?.next() {
+            addrs.push(addr)
+        } else {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::Other,
+                "failed to resolve endpoint address",
+            ));
+        }
+    }
+    Ok(addrs)
 }
 
 // trait implementations
@@ -169,6 +274,7 @@ impl Default for Listener {
     fn default() -> Self {
         Self {
             address: address(),
+            socket: socket(),
             timeout: timeout(),
             nevent: nevent(),
         }
@@ -193,6 +299,13 @@ impl Default for Backend {
             threads: backend_threads(),
             endpoints: Vec::new(),
             poolsize: backend_poolsize(),
+            pipeline_depth: backend_pipeline_depth(),
+            spares: 0,
+            selection: Selection::default(),
+            hedge: false,
+            distribution: Distribution::default(),
+            weights: Vec::new(),
+            routes: BTreeMap::new(),
         }
     }
 }
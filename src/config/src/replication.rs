@@ -0,0 +1,169 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use std::net::{AddrParseError, SocketAddr};
+
+use serde::{Deserialize, Serialize};
+
+// constants to define default values
+const LISTEN: Option<String> = None;
+const PRIMARY: Option<String> = None;
+const QUEUE_DEPTH: usize = 1024;
+const MAX_PENDING: usize = 64 * 1024 * 1024;
+const COMPRESSION_LEVEL: i32 = 1;
+const RECONNECT: usize = 1000;
+const WARM: bool = false;
+const WARM_START: u32 = 0;
+const WARM_END: u32 = u32::MAX;
+const WARM_MIN_FREQ: u8 = 0;
+
+// helper functions for default values
+fn listen() -> Option<String> {
+    LISTEN
+}
+
+fn primary() -> Option<String> {
+    PRIMARY
+}
+
+fn queue_depth() -> usize {
+    QUEUE_DEPTH
+}
+
+fn max_pending() -> usize {
+    MAX_PENDING
+}
+
+fn compression_level() -> i32 {
+    COMPRESSION_LEVEL
+}
+
+fn reconnect() -> usize {
+    RECONNECT
+}
+
+fn warm() -> bool {
+    WARM
+}
+
+fn warm_start() -> u32 {
+    WARM_START
+}
+
+fn warm_end() -> u32 {
+    WARM_END
+}
+
+fn warm_min_freq() -> u8 {
+    WARM_MIN_FREQ
+}
+
+// struct definitions
+#[derive(Serialize, Deserialize, Debug)]
+pub struct Replication {
+    #[serde(default = "listen")]
+    listen: Option<String>,
+    #[serde(default = "primary")]
+    primary: Option<String>,
+    #[serde(default = "queue_depth")]
+    queue_depth: usize,
+    #[serde(default = "max_pending")]
+    max_pending: usize,
+    #[serde(default = "compression_level")]
+    compression_level: i32,
+    #[serde(default = "reconnect")]
+    reconnect: usize,
+    #[serde(default = "warm")]
+    warm: bool,
+    #[serde(default = "warm_start")]
+    warm_start: u32,
+    #[serde(default = "warm_end")]
+    warm_end: u32,
+    #[serde(default = "warm_min_freq")]
+    warm_min_freq: u8,
+}
+
+// implementation
+impl Replication {
+    /// The address replicas connect to for the stream of writes executed by
+    /// this instance. Replication from this instance is disabled when not set.
+    pub fn listen(&self) -> Option<Result<SocketAddr, AddrParseError>> {
+        self.listen.as_ref().map(|addr| addr.parse())
+    }
+
+    /// The address of the primary whose stream of writes is applied to this
+    /// instance. This instance is not a replica when not set.
+    pub fn primary(&self) -> Option<Result<SocketAddr, AddrParseError>> {
+        self.primary.as_ref().map(|addr| addr.parse())
+    }
+
+    /// The number of batches of writes which may be queued from the storage
+    /// threads to the replication thread. Batches beyond this are dropped.
+    pub fn queue_depth(&self) -> usize {
+        self.queue_depth
+    }
+
+    /// The bytes of the stream which may be waiting to be sent to a replica
+    /// before it is disconnected for falling behind.
+    pub fn max_pending(&self) -> usize {
+        self.max_pending
+    }
+
+    /// The zstd level the stream is compressed with.
+    pub fn compression_level(&self) -> i32 {
+        self.compression_level
+    }
+
+    /// The time in milliseconds a replica waits before connecting to the
+    /// primary again after the connection is lost.
+    pub fn reconnect(&self) -> usize {
+        self.reconnect
+    }
+
+    /// Whether a replica imports the items already held by the primary each
+    /// time it connects, rather than only applying the writes which follow.
+    pub fn warm(&self) -> bool {
+        self.warm
+    }
+
+    /// The first of the range of key hashes imported when warming, as the
+    /// upper 32 bits of the hash.
+    pub fn warm_start(&self) -> u32 {
+        self.warm_start
+    }
+
+    /// The last of the range of key hashes imported when warming, as the upper
+    /// 32 bits of the hash.
+    pub fn warm_end(&self) -> u32 {
+        self.warm_end
+    }
+
+    /// The minimum frequency of the items imported when warming.
+    pub fn warm_min_freq(&self) -> u8 {
+        self.warm_min_freq
+    }
+}
+
+// trait implementations
+impl Default for Replication {
+    fn default() -> Self {
+        Self {
+            listen: listen(),
+            primary: primary(),
+            queue_depth: queue_depth(),
+            max_pending: max_pending(),
+            compression_level: compression_level(),
+            reconnect: reconnect(),
+            warm: warm(),
+            warm_start: warm_start(),
+            warm_end: warm_end(),
+            warm_min_freq: warm_min_freq(),
+        }
+    }
+}
+
+// trait definitions
+pub trait ReplicationConfig {
+    fn replication(&self) -> &Replication;
+}
@@ -6,16 +6,24 @@ use std::path::{Path, PathBuf};
 
 use serde::{Deserialize, Serialize};
 
+pub use common::eviction::Eviction;
+pub use common::huge_pages::HugePages;
+
 const MB: usize = 1024 * 1024;
 
 // defaults for hashtable
 const HASH_POWER: u8 = 16;
+const MAX_HASH_POWER: u8 = 0;
 const OVERFLOW_FACTOR: f64 = 1.0;
 
 // default heap/segment sizing
 const HEAP_SIZE: usize = 64 * MB;
 const SEGMENT_SIZE: i32 = MB as i32;
 
+// the hashtable and segments are sized by hand unless the expected mean size
+// of an item is provided
+const ITEM_SIZE: Option<usize> = None;
+
 // default eviction strategy
 const EVICTION: Eviction = Eviction::Merge;
 
@@ -27,22 +35,70 @@ const MERGE_MAX: usize = 8;
 // datapool
 const DATAPOOL_PATH: Option<&str> = None;
 
-#[derive(Copy, Clone, Debug, Serialize, Deserialize)]
-pub enum Eviction {
-    None,
-    Random,
-    RandomFifo,
-    Fifo,
-    Cte,
-    Util,
-    Merge,
-}
+// the heap is placed by the default memory policy unless a node is provided
+const NUMA_NODE: Option<usize> = None;
+
+// the heap and hashtable are backed by regular pages unless huge pages are
+// requested
+const HUGE_PAGES: HugePages = HugePages::Disabled;
+
+// metadata for restoring the cache across restarts
+const METADATA_PATH: Option<&str> = None;
+
+// flash tier beneath the heap, disabled by default
+const FLASH_PATH: Option<&str> = None;
+const FLASH_SIZE: usize = 0;
+const FLASH_NODE: Option<usize> = None;
+const FLASH_AGE: u32 = 0;
+
+// number of independently locked storage shards
+const SHARDS: usize = 1;
+
+// free segments kept in reserve by background eviction, disabled by default
+const FREE_RESERVE: usize = 0;
+
+// occupancy at or below which segments are compacted in the background,
+// disabled by default
+const COMPACT_THRESHOLD: f64 = 0.0;
+
+// values too large for a segment are rejected unless stored in chunks
+const LARGE_VALUES: bool = false;
+
+// expired items are not served as stale unless a grace period is set, and
+// leases to recompute them are held for 30 seconds
+const STALE_GRACE: u32 = 0;
+const LEASE_TTL: u32 = 30;
+
+// items are not stamped with a namespace generation unless namespaces are
+// enabled
+const NAMESPACES: bool = false;
+
+// admission filtering of new keys is disabled by default
+const ADMISSION_WINDOW: Option<usize> = None;
+const ADMISSION_THRESHOLD: u8 = 1;
+
+// miss ratio curve estimation is disabled by default
+const MRC_KEYS: Option<usize> = None;
+
+// value compression is disabled by default
+const COMPRESSION_LEVEL: Option<i32> = None;
+const COMPRESSION_THRESHOLD: usize = 512;
+
+// sampling of hot keys is disabled by default
+const HOTKEY_ENABLE: bool = false;
+const HOTKEY_SAMPLE_SIZE: usize = 10000;
+const HOTKEY_SAMPLE_RATE: usize = 1;
+const HOTKEY_NTOP: usize = 16;
 
 // helper functions for default values
 fn hash_power() -> u8 {
     HASH_POWER
 }
 
+fn max_hash_power() -> u8 {
+    MAX_HASH_POWER
+}
+
 fn overflow_factor() -> f64 {
     OVERFLOW_FACTOR
 }
@@ -55,6 +111,10 @@ fn segment_size() -> i32 {
     SEGMENT_SIZE
 }
 
+fn item_size() -> Option<usize> {
+    ITEM_SIZE
+}
+
 fn eviction() -> Eviction {
     EVICTION
 }
@@ -75,17 +135,113 @@ fn datapool_path() -> Option<String> {
     DATAPOOL_PATH.map(|v| v.to_string())
 }
 
+fn numa_node() -> Option<usize> {
+    NUMA_NODE
+}
+
+fn huge_pages() -> HugePages {
+    HUGE_PAGES
+}
+
+fn metadata_path() -> Option<String> {
+    METADATA_PATH.map(|v| v.to_string())
+}
+
+fn flash_path() -> Option<String> {
+    FLASH_PATH.map(|v| v.to_string())
+}
+
+fn flash_size() -> usize {
+    FLASH_SIZE
+}
+
+fn flash_node() -> Option<usize> {
+    FLASH_NODE
+}
+
+fn flash_age() -> u32 {
+    FLASH_AGE
+}
+
+fn shards() -> usize {
+    SHARDS
+}
+
+fn free_reserve() -> usize {
+    FREE_RESERVE
+}
+
+fn compact_threshold() -> f64 {
+    COMPACT_THRESHOLD
+}
+
+fn large_values() -> bool {
+    LARGE_VALUES
+}
+
+fn stale_grace() -> u32 {
+    STALE_GRACE
+}
+
+fn lease_ttl() -> u32 {
+    LEASE_TTL
+}
+
+fn namespaces() -> bool {
+    NAMESPACES
+}
+
+fn admission_window() -> Option<usize> {
+    ADMISSION_WINDOW
+}
+
+fn admission_threshold() -> u8 {
+    ADMISSION_THRESHOLD
+}
+
+fn mrc_keys() -> Option<usize> {
+    MRC_KEYS
+}
+
+fn compression_level() -> Option<i32> {
+    COMPRESSION_LEVEL
+}
+
+fn compression_threshold() -> usize {
+    COMPRESSION_THRESHOLD
+}
+
+fn hotkey_enable() -> bool {
+    HOTKEY_ENABLE
+}
+
+fn hotkey_sample_size() -> usize {
+    HOTKEY_SAMPLE_SIZE
+}
+
+fn hotkey_sample_rate() -> usize {
+    HOTKEY_SAMPLE_RATE
+}
+
+fn hotkey_ntop() -> usize {
+    HOTKEY_NTOP
+}
+
 // definitions
 #[derive(Serialize, Deserialize, Debug)]
 pub struct Seg {
     #[serde(default = "hash_power")]
     hash_power: u8,
+    #[serde(default = "max_hash_power")]
+    max_hash_power: u8,
     #[serde(default = "overflow_factor")]
     overflow_factor: f64,
     #[serde(default = "heap_size")]
     heap_size: usize,
     #[serde(default = "segment_size")]
     segment_size: i32,
+    #[serde(default = "item_size")]
+    item_size: Option<usize>,
     #[serde(default = "eviction")]
     eviction: Eviction,
     #[serde(default = "merge_target")]
@@ -96,20 +252,153 @@ pub struct Seg {
     compact_target: usize,
     #[serde(default = "datapool_path")]
     datapool_path: Option<String>,
+    #[serde(default = "numa_node")]
+    numa_node: Option<usize>,
+    #[serde(default = "huge_pages")]
+    huge_pages: HugePages,
+    #[serde(default = "metadata_path")]
+    metadata_path: Option<String>,
+    #[serde(default = "flash_path")]
+    flash_path: Option<String>,
+    #[serde(default = "flash_size")]
+    flash_size: usize,
+    #[serde(default = "flash_node")]
+    flash_node: Option<usize>,
+    #[serde(default = "flash_age")]
+    flash_age: u32,
+    #[serde(default = "shards")]
+    shards: usize,
+    #[serde(default = "free_reserve")]
+    free_reserve: usize,
+    #[serde(default = "compact_threshold")]
+    compact_threshold: f64,
+    #[serde(default = "large_values")]
+    large_values: bool,
+    #[serde(default = "stale_grace")]
+    stale_grace: u32,
+    #[serde(default = "lease_ttl")]
+    lease_ttl: u32,
+    #[serde(default = "namespaces")]
+    namespaces: bool,
+    #[serde(default)]
+    exact_ttls: Vec<u32>,
+    #[serde(default = "admission_window")]
+    admission_window: Option<usize>,
+    #[serde(default = "admission_threshold")]
+    admission_threshold: u8,
+    #[serde(default = "mrc_keys")]
+    mrc_keys: Option<usize>,
+    #[serde(default = "compression_level")]
+    compression_level: Option<i32>,
+    #[serde(default = "compression_threshold")]
+    compression_threshold: usize,
+    #[serde(default = "hotkey_enable")]
+    hotkey_enable: bool,
+    #[serde(default = "hotkey_sample_size")]
+    hotkey_sample_size: usize,
+    #[serde(default = "hotkey_sample_rate")]
+    hotkey_sample_rate: usize,
+    #[serde(default = "hotkey_ntop")]
+    hotkey_ntop: usize,
+    #[serde(default)]
+    prefixes: Vec<String>,
+    #[serde(default)]
+    partitions: Vec<Partition>,
+}
+
+/// A named partition of the cache which holds the keys that start with its
+/// prefix in a heap of its own.
+#[derive(Clone, Debug, Serialize, Deserialize)]
+pub struct Partition {
+    name: String,
+    prefix: String,
+    #[serde(default = "heap_size")]
+    heap_size: usize,
+    #[serde(default)]
+    eviction: Option<Eviction>,
+    #[serde(default)]
+    hash_power: Option<u8>,
+    #[serde(default = "partition_shards")]
+    shards: usize,
+}
+
+fn partition_shards() -> usize {
+    SHARDS
+}
+
+impl Partition {
+    /// The name of the partition, which its stats are reported under and is
+    /// appended to the datapool, metadata, and flash paths of its shards.
+    pub fn name(&self) -> &str {
+        &self.name
+    }
+
+    /// Keys which start with this prefix are held by the partition. A key
+    /// belongs to the partition with the longest matching prefix.
+    pub fn prefix(&self) -> &[u8] {
+        self.prefix.as_bytes()
+    }
+
+    pub fn heap_size(&self) -> usize {
+        self.heap_size
+    }
+
+    /// The eviction policy of the partition, the one of the cache if not set.
+    pub fn eviction(&self) -> Option<Eviction> {
+        self.eviction
+    }
+
+    /// The hash power of the partition, the one of the cache if not set.
+    pub fn hash_power(&self) -> Option<u8> {
+        self.hash_power
+    }
+
+    /// The number of shards of the partition. Must be a power of two.
+    pub fn shards(&self) -> usize {
+        self.shards
+    }
 }
 
 impl Default for Seg {
     fn default() -> Self {
         Self {
             hash_power: hash_power(),
+            max_hash_power: max_hash_power(),
             overflow_factor: overflow_factor(),
             heap_size: heap_size(),
             segment_size: segment_size(),
+            item_size: item_size(),
             eviction: eviction(),
             merge_target: merge_target(),
             merge_max: merge_max(),
             compact_target: compact_target(),
             datapool_path: datapool_path(),
+            numa_node: numa_node(),
+            huge_pages: huge_pages(),
+            metadata_path: metadata_path(),
+            flash_path: flash_path(),
+            flash_size: flash_size(),
+            flash_node: flash_node(),
+            flash_age: flash_age(),
+            shards: shards(),
+            free_reserve: free_reserve(),
+            compact_threshold: compact_threshold(),
+            large_values: large_values(),
+            stale_grace: stale_grace(),
+            lease_ttl: lease_ttl(),
+            namespaces: namespaces(),
+            exact_ttls: Vec::new(),
+            admission_window: admission_window(),
+            admission_threshold: admission_threshold(),
+            mrc_keys: mrc_keys(),
+            compression_level: compression_level(),
+            compression_threshold: compression_threshold(),
+            hotkey_enable: hotkey_enable(),
+            hotkey_sample_size: hotkey_sample_size(),
+            hotkey_sample_rate: hotkey_sample_rate(),
+            hotkey_ntop: hotkey_ntop(),
+            prefixes: Vec::new(),
+            partitions: Vec::new(),
         }
     }
 }
@@ -120,6 +409,12 @@ impl Seg {
         self.hash_power
     }
 
+    /// The hash power the hashtable may grow to at runtime. Values which do
+    /// not exceed `hash_power` disable growth.
+    pub fn max_hash_power(&self) -> u8 {
+        self.max_hash_power
+    }
+
     pub fn overflow_factor(&self) -> f64 {
         self.overflow_factor
     }
@@ -132,6 +427,13 @@ impl Seg {
         self.segment_size
     }
 
+    /// The expected mean size of the key and value of an item. When set, the
+    /// hash power, the max hash power and the segment size are derived from it
+    /// and the heap size, in place of the configured ones.
+    pub fn item_size(&self) -> Option<usize> {
+        self.item_size
+    }
+
     pub fn eviction(&self) -> Eviction {
         self.eviction
     }
@@ -151,6 +453,173 @@ impl Seg {
     pub fn datapool_path(&self) -> Option<PathBuf> {
         self.datapool_path.as_ref().map(|v| Path::new(v).to_owned())
     }
+
+    /// The NUMA node to place the heap on when it is held in memory, which
+    /// should be the node of the core the storage thread is pinned to.
+    pub fn numa_node(&self) -> Option<usize> {
+        self.numa_node
+    }
+
+    /// The size of the pages which back the heap and the hashtable. Pages from
+    /// the hugetlb pool must be reserved on the host, and transparent huge
+    /// pages are used when there are not enough free.
+    pub fn huge_pages(&self) -> HugePages {
+        self.huge_pages
+    }
+
+    /// A file which the hashtable and segment metadata are saved to on a
+    /// graceful shutdown. On startup, the cache is restored from this file
+    /// and the datapool if they exist. Requires `datapool_path`.
+    pub fn metadata_path(&self) -> Option<PathBuf> {
+        self.metadata_path.as_ref().map(|v| Path::new(v).to_owned())
+    }
+
+    /// A file, typically on an NVMe drive, which holds a tier of segments
+    /// beneath the heap. Items evicted from the heap are moved here and are
+    /// moved back into the heap when read.
+    pub fn flash_path(&self) -> Option<PathBuf> {
+        self.flash_path.as_ref().map(|v| Path::new(v).to_owned())
+    }
+
+    /// The total bytes to use for the flash tier.
+    pub fn flash_size(&self) -> usize {
+        self.flash_size
+    }
+
+    /// A NUMA node, such as that of a CXL memory expander, on which to hold
+    /// the flash tier in memory when no flash path is set. The tier is not
+    /// restored along with the heap.
+    pub fn flash_node(&self) -> Option<usize> {
+        self.flash_node
+    }
+
+    /// The age in seconds past which merge eviction moves a segment into the
+    /// flash tier whole. Zero, the default, only moves the items which
+    /// eviction would drop.
+    pub fn flash_age(&self) -> u32 {
+        self.flash_age
+    }
+
+    /// The number of storage shards. When more than one shard is configured,
+    /// worker threads execute requests against the shards directly instead of
+    /// handing them off to a single storage thread. Must be a power of two.
+    pub fn shards(&self) -> usize {
+        self.shards
+    }
+
+    /// The number of free segments which are kept in reserve by evicting
+    /// between batches of requests, so that writes do not have to evict.
+    pub fn free_reserve(&self) -> usize {
+        self.free_reserve
+    }
+
+    /// The occupancy, as a fraction of the segment size, at or below which
+    /// adjacent segments are merged between batches of requests to free the
+    /// memory of overwritten and deleted items.
+    pub fn compact_threshold(&self) -> f64 {
+        self.compact_threshold
+    }
+
+    /// Whether values which are too large for a segment are stored as a series
+    /// of chunks instead of being rejected, so that the segment size can be
+    /// chosen for the typical item rather than the largest.
+    pub fn large_values(&self) -> bool {
+        self.large_values
+    }
+
+    /// The number of seconds expired items are kept for, during which they
+    /// are served as stale to meta gets while the one client which holds the
+    /// lease for the key recomputes them.
+    pub fn stale_grace(&self) -> u32 {
+        self.stale_grace
+    }
+
+    /// The number of seconds a lease to recompute an item is held for, if
+    /// the item is not stored in the meantime.
+    pub fn lease_ttl(&self) -> u32 {
+        self.lease_ttl
+    }
+
+    /// Whether items are stamped with a namespace generation, so that all of
+    /// the keys with a prefix can be invalidated at once by the `invalidate`
+    /// admin command.
+    pub fn namespaces(&self) -> bool {
+        self.namespaces
+    }
+
+    /// The TTLs in seconds which are each held in a ttl bucket of their own,
+    /// so that their items are kept for their full TTL and do not share
+    /// segments with items of other TTLs. Must match the ones the metadata
+    /// was saved with for a cache to be restored.
+    pub fn exact_ttls(&self) -> &[u32] {
+        &self.exact_ttls
+    }
+
+    /// The number of recent reads and writes over which the admission filter
+    /// tracks key frequency. When set, new keys which are not accessed often
+    /// enough are not stored while the heap is full.
+    pub fn admission_window(&self) -> Option<usize> {
+        self.admission_window
+    }
+
+    /// The number of accesses within the admission window which are required
+    /// for a new key to be stored while the heap is full.
+    pub fn admission_threshold(&self) -> u8 {
+        self.admission_threshold
+    }
+
+    /// The number of keys, sampled by their hash, which are tracked to
+    /// estimate the hit ratio at other heap sizes. The estimate is published
+    /// in the `mrc_hit_ratio_*` metrics. It is disabled when not set.
+    pub fn mrc_keys(&self) -> Option<usize> {
+        self.mrc_keys
+    }
+
+    /// The zstd compression level used to compress item values. Compression
+    /// is disabled when not set.
+    pub fn compression_level(&self) -> Option<i32> {
+        self.compression_level
+    }
+
+    /// The minimum size in bytes of a value for it to be compressed.
+    pub fn compression_threshold(&self) -> usize {
+        self.compression_threshold
+    }
+
+    /// Whether the keys of requests are sampled to find the hottest ones.
+    pub fn hotkey_enable(&self) -> bool {
+        self.hotkey_enable
+    }
+
+    /// The number of samples over which the counts of hot keys decay by half.
+    pub fn hotkey_sample_size(&self) -> usize {
+        self.hotkey_sample_size
+    }
+
+    /// One in this many requests is sampled.
+    pub fn hotkey_sample_rate(&self) -> usize {
+        self.hotkey_sample_rate
+    }
+
+    /// The number of hottest keys which are kept and reported.
+    pub fn hotkey_ntop(&self) -> usize {
+        self.hotkey_ntop
+    }
+
+    /// Key prefixes whose hits, misses, sets and live bytes are counted and
+    /// reported on their own. A key is counted against the longest of the
+    /// prefixes it starts with. No keys are counted when empty.
+    pub fn prefixes(&self) -> &[String] {
+        &self.prefixes
+    }
+
+    /// Partitions of the cache which each hold the keys with a prefix in a
+    /// heap of their own, so that tenants sharing the process do not evict
+    /// each other's items. The shared storage which is used for more than
+    /// one shard is also used whenever partitions are configured.
+    pub fn partitions(&self) -> &[Partition] {
+        &self.partitions
+    }
 }
 
 // trait definitions
@@ -4,9 +4,11 @@
 
 use crate::*;
 
+use common::signal::Tunables;
 use serde::{Deserialize, Serialize};
 
 use std::io::Read;
+use std::net::{AddrParseError, SocketAddr};
 
 // constants to define default values
 const DAEMONIZE: bool = false;
@@ -26,10 +28,41 @@ fn dlog_interval() -> usize {
     DLOG_INTERVAL
 }
 
+/// The protocol which is spoken on the server port.
+#[derive(Copy, Clone, Serialize, Deserialize, Debug, Default, PartialEq, Eq)]
+#[serde(rename_all = "snake_case")]
+pub enum Protocol {
+    #[default]
+    Memcache,
+    Http,
+    Resp,
+}
+
+/// Another address which the server accepts sessions on, along with the
+/// protocol which is spoken there. All of the listeners share the storage.
+#[derive(Clone, Serialize, Deserialize, Debug)]
+pub struct Listener {
+    host: String,
+    port: String,
+    protocol: Protocol,
+}
+
+impl Listener {
+    pub fn socket_addr(&self) -> Result<SocketAddr, AddrParseError> {
+        format!("{}:{}", self.host, self.port).parse()
+    }
+
+    pub fn protocol(&self) -> Protocol {
+        self.protocol
+    }
+}
+
 // struct definitions
 #[derive(Serialize, Deserialize, Debug)]
 pub struct SegcacheConfig {
     // top-level
+    #[serde(default)]
+    protocol: Protocol,
     #[serde(default = "daemonize")]
     daemonize: bool,
     #[serde(default = "pid_filename")]
@@ -51,6 +84,8 @@ pub struct SegcacheConfig {
     tls: Tls,
     #[serde(default)]
     seg: Seg,
+    #[serde(default)]
+    replication: Replication,
 
     // ccommon
     #[serde(default)]
@@ -63,16 +98,28 @@ pub struct SegcacheConfig {
     sockio: Sockio,
     #[serde(default)]
     tcp: Tcp,
+
+    // listeners besides the one for the server port
+    #[serde(default, rename = "listener")]
+    listeners: Vec<Listener>,
+
+    // the file the config was loaded from
+    #[serde(skip)]
+    file: Option<String>,
 }
 
 // implementation
 impl SegcacheConfig {
     pub fn load(file: &str) -> Result<Self, std::io::Error> {
+        let path = file;
         let mut file = std::fs::File::open(file)?;
         let mut content = String::new();
         file.read_to_string(&mut content)?;
-        match toml::from_str(&content) {
-            Ok(t) => Ok(t),
+        match toml::from_str::<Self>(&content) {
+            Ok(mut t) => {
+                t.file = Some(path.to_owned());
+                Ok(t)
+            }
             Err(e) => {
                 eprintln!("{e}");
                 Err(std::io::Error::new(
@@ -83,6 +130,20 @@ impl SegcacheConfig {
         }
     }
 
+    pub fn protocol(&self) -> Protocol {
+        self.protocol
+    }
+
+    pub fn set_protocol(&mut self, protocol: Protocol) {
+        self.protocol = protocol;
+    }
+
+    /// The listeners besides the one for the server port, each of which may
+    /// speak its own protocol.
+    pub fn listeners(&self) -> &[Listener] {
+        &self.listeners
+    }
+
     pub fn daemonize(&self) -> bool {
         self.daemonize
     }
@@ -95,6 +156,26 @@ impl SegcacheConfig {
         self.dlog_interval
     }
 
+    /// The file the config was loaded from, if any.
+    pub fn file(&self) -> Option<&str> {
+        self.file.as_deref()
+    }
+
+    /// Returns the options which may be changed while running by reloading
+    /// the config.
+    pub fn tunables(&self) -> Tunables {
+        Tunables {
+            timeout: self.worker.timeout(),
+            nevent: self.worker.nevent(),
+            poolsize: self.buf.poolsize(),
+            klog_sample: self.klog.sample(),
+            eviction: Some(self.seg.eviction()),
+            merge_target: self.seg.merge_target(),
+            merge_max: self.seg.merge_max(),
+            compact_target: self.seg.compact_target(),
+        }
+    }
+
     /// Prints the configuration
     pub fn print(&self) {
         let config_toml = self.render_config();
@@ -131,6 +212,12 @@ impl KlogConfig for SegcacheConfig {
     }
 }
 
+impl ReplicationConfig for SegcacheConfig {
+    fn replication(&self) -> &Replication {
+        &self.replication
+    }
+}
+
 impl SegConfig for SegcacheConfig {
     fn seg(&self) -> &Seg {
         &self.seg
@@ -182,6 +269,7 @@ impl WorkerConfig for SegcacheConfig {
 impl Default for SegcacheConfig {
     fn default() -> Self {
         Self {
+            protocol: Default::default(),
             daemonize: daemonize(),
             pid_filename: pid_filename(),
             dlog_interval: dlog_interval(),
@@ -191,6 +279,7 @@ impl Default for SegcacheConfig {
             worker: Default::default(),
             time: Default::default(),
             seg: Default::default(),
+            replication: Default::default(),
 
             buf: Default::default(),
             debug: Default::default(),
@@ -199,6 +288,10 @@ impl Default for SegcacheConfig {
             tcp: Default::default(),
             #[cfg(feature = "boringssl")]
             tls: Default::default(),
+
+            listeners: Vec::new(),
+
+            file: None,
         }
     }
 }
@@ -11,6 +11,12 @@ const SERVER_HOST: &str = "0.0.0.0";
 const SERVER_PORT: &str = "12321";
 const SERVER_TIMEOUT: usize = 100;
 const SERVER_NEVENT: usize = 1024;
+const SERVER_REUSEPORT: bool = false;
+const SERVER_SOCKET: Option<String> = None;
+const SERVER_UDP_PORT: Option<String> = None;
+const SERVER_UPGRADE_SOCKET: Option<String> = None;
+const SERVER_FASTOPEN: usize = 0;
+const SERVER_DEFER_ACCEPT: usize = 0;
 
 // helper functions
 fn host() -> String {
@@ -29,6 +35,30 @@ fn nevent() -> usize {
     SERVER_NEVENT
 }
 
+fn reuseport() -> bool {
+    SERVER_REUSEPORT
+}
+
+fn socket() -> Option<String> {
+    SERVER_SOCKET
+}
+
+fn udp_port() -> Option<String> {
+    SERVER_UDP_PORT
+}
+
+fn upgrade_socket() -> Option<String> {
+    SERVER_UPGRADE_SOCKET
+}
+
+fn fastopen() -> usize {
+    SERVER_FASTOPEN
+}
+
+fn defer_accept() -> usize {
+    SERVER_DEFER_ACCEPT
+}
+
 // definitions
 #[derive(Serialize, Deserialize, Debug)]
 pub struct Server {
@@ -40,6 +70,18 @@ pub struct Server {
     timeout: usize,
     #[serde(default = "nevent")]
     nevent: usize,
+    #[serde(default = "reuseport")]
+    reuseport: bool,
+    #[serde(default = "socket")]
+    socket: Option<String>,
+    #[serde(default = "udp_port")]
+    udp_port: Option<String>,
+    #[serde(default = "upgrade_socket")]
+    upgrade_socket: Option<String>,
+    #[serde(default = "fastopen")]
+    fastopen: usize,
+    #[serde(default = "defer_accept")]
+    defer_accept: usize,
 }
 
 // implementation
@@ -68,6 +110,56 @@ impl Server {
     pub fn nevent(&self) -> usize {
         self.nevent
     }
+
+    /// Whether each worker thread should bind its own listener with
+    /// `SO_REUSEPORT` and accept connections directly, instead of receiving
+    /// them from a listener thread. Only used by servers with shared storage.
+    pub fn reuseport(&self) -> bool {
+        self.reuseport
+    }
+
+    /// The path of a Unix domain socket to listen on instead of the host and
+    /// port, for clients on the same host such as a sidecar. Not supported
+    /// with tls or `reuseport`.
+    pub fn socket(&self) -> Option<&str> {
+        self.socket.as_deref()
+    }
+
+    /// The port to also serve requests from UDP datagrams on, along with the
+    /// host, for protocols which support it. Only requests which do not change
+    /// the storage are served over UDP. Disabled by default.
+    pub fn udp_port(&self) -> Option<&str> {
+        self.udp_port.as_deref()
+    }
+
+    /// Return the result of parsing the host and UDP port, if UDP is enabled
+    pub fn udp_addr(&self) -> Option<Result<SocketAddr, AddrParseError>> {
+        self.udp_port()
+            .map(|port| format!("{}:{}", self.host(), port).parse())
+    }
+
+    /// The path of a Unix domain socket where the process hands its listening
+    /// sockets to a newer process on an upgrade. A process started with an
+    /// older one listening on the path takes over its listeners and waits for
+    /// it to exit before restoring the storage it saved. Disabled by default.
+    pub fn upgrade_socket(&self) -> Option<&str> {
+        self.upgrade_socket.as_deref()
+    }
+
+    /// The length of the queue of pending TCP Fast Open requests, which lets
+    /// clients that connected before send their first request with the SYN.
+    /// Only supported on Linux. Disabled by default.
+    pub fn fastopen(&self) -> usize {
+        self.fastopen
+    }
+
+    /// The number of seconds to wait for the first data of a new connection
+    /// before it is accepted, so that the listener is not woken for clients
+    /// which are yet to send a request. Only supported on Linux. Disabled by
+    /// default.
+    pub fn defer_accept(&self) -> usize {
+        self.defer_accept
+    }
 }
 
 // trait implementations
@@ -78,6 +170,12 @@ impl Default for Server {
             port: port(),
             timeout: timeout(),
             nevent: nevent(),
+            reuseport: reuseport(),
+            socket: socket(),
+            udp_port: udp_port(),
+            upgrade_socket: upgrade_socket(),
+            fastopen: fastopen(),
+            defer_accept: defer_accept(),
         }
     }
 }
@@ -15,6 +15,10 @@ pub struct Tls {
     certificate: Option<String>,
     #[serde(default)]
     ca_file: Option<String>,
+    #[serde(default)]
+    ktls: bool,
+    #[serde(default)]
+    session_cache_size: Option<usize>,
 }
 
 // implementation
@@ -34,6 +38,14 @@ impl common::ssl::TlsConfig for Tls {
     fn ca_file(&self) -> Option<String> {
         self.ca_file.clone()
     }
+
+    fn ktls(&self) -> bool {
+        self.ktls
+    }
+
+    fn session_cache_size(&self) -> Option<usize> {
+        self.session_cache_size
+    }
 }
 
 // trait definitions
@@ -8,6 +8,21 @@ use serde::{Deserialize, Serialize};
 const WORKER_TIMEOUT: usize = 100;
 const WORKER_NEVENT: usize = 1024;
 const WORKER_THREADS: usize = 1;
+const WORKER_STORAGE_THREADS: usize = 1;
+const WORKER_SPIN: usize = 0;
+const WORKER_CORES: Vec<usize> = Vec::new();
+const WORKER_STORAGE_CORE: Option<usize> = None;
+const WORKER_LISTENER_CORE: Option<usize> = None;
+const WORKER_MAX_INFLIGHT: usize = 0;
+const WORKER_QUEUE_DEADLINE: usize = 0;
+const WORKER_CYCLES: bool = false;
+const WORKER_HOT_COPIES: usize = 0;
+const WORKER_SESSION_RATE: usize = 0;
+const WORKER_SESSION_BURST: usize = 0;
+const WORKER_CLIENT_RATE: usize = 0;
+const WORKER_CLIENT_BURST: usize = 0;
+const WORKER_STREAM_KEYS: usize = 0;
+const WORKER_STREAM_BUFFER: usize = 1024 * 1024;
 
 // helper functions
 fn timeout() -> usize {
@@ -22,6 +37,66 @@ fn threads() -> usize {
     WORKER_THREADS
 }
 
+fn storage_threads() -> usize {
+    WORKER_STORAGE_THREADS
+}
+
+fn spin() -> usize {
+    WORKER_SPIN
+}
+
+fn cores() -> Vec<usize> {
+    WORKER_CORES
+}
+
+fn storage_core() -> Option<usize> {
+    WORKER_STORAGE_CORE
+}
+
+fn listener_core() -> Option<usize> {
+    WORKER_LISTENER_CORE
+}
+
+fn max_inflight() -> usize {
+    WORKER_MAX_INFLIGHT
+}
+
+fn queue_deadline() -> usize {
+    WORKER_QUEUE_DEADLINE
+}
+
+fn cycles() -> bool {
+    WORKER_CYCLES
+}
+
+fn hot_copies() -> usize {
+    WORKER_HOT_COPIES
+}
+
+fn session_rate() -> usize {
+    WORKER_SESSION_RATE
+}
+
+fn session_burst() -> usize {
+    WORKER_SESSION_BURST
+}
+
+fn client_rate() -> usize {
+    WORKER_CLIENT_RATE
+}
+
+fn client_burst() -> usize {
+    WORKER_CLIENT_BURST
+}
+
+fn stream_keys() -> usize {
+    WORKER_STREAM_KEYS
+}
+
+fn stream_buffer() -> usize {
+    WORKER_STREAM_BUFFER
+}
+
 // definitions
 #[derive(Serialize, Deserialize, Debug)]
 pub struct Worker {
@@ -31,6 +106,36 @@ pub struct Worker {
     nevent: usize,
     #[serde(default = "threads")]
     threads: usize,
+    #[serde(default = "storage_threads")]
+    storage_threads: usize,
+    #[serde(default = "spin")]
+    spin: usize,
+    #[serde(default = "cores")]
+    cores: Vec<usize>,
+    #[serde(default = "storage_core")]
+    storage_core: Option<usize>,
+    #[serde(default = "listener_core")]
+    listener_core: Option<usize>,
+    #[serde(default = "max_inflight")]
+    max_inflight: usize,
+    #[serde(default = "queue_deadline")]
+    queue_deadline: usize,
+    #[serde(default = "cycles")]
+    cycles: bool,
+    #[serde(default = "hot_copies")]
+    hot_copies: usize,
+    #[serde(default = "session_rate")]
+    session_rate: usize,
+    #[serde(default = "session_burst")]
+    session_burst: usize,
+    #[serde(default = "client_rate")]
+    client_rate: usize,
+    #[serde(default = "client_burst")]
+    client_burst: usize,
+    #[serde(default = "stream_keys")]
+    stream_keys: usize,
+    #[serde(default = "stream_buffer")]
+    stream_buffer: usize,
 }
 
 // implementation
@@ -47,9 +152,125 @@ impl Worker {
         self.threads
     }
 
+    /// The number of storage threads used when there are multiple worker
+    /// threads. With more than one, the storage is split into one shard for
+    /// each storage thread and requests are routed to the thread which owns
+    /// the shard for their key. Must be a power of two.
+    pub fn storage_threads(&self) -> usize {
+        self.storage_threads
+    }
+
+    /// How long in microseconds the worker and storage threads keep polling
+    /// without blocking after their last event, before they block for up to
+    /// the timeout. Zero disables busy-polling.
+    pub fn spin(&self) -> usize {
+        self.spin
+    }
+
+    /// The cores to pin the worker threads to. Each worker thread is pinned to
+    /// the next core in the list, wrapping around if there are more threads
+    /// than cores. Worker threads are not pinned if the list is empty.
+    pub fn cores(&self) -> &[usize] {
+        &self.cores
+    }
+
+    /// The core to pin the storage thread to, if any.
+    pub fn storage_core(&self) -> Option<usize> {
+        self.storage_core
+    }
+
+    /// The core to pin the listener thread to, if any.
+    pub fn listener_core(&self) -> Option<usize> {
+        self.listener_core
+    }
+
+    /// The most requests which may be queued for or executing on the storage
+    /// threads at once, across all of the worker threads. Once reached, the
+    /// workers stop reading from their sessions until responses come back,
+    /// and new sessions are refused. Zero means there is no limit.
+    pub fn max_inflight(&self) -> usize {
+        self.max_inflight
+    }
+
+    /// How long in milliseconds a request may wait on the queue to the
+    /// storage threads. A request which has waited longer by the time the
+    /// storage thread takes it is answered with an error instead of being
+    /// executed, so that a backlog is shed rather than served late. Zero
+    /// means requests are always executed.
+    pub fn queue_deadline(&self) -> usize {
+        self.queue_deadline
+    }
+
+    /// Whether the CPU cycles spent parsing, executing and composing each
+    /// request are counted into per-command metrics. The cycles are read from
+    /// the timestamp counter where there is one, which costs a few tens of
+    /// cycles for each phase of each request.
+    pub fn cycles(&self) -> bool {
+        self.cycles
+    }
+
+    /// The most copies of the values of hot keys which each storage thread
+    /// keeps, from which the worker threads answer reads of those keys
+    /// without sending them to the storage thread. Keys are found hot by hot
+    /// key sampling, which must be enabled for any copies to be made. Zero
+    /// disables the copies.
+    pub fn hot_copies(&self) -> usize {
+        self.hot_copies
+    }
+
+    /// The most requests per second which the worker threads take from each
+    /// session. The requests of a session over its limit are left unread
+    /// until it has refilled, so that one session cannot take a worker from
+    /// the others. Zero means there is no limit.
+    pub fn session_rate(&self) -> usize {
+        self.session_rate
+    }
+
+    /// The most requests which a session may send at once while under its
+    /// rate limit. Zero means the burst is one second of the rate.
+    pub fn session_burst(&self) -> usize {
+        self.session_burst
+    }
+
+    /// The most requests per second which the worker threads take from all of
+    /// the sessions of each client, across all of the worker threads. Clients
+    /// are told apart by the IP address they connect from, and sessions over
+    /// unix sockets are not limited. Zero means there is no limit.
+    pub fn client_rate(&self) -> usize {
+        self.client_rate
+    }
+
+    /// The most requests which a client may send at once while under its rate
+    /// limit. Zero means the burst is one second of the rate.
+    pub fn client_burst(&self) -> usize {
+        self.client_burst
+    }
+
+    /// The most keys which are looked up together for a multi-key read, such
+    /// as a memcache `get` of many keys. A read of more keys is split into
+    /// chunks of up to this many keys, and the values for each chunk are
+    /// written to the session as soon as they and those of the chunks before
+    /// it are found, rather than once every key has been looked up. Zero
+    /// disables streaming.
+    pub fn stream_keys(&self) -> usize {
+        self.stream_keys
+    }
+
+    /// The most bytes which may be waiting to be written to a session before
+    /// the next chunk of a streamed read is looked up, which bounds the
+    /// memory taken by the response to a read of many keys. Zero means the
+    /// chunks are not held back.
+    pub fn stream_buffer(&self) -> usize {
+        self.stream_buffer
+    }
+
     pub fn set_threads(&mut self, threads: usize) {
         self.threads = threads
     }
+
+    pub fn set_storage_threads(&mut self, threads: usize) {
+        self.storage_threads = threads
+    }
 }
 
 // trait implementations
@@ -59,6 +280,21 @@ impl Default for Worker {
             timeout: timeout(),
             nevent: nevent(),
             threads: threads(),
+            storage_threads: storage_threads(),
+            spin: spin(),
+            cores: cores(),
+            storage_core: storage_core(),
+            listener_core: listener_core(),
+            max_inflight: max_inflight(),
+            queue_deadline: queue_deadline(),
+            cycles: cycles(),
+            hot_copies: hot_copies(),
+            session_rate: session_rate(),
+            session_burst: session_burst(),
+            client_rate: client_rate(),
+            client_burst: client_burst(),
+            stream_keys: stream_keys(),
+            stream_buffer: stream_buffer(),
         }
     }
 }
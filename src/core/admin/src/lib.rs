@@ -2,10 +2,11 @@
 // Licensed under the Apache License, Version 2.0
 // http://www.apache.org/licenses/LICENSE-2.0
 
-use common::signal::Signal;
+use common::signal::{Signal, Tunables};
 use common::ssl::tls_acceptor;
 use config::{AdminConfig, TlsConfig};
 use crossbeam_channel::Receiver;
+use entrystore::{HOTKEYS, PARTITIONS, PREFIXES, SEGMENT_SNAPSHOTS};
 use logger::*;
 use metriken::*;
 use pelikan_net::event::{Event, Source};
@@ -16,11 +17,12 @@ use slab::Slab;
 use std::collections::VecDeque;
 use std::io::{Error, ErrorKind, Result};
 use std::sync::Arc;
-use std::time::Duration;
-use std::time::UNIX_EPOCH;
+use std::time::{Duration, Instant};
 use switchboard::{Queues, Waker};
 use tiny_http::{Method, Request, Response};
 
+mod profile;
+
 #[metric(name = "admin_request_parse")]
 pub static ADMIN_REQUEST_PARSE: Counter = Counter::new();
 
@@ -90,6 +92,36 @@ pub static RU_NVCSW: Counter = Counter::new();
 #[metric(name = "ru_nivcsw")]
 pub static RU_NIVCSW: Counter = Counter::new();
 
+#[metric(
+    name = "memory_rss",
+    description = "current resident set size of the process in bytes"
+)]
+pub static MEMORY_RSS: Gauge = Gauge::new();
+
+#[metric(
+    name = "malloc_arena",
+    description = "bytes of memory the allocator holds in its arenas, other than mmap allocations"
+)]
+pub static MALLOC_ARENA: Gauge = Gauge::new();
+
+#[metric(
+    name = "malloc_mmap",
+    description = "bytes of memory the allocator holds in allocations made with mmap"
+)]
+pub static MALLOC_MMAP: Gauge = Gauge::new();
+
+#[metric(
+    name = "malloc_inuse",
+    description = "bytes of memory allocated from the allocator and not yet freed"
+)]
+pub static MALLOC_INUSE: Gauge = Gauge::new();
+
+#[metric(
+    name = "malloc_free",
+    description = "bytes of memory the allocator holds in its arenas but which are free"
+)]
+pub static MALLOC_FREE: Gauge = Gauge::new();
+
 #[metric(
     name = "admin_session_accept",
     description = "total number of attempts to accept a session"
@@ -120,8 +152,24 @@ pub static ADMIN_SESSION_CLOSE: Counter = Counter::new();
 )]
 pub static ADMIN_SESSION_CURR: Gauge = Gauge::new();
 
+#[metric(
+    name = "admin_reload",
+    description = "number of times the tunables were reloaded from the config"
+)]
+pub static ADMIN_RELOAD: Counter = Counter::new();
+
+#[metric(
+    name = "admin_reload_ex",
+    description = "number of times reloading the config failed"
+)]
+pub static ADMIN_RELOAD_EX: Counter = Counter::new();
+
 // consts
 
+// the longest the admin thread waits for storage threads to snapshot their
+// segments, which they do between batches of requests
+const SNAPSHOT_TIMEOUT: Duration = Duration::from_millis(500);
+
 const LISTENER_TOKEN: Token = Token(usize::MAX - 1);
 const WAKER_TOKEN: Token = Token(usize::MAX);
 
@@ -129,6 +177,10 @@ const KB: u64 = 1024; // one kilobyte in bytes
 const S: u64 = 1_000_000_000; // one second in nanoseconds
 const US: u64 = 1_000; // one microsecond in nanoseconds
 
+/// Loads the tunables from the config of the process, such as by reading its
+/// config file again.
+pub type Reloader = Box<dyn Fn() -> Result<Tunables> + Send>;
+
 // helper functions
 
 fn map_err(e: std::io::Error) -> Result<()> {
@@ -138,6 +190,39 @@ fn map_err(e: std::io::Error) -> Result<()> {
     }
 }
 
+/// Loads the tunables and applies them. Those which are process wide are set
+/// here, and the rest are sent to the sibling threads, which apply them
+/// between events.
+fn reload(reloader: &Option<Reloader>, signal_queue_tx: &mut Queues<Signal, ()>) -> AdminResponse {
+    let tunables = match reloader.as_ref().map(|reloader| reloader()) {
+        Some(Ok(tunables)) => tunables,
+        Some(Err(e)) => {
+            ADMIN_RELOAD_EX.increment();
+            error!("error reloading config: {}", e);
+            return AdminResponse::report(format!("SERVER_ERROR {e}\r\n"));
+        }
+        None => {
+            ADMIN_RELOAD_EX.increment();
+            return AdminResponse::report("SERVER_ERROR config is not reloadable\r\n".to_string());
+        }
+    };
+
+    ADMIN_RELOAD.increment();
+    info!("reloading config: {:?}", tunables);
+
+    session::set_buffer_pool_size(tunables.poolsize);
+
+    if tunables.klog_sample as i64 != KLOG_SAMPLE.value() && !set_klog_sample(tunables.klog_sample)
+    {
+        warn!("klog sample can only be changed while running when sampling by key or for the binary klog");
+    }
+
+    let _ = signal_queue_tx.try_send_all(Signal::Reload(Arc::new(tunables)));
+    let _ = signal_queue_tx.wake();
+
+    AdminResponse::Ok
+}
+
 pub struct Admin {
     /// A backlog of tokens that need to be handled
     backlog: VecDeque<Token>,
@@ -150,12 +235,18 @@ pub struct Admin {
     nevent: usize,
     /// The actual poll instantance
     poll: Poll,
+    /// How often the histograms are snapshotted for percentiles, and when the
+    /// next snapshot is due
+    snapshot_interval: Duration,
+    next_snapshot: Instant,
     /// The sessions which have been opened
     sessions: Slab<ServerSession<AdminRequestParser, AdminResponse, AdminRequest>>,
     /// A queue for receiving signals from the parent thread
     signal_queue_rx: Receiver<Signal>,
     /// A set of queues for sending signals to sibling threads
     signal_queue_tx: Queues<Signal, ()>,
+    /// Loads the tunables for a reload, if the config can be reloaded
+    reloader: Option<Reloader>,
     /// The timeout for each call to poll
     timeout: Duration,
     /// The version of the service
@@ -170,7 +261,9 @@ pub struct AdminBuilder {
     listener: pelikan_net::Listener,
     nevent: usize,
     poll: Poll,
+    reloader: Option<Reloader>,
     sessions: Slab<ServerSession<AdminRequestParser, AdminResponse, AdminRequest>>,
+    snapshot_interval: Duration,
     timeout: Duration,
     version: String,
     waker: Arc<Waker>,
@@ -202,6 +295,7 @@ impl AdminBuilder {
 
         let nevent = config.nevent();
         let timeout = Duration::from_millis(config.timeout() as u64);
+        let snapshot_interval = Duration::from_millis(config.snapshot_interval() as u64);
 
         let sessions = Slab::new();
 
@@ -227,7 +321,9 @@ impl AdminBuilder {
             listener,
             nevent,
             poll,
+            reloader: None,
             sessions,
+            snapshot_interval,
             timeout,
             version,
             waker,
@@ -238,6 +334,12 @@ impl AdminBuilder {
         self.version = version.to_string();
     }
 
+    /// Enables the `reload` command, which applies the tunables returned by
+    /// the reloader to the running process.
+    pub fn reloader(&mut self, reloader: Reloader) {
+        self.reloader = Some(reloader);
+    }
+
     pub fn waker(&self) -> Arc<Waker> {
         self.waker.clone()
     }
@@ -255,6 +357,9 @@ impl AdminBuilder {
             log_drain,
             nevent: self.nevent,
             poll: self.poll,
+            reloader: self.reloader,
+            snapshot_interval: self.snapshot_interval,
+            next_snapshot: Instant::now() + self.snapshot_interval,
             sessions: self.sessions,
             signal_queue_rx,
             signal_queue_tx,
@@ -311,6 +416,32 @@ fn get_rusage() {
     }
 }
 
+/// Updates the resident set size and, with glibc, the statistics of the
+/// allocator. Together with the gauges of the memory held by the storage,
+/// the session buffers and the queues between threads, these account for
+/// the memory of the process beyond the size of the heap.
+fn get_memory() {
+    // the second field is the number of resident pages
+    #[cfg(target_os = "linux")]
+    if let Some(pages) = std::fs::read_to_string("/proc/self/statm")
+        .ok()
+        .and_then(|statm| statm.split_whitespace().nth(1)?.parse::<i64>().ok())
+    {
+        let page_size = unsafe { libc::sysconf(libc::_SC_PAGESIZE) } as i64;
+        MEMORY_RSS.set(pages * page_size);
+    }
+
+    #[cfg(all(target_os = "linux", target_env = "gnu"))]
+    {
+        // SAFETY: mallinfo2 only reads the state of the allocator
+        let info = unsafe { libc::mallinfo2() };
+        MALLOC_ARENA.set(info.arena as _);
+        MALLOC_MMAP.set(info.hblkhd as _);
+        MALLOC_INUSE.set((info.uordblks + info.hblkhd) as _);
+        MALLOC_FREE.set(info.fordblks as _);
+    }
+}
+
 impl Admin {
     /// Call accept one time
     fn accept(&mut self) {
@@ -372,12 +503,35 @@ impl Admin {
                         let _ = self.signal_queue_tx.try_send_all(Signal::FlushAll);
                         session.send(AdminResponse::Ok)?;
                     }
+                    AdminRequest::Invalidate(prefix) => {
+                        let _ = self
+                            .signal_queue_tx
+                            .try_send_all(Signal::Invalidate(prefix.into()));
+                        session.send(AdminResponse::Ok)?;
+                    }
+                    AdminRequest::Reload => {
+                        let response = reload(&self.reloader, &mut self.signal_queue_tx);
+                        session.send(response)?;
+                    }
                     AdminRequest::Quit => {
                         return Err(Error::new(ErrorKind::Other, "should hangup"));
                     }
                     AdminRequest::Stats => {
                         session.send(AdminResponse::Stats)?;
                     }
+                    AdminRequest::StatsSegments => {
+                        let report = SEGMENT_SNAPSHOTS.report(SNAPSHOT_TIMEOUT);
+                        session.send(AdminResponse::report(report))?;
+                    }
+                    AdminRequest::StatsHotkeys => {
+                        session.send(AdminResponse::report(HOTKEYS.report()))?;
+                    }
+                    AdminRequest::StatsPartitions => {
+                        session.send(AdminResponse::report(PARTITIONS.report()))?;
+                    }
+                    AdminRequest::StatsPrefixes => {
+                        session.send(AdminResponse::report(PREFIXES.report()))?;
+                    }
                     AdminRequest::Version => {
                         session.send(AdminResponse::version(self.version.clone()))?;
                     }
@@ -530,6 +684,58 @@ impl Admin {
                     let _ = request.respond(Response::empty(400));
                 }
             },
+            // the state of the segments of segcache storage, in the same
+            // format as `stats segments` on the admin port
+            "/segments" => match request.method() {
+                Method::Get => {
+                    let report = SEGMENT_SNAPSHOTS.report(SNAPSHOT_TIMEOUT);
+                    let _ = request.respond(Response::from_string(report));
+                }
+                _ => {
+                    let _ = request.respond(Response::empty(400));
+                }
+            },
+            // the hottest keys sampled by segcache storage, in the same format
+            // as `stats hotkeys` on the admin port
+            "/hotkeys" => match request.method() {
+                Method::Get => {
+                    let _ = request.respond(Response::from_string(HOTKEYS.report()));
+                }
+                _ => {
+                    let _ = request.respond(Response::empty(400));
+                }
+            },
+            // the counters of each partition of segcache storage, in the same
+            // format as `stats partitions` on the admin port
+            "/partitions" => match request.method() {
+                Method::Get => {
+                    let _ = request.respond(Response::from_string(PARTITIONS.report()));
+                }
+                _ => {
+                    let _ = request.respond(Response::empty(400));
+                }
+            },
+            // the counters of each key prefix of segcache storage, in the same
+            // format as `stats prefixes` on the admin port
+            "/prefixes" => match request.method() {
+                Method::Get => {
+                    let _ = request.respond(Response::from_string(PREFIXES.report()));
+                }
+                _ => {
+                    let _ = request.respond(Response::empty(400));
+                }
+            },
+            // a cpu profile of the process, sampled for a bounded time on a
+            // thread of its own, which responds once it is done
+            "/profile" => match request.method() {
+                Method::Get => {
+                    let query = parts.get(1).copied().unwrap_or("").to_string();
+                    profile::profile(request, &query);
+                }
+                _ => {
+                    let _ = request.respond(Response::empty(400));
+                }
+            },
             _ => {
                 let _ = request.respond(Response::empty(404));
             }
@@ -552,6 +758,15 @@ impl Admin {
 
             get_rusage();
 
+            // histograms are snapshotted on the admin thread, between its
+            // events, so that rendering stats never waits on a snapshot
+            let now = Instant::now();
+            if now >= self.next_snapshot {
+                get_memory();
+                SNAPSHOTS.write().update();
+                self.next_snapshot = now + self.snapshot_interval;
+            }
+
             if self.poll.poll(&mut events, Some(self.timeout)).is_err() {
                 error!("Error polling");
             }
@@ -589,7 +804,7 @@ impl Admin {
             // handle all signals
             while let Ok(signal) = self.signal_queue_rx.try_recv() {
                 match signal {
-                    Signal::FlushAll => {}
+                    Signal::FlushAll | Signal::Invalidate(_) | Signal::Reload(_) => {}
                     Signal::Shutdown => {
                         // if a shutdown is received from any
                         // thread, we will broadcast it to all
@@ -629,8 +844,7 @@ impl Admin {
 /// get_key_miss: 0
 /// ```
 pub fn human_stats() -> String {
-    let data = human_formatted_stats();
-    data.join("\n") + "\n"
+    with_stats(StatsFormat::Human, str::to_owned)
 }
 
 /// JSON stats output which follows the conventions found in Finagle and
@@ -643,9 +857,7 @@ pub fn human_stats() -> String {
 /// {"get": 0,"get_cardinality_p25": 0,"get_cardinality_p50": 0, ... }
 /// ```
 pub fn json_stats() -> String {
-    let data = human_formatted_stats();
-
-    "{".to_string() + &data.join(",") + "}"
+    with_stats(StatsFormat::Json, str::to_owned)
 }
 
 /// Prometheus / OpenTelemetry compatible stats output. Each stat is
@@ -679,103 +891,7 @@ pub fn json_stats() -> String {
 /// get_key_miss 0
 /// ```
 pub fn prometheus_stats() -> String {
-    let mut data = Vec::new();
-
-    let snapshots = SNAPSHOTS.read();
-
-    let timestamp = snapshots
-        .timestamp()
-        .duration_since(UNIX_EPOCH)
-        .unwrap()
-        .as_millis();
-
-    for metric in &metriken::metrics() {
-        let any = match metric.as_any() {
-            Some(any) => any,
-            None => {
-                continue;
-            }
-        };
-
-        let name = metric.name();
-
-        if let Some(counter) = any.downcast_ref::<Counter>() {
-            if metric.metadata().is_empty() {
-                data.push(format!(
-                    "# TYPE {name}_total counter\n{name}_total {}",
-                    counter.value()
-                ));
-            } else {
-                data.push(format!(
-                    "# TYPE {name} counter\n{} {}",
-                    metric.formatted(metriken::Format::Prometheus),
-                    counter.value()
-                ));
-            }
-        } else if let Some(gauge) = any.downcast_ref::<Gauge>() {
-            data.push(format!(
-                "# TYPE {name} gauge\n{} {}",
-                metric.formatted(metriken::Format::Prometheus),
-                gauge.value()
-            ));
-        } else if any.downcast_ref::<AtomicHistogram>().is_some()
-            || any.downcast_ref::<RwLockHistogram>().is_some()
-        {
-            for (_label, percentile, value) in snapshots.percentiles(metric.name()) {
-                data.push(format!(
-                    "# TYPE {name} gauge\n{name}{{percentile=\"{:02}\"}} {value} {timestamp}",
-                    percentile,
-                ));
-            }
-        }
-    }
-
-    data.sort();
-    data.dedup();
-    let mut content = data.join("\n");
-    content += "\n";
-    let parts: Vec<&str> = content.split('/').collect();
-    parts.join("_")
-}
-
-// human formatted stats that can be exposed as human stats or converted to json
-fn human_formatted_stats() -> Vec<String> {
-    let mut data = Vec::new();
-
-    let snapshots = SNAPSHOTS.read();
-
-    for metric in &metriken::metrics() {
-        let any = match metric.as_any() {
-            Some(any) => any,
-            None => {
-                continue;
-            }
-        };
-
-        let name = metric.name();
-
-        if let Some(counter) = any.downcast_ref::<Counter>() {
-            let value = counter.value();
-
-            data.push(format!("\"{name}\": {value}"));
-        } else if let Some(gauge) = any.downcast_ref::<Gauge>() {
-            let value = gauge.value();
-
-            data.push(format!("\"{name}\": {value}"));
-        } else if any.downcast_ref::<AtomicHistogram>().is_some()
-            || any.downcast_ref::<RwLockHistogram>().is_some()
-        {
-            let percentiles = snapshots.percentiles(metric.name());
-
-            for (label, _percentile, value) in percentiles {
-                data.push(format!("\"{name}/{label}\": {value}",));
-            }
-        }
-    }
-
-    data.sort();
-
-    data
+    with_stats(StatsFormat::Prometheus, str::to_owned)
 }
 
 common::metrics::test_no_duplicates!();
@@ -0,0 +1,184 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! CPU profiles of the process taken on demand over the admin http server.
+//!
+//! A profile samples the stacks of all threads from a `SIGPROF` timer for a
+//! bounded number of seconds at a low frequency, and is returned as folded
+//! stacks, one line per stack with its samples, or as a protobuf which the
+//! `pprof` tool reads. The profile runs on a thread of its own, so that the
+//! admin thread keeps serving while it is taken, and only one profile is
+//! taken at a time, as the sampling timer is shared by the whole process.
+
+use pprof::protos::Message;
+use pprof::ProfilerGuardBuilder;
+use std::fmt::Write;
+use std::sync::atomic::{AtomicBool, Ordering};
+use tiny_http::Header;
+
+use super::*;
+
+#[metric(
+    name = "admin_profile",
+    description = "number of cpu profiles taken from the admin http server"
+)]
+pub static ADMIN_PROFILE: Counter = Counter::new();
+
+#[metric(
+    name = "admin_profile_ex",
+    description = "number of cpu profiles which were refused or failed"
+)]
+pub static ADMIN_PROFILE_EX: Counter = Counter::new();
+
+// the length and sampling frequency of a profile when the request does not
+// give them, and the most which may be asked for
+const PROFILE_SECONDS: u64 = 10;
+const PROFILE_MAX_SECONDS: u64 = 60;
+const PROFILE_FREQUENCY: i32 = 99;
+const PROFILE_MAX_FREQUENCY: i32 = 499;
+
+// frames of these libraries are not unwound, as unwinding through them from
+// a signal handler is not safe
+const PROFILE_BLOCKLIST: &[&str] = &["libc", "libgcc", "pthread", "vdso"];
+
+// set while a profile is being taken
+static PROFILING: AtomicBool = AtomicBool::new(false);
+
+/// The format a profile is returned in.
+#[derive(Copy, Clone, PartialEq, Eq)]
+enum Format {
+    Folded,
+    Pprof,
+}
+
+/// Takes a profile as asked for by the query of a request to `/profile`, and
+/// responds with it once it is done. Accepts `seconds`, `frequency` in hertz,
+/// and `format`, which is either `folded` or `pprof`.
+pub fn profile(request: Request, query: &str) {
+    let mut seconds = PROFILE_SECONDS;
+    let mut frequency = PROFILE_FREQUENCY;
+    let mut format = Format::Folded;
+
+    for (name, value) in query.split('&').filter_map(|param| param.split_once('=')) {
+        let valid = match name {
+            "seconds" => value
+                .parse()
+                .ok()
+                .filter(|s| (1..=PROFILE_MAX_SECONDS).contains(s))
+                .map(|s| seconds = s)
+                .is_some(),
+            "frequency" => value
+                .parse()
+                .ok()
+                .filter(|f| (1..=PROFILE_MAX_FREQUENCY).contains(f))
+                .map(|f| frequency = f)
+                .is_some(),
+            "format" => match value {
+                "folded" => {
+                    format = Format::Folded;
+                    true
+                }
+                "pprof" => {
+                    format = Format::Pprof;
+                    true
+                }
+                _ => false,
+            },
+            _ => true,
+        };
+
+        if !valid {
+            ADMIN_PROFILE_EX.increment();
+            let _ = request.respond(Response::empty(400));
+            return;
+        }
+    }
+
+    if PROFILING.swap(true, Ordering::AcqRel) {
+        ADMIN_PROFILE_EX.increment();
+        let _ = request
+            .respond(Response::from_string("a profile is already running").with_status_code(409));
+        return;
+    }
+
+    let spawned = std::thread::Builder::new()
+        .name("pelikan_profile".to_string())
+        .spawn(move || {
+            let result = take(Duration::from_secs(seconds), frequency, format);
+            PROFILING.store(false, Ordering::Release);
+
+            match result {
+                Ok(body) => {
+                    ADMIN_PROFILE.increment();
+                    let content_type = match format {
+                        Format::Folded => &b"text/plain"[..],
+                        Format::Pprof => &b"application/octet-stream"[..],
+                    };
+                    let mut response = Response::from_data(body);
+                    if let Ok(header) = Header::from_bytes(&b"Content-Type"[..], content_type) {
+                        response = response.with_header(header);
+                    }
+                    let _ = request.respond(response);
+                }
+                Err(e) => {
+                    ADMIN_PROFILE_EX.increment();
+                    error!("error taking cpu profile: {}", e);
+                    let _ = request.respond(Response::empty(500));
+                }
+            }
+        });
+
+    if let Err(e) = spawned {
+        PROFILING.store(false, Ordering::Release);
+        ADMIN_PROFILE_EX.increment();
+        error!("error starting cpu profile thread: {}", e);
+    }
+}
+
+/// Samples the stacks of the process for the duration, returning the
+/// profile in the format.
+fn take(duration: Duration, frequency: i32, format: Format) -> Result<Vec<u8>> {
+    let other = |e: pprof::Error| Error::new(ErrorKind::Other, e.to_string());
+
+    info!(
+        "taking cpu profile for {}s at {}Hz",
+        duration.as_secs(),
+        frequency
+    );
+
+    let guard = ProfilerGuardBuilder::default()
+        .frequency(frequency)
+        .blocklist(PROFILE_BLOCKLIST)
+        .build()
+        .map_err(other)?;
+    std::thread::sleep(duration);
+    let report = guard.report().build().map_err(other)?;
+
+    match format {
+        Format::Folded => {
+            let mut folded = String::new();
+            for (frames, count) in report.data.iter() {
+                let _ = write!(folded, "{}", frames.thread_name);
+                // frames are held with the innermost first, and folded
+                // stacks start from the outermost
+                for frame in frames.frames.iter().rev() {
+                    for symbol in frame.iter().rev() {
+                        let _ = write!(folded, ";{}", symbol.name());
+                    }
+                }
+                let _ = writeln!(folded, " {count}");
+            }
+            Ok(folded.into_bytes())
+        }
+        Format::Pprof => {
+            let mut body = Vec::new();
+            report
+                .pprof()
+                .map_err(other)?
+                .write_to_vec(&mut body)
+                .map_err(|e| Error::new(ErrorKind::Other, e.to_string()))?;
+            Ok(body)
+        }
+    }
+}
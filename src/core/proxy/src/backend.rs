@@ -3,10 +3,14 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use super::map_result;
+use crate::hedge::HedgeDelay;
+use crate::ring::Ring;
 use crate::*;
 use session::ClientSession;
 use std::collections::HashMap;
+use std::collections::HashSet;
 use std::collections::VecDeque;
+use std::net::SocketAddr;
 
 #[metric(
     name = "backend_event_depth",
@@ -50,12 +54,124 @@ pub static BACKEND_EVENT_TOTAL: Counter = Counter::new();
 )]
 pub static BACKEND_EVENT_WRITE: Counter = Counter::new();
 
+#[metric(
+    name = "backend_backlog",
+    description = "the number of requests which waited in the backlog for a connection"
+)]
+pub static BACKEND_BACKLOG: Counter = Counter::new();
+
+#[metric(
+    name = "backend_backlog_wait",
+    description = "distribution of the time in nanoseconds that requests waited in the backlog"
+)]
+pub static BACKEND_BACKLOG_WAIT: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "backend_pipeline_depth",
+    description = "distribution of the number of requests in flight on a connection as each is sent"
+)]
+pub static BACKEND_PIPELINE_DEPTH: AtomicHistogram = AtomicHistogram::new(7, 17);
+
+#[metric(
+    name = "backend_fan_out",
+    description = "the number of requests which were split across more than one shard"
+)]
+pub static BACKEND_FAN_OUT: Counter = Counter::new();
+
+#[metric(
+    name = "backend_ring_rebuild",
+    description = "the number of times a shard was ejected or restored and the distribution rebuilt"
+)]
+pub static BACKEND_RING_REBUILD: Counter = Counter::new();
+
+#[metric(
+    name = "backend_hedge",
+    description = "the number of requests which were also sent on a second connection"
+)]
+pub static BACKEND_HEDGE: Counter = Counter::new();
+
+#[metric(
+    name = "backend_hedge_win",
+    description = "the number of hedged requests which were answered first on the second connection"
+)]
+pub static BACKEND_HEDGE_WIN: Counter = Counter::new();
+
+#[metric(
+    name = "backend_reconnect",
+    description = "the number of connections which were opened again after one was lost"
+)]
+pub static BACKEND_RECONNECT: Counter = Counter::new();
+
+#[metric(
+    name = "backend_spare",
+    description = "the number of lost connections which were replaced by a spare"
+)]
+pub static BACKEND_SPARE: Counter = Counter::new();
+
+/// The weight of each new latency in the moving average for a connection.
+const EWMA_WEIGHT: f64 = 0.1;
+
+/// The shortest and longest delay, in nanoseconds, before a lost connection
+/// is opened again. The delay doubles each time in a row that a connection to
+/// the endpoint is lost without having answered a request.
+const BACKOFF_MIN: u64 = 10_000_000;
+const BACKOFF_MAX: u64 = 1_000_000_000;
+
+/// What the response to a request in flight is for.
+enum Awaiting {
+    /// The request from a frontend session.
+    Request(Token),
+    /// One part of a request which was split across shards.
+    Part { fan_in: usize, index: usize },
+    /// A request which may be hedged, and whether this is the copy of it.
+    Hedged { hedge: usize, copy: bool },
+}
+
+/// A request which was split across shards, waiting for the responses to all
+/// of its parts.
+struct FanIn<Request, Response> {
+    request: Request,
+    fe_token: Token,
+    responses: Vec<Option<Response>>,
+    remaining: usize,
+    // a part was lost with the connection it was sent on
+    lost: bool,
+}
+
+/// A request which may be sent on a second connection if the first is slow
+/// to respond, and which is answered by whichever responds first.
+struct Hedge<Request> {
+    fe_token: Token,
+    // the copy of the request, until it is sent
+    copy: Option<Request>,
+    pool: Option<usize>,
+    // the connection the request was first sent on
+    first: Option<Token>,
+    // the number of connections the request is in flight on
+    outstanding: usize,
+    answered: bool,
+    // tells this hedge apart from later ones which reuse its slot
+    sequence: u64,
+}
+
 pub struct BackendWorkerBuilder<Parser, Request, Response> {
-    free_queue: VecDeque<Token>,
+    addrs: HashMap<Token, SocketAddr>,
+    connecting: HashSet<Token>,
+    connections: Vec<Vec<Token>>,
+    depth: usize,
+    hedge: bool,
     nevent: usize,
     parser: Parser,
     poll: Poll,
+    pools: HashMap<Token, usize>,
+    reconnects: Vec<(Instant, u64, usize, SocketAddr)>,
+    ring: Option<Ring>,
+    routes: HashMap<Vec<u8>, usize>,
+    selection: Selection,
     sessions: Slab<ClientSession<Parser, Request, Response>>,
+    shards: usize,
+    spares: Vec<Vec<Token>>,
+    targets: Vec<usize>,
     timeout: Duration,
     waker: Arc<Waker>,
 }
@@ -74,30 +190,101 @@ where
             pelikan_net::Waker::new(poll.registry(), WAKER_TOKEN).unwrap(),
         ));
 
+        let depth = config.pipeline_depth().max(1);
+        let hedge = config.hedge();
+        let selection = config.selection();
         let nevent = config.nevent();
         let timeout = Duration::from_millis(config.timeout() as u64);
 
+        // the connections are grouped into pools. when requests are spread by
+        // key, each default endpoint is a shard with a pool of its own, and
+        // otherwise the first pool holds the connections to all of them. each
+        // routed method has a pool of its own after these
+        let addrs = config.socket_addrs()?;
+        let (mut endpoints, mut ring) = match config.distribution() {
+            Distribution::None => (vec![addrs], None),
+            distribution => {
+                let names = addrs.iter().map(|addr| addr.to_string()).collect();
+                let ring = Ring::new(distribution, names, config.weights());
+                (
+                    addrs.into_iter().map(|addr| vec![addr]).collect(),
+                    Some(ring),
+                )
+            }
+        };
+        let shards = endpoints.len();
+        let mut routes = HashMap::new();
+        for (method, addrs) in config.routes()? {
+            routes.insert(method.into_bytes(), endpoints.len());
+            endpoints.push(addrs);
+        }
+
+        // each endpoint has `poolsize` connections which requests are sent on
+        // and `spares` connections which are kept open to replace them. a
+        // connection which can't be opened is tried again after a backoff
         let mut sessions = Slab::new();
-        let mut free_queue = VecDeque::new();
-
-        for endpoint in config.socket_addrs()? {
-            let stream = TcpStream::connect(endpoint)?;
-            let mut session = ClientSession::new(Session::from(stream), parser.clone());
-            let s = sessions.vacant_entry();
-            let interest = session.interest();
-            session
-                .register(poll.registry(), Token(s.key()), interest)
-                .expect("failed to register");
-            free_queue.push_back(Token(s.key()));
-            s.insert(session);
+        let mut addrs = HashMap::new();
+        let mut connecting = HashSet::new();
+        let mut connections = Vec::with_capacity(endpoints.len());
+        let mut spares = Vec::with_capacity(endpoints.len());
+        let mut targets = Vec::with_capacity(endpoints.len());
+        let mut pools = HashMap::new();
+        let mut reconnects = Vec::new();
+
+        for (pool, endpoint) in endpoints.iter().enumerate() {
+            let mut tokens = Vec::new();
+            let mut spare = Vec::new();
+            for (index, addr) in endpoint.iter().flat_map(|addr| {
+                std::iter::repeat(addr)
+                    .take(config.poolsize() + config.spares())
+                    .enumerate()
+            }) {
+                match open(&poll, &mut sessions, &parser, *addr) {
+                    Ok(token) => {
+                        addrs.insert(token, *addr);
+                        connecting.insert(token);
+                        pools.insert(token, pool);
+                        if index < config.poolsize() {
+                            tokens.push(token);
+                        } else {
+                            spare.push(token);
+                        }
+                    }
+                    Err(e) => {
+                        warn!("failed to connect to backend {}: {}", addr, e);
+                        reconnects.push((Instant::now(), BACKOFF_MIN, pool, *addr));
+                    }
+                }
+            }
+            // a shard which can't be reached is ejected until it is
+            if tokens.is_empty() && pool < shards {
+                if let Some(ring) = ring.as_mut() {
+                    ring.set_ejected(pool, true);
+                }
+            }
+            connections.push(tokens);
+            spares.push(spare);
+            targets.push(endpoint.len() * config.poolsize());
         }
 
         Ok(Self {
-            free_queue,
+            addrs,
+            connecting,
+            connections,
+            depth,
+            hedge,
             nevent,
             parser,
             poll,
+            pools,
+            reconnects,
+            ring,
+            routes,
+            selection,
             sessions,
+            shards,
+            spares,
+            targets,
             timeout,
             waker,
         })
@@ -113,15 +300,33 @@ where
         signal_queue: Queues<(), Signal>,
     ) -> BackendWorker<Parser, Request, Response> {
         BackendWorker {
+            addrs: self.addrs,
             backlog: VecDeque::new(),
+            backoff: HashMap::new(),
+            connecting: self.connecting,
+            connections: self.connections,
             data_queue,
-            free_queue: self.free_queue,
+            depth: self.depth,
+            ewma: HashMap::new(),
+            fan_ins: Slab::new(),
+            hedge: self.hedge.then(HedgeDelay::new),
+            hedges: Slab::new(),
+            hedge_sequence: 0,
+            hedging: VecDeque::new(),
             nevent: self.nevent,
             parser: self.parser,
             pending: HashMap::new(),
             poll: self.poll,
+            pools: self.pools,
+            reconnects: self.reconnects,
+            ring: self.ring,
+            routes: self.routes,
+            selection: self.selection,
             sessions: self.sessions,
+            shards: self.shards,
             signal_queue,
+            spares: self.spares,
+            targets: self.targets,
             timeout: self.timeout,
             waker: self.waker,
         }
@@ -129,15 +334,60 @@ where
 }
 
 pub struct BackendWorker<Parser, Request, Response> {
-    backlog: VecDeque<(Request, Token)>,
+    // the endpoint which each connection is to
+    addrs: HashMap<Token, SocketAddr>,
+    // requests waiting for a connection with room in its pipeline, along with
+    // the pool they wait on and the time they were added
+    backlog: VecDeque<(Request, Option<usize>, Awaiting, Instant)>,
+    // the delay, in nanoseconds, before a connection to each endpoint which
+    // has failed since it last answered a request is opened again
+    backoff: HashMap<SocketAddr, u64>,
+    // the connections which have been opened but are not yet established
+    connecting: HashSet<Token>,
+    // the connections in each pool which requests are sent on
+    connections: Vec<Vec<Token>>,
     data_queue: Queues<(Request, Response, Token), (Request, Token)>,
-    free_queue: VecDeque<Token>,
+    // the most requests in flight on one connection
+    depth: usize,
+    // the moving average of the latency of each connection, in nanoseconds
+    ewma: HashMap<Token, f64>,
+    // requests which were split across shards
+    fan_ins: Slab<FanIn<Request, Response>>,
+    // the delay after which requests are hedged, if hedging is enabled
+    hedge: Option<HedgeDelay>,
+    // requests which may be hedged
+    hedges: Slab<Hedge<Request>>,
+    hedge_sequence: u64,
+    // the time each request which may be hedged was sent, oldest first
+    hedging: VecDeque<(Instant, usize, u64)>,
     nevent: usize,
     parser: Parser,
-    pending: HashMap<Token, Token>,
+    // what each request in flight on each connection is for, and when it was
+    // sent, in the order they were sent
+    pending: HashMap<Token, VecDeque<(Instant, Awaiting)>>,
     poll: Poll,
+    // the pool which each connection belongs to
+    pools: HashMap<Token, usize>,
+    // the connections to be opened again, each with the time it was lost,
+    // the delay before it is opened, its pool, and its endpoint
+    reconnects: Vec<(Instant, u64, usize, SocketAddr)>,
+    // the distribution of keys across the shards, if requests are spread by
+    // key
+    ring: Option<Ring>,
+    // the pool which each routed method is sent to
+    routes: HashMap<Vec<u8>, usize>,
+    // how a connection is chosen from a pool
+    selection: Selection,
     sessions: Slab<ClientSession<Parser, Request, Response>>,
+    // the number of pools, from the first, which are shards of the default
+    // endpoints
+    shards: usize,
     signal_queue: Queues<(), Signal>,
+    // the connections in each pool which are kept open to replace one which
+    // is lost
+    spares: Vec<Vec<Token>>,
+    // the number of connections in each pool which requests are sent on
+    targets: Vec<usize>,
     timeout: Duration,
     waker: Arc<Waker>,
 }
@@ -145,17 +395,419 @@ pub struct BackendWorker<Parser, Request, Response> {
 impl<Parser, Request, Response> BackendWorker<Parser, Request, Response>
 where
     Parser: Parse<Response> + Clone,
-    Request: Compose,
+    Request: Compose + Correlate<Response> + Shard<Response>,
 {
+    /// Returns the pool of connections which the request is sent on, or
+    /// `None` if it may be sent on any of the shards.
+    fn pool(&self, request: &Request) -> Option<usize> {
+        let key = request.shard_key();
+        if let Some(pool) = key.and_then(|key| self.routes.get(key)) {
+            return Some(*pool);
+        }
+        match (&self.ring, key) {
+            (Some(ring), Some(key)) => Some(ring.shard(key)),
+            (Some(_), None) => None,
+            (None, _) => Some(0),
+        }
+    }
+
+    /// Returns the best connection in the pool, or in any of the shards, if
+    /// any has room in its pipeline.
+    fn connection(&self, pool: Option<usize>) -> Option<Token> {
+        self.select(pool, None)
+    }
+
+    /// Returns the best connection in the pool, or in any of the shards,
+    /// other than `except`, if any has room in its pipeline.
+    fn select(&self, pool: Option<usize>, except: Option<Token>) -> Option<Token> {
+        let pools = match pool {
+            Some(pool) => pool..(pool + 1),
+            None => 0..self.shards,
+        };
+        self.connections[pools]
+            .iter()
+            .flatten()
+            .filter(|token| Some(**token) != except && !self.connecting.contains(token))
+            .map(|token| (*token, self.sessions[token.0].in_flight()))
+            .filter(|(_, in_flight)| *in_flight < self.depth)
+            .min_by_key(|(token, in_flight)| self.cost(*token, *in_flight))
+            .map(|(token, _)| token)
+    }
+
+    /// The cost of sending one more request on the connection, which is
+    /// lowest for the best connection.
+    fn cost(&self, token: Token, in_flight: usize) -> u64 {
+        match self.selection {
+            Selection::LeastOutstanding => in_flight as u64,
+            // a connection which has not yet answered a request is assumed to
+            // be fast, so that every connection is tried
+            Selection::Ewma => {
+                let latency = self.ewma.get(&token).copied().unwrap_or(0.0).max(1.0);
+                (latency as u64).saturating_mul(in_flight as u64 + 1)
+            }
+        }
+    }
+
+    /// Sends the request from a frontend session. A request with keys on more
+    /// than one shard is split, and each part is sent to its own shard.
+    fn dispatch(&mut self, request: Request, fe_token: Token) {
+        let parts = self
+            .ring
+            .as_ref()
+            .and_then(|ring| request.split(&|key| ring.shard(key)));
+
+        if let Some(parts) = parts {
+            BACKEND_FAN_OUT.increment();
+            let fan_in = self.fan_ins.insert(FanIn {
+                request,
+                fe_token,
+                responses: parts.iter().map(|_| None).collect(),
+                remaining: parts.len(),
+                lost: false,
+            });
+            for (index, (shard, part)) in parts.into_iter().enumerate() {
+                self.send(part, Some(shard), Awaiting::Part { fan_in, index });
+            }
+            return;
+        }
+
+        let pool = self.pool(&request);
+
+        // requests are only hedged once there is a delay to hedge them after
+        let copy = match self.hedge.as_ref().and_then(|hedge| hedge.delay()) {
+            Some(_) => request.hedge(),
+            None => None,
+        };
+
+        if let Some(copy) = copy {
+            let sequence = self.hedge_sequence;
+            self.hedge_sequence += 1;
+            let hedge = self.hedges.insert(Hedge {
+                fe_token,
+                copy: Some(copy),
+                pool,
+                first: None,
+                outstanding: 1,
+                answered: false,
+                sequence,
+            });
+            self.hedging.push_back((Instant::now(), hedge, sequence));
+            let first = self.send(request, pool, Awaiting::Hedged { hedge, copy: false });
+            if let Some(state) = self.hedges.get_mut(hedge) {
+                state.first = first;
+            }
+        } else {
+            self.send(request, pool, Awaiting::Request(fe_token));
+        }
+    }
+
+    /// Sends the request on the best connection from its pool, returning the
+    /// connection, or adds it to the backlog if every connection has a full
+    /// pipeline.
+    fn send(&mut self, request: Request, pool: Option<usize>, awaiting: Awaiting) -> Option<Token> {
+        if let Some(be_token) = self.connection(pool) {
+            self.send_on(be_token, request, awaiting);
+            Some(be_token)
+        } else {
+            BACKEND_BACKLOG.increment();
+            self.backlog
+                .push_back((request, pool, awaiting, Instant::now()));
+            None
+        }
+    }
+
+    fn send_on(&mut self, be_token: Token, request: Request, awaiting: Awaiting) {
+        self.pending
+            .entry(be_token)
+            .or_default()
+            .push_back((Instant::now(), awaiting));
+
+        // a request which can't be sent is lost along with the connection
+        let session = &mut self.sessions[be_token.0];
+        if session.send(request).is_err() {
+            self.close(be_token);
+            return;
+        }
+        let _ = BACKEND_PIPELINE_DEPTH.increment(session.in_flight() as _);
+        if self.write(be_token).is_err() {
+            self.close(be_token);
+        }
+    }
+
+    /// Sends a copy of each request which has waited longer than the hedge
+    /// delay for a response, on another connection from its pool.
+    fn send_hedges(&mut self) {
+        let delay = match self.hedge.as_ref().and_then(|hedge| hedge.delay()) {
+            Some(delay) => delay,
+            None => return,
+        };
+
+        while let Some((sent, hedge, sequence)) = self.hedging.front() {
+            if (Instant::now() - *sent).as_nanos() < delay {
+                return;
+            }
+            let (hedge, sequence) = (*hedge, *sequence);
+            self.hedging.pop_front();
+
+            let state = match self.hedges.get_mut(hedge) {
+                Some(state) if state.sequence == sequence && !state.answered => state,
+                _ => continue,
+            };
+            let copy = match state.copy.take() {
+                Some(copy) => copy,
+                None => continue,
+            };
+            let (pool, first) = (state.pool, state.first);
+
+            if let Some(be_token) = self.select(pool, first) {
+                BACKEND_HEDGE.increment();
+                self.hedges[hedge].outstanding += 1;
+                self.send_on(be_token, copy, Awaiting::Hedged { hedge, copy: true });
+            } else if self.hedges[hedge].outstanding == 0 {
+                // the request was lost and there is nowhere to send the copy
+                self.hedges.remove(hedge);
+            }
+        }
+    }
+
+    /// The time to wait for events, which is cut short when a request is due
+    /// to be hedged or a connection is due to be opened again.
+    fn poll_timeout(&self) -> Duration {
+        let now = Instant::now();
+        let delay = self.hedge.as_ref().and_then(|hedge| hedge.delay());
+        let hedge = match (delay, self.hedging.front()) {
+            (Some(delay), Some((sent, _, _))) => {
+                Some(delay.saturating_sub((now - *sent).as_nanos()))
+            }
+            _ => None,
+        };
+        let reconnect = self
+            .reconnects
+            .iter()
+            .map(|(lost, delay, _, _)| delay.saturating_sub((now - *lost).as_nanos()))
+            .min();
+
+        match hedge.into_iter().chain(reconnect).min() {
+            Some(wait) => Duration::from_nanos(wait).min(self.timeout),
+            None => self.timeout,
+        }
+    }
+
+    /// Opens the connections which are due to be opened again.
+    fn reconnect(&mut self) {
+        let now = Instant::now();
+        let mut index = 0;
+        while index < self.reconnects.len() {
+            let (lost, delay, pool, addr) = self.reconnects[index];
+            if (now - lost).as_nanos() < delay {
+                index += 1;
+                continue;
+            }
+            self.reconnects.swap_remove(index);
+
+            BACKEND_RECONNECT.increment();
+            match open(&self.poll, &mut self.sessions, &self.parser, addr) {
+                Ok(token) => {
+                    self.addrs.insert(token, addr);
+                    self.connecting.insert(token);
+                    self.pools.insert(token, pool);
+                    if self.connections[pool].len() < self.targets[pool] {
+                        self.connections[pool].push(token);
+                    } else {
+                        self.spares[pool].push(token);
+                    }
+                }
+                Err(e) => {
+                    warn!("failed to connect to backend {}: {}", addr, e);
+                    self.retry(pool, addr);
+                }
+            }
+        }
+    }
+
+    /// Opens a connection to the endpoint again after a backoff.
+    fn retry(&mut self, pool: usize, addr: SocketAddr) {
+        let backoff = self.backoff.entry(addr).or_insert(0);
+        *backoff = (*backoff * 2).clamp(BACKOFF_MIN, BACKOFF_MAX);
+        self.reconnects.push((Instant::now(), *backoff, pool, addr));
+    }
+
+    /// Starts sending requests on a connection once it is established. A
+    /// connection to a shard which was ejected is a probe of its health, and
+    /// the shard is returned to the distribution once the probe succeeds.
+    fn establish(&mut self, token: Token) {
+        if !self.connecting.contains(&token) || !self.sessions[token.0].is_established() {
+            return;
+        }
+        self.connecting.remove(&token);
+
+        let pool = self.pools[&token];
+        if pool < self.shards {
+            if let Some(ring) = self.ring.as_mut() {
+                if ring.set_ejected(pool, false) {
+                    info!("restoring backend shard: {}", pool);
+                    BACKEND_RING_REBUILD.increment();
+                }
+            }
+        }
+
+        self.drain_backlog(pool);
+    }
+
+    /// Sends the oldest requests in the backlog which wait on the pool, for as
+    /// long as it has a connection with room in its pipeline.
+    fn drain_backlog(&mut self, pool: usize) {
+        while self.connection(Some(pool)).is_some() {
+            let index = match self.backlog.iter().position(|(_, p, _, _)| match p {
+                Some(p) => *p == pool,
+                None => pool < self.shards,
+            }) {
+                Some(index) => index,
+                None => return,
+            };
+            let (request, _, awaiting, queued) = self.backlog.remove(index).unwrap();
+            let _ = BACKEND_BACKLOG_WAIT.increment((Instant::now() - queued).as_nanos());
+            self.send(request, Some(pool), awaiting);
+        }
+    }
+
+    /// Passes the response back to the frontend, once every part of a request
+    /// which was split has been answered.
+    fn respond(&mut self, awaiting: Awaiting, request: Request, response: Response) -> Result<()> {
+        let (request, response, fe_token) = match awaiting {
+            Awaiting::Request(fe_token) => (request, response, fe_token),
+            Awaiting::Part { fan_in, index } => {
+                let state = &mut self.fan_ins[fan_in];
+                state.responses[index] = Some(response);
+                state.remaining -= 1;
+                if state.remaining > 0 {
+                    return Ok(());
+                }
+
+                let state = self.fan_ins.remove(fan_in);
+                if state.lost {
+                    return Ok(());
+                }
+                let responses = state.responses.into_iter().flatten().collect();
+                let ring = self.ring.as_ref().expect("split without a ring");
+                let response = state.request.merge(responses, &|key| ring.shard(key));
+                (state.request, response, state.fe_token)
+            }
+            Awaiting::Hedged { hedge, copy } => {
+                let state = &mut self.hedges[hedge];
+                state.outstanding -= 1;
+                let first = !state.answered;
+                state.answered = true;
+                let fe_token = state.fe_token;
+                if state.outstanding == 0 {
+                    self.hedges.remove(hedge);
+                }
+
+                // only the first response is passed back
+                if !first {
+                    return Ok(());
+                }
+                if copy {
+                    BACKEND_HEDGE_WIN.increment();
+                }
+                (request, response, fe_token)
+            }
+        };
+
+        self.data_queue
+            .try_send_to(0, (request, response, fe_token))
+            .map_err(|_| Error::new(ErrorKind::Other, "data queue is full"))
+    }
+
     /// Return the `Session` to the `Listener` to handle flush/close
     fn close(&mut self, token: Token) {
-        if self.sessions.contains(token.0) {
-            let mut session = self.sessions.remove(token.0);
-            let _ = session.flush();
+        if !self.sessions.contains(token.0) {
+            return;
+        }
+        let mut session = self.sessions.remove(token.0);
+        let _ = session.flush();
+
+        // a request which was split is lost along with any of its parts, and
+        // is dropped once the rest of them have been answered
+        //
+        // a request which may be hedged is only lost once it is lost on every
+        // connection and its copy has been sent, as until then the copy may
+        // still be sent on another connection
+        self.ewma.remove(&token);
+        for (_, awaiting) in self.pending.remove(&token).unwrap_or_default() {
+            match awaiting {
+                Awaiting::Part { fan_in, .. } => {
+                    let state = &mut self.fan_ins[fan_in];
+                    state.lost = true;
+                    state.remaining -= 1;
+                    if state.remaining == 0 {
+                        self.fan_ins.remove(fan_in);
+                    }
+                }
+                Awaiting::Hedged { hedge, .. } => {
+                    let state = &mut self.hedges[hedge];
+                    state.outstanding -= 1;
+                    if state.outstanding == 0 && (state.answered || state.copy.is_none()) {
+                        self.hedges.remove(hedge);
+                    }
+                }
+                Awaiting::Request(_) => {}
+            }
+        }
+
+        // the connection is replaced by a spare, if there is one, and is
+        // opened again after a backoff
+        let pool = self
+            .pools
+            .remove(&token)
+            .expect("connection without a pool");
+        let connecting = self.connecting.remove(&token);
+        if let Some(addr) = self.addrs.remove(&token) {
+            if !connecting {
+                info!("lost connection to backend {}", addr);
+            }
+            self.retry(pool, addr);
+        }
+        if let Some(index) = self.spares[pool].iter().position(|t| *t == token) {
+            self.spares[pool].swap_remove(index);
+        } else {
+            self.connections[pool].retain(|t| *t != token);
+            let spare = self.spares[pool]
+                .iter()
+                .position(|t| !self.connecting.contains(t))
+                .or_else(|| (!self.spares[pool].is_empty()).then_some(0));
+            if let Some(index) = spare {
+                BACKEND_SPARE.increment();
+                let spare = self.spares[pool].swap_remove(index);
+                self.connections[pool].push(spare);
+                self.drain_backlog(pool);
+            }
+        }
+
+        // a shard without any established connections is ejected until one is
+        // established again, and the requests which wait on it move to the
+        // shards which now own their keys
+        if pool < self.shards
+            && self.connections[pool]
+                .iter()
+                .all(|token| self.connecting.contains(token))
+        {
+            if let Some(ring) = self.ring.as_mut() {
+                if ring.set_ejected(pool, true) {
+                    warn!("ejecting backend shard: {}", pool);
+                    BACKEND_RING_REBUILD.increment();
+
+                    let backlog = std::mem::take(&mut self.backlog);
+                    for (request, _, awaiting, _) in backlog {
+                        let pool = self.pool(&request);
+                        self.send(request, pool, awaiting);
+                    }
+                }
+            }
         }
     }
 
-    /// Handle up to one response for a session
+    /// Handle all of the responses which have been received for a session
     fn read(&mut self, token: Token) -> Result<()> {
         let session = self
             .sessions
@@ -165,20 +817,49 @@ where
         // fill the session
         map_result(session.fill())?;
 
-        // process up to one request
-        match session.receive() {
-            Ok((request, response)) => {
-                if let Some(fe_token) = self.pending.remove(&token) {
-                    self.free_queue.push_back(token);
-                    self.data_queue
-                        .try_send_to(0, (request, response, fe_token))
-                        .map_err(|_| Error::new(ErrorKind::Other, "data queue is full"))
-                } else {
-                    panic!("corrupted state");
+        // with pipelining, a single read may hold many responses. each is
+        // paired with the request it answers, which for protocols with
+        // request ids need not be the oldest one in flight
+        let mut received = Vec::new();
+        let mut result = loop {
+            let (index, request, response) = match session.receive_matched() {
+                Ok(received) => received,
+                Err(e) => break map_err(e),
+            };
+            let (sent, awaiting) = self
+                .pending
+                .get_mut(&token)
+                .and_then(|pending| pending.remove(index))
+                .expect("corrupted state");
+
+            // a connection which answers a request is healthy, and is opened
+            // again without delay the next time it is lost
+            if !self.backoff.is_empty() {
+                if let Some(addr) = self.addrs.get(&token) {
+                    self.backoff.remove(addr);
                 }
             }
-            Err(e) => map_err(e),
+
+            let latency = (Instant::now() - sent).as_nanos();
+            let ewma = self.ewma.entry(token).or_insert(latency as f64);
+            *ewma += (latency as f64 - *ewma) * EWMA_WEIGHT;
+            if let Some(hedge) = self.hedge.as_mut() {
+                hedge.record(latency);
+            }
+
+            received.push((awaiting, request, response));
+        };
+
+        for (awaiting, request, response) in received {
+            if let Err(e) = self.respond(awaiting, request, response) {
+                result = Err(e);
+                break;
+            }
         }
+
+        self.drain_backlog(self.pools[&token]);
+
+        result
     }
 
     /// Handle write by flushing the session
@@ -206,7 +887,11 @@ where
             BACKEND_EVENT_LOOP.increment();
 
             // get events with timeout
-            if self.poll.poll(&mut events, Some(self.timeout)).is_err() {
+            if self
+                .poll
+                .poll(&mut events, Some(self.poll_timeout()))
+                .is_err()
+            {
                 error!("Error polling");
             }
 
@@ -227,16 +912,7 @@ where
                         // handle all pending messages on the data queue
                         self.data_queue.try_recv_all(&mut messages);
                         for (request, fe_token) in messages.drain(..).map(|v| v.into_inner()) {
-                            if let Some(be_token) = self.free_queue.pop_front() {
-                                let session = &mut self.sessions[be_token.0];
-                                if session.send(request).is_err() {
-                                    panic!("we don't handle this right now");
-                                } else {
-                                    self.pending.insert(be_token, fe_token);
-                                }
-                            } else {
-                                self.backlog.push_back((request, token));
-                            }
+                            self.dispatch(request, fe_token);
                         }
 
                         // check if we received any signals from the admin thread
@@ -244,7 +920,7 @@ where
                             self.signal_queue.try_recv().map(|v| v.into_inner())
                         {
                             match signal {
-                                Signal::FlushAll => {}
+                                Signal::FlushAll | Signal::Invalidate(_) | Signal::Reload(_) => {}
                                 Signal::Shutdown => {
                                     // if we received a shutdown, we can return
                                     // and stop processing events
@@ -261,6 +937,10 @@ where
                             continue;
                         }
 
+                        if self.connecting.contains(&token) {
+                            self.establish(token);
+                        }
+
                         if event.is_writable() {
                             BACKEND_EVENT_WRITE.increment();
 
@@ -282,12 +962,37 @@ where
                 }
             }
 
+            self.send_hedges();
+            self.reconnect();
+
             // wakes the storage thread if necessary
             let _ = self.data_queue.wake();
         }
     }
 }
 
+/// Opens a connection to the endpoint and registers it for events. The
+/// connection is not yet established when this returns.
+fn open<Parser, Request, Response>(
+    poll: &Poll,
+    sessions: &mut Slab<ClientSession<Parser, Request, Response>>,
+    parser: &Parser,
+    addr: SocketAddr,
+) -> Result<Token>
+where
+    Parser: Clone + Parse<Response>,
+    Request: Compose,
+{
+    let stream = TcpStream::connect(addr)?;
+    let mut session = ClientSession::new(Session::from(stream), parser.clone());
+    let s = sessions.vacant_entry();
+    let token = Token(s.key());
+    let interest = session.interest();
+    session.register(poll.registry(), token, interest)?;
+    s.insert(session);
+    Ok(token)
+}
+
 pub struct BackendBuilder<Parser, Request, Response> {
     builders: Vec<BackendWorkerBuilder<Parser, Request, Response>>,
 }
@@ -296,7 +1001,7 @@ impl<BackendParser, BackendRequest, BackendResponse>
     BackendBuilder<BackendParser, BackendRequest, BackendResponse>
 where
     BackendParser: Parse<BackendResponse> + Clone,
-    BackendRequest: Compose,
+    BackendRequest: Compose + Correlate<BackendResponse> + Shard<BackendResponse>,
 {
     pub fn new<T: BackendConfig>(
         config: &T,
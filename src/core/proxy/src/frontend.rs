@@ -287,7 +287,7 @@ where
                             self.signal_queue.try_recv().map(|v| v.into_inner())
                         {
                             match signal {
-                                Signal::FlushAll => {}
+                                Signal::FlushAll | Signal::Invalidate(_) | Signal::Reload(_) => {}
                                 Signal::Shutdown => {
                                     // if we received a shutdown, we can return
                                     // and stop processing events
@@ -0,0 +1,79 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Estimates how long to wait for a response before a request is hedged by
+//! sending a copy of it on another connection.
+//!
+//! The delay is a high percentile of the latencies of recent responses, so
+//! that only the slowest few requests are sent twice.
+
+/// The number of recent latencies the delay is estimated from.
+const WINDOW: usize = 256;
+
+/// The percentile of recent latencies after which a request is hedged.
+const PERCENTILE: f64 = 0.95;
+
+pub struct HedgeDelay {
+    samples: Vec<u64>,
+    next: usize,
+    delay: Option<u64>,
+}
+
+impl HedgeDelay {
+    pub fn new() -> Self {
+        Self {
+            samples: Vec::with_capacity(WINDOW),
+            next: 0,
+            delay: None,
+        }
+    }
+
+    /// Records the latency of a response in nanoseconds. The delay is
+    /// estimated again each time the window is filled.
+    pub fn record(&mut self, latency: u64) {
+        if self.samples.len() < WINDOW {
+            self.samples.push(latency);
+        } else {
+            self.samples[self.next] = latency;
+        }
+
+        self.next += 1;
+        if self.next == WINDOW {
+            self.next = 0;
+            let mut sorted = self.samples.clone();
+            let index = ((WINDOW - 1) as f64 * PERCENTILE) as usize;
+            let (_, delay, _) = sorted.select_nth_unstable(index);
+            self.delay = Some(*delay);
+        }
+    }
+
+    /// The delay in nanoseconds, once enough responses have been seen to
+    /// estimate it.
+    pub fn delay(&self) -> Option<u64> {
+        self.delay
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn percentile() {
+        let mut hedge = HedgeDelay::new();
+        for latency in 0..(WINDOW as u64 - 1) {
+            hedge.record(latency);
+        }
+        assert_eq!(hedge.delay(), None);
+
+        hedge.record(WINDOW as u64 - 1);
+        assert_eq!(hedge.delay(), Some(242));
+
+        // the window slides, so a slower backend raises the delay
+        for latency in 0..(WINDOW as u64) {
+            hedge.record(latency * 10);
+        }
+        assert_eq!(hedge.delay(), Some(2420));
+    }
+}
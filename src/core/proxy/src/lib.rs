@@ -25,7 +25,7 @@ use logger::Drain;
 use metriken::*;
 use pelikan_net::event::{Event, Source};
 use pelikan_net::*;
-use protocol_common::{Compose, Execute, Parse};
+use protocol_common::{Compose, Correlate, Execute, Parse, Shard};
 use session::{Buf, ServerSession, Session};
 use slab::Slab;
 use std::io::{Error, ErrorKind, Result};
@@ -34,8 +34,10 @@ use switchboard::{Queues, Waker};
 
 mod backend;
 mod frontend;
+mod hedge;
 mod listener;
 mod process;
+mod ring;
 
 use backend::BackendBuilder;
 use frontend::FrontendBuilder;
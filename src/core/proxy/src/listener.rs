@@ -62,17 +62,28 @@ impl ListenerBuilder {
         let tls_config = config.tls();
         let config = config.listener();
 
-        let addr = config.socket_addr().map_err(|e| {
-            error!("{}", e);
-            std::io::Error::new(std::io::ErrorKind::Other, "Bad listen address")
-        })?;
-
-        let tcp_listener = TcpListener::bind(addr)?;
+        let mut listener = if let Some(path) = config.socket() {
+            if tls_acceptor(tls_config)?.is_some() {
+                return Err(Error::new(
+                    ErrorKind::Other,
+                    "tls is not supported on a unix domain socket",
+                ));
+            }
 
-        let mut listener = if let Some(tls_acceptor) = tls_acceptor(tls_config)? {
-            pelikan_net::Listener::from((tcp_listener, tls_acceptor))
+            pelikan_net::Listener::from(UnixListener::bind(path)?)
         } else {
-            pelikan_net::Listener::from(tcp_listener)
+            let addr = config.socket_addr().map_err(|e| {
+                error!("{}", e);
+                std::io::Error::new(std::io::ErrorKind::Other, "Bad listen address")
+            })?;
+
+            let tcp_listener = TcpListener::bind(addr)?;
+
+            if let Some(tls_acceptor) = tls_acceptor(tls_config)? {
+                pelikan_net::Listener::from((tcp_listener, tls_acceptor))
+            } else {
+                pelikan_net::Listener::from(tcp_listener)
+            }
         };
 
         let poll = Poll::new()?;
@@ -287,6 +298,11 @@ impl Listener {
             self.listener
                 .local_addr()
                 .map(|v| format!("{v}"))
+                .or_else(|e| self
+                    .listener
+                    .path()
+                    .map(|v| v.display().to_string())
+                    .ok_or(e))
                 .unwrap_or_else(|_| "unknown address".to_string())
         );
 
@@ -323,7 +339,7 @@ impl Listener {
                             self.signal_queue.try_recv().map(|v| v.into_inner())
                         {
                             match signal {
-                                Signal::FlushAll => {}
+                                Signal::FlushAll | Signal::Invalidate(_) | Signal::Reload(_) => {}
                                 Signal::Shutdown => {
                                     // if we received a shutdown, we can return
                                     // and stop processing events
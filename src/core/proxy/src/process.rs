@@ -47,7 +47,12 @@ impl<
     >
 where
     BackendParser: 'static + Parse<BackendResponse> + Clone + Send,
-    BackendRequest: 'static + Send + Compose + From<FrontendRequest> + Compose,
+    BackendRequest: 'static
+        + Send
+        + Compose
+        + From<FrontendRequest>
+        + Correlate<BackendResponse>
+        + Shard<BackendResponse>,
     BackendResponse: 'static + Compose + Send,
     FrontendParser: 'static + Parse<FrontendRequest> + Clone + Send,
     FrontendRequest: 'static + Send,
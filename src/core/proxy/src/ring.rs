@@ -0,0 +1,267 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Consistent hashing of keys onto a set of weighted backend shards.
+//!
+//! Each shard is identified by a name, such as its address, which determines
+//! where it is placed, so that a shard keeps the same keys when other shards
+//! are added or removed. Shards which are unreachable are ejected from the
+//! distribution, and only the keys they owned move to the other shards.
+
+use config::proxy::Distribution;
+
+/// The number of points on a ketama ring for each unit of weight.
+const KETAMA_POINTS: usize = 160;
+
+/// The size of a maglev lookup table, which is prime and much larger than the
+/// number of shards so that keys are spread evenly.
+const MAGLEV_SIZE: usize = 65537;
+
+pub struct Ring {
+    distribution: Distribution,
+    names: Vec<String>,
+    weights: Vec<usize>,
+    ejected: Vec<bool>,
+    lookup: Lookup,
+}
+
+enum Lookup {
+    /// Points on the ring, sorted by hash, and the shard which owns each.
+    Ketama(Vec<(u64, usize)>),
+    /// One bucket for each unit of weight. Keys which hash to the bucket of an
+    /// ejected shard are hashed again until they find a live one.
+    Jump(Vec<usize>),
+    /// The shard for each slot of the table.
+    Maglev(Vec<usize>),
+    /// Every shard is ejected or has no weight.
+    Empty,
+}
+
+impl Ring {
+    pub fn new(distribution: Distribution, names: Vec<String>, weights: Vec<usize>) -> Self {
+        assert_eq!(names.len(), weights.len());
+
+        let mut ring = Self {
+            distribution,
+            ejected: vec![false; names.len()],
+            names,
+            weights,
+            lookup: Lookup::Empty,
+        };
+        ring.rebuild();
+        ring
+    }
+
+    /// Returns the index of the shard which owns the key.
+    pub fn shard(&self, key: &[u8]) -> usize {
+        let hash = hash(key);
+        match &self.lookup {
+            Lookup::Ketama(points) => {
+                let index = points.partition_point(|(point, _)| *point < hash);
+                points[index % points.len()].1
+            }
+            Lookup::Jump(buckets) => {
+                let mut hash = hash;
+                loop {
+                    let shard = buckets[jump(hash, buckets.len())];
+                    if !self.ejected[shard] {
+                        return shard;
+                    }
+                    hash = mix(hash);
+                }
+            }
+            Lookup::Maglev(table) => table[(hash % table.len() as u64) as usize],
+            Lookup::Empty => 0,
+        }
+    }
+
+    /// Removes a shard from the distribution, or returns it, and rebuilds the
+    /// distribution if this is a change. Returns true if it was rebuilt.
+    pub fn set_ejected(&mut self, shard: usize, ejected: bool) -> bool {
+        if self.ejected[shard] == ejected {
+            return false;
+        }
+        self.ejected[shard] = ejected;
+        self.rebuild();
+        true
+    }
+
+    /// The weight of the shard in the distribution, which is zero once it is
+    /// ejected.
+    fn weight(&self, shard: usize) -> usize {
+        if self.ejected[shard] {
+            0
+        } else {
+            self.weights[shard]
+        }
+    }
+
+    fn rebuild(&mut self) {
+        if (0..self.names.len()).all(|shard| self.weight(shard) == 0) {
+            self.lookup = Lookup::Empty;
+            return;
+        }
+
+        self.lookup = match self.distribution {
+            Distribution::Ketama => {
+                let mut points = Vec::new();
+                for (shard, name) in self.names.iter().enumerate() {
+                    for point in 0..(KETAMA_POINTS * self.weight(shard)) {
+                        points.push((hash(format!("{name}-{point}").as_bytes()), shard));
+                    }
+                }
+                points.sort_unstable();
+                Lookup::Ketama(points)
+            }
+            Distribution::Jump => Lookup::Jump(
+                self.weights
+                    .iter()
+                    .enumerate()
+                    .flat_map(|(shard, weight)| std::iter::repeat(shard).take(*weight))
+                    .collect(),
+            ),
+            Distribution::Maglev => Lookup::Maglev(self.maglev()),
+            Distribution::None => Lookup::Empty,
+        };
+    }
+
+    /// Populates a maglev lookup table. Each shard walks its own permutation
+    /// of the slots, claiming the next free one each turn, and takes as many
+    /// turns in each round as it has units of weight.
+    fn maglev(&self) -> Vec<usize> {
+        let size = MAGLEV_SIZE;
+        let permutations: Vec<(usize, usize)> = self
+            .names
+            .iter()
+            .map(|name| {
+                let offset = hash(name.as_bytes()) as usize % size;
+                let skip = mix(hash(name.as_bytes())) as usize % (size - 1) + 1;
+                (offset, skip)
+            })
+            .collect();
+
+        let mut table = vec![usize::MAX; size];
+        let mut next = vec![0; self.names.len()];
+        let mut filled = 0;
+
+        'fill: loop {
+            for shard in 0..self.names.len() {
+                for _ in 0..self.weight(shard) {
+                    let (offset, skip) = permutations[shard];
+                    let mut slot = (offset + next[shard] * skip) % size;
+                    while table[slot] != usize::MAX {
+                        next[shard] += 1;
+                        slot = (offset + next[shard] * skip) % size;
+                    }
+                    table[slot] = shard;
+                    next[shard] += 1;
+                    filled += 1;
+                    if filled == size {
+                        break 'fill;
+                    }
+                }
+            }
+        }
+
+        table
+    }
+}
+
+/// Maps a key hash onto one of `buckets` buckets. See: "A Fast, Minimal
+/// Memory, Consistent Hash Algorithm" by Lamping and Veach.
+fn jump(mut key: u64, buckets: usize) -> usize {
+    let mut b: i64 = -1;
+    let mut j: i64 = 0;
+    while j < buckets as i64 {
+        b = j;
+        key = key.wrapping_mul(2862933555777941757).wrapping_add(1);
+        j = ((b + 1) as f64 * ((1u64 << 31) as f64 / ((key >> 33) + 1) as f64)) as i64;
+    }
+    b as usize
+}
+
+/// A 64-bit FNV-1a hash with a final mix. The hash decides which shard owns a
+/// key, so it must be stable across builds and processes.
+fn hash(bytes: &[u8]) -> u64 {
+    mix(bytes.iter().fold(0xcbf29ce484222325, |hash: u64, byte| {
+        (hash ^ *byte as u64).wrapping_mul(0x100000001b3)
+    }))
+}
+
+/// The finalizer of splitmix64, which spreads the bits of the input.
+fn mix(mut x: u64) -> u64 {
+    x = (x ^ (x >> 30)).wrapping_mul(0xbf58476d1ce4e5b9);
+    x = (x ^ (x >> 27)).wrapping_mul(0x94d049bb133111eb);
+    x ^ (x >> 31)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn names(count: usize) -> Vec<String> {
+        (0..count).map(|i| format!("10.0.0.{i}:12321")).collect()
+    }
+
+    fn keys() -> Vec<Vec<u8>> {
+        (0..10000).map(|i| format!("key{i}").into_bytes()).collect()
+    }
+
+    #[test]
+    fn weighted() {
+        for distribution in [
+            Distribution::Ketama,
+            Distribution::Jump,
+            Distribution::Maglev,
+        ] {
+            let ring = Ring::new(distribution, names(3), vec![1, 1, 2]);
+            let mut counts = [0; 3];
+            for key in keys() {
+                counts[ring.shard(&key)] += 1;
+            }
+            // the shard with twice the weight has about half of the keys
+            assert!(counts[2] > 4000 && counts[2] < 6000, "{counts:?}");
+            assert!(counts[0] > 1500 && counts[1] > 1500, "{counts:?}");
+        }
+    }
+
+    #[test]
+    fn ejection() {
+        for distribution in [
+            Distribution::Ketama,
+            Distribution::Jump,
+            Distribution::Maglev,
+        ] {
+            let mut ring = Ring::new(distribution, names(4), vec![1; 4]);
+            let before: Vec<usize> = keys().iter().map(|key| ring.shard(key)).collect();
+
+            ring.set_ejected(1, true);
+            let after: Vec<usize> = keys().iter().map(|key| ring.shard(key)).collect();
+
+            let mut moved = 0;
+            let mut disrupted = 0;
+            for (before, after) in before.iter().zip(after.iter()) {
+                assert_ne!(*after, 1);
+                if before != after {
+                    moved += 1;
+                    if *before != 1 {
+                        disrupted += 1;
+                    }
+                }
+            }
+            assert!(moved > 1500 && moved < 3500, "{moved}");
+            // only the keys of the ejected shard move, except that maglev
+            // trades a few others for an even spread
+            if distribution == Distribution::Maglev {
+                assert!(disrupted < 100, "{disrupted}");
+            } else {
+                assert_eq!(disrupted, 0);
+            }
+
+            ring.set_ejected(1, false);
+            let restored: Vec<usize> = keys().iter().map(|key| ring.shard(key)).collect();
+            assert_eq!(before, restored);
+        }
+    }
+}
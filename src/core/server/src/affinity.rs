@@ -0,0 +1,58 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Pins threads to cores so that the scheduler does not migrate them, which
+//! keeps each thread next to its caches and, on multi-socket hosts, the memory
+//! of its NUMA node.
+
+/// Pins the calling thread to the provided core. Does nothing if no core is
+/// provided. Failing to pin the thread is logged, but is not fatal.
+#[cfg(target_os = "linux")]
+pub fn pin(core: Option<usize>) {
+    let Some(core) = core else {
+        return;
+    };
+
+    if core >= libc::CPU_SETSIZE as usize {
+        warn!("cannot pin thread to core {}: core is out of range", core);
+        return;
+    }
+
+    let ret = unsafe {
+        let mut set: libc::cpu_set_t = core::mem::zeroed();
+        libc::CPU_SET(core, &mut set);
+        libc::sched_setaffinity(0, core::mem::size_of::<libc::cpu_set_t>(), &set)
+    };
+
+    if ret == 0 {
+        debug!("pinned thread to core {}", core);
+    } else {
+        warn!(
+            "failed to pin thread to core {}: {}",
+            core,
+            std::io::Error::last_os_error()
+        );
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+pub fn pin(core: Option<usize>) {
+    if let Some(core) = core {
+        warn!(
+            "cannot pin thread to core {}: not supported on this platform",
+            core
+        );
+    }
+}
+
+/// Returns the core for the worker thread with the provided id. The worker
+/// threads are assigned to cores in order, wrapping around if there are more
+/// threads than cores.
+pub fn worker_core(cores: &[usize], id: usize) -> Option<usize> {
+    if cores.is_empty() {
+        None
+    } else {
+        Some(cores[id % cores.len()])
+    }
+}
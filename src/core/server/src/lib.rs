@@ -87,10 +87,35 @@
 //! execute requests. The storage thread will receive requests from a worker
 //! over a queue, execute the request, and returns the result back to the worker
 //! thread.
+//!
+//! ### Sharded Storage
+//! The storage may also be split into shards, each owned by its own `storage`
+//! thread, with the workers built by `ProcessBuilder::sharded`. Each worker
+//! routes a request to the storage thread which owns the shard for its key.
+//! Requests with keys on more than one shard, such as a multi-key get, are
+//! split into one request for each shard, and their responses are merged back
+//! together before being sent. Responses are always sent in the order of the
+//! requests of a session.
+//!
+//! ### Shared Storage
+//! When the storage is a concurrent datastructure which can be shared between
+//! threads, the workers may instead be built with `ProcessBuilder::shared`. In
+//! this mode there is no storage thread, and each worker executes requests
+//! directly against its own handle to the shared storage, as it would for the
+//! single worker thread model.
+//!
+//! Shared storage may also be combined with `reuseport` in the server config.
+//! Each worker then binds its own listening socket with `SO_REUSEPORT` and
+//! accepts, serves, and closes its sessions without involving any other
+//! thread, and there is no `listener` thread. The kernel balances connections
+//! across the workers. TLS is not supported in this mode.
 
 #[macro_use]
 extern crate logger;
 
+#[macro_use]
+mod usdt;
+
 use admin::AdminBuilder;
 use common::signal::Signal;
 use common::ssl::tls_acceptor;
@@ -101,23 +126,30 @@ use crossbeam_channel::{bounded, Sender};
 use entrystore::EntryStore;
 use logger::{Drain, Klog};
 use metriken::*;
-use pelikan_net::event::{Event, Source};
+use pelikan_net::event::Source;
 use pelikan_net::*;
-use protocol_common::{Compose, Execute, Parse};
+use protocol_common::{
+    Compose, Datagram, Deadline, Execute, HotCopy, Parse, Quiet, Replicate, Shard, Timed, Track,
+};
 use session::{Buf, ServerSession, Session};
 use slab::Slab;
 use std::io::{Error, ErrorKind, Result};
 use std::sync::Arc;
 use switchboard::{Queues, Waker};
 
+mod affinity;
 mod listener;
 mod process;
+mod upgrade;
 mod workers;
 
 use listener::ListenerBuilder;
-use workers::WorkersBuilder;
+use upgrade::Upgrade;
+use workers::{Primary, Replica, WorkersBuilder};
 
+pub use admin::Reloader;
 pub use process::{Process, ProcessBuilder};
+pub use upgrade::inherit;
 
 // TODO(bmartin): this *should* be plenty safe, the queue should rarely ever be
 // full, and a single wakeup should drain at least one message and make room for
@@ -129,6 +161,25 @@ const QUEUE_CAPACITY: usize = 64 * 1024;
 // determines the max number of calls to accept when the listener is ready
 const ACCEPT_BATCH: usize = 8;
 
+// determines the max number of calls to accept when the listener thread is
+// ready, which only accepts and so can take more of the backlog at once
+const LISTENER_ACCEPT_BATCH_MAX: usize = 64;
+
+// determines the max number of pipelined requests handled for a session per
+// read, their responses are flushed together with a single write
+const PIPELINE_BATCH: usize = 32;
+
+// determines the max number of pipelined requests handled for a session per
+// read across all of its batches, so that a single client cannot hold the
+// worker while other sessions wait, their responses are flushed together
+const PIPELINE_BUDGET: usize = 1024;
+
+// determines the smallest value which the single worker reads from a session
+// straight into storage, rather than into the session buffer, when the header
+// of its request arrives before all of the value
+const INGEST_MIN: usize = 16 * 1024;
+
+const UDP_TOKEN: Token = Token(usize::MAX - 2);
 const LISTENER_TOKEN: Token = Token(usize::MAX - 1);
 const WAKER_TOKEN: Token = Token(usize::MAX);
 
@@ -144,10 +195,39 @@ pub static PERCENTILES: &[(&str, f64)] = &[
     ("p9999", 99.99),
 ];
 
+/// A session which a worker hands back to the listener, either to be closed or
+/// to be moved to the worker with the provided index.
+pub enum Handoff {
+    Close(Session),
+    Move(Session, usize),
+}
+
 // stats
 #[metric(name = "process_req")]
 pub static PROCESS_REQ: Counter = Counter::new();
 
+#[metric(
+    name = "queue_bytes",
+    description = "approximate number of bytes allocated for the slots of the queues between threads"
+)]
+pub static QUEUE_BYTES: Gauge = Gauge::new();
+
+/// Creates the queues between two groups of threads, as `Queues::new` does,
+/// and adds the memory of their slots to the `queue_bytes` gauge. Each pair of
+/// threads has a queue of `capacity` slots in each direction, which is
+/// allocated up front however few messages are sent on it.
+fn queues<A, B>(
+    a_wakers: Vec<Arc<Waker>>,
+    b_wakers: Vec<Arc<Waker>>,
+    capacity: usize,
+) -> (Vec<Queues<A, B>>, Vec<Queues<B, A>>) {
+    // each message is held along with the index of its sender
+    let slot = core::mem::size_of::<(A, usize)>() + core::mem::size_of::<(B, usize)>();
+    QUEUE_BYTES.add((a_wakers.len() * b_wakers.len() * capacity * slot) as _);
+
+    Queues::new(a_wakers, b_wakers, capacity)
+}
+
 fn map_err(e: std::io::Error) -> Result<()> {
     match e.kind() {
         ErrorKind::WouldBlock => Ok(()),
@@ -3,7 +3,21 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use crate::*;
-use std::time::Duration;
+use std::net::SocketAddr;
+use std::os::unix::prelude::{AsRawFd, RawFd};
+use std::time::{Duration, Instant};
+
+#[metric(
+    name = "listener_accept_batch",
+    description = "the distribution of the number of sessions accepted on each wakeup"
+)]
+pub static LISTENER_ACCEPT_BATCH: AtomicHistogram = AtomicHistogram::new(7, 17);
+
+#[metric(
+    name = "listener_accept_latency",
+    description = "the distribution of the time taken to accept each session, in nanoseconds"
+)]
+pub static LISTENER_ACCEPT_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 64);
 
 #[metric(
     name = "listener_event_error",
@@ -41,6 +55,18 @@ pub static LISTENER_EVENT_TOTAL: Counter = Counter::new();
 )]
 pub static LISTENER_EVENT_WRITE: Counter = Counter::new();
 
+#[metric(
+    name = "listener_shed_buffer",
+    description = "the number of sessions refused as the session buffers were at their limit"
+)]
+pub static LISTENER_SHED_BUFFER: Counter = Counter::new();
+
+#[metric(
+    name = "listener_shed_inflight",
+    description = "the number of sessions refused as the limit of requests in flight to the storage threads was reached"
+)]
+pub static LISTENER_SHED_INFLIGHT: Counter = Counter::new();
+
 #[metric(
     name = "listener_session_discard",
     description = "the number of sessions discarded by the listener"
@@ -48,17 +74,17 @@ pub static LISTENER_EVENT_WRITE: Counter = Counter::new();
 pub static LISTENER_SESSION_DISCARD: Counter = Counter::new();
 
 pub struct Listener {
-    /// The actual network listener server
-    listener: pelikan_net::Listener,
+    /// The actual network listeners, the first of which is for the address in
+    /// the server config, and the index of each marks its sessions
+    listeners: Vec<pelikan_net::Listener>,
     /// The maximum number of events to process per call to poll
     nevent: usize,
     /// The actual poll instantance
     poll: Poll,
-    /// Sessions which have been opened, but are not fully established
-    sessions: Slab<Session>,
-    /// Queues for sending established sessions to the worker thread(s) and to
-    /// receive sessions which should be closed
-    session_queue: Queues<Session, Session>,
+    /// Queues for sending new sessions to the worker thread(s), which complete
+    /// any handshake, and to receive sessions which should be closed or moved
+    /// to another worker
+    session_queue: Queues<Session, Handoff>,
     /// Queue for receieving signals from the admin thread
     signal_queue: Queues<(), Signal>,
     /// The timeout for each call to poll
@@ -68,10 +94,11 @@ pub struct Listener {
 }
 
 pub struct ListenerBuilder {
-    listener: pelikan_net::Listener,
+    defer_accept: usize,
+    fastopen: usize,
+    listeners: Vec<pelikan_net::Listener>,
     nevent: usize,
     poll: Poll,
-    sessions: Slab<Session>,
     timeout: Duration,
     waker: Arc<Waker>,
 }
@@ -81,17 +108,29 @@ impl ListenerBuilder {
         let tls_config = config.tls();
         let config = config.server();
 
-        let addr = config.socket_addr().map_err(|e| {
-            error!("{}", e);
-            std::io::Error::new(std::io::ErrorKind::Other, "Bad listen address")
-        })?;
-
-        let tcp_listener = TcpListener::bind(addr)?;
+        let mut listener = if let Some(path) = config.socket() {
+            if tls_acceptor(tls_config)?.is_some() {
+                return Err(Error::new(
+                    ErrorKind::Other,
+                    "tls is not supported on a unix domain socket",
+                ));
+            }
 
-        let mut listener = if let Some(tls_acceptor) = tls_acceptor(tls_config)? {
-            pelikan_net::Listener::from((tcp_listener, tls_acceptor))
+            pelikan_net::Listener::from(UnixListener::bind(path)?)
         } else {
-            pelikan_net::Listener::from(tcp_listener)
+            let addr = config.socket_addr().map_err(|e| {
+                error!("{}", e);
+                std::io::Error::new(std::io::ErrorKind::Other, "Bad listen address")
+            })?;
+
+            let tcp_listener = upgrade::bind(addr)?;
+            tune(&tcp_listener, config);
+
+            if let Some(tls_acceptor) = tls_acceptor(tls_config)? {
+                pelikan_net::Listener::from((tcp_listener, tls_acceptor))
+            } else {
+                pelikan_net::Listener::from(tcp_listener)
+            }
         };
 
         let poll = Poll::new()?;
@@ -104,18 +143,47 @@ impl ListenerBuilder {
         let nevent = config.nevent();
         let timeout = Duration::from_millis(config.timeout() as u64);
 
-        let sessions = Slab::new();
-
         Ok(Self {
-            listener,
+            defer_accept: config.defer_accept(),
+            fastopen: config.fastopen(),
+            listeners: vec![listener],
             nevent,
             poll,
-            sessions,
             timeout,
             waker,
         })
     }
 
+    /// Adds a listener on the address, with the same tls config as the one for
+    /// the address in the server config. The sessions it accepts are marked
+    /// with its index, which starts from one for the first listener added.
+    pub fn listen<T: TlsConfig>(&mut self, config: &T, addr: SocketAddr) -> Result<()> {
+        let tcp_listener = upgrade::bind(addr)?;
+        tune_with(&tcp_listener, self.fastopen, self.defer_accept);
+
+        let mut listener = if let Some(tls_acceptor) = tls_acceptor(config.tls())? {
+            pelikan_net::Listener::from((tcp_listener, tls_acceptor))
+        } else {
+            pelikan_net::Listener::from(tcp_listener)
+        };
+
+        let index = self.listeners.len();
+        listener.register(self.poll.registry(), Token(index), Interest::READABLE)?;
+        self.listeners.push(listener);
+
+        Ok(())
+    }
+
+    /// Returns the file descriptors of the TCP listeners, which are handed to
+    /// a newer process on an upgrade.
+    pub fn fds(&self) -> Vec<RawFd> {
+        self.listeners
+            .iter()
+            .filter(|listener| listener.local_addr().is_ok())
+            .map(|listener| listener.as_raw_fd())
+            .collect()
+    }
+
     pub fn waker(&self) -> Arc<Waker> {
         self.waker.clone()
     }
@@ -123,13 +191,12 @@ impl ListenerBuilder {
     pub fn build(
         self,
         signal_queue: Queues<(), Signal>,
-        session_queue: Queues<Session, Session>,
+        session_queue: Queues<Session, Handoff>,
     ) -> Listener {
         Listener {
-            listener: self.listener,
+            listeners: self.listeners,
             nevent: self.nevent,
             poll: self.poll,
-            sessions: self.sessions,
             session_queue,
             signal_queue,
             timeout: self.timeout,
@@ -138,124 +205,62 @@ impl ListenerBuilder {
     }
 }
 
-impl Listener {
-    /// Accept new sessions
-    fn accept(&mut self) {
-        for _ in 0..ACCEPT_BATCH {
-            if let Ok(mut session) = self.listener.accept().map(Session::from) {
-                if session.is_handshaking() {
-                    let s = self.sessions.vacant_entry();
-                    let interest = session.interest();
-                    if session
-                        .register(self.poll.registry(), Token(s.key()), interest)
-                        .is_ok()
-                    {
-                        s.insert(session);
-                    } else {
-                        // failed to register
-                    }
-                } else {
-                    for attempt in 1..=QUEUE_RETRIES {
-                        if let Err(s) = self.session_queue.try_send_any(session) {
-                            if attempt == QUEUE_RETRIES {
-                                LISTENER_SESSION_DISCARD.increment();
-                            } else {
-                                let _ = self.session_queue.wake();
-                            }
-                            session = s;
-                        } else {
-                            break;
-                        }
-                    }
-                    // if pushing to the session queues fails, the session will be
-                    // closed on drop here
-                }
-            } else {
-                return;
-            }
-        }
-
-        // reregister is needed here so we will call accept if there is a backlog
-        if self
-            .listener
-            .reregister(self.poll.registry(), LISTENER_TOKEN, Interest::READABLE)
-            .is_err()
-        {
-            // failed to reregister listener? how do we handle this?
-        }
-    }
+/// Enables the options of the server config which speed up accepting new
+/// connections on the listener. Options which the host does not support are
+/// skipped with a warning, as the listener works without them.
+pub(crate) fn tune(listener: &TcpListener, config: &config::Server) {
+    tune_with(listener, config.fastopen(), config.defer_accept());
+}
 
-    /// Handle a read event for the `Session` with the `Token`. This primarily
-    /// just checks that there wasn't a hangup, as indicated by a zero-sized
-    /// return from `read()`.
-    fn read(&mut self, token: Token) -> Result<()> {
-        let session = self
-            .sessions
-            .get_mut(token.0)
-            .ok_or_else(|| Error::new(ErrorKind::Other, "non-existant session"))?;
-
-        // read from session to buffer
-        match session.fill() {
-            Ok(0) => {
-                // zero-length reads indicate remote side has closed connection
-                trace!("hangup for session: {:?}", session);
-                Err(Error::new(ErrorKind::Other, "client hangup"))
-            }
-            Ok(bytes) => {
-                trace!("read {} bytes for session: {:?}", bytes, session);
-                Ok(())
-            }
-            Err(e) => {
-                match e.kind() {
-                    ErrorKind::WouldBlock => {
-                        // spurious read, ignore
-                        Ok(())
-                    }
-                    _ => Err(e),
-                }
-            }
+fn tune_with(listener: &TcpListener, fastopen: usize, defer_accept: usize) {
+    if fastopen > 0 {
+        if let Err(e) = listener.set_fastopen(fastopen) {
+            warn!("failed to enable tcp fast open: {}", e);
         }
     }
-
-    /// Closes the session with the given token
-    fn close(&mut self, token: Token) {
-        if self.sessions.contains(token.0) {
-            let mut session = self.sessions.remove(token.0);
-            let _ = session.flush();
+    if defer_accept > 0 {
+        if let Err(e) = listener.set_defer_accept(defer_accept as u32) {
+            warn!("failed to defer accept: {}", e);
         }
     }
+}
 
-    fn handshake(&mut self, token: Token) -> Result<()> {
-        let session = self
-            .sessions
-            .get_mut(token.0)
-            .ok_or_else(|| Error::new(ErrorKind::Other, "non-existant session"))?;
-
-        session.do_handshake()
-    }
-
-    /// handle a single session event
-    fn session_event(&mut self, event: &Event) {
-        let token = event.token();
-
-        if event.is_error() {
-            LISTENER_EVENT_ERROR.increment();
-            self.close(token);
-            return;
-        }
+impl Listener {
+    /// Accept new sessions from the listener with the index and send them to
+    /// the worker thread(s). Sessions which are still handshaking are sent
+    /// along with the rest, so that their handshakes are spread across the
+    /// workers rather than performed one at a time on this thread.
+    fn accept(&mut self, index: usize) {
+        let token = if index == 0 {
+            LISTENER_TOKEN
+        } else {
+            Token(index)
+        };
 
-        if event.is_readable() {
-            LISTENER_EVENT_READ.increment();
-            if self.read(token).is_err() {
-                self.close(token);
-                return;
+        // this thread does nothing but accept, so it drains the backlog with
+        // fewer wakeups than the workers which accept from their own listener
+        let mut accepted = 0;
+        for _ in 0..LISTENER_ACCEPT_BATCH_MAX {
+            let start = Instant::now();
+            let result = self.listeners[index].accept().map(Session::from);
+            if result.is_ok() {
+                accepted += 1;
+                let _ = LISTENER_ACCEPT_LATENCY.increment(start.elapsed().as_nanos() as _);
             }
-        }
 
-        match self.handshake(token) {
-            Ok(_) => {
-                // handshake is complete, send the session to a worker thread
-                let mut session = self.sessions.remove(token.0);
+            if let Ok(mut session) = result {
+                // new sessions are refused while overloaded, so that those
+                // which are open keep being served
+                if session::buffer_limit_reached() {
+                    LISTENER_SHED_BUFFER.increment();
+                    continue;
+                }
+                if workers::inflight_reached() {
+                    LISTENER_SHED_INFLIGHT.increment();
+                    continue;
+                }
+
+                session.set_listener(index);
                 for attempt in 1..=QUEUE_RETRIES {
                     if let Err(s) = self.session_queue.try_send_any(session) {
                         if attempt == QUEUE_RETRIES {
@@ -270,24 +275,45 @@ impl Listener {
                 }
                 // if pushing to the session queues fails, the session will be
                 // closed on drop here
+            } else {
+                let _ = LISTENER_ACCEPT_BATCH.increment(accepted);
+                return;
             }
-            Err(e) => match e.kind() {
-                ErrorKind::WouldBlock => {}
-                _ => {
-                    self.close(token);
-                }
-            },
+        }
+        let _ = LISTENER_ACCEPT_BATCH.increment(accepted);
+
+        // reregister is needed here so we will call accept if there is a backlog
+        if self.listeners[index]
+            .reregister(self.poll.registry(), token, Interest::READABLE)
+            .is_err()
+        {
+            // failed to reregister listener? how do we handle this?
+        }
+    }
+
+    /// Sends a session which a worker handed back to the worker it is moved
+    /// to, or to any worker if that one cannot take it.
+    fn forward(&mut self, session: Session, worker: usize) {
+        let session = match self.session_queue.try_send_to(worker, session) {
+            Ok(()) => return,
+            Err(session) => session,
+        };
+        if self.session_queue.try_send_any(session).is_err() {
+            LISTENER_SESSION_DISCARD.increment();
         }
     }
 
     pub fn run(&mut self) {
-        info!(
-            "running server on: {}",
-            self.listener
-                .local_addr()
-                .map(|v| format!("{v}"))
-                .unwrap_or_else(|_| "unknown address".to_string())
-        );
+        for listener in &self.listeners {
+            info!(
+                "running server on: {}",
+                listener
+                    .local_addr()
+                    .map(|v| format!("{v}"))
+                    .or_else(|e| listener.path().map(|v| v.display().to_string()).ok_or(e))
+                    .unwrap_or_else(|_| "unknown address".to_string())
+            );
+        }
 
         let mut events = Events::with_capacity(self.nevent);
 
@@ -303,15 +329,19 @@ impl Listener {
             for event in events.iter() {
                 match event.token() {
                     LISTENER_TOKEN => {
-                        self.accept();
+                        self.accept(0);
                     }
                     WAKER_TOKEN => {
                         self.waker.reset();
-                        // handle any closing sessions
-                        if let Some(mut session) =
-                            self.session_queue.try_recv().map(|v| v.into_inner())
+                        // handle any closing or moving sessions
+                        if let Some(handoff) = self.session_queue.try_recv().map(|v| v.into_inner())
                         {
-                            let _ = session.flush();
+                            match handoff {
+                                Handoff::Close(mut session) => {
+                                    let _ = session.flush();
+                                }
+                                Handoff::Move(session, worker) => self.forward(session, worker),
+                            }
 
                             // wakeup to handle the possibility of more sessions
                             let _ = self.waker.wake();
@@ -322,7 +352,7 @@ impl Listener {
                             self.signal_queue.try_recv().map(|v| v.into_inner())
                         {
                             match signal {
-                                Signal::FlushAll => {}
+                                Signal::FlushAll | Signal::Invalidate(_) | Signal::Reload(_) => {}
                                 Signal::Shutdown => {
                                     // if we received a shutdown, we can return
                                     // and stop processing events
@@ -331,9 +361,10 @@ impl Listener {
                             }
                         }
                     }
-                    _ => {
-                        self.session_event(event);
+                    Token(index) if index < self.listeners.len() => {
+                        self.accept(index);
                     }
+                    _ => {}
                 }
             }
 
@@ -6,84 +6,305 @@ use crate::*;
 use libc::c_int;
 use signal_hook::consts::signal::*;
 use signal_hook::iterator::Signals;
+use std::net::{AddrParseError, SocketAddr};
 use std::thread::JoinHandle;
 
 pub struct ProcessBuilder<Parser, Request, Response, Storage> {
     admin: AdminBuilder,
-    listener: ListenerBuilder,
+    admin_core: Option<usize>,
+    listener: Option<ListenerBuilder>,
+    listener_core: Option<usize>,
     log_drain: Box<dyn Drain>,
+    primary: Option<Primary>,
+    replica: Option<Replica<Parser, Request, Response>>,
+    upgrade: Option<Upgrade>,
     workers: WorkersBuilder<Parser, Request, Response, Storage>,
 }
 
 impl<Parser, Request, Response, Storage> ProcessBuilder<Parser, Request, Response, Storage>
 where
     Parser: 'static + Parse<Request> + Clone + Send,
-    Request: 'static + Klog + Klog<Response = Response> + Send,
+    Request: 'static
+        + Datagram
+        + Deadline<Response>
+        + Klog
+        + Klog<Response = Response>
+        + Replicate<Response>
+        + Shard<Response>
+        + Quiet
+        + Timed
+        + Track<Response>
+        + Send,
     Response: 'static + Compose + Send,
     Storage: 'static + Execute<Request, Response> + EntryStore + Send,
 {
-    pub fn new<T: AdminConfig + ServerConfig + TlsConfig + WorkerConfig>(
+    pub fn new<T: AdminConfig + BufConfig + ServerConfig + TlsConfig + WorkerConfig>(
         config: &T,
         log_drain: Box<dyn Drain>,
         parser: Parser,
         storage: Storage,
     ) -> Result<Self> {
+        session::set_buffer_pool_size(config.buf().poolsize());
+        session::set_buffer_limit(config.buf().limit());
+        workers::set_max_inflight(config.worker().max_inflight());
+
         let admin = AdminBuilder::new(config)?;
-        let listener = ListenerBuilder::new(config)?;
+        let listener = Some(ListenerBuilder::new(config)?);
         let workers = WorkersBuilder::new(config, parser, storage)?;
 
         Ok(Self {
             admin,
+            admin_core: config.admin().core(),
             listener,
+            listener_core: config.worker().listener_core(),
             log_drain,
+            primary: None,
+            replica: None,
+            upgrade: Upgrade::bind(config)?,
             workers,
         })
     }
 
+    /// Creates a new `ProcessBuilder` where every worker thread executes
+    /// requests directly against a clone of the storage. See
+    /// `WorkersBuilder::shared` for details. When the workers bind their own
+    /// listeners with `SO_REUSEPORT`, there is no listener thread.
+    pub fn shared<T: AdminConfig + BufConfig + ServerConfig + TlsConfig + WorkerConfig>(
+        config: &T,
+        log_drain: Box<dyn Drain>,
+        parser: Parser,
+        storage: Storage,
+    ) -> Result<Self>
+    where
+        Storage: Clone,
+    {
+        session::set_buffer_pool_size(config.buf().poolsize());
+        session::set_buffer_limit(config.buf().limit());
+        workers::set_max_inflight(config.worker().max_inflight());
+
+        let admin = AdminBuilder::new(config)?;
+        let workers = WorkersBuilder::shared(config, parser, storage)?;
+        let listener = if workers.is_listening() {
+            None
+        } else {
+            Some(ListenerBuilder::new(config)?)
+        };
+
+        Ok(Self {
+            admin,
+            admin_core: config.admin().core(),
+            listener,
+            listener_core: config.worker().listener_core(),
+            log_drain,
+            primary: None,
+            replica: None,
+            upgrade: Upgrade::bind(config)?,
+            workers,
+        })
+    }
+
+    /// Creates a new `ProcessBuilder` with one storage thread for each of the
+    /// storage shards, and worker threads which route requests to the storage
+    /// threads by key. See `WorkersBuilder::sharded` for details.
+    pub fn sharded<T: AdminConfig + BufConfig + ServerConfig + TlsConfig + WorkerConfig>(
+        config: &T,
+        log_drain: Box<dyn Drain>,
+        parser: Parser,
+        storage: Vec<Storage>,
+        router: impl Fn(&[u8]) -> usize + Send + Sync + 'static,
+    ) -> Result<Self> {
+        session::set_buffer_pool_size(config.buf().poolsize());
+        session::set_buffer_limit(config.buf().limit());
+        workers::set_max_inflight(config.worker().max_inflight());
+
+        let admin = AdminBuilder::new(config)?;
+        let listener = Some(ListenerBuilder::new(config)?);
+        let workers = WorkersBuilder::sharded(config, parser, storage, router)?;
+
+        Ok(Self {
+            admin,
+            admin_core: config.admin().core(),
+            listener,
+            listener_core: config.worker().listener_core(),
+            log_drain,
+            primary: None,
+            replica: None,
+            upgrade: Upgrade::bind(config)?,
+            workers,
+        })
+    }
+
+    /// Accepts sessions on each of the addresses as well as the one in the
+    /// server config. The sessions of each listener are marked with its
+    /// index, from which the parser for them is chosen with
+    /// `Parse::for_listener`, and the first of the addresses has the index
+    /// one. Returns an error if the workers accept sessions from their own
+    /// listeners.
+    pub fn listen<T: TlsConfig>(mut self, config: &T, addrs: &[SocketAddr]) -> Result<Self> {
+        if addrs.is_empty() {
+            return Ok(self);
+        }
+
+        let listener = self.listener.as_mut().ok_or_else(|| {
+            Error::new(
+                ErrorKind::InvalidInput,
+                "more than one listener is not supported with reuseport",
+            )
+        })?;
+        for addr in addrs {
+            listener.listen(config, *addr)?;
+        }
+
+        Ok(self)
+    }
+
+    /// Replicates the writes executed by the storage threads to the replicas
+    /// which connect to the listen address in the config, and applies the
+    /// writes of the primary in the config, if either is set. The parser is
+    /// used for the stream from the primary, and must read ttls as a number
+    /// of seconds. Replication requires storage threads, so it is not
+    /// supported with a single worker thread or with shared storage.
+    pub fn replication<T: ReplicationConfig>(mut self, config: &T, parser: Parser) -> Result<Self> {
+        let config = config.replication();
+
+        if config.listen().is_none() && config.primary().is_none() {
+            return Ok(self);
+        }
+
+        let (storage, router) = self.workers.storage().ok_or_else(|| {
+            Error::new(
+                ErrorKind::InvalidInput,
+                "replication requires storage threads",
+            )
+        })?;
+
+        let invalid = |e: AddrParseError| Error::new(ErrorKind::InvalidInput, e);
+
+        if let Some(addr) = config.listen() {
+            let wakers = storage.iter().map(|s| s.waker()).collect();
+            let (primary, streams) = Primary::new(addr.map_err(invalid)?, config, wakers)?;
+            for (storage, stream) in storage.iter_mut().zip(streams) {
+                storage.replication(stream);
+            }
+            self.primary = Some(primary);
+        }
+
+        if let Some(addr) = config.primary() {
+            let wakers = storage.iter().map(|s| s.waker()).collect();
+            let (replica, queues) = Replica::new(
+                addr.map_err(invalid)?,
+                config,
+                parser,
+                wakers,
+                router.clone(),
+            );
+            for (storage, queue) in storage.iter_mut().zip(queues) {
+                storage.replica(queue);
+            }
+            self.replica = Some(replica);
+        }
+
+        Ok(self)
+    }
+
     pub fn version(mut self, version: &str) -> Self {
         self.admin.version(version);
         self
     }
 
+    /// Enables the `reload` admin command, which applies the tunables loaded
+    /// by the reloader to the running threads, such as the timeout and the
+    /// number of events of the worker and storage threads, and the eviction
+    /// policy of the storage.
+    pub fn reloader(mut self, reloader: Reloader) -> Self {
+        self.admin.reloader(reloader);
+        self
+    }
+
     pub fn spawn(self) -> Process {
-        let mut thread_wakers = vec![self.listener.waker()];
+        let mut thread_wakers: Vec<Arc<Waker>> = self.listener.iter().map(|l| l.waker()).collect();
         thread_wakers.extend_from_slice(&self.workers.wakers());
 
+        // the listening sockets which are handed to a newer process on an
+        // upgrade
+        let fds = self.listener.as_ref().map(|l| l.fds()).unwrap_or_default();
+
         // channel for the parent `Process` to send `Signal`s to the admin thread
         let (signal_tx, signal_rx) = bounded(QUEUE_CAPACITY);
 
         // queues for the `Admin` to send `Signal`s to all sibling threads
         let (mut signal_queue_tx, mut signal_queue_rx) =
-            Queues::new(vec![self.admin.waker()], thread_wakers, QUEUE_CAPACITY);
-
-        // queues for the `Listener` to send `Session`s to the worker threads
-        let (mut listener_session_queues, worker_session_queues) = Queues::new(
-            vec![self.listener.waker()],
-            self.workers.worker_wakers(),
-            QUEUE_CAPACITY,
-        );
+            queues(vec![self.admin.waker()], thread_wakers, QUEUE_CAPACITY);
 
         let mut admin = self
             .admin
             .build(self.log_drain, signal_rx, signal_queue_tx.remove(0));
 
-        let mut listener = self
-            .listener
-            .build(signal_queue_rx.remove(0), listener_session_queues.remove(0));
+        // queues for the `Listener` to send `Session`s to the worker threads,
+        // the listener's signal queue precedes those of the workers
+        let (listener, worker_session_queues) = match self.listener {
+            Some(listener) => {
+                let (mut listener_session_queues, worker_session_queues) = queues(
+                    vec![listener.waker()],
+                    self.workers.worker_wakers(),
+                    QUEUE_CAPACITY,
+                );
+
+                let listener =
+                    listener.build(signal_queue_rx.remove(0), listener_session_queues.remove(0));
+
+                (Some(listener), worker_session_queues)
+            }
+            None => (None, Vec::new()),
+        };
 
         let workers = self.workers.build(worker_session_queues, signal_queue_rx);
 
+        let admin_core = self.admin_core;
         let admin = std::thread::Builder::new()
             .name(format!("{THREAD_PREFIX}_admin"))
-            .spawn(move || admin.run())
+            .spawn(move || {
+                affinity::pin(admin_core);
+                admin.run()
+            })
             .unwrap();
 
-        let listener = std::thread::Builder::new()
-            .name(format!("{THREAD_PREFIX}_listener"))
-            .spawn(move || listener.run())
-            .unwrap();
+        let listener_core = self.listener_core;
+        let listener = listener.map(|mut listener| {
+            std::thread::Builder::new()
+                .name(format!("{THREAD_PREFIX}_listener"))
+                .spawn(move || {
+                    affinity::pin(listener_core);
+                    listener.run()
+                })
+                .unwrap()
+        });
 
         let workers = workers.spawn();
+
+        // like the signal handler below, the replication threads are not
+        // joined. The thread of a primary exits once the storage threads have,
+        // and the thread of a replica may be blocked reading from the primary.
+        if let Some(mut primary) = self.primary {
+            let _ = std::thread::Builder::new()
+                .name(format!("{THREAD_PREFIX}_replication"))
+                .spawn(move || primary.run());
+        }
+        if let Some(mut replica) = self.replica {
+            let _ = std::thread::Builder::new()
+                .name(format!("{THREAD_PREFIX}_replica"))
+                .spawn(move || replica.run());
+        }
+
+        // the upgrade thread is not joined either, as it blocks until a newer
+        // process connects
+        if let Some(upgrade) = self.upgrade {
+            let signal_tx = signal_tx.clone();
+            let _ = std::thread::Builder::new()
+                .name(format!("{THREAD_PREFIX}_upgrade"))
+                .spawn(move || upgrade.run(fds, signal_tx));
+        }
+
         let cloned_signal_tx = signal_tx.clone();
 
         // NOTE: Signal handler join handle is not taken ownership of by [Process] as it's
@@ -105,7 +326,7 @@ where
 
 pub struct Process {
     admin: JoinHandle<()>,
-    listener: JoinHandle<()>,
+    listener: Option<JoinHandle<()>>,
     signal_tx: Sender<Signal>,
     workers: Vec<JoinHandle<()>>,
 }
@@ -158,7 +379,9 @@ impl Process {
         for thread in self.workers {
             let _ = thread.join();
         }
-        let _ = self.listener.join();
+        if let Some(listener) = self.listener {
+            let _ = listener.join();
+        }
         let _ = self.admin.join();
     }
 }
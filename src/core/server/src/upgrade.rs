@@ -0,0 +1,229 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Handoff of the listening sockets from a running process to a newer one, so
+//! that a binary can be upgraded without refusing connections.
+//!
+//! A process with an upgrade socket in its server config listens on it. A
+//! newer process started with the same config connects to it before doing
+//! anything else, and the older process passes the file descriptors of its
+//! listening sockets with `SCM_RIGHTS` and then shuts down, which saves the
+//! storage if it is file backed. The newer process waits for the older one to
+//! exit, which closes the connection, before it restores the storage and
+//! binds its other sockets. Connections which arrive in the meantime are held
+//! in the backlog of the inherited sockets rather than refused. Sessions which
+//! are open on the older process are closed as it exits.
+
+use crate::*;
+use std::io::Read;
+use std::net::SocketAddr;
+use std::os::unix::net::{UnixListener, UnixStream};
+use std::os::unix::prelude::{AsRawFd, FromRawFd, RawFd};
+use std::sync::Mutex;
+
+// the most listening sockets which are passed in one handoff
+const MAX_FDS: usize = 16;
+
+// the listening sockets inherited from an older process, which are taken by
+// address as the listeners are bound
+static INHERITED: Mutex<Vec<std::net::TcpListener>> = Mutex::new(Vec::new());
+
+/// Takes over the listening sockets of an older process listening on the
+/// upgrade socket in the config, and waits for it to exit. This must be
+/// called before the storage is created, so that the storage saved by the
+/// older process is restored. Does nothing without an upgrade socket in the
+/// config, or if no process is listening on it.
+pub fn inherit<T: ServerConfig>(config: &T) -> Result<()> {
+    let Some(path) = config.server().upgrade_socket() else {
+        return Ok(());
+    };
+
+    let mut stream = match UnixStream::connect(path) {
+        Ok(stream) => stream,
+        Err(e) if matches!(e.kind(), ErrorKind::NotFound | ErrorKind::ConnectionRefused) => {
+            return Ok(());
+        }
+        Err(e) => return Err(e),
+    };
+
+    let fds = recv_fds(&stream)?;
+    let mut inherited = INHERITED.lock().unwrap();
+    for fd in fds {
+        // the descriptors are now owned by this process
+        let listener = unsafe { std::net::TcpListener::from_raw_fd(fd) };
+        if listener.local_addr().is_ok() {
+            inherited.push(listener);
+        }
+    }
+    info!(
+        "inherited {} listeners, waiting for the previous process to exit",
+        inherited.len()
+    );
+
+    // the older process keeps its end open until it exits
+    let mut buf = [0; 1];
+    while stream.read(&mut buf)? > 0 {}
+
+    Ok(())
+}
+
+/// Returns the inherited listening socket for the address, if there is one.
+pub(crate) fn take(addr: SocketAddr) -> Option<std::net::TcpListener> {
+    let mut inherited = INHERITED.lock().unwrap();
+    let index = inherited
+        .iter()
+        .position(|listener| listener.local_addr().ok() == Some(addr))?;
+    Some(inherited.swap_remove(index))
+}
+
+/// Binds a TCP listener for the address, unless one was inherited.
+pub(crate) fn bind(addr: SocketAddr) -> Result<TcpListener> {
+    match take(addr) {
+        Some(listener) => TcpListener::from_std(listener),
+        None => TcpListener::bind(addr),
+    }
+}
+
+/// The upgrade socket of a running process, which hands its listening sockets
+/// to the first newer process which connects.
+pub(crate) struct Upgrade {
+    listener: UnixListener,
+}
+
+impl Upgrade {
+    /// Binds the upgrade socket in the config, if there is one. A socket left
+    /// at the path by an older process is replaced.
+    pub(crate) fn bind<T: ServerConfig>(config: &T) -> Result<Option<Self>> {
+        let Some(path) = config.server().upgrade_socket() else {
+            return Ok(None);
+        };
+
+        match std::fs::remove_file(path) {
+            Err(e) if e.kind() != ErrorKind::NotFound => return Err(e),
+            _ => {}
+        }
+
+        Ok(Some(Self {
+            listener: UnixListener::bind(path)?,
+        }))
+    }
+
+    /// Waits for a newer process to connect, passes it the listening sockets
+    /// and shuts this process down.
+    pub(crate) fn run(self, fds: Vec<RawFd>, signal_tx: Sender<Signal>) {
+        for stream in self.listener.incoming() {
+            let stream = match stream {
+                Ok(stream) => stream,
+                Err(e) => {
+                    error!("error accepting on the upgrade socket: {}", e);
+                    continue;
+                }
+            };
+
+            if let Err(e) = send_fds(&stream, &fds) {
+                error!("error handing off the listeners: {}", e);
+                continue;
+            }
+
+            info!("handed off {} listeners, shutting down", fds.len());
+            let _ = signal_tx.try_send(Signal::Shutdown);
+
+            // the connection is closed as this process exits, which tells the
+            // newer process the storage has been saved
+            std::mem::forget(stream);
+            return;
+        }
+    }
+}
+
+fn send_fds(stream: &UnixStream, fds: &[RawFd]) -> Result<()> {
+    let fds = &fds[..fds.len().min(MAX_FDS)];
+    let len = std::mem::size_of_val(fds);
+
+    let mut byte = [0u8; 1];
+    let mut iov = libc::iovec {
+        iov_base: byte.as_mut_ptr() as *mut libc::c_void,
+        iov_len: byte.len(),
+    };
+    let space = unsafe { libc::CMSG_SPACE(len as _) } as usize;
+    let mut control = vec![0u8; space];
+
+    let mut msg: libc::msghdr = unsafe { std::mem::zeroed() };
+    msg.msg_iov = &mut iov;
+    msg.msg_iovlen = 1;
+    if !fds.is_empty() {
+        msg.msg_control = control.as_mut_ptr() as *mut libc::c_void;
+        msg.msg_controllen = space as _;
+
+        unsafe {
+            let cmsg = libc::CMSG_FIRSTHDR(&msg);
+            (*cmsg).cmsg_level = libc::SOL_SOCKET;
+            (*cmsg).cmsg_type = libc::SCM_RIGHTS;
+            (*cmsg).cmsg_len = libc::CMSG_LEN(len as _) as _;
+            std::ptr::copy_nonoverlapping(fds.as_ptr() as *const u8, libc::CMSG_DATA(cmsg), len);
+        }
+    }
+
+    if unsafe { libc::sendmsg(stream.as_raw_fd(), &msg, 0) } < 0 {
+        return Err(Error::last_os_error());
+    }
+
+    Ok(())
+}
+
+fn recv_fds(stream: &UnixStream) -> Result<Vec<RawFd>> {
+    let mut byte = [0u8; 1];
+    let mut iov = libc::iovec {
+        iov_base: byte.as_mut_ptr() as *mut libc::c_void,
+        iov_len: byte.len(),
+    };
+    let space = unsafe { libc::CMSG_SPACE((MAX_FDS * std::mem::size_of::<RawFd>()) as _) } as usize;
+    let mut control = vec![0u8; space];
+
+    let mut msg: libc::msghdr = unsafe { std::mem::zeroed() };
+    msg.msg_iov = &mut iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.as_mut_ptr() as *mut libc::c_void;
+    msg.msg_controllen = space as _;
+
+    if unsafe { libc::recvmsg(stream.as_raw_fd(), &mut msg, libc::MSG_CMSG_CLOEXEC) } < 0 {
+        return Err(Error::last_os_error());
+    }
+
+    let mut fds = Vec::new();
+    unsafe {
+        let mut cmsg = libc::CMSG_FIRSTHDR(&msg);
+        while !cmsg.is_null() {
+            if (*cmsg).cmsg_level == libc::SOL_SOCKET && (*cmsg).cmsg_type == libc::SCM_RIGHTS {
+                let len = (*cmsg).cmsg_len as usize - libc::CMSG_LEN(0) as usize;
+                let data = libc::CMSG_DATA(cmsg) as *const RawFd;
+                for i in 0..len / std::mem::size_of::<RawFd>() {
+                    fds.push(std::ptr::read_unaligned(data.add(i)));
+                }
+            }
+            cmsg = libc::CMSG_NXTHDR(&msg, cmsg);
+        }
+    }
+
+    Ok(fds)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn handoff() {
+        let (a, b) = UnixStream::pair().unwrap();
+        let listener = std::net::TcpListener::bind("127.0.0.1:0").unwrap();
+        let addr = listener.local_addr().unwrap();
+
+        send_fds(&a, &[listener.as_raw_fd()]).unwrap();
+        let fds = recv_fds(&b).unwrap();
+        assert_eq!(fds.len(), 1);
+
+        let inherited = unsafe { std::net::TcpListener::from_raw_fd(fds[0]) };
+        assert_eq!(inherited.local_addr().unwrap(), addr);
+    }
+}
@@ -0,0 +1,37 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Static tracepoints (USDT probes) on the request path of the workers,
+//! enabled with the `usdt` feature. Each probe is a `nop` and an ELF note
+//! which tracers use to find it, so it costs next to nothing until a tracer
+//! attaches, for example:
+//!
+//! ```text
+//! bpftrace -e 'usdt:./pelikan_segcache_rs:pelikan:execute_end {
+//!     @batch = hist(arg0); @ns = hist(arg1); }'
+//! ```
+//!
+//! Without the feature probes compile to nothing and their arguments are not
+//! evaluated. The probes, in the `pelikan` provider, are:
+//!
+//! * `request_parse(session)` for each request parsed from a session
+//! * `execute_begin(requests)` and `execute_end(requests, ns)` around the
+//!   execution of each batch of requests by the storage
+//! * `session_flush(session, bytes)` before a session's pending bytes are
+//!   flushed to its socket
+//!
+//! Sessions are identified by their token, which is unique among the sessions
+//! of a worker thread.
+
+#[cfg(feature = "usdt")]
+macro_rules! usdt {
+    ($name:ident $(, $arg:expr)* $(,)?) => {
+        probe::probe!(pelikan, $name $(, $arg)*)
+    };
+}
+
+#[cfg(not(feature = "usdt"))]
+macro_rules! usdt {
+    ($name:ident $(, $arg:expr)* $(,)?) => {};
+}
@@ -0,0 +1,131 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The CPU cycles spent parsing, executing and composing each command.
+//!
+//! When enabled, each thread reads the timestamp counter around each phase of
+//! handling a request and sums the cycles into a table local to the thread,
+//! keyed by the counters of the command. The table is added to the shared
+//! counters once per event loop iteration, so the shared cachelines are
+//! written once for each command handled in the iteration rather than once
+//! for each request and phase. On targets without a timestamp counter,
+//! nanoseconds of a monotonic clock are counted instead.
+
+use protocol_common::{Cycles, Timed};
+
+#[cfg(not(target_arch = "x86_64"))]
+use std::sync::OnceLock;
+#[cfg(not(target_arch = "x86_64"))]
+use std::time::Instant;
+
+const PARSE: usize = 0;
+const EXECUTE: usize = 1;
+const COMPOSE: usize = 2;
+
+/// Reads the timestamp counter.
+#[cfg(target_arch = "x86_64")]
+#[inline]
+pub fn now() -> u64 {
+    // SAFETY: rdtsc is available on all x86_64 processors
+    unsafe { core::arch::x86_64::_rdtsc() }
+}
+
+/// Reads a monotonic clock in nanoseconds, as there is no timestamp counter.
+#[cfg(not(target_arch = "x86_64"))]
+#[inline]
+pub fn now() -> u64 {
+    static EPOCH: OnceLock<Instant> = OnceLock::new();
+    EPOCH.get_or_init(Instant::now).elapsed().as_nanos() as u64
+}
+
+/// The cycles of each phase for the commands handled by one thread since the
+/// counts were last flushed to the shared counters.
+pub struct CycleCounts {
+    enabled: bool,
+    counts: Vec<(&'static Cycles, [u64; 3])>,
+}
+
+impl CycleCounts {
+    pub fn new(enabled: bool) -> Self {
+        Self {
+            enabled,
+            counts: Vec::new(),
+        }
+    }
+
+    /// Returns the timestamp at which a phase starts, or zero if cycles are
+    /// not being counted.
+    #[inline]
+    pub fn start(&self) -> u64 {
+        if self.enabled {
+            now()
+        } else {
+            0
+        }
+    }
+
+    /// Counts the cycles since `start` as spent parsing the request.
+    #[inline]
+    pub fn parse<Request: Timed>(&mut self, request: &Request, start: u64) {
+        if self.enabled {
+            self.add(
+                &request.latencies().cycles,
+                PARSE,
+                now().wrapping_sub(start),
+            );
+        }
+    }
+
+    /// Counts the cycles since `start` as spent composing and sending the
+    /// response to the request.
+    #[inline]
+    pub fn compose<Request: Timed>(&mut self, request: &Request, start: u64) {
+        if self.enabled {
+            self.add(
+                &request.latencies().cycles,
+                COMPOSE,
+                now().wrapping_sub(start),
+            );
+        }
+    }
+
+    /// Counts the cycles since `start` as spent executing the requests, which
+    /// were executed together, so the cycles are shared evenly between them.
+    pub fn execute<Request: Timed>(&mut self, requests: &[Request], start: u64) {
+        if !self.enabled || requests.is_empty() {
+            return;
+        }
+
+        let cycles = now().wrapping_sub(start) / requests.len() as u64;
+        for request in requests {
+            self.add(&request.latencies().cycles, EXECUTE, cycles);
+        }
+    }
+
+    /// Adds the counts to the shared counters and clears them.
+    pub fn flush(&mut self) {
+        for (cycles, counts) in self.counts.drain(..) {
+            cycles.parse.add(counts[PARSE]);
+            cycles.execute.add(counts[EXECUTE]);
+            cycles.compose.add(counts[COMPOSE]);
+        }
+    }
+
+    // There are a handful of distinct commands in most iterations, so a scan
+    // of the few entries is cheaper than hashing.
+    fn add(&mut self, cycles: &'static Cycles, phase: usize, count: u64) {
+        match self
+            .counts
+            .iter_mut()
+            .find(|(c, _)| core::ptr::eq(*c, cycles))
+        {
+            Some((_, counts)) => counts[phase] += count,
+            None => {
+                let mut counts = [0; 3];
+                counts[phase] = count;
+                self.counts.push((cycles, counts));
+            }
+        }
+    }
+}
@@ -0,0 +1,282 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Copies of the values of hot keys, which the worker threads serve reads
+//! from without sending them to the storage threads.
+//!
+//! With storage threads, every read of a key is executed by the storage thread
+//! which owns it, so a key which takes a large share of the requests keeps
+//! that one thread busy while the others idle. Once a storage thread finds
+//! that a read hit one of the hottest keys it has sampled, it keeps a copy of
+//! the value, and a worker which receives a read of the key answers it from
+//! the copy instead. A storage thread drops its copy of a key as soon as it
+//! executes a write to it, before the response to the write is sent, so a
+//! read which is sent after a write has been answered never sees the value
+//! from before the write.
+//!
+//! Copies live for `HOT_COPY_LIFETIME`, after which reads of the key go to
+//! the storage thread again, and a copy is made anew if the key is still hot.
+//! This bounds how long a copy is served once its item has expired or been
+//! evicted, which does not drop the copy. It also keeps the sampling going,
+//! as the reads served from copies are not sampled.
+
+use super::*;
+use std::collections::HashMap;
+use std::sync::RwLock;
+
+/// How long a copy is served for.
+const HOT_COPY_LIFETIME: Duration = Duration::from_millis(100);
+
+#[metric(
+    name = "hot_copy_hit",
+    description = "the number of reads answered by the workers from copies of the values of hot keys"
+)]
+pub static HOT_COPY_HIT: Counter = Counter::new();
+
+#[metric(
+    name = "hot_copy_insert",
+    description = "the number of copies of the values of hot keys made by the storage threads"
+)]
+pub static HOT_COPY_INSERT: Counter = Counter::new();
+
+#[metric(
+    name = "hot_copy_invalidate",
+    description = "the number of copies of the values of hot keys dropped as their keys were written"
+)]
+pub static HOT_COPY_INVALIDATE: Counter = Counter::new();
+
+/// The copies made by one storage thread, only ever changed by that thread.
+struct Copies {
+    // the number of copies held, so that lookups skip the lock while there
+    // are none
+    len: AtomicUsize,
+    copies: RwLock<HashMap<Box<[u8]>, (HotCopy, Instant)>>,
+}
+
+/// The copies of the values of hot keys, for each storage thread.
+pub struct HotCopies {
+    max: usize,
+    shards: Box<[Copies]>,
+}
+
+impl HotCopies {
+    /// Returns the copies for the provided number of storage threads, or
+    /// `None` if the config keeps no copies.
+    pub fn new<T: WorkerConfig>(config: &T, shards: usize) -> Option<Arc<Self>> {
+        match config.worker().hot_copies() {
+            0 => None,
+            max => Some(Arc::new(Self::with_max(max, shards))),
+        }
+    }
+
+    fn with_max(max: usize, shards: usize) -> Self {
+        let shards = (0..shards)
+            .map(|_| Copies {
+                len: AtomicUsize::new(0),
+                copies: RwLock::new(HashMap::with_capacity(max)),
+            })
+            .collect();
+
+        Self { max, shards }
+    }
+
+    /// Returns the copy of the value of the key held by the storage thread,
+    /// if it has not outlived its lifetime.
+    pub fn get(&self, shard: usize, key: &[u8]) -> Option<HotCopy> {
+        let shard = &self.shards[shard];
+        if shard.len.load(Ordering::Relaxed) == 0 {
+            return None;
+        }
+
+        let copies = shard.copies.read().ok()?;
+        let (copy, expires) = copies.get(key)?;
+        (Instant::now() < *expires).then(|| copy.clone())
+    }
+
+    /// Returns the handle through which a storage thread changes its copies.
+    pub fn shard(self: &Arc<Self>, shard: usize) -> HotShard {
+        HotShard {
+            copies: self.clone(),
+            shard,
+            purge: Instant::now() + HOT_COPY_LIFETIME,
+        }
+    }
+}
+
+/// The copies of one storage thread, as changed by that thread.
+pub struct HotShard {
+    copies: Arc<HotCopies>,
+    shard: usize,
+    // when copies which have outlived their lifetime are next dropped
+    purge: Instant,
+}
+
+impl HotShard {
+    /// Drops the copies of the keys written by a batch of requests, and makes
+    /// copies of the values read for hot keys, in the order the requests were
+    /// executed. This is done before the responses are sent.
+    pub fn update<Request, Response, Storage>(
+        &mut self,
+        storage: &mut Storage,
+        requests: &[Request],
+        responses: &[Response],
+    ) where
+        Request: Shard<Response> + Track<Response>,
+        Storage: EntryStore,
+    {
+        let max = self.copies.max;
+        let shard = &self.copies.shards[self.shard];
+
+        // the lock is only taken once something changes, and then held for
+        // the rest of the batch
+        let mut held = None;
+        let now = Instant::now();
+
+        for (request, response) in requests.iter().zip(responses.iter()) {
+            if held.is_some() || shard.len.load(Ordering::Relaxed) > 0 {
+                let copies = held.get_or_insert_with(|| shard.copies.write().unwrap());
+                request.writes(&mut |key| {
+                    if copies.remove(key).is_some() {
+                        HOT_COPY_INVALIDATE.increment();
+                    }
+                });
+            }
+
+            let Some(key) = request.hot_key() else {
+                continue;
+            };
+            let Some(copy) = request.hot_copy(response) else {
+                continue;
+            };
+            if !storage.is_hot(key) {
+                continue;
+            }
+
+            let copies = held.get_or_insert_with(|| shard.copies.write().unwrap());
+            if copies.len() >= max && !copies.contains_key(key) {
+                copies.retain(|_, (_, expires)| now < *expires);
+                if copies.len() >= max {
+                    continue;
+                }
+            }
+            copies.insert(key.into(), (copy, now + HOT_COPY_LIFETIME));
+            HOT_COPY_INSERT.increment();
+        }
+
+        if let Some(copies) = held {
+            shard.len.store(copies.len(), Ordering::Relaxed);
+        }
+    }
+
+    /// Drops the copies which have outlived their lifetime, at most once in
+    /// each lifetime, so that lookups skip the lock once no key is hot.
+    pub fn maintain(&mut self) {
+        let shard = &self.copies.shards[self.shard];
+        if shard.len.load(Ordering::Relaxed) == 0 {
+            return;
+        }
+
+        let now = Instant::now();
+        if now < self.purge {
+            return;
+        }
+        self.purge = now + HOT_COPY_LIFETIME;
+
+        let mut copies = shard.copies.write().unwrap();
+        copies.retain(|_, (_, expires)| now < *expires);
+        shard.len.store(copies.len(), Ordering::Relaxed);
+    }
+
+    /// Drops every copy, such as once the storage thread has removed or
+    /// invalidated items without executing writes to their keys.
+    pub fn clear(&mut self) {
+        let shard = &self.copies.shards[self.shard];
+        let mut copies = shard.copies.write().unwrap();
+        copies.clear();
+        shard.len.store(0, Ordering::Relaxed);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    // finds every key hot
+    struct Hot;
+
+    impl EntryStore for Hot {
+        fn clear(&mut self) {}
+
+        fn is_hot(&mut self, _key: &[u8]) -> bool {
+            true
+        }
+    }
+
+    // the response to a get is the value found, if any
+    enum Request {
+        Get(&'static [u8]),
+        Set(&'static [u8]),
+    }
+
+    type Response = Option<&'static [u8]>;
+
+    impl Shard<Response> for Request {
+        fn hot_key(&self) -> Option<&[u8]> {
+            match self {
+                Self::Get(key) => Some(key),
+                Self::Set(_) => None,
+            }
+        }
+
+        fn hot_copy(&self, response: &Response) -> Option<HotCopy> {
+            response.map(|value| HotCopy {
+                data: Arc::new(value),
+                flags: 0,
+            })
+        }
+    }
+
+    impl Track<Response> for Request {
+        fn writes(&self, f: &mut dyn FnMut(&[u8])) {
+            if let Self::Set(key) = self {
+                f(key)
+            }
+        }
+    }
+
+    fn value(copies: &HotCopies, key: &[u8]) -> Option<Vec<u8>> {
+        copies
+            .get(0, key)
+            .map(|copy| (*copy.data).as_ref().to_vec())
+    }
+
+    #[test]
+    fn update() {
+        let copies = Arc::new(HotCopies::with_max(1, 1));
+        let mut shard = copies.shard(0);
+
+        // only values which were found are copied
+        shard.update(&mut Hot, &[Request::Get(b"a")], &[None]);
+        assert!(value(&copies, b"a").is_none());
+        shard.update(&mut Hot, &[Request::Get(b"a")], &[Some(b"1")]);
+        assert_eq!(value(&copies, b"a"), Some(b"1".to_vec()));
+
+        // a write drops the copy, and a read after it copies the new value
+        shard.update(&mut Hot, &[Request::Set(b"a")], &[None]);
+        assert!(value(&copies, b"a").is_none());
+        shard.update(
+            &mut Hot,
+            &[Request::Set(b"a"), Request::Get(b"a")],
+            &[None, Some(b"2")],
+        );
+        assert_eq!(value(&copies, b"a"), Some(b"2".to_vec()));
+
+        // no more than the most copies are kept
+        shard.update(&mut Hot, &[Request::Get(b"b")], &[Some(b"3")]);
+        assert!(value(&copies, b"b").is_none());
+
+        shard.clear();
+        assert!(value(&copies, b"a").is_none());
+    }
+}
@@ -0,0 +1,302 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Limits on the rate at which the worker threads take requests from each
+//! session, and from all of the sessions of each client, so that a client
+//! which sends requests in a tight loop cannot take the workers and the
+//! storage threads from the others.
+//!
+//! Each limit is a token bucket, which holds up to a burst of requests and
+//! refills at the rate. A session whose own bucket, or that of its client, is
+//! empty has its requests left unread in its buffer, and is put aside until
+//! the bucket has refilled. Clients are told apart by the IP address they
+//! connect from, and the sessions of a client share one bucket across all of
+//! the worker threads. Sessions over unix sockets have no client limit.
+
+use super::*;
+use std::collections::HashMap;
+use std::net::IpAddr;
+use std::sync::Mutex;
+
+#[metric(
+    name = "worker_throttle_session",
+    description = "the number of times reading from a session was put off as it was over its rate limit"
+)]
+pub static WORKER_THROTTLE_SESSION: Counter = Counter::new();
+
+#[metric(
+    name = "worker_throttle_client",
+    description = "the number of times reading from a session was put off as its client was over its rate limit"
+)]
+pub static WORKER_THROTTLE_CLIENT: Counter = Counter::new();
+
+#[metric(
+    name = "worker_client_limited",
+    description = "the number of clients with sessions open whose requests are rate limited"
+)]
+pub static WORKER_CLIENT_LIMITED: Gauge = Gauge::new();
+
+/// The rate at which a bucket refills, and the most requests it holds.
+#[derive(Clone, Copy)]
+struct Rate {
+    per_sec: f64,
+    burst: f64,
+}
+
+impl Rate {
+    /// Returns the rate for the config, or `None` if the rate is zero. A burst
+    /// of zero is one second of the rate.
+    fn new(rate: usize, burst: usize) -> Option<Self> {
+        let burst = if burst == 0 { rate } else { burst };
+        (rate > 0).then(|| Self {
+            per_sec: rate as f64,
+            burst: burst as f64,
+        })
+    }
+}
+
+/// A token bucket, holding the number of requests which may be taken now.
+struct Bucket {
+    tokens: f64,
+    refilled: Instant,
+}
+
+impl Bucket {
+    fn new(rate: &Rate) -> Self {
+        Self {
+            tokens: rate.burst,
+            refilled: Instant::now(),
+        }
+    }
+
+    /// Refills the bucket for the time since it was last refilled, and returns
+    /// true if it holds a request.
+    fn ready(&mut self, rate: &Rate, now: Instant) -> bool {
+        let elapsed = now.saturating_duration_since(self.refilled).as_secs_f64();
+        self.tokens = (self.tokens + elapsed * rate.per_sec).min(rate.burst);
+        self.refilled = now;
+        self.tokens >= 1.0
+    }
+
+    /// Takes a request from the bucket. The bucket of a client may be taken
+    /// from by several sessions at once, so it may briefly go below empty.
+    fn take(&mut self) {
+        self.tokens -= 1.0;
+    }
+}
+
+/// The buckets of the clients which have sessions open, shared by the worker
+/// threads.
+struct Clients {
+    rate: Rate,
+    buckets: Mutex<HashMap<IpAddr, Arc<Mutex<Bucket>>>>,
+}
+
+/// The rate limits of the sessions, cloned for each worker thread so that
+/// they share the buckets of the clients.
+#[derive(Clone, Default)]
+pub struct Limits {
+    session: Option<Rate>,
+    clients: Option<Arc<Clients>>,
+}
+
+impl Limits {
+    pub fn new<T: WorkerConfig>(config: &T) -> Self {
+        let config = config.worker();
+
+        Self {
+            session: Rate::new(config.session_rate(), config.session_burst()),
+            clients: Rate::new(config.client_rate(), config.client_burst()).map(|rate| {
+                Arc::new(Clients {
+                    rate,
+                    buckets: Mutex::new(HashMap::new()),
+                })
+            }),
+        }
+    }
+
+    /// Returns the limit for a session which connected from the address.
+    pub fn session(&self, peer: Option<IpAddr>) -> Limit {
+        let client = self.clients.as_ref().zip(peer).map(|(clients, ip)| {
+            let mut buckets = clients.buckets.lock().unwrap();
+            let bucket = buckets
+                .entry(ip)
+                .or_insert_with(|| {
+                    WORKER_CLIENT_LIMITED.increment();
+                    Arc::new(Mutex::new(Bucket::new(&clients.rate)))
+                })
+                .clone();
+            ClientLimit {
+                clients: clients.clone(),
+                ip,
+                bucket,
+            }
+        });
+
+        Limit {
+            session: self.session.map(|rate| (rate, Bucket::new(&rate))),
+            client,
+        }
+    }
+}
+
+/// The share of a client's bucket held by one of its sessions. The bucket is
+/// dropped along with the last session of the client.
+struct ClientLimit {
+    clients: Arc<Clients>,
+    ip: IpAddr,
+    bucket: Arc<Mutex<Bucket>>,
+}
+
+impl Drop for ClientLimit {
+    fn drop(&mut self) {
+        // the buckets are only shared while the lock is held, so a bucket held
+        // only by the map and by this session is not shared by any other
+        let mut buckets = self.clients.buckets.lock().unwrap();
+        if Arc::strong_count(&self.bucket) == 2 {
+            buckets.remove(&self.ip);
+            WORKER_CLIENT_LIMITED.decrement();
+        }
+    }
+}
+
+/// The rate limit of one session, and that of its client.
+#[derive(Default)]
+pub struct Limit {
+    session: Option<(Rate, Bucket)>,
+    client: Option<ClientLimit>,
+}
+
+impl Limit {
+    /// Returns true if a request may be taken from the session now.
+    pub fn ready(&mut self) -> bool {
+        if self.session.is_none() && self.client.is_none() {
+            return true;
+        }
+
+        let now = Instant::now();
+        if let Some((rate, bucket)) = &mut self.session {
+            if !bucket.ready(rate, now) {
+                WORKER_THROTTLE_SESSION.increment();
+                return false;
+            }
+        }
+        if let Some(client) = &self.client {
+            if !client
+                .bucket
+                .lock()
+                .unwrap()
+                .ready(&client.clients.rate, now)
+            {
+                WORKER_THROTTLE_CLIENT.increment();
+                return false;
+            }
+        }
+
+        true
+    }
+
+    /// Takes a request which was read from the session from the buckets.
+    pub fn take(&mut self) {
+        if let Some((_, bucket)) = &mut self.session {
+            bucket.take();
+        }
+        if let Some(client) = &self.client {
+            client.bucket.lock().unwrap().take();
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn limits(session: Option<Rate>, client: Option<Rate>) -> Limits {
+        Limits {
+            session,
+            clients: client.map(|rate| {
+                Arc::new(Clients {
+                    rate,
+                    buckets: Mutex::new(HashMap::new()),
+                })
+            }),
+        }
+    }
+
+    // takes requests from the limit until it is not ready
+    fn drain(limit: &mut Limit) -> usize {
+        let mut taken = 0;
+        while limit.ready() && taken < 1000 {
+            limit.take();
+            taken += 1;
+        }
+        taken
+    }
+
+    #[test]
+    fn bucket() {
+        let rate = Rate::new(1000, 10).unwrap();
+        let mut bucket = Bucket::new(&rate);
+        let start = bucket.refilled;
+
+        // a full bucket holds the burst
+        for _ in 0..10 {
+            assert!(bucket.ready(&rate, start));
+            bucket.take();
+        }
+        assert!(!bucket.ready(&rate, start));
+
+        // and refills at the rate, up to the burst
+        assert!(!bucket.ready(&rate, start + Duration::from_micros(500)));
+        assert!(bucket.ready(&rate, start + Duration::from_millis(1)));
+        assert!(bucket.ready(&rate, start + Duration::from_secs(60)));
+        assert_eq!(bucket.tokens, 10.0);
+
+        // a burst of zero is one second of the rate
+        assert!(Rate::new(0, 10).is_none());
+        assert_eq!(Rate::new(1000, 0).unwrap().burst, 1000.0);
+    }
+
+    #[test]
+    fn limit() {
+        let ip: IpAddr = "127.0.0.1".parse().unwrap();
+        let other: IpAddr = "127.0.0.2".parse().unwrap();
+
+        // without limits, every request is taken
+        let mut limit = Limits::default().session(Some(ip));
+        assert_eq!(drain(&mut limit), 1000);
+
+        // each session has its own bucket
+        let limits = limits(Rate::new(1, 5), None);
+        assert_eq!(drain(&mut limits.session(Some(ip))), 5);
+        assert_eq!(drain(&mut limits.session(Some(ip))), 5);
+
+        // the sessions of a client share its bucket, which is dropped with the
+        // last of them
+        let limits = self::limits(None, Rate::new(1, 5));
+        let mut a = limits.session(Some(ip));
+        let mut b = limits.session(Some(ip));
+        assert_eq!(drain(&mut a), 5);
+        assert_eq!(drain(&mut b), 0);
+        assert_eq!(drain(&mut limits.session(Some(other))), 5);
+        assert_eq!(drain(&mut limits.session(None)), 1000);
+
+        let buckets = || {
+            limits
+                .clients
+                .as_ref()
+                .unwrap()
+                .buckets
+                .lock()
+                .unwrap()
+                .len()
+        };
+        assert_eq!(buckets(), 1);
+        drop(a);
+        assert_eq!(buckets(), 1);
+        drop(b);
+        assert_eq!(buckets(), 0);
+        assert_eq!(drain(&mut limits.session(Some(ip))), 5);
+    }
+}
@@ -3,15 +3,30 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use crate::*;
+use std::sync::atomic::{fence, AtomicBool, AtomicU64, AtomicUsize, Ordering};
 use std::thread::JoinHandle;
+use std::time::Instant;
 
+mod cycles;
+mod hot;
+mod limit;
 mod multi;
+mod replication;
 mod single;
 mod storage;
+mod tracking;
+mod udp;
 
+use cycles::*;
+use hot::*;
+use limit::*;
 use multi::*;
 use single::*;
 use storage::*;
+use tracking::*;
+use udp::*;
+
+pub use replication::{Primary, Replica};
 
 #[metric(
     name = "worker_event_depth",
@@ -19,6 +34,48 @@ use storage::*;
 )]
 pub static WORKER_EVENT_DEPTH: AtomicHistogram = AtomicHistogram::new(7, 17);
 
+#[metric(
+    name = "worker_flush_requests",
+    description = "distribution of the number of requests whose responses are written by each flush after a read"
+)]
+pub static WORKER_FLUSH_REQUESTS: AtomicHistogram = AtomicHistogram::new(7, 17);
+
+#[metric(
+    name = "queue_wake_suppressed",
+    description = "the number of wakes skipped as the threads on the other side of the data queue were not parked"
+)]
+pub static QUEUE_WAKE_SUPPRESSED: Counter = Counter::new();
+
+#[metric(
+    name = "worker_session_move",
+    description = "the number of sessions handed to a less loaded worker"
+)]
+pub static WORKER_SESSION_MOVE: Counter = Counter::new();
+
+#[metric(
+    name = "worker_ingest",
+    description = "the number of values read from sessions straight into storage"
+)]
+pub static WORKER_INGEST: Counter = Counter::new();
+
+#[metric(
+    name = "worker_shed_inflight",
+    description = "the number of reads from sessions put off as the limit of requests in flight to the storage threads was reached"
+)]
+pub static WORKER_SHED_INFLIGHT: Counter = Counter::new();
+
+#[metric(
+    name = "worker_stream",
+    description = "the number of reads of many keys which were split into chunks written out one after another"
+)]
+pub static WORKER_STREAM: Counter = Counter::new();
+
+#[metric(
+    name = "worker_stream_chunk",
+    description = "the number of chunks of streamed reads sent to the storage threads"
+)]
+pub static WORKER_STREAM_CHUNK: Counter = Counter::new();
+
 #[metric(
     name = "worker_event_error",
     description = "the number of error events received"
@@ -55,6 +112,290 @@ pub static WORKER_EVENT_TOTAL: Counter = Counter::new();
 )]
 pub static WORKER_EVENT_WRITE: Counter = Counter::new();
 
+/// Decides the timeout for each call to poll. After the last event the loop
+/// keeps polling without blocking until the spin duration has elapsed, which
+/// avoids sleeping and being woken again when events arrive in quick
+/// succession. After that it blocks for up to the configured timeout.
+struct Spin {
+    duration: Duration,
+    idle_since: Option<Instant>,
+}
+
+impl Spin {
+    fn new(duration: Duration) -> Self {
+        Self {
+            duration,
+            idle_since: None,
+        }
+    }
+
+    /// Returns the timeout to use for the next call to poll
+    fn timeout(&self, timeout: Duration) -> Duration {
+        match self.idle_since {
+            _ if self.duration.is_zero() => timeout,
+            Some(since) if since.elapsed() >= self.duration => timeout,
+            _ => Duration::ZERO,
+        }
+    }
+
+    /// Records the number of events returned by the last call to poll
+    fn record(&mut self, events: usize) {
+        if events > 0 {
+            self.idle_since = None;
+        } else if self.idle_since.is_none() {
+            self.idle_since = Some(Instant::now());
+        }
+    }
+}
+
+/// Tracks which of the threads on each side of the data queue are parked in a
+/// blocking poll. A thread which sends on the data queue only needs to wake
+/// the threads it sent to if they are parked, as a thread checks the queue
+/// once more after it is marked as parked and before it polls. This saves a
+/// write to the eventfd of a thread which is already awake.
+pub struct Parking {
+    id: usize,
+    // the threads on the same side of the queue, of which this is `id`
+    parked: Arc<[AtomicBool]>,
+    peers: Arc<[AtomicBool]>,
+}
+
+impl Parking {
+    fn new(id: usize, parked: Arc<[AtomicBool]>, peers: Arc<[AtomicBool]>) -> Self {
+        Self { id, parked, peers }
+    }
+
+    /// Marks the thread as parked ahead of a blocking poll. The data queue
+    /// must be checked again after this, as a peer may have sent to it just
+    /// before without waking it.
+    fn park(&self) {
+        self.parked[self.id].store(true, Ordering::Relaxed);
+        // orders the store before the check of the queue which follows, and
+        // pairs with the fence before a peer checks for parked threads
+        fence(Ordering::SeqCst);
+    }
+
+    fn unpark(&self) {
+        self.parked[self.id].store(false, Ordering::Relaxed);
+    }
+
+    /// Returns true if any of the peers, which have just been sent to, is
+    /// parked and must be woken.
+    fn any_parked(&self, peers: impl Iterator<Item = usize>) -> bool {
+        fence(Ordering::SeqCst);
+        peers.any(|peer| self.peers[peer].load(Ordering::Relaxed))
+    }
+
+    /// Returns the number of peers on the other side of the queue.
+    fn peers(&self) -> usize {
+        self.peers.len()
+    }
+}
+
+// how often each worker publishes its load and considers moving a session
+const BALANCE_INTERVAL: Duration = Duration::from_secs(1);
+
+// a worker only moves a session while it handles at least this many requests
+// per interval, and at least this many times as many as the least loaded
+// worker
+const BALANCE_MIN_LOAD: u64 = 10_000;
+const BALANCE_RATIO: u64 = 2;
+
+/// Spreads the load of the sessions across the workers. Each worker counts the
+/// requests of each of its sessions, and publishes its total once per
+/// interval. A worker which handles much more than the least loaded worker
+/// then picks one of its busiest sessions to move there, which it hands back
+/// to the listener the next time the session is idle. At most one session is
+/// moved per interval, and only one which leaves this worker busier than the
+/// one it moves to, so that sessions do not bounce between workers.
+pub struct Balance {
+    id: usize,
+    loads: Arc<[AtomicU64]>,
+    // the requests of each session in this interval, by token
+    sessions: Vec<u64>,
+    total: u64,
+    since: Instant,
+    moving: Option<(Token, usize)>,
+}
+
+impl Balance {
+    fn new(id: usize, loads: Arc<[AtomicU64]>) -> Self {
+        Self {
+            id,
+            loads,
+            sessions: Vec::new(),
+            total: 0,
+            since: Instant::now(),
+            moving: None,
+        }
+    }
+
+    /// Records requests handled for the session.
+    fn record(&mut self, token: Token, requests: usize) {
+        if self.sessions.len() <= token.0 {
+            self.sessions.resize(token.0 + 1, 0);
+        }
+        self.sessions[token.0] += requests as u64;
+        self.total += requests as u64;
+    }
+
+    /// Forgets a session which was closed or moved, so that its load is not
+    /// taken for a later session with the same token.
+    fn remove(&mut self, token: Token) {
+        if let Some(requests) = self.sessions.get_mut(token.0) {
+            *requests = 0;
+        }
+        if self.moving(token).is_some() {
+            self.moving = None;
+        }
+    }
+
+    /// Returns the worker the session should be moved to, if any.
+    fn moving(&self, token: Token) -> Option<usize> {
+        self.moving
+            .filter(|(moving, _)| *moving == token)
+            .map(|(_, worker)| worker)
+    }
+
+    /// Publishes the load of this worker once per interval, and picks the
+    /// session to move for the next interval if it is overloaded.
+    fn update(&mut self) {
+        if self.since.elapsed() < BALANCE_INTERVAL {
+            return;
+        }
+        self.since = Instant::now();
+
+        let load = std::mem::take(&mut self.total);
+        self.loads[self.id].store(load, Ordering::Relaxed);
+        self.moving = None;
+
+        let least = self
+            .loads
+            .iter()
+            .enumerate()
+            .filter(|(id, _)| *id != self.id)
+            .map(|(id, load)| (id, load.load(Ordering::Relaxed)))
+            .min_by_key(|(_, load)| *load);
+
+        if let Some((worker, least)) = least {
+            if load >= BALANCE_MIN_LOAD && load >= least.saturating_mul(BALANCE_RATIO) {
+                // the busiest session which leaves this worker busier than the
+                // one it is moved to
+                let limit = (load - least) / 2;
+                self.moving = self
+                    .sessions
+                    .iter()
+                    .enumerate()
+                    .filter(|(_, requests)| **requests > 0 && **requests <= limit)
+                    .max_by_key(|(_, requests)| **requests)
+                    .map(|(token, _)| (Token(token), worker));
+            }
+        }
+
+        self.sessions.fill(0);
+    }
+}
+
+/// Executes a batch of requests and records the time, and the cycles if they
+/// are counted, spent executing them for each request. The requests are
+/// executed together, so the time is shared evenly between them.
+fn execute_batch<Request, Response, Storage>(
+    storage: &mut Storage,
+    requests: &[Request],
+    responses: &mut Vec<Response>,
+    cycles: &mut CycleCounts,
+) where
+    Request: Timed,
+    Response: Compose,
+    Storage: Execute<Request, Response>,
+{
+    if requests.is_empty() {
+        return;
+    }
+
+    usdt!(execute_begin, requests.len());
+    let start = Instant::now();
+    let start_cycles = cycles.start();
+    storage.execute_batch(requests, responses);
+    cycles.execute(requests, start_cycles);
+    let elapsed = start.elapsed();
+    usdt!(execute_end, requests.len(), elapsed.as_nanos() as u64);
+    let latency = elapsed / requests.len() as u32;
+
+    for request in requests {
+        let _ = request
+            .latencies()
+            .execute
+            .increment(latency.as_nanos() as _);
+    }
+}
+
+/// Drives the handshake of a session which the listener handed over before
+/// its handshake completed, so that handshakes are spread across the workers
+/// instead of being serialized on the listener thread. Returns false while
+/// the handshake is in progress, in which case the caller waits for the next
+/// event for the session.
+fn handshake<Parser, Request, Response>(
+    session: &mut ServerSession<Parser, Response, Request>,
+    registry: &Registry,
+    token: Token,
+) -> Result<bool>
+where
+    Parser: Parse<Request>,
+    Response: Compose,
+{
+    if !session.is_handshaking() {
+        return Ok(true);
+    }
+
+    match session.do_handshake() {
+        Ok(()) => {
+            // the session no longer needs write events once it is negotiated
+            let interest = session.interest();
+            registry.reregister(session, token, interest)?;
+            Ok(true)
+        }
+        Err(e) if e.kind() == ErrorKind::WouldBlock => Ok(false),
+        Err(e) => Err(e),
+    }
+}
+
+// the number of requests in flight to the storage threads across all of the
+// workers, and the most which may be, zero for no limit
+static INFLIGHT: AtomicUsize = AtomicUsize::new(0);
+static MAX_INFLIGHT: AtomicUsize = AtomicUsize::new(0);
+
+/// Sets the most requests which may be in flight to the storage threads at
+/// once. A limit of zero disables it.
+pub(crate) fn set_max_inflight(max: usize) {
+    MAX_INFLIGHT.store(max, Ordering::Relaxed);
+}
+
+/// Returns true if as many requests are in flight to the storage threads as
+/// the limit allows.
+pub(crate) fn inflight_reached() -> bool {
+    let max = MAX_INFLIGHT.load(Ordering::Relaxed);
+    max > 0 && INFLIGHT.load(Ordering::Relaxed) >= max
+}
+
+/// Returns the loads shared by the workers, if there is more than one worker
+/// for sessions to be moved between.
+fn balance_loads(workers: usize) -> Option<Arc<[AtomicU64]>> {
+    (workers > 1).then(|| (0..workers).map(|_| AtomicU64::new(0)).collect())
+}
+
+/// Returns an error if a udp port is set, as datagrams are only served by
+/// workers which execute requests themselves.
+fn no_udp<T: ServerConfig>(config: &T) -> Result<()> {
+    if config.server().udp_port().is_some() {
+        return Err(Error::new(
+            ErrorKind::Other,
+            "udp requires workers which execute requests themselves",
+        ));
+    }
+    Ok(())
+}
+
 fn map_result(result: Result<usize>) -> Result<()> {
     match result {
         Ok(0) => Err(Error::new(ErrorKind::Other, "client hangup")),
@@ -72,14 +413,27 @@ pub enum Workers<Parser, Request, Response, Storage> {
     },
     Multi {
         workers: Vec<MultiWorker<Parser, Request, Response>>,
-        storage: StorageWorker<Request, Response, Storage, Token>,
+        storage: Vec<StorageWorker<Request, Response, Storage, Tag>>,
+    },
+    Shared {
+        workers: Vec<SingleWorker<Parser, Request, Response, Storage>>,
     },
 }
 
 impl<Parser, Request, Response, Storage> Workers<Parser, Request, Response, Storage>
 where
     Parser: 'static + Parse<Request> + Clone + Send,
-    Request: 'static + Klog + Klog<Response = Response> + Send,
+    Request: 'static
+        + Datagram
+        + Deadline<Response>
+        + Klog
+        + Klog<Response = Response>
+        + Replicate<Response>
+        + Shard<Response>
+        + Quiet
+        + Timed
+        + Track<Response>
+        + Send,
     Response: 'static + Compose + Send,
     Storage: 'static + EntryStore + Execute<Request, Response> + Send,
 {
@@ -95,10 +449,22 @@ where
                 mut workers,
                 mut storage,
             } => {
-                let mut join_handles = vec![std::thread::Builder::new()
-                    .name(format!("{THREAD_PREFIX}_storage"))
-                    .spawn(move || storage.run())
-                    .unwrap()];
+                let threads = storage.len();
+                let mut join_handles: Vec<JoinHandle<()>> = storage
+                    .drain(..)
+                    .enumerate()
+                    .map(|(id, mut storage)| {
+                        let name = if threads > 1 {
+                            format!("{THREAD_PREFIX}_storage_{id}")
+                        } else {
+                            format!("{THREAD_PREFIX}_storage")
+                        };
+                        std::thread::Builder::new()
+                            .name(name)
+                            .spawn(move || storage.run())
+                            .unwrap()
+                    })
+                    .collect();
 
                 for (id, mut worker) in workers.drain(..).enumerate() {
                     join_handles.push(
@@ -111,6 +477,16 @@ where
 
                 join_handles
             }
+            Self::Shared { mut workers } => workers
+                .drain(..)
+                .enumerate()
+                .map(|(id, mut worker)| {
+                    std::thread::Builder::new()
+                        .name(format!("{THREAD_PREFIX}_work_{id}"))
+                        .spawn(move || worker.run())
+                        .unwrap()
+                })
+                .collect(),
         }
     }
 }
@@ -121,7 +497,11 @@ pub enum WorkersBuilder<Parser, Request, Response, Storage> {
     },
     Multi {
         workers: Vec<MultiWorkerBuilder<Parser, Request, Response>>,
-        storage: StorageWorkerBuilder<Request, Response, Storage>,
+        storage: Vec<StorageWorkerBuilder<Request, Response, Storage>>,
+        router: Router,
+    },
+    Shared {
+        workers: Vec<SingleWorkerBuilder<Parser, Request, Response, Storage>>,
     },
 }
 
@@ -131,35 +511,159 @@ where
     Response: Compose,
     Storage: Execute<Request, Response> + EntryStore,
 {
-    pub fn new<T: WorkerConfig>(config: &T, parser: Parser, storage: Storage) -> Result<Self> {
+    pub fn new<T: ServerConfig + WorkerConfig>(
+        config: &T,
+        parser: Parser,
+        storage: Storage,
+    ) -> Result<Self> {
         let threads = config.worker().threads();
 
         if threads > 1 {
+            no_udp(config)?;
+
+            let hot = HotCopies::new(config, 1);
+            let limits = Limits::new(config);
+
             let mut workers = vec![];
-            for _ in 0..threads {
-                workers.push(MultiWorkerBuilder::new(config, parser.clone())?)
+            for id in 0..threads {
+                workers.push(
+                    MultiWorkerBuilder::new(config, parser.clone())?
+                        .core(affinity::worker_core(config.worker().cores(), id))
+                        .hot(hot.clone())
+                        .limits(limits.clone()),
+                )
             }
 
             Ok(Self::Multi {
                 workers,
-                storage: StorageWorkerBuilder::new(config, storage)?,
+                storage: vec![StorageWorkerBuilder::new(config, storage)?
+                    .hot(hot.as_ref().map(|hot| hot.shard(0)))],
+                router: Arc::new(|_| 0),
             })
         } else {
             Ok(Self::Single {
-                worker: SingleWorkerBuilder::new(config, parser, storage)?,
+                worker: SingleWorkerBuilder::new(config, parser, storage)?
+                    .core(affinity::worker_core(config.worker().cores(), 0))
+                    .udp(config)?,
             })
         }
     }
 
+    /// Creates workers which route each request to one of several storage
+    /// threads, each of which owns one shard of the storage. The router maps a
+    /// key to the index of the shard which owns it. Requests with keys on more
+    /// than one shard are split, and the responses to their parts are merged
+    /// back together, in order, before being sent. There are always separate
+    /// worker threads, even if the config has only one.
+    pub fn sharded<T: ServerConfig + WorkerConfig>(
+        config: &T,
+        parser: Parser,
+        storage: Vec<Storage>,
+        router: impl Fn(&[u8]) -> usize + Send + Sync + 'static,
+    ) -> Result<Self> {
+        no_udp(config)?;
+
+        let router: Router = Arc::new(router);
+        let shards = storage.len();
+        let hot = HotCopies::new(config, shards);
+        let limits = Limits::new(config);
+
+        let mut workers = vec![];
+        for id in 0..config.worker().threads() {
+            workers.push(
+                MultiWorkerBuilder::new(config, parser.clone())?
+                    .core(affinity::worker_core(config.worker().cores(), id))
+                    .shards(shards, router.clone())
+                    .hot(hot.clone())
+                    .limits(limits.clone()),
+            )
+        }
+
+        let storage_core = config.worker().storage_core();
+        let storage = storage
+            .into_iter()
+            .enumerate()
+            .map(|(id, storage)| {
+                StorageWorkerBuilder::new(config, storage).map(|builder| {
+                    builder
+                        .core(storage_core.map(|core| core + id))
+                        .hot(hot.as_ref().map(|hot| hot.shard(id)))
+                })
+            })
+            .collect::<Result<Vec<_>>>()?;
+
+        Ok(Self::Multi {
+            workers,
+            storage,
+            router,
+        })
+    }
+
+    /// Creates workers which each execute requests directly against their own
+    /// handle to the storage. This requires a storage type which can be cloned
+    /// to produce handles to the same underlying data, such as a concurrent
+    /// storage type. Every worker thread acts as a single worker, so there is
+    /// no separate storage thread. If `reuseport` is set in the server config,
+    /// every worker also binds its own listener and accepts sessions itself.
+    pub fn shared<T: ServerConfig + TlsConfig + WorkerConfig>(
+        config: &T,
+        parser: Parser,
+        storage: Storage,
+    ) -> Result<Self>
+    where
+        Storage: Clone,
+    {
+        let threads = config.worker().threads();
+
+        let mut workers = vec![];
+        for id in 0..threads {
+            let worker = SingleWorkerBuilder::new(config, parser.clone(), storage.clone())?
+                .core(affinity::worker_core(config.worker().cores(), id))
+                .udp(config)?;
+            if config.server().reuseport() {
+                workers.push(worker.listen(config)?);
+            } else {
+                workers.push(worker);
+            }
+        }
+
+        Ok(Self::Shared { workers })
+    }
+
+    /// Returns true if the workers accept sessions from their own listeners,
+    /// in which case no `Listener` thread is needed.
+    pub fn is_listening(&self) -> bool {
+        match self {
+            Self::Shared { workers } => workers.iter().all(|w| w.is_listening()),
+            _ => false,
+        }
+    }
+
+    /// Returns the builders of the storage threads along with the router which
+    /// maps a key to one of them, or `None` if the workers execute requests
+    /// themselves.
+    #[allow(clippy::type_complexity)]
+    pub fn storage(
+        &mut self,
+    ) -> Option<(
+        &mut [StorageWorkerBuilder<Request, Response, Storage>],
+        &Router,
+    )> {
+        match self {
+            Self::Multi {
+                storage, router, ..
+            } => Some((storage, router)),
+            _ => None,
+        }
+    }
+
     pub fn worker_wakers(&self) -> Vec<Arc<Waker>> {
         match self {
             Self::Single { worker } => {
                 vec![worker.waker()]
             }
-            Self::Multi {
-                workers,
-                storage: _,
-            } => workers.iter().map(|w| w.waker()).collect(),
+            Self::Multi { workers, .. } => workers.iter().map(|w| w.waker()).collect(),
+            Self::Shared { workers } => workers.iter().map(|w| w.waker()).collect(),
         }
     }
 
@@ -168,8 +672,11 @@ where
             Self::Single { worker } => {
                 vec![worker.waker()]
             }
-            Self::Multi { workers, storage } => {
-                let mut wakers = vec![storage.waker()];
+            Self::Shared { workers } => workers.iter().map(|w| w.waker()).collect(),
+            Self::Multi {
+                workers, storage, ..
+            } => {
+                let mut wakers: Vec<Arc<Waker>> = storage.iter().map(|s| s.waker()).collect();
                 for worker in workers {
                     wakers.push(worker.waker());
                 }
@@ -180,35 +687,64 @@ where
 
     pub fn build(
         self,
-        session_queues: Vec<Queues<Session, Session>>,
+        session_queues: Vec<Queues<Handoff, Session>>,
         signal_queues: Vec<Queues<(), Signal>>,
     ) -> Workers<Parser, Request, Response, Storage> {
         let mut signal_queues = signal_queues;
         let mut session_queues = session_queues;
         match self {
             Self::Multi {
-                storage,
+                mut storage,
                 mut workers,
+                ..
             } => {
-                let storage_wakers = vec![storage.waker()];
+                let storage_wakers: Vec<Arc<Waker>> = storage.iter().map(|v| v.waker()).collect();
                 let worker_wakers: Vec<Arc<Waker>> = workers.iter().map(|v| v.waker()).collect();
-                let (mut worker_data_queues, mut storage_data_queues) =
-                    Queues::new(worker_wakers, storage_wakers, QUEUE_CAPACITY);
+                let (mut worker_data_queues, mut storage_data_queues) = queues(
+                    worker_wakers.clone(),
+                    storage_wakers.clone(),
+                    QUEUE_CAPACITY,
+                );
+                // messages which the storage threads send to sessions outside
+                // of the responses to their requests
+                let (mut worker_push_queues, mut storage_push_queues) =
+                    queues(worker_wakers, storage_wakers, QUEUE_CAPACITY);
+
+                let flags = |len| -> Arc<[AtomicBool]> {
+                    (0..len).map(|_| AtomicBool::new(false)).collect()
+                };
+                let worker_parked = flags(workers.len());
+                let storage_parked = flags(storage.len());
+                let loads = balance_loads(workers.len());
 
-                // The storage thread precedes the worker threads in the set of
-                // wakers, so its signal queue is the first element of
-                // `signal_queues`. Its request queue is also the first (and
-                // only) element of `request_queues`. We remove these and build
-                // the storage so we can loop through the remaining signal
-                // queues when launching the worker threads.
-                let s = storage.build(storage_data_queues.remove(0), signal_queues.remove(0));
+                // The storage threads precede the worker threads in the set of
+                // wakers, so their signal queues are the first elements of
+                // `signal_queues`, in the same order as their request queues in
+                // `storage_data_queues`. We remove these and build the storage
+                // so we can loop through the remaining signal queues when
+                // launching the worker threads.
+                let s = storage
+                    .drain(..)
+                    .enumerate()
+                    .map(|(id, storage)| {
+                        storage.build(
+                            storage_data_queues.remove(0),
+                            storage_push_queues.remove(0),
+                            signal_queues.remove(0),
+                            Parking::new(id, storage_parked.clone(), worker_parked.clone()),
+                        )
+                    })
+                    .collect();
 
                 let mut w = Vec::new();
-                for worker_builder in workers.drain(..) {
+                for (id, worker_builder) in workers.drain(..).enumerate() {
                     w.push(worker_builder.build(
                         worker_data_queues.remove(0),
+                        worker_push_queues.remove(0),
                         session_queues.remove(0),
                         signal_queues.remove(0),
+                        Parking::new(id, worker_parked.clone(), storage_parked.clone()),
+                        loads.as_ref().map(|loads| Balance::new(id, loads.clone())),
                     ));
                 }
 
@@ -218,8 +754,34 @@ where
                 }
             }
             Self::Single { worker } => Workers::Single {
-                worker: worker.build(session_queues.remove(0), signal_queues.remove(0)),
+                worker: worker.build(
+                    Some(session_queues.remove(0)),
+                    signal_queues.remove(0),
+                    None,
+                ),
             },
+            Self::Shared { mut workers } => {
+                let loads = balance_loads(workers.len());
+                Workers::Shared {
+                    workers: workers
+                        .drain(..)
+                        .enumerate()
+                        .map(|(id, worker)| {
+                            // workers with their own listener have no session
+                            // queue, and keep the sessions they accept
+                            if worker.is_listening() {
+                                worker.build(None, signal_queues.remove(0), None)
+                            } else {
+                                worker.build(
+                                    Some(session_queues.remove(0)),
+                                    signal_queues.remove(0),
+                                    loads.as_ref().map(|loads| Balance::new(id, loads.clone())),
+                                )
+                            }
+                        })
+                        .collect(),
+                }
+            }
         }
     }
 }
@@ -3,14 +3,152 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use super::*;
+use std::collections::VecDeque;
+
+/// How often the sessions which are over their rate limit are retried, at
+/// the most, while the worker has nothing else to do.
+const THROTTLE_RETRY: Duration = Duration::from_millis(1);
+
+/// The most chunks of streamed reads of a session which are sent to the
+/// storage threads ahead of being written out, so that the lookups for the
+/// next chunk overlap with writing out the one before it.
+const STREAM_CHUNKS: usize = 2;
+
+/// Maps a key to the index of the storage thread which owns it.
+pub type Router = Arc<dyn Fn(&[u8]) -> usize + Send + Sync>;
+
+/// Identifies the request, or the part of a split request, which a message on
+/// the data queue is for.
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub struct Tag {
+    token: Token,
+    generation: u64,
+    seq: u64,
+    part: usize,
+    // set if the session tracks the keys it reads
+    tracking: bool,
+}
+
+impl Tracked for Tag {
+    fn session(&self) -> Option<Self> {
+        self.tracking.then_some(Self {
+            seq: 0,
+            part: 0,
+            ..*self
+        })
+    }
+}
+
+/// The requests of a session which are outstanding on the storage threads.
+/// Requests may be executed by different storage threads and complete out of
+/// order, so their responses are held here until they can be sent in the order
+/// of the requests.
+struct Pipeline<Request, Response> {
+    // incremented each time the session for this token is closed, so that
+    // responses for a closed session are not sent to a later session
+    generation: u64,
+    // the sequence number of the next request
+    next: u64,
+    pending: VecDeque<Pending<Request, Response>>,
+    // set while the session tracks the keys it reads
+    tracking: bool,
+    // the sequence number of the first request after the latest quiet one,
+    // which is cleared once that request completes. The session is not moved
+    // to another worker meanwhile, as the quiet request may still be in flight
+    quiet: Option<u64>,
+    // the rate limit of the session and its client
+    limit: Limit,
+    // set while the session is waiting for its turn to be read, or for its
+    // rate limit to allow another request
+    ready: bool,
+    throttled: bool,
+    // the number of chunks of streamed reads which are yet to be sent to the
+    // storage threads
+    unsent: usize,
+}
+
+struct Pending<Request, Response> {
+    // the original request, which is held here while its parts are executed
+    // if it was split, or returned with its response otherwise. A chunk of a
+    // streamed read is also held here until it is sent
+    request: Option<Request>,
+    responses: Responses<Response>,
+    remaining: usize,
+    chunk: Option<Chunk>,
+}
+
+/// A chunk of a streamed read, which takes its own place in the pipeline so
+/// that its response is written out once it and those before it are complete.
+#[derive(Clone, Copy)]
+struct Chunk {
+    // set for the last chunk of the read
+    last: bool,
+    // set once the chunk has been sent to the storage threads
+    sent: bool,
+    // whether the session tracked the keys it reads when the read was taken
+    tracking: bool,
+}
+
+/// The responses to the parts of a pending request. The response to a request
+/// which was not split is held inline, so that dispatching it does not
+/// allocate.
+enum Responses<Response> {
+    One(Option<Response>),
+    Many(Vec<Option<Response>>),
+}
+
+impl<Response> Responses<Response> {
+    fn insert(&mut self, part: usize, response: Response) {
+        match self {
+            Self::One(slot) => *slot = Some(response),
+            Self::Many(slots) => slots[part] = Some(response),
+        }
+    }
+}
+
+impl<Request, Response> Pipeline<Request, Response> {
+    fn new() -> Self {
+        Self {
+            generation: 0,
+            next: 0,
+            pending: VecDeque::new(),
+            tracking: false,
+            quiet: None,
+            limit: Limit::default(),
+            ready: false,
+            throttled: false,
+            unsent: 0,
+        }
+    }
+
+    fn reset(&mut self) {
+        self.generation += 1;
+        self.pending.clear();
+        self.tracking = false;
+        self.quiet = None;
+        self.limit = Limit::default();
+        self.ready = false;
+        self.throttled = false;
+        self.unsent = 0;
+    }
+}
 
 pub struct MultiWorkerBuilder<Parser, Request, Response> {
+    core: Option<usize>,
+    hot: Option<Arc<HotCopies>>,
+    limits: Limits,
     nevent: usize,
     parser: Parser,
     poll: Poll,
+    router: Router,
+    shards: usize,
+    spin: Spin,
     sessions: Slab<ServerSession<Parser, Response, Request>>,
+    stream_buffer: usize,
+    stream_keys: usize,
     timeout: Duration,
     waker: Arc<Waker>,
+    cycles: bool,
 }
 
 impl<Parser, Request, Response> MultiWorkerBuilder<Parser, Request, Response> {
@@ -25,87 +163,716 @@ impl<Parser, Request, Response> MultiWorkerBuilder<Parser, Request, Response> {
 
         let nevent = config.nevent();
         let timeout = Duration::from_millis(config.timeout() as u64);
+        let spin = Spin::new(Duration::from_micros(config.spin() as u64));
 
         Ok(Self {
+            core: None,
+            hot: None,
+            limits: Limits::default(),
             nevent,
             parser,
             poll,
+            router: Arc::new(|_| 0),
+            shards: 1,
+            spin,
             sessions: Slab::new(),
+            stream_buffer: config.stream_buffer(),
+            stream_keys: config.stream_keys(),
             timeout,
             waker,
+            cycles: config.cycles(),
         })
     }
 
+    /// Pins the worker thread to the provided core once it runs.
+    pub fn core(mut self, core: Option<usize>) -> Self {
+        self.core = core;
+        self
+    }
+
+    /// Routes each request to one of the provided number of storage threads,
+    /// using the router to map the keys of the request to a storage thread.
+    pub fn shards(mut self, shards: usize, router: Router) -> Self {
+        self.shards = shards;
+        self.router = router;
+        self
+    }
+
+    /// Answers reads of hot keys from the copies of their values made by the
+    /// storage threads, where the config asks for them.
+    pub fn hot(mut self, hot: Option<Arc<HotCopies>>) -> Self {
+        self.hot = hot;
+        self
+    }
+
+    /// Limits the rate of requests taken from each session and client.
+    pub fn limits(mut self, limits: Limits) -> Self {
+        self.limits = limits;
+        self
+    }
+
     pub fn waker(&self) -> Arc<Waker> {
         self.waker.clone()
     }
 
     pub fn build(
         self,
-        data_queue: Queues<(Request, Token), (Request, Response, Token)>,
-        session_queue: Queues<Session, Session>,
+        data_queue: Queues<(Request, Instant, Tag), (Request, Response, Instant, Tag)>,
+        push_queue: Queues<(), (Response, Tag)>,
+        session_queue: Queues<Handoff, Session>,
         signal_queue: Queues<(), Signal>,
+        parking: Parking,
+        balance: Option<Balance>,
     ) -> MultiWorker<Parser, Request, Response> {
         MultiWorker {
+            balance,
+            core: self.core,
             data_queue,
+            deferred: VecDeque::new(),
+            dispatched: false,
+            hot: self.hot,
+            limits: self.limits,
             nevent: self.nevent,
+            parking,
             parser: self.parser,
+            pipelines: Vec::new(),
             poll: self.poll,
+            push_queue,
+            ready: VecDeque::new(),
+            router: self.router,
+            shards: self.shards,
+            spin: self.spin,
             session_queue,
             sessions: self.sessions,
             signal_queue,
+            stream_buffer: self.stream_buffer,
+            stream_keys: self.stream_keys,
+            throttled: VecDeque::new(),
             timeout: self.timeout,
             waker: self.waker,
+            cycles: CycleCounts::new(self.cycles),
         }
     }
 }
 
 pub struct MultiWorker<Parser, Request, Response> {
-    data_queue: Queues<(Request, Token), (Request, Response, Token)>,
+    balance: Option<Balance>,
+    core: Option<usize>,
+    data_queue: Queues<(Request, Instant, Tag), (Request, Response, Instant, Tag)>,
+    // sessions whose reads were put off while the limit of requests in flight
+    // was reached
+    deferred: VecDeque<Token>,
+    // set once requests are sent to the storage threads in this iteration
+    dispatched: bool,
+    // copies of the values of hot keys made by the storage threads
+    hot: Option<Arc<HotCopies>>,
+    limits: Limits,
     nevent: usize,
+    parking: Parking,
     parser: Parser,
+    pipelines: Vec<Pipeline<Request, Response>>,
     poll: Poll,
-    session_queue: Queues<Session, Session>,
+    // messages from the storage threads which are not responses to requests
+    push_queue: Queues<(), (Response, Tag)>,
+    // sessions with requests left in their buffers once their responses came
+    // back, which are read in turn
+    ready: VecDeque<Token>,
+    router: Router,
+    shards: usize,
+    spin: Spin,
+    session_queue: Queues<Handoff, Session>,
     sessions: Slab<ServerSession<Parser, Response, Request>>,
     signal_queue: Queues<(), Signal>,
+    // reads of more keys than `stream_keys` are split into chunks, the next of
+    // which is sent once fewer than `stream_buffer` bytes are left to write
+    stream_buffer: usize,
+    stream_keys: usize,
+    // sessions whose reads were put off as they were over their rate limit
+    throttled: VecDeque<Token>,
     timeout: Duration,
     waker: Arc<Waker>,
+    cycles: CycleCounts,
 }
 
 impl<Parser, Request, Response> MultiWorker<Parser, Request, Response>
 where
     Parser: Parse<Request> + Clone,
-    Request: Klog + Klog<Response = Response>,
+    Request: Klog + Klog<Response = Response> + Quiet + Shard<Response> + Timed + Track<Response>,
     Response: Compose,
 {
     /// Return the `Session` to the `Listener` to handle flush/close
     fn close(&mut self, token: Token) {
+        if let Some(pipeline) = self.pipelines.get_mut(token.0) {
+            pipeline.reset();
+        }
+
+        if let Some(balance) = &mut self.balance {
+            balance.remove(token);
+        }
+
         if self.sessions.contains(token.0) {
             let mut session = self.sessions.remove(token.0).into_inner();
             let _ = session.deregister(self.poll.registry());
-            let _ = self.session_queue.try_send_any(session);
+            let _ = self.session_queue.try_send_any(Handoff::Close(session));
             let _ = self.session_queue.wake();
         }
     }
 
-    /// Handle up to one request for a session
+    /// Registers a session received from the `Listener`, or returns it if it
+    /// cannot be registered
+    fn insert(&mut self, mut session: Session) -> std::result::Result<(), Session> {
+        let s = self.sessions.vacant_entry();
+        let interest = session.interest();
+        if session
+            .register(self.poll.registry(), Token(s.key()), interest)
+            .is_err()
+        {
+            return Err(session);
+        }
+        if self.pipelines.len() <= s.key() {
+            self.pipelines.resize_with(s.key() + 1, Pipeline::new);
+        }
+        let peer = session.peer_addr().ok().map(|addr| addr.ip());
+        self.pipelines[s.key()].limit = self.limits.session(peer);
+        let parser = self.parser.for_listener(session.listener());
+        s.insert(ServerSession::new(session, parser));
+        Ok(())
+    }
+
+    /// Hands the session to the `Listener` to be moved to a less loaded worker
+    /// if the balance picked it, once it has no requests outstanding and no
+    /// data left to read or write
+    fn migrate(&mut self, token: Token) {
+        let Some(worker) = self.balance.as_ref().and_then(|b| b.moving(token)) else {
+            return;
+        };
+
+        let idle = match (self.sessions.get(token.0), self.pipelines.get(token.0)) {
+            (Some(session), Some(pipeline)) => {
+                pipeline.pending.is_empty()
+                    && pipeline.quiet.is_none()
+                    && session.write_pending() == 0
+                    && session.remaining() == 0
+            }
+            _ => false,
+        };
+        if !idle {
+            return;
+        }
+
+        if let Some(balance) = &mut self.balance {
+            balance.remove(token);
+        }
+        self.pipelines[token.0].reset();
+        let mut session = self.sessions.remove(token.0).into_inner();
+        let _ = session.deregister(self.poll.registry());
+
+        match self
+            .session_queue
+            .try_send_any(Handoff::Move(session, worker))
+        {
+            Ok(()) => {
+                WORKER_SESSION_MOVE.increment();
+                let _ = self.session_queue.wake();
+            }
+            // the session is kept here if the listener cannot take it
+            Err(Handoff::Move(session, _)) | Err(Handoff::Close(session)) => {
+                let _ = self.insert(session);
+            }
+        }
+    }
+
+    /// Handle up to `PIPELINE_BATCH` requests for a session
     fn read(&mut self, token: Token) -> Result<()> {
         let session = self
             .sessions
             .get_mut(token.0)
             .ok_or_else(|| Error::new(ErrorKind::Other, "non-existant session"))?;
 
+        if !handshake(session, self.poll.registry(), token)? {
+            return Ok(());
+        }
+
         // fill the session
         map_result(session.fill())?;
 
-        // process up to one request
-        match session.receive() {
-            Ok(request) => self
-                .data_queue
-                .try_send_to(0, (request, token))
-                .map_err(|_| Error::new(ErrorKind::Other, "data queue is full")),
-            Err(e) => map_err(e),
+        let pipeline = &mut self.pipelines[token.0];
+
+        // set once a response is written here rather than by `respond`
+        let mut answered = false;
+        let mut result = Ok(());
+
+        // send pipelined requests to the storage threads together, requests
+        // to each storage thread are executed in order and the pipeline puts
+        // their responses back into the order of the requests. Once the limit
+        // of requests in flight is reached, the rest are left in the session
+        // until responses come back
+        for _ in 0..PIPELINE_BATCH {
+            if inflight_reached() {
+                WORKER_SHED_INFLIGHT.increment();
+                self.deferred.push_back(token);
+                break;
+            }
+
+            if !pipeline.limit.ready() {
+                if !pipeline.throttled {
+                    pipeline.throttled = true;
+                    self.throttled.push_back(token);
+                }
+                break;
+            }
+
+            let start = self.cycles.start();
+            match session.receive() {
+                Ok(request) => {
+                    usdt!(request_parse, token.0);
+                    self.cycles.parse(&request, start);
+                    pipeline.limit.take();
+
+                    if let Some(response) =
+                        Self::hot_copy(&self.hot, &self.router, self.shards, pipeline, &request)
+                    {
+                        HOT_COPY_HIT.increment();
+                        request.klog(&response);
+                        let start = self.cycles.start();
+                        let sent = session.send_timed(response, request.latencies().write);
+                        self.cycles.compose(&request, start);
+                        sent?;
+                        answered = true;
+                        if let Some(balance) = &mut self.balance {
+                            balance.record(token, 1);
+                        }
+                        continue;
+                    }
+
+                    Self::dispatch(
+                        &mut self.data_queue,
+                        &self.router,
+                        self.shards,
+                        self.stream_keys,
+                        pipeline,
+                        token,
+                        request,
+                    )?;
+                    self.dispatched = true;
+                    if let Some(balance) = &mut self.balance {
+                        balance.record(token, 1);
+                    }
+                }
+                Err(e) => {
+                    // return the buffers to the pool if the session is now idle
+                    session.release_buffers();
+                    result = map_err(e);
+                    break;
+                }
+            }
+        }
+
+        // the first chunks of streamed reads are sent right away
+        if Self::stream(
+            &mut self.data_queue,
+            &self.router,
+            self.shards,
+            pipeline,
+            token,
+            session.write_pending(),
+            self.stream_buffer,
+        )? {
+            self.dispatched = true;
+        }
+
+        if answered {
+            Self::flush(session, self.poll.registry(), token)?;
+        }
+
+        result
+    }
+
+    /// Returns the response to a read of a hot key from the copy of its value,
+    /// if there is one. This is only done once every earlier request of the
+    /// session has been answered, so that a read is never answered before a
+    /// write which the session sent ahead of it has been executed, and not
+    /// for a session which tracks the keys it reads, as the storage threads
+    /// must see its reads.
+    fn hot_copy(
+        hot: &Option<Arc<HotCopies>>,
+        router: &Router,
+        shards: usize,
+        pipeline: &Pipeline<Request, Response>,
+        request: &Request,
+    ) -> Option<Response> {
+        let hot = hot.as_ref()?;
+        if !pipeline.pending.is_empty() || pipeline.quiet.is_some() || pipeline.tracking {
+            return None;
+        }
+
+        let key = request.hot_key()?;
+        let shard = if shards > 1 { router(key) } else { 0 };
+        let copy = hot.get(shard, key)?;
+        request.from_hot_copy(&copy)
+    }
+
+    /// Sends a request to the storage thread which owns its key. A request
+    /// with keys owned by more than one storage thread is split, and each part
+    /// is sent to the storage thread which owns its keys. A read of more than
+    /// `stream_keys` keys is instead split into chunks, which are held in the
+    /// pipeline until they are sent by `stream`.
+    fn dispatch(
+        data_queue: &mut Queues<(Request, Instant, Tag), (Request, Response, Instant, Tag)>,
+        router: &Router,
+        shards: usize,
+        stream_keys: usize,
+        pipeline: &mut Pipeline<Request, Response>,
+        token: Token,
+        request: Request,
+    ) -> Result<()> {
+        // the storage threads track the keys read by the requests which
+        // follow one which turns tracking on
+        if let Some((tracking, _)) = request.tracking() {
+            pipeline.tracking = tracking;
+        }
+
+        let chunks = if stream_keys > 0 {
+            request.chunks(stream_keys)
+        } else {
+            None
+        };
+
+        if let Some(chunks) = chunks {
+            WORKER_STREAM.increment();
+
+            let last = chunks.len() - 1;
+            for (index, chunk) in chunks.into_iter().enumerate() {
+                pipeline.pending.push_back(Pending {
+                    request: Some(chunk),
+                    responses: Responses::One(None),
+                    remaining: 1,
+                    chunk: Some(Chunk {
+                        last: index == last,
+                        sent: false,
+                        tracking: pipeline.tracking,
+                    }),
+                });
+                pipeline.next += 1;
+                pipeline.unsent += 1;
+            }
+
+            return Ok(());
+        }
+
+        let parts = if shards > 1 {
+            request.split(&**router)
+        } else {
+            None
+        };
+
+        // a quiet request takes no place in the pipeline, as nothing is sent
+        // back for it, so it is neither answered nor logged here. It still
+        // takes effect before the requests which follow it to the same
+        // storage thread, as those are executed in order
+        let quiet = parts.is_none() && request.quiet();
+
+        let tag = Tag {
+            token,
+            generation: pipeline.generation,
+            seq: pipeline.next,
+            part: 0,
+            tracking: pipeline.tracking,
+        };
+        if quiet {
+            pipeline.quiet = Some(pipeline.next);
+        } else {
+            pipeline.next += 1;
+        }
+
+        let queued = Instant::now();
+
+        if let Some(parts) = parts {
+            pipeline.pending.push_back(Pending {
+                request: Some(request),
+                responses: Responses::Many(parts.iter().map(|_| None).collect()),
+                remaining: parts.len(),
+                chunk: None,
+            });
+
+            for (part, (shard, request)) in parts.into_iter().enumerate() {
+                Self::send(data_queue, shard, request, queued, Tag { part, ..tag })?;
+            }
+        } else {
+            let shard = match request.shard_key() {
+                Some(key) if shards > 1 => router(key),
+                _ => 0,
+            };
+
+            if !quiet {
+                pipeline.pending.push_back(Pending {
+                    request: None,
+                    responses: Responses::One(None),
+                    remaining: 1,
+                    chunk: None,
+                });
+            }
+
+            Self::send(data_queue, shard, request, queued, tag)?;
+        }
+
+        Ok(())
+    }
+
+    /// Sends the chunks of streamed reads which are held in the pipeline to
+    /// the storage threads, in order, while fewer than `STREAM_CHUNKS` of them
+    /// are waiting to be written out and fewer than `buffer` bytes, unless it
+    /// is zero, are left to write to the session. Returns true if any chunk
+    /// was sent.
+    fn stream(
+        data_queue: &mut Queues<(Request, Instant, Tag), (Request, Response, Instant, Tag)>,
+        router: &Router,
+        shards: usize,
+        pipeline: &mut Pipeline<Request, Response>,
+        token: Token,
+        write_pending: usize,
+        buffer: usize,
+    ) -> Result<bool> {
+        if pipeline.unsent == 0 || (buffer > 0 && write_pending >= buffer) {
+            return Ok(false);
+        }
+
+        let front = pipeline.next - pipeline.pending.len() as u64;
+        let queued = Instant::now();
+        let mut waiting = 0;
+        let mut sent = false;
+
+        for (index, pending) in pipeline.pending.iter_mut().enumerate() {
+            let Some(chunk) = &mut pending.chunk else {
+                continue;
+            };
+            if waiting >= STREAM_CHUNKS {
+                break;
+            }
+            waiting += 1;
+            if chunk.sent {
+                continue;
+            }
+
+            chunk.sent = true;
+            pipeline.unsent -= 1;
+            sent = true;
+            WORKER_STREAM_CHUNK.increment();
+
+            let tag = Tag {
+                token,
+                generation: pipeline.generation,
+                seq: front + index as u64,
+                part: 0,
+                tracking: chunk.tracking,
+            };
+
+            // the chunk is split as any other request with keys owned by
+            // more than one storage thread
+            let request = pending.request.take().unwrap();
+            let parts = if shards > 1 {
+                request.split(&**router)
+            } else {
+                None
+            };
+
+            if let Some(parts) = parts {
+                pending.responses = Responses::Many(parts.iter().map(|_| None).collect());
+                pending.remaining = parts.len();
+                pending.request = Some(request);
+
+                for (part, (shard, request)) in parts.into_iter().enumerate() {
+                    Self::send(data_queue, shard, request, queued, Tag { part, ..tag })?;
+                }
+            } else {
+                let shard = match request.shard_key() {
+                    Some(key) if shards > 1 => router(key),
+                    _ => 0,
+                };
+                Self::send(data_queue, shard, request, queued, tag)?;
+            }
+        }
+
+        Ok(sent)
+    }
+
+    /// Sends a request, or a part of one, to a storage thread.
+    fn send(
+        data_queue: &mut Queues<(Request, Instant, Tag), (Request, Response, Instant, Tag)>,
+        shard: usize,
+        request: Request,
+        queued: Instant,
+        tag: Tag,
+    ) -> Result<()> {
+        data_queue
+            .try_send_to(shard, (request, queued, tag))
+            .map_err(|_| Error::new(ErrorKind::Other, "data queue is full"))?;
+        INFLIGHT.fetch_add(1, Ordering::Relaxed);
+        Ok(())
+    }
+
+    /// Handles a response from a storage thread. Once the responses for the
+    /// oldest requests of the session are complete, they are sent in order.
+    fn respond(&mut self, tag: Tag, request: Request, response: Response) -> Result<()> {
+        let token = tag.token;
+
+        let (Some(session), Some(pipeline)) = (
+            self.sessions.get_mut(token.0),
+            self.pipelines.get_mut(token.0),
+        ) else {
+            return Ok(());
+        };
+
+        // drop responses for a session which has since been closed
+        if pipeline.generation != tag.generation {
+            return Ok(());
+        }
+
+        let front = pipeline.next - pipeline.pending.len() as u64;
+        let Some(pending) = tag
+            .seq
+            .checked_sub(front)
+            .and_then(|index| pipeline.pending.get_mut(index as usize))
+        else {
+            return Ok(());
+        };
+
+        // the parts of a split request are dropped in favor of the original
+        if pending.request.is_none() {
+            pending.request = Some(request);
+        }
+        pending.responses.insert(tag.part, response);
+        pending.remaining -= 1;
+
+        while pipeline
+            .pending
+            .front()
+            .map(|pending| pending.remaining == 0)
+            .unwrap_or(false)
+        {
+            // with a single storage thread, a request which completes after
+            // a quiet one was sent means that the quiet one was executed
+            let seq = pipeline.next - pipeline.pending.len() as u64;
+            if self.shards == 1 && pipeline.quiet.is_some_and(|quiet| seq >= quiet) {
+                pipeline.quiet = None;
+            }
+
+            let pending = pipeline.pending.pop_front().unwrap();
+            let request = pending.request.unwrap();
+            let response = match pending.responses {
+                Responses::One(response) => response.unwrap(),
+                Responses::Many(responses) => {
+                    let mut responses: Vec<Response> = responses.into_iter().flatten().collect();
+                    if responses.len() == 1 {
+                        responses.pop().unwrap()
+                    } else {
+                        request.merge(responses, &*self.router)
+                    }
+                }
+            };
+            let response = match pending.chunk {
+                Some(chunk) => request.chunk_response(response, chunk.last),
+                None => response,
+            };
+
+            request.klog(&response);
+            let write = request.latencies().write;
+            if response.should_hangup() {
+                let _ = session.send_timed(response, write);
+                return Err(Error::new(ErrorKind::Other, "hangup"));
+            }
+            let start = self.cycles.start();
+            let sent = session.send_timed(response, write);
+            self.cycles.compose(&request, start);
+            sent?;
+        }
+
+        Self::flush(session, self.poll.registry(), token)?;
+
+        // the next chunks of streamed reads are sent once those before them
+        // have been written out
+        if Self::stream(
+            &mut self.data_queue,
+            &self.router,
+            self.shards,
+            pipeline,
+            token,
+            session.write_pending(),
+            self.stream_buffer,
+        )? {
+            self.dispatched = true;
+        }
+
+        // the rest of the requests in the session are read once the other
+        // sessions which had responses come back have had their turn, so that
+        // a session with a deep pipeline does not take the worker from them
+        if session.remaining() > 0 && !pipeline.ready {
+            pipeline.ready = true;
+            self.ready.push_back(token);
         }
+
+        Ok(())
+    }
+
+    /// Writes out the responses pending for the session.
+    fn flush(
+        session: &mut ServerSession<Parser, Response, Request>,
+        registry: &Registry,
+        token: Token,
+    ) -> Result<()> {
+        if session.write_pending() > 0 {
+            // try to immediately flush, if we still have pending bytes,
+            // reregister. This saves us one syscall when flushing would not
+            // block.
+            usdt!(session_flush, token.0, session.write_pending());
+            if let Err(e) = session.flush() {
+                map_err(e)?;
+            }
+
+            if session.write_pending() > 0 {
+                let interest = session.interest();
+                session.reregister(registry, token, interest)?;
+            } else {
+                session.release_buffers();
+            }
+        }
+
+        Ok(())
+    }
+
+    /// Sends a message from a storage thread which is not the response to any
+    /// request, such as to invalidate keys the session read. Messages for a
+    /// session which has since been closed, or which no longer tracks keys,
+    /// are dropped.
+    fn push(&mut self, tag: Tag, response: Response) -> Result<()> {
+        let token = tag.token;
+
+        let (Some(session), Some(pipeline)) = (
+            self.sessions.get_mut(token.0),
+            self.pipelines.get_mut(token.0),
+        ) else {
+            return Ok(());
+        };
+
+        if pipeline.generation != tag.generation || !pipeline.tracking {
+            return Ok(());
+        }
+
+        session.push(response)?;
+
+        // the message is flushed right away, rather than with the next
+        // response, as there may be none
+        if let Err(e) = session.flush() {
+            map_err(e)?;
+        }
+        if session.write_pending() > 0 {
+            let interest = session.interest();
+            session.reregister(self.poll.registry(), token, interest)?;
+        } else {
+            session.release_buffers();
+        }
+
+        Ok(())
     }
 
     /// Handle write by flushing the session
@@ -115,28 +882,80 @@ where
             .get_mut(token.0)
             .ok_or_else(|| Error::new(ErrorKind::Other, "non-existant session"))?;
 
+        if !handshake(session, self.poll.registry(), token)? {
+            return Ok(());
+        }
+
+        usdt!(session_flush, token.0, session.write_pending());
         match session.flush() {
-            Ok(_) => Ok(()),
-            Err(e) => map_err(e),
+            Ok(_) => {
+                session.release_buffers();
+            }
+            Err(e) => return map_err(e),
+        }
+
+        // streamed reads which waited for the session to be written out
+        // continue with their next chunks
+        if let Some(pipeline) = self.pipelines.get_mut(token.0) {
+            if Self::stream(
+                &mut self.data_queue,
+                &self.router,
+                self.shards,
+                pipeline,
+                token,
+                session.write_pending(),
+                self.stream_buffer,
+            )? {
+                self.dispatched = true;
+            }
         }
+
+        Ok(())
     }
 
     /// Run the worker in a loop, handling new events.
     pub fn run(&mut self) {
+        affinity::pin(self.core);
+
         // these are buffers which are re-used in each loop iteration to receive
         // events and queue messages
         let mut events = Events::with_capacity(self.nevent);
         let mut messages = Vec::with_capacity(QUEUE_CAPACITY);
+        let mut pushes = Vec::new();
 
         loop {
             WORKER_EVENT_LOOP.increment();
 
-            // get events with timeout
-            if self.poll.poll(&mut events, Some(self.timeout)).is_err() {
+            // the buffer of events is replaced once a reload changes its size
+            if events.capacity() != self.nevent {
+                events = Events::with_capacity(self.nevent);
+            }
+
+            // get events with timeout, which is zero while spinning. Before
+            // blocking, the thread is marked as parked so that the storage
+            // threads wake it, and responses sent just before are picked up
+            // instead
+            let mut timeout = self.spin.timeout(self.timeout);
+            if !self.ready.is_empty() {
+                timeout = Duration::ZERO;
+            } else if !self.throttled.is_empty() {
+                timeout = timeout.min(THROTTLE_RETRY);
+            }
+            if !timeout.is_zero() {
+                self.parking.park();
+                self.data_queue.try_recv_all(&mut messages);
+                self.push_queue.try_recv_all(&mut pushes);
+                if !messages.is_empty() || !pushes.is_empty() {
+                    timeout = Duration::ZERO;
+                }
+            }
+            if self.poll.poll(&mut events, Some(timeout)).is_err() {
                 error!("Error polling");
             }
+            self.parking.unpark();
 
             let count = events.iter().count();
+            self.spin.record(count);
             WORKER_EVENT_TOTAL.add(count as _);
             if count == self.nevent {
                 WORKER_EVENT_MAX_REACHED.increment();
@@ -151,74 +970,26 @@ where
                     WAKER_TOKEN => {
                         self.waker.reset();
                         // handle up to one new session
-                        if let Some(mut session) =
-                            self.session_queue.try_recv().map(|v| v.into_inner())
+                        if let Some(session) = self.session_queue.try_recv().map(|v| v.into_inner())
                         {
-                            let s = self.sessions.vacant_entry();
-                            let interest = session.interest();
-                            if session
-                                .register(self.poll.registry(), Token(s.key()), interest)
-                                .is_ok()
-                            {
-                                s.insert(ServerSession::new(session, self.parser.clone()));
-                            } else {
-                                let _ = self.session_queue.try_send_any(session);
+                            if let Err(session) = self.insert(session) {
+                                let _ = self.session_queue.try_send_any(Handoff::Close(session));
                             }
 
                             // trigger a wake-up in case there are more sessions
                             let _ = self.waker.wake();
                         }
 
-                        // handle all pending messages on the data queue
-                        self.data_queue.try_recv_all(&mut messages);
-                        for (request, response, token) in messages.drain(..).map(|v| v.into_inner())
-                        {
-                            request.klog(&response);
-                            if let Some(session) = self.sessions.get_mut(token.0) {
-                                if response.should_hangup() {
-                                    let _ = session.send(response);
-                                    self.close(token);
-                                    continue;
-                                } else if session.send(response).is_err() {
-                                    self.close(token);
-                                    continue;
-                                } else if session.write_pending() > 0 {
-                                    // try to immediately flush, if we still
-                                    // have pending bytes, reregister. This
-                                    // saves us one syscall when flushing would
-                                    // not block.
-                                    if let Err(e) = session.flush() {
-                                        if map_err(e).is_err() {
-                                            self.close(token);
-                                            continue;
-                                        }
-                                    }
-
-                                    if session.write_pending() > 0 {
-                                        let interest = session.interest();
-                                        if session
-                                            .reregister(self.poll.registry(), token, interest)
-                                            .is_err()
-                                        {
-                                            self.close(token);
-                                            continue;
-                                        }
-                                    }
-                                }
-
-                                if session.remaining() > 0 && self.read(token).is_err() {
-                                    self.close(token);
-                                    continue;
-                                }
-                            }
-                        }
-
                         // check if we received any signals from the admin thread
                         while let Some(signal) =
                             self.signal_queue.try_recv().map(|v| v.into_inner())
                         {
                             match signal {
-                                Signal::FlushAll => {}
+                                Signal::FlushAll | Signal::Invalidate(_) => {}
+                                Signal::Reload(tunables) => {
+                                    self.timeout = Duration::from_millis(tunables.timeout as u64);
+                                    self.nevent = tunables.nevent;
+                                }
                                 Signal::Shutdown => {
                                     // if we received a shutdown, we can return
                                     // and stop processing events
@@ -252,12 +1023,97 @@ where
                                 continue;
                             }
                         }
+
+                        self.migrate(token);
                     }
                 }
             }
 
-            // wakes the storage thread if necessary
-            let _ = self.data_queue.wake();
+            // handle all pending messages on the data queue. This is done on
+            // every iteration, as the storage threads only wake this thread
+            // while it is parked
+            self.data_queue.try_recv_all(&mut messages);
+            INFLIGHT.fetch_sub(messages.len(), Ordering::Relaxed);
+            for (request, response, queued, tag) in messages.drain(..).map(|v| v.into_inner()) {
+                let latencies = request.latencies();
+                let _ = latencies.queue.increment(queued.elapsed().as_nanos() as _);
+                if self.respond(tag, request, response).is_err() {
+                    self.close(tag.token);
+                } else {
+                    self.migrate(tag.token);
+                }
+            }
+
+            self.push_queue.try_recv_all(&mut pushes);
+            for (response, tag) in pushes.drain(..).map(|v| v.into_inner()) {
+                if self.push(tag, response).is_err() {
+                    self.close(tag.token);
+                }
+            }
+
+            // read each session which is waiting for its turn once, those
+            // which still have requests left go to the back of the queue
+            for _ in 0..self.ready.len() {
+                let Some(token) = self.ready.pop_front() else {
+                    break;
+                };
+                // the session may have been closed or moved since
+                if !self.sessions.contains(token.0) {
+                    continue;
+                }
+                self.pipelines[token.0].ready = false;
+                if self.read(token).is_err() {
+                    self.close(token);
+                } else {
+                    self.migrate(token);
+                }
+            }
+
+            // retry the sessions which were over their rate limit, those which
+            // still are go back on the queue
+            for _ in 0..self.throttled.len() {
+                let Some(token) = self.throttled.pop_front() else {
+                    break;
+                };
+                // the session may have been closed or moved since
+                if !self.sessions.contains(token.0) {
+                    continue;
+                }
+                self.pipelines[token.0].throttled = false;
+                if self.read(token).is_err() {
+                    self.close(token);
+                } else {
+                    self.migrate(token);
+                }
+            }
+
+            // resume the reads which were put off while the limit of requests
+            // in flight was reached
+            while !inflight_reached() {
+                let Some(token) = self.deferred.pop_front() else {
+                    break;
+                };
+                if self.read(token).is_err() {
+                    self.close(token);
+                }
+            }
+
+            if let Some(balance) = &mut self.balance {
+                balance.update();
+            }
+
+            self.cycles.flush();
+
+            // wakes the storage threads if any are parked, as those which are
+            // awake pick up the requests anyway
+            if self.dispatched {
+                self.dispatched = false;
+                if self.parking.any_parked(0..self.parking.peers()) {
+                    let _ = self.data_queue.wake();
+                } else {
+                    QUEUE_WAKE_SUPPRESSED.increment();
+                }
+            }
         }
     }
 }
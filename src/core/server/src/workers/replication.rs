@@ -0,0 +1,864 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Asynchronous replication of the writes executed by the storage threads.
+//!
+//! On a primary, each storage thread appends the requests which changed its
+//! storage to a buffer after executing a batch, in the wire format they are
+//! parsed from, and hands the buffer to the replication thread without
+//! waiting. The replication thread coalesces the batches, compresses them, and
+//! writes them as frames to every connected replica. Batches are dropped if the
+//! replication thread falls behind, and a replica which falls behind is
+//! disconnected, so that replication never slows down the storage threads.
+//!
+//! On a replica, the replication thread reads the frames from the primary,
+//! parses the requests, and hands them to the storage thread for their key,
+//! which executes them between batches of requests from clients. Replicas
+//! start from the point in the stream at which they connect.
+//!
+//! A replica may also ask to be warmed when it connects, such as when it is a
+//! new node which would otherwise start cold. The replication thread of the
+//! primary then asks each storage thread in turn for the next chunk of an
+//! export of its items, and sends the chunks to that replica alone, as records
+//! which the storage threads of the replica store directly without parsing
+//! them as requests. A chunk is only requested once the previous one has been
+//! written to the replica, which bounds the memory held for it. The chunks of
+//! a storage thread are sent in order with its writes, so a write which
+//! follows an item in the stream is applied after it. Without warming, items
+//! written while a replica was disconnected are missing until they are written
+//! again.
+
+use super::*;
+use crossbeam_channel::{Receiver, RecvTimeoutError, TrySendError};
+use entrystore::Export;
+use std::collections::VecDeque;
+use std::io::{Read, Write};
+use std::net::{SocketAddr, TcpListener, TcpStream};
+use std::time::{SystemTime, UNIX_EPOCH};
+
+#[metric(
+    name = "replication_batch",
+    description = "the number of batches of writes handed to the replication thread"
+)]
+pub static REPLICATION_BATCH: Counter = Counter::new();
+
+#[metric(
+    name = "replication_drop",
+    description = "the number of batches of writes dropped because the replication queue was full"
+)]
+pub static REPLICATION_DROP: Counter = Counter::new();
+
+#[metric(
+    name = "replication_bytes",
+    description = "the number of bytes of writes sent to replicas, before compression"
+)]
+pub static REPLICATION_BYTES: Counter = Counter::new();
+
+#[metric(
+    name = "replication_bytes_compressed",
+    description = "the number of bytes of writes sent to replicas, after compression"
+)]
+pub static REPLICATION_BYTES_COMPRESSED: Counter = Counter::new();
+
+#[metric(
+    name = "replication_warm_bytes",
+    description = "the number of bytes of exported items sent to warm replicas, before compression"
+)]
+pub static REPLICATION_WARM_BYTES: Counter = Counter::new();
+
+#[metric(
+    name = "replication_replicas",
+    description = "the number of replicas connected to this primary"
+)]
+pub static REPLICATION_REPLICAS: Gauge = Gauge::new();
+
+#[metric(
+    name = "replication_disconnect",
+    description = "the number of replicas disconnected, including for falling behind"
+)]
+pub static REPLICATION_DISCONNECT: Counter = Counter::new();
+
+#[metric(
+    name = "replication_connect",
+    description = "the number of times this replica connected to its primary"
+)]
+pub static REPLICATION_CONNECT: Counter = Counter::new();
+
+#[metric(
+    name = "replication_applied",
+    description = "the number of requests from the primary applied by this replica"
+)]
+pub static REPLICATION_APPLIED: Counter = Counter::new();
+
+#[metric(
+    name = "replication_imported",
+    description = "the number of items exported by the primary which were stored by this replica"
+)]
+pub static REPLICATION_IMPORTED: Counter = Counter::new();
+
+#[metric(
+    name = "replication_lag",
+    description = "the time in milliseconds from the primary executing the last applied writes until the replica applied them"
+)]
+pub static REPLICATION_LAG: Gauge = Gauge::new();
+
+#[metric(
+    name = "replication_lag_ns",
+    description = "the distribution of the time in nanoseconds from the primary executing writes until the replica applied them"
+)]
+pub static REPLICATION_LAG_NS: AtomicHistogram = AtomicHistogram::new(7, 64);
+
+// each frame is a header of the kind, the time at which the oldest of its
+// writes was executed in nanoseconds since the unix epoch, the length of the
+// data, and the length of the compressed data which follows the header
+const FRAME_HEADER: usize = 1 + 8 + 4 + 4;
+const FRAME_WRITES: u8 = 1;
+const FRAME_FLUSH: u8 = 2;
+const FRAME_ITEMS: u8 = 3;
+const FRAME_WARMED: u8 = 4;
+
+// a replica starts by sending whether it is to be warmed, followed by the
+// first and last of the range of key hashes and the minimum frequency of the
+// items to warm it with
+const HELLO_LEN: usize = 1 + 8 + 8 + 1;
+
+// batches are coalesced into one frame until it holds at least this many
+// bytes of writes
+const FRAME_TARGET: usize = 1024 * 1024;
+
+// the largest frame a replica accepts, which guards against a corrupt stream
+const FRAME_MAX: usize = 1024 * 1024 * 1024;
+
+// the next chunk of an export is only requested for a replica with fewer than
+// this many bytes waiting to be written to it
+const WARM_PENDING: usize = 4 * 1024 * 1024;
+
+// how long the replication thread of a primary waits for writes before
+// checking for new replicas, and how long it waits while there is still work
+// for a replica, such as writes pending for a socket which was full
+const POLL_TIMEOUT: Duration = Duration::from_millis(100);
+const PENDING_TIMEOUT: Duration = Duration::from_millis(1);
+
+fn unix_nanos() -> u64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_nanos() as u64)
+        .unwrap_or(0)
+}
+
+/// The writes of one batch executed by a storage thread, a flush of all of the
+/// items, or a chunk of the items exported to warm a replica.
+pub enum Batch {
+    Writes {
+        timestamp: u64,
+        data: Vec<u8>,
+    },
+    Flush {
+        timestamp: u64,
+    },
+    Items {
+        subscriber: u64,
+        storage: usize,
+        export: Export,
+        data: Vec<u8>,
+        done: bool,
+    },
+}
+
+/// The requests of one frame for a storage thread of a replica.
+pub enum Apply<Request> {
+    Requests(Vec<Request>),
+    Import(Arc<Vec<u8>>),
+    Flush,
+}
+
+/// The writes of a storage thread, which are handed to the replication thread
+/// after each batch, along with the requests for chunks of its items.
+pub struct Stream {
+    buffer: Vec<u8>,
+    exports: Receiver<(u64, Export)>,
+    // every storage thread receives a flush_all from the admin thread, so the
+    // flush is only replicated by one of them
+    flushes: bool,
+    id: usize,
+    retry: Vec<(u64, Export)>,
+    sender: Sender<Batch>,
+}
+
+impl Stream {
+    /// Appends the requests of an executed batch which changed the storage, as
+    /// told by their responses, and hands them to the replication thread.
+    pub fn record<Request: Replicate<Response>, Response>(
+        &mut self,
+        requests: &[Request],
+        responses: &[Response],
+    ) {
+        for (request, response) in requests.iter().zip(responses) {
+            request.replicate(response, &mut self.buffer);
+        }
+
+        if !self.buffer.is_empty() {
+            let data = std::mem::take(&mut self.buffer);
+            self.send(Batch::Writes {
+                timestamp: unix_nanos(),
+                data,
+            });
+        }
+    }
+
+    /// Replicates a flush of all of the items.
+    pub fn flush_all(&mut self) {
+        if self.flushes {
+            self.send(Batch::Flush {
+                timestamp: unix_nanos(),
+            });
+        }
+    }
+
+    /// Exports the next chunk of the items for each replica being warmed.
+    pub fn export<Storage: EntryStore>(&mut self, storage: &mut Storage) {
+        let mut requests = std::mem::take(&mut self.retry);
+        requests.extend(self.exports.try_iter());
+
+        let mut requests = requests.into_iter();
+        while let Some((subscriber, export)) = requests.next() {
+            let mut next = export.clone();
+            let mut data = Vec::new();
+            let done = storage.export(&mut next, &mut data);
+
+            let batch = Batch::Items {
+                subscriber,
+                storage: self.id,
+                export: next,
+                data,
+                done,
+            };
+            match self.sender.try_send(batch) {
+                Ok(()) => {}
+                // unlike writes, chunks are never dropped. The chunk is
+                // exported again once there is room, and is then still
+                // behind any writes sent in the meantime.
+                Err(TrySendError::Full(_)) => {
+                    self.retry.push((subscriber, export));
+                    self.retry.extend(requests);
+                    return;
+                }
+                Err(TrySendError::Disconnected(_)) => return,
+            }
+        }
+    }
+
+    fn send(&mut self, batch: Batch) {
+        match self.sender.try_send(batch) {
+            Ok(()) => {
+                REPLICATION_BATCH.increment();
+            }
+            Err(TrySendError::Full(_)) => {
+                REPLICATION_DROP.increment();
+            }
+            // the replication thread has exited
+            Err(TrySendError::Disconnected(_)) => {}
+        }
+    }
+}
+
+/// A replica connected to this primary, along with the frames which have not
+/// yet been written to it.
+struct Subscriber {
+    id: u64,
+    peer: SocketAddr,
+    pending: Vec<u8>,
+    stream: TcpStream,
+    // the bytes of the hello received so far, until it is complete
+    hello: Option<Vec<u8>>,
+    // the exports of the storage threads which are still warming the replica,
+    // which take turns to export the next chunk, and whether a chunk has been
+    // requested and not yet received
+    exports: VecDeque<(usize, Export)>,
+    exporting: bool,
+}
+
+impl Subscriber {
+    fn disconnect(&self) {
+        REPLICATION_REPLICAS.decrement();
+        REPLICATION_DISCONNECT.increment();
+    }
+}
+
+/// The replication thread of a primary, which sends the writes of its storage
+/// threads to each of its replicas.
+pub struct Primary {
+    compressor: zstd::bulk::Compressor<'static>,
+    exports: Vec<(Sender<(u64, Export)>, Arc<Waker>)>,
+    frame: Vec<u8>,
+    listener: TcpListener,
+    max_pending: usize,
+    next_id: u64,
+    receiver: Receiver<Batch>,
+    subscribers: Vec<Subscriber>,
+}
+
+impl Primary {
+    /// Creates the replication thread of a primary for the storage threads
+    /// with the provided wakers, returning it along with the stream for each
+    /// storage thread.
+    pub fn new(
+        addr: SocketAddr,
+        config: &config::Replication,
+        wakers: Vec<Arc<Waker>>,
+    ) -> Result<(Self, Vec<Stream>)> {
+        let listener = TcpListener::bind(addr)?;
+        listener.set_nonblocking(true)?;
+
+        let compressor = zstd::bulk::Compressor::new(config.compression_level())?;
+
+        let (sender, receiver) = bounded(config.queue_depth());
+
+        let mut exports = Vec::new();
+        let mut streams = Vec::new();
+        for (id, waker) in wakers.into_iter().enumerate() {
+            // a storage thread has at most one chunk requested per replica
+            let (export_sender, export_receiver) = bounded(QUEUE_CAPACITY);
+            exports.push((export_sender, waker));
+            streams.push(Stream {
+                buffer: Vec::new(),
+                exports: export_receiver,
+                flushes: id == 0,
+                id,
+                retry: Vec::new(),
+                sender: sender.clone(),
+            });
+        }
+
+        Ok((
+            Self {
+                compressor,
+                exports,
+                frame: Vec::new(),
+                listener,
+                max_pending: config.max_pending(),
+                next_id: 0,
+                receiver,
+                subscribers: Vec::new(),
+            },
+            streams,
+        ))
+    }
+
+    /// Runs the replication thread until every storage thread has exited.
+    pub fn run(&mut self) {
+        loop {
+            self.accept();
+            self.handshake();
+            self.warm();
+
+            let busy = self
+                .subscribers
+                .iter()
+                .any(|s| !s.pending.is_empty() || s.hello.is_some() || !s.exports.is_empty());
+            let timeout = if busy { PENDING_TIMEOUT } else { POLL_TIMEOUT };
+
+            match self.receiver.recv_timeout(timeout) {
+                Ok(batch) => self.coalesce(batch),
+                Err(RecvTimeoutError::Timeout) => {}
+                Err(RecvTimeoutError::Disconnected) => return,
+            }
+
+            self.write();
+        }
+    }
+
+    fn accept(&mut self) {
+        loop {
+            match self.listener.accept() {
+                Ok((stream, peer)) => {
+                    if stream.set_nonblocking(true).is_err() {
+                        continue;
+                    }
+                    let _ = stream.set_nodelay(true);
+                    info!("replica connected: {}", peer);
+                    REPLICATION_REPLICAS.increment();
+                    self.next_id += 1;
+                    self.subscribers.push(Subscriber {
+                        id: self.next_id,
+                        peer,
+                        pending: Vec::new(),
+                        stream,
+                        hello: Some(Vec::new()),
+                        exports: VecDeque::new(),
+                        exporting: false,
+                    });
+                }
+                Err(e) => {
+                    if e.kind() != ErrorKind::WouldBlock {
+                        error!("error accepting replica: {}", e);
+                    }
+                    return;
+                }
+            }
+        }
+    }
+
+    /// Reads the hello of each new replica, and starts an export from every
+    /// storage thread for those which asked to be warmed.
+    fn handshake(&mut self) {
+        let storage = self.exports.len();
+
+        self.subscribers.retain_mut(|subscriber| {
+            let Some(hello) = subscriber.hello.as_mut() else {
+                return true;
+            };
+
+            let mut buf = [0; HELLO_LEN];
+            match subscriber.stream.read(&mut buf[..HELLO_LEN - hello.len()]) {
+                Ok(0) => {
+                    info!("replica disconnected: {}", subscriber.peer);
+                    subscriber.disconnect();
+                    return false;
+                }
+                Ok(n) => hello.extend_from_slice(&buf[..n]),
+                Err(e) if e.kind() == ErrorKind::WouldBlock => return true,
+                Err(e) if e.kind() == ErrorKind::Interrupted => return true,
+                Err(e) => {
+                    info!("replica disconnected: {}: {}", subscriber.peer, e);
+                    subscriber.disconnect();
+                    return false;
+                }
+            }
+
+            if hello.len() < HELLO_LEN {
+                return true;
+            }
+
+            if hello[0] != 0 {
+                let start = u64::from_be_bytes(hello[1..9].try_into().unwrap());
+                let end = u64::from_be_bytes(hello[9..17].try_into().unwrap());
+                let export = Export::new(start..=end, hello[17]);
+                info!("warming replica: {}", subscriber.peer);
+                subscriber.exports = (0..storage).map(|id| (id, export.clone())).collect();
+            }
+            subscriber.hello = None;
+
+            true
+        });
+    }
+
+    /// Requests the next chunk of an export for each replica being warmed
+    /// which has written out most of the previous one.
+    fn warm(&mut self) {
+        for subscriber in self.subscribers.iter_mut() {
+            if subscriber.exporting || subscriber.pending.len() >= WARM_PENDING {
+                continue;
+            }
+
+            if let Some((storage, export)) = subscriber.exports.pop_front() {
+                let (sender, waker) = &self.exports[storage];
+                if sender.try_send((subscriber.id, export.clone())).is_ok() {
+                    subscriber.exporting = true;
+                    let _ = waker.wake();
+                } else {
+                    subscriber.exports.push_front((storage, export));
+                }
+            }
+        }
+    }
+
+    /// Coalesces the batches which are already queued into frames, in order,
+    /// and adds them to the pending writes of each replica.
+    fn coalesce(&mut self, batch: Batch) {
+        let mut timestamp = 0;
+        let mut next = Some(batch);
+
+        while let Some(batch) = next.take() {
+            match batch {
+                Batch::Writes { timestamp: t, data } => {
+                    if self.frame.is_empty() {
+                        timestamp = t;
+                    }
+                    self.frame.extend_from_slice(&data);
+                }
+                Batch::Flush { timestamp: t } => {
+                    self.broadcast(FRAME_WRITES, timestamp);
+                    self.broadcast(FRAME_FLUSH, t);
+                }
+                Batch::Items {
+                    subscriber,
+                    storage,
+                    export,
+                    data,
+                    done,
+                } => {
+                    // the writes which preceded the chunk are sent first
+                    self.broadcast(FRAME_WRITES, timestamp);
+                    self.items(subscriber, storage, export, &data, done);
+                }
+            }
+
+            if self.frame.len() < FRAME_TARGET {
+                next = self.receiver.try_recv().ok();
+            }
+        }
+
+        self.broadcast(FRAME_WRITES, timestamp);
+    }
+
+    /// Returns the frame with its data compressed.
+    fn compose(&mut self, kind: u8, timestamp: u64, data: &[u8]) -> Option<Vec<u8>> {
+        let compressed = match self.compressor.compress(data) {
+            Ok(compressed) => compressed,
+            Err(e) => {
+                error!("error compressing replication stream: {}", e);
+                return None;
+            }
+        };
+
+        REPLICATION_BYTES_COMPRESSED.add(compressed.len() as _);
+
+        let mut frame = Vec::with_capacity(FRAME_HEADER + compressed.len());
+        frame.push(kind);
+        frame.extend_from_slice(&timestamp.to_be_bytes());
+        frame.extend_from_slice(&(data.len() as u32).to_be_bytes());
+        frame.extend_from_slice(&(compressed.len() as u32).to_be_bytes());
+        frame.extend_from_slice(&compressed);
+        Some(frame)
+    }
+
+    /// Compresses the writes of the frame and adds it to the pending writes of
+    /// each replica. Replicas with more than the max pending bytes are
+    /// disconnected.
+    fn broadcast(&mut self, kind: u8, timestamp: u64) {
+        let mut data = std::mem::take(&mut self.frame);
+        if kind == FRAME_WRITES && data.is_empty() || self.subscribers.is_empty() {
+            data.clear();
+            self.frame = data;
+            return;
+        }
+
+        REPLICATION_BYTES.add(data.len() as _);
+        let frame = self.compose(kind, timestamp, &data);
+        data.clear();
+        self.frame = data;
+
+        let Some(frame) = frame else {
+            return;
+        };
+
+        let max_pending = self.max_pending;
+        self.subscribers.retain_mut(|subscriber| {
+            subscriber.pending.extend_from_slice(&frame);
+            if subscriber.pending.len() > max_pending {
+                warn!(
+                    "disconnecting replica which fell behind: {}",
+                    subscriber.peer
+                );
+                subscriber.disconnect();
+                false
+            } else {
+                true
+            }
+        });
+    }
+
+    /// Adds a chunk of an export to the pending writes of the replica it was
+    /// requested for, and queues the export for its next chunk.
+    fn items(&mut self, id: u64, storage: usize, export: Export, data: &[u8], done: bool) {
+        let Some(index) = self.subscribers.iter().position(|s| s.id == id) else {
+            return;
+        };
+
+        let frame = if data.is_empty() {
+            None
+        } else {
+            REPLICATION_WARM_BYTES.add(data.len() as _);
+            self.compose(FRAME_ITEMS, unix_nanos(), data)
+        };
+        let warmed = if done
+            && self.subscribers[index].exports.is_empty()
+            && self.subscribers[index].hello.is_none()
+        {
+            self.compose(FRAME_WARMED, unix_nanos(), &[])
+        } else {
+            None
+        };
+
+        let subscriber = &mut self.subscribers[index];
+        subscriber.exporting = false;
+        if let Some(frame) = frame {
+            subscriber.pending.extend_from_slice(&frame);
+        }
+        if done {
+            if let Some(warmed) = warmed {
+                info!("warmed replica: {}", subscriber.peer);
+                subscriber.pending.extend_from_slice(&warmed);
+            }
+        } else {
+            subscriber.exports.push_back((storage, export));
+        }
+    }
+
+    /// Writes as much of the pending frames to each replica as its socket
+    /// takes, disconnecting replicas which hung up.
+    fn write(&mut self) {
+        self.subscribers.retain_mut(|subscriber| {
+            while !subscriber.pending.is_empty() {
+                match subscriber.stream.write(&subscriber.pending) {
+                    Ok(0) => break,
+                    Ok(n) => {
+                        subscriber.pending.drain(..n);
+                    }
+                    Err(e) if e.kind() == ErrorKind::WouldBlock => return true,
+                    Err(e) if e.kind() == ErrorKind::Interrupted => {}
+                    Err(e) => {
+                        info!("replica disconnected: {}: {}", subscriber.peer, e);
+                        subscriber.disconnect();
+                        return false;
+                    }
+                }
+            }
+            true
+        });
+    }
+}
+
+/// The writes from the primary for one storage thread of a replica.
+pub struct ReplicaQueue<Request> {
+    receiver: Receiver<Apply<Request>>,
+    router: Router,
+    shard: usize,
+    shards: usize,
+}
+
+impl<Request> ReplicaQueue<Request> {
+    /// Applies the writes which have been received, discarding their
+    /// responses. Exported items are sent to every storage thread, and each
+    /// stores those whose keys it owns.
+    pub fn apply<Response, Storage>(
+        &self,
+        storage: &mut Storage,
+        responses: &mut Vec<Response>,
+        cycles: &mut CycleCounts,
+    ) where
+        Request: Timed,
+        Response: Compose,
+        Storage: Execute<Request, Response> + EntryStore,
+    {
+        while let Ok(apply) = self.receiver.try_recv() {
+            match apply {
+                Apply::Requests(requests) => {
+                    execute_batch(storage, &requests, responses, cycles);
+                    REPLICATION_APPLIED.add(requests.len() as _);
+                    responses.clear();
+                }
+                Apply::Import(data) => {
+                    let owned = |key: &[u8]| self.shards == 1 || (self.router)(key) == self.shard;
+                    match storage.import(&data, &owned) {
+                        Ok(imported) => REPLICATION_IMPORTED.add(imported as _),
+                        Err(e) => error!("error importing items from primary: {}", e),
+                    }
+                }
+                Apply::Flush => {
+                    storage.clear();
+                }
+            }
+        }
+    }
+}
+
+/// The replication thread of a replica, which applies the writes of its
+/// primary to its storage threads.
+pub struct Replica<Parser, Request, Response> {
+    parser: Parser,
+    primary: SocketAddr,
+    reconnect: Duration,
+    router: Router,
+    storage: Vec<(Sender<Apply<Request>>, Arc<Waker>)>,
+    warm: Option<Export>,
+    _response: PhantomData<Response>,
+}
+
+impl<Parser, Request, Response> Replica<Parser, Request, Response>
+where
+    Parser: Parse<Request>,
+    Request: Shard<Response>,
+{
+    /// Creates the replication thread of a replica which applies the writes
+    /// of the primary to the storage threads, along with the queue for each
+    /// storage thread. Requests are routed to the storage threads by key. The
+    /// parser must read ttls as a number of seconds.
+    pub fn new(
+        primary: SocketAddr,
+        config: &config::Replication,
+        parser: Parser,
+        wakers: Vec<Arc<Waker>>,
+        router: Router,
+    ) -> (Self, Vec<ReplicaQueue<Request>>) {
+        let shards = wakers.len();
+
+        let mut storage = Vec::new();
+        let mut queues = Vec::new();
+        for (shard, waker) in wakers.into_iter().enumerate() {
+            let (sender, receiver) = bounded(config.queue_depth());
+            storage.push((sender, waker));
+            queues.push(ReplicaQueue {
+                receiver,
+                router: router.clone(),
+                shard,
+                shards,
+            });
+        }
+
+        // the range of key hashes is given by its upper 32 bits
+        let warm = config.warm().then(|| {
+            let start = (config.warm_start() as u64) << 32;
+            let end = (config.warm_end() as u64) << 32 | u32::MAX as u64;
+            Export::new(start..=end, config.warm_min_freq())
+        });
+
+        (
+            Self {
+                parser,
+                primary,
+                reconnect: Duration::from_millis(config.reconnect() as u64),
+                router,
+                storage,
+                warm,
+                _response: PhantomData,
+            },
+            queues,
+        )
+    }
+
+    /// Runs the replication thread, connecting to the primary again whenever
+    /// the connection is lost, until the storage threads have exited.
+    pub fn run(&mut self) {
+        loop {
+            match TcpStream::connect(self.primary) {
+                Ok(stream) => {
+                    info!("connected to primary: {}", self.primary);
+                    REPLICATION_CONNECT.increment();
+                    match self.apply(stream) {
+                        Ok(()) => return,
+                        Err(e) => warn!("lost connection to primary: {}: {}", self.primary, e),
+                    }
+                }
+                Err(e) => {
+                    warn!("error connecting to primary: {}: {}", self.primary, e);
+                }
+            }
+
+            std::thread::sleep(self.reconnect);
+        }
+    }
+
+    /// Applies the frames read from the primary until the connection is lost,
+    /// which returns an error, or until the storage threads have exited.
+    fn apply(&mut self, mut stream: TcpStream) -> Result<()> {
+        let mut hello = [0; HELLO_LEN];
+        if let Some(export) = &self.warm {
+            hello[0] = 1;
+            hello[1..9].copy_from_slice(&export.hashes().start().to_be_bytes());
+            hello[9..17].copy_from_slice(&export.hashes().end().to_be_bytes());
+            hello[17] = export.min_freq();
+        }
+        stream.write_all(&hello)?;
+
+        let mut decompressor = zstd::bulk::Decompressor::new()?;
+        let mut header = [0; FRAME_HEADER];
+        let mut compressed = Vec::new();
+
+        loop {
+            stream.read_exact(&mut header)?;
+
+            let kind = header[0];
+            let timestamp = u64::from_be_bytes(header[1..9].try_into().unwrap());
+            let len = u32::from_be_bytes(header[9..13].try_into().unwrap()) as usize;
+            let clen = u32::from_be_bytes(header[13..17].try_into().unwrap()) as usize;
+
+            if len > FRAME_MAX || clen > FRAME_MAX {
+                return Err(Error::new(
+                    ErrorKind::InvalidData,
+                    "replication frame is too large",
+                ));
+            }
+
+            compressed.resize(clen, 0);
+            stream.read_exact(&mut compressed)?;
+
+            let applied = match kind {
+                FRAME_WRITES => {
+                    let data = decompressor.decompress(&compressed, len)?;
+                    let applied = self.writes(&data)?;
+
+                    let lag = unix_nanos().saturating_sub(timestamp);
+                    REPLICATION_LAG.set((lag / 1_000_000) as _);
+                    let _ = REPLICATION_LAG_NS.increment(lag);
+
+                    applied
+                }
+                FRAME_FLUSH => {
+                    warn!("received flush_all from primary");
+                    self.broadcast(|| Apply::Flush)
+                }
+                FRAME_ITEMS => {
+                    let data = Arc::new(decompressor.decompress(&compressed, len)?);
+                    self.broadcast(|| Apply::Import(data.clone()))
+                }
+                FRAME_WARMED => {
+                    info!("warmed from primary: {}", self.primary);
+                    true
+                }
+                _ => {
+                    return Err(Error::new(
+                        ErrorKind::InvalidData,
+                        "unknown replication frame",
+                    ));
+                }
+            };
+
+            if !applied {
+                return Ok(());
+            }
+        }
+    }
+
+    /// Hands a copy of the message to every storage thread. Returns false if
+    /// a storage thread has exited.
+    fn broadcast(&self, apply: impl Fn() -> Apply<Request>) -> bool {
+        self.storage.iter().all(|(sender, waker)| {
+            let sent = sender.send(apply()).is_ok();
+            let _ = waker.wake();
+            sent
+        })
+    }
+
+    /// Parses the writes of a frame and hands them to the storage thread for
+    /// their key. Returns false if a storage thread has exited.
+    fn writes(&mut self, mut data: &[u8]) -> Result<bool> {
+        let mut batches: Vec<Vec<Request>> = self.storage.iter().map(|_| Vec::new()).collect();
+
+        while !data.is_empty() {
+            let parsed = self.parser.parse(data)?;
+            data = &data[parsed.consumed()..];
+
+            let request = parsed.into_inner();
+            let shard = match request.shard_key() {
+                Some(key) if batches.len() > 1 => (self.router)(key),
+                _ => 0,
+            };
+            batches[shard].push(request);
+        }
+
+        for (batch, (sender, waker)) in batches.into_iter().zip(self.storage.iter()) {
+            if batch.is_empty() {
+                continue;
+            }
+            if sender.send(Apply::Requests(batch)).is_err() {
+                return Ok(false);
+            }
+            let _ = waker.wake();
+        }
+
+        Ok(true)
+    }
+}
@@ -3,17 +3,23 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use super::*;
-use std::collections::VecDeque;
+use crate::listener::{LISTENER_ACCEPT_BATCH, LISTENER_ACCEPT_LATENCY};
+use std::collections::{HashMap, VecDeque};
 
 pub struct SingleWorkerBuilder<Parser, Request, Response, Storage> {
+    core: Option<usize>,
+    listener: Option<pelikan_net::Listener>,
     nevent: usize,
     parser: Parser,
     pending: VecDeque<Token>,
     poll: Poll,
+    spin: Spin,
     sessions: Slab<ServerSession<Parser, Response, Request>>,
     storage: Storage,
     timeout: Duration,
+    udp: Option<Udp<Request, Response>>,
     waker: Arc<Waker>,
+    cycles: bool,
 }
 
 impl<Parser, Request, Response, Storage> SingleWorkerBuilder<Parser, Request, Response, Storage> {
@@ -28,142 +34,489 @@ impl<Parser, Request, Response, Storage> SingleWorkerBuilder<Parser, Request, Re
 
         let nevent = config.nevent();
         let timeout = Duration::from_millis(config.timeout() as u64);
+        let spin = Spin::new(Duration::from_micros(config.spin() as u64));
 
         Ok(Self {
+            core: None,
+            listener: None,
             nevent,
             parser,
             pending: VecDeque::new(),
             poll,
+            spin,
             sessions: Slab::new(),
             storage,
             timeout,
+            udp: None,
             waker,
+            cycles: config.cycles(),
         })
     }
 
+    /// Binds a UDP socket for this worker with `SO_REUSEPORT` if a udp port
+    /// is set in the server config, from which it serves the requests which
+    /// may be served from datagrams.
+    pub fn udp<T: ServerConfig>(mut self, config: &T) -> Result<Self> {
+        let addr = match config.server().udp_addr() {
+            Some(addr) => addr.map_err(|e| {
+                error!("{}", e);
+                Error::new(ErrorKind::Other, "Bad udp listen address")
+            })?,
+            None => return Ok(self),
+        };
+
+        self.udp = Some(Udp::bind(addr, self.poll.registry())?);
+        Ok(self)
+    }
+
+    /// Binds a listener for this worker with `SO_REUSEPORT` so that it accepts
+    /// new sessions directly instead of receiving them from the `Listener`.
+    /// Sessions are also closed by the worker itself. As there is no listener
+    /// thread to negotiate TLS, this returns an error if TLS is configured.
+    pub fn listen<T: ServerConfig + TlsConfig>(mut self, config: &T) -> Result<Self> {
+        if tls_acceptor(config.tls())?.is_some() {
+            return Err(Error::new(
+                ErrorKind::Other,
+                "reuseport is not supported with tls",
+            ));
+        }
+
+        if config.server().socket().is_some() {
+            return Err(Error::new(
+                ErrorKind::Other,
+                "reuseport is not supported on a unix domain socket",
+            ));
+        }
+
+        let addr = config.server().socket_addr().map_err(|e| {
+            error!("{}", e);
+            Error::new(ErrorKind::Other, "Bad listen address")
+        })?;
+
+        let tcp_listener = TcpListener::bind_reuseport(addr)?;
+        crate::listener::tune(&tcp_listener, config.server());
+
+        let mut listener = pelikan_net::Listener::from(tcp_listener);
+        listener.register(self.poll.registry(), LISTENER_TOKEN, Interest::READABLE)?;
+
+        self.listener = Some(listener);
+        Ok(self)
+    }
+
+    /// Pins the worker thread to the provided core once it runs.
+    pub fn core(mut self, core: Option<usize>) -> Self {
+        self.core = core;
+        self
+    }
+
     pub fn waker(&self) -> Arc<Waker> {
         self.waker.clone()
     }
 
+    /// Returns true if the worker accepts sessions from its own listener, in
+    /// which case it is built without a session queue.
+    pub fn is_listening(&self) -> bool {
+        self.listener.is_some()
+    }
+
     pub fn build(
         self,
-        session_queue: Queues<Session, Session>,
+        session_queue: Option<Queues<Handoff, Session>>,
         signal_queue: Queues<(), Signal>,
+        balance: Option<Balance>,
     ) -> SingleWorker<Parser, Request, Response, Storage> {
         SingleWorker {
+            balance,
+            core: self.core,
+            ingests: HashMap::new(),
+            listener: self.listener,
             nevent: self.nevent,
             parser: self.parser,
             pending: self.pending,
             poll: self.poll,
+            spin: self.spin,
+            requests: Vec::with_capacity(PIPELINE_BATCH),
+            responses: Vec::with_capacity(PIPELINE_BATCH),
             session_queue,
             sessions: self.sessions,
             signal_queue,
             storage: self.storage,
             timeout: self.timeout,
+            udp: self.udp,
             waker: self.waker,
+            cycles: CycleCounts::new(self.cycles),
         }
     }
 }
 
 pub struct SingleWorker<Parser, Request, Response, Storage> {
+    balance: Option<Balance>,
+    core: Option<usize>,
+    ingests: HashMap<usize, Ingesting<Request>>,
+    listener: Option<pelikan_net::Listener>,
     nevent: usize,
     parser: Parser,
     pending: VecDeque<Token>,
     poll: Poll,
-    session_queue: Queues<Session, Session>,
+    spin: Spin,
+    requests: Vec<Request>,
+    responses: Vec<Response>,
+    session_queue: Option<Queues<Handoff, Session>>,
     sessions: Slab<ServerSession<Parser, Response, Request>>,
     signal_queue: Queues<(), Signal>,
     storage: Storage,
     timeout: Duration,
+    udp: Option<Udp<Request, Response>>,
     waker: Arc<Waker>,
+    cycles: CycleCounts,
+}
+
+/// A request of a session whose value is being read straight into the room
+/// reserved for it in storage.
+struct Ingesting<Request> {
+    request: Request,
+    // the id of the reservation in storage
+    id: usize,
+    // the number of bytes of the value which have been read
+    read: usize,
+    // the bytes which end the request after its value
+    trailer: &'static [u8],
 }
 
 impl<Parser, Request, Response, Storage> SingleWorker<Parser, Request, Response, Storage>
 where
     Parser: Parse<Request> + Clone,
-    Request: Klog + Klog<Response = Response>,
+    Request: Datagram + Klog + Klog<Response = Response> + Timed,
     Response: Compose,
     Storage: EntryStore + Execute<Request, Response>,
 {
-    /// Return the `Session` to the `Listener` to handle flush/close
+    /// Return the `Session` to the `Listener` to handle flush/close, or flush
+    /// and close it here if this worker has its own listener
     fn close(&mut self, token: Token) {
+        if let Some(balance) = &mut self.balance {
+            balance.remove(token);
+        }
+
+        // the value of a request which was not read in full is not stored
+        if let Some(ingesting) = self.ingests.remove(&token.0) {
+            self.storage.abort(ingesting.id);
+        }
+
         if self.sessions.contains(token.0) {
             let mut session = self.sessions.remove(token.0).into_inner();
             let _ = self.poll.registry().deregister(&mut session);
-            let _ = self.session_queue.try_send_any(session);
-            let _ = self.session_queue.wake();
+            if let Some(session_queue) = &mut self.session_queue {
+                let _ = session_queue.try_send_any(Handoff::Close(session));
+                let _ = session_queue.wake();
+            } else {
+                let _ = session.flush();
+            }
+        }
+    }
+
+    /// Registers a session received from the `Listener`, or returns it if it
+    /// cannot be registered
+    fn insert(&mut self, mut session: Session) -> std::result::Result<(), Session> {
+        let s = self.sessions.vacant_entry();
+        let interest = session.interest();
+        if session
+            .register(self.poll.registry(), Token(s.key()), interest)
+            .is_err()
+        {
+            return Err(session);
+        }
+        let parser = self.parser.for_listener(session.listener());
+        s.insert(ServerSession::new(session, parser));
+        Ok(())
+    }
+
+    /// Hands the session to the `Listener` to be moved to a less loaded worker
+    /// if the balance picked it, once it has no data left to read or write
+    fn migrate(&mut self, token: Token) {
+        let Some(worker) = self.balance.as_ref().and_then(|b| b.moving(token)) else {
+            return;
+        };
+
+        let idle = !self.ingests.contains_key(&token.0)
+            && self
+                .sessions
+                .get(token.0)
+                .map(|session| session.write_pending() == 0 && session.remaining() == 0)
+                .unwrap_or(false);
+        if !idle || self.session_queue.is_none() {
+            return;
+        }
+
+        if let Some(balance) = &mut self.balance {
+            balance.remove(token);
+        }
+        let mut session = self.sessions.remove(token.0).into_inner();
+        let _ = self.poll.registry().deregister(&mut session);
+
+        let handoff = self
+            .session_queue
+            .as_mut()
+            .map(|queue| queue.try_send_any(Handoff::Move(session, worker)));
+        match handoff {
+            Some(Ok(())) => {
+                WORKER_SESSION_MOVE.increment();
+                if let Some(session_queue) = &mut self.session_queue {
+                    let _ = session_queue.wake();
+                }
+            }
+            // the session is kept here if the listener cannot take it
+            Some(Err(Handoff::Move(session, _))) | Some(Err(Handoff::Close(session))) => {
+                let _ = self.insert(session);
+            }
+            None => {}
         }
     }
 
-    /// Handle up to one request for a session
+    /// Accept new sessions from this worker's own listener
+    fn accept(&mut self) {
+        let listener = match &mut self.listener {
+            Some(listener) => listener,
+            None => return,
+        };
+
+        let mut accepted = 0;
+        for _ in 0..ACCEPT_BATCH {
+            let start = Instant::now();
+            if let Ok(mut session) = listener.accept().map(Session::from) {
+                accepted += 1;
+                let _ = LISTENER_ACCEPT_LATENCY.increment(start.elapsed().as_nanos() as _);
+
+                let s = self.sessions.vacant_entry();
+                let interest = session.interest();
+                if session
+                    .register(self.poll.registry(), Token(s.key()), interest)
+                    .is_ok()
+                {
+                    let parser = self.parser.for_listener(session.listener());
+                    s.insert(ServerSession::new(session, parser));
+                }
+                // if registration fails, the session will be closed on drop
+            } else {
+                break;
+            }
+        }
+        let _ = LISTENER_ACCEPT_BATCH.increment(accepted);
+
+        // reregister is needed here so we will call accept if there is a backlog
+        let _ = listener.reregister(self.poll.registry(), LISTENER_TOKEN, Interest::READABLE);
+    }
+
+    /// Handle up to `PIPELINE_BUDGET` requests for a session, in batches of up
+    /// to `PIPELINE_BATCH`, and flush all of their responses at once
     fn read(&mut self, token: Token) -> Result<()> {
         let session = self
             .sessions
             .get_mut(token.0)
             .ok_or_else(|| Error::new(ErrorKind::Other, "non-existant session"))?;
 
-        // fill the session
-        map_result(session.fill())?;
-
-        // process up to one pending request
-        match session.receive() {
-            Ok(request) => {
-                let response = self.storage.execute(&request);
-                PROCESS_REQ.increment();
-                if response.should_hangup() {
-                    let _ = session.send(response);
-                    return Err(Error::new(ErrorKind::Other, "should hangup"));
-                }
-                request.klog(&response);
-                match session.send(response) {
-                    Ok(_) => {
-                        // attempt to flush immediately if there's now data in
-                        // the write buffer
-                        if session.write_pending() > 0 {
-                            match session.flush() {
-                                Ok(_) => Ok(()),
-                                Err(e) => map_err(e),
-                            }?;
-                        }
+        if !handshake(session, self.poll.registry(), token)? {
+            return Ok(());
+        }
 
-                        // reregister to get writable event
-                        if session.write_pending() > 0 {
-                            let interest = session.interest();
-                            if self
-                                .poll
-                                .registry()
-                                .reregister(session, token, interest)
-                                .is_err()
-                            {
-                                return Err(Error::new(ErrorKind::Other, "failed to reregister"));
-                            }
-                        }
+        // the value of a request which is being ingested is read before
+        // anything else, filling the session once it is complete
+        let mut processed = 0;
+        if self.ingests.contains_key(&token.0) {
+            if !self.ingest(token)? {
+                return Ok(());
+            }
+            processed += 1;
+        } else {
+            // fill the session
+            map_result(session.fill())?;
+        }
 
-                        // if there's still data to read, put the token on the
-                        // pending queue
-                        if session.remaining() > 0 {
-                            self.pending.push_back(token);
-                        }
+        let session = self
+            .sessions
+            .get_mut(token.0)
+            .ok_or_else(|| Error::new(ErrorKind::Other, "non-existant session"))?;
 
-                        Ok(())
+        // receive pipelined requests and execute them in batches, composing
+        // all of their responses into the write buffer before flushing so
+        // that they share a single write
+        let mut batch_full = true;
+        let mut error = None;
+        let mut ingesting = false;
+        while batch_full && error.is_none() && processed < PIPELINE_BUDGET {
+            while self.requests.len() < PIPELINE_BATCH {
+                let start = self.cycles.start();
+                match session.receive() {
+                    Ok(request) => {
+                        usdt!(request_parse, token.0);
+                        self.cycles.parse(&request, start);
+                        self.requests.push(request);
                     }
                     Err(e) => {
-                        if e.kind() == ErrorKind::WouldBlock {
-                            Ok(())
-                        } else {
-                            Err(e)
+                        batch_full = false;
+                        if e.kind() != ErrorKind::WouldBlock {
+                            error = Some(e);
+                        } else if !self.requests.is_empty() {
+                            // a request with a large value which has not been
+                            // received is only ingested once the requests
+                            // before it have been executed
+                            batch_full = session.remaining() > 0;
+                        } else if let Some((header, id)) = session
+                            .receive_header(INGEST_MIN, |header| {
+                                self.storage.reserve(header.message(), header.value())
+                            })
+                        {
+                            let trailer = header.trailer();
+                            self.ingests.insert(
+                                token.0,
+                                Ingesting {
+                                    request: header.into_inner(),
+                                    id,
+                                    read: 0,
+                                    trailer,
+                                },
+                            );
+                            ingesting = true;
                         }
+                        break;
                     }
                 }
             }
-            Err(e) => {
-                if e.kind() == ErrorKind::WouldBlock {
-                    Ok(())
-                } else {
-                    Err(e)
+
+            execute_batch(
+                &mut self.storage,
+                &self.requests,
+                &mut self.responses,
+                &mut self.cycles,
+            );
+            PROCESS_REQ.add(self.requests.len() as _);
+            processed += self.requests.len();
+            if let Some(balance) = &mut self.balance {
+                balance.record(token, self.requests.len());
+            }
+
+            // any responses left over after an early exit are dropped along
+            // with their requests when the drains are dropped
+            for (request, response) in self.requests.drain(..).zip(self.responses.drain(..)) {
+                let write = request.latencies().write;
+                if response.should_hangup() {
+                    let _ = session.send_timed(response, write);
+                    error = Some(Error::new(ErrorKind::Other, "should hangup"));
+                    break;
+                }
+                request.klog(&response);
+                let start = self.cycles.start();
+                let sent = session.send_timed(response, write);
+                self.cycles.compose(&request, start);
+                if let Err(e) = sent {
+                    batch_full = false;
+                    if e.kind() != ErrorKind::WouldBlock {
+                        error = Some(e);
+                    }
+                    break;
                 }
             }
         }
+
+        if let Some(e) = error {
+            return Err(e);
+        }
+
+        // attempt to flush immediately if there's now data in the write buffer
+        if session.write_pending() > 0 {
+            let _ = WORKER_FLUSH_REQUESTS.increment(processed as _);
+            usdt!(session_flush, token.0, session.write_pending());
+            match session.flush() {
+                Ok(_) => Ok(()),
+                Err(e) => map_err(e),
+            }?;
+        }
+
+        // reregister to get writable event
+        if session.write_pending() > 0 {
+            let interest = session.interest();
+            if self
+                .poll
+                .registry()
+                .reregister(session, token, interest)
+                .is_err()
+            {
+                return Err(Error::new(ErrorKind::Other, "failed to reregister"));
+            }
+        }
+
+        // if the budget ran out and there's still data to read, or the value
+        // of a request is to be read into storage, put the token on the
+        // pending queue
+        if (batch_full && session.remaining() > 0) || ingesting {
+            self.pending.push_back(token);
+        }
+
+        // return the buffers to the pool if the session is now idle
+        session.release_buffers();
+
+        Ok(())
+    }
+
+    /// Reads the value of the request which is being ingested for a session
+    /// straight into the room reserved for it in storage, and then stores it
+    /// once the bytes which end the request have been read. Returns true once
+    /// the response has been sent, after which the session is read as usual.
+    fn ingest(&mut self, token: Token) -> Result<bool> {
+        let session = self
+            .sessions
+            .get_mut(token.0)
+            .ok_or_else(|| Error::new(ErrorKind::Other, "non-existant session"))?;
+        let ingesting = self
+            .ingests
+            .get_mut(&token.0)
+            .ok_or_else(|| Error::new(ErrorKind::Other, "no value to ingest"))?;
+
+        loop {
+            let value = self.storage.reserved(ingesting.id);
+            if ingesting.read >= value.len() {
+                break;
+            }
+            match session.fill_into(&mut value[ingesting.read..]) {
+                Ok(0) => return Err(Error::new(ErrorKind::Other, "client hangup")),
+                Ok(amt) => ingesting.read += amt,
+                Err(e) => return map_err(e).map(|_| false),
+            }
+        }
+
+        // fill the session with the rest, which starts with the bytes that end
+        // the request
+        let trailer = ingesting.trailer;
+        map_result(session.fill())?;
+        if session.remaining() < trailer.len() {
+            return Ok(false);
+        }
+        if !session.chunk().starts_with(trailer) {
+            return Err(Error::new(ErrorKind::InvalidInput, "malformed request"));
+        }
+        session.advance(trailer.len());
+
+        let ingesting = self
+            .ingests
+            .remove(&token.0)
+            .ok_or_else(|| Error::new(ErrorKind::Other, "no value to ingest"))?;
+        let response = self
+            .storage
+            .commit(ingesting.id, &ingesting.request)
+            .ok_or_else(|| Error::new(ErrorKind::Other, "no room reserved for value"))?;
+        WORKER_INGEST.increment();
+        PROCESS_REQ.increment();
+
+        // the request is not logged, as it does not hold its value
+        let write = ingesting.request.latencies().write;
+        let hangup = response.should_hangup();
+        if let Err(e) = session.send_timed(response, write) {
+            map_err(e)?;
+        }
+        if hangup {
+            return Err(Error::new(ErrorKind::Other, "should hangup"));
+        }
+
+        Ok(true)
     }
 
     fn write(&mut self, token: Token) -> Result<()> {
@@ -172,32 +525,49 @@ where
             .get_mut(token.0)
             .ok_or_else(|| Error::new(ErrorKind::Other, "non-existant session"))?;
 
+        if !handshake(session, self.poll.registry(), token)? {
+            return Ok(());
+        }
+
+        usdt!(session_flush, token.0, session.write_pending());
         match session.flush() {
-            Ok(_) => Ok(()),
+            Ok(_) => {
+                session.release_buffers();
+                Ok(())
+            }
             Err(e) => map_err(e),
         }
     }
 
     /// Run the worker in a loop, handling new events.
     pub fn run(&mut self) {
+        affinity::pin(self.core);
+
         let mut events = Events::with_capacity(self.nevent);
 
         loop {
             WORKER_EVENT_LOOP.increment();
 
-            self.storage.expire();
-
-            // we need another wakeup if there are still pending reads
-            if !self.pending.is_empty() {
+            // we need another wakeup if there are still pending reads or
+            // datagrams
+            let udp_pending = self.udp.as_ref().map(|udp| udp.is_pending());
+            if !self.pending.is_empty() || udp_pending == Some(true) {
                 let _ = self.waker.wake();
             }
 
-            // get events with timeout
-            if self.poll.poll(&mut events, Some(self.timeout)).is_err() {
+            // the buffer of events is replaced once a reload changes its size
+            if events.capacity() != self.nevent {
+                events = Events::with_capacity(self.nevent);
+            }
+
+            // get events with timeout, which is zero while spinning
+            let timeout = self.spin.timeout(self.timeout);
+            if self.poll.poll(&mut events, Some(timeout)).is_err() {
                 error!("Error polling");
             }
 
             let count = events.iter().count();
+            self.spin.record(count);
             WORKER_EVENT_TOTAL.add(count as _);
             if count == self.nevent {
                 WORKER_EVENT_MAX_REACHED.increment();
@@ -210,30 +580,44 @@ where
                 let token = event.token();
 
                 match token {
+                    LISTENER_TOKEN => {
+                        self.accept();
+                    }
+                    UDP_TOKEN => {
+                        if let Some(udp) = &mut self.udp {
+                            udp.serve(&self.parser, &mut self.storage, &mut self.cycles);
+                        }
+                    }
                     WAKER_TOKEN => {
                         self.waker.reset();
+
+                        // handle datagrams left over once the budget ran out
+                        if let Some(udp) = self.udp.as_mut().filter(|udp| udp.is_pending()) {
+                            udp.serve(&self.parser, &mut self.storage, &mut self.cycles);
+                        }
+
                         // handle outstanding reads
                         for _ in 0..self.pending.len() {
                             if let Some(token) = self.pending.pop_front() {
                                 if self.read(token).is_err() {
                                     self.close(token);
+                                } else {
+                                    self.migrate(token);
                                 }
                             }
                         }
 
                         // handle up to one new session
-                        if let Some(mut session) =
-                            self.session_queue.try_recv().map(|v| v.into_inner())
+                        if let Some(session) = self
+                            .session_queue
+                            .as_mut()
+                            .and_then(|queue| queue.try_recv())
+                            .map(|v| v.into_inner())
                         {
-                            let s = self.sessions.vacant_entry();
-                            let interest = session.interest();
-                            if session
-                                .register(self.poll.registry(), Token(s.key()), interest)
-                                .is_ok()
-                            {
-                                s.insert(ServerSession::new(session, self.parser.clone()));
-                            } else {
-                                let _ = self.session_queue.try_send_any(session);
+                            if let Err(session) = self.insert(session) {
+                                if let Some(session_queue) = &mut self.session_queue {
+                                    let _ = session_queue.try_send_any(Handoff::Close(session));
+                                }
                             }
 
                             // trigger a wake-up in case there are more sessions
@@ -246,6 +630,14 @@ where
                                 Signal::FlushAll => {
                                     self.storage.clear();
                                 }
+                                Signal::Invalidate(prefix) => {
+                                    self.storage.invalidate(&prefix);
+                                }
+                                Signal::Reload(tunables) => {
+                                    self.timeout = Duration::from_millis(tunables.timeout as u64);
+                                    self.nevent = tunables.nevent;
+                                    self.storage.reload(&tunables);
+                                }
                                 Signal::Shutdown => {
                                     // if we received a shutdown, we can return
                                     // and stop processing events
@@ -279,9 +671,21 @@ where
                                 continue;
                             }
                         }
+
+                        self.migrate(token);
                     }
                 }
             }
+
+            if let Some(balance) = &mut self.balance {
+                balance.update();
+            }
+
+            self.cycles.flush();
+
+            // maintenance is done once the responses for this batch of events
+            // have been written, so that it does not delay them
+            self.storage.maintain();
         }
     }
 }
@@ -2,7 +2,12 @@
 // Licensed under the Apache License, Version 2.0
 // http://www.apache.org/licenses/LICENSE-2.0
 
+use super::replication::{ReplicaQueue, Stream};
+use super::tracking::{Tracked, Tracking};
+use super::{execute_batch, CycleCounts, Parking, Spin, INFLIGHT, QUEUE_WAKE_SUPPRESSED};
 use crate::*;
+use std::sync::atomic::Ordering;
+use std::time::Instant;
 
 #[metric(
     name = "storage_event_loop",
@@ -16,12 +21,37 @@ pub static STORAGE_EVENT_LOOP: Counter = Counter::new();
 )]
 pub static STORAGE_QUEUE_DEPTH: AtomicHistogram = AtomicHistogram::new(7, 20);
 
+#[metric(
+    name = "storage_deadline_exceeded",
+    description = "the number of requests answered without being executed as they waited on the storage queue past the deadline"
+)]
+pub static STORAGE_DEADLINE_EXCEEDED: Counter = Counter::new();
+
+#[metric(
+    name = "storage_tracking_invalidate",
+    description = "the number of messages sent to sessions which track keys to invalidate keys they read"
+)]
+pub static STORAGE_TRACKING_INVALIDATE: Counter = Counter::new();
+
+#[metric(
+    name = "storage_quiet",
+    description = "the number of requests whose responses were dropped rather than sent back, as their clients do not read them"
+)]
+pub static STORAGE_QUIET: Counter = Counter::new();
+
 pub struct StorageWorkerBuilder<Request, Response, Storage> {
+    core: Option<usize>,
+    deadline: Option<Duration>,
+    hot: Option<HotShard>,
     nevent: usize,
     poll: Poll,
+    replica: Option<ReplicaQueue<Request>>,
+    replication: Option<Stream>,
+    spin: Spin,
     storage: Storage,
     timeout: Duration,
     waker: Arc<Waker>,
+    cycles: bool,
     _request: PhantomData<Request>,
     _response: PhantomData<Response>,
 }
@@ -38,35 +68,93 @@ impl<Request, Response, Storage> StorageWorkerBuilder<Request, Response, Storage
 
         let nevent = config.nevent();
         let timeout = Duration::from_millis(config.timeout() as u64);
+        let spin = Spin::new(Duration::from_micros(config.spin() as u64));
+        let deadline = match config.queue_deadline() {
+            0 => None,
+            ms => Some(Duration::from_millis(ms as u64)),
+        };
 
         Ok(Self {
+            core: config.storage_core(),
+            deadline,
+            hot: None,
             nevent,
             poll,
+            replica: None,
+            replication: None,
+            spin,
             storage,
             timeout,
             waker,
+            cycles: config.cycles(),
             _request: PhantomData,
             _response: PhantomData,
         })
     }
 
+    /// Pins the storage thread to the provided core once it runs, in place of
+    /// the storage core from the config.
+    pub fn core(mut self, core: Option<usize>) -> Self {
+        self.core = core;
+        self
+    }
+
+    /// Keeps copies of the values of hot keys for the workers to serve reads
+    /// from, where the config asks for them.
+    pub fn hot(mut self, hot: Option<HotShard>) -> Self {
+        self.hot = hot;
+        self
+    }
+
+    /// Hands the writes executed by the storage thread to the replication
+    /// thread of a primary.
+    pub fn replication(&mut self, stream: Stream) {
+        self.replication = Some(stream);
+    }
+
+    /// Executes the writes received from the primary by the replication
+    /// thread of a replica.
+    pub fn replica(&mut self, queue: ReplicaQueue<Request>) {
+        self.replica = Some(queue);
+    }
+
     pub fn waker(&self) -> Arc<Waker> {
         self.waker.clone()
     }
 
-    pub fn build(
+    pub fn build<Token>(
         self,
-        data_queue: Queues<(Request, Response, Token), (Request, Token)>,
+        data_queue: Queues<(Request, Response, Instant, Token), (Request, Instant, Token)>,
+        push_queue: Queues<(Response, Token), ()>,
         signal_queue: Queues<(), Signal>,
+        parking: Parking,
     ) -> StorageWorker<Request, Response, Storage, Token> {
+        // the writes applied by a replica are not executed as requests, so no
+        // copies are kept that they would have to drop
+        let hot = if self.replica.is_some() {
+            None
+        } else {
+            self.hot
+        };
+
         StorageWorker {
+            core: self.core,
+            deadline: self.deadline,
             data_queue,
+            hot,
             nevent: self.nevent,
+            parking,
             poll: self.poll,
+            push_queue,
+            replica: self.replica,
+            replication: self.replication,
+            spin: self.spin,
             signal_queue,
             storage: self.storage,
             timeout: self.timeout,
+            tracking: Tracking::new(),
             waker: self.waker,
+            cycles: CycleCounts::new(self.cycles),
             _request: PhantomData,
             _response: PhantomData,
         }
@@ -74,14 +162,28 @@ impl<Request, Response, Storage> StorageWorkerBuilder<Request, Response, Storage
 }
 
 pub struct StorageWorker<Request, Response, Storage, Token> {
-    data_queue: Queues<(Request, Response, Token), (Request, Token)>,
+    core: Option<usize>,
+    deadline: Option<Duration>,
+    data_queue: Queues<(Request, Response, Instant, Token), (Request, Instant, Token)>,
+    // copies of the values of hot keys which the workers serve reads from
+    hot: Option<HotShard>,
     nevent: usize,
+    parking: Parking,
     poll: Poll,
+    // messages to sessions which are not responses to their requests
+    push_queue: Queues<(Response, Token), ()>,
+    replica: Option<ReplicaQueue<Request>>,
+    replication: Option<Stream>,
+    spin: Spin,
     signal_queue: Queues<(), Signal>,
     storage: Storage,
     timeout: Duration,
+    // the sessions which track the keys they read, along with the worker
+    // each of them is on
+    tracking: Tracking<(usize, Token)>,
     #[allow(dead_code)]
     waker: Arc<Waker>,
+    cycles: CycleCounts,
     _request: PhantomData<Request>,
     _response: PhantomData<Response>,
 }
@@ -89,47 +191,198 @@ pub struct StorageWorker<Request, Response, Storage, Token> {
 impl<Request, Response, Storage, Token> StorageWorker<Request, Response, Storage, Token>
 where
     Storage: Execute<Request, Response> + EntryStore,
-    Request: Klog + Klog<Response = Response>,
+    Request: Deadline<Response>
+        + Klog
+        + Klog<Response = Response>
+        + Quiet
+        + Replicate<Response>
+        + Shard<Response>
+        + Timed
+        + Track<Response>,
     Response: Compose,
+    Token: Tracked,
 {
     /// Run the `StorageWorker` in a loop, handling new session events.
     pub fn run(&mut self) {
+        affinity::pin(self.core);
+
         let mut events = Events::with_capacity(self.nevent);
         let mut messages = Vec::with_capacity(1024);
+        let mut senders = Vec::with_capacity(1024);
+        let mut requests = Vec::with_capacity(1024);
+        let mut responses = Vec::with_capacity(1024);
+        // requests which are answered without being executed, such as those
+        // which waited past the deadline, with their responses
+        let mut answered = Vec::new();
+        // messages to sessions tracking keys, along with their workers
+        let mut pushes = Vec::new();
+        // the workers which responses were sent to in this batch
+        let mut sent = vec![false; self.parking.peers()];
 
         loop {
             STORAGE_EVENT_LOOP.increment();
 
-            self.storage.expire();
+            // the buffer of events is replaced once a reload changes its size
+            if events.capacity() != self.nevent {
+                events = Events::with_capacity(self.nevent);
+            }
 
-            // get events with timeout
-            if self.poll.poll(&mut events, Some(self.timeout)).is_err() {
+            // get events with timeout, which is zero while spinning. Before
+            // blocking, the thread is marked as parked so that the workers
+            // wake it, and requests sent just before are picked up instead
+            let mut timeout = self.spin.timeout(self.timeout);
+            if !timeout.is_zero() {
+                self.parking.park();
+                self.data_queue.try_recv_all(&mut messages);
+                if !messages.is_empty() {
+                    timeout = Duration::ZERO;
+                }
+            }
+            if self.poll.poll(&mut events, Some(timeout)).is_err() {
                 error!("Error polling");
             }
+            self.parking.unpark();
 
-            if !events.is_empty() {
-                self.waker.reset();
+            // while spinning, the queues are checked on every iteration so
+            // that requests are picked up without waiting for a wakeup
+            if !events.is_empty() || timeout.is_zero() {
+                if !events.is_empty() {
+                    self.waker.reset();
+                }
 
                 trace!("handling events");
 
                 self.data_queue.try_recv_all(&mut messages);
 
+                self.spin.record(events.iter().count() + messages.len());
+
                 let _ = STORAGE_QUEUE_DEPTH.increment(messages.len() as _);
 
+                // the whole batch is executed at once, which lets the storage
+                // prefetch for all of the requests before executing any
+                let received = Instant::now();
                 for message in messages.drain(..) {
                     let sender = message.sender();
-                    let (request, token) = message.into_inner();
+                    let (request, queued, token) = message.into_inner();
                     trace!("handling request from worker: {}", sender);
-                    let response = self.storage.execute(&request);
-                    PROCESS_REQ.increment();
-                    let mut message = (request, response, token);
+
+                    // a request which waited too long is answered without
+                    // being executed, as its client has likely given up on it
+                    if let Some(deadline) = self.deadline {
+                        if received.saturating_duration_since(queued) > deadline {
+                            if let Some(response) = request.expired() {
+                                STORAGE_DEADLINE_EXCEEDED.increment();
+                                answered.push((request, response, (sender, queued, token)));
+                                continue;
+                            }
+                        }
+                    }
+
+                    // tracking is turned on or off for a session here, where
+                    // the keys it reads are tracked, rather than by the storage
+                    if let Some((_, response)) = request.tracking() {
+                        answered.push((request, response, (sender, queued, token)));
+                        continue;
+                    }
+
+                    senders.push((sender, queued, token));
+                    requests.push(request);
+                }
+
+                let batch = requests.len();
+                execute_batch(
+                    &mut self.storage,
+                    &requests,
+                    &mut responses,
+                    &mut self.cycles,
+                );
+                PROCESS_REQ.add(batch as _);
+
+                if let Some(stream) = &mut self.replication {
+                    stream.record(&requests, &responses);
+                }
+
+                // copies of the keys written are dropped before the responses
+                // to the writes are sent
+                if let Some(hot) = &mut self.hot {
+                    hot.update(&mut self.storage, &requests, &responses);
+                }
+
+                // sessions which read a key before it was written are told of
+                // the write, after which the keys read by this batch are
+                // tracked, including for requests which both read and write
+                for (request, (sender, _, token)) in requests.iter().zip(senders.iter()) {
+                    if !self.tracking.is_empty() {
+                        let tracking = &mut self.tracking;
+                        request.writes(&mut |key| {
+                            tracking.write(key, |(worker, session)| {
+                                if let Some(push) = Request::invalidate(&[key]) {
+                                    pushes.push((worker, push, session));
+                                }
+                            })
+                        });
+                    }
+                    if let Some(session) = token.session() {
+                        let tracking = &mut self.tracking;
+                        request.reads(&mut |key| {
+                            tracking.read((*sender, session), key, |(worker, session)| {
+                                if let Some(push) = Request::invalidate(&[]) {
+                                    pushes.push((worker, push, session));
+                                }
+                            })
+                        });
+                    }
+                }
+                let pushed = self.push(&mut pushes, &mut sent);
+
+                // requests which were not executed are sent back along with
+                // the others, but are not replicated
+                let dropped = answered.len();
+                for (request, response, sender) in answered.drain(..) {
+                    requests.push(request);
+                    responses.push(response);
+                    senders.push(sender);
+                }
+
+                // the time spent on this thread is added to the time each
+                // request was queued, so that the worker can measure the total
+                // time spent on the queues in both directions once it receives
+                // the response
+                let elapsed = received.elapsed();
+
+                // the responses to quiet requests are dropped here rather than
+                // sent back, as the worker keeps no place for them. They are
+                // acknowledged together by releasing their share of the
+                // requests in flight once the batch is done, and their worker
+                // is still woken if parked, as it may have put off reads until
+                // fewer requests are in flight
+                let mut quiet = 0;
+
+                for ((request, response), (sender, queued, token)) in requests
+                    .drain(..)
+                    .zip(responses.drain(..))
+                    .zip(senders.drain(..))
+                {
+                    sent[sender] = true;
+
+                    if request.quiet() {
+                        quiet += 1;
+                        continue;
+                    }
+
+                    let mut message = (request, response, queued + elapsed, token);
                     for retry in 0..QUEUE_RETRIES {
                         if let Err(m) = self.data_queue.try_send_to(sender, message) {
                             if (retry + 1) == QUEUE_RETRIES {
                                 error!("error sending message to worker");
                             }
-                            // wake workers immediately
-                            let _ = self.data_queue.wake();
+                            // wake the worker immediately if it is parked, a
+                            // worker which is awake drains the queue anyway
+                            if self.parking.any_parked(std::iter::once(sender)) {
+                                let _ = self.data_queue.wake();
+                            } else {
+                                QUEUE_WAKE_SUPPRESSED.increment();
+                            }
                             message = m;
                         } else {
                             break;
@@ -137,7 +390,25 @@ where
                     }
                 }
 
-                let _ = self.data_queue.wake();
+                if quiet > 0 {
+                    STORAGE_QUIET.add(quiet as _);
+                    INFLIGHT.fetch_sub(quiet, Ordering::Relaxed);
+                }
+
+                if batch + dropped + pushed > 0 {
+                    let parked = self
+                        .parking
+                        .any_parked((0..sent.len()).filter(|worker| sent[*worker]));
+                    if parked {
+                        let _ = self.data_queue.wake();
+                        if pushed > 0 {
+                            let _ = self.push_queue.wake();
+                        }
+                    } else {
+                        QUEUE_WAKE_SUPPRESSED.increment();
+                    }
+                    sent.fill(false);
+                }
 
                 // check if we received any signals from the admin thread
                 while let Some(s) = self.signal_queue.try_recv().map(|v| v.into_inner()) {
@@ -145,19 +416,96 @@ where
                         Signal::FlushAll => {
                             warn!("received flush_all");
                             self.storage.clear();
+                            if let Some(hot) = &mut self.hot {
+                                hot.clear();
+                            }
+                            if let Some(stream) = &mut self.replication {
+                                stream.flush_all();
+                            }
+
+                            // every session which tracks keys is told that
+                            // all of them were removed
+                            self.tracking.clear(|(worker, session)| {
+                                if let Some(push) = Request::invalidate(&[]) {
+                                    pushes.push((worker, push, session));
+                                }
+                            });
+                            if self.push(&mut pushes, &mut sent) > 0 {
+                                let _ = self.push_queue.wake();
+                            }
+                            sent.fill(false);
+                        }
+                        Signal::Invalidate(prefix) => {
+                            self.storage.invalidate(&prefix);
+                            if let Some(hot) = &mut self.hot {
+                                hot.clear();
+                            }
+                        }
+                        Signal::Reload(tunables) => {
+                            self.timeout = Duration::from_millis(tunables.timeout as u64);
+                            self.nevent = tunables.nevent;
+                            self.storage.reload(&tunables);
                         }
                         Signal::Shutdown => {
                             // if we received a shutdown, we can return and stop
-                            // processing events
-
-                            // TODO(bmartin): graceful shutdown would occur here
-                            // when we add persistence
-
+                            // processing events. Storage which supports
+                            // persistence saves its state when it is dropped as
+                            // the thread exits.
                             return;
                         }
                     }
                 }
+
+                // apply the writes received from the primary, whose responses
+                // are not sent anywhere
+                if let Some(replica) = &self.replica {
+                    replica.apply(&mut self.storage, &mut responses, &mut self.cycles);
+                }
+            }
+
+            // chunks of the items are exported for replicas being warmed
+            // between batches, so that an export only delays the requests
+            // which arrive while one chunk is exported
+            if let Some(stream) = &mut self.replication {
+                stream.export(&mut self.storage);
+            }
+
+            self.cycles.flush();
+
+            // maintenance is done once the responses for this batch have been
+            // sent and the workers woken, so that it does not delay them.
+            // Evicting ahead of writes here means that inserts in the next
+            // batch can take a free segment instead of evicting inline.
+            self.storage.maintain();
+            if let Some(hot) = &mut self.hot {
+                hot.maintain();
+            }
+        }
+    }
+
+    /// Sends the messages to sessions which track keys to their workers,
+    /// marking the workers which were sent to. Returns the number sent.
+    fn push(&mut self, pushes: &mut Vec<(usize, Response, Token)>, sent: &mut [bool]) -> usize {
+        let pushed = pushes.len();
+        STORAGE_TRACKING_INVALIDATE.add(pushed as _);
+
+        for (worker, response, session) in pushes.drain(..) {
+            sent[worker] = true;
+
+            let mut message = (response, session);
+            for retry in 0..QUEUE_RETRIES {
+                if let Err(m) = self.push_queue.try_send_to(worker, message) {
+                    if (retry + 1) == QUEUE_RETRIES {
+                        error!("error sending message to worker");
+                    }
+                    let _ = self.push_queue.wake();
+                    message = m;
+                } else {
+                    break;
+                }
             }
         }
+
+        pushed
     }
 }
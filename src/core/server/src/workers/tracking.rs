@@ -0,0 +1,156 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The keys read by sessions which track them for client-side caching.
+//!
+//! A session which turns tracking on has the keys it reads remembered by the
+//! storage thread which executes its reads. Once one of those keys is written,
+//! the session is sent a message which invalidates the key, and is forgotten
+//! for it until it reads it again. Keys are remembered by the slot which their
+//! hash falls in rather than by the key itself, which bounds the size of the
+//! table regardless of the number of keys. A write to any key of a slot is
+//! sent to every session which read a key of the slot, so a session may be
+//! told of a key it never read, which only costs its client a lookup.
+//!
+//! A slot holds a bounded number of sessions. Once it is full, the session
+//! which has been in it the longest is told that every key has changed and
+//! is forgotten, which is rare for a session which is still open, as closed
+//! sessions are not removed from the table until they are pushed out this way
+//! or a key of their slot is written.
+
+use std::collections::hash_map::DefaultHasher;
+use std::hash::{Hash, Hasher};
+
+// the number of slots which keys hash to
+const TRACKING_SLOTS: usize = 1 << 16;
+
+// the most sessions remembered for each slot
+const TRACKING_SLOT_SESSIONS: usize = 32;
+
+/// Identifies the session which sent a request, for the sessions which track
+/// the keys they read.
+pub trait Tracked: Copy + PartialEq {
+    /// Returns the session which sent the request, the same for each of its
+    /// requests, if the session tracks the keys it reads.
+    fn session(&self) -> Option<Self>;
+}
+
+pub(crate) struct Tracking<Session> {
+    // the sessions which read a key of each slot, oldest first. The table is
+    // only allocated once a session reads a key
+    slots: Vec<Vec<Session>>,
+}
+
+impl<Session: Copy + PartialEq> Tracking<Session> {
+    pub fn new() -> Self {
+        Self { slots: Vec::new() }
+    }
+
+    /// Returns true if no session has read a key since the table was cleared.
+    pub fn is_empty(&self) -> bool {
+        self.slots.is_empty()
+    }
+
+    /// Remembers that the session read the key. Calls `evict` with a session
+    /// which is forgotten to make room, and which must be told that all of
+    /// its keys have changed.
+    pub fn read(&mut self, session: Session, key: &[u8], evict: impl FnOnce(Session)) {
+        if self.slots.is_empty() {
+            self.slots.resize_with(TRACKING_SLOTS, Vec::new);
+        }
+
+        let slot = &mut self.slots[slot(key)];
+        if slot.contains(&session) {
+            return;
+        }
+        if slot.len() >= TRACKING_SLOT_SESSIONS {
+            evict(slot.remove(0));
+        }
+        slot.push(session);
+    }
+
+    /// Calls `f` with each session which must be told that the key has been
+    /// written, and forgets them for the slot of the key.
+    pub fn write(&mut self, key: &[u8], f: impl FnMut(Session)) {
+        if self.slots.is_empty() {
+            return;
+        }
+
+        self.slots[slot(key)].drain(..).for_each(f);
+    }
+
+    /// Calls `f` once with each session which is tracking any key, such as
+    /// once all keys are removed, and forgets every session.
+    pub fn clear(&mut self, f: impl FnMut(Session)) {
+        let mut sessions = Vec::new();
+        for slot in self.slots.iter_mut() {
+            for session in slot.drain(..) {
+                if !sessions.contains(&session) {
+                    sessions.push(session);
+                }
+            }
+        }
+        self.slots = Vec::new();
+
+        sessions.into_iter().for_each(f);
+    }
+}
+
+fn slot(key: &[u8]) -> usize {
+    let mut hasher = DefaultHasher::new();
+    key.hash(&mut hasher);
+    hasher.finish() as usize & (TRACKING_SLOTS - 1)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn write() {
+        let mut tracking = Tracking::new();
+        assert!(tracking.is_empty());
+
+        tracking.read(1, b"coffee", |_| panic!("no session is evicted"));
+        tracking.read(2, b"coffee", |_| panic!("no session is evicted"));
+        tracking.read(1, b"coffee", |_| panic!("no session is evicted"));
+
+        let mut told = Vec::new();
+        tracking.write(b"coffee", |session| told.push(session));
+        assert_eq!(told, vec![1, 2]);
+
+        // the sessions are forgotten once they have been told
+        told.clear();
+        tracking.write(b"coffee", |session| told.push(session));
+        assert!(told.is_empty());
+    }
+
+    #[test]
+    fn evict() {
+        let mut tracking = Tracking::new();
+        for session in 0..TRACKING_SLOT_SESSIONS {
+            tracking.read(session, b"coffee", |_| panic!("no session is evicted"));
+        }
+
+        let mut evicted = None;
+        tracking.read(TRACKING_SLOT_SESSIONS, b"coffee", |session| {
+            evicted = Some(session)
+        });
+        assert_eq!(evicted, Some(0));
+    }
+
+    #[test]
+    fn clear() {
+        let mut tracking = Tracking::new();
+        tracking.read(1, b"coffee", |_| {});
+        tracking.read(1, b"tea", |_| {});
+        tracking.read(2, b"tea", |_| {});
+
+        let mut told = Vec::new();
+        tracking.clear(|session| told.push(session));
+        told.sort();
+        assert_eq!(told, vec![1, 2]);
+        assert!(tracking.is_empty());
+    }
+}
@@ -0,0 +1,242 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Requests served from UDP datagrams, in the frames of the memcache UDP
+//! protocol. Each datagram starts with an eight byte frame header of the
+//! request id, the sequence number of the datagram, the number of datagrams
+//! in the message and a reserved field, each a big endian u16. A request must
+//! fit in one datagram, while a response is split across as many as needed,
+//! all but the last of which are of the full datagram size.
+//!
+//! There is no session for a peer, so only requests which the protocol allows
+//! to be served from a datagram, such as gets, are executed. The datagrams
+//! received in one call are executed together as a batch, and the responses
+//! to them are sent with one call.
+
+use super::*;
+use std::net::SocketAddr;
+
+#[metric(
+    name = "udp_datagram_ex",
+    description = "the number of datagrams dropped as they did not hold a request which may be served over udp, or the response was too large"
+)]
+pub static UDP_DATAGRAM_EX: Counter = Counter::new();
+
+// the length of the frame header at the start of each datagram
+const FRAME_HEADER_LEN: usize = 8;
+
+// the size of the datagrams of a response, which keeps them within the usual
+// ethernet mtu
+const DATAGRAM_SIZE: usize = 1400;
+
+// the largest request which is received
+const RECV_SIZE: usize = 2048;
+
+// the number of datagrams received at once, and the number of batches handled
+// per event before yielding to the sessions of the worker
+const UDP_BATCH: usize = 64;
+const UDP_BUDGET: usize = 16;
+
+/// The frame header of a datagram.
+#[derive(Debug, PartialEq, Eq)]
+struct Frame {
+    id: u16,
+    seq: u16,
+    total: u16,
+}
+
+impl Frame {
+    fn parse(datagram: &[u8]) -> Option<Self> {
+        let header = datagram.get(..FRAME_HEADER_LEN)?;
+        let field = |i: usize| u16::from_be_bytes([header[i], header[i + 1]]);
+        Some(Self {
+            id: field(0),
+            seq: field(2),
+            total: field(4),
+        })
+    }
+
+    fn write(&self, dst: &mut Vec<u8>) {
+        dst.extend_from_slice(&self.id.to_be_bytes());
+        dst.extend_from_slice(&self.seq.to_be_bytes());
+        dst.extend_from_slice(&self.total.to_be_bytes());
+        dst.extend_from_slice(&[0, 0]);
+    }
+}
+
+/// Writes the response to the request with the id in frames, one for each
+/// datagram. Returns false, without writing anything, if the response needs
+/// more datagrams than a frame can number.
+fn write_frames(id: u16, response: &[u8], dst: &mut Vec<u8>) -> bool {
+    let payload = DATAGRAM_SIZE - FRAME_HEADER_LEN;
+    let total = response.len().div_ceil(payload).max(1);
+    if total > u16::MAX as usize {
+        return false;
+    }
+
+    for seq in 0..total {
+        let start = (seq * payload).min(response.len());
+        let end = (start + payload).min(response.len());
+        Frame {
+            id,
+            seq: seq as u16,
+            total: total as u16,
+        }
+        .write(dst);
+        dst.extend_from_slice(&response[start..end]);
+    }
+
+    true
+}
+
+/// The UDP socket of a worker, along with the buffers which are reused for
+/// each batch of datagrams.
+pub struct Udp<Request, Response> {
+    socket: UdpSocket,
+    recv: RecvBatch,
+    send: SendBatch,
+    requests: Vec<Request>,
+    responses: Vec<Response>,
+    // the peer and the request id for each request of the batch
+    peers: Vec<(SocketAddr, u16)>,
+    composed: Vec<u8>,
+    // set when the budget ran out before the socket was drained
+    pending: bool,
+}
+
+impl<Request, Response> Udp<Request, Response> {
+    /// Binds the socket with `SO_REUSEPORT`, so that each worker may bind its
+    /// own, and registers it with the poll of the worker.
+    pub fn bind(addr: SocketAddr, registry: &Registry) -> Result<Self> {
+        let mut socket = UdpSocket::bind_reuseport(addr)?;
+        socket.register(registry, UDP_TOKEN, Interest::READABLE)?;
+
+        Ok(Self {
+            socket,
+            recv: RecvBatch::new(UDP_BATCH, RECV_SIZE),
+            send: SendBatch::new(),
+            requests: Vec::with_capacity(UDP_BATCH),
+            responses: Vec::with_capacity(UDP_BATCH),
+            peers: Vec::with_capacity(UDP_BATCH),
+            composed: Vec::new(),
+            pending: false,
+        })
+    }
+
+    /// Returns true if there may be datagrams left to receive.
+    pub fn is_pending(&self) -> bool {
+        self.pending
+    }
+
+    /// Receives, executes and responds to batches of datagrams until there
+    /// are none left or the budget runs out.
+    pub fn serve<Parser, Storage>(
+        &mut self,
+        parser: &Parser,
+        storage: &mut Storage,
+        cycles: &mut CycleCounts,
+    ) where
+        Parser: Parse<Request>,
+        Request: Datagram + Klog + Klog<Response = Response> + Timed,
+        Response: Compose,
+        Storage: Execute<Request, Response>,
+    {
+        self.pending = false;
+
+        for _ in 0..UDP_BUDGET {
+            match self.socket.recv_batch(&mut self.recv) {
+                Ok(_) => {}
+                Err(e) => {
+                    if e.kind() != ErrorKind::WouldBlock {
+                        error!("error receiving datagrams: {}", e);
+                    }
+                    return;
+                }
+            }
+
+            for (datagram, peer) in self.recv.iter() {
+                let start = cycles.start();
+                let request = Frame::parse(datagram)
+                    .filter(|frame| frame.seq == 0 && frame.total == 1)
+                    .and_then(|frame| {
+                        parser
+                            .parse(&datagram[FRAME_HEADER_LEN..])
+                            .ok()
+                            .map(|request| (frame, request.into_inner()))
+                    })
+                    .filter(|(_, request)| request.is_datagram());
+
+                match request {
+                    Some((frame, request)) => {
+                        cycles.parse(&request, start);
+                        self.requests.push(request);
+                        self.peers.push((peer, frame.id));
+                    }
+                    None => UDP_DATAGRAM_EX.increment(),
+                }
+            }
+
+            execute_batch(storage, &self.requests, &mut self.responses, cycles);
+            PROCESS_REQ.add(self.requests.len() as _);
+
+            for ((request, response), (peer, id)) in self
+                .requests
+                .drain(..)
+                .zip(self.responses.drain(..))
+                .zip(self.peers.drain(..))
+            {
+                request.klog(&response);
+
+                let start = cycles.start();
+                self.composed.clear();
+                response.compose(&mut self.composed);
+                if write_frames(id, &self.composed, self.send.buffer()) {
+                    self.send.push(peer, DATAGRAM_SIZE);
+                } else {
+                    UDP_DATAGRAM_EX.increment();
+                }
+                cycles.compose(&request, start);
+            }
+
+            if let Err(e) = self.socket.send_batch(&mut self.send) {
+                error!("error sending datagrams: {}", e);
+            }
+        }
+
+        self.pending = true;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn frames() {
+        let mut dst = Vec::new();
+        assert!(write_frames(7, b"END\r\n", &mut dst));
+        assert_eq!(&dst[..FRAME_HEADER_LEN], &[0, 7, 0, 0, 0, 1, 0, 0]);
+        assert_eq!(&dst[FRAME_HEADER_LEN..], b"END\r\n");
+        assert_eq!(
+            Frame::parse(&dst),
+            Some(Frame {
+                id: 7,
+                seq: 0,
+                total: 1
+            })
+        );
+
+        // a response is split into datagrams of the full size but the last
+        let payload = DATAGRAM_SIZE - FRAME_HEADER_LEN;
+        let response = vec![b'a'; payload * 2 + 10];
+        dst.clear();
+        assert!(write_frames(1, &response, &mut dst));
+        assert_eq!(dst.len(), DATAGRAM_SIZE * 2 + FRAME_HEADER_LEN + 10);
+        let last = Frame::parse(&dst[DATAGRAM_SIZE * 2..]).unwrap();
+        assert_eq!(last.seq, 2);
+        assert_eq!(last.total, 3);
+
+        assert!(Frame::parse(&[0; 4]).is_none());
+    }
+}
@@ -0,0 +1,489 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Sampling of the keys of requests, to find the hottest keys by the number of
+//! requests and by the bytes of value served, as the legacy `hotkey` module
+//! does. Each storage handle, which is only used by one worker thread at a
+//! time, samples into its own sketches, so sampling takes an uncontended lock
+//! and copies no key unless it becomes one of the hottest. The hottest keys of
+//! all handles are merged when they are reported.
+//!
+//! Keys are counted in a count-min sketch with conservative update: each key
+//! is hashed to one counter in each row, and its count is estimated as the
+//! smallest of them, which is never less than it was sampled. Next to the
+//! sketch, the keys with the highest estimates are kept as in the
+//! Space-Saving algorithm. Counts decay by half every `hotkey_sample_size`
+//! samples, so keys that are no longer requested age out.
+//!
+//! The sizes of the keys and values sampled are recorded in histograms, which
+//! are exported along with the other metrics.
+
+use config::seg::Seg as SegOptions;
+use metriken::{metric, AtomicHistogram, Counter};
+
+use std::fmt::Write;
+use std::hash::{BuildHasher, Hasher};
+use std::sync::{Arc, Mutex, Weak};
+
+#[metric(
+    name = "hotkey_sample",
+    description = "number of requests sampled for hot keys"
+)]
+pub static HOTKEY_SAMPLE: Counter = Counter::new();
+
+#[metric(
+    name = "hotkey_key_size",
+    description = "distribution of the size of the keys sampled in bytes"
+)]
+pub static HOTKEY_KEY_SIZE: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hotkey_value_size",
+    description = "distribution of the size of the values read or written by the requests sampled in bytes"
+)]
+pub static HOTKEY_VALUE_SIZE: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+/// The samplers of every storage handle in the process.
+pub static HOTKEYS: Hotkeys = Hotkeys::new();
+
+/// Keys are truncated to the longest memcache key when they are kept.
+const MAX_KEY_LEN: usize = 250;
+
+const SKETCH_DEPTH: usize = 4;
+/// Wide enough that a key which takes up 1% of the samples is overestimated
+/// by well under that.
+const SKETCH_WIDTH: usize = 2048;
+
+// all sketches hash keys the same way, so that a key has the same fingerprint
+// in each of them and its counts can be added up when they are reported
+const SEEDS: [u64; 4] = [
+    0xbb8c484891ec6c86,
+    0x0522a25ae9c769f9,
+    0xeed2797b9571bc75,
+    0x4feb29c1fbbd59d0,
+];
+
+fn fingerprint(key: &[u8]) -> u64 {
+    let mut hasher =
+        ahash::RandomState::with_seeds(SEEDS[0], SEEDS[1], SEEDS[2], SEEDS[3]).build_hasher();
+    hasher.write(key);
+    hasher.finish()
+}
+
+/// The hottest keys of one sketch.
+struct Top {
+    fp: u64,
+    count: u64,
+    key: Box<[u8]>,
+}
+
+/// Counts keys in a fixed amount of memory and keeps those counted the most.
+struct Sketch {
+    counters: Box<[u64]>,
+    top: Vec<Top>,
+    ntop: usize,
+    /// the index of the kept key with the lowest count
+    min: usize,
+}
+
+impl Sketch {
+    fn new(ntop: usize) -> Self {
+        Self {
+            counters: vec![0; SKETCH_DEPTH * SKETCH_WIDTH].into_boxed_slice(),
+            top: Vec::with_capacity(ntop),
+            ntop,
+            min: 0,
+        }
+    }
+
+    /// Counts `weight` more for the key, and keeps it if it is now one of the
+    /// hottest.
+    fn incr(&mut self, key: &[u8], fp: u64, weight: u64) {
+        // the counter in each row is derived from two halves of the hash
+        let h1 = fp as u32 as usize;
+        let h2 = ((fp >> 32) as u32 | 1) as usize;
+        let mut index = [0; SKETCH_DEPTH];
+        let mut estimate = u64::MAX;
+        for (row, index) in index.iter_mut().enumerate() {
+            *index = row * SKETCH_WIDTH + (h1.wrapping_add(row * h2) & (SKETCH_WIDTH - 1));
+            estimate = estimate.min(self.counters[*index]);
+        }
+
+        // conservative update: only raise the counters that were the lowest
+        let estimate = estimate.saturating_add(weight);
+        for index in index {
+            if self.counters[index] < estimate {
+                self.counters[index] = estimate;
+            }
+        }
+
+        self.update_top(key, fp, estimate);
+    }
+
+    fn update_top(&mut self, key: &[u8], fp: u64, count: u64) {
+        // a kept key was last counted at least at the lowest count, and its
+        // estimate has grown since, so most keys sampled are skipped early
+        if self.top.len() == self.ntop && count <= self.top[self.min].count {
+            return;
+        }
+
+        if let Some(i) = self.top.iter().position(|top| top.fp == fp) {
+            self.top[i].count = count;
+            if i == self.min {
+                self.find_min();
+            }
+            return;
+        }
+
+        let top = Top {
+            fp,
+            count,
+            key: key[..key.len().min(MAX_KEY_LEN)].into(),
+        };
+        if self.top.len() < self.ntop {
+            self.top.push(top);
+        } else {
+            self.top[self.min] = top;
+        }
+        self.find_min();
+    }
+
+    fn find_min(&mut self) {
+        self.min = 0;
+        for (i, top) in self.top.iter().enumerate() {
+            if top.count < self.top[self.min].count {
+                self.min = i;
+            }
+        }
+    }
+
+    fn decay(&mut self) {
+        for counter in self.counters.iter_mut() {
+            *counter >>= 1;
+        }
+        for top in self.top.iter_mut() {
+            top.count >>= 1;
+        }
+    }
+}
+
+/// The sketches of one storage handle.
+struct Sketches {
+    window: usize,
+    /// samples since the last decay
+    nsample: usize,
+    requests: Sketch,
+    bytes: Sketch,
+}
+
+impl Sketches {
+    fn sample(&mut self, key: &[u8], served: usize) {
+        let fp = fingerprint(key);
+        self.requests.incr(key, fp, 1);
+        if served > 0 {
+            self.bytes.incr(key, fp, served as u64);
+        }
+
+        self.nsample += 1;
+        if self.nsample == self.window {
+            self.requests.decay();
+            self.bytes.decay();
+            self.nsample = 0;
+        }
+    }
+}
+
+/// The options of hot key sampling, as taken from the seg config.
+#[derive(Copy, Clone, Debug)]
+struct Options {
+    window: usize,
+    rate: usize,
+    ntop: usize,
+}
+
+/// Samples the keys of the requests executed through one storage handle. A
+/// handle which is cloned for another thread gets a sampler of its own.
+pub(crate) struct HotkeySampler {
+    options: Option<Options>,
+    /// requests left until the next one is sampled
+    countdown: usize,
+    sketches: Option<Arc<Mutex<Sketches>>>,
+}
+
+impl HotkeySampler {
+    pub(crate) fn new(config: &SegOptions) -> Self {
+        let options = if !config.hotkey_enable() {
+            None
+        } else if config.hotkey_sample_size() == 0
+            || config.hotkey_sample_rate() == 0
+            || config.hotkey_ntop() == 0
+        {
+            error!("hotkey sample size, rate and # keys reported cannot be 0");
+            None
+        } else {
+            Some(Options {
+                window: config.hotkey_sample_size(),
+                rate: config.hotkey_sample_rate(),
+                ntop: config.hotkey_ntop(),
+            })
+        };
+
+        Self::with_options(options)
+    }
+
+    fn with_options(options: Option<Options>) -> Self {
+        let sketches = options.map(|options| {
+            let sketches = Arc::new(Mutex::new(Sketches {
+                window: options.window,
+                nsample: 0,
+                requests: Sketch::new(options.ntop),
+                bytes: Sketch::new(options.ntop),
+            }));
+            HOTKEYS.register(options, &sketches);
+            sketches
+        });
+
+        Self {
+            options,
+            countdown: options.map(|options| options.rate).unwrap_or(0),
+            sketches,
+        }
+    }
+
+    /// Whether the next request is to be sampled.
+    #[inline]
+    pub(crate) fn sample(&mut self) -> bool {
+        match self.options {
+            None => false,
+            Some(options) => {
+                self.countdown -= 1;
+                if self.countdown == 0 {
+                    self.countdown = options.rate;
+                    HOTKEY_SAMPLE.increment();
+                    true
+                } else {
+                    false
+                }
+            }
+        }
+    }
+
+    /// Samples a key of a request, along with the bytes of value it served
+    /// and, for writes, the bytes of value written.
+    pub(crate) fn record(&self, key: &[u8], served: usize, written: Option<usize>) {
+        let sketches = match &self.sketches {
+            Some(sketches) => sketches,
+            None => return,
+        };
+
+        let _ = HOTKEY_KEY_SIZE.increment(key.len() as u64);
+        let size = written.unwrap_or(served);
+        if size > 0 {
+            let _ = HOTKEY_VALUE_SIZE.increment(size as u64);
+        }
+
+        if let Ok(mut sketches) = sketches.lock() {
+            sketches.sample(key, served);
+        }
+    }
+
+    /// Whether the key is one of the hottest by the number of requests
+    /// sampled through this handle.
+    pub(crate) fn is_hot(&self, key: &[u8]) -> bool {
+        let sketches = match &self.sketches {
+            Some(sketches) => sketches,
+            None => return false,
+        };
+
+        let fp = fingerprint(key);
+        let key = &key[..key.len().min(MAX_KEY_LEN)];
+        match sketches.lock() {
+            Ok(sketches) => sketches
+                .requests
+                .top
+                .iter()
+                .any(|top| top.fp == fp && &*top.key == key),
+            Err(_) => false,
+        }
+    }
+}
+
+impl Clone for HotkeySampler {
+    fn clone(&self) -> Self {
+        Self::with_options(self.options)
+    }
+}
+
+pub struct Hotkeys {
+    options: Mutex<Option<Options>>,
+    sketches: Mutex<Vec<Weak<Mutex<Sketches>>>>,
+}
+
+impl Hotkeys {
+    const fn new() -> Self {
+        Self {
+            options: Mutex::new(None),
+            sketches: Mutex::new(Vec::new()),
+        }
+    }
+
+    fn register(&self, options: Options, sketches: &Arc<Mutex<Sketches>>) {
+        *self.options.lock().unwrap() = Some(options);
+
+        let mut all = self.sketches.lock().unwrap();
+        all.retain(|sketches| sketches.strong_count() > 0);
+        all.push(Arc::downgrade(sketches));
+    }
+
+    /// Reports the hottest keys by requests and by bytes served, merged over
+    /// all storage handles, in the format of memcache stats. Counts are of
+    /// the requests sampled, and decay by half every `sample_size` samples.
+    /// Bytes in keys which would break up the report are shown as `.`.
+    pub fn report(&self) -> String {
+        let options = *self.options.lock().unwrap();
+
+        let mut report = String::new();
+        let _ = write!(
+            report,
+            "STAT hotkey_enabled {}\r\n",
+            options.is_some() as u8
+        );
+        if let Some(options) = options {
+            let _ = write!(report, "STAT hotkey_sample_rate {}\r\n", options.rate);
+            let _ = write!(report, "STAT hotkey_sample_size {}\r\n", options.window);
+            let _ = write!(report, "STAT hotkey_samples {}\r\n", HOTKEY_SAMPLE.value());
+
+            let (requests, bytes) = self.merge(options.ntop);
+            for (key, count) in requests {
+                let _ = write!(report, "STAT hotkey_requests {} {}\r\n", key, count);
+            }
+            for (key, count) in bytes {
+                let _ = write!(report, "STAT hotkey_bytes {} {}\r\n", key, count);
+            }
+        }
+        report.push_str("END\r\n");
+        report
+    }
+
+    /// The hottest keys of all sketches, by requests and by bytes, with the
+    /// counts of a key kept by more than one handle added up.
+    #[allow(clippy::type_complexity)]
+    fn merge(&self, ntop: usize) -> (Vec<(String, u64)>, Vec<(String, u64)>) {
+        let mut requests = Vec::new();
+        let mut bytes = Vec::new();
+
+        let all = self.sketches.lock().unwrap();
+        for sketches in all.iter().filter_map(|sketches| sketches.upgrade()) {
+            if let Ok(sketches) = sketches.lock() {
+                for top in &sketches.requests.top {
+                    requests.push((top.fp, top.count, printable(&top.key)));
+                }
+                for top in &sketches.bytes.top {
+                    bytes.push((top.fp, top.count, printable(&top.key)));
+                }
+            }
+        }
+
+        (hottest(requests, ntop), hottest(bytes, ntop))
+    }
+}
+
+fn hottest(mut keys: Vec<(u64, u64, String)>, ntop: usize) -> Vec<(String, u64)> {
+    keys.sort_by_key(|(fp, _, _)| *fp);
+    let mut merged: Vec<(u64, u64, String)> = Vec::with_capacity(keys.len());
+    for (fp, count, key) in keys {
+        match merged.last_mut() {
+            Some(last) if last.0 == fp => last.1 += count,
+            _ => merged.push((fp, count, key)),
+        }
+    }
+
+    merged.sort_by(|a, b| b.1.cmp(&a.1));
+    merged
+        .into_iter()
+        .take(ntop)
+        .map(|(_, count, key)| (key, count))
+        .collect()
+}
+
+fn printable(key: &[u8]) -> String {
+    key.iter()
+        .map(|b| {
+            if b.is_ascii_graphic() {
+                *b as char
+            } else {
+                '.'
+            }
+        })
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn sketch() {
+        let mut sketch = Sketch::new(2);
+        for i in 0..1000u32 {
+            let key = format!("cold{i}");
+            sketch.incr(key.as_bytes(), fingerprint(key.as_bytes()), 1);
+            sketch.incr(b"hot", fingerprint(b"hot"), 1);
+            if i % 2 == 0 {
+                sketch.incr(b"warm", fingerprint(b"warm"), 1);
+            }
+        }
+
+        let mut top: Vec<(&[u8], u64)> = sketch
+            .top
+            .iter()
+            .map(|top| (&top.key[..], top.count))
+            .collect();
+        top.sort_by(|a, b| b.1.cmp(&a.1));
+        assert_eq!(top[0].0, b"hot");
+        assert!(top[0].1 >= 1000);
+        assert_eq!(top[1].0, b"warm");
+        assert!(top[1].1 >= 500);
+
+        sketch.decay();
+        assert!(sketch.top.iter().all(|top| top.count < 1000));
+    }
+
+    #[test]
+    fn hot() {
+        let sampler = HotkeySampler::with_options(Some(Options {
+            window: 1000,
+            rate: 1,
+            ntop: 1,
+        }));
+        assert!(!sampler.is_hot(b"hot"));
+
+        for i in 0..100u32 {
+            sampler.record(b"hot", 0, None);
+            sampler.record(format!("cold{i}").as_bytes(), 0, None);
+        }
+        assert!(sampler.is_hot(b"hot"));
+        assert!(!sampler.is_hot(b"cold0"));
+        assert!(!HotkeySampler::with_options(None).is_hot(b"hot"));
+    }
+
+    #[test]
+    fn merge() {
+        let keys = vec![
+            (1, 10, "a".to_string()),
+            (2, 15, "b".to_string()),
+            (1, 10, "a".to_string()),
+            (3, 1, "c".to_string()),
+        ];
+        assert_eq!(
+            hottest(keys, 2),
+            vec![("a".to_string(), 20), ("b".to_string(), 15)]
+        );
+    }
+
+    #[test]
+    fn printable_keys() {
+        assert_eq!(printable(b"key 1\r\n"), "key.1..");
+    }
+}
@@ -7,12 +7,23 @@
 //! addition to the base `EntryStore` trait. For example [`Seg`] implements both
 //! [`EntryStore`] and [`protocol::memcache::MemcacheStorage`].
 
+#[macro_use]
+extern crate log;
+
+mod hotkeys;
 mod noop;
+mod prefixes;
 mod segcache;
 
+pub use self::hotkeys::{Hotkeys, HOTKEYS};
 pub use self::noop::*;
+pub use self::prefixes::{Prefixes, PREFIXES};
 pub use self::segcache::*;
 
+pub use ::segcache::Export;
+
+use common::signal::Tunables;
+
 /// A trait defining the basic requirements of a type which may be used for
 /// storage.
 pub trait EntryStore {
@@ -22,6 +33,52 @@ pub trait EntryStore {
     /// expiration should implement their own handling logic for this function.
     fn expire(&mut self) {}
 
+    /// Periodic maintenance which is performed between batches of requests,
+    /// after their responses have been sent. This includes eager expiration
+    /// and, for storage types which support it, evicting ahead of writes so
+    /// that requests do not need to. The default implementation only expires.
+    fn maintain(&mut self) {
+        self.expire();
+    }
+
     /// Remove all existing values from the entry store.
     fn clear(&mut self);
+
+    /// Invalidates every value whose key starts with the prefix. The default
+    /// implementation is a no-op, as is that of storage which was not
+    /// configured to support it.
+    fn invalidate(&mut self, _prefix: &[u8]) {}
+
+    /// Returns true if the key is one of the hottest keys sampled from the
+    /// requests executed against the storage, so that copies of its value
+    /// may be served without routing reads to the storage. The default
+    /// implementation, as that of storage which does not sample hot keys,
+    /// finds no key hot.
+    fn is_hot(&mut self, _key: &[u8]) -> bool {
+        false
+    }
+
+    /// Applies the tunables reloaded from the config, such as the eviction
+    /// policy, while the storage holds items. The default implementation
+    /// ignores them.
+    fn reload(&mut self, _tunables: &Tunables) {}
+
+    /// Appends the next chunk of the items selected by the export to `dst`,
+    /// in the format read by `import`, and advances the export. Returns true
+    /// once every item has been exported. This is used to warm a new peer. The
+    /// default implementation exports nothing.
+    fn export(&mut self, _export: &mut Export, _dst: &mut Vec<u8>) -> bool {
+        true
+    }
+
+    /// Stores the items exported by a peer whose keys are accepted by the
+    /// filter, returning the number of items stored. The default
+    /// implementation stores nothing.
+    fn import(
+        &mut self,
+        _data: &[u8],
+        _filter: &dyn Fn(&[u8]) -> bool,
+    ) -> Result<usize, std::io::Error> {
+        Ok(0)
+    }
 }
@@ -0,0 +1,31 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Allows for `Noop` storage to be used for the `HTTP` key-value protocol.
+//! Every read is a miss and every write is stored.
+
+use super::*;
+
+use protocol_common::*;
+use protocol_http::*;
+
+impl Execute<ParseData, Response> for Noop {
+    fn execute(&mut self, request: &ParseData) -> Response {
+        let request = match &request.0 {
+            Ok(request) => request,
+            Err(e) => return e.to_response(),
+        };
+
+        let mut response = match request.data() {
+            RequestData::Get(_) | RequestData::Delete(_) => Response::builder(404).empty(),
+            RequestData::Put(_, _) => Response::builder(204).empty(),
+        };
+
+        if !request.keep_alive() {
+            response.should_close(true);
+        }
+
+        response
+    }
+}
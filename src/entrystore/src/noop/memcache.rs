@@ -0,0 +1,67 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Allows for `Noop` storage to be used for the `Memcache` protocol. Every
+//! read is a miss and every write is stored, so that a server measures the
+//! overhead of everything but storage.
+
+use super::*;
+
+use protocol_common::*;
+use protocol_memcache::*;
+
+impl Execute<Request, Response> for Noop {
+    fn execute(&mut self, request: &Request) -> Response {
+        match request {
+            Request::Get(_) | Request::Gets(_) | Request::Gat(_) | Request::Gats(_) => {
+                Values::new(Box::new([])).into()
+            }
+            Request::Set(set) => Response::stored(set.noreply()),
+            Request::Add(add) => Response::stored(add.noreply()),
+            Request::Replace(replace) => Response::stored(replace.noreply()),
+            Request::Cas(cas) => Response::stored(cas.noreply()),
+            Request::Append(append) => Response::stored(append.noreply()),
+            Request::Prepend(prepend) => Response::stored(prepend.noreply()),
+            Request::Incr(incr) => Response::not_found(incr.noreply()),
+            Request::Decr(decr) => Response::not_found(decr.noreply()),
+            Request::Delete(delete) => Response::not_found(delete.noreply()),
+            Request::Touch(touch) => Response::not_found(touch.noreply()),
+            Request::MetaGet(get) => Meta::new(MetaCode::En, get.flags(), get.key()).into(),
+            Request::MetaSet(set) => Meta::new(MetaCode::Hd, set.flags(), set.key()).into(),
+            Request::MetaDelete(delete) => {
+                Meta::new(MetaCode::Nf, delete.flags(), delete.key()).into()
+            }
+            Request::MetaArithmetic(arithmetic) => {
+                Meta::new(MetaCode::Nf, arithmetic.flags(), arithmetic.key()).into()
+            }
+            Request::MetaNoop(_) => Meta::noop().into(),
+            Request::Binary(binary) => Response::binary(binary, self.execute(binary.request())),
+            Request::FlushAll(_) => Response::error(),
+            Request::Quit(_) => Response::hangup(),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn canned() {
+        let parser = RequestParser::new();
+        let mut noop = Noop::new();
+
+        let mut execute = |request: &[u8]| {
+            let request = parser.parse(request).unwrap().into_inner();
+            let mut buf = Vec::new();
+            noop.execute(&request).compose(&mut buf);
+            buf
+        };
+
+        assert_eq!(execute(b"get coffee\r\n"), b"END\r\n");
+        assert_eq!(execute(b"set coffee 0 0 6\r\nstrong\r\n"), b"STORED\r\n");
+        assert_eq!(execute(b"delete coffee\r\n"), b"NOT_FOUND\r\n");
+        assert_eq!(execute(b"mg coffee v\r\n"), b"EN\r\n");
+    }
+}
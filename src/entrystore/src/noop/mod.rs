@@ -2,11 +2,17 @@
 // Licensed under the Apache License, Version 2.0
 // http://www.apache.org/licenses/LICENSE-2.0
 
-//! No-op storage which can be used for servers which do not have state.
+//! No-op storage which can be used for servers which do not have state. For
+//! the storage protocols, it answers each request with a canned response
+//! without storing anything, which measures the overhead of a server apart
+//! from its storage.
 
 use crate::EntryStore;
 
+mod http;
+mod memcache;
 mod ping;
+mod resp;
 
 #[derive(Default)]
 /// A no-op storage backend which implements `EntryStore` and storage protocol
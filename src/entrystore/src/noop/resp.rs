@@ -0,0 +1,49 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Allows for `Noop` storage to be used for the `RESP` protocol. Every read is
+//! a miss and every write is stored, so that a server measures the overhead of
+//! everything but storage. Commands beyond those on strings are not supported.
+
+use super::*;
+
+use protocol_common::*;
+use protocol_resp::*;
+
+impl Execute<Request, Response> for Noop {
+    fn execute(&mut self, request: &Request) -> Response {
+        match request {
+            Request::Get(_) | Request::GetEx(_) => Response::null(),
+            Request::MultiGet(get) => {
+                Response::array(get.keys().iter().map(|_| Response::null()).collect())
+            }
+            Request::Set(_) | Request::MultiSet(_) => Response::simple_string("OK"),
+            Request::Del(_) | Request::Exists(_) => Response::integer(0),
+            _ => Response::error("not supported"),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn canned() {
+        let parser = RequestParser::new();
+        let mut noop = Noop::new();
+
+        let mut execute = |request: &[u8]| {
+            let request = parser.parse(request).unwrap().into_inner();
+            let mut buf = Vec::new();
+            noop.execute(&request).compose(&mut buf);
+            buf
+        };
+
+        assert_eq!(execute(b"get coffee\r\n"), b"$-1\r\n");
+        assert_eq!(execute(b"set coffee strong\r\n"), b"+OK\r\n");
+        assert_eq!(execute(b"mget coffee tea\r\n"), b"*2\r\n$-1\r\n$-1\r\n");
+        assert_eq!(execute(b"del coffee\r\n"), b":0\r\n");
+    }
+}
@@ -0,0 +1,433 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Counters of the hits, misses, sets and live bytes of the keys with each of
+//! a few configured prefixes, so that the tenants or key families sharing a
+//! cache can be told apart without sampling.
+//!
+//! The prefixes are held in a fixed-size table, along with a bitmap of their
+//! first bytes, so that the keys of most requests which match no prefix are
+//! turned away by a single load, and the others are compared against the few
+//! prefixes, longest first. Each storage handle, which is only used by one
+//! worker thread at a time, counts into counters of its own, and the counters
+//! of all handles are added up when they are reported.
+//!
+//! Live bytes are not seen by requests, as items are also removed by eviction
+//! and expiry. Instead, the items of the storage are summed up by prefix in
+//! the background, a bounded number of hashtable buckets at a time, and the
+//! sums of the last complete pass are reported. Handles which share their
+//! storage also share the pass, which one of them advances at a time.
+
+use config::seg::Seg as SegOptions;
+use metriken::{metric, Counter};
+
+use std::fmt::Write;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, Weak};
+
+#[metric(
+    name = "prefix_sweep",
+    description = "number of complete passes summing up the live bytes of each key prefix"
+)]
+pub static PREFIX_SWEEP: Counter = Counter::new();
+
+/// The prefix counters of every storage handle in the process.
+pub static PREFIXES: Prefixes = Prefixes::new();
+
+/// The most prefixes which may be configured.
+pub const MAX_PREFIXES: usize = 64;
+
+/// The number of hashtable buckets summed up by each step of a pass.
+const SWEEP_BUCKETS: usize = 256;
+
+/// The configured prefixes, longest first.
+struct Table {
+    prefixes: Box<[Box<[u8]>]>,
+    /// the first bytes of the prefixes
+    first: [u64; 4],
+}
+
+impl Table {
+    fn new(prefixes: &[String]) -> Option<Self> {
+        if prefixes.is_empty() {
+            return None;
+        }
+        if prefixes.len() > MAX_PREFIXES || prefixes.iter().any(|p| p.is_empty()) {
+            error!(
+                "up to {} key prefixes may be counted, and they cannot be empty",
+                MAX_PREFIXES
+            );
+            return None;
+        }
+
+        let mut sorted: Vec<Box<[u8]>> = prefixes
+            .iter()
+            .map(|p| p.as_bytes().to_vec().into_boxed_slice())
+            .collect();
+        sorted.sort_by(|a, b| b.len().cmp(&a.len()).then(a.cmp(b)));
+        sorted.dedup();
+
+        let mut first = [0; 4];
+        for prefix in &sorted {
+            first[prefix[0] as usize >> 6] |= 1 << (prefix[0] & 63);
+        }
+
+        Some(Self {
+            prefixes: sorted.into_boxed_slice(),
+            first,
+        })
+    }
+
+    /// Returns the index of the longest prefix of the key.
+    #[inline]
+    fn find(&self, key: &[u8]) -> Option<usize> {
+        let b = *key.first()?;
+        if self.first[b as usize >> 6] & (1 << (b & 63)) == 0 {
+            return None;
+        }
+        self.prefixes
+            .iter()
+            .position(|prefix| key.starts_with(prefix))
+    }
+}
+
+/// The counters of one prefix in one storage handle.
+#[derive(Default)]
+struct Counts {
+    gets: AtomicU64,
+    hits: AtomicU64,
+    sets: AtomicU64,
+}
+
+impl Counts {
+    #[inline]
+    fn incr(counter: &AtomicU64) {
+        // each handle is used by one thread at a time, so the counters are
+        // never contended
+        counter.store(counter.load(Ordering::Relaxed) + 1, Ordering::Relaxed);
+    }
+}
+
+/// A pass summing up the live items of a storage, by prefix.
+struct Sweep {
+    cursor: u64,
+    /// bytes and items of the pass under way
+    bytes: Vec<u64>,
+    items: Vec<u64>,
+    /// bytes and items of the last complete pass
+    live_bytes: Vec<u64>,
+    live_items: Vec<u64>,
+}
+
+impl Sweep {
+    fn new(len: usize) -> Self {
+        Self {
+            cursor: 0,
+            bytes: vec![0; len],
+            items: vec![0; len],
+            live_bytes: vec![0; len],
+            live_items: vec![0; len],
+        }
+    }
+}
+
+struct Inner {
+    table: Arc<Table>,
+    counts: Arc<[Counts]>,
+    sweep: Arc<Mutex<Sweep>>,
+}
+
+/// Counts the requests executed through one storage handle by the prefix of
+/// their keys. A handle which is cloned for another thread gets counters of
+/// its own, and shares the pass over the live items of their storage.
+pub(crate) struct PrefixCounter {
+    inner: Option<Inner>,
+}
+
+impl PrefixCounter {
+    pub(crate) fn new(config: &SegOptions) -> Self {
+        let inner = Table::new(config.prefixes()).map(|table| {
+            let table = Arc::new(table);
+            let sweep = Arc::new(Mutex::new(Sweep::new(table.prefixes.len())));
+            let counts = PREFIXES.register(&table, Some(&sweep));
+            Inner {
+                table,
+                counts,
+                sweep,
+            }
+        });
+
+        Self { inner }
+    }
+
+    /// Whether any prefix is counted.
+    #[inline]
+    pub(crate) fn enabled(&self) -> bool {
+        self.inner.is_some()
+    }
+
+    #[inline]
+    fn counts(&self, key: &[u8]) -> Option<&Counts> {
+        let inner = self.inner.as_ref()?;
+        inner.table.find(key).map(|i| &inner.counts[i])
+    }
+
+    /// Counts a read of the key, which was a hit if it found an item.
+    #[inline]
+    pub(crate) fn get(&self, key: &[u8], hit: bool) {
+        if let Some(counts) = self.counts(key) {
+            Counts::incr(&counts.gets);
+            if hit {
+                Counts::incr(&counts.hits);
+            }
+        }
+    }
+
+    /// Counts a write which stored an item with the key.
+    #[inline]
+    pub(crate) fn set(&self, key: &[u8]) {
+        if let Some(counts) = self.counts(key) {
+            Counts::incr(&counts.sets);
+        }
+    }
+
+    /// Advances the pass over the live items of the storage by one step, with
+    /// `scan`, which calls its function with the key and size in bytes of each
+    /// live item held in a bounded number of buckets from the cursor, and
+    /// returns the next cursor. The step is skipped if another handle of the
+    /// same storage is taking one.
+    pub(crate) fn sweep<S>(&self, scan: S)
+    where
+        S: FnOnce(u64, usize, &mut dyn FnMut(&[u8], usize)) -> u64,
+    {
+        let inner = match &self.inner {
+            Some(inner) => inner,
+            None => return,
+        };
+        let mut sweep = match inner.sweep.try_lock() {
+            Ok(sweep) => sweep,
+            Err(_) => return,
+        };
+
+        let sweep = &mut *sweep;
+        let cursor = scan(sweep.cursor, SWEEP_BUCKETS, &mut |key, size| {
+            if let Some(i) = inner.table.find(key) {
+                sweep.bytes[i] += size as u64;
+                sweep.items[i] += 1;
+            }
+        });
+
+        sweep.cursor = cursor;
+        if cursor == 0 {
+            std::mem::swap(&mut sweep.bytes, &mut sweep.live_bytes);
+            std::mem::swap(&mut sweep.items, &mut sweep.live_items);
+            sweep.bytes.iter_mut().for_each(|b| *b = 0);
+            sweep.items.iter_mut().for_each(|i| *i = 0);
+            PREFIX_SWEEP.increment();
+        }
+    }
+}
+
+impl Clone for PrefixCounter {
+    fn clone(&self) -> Self {
+        let inner = self.inner.as_ref().map(|inner| Inner {
+            table: inner.table.clone(),
+            counts: PREFIXES.register(&inner.table, None),
+            sweep: inner.sweep.clone(),
+        });
+
+        Self { inner }
+    }
+}
+
+struct Registered {
+    table: Weak<Table>,
+    counts: Vec<Weak<[Counts]>>,
+    sweeps: Vec<Weak<Mutex<Sweep>>>,
+}
+
+pub struct Prefixes {
+    registered: Mutex<Option<Registered>>,
+}
+
+impl Prefixes {
+    const fn new() -> Self {
+        Self {
+            registered: Mutex::new(None),
+        }
+    }
+
+    /// Registers the counters of a new handle, and the pass over its storage
+    /// if it does not share one with a handle registered before. Handles
+    /// built from another config replace those registered before.
+    fn register(&self, table: &Arc<Table>, sweep: Option<&Arc<Mutex<Sweep>>>) -> Arc<[Counts]> {
+        let counts: Arc<[Counts]> = (0..table.prefixes.len())
+            .map(|_| Counts::default())
+            .collect();
+
+        let mut registered = self.registered.lock().unwrap();
+        let same = registered
+            .as_ref()
+            .and_then(|r| r.table.upgrade())
+            .map(|t| t.prefixes == table.prefixes)
+            .unwrap_or(false);
+        if !same {
+            *registered = Some(Registered {
+                table: Arc::downgrade(table),
+                counts: Vec::new(),
+                sweeps: Vec::new(),
+            });
+        }
+
+        let registered = registered.as_mut().unwrap();
+        registered.counts.retain(|c| c.strong_count() > 0);
+        registered.counts.push(Arc::downgrade(&counts));
+        if let Some(sweep) = sweep {
+            registered.sweeps.retain(|s| s.strong_count() > 0);
+            registered.sweeps.push(Arc::downgrade(sweep));
+        }
+
+        counts
+    }
+
+    /// Reports the hits, misses and sets of each prefix, added up over all
+    /// storage handles, along with their live bytes and items as of the last
+    /// complete pass over each storage, in the format of memcache stats.
+    /// Bytes are those of the keys and values. Bytes in prefixes which would
+    /// break up the report are shown as `.`.
+    pub fn report(&self) -> String {
+        let registered = self.registered.lock().unwrap();
+        let table = registered.as_ref().and_then(|r| r.table.upgrade());
+
+        let mut report = String::new();
+        let _ = write!(report, "STAT prefix_enabled {}\r\n", table.is_some() as u8);
+        if let (Some(registered), Some(table)) = (registered.as_ref(), table) {
+            let len = table.prefixes.len();
+            let mut gets = vec![0; len];
+            let mut hits = vec![0; len];
+            let mut sets = vec![0; len];
+            for counts in registered.counts.iter().filter_map(|c| c.upgrade()) {
+                for (i, counts) in counts.iter().enumerate() {
+                    gets[i] += counts.gets.load(Ordering::Relaxed);
+                    hits[i] += counts.hits.load(Ordering::Relaxed);
+                    sets[i] += counts.sets.load(Ordering::Relaxed);
+                }
+            }
+
+            let mut live_bytes = vec![0; len];
+            let mut live_items = vec![0; len];
+            for sweep in registered.sweeps.iter().filter_map(|s| s.upgrade()) {
+                if let Ok(sweep) = sweep.lock() {
+                    for i in 0..len {
+                        live_bytes[i] += sweep.live_bytes[i];
+                        live_items[i] += sweep.live_items[i];
+                    }
+                }
+            }
+
+            let _ = write!(report, "STAT prefix_sweeps {}\r\n", PREFIX_SWEEP.value());
+            for (i, prefix) in table.prefixes.iter().enumerate() {
+                let prefix = printable(prefix);
+                let misses = gets[i].saturating_sub(hits[i]);
+                let _ = write!(report, "STAT prefix_hits {} {}\r\n", prefix, hits[i]);
+                let _ = write!(report, "STAT prefix_misses {} {}\r\n", prefix, misses);
+                let _ = write!(report, "STAT prefix_sets {} {}\r\n", prefix, sets[i]);
+                let _ = write!(
+                    report,
+                    "STAT prefix_live_bytes {} {}\r\n",
+                    prefix, live_bytes[i]
+                );
+                let _ = write!(
+                    report,
+                    "STAT prefix_live_items {} {}\r\n",
+                    prefix, live_items[i]
+                );
+            }
+        }
+        report.push_str("END\r\n");
+        report
+    }
+}
+
+fn printable(prefix: &[u8]) -> String {
+    prefix
+        .iter()
+        .map(|b| {
+            if b.is_ascii_graphic() {
+                *b as char
+            } else {
+                '.'
+            }
+        })
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn table(prefixes: &[&str]) -> Option<Table> {
+        let prefixes: Vec<String> = prefixes.iter().map(|p| p.to_string()).collect();
+        Table::new(&prefixes)
+    }
+
+    #[test]
+    fn find() {
+        let t = table(&["user:", "user:admin:", "session:"]).unwrap();
+
+        // the longest prefix wins
+        let admin = t.find(b"user:admin:1").unwrap();
+        let user = t.find(b"user:1").unwrap();
+        let session = t.find(b"session:1").unwrap();
+        assert_eq!(&*t.prefixes[admin], b"user:admin:");
+        assert_eq!(&*t.prefixes[user], b"user:");
+        assert_eq!(&*t.prefixes[session], b"session:");
+
+        // as does no prefix at all
+        assert!(t.find(b"").is_none());
+        assert!(t.find(b"user").is_none());
+        assert!(t.find(b"other:1").is_none());
+
+        assert!(table(&[]).is_none());
+        assert!(table(&[""]).is_none());
+        assert!(table(&["a"; MAX_PREFIXES + 1]).is_none());
+    }
+
+    #[test]
+    fn sweep() {
+        let table = Arc::new(table(&["a", "b"]).unwrap());
+        let counter = PrefixCounter {
+            inner: Some(Inner {
+                counts: (0..2).map(|_| Counts::default()).collect(),
+                sweep: Arc::new(Mutex::new(Sweep::new(2))),
+                table,
+            }),
+        };
+
+        // a pass of two steps, which publishes its sums once it ends
+        let step = |cursor: u64, _: usize, f: &mut dyn FnMut(&[u8], usize)| {
+            f(b"a1", 10);
+            f(b"c1", 100);
+            if cursor == 0 {
+                f(b"b1", 20);
+                7
+            } else {
+                f(b"a2", 5);
+                0
+            }
+        };
+        counter.sweep(step);
+        {
+            let sweep = counter.inner.as_ref().unwrap().sweep.lock().unwrap();
+            assert_eq!(sweep.cursor, 7);
+            assert_eq!(sweep.live_bytes, vec![0, 0]);
+        }
+        counter.sweep(step);
+        let sweep = counter.inner.as_ref().unwrap().sweep.lock().unwrap();
+        assert_eq!(sweep.cursor, 0);
+        assert_eq!(sweep.live_bytes, vec![25, 20]);
+        assert_eq!(sweep.live_items, vec![3, 1]);
+        assert_eq!(sweep.bytes, vec![0, 0]);
+    }
+}
@@ -0,0 +1,229 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The encoding of a hash, which maps fields to values.
+//!
+//! ```text
+//! <count><slots> [<slot> ...] <flen><field><vlen><value> ...
+//! ╰------------╯ ╰----------╯ ╰------------------------------╯
+//!     header        index                 entries
+//! ```
+//!
+//! `count` is the number of entries and `slots` is the size of the index, both
+//! as variable length integers. Small hashes have no index and are searched
+//! with a linear scan of the entries. Once a hash holds `INDEX_THRESHOLD`
+//! fields it gains an open-addressed table of 32-bit little-endian slots, each
+//! holding one plus the offset of an entry within the entries, or zero for an
+//! empty slot. The table is at least twice the size of the hash, so a lookup
+//! probes only a few slots.
+//!
+//! A value may be changed in place when its length does not change, as none of
+//! the other bytes of the encoding move.
+
+use super::*;
+
+/// The number of fields at which a hash is indexed.
+pub(crate) const INDEX_THRESHOLD: usize = 32;
+
+const SLOT_SIZE: usize = std::mem::size_of::<u32>();
+
+/// A borrowed view of an encoded hash.
+pub(crate) struct Hash<'a> {
+    len: usize,
+    index: &'a [u8],
+    entries: &'a [u8],
+    /// The offset of the entries within the encoding.
+    base: usize,
+}
+
+/// A field of a hash along with its value.
+struct Entry<'a> {
+    field: &'a [u8],
+    value: &'a [u8],
+    /// The offset of the value within the entries.
+    value_offset: usize,
+    /// The offset of the next entry within the entries.
+    next: usize,
+}
+
+impl<'a> Hash<'a> {
+    /// Returns a view of an encoded hash, or `None` if the header is invalid.
+    pub fn decode(data: &'a [u8]) -> Option<Self> {
+        let (len, a) = read_varint(data)?;
+        let (slots, b) = read_varint(&data[a..])?;
+        let base = (a + b).checked_add(slots.checked_mul(SLOT_SIZE)?)?;
+
+        Some(Self {
+            len,
+            index: data.get((a + b)..base)?,
+            entries: &data[base..],
+            base,
+        })
+    }
+
+    /// The number of fields in the hash.
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Iterates over the fields and values of the hash, in the order they were
+    /// encoded.
+    pub fn iter(&self) -> impl Iterator<Item = (&'a [u8], &'a [u8])> + 'a {
+        let entries = self.entries;
+        let mut offset = 0;
+        std::iter::from_fn(move || {
+            let entry = entry(entries, offset)?;
+            offset = entry.next;
+            Some((entry.field, entry.value))
+        })
+        .take(self.len)
+    }
+
+    /// Returns the value of a field.
+    pub fn get(&self, field: &[u8]) -> Option<&'a [u8]> {
+        self.find(field).map(|(_, value)| value)
+    }
+
+    /// Returns the value of a field along with its offset within the encoding,
+    /// which allows a value of the same length to be written in its place.
+    pub fn find(&self, field: &[u8]) -> Option<(usize, &'a [u8])> {
+        let entry = if self.index.is_empty() {
+            self.scan(field)
+        } else {
+            self.probe(field)
+        }?;
+
+        Some((self.base + entry.value_offset, entry.value))
+    }
+
+    fn scan(&self, field: &[u8]) -> Option<Entry<'a>> {
+        let mut offset = 0;
+        for _ in 0..self.len {
+            let entry = entry(self.entries, offset)?;
+            if entry.field == field {
+                return Some(entry);
+            }
+            offset = entry.next;
+        }
+        None
+    }
+
+    fn probe(&self, field: &[u8]) -> Option<Entry<'a>> {
+        let slots = self.index.len() / SLOT_SIZE;
+        let mut slot = hash(field) as usize & (slots - 1);
+        for _ in 0..slots {
+            let start = slot * SLOT_SIZE;
+            let offset =
+                u32::from_le_bytes(self.index[start..(start + SLOT_SIZE)].try_into().unwrap())
+                    as usize;
+            if offset == 0 {
+                return None;
+            }
+            let entry = entry(self.entries, offset - 1)?;
+            if entry.field == field {
+                return Some(entry);
+            }
+            slot = (slot + 1) & (slots - 1);
+        }
+        None
+    }
+}
+
+fn entry(entries: &[u8], offset: usize) -> Option<Entry<'_>> {
+    let (field_offset, field) = read_bytes(entries, offset)?;
+    let (value_offset, value) = read_bytes(entries, field_offset + field.len())?;
+    Some(Entry {
+        field,
+        value,
+        value_offset,
+        next: value_offset + value.len(),
+    })
+}
+
+/// Encodes a hash from its fields and values, which must not repeat a field.
+pub(crate) fn encode(pairs: &[(&[u8], &[u8])]) -> Vec<u8> {
+    let mut entries = Vec::with_capacity(
+        pairs
+            .iter()
+            .map(|(field, value)| field.len() + value.len() + 2)
+            .sum(),
+    );
+    let mut offsets = Vec::with_capacity(pairs.len());
+    for (field, value) in pairs {
+        offsets.push(entries.len());
+        write_bytes(&mut entries, field);
+        write_bytes(&mut entries, value);
+    }
+
+    let slots = if pairs.len() >= INDEX_THRESHOLD {
+        (pairs.len() * 2).next_power_of_two()
+    } else {
+        0
+    };
+
+    let mut buf = Vec::with_capacity(10 + slots * SLOT_SIZE + entries.len());
+    write_varint(&mut buf, pairs.len());
+    write_varint(&mut buf, slots);
+
+    if slots > 0 {
+        let mut index = vec![0_u32; slots];
+        for ((field, _), offset) in pairs.iter().zip(offsets) {
+            let mut slot = hash(field) as usize & (slots - 1);
+            while index[slot] != 0 {
+                slot = (slot + 1) & (slots - 1);
+            }
+            index[slot] = offset as u32 + 1;
+        }
+        for slot in index {
+            buf.extend_from_slice(&slot.to_le_bytes());
+        }
+    }
+
+    buf.extend_from_slice(&entries);
+    buf
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn small() {
+        let data = encode(&[(b"name", b"alice"), (b"age", b"30")]);
+        let hash = Hash::decode(&data).unwrap();
+        assert_eq!(hash.len(), 2);
+        assert_eq!(hash.get(b"name"), Some(&b"alice"[..]));
+        assert_eq!(hash.get(b"age"), Some(&b"30"[..]));
+        assert_eq!(hash.get(b"email"), None);
+        assert_eq!(
+            hash.iter().collect::<Vec<_>>(),
+            vec![(&b"name"[..], &b"alice"[..]), (&b"age"[..], &b"30"[..])]
+        );
+
+        let (offset, value) = hash.find(b"name").unwrap();
+        assert_eq!(&data[offset..(offset + value.len())], b"alice");
+
+        let empty = encode(&[]);
+        assert_eq!(Hash::decode(&empty).unwrap().iter().count(), 0);
+    }
+
+    #[test]
+    fn indexed() {
+        let fields: Vec<String> = (0..100).map(|i| format!("field{i}")).collect();
+        let pairs: Vec<(&[u8], &[u8])> = fields
+            .iter()
+            .map(|f| (f.as_bytes(), &f.as_bytes()[5..]))
+            .collect();
+
+        let data = encode(&pairs);
+        let hash = Hash::decode(&data).unwrap();
+        assert!(!hash.index.is_empty());
+        assert_eq!(hash.len(), 100);
+        for (field, value) in &pairs {
+            assert_eq!(hash.get(field), Some(*value));
+        }
+        assert_eq!(hash.get(b"field100"), None);
+        assert_eq!(hash.iter().count(), 100);
+    }
+}
@@ -0,0 +1,321 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The encoding of a list, which is split into chunks in the manner of a
+//! quicklist.
+//!
+//! ```text
+//! <count><chunks> [<ccount><csize> ...] <chunk> ...
+//! ╰-------------╯ ╰-------------------╯ ╰---------╯
+//!     header           directory            body
+//!
+//! chunk: <len><element> <len><element> ...
+//! ```
+//!
+//! `count` is the number of elements and `chunks` the number of chunks. The
+//! directory holds the number of elements and the size in bytes of each chunk,
+//! and each chunk is a packed run of length-prefixed elements. All of these are
+//! variable length integers.
+//!
+//! The directory allows an element to be located by skipping whole chunks, so
+//! only the chunk which holds it is scanned. Elements are removed from either
+//! end of the list by dropping whole chunks and slicing the chunk at the
+//! boundary, so trimming a list never decodes the elements that it keeps.
+//! Chunks are filled up to `CHUNK_SIZE` bytes as elements are pushed.
+
+use super::*;
+
+use std::borrow::Cow;
+use std::ops::Range;
+
+/// The size in bytes up to which a chunk is filled.
+pub(crate) const CHUNK_SIZE: usize = 4096;
+
+/// A packed run of elements.
+#[derive(Clone, Debug)]
+struct Chunk<'a> {
+    count: usize,
+    data: Cow<'a, [u8]>,
+}
+
+impl<'a> Chunk<'a> {
+    fn elements(&self) -> impl Iterator<Item = &[u8]> {
+        elements(&self.data)
+    }
+
+    /// Keeps only the elements within the range.
+    fn slice(&mut self, range: Range<usize>) {
+        let start = offset_of(&self.data, range.start);
+        let end = start + offset_of(&self.data[start..], range.end - range.start);
+        self.data = match std::mem::take(&mut self.data) {
+            Cow::Borrowed(data) => Cow::Borrowed(&data[start..end]),
+            Cow::Owned(mut data) => {
+                data.truncate(end);
+                data.drain(..start);
+                Cow::Owned(data)
+            }
+        };
+        self.count = range.end - range.start;
+    }
+}
+
+/// Iterates over the elements of a chunk.
+fn elements(data: &[u8]) -> impl Iterator<Item = &[u8]> {
+    let mut offset = 0;
+    std::iter::from_fn(move || {
+        let (start, element) = read_bytes(data, offset)?;
+        offset = start + element.len();
+        Some(element)
+    })
+}
+
+/// Returns the offset of the element which follows the first `n` elements of a
+/// chunk.
+fn offset_of(data: &[u8], n: usize) -> usize {
+    let mut offset = 0;
+    for _ in 0..n {
+        match read_bytes(data, offset) {
+            Some((start, element)) => offset = start + element.len(),
+            None => break,
+        }
+    }
+    offset
+}
+
+/// Packs elements into chunks, in order.
+fn chunks<'b>(elements: impl Iterator<Item = &'b [u8]>) -> Vec<Chunk<'static>> {
+    let mut chunks = Vec::new();
+    let mut chunk = Chunk {
+        count: 0,
+        data: Cow::Owned(Vec::new()),
+    };
+    for element in elements {
+        if chunk.count > 0 && chunk.data.len() + element.len() > CHUNK_SIZE {
+            chunks.push(std::mem::replace(
+                &mut chunk,
+                Chunk {
+                    count: 0,
+                    data: Cow::Owned(Vec::new()),
+                },
+            ));
+        }
+        write_bytes(chunk.data.to_mut(), element);
+        chunk.count += 1;
+    }
+    if chunk.count > 0 {
+        chunks.push(chunk);
+    }
+    chunks
+}
+
+/// Joins two adjacent chunks if the result fits within a chunk.
+fn join<'a>(first: &Chunk<'a>, second: &Chunk<'a>) -> Option<Chunk<'a>> {
+    if first.data.len() + second.data.len() > CHUNK_SIZE {
+        return None;
+    }
+    let mut data = Vec::with_capacity(first.data.len() + second.data.len());
+    data.extend_from_slice(&first.data);
+    data.extend_from_slice(&second.data);
+    Some(Chunk {
+        count: first.count + second.count,
+        data: Cow::Owned(data),
+    })
+}
+
+/// A list which borrows the chunks of its encoding until they are changed.
+#[derive(Debug, Default)]
+pub(crate) struct List<'a> {
+    len: usize,
+    chunks: Vec<Chunk<'a>>,
+}
+
+impl<'a> List<'a> {
+    /// Returns a view of an encoded list, or `None` if the encoding is
+    /// invalid.
+    pub fn decode(data: &'a [u8]) -> Option<Self> {
+        let (len, mut offset) = read_varint(data)?;
+        let (count, n) = read_varint(data.get(offset..)?)?;
+        offset += n;
+
+        let mut sizes = Vec::with_capacity(count);
+        for _ in 0..count {
+            let (elements, a) = read_varint(data.get(offset..)?)?;
+            let (size, b) = read_varint(data.get((offset + a)..)?)?;
+            offset += a + b;
+            sizes.push((elements, size));
+        }
+
+        let mut chunks = Vec::with_capacity(count);
+        for (count, size) in sizes {
+            let chunk = data.get(offset..offset.checked_add(size)?)?;
+            offset += size;
+            chunks.push(Chunk {
+                count,
+                data: Cow::Borrowed(chunk),
+            });
+        }
+
+        Some(Self { len, chunks })
+    }
+
+    /// Encodes the list.
+    pub fn encode(&self) -> Vec<u8> {
+        let size: usize = self.chunks.iter().map(|c| c.data.len()).sum();
+        let mut buf = Vec::with_capacity(size + 10 * (2 + 2 * self.chunks.len()));
+        write_varint(&mut buf, self.len);
+        write_varint(&mut buf, self.chunks.len());
+        for chunk in &self.chunks {
+            write_varint(&mut buf, chunk.count);
+            write_varint(&mut buf, chunk.data.len());
+        }
+        for chunk in &self.chunks {
+            buf.extend_from_slice(&chunk.data);
+        }
+        buf
+    }
+
+    /// The number of elements in the list.
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Returns the element at an index.
+    pub fn get(&self, index: usize) -> Option<&[u8]> {
+        self.range(index..(index + 1)).next()
+    }
+
+    /// Iterates over the elements within a range of indices.
+    pub fn range(&self, range: Range<usize>) -> impl Iterator<Item = &[u8]> {
+        // skip the chunks which end before the range
+        let mut skip = range.start;
+        let mut first = 0;
+        for chunk in &self.chunks {
+            if skip < chunk.count {
+                break;
+            }
+            skip -= chunk.count;
+            first += 1;
+        }
+
+        self.chunks[first.min(self.chunks.len())..]
+            .iter()
+            .flat_map(|chunk| chunk.elements())
+            .skip(skip)
+            .take(range.end.saturating_sub(range.start))
+    }
+
+    /// Adds elements to the front of the list, each in turn, so that the last
+    /// element ends up first.
+    pub fn push_front(&mut self, elements: &[&[u8]]) {
+        let mut new = chunks(elements.iter().rev().copied());
+        if let (Some(last), Some(first)) = (new.last(), self.chunks.first()) {
+            if let Some(joined) = join(last, first) {
+                *new.last_mut().unwrap() = joined;
+                self.chunks.remove(0);
+            }
+        }
+        self.len += elements.len();
+        self.chunks.splice(0..0, new);
+    }
+
+    /// Adds elements to the back of the list, in order.
+    pub fn push_back(&mut self, elements: &[&[u8]]) {
+        let mut new = chunks(elements.iter().copied());
+        if let (Some(last), Some(first)) = (self.chunks.last(), new.first()) {
+            if let Some(joined) = join(last, first) {
+                new[0] = joined;
+                self.chunks.pop();
+            }
+        }
+        self.len += elements.len();
+        self.chunks.extend(new);
+    }
+
+    /// Keeps only the elements within a range of indices.
+    pub fn trim(&mut self, range: Range<usize>) {
+        let end = range.end.min(self.len);
+        let start = range.start.min(end);
+
+        let mut index = 0;
+        self.chunks.retain_mut(|chunk| {
+            let chunk_start = index;
+            index += chunk.count;
+            let keep = start.max(chunk_start)..end.min(index);
+            if keep.start >= keep.end {
+                return false;
+            }
+            if keep.end - keep.start < chunk.count {
+                chunk.slice((keep.start - chunk_start)..(keep.end - chunk_start));
+            }
+            true
+        });
+        self.len = end - start;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn elements(list: &List) -> Vec<Vec<u8>> {
+        list.range(0..list.len()).map(|e| e.to_vec()).collect()
+    }
+
+    #[test]
+    fn push() {
+        let mut list = List::default();
+        list.push_back(&[b"b", b"c"]);
+        list.push_front(&[b"a", b"z"]);
+        assert_eq!(list.len(), 4);
+        assert_eq!(list.get(0), Some(&b"z"[..]));
+        assert_eq!(list.get(3), Some(&b"c"[..]));
+        assert_eq!(list.get(4), None);
+
+        let data = list.encode();
+        let list = List::decode(&data).unwrap();
+        assert_eq!(
+            elements(&list),
+            vec![b"z".to_vec(), b"a".to_vec(), b"b".to_vec(), b"c".to_vec()]
+        );
+        assert_eq!(list.chunks.len(), 1);
+    }
+
+    #[test]
+    fn chunked() {
+        let values: Vec<Vec<u8>> = (0..2000).map(|i| format!("element{i}").into()).collect();
+        let refs: Vec<&[u8]> = values.iter().map(|v| &v[..]).collect();
+
+        let mut list = List::default();
+        for chunk in refs.chunks(100) {
+            list.push_back(chunk);
+        }
+        let data = list.encode();
+        let mut list = List::decode(&data).unwrap();
+        assert!(list.chunks.len() > 1);
+        assert_eq!(list.len(), 2000);
+        assert_eq!(list.get(1234), Some(&b"element1234"[..]));
+        assert_eq!(
+            list.range(998..1002).collect::<Vec<_>>(),
+            refs[998..1002].to_vec()
+        );
+
+        list.trim(10..1500);
+        assert_eq!(list.len(), 1490);
+        assert_eq!(list.get(0), Some(&b"element10"[..]));
+        assert_eq!(list.get(1489), Some(&b"element1499"[..]));
+        assert!(list
+            .chunks
+            .iter()
+            .all(|c| matches!(c.data, Cow::Borrowed(_))));
+
+        let data = list.encode();
+        let list = List::decode(&data).unwrap();
+        assert_eq!(elements(&list), values[10..1500].to_vec());
+
+        let mut empty = List::decode(&data).unwrap();
+        empty.trim(5..5);
+        assert_eq!(empty.len(), 0);
+        assert!(empty.chunks.is_empty());
+    }
+}
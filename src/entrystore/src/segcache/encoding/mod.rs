@@ -0,0 +1,75 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Compact encodings which store a data structure as the value of a single
+//! cache item, in the spirit of the `ziplist` and `smap` encodings of the
+//! legacy backends. Each encoding is a header followed by a packed sequence of
+//! length-prefixed entries, so that small data structures carry very little
+//! overhead. Lengths are LEB128 variable length integers.
+
+pub(crate) mod hash;
+pub(crate) mod list;
+pub(crate) mod set;
+pub(crate) mod zset;
+
+/// Appends a variable length integer.
+fn write_varint(buf: &mut Vec<u8>, mut value: usize) {
+    while value >= 0x80 {
+        buf.push(value as u8 | 0x80);
+        value >>= 7;
+    }
+    buf.push(value as u8);
+}
+
+/// Reads a variable length integer from the start of the buffer, returning
+/// the integer and the number of bytes it occupied.
+fn read_varint(buf: &[u8]) -> Option<(usize, usize)> {
+    let mut value = 0;
+    for (i, byte) in buf.iter().enumerate().take(10) {
+        value |= ((byte & 0x7f) as usize) << (7 * i);
+        if byte & 0x80 == 0 {
+            return Some((value, i + 1));
+        }
+    }
+    None
+}
+
+/// Appends a length-prefixed byte string.
+fn write_bytes(buf: &mut Vec<u8>, bytes: &[u8]) {
+    write_varint(buf, bytes.len());
+    buf.extend_from_slice(bytes);
+}
+
+/// Reads a length-prefixed byte string starting at the offset, returning the
+/// offset of its contents and the contents.
+fn read_bytes(buf: &[u8], offset: usize) -> Option<(usize, &[u8])> {
+    let (len, n) = read_varint(buf.get(offset..)?)?;
+    let start = offset + n;
+    Some((start, buf.get(start..start.checked_add(len)?)?))
+}
+
+/// A 32-bit FNV-1a hash. The hash is part of the stored encoding, so it must
+/// be stable across builds.
+fn hash(bytes: &[u8]) -> u32 {
+    bytes.iter().fold(0x811c9dc5, |hash: u32, byte| {
+        (hash ^ *byte as u32).wrapping_mul(0x01000193)
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn varint() {
+        for value in [0, 1, 127, 128, 300, 16383, 16384, u32::MAX as usize] {
+            let mut buf = Vec::new();
+            write_varint(&mut buf, value);
+            assert_eq!(read_varint(&buf), Some((value, buf.len())));
+        }
+
+        assert_eq!(read_varint(&[0x80]), None);
+        assert_eq!(read_bytes(&[3, b'a'], 0), None);
+    }
+}
@@ -0,0 +1,280 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The encodings of a set, which holds unique members.
+//!
+//! ```text
+//! <0><width><count> <member> <member> ...
+//! <1><hash>
+//! ```
+//!
+//! A set of integers is encoded like the legacy `sarray`, as a sorted array of
+//! little-endian signed integers which all have the same width of 2, 4 or 8
+//! bytes, chosen by the largest magnitude in the set. Members are found with a
+//! binary search. Only members which are integers in their canonical decimal
+//! form take this encoding, so that they are returned as they were added.
+//!
+//! Any other set, or a set of more than `INTEGERS_MAX` integers, is encoded as
+//! a [`hash`](super::hash) whose fields are the members and whose values are
+//! empty, which is searched with the index of the hash once it is large.
+
+use super::hash::{self, Hash};
+
+use std::borrow::Cow;
+use std::collections::HashSet;
+
+/// The largest number of members which are held in the integer encoding.
+pub(crate) const INTEGERS_MAX: usize = 512;
+
+const INTEGERS: u8 = 0;
+const HASHED: u8 = 1;
+
+/// A borrowed view of an encoded set.
+pub(crate) enum Set<'a> {
+    Integers { width: usize, data: &'a [u8] },
+    Hashed(Hash<'a>),
+}
+
+/// The encoding of an empty set.
+pub(crate) const EMPTY: &[u8] = &[INTEGERS, 2, 0];
+
+/// Returns the integer a member represents, if it is in canonical form.
+fn integer(member: &[u8]) -> Option<i64> {
+    let value: i64 = std::str::from_utf8(member).ok()?.parse().ok()?;
+    // reject forms such as `+1`, `01` and `-0`
+    if member[0] == b'+' || (member.len() > 1 && (member[0] == b'0' || member.starts_with(b"-0"))) {
+        return None;
+    }
+    Some(value)
+}
+
+/// Returns the width of the integers needed to hold all of the values.
+fn width(values: &[i64]) -> usize {
+    let (min, max) = values
+        .iter()
+        .fold((0, 0), |(min, max), v| (min.min(*v), max.max(*v)));
+    if min >= i16::MIN as i64 && max <= i16::MAX as i64 {
+        2
+    } else if min >= i32::MIN as i64 && max <= i32::MAX as i64 {
+        4
+    } else {
+        8
+    }
+}
+
+impl<'a> Set<'a> {
+    /// Returns a view of an encoded set, or `None` if the encoding is invalid.
+    pub fn decode(data: &'a [u8]) -> Option<Self> {
+        match *data.first()? {
+            INTEGERS => {
+                let width = *data.get(1)? as usize;
+                let (count, n) = super::read_varint(data.get(2..)?)?;
+                let data = data.get((2 + n)..)?;
+                if ![2, 4, 8].contains(&width) || data.len() != count.checked_mul(width)? {
+                    return None;
+                }
+                Some(Self::Integers { width, data })
+            }
+            HASHED => Hash::decode(&data[1..]).map(Self::Hashed),
+            _ => None,
+        }
+    }
+
+    /// The number of members in the set.
+    pub fn len(&self) -> usize {
+        match self {
+            Self::Integers { width, data } => data.len() / width,
+            Self::Hashed(hash) => hash.len(),
+        }
+    }
+
+    fn integer_at(width: usize, data: &[u8], index: usize) -> i64 {
+        let bytes = &data[(index * width)..((index + 1) * width)];
+        match width {
+            2 => i16::from_le_bytes(bytes.try_into().unwrap()) as i64,
+            4 => i32::from_le_bytes(bytes.try_into().unwrap()) as i64,
+            _ => i64::from_le_bytes(bytes.try_into().unwrap()),
+        }
+    }
+
+    fn integers(&self) -> Option<Vec<i64>> {
+        match self {
+            Self::Integers { width, data } => Some(
+                (0..self.len())
+                    .map(|i| Self::integer_at(*width, data, i))
+                    .collect(),
+            ),
+            Self::Hashed(_) => None,
+        }
+    }
+
+    /// Returns true if the member is in the set.
+    pub fn contains(&self, member: &[u8]) -> bool {
+        match self {
+            Self::Integers { width, data } => {
+                let value = match integer(member) {
+                    Some(value) => value,
+                    None => return false,
+                };
+                let (mut low, mut high) = (0, self.len());
+                while low < high {
+                    let mid = low + (high - low) / 2;
+                    match Self::integer_at(*width, data, mid).cmp(&value) {
+                        std::cmp::Ordering::Less => low = mid + 1,
+                        std::cmp::Ordering::Greater => high = mid,
+                        std::cmp::Ordering::Equal => return true,
+                    }
+                }
+                false
+            }
+            Self::Hashed(hash) => hash.get(member).is_some(),
+        }
+    }
+
+    /// Returns the members of the set. Integers are returned in ascending
+    /// order, other members in the order they were added.
+    pub fn members(&self) -> Vec<Cow<'a, [u8]>> {
+        match self {
+            Self::Integers { .. } => self
+                .integers()
+                .unwrap()
+                .into_iter()
+                .map(|v| Cow::Owned(v.to_string().into_bytes()))
+                .collect(),
+            Self::Hashed(hash) => hash.iter().map(|(m, _)| Cow::Borrowed(m)).collect(),
+        }
+    }
+
+    /// Encodes the set with the members added, returning the encoding and the
+    /// number of members which were not already in the set.
+    pub fn insert(&self, members: &[&[u8]]) -> (Vec<u8>, usize) {
+        if let Some(mut values) = self.integers() {
+            let before = values.len();
+            let mut integers = true;
+            for member in members {
+                match integer(member) {
+                    Some(value) => {
+                        if let Err(i) = values.binary_search(&value) {
+                            values.insert(i, value);
+                        }
+                    }
+                    None => {
+                        integers = false;
+                        break;
+                    }
+                }
+            }
+            if integers && values.len() <= INTEGERS_MAX {
+                let added = values.len() - before;
+                return (encode_integers(&values), added);
+            }
+        }
+
+        let mut current = self.members();
+        let before = current.len();
+        let mut seen: HashSet<Vec<u8>> = current.iter().map(|m| m.to_vec()).collect();
+        for member in members {
+            if seen.insert(member.to_vec()) {
+                current.push(Cow::Borrowed(member));
+            }
+        }
+        let added = current.len() - before;
+        let members: Vec<&[u8]> = current.iter().map(|m| &m[..]).collect();
+        (encode_hashed(&members), added)
+    }
+
+    /// Encodes the set with the members removed, returning the encoding and
+    /// the number of members which were removed.
+    pub fn remove(&self, members: &[&[u8]]) -> (Vec<u8>, usize) {
+        let members: HashSet<&[u8]> = members.iter().copied().collect();
+        match self {
+            Self::Integers { .. } => {
+                let values: Vec<i64> = self
+                    .integers()
+                    .unwrap()
+                    .into_iter()
+                    .filter(|v| !members.contains(v.to_string().as_bytes()))
+                    .collect();
+                let removed = self.len() - values.len();
+                (encode_integers(&values), removed)
+            }
+            Self::Hashed(hash) => {
+                let kept: Vec<&[u8]> = hash
+                    .iter()
+                    .map(|(m, _)| m)
+                    .filter(|m| !members.contains(m))
+                    .collect();
+                let removed = self.len() - kept.len();
+                (encode_hashed(&kept), removed)
+            }
+        }
+    }
+}
+
+/// Encodes sorted and unique integers.
+fn encode_integers(values: &[i64]) -> Vec<u8> {
+    let width = width(values);
+    let mut buf = Vec::with_capacity(2 + 10 + values.len() * width);
+    buf.push(INTEGERS);
+    buf.push(width as u8);
+    super::write_varint(&mut buf, values.len());
+    for value in values {
+        buf.extend_from_slice(&value.to_le_bytes()[..width]);
+    }
+    buf
+}
+
+/// Encodes unique members as a hash.
+fn encode_hashed(members: &[&[u8]]) -> Vec<u8> {
+    let pairs: Vec<(&[u8], &[u8])> = members.iter().map(|m| (*m, &b""[..])).collect();
+    let mut buf = vec![HASHED];
+    buf.extend_from_slice(&hash::encode(&pairs));
+    buf
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn integers() {
+        let (data, added) = Set::decode(EMPTY)
+            .unwrap()
+            .insert(&[b"3", b"-1", b"3", b"2"]);
+        assert_eq!(added, 3);
+        let set = Set::decode(&data).unwrap();
+        assert!(matches!(set, Set::Integers { width: 2, .. }));
+        assert!(set.contains(b"-1"));
+        assert!(!set.contains(b"4"));
+        assert!(!set.contains(b"03"));
+        assert_eq!(set.members(), vec![&b"-1"[..], b"2", b"3"]);
+
+        let (data, added) = set.insert(&[b"100000"]);
+        assert_eq!(added, 1);
+        let set = Set::decode(&data).unwrap();
+        assert!(matches!(set, Set::Integers { width: 4, .. }));
+        assert!(set.contains(b"100000"));
+
+        let (data, removed) = set.remove(&[b"2", b"5"]);
+        assert_eq!(removed, 1);
+        assert_eq!(Set::decode(&data).unwrap().len(), 3);
+    }
+
+    #[test]
+    fn hashed() {
+        let (data, _) = Set::decode(EMPTY).unwrap().insert(&[b"1", b"2"]);
+        let (data, added) = Set::decode(&data).unwrap().insert(&[b"a", b"2", b"01"]);
+        assert_eq!(added, 2);
+        let set = Set::decode(&data).unwrap();
+        assert!(matches!(set, Set::Hashed(_)));
+        assert!(set.contains(b"1"));
+        assert!(set.contains(b"01"));
+        assert!(set.contains(b"a"));
+        assert_eq!(set.len(), 4);
+
+        let (data, removed) = set.remove(&[b"a", b"b"]);
+        assert_eq!(removed, 1);
+        assert_eq!(Set::decode(&data).unwrap().len(), 3);
+    }
+}
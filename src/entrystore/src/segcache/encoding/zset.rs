@@ -0,0 +1,452 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The encoding of a sorted set, which holds unique members ordered by score.
+//!
+//! ```text
+//! <count><slots> [<slot> ...] [<block> ...] <score><mlen><member> ...
+//! ╰------------╯ ╰-------------------------╯ ╰-------------------------╯
+//!     header               index                      entries
+//! ```
+//!
+//! Entries are sorted by score, and entries of equal score by member, as with
+//! Redis. Each score is a little-endian `f64` followed by the length-prefixed
+//! member, so a small sorted set is a packed array in the manner of a
+//! `listpack`, which is scanned. Once a sorted set holds `INDEX_THRESHOLD`
+//! members it gains two indices of 32-bit little-endian offsets within the
+//! entries. The first is an open-addressed table of slots, as for a
+//! [`hash`](super::hash), which finds the entry of a member. The second is a
+//! directory of the offset of every `BLOCK`th entry, which finds the entry at
+//! a rank, or the first entry at or beyond a score, with a binary search and a
+//! scan of at most one block. This serves the lookups of a skiplist from a
+//! single allocation, with around ten bytes of index for each member.
+
+use super::*;
+
+use std::cmp::Ordering;
+use std::collections::{HashMap, HashSet};
+use std::ops::Range;
+
+/// The number of members at which a sorted set is indexed.
+pub(crate) const INDEX_THRESHOLD: usize = 32;
+
+/// The number of entries between the offsets held by the directory.
+const BLOCK: usize = 16;
+
+const SLOT_SIZE: usize = std::mem::size_of::<u32>();
+const SCORE_SIZE: usize = std::mem::size_of::<f64>();
+
+/// The encoding of an empty sorted set.
+pub(crate) const EMPTY: &[u8] = &[0, 0];
+
+/// A borrowed view of an encoded sorted set.
+pub(crate) struct SortedSet<'a> {
+    len: usize,
+    slots: &'a [u8],
+    blocks: &'a [u8],
+    entries: &'a [u8],
+}
+
+/// A member of a sorted set along with its score.
+struct Entry<'a> {
+    score: f64,
+    member: &'a [u8],
+    /// The offset of the next entry within the entries.
+    next: usize,
+}
+
+fn entry(entries: &[u8], offset: usize) -> Option<Entry<'_>> {
+    let score = entries.get(offset..offset.checked_add(SCORE_SIZE)?)?;
+    let score = f64::from_le_bytes(score.try_into().unwrap());
+    let (start, member) = read_bytes(entries, offset + SCORE_SIZE)?;
+    Some(Entry {
+        score,
+        member,
+        next: start + member.len(),
+    })
+}
+
+/// Reads the offset at a position of an index.
+fn offset_at(index: &[u8], position: usize) -> usize {
+    let start = position * SLOT_SIZE;
+    u32::from_le_bytes(index[start..(start + SLOT_SIZE)].try_into().unwrap()) as usize
+}
+
+/// Orders entries by score, and entries of equal score by member. Scores are
+/// never NaN.
+pub(crate) fn order(a: &(f64, &[u8]), b: &(f64, &[u8])) -> Ordering {
+    a.0.total_cmp(&b.0).then_with(|| a.1.cmp(b.1))
+}
+
+impl<'a> SortedSet<'a> {
+    /// Returns a view of an encoded sorted set, or `None` if the header is
+    /// invalid.
+    pub fn decode(data: &'a [u8]) -> Option<Self> {
+        let (len, a) = read_varint(data)?;
+        let (slots, b) = read_varint(data.get(a..)?)?;
+        if slots != 0 && !slots.is_power_of_two() {
+            return None;
+        }
+        let blocks = if slots > 0 { len.div_ceil(BLOCK) } else { 0 };
+
+        let start = a + b;
+        let mid = start.checked_add(slots.checked_mul(SLOT_SIZE)?)?;
+        let base = mid.checked_add(blocks.checked_mul(SLOT_SIZE)?)?;
+
+        Some(Self {
+            len,
+            slots: data.get(start..mid)?,
+            blocks: data.get(mid..base)?,
+            entries: data.get(base..)?,
+        })
+    }
+
+    /// The number of members in the sorted set.
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Iterates over the members and their scores in order, starting from the
+    /// entry at the offset, which has the rank.
+    fn iter_from(&self, offset: usize, rank: usize) -> impl Iterator<Item = (&'a [u8], f64)> {
+        let entries = self.entries;
+        let mut offset = offset;
+        std::iter::from_fn(move || {
+            let entry = entry(entries, offset)?;
+            offset = entry.next;
+            Some((entry.member, entry.score))
+        })
+        .take(self.len.saturating_sub(rank))
+    }
+
+    /// Iterates over the members and their scores in order.
+    pub fn iter(&self) -> impl Iterator<Item = (&'a [u8], f64)> {
+        self.iter_from(0, 0)
+    }
+
+    /// Iterates over the members and their scores within a range of ranks.
+    pub fn range(&self, range: Range<usize>) -> impl Iterator<Item = (&'a [u8], f64)> {
+        let end = range.end.min(self.len);
+        let start = range.start.min(end);
+
+        // the scan starts from the block which holds the first entry
+        let (mut rank, mut offset) = match self.blocks.len() / SLOT_SIZE {
+            0 => (0, 0),
+            _ => (start / BLOCK * BLOCK, offset_at(self.blocks, start / BLOCK)),
+        };
+        while rank < start {
+            match entry(self.entries, offset) {
+                Some(entry) => offset = entry.next,
+                None => break,
+            }
+            rank += 1;
+        }
+
+        self.iter_from(offset, rank).take(end - start)
+    }
+
+    /// Returns the rank of the first entry with a score admitted by `min`,
+    /// which must admit the scores of all of the entries which follow it.
+    pub fn first(&self, min: impl Fn(f64) -> bool) -> usize {
+        let (mut rank, mut offset) = (0, 0);
+
+        // find the first block which starts with an admitted score, as the
+        // first admitted entry is within the block before it
+        let blocks = self.blocks.len() / SLOT_SIZE;
+        let (mut low, mut high) = (0, blocks);
+        while low < high {
+            let mid = low + (high - low) / 2;
+            match entry(self.entries, offset_at(self.blocks, mid)) {
+                Some(entry) if !min(entry.score) => low = mid + 1,
+                _ => high = mid,
+            }
+        }
+        if low > 0 {
+            rank = (low - 1) * BLOCK;
+            offset = offset_at(self.blocks, low - 1);
+        }
+
+        for (_, score) in self.iter_from(offset, rank) {
+            if min(score) {
+                break;
+            }
+            rank += 1;
+        }
+        rank
+    }
+
+    /// Returns the score of a member.
+    pub fn score(&self, member: &[u8]) -> Option<f64> {
+        self.find(member).map(|(_, entry)| entry.score)
+    }
+
+    /// Returns the rank of a member, counting from the lowest score.
+    pub fn rank(&self, member: &[u8]) -> Option<usize> {
+        let (target, _) = self.find(member)?;
+
+        // the entry is within the last block which starts at or before it
+        let blocks = self.blocks.len() / SLOT_SIZE;
+        let (mut low, mut high) = (0, blocks);
+        while low < high {
+            let mid = low + (high - low) / 2;
+            if offset_at(self.blocks, mid) <= target {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        let (mut rank, mut offset) = match low {
+            0 => (0, 0),
+            _ => ((low - 1) * BLOCK, offset_at(self.blocks, low - 1)),
+        };
+
+        while offset < target {
+            offset = entry(self.entries, offset)?.next;
+            rank += 1;
+        }
+        (offset == target).then_some(rank)
+    }
+
+    /// Returns the offset of the entry of a member along with the entry.
+    fn find(&self, member: &[u8]) -> Option<(usize, Entry<'a>)> {
+        if self.slots.is_empty() {
+            let mut offset = 0;
+            for _ in 0..self.len {
+                let entry = entry(self.entries, offset)?;
+                if entry.member == member {
+                    return Some((offset, entry));
+                }
+                offset = entry.next;
+            }
+            return None;
+        }
+
+        let slots = self.slots.len() / SLOT_SIZE;
+        let mut slot = hash(member) as usize & (slots - 1);
+        for _ in 0..slots {
+            let offset = offset_at(self.slots, slot);
+            if offset == 0 {
+                return None;
+            }
+            let entry = entry(self.entries, offset - 1)?;
+            if entry.member == member {
+                return Some((offset - 1, entry));
+            }
+            slot = (slot + 1) & (slots - 1);
+        }
+        None
+    }
+
+    /// Encodes the sorted set with the scores of the members updated in turn.
+    /// For each member, `score` is given its current score, if any, and the
+    /// score of the request, and returns the new score of the member or `None`
+    /// to leave it as it is. Returns the encoding along with the number of
+    /// members which were added and the number of members whose score was
+    /// changed, or `None` if the sorted set is unchanged.
+    pub fn update(
+        &self,
+        members: &[(f64, &[u8])],
+        mut score: impl FnMut(Option<f64>, f64) -> Option<f64>,
+    ) -> Option<(Vec<u8>, usize, usize)> {
+        // the current and the new score of each member which changes
+        let mut changes: HashMap<&[u8], (Option<f64>, f64)> = HashMap::new();
+        for (requested, member) in members {
+            let current = match changes.get(member) {
+                Some((_, new)) => Some(*new),
+                None => self.score(member),
+            };
+            if let Some(new) = score(current, *requested) {
+                if current != Some(new) {
+                    let before = changes.get(member).map_or(current, |(before, _)| *before);
+                    changes.insert(*member, (before, new));
+                }
+            }
+        }
+        changes.retain(|_, (before, new)| *before != Some(*new));
+        if changes.is_empty() {
+            return None;
+        }
+
+        let added = changes
+            .values()
+            .filter(|(before, _)| before.is_none())
+            .count();
+        let changed = changes.len() - added;
+
+        let mut updated: Vec<(f64, &[u8])> = changes
+            .iter()
+            .map(|(member, (_, new))| (*new, *member))
+            .collect();
+        updated.sort_unstable_by(order);
+
+        // the entries which are kept are already in order, so the updated
+        // entries are merged into them
+        let kept = self
+            .iter()
+            .filter(|(member, _)| !changes.contains_key(member))
+            .map(|(member, score)| (score, member));
+        let mut entries = Vec::with_capacity(self.len + added);
+        let mut updated = updated.into_iter().peekable();
+        for entry in kept {
+            while let Some(next) = updated.next_if(|next| order(next, &entry).is_lt()) {
+                entries.push(next);
+            }
+            entries.push(entry);
+        }
+        entries.extend(updated);
+
+        Some((encode(&entries), added, changed))
+    }
+
+    /// Encodes the sorted set with the members removed, returning the encoding
+    /// and the number of members which were removed.
+    pub fn remove(&self, members: &[&[u8]]) -> (Vec<u8>, usize) {
+        let members: HashSet<&[u8]> = members.iter().copied().collect();
+        let kept: Vec<(f64, &[u8])> = self
+            .iter()
+            .filter(|(member, _)| !members.contains(member))
+            .map(|(member, score)| (score, member))
+            .collect();
+        let removed = self.len - kept.len();
+        (encode(&kept), removed)
+    }
+}
+
+/// Encodes a sorted set from its scores and members, which must be in order
+/// and must not repeat a member.
+pub(crate) fn encode(entries: &[(f64, &[u8])]) -> Vec<u8> {
+    let mut body = Vec::with_capacity(
+        entries
+            .iter()
+            .map(|(_, member)| SCORE_SIZE + member.len() + 2)
+            .sum(),
+    );
+    let mut offsets = Vec::with_capacity(entries.len());
+    for (score, member) in entries {
+        offsets.push(body.len());
+        body.extend_from_slice(&score.to_le_bytes());
+        write_bytes(&mut body, member);
+    }
+
+    let slots = if entries.len() >= INDEX_THRESHOLD {
+        (entries.len() * 2).next_power_of_two()
+    } else {
+        0
+    };
+    let blocks = if slots > 0 {
+        entries.len().div_ceil(BLOCK)
+    } else {
+        0
+    };
+
+    let mut buf = Vec::with_capacity(20 + (slots + blocks) * SLOT_SIZE + body.len());
+    write_varint(&mut buf, entries.len());
+    write_varint(&mut buf, slots);
+
+    if slots > 0 {
+        let mut index = vec![0_u32; slots];
+        for ((_, member), offset) in entries.iter().zip(&offsets) {
+            let mut slot = hash(member) as usize & (slots - 1);
+            while index[slot] != 0 {
+                slot = (slot + 1) & (slots - 1);
+            }
+            index[slot] = *offset as u32 + 1;
+        }
+        for slot in index {
+            buf.extend_from_slice(&slot.to_le_bytes());
+        }
+        for offset in offsets.iter().step_by(BLOCK) {
+            buf.extend_from_slice(&(*offset as u32).to_le_bytes());
+        }
+    }
+
+    buf.extend_from_slice(&body);
+    buf
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn small() {
+        let (data, added, changed) = SortedSet::decode(EMPTY)
+            .unwrap()
+            .update(&[(2.0, b"b"), (1.0, b"c"), (1.0, b"a")], |_, s| Some(s))
+            .unwrap();
+        assert_eq!((added, changed), (3, 0));
+
+        let zset = SortedSet::decode(&data).unwrap();
+        assert!(zset.slots.is_empty());
+        assert_eq!(
+            zset.iter().collect::<Vec<_>>(),
+            vec![(&b"a"[..], 1.0), (&b"c"[..], 1.0), (&b"b"[..], 2.0)]
+        );
+        assert_eq!(zset.score(b"c"), Some(1.0));
+        assert_eq!(zset.rank(b"b"), Some(2));
+        assert_eq!(zset.rank(b"d"), None);
+        assert_eq!(zset.first(|s| s >= 1.5), 2);
+        assert_eq!(zset.first(|s| s > 2.0), 3);
+        assert_eq!(
+            zset.range(1..5).map(|(m, _)| m).collect::<Vec<_>>(),
+            vec![&b"c"[..], b"b"]
+        );
+
+        // a score which is unchanged leaves the set as it is
+        assert!(zset.update(&[(2.0, b"b")], |_, s| Some(s)).is_none());
+
+        let (data, added, changed) = zset
+            .update(&[(0.5, b"b"), (3.0, b"d")], |_, s| Some(s))
+            .unwrap();
+        assert_eq!((added, changed), (1, 1));
+        let zset = SortedSet::decode(&data).unwrap();
+        assert_eq!(
+            zset.iter().map(|(m, _)| m).collect::<Vec<_>>(),
+            vec![&b"b"[..], b"a", b"c", b"d"]
+        );
+
+        let (data, removed) = zset.remove(&[b"a", b"e"]);
+        assert_eq!(removed, 1);
+        assert_eq!(SortedSet::decode(&data).unwrap().len(), 3);
+    }
+
+    #[test]
+    fn indexed() {
+        let members: Vec<String> = (0..100).map(|i| format!("member{i}")).collect();
+        let entries: Vec<(f64, &[u8])> = members
+            .iter()
+            .enumerate()
+            .map(|(i, m)| ((i / 2) as f64, m.as_bytes()))
+            .collect();
+        let mut sorted = entries.clone();
+        sorted.sort_by(order);
+
+        let data = encode(&sorted);
+        let zset = SortedSet::decode(&data).unwrap();
+        assert!(!zset.slots.is_empty());
+        assert_eq!(zset.len(), 100);
+        for (rank, (score, member)) in sorted.iter().enumerate() {
+            assert_eq!(zset.score(member), Some(*score));
+            assert_eq!(zset.rank(member), Some(rank));
+            assert_eq!(zset.range(rank..(rank + 1)).next(), Some((*member, *score)));
+        }
+        assert_eq!(zset.score(b"member100"), None);
+        assert_eq!(zset.first(|s| s >= 20.0), 40);
+        assert_eq!(zset.first(|s| s > 20.0), 42);
+        assert_eq!(zset.first(|s| s > 100.0), 100);
+        assert_eq!(zset.range(90..200).count(), 10);
+
+        let (data, added, changed) = zset
+            .update(&[(1.0, b"member0"), (-1.0, b"new")], |current, s| {
+                Some(current.unwrap_or(0.0) + s)
+            })
+            .unwrap();
+        assert_eq!((added, changed), (1, 1));
+        let zset = SortedSet::decode(&data).unwrap();
+        assert_eq!(zset.rank(b"new"), Some(0));
+        assert_eq!(zset.score(b"member0"), Some(1.0));
+        assert_eq!(zset.rank(b"member0"), Some(2));
+        assert_eq!(zset.iter().count(), 101);
+    }
+}
@@ -0,0 +1,101 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! This module defines how `Seg` storage will be used to execute `HTTP`
+//! storage commands.
+
+use super::*;
+use protocol_common::*;
+
+use protocol_http::*;
+
+impl Execute<ParseData, Response> for Seg {
+    fn execute(&mut self, request: &ParseData) -> Response {
+        SegRef {
+            data: &mut self.data,
+        }
+        .execute(request)
+    }
+
+    fn execute_batch(&mut self, requests: &[ParseData], responses: &mut Vec<Response>) {
+        // prefetch the buckets for every key in the batch up front so that the
+        // memory accesses overlap instead of stalling on each request in turn
+        for request in requests.iter().filter_map(|r| r.0.as_ref().ok()) {
+            self.data.prefetch(request.key());
+        }
+
+        responses.extend(requests.iter().map(|request| self.execute(request)));
+    }
+}
+
+impl Execute<ParseData, Response> for SharedSeg {
+    fn execute(&mut self, request: &ParseData) -> Response {
+        match &request.0 {
+            Ok(r) => SegRef {
+                data: &mut self.data.shard(r.key()),
+            }
+            .execute(request),
+            Err(e) => e.to_response(),
+        }
+    }
+}
+
+impl Execute<ParseData, Response> for SegRef<'_> {
+    fn execute(&mut self, request: &ParseData) -> Response {
+        let request = match &request.0 {
+            Ok(request) => request,
+            Err(e) => return e.to_response(),
+        };
+
+        let headers = &request.headers;
+        let mut response = match request.data() {
+            RequestData::Get(key) => self.get(key, headers),
+            RequestData::Put(key, value) => self.put(key, value, headers),
+            RequestData::Delete(key) => self.delete(key, headers),
+        };
+
+        if !request.keep_alive() {
+            response.should_close(true);
+        }
+
+        response
+    }
+}
+
+impl Storage for SegRef<'_> {
+    fn get(&mut self, key: &[u8], headers: &Headers) -> Response {
+        let item = match self.data.get(key) {
+            Some(item) => item,
+            None => return Response::builder(404).empty(),
+        };
+
+        // large values are written out directly from segment memory, which
+        // also lets a range of a large value be served without a copy
+        let value: SharedBytes = match item.value() {
+            segcache::Value::Bytes(b) if b.len() >= PIN_THRESHOLD && !item.is_compressed() => {
+                Arc::new(PinnedValue(self.data.pin(&item)))
+            }
+            segcache::Value::Bytes(b) => Arc::new(b.to_vec()),
+            segcache::Value::U64(v) => Arc::new(Digits::new(v).as_bytes().to_vec()),
+        };
+
+        Response::value(value, headers).unwrap_or_else(|e| e.to_response())
+    }
+
+    fn put(&mut self, key: &[u8], value: &[u8], _headers: &Headers) -> Response {
+        match self.data.insert(key, value, None, Duration::ZERO) {
+            Ok(()) => Response::builder(204).empty(),
+            Err(SegcacheError::ItemOversized { .. }) => Response::builder(413).empty(),
+            Err(_) => Response::builder(500).empty(),
+        }
+    }
+
+    fn delete(&mut self, key: &[u8], _headers: &Headers) -> Response {
+        if self.data.delete(key) {
+            Response::builder(204).empty()
+        } else {
+            Response::builder(404).empty()
+        }
+    }
+}
@@ -14,10 +14,556 @@ use protocol_memcache::*;
 use std::time::Duration;
 
 impl Execute<Request, Response> for Seg {
+    fn execute(&mut self, request: &Request) -> Response {
+        let response = SegRef {
+            data: &mut self.data,
+        }
+        .execute(request);
+
+        if self.hotkeys.sample() {
+            sample(&self.hotkeys, request, &response);
+        }
+        if self.prefixes.enabled() {
+            count(&self.prefixes, request, &response);
+        }
+
+        response
+    }
+
+    fn execute_batch(&mut self, requests: &[Request], responses: &mut Vec<Response>) {
+        // prefetch the buckets for every key in the batch up front so that the
+        // memory accesses overlap instead of stalling on each request in turn
+        for request in requests {
+            match request {
+                Request::Get(get) => get
+                    .keys()
+                    .iter()
+                    .for_each(|key| self.data.prefetch_hashed(key.hash())),
+                Request::Gets(gets) => gets
+                    .keys()
+                    .iter()
+                    .for_each(|key| self.data.prefetch_hashed(key.hash())),
+                Request::Gat(gat) => gat
+                    .keys()
+                    .iter()
+                    .for_each(|key| self.data.prefetch_hashed(key.hash())),
+                Request::Gats(gats) => gats
+                    .keys()
+                    .iter()
+                    .for_each(|key| self.data.prefetch_hashed(key.hash())),
+                Request::Set(set) => self.data.prefetch(set.key()),
+                Request::Add(add) => self.data.prefetch(add.key()),
+                Request::Replace(replace) => self.data.prefetch(replace.key()),
+                Request::Cas(cas) => self.data.prefetch(cas.key()),
+                Request::Incr(incr) => self.data.prefetch(incr.key()),
+                Request::Decr(decr) => self.data.prefetch(decr.key()),
+                Request::Append(append) => self.data.prefetch(append.key()),
+                Request::Prepend(prepend) => self.data.prefetch(prepend.key()),
+                Request::Delete(delete) => self.data.prefetch(delete.key()),
+                Request::Touch(touch) => self.data.prefetch(touch.key()),
+                Request::MetaGet(get) => self.data.prefetch(get.key()),
+                Request::MetaSet(set) => self.data.prefetch(set.key()),
+                Request::MetaDelete(delete) => self.data.prefetch(delete.key()),
+                Request::MetaArithmetic(arithmetic) => self.data.prefetch(arithmetic.key()),
+                Request::Binary(binary) => {
+                    if let Some(key) = binary.key() {
+                        self.data.prefetch(key);
+                    }
+                }
+                Request::FlushAll(_) | Request::Quit(_) | Request::MetaNoop(_) => {}
+            }
+        }
+
+        responses.extend(requests.iter().map(|request| self.execute(request)));
+    }
+
+    fn reserve(&mut self, request: &Request, len: usize) -> Option<usize> {
+        let Request::Set(set) = request else {
+            return None;
+        };
+
+        // immediate expiry maps to a delete, which is executed as usual
+        let ttl = set.ttl().get().unwrap_or(0);
+        if ttl < 0 {
+            return None;
+        }
+
+        let ingest = self
+            .data
+            .ingest(
+                set.key(),
+                len,
+                Some(&set.flags().to_be_bytes()),
+                Duration::from_secs(ttl as u64),
+            )
+            .ok()?;
+
+        let id = self.ingest_id;
+        self.ingest_id = self.ingest_id.wrapping_add(1);
+        self.ingests.insert(id, ingest);
+        Some(id)
+    }
+
+    fn reserved(&mut self, id: usize) -> &mut [u8] {
+        self.ingests
+            .get_mut(&id)
+            .map(|ingest| ingest.value_mut())
+            .unwrap_or_default()
+    }
+
+    fn commit(&mut self, id: usize, request: &Request) -> Option<Response> {
+        let ingest = self.ingests.remove(&id)?;
+        let Request::Set(set) = request else {
+            self.data.abort(ingest);
+            return None;
+        };
+
+        let response = match self.data.commit(ingest) {
+            // an item whose segment expired meanwhile was stored, and has
+            // since expired along with it
+            Ok(()) | Err(SegcacheError::Expired) => Response::stored(set.noreply()),
+            Err(_) => Response::server_error(""),
+        };
+
+        if self.hotkeys.sample() {
+            sample(&self.hotkeys, request, &response);
+        }
+        if self.prefixes.enabled() {
+            count(&self.prefixes, request, &response);
+        }
+
+        Some(response)
+    }
+
+    fn abort(&mut self, id: usize) {
+        if let Some(ingest) = self.ingests.remove(&id) {
+            self.data.abort(ingest);
+        }
+    }
+}
+
+impl Execute<Request, Response> for SharedSeg {
+    fn execute(&mut self, request: &Request) -> Response {
+        let response = self.dispatch(request);
+
+        if self.hotkeys.sample() {
+            sample(&self.hotkeys, request, &response);
+        }
+        if self.prefixes.enabled() {
+            count(&self.prefixes, request, &response);
+        }
+
+        response
+    }
+}
+
+impl SharedSeg {
+    fn dispatch(&mut self, request: &Request) -> Response {
+        // multi-key requests lock the owning shard for each key in turn, all
+        // other requests are executed while holding the lock for their key
+        let key = match request {
+            Request::Get(get) => return self.get(get.keys(), false),
+            Request::Gets(gets) => return self.get(gets.keys(), true),
+            Request::Gat(gat) => return self.gat(gat.keys(), gat.ttl(), false),
+            Request::Gats(gats) => return self.gat(gats.keys(), gats.ttl(), true),
+            Request::Set(set) => set.key(),
+            Request::Add(add) => add.key(),
+            Request::Replace(replace) => replace.key(),
+            Request::Cas(cas) => cas.key(),
+            Request::Incr(incr) => incr.key(),
+            Request::Decr(decr) => decr.key(),
+            Request::Append(append) => append.key(),
+            Request::Prepend(prepend) => prepend.key(),
+            Request::Delete(delete) => delete.key(),
+            Request::Touch(touch) => touch.key(),
+            Request::MetaGet(get) => get.key(),
+            Request::MetaSet(set) => set.key(),
+            Request::MetaDelete(delete) => delete.key(),
+            Request::MetaArithmetic(arithmetic) => arithmetic.key(),
+            Request::Binary(binary) => match binary.key() {
+                Some(key) => key,
+                None => return Response::binary(binary, self.execute(binary.request())),
+            },
+            Request::MetaNoop(_) => return Meta::noop().into(),
+            Request::FlushAll(_) => return Response::error(),
+            Request::Quit(_) => return Response::hangup(),
+        };
+
+        SegRef {
+            data: &mut self.data.shard(key),
+        }
+        .execute(request)
+    }
+
+    fn get(&mut self, keys: &[Key], cas: bool) -> Response {
+        let mut values = Vec::with_capacity(keys.len());
+        for key in keys.iter() {
+            let mut shard = self.data.shard(key);
+            if let Some(item) = shard.get_hashed(key, key.hash()) {
+                values.push(value(&shard, &item, cas));
+            } else {
+                values.push(Value::none(key));
+            }
+        }
+        Values::new(values.into_boxed_slice()).into()
+    }
+
+    fn gat(&mut self, keys: &[Key], ttl: Ttl, cas: bool) -> Response {
+        let values: Vec<Value> = keys
+            .iter()
+            .map(|key| touched_value(&mut self.data.shard(key), key, ttl, cas))
+            .collect();
+        Values::new(values.into_boxed_slice()).into()
+    }
+}
+
+/// Samples the keys of a request for hot keys, along with the bytes of value
+/// served for each key and the bytes written.
+/// Counts the reads and writes of a request against the prefixes of their
+/// keys. A read is a hit if it found an item, and a write is counted if it
+/// stored one.
+fn count(prefixes: &PrefixCounter, request: &Request, response: &Response) {
+    let keys = match request {
+        Request::Get(get) => get.keys(),
+        Request::Gets(gets) => gets.keys(),
+        Request::Gat(gat) => gat.keys(),
+        Request::Gats(gats) => gats.keys(),
+        Request::MetaGet(get) => {
+            let hit = matches!(response, Response::Meta(meta) if meta.code() != MetaCode::En);
+            prefixes.get(get.key(), hit);
+            return;
+        }
+        _ => {
+            let key = match request {
+                Request::Set(set) => set.key(),
+                Request::Add(add) => add.key(),
+                Request::Replace(replace) => replace.key(),
+                Request::Cas(cas) => cas.key(),
+                Request::Append(append) => append.key(),
+                Request::Prepend(prepend) => prepend.key(),
+                Request::MetaSet(set) => set.key(),
+                _ => return,
+            };
+            let stored = match response {
+                Response::Stored(_) => true,
+                Response::Meta(meta) => meta.code() == MetaCode::Hd,
+                _ => false,
+            };
+            if stored {
+                prefixes.set(key);
+            }
+            return;
+        }
+    };
+
+    // the values are those of the keys which were hits, in the order of
+    // the keys
+    let mut values = match response {
+        Response::Values(values) => values.values(),
+        _ => &[],
+    }
+    .iter()
+    .peekable();
+    for key in keys {
+        let hit = values.next_if(|value| value.key() == &key[..]).is_some();
+        prefixes.get(key, hit);
+    }
+}
+
+fn sample(hotkeys: &HotkeySampler, request: &Request, response: &Response) {
+    let (key, written) = match request {
+        Request::Get(_) | Request::Gets(_) | Request::Gat(_) | Request::Gats(_) => {
+            if let Response::Values(values) = response {
+                for value in values.values() {
+                    hotkeys.record(value.key(), value.len().unwrap_or(0), None);
+                }
+            }
+            return;
+        }
+        Request::Set(set) => (set.key(), Some(set.value().len())),
+        Request::Add(add) => (add.key(), Some(add.value().len())),
+        Request::Replace(replace) => (replace.key(), Some(replace.value().len())),
+        Request::Cas(cas) => (cas.key(), Some(cas.value().len())),
+        Request::Append(append) => (append.key(), Some(append.value().len())),
+        Request::Prepend(prepend) => (prepend.key(), Some(prepend.value().len())),
+        Request::MetaSet(set) => (set.key(), Some(set.value().len())),
+        Request::Incr(incr) => (incr.key(), None),
+        Request::Decr(decr) => (decr.key(), None),
+        Request::Delete(delete) => (delete.key(), None),
+        Request::Touch(touch) => (touch.key(), None),
+        Request::MetaGet(get) => (get.key(), None),
+        Request::MetaDelete(delete) => (delete.key(), None),
+        Request::MetaArithmetic(arithmetic) => (arithmetic.key(), None),
+        Request::Binary(binary) => match binary.key() {
+            Some(key) => (key, None),
+            None => return,
+        },
+        Request::FlushAll(_) | Request::Quit(_) | Request::MetaNoop(_) => return,
+    };
+
+    let served = match response {
+        Response::Meta(meta) => meta.value_len().unwrap_or(0),
+        _ => 0,
+    };
+    hotkeys.record(key, served, written);
+}
+
+/// Converts a cache item into a `Value` for the response. The CAS value is
+/// only included if requested. Large values hold a reference on their segment
+/// instead of being copied.
+fn value(cache: &segcache::Segcache, item: &segcache::Item, cas: bool) -> Value {
+    let o = item.optional().unwrap_or(&[0, 0, 0, 0]);
+    let flags = u32::from_be_bytes([o[0], o[1], o[2], o[3]]);
+    let cas = if cas { Some(item.cas().into()) } else { None };
+    match item.value() {
+        segcache::Value::Bytes(b) if b.len() >= PIN_THRESHOLD && !item.is_compressed() => {
+            Value::shared(item.key(), flags, cas, PinnedValue(cache.pin(item)))
+        }
+        segcache::Value::Bytes(b) => Value::new(item.key(), flags, cas, b),
+        segcache::Value::U64(v) => Value::new(item.key(), flags, cas, Digits::new(v).as_bytes()),
+    }
+}
+
+/// Gives the item for the key a new TTL and returns its value, or a miss if
+/// it is not found. An immediate expiry returns the value once before the item
+/// is removed.
+fn touched_value(cache: &mut segcache::Segcache, key: &[u8], ttl: Ttl, cas: bool) -> Value {
+    let item = match duration(ttl) {
+        Some(ttl) => cache.touch(key, ttl).ok(),
+        None => cache.get(key),
+    };
+    let value = match item {
+        Some(item) => value(cache, &item, cas),
+        None => Value::none(key),
+    };
+    if duration(ttl).is_none() {
+        cache.delete(key);
+    }
+    value
+}
+
+/// Meta commands keep the lease state of an item in a byte which follows its
+/// client flags in the optional data. An invalidated item is stale until it
+/// is stored again. Once a client has been handed the right to recache an
+/// item, the other clients are told that it has already been won.
+const META_STALE: u8 = 0x01;
+const META_WON: u8 = 0x02;
+
+fn client_flags(item: &segcache::Item) -> u32 {
+    let o = item.optional().unwrap_or(&[0, 0, 0, 0]);
+    u32::from_be_bytes([o[0], o[1], o[2], o[3]])
+}
+
+fn meta_state(item: &segcache::Item) -> u8 {
+    item.optional().and_then(|o| o.get(4)).copied().unwrap_or(0)
+}
+
+/// Returns the optional data for an item, which only carries the lease state
+/// when there is one, so that items stored by meta commands match those
+/// stored by the other commands.
+fn optional(flags: u32, state: u8, buf: &mut [u8; 5]) -> &[u8] {
+    buf[..4].copy_from_slice(&flags.to_be_bytes());
+    buf[4] = state;
+    if state == 0 {
+        &buf[..4]
+    } else {
+        &buf[..]
+    }
+}
+
+/// Converts a TTL into the duration to store an item for. Returns `None` for
+/// an immediate expiry.
+fn duration(ttl: Ttl) -> Option<Duration> {
+    match ttl.get() {
+        Some(ttl) if ttl < 0 => None,
+        ttl => Some(Duration::from_secs(ttl.unwrap_or(0) as u64)),
+    }
+}
+
+/// Adds the value of a cache item to a meta response. Large values hold a
+/// reference on their segment instead of being copied.
+fn meta_value(cache: &segcache::Segcache, item: &segcache::Item, response: Meta) -> Meta {
+    match item.value() {
+        segcache::Value::Bytes(b) if b.len() >= PIN_THRESHOLD && !item.is_compressed() => {
+            response.shared(PinnedValue(cache.pin(item)))
+        }
+        segcache::Value::Bytes(b) => response.value(b),
+        segcache::Value::U64(v) => response.value(Digits::new(v).as_bytes()),
+    }
+}
+
+/// Adds the value, client flags, and size of a cache item to a meta response,
+/// if the request asked for them.
+fn meta_fields(
+    cache: &segcache::Segcache,
+    item: &segcache::Item,
+    flags: &MetaFlags,
+    mut response: Meta,
+) -> Meta {
+    if flags.return_value() {
+        response = meta_value(cache, item, response);
+    }
+    if flags.return_flags() {
+        response = response.flags(client_flags(item));
+    }
+    if flags.return_size() {
+        response = response.size(value_len(item));
+    }
+    response
+}
+
+/// Returns the length of the value which is returned for a cache item.
+fn value_len(item: &segcache::Item) -> usize {
+    match item.value() {
+        segcache::Value::Bytes(b) => b.len(),
+        segcache::Value::U64(v) => Digits::new(v).len(),
+    }
+}
+
+impl SegRef<'_> {
+    fn get_many(&mut self, keys: &[Key], cas: bool) -> Response {
+        // single key lookups gain nothing from batching
+        if keys.len() == 1 {
+            let value = match self.data.get_hashed(&keys[0], keys[0].hash()) {
+                Some(item) => value(self.data, &item, cas),
+                None => Value::none(&keys[0]),
+            };
+            return Values::new(vec![value].into_boxed_slice()).into();
+        }
+
+        let hashes: Vec<u64> = keys.iter().map(|key| key.hash()).collect();
+        let items = self.data.get_many_hashed(keys, &hashes);
+        let values: Vec<Value> = items
+            .iter()
+            .zip(keys.iter())
+            .map(|(item, key)| match item {
+                Some(item) => value(self.data, item, cas),
+                None => Value::none(key),
+            })
+            .collect();
+        Values::new(values.into_boxed_slice()).into()
+    }
+
+    fn gat_many(&mut self, keys: &[Key], ttl: Ttl, cas: bool) -> Response {
+        let values: Vec<Value> = keys
+            .iter()
+            .map(|key| touched_value(self.data, key, ttl, cas))
+            .collect();
+        Values::new(values.into_boxed_slice()).into()
+    }
+}
+
+impl SegRef<'_> {
+    /// Stores a value, holding numeric values as integers so that they can be
+    /// incremented and decremented.
+    fn store(
+        &mut self,
+        key: &[u8],
+        value: &[u8],
+        optional: &[u8],
+        ttl: Duration,
+    ) -> Result<(), SegcacheError> {
+        match std::str::from_utf8(value)
+            .ok()
+            .and_then(|s| s.parse::<u64>().ok())
+        {
+            Some(v) => self.data.insert(key, v, Some(optional), ttl),
+            None => self.data.insert(key, value, Some(optional), ttl),
+        }
+    }
+
+    /// Rewrites an item with a new lease state and TTL, keeping its value and
+    /// client flags. The item is pinned while it is copied, as storing it may
+    /// reuse the segment which holds it.
+    fn restore(
+        &mut self,
+        item: &segcache::Item,
+        state: u8,
+        ttl: Duration,
+    ) -> Result<(), SegcacheError> {
+        let item = self.data.pin(item);
+        let mut buf = [0; 5];
+        let optional = optional(client_flags(&item), state, &mut buf);
+        self.data
+            .insert(item.key(), item.value(), Some(optional), ttl)
+    }
+
+    /// Appends, or prepends if `front` is set, bytes to the value of an
+    /// existing item, keeping its client flags and TTL. The value is extended
+    /// in place when storage allows.
+    fn extend(&mut self, key: &[u8], bytes: &[u8], front: bool, noreply: bool) -> Response {
+        let result = if front {
+            self.data.prepend(key, bytes)
+        } else {
+            self.data.append(key, bytes)
+        };
+        let result = match result {
+            Err(SegcacheError::NotNumeric) => self.extend_numeric(key, bytes, front),
+            result => result,
+        };
+
+        match result {
+            Ok(()) => Response::stored(noreply),
+            Err(SegcacheError::NotFound) => Response::not_stored(noreply),
+            Err(_) => Response::server_error(""),
+        }
+    }
+
+    /// Extends a value held as an integer by its digits, storing the result
+    /// as an integer again if it is still a number.
+    fn extend_numeric(
+        &mut self,
+        key: &[u8],
+        bytes: &[u8],
+        front: bool,
+    ) -> Result<(), SegcacheError> {
+        let item = self
+            .data
+            .get_no_freq_incr(key)
+            .ok_or(SegcacheError::NotFound)?;
+        let digits = match item.value() {
+            segcache::Value::U64(v) => v.to_string().into_bytes(),
+            segcache::Value::Bytes(b) => b.to_vec(),
+        };
+        let value = if front {
+            [bytes, &digits].concat()
+        } else {
+            [&digits, bytes].concat()
+        };
+        let ttl = self
+            .data
+            .ttl(&item)
+            .map(|ttl| ttl.max(Duration::from_secs(1)))
+            .unwrap_or(Duration::ZERO);
+        let optional = item.optional().unwrap_or(&[]).to_vec();
+        self.store(key, &value, &optional, ttl)
+    }
+
+    /// Adds the cas value and remaining TTL of a stored item to a meta
+    /// response, if the request asked for them. The item is read once it has
+    /// been stored, as storing an item changes both.
+    fn meta_stored(&mut self, key: &[u8], flags: &MetaFlags, mut response: Meta) -> Meta {
+        if flags.return_cas() || flags.return_ttl() {
+            if let Some(item) = self.data.get_no_freq_incr(key) {
+                if flags.return_cas() {
+                    response = response.cas(item.cas().into());
+                }
+                if flags.return_ttl() {
+                    response = response.ttl(self.remaining_secs(&item));
+                }
+            }
+        }
+        response
+    }
+}
+
+impl Execute<Request, Response> for SegRef<'_> {
     fn execute(&mut self, request: &Request) -> Response {
         match request {
             Request::Get(get) => self.get(get),
             Request::Gets(gets) => self.gets(gets),
+            Request::Gat(gat) => self.gat(gat),
+            Request::Gats(gats) => self.gats(gats),
             Request::Set(set) => self.set(set),
             Request::Add(add) => self.add(add),
             Request::Replace(replace) => self.replace(replace),
@@ -27,63 +573,34 @@ impl Execute<Request, Response> for Seg {
             Request::Append(append) => self.append(append),
             Request::Prepend(prepend) => self.prepend(prepend),
             Request::Delete(delete) => self.delete(delete),
+            Request::Touch(touch) => self.touch(touch),
+            Request::MetaGet(get) => self.meta_get(get),
+            Request::MetaSet(set) => self.meta_set(set),
+            Request::MetaDelete(delete) => self.meta_delete(delete),
+            Request::MetaArithmetic(arithmetic) => self.meta_arithmetic(arithmetic),
+            Request::MetaNoop(noop) => self.meta_noop(noop),
+            Request::Binary(binary) => Response::binary(binary, self.execute(binary.request())),
             Request::FlushAll(flush_all) => self.flush_all(flush_all),
             Request::Quit(quit) => self.quit(quit),
         }
     }
 }
 
-impl Storage for Seg {
+impl Storage for SegRef<'_> {
     fn get(&mut self, get: &Get) -> Response {
-        let mut values = Vec::with_capacity(get.keys().len());
-        for key in get.keys().iter() {
-            if let Some(item) = self.data.get(key) {
-                let o = item.optional().unwrap_or(&[0, 0, 0, 0]);
-                let flags = u32::from_be_bytes([o[0], o[1], o[2], o[3]]);
-                match item.value() {
-                    segcache::Value::Bytes(b) => {
-                        values.push(Value::new(item.key(), flags, None, b));
-                    }
-                    segcache::Value::U64(v) => {
-                        values.push(Value::new(
-                            item.key(),
-                            flags,
-                            None,
-                            format!("{v}").as_bytes(),
-                        ));
-                    }
-                }
-            } else {
-                values.push(Value::none(key));
-            }
-        }
-        Values::new(values.into_boxed_slice()).into()
+        self.get_many(get.keys(), false)
     }
 
     fn gets(&mut self, get: &Gets) -> Response {
-        let mut values = Vec::with_capacity(get.keys().len());
-        for key in get.keys().iter() {
-            if let Some(item) = self.data.get(key) {
-                let o = item.optional().unwrap_or(&[0, 0, 0, 0]);
-                let flags = u32::from_be_bytes([o[0], o[1], o[2], o[3]]);
-                match item.value() {
-                    segcache::Value::Bytes(b) => {
-                        values.push(Value::new(item.key(), flags, Some(item.cas().into()), b));
-                    }
-                    segcache::Value::U64(v) => {
-                        values.push(Value::new(
-                            item.key(),
-                            flags,
-                            Some(item.cas().into()),
-                            format!("{v}").as_bytes(),
-                        ));
-                    }
-                }
-            } else {
-                values.push(Value::none(key));
-            }
-        }
-        Values::new(values.into_boxed_slice()).into()
+        self.get_many(get.keys(), true)
+    }
+
+    fn gat(&mut self, gat: &Gat) -> Response {
+        self.gat_many(gat.keys(), gat.ttl(), false)
+    }
+
+    fn gats(&mut self, gats: &Gats) -> Response {
+        self.gat_many(gats.keys(), gats.ttl(), true)
     }
 
     fn set(&mut self, set: &Set) -> Response {
@@ -253,12 +770,12 @@ impl Storage for Seg {
         }
     }
 
-    fn append(&mut self, _: &Append) -> Response {
-        Response::error()
+    fn append(&mut self, append: &Append) -> Response {
+        self.extend(append.key(), append.value(), false, append.noreply())
     }
 
-    fn prepend(&mut self, _: &Prepend) -> Response {
-        Response::error()
+    fn prepend(&mut self, prepend: &Prepend) -> Response {
+        self.extend(prepend.key(), prepend.value(), true, prepend.noreply())
     }
 
     fn incr(&mut self, incr: &Incr) -> Response {
@@ -375,6 +892,19 @@ impl Storage for Seg {
         }
     }
 
+    fn touch(&mut self, touch: &Touch) -> Response {
+        // immediate expire maps to a delete
+        let found = match duration(touch.ttl()) {
+            Some(ttl) => self.data.touch(touch.key(), ttl).is_ok(),
+            None => self.data.delete(touch.key()),
+        };
+        if found {
+            Response::touched(touch.noreply())
+        } else {
+            Response::not_found(touch.noreply())
+        }
+    }
+
     fn flush_all(&mut self, _flush_all: &FlushAll) -> Response {
         Response::error()
     }
@@ -382,4 +912,281 @@ impl Storage for Seg {
     fn quit(&mut self, _quit: &Quit) -> Response {
         Response::hangup()
     }
+
+    fn meta_get(&mut self, get: &MetaGet) -> Response {
+        let flags = get.flags();
+
+        let item = if flags.no_bump() {
+            self.data.get_no_freq_incr(get.key())
+        } else {
+            self.data.get(get.key())
+        };
+
+        let item = match item {
+            Some(item) => item,
+            None => {
+                // an item which expired within the stale grace period is
+                // served as stale, and the first client to see it is handed
+                // the lease to recompute it while the others are told that it
+                // has already been won
+                if let Some(item) = self.data.get_stale(get.key()) {
+                    let response = meta_fields(
+                        self.data,
+                        &item,
+                        flags,
+                        Meta::new(MetaCode::Hd, flags, get.key()).stale(),
+                    );
+                    if self.data.lease(get.key()) {
+                        return response.win().into();
+                    } else {
+                        return response.won().into();
+                    }
+                }
+
+                // a miss with autovivify stores an empty item in its place and
+                // hands this client the right to fill it
+                if let Some(ttl) = flags.vivify().and_then(duration) {
+                    let mut buf = [0; 5];
+                    let optional = optional(0, META_WON, &mut buf);
+                    if self
+                        .data
+                        .insert(get.key(), &b""[..], Some(optional), ttl)
+                        .is_ok()
+                    {
+                        return Meta::new(MetaCode::En, flags, get.key()).win().into();
+                    }
+                }
+                return Meta::new(MetaCode::En, flags, get.key()).into();
+            }
+        };
+
+        let mut response = meta_fields(
+            self.data,
+            &item,
+            flags,
+            Meta::new(MetaCode::Hd, flags, get.key()),
+        );
+
+        // a stale item, or one which is about to expire, is recached by the
+        // first client to see it while the others keep being served the
+        // current value
+        let mut state = meta_state(&item);
+        let mut ttl = None;
+        if state & META_STALE != 0 {
+            response = response.stale();
+        }
+        let recache = flags
+            .recache()
+            .and_then(|threshold| {
+                self.data
+                    .ttl(&item)
+                    .map(|ttl| ttl < Duration::from_secs(threshold as u64))
+            })
+            .unwrap_or(false);
+        if state & META_WON != 0 {
+            response = response.won();
+        } else if recache || state & META_STALE != 0 {
+            response = response.win();
+            state |= META_WON;
+            ttl = Some(self.remaining(&item));
+        }
+
+        if let Some(new) = flags.ttl() {
+            match duration(new) {
+                Some(new) => ttl = Some(new),
+                None => {
+                    self.data.delete(get.key());
+                    return response.into();
+                }
+            }
+        }
+
+        if let Some(ttl) = ttl {
+            if self.restore(&item, state, ttl).is_err() {
+                return Response::server_error("");
+            }
+        }
+
+        self.meta_stored(get.key(), flags, response).into()
+    }
+
+    fn meta_set(&mut self, set: &MetaSet) -> Response {
+        let flags = set.flags();
+        let existing = self.data.get_no_freq_incr(set.key());
+
+        match (set.mode(), &existing) {
+            (MetaMode::Add, Some(_))
+            | (MetaMode::Append | MetaMode::Prepend | MetaMode::Replace, None) => {
+                return Meta::new(MetaCode::Ns, flags, set.key()).into();
+            }
+            _ => {}
+        }
+
+        // an invalidating set with an older cas is still stored, but the item
+        // is marked as stale
+        let mut state = 0;
+        if let Some(cas) = flags.compare_cas() {
+            match &existing {
+                None => return Meta::new(MetaCode::Nf, flags, set.key()).into(),
+                Some(item) if u64::from(item.cas()) == cas => {}
+                Some(item) if flags.invalidate() && cas < u64::from(item.cas()) => {
+                    state = META_STALE;
+                }
+                Some(_) => return Meta::new(MetaCode::Ex, flags, set.key()).into(),
+            }
+        }
+
+        let ttl = match flags.ttl().map(duration) {
+            Some(Some(ttl)) => ttl,
+            Some(None) => {
+                // immediate expire maps to a delete
+                self.data.delete(set.key());
+                return Meta::new(MetaCode::Hd, flags, set.key()).into();
+            }
+            None => Duration::from_secs(0),
+        };
+
+        let mut buf = [0; 5];
+        let result = match (set.mode(), existing) {
+            // concatenated values keep the client flags and TTL of the item
+            (MetaMode::Append | MetaMode::Prepend, Some(item)) => {
+                let mut value = Vec::with_capacity(value_len(&item) + set.value().len());
+                match item.value() {
+                    segcache::Value::Bytes(b) => value.extend_from_slice(b),
+                    segcache::Value::U64(v) => value.extend_from_slice(Digits::new(v).as_bytes()),
+                }
+                if set.mode() == MetaMode::Append {
+                    value.extend_from_slice(set.value());
+                } else {
+                    value.splice(0..0, set.value().iter().copied());
+                }
+                let optional = optional(client_flags(&item), state, &mut buf);
+                let ttl = self.remaining(&item);
+                self.store(set.key(), &value, optional, ttl)
+            }
+            _ => {
+                let optional = optional(flags.client_flags().unwrap_or(0), state, &mut buf);
+                self.store(set.key(), set.value(), optional, ttl)
+            }
+        };
+
+        if result.is_err() {
+            return Response::server_error("");
+        }
+
+        let response = Meta::new(MetaCode::Hd, flags, set.key());
+        self.meta_stored(set.key(), flags, response).into()
+    }
+
+    fn meta_delete(&mut self, delete: &MetaDelete) -> Response {
+        let flags = delete.flags();
+
+        let item = match self.data.get_no_freq_incr(delete.key()) {
+            Some(item) => item,
+            None => return Meta::new(MetaCode::Nf, flags, delete.key()).into(),
+        };
+
+        if let Some(cas) = flags.compare_cas() {
+            if u64::from(item.cas()) != cas {
+                return Meta::new(MetaCode::Ex, flags, delete.key()).into();
+            }
+        }
+
+        // an invalidated item is kept as a stale item, so that clients are
+        // served the old value while one of them recaches it
+        let ttl = if flags.invalidate() {
+            match flags.ttl().map(duration) {
+                Some(ttl) => ttl,
+                None => Some(self.remaining(&item)),
+            }
+        } else {
+            None
+        };
+
+        match ttl {
+            Some(ttl) => {
+                if self.restore(&item, META_STALE, ttl).is_err() {
+                    return Response::server_error("");
+                }
+            }
+            None => {
+                self.data.delete(delete.key());
+            }
+        }
+
+        Meta::new(MetaCode::Hd, flags, delete.key()).into()
+    }
+
+    fn meta_arithmetic(&mut self, arithmetic: &MetaArithmetic) -> Response {
+        let flags = arithmetic.flags();
+        let key = arithmetic.key();
+
+        let value = match self.data.get_no_freq_incr(key) {
+            None => {
+                // a miss with autovivify stores the initial value
+                let ttl = match flags.vivify().map(duration) {
+                    Some(Some(ttl)) => ttl,
+                    _ => return Meta::new(MetaCode::Nf, flags, key).into(),
+                };
+                let initial = flags.initial().unwrap_or(0);
+                if self
+                    .data
+                    .insert(key, initial, Some(&0_u32.to_be_bytes()), ttl)
+                    .is_err()
+                {
+                    return Response::server_error("");
+                }
+                initial
+            }
+            Some(item) => {
+                if let Some(cas) = flags.compare_cas() {
+                    if u64::from(item.cas()) != cas {
+                        return Meta::new(MetaCode::Ex, flags, key).into();
+                    }
+                }
+
+                let result = match arithmetic.mode() {
+                    MetaMode::Decr => self.data.saturating_sub(key, arithmetic.delta()),
+                    _ => self.data.wrapping_add(key, arithmetic.delta()),
+                };
+                let item = match result {
+                    Ok(item) => item,
+                    Err(SegcacheError::NotFound) => {
+                        return Meta::new(MetaCode::Nf, flags, key).into()
+                    }
+                    Err(SegcacheError::NotNumeric) => return Response::error(),
+                    Err(_) => return Response::server_error(""),
+                };
+                let value = match item.value() {
+                    segcache::Value::U64(v) => v,
+                    _ => return Response::server_error(""),
+                };
+
+                if let Some(ttl) = flags.ttl().map(duration) {
+                    let result = match ttl {
+                        Some(ttl) => self.restore(&item, meta_state(&item), ttl),
+                        None => {
+                            self.data.delete(key);
+                            Ok(())
+                        }
+                    };
+                    if result.is_err() {
+                        return Response::server_error("");
+                    }
+                }
+
+                value
+            }
+        };
+
+        let mut response = Meta::new(MetaCode::Hd, flags, key);
+        if flags.return_value() {
+            response = response.value(Digits::new(value).as_bytes());
+        }
+        self.meta_stored(key, flags, response).into()
+    }
+
+    fn meta_noop(&mut self, _noop: &MetaNoop) -> Response {
+        Meta::noop().into()
+    }
 }
@@ -7,53 +7,385 @@
 //! See: [`::segcache`] crate for more details behind the underlying storage
 //! design.
 
+use crate::hotkeys::HotkeySampler;
+use crate::prefixes::PrefixCounter;
 use crate::EntryStore;
 
-use config::seg::Eviction;
+use common::signal::Tunables;
+use config::seg::{Eviction, Partition};
 use config::SegConfig;
 use segcache::{Policy, SegcacheError};
 
+use std::collections::HashMap;
+use std::ops::Deref;
+use std::path::PathBuf;
+use std::sync::Arc;
+use std::time::Duration;
+
+mod encoding;
+mod http;
 mod memcache;
+mod partitions;
 mod resp;
+mod snapshot;
+
+use snapshot::Slot;
+
+pub use partitions::{Partitions, PARTITIONS};
+pub use snapshot::{SegmentSnapshots, SEGMENT_SNAPSHOTS};
 
 /// A wrapper around [`seg::Seg`] which implements `EntryStore` and storage
 /// protocol traits.
 pub struct Seg {
     data: segcache::Segcache,
+    snapshots: Slot,
+    hotkeys: HotkeySampler,
+    prefixes: PrefixCounter,
+    // the values which are being read straight into storage, by the id of
+    // their reservation
+    ingests: HashMap<usize, segcache::Ingest>,
+    ingest_id: usize,
+}
+
+/// A wrapper around [`segcache::ShardedSegcache`] which implements
+/// `EntryStore` and storage protocol traits. Unlike [`Seg`], this storage type
+/// is cheap to clone and each clone refers to the same underlying shards, which
+/// allows multiple worker threads to execute requests against storage directly.
+/// Each clone samples hot keys and counts key prefixes on its own.
+#[derive(Clone)]
+pub struct SharedSeg {
+    data: Arc<Shards>,
+    hotkeys: HotkeySampler,
+    prefixes: PrefixCounter,
+}
+
+/// The shards shared by all clones of a [`SharedSeg`]. The shards are
+/// persisted when the last clone is dropped.
+struct Shards(segcache::ShardedSegcache, Slot);
+
+/// A mutable borrow of a single `Segcache` instance. Requests are executed
+/// through this type for both [`Seg`] and the locked shards of [`SharedSeg`].
+pub(crate) struct SegRef<'a> {
+    data: &'a mut segcache::Segcache,
 }
 
 impl Seg {
     /// Create `Seg` storage based on the config and the `TimeType` which is
     /// used to interpret various expiry time formats.
     pub fn new<T: SegConfig>(config: &T) -> Result<Self, std::io::Error> {
-        let config = config.seg();
-
-        // build up the eviction policy from the config
-        let eviction = match config.eviction() {
-            Eviction::None => Policy::None,
-            Eviction::Random => Policy::Random,
-            Eviction::RandomFifo => Policy::RandomFifo,
-            Eviction::Fifo => Policy::Fifo,
-            Eviction::Cte => Policy::Cte,
-            Eviction::Util => Policy::Util,
-            Eviction::Merge => Policy::Merge {
-                max: config.merge_max(),
-                merge: config.merge_target(),
-                compact: config.compact_target(),
-            },
-        };
-
-        // build the datastructure from the config
-        let data = segcache::Segcache::builder()
-            .hash_power(config.hash_power())
-            .overflow_factor(config.overflow_factor())
-            .heap_size(config.heap_size())
-            .segment_size(config.segment_size())
-            .eviction(eviction)
-            .datapool_path(config.datapool_path())
-            .build()?;
-
-        Ok(Self { data })
+        unpartitioned(config)?;
+        let data = builder(config).build()?;
+
+        Ok(Self {
+            data,
+            snapshots: Slot::new(),
+            hotkeys: HotkeySampler::new(config.seg()),
+            prefixes: PrefixCounter::new(config.seg()),
+            ingests: HashMap::new(),
+            ingest_id: 0,
+        })
+    }
+
+    /// Create `Seg` storage split into the provided number of shards, which
+    /// must be a power of two, along with a function which maps each key to
+    /// the index of its shard. Each shard is independent, so that it can be
+    /// owned by its own storage thread. The shards are laid out in the same
+    /// way as those of [`SharedSeg`], including their persisted files.
+    #[allow(clippy::type_complexity)]
+    pub fn shards<T: SegConfig>(
+        config: &T,
+        shards: usize,
+    ) -> Result<(impl Fn(&[u8]) -> usize + Clone + Send + Sync, Vec<Self>), std::io::Error> {
+        unpartitioned(config)?;
+        let (router, data) = builder(config)
+            .shards(shards)
+            .build_sharded()?
+            .into_shards();
+
+        let shards = data
+            .into_iter()
+            .map(|data| Self {
+                data,
+                snapshots: Slot::new(),
+                hotkeys: HotkeySampler::new(config.seg()),
+                prefixes: PrefixCounter::new(config.seg()),
+                ingests: HashMap::new(),
+                ingest_id: 0,
+            })
+            .collect();
+
+        Ok((move |key: &[u8]| router.shard_index(key), shards))
+    }
+}
+
+impl SharedSeg {
+    /// Create `SharedSeg` storage based on the config. The number of shards is
+    /// determined by the `shards` parameter of the config, and each of the
+    /// configured partitions is added with shards of its own.
+    pub fn new<T: SegConfig>(config: &T) -> Result<Self, std::io::Error> {
+        let mut builder = builder(config).shards(config.seg().shards());
+        for partition in config.seg().partitions() {
+            builder = builder.partition(
+                partition.name(),
+                partition.prefix(),
+                partition_builder(config, partition),
+            );
+        }
+        let data = Arc::new(Shards(builder.build_sharded()?, Slot::new()));
+        PARTITIONS.register(&data);
+
+        Ok(Self {
+            data,
+            hotkeys: HotkeySampler::new(config.seg()),
+            prefixes: PrefixCounter::new(config.seg()),
+        })
+    }
+}
+
+/// The bytes of an item which are counted against the prefix of its key.
+fn item_bytes(item: &segcache::Item) -> usize {
+    item.key().len() + item.value().len()
+}
+
+// Helpers shared by the protocol implementations.
+impl SegRef<'_> {
+    /// Returns the remaining TTL of an item, which is at least a second so
+    /// that rewriting an item that is about to expire does not keep it
+    /// forever. Items which do not expire are rewritten without a TTL.
+    fn remaining(&self, item: &segcache::Item) -> Duration {
+        match self.data.ttl(item) {
+            Some(ttl) => ttl.max(Duration::from_secs(1)),
+            None => Duration::ZERO,
+        }
+    }
+
+    /// Returns the remaining TTL of an item in seconds, or `-1` for an item
+    /// which does not expire.
+    fn remaining_secs(&self, item: &segcache::Item) -> i64 {
+        self.data
+            .ttl(item)
+            .map(|ttl| ttl.as_secs() as i64)
+            .unwrap_or(-1)
+    }
+}
+
+/// Values of at least this size are referenced from segment memory rather than
+/// copied into the response. Smaller values are cheaper to copy than to pin,
+/// and compressed values are always copied as they are decompressed on read.
+const PIN_THRESHOLD: usize = 1024;
+
+/// The bytes of a pinned item, which are written directly from segment memory
+/// when the response is composed.
+struct PinnedValue(segcache::PinnedItem);
+
+impl AsRef<[u8]> for PinnedValue {
+    fn as_ref(&self) -> &[u8] {
+        match self.0.value() {
+            segcache::Value::Bytes(b) => b,
+            segcache::Value::U64(_) => unreachable!("numeric values are not pinned"),
+        }
+    }
+}
+
+/// Partitions are only supported by [`SharedSeg`], the other storage types
+/// would silently hold every key in one heap.
+fn unpartitioned<T: SegConfig>(config: &T) -> Result<(), std::io::Error> {
+    if config.seg().partitions().is_empty() {
+        Ok(())
+    } else {
+        Err(std::io::Error::new(
+            std::io::ErrorKind::InvalidInput,
+            "seg partitions require shared storage",
+        ))
+    }
+}
+
+/// Returns the eviction `Policy` for the config.
+fn policy(config: &config::Seg, eviction: Eviction) -> Policy {
+    merge_policy(
+        eviction,
+        config.merge_max(),
+        config.merge_target(),
+        config.compact_target(),
+    )
+}
+
+/// Returns the eviction `Policy` for the tunables reloaded from the config.
+fn reloaded_policy(tunables: &Tunables) -> Option<Policy> {
+    tunables.eviction.map(|eviction| {
+        merge_policy(
+            eviction,
+            tunables.merge_max,
+            tunables.merge_target,
+            tunables.compact_target,
+        )
+    })
+}
+
+/// Returns the eviction `Policy`, with the options used by merge eviction.
+fn merge_policy(eviction: Eviction, max: usize, merge: usize, compact: usize) -> Policy {
+    match eviction {
+        Eviction::None => Policy::None,
+        Eviction::Random => Policy::Random,
+        Eviction::RandomFifo => Policy::RandomFifo,
+        Eviction::Fifo => Policy::Fifo,
+        Eviction::Cte => Policy::Cte,
+        Eviction::Util => Policy::Util,
+        // live bytes and hits weigh the most, age and time to expiry break
+        // ties between segments which are equally live and read
+        Eviction::Score => Policy::Score {
+            samples: 16,
+            hits: 100,
+            age: 25,
+            ttl: 25,
+        },
+        Eviction::S3Fifo => Policy::S3Fifo,
+        Eviction::Merge => Policy::Merge {
+            max,
+            merge,
+            compact,
+        },
+    }
+}
+
+/// Returns the `segcache::HugePages` for the configured page size.
+fn huge_pages(huge_pages: config::seg::HugePages) -> segcache::HugePages {
+    match huge_pages {
+        config::seg::HugePages::Disabled => segcache::HugePages::Disabled,
+        config::seg::HugePages::Transparent => segcache::HugePages::Transparent,
+        config::seg::HugePages::Huge2M => segcache::HugePages::Huge2M,
+        config::seg::HugePages::Huge1G => segcache::HugePages::Huge1G,
+    }
+}
+
+/// Returns a `segcache::Builder` for the provided config.
+fn builder<T: SegConfig>(config: &T) -> segcache::Builder {
+    let config = config.seg();
+    let eviction = policy(config, config.eviction());
+    let exact_ttls: Vec<Duration> = config
+        .exact_ttls()
+        .iter()
+        .map(|ttl| Duration::from_secs(*ttl as u64))
+        .collect();
+
+    // build the datastructure from the config
+    let builder = segcache::Segcache::builder()
+        .hash_power(config.hash_power())
+        .max_hash_power(config.max_hash_power())
+        .overflow_factor(config.overflow_factor())
+        .heap_size(config.heap_size())
+        .segment_size(config.segment_size());
+
+    sized(builder, config, config.heap_size())
+        .eviction(eviction)
+        .datapool_path(config.datapool_path())
+        .numa_node(config.numa_node())
+        .huge_pages(huge_pages(config.huge_pages()))
+        .metadata_path(config.metadata_path())
+        .flash_path(config.flash_path())
+        .flash_size(config.flash_size())
+        .flash_node(config.flash_node())
+        .flash_age(Duration::from_secs(config.flash_age() as u64))
+        .free_reserve(config.free_reserve())
+        .compact_threshold(config.compact_threshold())
+        .large_values(config.large_values())
+        .stale_grace(Duration::from_secs(config.stale_grace() as u64))
+        .lease_ttl(Duration::from_secs(config.lease_ttl() as u64))
+        .namespaces(config.namespaces())
+        .exact_ttls(&exact_ttls)
+        .admission(config.admission_window())
+        .admission_threshold(config.admission_threshold())
+        .mrc(config.mrc_keys())
+        .compression(config.compression_level())
+        .compression_threshold(config.compression_threshold())
+}
+
+/// Applies the sizing for the heap and the expected item size, if the config
+/// has one.
+fn sized(
+    builder: segcache::Builder,
+    config: &config::seg::Seg,
+    heap_size: usize,
+) -> segcache::Builder {
+    let Some(item_size) = config.item_size() else {
+        return builder;
+    };
+
+    let sizing = segcache::Sizing::new(heap_size, item_size);
+    info!(
+        "sized {} byte heap for {} byte items: hash_power {} max_hash_power {} segment_size {}",
+        heap_size, item_size, sizing.hash_power, sizing.max_hash_power, sizing.segment_size
+    );
+    builder
+        .hash_power(sizing.hash_power)
+        .max_hash_power(sizing.max_hash_power)
+        .segment_size(sizing.segment_size)
+}
+
+/// Returns a `segcache::Builder` for a partition, which shares the settings
+/// of the cache other than those the partition overrides. The files of the
+/// partition have its name appended to the paths of the cache.
+fn partition_builder<T: SegConfig>(config: &T, partition: &Partition) -> segcache::Builder {
+    let seg = config.seg();
+    let path = |path: Option<PathBuf>| {
+        path.map(|path| {
+            let mut path = path.into_os_string();
+            path.push(format!(".{}", partition.name()));
+            PathBuf::from(path)
+        })
+    };
+
+    let builder = sized(builder(config), seg, partition.heap_size());
+    let builder = match partition.hash_power() {
+        Some(hash_power) => builder.hash_power(hash_power),
+        None if seg.item_size().is_some() => builder,
+        None => builder.hash_power(seg.hash_power()),
+    };
+
+    builder
+        .heap_size(partition.heap_size())
+        .eviction(policy(seg, partition.eviction().unwrap_or(seg.eviction())))
+        .datapool_path(path(seg.datapool_path()))
+        .metadata_path(path(seg.metadata_path()))
+        .flash_path(path(seg.flash_path()))
+        .shards(partition.shards())
+}
+
+impl Deref for Shards {
+    type Target = segcache::ShardedSegcache;
+
+    fn deref(&self) -> &Self::Target {
+        &self.0
+    }
+}
+
+// Storage is persisted when it is dropped as the worker threads exit, which
+// only happens after a shutdown. A panic may leave the storage inconsistent,
+// so it is never persisted while unwinding.
+
+impl Drop for Seg {
+    fn drop(&mut self) {
+        // values which were still being read are not stored, and their
+        // segments are unpinned before the storage goes away
+        for (_, ingest) in self.ingests.drain() {
+            self.data.abort(ingest);
+        }
+
+        if !std::thread::panicking() {
+            if let Err(e) = self.data.persist() {
+                error!("failed to persist storage: {}", e);
+            }
+        }
+    }
+}
+
+impl Drop for Shards {
+    fn drop(&mut self) {
+        if !std::thread::panicking() {
+            if let Err(e) = self.0.persist() {
+                error!("failed to persist storage: {}", e);
+            }
+        }
     }
 }
 
@@ -62,7 +394,79 @@ impl EntryStore for Seg {
         self.data.expire();
     }
 
+    fn maintain(&mut self) {
+        self.data.expire();
+        self.data.maintain();
+        let data = &mut self.data;
+        self.prefixes.sweep(|cursor, count, f| {
+            data.scan_items(cursor, count, |item| f(item.key(), item_bytes(item)))
+        });
+        self.snapshots.maintain(|| vec![self.data.segment_stats()]);
+    }
+
+    // a flush_all must not stall the requests behind it, so the segments are
+    // reclaimed in the background rather than freed here
     fn clear(&mut self) {
-        self.data.clear();
+        self.data.flush();
+    }
+
+    fn invalidate(&mut self, prefix: &[u8]) {
+        self.data.invalidate_prefix(prefix);
+    }
+
+    fn is_hot(&mut self, key: &[u8]) -> bool {
+        self.hotkeys.is_hot(key)
+    }
+
+    fn reload(&mut self, tunables: &Tunables) {
+        if let Some(policy) = reloaded_policy(tunables) {
+            self.data.set_eviction(policy);
+        }
+    }
+
+    fn export(&mut self, export: &mut crate::Export, dst: &mut Vec<u8>) -> bool {
+        self.data.export(export, dst)
+    }
+
+    fn import(
+        &mut self,
+        data: &[u8],
+        filter: &dyn Fn(&[u8]) -> bool,
+    ) -> Result<usize, std::io::Error> {
+        self.data.import(data, filter)
+    }
+}
+
+impl EntryStore for SharedSeg {
+    fn expire(&mut self) {
+        self.data.expire();
+    }
+
+    fn maintain(&mut self) {
+        self.data.expire();
+        self.data.maintain();
+        let data = &self.data;
+        self.prefixes.sweep(|cursor, count, f| {
+            data.scan_items(cursor, count, |item| f(item.key(), item_bytes(item)))
+        });
+        self.data.1.maintain(|| self.data.segment_stats());
+    }
+
+    fn clear(&mut self) {
+        self.data.flush();
+    }
+
+    // every worker thread receives the invalidation, so items of the prefix
+    // which are stored while the others apply it may be invalidated again
+    fn invalidate(&mut self, prefix: &[u8]) {
+        self.data.invalidate_prefix(prefix);
+    }
+
+    // every worker thread reloads the shared storage, which sets the same
+    // policy on each shard
+    fn reload(&mut self, tunables: &Tunables) {
+        if let Some(policy) = reloaded_policy(tunables) {
+            self.data.set_eviction(policy);
+        }
     }
 }
@@ -0,0 +1,77 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The partitions of the shared caches in the process, which are served by
+//! the admin thread. Unlike segment snapshots, the counters of a partition
+//! are cheap to read, so the admin thread locks each shard briefly to read
+//! them rather than waiting for maintenance.
+
+use super::Shards;
+
+use std::fmt::Write;
+use std::sync::{Arc, Mutex, Weak};
+
+/// The partitions of every shared cache in the process.
+pub static PARTITIONS: Partitions = Partitions::new();
+
+pub struct Partitions {
+    caches: Mutex<Vec<Weak<Shards>>>,
+}
+
+impl Partitions {
+    const fn new() -> Self {
+        Self {
+            caches: Mutex::new(Vec::new()),
+        }
+    }
+
+    /// Adds a cache, which is dropped from the report once the last reference
+    /// to it is dropped.
+    pub(super) fn register(&self, shards: &Arc<Shards>) {
+        let mut caches = self.caches.lock().unwrap();
+        caches.retain(|cache| cache.strong_count() > 0);
+        caches.push(Arc::downgrade(shards));
+    }
+
+    /// Reports the counters and memory of each partition of every cache in the
+    /// format of memcache stats. Caches without partitions are reported as a
+    /// single default partition.
+    pub fn report(&self) -> String {
+        let caches: Vec<Arc<Shards>> = self
+            .caches
+            .lock()
+            .unwrap()
+            .iter()
+            .filter_map(Weak::upgrade)
+            .collect();
+
+        let mut report = String::new();
+        for cache in caches {
+            for p in cache.partitions() {
+                let _ = write!(report, "STAT partition {}", p.name);
+                // the default partition has no prefix
+                if !p.prefix.is_empty() {
+                    let _ = write!(report, " prefix {}", String::from_utf8_lossy(&p.prefix));
+                }
+                let _ = write!(
+                    report,
+                    " shards {} heap {} used {} live_bytes {} live_items {} \
+                     gets {} hits {} misses {} inserts {} deletes {}\r\n",
+                    p.shards.len(),
+                    p.usage.heap,
+                    p.usage.used,
+                    p.usage.live,
+                    p.usage.items,
+                    p.access.gets,
+                    p.access.hits,
+                    p.access.misses(),
+                    p.access.inserts,
+                    p.access.deletes,
+                );
+            }
+        }
+        report.push_str("END\r\n");
+        report
+    }
+}
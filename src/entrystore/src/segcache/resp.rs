@@ -7,47 +7,1557 @@
 
 use super::*;
 
+use crate::segcache::encoding::hash::{self, Hash};
+use crate::segcache::encoding::list::List;
+use crate::segcache::encoding::set as sets;
+use crate::segcache::encoding::zset::{self as zsets, SortedSet};
+
 use protocol_common::*;
 use protocol_resp::*;
 
-use std::time::Duration;
+use std::collections::{HashMap, HashSet as Members};
+use std::ops::Range;
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+/// The error returned when an arithmetic command is applied to a value which
+/// is not an integer, or when the result would overflow.
+const NOT_AN_INTEGER: &str = "ERR value is not an integer or out of range";
+
+/// The error returned when an increment of a sorted set score would give a
+/// score which is not a number, such as by adding infinities of either sign.
+const NOT_A_NUMBER: &str = "ERR resulting score is not a number (NaN)";
+
+/// The error returned when a command is applied to a key which holds a
+/// different type of value.
+const WRONG_TYPE: &str = "WRONGTYPE Operation against a key holding the wrong kind of value";
+
+/// The error returned when a stored data structure cannot be decoded.
+const CORRUPT: &str = "ERR corrupt value";
+
+/// The error returned when a session turns on tracking of its keys, but the
+/// requests are executed by the workers rather than by storage threads, which
+/// are where the keys read by each session are tracked.
+const TRACKING_UNSUPPORTED: &str = "ERR client tracking requires separate storage threads";
+
+/// The number of hashtable buckets visited by a step of a scan when no count
+/// is given, as with Redis.
+const SCAN_COUNT: u64 = 10;
+
+/// The most hashtable buckets visited by a step of a scan, which bounds the
+/// time the storage thread spends on any one step.
+const MAX_SCAN_COUNT: u64 = 1000;
+
+/// Data structures are stored as the value of a single item in a compact
+/// encoding, with their type held in the optional data of the item. Strings
+/// are stored without any optional data.
+const HASH: &[u8] = &[1];
+const LIST: &[u8] = &[2];
+const SET: &[u8] = &[3];
+const ZSET: &[u8] = &[4];
+
+/// The encoding of an empty hash, which a missing key is treated as.
+const EMPTY_HASH: &[u8] = &[0, 0];
 
 impl Execute<Request, Response> for Seg {
+    fn execute(&mut self, request: &Request) -> Response {
+        let response = SegRef {
+            data: &mut self.data,
+        }
+        .execute(request);
+
+        if self.hotkeys.sample() {
+            sample(&self.hotkeys, request, &response);
+        }
+        if self.prefixes.enabled() {
+            count(&self.prefixes, request, &response);
+        }
+
+        response
+    }
+
+    fn execute_batch(&mut self, requests: &[Request], responses: &mut Vec<Response>) {
+        // prefetch the buckets for every key in the batch up front so that the
+        // memory accesses overlap instead of stalling on each request in turn
+        for request in requests {
+            match request {
+                Request::Get(get) => self.data.prefetch(get.key()),
+                Request::Set(set) => self.data.prefetch(set.key()),
+                Request::GetEx(get) => self.data.prefetch(get.key()),
+                Request::IncrBy(incr) => self.data.prefetch(incr.key()),
+                Request::DecrBy(decr) => self.data.prefetch(decr.key()),
+                Request::Expire(expire) => self.data.prefetch(expire.key()),
+                Request::Ttl(ttl) => self.data.prefetch(ttl.key()),
+                Request::HashDelete(r) => self.data.prefetch(r.key()),
+                Request::HashExists(r) => self.data.prefetch(r.key()),
+                Request::HashGet(r) => self.data.prefetch(r.key()),
+                Request::HashGetAll(r) => self.data.prefetch(r.key()),
+                Request::HashIncrBy(r) => self.data.prefetch(r.key()),
+                Request::HashKeys(r) => self.data.prefetch(r.key()),
+                Request::HashLength(r) => self.data.prefetch(r.key()),
+                Request::HashMultiGet(r) => self.data.prefetch(r.key()),
+                Request::HashSet(r) => self.data.prefetch(r.key()),
+                Request::HashValues(r) => self.data.prefetch(r.key()),
+                Request::ListIndex(r) => self.data.prefetch(r.key()),
+                Request::ListLen(r) => self.data.prefetch(r.key()),
+                Request::ListPop(r) => self.data.prefetch(r.key()),
+                Request::ListPopBack(r) => self.data.prefetch(r.key()),
+                Request::ListRange(r) => self.data.prefetch(r.key()),
+                Request::ListPush(r) => self.data.prefetch(r.key()),
+                Request::ListPushBack(r) => self.data.prefetch(r.key()),
+                Request::ListTrim(r) => self.data.prefetch(r.key()),
+                Request::SetAdd(r) => self.data.prefetch(r.key()),
+                Request::SetRem(r) => self.data.prefetch(r.key()),
+                Request::SetMembers(r) => self.data.prefetch(r.key()),
+                Request::SetIsMember(r) => self.data.prefetch(r.key()),
+                Request::SortedSetAdd(r) => self.data.prefetch(r.key()),
+                Request::SortedSetIncrBy(r) => self.data.prefetch(r.key()),
+                Request::SortedSetRange(r) => self.data.prefetch(r.key()),
+                Request::SortedSetRangeByScore(r) => self.data.prefetch(r.key()),
+                Request::SortedSetRank(r) => self.data.prefetch(r.key()),
+                Request::SortedSetRem(r) => self.data.prefetch(r.key()),
+                Request::SetDiff(r) => r.keys().iter().for_each(|k| self.data.prefetch(k)),
+                Request::SetUnion(r) => r.keys().iter().for_each(|k| self.data.prefetch(k)),
+                Request::SetIntersect(r) => r.keys().iter().for_each(|k| self.data.prefetch(k)),
+                Request::MultiGet(get) => get.keys().iter().for_each(|k| self.data.prefetch(k)),
+                Request::Del(del) => del.keys().iter().for_each(|k| self.data.prefetch(k)),
+                Request::Exists(exists) => exists.keys().iter().for_each(|k| self.data.prefetch(k)),
+                Request::MultiSet(set) => {
+                    set.data().iter().for_each(|(k, _)| self.data.prefetch(k))
+                }
+                _ => {}
+            }
+        }
+
+        responses.extend(requests.iter().map(|request| self.execute(request)));
+    }
+}
+
+impl Execute<Request, Response> for SharedSeg {
+    fn execute(&mut self, request: &Request) -> Response {
+        let response = self.dispatch(request);
+
+        if self.hotkeys.sample() {
+            sample(&self.hotkeys, request, &response);
+        }
+        if self.prefixes.enabled() {
+            count(&self.prefixes, request, &response);
+        }
+
+        response
+    }
+}
+
+impl SharedSeg {
+    fn dispatch(&mut self, request: &Request) -> Response {
+        // multi-key requests lock the owning shard for each key in turn, all
+        // other requests are executed while holding the lock for their key
+        let key = match request {
+            Request::Get(get) => get.key(),
+            Request::Set(set) => set.key(),
+            Request::GetEx(get) => get.key(),
+            Request::IncrBy(incr) => incr.key(),
+            Request::DecrBy(decr) => decr.key(),
+            Request::Expire(expire) => expire.key(),
+            Request::Ttl(ttl) => ttl.key(),
+            Request::HashDelete(r) => r.key(),
+            Request::HashExists(r) => r.key(),
+            Request::HashGet(r) => r.key(),
+            Request::HashGetAll(r) => r.key(),
+            Request::HashIncrBy(r) => r.key(),
+            Request::HashKeys(r) => r.key(),
+            Request::HashLength(r) => r.key(),
+            Request::HashMultiGet(r) => r.key(),
+            Request::HashSet(r) => r.key(),
+            Request::HashValues(r) => r.key(),
+            Request::ListIndex(r) => r.key(),
+            Request::ListLen(r) => r.key(),
+            Request::ListPop(r) => r.key(),
+            Request::ListPopBack(r) => r.key(),
+            Request::ListRange(r) => r.key(),
+            Request::ListPush(r) => r.key(),
+            Request::ListPushBack(r) => r.key(),
+            Request::ListTrim(r) => r.key(),
+            Request::SetAdd(r) => r.key(),
+            Request::SetRem(r) => r.key(),
+            Request::SetMembers(r) => r.key(),
+            Request::SetIsMember(r) => r.key(),
+            Request::SortedSetAdd(r) => r.key(),
+            Request::SortedSetIncrBy(r) => r.key(),
+            Request::SortedSetRange(r) => r.key(),
+            Request::SortedSetRangeByScore(r) => r.key(),
+            Request::SortedSetRank(r) => r.key(),
+            Request::SortedSetRem(r) => r.key(),
+            Request::SetDiff(r) => return self.combine(r.keys(), Combine::Diff),
+            Request::SetUnion(r) => return self.combine(r.keys(), Combine::Union),
+            Request::SetIntersect(r) => return self.combine(r.keys(), Combine::Intersect),
+            Request::MultiGet(get) => return self.multi_get(get.keys()),
+            Request::MultiSet(set) => return self.multi_set(set.data()),
+            Request::Del(del) => return self.count(del.keys(), |shard, key| shard.delete(key)),
+            Request::Scan(scan) => return self.scan(scan),
+            Request::Exists(exists) => {
+                return self.count(exists.keys(), |shard, key| {
+                    shard.get_no_freq_incr(key).is_some()
+                })
+            }
+            Request::Hello(r) => return hello(r),
+            Request::ClientTracking(_) => return Response::error(TRACKING_UNSUPPORTED),
+            _ => return Response::error("not supported"),
+        };
+
+        SegRef {
+            data: &mut self.data.shard(key),
+        }
+        .execute(request)
+    }
+
+    fn multi_get(&mut self, keys: &[Arc<[u8]>]) -> Response {
+        let mut values = Vec::with_capacity(keys.len());
+        for key in keys.iter() {
+            match self.data.shard(key).get(key) {
+                Some(item) if is_string(&item) => values.push(bulk_string(&item)),
+                _ => values.push(Response::null()),
+            }
+        }
+        Response::array(values)
+    }
+
+    fn multi_set(&mut self, data: &[(Arc<[u8]>, Arc<[u8]>)]) -> Response {
+        for (key, value) in data.iter() {
+            if self
+                .data
+                .shard(key)
+                .insert(key, &**value, None, Duration::ZERO)
+                .is_err()
+            {
+                return Response::error("not stored");
+            }
+        }
+        Response::simple_string("OK")
+    }
+
+    /// Returns the number of keys for which the operation returns true.
+    fn count(
+        &mut self,
+        keys: &[Arc<[u8]>],
+        op: impl Fn(&mut segcache::Segcache, &[u8]) -> bool,
+    ) -> Response {
+        let count = keys
+            .iter()
+            .filter(|key| op(&mut self.data.shard(key), &key[..]))
+            .count();
+        Response::integer(count as i64)
+    }
+
+    /// Scans the shards in turn, locking only the shard being scanned.
+    fn scan(&mut self, scan: &Scan) -> Response {
+        let mut keys = Vec::new();
+        let cursor = self.data.scan(scan.cursor(), scan_count(scan), &mut keys);
+        scanned(scan, cursor, keys)
+    }
+
+    /// Combines the sets stored at the keys, locking the shard for each key
+    /// in turn.
+    fn combine(&mut self, keys: &[Arc<[u8]>], combine: Combine) -> Response {
+        combine.apply(keys, |key| members_of(&mut self.data.shard(key), key))
+    }
+}
+
+impl Execute<Request, Response> for SegRef<'_> {
     fn execute(&mut self, request: &Request) -> Response {
         match request {
             Request::Get(get) => self.get(get),
             Request::Set(set) => self.set(set),
+            Request::MultiGet(get) => self.multi_get(get),
+            Request::MultiSet(set) => self.multi_set(set),
+            Request::Del(del) => self.del(del),
+            Request::Exists(exists) => self.exists(exists),
+            Request::IncrBy(incr) => self.incr_by(incr),
+            Request::DecrBy(decr) => self.decr_by(decr),
+            Request::Expire(expire) => self.expire(expire),
+            Request::Ttl(ttl) => self.ttl(ttl),
+            Request::Scan(scan) => self.scan(scan),
+            Request::GetEx(get) => self.get_ex(get),
+            Request::HashDelete(r) => self.hash_delete(r),
+            Request::HashExists(r) => self.hash_exists(r),
+            Request::HashGet(r) => self.hash_get(r),
+            Request::HashGetAll(r) => self.hash_get_all(r),
+            Request::HashIncrBy(r) => self.hash_incrby(r),
+            Request::HashKeys(r) => self.hash_keys(r),
+            Request::HashLength(r) => self.hash_length(r),
+            Request::HashMultiGet(r) => self.hash_multi_get(r),
+            Request::HashSet(r) => self.hash_set(r),
+            Request::HashValues(r) => self.hash_values(r),
+            Request::ListIndex(r) => self.list_index(r),
+            Request::ListLen(r) => self.list_len(r),
+            Request::ListPop(r) => self.list_pop(r),
+            Request::ListPopBack(r) => self.list_pop_back(r),
+            Request::ListRange(r) => self.list_range(r),
+            Request::ListPush(r) => self.list_push(r),
+            Request::ListPushBack(r) => self.list_push_back(r),
+            Request::ListTrim(r) => self.list_trim(r),
+            Request::SetAdd(r) => self.set_add(r),
+            Request::SetRem(r) => self.set_rem(r),
+            Request::SetDiff(r) => self.set_diff(r),
+            Request::SetUnion(r) => self.set_union(r),
+            Request::SetIntersect(r) => self.set_intersect(r),
+            Request::SetMembers(r) => self.set_members(r),
+            Request::SetIsMember(r) => self.set_is_member(r),
+            Request::SortedSetAdd(r) => self.sorted_set_add(r),
+            Request::SortedSetIncrBy(r) => self.sorted_set_incrby(r),
+            Request::SortedSetRange(r) => self.sorted_set_range(r),
+            Request::SortedSetRangeByScore(r) => self.sorted_set_range_by_score(r),
+            Request::SortedSetRank(r) => self.sorted_set_rank(r),
+            Request::SortedSetRem(r) => self.sorted_set_rem(r),
+            Request::Hello(r) => hello(r),
+            Request::ClientTracking(_) => Response::error(TRACKING_UNSUPPORTED),
             _ => Response::error("not supported"),
         }
     }
 }
 
-impl Storage for Seg {
-    fn get(&mut self, get: &Get) -> Response {
-        if let Some(item) = self.data.get(get.key()) {
-            match item.value() {
-                segcache::Value::Bytes(b) => Response::bulk_string(b),
-                segcache::Value::U64(v) => Response::bulk_string(format!("{v}").as_bytes()),
+/// Answers a hello with the properties of the server, as a map for RESP3 and as
+/// a flat array of names and values otherwise. The version of the protocol is
+/// not kept for the session, as the responses to all other requests are the
+/// same for both versions.
+fn hello(hello: &Hello) -> Response {
+    let proto = match hello.protover() {
+        None | Some(2) => 2,
+        Some(3) => 3,
+        Some(_) => return Response::error("NOPROTO unsupported protocol version"),
+    };
+
+    let properties = [
+        ("server", Response::bulk_string(b"pelikan")),
+        (
+            "version",
+            Response::bulk_string(env!("CARGO_PKG_VERSION").as_bytes()),
+        ),
+        ("proto", Response::integer(proto)),
+        ("id", Response::integer(0)),
+        ("mode", Response::bulk_string(b"standalone")),
+        ("role", Response::bulk_string(b"master")),
+        ("modules", Response::array(Vec::new())),
+    ];
+
+    if proto == 3 {
+        Response::map(
+            properties
+                .into_iter()
+                .map(|(name, value)| (Response::bulk_string(name.as_bytes()), value))
+                .collect(),
+        )
+    } else {
+        Response::array(
+            properties
+                .into_iter()
+                .flat_map(|(name, value)| [Response::bulk_string(name.as_bytes()), value])
+                .collect(),
+        )
+    }
+}
+
+/// Samples the keys of a request for hot keys, along with the bytes of value
+/// served for each key and the bytes written.
+/// Counts the reads and writes of a request against the prefixes of their
+/// keys. A read is a hit if it found a value, and a write is counted if it
+/// stored one.
+fn count(prefixes: &PrefixCounter, request: &Request, response: &Response) {
+    let hit =
+        |response: &Response| matches!(response, Response::BulkString(s) if s.bytes().is_some());
+    let stored = matches!(response, Response::SimpleString(_));
+
+    match request {
+        Request::Get(get) => prefixes.get(get.key(), hit(response)),
+        Request::GetEx(get) => prefixes.get(get.key(), hit(response)),
+        Request::MultiGet(get) => {
+            if let Response::Array(values) = response {
+                for (key, value) in get.keys().iter().zip(values) {
+                    prefixes.get(key, hit(value));
+                }
+            }
+        }
+        Request::Set(set) if stored => prefixes.set(set.key()),
+        Request::MultiSet(set) if stored => {
+            for (key, _) in set.data() {
+                prefixes.set(key);
+            }
+        }
+        _ => {}
+    }
+}
+
+fn sample(hotkeys: &HotkeySampler, request: &Request, response: &Response) {
+    let (key, written) = match request {
+        Request::MultiGet(get) => {
+            if let Response::Array(values) = response {
+                for (key, value) in get.keys().iter().zip(values) {
+                    hotkeys.record(key, served(value), None);
+                }
+            }
+            return;
+        }
+        Request::MultiSet(set) => {
+            for (key, value) in set.data() {
+                hotkeys.record(key, 0, Some(value.len()));
+            }
+            return;
+        }
+        Request::Del(del) => return record_keys(hotkeys, del.keys()),
+        Request::Exists(exists) => return record_keys(hotkeys, exists.keys()),
+        Request::SetDiff(r) => return record_keys(hotkeys, r.keys()),
+        Request::SetUnion(r) => return record_keys(hotkeys, r.keys()),
+        Request::SetIntersect(r) => return record_keys(hotkeys, r.keys()),
+        Request::Set(set) => (set.key(), Some(set.value().len())),
+        Request::Get(get) => (get.key(), None),
+        Request::GetEx(get) => (get.key(), None),
+        Request::IncrBy(incr) => (incr.key(), None),
+        Request::DecrBy(decr) => (decr.key(), None),
+        Request::Expire(expire) => (expire.key(), None),
+        Request::Ttl(ttl) => (ttl.key(), None),
+        Request::HashDelete(r) => (r.key(), None),
+        Request::HashExists(r) => (r.key(), None),
+        Request::HashGet(r) => (r.key(), None),
+        Request::HashGetAll(r) => (r.key(), None),
+        Request::HashIncrBy(r) => (r.key(), None),
+        Request::HashKeys(r) => (r.key(), None),
+        Request::HashLength(r) => (r.key(), None),
+        Request::HashMultiGet(r) => (r.key(), None),
+        Request::HashSet(r) => (r.key(), None),
+        Request::HashValues(r) => (r.key(), None),
+        Request::ListIndex(r) => (r.key(), None),
+        Request::ListLen(r) => (r.key(), None),
+        Request::ListPop(r) => (r.key(), None),
+        Request::ListPopBack(r) => (r.key(), None),
+        Request::ListRange(r) => (r.key(), None),
+        Request::ListPush(r) => (r.key(), None),
+        Request::ListPushBack(r) => (r.key(), None),
+        Request::ListTrim(r) => (r.key(), None),
+        Request::SetAdd(r) => (r.key(), None),
+        Request::SetRem(r) => (r.key(), None),
+        Request::SetMembers(r) => (r.key(), None),
+        Request::SetIsMember(r) => (r.key(), None),
+        Request::SortedSetAdd(r) => (r.key(), None),
+        Request::SortedSetIncrBy(r) => (r.key(), None),
+        Request::SortedSetRange(r) => (r.key(), None),
+        Request::SortedSetRangeByScore(r) => (r.key(), None),
+        Request::SortedSetRank(r) => (r.key(), None),
+        Request::SortedSetRem(r) => (r.key(), None),
+        _ => return,
+    };
+
+    hotkeys.record(key, served(response), written);
+}
+
+/// Samples the keys of a request which only reports on them.
+fn record_keys(hotkeys: &HotkeySampler, keys: &[Arc<[u8]>]) {
+    for key in keys {
+        hotkeys.record(key, 0, None);
+    }
+}
+
+/// The bytes of the bulk strings in a response.
+fn served(response: &Response) -> usize {
+    match response {
+        Response::BulkString(string) => string.len(),
+        Response::Array(array) => array.into_iter().map(served).sum(),
+        _ => 0,
+    }
+}
+
+/// Returns true if a cache item holds a string rather than a data structure.
+fn is_string(item: &segcache::Item) -> bool {
+    item.optional().map_or(true, |optional| optional.is_empty())
+}
+
+/// Returns the encoded data structure held by a cache item.
+fn encoded(item: &segcache::Item) -> Option<&[u8]> {
+    match item.value() {
+        segcache::Value::Bytes(b) => Some(b),
+        segcache::Value::U64(_) => None,
+    }
+}
+
+/// Returns a view of the hash held by a cache item.
+fn hash_of(item: &segcache::Item) -> Option<Hash<'_>> {
+    encoded(item).and_then(Hash::decode)
+}
+
+/// Returns the members of the set stored at a key, which are copied out so
+/// that several sets can be combined. A missing key is treated as an empty
+/// set.
+fn members_of(data: &mut segcache::Segcache, key: &[u8]) -> Result<Vec<Vec<u8>>, Response> {
+    match data.get(key) {
+        Some(item) if item.optional() == Some(SET) => {
+            match encoded(&item).and_then(sets::Set::decode) {
+                Some(set) => Ok(set.members().into_iter().map(|m| m.into_owned()).collect()),
+                None => Err(Response::error(CORRUPT)),
+            }
+        }
+        Some(_) => Err(Response::error(WRONG_TYPE)),
+        None => Ok(Vec::new()),
+    }
+}
+
+/// The ways in which the sets stored at several keys are combined.
+enum Combine {
+    /// The members of the first set which are in none of the others.
+    Diff,
+    /// The members of any of the sets.
+    Union,
+    /// The members of the first set which are in all of the others.
+    Intersect,
+}
+
+impl Combine {
+    fn apply(
+        &self,
+        keys: &[Arc<[u8]>],
+        mut members: impl FnMut(&[u8]) -> Result<Vec<Vec<u8>>, Response>,
+    ) -> Response {
+        let mut sets = Vec::with_capacity(keys.len());
+        for key in keys {
+            match members(key) {
+                Ok(set) => sets.push(set),
+                Err(response) => return response,
+            }
+        }
+
+        let (first, rest) = match sets.split_first() {
+            Some(split) => split,
+            None => return Response::array(Vec::new()),
+        };
+
+        let result: Vec<&[u8]> = match self {
+            Self::Union => {
+                let mut seen = Members::new();
+                sets.iter()
+                    .flatten()
+                    .map(|m| &m[..])
+                    .filter(|m| seen.insert(*m))
+                    .collect()
             }
+            Self::Diff | Self::Intersect => {
+                let rest: Vec<Members<&[u8]>> = rest
+                    .iter()
+                    .map(|set| set.iter().map(|m| &m[..]).collect())
+                    .collect();
+                let keep = matches!(self, Self::Intersect);
+                first
+                    .iter()
+                    .map(|m| &m[..])
+                    .filter(|m| {
+                        if keep {
+                            rest.iter().all(|set| set.contains(m))
+                        } else {
+                            !rest.iter().any(|set| set.contains(m))
+                        }
+                    })
+                    .collect()
+            }
+        };
+
+        Response::array(result.into_iter().map(Response::bulk_string).collect())
+    }
+}
+
+/// Converts an inclusive range of list indices, which count back from the end
+/// of the list when negative, into the range of positions it covers within a
+/// list of `len` elements.
+fn positions(start: i64, stop: i64, len: usize) -> Range<usize> {
+    let len = len as i64;
+    let start = if start < 0 {
+        (start + len).max(0)
+    } else {
+        start
+    };
+    let stop = if stop < 0 {
+        stop + len
+    } else {
+        stop.min(len - 1)
+    };
+    if start > stop {
+        0..0
+    } else {
+        (start as usize)..((stop + 1) as usize)
+    }
+}
+
+/// The response holding the members of a sorted set, each followed by its
+/// score when the scores are asked for.
+fn scored<'a>(entries: impl Iterator<Item = (&'a [u8], f64)>, with_scores: bool) -> Response {
+    let mut values = Vec::new();
+    for (member, score) in entries {
+        values.push(Response::bulk_string(member));
+        if with_scores {
+            values.push(Response::bulk_string(format_score(score).as_bytes()));
+        }
+    }
+    Response::array(values)
+}
+
+/// Converts a cache item into a bulk string holding its value.
+/// The number of buckets for a step of a scan.
+fn scan_count(scan: &Scan) -> usize {
+    scan.count().unwrap_or(SCAN_COUNT).min(MAX_SCAN_COUNT) as usize
+}
+
+/// The response to a step of a scan, holding the cursor to continue from and
+/// the keys which match the pattern.
+fn scanned(scan: &Scan, cursor: u64, keys: Vec<Box<[u8]>>) -> Response {
+    let keys = keys
+        .iter()
+        .filter(|key| scan.matches(key))
+        .map(|key| Response::bulk_string(key))
+        .collect();
+    Response::array(vec![
+        Response::bulk_string(cursor.to_string().as_bytes()),
+        Response::array(keys),
+    ])
+}
+
+fn bulk_string(item: &segcache::Item) -> Response {
+    match item.value() {
+        segcache::Value::Bytes(b) => Response::bulk_string(b),
+        segcache::Value::U64(v) => Response::bulk_string(Digits::new(v).as_bytes()),
+    }
+}
+
+/// Returns the value of a cache item as a signed integer, if it is one.
+fn integer(item: &segcache::Item) -> Option<i64> {
+    match item.value() {
+        segcache::Value::Bytes(b) => std::str::from_utf8(b).ok()?.parse().ok(),
+        segcache::Value::U64(v) => i64::try_from(v).ok(),
+    }
+}
+
+/// Converts the expiry of a request into the TTL to store an item for. `Seg`
+/// storage keeps TTLs in whole seconds, so the TTL is rounded up to ensure that
+/// a short expiry is not mistaken for no expiry. Returns `None` for an expiry
+/// which has already passed.
+fn duration(expire_time: ExpireTime) -> Option<Duration> {
+    let now = || {
+        SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .unwrap_or_default()
+    };
+
+    let ttl = match expire_time {
+        ExpireTime::Seconds(s) => Duration::from_secs(s),
+        ExpireTime::Milliseconds(ms) => Duration::from_millis(ms),
+        ExpireTime::UnixSeconds(s) => Duration::from_secs(s)
+            .checked_sub(now())
+            .filter(|ttl| !ttl.is_zero())?,
+        ExpireTime::UnixMilliseconds(ms) => Duration::from_millis(ms)
+            .checked_sub(now())
+            .filter(|ttl| !ttl.is_zero())?,
+        ExpireTime::KeepTtl => Duration::ZERO,
+    };
+
+    Some(Duration::from_secs(
+        ttl.as_secs() + u64::from(ttl.subsec_nanos() > 0),
+    ))
+}
+
+impl SegRef<'_> {
+    /// Looks up the data structure of a type stored at a key, returning an
+    /// error response if the key holds another type.
+    fn typed(&mut self, key: &[u8], tag: &[u8]) -> Result<Option<segcache::Item>, Response> {
+        match self.data.get(key) {
+            Some(item) if item.optional() == Some(tag) => Ok(Some(item)),
+            Some(_) => Err(Response::error(WRONG_TYPE)),
+            None => Ok(None),
+        }
+    }
+
+    /// Stores an encoded data structure, keeping the TTL of the item it
+    /// replaces.
+    fn store_encoded(
+        &mut self,
+        key: &[u8],
+        item: Option<&segcache::Item>,
+        tag: &[u8],
+        value: &[u8],
+    ) -> Result<(), SegcacheError> {
+        let ttl = item
+            .map(|item| self.remaining(item))
+            .unwrap_or(Duration::ZERO);
+        self.data.insert(key, value, Some(tag), ttl)
+    }
+
+    /// Looks up the hash stored at a key, returning an error response if the
+    /// key holds another type.
+    fn hash(&mut self, key: &[u8]) -> Result<Option<segcache::Item>, Response> {
+        self.typed(key, HASH)
+    }
+
+    /// Executes a read of the hash stored at a key. A missing key is treated
+    /// as an empty hash.
+    fn read_hash(&mut self, key: &[u8], read: impl FnOnce(&Hash) -> Response) -> Response {
+        match self.hash(key) {
+            Ok(Some(item)) => match hash_of(&item) {
+                Some(hash) => read(&hash),
+                None => Response::error(CORRUPT),
+            },
+            Ok(None) => read(&Hash::decode(EMPTY_HASH).unwrap()),
+            Err(response) => response,
+        }
+    }
+
+    /// Stores a hash, keeping the TTL of the item it replaces. An empty hash
+    /// is removed.
+    fn store_hash(
+        &mut self,
+        key: &[u8],
+        item: Option<&segcache::Item>,
+        pairs: &[(&[u8], &[u8])],
+    ) -> Result<(), SegcacheError> {
+        if pairs.is_empty() {
+            self.data.delete(key);
+            return Ok(());
+        }
+
+        self.store_encoded(key, item, HASH, &hash::encode(pairs))
+    }
+
+    /// Executes a read of the list stored at a key. A missing key is treated
+    /// as an empty list.
+    fn read_list(&mut self, key: &[u8], read: impl FnOnce(&List) -> Response) -> Response {
+        match self.typed(key, LIST) {
+            Ok(Some(item)) => match encoded(&item).and_then(List::decode) {
+                Some(list) => read(&list),
+                None => Response::error(CORRUPT),
+            },
+            Ok(None) => read(&List::default()),
+            Err(response) => response,
+        }
+    }
+
+    /// Stores a list, keeping the TTL of the item it replaces. An empty list
+    /// is removed.
+    fn store_list(
+        &mut self,
+        key: &[u8],
+        item: Option<&segcache::Item>,
+        list: &List,
+    ) -> Result<(), SegcacheError> {
+        if list.len() == 0 {
+            self.data.delete(key);
+            return Ok(());
+        }
+
+        self.store_encoded(key, item, LIST, &list.encode())
+    }
+
+    /// Adds elements to the front or the back of the list stored at a key,
+    /// returning the length of the list.
+    fn push(&mut self, key: &[u8], elements: &[Arc<[u8]>], back: bool) -> Response {
+        let item = match self.typed(key, LIST) {
+            Ok(item) => item,
+            Err(response) => return response,
+        };
+        let mut list = match &item {
+            Some(item) => match encoded(item).and_then(List::decode) {
+                Some(list) => list,
+                None => return Response::error(CORRUPT),
+            },
+            None => List::default(),
+        };
+
+        let elements: Vec<&[u8]> = elements.iter().map(|e| &e[..]).collect();
+        if back {
+            list.push_back(&elements);
+        } else {
+            list.push_front(&elements);
+        }
+
+        if self.store_list(key, item.as_ref(), &list).is_ok() {
+            Response::integer(list.len() as i64)
+        } else {
+            Response::error("not stored")
+        }
+    }
+
+    /// Removes elements from the front or the back of the list stored at a
+    /// key. Without a count a single element is returned, otherwise an array
+    /// of up to that many elements.
+    fn pop(&mut self, key: &[u8], count: Option<u64>, back: bool) -> Response {
+        let item = match self.typed(key, LIST) {
+            Ok(Some(item)) => item,
+            Ok(None) if count.is_some() => return Response::null_array(),
+            Ok(None) => return Response::null(),
+            Err(response) => return response,
+        };
+        let mut list = match encoded(&item).and_then(List::decode) {
+            Some(list) => list,
+            None => return Response::error(CORRUPT),
+        };
+
+        let len = list.len();
+        let n = count.map_or(1, |count| count.min(len as u64) as usize);
+        let (popped, kept) = if back {
+            ((len - n)..len, 0..(len - n))
+        } else {
+            (0..n, n..len)
+        };
+
+        let mut elements: Vec<Response> = list.range(popped).map(Response::bulk_string).collect();
+        if back {
+            elements.reverse();
+        }
+
+        list.trim(kept);
+        if self.store_list(key, Some(&item), &list).is_err() {
+            return Response::error("not stored");
+        }
+
+        match count {
+            Some(_) => Response::array(elements),
+            None => elements.pop().unwrap_or_else(Response::null),
+        }
+    }
+
+    /// Executes a read of the set stored at a key. A missing key is treated as
+    /// an empty set.
+    fn read_set(&mut self, key: &[u8], read: impl FnOnce(&sets::Set) -> Response) -> Response {
+        match self.typed(key, SET) {
+            Ok(Some(item)) => match encoded(&item).and_then(sets::Set::decode) {
+                Some(set) => read(&set),
+                None => Response::error(CORRUPT),
+            },
+            Ok(None) => read(&sets::Set::decode(sets::EMPTY).unwrap()),
+            Err(response) => response,
+        }
+    }
+
+    /// Executes a read of the sorted set stored at a key. A missing key is
+    /// treated as an empty sorted set.
+    fn read_zset(&mut self, key: &[u8], read: impl FnOnce(&SortedSet) -> Response) -> Response {
+        match self.typed(key, ZSET) {
+            Ok(Some(item)) => match encoded(&item).and_then(SortedSet::decode) {
+                Some(zset) => read(&zset),
+                None => Response::error(CORRUPT),
+            },
+            Ok(None) => read(&SortedSet::decode(zsets::EMPTY).unwrap()),
+            Err(response) => response,
+        }
+    }
+
+    /// Updates the scores of members of the sorted set stored at a key, as
+    /// for [`SortedSet::update`], and stores it if it changed. Returns the
+    /// number of members which were added and the number whose score changed.
+    fn update_zset(
+        &mut self,
+        key: &[u8],
+        members: &[(f64, &[u8])],
+        score: impl FnMut(Option<f64>, f64) -> Option<f64>,
+    ) -> Result<(usize, usize), Response> {
+        let item = self.typed(key, ZSET)?;
+        let zset = match &item {
+            Some(item) => match encoded(item).and_then(SortedSet::decode) {
+                Some(zset) => zset,
+                None => return Err(Response::error(CORRUPT)),
+            },
+            None => SortedSet::decode(zsets::EMPTY).unwrap(),
+        };
+
+        match zset.update(members, score) {
+            Some((value, added, changed)) => {
+                if self
+                    .store_encoded(key, item.as_ref(), ZSET, &value)
+                    .is_err()
+                {
+                    return Err(Response::error("not stored"));
+                }
+                Ok((added, changed))
+            }
+            None => Ok((0, 0)),
+        }
+    }
+
+    /// Writes a new value for a field of a hash in place, which is possible
+    /// when the length of the value is unchanged. Returns false if the hash
+    /// must be stored again instead.
+    fn overwrite_field(
+        &mut self,
+        key: &[u8],
+        item: &segcache::Item,
+        field: &[u8],
+        value: &[u8],
+    ) -> bool {
+        match hash_of(item).and_then(|hash| hash.find(field)) {
+            Some((offset, old)) if old.len() == value.len() => {
+                self.data.overwrite(key, offset, value).is_ok()
+            }
+            _ => false,
+        }
+    }
+
+    /// Adds a signed amount to the integer stored at a key. Values which are
+    /// already stored as unsigned integers are updated in place.
+    fn increment(&mut self, key: &[u8], delta: Option<i64>) -> Response {
+        let item = self.data.get(key);
+
+        let current = match &item {
+            Some(item) if !is_string(item) => return Response::error(WRONG_TYPE),
+            Some(item) => match integer(item) {
+                Some(current) => current,
+                None => return Response::error(NOT_AN_INTEGER),
+            },
+            None => 0,
+        };
+
+        let value = match delta.and_then(|delta| current.checked_add(delta)) {
+            Some(value) => value,
+            None => return Response::error(NOT_AN_INTEGER),
+        };
+
+        let ttl = match &item {
+            Some(item) if value >= 0 => {
+                if let segcache::Value::U64(_) = item.value() {
+                    let result = if value >= current {
+                        self.data.wrapping_add(key, (value - current) as u64)
+                    } else {
+                        self.data.saturating_sub(key, (current - value) as u64)
+                    };
+                    if result.is_ok() {
+                        return Response::integer(value);
+                    }
+                }
+                self.remaining(item)
+            }
+            Some(item) => self.remaining(item),
+            None => Duration::ZERO,
+        };
+
+        let result = if value >= 0 {
+            self.data.insert(key, value as u64, None, ttl)
+        } else {
+            self.data
+                .insert(key, Digits::signed(value).as_bytes(), None, ttl)
+        };
+
+        if result.is_ok() {
+            Response::integer(value)
         } else {
-            Response::null()
+            Response::error("not stored")
+        }
+    }
+}
+
+impl Storage for SegRef<'_> {
+    fn get(&mut self, get: &Get) -> Response {
+        match self.data.get(get.key()) {
+            Some(item) if is_string(&item) => bulk_string(&item),
+            Some(_) => Response::error(WRONG_TYPE),
+            None => Response::null(),
         }
     }
 
     fn set(&mut self, set: &Set) -> Response {
-        let ttl = match set.expire_time().unwrap_or_default() {
-            ExpireTime::Seconds(n) => n,
-            _ => 0,
+        let ttl = match set.expire_time() {
+            None => Some(Duration::ZERO),
+            Some(ExpireTime::KeepTtl) => Some(
+                self.data
+                    .get_no_freq_incr(set.key())
+                    .map(|item| self.remaining(&item))
+                    .unwrap_or(Duration::ZERO),
+            ),
+            Some(expire_time) => duration(expire_time),
+        };
+
+        let ttl = match ttl {
+            Some(ttl) => ttl,
+            None => {
+                // an expiry in the past maps to a delete
+                self.data.delete(set.key());
+                return Response::simple_string("OK");
+            }
         };
 
-        if self
+        if self.data.insert(set.key(), set.value(), None, ttl).is_ok() {
+            Response::simple_string("OK")
+        } else {
+            Response::error("not stored")
+        }
+    }
+
+    fn multi_get(&mut self, get: &MultiGet) -> Response {
+        let values = self
             .data
-            .insert(set.key(), set.value(), None, Duration::from_secs(ttl))
-            .is_ok()
+            .get_many(get.keys())
+            .iter()
+            .map(|item| match item {
+                Some(item) if is_string(item) => bulk_string(item),
+                _ => Response::null(),
+            })
+            .collect();
+
+        Response::array(values)
+    }
+
+    fn multi_set(&mut self, set: &MultiSet) -> Response {
+        for (key, value) in set.data().iter() {
+            if self
+                .data
+                .insert(key, &**value, None, Duration::ZERO)
+                .is_err()
+            {
+                return Response::error("not stored");
+            }
+        }
+
+        Response::simple_string("OK")
+    }
+
+    fn del(&mut self, del: &Del) -> Response {
+        let count = del
+            .keys()
+            .iter()
+            .filter(|key| self.data.delete(key))
+            .count();
+
+        Response::integer(count as i64)
+    }
+
+    fn exists(&mut self, exists: &Exists) -> Response {
+        let count = exists
+            .keys()
+            .iter()
+            .filter(|key| self.data.get_no_freq_incr(key).is_some())
+            .count();
+
+        Response::integer(count as i64)
+    }
+
+    fn incr_by(&mut self, incr: &IncrBy) -> Response {
+        self.increment(incr.key(), Some(incr.increment()))
+    }
+
+    fn decr_by(&mut self, decr: &DecrBy) -> Response {
+        self.increment(decr.key(), decr.decrement().checked_neg())
+    }
+
+    fn expire(&mut self, expire: &Expire) -> Response {
+        if expire.seconds() <= 0 {
+            return Response::integer(self.data.delete(expire.key()) as i64);
+        }
+
+        // the item is given its new TTL without being copied
+        match self
+            .data
+            .touch(expire.key(), Duration::from_secs(expire.seconds() as u64))
         {
+            Ok(_) => Response::integer(1),
+            Err(SegcacheError::NotFound) => Response::integer(0),
+            Err(_) => Response::error("not stored"),
+        }
+    }
+
+    fn ttl(&mut self, ttl: &Ttl) -> Response {
+        match self.data.get_no_freq_incr(ttl.key()) {
+            Some(item) => Response::integer(self.remaining_secs(&item)),
+            None => Response::integer(-2),
+        }
+    }
+
+    fn scan(&mut self, scan: &Scan) -> Response {
+        let mut keys = Vec::new();
+        let cursor = self.data.scan(scan.cursor(), scan_count(scan), &mut keys);
+        scanned(scan, cursor, keys)
+    }
+
+    fn get_ex(&mut self, get: &GetEx) -> Response {
+        let item = match self.data.get(get.key()) {
+            Some(item) if is_string(&item) => item,
+            Some(_) => return Response::error(WRONG_TYPE),
+            None => return Response::null(),
+        };
+
+        let response = bulk_string(&item);
+
+        let ttl = if get.persist() {
+            Some(Duration::ZERO)
+        } else {
+            match get.expire_time() {
+                Some(expire_time) => duration(expire_time),
+                None => return response,
+            }
+        };
+
+        match ttl {
+            Some(ttl) => {
+                if self.data.touch(get.key(), ttl).is_err() {
+                    return Response::error("not stored");
+                }
+            }
+            None => {
+                self.data.delete(get.key());
+            }
+        }
+
+        response
+    }
+
+    fn hash_delete(&mut self, delete: &HashDelete) -> Response {
+        let item = match self.hash(delete.key()) {
+            Ok(Some(item)) => item,
+            Ok(None) => return Response::integer(0),
+            Err(response) => return response,
+        };
+        let hash = match hash_of(&item) {
+            Some(hash) => hash,
+            None => return Response::error(CORRUPT),
+        };
+
+        let pairs: Vec<(&[u8], &[u8])> = hash
+            .iter()
+            .filter(|(field, _)| !delete.fields().iter().any(|f| &f[..] == *field))
+            .collect();
+
+        let removed = hash.len() - pairs.len();
+        if removed > 0 && self.store_hash(delete.key(), Some(&item), &pairs).is_err() {
+            return Response::error("not stored");
+        }
+
+        Response::integer(removed as i64)
+    }
+
+    fn hash_exists(&mut self, exists: &HashExists) -> Response {
+        self.read_hash(exists.key(), |hash| {
+            Response::integer(hash.get(exists.field()).is_some() as i64)
+        })
+    }
+
+    fn hash_get(&mut self, get: &HashGet) -> Response {
+        self.read_hash(get.key(), |hash| match hash.get(get.field()) {
+            Some(value) => Response::bulk_string(value),
+            None => Response::null(),
+        })
+    }
+
+    fn hash_get_all(&mut self, get: &HashGetAll) -> Response {
+        self.read_hash(get.key(), |hash| {
+            let mut values = Vec::with_capacity(hash.len() * 2);
+            for (field, value) in hash.iter() {
+                values.push(Response::bulk_string(field));
+                values.push(Response::bulk_string(value));
+            }
+            Response::array(values)
+        })
+    }
+
+    fn hash_incrby(&mut self, incr: &HashIncrBy) -> Response {
+        let item = match self.hash(incr.key()) {
+            Ok(item) => item,
+            Err(response) => return response,
+        };
+        let hash = match &item {
+            Some(item) => match hash_of(item) {
+                Some(hash) => hash,
+                None => return Response::error(CORRUPT),
+            },
+            None => Hash::decode(EMPTY_HASH).unwrap(),
+        };
+
+        let current = match hash.get(incr.field()) {
+            Some(value) => match std::str::from_utf8(value).ok().and_then(|s| s.parse().ok()) {
+                Some(current) => current,
+                None => return Response::error("ERR hash value is not an integer"),
+            },
+            None => 0_i64,
+        };
+        let value = match current.checked_add(incr.increment()) {
+            Some(value) => value,
+            None => return Response::error("ERR increment or decrement would overflow"),
+        };
+        let digits = Digits::signed(value);
+
+        if let Some(item) = &item {
+            if self.overwrite_field(incr.key(), item, incr.field(), digits.as_bytes()) {
+                return Response::integer(value);
+            }
+        }
+
+        let mut pairs: Vec<(&[u8], &[u8])> = hash.iter().collect();
+        match pairs.iter_mut().find(|(field, _)| *field == incr.field()) {
+            Some(pair) => pair.1 = digits.as_bytes(),
+            None => pairs.push((incr.field(), digits.as_bytes())),
+        }
+
+        if self.store_hash(incr.key(), item.as_ref(), &pairs).is_ok() {
+            Response::integer(value)
+        } else {
+            Response::error("not stored")
+        }
+    }
+
+    fn hash_keys(&mut self, keys: &HashKeys) -> Response {
+        self.read_hash(keys.key(), |hash| {
+            Response::array(hash.iter().map(|(f, _)| Response::bulk_string(f)).collect())
+        })
+    }
+
+    fn hash_length(&mut self, length: &HashLength) -> Response {
+        self.read_hash(length.key(), |hash| Response::integer(hash.len() as i64))
+    }
+
+    fn hash_multi_get(&mut self, get: &HashMultiGet) -> Response {
+        self.read_hash(get.key(), |hash| {
+            Response::array(
+                get.fields()
+                    .iter()
+                    .map(|field| match hash.get(field) {
+                        Some(value) => Response::bulk_string(value),
+                        None => Response::null(),
+                    })
+                    .collect(),
+            )
+        })
+    }
+
+    fn hash_set(&mut self, set: &HashSet) -> Response {
+        let item = match self.hash(set.key()) {
+            Ok(item) => item,
+            Err(response) => return response,
+        };
+
+        // a single field which keeps the length of its value is changed in
+        // place rather than storing the whole hash again
+        if let (Some(item), [(field, value)]) = (&item, set.data()) {
+            if self.overwrite_field(set.key(), item, field, value) {
+                return Response::integer(0);
+            }
+        }
+
+        let mut pairs: Vec<(&[u8], &[u8])> = match &item {
+            Some(item) => match hash_of(item) {
+                Some(hash) => hash.iter().collect(),
+                None => return Response::error(CORRUPT),
+            },
+            None => Vec::with_capacity(set.data().len()),
+        };
+
+        let mut positions: HashMap<&[u8], usize> = pairs
+            .iter()
+            .enumerate()
+            .map(|(i, (field, _))| (*field, i))
+            .collect();
+        let mut added = 0;
+        for (field, value) in set.data() {
+            match positions.get(&field[..]) {
+                Some(i) => pairs[*i].1 = value,
+                None => {
+                    positions.insert(field, pairs.len());
+                    pairs.push((field, value));
+                    added += 1;
+                }
+            }
+        }
+
+        if self.store_hash(set.key(), item.as_ref(), &pairs).is_ok() {
+            Response::integer(added)
+        } else {
+            Response::error("not stored")
+        }
+    }
+
+    fn hash_values(&mut self, values: &HashValues) -> Response {
+        self.read_hash(values.key(), |hash| {
+            Response::array(hash.iter().map(|(_, v)| Response::bulk_string(v)).collect())
+        })
+    }
+
+    fn list_index(&mut self, index: &ListIndex) -> Response {
+        self.read_list(index.key(), |list| {
+            let len = list.len() as i64;
+            let i = if index.index() < 0 {
+                index.index() + len
+            } else {
+                index.index()
+            };
+            match (0..len)
+                .contains(&i)
+                .then(|| list.get(i as usize))
+                .flatten()
+            {
+                Some(element) => Response::bulk_string(element),
+                None => Response::null(),
+            }
+        })
+    }
+
+    fn list_len(&mut self, len: &ListLen) -> Response {
+        self.read_list(len.key(), |list| Response::integer(list.len() as i64))
+    }
+
+    fn list_pop(&mut self, pop: &ListPop) -> Response {
+        self.pop(pop.key(), pop.count(), false)
+    }
+
+    fn list_pop_back(&mut self, pop: &ListPopBack) -> Response {
+        self.pop(pop.key(), pop.count(), true)
+    }
+
+    fn list_range(&mut self, range: &ListRange) -> Response {
+        self.read_list(range.key(), |list| {
+            let positions = positions(range.start(), range.stop(), list.len());
+            Response::array(list.range(positions).map(Response::bulk_string).collect())
+        })
+    }
+
+    fn list_push(&mut self, push: &ListPush) -> Response {
+        self.push(push.key(), push.elements(), false)
+    }
+
+    fn list_push_back(&mut self, push: &ListPushBack) -> Response {
+        self.push(push.key(), push.elements(), true)
+    }
+
+    fn list_trim(&mut self, trim: &ListTrim) -> Response {
+        let item = match self.typed(trim.key(), LIST) {
+            Ok(Some(item)) => item,
+            Ok(None) => return Response::simple_string("OK"),
+            Err(response) => return response,
+        };
+        let mut list = match encoded(&item).and_then(List::decode) {
+            Some(list) => list,
+            None => return Response::error(CORRUPT),
+        };
+
+        let len = list.len();
+        let positions = positions(trim.start(), trim.stop(), len);
+        if positions.len() == len {
+            return Response::simple_string("OK");
+        }
+
+        list.trim(positions);
+        if self.store_list(trim.key(), Some(&item), &list).is_ok() {
             Response::simple_string("OK")
         } else {
             Response::error("not stored")
         }
     }
+
+    fn set_add(&mut self, add: &SetAdd) -> Response {
+        let item = match self.typed(add.key(), SET) {
+            Ok(item) => item,
+            Err(response) => return response,
+        };
+        let set = match &item {
+            Some(item) => match encoded(item).and_then(sets::Set::decode) {
+                Some(set) => set,
+                None => return Response::error(CORRUPT),
+            },
+            None => sets::Set::decode(sets::EMPTY).unwrap(),
+        };
+
+        let members: Vec<&[u8]> = add.members().iter().map(|m| &m[..]).collect();
+        let (value, added) = set.insert(&members);
+        if added > 0
+            && self
+                .store_encoded(add.key(), item.as_ref(), SET, &value)
+                .is_err()
+        {
+            return Response::error("not stored");
+        }
+
+        Response::integer(added as i64)
+    }
+
+    fn set_rem(&mut self, rem: &SetRem) -> Response {
+        let item = match self.typed(rem.key(), SET) {
+            Ok(Some(item)) => item,
+            Ok(None) => return Response::integer(0),
+            Err(response) => return response,
+        };
+        let set = match encoded(&item).and_then(sets::Set::decode) {
+            Some(set) => set,
+            None => return Response::error(CORRUPT),
+        };
+
+        let members: Vec<&[u8]> = rem.members().iter().map(|m| &m[..]).collect();
+        let (value, removed) = set.remove(&members);
+        if removed == set.len() {
+            // an empty set is removed
+            self.data.delete(rem.key());
+        } else if removed > 0
+            && self
+                .store_encoded(rem.key(), Some(&item), SET, &value)
+                .is_err()
+        {
+            return Response::error("not stored");
+        }
+
+        Response::integer(removed as i64)
+    }
+
+    fn set_diff(&mut self, diff: &SetDiff) -> Response {
+        Combine::Diff.apply(diff.keys(), |key| members_of(self.data, key))
+    }
+
+    fn set_union(&mut self, union: &SetUnion) -> Response {
+        Combine::Union.apply(union.keys(), |key| members_of(self.data, key))
+    }
+
+    fn set_intersect(&mut self, intersect: &SetIntersect) -> Response {
+        Combine::Intersect.apply(intersect.keys(), |key| members_of(self.data, key))
+    }
+
+    fn set_members(&mut self, members: &SetMembers) -> Response {
+        self.read_set(members.key(), |set| {
+            Response::array(
+                set.members()
+                    .iter()
+                    .map(|m| Response::bulk_string(m))
+                    .collect(),
+            )
+        })
+    }
+
+    fn set_is_member(&mut self, is_member: &SetIsMember) -> Response {
+        self.read_set(is_member.key(), |set| {
+            Response::integer(set.contains(is_member.field()) as i64)
+        })
+    }
+
+    fn sorted_set_add(&mut self, add: &SortedSetAdd) -> Response {
+        let members: Vec<(f64, &[u8])> = add.members().iter().map(|(s, m)| (*s, &m[..])).collect();
+
+        // the score of the member for INCR, and whether it would become NaN
+        let mut incremented = None;
+        let mut nan = false;
+        let counts = self.update_zset(add.key(), &members, |current, score| {
+            let new = match current {
+                Some(_) if add.nx() => return None,
+                None if add.xx() => return None,
+                Some(current) if add.incr() => current + score,
+                _ => score,
+            };
+            if new.is_nan() {
+                nan = true;
+                return None;
+            }
+            if let Some(current) = current {
+                if (add.gt() && new <= current) || (add.lt() && new >= current) {
+                    return None;
+                }
+            }
+            incremented = Some(new);
+            Some(new)
+        });
+
+        let (added, changed) = match counts {
+            Ok(counts) => counts,
+            Err(response) => return response,
+        };
+        if nan {
+            return Response::error(NOT_A_NUMBER);
+        }
+
+        if add.incr() {
+            return match incremented {
+                Some(score) => Response::bulk_string(format_score(score).as_bytes()),
+                None => Response::null(),
+            };
+        }
+        if add.ch() {
+            Response::integer((added + changed) as i64)
+        } else {
+            Response::integer(added as i64)
+        }
+    }
+
+    fn sorted_set_incrby(&mut self, incr: &SortedSetIncrBy) -> Response {
+        let mut incremented = None;
+        let counts = self.update_zset(
+            incr.key(),
+            &[(incr.increment(), incr.member())],
+            |current, increment| {
+                let new = current.unwrap_or(0.0) + increment;
+                incremented = Some(new);
+                (!new.is_nan()).then_some(new)
+            },
+        );
+
+        if let Err(response) = counts {
+            return response;
+        }
+        match incremented {
+            Some(score) if score.is_nan() => Response::error(NOT_A_NUMBER),
+            Some(score) => Response::bulk_string(format_score(score).as_bytes()),
+            None => Response::error(CORRUPT),
+        }
+    }
+
+    fn sorted_set_range(&mut self, range: &SortedSetRange) -> Response {
+        self.read_zset(range.key(), |zset| {
+            let len = zset.len();
+            let positions = positions(range.start(), range.stop(), len);
+            if range.rev() {
+                // ranks from the highest score are mapped onto ranks from the
+                // lowest, and the members are returned in reverse
+                let positions = (len - positions.end)..(len - positions.start);
+                let entries: Vec<(&[u8], f64)> = zset.range(positions).collect();
+                scored(entries.into_iter().rev(), range.with_scores())
+            } else {
+                scored(zset.range(positions), range.with_scores())
+            }
+        })
+    }
+
+    fn sorted_set_range_by_score(&mut self, range: &SortedSetRangeByScore) -> Response {
+        self.read_zset(range.key(), |zset| {
+            let (min, max) = (range.min(), range.max());
+            let (offset, count) = match range.limit() {
+                Some((offset, count)) => (
+                    usize::try_from(offset).unwrap_or(usize::MAX),
+                    usize::try_from(count).unwrap_or(usize::MAX),
+                ),
+                None => (0, usize::MAX),
+            };
+
+            let start = zset
+                .first(|score| min.admits_above(score))
+                .saturating_add(offset);
+            let entries = zset
+                .range(start..zset.len())
+                .take_while(|(_, score)| max.admits_below(*score))
+                .take(count);
+            scored(entries, range.with_scores())
+        })
+    }
+
+    fn sorted_set_rank(&mut self, rank: &SortedSetRank) -> Response {
+        self.read_zset(rank.key(), |zset| match zset.rank(rank.member()) {
+            Some(position) => Response::integer(position as i64),
+            None => Response::null(),
+        })
+    }
+
+    fn sorted_set_rem(&mut self, rem: &SortedSetRem) -> Response {
+        let item = match self.typed(rem.key(), ZSET) {
+            Ok(Some(item)) => item,
+            Ok(None) => return Response::integer(0),
+            Err(response) => return response,
+        };
+        let zset = match encoded(&item).and_then(SortedSet::decode) {
+            Some(zset) => zset,
+            None => return Response::error(CORRUPT),
+        };
+
+        let members: Vec<&[u8]> = rem.members().iter().map(|m| &m[..]).collect();
+        let (value, removed) = zset.remove(&members);
+        if removed == zset.len() {
+            // an empty sorted set is removed
+            self.data.delete(rem.key());
+        } else if removed > 0
+            && self
+                .store_encoded(rem.key(), Some(&item), ZSET, &value)
+                .is_err()
+        {
+            return Response::error("not stored");
+        }
+
+        Response::integer(removed as i64)
+    }
 }
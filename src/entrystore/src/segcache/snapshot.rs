@@ -0,0 +1,248 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Snapshots of the segments of each cache, which are served by the admin
+//! thread. A cache is only ever touched by the threads executing requests
+//! against it, so the admin thread asks for new snapshots, and each cache
+//! takes one during its next maintenance, between batches of requests. Caches
+//! which are not asked for a snapshot only check an atomic counter during
+//! maintenance.
+
+use segcache::{
+    mean_item_size, HashtableInfo, SegmentStats, Sizing, TtlBucketInfo, UTILIZATION_BUCKETS,
+};
+
+use std::collections::BTreeMap;
+use std::fmt::Write;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Mutex;
+use std::time::{Duration, Instant};
+
+/// The snapshots of every cache in the process.
+pub static SEGMENT_SNAPSHOTS: SegmentSnapshots = SegmentSnapshots::new();
+
+/// How often the admin thread checks whether the caches took their snapshots.
+const POLL_INTERVAL: Duration = Duration::from_millis(1);
+
+pub struct SegmentSnapshots {
+    /// incremented by each request for new snapshots
+    requested: AtomicU64,
+    /// the last snapshot of each cache, and the request it was taken for
+    slots: Mutex<Vec<Option<(u64, Vec<SegmentStats>)>>>,
+}
+
+impl SegmentSnapshots {
+    const fn new() -> Self {
+        Self {
+            requested: AtomicU64::new(0),
+            slots: Mutex::new(Vec::new()),
+        }
+    }
+
+    /// Asks every cache for a new snapshot and waits up to `timeout` for them
+    /// to be taken, then reports the segments of all caches in the format of
+    /// memcache stats. Caches which did not take a snapshot in time, such as
+    /// those whose threads are busy, are reported from their last one, and
+    /// counted in `segment_snapshot_stale`.
+    pub fn report(&self, timeout: Duration) -> String {
+        let request = self.requested.fetch_add(1, Ordering::AcqRel) + 1;
+        let deadline = Instant::now() + timeout;
+
+        loop {
+            {
+                let slots = self.slots.lock().unwrap();
+                let pending = slots
+                    .iter()
+                    .flatten()
+                    .filter(|(taken, _)| *taken < request)
+                    .count();
+                if pending == 0 || Instant::now() >= deadline {
+                    return format_report(&slots, pending);
+                }
+            }
+            std::thread::sleep(POLL_INTERVAL);
+        }
+    }
+}
+
+/// Where a cache publishes its snapshots, the slot is removed when the cache
+/// is dropped.
+pub(crate) struct Slot {
+    index: usize,
+    /// the last request a snapshot was taken for
+    taken: AtomicU64,
+}
+
+impl Slot {
+    pub(crate) fn new() -> Self {
+        let mut slots = SEGMENT_SNAPSHOTS.slots.lock().unwrap();
+        let index = match slots.iter().position(|slot| slot.is_none()) {
+            Some(index) => index,
+            None => {
+                slots.push(None);
+                slots.len() - 1
+            }
+        };
+        slots[index] = Some((0, Vec::new()));
+
+        Self {
+            index,
+            taken: AtomicU64::new(0),
+        }
+    }
+
+    /// Takes a snapshot of the shards of the cache if one was asked for since
+    /// the last one was taken.
+    pub(crate) fn maintain(&self, snapshot: impl FnOnce() -> Vec<SegmentStats>) {
+        let request = SEGMENT_SNAPSHOTS.requested.load(Ordering::Acquire);
+        let taken = self.taken.load(Ordering::Relaxed);
+        if request == taken
+            || self
+                .taken
+                .compare_exchange(taken, request, Ordering::AcqRel, Ordering::Relaxed)
+                .is_err()
+        {
+            // up to date, or another thread is taking the snapshot
+            return;
+        }
+
+        let stats = snapshot();
+        SEGMENT_SNAPSHOTS.slots.lock().unwrap()[self.index] = Some((request, stats));
+    }
+}
+
+impl Drop for Slot {
+    fn drop(&mut self) {
+        if let Ok(mut slots) = SEGMENT_SNAPSHOTS.slots.lock() {
+            slots[self.index] = None;
+        }
+    }
+}
+
+fn format_report(slots: &[Option<(u64, Vec<SegmentStats>)>], stale: usize) -> String {
+    let mut segments = 0;
+    let mut free = 0;
+    let mut utilization = [0; UTILIZATION_BUCKETS];
+    let mut buckets = BTreeMap::new();
+    let mut lines = String::new();
+
+    // the hashtables and items of all shards, which are sized as one cache
+    let mut hash_slots: usize = 0;
+    let mut hashtable = HashtableInfo::default();
+    let mut heap_size = 0;
+    let mut live_bytes = 0;
+    let mut live_items = 0;
+
+    // shards are numbered across all caches
+    for (shard, stats) in slots
+        .iter()
+        .flatten()
+        .flat_map(|(_, stats)| stats)
+        .enumerate()
+    {
+        segments += stats.segments.len();
+        free += stats.free();
+        hash_slots += 1 << stats.hashtable.power;
+        hashtable.item_slots += stats.hashtable.item_slots;
+        hashtable.overflow_used += stats.hashtable.overflow_used;
+        hashtable.overflow_buckets += stats.hashtable.overflow_buckets;
+        heap_size += stats.segment_size * stats.segments.len();
+        for (total, count) in utilization.iter_mut().zip(stats.utilization()) {
+            *total += count;
+        }
+        for bucket in stats.ttl_buckets() {
+            let total = buckets.entry(bucket.ttl).or_insert(TtlBucketInfo {
+                ttl: bucket.ttl,
+                ..Default::default()
+            });
+            total.segments += bucket.segments;
+            total.written += bucket.written;
+            total.live_bytes += bucket.live_bytes;
+            total.live_items += bucket.live_items;
+            total.merges += bucket.merges;
+            live_bytes += bucket.live_bytes;
+            live_items += bucket.live_items;
+        }
+        for s in stats.segments.iter().filter(|s| !s.is_free()) {
+            let _ = write!(
+                lines,
+                "STAT segment {}:{} ttl {} age {} merge_age {} write_offset {} \
+                 live_bytes {} live_items {} merges {} accessible {} evictable {}\r\n",
+                shard,
+                s.id,
+                s.ttl,
+                s.age,
+                s.merge_age,
+                s.write_offset,
+                s.live_bytes,
+                s.live_items,
+                s.merges,
+                s.accessible as u8,
+                s.evictable as u8,
+            );
+        }
+    }
+
+    let mut report = String::new();
+    let _ = write!(report, "STAT segments {}\r\n", segments);
+    let _ = write!(report, "STAT segments_free {}\r\n", free);
+    let _ = write!(report, "STAT segment_snapshot_stale {}\r\n", stale);
+    for (i, count) in utilization.iter().enumerate() {
+        let _ = write!(
+            report,
+            "STAT segment_utilization_{}_{} {}\r\n",
+            i * 100 / UTILIZATION_BUCKETS,
+            (i + 1) * 100 / UTILIZATION_BUCKETS,
+            count
+        );
+    }
+    if hash_slots > 0 {
+        let _ = write!(report, "STAT hash_power {}\r\n", hash_slots.ilog2());
+    }
+    let _ = write!(report, "STAT hash_item_slots {}\r\n", hashtable.item_slots);
+    let _ = write!(
+        report,
+        "STAT hash_overflow_used {}\r\n",
+        hashtable.overflow_used
+    );
+    let _ = write!(
+        report,
+        "STAT hash_overflow_buckets {}\r\n",
+        hashtable.overflow_buckets
+    );
+    if hashtable.item_slots > 0 {
+        let _ = write!(
+            report,
+            "STAT hash_load_pct {}\r\n",
+            live_items * 100 / hashtable.item_slots
+        );
+    }
+    // the sizing which the items held call for, to compare with the one the
+    // cache was configured with
+    if let Some(item_size) = mean_item_size(live_bytes, live_items) {
+        let sizing = Sizing::new(heap_size, item_size);
+        let _ = write!(report, "STAT item_size_mean {}\r\n", item_size);
+        let _ = write!(report, "STAT sizing_hash_power {}\r\n", sizing.hash_power);
+        let _ = write!(
+            report,
+            "STAT sizing_max_hash_power {}\r\n",
+            sizing.max_hash_power
+        );
+        let _ = write!(
+            report,
+            "STAT sizing_segment_size {}\r\n",
+            sizing.segment_size
+        );
+    }
+    for b in buckets.values() {
+        let _ = write!(
+            report,
+            "STAT ttl_bucket {} segments {} written {} live_bytes {} live_items {} merges {}\r\n",
+            b.ttl, b.segments, b.written, b.live_bytes, b.live_items, b.merges,
+        );
+    }
+    report.push_str(&lines);
+    report.push_str("END\r\n");
+    report
+}
@@ -0,0 +1,206 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! A latency histogram with HDR-style log-linear buckets. Values below
+//! `2^(GROUPING_POWER + 1)` each get their own bucket, and every power of two
+//! above that is split into `2^GROUPING_POWER` buckets, so a value is reported
+//! within `1 / 2^GROUPING_POWER` of what was recorded.
+//!
+//! One thread records into a histogram while others may read it, each bucket
+//! being updated with a relaxed atomic add.
+
+use std::sync::atomic::{AtomicU64, Ordering};
+
+// values are reported within 1/128 (< 1%) of the recorded value
+const GROUPING_POWER: u32 = 7;
+// values, in nanoseconds, are recorded up to ~18 minutes
+const MAX_VALUE_POWER: u32 = 40;
+
+const LINEAR: usize = 1 << (GROUPING_POWER + 1);
+const BUCKETS: usize =
+    LINEAR + (((MAX_VALUE_POWER - GROUPING_POWER - 1) as usize) << GROUPING_POWER);
+
+pub const MAX_VALUE: u64 = (1 << MAX_VALUE_POWER) - 1;
+
+fn index(value: u64) -> usize {
+    let value = value.min(MAX_VALUE);
+
+    if (value as usize) < LINEAR {
+        return value as usize;
+    }
+
+    let power = 63 - value.leading_zeros();
+    let shift = power - GROUPING_POWER;
+
+    LINEAR
+        + (((power - GROUPING_POWER - 1) as usize) << GROUPING_POWER)
+        + ((value >> shift) as usize - (1 << GROUPING_POWER))
+}
+
+/// The highest value which is recorded into the bucket with `index`.
+fn upper_bound(index: usize) -> u64 {
+    if index < LINEAR {
+        return index as u64;
+    }
+
+    let offset = index - LINEAR;
+    let power = (offset >> GROUPING_POWER) as u32 + GROUPING_POWER + 1;
+    let mantissa = (offset & ((1 << GROUPING_POWER) - 1)) as u64 + (1 << GROUPING_POWER);
+    let shift = power - GROUPING_POWER;
+
+    ((mantissa + 1) << shift) - 1
+}
+
+pub struct Histogram {
+    buckets: Box<[AtomicU64]>,
+}
+
+impl Default for Histogram {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Histogram {
+    pub fn new() -> Self {
+        Self {
+            buckets: (0..BUCKETS).map(|_| AtomicU64::new(0)).collect(),
+        }
+    }
+
+    /// Record a value, values above `MAX_VALUE` are recorded as `MAX_VALUE`.
+    pub fn increment(&self, value: u64) {
+        self.buckets[index(value)].fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// A copy of the current counts, which can be merged with and compared
+    /// to the counts of other histograms.
+    pub fn snapshot(&self) -> Snapshot {
+        Snapshot {
+            counts: self
+                .buckets
+                .iter()
+                .map(|b| b.load(Ordering::Relaxed))
+                .collect(),
+        }
+    }
+}
+
+#[derive(Clone)]
+pub struct Snapshot {
+    counts: Vec<u64>,
+}
+
+impl Default for Snapshot {
+    fn default() -> Self {
+        Self {
+            counts: vec![0; BUCKETS],
+        }
+    }
+}
+
+impl Snapshot {
+    pub fn count(&self) -> u64 {
+        self.counts.iter().sum()
+    }
+
+    /// Add the counts of another snapshot.
+    pub fn merge(&mut self, other: &Snapshot) {
+        for (a, b) in self.counts.iter_mut().zip(other.counts.iter()) {
+            *a += b;
+        }
+    }
+
+    /// The counts recorded since an earlier snapshot of the same histograms.
+    pub fn since(&self, earlier: &Snapshot) -> Snapshot {
+        Snapshot {
+            counts: self
+                .counts
+                .iter()
+                .zip(earlier.counts.iter())
+                .map(|(a, b)| a.saturating_sub(*b))
+                .collect(),
+        }
+    }
+
+    /// The upper bound of the bucket holding each of the percentiles, which
+    /// must be sorted and within 0.0..=100.0. Returns `None` if nothing was
+    /// recorded.
+    pub fn percentiles(&self, percentiles: &[f64]) -> Option<Vec<u64>> {
+        let total = self.count();
+        if total == 0 {
+            return None;
+        }
+
+        let mut result = Vec::with_capacity(percentiles.len());
+        let mut seen = 0;
+        let mut percentiles = percentiles.iter().peekable();
+
+        for (index, count) in self.counts.iter().enumerate() {
+            seen += count;
+            while let Some(p) = percentiles.peek() {
+                let needed = ((**p / 100.0) * total as f64).ceil().max(1.0) as u64;
+                if seen < needed {
+                    break;
+                }
+                result.push(upper_bound(index));
+                percentiles.next();
+            }
+        }
+
+        Some(result)
+    }
+
+    /// The non-empty buckets, as their upper bound and count.
+    pub fn buckets(&self) -> impl Iterator<Item = (u64, u64)> + '_ {
+        self.counts
+            .iter()
+            .enumerate()
+            .filter(|(_, count)| **count > 0)
+            .map(|(index, count)| (upper_bound(index), *count))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn buckets() {
+        // every value lands in a bucket whose upper bound is at or above it,
+        // and within the resolution
+        for value in (0..1_000_000).chain([MAX_VALUE - 1, MAX_VALUE]) {
+            let index = index(value);
+            assert!(index < BUCKETS);
+            let upper = upper_bound(index);
+            assert!(upper >= value, "{value} {upper}");
+            assert!(upper - value <= value >> GROUPING_POWER, "{value} {upper}");
+            if index > 0 {
+                assert!(upper_bound(index - 1) < value);
+            }
+        }
+        assert_eq!(index(u64::MAX), BUCKETS - 1);
+    }
+
+    #[test]
+    fn percentiles() {
+        let histogram = Histogram::new();
+        assert!(histogram.snapshot().percentiles(&[50.0]).is_none());
+
+        for value in 1..=100 {
+            histogram.increment(value);
+        }
+        let snapshot = histogram.snapshot();
+        assert_eq!(snapshot.count(), 100);
+        assert_eq!(
+            snapshot.percentiles(&[0.0, 50.0, 99.0, 100.0]),
+            Some(vec![1, 50, 99, 100])
+        );
+
+        histogram.increment(1000);
+        let window = histogram.snapshot().since(&snapshot);
+        assert_eq!(window.count(), 1);
+        assert_eq!(window.percentiles(&[50.0]), Some(vec![1003]));
+    }
+}
@@ -0,0 +1,529 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! A load generator for Pelikan servers speaking the Memcache ASCII or RESP
+//! protocol, to measure their throughput and latency in-tree without an
+//! external benchmarking tool.
+//!
+//! Each connection runs on its own thread and keeps up to `--pipeline`
+//! requests in flight. With `--rate`, requests are sent open-loop: each one is
+//! scheduled ahead of time, and its latency is measured from when it was due
+//! to be sent, not from when it was sent. A server that falls behind is then
+//! charged for the time requests spent waiting to go out, instead of slowing
+//! down the load and hiding its stalls (coordinated omission). Without a rate,
+//! connections send closed-loop, as fast as responses come back.
+//!
+//! Latencies are recorded in log-linear histograms, reported as percentiles
+//! every `--interval` and for the whole run, and optionally written out in
+//! full with `--histogram`.
+
+mod histogram;
+mod protocol;
+
+use crate::histogram::{Histogram, Snapshot};
+use crate::protocol::{Protocol, Response};
+
+use clap::{value_parser, Arg, ArgAction, Command};
+use rand::{Rng, SeedableRng};
+use rand_xoshiro::Xoshiro256PlusPlus;
+
+use std::collections::VecDeque;
+use std::io::{ErrorKind, Read, Write};
+use std::net::TcpStream;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+// the percentiles reported
+const PERCENTILES: &[(&str, f64)] = &[
+    ("p50", 50.0),
+    ("p90", 90.0),
+    ("p99", 99.0),
+    ("p999", 99.9),
+    ("p9999", 99.99),
+    ("max", 100.0),
+];
+
+// how long to wait for the responses still in flight once the run is over
+const DRAIN_TIMEOUT: Duration = Duration::from_secs(5);
+
+// how long a read waits when there's nothing to send in the meantime
+const READ_TIMEOUT: Duration = Duration::from_millis(100);
+
+const BUFFER_SIZE: usize = 1024 * 1024;
+
+struct Config {
+    endpoint: String,
+    protocol: Protocol,
+    connections: usize,
+    pipeline: usize,
+    rate: u64,
+    duration: Duration,
+    interval: Duration,
+    keys: u64,
+    klen: usize,
+    vlen: usize,
+    get_pct: u64,
+    prefill: bool,
+    histogram: Option<String>,
+}
+
+impl Config {
+    // the time between two requests sent on one connection, when open-loop
+    fn request_interval(&self) -> Option<Duration> {
+        if self.rate == 0 {
+            None
+        } else {
+            Some(Duration::from_secs_f64(
+                self.connections as f64 / self.rate as f64,
+            ))
+        }
+    }
+
+    fn key(&self, id: u64) -> String {
+        format!("{:01$}", id, self.klen)
+    }
+}
+
+/// Counts of one connection, which are read by the reporting thread.
+#[derive(Default)]
+struct Stats {
+    sent: AtomicU64,
+    hit: AtomicU64,
+    miss: AtomicU64,
+    stored: AtomicU64,
+    error: AtomicU64,
+    latency: Histogram,
+}
+
+impl Stats {
+    fn record(&self, response: Response) {
+        match response {
+            Response::Hit => &self.hit,
+            Response::Miss => &self.miss,
+            Response::Stored => &self.stored,
+            Response::Error => &self.error,
+        }
+        .fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// Counts of all connections at one point in time.
+#[derive(Clone, Default)]
+struct Totals {
+    sent: u64,
+    hit: u64,
+    miss: u64,
+    stored: u64,
+    error: u64,
+    latency: Snapshot,
+}
+
+impl Totals {
+    fn collect(stats: &[Arc<Stats>]) -> Self {
+        let mut totals = Self::default();
+        for s in stats {
+            totals.sent += s.sent.load(Ordering::Relaxed);
+            totals.hit += s.hit.load(Ordering::Relaxed);
+            totals.miss += s.miss.load(Ordering::Relaxed);
+            totals.stored += s.stored.load(Ordering::Relaxed);
+            totals.error += s.error.load(Ordering::Relaxed);
+            totals.latency.merge(&s.latency.snapshot());
+        }
+        totals
+    }
+
+    fn since(&self, earlier: &Totals) -> Self {
+        Self {
+            sent: self.sent - earlier.sent,
+            hit: self.hit - earlier.hit,
+            miss: self.miss - earlier.miss,
+            stored: self.stored - earlier.stored,
+            error: self.error - earlier.error,
+            latency: self.latency.since(&earlier.latency),
+        }
+    }
+
+    fn report(&self, label: &str, elapsed: Duration) {
+        let responses = self.hit + self.miss + self.stored + self.error;
+        let gets = self.hit + self.miss;
+        let hit_ratio = if gets == 0 {
+            0.0
+        } else {
+            100.0 * self.hit as f64 / gets as f64
+        };
+
+        let mut line = format!(
+            "{label}: sent {} responses {} ({:.0}/s) hit {:.2}% errors {}",
+            self.sent,
+            responses,
+            responses as f64 / elapsed.as_secs_f64(),
+            hit_ratio,
+            self.error,
+        );
+
+        let percentiles: Vec<f64> = PERCENTILES.iter().map(|(_, p)| *p).collect();
+        if let Some(values) = self.latency.percentiles(&percentiles) {
+            line.push_str(" latency (us)");
+            for ((name, _), value) in PERCENTILES.iter().zip(values) {
+                line.push_str(&format!(" {name} {:.1}", value as f64 / 1000.0));
+            }
+        }
+
+        println!("{line}");
+    }
+}
+
+/// Reads from the stream into `buf` after the `len` bytes it already holds,
+/// waiting at most `timeout`, and returns the new length.
+fn read(
+    stream: &mut TcpStream,
+    buf: &mut Vec<u8>,
+    len: usize,
+    timeout: Duration,
+) -> std::io::Result<usize> {
+    if len == buf.len() {
+        buf.resize(buf.len() * 2, 0);
+    }
+
+    // a zero timeout is rejected, and means blocking forever
+    stream.set_read_timeout(Some(timeout.max(Duration::from_micros(1))))?;
+
+    match stream.read(&mut buf[len..]) {
+        Ok(0) => Err(ErrorKind::UnexpectedEof.into()),
+        Ok(n) => Ok(len + n),
+        Err(e) if e.kind() == ErrorKind::WouldBlock || e.kind() == ErrorKind::TimedOut => Ok(len),
+        Err(e) => Err(e),
+    }
+}
+
+/// Sets every key once, with this connection taking one in `connections`.
+fn prefill(config: &Config, id: usize) -> std::io::Result<()> {
+    let mut stream = TcpStream::connect(&config.endpoint)?;
+    stream.set_nodelay(true)?;
+
+    let value = vec![b'A'; config.vlen];
+    let mut wbuf = Vec::new();
+    let mut rbuf = vec![0; BUFFER_SIZE];
+    let mut rlen = 0;
+
+    let keys: Vec<u64> = (id as u64..config.keys)
+        .step_by(config.connections)
+        .collect();
+
+    for batch in keys.chunks(config.pipeline) {
+        for key in batch {
+            config
+                .protocol
+                .set(&mut wbuf, config.key(*key).as_bytes(), &value);
+        }
+        stream.write_all(&wbuf)?;
+        wbuf.clear();
+
+        let mut pending = batch.len();
+        while pending > 0 {
+            rlen = read(&mut stream, &mut rbuf, rlen, READ_TIMEOUT)?;
+            let mut offset = 0;
+            while let Some((_, len)) = config.protocol.parse(&rbuf[offset..rlen]) {
+                offset += len;
+                pending -= 1;
+            }
+            rbuf.copy_within(offset..rlen, 0);
+            rlen -= offset;
+        }
+    }
+
+    Ok(())
+}
+
+/// Sends requests on one connection until `end`, then waits for the ones
+/// still in flight.
+fn run(
+    config: &Config,
+    id: usize,
+    stats: &Stats,
+    start: Instant,
+    end: Instant,
+) -> std::io::Result<()> {
+    let mut stream = TcpStream::connect(&config.endpoint)?;
+    stream.set_nodelay(true)?;
+
+    let mut rng = Xoshiro256PlusPlus::seed_from_u64(id as u64);
+    let value = vec![b'A'; config.vlen];
+    let mut wbuf = Vec::new();
+    let mut rbuf = vec![0; BUFFER_SIZE];
+    let mut rlen = 0;
+
+    // when each request in flight was due to be sent
+    let mut inflight: VecDeque<Instant> = VecDeque::with_capacity(config.pipeline);
+
+    // the first requests of the connections are spread over one interval
+    let interval = config.request_interval();
+    let mut next = start
+        + interval
+            .map(|i| i.mul_f64(id as f64 / config.connections as f64))
+            .unwrap_or_default();
+
+    loop {
+        let now = Instant::now();
+
+        if now >= end && (inflight.is_empty() || now >= end + DRAIN_TIMEOUT) {
+            return Ok(());
+        }
+
+        while inflight.len() < config.pipeline && now < end {
+            let due = match interval {
+                Some(interval) => {
+                    if next > now {
+                        break;
+                    }
+                    let due = next;
+                    next += interval;
+                    due
+                }
+                None => now,
+            };
+
+            let key = config.key(rng.gen_range(0..config.keys));
+            if rng.gen_range(0..100) < config.get_pct {
+                config.protocol.get(&mut wbuf, key.as_bytes());
+            } else {
+                config.protocol.set(&mut wbuf, key.as_bytes(), &value);
+            }
+            inflight.push_back(due);
+            stats.sent.fetch_add(1, Ordering::Relaxed);
+        }
+
+        if !wbuf.is_empty() {
+            stream.write_all(&wbuf)?;
+            wbuf.clear();
+        }
+
+        // wait for responses, but no longer than until the next request is
+        // due if there is room for it
+        let timeout = match interval {
+            Some(_) if inflight.len() < config.pipeline && now < end => {
+                next.saturating_duration_since(Instant::now())
+            }
+            _ => READ_TIMEOUT,
+        };
+
+        if inflight.is_empty() {
+            std::thread::sleep(timeout);
+            continue;
+        }
+
+        rlen = read(&mut stream, &mut rbuf, rlen, timeout)?;
+
+        let now = Instant::now();
+        let mut offset = 0;
+        while let Some((response, len)) = config.protocol.parse(&rbuf[offset..rlen]) {
+            offset += len;
+            let due = inflight.pop_front().ok_or_else(|| {
+                std::io::Error::new(ErrorKind::InvalidData, "unexpected response")
+            })?;
+            stats
+                .latency
+                .increment(now.duration_since(due).as_nanos() as u64);
+            stats.record(response);
+        }
+        rbuf.copy_within(offset..rlen, 0);
+        rlen -= offset;
+    }
+}
+
+fn config() -> Config {
+    let matches = Command::new(env!("CARGO_BIN_NAME"))
+        .version(env!("CARGO_PKG_VERSION"))
+        .long_about(
+            "A load generator for Pelikan servers. It opens many connections, \
+            pipelines requests on each of them, and can send at a fixed rate \
+            to measure latency without coordinated omission.",
+        )
+        .arg(
+            Arg::new("ENDPOINT")
+                .help("Server address")
+                .default_value("127.0.0.1:12321")
+                .index(1),
+        )
+        .arg(
+            Arg::new("protocol")
+                .long("protocol")
+                .help("Protocol spoken by the server")
+                .value_parser(["memcache", "resp"])
+                .default_value("memcache"),
+        )
+        .arg(
+            Arg::new("connections")
+                .short('c')
+                .long("connections")
+                .help("Number of connections, each on its own thread")
+                .value_parser(value_parser!(usize))
+                .default_value("16"),
+        )
+        .arg(
+            Arg::new("pipeline")
+                .short('p')
+                .long("pipeline")
+                .help("Max number of requests in flight on each connection")
+                .value_parser(value_parser!(usize))
+                .default_value("1"),
+        )
+        .arg(
+            Arg::new("rate")
+                .short('r')
+                .long("rate")
+                .help("Requests per second across all connections, 0 to send as fast as possible")
+                .value_parser(value_parser!(u64))
+                .default_value("0"),
+        )
+        .arg(
+            Arg::new("duration")
+                .short('d')
+                .long("duration")
+                .help("Duration of the run in seconds")
+                .value_parser(value_parser!(u64))
+                .default_value("60"),
+        )
+        .arg(
+            Arg::new("interval")
+                .short('i')
+                .long("interval")
+                .help("Reporting interval in seconds")
+                .value_parser(value_parser!(u64))
+                .default_value("10"),
+        )
+        .arg(
+            Arg::new("keys")
+                .long("keys")
+                .help("Number of keys, picked uniformly")
+                .value_parser(value_parser!(u64))
+                .default_value("1000000"),
+        )
+        .arg(
+            Arg::new("klen")
+                .long("klen")
+                .help("Key length in bytes")
+                .value_parser(value_parser!(usize))
+                .default_value("16"),
+        )
+        .arg(
+            Arg::new("vlen")
+                .long("vlen")
+                .help("Value length in bytes")
+                .value_parser(value_parser!(usize))
+                .default_value("64"),
+        )
+        .arg(
+            Arg::new("get")
+                .long("get")
+                .help("Percentage of requests that are gets, the others are sets")
+                .value_parser(value_parser!(u64).range(0..=100))
+                .default_value("90"),
+        )
+        .arg(
+            Arg::new("prefill")
+                .long("prefill")
+                .help("Set every key once before the run")
+                .action(ArgAction::SetTrue),
+        )
+        .arg(
+            Arg::new("histogram")
+                .long("histogram")
+                .help("File to write the latency histogram of the run to")
+                .action(ArgAction::Set),
+        )
+        .get_matches();
+
+    let protocol = match matches.get_one::<String>("protocol").unwrap().as_str() {
+        "resp" => Protocol::Resp,
+        _ => Protocol::Memcache,
+    };
+
+    Config {
+        endpoint: matches.get_one::<String>("ENDPOINT").unwrap().clone(),
+        protocol,
+        connections: (*matches.get_one::<usize>("connections").unwrap()).max(1),
+        pipeline: (*matches.get_one::<usize>("pipeline").unwrap()).max(1),
+        rate: *matches.get_one::<u64>("rate").unwrap(),
+        duration: Duration::from_secs(*matches.get_one::<u64>("duration").unwrap()),
+        interval: Duration::from_secs((*matches.get_one::<u64>("interval").unwrap()).max(1)),
+        keys: (*matches.get_one::<u64>("keys").unwrap()).max(1),
+        klen: *matches.get_one::<usize>("klen").unwrap(),
+        vlen: *matches.get_one::<usize>("vlen").unwrap(),
+        get_pct: *matches.get_one::<u64>("get").unwrap(),
+        prefill: matches.get_flag("prefill"),
+        histogram: matches.get_one::<String>("histogram").cloned(),
+    }
+}
+
+fn main() {
+    let config = Arc::new(config());
+
+    if config.prefill {
+        let threads: Vec<_> = (0..config.connections)
+            .map(|id| {
+                let config = config.clone();
+                std::thread::spawn(move || prefill(&config, id))
+            })
+            .collect();
+        for thread in threads {
+            if let Err(e) = thread.join().unwrap() {
+                eprintln!("prefill failed: {e}");
+                std::process::exit(1);
+            }
+        }
+        println!("prefilled {} keys", config.keys);
+    }
+
+    let stats: Vec<Arc<Stats>> = (0..config.connections)
+        .map(|_| Arc::new(Stats::default()))
+        .collect();
+
+    let start = Instant::now();
+    let end = start + config.duration;
+
+    let threads: Vec<_> = stats
+        .iter()
+        .enumerate()
+        .map(|(id, stats)| {
+            let config = config.clone();
+            let stats = stats.clone();
+            std::thread::spawn(move || {
+                if let Err(e) = run(&config, id, &stats, start, end) {
+                    eprintln!("connection {id} failed: {e}");
+                }
+            })
+        })
+        .collect();
+
+    let mut previous = Totals::default();
+    let mut tick = start;
+    while tick + config.interval <= end {
+        tick += config.interval;
+        std::thread::sleep(tick.saturating_duration_since(Instant::now()));
+
+        let current = Totals::collect(&stats);
+        current.since(&previous).report(
+            &format!("{:>6}s", (tick - start).as_secs()),
+            config.interval,
+        );
+        previous = current;
+    }
+
+    for thread in threads {
+        let _ = thread.join();
+    }
+
+    let total = Totals::collect(&stats);
+    total.report(" total", config.duration);
+
+    if let Some(path) = &config.histogram {
+        let mut file = std::fs::File::create(path).expect("failed to create histogram file");
+        writeln!(file, "# latency_ns_upper_bound count").unwrap();
+        for (upper, count) in total.latency.buckets() {
+            writeln!(file, "{upper} {count}").unwrap();
+        }
+    }
+}
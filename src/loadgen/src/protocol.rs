@@ -0,0 +1,204 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Encoding of the requests sent and framing of the responses read, for the
+//! Memcache ASCII and RESP protocols. Only as much of a response is parsed as
+//! is needed to find where it ends and whether it was a hit, a miss, or an
+//! error.
+
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub enum Protocol {
+    Memcache,
+    Resp,
+}
+
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub enum Response {
+    /// a get found its key
+    Hit,
+    /// a get did not find its key
+    Miss,
+    /// a set was stored
+    Stored,
+    /// any error, or a set that was not stored
+    Error,
+}
+
+impl Protocol {
+    pub fn get(&self, buf: &mut Vec<u8>, key: &[u8]) {
+        match self {
+            Self::Memcache => {
+                buf.extend_from_slice(b"get ");
+                buf.extend_from_slice(key);
+                buf.extend_from_slice(b"\r\n");
+            }
+            Self::Resp => {
+                buf.extend_from_slice(b"*2\r\n$3\r\nGET\r\n");
+                bulk_string(buf, key);
+            }
+        }
+    }
+
+    pub fn set(&self, buf: &mut Vec<u8>, key: &[u8], value: &[u8]) {
+        match self {
+            Self::Memcache => {
+                buf.extend_from_slice(b"set ");
+                buf.extend_from_slice(key);
+                buf.extend_from_slice(format!(" 0 0 {}\r\n", value.len()).as_bytes());
+                buf.extend_from_slice(value);
+                buf.extend_from_slice(b"\r\n");
+            }
+            Self::Resp => {
+                buf.extend_from_slice(b"*3\r\n$3\r\nSET\r\n");
+                bulk_string(buf, key);
+                bulk_string(buf, value);
+            }
+        }
+    }
+
+    /// Parse the response at the start of `buf`, returning it along with its
+    /// length, or `None` if it is not complete yet.
+    pub fn parse(&self, buf: &[u8]) -> Option<(Response, usize)> {
+        match self {
+            Self::Memcache => parse_memcache(buf),
+            Self::Resp => parse_resp(buf),
+        }
+    }
+}
+
+fn bulk_string(buf: &mut Vec<u8>, data: &[u8]) {
+    buf.extend_from_slice(format!("${}\r\n", data.len()).as_bytes());
+    buf.extend_from_slice(data);
+    buf.extend_from_slice(b"\r\n");
+}
+
+/// The length of the line at the start of `buf`, CRLF included.
+fn line(buf: &[u8]) -> Option<usize> {
+    buf.windows(2).position(|w| w == b"\r\n").map(|p| p + 2)
+}
+
+fn parse_memcache(buf: &[u8]) -> Option<(Response, usize)> {
+    let mut offset = 0;
+    let mut hit = false;
+
+    loop {
+        let len = line(&buf[offset..])?;
+        let l = &buf[offset..(offset + len - 2)];
+        offset += len;
+
+        if l.starts_with(b"VALUE ") {
+            // VALUE <key> <flags> <bytes> [<cas>], followed by the value
+            let bytes: usize = std::str::from_utf8(l)
+                .ok()?
+                .split(' ')
+                .nth(3)?
+                .parse()
+                .ok()?;
+            offset += bytes + 2;
+            if buf.len() < offset {
+                return None;
+            }
+            hit = true;
+            continue;
+        }
+
+        let response = match l {
+            b"END" if hit => Response::Hit,
+            b"END" => Response::Miss,
+            b"STORED" => Response::Stored,
+            _ => Response::Error,
+        };
+
+        return Some((response, offset));
+    }
+}
+
+fn parse_resp(buf: &[u8]) -> Option<(Response, usize)> {
+    let len = line(buf)?;
+    let l = &buf[1..(len - 2)];
+
+    match buf[0] {
+        b'+' => Some((Response::Stored, len)),
+        b':' => Some((Response::Stored, len)),
+        b'-' => Some((Response::Error, len)),
+        b'$' => {
+            let n: i64 = std::str::from_utf8(l).ok()?.parse().ok()?;
+            if n < 0 {
+                return Some((Response::Miss, len));
+            }
+            let end = len + n as usize + 2;
+            if buf.len() < end {
+                return None;
+            }
+            Some((Response::Hit, end))
+        }
+        b'*' => {
+            let n: i64 = std::str::from_utf8(l).ok()?.parse().ok()?;
+            let mut offset = len;
+            for _ in 0..n.max(0) {
+                let (_, len) = parse_resp(&buf[offset..])?;
+                offset += len;
+            }
+            Some((if n < 0 { Response::Miss } else { Response::Hit }, offset))
+        }
+        _ => Some((Response::Error, len)),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn memcache() {
+        let p = Protocol::Memcache;
+
+        let mut buf = Vec::new();
+        p.get(&mut buf, b"key");
+        p.set(&mut buf, b"key", b"value");
+        assert_eq!(&buf, b"get key\r\nset key 0 0 5\r\nvalue\r\n");
+
+        assert_eq!(p.parse(b"STORED\r\n"), Some((Response::Stored, 8)));
+        assert_eq!(p.parse(b"END\r\nEND"), Some((Response::Miss, 5)));
+        assert_eq!(p.parse(b"NOT_STORED\r\n"), Some((Response::Error, 12)));
+        assert_eq!(
+            p.parse(b"SERVER_ERROR oom\r\n"),
+            Some((Response::Error, 18))
+        );
+
+        let hit = b"VALUE key 0 5\r\nva\r\ne\r\nEND\r\n";
+        assert_eq!(p.parse(hit), Some((Response::Hit, hit.len())));
+        for len in 0..hit.len() {
+            assert_eq!(p.parse(&hit[..len]), None);
+        }
+    }
+
+    #[test]
+    fn resp() {
+        let p = Protocol::Resp;
+
+        let mut buf = Vec::new();
+        p.get(&mut buf, b"key");
+        p.set(&mut buf, b"key", b"value");
+        assert_eq!(
+            &buf,
+            b"*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n"
+        );
+
+        assert_eq!(p.parse(b"+OK\r\n"), Some((Response::Stored, 5)));
+        assert_eq!(p.parse(b"$-1\r\n+OK"), Some((Response::Miss, 5)));
+        assert_eq!(p.parse(b"-ERR oom\r\n"), Some((Response::Error, 10)));
+        assert_eq!(p.parse(b"*-1\r\n"), Some((Response::Miss, 5)));
+
+        let hit = b"$5\r\nva\r\ne\r\n";
+        assert_eq!(p.parse(hit), Some((Response::Hit, hit.len())));
+        for len in 0..hit.len() {
+            assert_eq!(p.parse(&hit[..len]), None);
+        }
+
+        let array = b"*2\r\n$1\r\na\r\n:1\r\n";
+        assert_eq!(p.parse(array), Some((Response::Hit, array.len())));
+        assert_eq!(p.parse(&array[..array.len() - 1]), None);
+    }
+}
@@ -0,0 +1,85 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Decodes binary klog files into one line of text per command, which is the
+//! unix time in nanoseconds, the command and key, the result code, the length
+//! of the value, the length of the response, and the ttl. Hashed keys are
+//! written as `#` followed by the hash in hex. The sampling of each file is
+//! written to stderr, so that counts taken from the commands may be scaled.
+
+use logger::binary::{KlogDecoder, KlogKey, KlogOp};
+
+use std::fs::File;
+use std::io::{BufReader, BufWriter, Write};
+
+fn main() {
+    let paths: Vec<String> = std::env::args().skip(1).collect();
+    if paths.is_empty() {
+        eprintln!("usage: klog-decode <file>...");
+        std::process::exit(1);
+    }
+
+    let stdout = std::io::stdout();
+    let mut out = BufWriter::new(stdout.lock());
+
+    for path in paths {
+        let file = match File::open(&path) {
+            Ok(file) => file,
+            Err(e) => {
+                eprintln!("failed to open {path}: {e}");
+                std::process::exit(1);
+            }
+        };
+        let decoder = match KlogDecoder::new(BufReader::new(file)) {
+            Ok(decoder) => decoder,
+            Err(e) => {
+                eprintln!("failed to read {path}: {e}");
+                std::process::exit(1);
+            }
+        };
+        let unit = if decoder.sample_key() {
+            "keys"
+        } else {
+            "commands"
+        };
+        eprintln!("{path}: 1 in {} {unit} logged", decoder.sample());
+
+        for entry in decoder {
+            let entry = match entry {
+                Ok(entry) => entry,
+                Err(e) => {
+                    eprintln!("{path}: {e}");
+                    continue;
+                }
+            };
+
+            let op = KlogOp::from_u8(entry.op)
+                .map(|op| op.name().to_string())
+                .unwrap_or_else(|| format!("op{}", entry.op));
+            let key = match entry.key {
+                KlogKey::Key(key) => String::from_utf8_lossy(&key).into_owned(),
+                KlogKey::Hash(hash) => format!("#{hash:016x}"),
+            };
+
+            if writeln!(
+                out,
+                "{} \"{} {}\" {} {} {} {}",
+                entry.timestamp,
+                op,
+                key,
+                entry.result,
+                entry.value_len,
+                entry.response_len,
+                entry.ttl
+            )
+            .is_err()
+            {
+                // the reader went away
+                return;
+            }
+        }
+    }
+
+    let _ = out.flush();
+}
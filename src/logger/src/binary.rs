@@ -0,0 +1,781 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! A binary klog, which writes a compact record for each logged command so
+//! that every command may be logged, such as for collecting traces to replay.
+//!
+//! Each thread encodes its records into a block of its own, which only the
+//! drain contends for. Full blocks, and blocks which have been open for longer
+//! than the flush interval, are taken by the drain, compressed with zstd, and
+//! appended to the klog file.
+//!
+//! The file starts with `MAGIC` and `VERSION`, then the sampling of the klog:
+//! 1 in how many commands or keys are logged as a little endian `u32`, and
+//! `SAMPLE_KEY` if commands are sampled by key, followed by frames of a block
+//! each: the length of the block, the length of the compressed block, both as
+//! little endian `u32`, and the compressed block. A block starts with the unix
+//! time of its first record in nanoseconds as a little endian `u64`, followed
+//! by the records, which are:
+//!
+//! * the nanoseconds since the previous record, as a varint
+//! * the op, see `KlogOp`
+//! * the result code of the protocol
+//! * flags, `FLAG_HASHED` if the key is the xxh3 hash of the key
+//! * the key, either its length as a varint followed by the key, or the hash
+//!   as a little endian `u64`
+//! * the length of the value, the length of the response, and the ttl zigzag
+//!   encoded, each as a varint
+
+use metriken::{metric, Counter};
+use twox_hash::Xxh3Hash64;
+
+use std::cell::RefCell;
+use std::collections::VecDeque;
+use std::fs::{File, OpenOptions};
+use std::hash::Hasher;
+use std::io::{Error, ErrorKind, Read, Write};
+use std::sync::atomic::{AtomicBool, AtomicU32, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::time::{SystemTime, UNIX_EPOCH};
+
+#[metric(
+    name = "klog_binary_record",
+    description = "number of records written to the binary klog"
+)]
+pub static KLOG_BINARY_RECORD: Counter = Counter::new();
+
+#[metric(
+    name = "klog_binary_drop",
+    description = "number of records dropped from the binary klog because the drain fell behind"
+)]
+pub static KLOG_BINARY_DROP: Counter = Counter::new();
+
+#[metric(
+    name = "klog_binary_block",
+    description = "number of compressed blocks written to the binary klog"
+)]
+pub static KLOG_BINARY_BLOCK: Counter = Counter::new();
+
+/// The first bytes of a binary klog file.
+pub const MAGIC: &[u8; 4] = b"PKLG";
+
+/// The version of the format of the records.
+pub const VERSION: u32 = 1;
+
+/// The record holds the hash of the key rather than the key.
+const FLAG_HASHED: u8 = 0x01;
+
+/// The sampling of the file header when every command for a sampled key is
+/// logged, see `crate::sample_key`.
+const SAMPLE_KEY: u8 = 0x01;
+
+/// The bytes of the file header.
+const HEADER_LEN: usize = 16;
+
+/// The number of full blocks each thread may hold for the drain, after which
+/// the oldest is dropped.
+const MAX_PENDING: usize = 16;
+
+/// The zstd level the blocks are compressed at, which favors speed as the
+/// records of a block compress well regardless.
+const COMPRESSION_LEVEL: i32 = 1;
+
+/// The commands which are recorded.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+#[repr(u8)]
+pub enum KlogOp {
+    Get = 1,
+    Gets = 2,
+    Set = 3,
+    Add = 4,
+    Replace = 5,
+    Append = 6,
+    Prepend = 7,
+    Cas = 8,
+    Incr = 9,
+    Decr = 10,
+    Delete = 11,
+    MetaGet = 12,
+    MetaSet = 13,
+    MetaDelete = 14,
+    MetaArithmetic = 15,
+    Touch = 16,
+    Gat = 17,
+    Gats = 18,
+}
+
+impl KlogOp {
+    pub fn from_u8(op: u8) -> Option<Self> {
+        Some(match op {
+            1 => Self::Get,
+            2 => Self::Gets,
+            3 => Self::Set,
+            4 => Self::Add,
+            5 => Self::Replace,
+            6 => Self::Append,
+            7 => Self::Prepend,
+            8 => Self::Cas,
+            9 => Self::Incr,
+            10 => Self::Decr,
+            11 => Self::Delete,
+            12 => Self::MetaGet,
+            13 => Self::MetaSet,
+            14 => Self::MetaDelete,
+            15 => Self::MetaArithmetic,
+            16 => Self::Touch,
+            17 => Self::Gat,
+            18 => Self::Gats,
+            _ => return None,
+        })
+    }
+
+    /// The command, as it is written in the text klog.
+    pub fn name(&self) -> &'static str {
+        match self {
+            Self::Get => "get",
+            Self::Gets => "gets",
+            Self::Set => "set",
+            Self::Add => "add",
+            Self::Replace => "replace",
+            Self::Append => "append",
+            Self::Prepend => "prepend",
+            Self::Cas => "cas",
+            Self::Incr => "incr",
+            Self::Decr => "decr",
+            Self::Delete => "delete",
+            Self::MetaGet => "mg",
+            Self::MetaSet => "ms",
+            Self::MetaDelete => "md",
+            Self::MetaArithmetic => "ma",
+            Self::Touch => "touch",
+            Self::Gat => "gat",
+            Self::Gats => "gats",
+        }
+    }
+}
+
+/// A command to be written to the binary klog.
+pub struct KlogRecord<'a> {
+    op: KlogOp,
+    key: &'a [u8],
+    result: u8,
+    value_len: usize,
+    response_len: usize,
+    ttl: i32,
+}
+
+impl<'a> KlogRecord<'a> {
+    pub fn new(op: KlogOp, key: &'a [u8], result: u8) -> Self {
+        Self {
+            op,
+            key,
+            result,
+            value_len: 0,
+            response_len: 0,
+            ttl: 0,
+        }
+    }
+
+    pub fn value_len(mut self, len: usize) -> Self {
+        self.value_len = len;
+        self
+    }
+
+    pub fn response_len(mut self, len: usize) -> Self {
+        self.response_len = len;
+        self
+    }
+
+    pub fn ttl(mut self, ttl: i32) -> Self {
+        self.ttl = ttl;
+        self
+    }
+
+    pub fn key(&self) -> &[u8] {
+        self.key
+    }
+}
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+static SHARED: OnceLock<Shared> = OnceLock::new();
+
+thread_local! {
+    static LOCAL: RefCell<Option<Local>> = const { RefCell::new(None) };
+}
+
+/// Whether commands are logged as binary records rather than as text.
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+/// Logs the record, subject to sampling, if the binary klog is enabled.
+pub fn record(record: &KlogRecord) {
+    let shared = match SHARED.get() {
+        Some(shared) => shared,
+        None => return,
+    };
+    if !crate::sample_key(record.key) {
+        return;
+    }
+
+    LOCAL.with(|local| {
+        let mut local = local.borrow_mut();
+        let local = local.get_or_insert_with(|| shared.register());
+
+        if local.countdown > 1 {
+            local.countdown -= 1;
+            return;
+        }
+        local.countdown = shared.sample.load(Ordering::Relaxed);
+
+        local.buffer.lock().unwrap().push(shared, record);
+    });
+}
+
+/// Changes the sampling of the binary klog while it runs, which logs 1 in
+/// `sample` of the commands of sampled keys, and writes `header` as the
+/// sampling of the file. The file is rotated by the drain so that the header
+/// of each file holds the sampling of its records. Returns false if the
+/// binary klog is not enabled.
+pub(crate) fn set_sample(sample: usize, header: usize) -> bool {
+    match SHARED.get() {
+        Some(shared) if enabled() => {
+            shared.sample.store(sample, Ordering::Relaxed);
+            shared
+                .header
+                .store(header.min(u32::MAX as usize) as u32, Ordering::Relaxed);
+            true
+        }
+        _ => false,
+    }
+}
+
+/// The options of the binary klog shared by all threads.
+struct Shared {
+    /// 1 in how many of the commands of sampled keys are logged
+    sample: AtomicUsize,
+    /// the sampling written to the header of the file, which is rotated when
+    /// the sample is changed
+    header: AtomicU32,
+    hash_keys: bool,
+    block_size: usize,
+    /// the buffer of each thread which logged a record
+    buffers: Mutex<Vec<Arc<Mutex<Buffer>>>>,
+}
+
+impl Shared {
+    fn register(&self) -> Local {
+        let buffer = Arc::new(Mutex::new(Buffer {
+            block: Vec::with_capacity(self.block_size),
+            last: 0,
+            full: VecDeque::new(),
+        }));
+        self.buffers.lock().unwrap().push(buffer.clone());
+
+        Local {
+            countdown: 1,
+            buffer,
+        }
+    }
+}
+
+struct Local {
+    /// the number of records until the next one is sampled
+    countdown: usize,
+    buffer: Arc<Mutex<Buffer>>,
+}
+
+struct Buffer {
+    /// the open block, empty if there are no records since the last was taken
+    block: Vec<u8>,
+    /// the time of the last record of the open block
+    last: u64,
+    /// blocks which are ready for the drain
+    full: VecDeque<Vec<u8>>,
+}
+
+impl Buffer {
+    fn push(&mut self, shared: &Shared, record: &KlogRecord) {
+        let now = now();
+        if self.block.is_empty() {
+            self.block.extend_from_slice(&now.to_le_bytes());
+            self.last = now;
+        }
+
+        let block = &mut self.block;
+        put_varint(block, now.saturating_sub(self.last));
+        self.last = self.last.max(now);
+        block.push(record.op as u8);
+        block.push(record.result);
+        if shared.hash_keys {
+            block.push(FLAG_HASHED);
+            block.extend_from_slice(&hash(record.key).to_le_bytes());
+        } else {
+            block.push(0);
+            put_varint(block, record.key.len() as u64);
+            block.extend_from_slice(record.key);
+        }
+        put_varint(block, record.value_len as u64);
+        put_varint(block, record.response_len as u64);
+        put_varint(block, zigzag(record.ttl));
+
+        KLOG_BINARY_RECORD.increment();
+
+        if self.block.len() >= shared.block_size {
+            if self.full.len() >= MAX_PENDING {
+                self.full.pop_front();
+                KLOG_BINARY_DROP.increment();
+            }
+            let block = std::mem::replace(&mut self.block, Vec::with_capacity(shared.block_size));
+            self.full.push_back(block);
+        }
+    }
+}
+
+/// Takes the blocks of each thread, and compresses and writes them to the
+/// klog file, rotating it once it grows beyond the max size.
+pub(crate) struct BinaryDrain {
+    path: String,
+    backup: String,
+    max_size: u64,
+    /// open blocks are taken once they are older than this, in nanoseconds
+    interval: u64,
+    /// the sampling written to the header of each file
+    sample: u32,
+    sampling: u8,
+    file: File,
+    size: u64,
+    compressor: zstd::bulk::Compressor<'static>,
+    blocks: Vec<Vec<u8>>,
+    compressed: Vec<u8>,
+    frame: Vec<u8>,
+}
+
+impl BinaryDrain {
+    /// Opens the klog file and enables the binary klog, which logs 1 in
+    /// `sample` of the commands of sampled keys.
+    pub(crate) fn new(
+        config: &config::Klog,
+        sample: usize,
+        path: String,
+        backup: String,
+    ) -> Result<Self, Error> {
+        let shared = Shared {
+            sample: AtomicUsize::new(sample),
+            header: AtomicU32::new(config.sample().min(u32::MAX as usize) as u32),
+            hash_keys: config.hash_keys(),
+            block_size: config.block_size().max(1),
+            buffers: Mutex::new(Vec::new()),
+        };
+        if SHARED.set(shared).is_err() {
+            return Err(Error::new(
+                ErrorKind::AlreadyExists,
+                "binary klog is already configured",
+            ));
+        }
+
+        let mut drain = Self {
+            file: open(&path)?,
+            size: 0,
+            path,
+            backup,
+            max_size: config.max_size(),
+            interval: config.interval() as u64 * 1_000_000,
+            sample: config.sample().min(u32::MAX as usize) as u32,
+            sampling: match config.sampling() {
+                config::KlogSampling::Uniform => 0,
+                config::KlogSampling::Key => SAMPLE_KEY,
+            },
+            compressor: zstd::bulk::Compressor::new(COMPRESSION_LEVEL)?,
+            blocks: Vec::new(),
+            compressed: Vec::new(),
+            frame: Vec::new(),
+        };
+        drain.size = drain.file.metadata()?.len();
+        if drain.size == 0 {
+            drain.write_header()?;
+        }
+
+        // a sample of zero disables the klog
+        ENABLED.store(sample > 0, Ordering::Relaxed);
+
+        Ok(drain)
+    }
+
+    fn write_header(&mut self) -> Result<(), Error> {
+        let mut header = [0; HEADER_LEN];
+        header[0..4].copy_from_slice(MAGIC);
+        header[4..8].copy_from_slice(&VERSION.to_le_bytes());
+        header[8..12].copy_from_slice(&self.sample.to_le_bytes());
+        header[12] = self.sampling;
+        self.file.write_all(&header)?;
+        self.size += HEADER_LEN as u64;
+        Ok(())
+    }
+
+    pub(crate) fn flush(&mut self) -> Result<(), Error> {
+        let shared = match SHARED.get() {
+            Some(shared) => shared,
+            None => return Ok(()),
+        };
+
+        // the records logged since the sample was changed are written to the
+        // file with the previous header, which is then rotated
+        let header = shared.header.load(Ordering::Relaxed);
+        let rotate = header != self.sample;
+
+        let now = now();
+        shared.buffers.lock().unwrap().retain(|buffer| {
+            // the buffers of threads which exited are only held here
+            let exited = Arc::strong_count(buffer) == 1;
+            let mut buffer = buffer.lock().unwrap();
+            self.blocks.extend(buffer.full.drain(..));
+            if !buffer.block.is_empty() {
+                let opened = u64::from_le_bytes(buffer.block[0..8].try_into().unwrap());
+                if exited || now.saturating_sub(opened) >= self.interval {
+                    let block = Vec::with_capacity(shared.block_size);
+                    self.blocks
+                        .push(std::mem::replace(&mut buffer.block, block));
+                }
+            }
+            !exited
+        });
+
+        for block in std::mem::take(&mut self.blocks) {
+            self.write_block(&block)?;
+        }
+
+        if rotate {
+            self.sample = header;
+            self.rotate()?;
+        }
+        Ok(())
+    }
+
+    fn rotate(&mut self) -> Result<(), Error> {
+        std::fs::rename(&self.path, &self.backup)?;
+        self.file = open(&self.path)?;
+        self.size = 0;
+        self.write_header()
+    }
+
+    fn write_block(&mut self, block: &[u8]) -> Result<(), Error> {
+        // zstd writes from the start of the buffer, so the frame header is
+        // put in front of the compressed block after compressing
+        self.compressed.clear();
+        self.compressed
+            .reserve(zstd::zstd_safe::compress_bound(block.len()));
+        let len = self
+            .compressor
+            .compress_to_buffer(block, &mut self.compressed)?;
+
+        self.frame.clear();
+        self.frame
+            .extend_from_slice(&(block.len() as u32).to_le_bytes());
+        self.frame.extend_from_slice(&(len as u32).to_le_bytes());
+        self.frame.extend_from_slice(&self.compressed);
+
+        self.file.write_all(&self.frame)?;
+        self.size += self.frame.len() as u64;
+        KLOG_BINARY_BLOCK.increment();
+
+        if self.max_size > 0 && self.size >= self.max_size {
+            self.rotate()?;
+        }
+        Ok(())
+    }
+}
+
+fn open(path: &str) -> Result<File, Error> {
+    OpenOptions::new().create(true).append(true).open(path)
+}
+
+/// The key of a decoded record.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub enum KlogKey {
+    Key(Vec<u8>),
+    Hash(u64),
+}
+
+/// A record read back from a binary klog.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct KlogEntry {
+    /// unix time in nanoseconds
+    pub timestamp: u64,
+    /// the op, which is a `KlogOp` unless the log is from a newer version
+    pub op: u8,
+    pub result: u8,
+    pub key: KlogKey,
+    pub value_len: u64,
+    pub response_len: u64,
+    pub ttl: i32,
+}
+
+/// Reads the records of a binary klog file in the order they were written,
+/// which is in order of time for the records of each thread.
+pub struct KlogDecoder<R> {
+    reader: R,
+    block: Vec<u8>,
+    /// the offset of the next record in the block
+    offset: usize,
+    /// the time of the previous record of the block
+    last: u64,
+    sample: u32,
+    sampling: u8,
+}
+
+impl<R: Read> KlogDecoder<R> {
+    pub fn new(mut reader: R) -> Result<Self, Error> {
+        let mut header = [0; HEADER_LEN];
+        reader.read_exact(&mut header)?;
+        if &header[0..4] != MAGIC {
+            return Err(invalid("not a binary klog"));
+        }
+
+        let mut decoder = Self {
+            reader,
+            block: Vec::new(),
+            offset: 0,
+            last: 0,
+            sample: 0,
+            sampling: 0,
+        };
+        decoder.read_header(&header)?;
+        Ok(decoder)
+    }
+
+    fn read_header(&mut self, header: &[u8; HEADER_LEN]) -> Result<(), Error> {
+        if u32::from_le_bytes(header[4..8].try_into().unwrap()) != VERSION {
+            return Err(invalid("unsupported binary klog version"));
+        }
+        self.sample = u32::from_le_bytes(header[8..12].try_into().unwrap());
+        self.sampling = header[12];
+        Ok(())
+    }
+
+    /// 1 in how many commands, or keys if `sample_key`, were logged, by which
+    /// counts taken from the log may be scaled.
+    pub fn sample(&self) -> u32 {
+        self.sample
+    }
+
+    /// Whether every command for the sampled keys was logged.
+    pub fn sample_key(&self) -> bool {
+        self.sampling & SAMPLE_KEY != 0
+    }
+
+    /// Reads the next block, returns false at the end of the file. Files which
+    /// were concatenated hold the header of each file before its blocks.
+    fn next_block(&mut self) -> Result<bool, Error> {
+        let mut header = [0; 8];
+        match self.reader.read_exact(&mut header) {
+            Ok(()) => {}
+            Err(e) if e.kind() == ErrorKind::UnexpectedEof => return Ok(false),
+            Err(e) => return Err(e),
+        }
+        if &header[0..4] == MAGIC {
+            let mut file_header = [0; HEADER_LEN];
+            file_header[0..8].copy_from_slice(&header);
+            self.reader.read_exact(&mut file_header[8..])?;
+            self.read_header(&file_header)?;
+            return self.next_block();
+        }
+
+        let len = u32::from_le_bytes(header[0..4].try_into().unwrap()) as usize;
+        let compressed_len = u32::from_le_bytes(header[4..8].try_into().unwrap()) as usize;
+        let mut compressed = vec![0; compressed_len];
+        self.reader.read_exact(&mut compressed)?;
+        self.block = zstd::bulk::decompress(&compressed, len)?;
+        if self.block.len() < 8 {
+            return Err(invalid("truncated block"));
+        }
+        self.last = u64::from_le_bytes(self.block[0..8].try_into().unwrap());
+        self.offset = 8;
+        Ok(true)
+    }
+
+    fn decode(&mut self) -> Option<KlogEntry> {
+        let mut cursor = &self.block[self.offset..];
+
+        let timestamp = self.last + get_varint(&mut cursor)?;
+        let (&op, rest) = cursor.split_first()?;
+        let (&result, rest) = rest.split_first()?;
+        let (&flags, rest) = rest.split_first()?;
+        cursor = rest;
+        let key = if flags & FLAG_HASHED != 0 {
+            let hash = cursor.get(0..8)?;
+            let hash = u64::from_le_bytes(hash.try_into().unwrap());
+            cursor = &cursor[8..];
+            KlogKey::Hash(hash)
+        } else {
+            let len = get_varint(&mut cursor)? as usize;
+            let key = cursor.get(0..len)?.to_vec();
+            cursor = &cursor[len..];
+            KlogKey::Key(key)
+        };
+        let value_len = get_varint(&mut cursor)?;
+        let response_len = get_varint(&mut cursor)?;
+        let ttl = unzigzag(get_varint(&mut cursor)?);
+
+        self.offset = self.block.len() - cursor.len();
+        self.last = timestamp;
+
+        Some(KlogEntry {
+            timestamp,
+            op,
+            result,
+            key,
+            value_len,
+            response_len,
+            ttl,
+        })
+    }
+}
+
+impl<R: Read> Iterator for KlogDecoder<R> {
+    type Item = Result<KlogEntry, Error>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        while self.offset >= self.block.len() {
+            match self.next_block() {
+                Ok(true) => {}
+                Ok(false) => return None,
+                Err(e) => return Some(Err(e)),
+            }
+        }
+
+        match self.decode() {
+            Some(entry) => Some(Ok(entry)),
+            None => {
+                // skip the rest of a block which does not decode
+                self.offset = self.block.len();
+                Some(Err(invalid("truncated record")))
+            }
+        }
+    }
+}
+
+fn invalid(message: &str) -> Error {
+    Error::new(ErrorKind::InvalidData, message.to_string())
+}
+
+fn now() -> u64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_nanos() as u64)
+        .unwrap_or(0)
+}
+
+/// The hash of a key as written by the binary klog.
+pub fn hash(key: &[u8]) -> u64 {
+    let mut hasher = Xxh3Hash64::with_seed(0);
+    hasher.write(key);
+    hasher.finish()
+}
+
+fn put_varint(buffer: &mut Vec<u8>, mut value: u64) {
+    while value >= 0x80 {
+        buffer.push(value as u8 | 0x80);
+        value >>= 7;
+    }
+    buffer.push(value as u8);
+}
+
+fn get_varint(cursor: &mut &[u8]) -> Option<u64> {
+    let mut value = 0;
+    for (i, byte) in cursor.iter().enumerate().take(10) {
+        value |= ((byte & 0x7f) as u64) << (7 * i);
+        if byte & 0x80 == 0 {
+            *cursor = &cursor[i + 1..];
+            return Some(value);
+        }
+    }
+    None
+}
+
+fn zigzag(value: i32) -> u64 {
+    ((value << 1) ^ (value >> 31)) as u32 as u64
+}
+
+fn unzigzag(value: u64) -> i32 {
+    let value = value as u32;
+    ((value >> 1) as i32) ^ -((value & 1) as i32)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn varint() {
+        for value in [0, 1, 127, 128, 16383, 16384, u32::MAX as u64, u64::MAX] {
+            let mut buffer = Vec::new();
+            put_varint(&mut buffer, value);
+            let mut cursor = buffer.as_slice();
+            assert_eq!(get_varint(&mut cursor), Some(value));
+            assert!(cursor.is_empty());
+        }
+
+        for value in [0, 1, -1, i32::MAX, i32::MIN] {
+            assert_eq!(unzigzag(zigzag(value)), value);
+        }
+    }
+
+    #[test]
+    fn roundtrip() {
+        let shared = Shared {
+            sample: AtomicUsize::new(1),
+            header: AtomicU32::new(1),
+            hash_keys: false,
+            block_size: usize::MAX,
+            buffers: Mutex::new(Vec::new()),
+        };
+        let mut buffer = Buffer {
+            block: Vec::new(),
+            last: 0,
+            full: VecDeque::new(),
+        };
+        buffer.push(
+            &shared,
+            &KlogRecord::new(KlogOp::Get, b"0", 4).response_len(1),
+        );
+        buffer.push(
+            &shared,
+            &KlogRecord::new(KlogOp::Set, b"key", 5)
+                .value_len(3)
+                .response_len(8)
+                .ttl(-1),
+        );
+        let shared = Shared {
+            hash_keys: true,
+            ..shared
+        };
+        buffer.push(&shared, &KlogRecord::new(KlogOp::Delete, b"key", 8));
+
+        let mut file = Vec::new();
+        file.extend_from_slice(MAGIC);
+        file.extend_from_slice(&VERSION.to_le_bytes());
+        file.extend_from_slice(&100u32.to_le_bytes());
+        file.extend_from_slice(&[SAMPLE_KEY, 0, 0, 0]);
+        let compressed = zstd::bulk::compress(&buffer.block, COMPRESSION_LEVEL).unwrap();
+        file.extend_from_slice(&(buffer.block.len() as u32).to_le_bytes());
+        file.extend_from_slice(&(compressed.len() as u32).to_le_bytes());
+        file.extend_from_slice(&compressed);
+
+        let decoder = KlogDecoder::new(file.as_slice()).unwrap();
+        assert_eq!(decoder.sample(), 100);
+        assert!(decoder.sample_key());
+        let entries: Vec<KlogEntry> = decoder.map(|entry| entry.unwrap()).collect();
+        assert_eq!(entries.len(), 3);
+        assert_eq!(entries[0].op, KlogOp::Get as u8);
+        assert_eq!(entries[0].key, KlogKey::Key(b"0".to_vec()));
+        assert_eq!(entries[1].result, 5);
+        assert_eq!(entries[1].value_len, 3);
+        assert_eq!(entries[1].response_len, 8);
+        assert_eq!(entries[1].ttl, -1);
+        assert_eq!(entries[2].key, KlogKey::Hash(hash(b"key")));
+        assert!(entries[0].timestamp <= entries[2].timestamp);
+    }
+}
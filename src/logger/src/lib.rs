@@ -33,10 +33,47 @@
 //! macro to set the target to some specific category and log those messages to
 //! a file, while letting all other log messages pass to standard out. This
 //! could allow splitting command/access/audit logs from the normal logging.
+//!
+//! The command log may instead be written as compact binary records, see the
+//! `binary` module, which are read back with the `klog-decode` tool.
 
 pub use ringlog::*;
 
-use config::{DebugConfig, KlogConfig};
+pub mod binary;
+
+pub use binary::{KlogOp, KlogRecord};
+
+use binary::BinaryDrain;
+use config::{DebugConfig, KlogConfig, KlogFormat, KlogSampling};
+use metriken::{metric, Gauge};
+
+use std::sync::atomic::{AtomicU64, AtomicU8, Ordering};
+
+#[metric(
+    name = "klog_sample",
+    description = "1 in N commands, or keys when sampling by key, are logged to the klog"
+)]
+pub static KLOG_SAMPLE: Gauge = Gauge::new();
+
+#[metric(
+    name = "klog_sample_key",
+    description = "1 if the klog samples commands by the hash of their key"
+)]
+pub static KLOG_SAMPLE_KEY: Gauge = Gauge::new();
+
+/// Keys which hash below this are logged, `u64::MAX` when not sampling by key.
+static KEY_THRESHOLD: AtomicU64 = AtomicU64::new(u64::MAX);
+
+/// How the sample of the klog is changed while running, see `set_klog_sample`.
+static RESAMPLE: AtomicU8 = AtomicU8::new(RESAMPLE_NONE);
+
+// the klog is disabled, or samples its lines of text as they are logged, which
+// is fixed once the log is built
+const RESAMPLE_NONE: u8 = 0;
+// the klog samples by key
+const RESAMPLE_KEY: u8 = 1;
+// the binary klog samples commands
+const RESAMPLE_BINARY: u8 = 2;
 
 ////////////////////////////////////////////////////////////////////////////////
 // TODO(bmartin): everything below is Pelikan specific, and should be factored
@@ -52,6 +89,70 @@ macro_rules! klog {
     )
 }
 
+/// Logs a command, as the `KlogRecord` when the klog is binary, and otherwise
+/// as a line of text formatted from the remaining arguments, which are only
+/// evaluated for the text klog.
+#[macro_export]
+macro_rules! klog_command {
+    ($record:expr, $($arg:tt)*) => {{
+        let record = $record;
+        if $crate::binary::enabled() {
+            $crate::binary::record(&record);
+        } else if $crate::sample_key(record.key()) {
+            klog!($($arg)*);
+        }
+    }}
+}
+
+/// Logs a command for the key as a line of text, if the key is sampled when
+/// the klog samples by key.
+#[macro_export]
+macro_rules! klog_key {
+    ($key:expr, $($arg:tt)*) => (
+        if $crate::sample_key($key) {
+            klog!($($arg)*);
+        }
+    )
+}
+
+/// Whether commands for the key are logged. When the klog samples by key, this
+/// holds for 1 in `sample` keys and all of their commands, otherwise commands
+/// are sampled as they are logged and this always holds.
+pub fn sample_key(key: &[u8]) -> bool {
+    let threshold = KEY_THRESHOLD.load(Ordering::Relaxed);
+    threshold == u64::MAX || binary::hash(key) < threshold
+}
+
+/// Changes 1 in how many commands, or keys when sampling by key, are logged
+/// to the klog while running. Returns false if the sample cannot be changed,
+/// which is the case when the klog is disabled, as it is only enabled at
+/// startup, and for a text klog which samples commands.
+pub fn set_klog_sample(sample: usize) -> bool {
+    if sample == 0 {
+        return false;
+    }
+
+    let changed = match RESAMPLE.load(Ordering::Relaxed) {
+        RESAMPLE_KEY => {
+            let threshold = if sample > 1 {
+                u64::MAX / sample as u64
+            } else {
+                u64::MAX
+            };
+            KEY_THRESHOLD.store(threshold, Ordering::Relaxed);
+            binary::set_sample(1, sample);
+            true
+        }
+        RESAMPLE_BINARY => binary::set_sample(sample, sample),
+        _ => false,
+    };
+
+    if changed {
+        KLOG_SAMPLE.set(sample as i64);
+    }
+    changed
+}
+
 pub trait Klog {
     type Response;
 
@@ -80,7 +181,40 @@ pub fn configure_logging<T: DebugConfig + KlogConfig>(config: &T) -> Box<dyn Dra
 
     let klog_config = config.klog();
 
-    let klog = if let Some(file) = klog_config.file() {
+    // when sampling by key, every command for a sampled key is logged
+    let sample = match klog_config.sampling() {
+        KlogSampling::Uniform => klog_config.sample(),
+        KlogSampling::Key => {
+            if klog_config.sample() > 1 {
+                KEY_THRESHOLD.store(u64::MAX / klog_config.sample() as u64, Ordering::Relaxed);
+            }
+            KLOG_SAMPLE_KEY.set(1);
+            klog_config.sample().min(1)
+        }
+    };
+    KLOG_SAMPLE.set(klog_config.sample() as i64);
+
+    if klog_config.file().is_some() && klog_config.sample() > 0 {
+        match (klog_config.sampling(), klog_config.format()) {
+            (KlogSampling::Key, _) => RESAMPLE.store(RESAMPLE_KEY, Ordering::Relaxed),
+            (KlogSampling::Uniform, KlogFormat::Binary) => {
+                RESAMPLE.store(RESAMPLE_BINARY, Ordering::Relaxed)
+            }
+            _ => {}
+        }
+    }
+
+    let mut binary = None;
+
+    let klog = if let (Some(file), KlogFormat::Binary) = (klog_config.file(), klog_config.format())
+    {
+        let backup = klog_config.backup().unwrap_or(format!("{file}.old"));
+        binary = Some(
+            BinaryDrain::new(klog_config, sample, file, backup)
+                .expect("failed to open binary klog file"),
+        );
+        NopLogBuilder::new().build()
+    } else if let Some(file) = klog_config.file() {
         let backup = klog_config.backup().unwrap_or(format!("{file}.old"));
         let output = Box::new(
             File::new(&file, &backup, klog_config.max_size()).expect("failed to open klog file"),
@@ -88,7 +222,7 @@ pub fn configure_logging<T: DebugConfig + KlogConfig>(config: &T) -> Box<dyn Dra
         SamplingLogBuilder::new()
             .output(output)
             .format(klog_format)
-            .sample(klog_config.sample())
+            .sample(sample)
             .log_queue_depth(klog_config.queue_depth())
             .single_message_size(klog_config.single_message_size())
             .build()
@@ -97,10 +231,29 @@ pub fn configure_logging<T: DebugConfig + KlogConfig>(config: &T) -> Box<dyn Dra
         NopLogBuilder::new().build()
     };
 
-    MultiLogBuilder::new()
+    let log = MultiLogBuilder::new()
         .level_filter(debug_config.log_level().to_level_filter())
         .default(debug_log)
         .add_target("klog", klog)
         .build()
-        .start()
+        .start();
+
+    match binary {
+        Some(binary) => Box::new(KlogDrain { log, binary }),
+        None => log,
+    }
+}
+
+/// Flushes the binary klog along with the text logs.
+struct KlogDrain {
+    log: Box<dyn Drain>,
+    binary: BinaryDrain,
+}
+
+impl Drain for KlogDrain {
+    fn flush(&mut self) -> Result<(), std::io::Error> {
+        let result = self.log.flush();
+        self.binary.flush()?;
+        result
+    }
 }
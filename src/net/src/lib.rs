@@ -6,6 +6,8 @@ mod connector;
 mod listener;
 mod stream;
 mod tcp;
+mod udp;
+mod unix;
 
 #[cfg(any(feature = "boringssl", feature = "openssl"))]
 mod tls_tcp;
@@ -14,6 +16,8 @@ pub use connector::*;
 pub use listener::*;
 pub use stream::*;
 pub use tcp::*;
+pub use udp::*;
+pub use unix::*;
 
 #[cfg(any(feature = "boringssl", feature = "openssl"))]
 pub use tls_tcp::*;
@@ -44,7 +48,7 @@ pub(crate) use metric;
 
 use core::fmt::Debug;
 use core::ops::Deref;
-use std::io::{Error, ErrorKind, Read, Write};
+use std::io::{Error, ErrorKind, IoSlice, Read, Write};
 use std::net::{SocketAddr, ToSocketAddrs};
 
 type Result<T> = std::io::Result<T>;
@@ -3,6 +3,7 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use crate::*;
+use std::os::unix::prelude::{AsRawFd, RawFd};
 
 pub struct Listener {
     inner: ListenerType,
@@ -10,6 +11,7 @@ pub struct Listener {
 
 enum ListenerType {
     Plain(TcpListener),
+    Unix(UnixListener),
     #[cfg(any(feature = "boringssl", feature = "openssl"))]
     Tls((TcpListener, TlsTcpAcceptor)),
 }
@@ -22,6 +24,14 @@ impl From<TcpListener> for Listener {
     }
 }
 
+impl From<UnixListener> for Listener {
+    fn from(other: UnixListener) -> Self {
+        Self {
+            inner: ListenerType::Unix(other),
+        }
+    }
+}
+
 #[cfg(any(feature = "boringssl", feature = "openssl"))]
 impl From<(TcpListener, TlsTcpAcceptor)> for Listener {
     fn from(other: (TcpListener, TlsTcpAcceptor)) -> Self {
@@ -59,6 +69,10 @@ impl Listener {
                 let (stream, _addr) = listener.accept()?;
                 Ok(Stream::from(stream))
             }
+            ListenerType::Unix(listener) => {
+                let stream = listener.accept()?;
+                Ok(Stream::from(stream))
+            }
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             ListenerType::Tls((listener, acceptor)) => {
                 let (stream, _addr) = listener.accept()?;
@@ -68,13 +82,38 @@ impl Listener {
         }
     }
 
+    /// Returns the address of a TCP listener. Listeners on a Unix domain
+    /// socket have no such address and return an error, see `path`.
     pub fn local_addr(&self) -> Result<SocketAddr> {
         match &self.inner {
             ListenerType::Plain(listener) => listener.local_addr(),
+            ListenerType::Unix(_) => Err(Error::new(
+                ErrorKind::Unsupported,
+                "unix domain socket listener has no socket address",
+            )),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             ListenerType::Tls((listener, _acceptor)) => listener.local_addr(),
         }
     }
+
+    /// Returns the path of a listener on a Unix domain socket.
+    pub fn path(&self) -> Option<&std::path::Path> {
+        match &self.inner {
+            ListenerType::Unix(listener) => Some(listener.path()),
+            _ => None,
+        }
+    }
+}
+
+impl AsRawFd for Listener {
+    fn as_raw_fd(&self) -> RawFd {
+        match &self.inner {
+            ListenerType::Plain(listener) => listener.as_raw_fd(),
+            ListenerType::Unix(listener) => listener.as_raw_fd(),
+            #[cfg(any(feature = "boringssl", feature = "openssl"))]
+            ListenerType::Tls((listener, _acceptor)) => listener.as_raw_fd(),
+        }
+    }
 }
 
 impl event::Source for Listener {
@@ -86,6 +125,7 @@ impl event::Source for Listener {
     ) -> Result<()> {
         match &mut self.inner {
             ListenerType::Plain(listener) => listener.register(registry, token, interests),
+            ListenerType::Unix(listener) => listener.register(registry, token, interests),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             ListenerType::Tls((listener, _acceptor)) => {
                 listener.register(registry, token, interests)
@@ -101,6 +141,7 @@ impl event::Source for Listener {
     ) -> Result<()> {
         match &mut self.inner {
             ListenerType::Plain(listener) => listener.reregister(registry, token, interests),
+            ListenerType::Unix(listener) => listener.reregister(registry, token, interests),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             ListenerType::Tls((listener, _acceptor)) => {
                 listener.reregister(registry, token, interests)
@@ -111,6 +152,7 @@ impl event::Source for Listener {
     fn deregister(&mut self, registry: &mio::Registry) -> Result<()> {
         match &mut self.inner {
             ListenerType::Plain(listener) => listener.deregister(registry),
+            ListenerType::Unix(listener) => listener.deregister(registry),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             ListenerType::Tls((listener, _acceptor)) => listener.deregister(registry),
         }
@@ -33,6 +33,75 @@ pub static TCP_RECV_BYTE: Counter = Counter::new();
 )]
 pub static TCP_SEND_BYTE: Counter = Counter::new();
 
+#[metric(name = "udp_recv", description = "number of UDP datagrams received")]
+pub static UDP_RECV: Counter = Counter::new();
+
+#[metric(
+    name = "udp_recv_byte",
+    description = "number of bytes received in UDP datagrams"
+)]
+pub static UDP_RECV_BYTE: Counter = Counter::new();
+
+#[metric(
+    name = "udp_send",
+    description = "number of UDP messages sent, each of one or more datagrams"
+)]
+pub static UDP_SEND: Counter = Counter::new();
+
+#[metric(
+    name = "udp_send_byte",
+    description = "number of bytes sent in UDP datagrams"
+)]
+pub static UDP_SEND_BYTE: Counter = Counter::new();
+
+#[metric(
+    name = "udp_send_drop",
+    description = "number of UDP messages dropped as the socket would block"
+)]
+pub static UDP_SEND_DROP: Counter = Counter::new();
+
+#[metric(
+    name = "udp_gso_ex",
+    description = "number of times segmentation offload was refused and disabled for a UDP socket"
+)]
+pub static UDP_GSO_EX: Counter = Counter::new();
+
+#[metric(
+    name = "unix_accept",
+    description = "number of Unix domain socket streams passively opened with accept"
+)]
+pub static UNIX_ACCEPT: Counter = Counter::new();
+
+#[metric(
+    name = "unix_connect",
+    description = "number of Unix domain socket streams actively opened with connect"
+)]
+pub static UNIX_CONNECT: Counter = Counter::new();
+
+#[metric(
+    name = "unix_close",
+    description = "number of Unix domain socket streams closed"
+)]
+pub static UNIX_CLOSE: Counter = Counter::new();
+
+#[metric(
+    name = "unix_conn_curr",
+    description = "current number of open Unix domain socket streams"
+)]
+pub static UNIX_CONN_CURR: Gauge = Gauge::new();
+
+#[metric(
+    name = "unix_recv_byte",
+    description = "number of bytes received on Unix domain socket streams"
+)]
+pub static UNIX_RECV_BYTE: Counter = Counter::new();
+
+#[metric(
+    name = "unix_send_byte",
+    description = "number of bytes sent on Unix domain socket streams"
+)]
+pub static UNIX_SEND_BYTE: Counter = Counter::new();
+
 #[metric(name = "stream_accept", description = "number of calls to accept")]
 pub static STREAM_ACCEPT: Counter = Counter::new();
 
@@ -57,6 +126,12 @@ pub static STREAM_HANDSHAKE: Counter = Counter::new();
 )]
 pub static STREAM_HANDSHAKE_EX: Counter = Counter::new();
 
+#[metric(
+    name = "stream_handshake_resumed",
+    description = "number of handshakes which resumed a previous session"
+)]
+pub static STREAM_HANDSHAKE_RESUMED: Counter = Counter::new();
+
 #[metric(
     name = "stream_shutdown",
     description = "number of streams gracefully shutdown"
@@ -68,3 +143,15 @@ pub static STREAM_SHUTDOWN: Counter = Counter::new();
     description = "number of exceptions while attempting to gracefully shutdown a stream"
 )]
 pub static STREAM_SHUTDOWN_EX: Counter = Counter::new();
+
+#[metric(
+    name = "stream_ktls",
+    description = "number of TLS streams with record encryption offloaded to the kernel"
+)]
+pub static STREAM_KTLS: Counter = Counter::new();
+
+#[metric(
+    name = "stream_ktls_ex",
+    description = "number of TLS streams which could not be offloaded to the kernel and remain in userspace"
+)]
+pub static STREAM_KTLS_EX: Counter = Counter::new();
@@ -8,8 +8,8 @@ use std::os::unix::prelude::AsRawFd;
 use crate::*;
 
 /// A wrapper type that unifies types which represent a stream. For example,
-/// plaintext TCP streams and TLS/SSL over TCP can both be wrapped by this type.
-/// This allows dynamic behaviors at runtime, such as enabling TLS/SSL through
+/// plaintext TCP streams, TLS/SSL over TCP, and Unix domain sockets can all be
+/// wrapped by this type. This allows dynamic behaviors at runtime, such as enabling TLS/SSL through
 /// configuration or allowing clients to request an upgrade to TLS/SSL from a
 /// plaintext stream.
 pub struct Stream {
@@ -20,6 +20,7 @@ impl AsRawFd for Stream {
     fn as_raw_fd(&self) -> i32 {
         match &self.inner {
             StreamType::Tcp(s) => s.as_raw_fd(),
+            StreamType::Unix(s) => s.as_raw_fd(),
 
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.as_raw_fd(),
@@ -37,6 +38,7 @@ impl Stream {
                     Interest::READABLE
                 }
             }
+            StreamType::Unix(_) => Interest::READABLE,
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.interest(),
         }
@@ -45,6 +47,8 @@ impl Stream {
     pub fn is_established(&mut self) -> bool {
         match &mut self.inner {
             StreamType::Tcp(s) => s.is_established(),
+            // a unix stream is connected once connect returns
+            StreamType::Unix(_) => true,
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => !s.is_handshaking(),
         }
@@ -52,7 +56,7 @@ impl Stream {
 
     pub fn is_handshaking(&self) -> bool {
         match &self.inner {
-            StreamType::Tcp(_) => false,
+            StreamType::Tcp(_) | StreamType::Unix(_) => false,
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.is_handshaking(),
         }
@@ -60,7 +64,7 @@ impl Stream {
 
     pub fn do_handshake(&mut self) -> Result<()> {
         match &mut self.inner {
-            StreamType::Tcp(_) => Ok(()),
+            StreamType::Tcp(_) | StreamType::Unix(_) => Ok(()),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.do_handshake(),
         }
@@ -69,15 +73,32 @@ impl Stream {
     pub fn set_nodelay(&mut self, nodelay: bool) -> Result<()> {
         match &mut self.inner {
             StreamType::Tcp(s) => s.set_nodelay(nodelay),
+            // there is no nagle's algorithm to disable
+            StreamType::Unix(_) => Ok(()),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.set_nodelay(nodelay),
         }
     }
 
+    /// Returns the address of the remote peer. Unix domain sockets have no
+    /// such address, so an error is returned for them.
+    pub fn peer_addr(&self) -> Result<SocketAddr> {
+        match &self.inner {
+            StreamType::Tcp(s) => s.peer_addr(),
+            StreamType::Unix(_) => Err(Error::new(
+                ErrorKind::Unsupported,
+                "unix streams have no peer address",
+            )),
+            #[cfg(any(feature = "boringssl", feature = "openssl"))]
+            StreamType::TlsTcp(s) => s.peer_addr(),
+        }
+    }
+
     #[allow(clippy::let_and_return)]
     pub fn shutdown(&mut self) -> Result<bool> {
         let result = match &mut self.inner {
             StreamType::Tcp(s) => s.shutdown(Shutdown::Both).map(|_| true),
+            StreamType::Unix(s) => s.shutdown(Shutdown::Both).map(|_| true),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.shutdown().map(|v| v == ShutdownResult::Received),
         };
@@ -106,6 +127,7 @@ impl Debug for Stream {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
         match &self.inner {
             StreamType::Tcp(s) => write!(f, "{s:?}"),
+            StreamType::Unix(s) => write!(f, "{s:?}"),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => write!(f, "{s:?}"),
         }
@@ -120,6 +142,14 @@ impl From<TcpStream> for Stream {
     }
 }
 
+impl From<UnixStream> for Stream {
+    fn from(other: UnixStream) -> Self {
+        Self {
+            inner: StreamType::Unix(other),
+        }
+    }
+}
+
 #[cfg(any(feature = "boringssl", feature = "openssl"))]
 impl From<TlsTcpStream> for Stream {
     fn from(other: TlsTcpStream) -> Self {
@@ -133,6 +163,7 @@ impl Read for Stream {
     fn read(&mut self, buf: &mut [u8]) -> Result<usize> {
         match &mut self.inner {
             StreamType::Tcp(s) => s.read(buf),
+            StreamType::Unix(s) => s.read(buf),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.read(buf),
         }
@@ -143,14 +174,27 @@ impl Write for Stream {
     fn write(&mut self, buf: &[u8]) -> Result<usize> {
         match &mut self.inner {
             StreamType::Tcp(s) => s.write(buf),
+            StreamType::Unix(s) => s.write(buf),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.write(buf),
         }
     }
 
+    fn write_vectored(&mut self, bufs: &[IoSlice<'_>]) -> Result<usize> {
+        match &mut self.inner {
+            StreamType::Tcp(s) => s.write_vectored(bufs),
+            StreamType::Unix(s) => s.write_vectored(bufs),
+            // TLS records are encrypted from one buffer at a time, unless the
+            // session is offloaded to kernel TLS
+            #[cfg(any(feature = "boringssl", feature = "openssl"))]
+            StreamType::TlsTcp(s) => s.write_vectored(bufs),
+        }
+    }
+
     fn flush(&mut self) -> Result<()> {
         match &mut self.inner {
             StreamType::Tcp(s) => s.flush(),
+            StreamType::Unix(s) => s.flush(),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.flush(),
         }
@@ -161,6 +205,7 @@ impl event::Source for Stream {
     fn register(&mut self, registry: &Registry, token: Token, interest: Interest) -> Result<()> {
         match &mut self.inner {
             StreamType::Tcp(s) => s.register(registry, token, interest),
+            StreamType::Unix(s) => s.register(registry, token, interest),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.register(registry, token, interest),
         }
@@ -174,6 +219,7 @@ impl event::Source for Stream {
     ) -> Result<()> {
         match &mut self.inner {
             StreamType::Tcp(s) => s.reregister(registry, token, interest),
+            StreamType::Unix(s) => s.reregister(registry, token, interest),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.reregister(registry, token, interest),
         }
@@ -182,6 +228,7 @@ impl event::Source for Stream {
     fn deregister(&mut self, registry: &mio::Registry) -> Result<()> {
         match &mut self.inner {
             StreamType::Tcp(s) => s.deregister(registry),
+            StreamType::Unix(s) => s.deregister(registry),
             #[cfg(any(feature = "boringssl", feature = "openssl"))]
             StreamType::TlsTcp(s) => s.deregister(registry),
         }
@@ -193,6 +240,7 @@ impl event::Source for Stream {
 /// efficient than using a trait for dynamic dispatch.
 enum StreamType {
     Tcp(TcpStream),
+    Unix(UnixStream),
     #[cfg(any(feature = "boringssl", feature = "openssl"))]
     TlsTcp(TlsTcpStream),
 }
@@ -3,7 +3,7 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use crate::*;
-use std::os::unix::prelude::FromRawFd;
+use std::os::unix::prelude::{AsRawFd, FromRawFd};
 
 #[derive(PartialEq)]
 enum State {
@@ -56,6 +56,10 @@ impl TcpStream {
     pub fn set_nodelay(&mut self, nodelay: bool) -> Result<()> {
         self.inner.set_nodelay(nodelay)
     }
+
+    pub fn peer_addr(&self) -> Result<SocketAddr> {
+        self.inner.peer_addr()
+    }
 }
 
 impl Drop for TcpStream {
@@ -110,6 +114,19 @@ impl Write for TcpStream {
         }
     }
 
+    fn write_vectored(&mut self, bufs: &[IoSlice<'_>]) -> Result<usize> {
+        match self.inner.write_vectored(bufs) {
+            Ok(amt) => {
+                metric! {
+                    TCP_SEND_BYTE.add(amt as _);
+                }
+
+                Ok(amt)
+            }
+            Err(e) => Err(e),
+        }
+    }
+
     fn flush(&mut self) -> Result<()> {
         self.inner.flush()
     }
@@ -176,6 +193,73 @@ impl TcpListener {
         Ok(Self { inner })
     }
 
+    /// Wraps a listener which is already bound, such as one inherited from
+    /// another process, and makes it non-blocking.
+    pub fn from_std(listener: std::net::TcpListener) -> Result<TcpListener> {
+        listener.set_nonblocking(true)?;
+
+        let inner = mio::net::TcpListener::from_std(listener);
+
+        Ok(Self { inner })
+    }
+
+    /// Binds a listener with `SO_REUSEPORT` set, so that several listeners,
+    /// typically one per thread, may be bound to the same address. The kernel
+    /// then balances new connections across all of the listeners.
+    pub fn bind_reuseport(addr: SocketAddr) -> Result<TcpListener> {
+        let domain = match addr {
+            SocketAddr::V4(_) => libc::AF_INET,
+            SocketAddr::V6(_) => libc::AF_INET6,
+        };
+
+        let fd = unsafe { libc::socket(domain, libc::SOCK_STREAM, 0) };
+        if fd < 0 {
+            return Err(Error::last_os_error());
+        }
+
+        // take ownership right away so the socket is closed on any error
+        let l = unsafe { std::net::TcpListener::from_raw_fd(fd) };
+
+        let enable: libc::c_int = 1;
+        for option in [libc::SO_REUSEADDR, libc::SO_REUSEPORT] {
+            let ret = unsafe {
+                libc::setsockopt(
+                    fd,
+                    libc::SOL_SOCKET,
+                    option,
+                    &enable as *const libc::c_int as *const libc::c_void,
+                    core::mem::size_of::<libc::c_int>() as libc::socklen_t,
+                )
+            };
+            if ret < 0 {
+                return Err(Error::last_os_error());
+            }
+        }
+
+        let (storage, len) = crate::udp::sockaddr(addr);
+
+        if unsafe {
+            libc::bind(
+                fd,
+                &storage as *const libc::sockaddr_storage as *const libc::sockaddr,
+                len,
+            )
+        } < 0
+        {
+            return Err(Error::last_os_error());
+        }
+
+        if unsafe { libc::listen(fd, libc::SOMAXCONN) } < 0 {
+            return Err(Error::last_os_error());
+        }
+
+        l.set_nonblocking(true)?;
+
+        let inner = mio::net::TcpListener::from_std(l);
+
+        Ok(Self { inner })
+    }
+
     #[allow(clippy::let_and_return)]
     pub fn accept(&self) -> Result<(TcpStream, SocketAddr)> {
         let result = self.inner.accept().map(|(stream, addr)| {
@@ -201,6 +285,60 @@ impl TcpListener {
     pub fn local_addr(&self) -> Result<SocketAddr> {
         self.inner.local_addr()
     }
+
+    /// Enables TCP Fast Open with a queue of up to `queue` pending requests,
+    /// so that clients which connected before may send their first request
+    /// along with the SYN, saving a round trip on each new connection. Only
+    /// supported on Linux, where it takes effect if `net.ipv4.tcp_fastopen`
+    /// allows it for servers.
+    pub fn set_fastopen(&self, queue: usize) -> Result<()> {
+        #[cfg(target_os = "linux")]
+        return self.setsockopt(libc::TCP_FASTOPEN, queue as libc::c_int);
+
+        #[cfg(not(target_os = "linux"))]
+        {
+            let _ = queue;
+            Err(Error::new(
+                ErrorKind::Unsupported,
+                "tcp fast open is only supported on linux",
+            ))
+        }
+    }
+
+    /// Defers waking the listener for a new connection until its first data
+    /// arrives, or up to `secs` seconds after which the connection is
+    /// accepted anyway, so that connections are not accepted only to wait for
+    /// their first request. Only supported on Linux.
+    pub fn set_defer_accept(&self, secs: u32) -> Result<()> {
+        #[cfg(target_os = "linux")]
+        return self.setsockopt(libc::TCP_DEFER_ACCEPT, secs as libc::c_int);
+
+        #[cfg(not(target_os = "linux"))]
+        {
+            let _ = secs;
+            Err(Error::new(
+                ErrorKind::Unsupported,
+                "deferred accept is only supported on linux",
+            ))
+        }
+    }
+
+    #[cfg(target_os = "linux")]
+    fn setsockopt(&self, option: libc::c_int, value: libc::c_int) -> Result<()> {
+        let ret = unsafe {
+            libc::setsockopt(
+                self.inner.as_raw_fd(),
+                libc::IPPROTO_TCP,
+                option,
+                &value as *const libc::c_int as *const libc::c_void,
+                core::mem::size_of::<libc::c_int>() as libc::socklen_t,
+            )
+        };
+        if ret < 0 {
+            return Err(Error::last_os_error());
+        }
+        Ok(())
+    }
 }
 
 impl event::Source for TcpListener {
@@ -272,6 +410,29 @@ mod tests {
         let _ = create_listener("127.0.0.1:0");
     }
 
+    #[test]
+    fn reuseport() {
+        let first =
+            TcpListener::bind_reuseport("127.0.0.1:0".parse().unwrap()).expect("failed to bind");
+        let addr = first.local_addr().expect("listener has no local addr");
+
+        // a second listener may share the address
+        let second = TcpListener::bind_reuseport(addr).expect("failed to bind");
+        assert_eq!(second.local_addr().unwrap(), addr);
+    }
+
+    #[cfg(target_os = "linux")]
+    #[test]
+    fn defer_accept() {
+        let listener = TcpListener::bind("127.0.0.1:0").expect("failed to bind");
+        listener
+            .set_defer_accept(1)
+            .expect("failed to defer accept");
+        // fast open may be disabled for servers by the host, which still
+        // accepts the option
+        listener.set_fastopen(16).expect("failed to set fast open");
+    }
+
     #[test]
     fn connector() {
         let _ = create_connector();
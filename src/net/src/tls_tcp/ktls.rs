@@ -0,0 +1,365 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Kernel TLS offload for TLS 1.3 sessions.
+//!
+//! Once the handshake has completed, the application traffic secrets of the
+//! session are used to derive the record keys, which are installed on the
+//! socket with the `tls` upper layer protocol. From then on the kernel
+//! encrypts and decrypts records, and the stream is read and written with
+//! plain syscalls on the socket. Each direction is installed separately, so a
+//! direction which the kernel does not support remains in userspace.
+//!
+//! The traffic secrets are captured with the key log callback of the TLS
+//! library, as neither implementation exposes them directly.
+
+use crate::*;
+use std::os::fd::RawFd;
+
+// from linux/tcp.h and linux/tls.h
+#[cfg(target_os = "linux")]
+const TCP_ULP: libc::c_int = 31;
+#[cfg(target_os = "linux")]
+const SOL_TLS: libc::c_int = 282;
+#[cfg(target_os = "linux")]
+const TLS_SET_RECORD_TYPE: libc::c_int = 1;
+
+const TLS_1_3_VERSION: u16 = 0x0304;
+
+// the record type of an alert
+const ALERT: u8 = 21;
+
+/// The direction of traffic on a stream.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum Direction {
+    Tx,
+    Rx,
+}
+
+/// The hash function of a cipher suite.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum Hash {
+    Sha256,
+    Sha384,
+}
+
+/// The TLS 1.3 cipher suites which the kernel can offload.
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum Cipher {
+    Aes128Gcm,
+    Aes256Gcm,
+    Chacha20Poly1305,
+}
+
+impl Cipher {
+    /// Returns the cipher for the name of a TLS 1.3 cipher suite.
+    pub fn from_name(name: &str) -> Option<Self> {
+        match name {
+            "TLS_AES_128_GCM_SHA256" => Some(Self::Aes128Gcm),
+            "TLS_AES_256_GCM_SHA384" => Some(Self::Aes256Gcm),
+            "TLS_CHACHA20_POLY1305_SHA256" => Some(Self::Chacha20Poly1305),
+            _ => None,
+        }
+    }
+
+    pub fn hash(&self) -> Hash {
+        match self {
+            Self::Aes256Gcm => Hash::Sha384,
+            _ => Hash::Sha256,
+        }
+    }
+
+    fn key_len(&self) -> usize {
+        match self {
+            Self::Aes128Gcm => 16,
+            _ => 32,
+        }
+    }
+
+    // the cipher type from linux/tls.h
+    fn kernel_type(&self) -> u16 {
+        match self {
+            Self::Aes128Gcm => 51,
+            Self::Aes256Gcm => 52,
+            Self::Chacha20Poly1305 => 54,
+        }
+    }
+
+    // the number of bytes of the iv which the kernel takes as the salt, the
+    // remainder of the iv is taken as the iv
+    fn salt_len(&self) -> usize {
+        match self {
+            Self::Chacha20Poly1305 => 0,
+            _ => 4,
+        }
+    }
+}
+
+/// The application traffic secrets of a session, as captured from the key log
+/// callback.
+#[derive(Default)]
+pub struct Secrets {
+    client: Option<Vec<u8>>,
+    server: Option<Vec<u8>>,
+}
+
+impl Secrets {
+    /// Records the secret from a line in the NSS key log format, ignoring any
+    /// secrets other than the initial application traffic secrets.
+    pub fn record(&mut self, line: &str) {
+        let mut fields = line.split(' ');
+        let (Some(label), Some(_random), Some(secret)) =
+            (fields.next(), fields.next(), fields.next())
+        else {
+            return;
+        };
+
+        match label {
+            "CLIENT_TRAFFIC_SECRET_0" => self.client = decode_hex(secret),
+            "SERVER_TRAFFIC_SECRET_0" => self.server = decode_hex(secret),
+            _ => {}
+        }
+    }
+
+    /// Returns the secret used by a server for the provided direction.
+    pub fn server(&self, direction: Direction) -> Option<&[u8]> {
+        match direction {
+            Direction::Tx => self.server.as_deref(),
+            Direction::Rx => self.client.as_deref(),
+        }
+    }
+}
+
+fn decode_hex(hex: &str) -> Option<Vec<u8>> {
+    if hex.len() % 2 != 0 {
+        return None;
+    }
+
+    (0..hex.len())
+        .step_by(2)
+        .map(|i| u8::from_str_radix(hex.get(i..i + 2)?, 16).ok())
+        .collect()
+}
+
+/// Computes `HKDF-Expand-Label` from RFC 8446 with an empty context, for an
+/// output no longer than the hash. The `hmac` function returns the HMAC of
+/// the data with the provided hash and key.
+fn expand_label(
+    hmac: &dyn Fn(Hash, &[u8], &[u8]) -> Result<Vec<u8>>,
+    hash: Hash,
+    secret: &[u8],
+    label: &[u8],
+    len: usize,
+) -> Result<Vec<u8>> {
+    let mut info = Vec::with_capacity(4 + 6 + label.len());
+    info.extend_from_slice(&(len as u16).to_be_bytes());
+    info.push((6 + label.len()) as u8);
+    info.extend_from_slice(b"tls13 ");
+    info.extend_from_slice(label);
+    // empty context, followed by the block counter for the first block
+    info.push(0);
+    info.push(1);
+
+    let mut output = hmac(hash, secret, &info)?;
+    if output.len() < len {
+        return Err(Error::new(ErrorKind::Other, "hmac output is too short"));
+    }
+    output.truncate(len);
+    Ok(output)
+}
+
+/// Returns the `tls12_crypto_info_*` struct from linux/tls.h for the cipher,
+/// with the record key and iv derived from the traffic secret, and the
+/// sequence number of the next record.
+fn crypto_info(
+    hmac: &dyn Fn(Hash, &[u8], &[u8]) -> Result<Vec<u8>>,
+    cipher: Cipher,
+    secret: &[u8],
+    seq: u64,
+) -> Result<Vec<u8>> {
+    let key = expand_label(hmac, cipher.hash(), secret, b"key", cipher.key_len())?;
+    let iv = expand_label(hmac, cipher.hash(), secret, b"iv", 12)?;
+    let (salt, iv) = iv.split_at(cipher.salt_len());
+
+    let mut info = Vec::with_capacity(4 + 12 + 32 + 8);
+    info.extend_from_slice(&TLS_1_3_VERSION.to_ne_bytes());
+    info.extend_from_slice(&cipher.kernel_type().to_ne_bytes());
+    info.extend_from_slice(iv);
+    info.extend_from_slice(&key);
+    info.extend_from_slice(salt);
+    info.extend_from_slice(&seq.to_be_bytes());
+    Ok(info)
+}
+
+/// Attaches the kernel TLS upper layer protocol to the socket. This must
+/// succeed before keys are installed for either direction. The socket
+/// continues to send and receive unencrypted bytes until keys are installed.
+#[cfg(target_os = "linux")]
+pub fn attach(fd: RawFd) -> Result<()> {
+    let ulp = b"tls";
+    let ret = unsafe {
+        libc::setsockopt(
+            fd,
+            libc::SOL_TCP,
+            TCP_ULP,
+            ulp.as_ptr() as *const libc::c_void,
+            ulp.len() as libc::socklen_t,
+        )
+    };
+
+    if ret < 0 {
+        Err(Error::last_os_error())
+    } else {
+        Ok(())
+    }
+}
+
+/// Installs the record keys for one direction of the session on a socket to
+/// which the upper layer protocol is attached.
+#[cfg(target_os = "linux")]
+pub fn install(
+    fd: RawFd,
+    direction: Direction,
+    hmac: &dyn Fn(Hash, &[u8], &[u8]) -> Result<Vec<u8>>,
+    cipher: Cipher,
+    secret: &[u8],
+    seq: u64,
+) -> Result<()> {
+    let info = crypto_info(hmac, cipher, secret, seq)?;
+
+    let option = match direction {
+        Direction::Tx => 1,
+        Direction::Rx => 2,
+    };
+
+    let ret = unsafe {
+        libc::setsockopt(
+            fd,
+            SOL_TLS,
+            option,
+            info.as_ptr() as *const libc::c_void,
+            info.len() as libc::socklen_t,
+        )
+    };
+
+    if ret < 0 {
+        Err(Error::last_os_error())
+    } else {
+        Ok(())
+    }
+}
+
+/// Sends a close_notify alert on a socket with kernel TLS transmit installed.
+/// The kernel sends the payload as a record of the type given in the control
+/// message.
+#[cfg(target_os = "linux")]
+pub fn close_notify(fd: RawFd) -> Result<()> {
+    // a warning level close_notify
+    let mut alert = [1u8, 0u8];
+
+    let mut iov = libc::iovec {
+        iov_base: alert.as_mut_ptr() as *mut libc::c_void,
+        iov_len: alert.len(),
+    };
+
+    let space = unsafe { libc::CMSG_SPACE(1) } as usize;
+    let mut control = vec![0u8; space];
+
+    let mut msg: libc::msghdr = unsafe { core::mem::zeroed() };
+    msg.msg_iov = &mut iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.as_mut_ptr() as *mut libc::c_void;
+    msg.msg_controllen = space as _;
+
+    let ret = unsafe {
+        let cmsg = libc::CMSG_FIRSTHDR(&msg);
+        (*cmsg).cmsg_level = SOL_TLS;
+        (*cmsg).cmsg_type = TLS_SET_RECORD_TYPE;
+        (*cmsg).cmsg_len = libc::CMSG_LEN(1) as _;
+        *libc::CMSG_DATA(cmsg) = ALERT;
+
+        libc::sendmsg(fd, &msg, 0)
+    };
+
+    if ret < 0 {
+        Err(Error::last_os_error())
+    } else {
+        Ok(())
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+pub fn attach(_fd: RawFd) -> Result<()> {
+    Err(Error::new(
+        ErrorKind::Unsupported,
+        "kernel tls is not supported on this platform",
+    ))
+}
+
+#[cfg(not(target_os = "linux"))]
+pub fn install(
+    _fd: RawFd,
+    _direction: Direction,
+    _hmac: &dyn Fn(Hash, &[u8], &[u8]) -> Result<Vec<u8>>,
+    _cipher: Cipher,
+    _secret: &[u8],
+    _seq: u64,
+) -> Result<()> {
+    Err(Error::new(
+        ErrorKind::Unsupported,
+        "kernel tls is not supported on this platform",
+    ))
+}
+
+#[cfg(not(target_os = "linux"))]
+pub fn close_notify(_fd: RawFd) -> Result<()> {
+    Err(Error::new(
+        ErrorKind::Unsupported,
+        "kernel tls is not supported on this platform",
+    ))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[cfg(feature = "boringssl")]
+    use crate::tls_tcp::boringssl::hmac;
+    #[cfg(all(not(feature = "boringssl"), feature = "openssl"))]
+    use crate::tls_tcp::openssl::hmac;
+
+    #[test]
+    fn secrets() {
+        let mut secrets = Secrets::default();
+        secrets.record("CLIENT_HANDSHAKE_TRAFFIC_SECRET 00 0102");
+        secrets.record("CLIENT_TRAFFIC_SECRET_0 00 0a0b");
+        secrets.record("SERVER_TRAFFIC_SECRET_0 00 0c0d");
+        assert_eq!(secrets.server(Direction::Tx), Some(&[0x0c, 0x0d][..]));
+        assert_eq!(secrets.server(Direction::Rx), Some(&[0x0a, 0x0b][..]));
+
+        secrets.record("SERVER_TRAFFIC_SECRET_0 00 0c0");
+        assert_eq!(secrets.server(Direction::Tx), None);
+    }
+
+    // the server application traffic keys from the simple 1-RTT handshake in
+    // RFC 8448
+    #[test]
+    fn crypto_info() {
+        let secret =
+            decode_hex("a11af9f05531f856ad47116b45a950328204b4f44bfb6b3a4b4f1f3fcb631643").unwrap();
+
+        let info = super::crypto_info(&hmac, Cipher::Aes128Gcm, &secret, 7).unwrap();
+
+        let key = decode_hex("9f02283b6c9c07efc26bb9f2ac92e356").unwrap();
+        let iv = decode_hex("cf782b88dd83549aadf1e984").unwrap();
+
+        assert_eq!(info.len(), 40);
+        assert_eq!(&info[0..2], &TLS_1_3_VERSION.to_ne_bytes());
+        assert_eq!(&info[2..4], &51u16.to_ne_bytes());
+        assert_eq!(&info[4..12], &iv[4..]);
+        assert_eq!(&info[12..28], &key[..]);
+        assert_eq!(&info[28..32], &iv[..4]);
+        assert_eq!(&info[32..40], &7u64.to_be_bytes());
+    }
+}
@@ -10,6 +10,12 @@ mod boringssl;
 #[cfg(feature = "openssl")]
 mod openssl;
 
+mod ktls;
+
+/// Identifies the sessions cached by an acceptor, which are only resumed by
+/// an acceptor with the same context.
+const SESSION_ID_CONTEXT: &[u8] = b"pelikan";
+
 pub enum Implementation {
     #[cfg(feature = "boringssl")]
     Boringssl,
@@ -151,6 +157,15 @@ impl Write for TlsTcpStream {
         }
     }
 
+    fn write_vectored(&mut self, bufs: &[IoSlice<'_>]) -> Result<usize> {
+        match &mut self.inner {
+            #[cfg(feature = "boringssl")]
+            TlsTcpStreamImpl::Boringssl(s) => s.write_vectored(bufs),
+            #[cfg(feature = "openssl")]
+            TlsTcpStreamImpl::Openssl(s) => s.write_vectored(bufs),
+        }
+    }
+
     fn flush(&mut self) -> Result<()> {
         match &mut self.inner {
             #[cfg(feature = "boringssl")]
@@ -235,6 +250,8 @@ pub struct TlsTcpAcceptorBuilder {
     certificate_file: Option<PathBuf>,
     certificate_chain_file: Option<PathBuf>,
     private_key_file: Option<PathBuf>,
+    ktls: bool,
+    session_cache_size: Option<usize>,
 }
 
 impl TlsTcpAcceptorBuilder {
@@ -299,6 +316,31 @@ impl TlsTcpAcceptorBuilder {
         self.private_key_file = Some(file.as_ref().to_path_buf());
         self
     }
+
+    /// Offload record encryption and decryption to the kernel once the
+    /// handshake completes, so that negotiated streams are read and written
+    /// with plain syscalls on the socket.
+    ///
+    /// Only TLS 1.3 sessions with an AES-GCM or ChaCha20-Poly1305 cipher suite
+    /// are offloaded, and each direction falls back to userspace if the kernel
+    /// does not support it. Session tickets are not issued while this is
+    /// enabled, as they would be sent after the keys are handed to the kernel.
+    /// A client which sends a key update to an offloaded session will have the
+    /// session closed.
+    pub fn ktls(mut self, enabled: bool) -> Self {
+        self.ktls = enabled;
+        self
+    }
+
+    /// Set the number of sessions kept for resumption. Sessions are cached by
+    /// the acceptor and shared by every stream it accepts, so a client which
+    /// reconnects can resume its session with an abbreviated handshake. `None`
+    /// keeps the default size of the library, and a size of zero disables the
+    /// cache. Clients which resume TLS 1.3 sessions use session tickets.
+    pub fn session_cache_size(mut self, size: Option<usize>) -> Self {
+        self.session_cache_size = size;
+        self
+    }
 }
 
 pub struct TlsTcpConnector {
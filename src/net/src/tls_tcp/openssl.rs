@@ -5,11 +5,19 @@
 pub use ::openssl::ssl::ShutdownResult;
 
 use std::os::unix::prelude::AsRawFd;
-
-use ::openssl::ssl::{ErrorCode, Ssl, SslFiletype, SslMethod, SslStream};
+use std::sync::Mutex;
+
+use ::openssl::ex_data::Index;
+use ::openssl::hash::MessageDigest;
+use ::openssl::pkey::PKey;
+use ::openssl::sign::Signer;
+use ::openssl::ssl::{
+    ErrorCode, Ssl, SslFiletype, SslMethod, SslSessionCacheMode, SslStream, SslVersion,
+};
 use ::openssl::x509::X509;
 use foreign_types_shared_01::ForeignTypeRef;
 
+use super::{ktls, SESSION_ID_CONTEXT};
 use crate::*;
 
 #[derive(PartialEq)]
@@ -23,6 +31,11 @@ enum TlsState {
 pub struct TlsTcpStream {
     inner: SslStream<TcpStream>,
     state: TlsState,
+    // the index of the captured traffic secrets, present until the session is
+    // negotiated if it should be offloaded to kernel TLS
+    ktls: Option<Index<Ssl, Mutex<ktls::Secrets>>>,
+    ktls_tx: bool,
+    ktls_rx: bool,
 }
 
 impl AsRawFd for TlsTcpStream {
@@ -36,6 +49,10 @@ impl TlsTcpStream {
         self.inner.get_mut().set_nodelay(nodelay)
     }
 
+    pub fn peer_addr(&self) -> Result<SocketAddr> {
+        self.inner.get_ref().peer_addr()
+    }
+
     pub fn is_handshaking(&self) -> bool {
         self.state == TlsState::Handshaking
     }
@@ -52,9 +69,14 @@ impl TlsTcpStream {
             if ret > 0 {
                 metric! {
                     STREAM_HANDSHAKE.increment();
+
+                    if self.inner.ssl().session_reused() {
+                        STREAM_HANDSHAKE_RESUMED.increment();
+                    }
                 }
 
                 self.state = TlsState::Negotiated;
+                self.offload();
 
                 Ok(())
             } else {
@@ -79,10 +101,82 @@ impl TlsTcpStream {
     }
 
     pub fn shutdown(&mut self) -> Result<ShutdownResult> {
+        if self.ktls_tx {
+            ktls::close_notify(self.as_raw_fd())?;
+            return Ok(ShutdownResult::Sent);
+        }
+
         self.inner
             .shutdown()
             .map_err(|e| Error::new(ErrorKind::Other, e.to_string()))
     }
+
+    /// Installs the record keys of a negotiated TLS 1.3 session into the
+    /// kernel, if the acceptor has kernel TLS enabled. Any direction which
+    /// cannot be installed continues to be handled by the library.
+    fn offload(&mut self) {
+        let Some(index) = self.ktls.take() else {
+            return;
+        };
+
+        let fd = self.as_raw_fd();
+        let ssl = self.inner.ssl();
+
+        let cipher = ssl
+            .current_cipher()
+            .and_then(|cipher| ktls::Cipher::from_name(cipher.name()));
+
+        // records which the library has already read from the socket would be
+        // lost to the kernel, so such sessions are left in userspace
+        let (tx, rx) = match (cipher, ssl.ex_data(index)) {
+            (Some(cipher), Some(secrets))
+                if ssl.version2() == Some(SslVersion::TLS1_3)
+                    && ssl.pending() == 0
+                    && ktls::attach(fd).is_ok() =>
+            {
+                let mut secrets = secrets.lock().unwrap();
+
+                // no tickets are issued, so the first application record in
+                // each direction has a sequence number of zero
+                let install = |direction| {
+                    secrets.server(direction).is_some_and(|secret| {
+                        ktls::install(fd, direction, &hmac, cipher, secret, 0).is_ok()
+                    })
+                };
+                let offloaded = (install(ktls::Direction::Tx), install(ktls::Direction::Rx));
+
+                // the secrets are no longer needed
+                *secrets = ktls::Secrets::default();
+
+                offloaded
+            }
+            _ => (false, false),
+        };
+
+        self.ktls_tx = tx;
+        self.ktls_rx = rx;
+
+        metric! {
+            if tx || rx {
+                STREAM_KTLS.increment();
+            } else {
+                STREAM_KTLS_EX.increment();
+            }
+        }
+    }
+}
+
+/// Returns the HMAC of the data with the provided hash and key.
+pub(super) fn hmac(hash: ktls::Hash, key: &[u8], data: &[u8]) -> Result<Vec<u8>> {
+    let digest = match hash {
+        ktls::Hash::Sha256 => MessageDigest::sha256(),
+        ktls::Hash::Sha384 => MessageDigest::sha384(),
+    };
+
+    let key = PKey::hmac(key)?;
+    let mut signer = Signer::new(digest, &key)?;
+    signer.update(data)?;
+    Ok(signer.sign_to_vec()?)
 }
 
 impl Debug for TlsTcpStream {
@@ -98,6 +192,8 @@ impl Read for TlsTcpStream {
                 ErrorKind::WouldBlock,
                 "read on handshaking session would block",
             ))
+        } else if self.ktls_rx {
+            self.inner.get_mut().read(buf)
         } else {
             self.inner.read(buf)
         }
@@ -111,17 +207,34 @@ impl Write for TlsTcpStream {
                 ErrorKind::WouldBlock,
                 "write on handshaking session would block",
             ))
+        } else if self.ktls_tx {
+            self.inner.get_mut().write(buf)
         } else {
             self.inner.write(buf)
         }
     }
 
+    fn write_vectored(&mut self, bufs: &[IoSlice<'_>]) -> Result<usize> {
+        if self.ktls_tx && !self.is_handshaking() {
+            self.inner.get_mut().write_vectored(bufs)
+        } else {
+            // the library encrypts from one buffer at a time
+            let buf = bufs
+                .iter()
+                .find(|buf| !buf.is_empty())
+                .map_or(&[][..], |buf| &**buf);
+            self.write(buf)
+        }
+    }
+
     fn flush(&mut self) -> Result<()> {
         if self.is_handshaking() {
             Err(Error::new(
                 ErrorKind::WouldBlock,
                 "flush on handshaking session would block",
             ))
+        } else if self.ktls_tx {
+            self.inner.get_mut().flush()
         } else {
             self.inner.flush()
         }
@@ -152,6 +265,7 @@ impl event::Source for TlsTcpStream {
 /// streams in a structure with a uniform type.
 pub struct TlsTcpAcceptor {
     inner: ::openssl::ssl::SslContext,
+    ktls: Option<Index<Ssl, Mutex<ktls::Secrets>>>,
 }
 
 impl TlsTcpAcceptor {
@@ -271,23 +385,68 @@ impl TlsTcpAcceptor {
             }
         }
 
+        // sessions are cached by the context, which is shared by every stream
+        // it accepts, so that a client which reconnects to any worker can
+        // resume its session rather than taking a full handshake
+        match builder.session_cache_size {
+            Some(0) => {
+                acceptor.set_session_cache_mode(SslSessionCacheMode::OFF);
+            }
+            size => {
+                acceptor.set_session_cache_mode(SslSessionCacheMode::SERVER);
+                acceptor.set_session_id_context(SESSION_ID_CONTEXT)?;
+                if let Some(size) = size {
+                    acceptor.set_session_cache_size(size.min(i32::MAX as usize) as i32);
+                }
+            }
+        }
+
+        // capture the traffic secrets of each session so that the record keys
+        // can be installed into the kernel once the handshake completes
+        let ktls = if builder.ktls {
+            let index = Ssl::new_ex_index::<Mutex<ktls::Secrets>>()?;
+
+            acceptor.set_keylog_callback(move |ssl, line| {
+                if let Some(secrets) = ssl.ex_data(index) {
+                    secrets.lock().unwrap().record(line);
+                }
+            });
+
+            // tickets are sent after the handshake with records which the
+            // kernel would not know about
+            acceptor.set_num_tickets(0)?;
+
+            Some(index)
+        } else {
+            None
+        };
+
         let inner = acceptor.build().into_context();
 
-        Ok(TlsTcpAcceptor { inner })
+        Ok(TlsTcpAcceptor { inner, ktls })
     }
 
     pub fn accept(&self, stream: TcpStream) -> Result<TlsTcpStream> {
-        let ssl = Ssl::new(&self.inner)?;
+        let mut ssl = Ssl::new(&self.inner)?;
+
+        if let Some(index) = self.ktls {
+            ssl.set_ex_data(index, Mutex::new(ktls::Secrets::default()));
+        }
 
         let stream = SslStream::new(ssl, stream)?;
 
         let ret = unsafe { openssl_sys::SSL_accept(stream.ssl().as_ptr()) };
 
         if ret > 0 {
-            Ok(TlsTcpStream {
+            let mut stream = TlsTcpStream {
                 inner: stream,
                 state: TlsState::Negotiated,
-            })
+                ktls: self.ktls,
+                ktls_tx: false,
+                ktls_rx: false,
+            };
+            stream.offload();
+            Ok(stream)
         } else {
             let code = unsafe {
                 ErrorCode::from_raw(openssl_sys::SSL_get_error(stream.ssl().as_ptr(), ret))
@@ -296,6 +455,9 @@ impl TlsTcpAcceptor {
                 ErrorCode::WANT_READ | ErrorCode::WANT_WRITE => Ok(TlsTcpStream {
                     inner: stream,
                     state: TlsState::Handshaking,
+                    ktls: self.ktls,
+                    ktls_tx: false,
+                    ktls_rx: false,
                 }),
                 _ => Err(Error::new(ErrorKind::Other, "handshake failed")),
             }
@@ -431,6 +593,9 @@ impl TlsTcpConnector {
             Ok(TlsTcpStream {
                 inner: stream,
                 state: TlsState::Negotiated,
+                ktls: None,
+                ktls_tx: false,
+                ktls_rx: false,
             })
         } else {
             let code = unsafe {
@@ -440,6 +605,9 @@ impl TlsTcpConnector {
                 ErrorCode::WANT_READ | ErrorCode::WANT_WRITE => Ok(TlsTcpStream {
                     inner: stream,
                     state: TlsState::Handshaking,
+                    ktls: None,
+                    ktls_tx: false,
+                    ktls_rx: false,
                 }),
                 _ => Err(Error::new(ErrorKind::Other, "handshake failed")),
             }
@@ -0,0 +1,570 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! UDP sockets which send and receive datagrams in batches. On Linux a batch
+//! is received with one call to `recvmmsg` and sent with one call to
+//! `sendmmsg`, and a message of several datagrams of the same size is handed
+//! to the kernel to segment with generic segmentation offload (GSO) where it
+//! is supported. Elsewhere each datagram is sent and received on its own.
+
+use crate::*;
+use std::cell::Cell;
+use std::net::{Ipv4Addr, Ipv6Addr, SocketAddrV4, SocketAddrV6};
+use std::os::unix::prelude::FromRawFd;
+
+#[cfg(target_os = "linux")]
+use std::os::unix::io::AsRawFd;
+
+// the kernel limits the number of segments and the size of a message which it
+// segments with GSO
+#[cfg(target_os = "linux")]
+const GSO_MAX_SEGMENTS: usize = 64;
+#[cfg(target_os = "linux")]
+const GSO_MAX_BYTES: usize = 65000;
+
+pub struct UdpSocket {
+    inner: mio::net::UdpSocket,
+    // cleared once the kernel refuses a message to segment
+    gso: Cell<bool>,
+}
+
+impl UdpSocket {
+    /// Binds a socket with `SO_REUSEPORT` set, so that several sockets,
+    /// typically one per thread, may be bound to the same address. The kernel
+    /// then balances the datagrams from each peer across all of the sockets.
+    pub fn bind_reuseport(addr: SocketAddr) -> Result<UdpSocket> {
+        let domain = match addr {
+            SocketAddr::V4(_) => libc::AF_INET,
+            SocketAddr::V6(_) => libc::AF_INET6,
+        };
+
+        let fd = unsafe { libc::socket(domain, libc::SOCK_DGRAM, 0) };
+        if fd < 0 {
+            return Err(Error::last_os_error());
+        }
+
+        // take ownership right away so the socket is closed on any error
+        let s = unsafe { std::net::UdpSocket::from_raw_fd(fd) };
+
+        let enable: libc::c_int = 1;
+        for option in [libc::SO_REUSEADDR, libc::SO_REUSEPORT] {
+            let ret = unsafe {
+                libc::setsockopt(
+                    fd,
+                    libc::SOL_SOCKET,
+                    option,
+                    &enable as *const libc::c_int as *const libc::c_void,
+                    core::mem::size_of::<libc::c_int>() as libc::socklen_t,
+                )
+            };
+            if ret < 0 {
+                return Err(Error::last_os_error());
+            }
+        }
+
+        let (storage, len) = sockaddr(addr);
+        if unsafe {
+            libc::bind(
+                fd,
+                &storage as *const libc::sockaddr_storage as *const libc::sockaddr,
+                len,
+            )
+        } < 0
+        {
+            return Err(Error::last_os_error());
+        }
+
+        s.set_nonblocking(true)?;
+
+        Ok(Self {
+            inner: mio::net::UdpSocket::from_std(s),
+            gso: Cell::new(cfg!(target_os = "linux")),
+        })
+    }
+
+    pub fn local_addr(&self) -> Result<SocketAddr> {
+        self.inner.local_addr()
+    }
+
+    /// Receives datagrams into the batch, replacing those it held, and returns
+    /// the number received. Datagrams which are larger than the slots of the
+    /// batch are dropped. Returns `WouldBlock` if there are none to receive.
+    pub fn recv_batch(&self, batch: &mut RecvBatch) -> Result<usize> {
+        batch.lens.clear();
+        batch.peers.clear();
+
+        let received = self.recv_into(batch)?;
+
+        metric! {
+            UDP_RECV.add(received as _);
+            UDP_RECV_BYTE.add(batch.lens.iter().sum::<usize>() as _);
+        }
+
+        Ok(received)
+    }
+
+    #[cfg(target_os = "linux")]
+    fn recv_into(&self, batch: &mut RecvBatch) -> Result<usize> {
+        let slots = batch.slots;
+        let size = batch.size;
+        let base = batch.data.as_mut_ptr();
+
+        let mut addrs: Vec<libc::sockaddr_storage> = vec![unsafe { core::mem::zeroed() }; slots];
+        let mut iovecs: Vec<libc::iovec> = (0..slots)
+            .map(|slot| libc::iovec {
+                iov_base: unsafe { base.add(slot * size) } as *mut libc::c_void,
+                iov_len: size,
+            })
+            .collect();
+        let mut headers: Vec<libc::mmsghdr> = (0..slots)
+            .map(|slot| {
+                let mut header: libc::mmsghdr = unsafe { core::mem::zeroed() };
+                header.msg_hdr.msg_name = &mut addrs[slot] as *mut _ as *mut libc::c_void;
+                header.msg_hdr.msg_namelen =
+                    core::mem::size_of::<libc::sockaddr_storage>() as libc::socklen_t;
+                header.msg_hdr.msg_iov = &mut iovecs[slot];
+                header.msg_hdr.msg_iovlen = 1;
+                header
+            })
+            .collect();
+
+        let ret = unsafe {
+            libc::recvmmsg(
+                self.inner.as_raw_fd(),
+                headers.as_mut_ptr(),
+                slots as _,
+                libc::MSG_DONTWAIT as _,
+                core::ptr::null_mut(),
+            )
+        };
+        if ret < 0 {
+            return Err(Error::last_os_error());
+        }
+
+        let received = ret as usize;
+        for (header, addr) in headers.iter().zip(addrs.iter()).take(received) {
+            let truncated = header.msg_hdr.msg_flags & libc::MSG_TRUNC != 0;
+            match socket_addr(addr) {
+                Some(peer) if !truncated => {
+                    batch.lens.push(header.msg_len as usize);
+                    batch.peers.push(peer);
+                }
+                _ => {
+                    // kept empty so that the datagrams stay in order
+                    batch.lens.push(0);
+                    batch.peers.push(SocketAddr::from(([0, 0, 0, 0], 0)));
+                }
+            }
+        }
+
+        Ok(received)
+    }
+
+    #[cfg(not(target_os = "linux"))]
+    fn recv_into(&self, batch: &mut RecvBatch) -> Result<usize> {
+        let size = batch.size;
+        for slot in 0..batch.slots {
+            let buf = &mut batch.data[slot * size..(slot + 1) * size];
+            match self.inner.recv_from(buf) {
+                Ok((len, peer)) => {
+                    batch.lens.push(len);
+                    batch.peers.push(peer);
+                }
+                Err(e) if e.kind() == ErrorKind::WouldBlock && slot > 0 => break,
+                Err(e) => return Err(e),
+            }
+        }
+        Ok(batch.lens.len())
+    }
+
+    /// Sends the messages of the batch, and clears it. Returns the number of
+    /// messages sent, as those left once the socket would block are dropped.
+    pub fn send_batch(&self, batch: &mut SendBatch) -> Result<usize> {
+        let result = self.send_from(batch);
+
+        metric! {
+            if let Ok(sent) = result {
+                let bytes: usize = batch.messages[..sent].iter().map(|m| m.end - m.start).sum();
+                UDP_SEND.add(sent as _);
+                UDP_SEND_BYTE.add(bytes as _);
+                UDP_SEND_DROP.add((batch.messages.len() - sent) as _);
+            }
+        }
+
+        batch.clear();
+        result
+    }
+
+    #[cfg(target_os = "linux")]
+    fn send_from(&self, batch: &SendBatch) -> Result<usize> {
+        let mut sent = 0;
+        while sent < batch.messages.len() {
+            match self.sendmmsg(batch, sent) {
+                Ok(0) => break,
+                Ok(count) => sent += count,
+                Err(e) if e.kind() == ErrorKind::WouldBlock => break,
+                // kernels without GSO refuse the segment size, so the
+                // datagrams are sent one at a time from then on
+                Err(e)
+                    if self.gso.get()
+                        && matches!(e.raw_os_error(), Some(libc::EIO | libc::EINVAL)) =>
+                {
+                    self.gso.set(false);
+
+                    metric! {
+                        UDP_GSO_EX.increment();
+                    }
+                }
+                Err(_) if sent > 0 => break,
+                Err(e) => return Err(e),
+            }
+        }
+        Ok(sent)
+    }
+
+    /// Sends the messages of the batch from the provided one with a single
+    /// call to `sendmmsg`, and returns the number of messages which were sent
+    /// in full. The datagrams sent of a message which was cut short are sent
+    /// again with the rest of it.
+    #[cfg(target_os = "linux")]
+    fn sendmmsg(&self, batch: &SendBatch, from: usize) -> Result<usize> {
+        let gso = self.gso.get();
+        let messages = &batch.messages[from..];
+        let base = batch.data.as_ptr();
+
+        // with GSO each message is one entry, otherwise each of its datagrams
+        let entries: Vec<(usize, usize, usize)> = messages
+            .iter()
+            .enumerate()
+            .flat_map(|(index, m)| {
+                let step = if gso {
+                    m.segment * m.gso_segments()
+                } else {
+                    m.segment
+                };
+                (m.start..m.end)
+                    .step_by(step)
+                    .map(move |start| (index, start, (start + step).min(m.end)))
+            })
+            .collect();
+
+        let addrs: Vec<(libc::sockaddr_storage, libc::socklen_t)> =
+            messages.iter().map(|m| sockaddr(m.peer)).collect();
+        let mut iovecs: Vec<libc::iovec> = entries
+            .iter()
+            .map(|(_, start, end)| libc::iovec {
+                iov_base: unsafe { base.add(*start) } as *mut libc::c_void,
+                iov_len: end - start,
+            })
+            .collect();
+        // holds the control message with the segment size for GSO, aligned for
+        // the header of the control message
+        let mut controls: Vec<[u64; 4]> = vec![[0; 4]; entries.len()];
+        let mut headers: Vec<libc::mmsghdr> = Vec::with_capacity(entries.len());
+
+        for (entry, (index, start, end)) in entries.iter().enumerate() {
+            let message = &messages[*index];
+            let (addr, len) = &addrs[*index];
+
+            let mut header: libc::mmsghdr = unsafe { core::mem::zeroed() };
+            header.msg_hdr.msg_name = addr as *const _ as *mut libc::c_void;
+            header.msg_hdr.msg_namelen = *len;
+            header.msg_hdr.msg_iov = &mut iovecs[entry];
+            header.msg_hdr.msg_iovlen = 1;
+
+            if gso && end - start > message.segment {
+                let space = unsafe { libc::CMSG_SPACE(core::mem::size_of::<u16>() as _) };
+                header.msg_hdr.msg_control = controls[entry].as_mut_ptr() as *mut libc::c_void;
+                header.msg_hdr.msg_controllen = space as _;
+                unsafe {
+                    let cmsg = libc::CMSG_FIRSTHDR(&header.msg_hdr);
+                    (*cmsg).cmsg_level = libc::SOL_UDP;
+                    (*cmsg).cmsg_type = libc::UDP_SEGMENT;
+                    (*cmsg).cmsg_len = libc::CMSG_LEN(core::mem::size_of::<u16>() as _) as _;
+                    core::ptr::write_unaligned(
+                        libc::CMSG_DATA(cmsg) as *mut u16,
+                        message.segment as u16,
+                    );
+                }
+            }
+
+            headers.push(header);
+        }
+
+        let ret = unsafe {
+            libc::sendmmsg(
+                self.inner.as_raw_fd(),
+                headers.as_mut_ptr(),
+                headers.len() as _,
+                libc::MSG_DONTWAIT as _,
+            )
+        };
+        if ret < 0 {
+            return Err(Error::last_os_error());
+        }
+
+        // a message counts as sent once its last entry is
+        let sent = ret as usize;
+        Ok(entries[..sent]
+            .iter()
+            .filter(|(index, _, end)| *end == messages[*index].end)
+            .count())
+    }
+
+    #[cfg(not(target_os = "linux"))]
+    fn send_from(&self, batch: &SendBatch) -> Result<usize> {
+        let mut sent = 0;
+        'messages: for message in batch.messages.iter() {
+            for start in (message.start..message.end).step_by(message.segment) {
+                let end = (start + message.segment).min(message.end);
+                match self.inner.send_to(&batch.data[start..end], message.peer) {
+                    Ok(_) => {}
+                    Err(e) if e.kind() == ErrorKind::WouldBlock => break 'messages,
+                    Err(_) if sent > 0 => break 'messages,
+                    Err(e) => return Err(e),
+                }
+            }
+            sent += 1;
+        }
+        Ok(sent)
+    }
+}
+
+impl event::Source for UdpSocket {
+    fn register(
+        &mut self,
+        registry: &mio::Registry,
+        token: mio::Token,
+        interest: mio::Interest,
+    ) -> Result<()> {
+        self.inner.register(registry, token, interest)
+    }
+
+    fn reregister(
+        &mut self,
+        registry: &mio::Registry,
+        token: mio::Token,
+        interest: mio::Interest,
+    ) -> Result<()> {
+        self.inner.reregister(registry, token, interest)
+    }
+
+    fn deregister(&mut self, registry: &mio::Registry) -> Result<()> {
+        self.inner.deregister(registry)
+    }
+}
+
+/// A batch of received datagrams, each held in a slot of a fixed size.
+pub struct RecvBatch {
+    data: Vec<u8>,
+    slots: usize,
+    size: usize,
+    lens: Vec<usize>,
+    peers: Vec<SocketAddr>,
+}
+
+impl RecvBatch {
+    /// Creates a batch of the provided number of slots, each of which holds a
+    /// datagram of up to `size` bytes.
+    pub fn new(slots: usize, size: usize) -> Self {
+        Self {
+            data: vec![0; slots * size],
+            slots,
+            size,
+            lens: Vec::with_capacity(slots),
+            peers: Vec::with_capacity(slots),
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.lens.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.lens.is_empty()
+    }
+
+    /// Returns the datagrams in the order they were received, along with the
+    /// peer each was received from. Datagrams which were dropped are empty.
+    pub fn iter(&self) -> impl Iterator<Item = (&[u8], SocketAddr)> {
+        self.lens
+            .iter()
+            .zip(self.peers.iter())
+            .enumerate()
+            .map(|(slot, (len, peer))| {
+                let start = slot * self.size;
+                (&self.data[start..start + len], *peer)
+            })
+    }
+}
+
+/// A batch of messages to send. Each message is sent to one peer as one or
+/// more datagrams, all but the last of which are of the segment size.
+#[derive(Default)]
+pub struct SendBatch {
+    data: Vec<u8>,
+    messages: Vec<Message>,
+}
+
+struct Message {
+    peer: SocketAddr,
+    start: usize,
+    end: usize,
+    segment: usize,
+}
+
+impl Message {
+    /// Returns the number of datagrams of the message which are sent as one
+    /// entry with GSO.
+    #[cfg(target_os = "linux")]
+    fn gso_segments(&self) -> usize {
+        (GSO_MAX_BYTES / self.segment).clamp(1, GSO_MAX_SEGMENTS)
+    }
+}
+
+impl SendBatch {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Returns the buffer which the datagrams of the next message are written
+    /// to, after any written for earlier messages.
+    pub fn buffer(&mut self) -> &mut Vec<u8> {
+        &mut self.data
+    }
+
+    /// Ends the message made of the bytes written to the buffer since the
+    /// last message, which is sent to the peer in datagrams of the segment
+    /// size.
+    pub fn push(&mut self, peer: SocketAddr, segment: usize) {
+        let start = self.messages.last().map(|m| m.end).unwrap_or(0);
+        let end = self.data.len();
+        if end > start {
+            self.messages.push(Message {
+                peer,
+                start,
+                end,
+                segment: segment.max(1),
+            });
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.messages.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.messages.is_empty()
+    }
+
+    pub fn clear(&mut self) {
+        self.data.clear();
+        self.messages.clear();
+    }
+}
+
+/// Converts the address to the form taken by the socket calls.
+pub(crate) fn sockaddr(addr: SocketAddr) -> (libc::sockaddr_storage, libc::socklen_t) {
+    let mut storage: libc::sockaddr_storage = unsafe { core::mem::zeroed() };
+    let len = match addr {
+        SocketAddr::V4(addr) => {
+            let sin = &mut storage as *mut libc::sockaddr_storage as *mut libc::sockaddr_in;
+            unsafe {
+                (*sin).sin_family = libc::AF_INET as libc::sa_family_t;
+                (*sin).sin_port = addr.port().to_be();
+                (*sin).sin_addr = libc::in_addr {
+                    s_addr: u32::from(*addr.ip()).to_be(),
+                };
+            }
+            core::mem::size_of::<libc::sockaddr_in>()
+        }
+        SocketAddr::V6(addr) => {
+            let sin6 = &mut storage as *mut libc::sockaddr_storage as *mut libc::sockaddr_in6;
+            unsafe {
+                (*sin6).sin6_family = libc::AF_INET6 as libc::sa_family_t;
+                (*sin6).sin6_port = addr.port().to_be();
+                (*sin6).sin6_flowinfo = addr.flowinfo();
+                (*sin6).sin6_addr = libc::in6_addr {
+                    s6_addr: addr.ip().octets(),
+                };
+                (*sin6).sin6_scope_id = addr.scope_id();
+            }
+            core::mem::size_of::<libc::sockaddr_in6>()
+        }
+    };
+    (storage, len as libc::socklen_t)
+}
+
+/// Converts an address filled in by the socket calls, if it is an internet
+/// address.
+#[cfg_attr(not(target_os = "linux"), allow(dead_code))]
+fn socket_addr(storage: &libc::sockaddr_storage) -> Option<SocketAddr> {
+    match storage.ss_family as libc::c_int {
+        libc::AF_INET => {
+            let sin = unsafe { &*(storage as *const _ as *const libc::sockaddr_in) };
+            let ip = Ipv4Addr::from(u32::from_be(sin.sin_addr.s_addr));
+            Some(SocketAddrV4::new(ip, u16::from_be(sin.sin_port)).into())
+        }
+        libc::AF_INET6 => {
+            let sin6 = unsafe { &*(storage as *const _ as *const libc::sockaddr_in6) };
+            let ip = Ipv6Addr::from(sin6.sin6_addr.s6_addr);
+            Some(
+                SocketAddrV6::new(
+                    ip,
+                    u16::from_be(sin6.sin6_port),
+                    sin6.sin6_flowinfo,
+                    sin6.sin6_scope_id,
+                )
+                .into(),
+            )
+        }
+        _ => None,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn batch() {
+        let server =
+            UdpSocket::bind_reuseport("127.0.0.1:0".parse().unwrap()).expect("failed to bind");
+        let server_addr = server.local_addr().unwrap();
+        let client =
+            UdpSocket::bind_reuseport("127.0.0.1:0".parse().unwrap()).expect("failed to bind");
+        let client_addr = client.local_addr().unwrap();
+
+        // two messages, the second of which is sent as three datagrams
+        let mut send = SendBatch::new();
+        send.buffer().extend_from_slice(b"ping");
+        send.push(server_addr, 4);
+        send.buffer().extend_from_slice(b"aaaabbbbcc");
+        send.push(server_addr, 4);
+        assert_eq!(send.len(), 2);
+        assert_eq!(client.send_batch(&mut send).expect("failed to send"), 2);
+        assert!(send.is_empty());
+
+        let mut recv = RecvBatch::new(8, 64);
+        let mut datagrams = Vec::new();
+        for _ in 0..100 {
+            match server.recv_batch(&mut recv) {
+                Ok(_) => datagrams.extend(recv.iter().map(|(d, peer)| (d.to_vec(), peer))),
+                Err(e) if e.kind() == ErrorKind::WouldBlock => {}
+                Err(e) => panic!("failed to receive: {e}"),
+            }
+            if datagrams.len() == 4 {
+                break;
+            }
+            std::thread::sleep(std::time::Duration::from_millis(10));
+        }
+
+        let expected: Vec<&[u8]> = vec![b"ping", b"aaaa", b"bbbb", b"cc"];
+        assert_eq!(datagrams.len(), expected.len());
+        for ((datagram, peer), expected) in datagrams.iter().zip(expected) {
+            assert_eq!(datagram.as_slice(), expected);
+            assert_eq!(*peer, client_addr);
+        }
+    }
+}
@@ -0,0 +1,285 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use crate::*;
+use std::path::{Path, PathBuf};
+
+pub struct UnixStream {
+    inner: mio::net::UnixStream,
+}
+
+impl UnixStream {
+    pub fn connect<P: AsRef<Path>>(path: P) -> Result<Self> {
+        let inner = mio::net::UnixStream::connect(path)?;
+
+        metric! {
+            UNIX_CONN_CURR.increment();
+            UNIX_CONNECT.increment();
+        }
+
+        Ok(Self { inner })
+    }
+}
+
+impl Drop for UnixStream {
+    fn drop(&mut self) {
+        metric! {
+            UNIX_CONN_CURR.decrement();
+            UNIX_CLOSE.increment();
+        }
+    }
+}
+
+impl Debug for UnixStream {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        write!(f, "{:?}", self.inner)
+    }
+}
+
+impl Deref for UnixStream {
+    type Target = mio::net::UnixStream;
+
+    fn deref(&self) -> &Self::Target {
+        &self.inner
+    }
+}
+
+impl Read for UnixStream {
+    fn read(&mut self, buf: &mut [u8]) -> Result<usize> {
+        match self.inner.read(buf) {
+            Ok(amt) => {
+                metric! {
+                    UNIX_RECV_BYTE.add(amt as _);
+                }
+
+                Ok(amt)
+            }
+            Err(e) => Err(e),
+        }
+    }
+}
+
+impl Write for UnixStream {
+    fn write(&mut self, buf: &[u8]) -> Result<usize> {
+        match self.inner.write(buf) {
+            Ok(amt) => {
+                metric! {
+                    UNIX_SEND_BYTE.add(amt as _);
+                }
+
+                Ok(amt)
+            }
+            Err(e) => Err(e),
+        }
+    }
+
+    fn write_vectored(&mut self, bufs: &[IoSlice<'_>]) -> Result<usize> {
+        match self.inner.write_vectored(bufs) {
+            Ok(amt) => {
+                metric! {
+                    UNIX_SEND_BYTE.add(amt as _);
+                }
+
+                Ok(amt)
+            }
+            Err(e) => Err(e),
+        }
+    }
+
+    fn flush(&mut self) -> Result<()> {
+        self.inner.flush()
+    }
+}
+
+impl event::Source for UnixStream {
+    fn register(
+        &mut self,
+        registry: &mio::Registry,
+        token: mio::Token,
+        interest: mio::Interest,
+    ) -> Result<()> {
+        self.inner.register(registry, token, interest)
+    }
+
+    fn reregister(
+        &mut self,
+        registry: &mio::Registry,
+        token: mio::Token,
+        interest: mio::Interest,
+    ) -> Result<()> {
+        self.inner.reregister(registry, token, interest)
+    }
+
+    fn deregister(&mut self, registry: &mio::Registry) -> Result<()> {
+        self.inner.deregister(registry)
+    }
+}
+
+/// A listener on a Unix domain socket, for clients on the same host which do
+/// not need to pay for the TCP/IP stack, such as a sidecar proxy.
+pub struct UnixListener {
+    inner: mio::net::UnixListener,
+    path: PathBuf,
+}
+
+impl Deref for UnixListener {
+    type Target = mio::net::UnixListener;
+
+    fn deref(&self) -> &Self::Target {
+        &self.inner
+    }
+}
+
+impl UnixListener {
+    /// Binds a listener to the socket at the path. A socket left at the path
+    /// by a previous process is removed first, but any other kind of file is
+    /// not and causes an error. The socket is removed when the listener is
+    /// dropped.
+    pub fn bind<P: AsRef<Path>>(path: P) -> Result<UnixListener> {
+        let path = path.as_ref();
+
+        if let Ok(metadata) = std::fs::symlink_metadata(path) {
+            use std::os::unix::fs::FileTypeExt;
+
+            if metadata.file_type().is_socket() {
+                std::fs::remove_file(path)?;
+            }
+        }
+
+        let inner = mio::net::UnixListener::bind(path)?;
+
+        Ok(Self {
+            inner,
+            path: path.to_path_buf(),
+        })
+    }
+
+    #[allow(clippy::let_and_return)]
+    pub fn accept(&self) -> Result<UnixStream> {
+        let result = self
+            .inner
+            .accept()
+            .map(|(stream, _addr)| UnixStream { inner: stream });
+
+        metric! {
+            if result.is_ok() {
+                UNIX_ACCEPT.increment();
+                UNIX_CONN_CURR.increment();
+            }
+        }
+
+        result
+    }
+
+    /// The path of the socket the listener is bound to.
+    pub fn path(&self) -> &Path {
+        &self.path
+    }
+}
+
+impl Drop for UnixListener {
+    fn drop(&mut self) {
+        let _ = std::fs::remove_file(&self.path);
+    }
+}
+
+impl event::Source for UnixListener {
+    fn register(
+        &mut self,
+        registry: &mio::Registry,
+        token: mio::Token,
+        interests: mio::Interest,
+    ) -> Result<()> {
+        self.inner.register(registry, token, interests)
+    }
+
+    fn reregister(
+        &mut self,
+        registry: &mio::Registry,
+        token: mio::Token,
+        interests: mio::Interest,
+    ) -> Result<()> {
+        self.inner.reregister(registry, token, interests)
+    }
+
+    fn deregister(&mut self, registry: &mio::Registry) -> Result<()> {
+        self.inner.deregister(registry)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn socket_path(name: &str) -> PathBuf {
+        std::env::temp_dir().join(format!("pelikan-net-{}-{name}.sock", std::process::id()))
+    }
+
+    #[test]
+    fn listener() {
+        let path = socket_path("listener");
+
+        let listener = UnixListener::bind(&path).expect("failed to bind");
+        assert!(path.exists());
+
+        // a socket left behind is replaced
+        std::mem::forget(listener);
+        let listener = UnixListener::bind(&path).expect("failed to bind again");
+
+        drop(listener);
+        assert!(!path.exists());
+    }
+
+    #[test]
+    fn ping_pong() {
+        let path = socket_path("ping_pong");
+        let listener = Listener::from(UnixListener::bind(&path).expect("failed to bind"));
+
+        let mut client_stream =
+            Stream::from(UnixStream::connect(&path).expect("failed to connect"));
+        std::thread::sleep(std::time::Duration::from_millis(100));
+        let mut server_stream = listener.accept().expect("failed to accept");
+
+        assert!(client_stream.is_established());
+        assert!(server_stream.is_established());
+
+        client_stream
+            .write_all(b"PING\r\n")
+            .expect("failed to write");
+        client_stream.flush().expect("failed to flush");
+
+        std::thread::sleep(std::time::Duration::from_millis(100));
+
+        let mut buf = [0; 4096];
+
+        match server_stream.read(&mut buf) {
+            Ok(6) => {
+                assert_eq!(&buf[0..6], b"PING\r\n");
+                server_stream
+                    .write_all(b"PONG\r\n")
+                    .expect("failed to write");
+            }
+            Ok(n) => {
+                panic!("read: {n} bytes but expected 6");
+            }
+            Err(e) => {
+                panic!("error reading: {e}");
+            }
+        }
+
+        std::thread::sleep(std::time::Duration::from_millis(100));
+
+        match client_stream.read(&mut buf) {
+            Ok(6) => {
+                assert_eq!(&buf[0..6], b"PONG\r\n");
+            }
+            Ok(n) => {
+                panic!("read: {n} bytes but expected 6");
+            }
+            Err(e) => {
+                panic!("error reading: {e}");
+            }
+        }
+    }
+}
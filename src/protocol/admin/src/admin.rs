@@ -9,7 +9,6 @@
 
 use crate::*;
 use common::bytes::SliceExtension;
-use metriken::*;
 
 use std::io::{Error, ErrorKind, Result};
 
@@ -19,8 +18,21 @@ use std::io::{Error, ErrorKind, Result};
 #[derive(PartialEq, Eq, Debug)]
 pub enum AdminRequest {
     FlushAll,
+    /// `invalidate <prefix>`, invalidates every item whose key starts with
+    /// the prefix
+    Invalidate(Box<[u8]>),
     Stats,
+    /// `stats segments`, the state of the segments of segcache storage
+    StatsSegments,
+    /// `stats hotkeys`, the hottest keys sampled by segcache storage
+    StatsHotkeys,
+    /// `stats partitions`, the counters of each partition of segcache storage
+    StatsPartitions,
+    /// `stats prefixes`, the counters of each key prefix of segcache storage
+    StatsPrefixes,
     Version,
+    /// `reload`, applies the tunables of the config to the running process
+    Reload,
     Quit,
 }
 
@@ -46,10 +58,28 @@ impl Parse<AdminRequest> for AdminRequestParser {
             let mut single_byte_windows = trimmed_buffer.windows(1);
             if let Some(command_verb_end) = single_byte_windows.position(|w| w == b" ") {
                 let command_verb = &trimmed_buffer[0..command_verb_end];
-                // TODO(bmartin): 'stats slab' will go here eventually which will
-                // remove the need for ignoring this lint.
-                #[allow(clippy::match_single_binding)]
-                match command_verb {
+                let argument = trimmed_buffer[command_verb_end..].trim();
+                match (command_verb, argument) {
+                    (b"stats", b"segments") => Ok(ParseOk::new(
+                        AdminRequest::StatsSegments,
+                        command_end + CRLF.len(),
+                    )),
+                    (b"stats", b"hotkeys") => Ok(ParseOk::new(
+                        AdminRequest::StatsHotkeys,
+                        command_end + CRLF.len(),
+                    )),
+                    (b"stats", b"partitions") => Ok(ParseOk::new(
+                        AdminRequest::StatsPartitions,
+                        command_end + CRLF.len(),
+                    )),
+                    (b"stats", b"prefixes") => Ok(ParseOk::new(
+                        AdminRequest::StatsPrefixes,
+                        command_end + CRLF.len(),
+                    )),
+                    (b"invalidate", prefix) if !prefix.contains(&b' ') => Ok(ParseOk::new(
+                        AdminRequest::Invalidate(prefix.into()),
+                        command_end + CRLF.len(),
+                    )),
                     _ => Err(Error::from(ErrorKind::InvalidInput)),
                 }
             } else {
@@ -60,6 +90,7 @@ impl Parse<AdminRequest> for AdminRequestParser {
                     )),
                     b"stats" => Ok(ParseOk::new(AdminRequest::Stats, command_end + CRLF.len())),
                     b"quit" => Ok(ParseOk::new(AdminRequest::Quit, command_end + CRLF.len())),
+                    b"reload" => Ok(ParseOk::new(AdminRequest::Reload, command_end + CRLF.len())),
                     b"version" => Ok(ParseOk::new(
                         AdminRequest::Version,
                         command_end + CRLF.len(),
@@ -90,6 +121,9 @@ impl Compose for Version {
 pub enum AdminResponse {
     Hangup,
     Ok,
+    /// A response which was composed by the caller, such as the report of
+    /// `stats segments`
+    Report(String),
     Stats,
     Version(Version),
 }
@@ -103,6 +137,10 @@ impl AdminResponse {
         Self::Ok
     }
 
+    pub fn report(report: String) -> Self {
+        Self::Report(report)
+    }
+
     pub fn stats() -> Self {
         Self::Stats
     }
@@ -120,44 +158,21 @@ impl Compose for AdminResponse {
                 buf.put_slice(b"OK\r\n");
                 4
             }
-            Self::Stats => {
-                let message = memcache_stats();
+            Self::Report(report) => {
+                buf.put_slice(report.as_bytes());
+                report.len()
+            }
+            Self::Stats => with_stats(StatsFormat::Memcache, |message| {
                 buf.put_slice(message.as_bytes());
                 message.len()
-            }
+            }),
             Self::Version(v) => v.compose(buf),
         }
     }
 }
 
 pub fn memcache_stats() -> String {
-    let snapshots = SNAPSHOTS.read();
-
-    let mut data = Vec::new();
-
-    for metric in &metriken::metrics() {
-        let any = match metric.as_any() {
-            Some(any) => any,
-            None => {
-                continue;
-            }
-        };
-
-        if let Some(counter) = any.downcast_ref::<Counter>() {
-            data.push(format!("STAT {} {}\r\n", metric.name(), counter.value()));
-        } else if let Some(gauge) = any.downcast_ref::<Gauge>() {
-            data.push(format!("STAT {} {}\r\n", metric.name(), gauge.value()));
-        } else if any.downcast_ref::<AtomicHistogram>().is_some()
-            || any.downcast_ref::<RwLockHistogram>().is_some()
-        {
-            for (label, _percentile, value) in snapshots.percentiles(metric.name()) {
-                data.push(format!("STAT {}_{} {}\r\n", metric.name(), label, value,));
-            }
-        }
-    }
-
-    data.sort();
-    data.join("\r\n") + "END\r\n"
+    with_stats(StatsFormat::Memcache, str::to_owned)
 }
 
 #[cfg(test)]
@@ -187,6 +202,20 @@ mod tests {
         assert_eq!(parsed.unwrap().into_inner(), AdminRequest::FlushAll);
     }
 
+    #[test]
+    fn parse_invalidate() {
+        let parser = AdminRequestParser::new();
+
+        let parsed = parser.parse(b"invalidate user:123:\r\n");
+        assert!(parsed.is_ok());
+        assert_eq!(
+            parsed.unwrap().into_inner(),
+            AdminRequest::Invalidate(b"user:123:".to_vec().into_boxed_slice())
+        );
+
+        assert!(parser.parse(b"invalidate a b\r\n").is_err());
+    }
+
     #[test]
     fn parse_quit() {
         let parser = AdminRequestParser::new();
@@ -196,6 +225,15 @@ mod tests {
         assert_eq!(parsed.unwrap().into_inner(), AdminRequest::Quit);
     }
 
+    #[test]
+    fn parse_reload() {
+        let parser = AdminRequestParser::new();
+
+        let parsed = parser.parse(b"reload\r\n");
+        assert!(parsed.is_ok());
+        assert_eq!(parsed.unwrap().into_inner(), AdminRequest::Reload);
+    }
+
     #[test]
     fn parse_stats() {
         let parser = AdminRequestParser::new();
@@ -205,6 +243,34 @@ mod tests {
         assert_eq!(parsed.unwrap().into_inner(), AdminRequest::Stats);
     }
 
+    #[test]
+    fn parse_stats_segments() {
+        let parser = AdminRequestParser::new();
+
+        let parsed = parser.parse(b"stats segments\r\n");
+        assert!(parsed.is_ok());
+        assert_eq!(parsed.unwrap().into_inner(), AdminRequest::StatsSegments);
+
+        let parsed = parser.parse(b"stats  segments \r\n");
+        assert!(parsed.is_ok());
+        assert_eq!(parsed.unwrap().into_inner(), AdminRequest::StatsSegments);
+
+        let parsed = parser.parse(b"stats hotkeys\r\n");
+        assert!(parsed.is_ok());
+        assert_eq!(parsed.unwrap().into_inner(), AdminRequest::StatsHotkeys);
+
+        let parsed = parser.parse(b"stats partitions\r\n");
+        assert!(parsed.is_ok());
+        assert_eq!(parsed.unwrap().into_inner(), AdminRequest::StatsPartitions);
+
+        let parsed = parser.parse(b"stats prefixes\r\n");
+        assert!(parsed.is_ok());
+        assert_eq!(parsed.unwrap().into_inner(), AdminRequest::StatsPrefixes);
+
+        assert!(parser.parse(b"stats slabs\r\n").is_err());
+        assert!(parser.parse(b"version segments\r\n").is_err());
+    }
+
     #[test]
     fn parse_version() {
         let parser = AdminRequestParser::new();
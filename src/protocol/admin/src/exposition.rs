@@ -0,0 +1,308 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Stats exposition which is rendered once into a buffer that is kept across
+//! requests. The text around each value is built when the set of metrics is
+//! first seen, and each rendering only formats the values which changed, so
+//! that scraping stats does not allocate once the buffers have grown.
+
+use crate::*;
+use metriken::{AtomicHistogram, Counter, Gauge, Lazy, RwLockHistogram};
+use parking_lot::Mutex;
+use std::fmt::Write;
+use std::time::UNIX_EPOCH;
+
+// the rendering of each format, in the order of `StatsFormat`
+static EXPOSITIONS: Lazy<[Mutex<Exposition>; 4]> = Lazy::new(|| {
+    [
+        Mutex::new(Exposition::new(StatsFormat::Human)),
+        Mutex::new(Exposition::new(StatsFormat::Json)),
+        Mutex::new(Exposition::new(StatsFormat::Memcache)),
+        Mutex::new(Exposition::new(StatsFormat::Prometheus)),
+    ]
+});
+
+/// Renders the stats in the format into its buffer, which is kept for the
+/// next rendering, and passes them to `f`.
+pub fn with_stats<T>(format: StatsFormat, f: impl FnOnce(&str) -> T) -> T {
+    let mut exposition = EXPOSITIONS[format as usize].lock();
+    f(exposition.render())
+}
+
+/// The formats stats are exposed in.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+#[repr(usize)]
+pub enum StatsFormat {
+    /// `"name": value` per line
+    Human = 0,
+    /// Finagle / TwitterServer style JSON
+    Json = 1,
+    /// `STAT name value` per line, for the memcache style admin port
+    Memcache = 2,
+    /// Prometheus / OpenTelemetry text format
+    Prometheus = 3,
+}
+
+impl StatsFormat {
+    /// The text before the first line, between lines, and after the last.
+    fn framing(&self) -> (&'static str, &'static str, &'static str) {
+        match self {
+            Self::Human => ("", "\n", "\n"),
+            Self::Json => ("{", ",", "}"),
+            Self::Memcache => ("", "", "END\r\n"),
+            Self::Prometheus => ("", "\n", "\n"),
+        }
+    }
+}
+
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+enum Value {
+    Counter(u64),
+    Gauge(i64),
+    /// the value of a percentile and the time of the snapshot, in ms
+    Percentile(u64, u128),
+}
+
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+enum Source {
+    Counter,
+    Gauge,
+    /// the index into `PERCENTILES`
+    Percentile(usize),
+}
+
+struct Line {
+    /// the text before the value
+    prefix: String,
+    source: Source,
+    /// the last value, none for percentiles of histograms without samples
+    value: Option<Value>,
+    /// the last value, formatted, and the text after it
+    text: String,
+}
+
+/// A rendering of all metrics in one format. Lines are kept in the order the
+/// metrics are listed in, and written into the buffer sorted by their prefix.
+pub struct Exposition {
+    format: StatsFormat,
+    /// the number of metrics the lines were built for
+    nmetric: usize,
+    lines: Vec<Line>,
+    /// the indices of the lines, sorted by their prefix
+    order: Vec<usize>,
+    buffer: String,
+}
+
+impl Exposition {
+    pub fn new(format: StatsFormat) -> Self {
+        Self {
+            format,
+            nmetric: 0,
+            lines: Vec::new(),
+            order: Vec::new(),
+            buffer: String::new(),
+        }
+    }
+
+    /// Renders the current value of every metric, and the percentiles of the
+    /// latest histogram snapshots.
+    pub fn render(&mut self) -> &str {
+        let nmetric = metriken::metrics().iter().count();
+        if nmetric != self.nmetric {
+            self.build();
+            self.nmetric = nmetric;
+        }
+
+        let metrics = metriken::metrics();
+        let snapshots = SNAPSHOTS.read();
+
+        // only prometheus renders the time of the snapshot
+        let timestamp = match self.format {
+            StatsFormat::Prometheus => snapshots
+                .timestamp()
+                .duration_since(UNIX_EPOCH)
+                .unwrap()
+                .as_millis(),
+            _ => 0,
+        };
+
+        let mut lines = self.lines.iter_mut();
+        for metric in metrics.iter() {
+            let any = match metric.as_any() {
+                Some(any) => any,
+                None => continue,
+            };
+
+            if let Some(counter) = any.downcast_ref::<Counter>() {
+                if let Some(line) = lines.next() {
+                    line.set(self.format, Some(Value::Counter(counter.value())));
+                }
+            } else if let Some(gauge) = any.downcast_ref::<Gauge>() {
+                if let Some(line) = lines.next() {
+                    line.set(self.format, Some(Value::Gauge(gauge.value())));
+                }
+            } else if is_histogram(any) {
+                let values = snapshots.percentile_values(metric.name());
+                for _ in PERCENTILES {
+                    if let Some(line) = lines.next() {
+                        let value = match line.source {
+                            Source::Percentile(i) => values.get(i),
+                            _ => None,
+                        };
+                        line.set(
+                            self.format,
+                            value.map(|value| Value::Percentile(*value, timestamp)),
+                        );
+                    }
+                }
+            }
+        }
+
+        let (open, separator, close) = self.format.framing();
+        self.buffer.clear();
+        self.buffer.push_str(open);
+        let mut first = true;
+        for line in self.order.iter().map(|i| &self.lines[*i]) {
+            if line.value.is_none() {
+                continue;
+            }
+            if !first {
+                self.buffer.push_str(separator);
+            }
+            first = false;
+            self.buffer.push_str(&line.prefix);
+            self.buffer.push_str(&line.text);
+        }
+        self.buffer.push_str(close);
+
+        &self.buffer
+    }
+
+    /// Builds the lines for the metrics, which are rendered in the same order.
+    fn build(&mut self) {
+        self.lines.clear();
+
+        for metric in metriken::metrics().iter() {
+            let any = match metric.as_any() {
+                Some(any) => any,
+                None => continue,
+            };
+
+            let name = metric.name();
+
+            if any.downcast_ref::<Counter>().is_some() {
+                let prefix = match self.format {
+                    StatsFormat::Human | StatsFormat::Json => format!("\"{name}\": "),
+                    StatsFormat::Memcache => format!("STAT {name} "),
+                    StatsFormat::Prometheus => {
+                        if metric.metadata().is_empty() {
+                            format!("# TYPE {name}_total counter\n{name}_total ")
+                        } else {
+                            format!(
+                                "# TYPE {name} counter\n{} ",
+                                metric.formatted(metriken::Format::Prometheus)
+                            )
+                        }
+                    }
+                };
+                self.lines
+                    .push(Line::new(self.format, prefix, Source::Counter));
+            } else if any.downcast_ref::<Gauge>().is_some() {
+                let prefix = match self.format {
+                    StatsFormat::Human | StatsFormat::Json => format!("\"{name}\": "),
+                    StatsFormat::Memcache => format!("STAT {name} "),
+                    StatsFormat::Prometheus => format!(
+                        "# TYPE {name} gauge\n{} ",
+                        metric.formatted(metriken::Format::Prometheus)
+                    ),
+                };
+                self.lines
+                    .push(Line::new(self.format, prefix, Source::Gauge));
+            } else if is_histogram(any) {
+                for (i, (label, percentile)) in PERCENTILES.iter().enumerate() {
+                    let prefix = match self.format {
+                        StatsFormat::Human | StatsFormat::Json => format!("\"{name}/{label}\": "),
+                        StatsFormat::Memcache => format!("STAT {name}_{label} "),
+                        StatsFormat::Prometheus => format!(
+                            "# TYPE {name} gauge\n{name}{{percentile=\"{:02}\"}} ",
+                            percentile
+                        ),
+                    };
+                    self.lines
+                        .push(Line::new(self.format, prefix, Source::Percentile(i)));
+                }
+            }
+        }
+
+        self.order = (0..self.lines.len()).collect();
+        self.order
+            .sort_by(|a, b| self.lines[*a].prefix.cmp(&self.lines[*b].prefix));
+        // a metric listed twice is only rendered once
+        let lines = &self.lines;
+        self.order
+            .dedup_by(|a, b| lines[*a].prefix == lines[*b].prefix);
+    }
+}
+
+impl Line {
+    fn new(format: StatsFormat, mut prefix: String, source: Source) -> Self {
+        if format == StatsFormat::Prometheus {
+            // prometheus does not allow `/` in names
+            prefix = prefix.replace('/', "_");
+        }
+
+        Self {
+            prefix,
+            source,
+            value: None,
+            text: String::new(),
+        }
+    }
+
+    /// Formats the value if it changed since the last rendering.
+    fn set(&mut self, format: StatsFormat, value: Option<Value>) {
+        if self.value == value {
+            return;
+        }
+        self.value = value;
+
+        self.text.clear();
+        let _ = match value {
+            None => Ok(()),
+            Some(Value::Counter(value)) => write!(self.text, "{value}"),
+            Some(Value::Gauge(value)) => write!(self.text, "{value}"),
+            Some(Value::Percentile(value, timestamp)) => match format {
+                StatsFormat::Prometheus => write!(self.text, "{value} {timestamp}"),
+                _ => write!(self.text, "{value}"),
+            },
+        };
+        if format == StatsFormat::Memcache {
+            self.text.push_str("\r\n");
+        }
+    }
+}
+
+fn is_histogram(any: &dyn std::any::Any) -> bool {
+    any.downcast_ref::<AtomicHistogram>().is_some()
+        || any.downcast_ref::<RwLockHistogram>().is_some()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn framing() {
+        let stats = with_stats(StatsFormat::Memcache, str::to_owned);
+        assert!(stats.ends_with("END\r\n"));
+        assert!(!stats.contains("\r\n\r\n"));
+
+        let stats = with_stats(StatsFormat::Json, str::to_owned);
+        assert!(stats.starts_with('{'));
+        assert!(stats.ends_with('}'));
+
+        // a second rendering reuses the lines built by the first
+        assert_eq!(stats, with_stats(StatsFormat::Json, str::to_owned));
+    }
+}
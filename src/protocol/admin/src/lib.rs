@@ -5,9 +5,11 @@
 pub use protocol_common::*;
 
 mod admin;
+mod exposition;
 mod snapshots;
 
 pub use admin::*;
+pub use exposition::*;
 pub use snapshots::*;
 
 pub static PERCENTILES: &[(&str, f64)] = &[
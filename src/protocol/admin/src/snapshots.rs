@@ -1,19 +1,72 @@
 use crate::*;
 use metriken::Lazy;
 use parking_lot::RwLock;
+use std::any::Any;
 use std::collections::HashMap;
 use std::sync::Arc;
 use std::time::SystemTime;
 
-type HistogramSnapshots = HashMap<String, metriken::histogram::Histogram>;
-
 pub static SNAPSHOTS: Lazy<Arc<RwLock<Snapshots>>> =
     Lazy::new(|| Arc::new(RwLock::new(Snapshots::new())));
 
+/// The last snapshot of a histogram, the change since the snapshot before it,
+/// and the percentiles of that change. The buffers are reused by each update.
+struct HistogramSnapshot {
+    previous: metriken::histogram::Histogram,
+    delta: metriken::histogram::Histogram,
+    /// the upper edge of the bucket of each of `PERCENTILES`, empty when there
+    /// were no samples
+    percentiles: Vec<u64>,
+}
+
+impl HistogramSnapshot {
+    fn new(current: metriken::histogram::Histogram, percentiles: &[f64]) -> Self {
+        let mut snapshot = Self {
+            delta: current.clone(),
+            previous: current,
+            percentiles: Vec::with_capacity(percentiles.len()),
+        };
+        snapshot.update_percentiles(percentiles);
+        snapshot
+    }
+
+    fn update(&mut self, current: metriken::histogram::Histogram, percentiles: &[f64]) {
+        if self.delta.config() == current.config() {
+            // subtract in place rather than allocating a new histogram
+            for ((delta, current), previous) in self
+                .delta
+                .as_mut_slice()
+                .iter_mut()
+                .zip(current.as_slice())
+                .zip(self.previous.as_slice())
+            {
+                *delta = current.wrapping_sub(*previous);
+            }
+        } else {
+            self.delta = current.wrapping_sub(&self.previous).unwrap();
+        }
+
+        self.previous = current;
+        self.update_percentiles(percentiles);
+    }
+
+    fn update_percentiles(&mut self, percentiles: &[f64]) {
+        self.percentiles.clear();
+        if let Ok(Some(result)) = self.delta.percentiles(percentiles) {
+            self.percentiles
+                .extend(result.iter().map(|(_, bucket)| bucket.end()));
+        }
+    }
+}
+
 pub struct Snapshots {
     timestamp: SystemTime,
-    previous: HistogramSnapshots,
-    deltas: HistogramSnapshots,
+    /// incremented by each update, so that renderings of the percentiles may
+    /// tell whether they changed
+    generation: u64,
+    /// the values of `PERCENTILES`
+    percentiles: Vec<f64>,
+    histograms: HashMap<String, HistogramSnapshot>,
 }
 
 impl Default for Snapshots {
@@ -22,98 +75,76 @@ impl Default for Snapshots {
     }
 }
 
+fn load(any: &dyn Any) -> Option<metriken::histogram::Histogram> {
+    if let Some(histogram) = any.downcast_ref::<metriken::AtomicHistogram>() {
+        histogram.load()
+    } else if let Some(histogram) = any.downcast_ref::<metriken::RwLockHistogram>() {
+        histogram.load()
+    } else {
+        None
+    }
+}
+
 impl Snapshots {
     pub fn new() -> Self {
-        let timestamp = SystemTime::now();
-
-        let mut current = HashMap::new();
-
-        for metric in metriken::metrics().iter() {
-            let any = if let Some(any) = metric.as_any() {
-                any
-            } else {
-                continue;
-            };
-
-            let key = metric.name().to_string();
-
-            let snapshot = if let Some(histogram) = any.downcast_ref::<metriken::AtomicHistogram>()
-            {
-                histogram.load()
-            } else if let Some(histogram) = any.downcast_ref::<metriken::RwLockHistogram>() {
-                histogram.load()
-            } else {
-                None
-            };
-
-            if let Some(snapshot) = snapshot {
-                current.insert(key, snapshot);
-            }
-        }
-
-        let deltas = current.clone();
-
-        Self {
-            timestamp,
-            previous: current,
-            deltas,
-        }
+        let mut snapshots = Self {
+            timestamp: SystemTime::now(),
+            generation: 0,
+            percentiles: PERCENTILES
+                .iter()
+                .map(|(_, percentile)| *percentile)
+                .collect(),
+            histograms: HashMap::new(),
+        };
+
+        snapshots.update();
+        snapshots.generation = 0;
+        snapshots
     }
 
+    /// Takes a new snapshot of each histogram. Percentiles are reported over
+    /// the interval between the last two updates.
     pub fn update(&mut self) {
         self.timestamp = SystemTime::now();
-
-        let mut current = HashMap::new();
+        self.generation += 1;
 
         for metric in metriken::metrics().iter() {
-            let any = if let Some(any) = metric.as_any() {
-                any
-            } else {
-                continue;
+            let current = match metric.as_any().and_then(load) {
+                Some(current) => current,
+                None => continue,
             };
 
-            let key = metric.name().to_string();
-
-            let snapshot = if let Some(histogram) = any.downcast_ref::<metriken::AtomicHistogram>()
-            {
-                histogram.load()
-            } else if let Some(histogram) = any.downcast_ref::<metriken::RwLockHistogram>() {
-                histogram.load()
-            } else {
-                None
-            };
-
-            if let Some(snapshot) = snapshot {
-                if let Some(previous) = self.previous.get(&key) {
-                    self.deltas
-                        .insert(key.clone(), snapshot.wrapping_sub(previous).unwrap());
+            match self.histograms.get_mut(metric.name()) {
+                Some(snapshot) => snapshot.update(current, &self.percentiles),
+                None => {
+                    self.histograms.insert(
+                        metric.name().to_string(),
+                        HistogramSnapshot::new(current, &self.percentiles),
+                    );
                 }
-
-                current.insert(key, snapshot);
             }
         }
-
-        self.previous = current;
     }
 
     pub fn percentiles(&self, metric: &str) -> Vec<(String, f64, u64)> {
-        let mut result = Vec::new();
-
-        let percentiles: Vec<f64> = PERCENTILES
+        PERCENTILES
             .iter()
-            .map(|(_, percentile)| *percentile)
-            .collect();
-
-        if let Some(snapshot) = self.deltas.get(metric) {
-            if let Ok(Some(percentiles)) = snapshot.percentiles(&percentiles) {
-                for ((label, _), (percentile, bucket)) in PERCENTILES.iter().zip(percentiles.iter())
-                {
-                    result.push((label.to_string(), *percentile, bucket.end()));
-                }
-            }
-        }
+            .zip(self.percentile_values(metric))
+            .map(|((label, percentile), value)| (label.to_string(), *percentile, *value))
+            .collect()
+    }
+
+    /// The value of each of `PERCENTILES` for the histogram, empty if it had
+    /// no samples in the last interval.
+    pub fn percentile_values(&self, metric: &str) -> &[u64] {
+        self.histograms
+            .get(metric)
+            .map(|snapshot| snapshot.percentiles.as_slice())
+            .unwrap_or(&[])
+    }
 
-        result
+    pub fn generation(&self) -> u64 {
+        self.generation
     }
 
     pub fn timestamp(&self) -> SystemTime {
@@ -0,0 +1,87 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+/// The decimal digits of every number below one hundred, in pairs.
+const PAIRS: &[u8; 200] = b"\
+    0001020304050607080910111213141516171819\
+    2021222324252627282930313233343536373839\
+    4041424344454647484950515253545556575859\
+    6061626364656667686970717273747576777879\
+    8081828384858687888990919293949596979899";
+
+/// The decimal form of an integer, formatted on the stack.
+///
+/// Responses carry lengths, flags, cas values and counters which are formatted
+/// for every response. Formatting through `std::fmt` goes through dynamic
+/// dispatch and, with `format!`, a heap allocation. This writes the digits two
+/// at a time from the end of a fixed buffer instead.
+pub struct Digits {
+    buf: [u8; 20],
+    start: usize,
+}
+
+impl Digits {
+    /// Formats an unsigned integer.
+    pub fn new(mut value: u64) -> Self {
+        // a u64 has at most 20 decimal digits
+        let mut buf = [0; 20];
+        let mut start = buf.len();
+
+        while value >= 100 {
+            let pair = (value % 100) as usize * 2;
+            value /= 100;
+            start -= 2;
+            buf[start..(start + 2)].copy_from_slice(&PAIRS[pair..(pair + 2)]);
+        }
+        if value >= 10 {
+            let pair = value as usize * 2;
+            start -= 2;
+            buf[start..(start + 2)].copy_from_slice(&PAIRS[pair..(pair + 2)]);
+        } else {
+            start -= 1;
+            buf[start] = b'0' + value as u8;
+        }
+
+        Self { buf, start }
+    }
+
+    /// Formats a signed integer. The magnitude of an i64 has at most 19
+    /// decimal digits, which leaves room for the sign.
+    pub fn signed(value: i64) -> Self {
+        let mut digits = Self::new(value.unsigned_abs());
+        if value < 0 {
+            digits.start -= 1;
+            digits.buf[digits.start] = b'-';
+        }
+        digits
+    }
+
+    pub fn as_bytes(&self) -> &[u8] {
+        &self.buf[self.start..]
+    }
+
+    #[allow(clippy::len_without_is_empty)]
+    pub fn len(&self) -> usize {
+        self.buf.len() - self.start
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn digits() {
+        for value in [0, 1, 9, 10, 99, 100, 101, 12345, u32::MAX as u64, u64::MAX] {
+            assert_eq!(Digits::new(value).as_bytes(), value.to_string().as_bytes());
+        }
+
+        for value in [0, -1, -10, 42, i64::MIN, i64::MAX] {
+            assert_eq!(
+                Digits::signed(value).as_bytes(),
+                value.to_string().as_bytes()
+            );
+        }
+    }
+}
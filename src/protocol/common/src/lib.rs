@@ -8,11 +8,41 @@
 
 pub use bytes::BufMut;
 
+mod digits;
+
+pub use digits::Digits;
+
+use metriken::{AtomicHistogram, Counter};
+use std::sync::Arc;
+
 pub const CRLF: &str = "\r\n";
 
+/// Bytes which are held elsewhere, such as in storage, and which can be written
+/// out in place instead of first being copied into a buffer.
+pub type SharedBytes = Arc<dyn AsRef<[u8]> + Send + Sync>;
+
+/// A destination for composed messages which, in addition to taking copies of
+/// bytes, can hold references to shared bytes and write them out in place with
+/// a vectored write.
+pub trait Vectored {
+    /// Returns the destination for bytes which are copied.
+    fn buf_mut(&mut self) -> &mut dyn BufMut;
+
+    /// Appends a reference to the shared bytes. They are written out after all
+    /// of the bytes which were put before them and before any put after them.
+    fn put_shared(&mut self, data: SharedBytes);
+}
+
 pub trait Compose {
     fn compose(&self, dst: &mut dyn BufMut) -> usize;
 
+    /// Composes the message into a destination which can take references to
+    /// shared bytes instead of copies of them. Override this function for
+    /// messages which may carry large shared payloads.
+    fn compose_vectored(&self, dst: &mut dyn Vectored) -> usize {
+        self.compose(dst.buf_mut())
+    }
+
     /// Indicates that the connection should be closed.
     /// Override this function as appropriate for the
     /// protocol.
@@ -23,6 +53,237 @@ pub trait Compose {
 
 pub trait Execute<Request, Response: Compose> {
     fn execute(&mut self, request: &Request) -> Response;
+
+    /// Executes a batch of requests in order, appending their responses to
+    /// `responses`. Override this function when the storage can do better
+    /// with the whole batch in view, such as by prefetching.
+    fn execute_batch(&mut self, requests: &[Request], responses: &mut Vec<Response>) {
+        responses.extend(requests.iter().map(|request| self.execute(request)));
+    }
+
+    /// Reserves room for the value of `len` bytes of a request which was
+    /// parsed by [`Parse::parse_header`], so that the value can be read from
+    /// the session straight into the storage. Returns the id of the
+    /// reservation, or `None` if the request must be received in full and
+    /// executed instead, which is always the case by default.
+    fn reserve(&mut self, _request: &Request, _len: usize) -> Option<usize> {
+        None
+    }
+
+    /// Returns the memory reserved for the value, which is to be filled with
+    /// the value before the reservation is committed.
+    fn reserved(&mut self, _id: usize) -> &mut [u8] {
+        &mut []
+    }
+
+    /// Stores the value which was read into the reservation for the request,
+    /// returning the response to it. Returns `None` if there is no such
+    /// reservation.
+    fn commit(&mut self, _id: usize, _request: &Request) -> Option<Response> {
+        None
+    }
+
+    /// Releases a reservation without storing its value, such as when the
+    /// session is closed before all of it was read.
+    fn abort(&mut self, _id: usize) {}
+}
+
+/// Histograms of the latency in nanoseconds of each phase of handling one
+/// type of request.
+pub struct Latencies {
+    /// Time spent waiting on queues between worker and storage threads.
+    pub queue: &'static AtomicHistogram,
+    /// Time spent executing the request against storage.
+    pub execute: &'static AtomicHistogram,
+    /// Time from the response being composed until it is fully flushed.
+    pub write: &'static AtomicHistogram,
+    /// CPU cycles spent in each phase, when cycle accounting is enabled.
+    pub cycles: Cycles,
+}
+
+/// Counters of the CPU cycles spent handling one type of request, split into
+/// parsing the request, executing it against storage, and composing and
+/// sending its response. Workers sum the cycles of each thread locally and add
+/// them to these counters once per event loop iteration.
+pub struct Cycles {
+    pub parse: &'static Counter,
+    pub execute: &'static Counter,
+    pub compose: &'static Counter,
+}
+
+/// Requests which have the latency of each phase of their handling recorded
+/// into per-command histograms.
+pub trait Timed {
+    /// Returns the histograms for the command of this request.
+    fn latencies(&self) -> &'static Latencies;
+}
+
+/// A copy of the value of a hot key, which may be served for reads of the key
+/// by threads other than the one which owns the key.
+#[derive(Clone)]
+pub struct HotCopy {
+    pub data: SharedBytes,
+    pub flags: u32,
+}
+
+/// Requests which can be routed by key to one of several storage shards. The
+/// shard for a key is given by a function which maps the key to the index of
+/// its shard.
+pub trait Shard<Response>: Sized {
+    /// Returns the key which determines the shard of this request. Requests
+    /// without a key may be handled by any shard.
+    fn shard_key(&self) -> Option<&[u8]> {
+        None
+    }
+
+    /// Splits a request with keys on more than one shard into one request for
+    /// each shard, along with the index of that shard. Returns `None` if the
+    /// request can be handled entirely by the shard of its key.
+    fn split(&self, _shard: &dyn Fn(&[u8]) -> usize) -> Option<Vec<(usize, Self)>> {
+        None
+    }
+
+    /// Reassembles the responses to the requests returned by `split`, which
+    /// are in the same order as the requests, into the response to this
+    /// request.
+    fn merge(&self, mut responses: Vec<Response>, _shard: &dyn Fn(&[u8]) -> usize) -> Response {
+        responses.swap_remove(0)
+    }
+
+    /// Splits a request for more than `keys` keys into requests for up to
+    /// `keys` consecutive keys each, whose responses are written one after
+    /// another as each is complete, rather than once all of them are. Returns
+    /// `None` if the request is answered all at once, which is the default.
+    fn chunks(&self, _keys: usize) -> Option<Vec<Self>> {
+        None
+    }
+
+    /// Returns the response to one of the requests returned by `chunks` as it
+    /// is to be written, such that the responses to all of them together are
+    /// the response to the original request. `last` is set for the response
+    /// to the last of them.
+    fn chunk_response(&self, response: Response, _last: bool) -> Response {
+        response
+    }
+
+    /// Returns the key of a request which only reads the value of that one
+    /// key, and which may therefore be answered from a copy of the value. No
+    /// request is answered from a copy by default.
+    fn hot_key(&self) -> Option<&[u8]> {
+        None
+    }
+
+    /// Returns a copy of the value in the response to a request with a hot
+    /// key, if the response holds one.
+    fn hot_copy(&self, _response: &Response) -> Option<HotCopy> {
+        None
+    }
+
+    /// Returns the response to a request with a hot key from a copy of the
+    /// value of its key.
+    fn from_hot_copy(&self, _copy: &HotCopy) -> Option<Response> {
+        None
+    }
+}
+
+/// Requests which may be replayed against a replica of the storage they were
+/// executed against. The stream sent to replicas is made of the requests in
+/// the same wire format they are parsed from.
+pub trait Replicate<Response> {
+    /// Appends the request to the replication stream if it changed the
+    /// storage, as told by its response, in a form which has the same effect
+    /// when it is parsed and executed by the replica. Returns true if the
+    /// request was appended. Requests are not replicated by default.
+    fn replicate(&self, _response: &Response, _dst: &mut dyn BufMut) -> bool {
+        false
+    }
+}
+
+/// Requests which may be served from a datagram, such as over UDP, where there
+/// is no session and the request or its response may be lost. A client cannot
+/// tell whether a lost request was executed, so only requests which do not
+/// change the storage should be served this way.
+pub trait Datagram {
+    /// Returns true if the request may be served from a datagram. Requests
+    /// are not served from datagrams by default.
+    fn is_datagram(&self) -> bool {
+        false
+    }
+}
+
+/// Requests which may be answered without being executed once they have waited
+/// on the storage queue for longer than the deadline of the server, as their
+/// clients have likely given up on them. Answering them right away sheds the
+/// backlog of an overloaded server instead of executing requests whose
+/// responses are not read.
+pub trait Deadline<Response> {
+    /// Returns the response to the request when it is not executed because
+    /// its deadline passed, or `None` if it must be executed regardless.
+    /// Requests are always executed by default.
+    fn expired(&self) -> Option<Response> {
+        None
+    }
+}
+
+/// Requests of protocols which support client-side caching. A session which
+/// turns tracking on is sent a message once a key it has read is written, so
+/// that its client may serve reads of the key from its own cache until then.
+/// Requests take no part in tracking by default.
+pub trait Track<Response> {
+    /// Returns whether the request turns tracking on or off for the session
+    /// which sent it, along with the response to send. Such requests are
+    /// answered by the server rather than executed against the storage.
+    fn tracking(&self) -> Option<(bool, Response)> {
+        None
+    }
+
+    /// Calls `f` with each of the keys which the request reads.
+    fn reads(&self, _f: &mut dyn FnMut(&[u8])) {}
+
+    /// Calls `f` with each of the keys which the request may change.
+    fn writes(&self, _f: &mut dyn FnMut(&[u8])) {}
+
+    /// Returns the message which tells a tracking session that the keys have
+    /// changed, or that every key has if there are none.
+    fn invalidate(_keys: &[&[u8]]) -> Option<Response>
+    where
+        Self: Sized,
+    {
+        None
+    }
+}
+
+/// Requests which a client sends without reading any response to them, such as
+/// writes which are only made for their effect on the storage. Their responses
+/// are dropped where they are executed instead of being sent back to the
+/// session. Every request is answered by default.
+pub trait Quiet {
+    /// Returns true if nothing is sent back to the client for the request,
+    /// whatever its outcome.
+    fn quiet(&self) -> bool {
+        false
+    }
+}
+
+/// Requests which are paired with their responses when many are in flight on
+/// one connection. Responses are taken to arrive in the order the requests
+/// were sent, unless the protocol carries an id in each message which allows
+/// them to be answered out of order.
+pub trait Correlate<Response> {
+    /// Returns true if the response answers this request.
+    fn answered_by(&self, _response: &Response) -> bool {
+        true
+    }
+
+    /// Returns a copy of the request which may be sent to another backend if
+    /// the first is slow to respond, or `None` if the request must not be
+    /// sent more than once.
+    fn hedge(&self) -> Option<Self>
+    where
+        Self: Sized,
+    {
+        None
+    }
 }
 
 #[derive(Debug, PartialEq, Eq)]
@@ -45,6 +306,70 @@ impl<T> ParseOk<T> {
     }
 }
 
+/// The header of a request whose value has not been received in full, along
+/// with the length of its value and the bytes which must follow the value.
+#[derive(Debug, PartialEq, Eq)]
+pub struct ParseHeader<T> {
+    message: T,
+    consumed: usize,
+    value: usize,
+    trailer: &'static [u8],
+}
+
+impl<T> ParseHeader<T> {
+    pub fn new(message: T, consumed: usize, value: usize, trailer: &'static [u8]) -> Self {
+        Self {
+            message,
+            consumed,
+            value,
+            trailer,
+        }
+    }
+
+    pub fn into_inner(self) -> T {
+        self.message
+    }
+
+    pub fn message(&self) -> &T {
+        &self.message
+    }
+
+    /// Returns the length of the header, up to the start of the value.
+    pub fn consumed(&self) -> usize {
+        self.consumed
+    }
+
+    /// Returns the length of the value.
+    pub fn value(&self) -> usize {
+        self.value
+    }
+
+    /// Returns the bytes which follow the value, ending the request.
+    pub fn trailer(&self) -> &'static [u8] {
+        self.trailer
+    }
+}
+
 pub trait Parse<T> {
     fn parse(&self, buffer: &[u8]) -> Result<ParseOk<T>, std::io::Error>;
+
+    /// Parses the header of a request with a value of at least `min` bytes
+    /// which the buffer does not yet hold in full, returning the request with
+    /// an empty value. The value may then be read straight into storage, see
+    /// [`Execute::reserve`], instead of being buffered. Returns `None` if the
+    /// buffer does not start with such a request, which is always the case by
+    /// default.
+    fn parse_header(&self, _buffer: &[u8], _min: usize) -> Option<ParseHeader<T>> {
+        None
+    }
+
+    /// Returns the parser for a session accepted by the listener with the
+    /// index, for servers which speak a different protocol on each of their
+    /// listeners. Every listener uses the same parser by default.
+    fn for_listener(&self, _listener: usize) -> Self
+    where
+        Self: Clone,
+    {
+        self.clone()
+    }
 }
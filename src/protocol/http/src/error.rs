@@ -15,6 +15,10 @@ pub enum Error {
     #[error("method was unsupported")]
     BadRequestMethod,
 
+    /// Contains the length of the value which the range was requested from.
+    #[error("requested range was not satisfiable")]
+    UnsatisfiableRange(usize),
+
     /// Contains the number of additional bytes needed to parse the rest of the
     /// request, if known.
     #[error("not enough data present to parse the whole request")]
@@ -43,6 +47,9 @@ impl Error {
                 .should_close(true)
                 .header("Content-Type", b"text/plain")
                 .body(b"A Content-Length header is required for all PUT requests"),
+            Self::UnsatisfiableRange(len) => Response::builder(416)
+                .header("Content-Range", format!("bytes */{len}").as_bytes())
+                .empty(),
             Self::InternalError(message) => Response::builder(500)
                 .should_close(true)
                 .header("Content-Type", b"text/plain")
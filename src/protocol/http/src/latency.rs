@@ -0,0 +1,215 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Per-method histograms of the latency of each phase of request handling.
+//! See [`protocol_common::Latencies`] for the phases. The metrics are prefixed
+//! with `http_` so that they do not collide with those of other protocols
+//! served by the same process.
+
+use metriken::{metric, AtomicHistogram, Counter};
+use protocol_common::{Cycles, Latencies};
+
+/*
+ * GET
+ */
+
+#[metric(
+    name = "http_get_queue_latency",
+    description = "distribution of time spent waiting on queues for http get requests in nanoseconds"
+)]
+pub static GET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_get_execute_latency",
+    description = "distribution of time spent executing against storage for http get requests in nanoseconds"
+)]
+pub static GET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_get_write_latency",
+    description = "distribution of time spent writing out responses for http get requests in nanoseconds"
+)]
+pub static GET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_get_parse_cycles",
+    description = "cpu cycles spent parsing http get requests"
+)]
+pub static GET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "http_get_execute_cycles",
+    description = "cpu cycles spent executing against storage for http get requests"
+)]
+pub static GET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "http_get_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for http get requests"
+)]
+pub static GET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static GET_LATENCIES: Latencies = Latencies {
+    queue: &GET_QUEUE_LATENCY,
+    execute: &GET_EXECUTE_LATENCY,
+    write: &GET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &GET_PARSE_CYCLES,
+        execute: &GET_EXECUTE_CYCLES,
+        compose: &GET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * PUT
+ */
+
+#[metric(
+    name = "http_put_queue_latency",
+    description = "distribution of time spent waiting on queues for http put requests in nanoseconds"
+)]
+pub static PUT_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_put_execute_latency",
+    description = "distribution of time spent executing against storage for http put requests in nanoseconds"
+)]
+pub static PUT_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_put_write_latency",
+    description = "distribution of time spent writing out responses for http put requests in nanoseconds"
+)]
+pub static PUT_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_put_parse_cycles",
+    description = "cpu cycles spent parsing http put requests"
+)]
+pub static PUT_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "http_put_execute_cycles",
+    description = "cpu cycles spent executing against storage for http put requests"
+)]
+pub static PUT_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "http_put_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for http put requests"
+)]
+pub static PUT_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static PUT_LATENCIES: Latencies = Latencies {
+    queue: &PUT_QUEUE_LATENCY,
+    execute: &PUT_EXECUTE_LATENCY,
+    write: &PUT_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &PUT_PARSE_CYCLES,
+        execute: &PUT_EXECUTE_CYCLES,
+        compose: &PUT_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * DELETE
+ */
+
+#[metric(
+    name = "http_delete_queue_latency",
+    description = "distribution of time spent waiting on queues for http delete requests in nanoseconds"
+)]
+pub static DELETE_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_delete_execute_latency",
+    description = "distribution of time spent executing against storage for http delete requests in nanoseconds"
+)]
+pub static DELETE_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_delete_write_latency",
+    description = "distribution of time spent writing out responses for http delete requests in nanoseconds"
+)]
+pub static DELETE_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_delete_parse_cycles",
+    description = "cpu cycles spent parsing http delete requests"
+)]
+pub static DELETE_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "http_delete_execute_cycles",
+    description = "cpu cycles spent executing against storage for http delete requests"
+)]
+pub static DELETE_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "http_delete_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for http delete requests"
+)]
+pub static DELETE_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static DELETE_LATENCIES: Latencies = Latencies {
+    queue: &DELETE_QUEUE_LATENCY,
+    execute: &DELETE_EXECUTE_LATENCY,
+    write: &DELETE_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &DELETE_PARSE_CYCLES,
+        execute: &DELETE_EXECUTE_CYCLES,
+        compose: &DELETE_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * INVALID
+ */
+
+#[metric(
+    name = "http_invalid_queue_latency",
+    description = "distribution of time spent waiting on queues for http requests which could not be parsed in nanoseconds"
+)]
+pub static INVALID_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_invalid_execute_latency",
+    description = "distribution of time spent executing against storage for http requests which could not be parsed in nanoseconds"
+)]
+pub static INVALID_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_invalid_write_latency",
+    description = "distribution of time spent writing out responses for http requests which could not be parsed in nanoseconds"
+)]
+pub static INVALID_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "http_invalid_parse_cycles",
+    description = "cpu cycles spent parsing http requests which could not be parsed"
+)]
+pub static INVALID_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "http_invalid_execute_cycles",
+    description = "cpu cycles spent executing against storage for http requests which could not be parsed"
+)]
+pub static INVALID_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "http_invalid_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for http requests which could not be parsed"
+)]
+pub static INVALID_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static INVALID_LATENCIES: Latencies = Latencies {
+    queue: &INVALID_QUEUE_LATENCY,
+    execute: &INVALID_EXECUTE_LATENCY,
+    write: &INVALID_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &INVALID_PARSE_CYCLES,
+        execute: &INVALID_EXECUTE_CYCLES,
+        compose: &INVALID_COMPOSE_CYCLES,
+    },
+};
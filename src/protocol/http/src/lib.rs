@@ -14,11 +14,16 @@
 //! and the value is passed in as the request body. The protocol supports
 //! reusing the HTTP connection for multiple requests. The only length
 //! specification supported by pelikan is setting the Content-Length header.
+//!
+//! Requests may be pipelined on a connection, which persists unless the
+//! client asks for it to be closed. A single range of a value may be read by
+//! sending a `Range` header with a `GET`.
 
 #[macro_use]
 extern crate thiserror;
 
 mod error;
+mod latency;
 pub mod request;
 pub mod response;
 mod util;
@@ -4,11 +4,15 @@
 
 use std::fmt;
 use std::mem::MaybeUninit;
+use std::ops::Range;
 
-use crate::{response::status_line, Error, ParseResult};
+use crate::latency::*;
+use crate::{response::status_line, Error, ParseResult, Response};
 use httparse::{Header, ParserConfig, Status};
-use logger::{error, klog};
-use protocol_common::{Parse, ParseOk};
+use logger::{error, klog, klog_key};
+use protocol_common::{
+    Datagram, Deadline, Latencies, Parse, ParseOk, Quiet, Replicate, Shard, Timed, Track,
+};
 
 #[derive(Clone)]
 pub struct Headers(Vec<(String, Vec<u8>)>);
@@ -31,12 +35,62 @@ impl Headers {
             .find(|(name, _)| name.eq_ignore_ascii_case(hdr))
             .map(|(_, value)| &**value)
     }
+
+    /// Returns the range of a value of `len` bytes which is requested by a
+    /// `Range` header, or `None` if the whole value is requested. Only a
+    /// single range of bytes is supported, as any other header may be ignored
+    /// by serving the whole value instead.
+    pub fn range(&self, len: usize) -> Result<Option<Range<usize>>, Error> {
+        let spec = match self
+            .header("Range")
+            .and_then(|value| value.strip_prefix(b"bytes="))
+            .and_then(|spec| std::str::from_utf8(spec).ok())
+        {
+            Some(spec) if !spec.contains(',') => spec.trim(),
+            _ => return Ok(None),
+        };
+
+        let (first, last) = match spec.split_once('-') {
+            Some(split) => split,
+            None => return Ok(None),
+        };
+
+        let range = if first.is_empty() {
+            // a suffix range selects the final bytes of the value
+            match last.parse::<usize>() {
+                Ok(0) => return Err(Error::UnsatisfiableRange(len)),
+                Ok(suffix) => len.saturating_sub(suffix)..len,
+                Err(_) => return Ok(None),
+            }
+        } else {
+            let first = match first.parse::<usize>() {
+                Ok(first) => first,
+                Err(_) => return Ok(None),
+            };
+            let end = if last.is_empty() {
+                len
+            } else {
+                match last.parse::<usize>() {
+                    Ok(last) if last >= first => last.saturating_add(1).min(len),
+                    _ => return Ok(None),
+                }
+            };
+            first..end
+        };
+
+        if range.start >= len {
+            return Err(Error::UnsatisfiableRange(len));
+        }
+
+        Ok(Some(range))
+    }
 }
 
 #[derive(Clone, Debug)]
 pub struct Request {
     pub data: RequestData,
     pub headers: Headers,
+    keep_alive: bool,
 }
 
 impl Request {
@@ -47,6 +101,20 @@ impl Request {
     pub fn header(&self, hdr: &str) -> Option<&[u8]> {
         self.headers.header(hdr)
     }
+
+    pub fn key(&self) -> &[u8] {
+        match &self.data {
+            RequestData::Get(key) | RequestData::Put(key, _) | RequestData::Delete(key) => key,
+        }
+    }
+
+    /// Returns true if the connection persists after the response to this
+    /// request. Connections persist by default from HTTP/1.1 onwards, and are
+    /// closed by default for HTTP/1.0, unless the `Connection` header says
+    /// otherwise.
+    pub fn keep_alive(&self) -> bool {
+        self.keep_alive
+    }
 }
 
 #[derive(Clone)]
@@ -90,19 +158,27 @@ impl RequestParser {
         let key = urlencoding::decode_binary(key.as_bytes()).into_owned();
         let headers = Headers::from_httparse(request.headers);
 
+        let keep_alive = match headers.header("Connection") {
+            Some(value) if value.eq_ignore_ascii_case(b"close") => false,
+            Some(value) if value.eq_ignore_ascii_case(b"keep-alive") => true,
+            _ => request.version != Some(0),
+        };
+
         match method {
             "GET" => Ok(Request {
                 data: RequestData::Get(key),
                 headers,
+                keep_alive,
             }),
             "DELETE" => Ok(Request {
                 data: RequestData::Delete(key),
                 headers,
+                keep_alive,
             }),
             "PUT" => {
                 let content_length = headers
                     .header("Content-Length")
-                    .ok_or(Error::BadContentLength)?;
+                    .ok_or(Error::MissingContentLength)?;
                 let len: usize = std::str::from_utf8(content_length)
                     .map_err(|_| Error::BadContentLength)?
                     .parse()
@@ -118,6 +194,7 @@ impl RequestParser {
                 Ok(Request {
                     data: RequestData::Put(key, value.to_owned()),
                     headers,
+                    keep_alive,
                 })
             }
             _ => Err(Error::BadRequestMethod),
@@ -130,9 +207,12 @@ impl Parse<ParseData> for RequestParser {
         let mut buf = buffer;
         let result = self.do_parse(&mut buf);
 
+        // the connection is closed after the response to an invalid request,
+        // so the rest of the buffer is consumed along with it rather than
+        // being parsed again for any requests pipelined behind it
         let consumed = match result.is_ok() {
             true => unsafe { buf.as_ptr().offset_from(buffer.as_ptr()) as usize },
-            false => 0,
+            false => buffer.len(),
         };
 
         if matches!(result, Err(Error::PartialRequest(_))) {
@@ -153,10 +233,15 @@ impl logger::Klog for Request {
         let line = status_line(status).unwrap_or("");
 
         match self.data() {
-            RequestData::Get(key) => klog!("GET '{}' => {} {}", BStr::new(key), status, line),
-            RequestData::Delete(key) => klog!("DELETE '{}' => {} {}", BStr::new(key), status, line),
+            RequestData::Get(key) => {
+                klog_key!(key, "GET '{}' => {} {}", BStr::new(key), status, line)
+            }
+            RequestData::Delete(key) => {
+                klog_key!(key, "DELETE '{}' => {} {}", BStr::new(key), status, line)
+            }
             RequestData::Put(key, val) => {
-                klog!(
+                klog_key!(
+                    key,
                     "PUT '{}' {} => {} {}",
                     BStr::new(key),
                     val.len(),
@@ -178,6 +263,58 @@ impl logger::Klog for ParseData {
     }
 }
 
+impl Timed for Request {
+    fn latencies(&self) -> &'static Latencies {
+        match self.data {
+            RequestData::Get(_) => &GET_LATENCIES,
+            RequestData::Put(..) => &PUT_LATENCIES,
+            RequestData::Delete(_) => &DELETE_LATENCIES,
+        }
+    }
+}
+
+impl Timed for ParseData {
+    fn latencies(&self) -> &'static Latencies {
+        match &self.0 {
+            Ok(request) => request.latencies(),
+            Err(_) => &INVALID_LATENCIES,
+        }
+    }
+}
+
+// Every request has a single key, so requests are routed to the shard which
+// owns it and are never split. Requests which failed to parse are answered by
+// any shard.
+impl Shard<Response> for ParseData {
+    fn shard_key(&self) -> Option<&[u8]> {
+        self.0.as_ref().ok().map(|request| request.key())
+    }
+}
+
+// Replication is only implemented for the memcache protocol.
+impl Replicate<Response> for ParseData {}
+
+// Datagrams are only served for the memcache protocol.
+impl Datagram for ParseData {}
+
+// Requests past the deadline are only failed for the memcache and resp
+// protocols.
+impl Deadline<Response> for ParseData {}
+
+// Tracking keys for client-side caching is only implemented for the resp
+// protocol, but the keys written are given so that sessions of other protocols
+// which track them, and copies of the values of hot keys, see the writes.
+impl Track<Response> for ParseData {
+    fn writes(&self, f: &mut dyn FnMut(&[u8])) {
+        match self.0.as_ref().map(|request| request.data()) {
+            Ok(RequestData::Put(key, _)) | Ok(RequestData::Delete(key)) => f(key),
+            _ => {}
+        }
+    }
+}
+
+impl Quiet for ParseData {}
+
 impl fmt::Debug for RequestData {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         use bstr::BStr;
@@ -2,14 +2,45 @@
 // Licensed under the Apache License, Version 2.0
 // http://www.apache.org/licenses/LICENSE-2.0
 
-use arrayvec::ArrayVec;
+use crate::{Headers, Result};
 use phf::{phf_map, Map};
-use protocol_common::{BufMut, Compose};
+use protocol_common::{BufMut, Compose, Digits, SharedBytes, Vectored};
 use std::io::Write;
+use std::ops::Range;
+use std::sync::Arc;
 
 pub struct Response {
     builder: ResponseBuilder,
-    body: Option<Vec<u8>>,
+    body: Option<Body>,
+}
+
+/// The body of a response, which is either owned or a reference to bytes held
+/// elsewhere, such as in storage. Referenced bytes are written out in place
+/// when the response is composed into a vectored destination.
+enum Body {
+    Owned(Vec<u8>),
+    Shared(SharedBytes),
+}
+
+impl Body {
+    fn as_slice(&self) -> &[u8] {
+        match self {
+            Self::Owned(body) => body,
+            Self::Shared(body) => (**body).as_ref(),
+        }
+    }
+}
+
+/// A range of shared bytes, which is itself shared.
+struct Slice {
+    bytes: SharedBytes,
+    range: Range<usize>,
+}
+
+impl AsRef<[u8]> for Slice {
+    fn as_ref(&self) -> &[u8] {
+        &(*self.bytes).as_ref()[self.range.clone()]
+    }
 }
 
 impl Response {
@@ -17,9 +48,34 @@ impl Response {
         ResponseBuilder::new(status)
     }
 
+    /// Builds the response to a read of a value. A single range of the value
+    /// may be requested with a `Range` header, which is answered with just
+    /// those bytes as `206 Partial Content`.
+    pub fn value(value: SharedBytes, headers: &Headers) -> Result<Self> {
+        let len = (*value).as_ref().len();
+        match headers.range(len)? {
+            None => Ok(Self::builder(200).shared(value)),
+            Some(range) => {
+                let content_range = format!("bytes {}-{}/{len}", range.start, range.end - 1);
+                Ok(Self::builder(206)
+                    .header("Content-Range", content_range.as_bytes())
+                    .shared(Arc::new(Slice {
+                        bytes: value,
+                        range,
+                    })))
+            }
+        }
+    }
+
     pub fn status(&self) -> u16 {
         self.builder.status
     }
+
+    /// Sets whether the connection is closed once this response is sent.
+    pub fn should_close(&mut self, close: bool) -> &mut Self {
+        self.builder.close = close;
+        self
+    }
 }
 
 pub struct ResponseBuilder {
@@ -80,7 +136,19 @@ impl ResponseBuilder {
         let body = body.to_owned();
         Response {
             builder: self.take(),
-            body: Some(body),
+            body: Some(Body::Owned(body)),
+        }
+    }
+
+    /// Build a response with a body which is held elsewhere, also appends a
+    /// Content-Length header. The body is written out in place rather than
+    /// being copied into the response.
+    pub fn shared(&mut self, body: SharedBytes) -> Response {
+        assert!(!self.headers.is_empty());
+
+        Response {
+            builder: self.take(),
+            body: Some(Body::Shared(body)),
         }
     }
 
@@ -93,8 +161,9 @@ impl ResponseBuilder {
     }
 }
 
-impl Compose for Response {
-    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+impl Response {
+    /// Composes everything before the body, returning the number of bytes.
+    fn compose_head(&self, dst: &mut dyn BufMut) -> usize {
         let mut dst = crate::util::CountingBuf::new(dst);
 
         dst.put_slice(&self.builder.headers);
@@ -107,21 +176,39 @@ impl Compose for Response {
         }
 
         if let Some(body) = &self.body {
-            let mut lenbuf = ArrayVec::<u8, 24>::new();
-            write!(&mut lenbuf, "{}", body.len()).unwrap();
-
             dst.put_slice(b"Content-Length: ");
-            dst.put_slice(&lenbuf);
+            dst.put_slice(Digits::new(body.as_slice().len() as u64).as_bytes());
             dst.put_slice(b"\r\n");
         }
 
         dst.put_slice(b"\r\n");
 
+        dst.count()
+    }
+}
+
+impl Compose for Response {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        let mut size = self.compose_head(dst);
+
         if let Some(body) = &self.body {
-            dst.put_slice(body);
+            dst.put_slice(body.as_slice());
+            size += body.as_slice().len();
         }
 
-        dst.count()
+        size
+    }
+
+    fn compose_vectored(&self, dst: &mut dyn Vectored) -> usize {
+        // a shared body is handed to the destination by reference, so that it
+        // can be written out directly from where it is held
+        if let Some(Body::Shared(body)) = &self.body {
+            let size = self.compose_head(dst.buf_mut()) + (**body).as_ref().len();
+            dst.put_shared(body.clone());
+            size
+        } else {
+            self.compose(dst.buf_mut())
+        }
     }
 
     fn should_hangup(&self) -> bool {
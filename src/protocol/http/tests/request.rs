@@ -106,3 +106,55 @@ fn parse_incomplete() {
 
     assert_matches!(result, Err(ParseError::PartialRequest(Some(100))));
 }
+
+#[test]
+fn parse_keep_alive() {
+    let request = parse_to_end(b"GET /test HTTP/1.1\r\n\r\n").expect("failed to parse request");
+    assert!(request.keep_alive());
+
+    let request = parse_to_end(b"GET /test HTTP/1.1\r\nConnection: close\r\n\r\n")
+        .expect("failed to parse request");
+    assert!(!request.keep_alive());
+
+    let request = parse_to_end(b"GET /test HTTP/1.0\r\n\r\n").expect("failed to parse request");
+    assert!(!request.keep_alive());
+
+    let request = parse_to_end(b"GET /test HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n")
+        .expect("failed to parse request");
+    assert!(request.keep_alive());
+}
+
+#[test]
+fn parse_range() {
+    let range = |header: &str, len: usize| {
+        let data = format!("GET /test HTTP/1.1\r\nRange: {header}\r\n\r\n");
+        let request = parse_to_end(data.as_bytes()).expect("failed to parse request");
+        request.headers.range(len)
+    };
+
+    assert_matches!(range("bytes=0-9", 100), Ok(Some(r)) if r == (0..10));
+    assert_matches!(range("bytes=90-", 100), Ok(Some(r)) if r == (90..100));
+    assert_matches!(range("bytes=-10", 100), Ok(Some(r)) if r == (90..100));
+    assert_matches!(range("bytes=50-200", 100), Ok(Some(r)) if r == (50..100));
+
+    // unsupported or invalid ranges are ignored
+    assert_matches!(range("bytes=0-1,5-6", 100), Ok(None));
+    assert_matches!(range("bytes=9-0", 100), Ok(None));
+    assert_matches!(range("lines=0-1", 100), Ok(None));
+
+    assert_matches!(
+        range("bytes=100-", 100),
+        Err(ParseError::UnsatisfiableRange(100))
+    );
+    assert_matches!(
+        range("bytes=-0", 100),
+        Err(ParseError::UnsatisfiableRange(100))
+    );
+}
+
+#[test]
+fn parse_put_without_length() {
+    let result = parse_to_end(b"PUT /test HTTP/1.1\r\n\r\n");
+
+    assert_matches!(result, Err(ParseError::MissingContentLength));
+}
@@ -3,8 +3,9 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use bstr::BStr;
-use protocol_common::Compose;
-use protocol_http::Response;
+use protocol_common::{Compose, SharedBytes};
+use protocol_http::{RequestParser, Response};
+use std::sync::Arc;
 
 #[test]
 fn response_with_body() {
@@ -55,3 +56,32 @@ fn response_empty() {
         )
     );
 }
+
+#[test]
+fn response_value_range() {
+    let parser = RequestParser::new();
+    let mut data: &[u8] = b"GET /test HTTP/1.1\r\nRange: bytes=5-8\r\n\r\n";
+    let request = parser.do_parse(&mut data).expect("failed to parse request");
+
+    let value: SharedBytes = Arc::new(b"TEST BODY".to_vec());
+    let response = Response::value(value, &request.headers).expect("range was satisfiable");
+
+    let mut data = Vec::new();
+    response.compose(&mut data);
+
+    assert_eq!(response.status(), 206);
+    assert_eq!(
+        BStr::new(&data),
+        BStr::new(
+            b"\
+                HTTP/1.1 206 Partial Content\r\n\
+                Content-Range: bytes 5-8/9\r\n\
+                Connection: keep-alive\r\n\
+                Keep-Alive: timeout=60\r\n\
+                Content-Length: 4\r\n\
+                \r\n\
+                BODY\
+            "
+        )
+    );
+}
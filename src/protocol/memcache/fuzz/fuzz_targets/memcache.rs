@@ -9,12 +9,12 @@
 #![no_main]
 use libfuzzer_sys::fuzz_target;
 
-use protocol_memcache::*;
 use protocol_common::Parse;
+use protocol_memcache::*;
 
 const MAX_KEY_LEN: usize = 128;
 const MAX_BATCH_SIZE: usize = 128;
-const MAX_VALUE_SIZE: usize = 4*4096;
+const MAX_VALUE_SIZE: usize = 4 * 4096;
 
 fuzz_target!(|data: &[u8]| {
     let parser = RequestParser::new()
@@ -46,6 +46,28 @@ fuzz_target!(|data: &[u8]| {
                     validate_key(key);
                 }
             }
+            Request::Gat(gat) => {
+                if gat.keys().is_empty() {
+                    panic!("no keys");
+                }
+                if gat.keys().len() > MAX_BATCH_SIZE {
+                    panic!("batch size exceeds max");
+                }
+                for key in gat.keys().iter() {
+                    validate_key(key);
+                }
+            }
+            Request::Gats(gats) => {
+                if gats.keys().is_empty() {
+                    panic!("no keys");
+                }
+                if gats.keys().len() > MAX_BATCH_SIZE {
+                    panic!("batch size exceeds max");
+                }
+                for key in gats.keys().iter() {
+                    validate_key(key);
+                }
+            }
             Request::Set(set) => {
                 validate_key(set.key());
                 validate_value(set.value());
@@ -73,13 +95,38 @@ fuzz_target!(|data: &[u8]| {
             Request::Delete(delete) => {
                 validate_key(delete.key());
             }
+            Request::Touch(touch) => {
+                validate_key(touch.key());
+            }
             Request::Incr(incr) => {
                 validate_key(incr.key());
             }
             Request::Decr(decr) => {
                 validate_key(decr.key());
             }
+            Request::MetaGet(get) => {
+                validate_key(get.key());
+            }
+            Request::MetaSet(set) => {
+                validate_key(set.key());
+                validate_value(set.value());
+            }
+            Request::MetaDelete(delete) => {
+                validate_key(delete.key());
+            }
+            Request::MetaArithmetic(arithmetic) => {
+                validate_key(arithmetic.key());
+            }
+            Request::Binary(binary) => {
+                // binary keys are length prefixed, so they may hold any byte
+                if let Some(key) = binary.key() {
+                    if key.is_empty() || key.len() > MAX_KEY_LEN {
+                        panic!("invalid binary key length: {}", key.len());
+                    }
+                }
+            }
             Request::FlushAll(_) => {}
+            Request::MetaNoop(_) => {}
             Request::Quit(_) => {}
         }
     }
@@ -0,0 +1,1080 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Per-command histograms of the latency of each phase of request handling.
+//! See [`protocol_common::Latencies`] for the phases.
+
+use metriken::{metric, AtomicHistogram, Counter};
+use protocol_common::{Cycles, Latencies};
+
+/*
+ * GET
+ */
+
+#[metric(
+    name = "get_queue_latency",
+    description = "distribution of time spent waiting on queues for get requests in nanoseconds"
+)]
+pub static GET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "get_execute_latency",
+    description = "distribution of time spent executing against storage for get requests in nanoseconds"
+)]
+pub static GET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "get_write_latency",
+    description = "distribution of time spent writing out responses for get requests in nanoseconds"
+)]
+pub static GET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "get_parse_cycles",
+    description = "cpu cycles spent parsing get requests"
+)]
+pub static GET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "get_execute_cycles",
+    description = "cpu cycles spent executing against storage for get requests"
+)]
+pub static GET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "get_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for get requests"
+)]
+pub static GET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static GET_LATENCIES: Latencies = Latencies {
+    queue: &GET_QUEUE_LATENCY,
+    execute: &GET_EXECUTE_LATENCY,
+    write: &GET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &GET_PARSE_CYCLES,
+        execute: &GET_EXECUTE_CYCLES,
+        compose: &GET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * GETS
+ */
+
+#[metric(
+    name = "gets_queue_latency",
+    description = "distribution of time spent waiting on queues for gets requests in nanoseconds"
+)]
+pub static GETS_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "gets_execute_latency",
+    description = "distribution of time spent executing against storage for gets requests in nanoseconds"
+)]
+pub static GETS_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "gets_write_latency",
+    description = "distribution of time spent writing out responses for gets requests in nanoseconds"
+)]
+pub static GETS_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "gets_parse_cycles",
+    description = "cpu cycles spent parsing gets requests"
+)]
+pub static GETS_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "gets_execute_cycles",
+    description = "cpu cycles spent executing against storage for gets requests"
+)]
+pub static GETS_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "gets_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for gets requests"
+)]
+pub static GETS_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static GETS_LATENCIES: Latencies = Latencies {
+    queue: &GETS_QUEUE_LATENCY,
+    execute: &GETS_EXECUTE_LATENCY,
+    write: &GETS_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &GETS_PARSE_CYCLES,
+        execute: &GETS_EXECUTE_CYCLES,
+        compose: &GETS_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * SET
+ */
+
+#[metric(
+    name = "set_queue_latency",
+    description = "distribution of time spent waiting on queues for set requests in nanoseconds"
+)]
+pub static SET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "set_execute_latency",
+    description = "distribution of time spent executing against storage for set requests in nanoseconds"
+)]
+pub static SET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "set_write_latency",
+    description = "distribution of time spent writing out responses for set requests in nanoseconds"
+)]
+pub static SET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "set_parse_cycles",
+    description = "cpu cycles spent parsing set requests"
+)]
+pub static SET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "set_execute_cycles",
+    description = "cpu cycles spent executing against storage for set requests"
+)]
+pub static SET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "set_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for set requests"
+)]
+pub static SET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static SET_LATENCIES: Latencies = Latencies {
+    queue: &SET_QUEUE_LATENCY,
+    execute: &SET_EXECUTE_LATENCY,
+    write: &SET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &SET_PARSE_CYCLES,
+        execute: &SET_EXECUTE_CYCLES,
+        compose: &SET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * ADD
+ */
+
+#[metric(
+    name = "add_queue_latency",
+    description = "distribution of time spent waiting on queues for add requests in nanoseconds"
+)]
+pub static ADD_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "add_execute_latency",
+    description = "distribution of time spent executing against storage for add requests in nanoseconds"
+)]
+pub static ADD_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "add_write_latency",
+    description = "distribution of time spent writing out responses for add requests in nanoseconds"
+)]
+pub static ADD_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "add_parse_cycles",
+    description = "cpu cycles spent parsing add requests"
+)]
+pub static ADD_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "add_execute_cycles",
+    description = "cpu cycles spent executing against storage for add requests"
+)]
+pub static ADD_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "add_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for add requests"
+)]
+pub static ADD_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static ADD_LATENCIES: Latencies = Latencies {
+    queue: &ADD_QUEUE_LATENCY,
+    execute: &ADD_EXECUTE_LATENCY,
+    write: &ADD_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &ADD_PARSE_CYCLES,
+        execute: &ADD_EXECUTE_CYCLES,
+        compose: &ADD_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * REPLACE
+ */
+
+#[metric(
+    name = "replace_queue_latency",
+    description = "distribution of time spent waiting on queues for replace requests in nanoseconds"
+)]
+pub static REPLACE_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "replace_execute_latency",
+    description = "distribution of time spent executing against storage for replace requests in nanoseconds"
+)]
+pub static REPLACE_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "replace_write_latency",
+    description = "distribution of time spent writing out responses for replace requests in nanoseconds"
+)]
+pub static REPLACE_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "replace_parse_cycles",
+    description = "cpu cycles spent parsing replace requests"
+)]
+pub static REPLACE_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "replace_execute_cycles",
+    description = "cpu cycles spent executing against storage for replace requests"
+)]
+pub static REPLACE_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "replace_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for replace requests"
+)]
+pub static REPLACE_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static REPLACE_LATENCIES: Latencies = Latencies {
+    queue: &REPLACE_QUEUE_LATENCY,
+    execute: &REPLACE_EXECUTE_LATENCY,
+    write: &REPLACE_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &REPLACE_PARSE_CYCLES,
+        execute: &REPLACE_EXECUTE_CYCLES,
+        compose: &REPLACE_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * APPEND
+ */
+
+#[metric(
+    name = "append_queue_latency",
+    description = "distribution of time spent waiting on queues for append requests in nanoseconds"
+)]
+pub static APPEND_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "append_execute_latency",
+    description = "distribution of time spent executing against storage for append requests in nanoseconds"
+)]
+pub static APPEND_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "append_write_latency",
+    description = "distribution of time spent writing out responses for append requests in nanoseconds"
+)]
+pub static APPEND_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "append_parse_cycles",
+    description = "cpu cycles spent parsing append requests"
+)]
+pub static APPEND_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "append_execute_cycles",
+    description = "cpu cycles spent executing against storage for append requests"
+)]
+pub static APPEND_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "append_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for append requests"
+)]
+pub static APPEND_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static APPEND_LATENCIES: Latencies = Latencies {
+    queue: &APPEND_QUEUE_LATENCY,
+    execute: &APPEND_EXECUTE_LATENCY,
+    write: &APPEND_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &APPEND_PARSE_CYCLES,
+        execute: &APPEND_EXECUTE_CYCLES,
+        compose: &APPEND_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * PREPEND
+ */
+
+#[metric(
+    name = "prepend_queue_latency",
+    description = "distribution of time spent waiting on queues for prepend requests in nanoseconds"
+)]
+pub static PREPEND_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "prepend_execute_latency",
+    description = "distribution of time spent executing against storage for prepend requests in nanoseconds"
+)]
+pub static PREPEND_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "prepend_write_latency",
+    description = "distribution of time spent writing out responses for prepend requests in nanoseconds"
+)]
+pub static PREPEND_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "prepend_parse_cycles",
+    description = "cpu cycles spent parsing prepend requests"
+)]
+pub static PREPEND_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "prepend_execute_cycles",
+    description = "cpu cycles spent executing against storage for prepend requests"
+)]
+pub static PREPEND_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "prepend_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for prepend requests"
+)]
+pub static PREPEND_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static PREPEND_LATENCIES: Latencies = Latencies {
+    queue: &PREPEND_QUEUE_LATENCY,
+    execute: &PREPEND_EXECUTE_LATENCY,
+    write: &PREPEND_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &PREPEND_PARSE_CYCLES,
+        execute: &PREPEND_EXECUTE_CYCLES,
+        compose: &PREPEND_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * CAS
+ */
+
+#[metric(
+    name = "cas_queue_latency",
+    description = "distribution of time spent waiting on queues for cas requests in nanoseconds"
+)]
+pub static CAS_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "cas_execute_latency",
+    description = "distribution of time spent executing against storage for cas requests in nanoseconds"
+)]
+pub static CAS_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "cas_write_latency",
+    description = "distribution of time spent writing out responses for cas requests in nanoseconds"
+)]
+pub static CAS_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "cas_parse_cycles",
+    description = "cpu cycles spent parsing cas requests"
+)]
+pub static CAS_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "cas_execute_cycles",
+    description = "cpu cycles spent executing against storage for cas requests"
+)]
+pub static CAS_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "cas_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for cas requests"
+)]
+pub static CAS_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static CAS_LATENCIES: Latencies = Latencies {
+    queue: &CAS_QUEUE_LATENCY,
+    execute: &CAS_EXECUTE_LATENCY,
+    write: &CAS_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &CAS_PARSE_CYCLES,
+        execute: &CAS_EXECUTE_CYCLES,
+        compose: &CAS_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * INCR
+ */
+
+#[metric(
+    name = "incr_queue_latency",
+    description = "distribution of time spent waiting on queues for incr requests in nanoseconds"
+)]
+pub static INCR_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "incr_execute_latency",
+    description = "distribution of time spent executing against storage for incr requests in nanoseconds"
+)]
+pub static INCR_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "incr_write_latency",
+    description = "distribution of time spent writing out responses for incr requests in nanoseconds"
+)]
+pub static INCR_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "incr_parse_cycles",
+    description = "cpu cycles spent parsing incr requests"
+)]
+pub static INCR_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "incr_execute_cycles",
+    description = "cpu cycles spent executing against storage for incr requests"
+)]
+pub static INCR_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "incr_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for incr requests"
+)]
+pub static INCR_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static INCR_LATENCIES: Latencies = Latencies {
+    queue: &INCR_QUEUE_LATENCY,
+    execute: &INCR_EXECUTE_LATENCY,
+    write: &INCR_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &INCR_PARSE_CYCLES,
+        execute: &INCR_EXECUTE_CYCLES,
+        compose: &INCR_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * DECR
+ */
+
+#[metric(
+    name = "decr_queue_latency",
+    description = "distribution of time spent waiting on queues for decr requests in nanoseconds"
+)]
+pub static DECR_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "decr_execute_latency",
+    description = "distribution of time spent executing against storage for decr requests in nanoseconds"
+)]
+pub static DECR_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "decr_write_latency",
+    description = "distribution of time spent writing out responses for decr requests in nanoseconds"
+)]
+pub static DECR_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "decr_parse_cycles",
+    description = "cpu cycles spent parsing decr requests"
+)]
+pub static DECR_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "decr_execute_cycles",
+    description = "cpu cycles spent executing against storage for decr requests"
+)]
+pub static DECR_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "decr_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for decr requests"
+)]
+pub static DECR_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static DECR_LATENCIES: Latencies = Latencies {
+    queue: &DECR_QUEUE_LATENCY,
+    execute: &DECR_EXECUTE_LATENCY,
+    write: &DECR_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &DECR_PARSE_CYCLES,
+        execute: &DECR_EXECUTE_CYCLES,
+        compose: &DECR_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * DELETE
+ */
+
+#[metric(
+    name = "delete_queue_latency",
+    description = "distribution of time spent waiting on queues for delete requests in nanoseconds"
+)]
+pub static DELETE_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "delete_execute_latency",
+    description = "distribution of time spent executing against storage for delete requests in nanoseconds"
+)]
+pub static DELETE_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "delete_write_latency",
+    description = "distribution of time spent writing out responses for delete requests in nanoseconds"
+)]
+pub static DELETE_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "delete_parse_cycles",
+    description = "cpu cycles spent parsing delete requests"
+)]
+pub static DELETE_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "delete_execute_cycles",
+    description = "cpu cycles spent executing against storage for delete requests"
+)]
+pub static DELETE_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "delete_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for delete requests"
+)]
+pub static DELETE_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static DELETE_LATENCIES: Latencies = Latencies {
+    queue: &DELETE_QUEUE_LATENCY,
+    execute: &DELETE_EXECUTE_LATENCY,
+    write: &DELETE_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &DELETE_PARSE_CYCLES,
+        execute: &DELETE_EXECUTE_CYCLES,
+        compose: &DELETE_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * TOUCH
+ */
+
+#[metric(
+    name = "touch_queue_latency",
+    description = "distribution of time spent waiting on queues for touch requests in nanoseconds"
+)]
+pub static TOUCH_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "touch_execute_latency",
+    description = "distribution of time spent executing against storage for touch requests in nanoseconds"
+)]
+pub static TOUCH_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "touch_write_latency",
+    description = "distribution of time spent writing out responses for touch requests in nanoseconds"
+)]
+pub static TOUCH_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "touch_parse_cycles",
+    description = "cpu cycles spent parsing touch requests"
+)]
+pub static TOUCH_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "touch_execute_cycles",
+    description = "cpu cycles spent executing against storage for touch requests"
+)]
+pub static TOUCH_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "touch_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for touch requests"
+)]
+pub static TOUCH_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static TOUCH_LATENCIES: Latencies = Latencies {
+    queue: &TOUCH_QUEUE_LATENCY,
+    execute: &TOUCH_EXECUTE_LATENCY,
+    write: &TOUCH_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &TOUCH_PARSE_CYCLES,
+        execute: &TOUCH_EXECUTE_CYCLES,
+        compose: &TOUCH_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * GAT
+ */
+
+#[metric(
+    name = "gat_queue_latency",
+    description = "distribution of time spent waiting on queues for gat requests in nanoseconds"
+)]
+pub static GAT_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "gat_execute_latency",
+    description = "distribution of time spent executing against storage for gat requests in nanoseconds"
+)]
+pub static GAT_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "gat_write_latency",
+    description = "distribution of time spent writing out responses for gat requests in nanoseconds"
+)]
+pub static GAT_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "gat_parse_cycles",
+    description = "cpu cycles spent parsing gat requests"
+)]
+pub static GAT_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "gat_execute_cycles",
+    description = "cpu cycles spent executing against storage for gat requests"
+)]
+pub static GAT_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "gat_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for gat requests"
+)]
+pub static GAT_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static GAT_LATENCIES: Latencies = Latencies {
+    queue: &GAT_QUEUE_LATENCY,
+    execute: &GAT_EXECUTE_LATENCY,
+    write: &GAT_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &GAT_PARSE_CYCLES,
+        execute: &GAT_EXECUTE_CYCLES,
+        compose: &GAT_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * GATS
+ */
+
+#[metric(
+    name = "gats_queue_latency",
+    description = "distribution of time spent waiting on queues for gats requests in nanoseconds"
+)]
+pub static GATS_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "gats_execute_latency",
+    description = "distribution of time spent executing against storage for gats requests in nanoseconds"
+)]
+pub static GATS_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "gats_write_latency",
+    description = "distribution of time spent writing out responses for gats requests in nanoseconds"
+)]
+pub static GATS_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "gats_parse_cycles",
+    description = "cpu cycles spent parsing gats requests"
+)]
+pub static GATS_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "gats_execute_cycles",
+    description = "cpu cycles spent executing against storage for gats requests"
+)]
+pub static GATS_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "gats_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for gats requests"
+)]
+pub static GATS_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static GATS_LATENCIES: Latencies = Latencies {
+    queue: &GATS_QUEUE_LATENCY,
+    execute: &GATS_EXECUTE_LATENCY,
+    write: &GATS_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &GATS_PARSE_CYCLES,
+        execute: &GATS_EXECUTE_CYCLES,
+        compose: &GATS_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * FLUSH_ALL
+ */
+
+#[metric(
+    name = "flush_all_queue_latency",
+    description = "distribution of time spent waiting on queues for flush_all requests in nanoseconds"
+)]
+pub static FLUSH_ALL_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "flush_all_execute_latency",
+    description = "distribution of time spent executing against storage for flush_all requests in nanoseconds"
+)]
+pub static FLUSH_ALL_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "flush_all_write_latency",
+    description = "distribution of time spent writing out responses for flush_all requests in nanoseconds"
+)]
+pub static FLUSH_ALL_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "flush_all_parse_cycles",
+    description = "cpu cycles spent parsing flush_all requests"
+)]
+pub static FLUSH_ALL_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "flush_all_execute_cycles",
+    description = "cpu cycles spent executing against storage for flush_all requests"
+)]
+pub static FLUSH_ALL_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "flush_all_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for flush_all requests"
+)]
+pub static FLUSH_ALL_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static FLUSH_ALL_LATENCIES: Latencies = Latencies {
+    queue: &FLUSH_ALL_QUEUE_LATENCY,
+    execute: &FLUSH_ALL_EXECUTE_LATENCY,
+    write: &FLUSH_ALL_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &FLUSH_ALL_PARSE_CYCLES,
+        execute: &FLUSH_ALL_EXECUTE_CYCLES,
+        compose: &FLUSH_ALL_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * QUIT
+ */
+
+#[metric(
+    name = "quit_queue_latency",
+    description = "distribution of time spent waiting on queues for quit requests in nanoseconds"
+)]
+pub static QUIT_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "quit_execute_latency",
+    description = "distribution of time spent executing against storage for quit requests in nanoseconds"
+)]
+pub static QUIT_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "quit_write_latency",
+    description = "distribution of time spent writing out responses for quit requests in nanoseconds"
+)]
+pub static QUIT_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "quit_parse_cycles",
+    description = "cpu cycles spent parsing quit requests"
+)]
+pub static QUIT_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "quit_execute_cycles",
+    description = "cpu cycles spent executing against storage for quit requests"
+)]
+pub static QUIT_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "quit_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for quit requests"
+)]
+pub static QUIT_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static QUIT_LATENCIES: Latencies = Latencies {
+    queue: &QUIT_QUEUE_LATENCY,
+    execute: &QUIT_EXECUTE_LATENCY,
+    write: &QUIT_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &QUIT_PARSE_CYCLES,
+        execute: &QUIT_EXECUTE_CYCLES,
+        compose: &QUIT_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * META_GET
+ */
+
+#[metric(
+    name = "meta_get_queue_latency",
+    description = "distribution of time spent waiting on queues for mg requests in nanoseconds"
+)]
+pub static META_GET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_get_execute_latency",
+    description = "distribution of time spent executing against storage for mg requests in nanoseconds"
+)]
+pub static META_GET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_get_write_latency",
+    description = "distribution of time spent writing out responses for mg requests in nanoseconds"
+)]
+pub static META_GET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_get_parse_cycles",
+    description = "cpu cycles spent parsing mg requests"
+)]
+pub static META_GET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "meta_get_execute_cycles",
+    description = "cpu cycles spent executing against storage for mg requests"
+)]
+pub static META_GET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "meta_get_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for mg requests"
+)]
+pub static META_GET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static META_GET_LATENCIES: Latencies = Latencies {
+    queue: &META_GET_QUEUE_LATENCY,
+    execute: &META_GET_EXECUTE_LATENCY,
+    write: &META_GET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &META_GET_PARSE_CYCLES,
+        execute: &META_GET_EXECUTE_CYCLES,
+        compose: &META_GET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * META_SET
+ */
+
+#[metric(
+    name = "meta_set_queue_latency",
+    description = "distribution of time spent waiting on queues for ms requests in nanoseconds"
+)]
+pub static META_SET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_set_execute_latency",
+    description = "distribution of time spent executing against storage for ms requests in nanoseconds"
+)]
+pub static META_SET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_set_write_latency",
+    description = "distribution of time spent writing out responses for ms requests in nanoseconds"
+)]
+pub static META_SET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_set_parse_cycles",
+    description = "cpu cycles spent parsing ms requests"
+)]
+pub static META_SET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "meta_set_execute_cycles",
+    description = "cpu cycles spent executing against storage for ms requests"
+)]
+pub static META_SET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "meta_set_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for ms requests"
+)]
+pub static META_SET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static META_SET_LATENCIES: Latencies = Latencies {
+    queue: &META_SET_QUEUE_LATENCY,
+    execute: &META_SET_EXECUTE_LATENCY,
+    write: &META_SET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &META_SET_PARSE_CYCLES,
+        execute: &META_SET_EXECUTE_CYCLES,
+        compose: &META_SET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * META_DELETE
+ */
+
+#[metric(
+    name = "meta_delete_queue_latency",
+    description = "distribution of time spent waiting on queues for md requests in nanoseconds"
+)]
+pub static META_DELETE_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_delete_execute_latency",
+    description = "distribution of time spent executing against storage for md requests in nanoseconds"
+)]
+pub static META_DELETE_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_delete_write_latency",
+    description = "distribution of time spent writing out responses for md requests in nanoseconds"
+)]
+pub static META_DELETE_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_delete_parse_cycles",
+    description = "cpu cycles spent parsing md requests"
+)]
+pub static META_DELETE_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "meta_delete_execute_cycles",
+    description = "cpu cycles spent executing against storage for md requests"
+)]
+pub static META_DELETE_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "meta_delete_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for md requests"
+)]
+pub static META_DELETE_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static META_DELETE_LATENCIES: Latencies = Latencies {
+    queue: &META_DELETE_QUEUE_LATENCY,
+    execute: &META_DELETE_EXECUTE_LATENCY,
+    write: &META_DELETE_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &META_DELETE_PARSE_CYCLES,
+        execute: &META_DELETE_EXECUTE_CYCLES,
+        compose: &META_DELETE_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * META_ARITHMETIC
+ */
+
+#[metric(
+    name = "meta_arithmetic_queue_latency",
+    description = "distribution of time spent waiting on queues for ma requests in nanoseconds"
+)]
+pub static META_ARITHMETIC_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_arithmetic_execute_latency",
+    description = "distribution of time spent executing against storage for ma requests in nanoseconds"
+)]
+pub static META_ARITHMETIC_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_arithmetic_write_latency",
+    description = "distribution of time spent writing out responses for ma requests in nanoseconds"
+)]
+pub static META_ARITHMETIC_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_arithmetic_parse_cycles",
+    description = "cpu cycles spent parsing ma requests"
+)]
+pub static META_ARITHMETIC_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "meta_arithmetic_execute_cycles",
+    description = "cpu cycles spent executing against storage for ma requests"
+)]
+pub static META_ARITHMETIC_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "meta_arithmetic_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for ma requests"
+)]
+pub static META_ARITHMETIC_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static META_ARITHMETIC_LATENCIES: Latencies = Latencies {
+    queue: &META_ARITHMETIC_QUEUE_LATENCY,
+    execute: &META_ARITHMETIC_EXECUTE_LATENCY,
+    write: &META_ARITHMETIC_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &META_ARITHMETIC_PARSE_CYCLES,
+        execute: &META_ARITHMETIC_EXECUTE_CYCLES,
+        compose: &META_ARITHMETIC_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * META_NOOP
+ */
+
+#[metric(
+    name = "meta_noop_queue_latency",
+    description = "distribution of time spent waiting on queues for mn requests in nanoseconds"
+)]
+pub static META_NOOP_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_noop_execute_latency",
+    description = "distribution of time spent executing against storage for mn requests in nanoseconds"
+)]
+pub static META_NOOP_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_noop_write_latency",
+    description = "distribution of time spent writing out responses for mn requests in nanoseconds"
+)]
+pub static META_NOOP_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "meta_noop_parse_cycles",
+    description = "cpu cycles spent parsing mn requests"
+)]
+pub static META_NOOP_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "meta_noop_execute_cycles",
+    description = "cpu cycles spent executing against storage for mn requests"
+)]
+pub static META_NOOP_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "meta_noop_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for mn requests"
+)]
+pub static META_NOOP_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static META_NOOP_LATENCIES: Latencies = Latencies {
+    queue: &META_NOOP_QUEUE_LATENCY,
+    execute: &META_NOOP_EXECUTE_LATENCY,
+    write: &META_NOOP_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &META_NOOP_PARSE_CYCLES,
+        execute: &META_NOOP_EXECUTE_CYCLES,
+        compose: &META_NOOP_COMPOSE_CYCLES,
+    },
+};
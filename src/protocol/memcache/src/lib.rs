@@ -5,6 +5,7 @@
 #[macro_use]
 extern crate logger;
 
+mod latency;
 mod request;
 mod response;
 mod storage;
@@ -16,7 +17,9 @@ pub use request::*;
 pub use response::*;
 pub use storage::*;
 
-pub use protocol_common::{Compose, Parse, ParseOk};
+pub use protocol_common::{
+    Compose, Datagram, Deadline, Latencies, Parse, ParseOk, Quiet, Shard, Timed, Track,
+};
 
 pub use common::expiry::TimeType;
 use logger::Klog;
@@ -170,6 +173,60 @@ pub static DELETE_DELETED: Counter = Counter::new();
 #[metric(name = "delete_not_found")]
 pub static DELETE_NOT_FOUND: Counter = Counter::new();
 
+/*
+ * TOUCH
+ */
+
+#[metric(name = "touch")]
+pub static TOUCH: Counter = Counter::new();
+
+#[metric(name = "touch_ex")]
+pub static TOUCH_EX: Counter = Counter::new();
+
+#[metric(name = "touch_touched")]
+pub static TOUCH_TOUCHED: Counter = Counter::new();
+
+#[metric(name = "touch_not_found")]
+pub static TOUCH_NOT_FOUND: Counter = Counter::new();
+
+/*
+ * GAT
+ */
+
+#[metric(name = "gat")]
+pub static GAT: Counter = Counter::new();
+
+#[metric(name = "gat_ex")]
+pub static GAT_EX: Counter = Counter::new();
+
+#[metric(name = "gat_key")]
+pub static GAT_KEY: Counter = Counter::new();
+
+#[metric(name = "gat_key_hit")]
+pub static GAT_KEY_HIT: Counter = Counter::new();
+
+#[metric(name = "gat_key_miss")]
+pub static GAT_KEY_MISS: Counter = Counter::new();
+
+/*
+ * GATS
+ */
+
+#[metric(name = "gats")]
+pub static GATS: Counter = Counter::new();
+
+#[metric(name = "gats_ex")]
+pub static GATS_EX: Counter = Counter::new();
+
+#[metric(name = "gats_key")]
+pub static GATS_KEY: Counter = Counter::new();
+
+#[metric(name = "gats_key_hit")]
+pub static GATS_KEY_HIT: Counter = Counter::new();
+
+#[metric(name = "gats_key_miss")]
+pub static GATS_KEY_MISS: Counter = Counter::new();
+
 /*
  * INCR
  */
@@ -238,4 +295,85 @@ pub static FLUSH_ALL_EX: Counter = Counter::new();
 #[metric(name = "quit")]
 pub static QUIT: Counter = Counter::new();
 
+/*
+ * META_GET
+ */
+
+#[metric(name = "meta_get")]
+pub static META_GET: Counter = Counter::new();
+
+#[metric(name = "meta_get_ex")]
+pub static META_GET_EX: Counter = Counter::new();
+
+#[metric(name = "meta_get_hit")]
+pub static META_GET_HIT: Counter = Counter::new();
+
+#[metric(name = "meta_get_miss")]
+pub static META_GET_MISS: Counter = Counter::new();
+
+/*
+ * META_SET
+ */
+
+#[metric(name = "meta_set")]
+pub static META_SET: Counter = Counter::new();
+
+#[metric(name = "meta_set_ex")]
+pub static META_SET_EX: Counter = Counter::new();
+
+#[metric(name = "meta_set_stored")]
+pub static META_SET_STORED: Counter = Counter::new();
+
+#[metric(name = "meta_set_not_stored")]
+pub static META_SET_NOT_STORED: Counter = Counter::new();
+
+/*
+ * META_DELETE
+ */
+
+#[metric(name = "meta_delete")]
+pub static META_DELETE: Counter = Counter::new();
+
+#[metric(name = "meta_delete_ex")]
+pub static META_DELETE_EX: Counter = Counter::new();
+
+#[metric(name = "meta_delete_deleted")]
+pub static META_DELETE_DELETED: Counter = Counter::new();
+
+#[metric(name = "meta_delete_not_found")]
+pub static META_DELETE_NOT_FOUND: Counter = Counter::new();
+
+/*
+ * META_ARITHMETIC
+ */
+
+#[metric(name = "meta_arithmetic")]
+pub static META_ARITHMETIC: Counter = Counter::new();
+
+#[metric(name = "meta_arithmetic_ex")]
+pub static META_ARITHMETIC_EX: Counter = Counter::new();
+
+#[metric(name = "meta_arithmetic_stored")]
+pub static META_ARITHMETIC_STORED: Counter = Counter::new();
+
+#[metric(name = "meta_arithmetic_not_found")]
+pub static META_ARITHMETIC_NOT_FOUND: Counter = Counter::new();
+
+/*
+ * META_NOOP
+ */
+
+#[metric(name = "meta_noop")]
+pub static META_NOOP: Counter = Counter::new();
+
+/*
+ * BINARY
+ */
+
+#[metric(name = "binary")]
+pub static BINARY: Counter = Counter::new();
+
+#[metric(name = "binary_ex")]
+pub static BINARY_EX: Counter = Counter::new();
+
 common::metrics::test_no_duplicates!();
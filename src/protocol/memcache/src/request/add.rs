@@ -6,7 +6,7 @@ use super::*;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct Add {
-    pub(crate) key: Box<[u8]>,
+    pub(crate) key: Key,
     pub(crate) value: Box<[u8]>,
     pub(crate) flags: u32,
     pub(crate) ttl: Ttl,
@@ -115,7 +115,11 @@ impl Klog for Add {
                 return;
             }
         };
-        klog!(
+        klog_command!(
+            KlogRecord::new(KlogOp::Add, self.key(), code)
+                .value_len(self.value().len())
+                .response_len(len)
+                .ttl(self.ttl.get().unwrap_or(0)),
             "\"add {} {} {} {}\" {} {}",
             string_key(self.key()),
             self.flags(),
@@ -141,7 +145,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Add(Add {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     value: b"0".to_vec().into_boxed_slice(),
                     flags: 0,
                     ttl: Ttl::none(),
@@ -156,7 +160,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Add(Add {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     value: b"0".to_vec().into_boxed_slice(),
                     flags: 0,
                     ttl: Ttl::none(),
@@ -0,0 +1,603 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The binary protocol, which frames each request with a fixed size header
+//! that holds the lengths of the extras, key and value which follow it. It is
+//! served on the same port as the text protocol, as binary requests always
+//! start with a magic byte which never starts a text command.
+//!
+//! Binary requests are parsed into the equivalent meta requests, which return
+//! everything a binary response carries, and the binary header is kept so
+//! that the response can be composed in the binary protocol.
+
+use super::*;
+
+/// The first byte of every binary request.
+pub(crate) const REQUEST_MAGIC: u8 = 0x80;
+
+/// The length of the header of a binary request or response.
+pub(crate) const HEADER_LEN: usize = 24;
+
+/// Incr and decr without autovivify set the expiration to this value.
+const NO_VIVIFY: u32 = 0xFFFF_FFFF;
+
+/// The opcodes of the binary protocol. The quiet variants only respond when
+/// there is something the client needs to know, so that they can be
+/// pipelined and ended with a noop.
+#[derive(Debug, PartialEq, Eq, Copy, Clone)]
+pub enum Opcode {
+    Get,
+    Set,
+    Add,
+    Replace,
+    Delete,
+    Increment,
+    Decrement,
+    Quit,
+    Flush,
+    GetQ,
+    Noop,
+    Version,
+    GetK,
+    GetKQ,
+    Append,
+    Prepend,
+    SetQ,
+    AddQ,
+    ReplaceQ,
+    DeleteQ,
+    IncrementQ,
+    DecrementQ,
+    QuitQ,
+    FlushQ,
+    AppendQ,
+    PrependQ,
+    Unknown(u8),
+}
+
+impl Opcode {
+    pub(crate) fn from_byte(byte: u8) -> Self {
+        match byte {
+            0x00 => Self::Get,
+            0x01 => Self::Set,
+            0x02 => Self::Add,
+            0x03 => Self::Replace,
+            0x04 => Self::Delete,
+            0x05 => Self::Increment,
+            0x06 => Self::Decrement,
+            0x07 => Self::Quit,
+            0x08 => Self::Flush,
+            0x09 => Self::GetQ,
+            0x0a => Self::Noop,
+            0x0b => Self::Version,
+            0x0c => Self::GetK,
+            0x0d => Self::GetKQ,
+            0x0e => Self::Append,
+            0x0f => Self::Prepend,
+            0x11 => Self::SetQ,
+            0x12 => Self::AddQ,
+            0x13 => Self::ReplaceQ,
+            0x14 => Self::DeleteQ,
+            0x15 => Self::IncrementQ,
+            0x16 => Self::DecrementQ,
+            0x17 => Self::QuitQ,
+            0x18 => Self::FlushQ,
+            0x19 => Self::AppendQ,
+            0x1a => Self::PrependQ,
+            other => Self::Unknown(other),
+        }
+    }
+
+    pub(crate) fn as_byte(&self) -> u8 {
+        match self {
+            Self::Get => 0x00,
+            Self::Set => 0x01,
+            Self::Add => 0x02,
+            Self::Replace => 0x03,
+            Self::Delete => 0x04,
+            Self::Increment => 0x05,
+            Self::Decrement => 0x06,
+            Self::Quit => 0x07,
+            Self::Flush => 0x08,
+            Self::GetQ => 0x09,
+            Self::Noop => 0x0a,
+            Self::Version => 0x0b,
+            Self::GetK => 0x0c,
+            Self::GetKQ => 0x0d,
+            Self::Append => 0x0e,
+            Self::Prepend => 0x0f,
+            Self::SetQ => 0x11,
+            Self::AddQ => 0x12,
+            Self::ReplaceQ => 0x13,
+            Self::DeleteQ => 0x14,
+            Self::IncrementQ => 0x15,
+            Self::DecrementQ => 0x16,
+            Self::QuitQ => 0x17,
+            Self::FlushQ => 0x18,
+            Self::AppendQ => 0x19,
+            Self::PrependQ => 0x1a,
+            Self::Unknown(byte) => *byte,
+        }
+    }
+
+    /// Returns true for the quiet opcodes.
+    pub fn is_quiet(&self) -> bool {
+        matches!(
+            self,
+            Self::GetQ
+                | Self::GetKQ
+                | Self::SetQ
+                | Self::AddQ
+                | Self::ReplaceQ
+                | Self::DeleteQ
+                | Self::IncrementQ
+                | Self::DecrementQ
+                | Self::QuitQ
+                | Self::FlushQ
+                | Self::AppendQ
+                | Self::PrependQ
+        )
+    }
+
+    /// Returns true for the gets, which return a value and hide a miss rather
+    /// than a success when they are quiet.
+    pub fn is_get(&self) -> bool {
+        matches!(self, Self::Get | Self::GetQ | Self::GetK | Self::GetKQ)
+    }
+
+    /// Returns true for the gets which return the key with the value.
+    pub fn returns_key(&self) -> bool {
+        matches!(self, Self::GetK | Self::GetKQ)
+    }
+
+    /// Returns true for incr and decr, which return the new value as a
+    /// 64bit integer.
+    pub fn is_arithmetic(&self) -> bool {
+        matches!(
+            self,
+            Self::Increment | Self::Decrement | Self::IncrementQ | Self::DecrementQ
+        )
+    }
+}
+
+/// A binary request, which holds the meta request it is executed as.
+#[derive(Debug, PartialEq, Eq)]
+pub struct Binary {
+    pub(crate) opcode: Opcode,
+    pub(crate) opaque: u32,
+    pub(crate) request: Box<Request>,
+}
+
+impl Binary {
+    pub fn opcode(&self) -> Opcode {
+        self.opcode
+    }
+
+    /// The opaque value which is echoed in the response.
+    pub fn opaque(&self) -> u32 {
+        self.opaque
+    }
+
+    /// The request which this binary request is executed as.
+    pub fn request(&self) -> &Request {
+        &self.request
+    }
+
+    /// Returns the key of the request, if it has one.
+    pub fn key(&self) -> Option<&[u8]> {
+        match &*self.request {
+            Request::MetaGet(r) => Some(r.key()),
+            Request::MetaSet(r) => Some(r.key()),
+            Request::MetaDelete(r) => Some(r.key()),
+            Request::MetaArithmetic(r) => Some(r.key()),
+            _ => None,
+        }
+    }
+}
+
+/// Returns a parse failure for a malformed binary request.
+fn invalid(input: &[u8]) -> nom::Err<nom::error::Error<&[u8]>> {
+    nom::Err::Failure(nom::error::Error::new(input, nom::error::ErrorKind::Tag))
+}
+
+impl RequestParser {
+    // the magic byte is checked here, as it selects the binary protocol
+    pub(crate) fn parse_binary_no_stats<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Binary> {
+        let (input, header) = take(HEADER_LEN)(input)?;
+
+        if header[0] != REQUEST_MAGIC {
+            return Err(invalid(input));
+        }
+
+        let opcode = Opcode::from_byte(header[1]);
+        let key_len = u16::from_be_bytes([header[2], header[3]]) as usize;
+        let extras_len = header[4] as usize;
+        let body_len = u32::from_be_bytes([header[8], header[9], header[10], header[11]]) as usize;
+        let opaque = u32::from_be_bytes([header[12], header[13], header[14], header[15]]);
+        let cas = u64::from_be_bytes([
+            header[16], header[17], header[18], header[19], header[20], header[21], header[22],
+            header[23],
+        ]);
+
+        // the lengths are checked before waiting on the body, so that an
+        // oversized request is rejected without being buffered
+        if key_len > self.max_key_len
+            || key_len + extras_len > body_len
+            || body_len - key_len - extras_len > self.max_value_size
+        {
+            return Err(invalid(input));
+        }
+
+        let (input, body) = take(body_len)(input)?;
+        let (extras, body) = body.split_at(extras_len);
+        let (key, value) = body.split_at(key_len);
+
+        let compare_cas = if cas != 0 { Some(cas) } else { None };
+
+        let request = match opcode {
+            Opcode::Get | Opcode::GetQ | Opcode::GetK | Opcode::GetKQ => {
+                if !extras.is_empty() || key.is_empty() || !value.is_empty() {
+                    return Err(invalid(input));
+                }
+                Request::MetaGet(MetaGet {
+                    key: Key::new(key),
+                    flags: MetaFlags {
+                        value: true,
+                        flags: true,
+                        cas: true,
+                        ..Default::default()
+                    },
+                })
+            }
+            Opcode::Set
+            | Opcode::SetQ
+            | Opcode::Add
+            | Opcode::AddQ
+            | Opcode::Replace
+            | Opcode::ReplaceQ => {
+                if extras.len() != 8 || key.is_empty() {
+                    return Err(invalid(input));
+                }
+                let client_flags = u32::from_be_bytes([extras[0], extras[1], extras[2], extras[3]]);
+                let exptime = u32::from_be_bytes([extras[4], extras[5], extras[6], extras[7]]);
+                let mode = match opcode {
+                    Opcode::Add | Opcode::AddQ => MetaMode::Add,
+                    Opcode::Replace | Opcode::ReplaceQ => MetaMode::Replace,
+                    _ => MetaMode::Set,
+                };
+                Request::MetaSet(MetaSet {
+                    key: Key::new(key),
+                    value: value.to_owned().into_boxed_slice(),
+                    flags: MetaFlags {
+                        cas: true,
+                        mode: Some(mode),
+                        compare_cas: compare_cas.filter(|_| mode != MetaMode::Add),
+                        client_flags: Some(client_flags),
+                        new_ttl: Some(Ttl::new(exptime.into(), self.time_type)),
+                        ..Default::default()
+                    },
+                })
+            }
+            Opcode::Append | Opcode::AppendQ | Opcode::Prepend | Opcode::PrependQ => {
+                if !extras.is_empty() || key.is_empty() {
+                    return Err(invalid(input));
+                }
+                let mode = match opcode {
+                    Opcode::Append | Opcode::AppendQ => MetaMode::Append,
+                    _ => MetaMode::Prepend,
+                };
+                Request::MetaSet(MetaSet {
+                    key: Key::new(key),
+                    value: value.to_owned().into_boxed_slice(),
+                    flags: MetaFlags {
+                        cas: true,
+                        mode: Some(mode),
+                        compare_cas,
+                        ..Default::default()
+                    },
+                })
+            }
+            Opcode::Delete | Opcode::DeleteQ => {
+                if !extras.is_empty() || key.is_empty() || !value.is_empty() {
+                    return Err(invalid(input));
+                }
+                Request::MetaDelete(MetaDelete {
+                    key: Key::new(key),
+                    flags: MetaFlags {
+                        compare_cas,
+                        ..Default::default()
+                    },
+                })
+            }
+            Opcode::Increment | Opcode::IncrementQ | Opcode::Decrement | Opcode::DecrementQ => {
+                if extras.len() != 20 || key.is_empty() || !value.is_empty() {
+                    return Err(invalid(input));
+                }
+                let delta = u64::from_be_bytes(extras[0..8].try_into().unwrap());
+                let initial = u64::from_be_bytes(extras[8..16].try_into().unwrap());
+                let exptime = u32::from_be_bytes(extras[16..20].try_into().unwrap());
+                let mode = match opcode {
+                    Opcode::Increment | Opcode::IncrementQ => MetaMode::Incr,
+                    _ => MetaMode::Decr,
+                };
+                Request::MetaArithmetic(MetaArithmetic {
+                    key: Key::new(key),
+                    flags: MetaFlags {
+                        cas: true,
+                        value: true,
+                        mode: Some(mode),
+                        delta: Some(delta),
+                        initial: Some(initial),
+                        vivify: (exptime != NO_VIVIFY)
+                            .then(|| Ttl::new(exptime.into(), self.time_type)),
+                        compare_cas,
+                        ..Default::default()
+                    },
+                })
+            }
+            Opcode::Flush | Opcode::FlushQ => {
+                if !key.is_empty() || !value.is_empty() {
+                    return Err(invalid(input));
+                }
+                let delay = match extras.len() {
+                    0 => 0,
+                    4 => u32::from_be_bytes([extras[0], extras[1], extras[2], extras[3]]),
+                    _ => {
+                        return Err(invalid(input));
+                    }
+                };
+                Request::FlushAll(FlushAll {
+                    delay,
+                    noreply: false,
+                })
+            }
+            Opcode::Quit | Opcode::QuitQ => Request::Quit(Quit {}),
+            // noop and version need nothing from storage, and an unknown
+            // opcode is answered with an error without closing the connection
+            Opcode::Noop | Opcode::Version | Opcode::Unknown(_) => Request::MetaNoop(MetaNoop {}),
+        };
+
+        Ok((
+            input,
+            Binary {
+                opcode,
+                opaque,
+                request: Box::new(request),
+            },
+        ))
+    }
+
+    pub fn parse_binary<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Binary> {
+        match self.parse_binary_no_stats(input) {
+            Ok((input, request)) => {
+                BINARY.increment();
+                Ok((input, request))
+            }
+            Err(e) => {
+                if !e.is_incomplete() {
+                    BINARY.increment();
+                    BINARY_EX.increment();
+                }
+                Err(e)
+            }
+        }
+    }
+}
+
+/// Converts a TTL back into the expiration time of a binary request.
+fn exptime(ttl: Option<Ttl>) -> u32 {
+    match ttl.and_then(|ttl| ttl.get()) {
+        None => 0,
+        // an expiration time in the past was parsed as an immediate expiry,
+        // which is the closest to the original that can be sent
+        Some(ttl) if ttl < 0 => 1,
+        Some(ttl) => ttl as u32,
+    }
+}
+
+impl Compose for Binary {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        let mut extras = [0; 20];
+        let mut cas = 0;
+        let (extras_len, key, value): (usize, &[u8], &[u8]) = match &*self.request {
+            Request::MetaGet(r) => (0, r.key(), b""),
+            Request::MetaSet(r) => {
+                cas = r.flags.compare_cas().unwrap_or(0);
+                if let Some(flags) = r.flags.client_flags() {
+                    extras[0..4].copy_from_slice(&flags.to_be_bytes());
+                    extras[4..8].copy_from_slice(&exptime(r.flags.ttl()).to_be_bytes());
+                    (8, r.key(), r.value())
+                } else {
+                    (0, r.key(), r.value())
+                }
+            }
+            Request::MetaDelete(r) => {
+                cas = r.flags.compare_cas().unwrap_or(0);
+                (0, r.key(), b"")
+            }
+            Request::MetaArithmetic(r) => {
+                cas = r.flags.compare_cas().unwrap_or(0);
+                let vivify = match r.flags.vivify() {
+                    Some(ttl) => exptime(Some(ttl)),
+                    None => NO_VIVIFY,
+                };
+                extras[0..8].copy_from_slice(&r.delta().to_be_bytes());
+                extras[8..16].copy_from_slice(&r.flags.initial().unwrap_or(0).to_be_bytes());
+                extras[16..20].copy_from_slice(&vivify.to_be_bytes());
+                (20, r.key(), b"")
+            }
+            Request::FlushAll(r) if r.delay() != 0 => {
+                extras[0..4].copy_from_slice(&r.delay().to_be_bytes());
+                (4, b"", b"")
+            }
+            _ => (0, b"", b""),
+        };
+
+        let body_len = extras_len + key.len() + value.len();
+
+        let mut header = [0; HEADER_LEN];
+        header[0] = REQUEST_MAGIC;
+        header[1] = self.opcode.as_byte();
+        header[2..4].copy_from_slice(&(key.len() as u16).to_be_bytes());
+        header[4] = extras_len as u8;
+        header[8..12].copy_from_slice(&(body_len as u32).to_be_bytes());
+        header[12..16].copy_from_slice(&self.opaque.to_be_bytes());
+        header[16..24].copy_from_slice(&cas.to_be_bytes());
+
+        session.put_slice(&header);
+        session.put_slice(&extras[..extras_len]);
+        session.put_slice(key);
+        session.put_slice(value);
+
+        HEADER_LEN + body_len
+    }
+}
+
+impl Klog for Binary {
+    type Response = Response;
+
+    fn klog(&self, response: &Self::Response) {
+        if let Response::Binary(response) = response {
+            self.request.klog(response.inner());
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn header(opcode: u8, key_len: u16, extras_len: u8, body_len: u32, cas: u64) -> Vec<u8> {
+        let mut header = vec![REQUEST_MAGIC, opcode];
+        header.extend_from_slice(&key_len.to_be_bytes());
+        header.push(extras_len);
+        header.extend_from_slice(&[0, 0, 0]);
+        header.extend_from_slice(&body_len.to_be_bytes());
+        header.extend_from_slice(&0xdeadbeef_u32.to_be_bytes());
+        header.extend_from_slice(&cas.to_be_bytes());
+        header
+    }
+
+    #[test]
+    fn parse_get() {
+        let parser = RequestParser::new();
+
+        let mut buffer = header(0x0d, 3, 0, 3, 0);
+        buffer.extend_from_slice(b"key");
+
+        let (remaining, request) = parser.parse_request(&buffer).unwrap();
+        assert!(remaining.is_empty());
+        match request {
+            Request::Binary(binary) => {
+                assert_eq!(binary.opcode(), Opcode::GetKQ);
+                assert_eq!(binary.opaque(), 0xdeadbeef);
+                assert_eq!(binary.key(), Some(&b"key"[..]));
+                assert!(matches!(binary.request(), Request::MetaGet(_)));
+            }
+            _ => panic!("not a binary request"),
+        }
+
+        // the request is incomplete until the whole body has been received
+        for len in 0..buffer.len() {
+            assert!(parser
+                .parse_request(&buffer[..len])
+                .unwrap_err()
+                .is_incomplete());
+        }
+    }
+
+    #[test]
+    fn parse_set() {
+        let parser = RequestParser::new();
+
+        let mut buffer = header(0x01, 3, 8, 16, 42);
+        buffer.extend_from_slice(&7_u32.to_be_bytes());
+        buffer.extend_from_slice(&30_u32.to_be_bytes());
+        buffer.extend_from_slice(b"keyvalue");
+
+        let (_, request) = parser.parse_request(&buffer).unwrap();
+        assert_eq!(
+            request,
+            Request::Binary(Binary {
+                opcode: Opcode::Set,
+                opaque: 0xdeadbeef,
+                request: Box::new(Request::MetaSet(MetaSet {
+                    key: b"key".into(),
+                    value: b"value".to_vec().into_boxed_slice(),
+                    flags: MetaFlags {
+                        cas: true,
+                        mode: Some(MetaMode::Set),
+                        compare_cas: Some(42),
+                        client_flags: Some(7),
+                        new_ttl: Some(Ttl::new(30, TimeType::Memcache)),
+                        ..Default::default()
+                    },
+                })),
+            })
+        );
+
+        // a set without its extras is malformed
+        let mut buffer = header(0x01, 3, 0, 8, 0);
+        buffer.extend_from_slice(b"keyvalue");
+        assert!(parser.parse_request(&buffer).is_err());
+    }
+
+    #[test]
+    fn parse_limits() {
+        let parser = RequestParser::new().max_key_len(8).max_value_size(16);
+
+        // an oversized value is rejected from the header alone
+        let buffer = header(0x01, 3, 8, 3 + 8 + 17, 0);
+        assert!(matches!(
+            parser.parse_request(&buffer),
+            Err(nom::Err::Failure(_))
+        ));
+
+        // as is a key which is too long
+        let buffer = header(0x00, 9, 0, 9, 0);
+        assert!(matches!(
+            parser.parse_request(&buffer),
+            Err(nom::Err::Failure(_))
+        ));
+    }
+
+    #[test]
+    fn parse_unknown() {
+        let parser = RequestParser::new();
+
+        // unknown opcodes are parsed, so that they can be answered with an
+        // error, and their body is skipped
+        let mut buffer = header(0x20, 0, 0, 4, 0);
+        buffer.extend_from_slice(b"body");
+        let (remaining, request) = parser.parse_request(&buffer).unwrap();
+        assert!(remaining.is_empty());
+        match request {
+            Request::Binary(binary) => assert_eq!(binary.opcode(), Opcode::Unknown(0x20)),
+            _ => panic!("not a binary request"),
+        }
+    }
+
+    #[test]
+    fn compose() {
+        let parser = RequestParser::new();
+
+        let mut incr = header(0x05, 3, 20, 23, 0);
+        incr.extend_from_slice(&5_u64.to_be_bytes());
+        incr.extend_from_slice(&10_u64.to_be_bytes());
+        incr.extend_from_slice(&NO_VIVIFY.to_be_bytes());
+        incr.extend_from_slice(b"key");
+
+        let mut set = header(0x11, 3, 8, 16, 0);
+        set.extend_from_slice(&7_u32.to_be_bytes());
+        set.extend_from_slice(&30_u32.to_be_bytes());
+        set.extend_from_slice(b"keyvalue");
+
+        for buffer in [incr, set, header(0x0a, 0, 0, 0, 0)] {
+            let (_, request) = parser.parse_request(&buffer).unwrap();
+            let mut composed = Vec::new();
+            assert_eq!(request.compose(&mut composed), buffer.len());
+            assert_eq!(composed, buffer);
+        }
+    }
+}
@@ -6,7 +6,7 @@ use super::*;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct Cas {
-    pub(crate) key: Box<[u8]>,
+    pub(crate) key: Key,
     pub(crate) value: Box<[u8]>,
     pub(crate) flags: u32,
     pub(crate) ttl: Ttl,
@@ -91,7 +91,7 @@ impl RequestParser {
         Ok((
             input,
             Cas {
-                key: key.to_owned().into_boxed_slice(),
+                key: Key::new(key),
                 value: value.to_owned().into_boxed_slice(),
                 ttl,
                 flags,
@@ -177,7 +177,11 @@ impl Klog for Cas {
                 return;
             }
         };
-        klog!(
+        klog_command!(
+            KlogRecord::new(KlogOp::Cas, self.key(), code)
+                .value_len(self.value().len())
+                .response_len(len)
+                .ttl(self.ttl.get().unwrap_or(0)),
             "\"cas {} {} {} {} {}\" {} {}",
             string_key(self.key()),
             self.flags(),
@@ -204,7 +208,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Cas(Cas {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     value: b"0".to_vec().into_boxed_slice(),
                     flags: 0,
                     ttl: Ttl::none(),
@@ -220,7 +224,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Cas(Cas {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     value: b"0".to_vec().into_boxed_slice(),
                     flags: 0,
                     ttl: Ttl::none(),
@@ -6,7 +6,7 @@ use super::*;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct Decr {
-    pub(crate) key: Box<[u8]>,
+    pub(crate) key: Key,
     pub(crate) value: u64,
     pub(crate) noreply: bool,
 }
@@ -90,7 +90,13 @@ impl Klog for Decr {
                 return;
             }
         };
-        klog!("\"decr {}\" {} {}", string_key(self.key()), code, len);
+        klog_command!(
+            KlogRecord::new(KlogOp::Decr, self.key(), code).response_len(len),
+            "\"decr {}\" {} {}",
+            string_key(self.key()),
+            code,
+            len
+        );
     }
 }
 
@@ -108,7 +114,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Decr(Decr {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     value: 1,
                     noreply: false,
                 })
@@ -6,7 +6,7 @@ use super::*;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct Delete {
-    pub(crate) key: Box<[u8]>,
+    pub(crate) key: Key,
     pub(crate) noreply: bool,
 }
 
@@ -53,7 +53,7 @@ impl RequestParser {
         Ok((
             input,
             Delete {
-                key: key.to_owned().into_boxed_slice(),
+                key: Key::new(key),
                 noreply,
             },
         ))
@@ -113,7 +113,13 @@ impl Klog for Delete {
                 return;
             }
         };
-        klog!("\"delete {}\" {} {}", string_key(self.key()), code, len);
+        klog_command!(
+            KlogRecord::new(KlogOp::Delete, self.key(), code).response_len(len),
+            "\"delete {}\" {} {}",
+            string_key(self.key()),
+            code,
+            len
+        );
     }
 }
 
@@ -131,7 +137,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Delete(Delete {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     noreply: false,
                 })
             ))
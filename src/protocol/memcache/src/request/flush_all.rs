@@ -6,8 +6,8 @@ use super::*;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct FlushAll {
-    delay: u32,
-    noreply: bool,
+    pub(crate) delay: u32,
+    pub(crate) noreply: bool,
 }
 
 impl FlushAll {
@@ -32,7 +32,7 @@ impl RequestParser {
         if let Ok((i, _)) = space1(input) {
             // we need to check to make sure we didn't stop because
             // of the CRLF
-            let (i, c) = take_till(|b| (b == b' ' || b == b'\r'))(i)?;
+            let (i, c) = token(i)?;
             if !c.is_empty() {
                 // make sure it's a valid string
                 let c = std::str::from_utf8(c).map_err(|_| {
@@ -0,0 +1,156 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct Gat {
+    pub(crate) ttl: Ttl,
+    pub(crate) keys: Keys,
+}
+
+impl Gat {
+    pub fn ttl(&self) -> Ttl {
+        self.ttl
+    }
+
+    pub fn keys(&self) -> &[Key] {
+        &self.keys
+    }
+}
+
+impl RequestParser {
+    // this is to be called after parsing the command, so we do not match the verb
+    pub(crate) fn parse_gat_no_stats<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Gat> {
+        let (input, _) = space1(input)?;
+        let (input, ttl) = parse_ttl(input, self.time_type)?;
+
+        // the keys follow as they do for a get
+        let (input, request) = self.parse_get_no_stats(input)?;
+
+        Ok((
+            input,
+            Gat {
+                ttl,
+                keys: request.keys,
+            },
+        ))
+    }
+
+    // this is to be called after parsing the command, so we do not match the verb
+    pub fn parse_gat<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Gat> {
+        match self.parse_gat_no_stats(input) {
+            Ok((input, request)) => {
+                GAT.increment();
+                GAT_KEY.add(request.keys.len() as _);
+                Ok((input, request))
+            }
+            Err(e) => {
+                if !e.is_incomplete() {
+                    GAT.increment();
+                    GAT_EX.increment();
+                }
+                Err(e)
+            }
+        }
+    }
+}
+
+impl Compose for Gat {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        compose_gat(session, b"gat", self.ttl, &self.keys)
+    }
+}
+
+/// Writes a `gat` or `gats` request with the verb.
+pub(crate) fn compose_gat(session: &mut dyn BufMut, verb: &[u8], ttl: Ttl, keys: &[Key]) -> usize {
+    let ttl = format!(" {}", ttl.get().unwrap_or(0)).into_bytes();
+
+    let mut size = verb.len() + ttl.len() + CRLF.len();
+
+    session.put_slice(verb);
+    session.put_slice(&ttl);
+    for key in keys.iter() {
+        session.put_slice(b" ");
+        session.put_slice(key);
+        size += 1 + key.len();
+    }
+    session.put_slice(CRLF);
+
+    size
+}
+
+impl Klog for Gat {
+    type Response = Response;
+
+    fn klog(&self, response: &Self::Response) {
+        if let Response::Values(ref res) = response {
+            let mut hit_keys = 0;
+            let mut miss_keys = 0;
+
+            for value in res.values() {
+                if value.len().is_none() {
+                    miss_keys += 1;
+
+                    klog_command!(
+                        KlogRecord::new(KlogOp::Gat, value.key(), MISS),
+                        "\"gat {}\" {} 0",
+                        String::from_utf8_lossy(value.key()),
+                        MISS
+                    );
+                } else {
+                    hit_keys += 1;
+
+                    klog_command!(
+                        KlogRecord::new(KlogOp::Gat, value.key(), HIT)
+                            .value_len(value.len().unwrap()),
+                        "\"gat {}\" {} {}",
+                        String::from_utf8_lossy(value.key()),
+                        HIT,
+                        value.len().unwrap(),
+                    );
+                }
+            }
+
+            GAT_KEY_HIT.add(hit_keys as _);
+            GAT_KEY_MISS.add(miss_keys as _);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse() {
+        let parser = RequestParser::new();
+
+        // the exptime comes before the keys
+        assert_eq!(
+            parser.parse_request(b"gat 60 a b\r\n"),
+            Ok((
+                &b""[..],
+                Request::Gat(Gat {
+                    ttl: Ttl::new(60, TimeType::Memcache),
+                    keys: vec![
+                        b"a".to_vec().into_boxed_slice(),
+                        b"b".to_vec().into_boxed_slice(),
+                    ]
+                    .into_boxed_slice()
+                    .into(),
+                })
+            ))
+        );
+
+        // command name is not case sensitive
+        assert_eq!(
+            parser.parse_request(b"gat 0 key\r\n"),
+            parser.parse_request(b"GAT 0 key\r\n"),
+        );
+
+        // at least one key is required
+        assert!(parser.parse_request(b"gat 60\r\n").is_err());
+    }
+}
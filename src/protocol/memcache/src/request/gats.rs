@@ -0,0 +1,115 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct Gats {
+    pub(crate) ttl: Ttl,
+    pub(crate) keys: Keys,
+}
+
+impl Gats {
+    pub fn ttl(&self) -> Ttl {
+        self.ttl
+    }
+
+    pub fn keys(&self) -> &[Key] {
+        &self.keys
+    }
+}
+
+impl RequestParser {
+    // this is to be called after parsing the command, so we do not match the verb
+    pub(crate) fn parse_gats<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Gats> {
+        // we can use the gat parser here and convert the request
+        match self.parse_gat_no_stats(input) {
+            Ok((input, request)) => {
+                GATS.increment();
+                GATS_KEY.add(request.keys.len() as _);
+                Ok((
+                    input,
+                    Gats {
+                        ttl: request.ttl,
+                        keys: request.keys,
+                    },
+                ))
+            }
+            Err(e) => {
+                if !e.is_incomplete() {
+                    GATS.increment();
+                    GATS_EX.increment();
+                }
+                Err(e)
+            }
+        }
+    }
+}
+
+impl Compose for Gats {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        gat::compose_gat(session, b"gats", self.ttl, &self.keys)
+    }
+}
+
+impl Klog for Gats {
+    type Response = Response;
+
+    fn klog(&self, response: &Self::Response) {
+        if let Response::Values(ref res) = response {
+            let mut hit_keys = 0;
+            let mut miss_keys = 0;
+
+            for value in res.values() {
+                if value.len().is_none() {
+                    miss_keys += 1;
+
+                    klog_command!(
+                        KlogRecord::new(KlogOp::Gats, value.key(), MISS),
+                        "\"gats {}\" {} 0",
+                        String::from_utf8_lossy(value.key()),
+                        MISS
+                    );
+                } else {
+                    hit_keys += 1;
+
+                    klog_command!(
+                        KlogRecord::new(KlogOp::Gats, value.key(), HIT)
+                            .value_len(value.len().unwrap()),
+                        "\"gats {}\" {} {}",
+                        String::from_utf8_lossy(value.key()),
+                        HIT,
+                        value.len().unwrap(),
+                    );
+                }
+            }
+
+            GATS_KEY_HIT.add(hit_keys as _);
+            GATS_KEY_MISS.add(miss_keys as _);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse() {
+        let parser = RequestParser::new();
+
+        assert_eq!(
+            parser.parse_request(b"gats 0 key\r\n"),
+            Ok((
+                &b""[..],
+                Request::Gats(Gats {
+                    ttl: Ttl::none(),
+                    keys: vec![b"key".to_vec().into_boxed_slice()]
+                        .into_boxed_slice()
+                        .into(),
+                })
+            ))
+        );
+    }
+}
@@ -6,19 +6,19 @@ use super::*;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct Get {
-    pub(crate) keys: Box<[Box<[u8]>]>,
+    pub(crate) keys: Keys,
 }
 
 impl Get {
-    pub fn keys(&self) -> &[Box<[u8]>] {
-        self.keys.as_ref()
+    pub fn keys(&self) -> &[Key] {
+        &self.keys
     }
 }
 
 impl RequestParser {
     // this is to be called after parsing the command, so we do not match the verb
     pub(crate) fn parse_get_no_stats<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Get> {
-        let mut keys = Vec::new();
+        let mut keys = Keys::new();
 
         let (mut input, _) = space1(input)?;
 
@@ -27,7 +27,7 @@ impl RequestParser {
 
             match key {
                 Some(k) => {
-                    keys.push(k.to_owned().into_boxed_slice());
+                    keys.push(Key::new(k));
                 }
                 None => {
                     break;
@@ -58,12 +58,7 @@ impl RequestParser {
 
         let (input, _) = space0(input)?;
         let (input, _) = crlf(input)?;
-        Ok((
-            input,
-            Get {
-                keys: keys.to_owned().into_boxed_slice(),
-            },
-        ))
+        Ok((input, Get { keys }))
     }
 
     // this is to be called after parsing the command, so we do not match the verb
@@ -117,7 +112,8 @@ impl Klog for Get {
                 if value.len().is_none() {
                     miss_keys += 1;
 
-                    klog!(
+                    klog_command!(
+                        KlogRecord::new(KlogOp::Get, value.key(), MISS),
                         "\"get {}\" {} 0",
                         String::from_utf8_lossy(value.key()),
                         MISS
@@ -125,7 +121,9 @@ impl Klog for Get {
                 } else {
                     hit_keys += 1;
 
-                    klog!(
+                    klog_command!(
+                        KlogRecord::new(KlogOp::Get, value.key(), HIT)
+                            .value_len(value.len().unwrap()),
                         "\"get {}\" {} {}",
                         String::from_utf8_lossy(value.key()),
                         HIT,
@@ -154,7 +152,9 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Get(Get {
-                    keys: vec![b"key".to_vec().into_boxed_slice()].into_boxed_slice(),
+                    keys: vec![b"key".to_vec().into_boxed_slice()]
+                        .into_boxed_slice()
+                        .into(),
                 })
             ))
         );
@@ -188,7 +188,8 @@ mod tests {
                         b"b".to_vec().into_boxed_slice(),
                         b"c".to_vec().into_boxed_slice(),
                     ]
-                    .into_boxed_slice(),
+                    .into_boxed_slice()
+                    .into(),
                 })
             ))
         );
@@ -199,9 +200,128 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Get(Get {
-                    keys: vec![b"evil\0key".to_vec().into_boxed_slice(),].into_boxed_slice()
+                    keys: vec![b"evil\0key".to_vec().into_boxed_slice(),]
+                        .into_boxed_slice()
+                        .into()
                 })
             ))
         );
     }
+
+    #[test]
+    fn shard() {
+        let parser = RequestParser::new();
+        let (_, request) = parser.parse_request(b"get a b c d\r\n").unwrap();
+
+        // keys are sharded by their first byte
+        let shard = |key: &[u8]| (key[0] % 2) as usize;
+
+        let parts = request.split(&shard).expect("request was not split");
+        assert_eq!(
+            parts,
+            vec![
+                (
+                    1,
+                    Request::get(
+                        vec![
+                            b"a".to_vec().into_boxed_slice(),
+                            b"c".to_vec().into_boxed_slice()
+                        ]
+                        .into_boxed_slice()
+                    )
+                ),
+                (
+                    0,
+                    Request::get(
+                        vec![
+                            b"b".to_vec().into_boxed_slice(),
+                            b"d".to_vec().into_boxed_slice()
+                        ]
+                        .into_boxed_slice()
+                    )
+                ),
+            ]
+        );
+
+        // the values are returned in the order of the keys in the request
+        let responses = vec![
+            Response::values(
+                vec![Value::new(b"a", 0, None, b"1"), Value::none(b"c")].into_boxed_slice(),
+            ),
+            Response::values(
+                vec![
+                    Value::new(b"b", 0, None, b"2"),
+                    Value::new(b"d", 0, None, b"4"),
+                ]
+                .into_boxed_slice(),
+            ),
+        ];
+        assert_eq!(
+            request.merge(responses, &shard),
+            Response::values(
+                vec![
+                    Value::new(b"a", 0, None, b"1"),
+                    Value::new(b"b", 0, None, b"2"),
+                    Value::none(b"c"),
+                    Value::new(b"d", 0, None, b"4"),
+                ]
+                .into_boxed_slice()
+            )
+        );
+
+        // requests with all keys on one shard are not split
+        let (_, request) = parser.parse_request(b"get a c\r\n").unwrap();
+        assert!(request.split(&shard).is_none());
+    }
+
+    #[test]
+    fn chunks() {
+        let parser = RequestParser::new();
+        let (_, request) = parser.parse_request(b"get a b c\r\n").unwrap();
+
+        let key = |key: &[u8]| key.to_vec().into_boxed_slice();
+        let chunks = request.chunks(2).expect("request was not chunked");
+        assert_eq!(
+            chunks,
+            vec![
+                Request::get(vec![key(b"a"), key(b"b")].into_boxed_slice()),
+                Request::get(vec![key(b"c")].into_boxed_slice()),
+            ]
+        );
+
+        // the responses to the chunks together make up one response, and a
+        // chunk which fails is a miss for each of its keys
+        let mut composed = Vec::new();
+        let first = Response::values(vec![Value::new(b"a", 0, None, b"1")].into_boxed_slice());
+        chunks[0]
+            .chunk_response(first, false)
+            .compose(&mut composed);
+        chunks[1]
+            .chunk_response(Response::error(), true)
+            .compose(&mut composed);
+        assert_eq!(composed, b"VALUE a 0 1\r\n1\r\nEND\r\n");
+
+        // requests for no more keys than a chunk are not chunked
+        assert!(request.chunks(3).is_none());
+        assert!(request.chunks(0).is_none());
+    }
+
+    #[test]
+    fn hot_copy() {
+        let parser = RequestParser::new();
+        let (_, request) = parser.parse_request(b"get a\r\n").unwrap();
+        assert_eq!(request.hot_key(), Some(&b"a"[..]));
+
+        // only a value which was found is copied
+        let miss = Response::values(vec![Value::none(b"a")].into_boxed_slice());
+        assert!(request.hot_copy(&miss).is_none());
+
+        let hit = Response::values(vec![Value::new(b"a", 7, None, b"1")].into_boxed_slice());
+        let copy = request.hot_copy(&hit).expect("value was not copied");
+        assert_eq!(request.from_hot_copy(&copy), Some(hit));
+
+        // gets of more than one key are not answered from copies
+        let (_, request) = parser.parse_request(b"get a b\r\n").unwrap();
+        assert!(request.hot_key().is_none());
+    }
 }
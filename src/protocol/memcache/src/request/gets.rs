@@ -6,12 +6,12 @@ use super::*;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct Gets {
-    pub(crate) keys: Box<[Box<[u8]>]>,
+    pub(crate) keys: Keys,
 }
 
 impl Gets {
-    pub fn keys(&self) -> &[Box<[u8]>] {
-        self.keys.as_ref()
+    pub fn keys(&self) -> &[Key] {
+        &self.keys
     }
 }
 
@@ -67,7 +67,8 @@ impl Klog for Gets {
                 if value.len().is_none() {
                     miss_keys += 1;
 
-                    klog!(
+                    klog_command!(
+                        KlogRecord::new(KlogOp::Gets, value.key(), MISS),
                         "\"gets {}\" {} 0",
                         String::from_utf8_lossy(value.key()),
                         MISS
@@ -75,7 +76,9 @@ impl Klog for Gets {
                 } else {
                     hit_keys += 1;
 
-                    klog!(
+                    klog_command!(
+                        KlogRecord::new(KlogOp::Gets, value.key(), HIT)
+                            .value_len(value.len().unwrap()),
                         "\"gets {}\" {} {}",
                         String::from_utf8_lossy(value.key()),
                         HIT,
@@ -104,7 +107,9 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Gets(Gets {
-                    keys: vec![b"key".to_vec().into_boxed_slice()].into_boxed_slice(),
+                    keys: vec![b"key".to_vec().into_boxed_slice()]
+                        .into_boxed_slice()
+                        .into(),
                 })
             ))
         );
@@ -138,7 +143,8 @@ mod tests {
                         b"b".to_vec().into_boxed_slice(),
                         b"c".to_vec().into_boxed_slice(),
                     ]
-                    .into_boxed_slice(),
+                    .into_boxed_slice()
+                    .into(),
                 })
             ))
         );
@@ -149,7 +155,9 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Gets(Gets {
-                    keys: vec![b"evil\0key".to_vec().into_boxed_slice(),].into_boxed_slice()
+                    keys: vec![b"evil\0key".to_vec().into_boxed_slice(),]
+                        .into_boxed_slice()
+                        .into()
                 })
             ))
         );
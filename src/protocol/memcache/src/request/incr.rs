@@ -6,7 +6,7 @@ use super::*;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct Incr {
-    pub(crate) key: Box<[u8]>,
+    pub(crate) key: Key,
     pub(crate) value: u64,
     pub(crate) noreply: bool,
 }
@@ -60,7 +60,7 @@ impl RequestParser {
         Ok((
             input,
             Incr {
-                key: key.to_owned().into_boxed_slice(),
+                key: Key::new(key),
                 value,
                 noreply,
             },
@@ -122,7 +122,13 @@ impl Klog for Incr {
                 return;
             }
         };
-        klog!("\"incr {}\" {} {}", string_key(self.key()), code, len);
+        klog_command!(
+            KlogRecord::new(KlogOp::Incr, self.key(), code).response_len(len),
+            "\"incr {}\" {} {}",
+            string_key(self.key()),
+            code,
+            len
+        );
     }
 }
 
@@ -140,7 +146,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Incr(Incr {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     value: 1,
                     noreply: false,
                 })
@@ -153,7 +159,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Incr(Incr {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     value: 1,
                     noreply: true,
                 })
@@ -166,7 +172,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Incr(Incr {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     value: 42,
                     noreply: false,
                 })
@@ -0,0 +1,238 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use core::fmt::Debug;
+use core::hash::{Hash, Hasher};
+use core::ops::Deref;
+
+/// The number of bytes of a key which are held inline. This covers the keys
+/// of most workloads while keeping `Key`, along with its hash, no larger than
+/// seven words.
+pub const INLINE_KEY_LEN: usize = 46;
+
+/// The key of a request. Keys of up to `INLINE_KEY_LEN` bytes are held inline
+/// so that parsing them does not allocate. Longer keys are held in their own
+/// allocation. The hash of the key is computed once as it is parsed, so that
+/// storage does not hash it again.
+#[derive(Clone)]
+pub struct Key {
+    inner: KeyInner,
+    hash: u64,
+}
+
+#[derive(Clone)]
+enum KeyInner {
+    Inline { len: u8, data: [u8; INLINE_KEY_LEN] },
+    Boxed(Box<[u8]>),
+}
+
+impl Key {
+    pub fn new(key: &[u8]) -> Self {
+        let inner = if key.len() <= INLINE_KEY_LEN {
+            let mut data = [0; INLINE_KEY_LEN];
+            data[..key.len()].copy_from_slice(key);
+            KeyInner::Inline {
+                len: key.len() as u8,
+                data,
+            }
+        } else {
+            KeyInner::Boxed(key.into())
+        };
+
+        Self {
+            inner,
+            hash: storage_types::hash_key(key),
+        }
+    }
+
+    /// Returns the hash of the key, as from [`storage_types::hash_key`].
+    pub fn hash(&self) -> u64 {
+        self.hash
+    }
+}
+
+impl Deref for Key {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        match &self.inner {
+            KeyInner::Inline { len, data } => &data[..*len as usize],
+            KeyInner::Boxed(key) => key,
+        }
+    }
+}
+
+impl AsRef<[u8]> for Key {
+    fn as_ref(&self) -> &[u8] {
+        self
+    }
+}
+
+impl From<&[u8]> for Key {
+    fn from(other: &[u8]) -> Self {
+        Self::new(other)
+    }
+}
+
+impl<const N: usize> From<&[u8; N]> for Key {
+    fn from(other: &[u8; N]) -> Self {
+        Self::new(other)
+    }
+}
+
+impl From<Box<[u8]>> for Key {
+    fn from(other: Box<[u8]>) -> Self {
+        // keep the existing allocation for keys which are already boxed
+        let hash = storage_types::hash_key(&other);
+        Self {
+            inner: KeyInner::Boxed(other),
+            hash,
+        }
+    }
+}
+
+impl PartialEq for Key {
+    fn eq(&self, other: &Self) -> bool {
+        **self == **other
+    }
+}
+
+impl Eq for Key {}
+
+impl Hash for Key {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        (**self).hash(state)
+    }
+}
+
+impl Debug for Key {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        (**self).fmt(f)
+    }
+}
+
+/// The keys of a retrieval request. A lone key is held inline, so that a
+/// request for one short key is parsed without allocating.
+#[derive(Clone)]
+pub struct Keys {
+    inner: KeysInner,
+}
+
+#[derive(Clone)]
+enum KeysInner {
+    One([Key; 1]),
+    Many(Vec<Key>),
+}
+
+impl Keys {
+    pub fn new() -> Self {
+        Self {
+            inner: KeysInner::Many(Vec::new()),
+        }
+    }
+
+    pub fn push(&mut self, key: Key) {
+        let inner = std::mem::replace(&mut self.inner, KeysInner::Many(Vec::new()));
+
+        self.inner = match inner {
+            KeysInner::Many(keys) if keys.is_empty() => KeysInner::One([key]),
+            KeysInner::Many(mut keys) => {
+                keys.push(key);
+                KeysInner::Many(keys)
+            }
+            KeysInner::One([first]) => KeysInner::Many(vec![first, key]),
+        };
+    }
+}
+
+impl Default for Keys {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Deref for Keys {
+    type Target = [Key];
+
+    fn deref(&self) -> &[Key] {
+        match &self.inner {
+            KeysInner::One(keys) => keys,
+            KeysInner::Many(keys) => keys,
+        }
+    }
+}
+
+impl FromIterator<Key> for Keys {
+    fn from_iter<I: IntoIterator<Item = Key>>(iter: I) -> Self {
+        let mut keys = Self::new();
+        for key in iter {
+            keys.push(key);
+        }
+        keys
+    }
+}
+
+impl From<Box<[Box<[u8]>]>> for Keys {
+    fn from(other: Box<[Box<[u8]>]>) -> Self {
+        other.into_vec().into_iter().map(Key::from).collect()
+    }
+}
+
+impl PartialEq for Keys {
+    fn eq(&self, other: &Self) -> bool {
+        **self == **other
+    }
+}
+
+impl Eq for Keys {}
+
+impl Debug for Keys {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        (**self).fmt(f)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn sizes() {
+        assert_eq!(std::mem::size_of::<Key>(), 56);
+    }
+
+    #[test]
+    fn key() {
+        let short = Key::new(b"key");
+        assert!(matches!(short.inner, KeyInner::Inline { .. }));
+        assert_eq!(&*short, b"key");
+
+        let long = vec![b'a'; INLINE_KEY_LEN + 1];
+        let key = Key::new(&long);
+        assert!(matches!(key.inner, KeyInner::Boxed(_)));
+        assert_eq!(&*key, &long[..]);
+
+        // keys compare by their bytes however they are held
+        let boxed = Key::from(b"key".to_vec().into_boxed_slice());
+        assert_eq!(short, boxed);
+        assert_eq!(short.hash(), boxed.hash());
+        assert_eq!(short.hash(), storage_types::hash_key(b"key"));
+    }
+
+    #[test]
+    fn keys() {
+        let mut keys = Keys::new();
+        assert!(keys.is_empty());
+
+        keys.push(Key::new(b"a"));
+        assert!(matches!(keys.inner, KeysInner::One(_)));
+
+        keys.push(Key::new(b"b"));
+        keys.push(Key::new(b"c"));
+        assert_eq!(
+            &*keys,
+            &[Key::new(b"a"), Key::new(b"b"), Key::new(b"c")][..]
+        );
+    }
+}
@@ -0,0 +1,424 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The flags which follow the key of the meta commands. Each flag is a single
+//! character, some of which are immediately followed by a token argument, for
+//! example `mg key v t N30`.
+
+use super::*;
+
+/// The longest opaque token which is accepted, which matches memcached.
+const MAX_OPAQUE_LEN: usize = 32;
+
+/// The mode of a meta set or meta arithmetic request, selected with the `M`
+/// flag.
+#[derive(Debug, PartialEq, Eq, Copy, Clone)]
+pub enum MetaMode {
+    Add,
+    Append,
+    Prepend,
+    Replace,
+    Set,
+    Incr,
+    Decr,
+}
+
+impl MetaMode {
+    fn as_byte(&self) -> u8 {
+        match self {
+            Self::Add => b'E',
+            Self::Append => b'A',
+            Self::Prepend => b'P',
+            Self::Replace => b'R',
+            Self::Set => b'S',
+            Self::Incr => b'I',
+            Self::Decr => b'D',
+        }
+    }
+}
+
+/// The flags of a meta request. Flags which ask for part of the item to be
+/// returned are held as booleans, the others hold their argument if they were
+/// provided. Each command only accepts the flags which apply to it.
+#[derive(Debug, PartialEq, Eq, Clone, Default)]
+pub struct MetaFlags {
+    pub(crate) cas: bool,
+    pub(crate) flags: bool,
+    pub(crate) key: bool,
+    pub(crate) size: bool,
+    pub(crate) ttl: bool,
+    pub(crate) value: bool,
+    pub(crate) quiet: bool,
+    pub(crate) no_bump: bool,
+    pub(crate) invalidate: bool,
+    pub(crate) opaque: Option<Key>,
+    pub(crate) compare_cas: Option<u64>,
+    pub(crate) client_flags: Option<u32>,
+    pub(crate) mode: Option<MetaMode>,
+    pub(crate) new_ttl: Option<Ttl>,
+    pub(crate) vivify: Option<Ttl>,
+    pub(crate) recache: Option<u32>,
+    pub(crate) initial: Option<u64>,
+    pub(crate) delta: Option<u64>,
+}
+
+impl MetaFlags {
+    /// `c`: return the cas value of the item.
+    pub fn return_cas(&self) -> bool {
+        self.cas
+    }
+
+    /// `f`: return the client flags of the item.
+    pub fn return_flags(&self) -> bool {
+        self.flags
+    }
+
+    /// `k`: return the key of the item.
+    pub fn return_key(&self) -> bool {
+        self.key
+    }
+
+    /// `s`: return the size of the item value.
+    pub fn return_size(&self) -> bool {
+        self.size
+    }
+
+    /// `t`: return the remaining ttl of the item in seconds.
+    pub fn return_ttl(&self) -> bool {
+        self.ttl
+    }
+
+    /// `v`: return the value of the item.
+    pub fn return_value(&self) -> bool {
+        self.value
+    }
+
+    /// `q`: suppress the responses which carry no information, so that a
+    /// pipeline of requests ended by a meta noop only returns the interesting
+    /// responses.
+    pub fn quiet(&self) -> bool {
+        self.quiet
+    }
+
+    /// `u`: do not count the access towards the item frequency.
+    pub fn no_bump(&self) -> bool {
+        self.no_bump
+    }
+
+    /// `I`: mark the item as stale instead of removing it on delete, or when
+    /// the compare cas is older than the item on set.
+    pub fn invalidate(&self) -> bool {
+        self.invalidate
+    }
+
+    /// `O`: an opaque token which is echoed in the response.
+    pub fn opaque(&self) -> Option<&[u8]> {
+        self.opaque.as_deref()
+    }
+
+    /// `C`: only apply the request if the item has this cas value.
+    pub fn compare_cas(&self) -> Option<u64> {
+        self.compare_cas
+    }
+
+    /// `F`: the client flags to store with the item.
+    pub fn client_flags(&self) -> Option<u32> {
+        self.client_flags
+    }
+
+    /// `M`: the mode of a set or arithmetic request.
+    pub fn mode(&self) -> Option<MetaMode> {
+        self.mode
+    }
+
+    /// `T`: the ttl to store or update the item with.
+    pub fn ttl(&self) -> Option<Ttl> {
+        self.new_ttl
+    }
+
+    /// `N`: on a miss, create the item with this ttl.
+    pub fn vivify(&self) -> Option<Ttl> {
+        self.vivify
+    }
+
+    /// `R`: hand out the right to recache the item once its remaining ttl
+    /// drops below this many seconds.
+    pub fn recache(&self) -> Option<u32> {
+        self.recache
+    }
+
+    /// `J`: the initial value of an item created by an arithmetic request.
+    pub fn initial(&self) -> Option<u64> {
+        self.initial
+    }
+
+    /// `D`: the delta of an arithmetic request.
+    pub fn delta(&self) -> Option<u64> {
+        self.delta
+    }
+}
+
+fn failure(input: &[u8]) -> nom::Err<nom::error::Error<&[u8]>> {
+    nom::Err::Failure(nom::error::Error::new(input, nom::error::ErrorKind::Tag))
+}
+
+impl RequestParser {
+    /// Parses the flags of a meta request, through the end of the command
+    /// line. Only the flags in `allowed` are accepted, any other flag causes
+    /// the request to be rejected.
+    pub(crate) fn parse_meta_flags<'a>(
+        &self,
+        input: &'a [u8],
+        allowed: &[u8],
+    ) -> IResult<&'a [u8], MetaFlags> {
+        let mut flags = MetaFlags::default();
+        let mut input = input;
+
+        loop {
+            let (i, _) = space0(input)?;
+
+            let flag = match i.first() {
+                Some(b'\r') => {
+                    let (i, _) = crlf(i)?;
+                    return Ok((i, flags));
+                }
+                Some(flag) => *flag,
+                None => return Err(nom::Err::Incomplete(nom::Needed::new(1))),
+            };
+
+            if !allowed.contains(&flag) {
+                return Err(failure(i));
+            }
+
+            let i = &i[1..];
+            let i = match flag {
+                b'c' => {
+                    flags.cas = true;
+                    i
+                }
+                b'f' => {
+                    flags.flags = true;
+                    i
+                }
+                b'k' => {
+                    flags.key = true;
+                    i
+                }
+                b's' => {
+                    flags.size = true;
+                    i
+                }
+                b't' => {
+                    flags.ttl = true;
+                    i
+                }
+                b'v' => {
+                    flags.value = true;
+                    i
+                }
+                b'q' => {
+                    flags.quiet = true;
+                    i
+                }
+                b'u' => {
+                    flags.no_bump = true;
+                    i
+                }
+                b'I' => {
+                    flags.invalidate = true;
+                    i
+                }
+                b'O' => {
+                    let (i, opaque) = token(i)?;
+                    if opaque.len() > MAX_OPAQUE_LEN {
+                        return Err(failure(i));
+                    }
+                    flags.opaque = Some(Key::new(opaque));
+                    i
+                }
+                b'C' => {
+                    let (i, cas) = parse_u64(i)?;
+                    flags.compare_cas = Some(cas);
+                    i
+                }
+                b'F' => {
+                    let (i, client_flags) = parse_u32(i)?;
+                    flags.client_flags = Some(client_flags);
+                    i
+                }
+                b'M' => {
+                    let (i, mode) = token(i)?;
+                    let mode = match mode {
+                        b"E" | b"e" => MetaMode::Add,
+                        b"A" | b"a" => MetaMode::Append,
+                        b"P" | b"p" => MetaMode::Prepend,
+                        b"R" | b"r" => MetaMode::Replace,
+                        b"S" | b"s" => MetaMode::Set,
+                        b"I" | b"i" | b"+" => MetaMode::Incr,
+                        b"D" | b"d" | b"-" => MetaMode::Decr,
+                        _ => return Err(failure(i)),
+                    };
+                    flags.mode = Some(mode);
+                    i
+                }
+                b'T' => {
+                    let (i, ttl) = parse_ttl(i, self.time_type)?;
+                    flags.new_ttl = Some(ttl);
+                    i
+                }
+                b'N' => {
+                    let (i, ttl) = parse_ttl(i, self.time_type)?;
+                    flags.vivify = Some(ttl);
+                    i
+                }
+                b'R' => {
+                    let (i, threshold) = parse_u32(i)?;
+                    flags.recache = Some(threshold);
+                    i
+                }
+                b'J' => {
+                    let (i, initial) = parse_u64(i)?;
+                    flags.initial = Some(initial);
+                    i
+                }
+                b'D' => {
+                    let (i, delta) = parse_u64(i)?;
+                    flags.delta = Some(delta);
+                    i
+                }
+                _ => return Err(failure(i)),
+            };
+
+            // each flag must be followed by a space or the end of the line
+            match i.first() {
+                Some(b' ') | Some(b'\r') => {}
+                Some(_) => return Err(failure(i)),
+                None => return Err(nom::Err::Incomplete(nom::Needed::new(1))),
+            }
+
+            input = i;
+        }
+    }
+}
+
+impl MetaFlags {
+    /// Composes the flags, each preceded by a space, returning the number of
+    /// bytes.
+    pub(crate) fn compose(&self, session: &mut dyn BufMut) -> usize {
+        let mut buf = Vec::new();
+
+        for (set, flag) in [
+            (self.cas, " c"),
+            (self.flags, " f"),
+            (self.key, " k"),
+            (self.size, " s"),
+            (self.ttl, " t"),
+            (self.value, " v"),
+            (self.quiet, " q"),
+            (self.no_bump, " u"),
+            (self.invalidate, " I"),
+        ] {
+            if set {
+                buf.extend_from_slice(flag.as_bytes());
+            }
+        }
+        if let Some(opaque) = &self.opaque {
+            buf.extend_from_slice(b" O");
+            buf.extend_from_slice(opaque);
+        }
+        if let Some(cas) = self.compare_cas {
+            let _ = write!(buf, " C{cas}");
+        }
+        if let Some(client_flags) = self.client_flags {
+            let _ = write!(buf, " F{client_flags}");
+        }
+        if let Some(mode) = self.mode {
+            buf.extend_from_slice(&[b' ', b'M', mode.as_byte()]);
+        }
+        if let Some(ttl) = self.new_ttl {
+            let _ = write!(buf, " T{}", ttl.get().unwrap_or(0));
+        }
+        if let Some(ttl) = self.vivify {
+            let _ = write!(buf, " N{}", ttl.get().unwrap_or(0));
+        }
+        if let Some(threshold) = self.recache {
+            let _ = write!(buf, " R{threshold}");
+        }
+        if let Some(initial) = self.initial {
+            let _ = write!(buf, " J{initial}");
+        }
+        if let Some(delta) = self.delta {
+            let _ = write!(buf, " D{delta}");
+        }
+
+        session.put_slice(&buf);
+        buf.len()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse() {
+        let parser = RequestParser::new();
+        let all = b"cfkstvquIOCFMTNRJD";
+
+        // no flags
+        assert_eq!(
+            parser.parse_meta_flags(b"\r\n", all),
+            Ok((&b""[..], MetaFlags::default()))
+        );
+
+        // flags with and without arguments
+        assert_eq!(
+            parser.parse_meta_flags(b" v t Oabc N30 R5 MS\r\n", all),
+            Ok((
+                &b""[..],
+                MetaFlags {
+                    value: true,
+                    ttl: true,
+                    opaque: Some(Key::new(b"abc")),
+                    vivify: Some(Ttl::new(30, TimeType::Memcache)),
+                    recache: Some(5),
+                    mode: Some(MetaMode::Set),
+                    ..Default::default()
+                }
+            ))
+        );
+
+        // the line must be complete
+        assert!(parser
+            .parse_meta_flags(b" v t", all)
+            .unwrap_err()
+            .is_incomplete());
+
+        // flags which are not allowed are rejected
+        assert!(parser.parse_meta_flags(b" v\r\n", b"c").is_err());
+
+        // as are arguments which run into the next flag
+        assert!(parser.parse_meta_flags(b" R5v\r\n", all).is_err());
+        assert!(parser.parse_meta_flags(b" Mx\r\n", all).is_err());
+
+        // the opaque token is limited in length
+        let mut long = b" O".to_vec();
+        long.extend_from_slice(&[b'a'; MAX_OPAQUE_LEN + 1]);
+        long.extend_from_slice(b"\r\n");
+        assert!(parser.parse_meta_flags(&long, all).is_err());
+    }
+
+    #[test]
+    fn compose() {
+        let parser = RequestParser::new();
+        let all = b"cfkstvquIOCFMTNRJD";
+        let line = b" c v q Oab C7 MA T10\r\n";
+
+        let (_, flags) = parser.parse_meta_flags(line, all).unwrap();
+        let mut buf = Vec::new();
+        let len = flags.compose(&mut buf);
+        assert_eq!(len, buf.len());
+        assert_eq!(&buf[..], &line[..line.len() - 2]);
+    }
+}
@@ -0,0 +1,184 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+
+/// The flags which are accepted by a meta arithmetic request.
+const FLAGS: &[u8] = b"ckqtvCDJMNOT";
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct MetaArithmetic {
+    pub(crate) key: Key,
+    pub(crate) flags: MetaFlags,
+}
+
+impl MetaArithmetic {
+    pub fn key(&self) -> &[u8] {
+        self.key.as_ref()
+    }
+
+    pub fn flags(&self) -> &MetaFlags {
+        &self.flags
+    }
+
+    /// The mode of the request, which defaults to an increment.
+    pub fn mode(&self) -> MetaMode {
+        self.flags.mode().unwrap_or(MetaMode::Incr)
+    }
+
+    /// The delta of the request, which defaults to one.
+    pub fn delta(&self) -> u64 {
+        self.flags.delta().unwrap_or(1)
+    }
+}
+
+impl RequestParser {
+    // this is to be called after parsing the command, so we do not match the verb
+    pub(crate) fn parse_meta_arithmetic_no_stats<'a>(
+        &self,
+        input: &'a [u8],
+    ) -> IResult<&'a [u8], MetaArithmetic> {
+        let (input, _) = space1(input)?;
+        let (input, key) = key(input, self.max_key_len)?;
+
+        let key = match key {
+            Some(k) => k,
+            None => {
+                return Err(nom::Err::Failure(nom::error::Error::new(
+                    input,
+                    nom::error::ErrorKind::Tag,
+                )));
+            }
+        };
+
+        let (input, flags) = self.parse_meta_flags(input, FLAGS)?;
+
+        // only the arithmetic modes apply to a meta arithmetic request
+        if !matches!(
+            flags.mode(),
+            None | Some(MetaMode::Incr) | Some(MetaMode::Decr)
+        ) {
+            return Err(nom::Err::Failure(nom::error::Error::new(
+                input,
+                nom::error::ErrorKind::Tag,
+            )));
+        }
+
+        Ok((
+            input,
+            MetaArithmetic {
+                key: Key::new(key),
+                flags,
+            },
+        ))
+    }
+
+    pub fn parse_meta_arithmetic<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], MetaArithmetic> {
+        match self.parse_meta_arithmetic_no_stats(input) {
+            Ok((input, request)) => {
+                META_ARITHMETIC.increment();
+                Ok((input, request))
+            }
+            Err(e) => {
+                if !e.is_incomplete() {
+                    META_ARITHMETIC.increment();
+                    META_ARITHMETIC_EX.increment();
+                }
+                Err(e)
+            }
+        }
+    }
+}
+
+impl Compose for MetaArithmetic {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        let verb = b"ma ";
+
+        session.put_slice(verb);
+        session.put_slice(&self.key);
+        let flags = self.flags.compose(session);
+        session.put_slice(CRLF);
+
+        verb.len() + self.key.len() + flags + CRLF.len()
+    }
+}
+
+impl Klog for MetaArithmetic {
+    type Response = Response;
+
+    fn klog(&self, response: &Self::Response) {
+        let code = match response {
+            Response::Meta(ref res) => match res.code() {
+                MetaCode::Hd | MetaCode::Va => {
+                    META_ARITHMETIC_STORED.increment();
+                    STORED
+                }
+                MetaCode::Nf => {
+                    META_ARITHMETIC_NOT_FOUND.increment();
+                    NOT_FOUND
+                }
+                MetaCode::Ex => EXISTS,
+                _ => {
+                    return;
+                }
+            },
+            _ => {
+                return;
+            }
+        };
+        klog_command!(
+            KlogRecord::new(KlogOp::MetaArithmetic, self.key(), code),
+            "\"ma {} {}\" {}",
+            string_key(self.key()),
+            self.delta(),
+            code
+        );
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse() {
+        let parser = RequestParser::new();
+
+        // basic meta arithmetic command
+        let (_, request) = parser.parse_request(b"ma key\r\n").unwrap();
+        assert_eq!(
+            request,
+            Request::MetaArithmetic(MetaArithmetic {
+                key: b"key".into(),
+                flags: MetaFlags::default(),
+            })
+        );
+        if let Request::MetaArithmetic(request) = request {
+            assert_eq!(request.mode(), MetaMode::Incr);
+            assert_eq!(request.delta(), 1);
+        }
+
+        // decrement with autovivify
+        assert_eq!(
+            parser.parse_request(b"ma key MD D5 N0 J10 v\r\n"),
+            Ok((
+                &b""[..],
+                Request::MetaArithmetic(MetaArithmetic {
+                    key: b"key".into(),
+                    flags: MetaFlags {
+                        mode: Some(MetaMode::Decr),
+                        delta: Some(5),
+                        vivify: Some(Ttl::none()),
+                        initial: Some(10),
+                        value: true,
+                        ..Default::default()
+                    },
+                })
+            ))
+        );
+
+        // storage modes are rejected
+        assert!(parser.parse_request(b"ma key MS\r\n").is_err());
+    }
+}
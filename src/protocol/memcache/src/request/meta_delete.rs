@@ -0,0 +1,154 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+
+/// The flags which are accepted by a meta delete.
+const FLAGS: &[u8] = b"kqICOT";
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct MetaDelete {
+    pub(crate) key: Key,
+    pub(crate) flags: MetaFlags,
+}
+
+impl MetaDelete {
+    pub fn key(&self) -> &[u8] {
+        self.key.as_ref()
+    }
+
+    pub fn flags(&self) -> &MetaFlags {
+        &self.flags
+    }
+}
+
+impl RequestParser {
+    // this is to be called after parsing the command, so we do not match the verb
+    pub(crate) fn parse_meta_delete_no_stats<'a>(
+        &self,
+        input: &'a [u8],
+    ) -> IResult<&'a [u8], MetaDelete> {
+        let (input, _) = space1(input)?;
+        let (input, key) = key(input, self.max_key_len)?;
+
+        let key = match key {
+            Some(k) => k,
+            None => {
+                return Err(nom::Err::Failure(nom::error::Error::new(
+                    input,
+                    nom::error::ErrorKind::Tag,
+                )));
+            }
+        };
+
+        let (input, flags) = self.parse_meta_flags(input, FLAGS)?;
+
+        Ok((
+            input,
+            MetaDelete {
+                key: Key::new(key),
+                flags,
+            },
+        ))
+    }
+
+    pub fn parse_meta_delete<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], MetaDelete> {
+        match self.parse_meta_delete_no_stats(input) {
+            Ok((input, request)) => {
+                META_DELETE.increment();
+                Ok((input, request))
+            }
+            Err(e) => {
+                if !e.is_incomplete() {
+                    META_DELETE.increment();
+                    META_DELETE_EX.increment();
+                }
+                Err(e)
+            }
+        }
+    }
+}
+
+impl Compose for MetaDelete {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        let verb = b"md ";
+
+        session.put_slice(verb);
+        session.put_slice(&self.key);
+        let flags = self.flags.compose(session);
+        session.put_slice(CRLF);
+
+        verb.len() + self.key.len() + flags + CRLF.len()
+    }
+}
+
+impl Klog for MetaDelete {
+    type Response = Response;
+
+    fn klog(&self, response: &Self::Response) {
+        let code = match response {
+            Response::Meta(ref res) => match res.code() {
+                MetaCode::Hd => {
+                    META_DELETE_DELETED.increment();
+                    DELETED
+                }
+                MetaCode::Nf => {
+                    META_DELETE_NOT_FOUND.increment();
+                    NOT_FOUND
+                }
+                MetaCode::Ex => EXISTS,
+                _ => {
+                    return;
+                }
+            },
+            _ => {
+                return;
+            }
+        };
+        klog_command!(
+            KlogRecord::new(KlogOp::MetaDelete, self.key(), code),
+            "\"md {}\" {}",
+            string_key(self.key()),
+            code
+        );
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse() {
+        let parser = RequestParser::new();
+
+        // basic meta delete command
+        assert_eq!(
+            parser.parse_request(b"md key\r\n"),
+            Ok((
+                &b""[..],
+                Request::MetaDelete(MetaDelete {
+                    key: b"key".into(),
+                    flags: MetaFlags::default(),
+                })
+            ))
+        );
+
+        // invalidate instead of removing the item
+        assert_eq!(
+            parser.parse_request(b"md key I T30\r\n"),
+            Ok((
+                &b""[..],
+                Request::MetaDelete(MetaDelete {
+                    key: b"key".into(),
+                    flags: MetaFlags {
+                        invalidate: true,
+                        new_ttl: Some(Ttl::new(30, TimeType::Memcache)),
+                        ..Default::default()
+                    },
+                })
+            ))
+        );
+    }
+}
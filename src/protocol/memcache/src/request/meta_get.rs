@@ -0,0 +1,154 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+
+/// The flags which are accepted by a meta get.
+const FLAGS: &[u8] = b"cfkstvquONRT";
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct MetaGet {
+    pub(crate) key: Key,
+    pub(crate) flags: MetaFlags,
+}
+
+impl MetaGet {
+    pub fn key(&self) -> &[u8] {
+        self.key.as_ref()
+    }
+
+    pub fn flags(&self) -> &MetaFlags {
+        &self.flags
+    }
+}
+
+impl RequestParser {
+    // this is to be called after parsing the command, so we do not match the verb
+    pub(crate) fn parse_meta_get_no_stats<'a>(
+        &self,
+        input: &'a [u8],
+    ) -> IResult<&'a [u8], MetaGet> {
+        let (input, _) = space1(input)?;
+        let (input, key) = key(input, self.max_key_len)?;
+
+        let key = match key {
+            Some(k) => k,
+            None => {
+                return Err(nom::Err::Failure(nom::error::Error::new(
+                    input,
+                    nom::error::ErrorKind::Tag,
+                )));
+            }
+        };
+
+        let (input, flags) = self.parse_meta_flags(input, FLAGS)?;
+
+        Ok((
+            input,
+            MetaGet {
+                key: Key::new(key),
+                flags,
+            },
+        ))
+    }
+
+    pub fn parse_meta_get<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], MetaGet> {
+        match self.parse_meta_get_no_stats(input) {
+            Ok((input, request)) => {
+                META_GET.increment();
+                Ok((input, request))
+            }
+            Err(e) => {
+                if !e.is_incomplete() {
+                    META_GET.increment();
+                    META_GET_EX.increment();
+                }
+                Err(e)
+            }
+        }
+    }
+}
+
+impl Compose for MetaGet {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        let verb = b"mg ";
+
+        session.put_slice(verb);
+        session.put_slice(&self.key);
+        let flags = self.flags.compose(session);
+        session.put_slice(CRLF);
+
+        verb.len() + self.key.len() + flags + CRLF.len()
+    }
+}
+
+impl Klog for MetaGet {
+    type Response = Response;
+
+    fn klog(&self, response: &Self::Response) {
+        let (code, len) = match response {
+            Response::Meta(ref res) if res.code() == MetaCode::En => {
+                META_GET_MISS.increment();
+                (MISS, 0)
+            }
+            Response::Meta(ref res) => {
+                META_GET_HIT.increment();
+                (HIT, res.value_len().unwrap_or(0))
+            }
+            _ => {
+                return;
+            }
+        };
+        klog_command!(
+            KlogRecord::new(KlogOp::MetaGet, self.key(), code).value_len(len),
+            "\"mg {}\" {} {}",
+            string_key(self.key()),
+            code,
+            len
+        );
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse() {
+        let parser = RequestParser::new();
+
+        // basic meta get command
+        assert_eq!(
+            parser.parse_request(b"mg key\r\n"),
+            Ok((
+                &b""[..],
+                Request::MetaGet(MetaGet {
+                    key: b"key".into(),
+                    flags: MetaFlags::default(),
+                })
+            ))
+        );
+
+        // with flags
+        assert_eq!(
+            parser.parse_request(b"mg key v c t R30\r\n"),
+            Ok((
+                &b""[..],
+                Request::MetaGet(MetaGet {
+                    key: b"key".into(),
+                    flags: MetaFlags {
+                        value: true,
+                        cas: true,
+                        ttl: true,
+                        recache: Some(30),
+                        ..Default::default()
+                    },
+                })
+            ))
+        );
+
+        // flags of other commands are rejected
+        assert!(parser.parse_request(b"mg key MS\r\n").is_err());
+    }
+}
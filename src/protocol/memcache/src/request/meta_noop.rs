@@ -0,0 +1,52 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+
+/// A meta noop, which always returns `MN`. It is sent at the end of a pipeline
+/// of quiet requests so that the client knows when all of their responses
+/// have been returned.
+#[derive(Debug, PartialEq, Eq)]
+pub struct MetaNoop {}
+
+impl RequestParser {
+    // this is to be called after parsing the command, so we do not match the verb
+    pub fn parse_meta_noop<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], MetaNoop> {
+        let (input, _) = space0(input)?;
+        let (input, _) = crlf(input)?;
+
+        META_NOOP.increment();
+
+        Ok((input, MetaNoop {}))
+    }
+}
+
+impl Compose for MetaNoop {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        session.put_slice(b"mn\r\n");
+        4
+    }
+}
+
+impl Klog for MetaNoop {
+    type Response = Response;
+
+    fn klog(&self, _response: &Self::Response) {}
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse() {
+        let parser = RequestParser::new();
+
+        // meta noop command
+        assert_eq!(
+            parser.parse_request(b"mn\r\n"),
+            Ok((&b""[..], Request::MetaNoop(MetaNoop {})))
+        );
+    }
+}
@@ -0,0 +1,205 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+
+/// The flags which are accepted by a meta set.
+const FLAGS: &[u8] = b"ckqICFMOT";
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct MetaSet {
+    pub(crate) key: Key,
+    pub(crate) value: Box<[u8]>,
+    pub(crate) flags: MetaFlags,
+}
+
+impl MetaSet {
+    pub fn key(&self) -> &[u8] {
+        self.key.as_ref()
+    }
+
+    pub fn value(&self) -> &[u8] {
+        &self.value
+    }
+
+    pub fn flags(&self) -> &MetaFlags {
+        &self.flags
+    }
+
+    /// The mode of the request, which defaults to a set.
+    pub fn mode(&self) -> MetaMode {
+        self.flags.mode().unwrap_or(MetaMode::Set)
+    }
+}
+
+impl RequestParser {
+    // this is to be called after parsing the command, so we do not match the verb
+    pub(crate) fn parse_meta_set_no_stats<'a>(
+        &self,
+        input: &'a [u8],
+    ) -> IResult<&'a [u8], MetaSet> {
+        let (input, _) = space1(input)?;
+        let (input, key) = key(input, self.max_key_len)?;
+
+        let key = match key {
+            Some(k) => k,
+            None => {
+                return Err(nom::Err::Failure(nom::error::Error::new(
+                    input,
+                    nom::error::ErrorKind::Tag,
+                )));
+            }
+        };
+
+        let (input, _) = space1(input)?;
+        let (input, bytes) = parse_usize(input)?;
+
+        if bytes > self.max_value_size {
+            return Err(nom::Err::Failure(nom::error::Error::new(
+                input,
+                nom::error::ErrorKind::Tag,
+            )));
+        }
+
+        let (input, flags) = self.parse_meta_flags(input, FLAGS)?;
+
+        // only the storage modes apply to a meta set
+        if matches!(flags.mode(), Some(MetaMode::Incr) | Some(MetaMode::Decr)) {
+            return Err(nom::Err::Failure(nom::error::Error::new(
+                input,
+                nom::error::ErrorKind::Tag,
+            )));
+        }
+
+        let (input, value) = take(bytes)(input)?;
+        let (input, _) = crlf(input)?;
+
+        Ok((
+            input,
+            MetaSet {
+                key: Key::new(key),
+                value: value.to_owned().into_boxed_slice(),
+                flags,
+            },
+        ))
+    }
+
+    pub fn parse_meta_set<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], MetaSet> {
+        match self.parse_meta_set_no_stats(input) {
+            Ok((input, request)) => {
+                META_SET.increment();
+                Ok((input, request))
+            }
+            Err(e) => {
+                if !e.is_incomplete() {
+                    META_SET.increment();
+                    META_SET_EX.increment();
+                }
+                Err(e)
+            }
+        }
+    }
+}
+
+impl Compose for MetaSet {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        let verb = b"ms ";
+        let vlen = format!(" {}", self.value.len()).into_bytes();
+
+        session.put_slice(verb);
+        session.put_slice(&self.key);
+        session.put_slice(&vlen);
+        let flags = self.flags.compose(session);
+        session.put_slice(CRLF);
+        session.put_slice(&self.value);
+        session.put_slice(CRLF);
+
+        verb.len() + self.key.len() + vlen.len() + flags + self.value.len() + 2 * CRLF.len()
+    }
+}
+
+impl Klog for MetaSet {
+    type Response = Response;
+
+    fn klog(&self, response: &Self::Response) {
+        let code = match response {
+            Response::Meta(ref res) => match res.code() {
+                MetaCode::Hd => {
+                    META_SET_STORED.increment();
+                    STORED
+                }
+                MetaCode::Ns => {
+                    META_SET_NOT_STORED.increment();
+                    NOT_STORED
+                }
+                MetaCode::Ex => EXISTS,
+                MetaCode::Nf => NOT_FOUND,
+                _ => {
+                    return;
+                }
+            },
+            _ => {
+                return;
+            }
+        };
+        klog_command!(
+            KlogRecord::new(KlogOp::MetaSet, self.key(), code).value_len(self.value().len()),
+            "\"ms {} {}\" {}",
+            string_key(self.key()),
+            self.value().len(),
+            code
+        );
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse() {
+        let parser = RequestParser::new();
+
+        // basic meta set command
+        assert_eq!(
+            parser.parse_request(b"ms key 5\r\nvalue\r\n"),
+            Ok((
+                &b""[..],
+                Request::MetaSet(MetaSet {
+                    key: b"key".into(),
+                    value: b"value".to_vec().into_boxed_slice(),
+                    flags: MetaFlags::default(),
+                })
+            ))
+        );
+
+        // with flags
+        assert_eq!(
+            parser.parse_request(b"ms key 1 F7 T60 ME q\r\n0\r\n"),
+            Ok((
+                &b""[..],
+                Request::MetaSet(MetaSet {
+                    key: b"key".into(),
+                    value: b"0".to_vec().into_boxed_slice(),
+                    flags: MetaFlags {
+                        client_flags: Some(7),
+                        new_ttl: Some(Ttl::new(60, TimeType::Memcache)),
+                        mode: Some(MetaMode::Add),
+                        quiet: true,
+                        ..Default::default()
+                    },
+                })
+            ))
+        );
+
+        // arithmetic modes are rejected
+        assert!(parser.parse_request(b"ms key 1 MI\r\n0\r\n").is_err());
+
+        // the value must be complete
+        assert!(parser
+            .parse_request(b"ms key 5\r\nval")
+            .unwrap_err()
+            .is_incomplete());
+    }
+}
@@ -2,40 +2,65 @@
 // Licensed under the Apache License, Version 2.0
 // http://www.apache.org/licenses/LICENSE-2.0
 
+use crate::latency::*;
 use crate::*;
 use clocksource::coarse::UnixInstant;
 use core::fmt::{Display, Formatter};
 use core::num::NonZeroI32;
-use protocol_common::{BufMut, Parse, ParseOk};
+use logger::{KlogOp, KlogRecord};
+use protocol_common::{BufMut, HotCopy, Parse, ParseHeader, ParseOk};
 use std::borrow::Cow;
 
 mod add;
 mod append;
+mod binary;
 mod cas;
 mod decr;
 mod delete;
 mod flush_all;
+mod gat;
+mod gats;
 mod get;
 mod gets;
 mod incr;
+mod key;
+mod meta;
+mod meta_arithmetic;
+mod meta_delete;
+mod meta_get;
+mod meta_noop;
+mod meta_set;
 mod prepend;
 mod quit;
 mod replace;
+mod replicate;
 mod set;
+mod touch;
 
 pub use add::Add;
 pub use append::Append;
+pub use binary::{Binary, Opcode};
 pub use cas::Cas;
 pub use decr::Decr;
 pub use delete::Delete;
 pub use flush_all::FlushAll;
+pub use gat::Gat;
+pub use gats::Gats;
 pub use get::Get;
 pub use gets::Gets;
 pub use incr::Incr;
+pub use key::{Key, Keys, INLINE_KEY_LEN};
+pub use meta::{MetaFlags, MetaMode};
+pub use meta_arithmetic::MetaArithmetic;
+pub use meta_delete::MetaDelete;
+pub use meta_get::MetaGet;
+pub use meta_noop::MetaNoop;
+pub use meta_set::MetaSet;
 pub use prepend::Prepend;
 pub use quit::Quit;
 pub use replace::Replace;
 pub use set::Set;
+pub use touch::Touch;
 
 pub const DEFAULT_MAX_BATCH_SIZE: usize = 1024;
 pub const DEFAULT_MAX_KEY_LEN: usize = 250;
@@ -49,6 +74,7 @@ const EXISTS: u8 = 6;
 const DELETED: u8 = 7;
 const NOT_FOUND: u8 = 8;
 const NOT_STORED: u8 = 9;
+const TOUCHED: u8 = 10;
 
 fn string_key(key: &[u8]) -> Cow<'_, str> {
     String::from_utf8_lossy(key)
@@ -88,7 +114,7 @@ impl RequestParser {
     }
 
     fn parse_command<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Command> {
-        let (remaining, command_bytes) = take_till(|b| (b == b' ' || b == b'\r'))(input)?;
+        let (remaining, command_bytes) = token(input)?;
         let command = match command_bytes {
             b"add" | b"ADD" => Command::Add,
             b"append" | b"APPEND" => Command::Append,
@@ -97,12 +123,20 @@ impl RequestParser {
             b"delete" | b"DELETE" => Command::Delete,
             b"flush_all" | b"FLUSH_ALL" => Command::FlushAll,
             b"incr" | b"INCR" => Command::Incr,
+            b"ma" | b"MA" => Command::MetaArithmetic,
+            b"md" | b"MD" => Command::MetaDelete,
+            b"mg" | b"MG" => Command::MetaGet,
+            b"mn" | b"MN" => Command::MetaNoop,
+            b"ms" | b"MS" => Command::MetaSet,
+            b"gat" | b"GAT" => Command::Gat,
+            b"gats" | b"GATS" => Command::Gats,
             b"get" | b"GET" => Command::Get,
             b"gets" | b"GETS" => Command::Gets,
             b"prepend" | b"PREPEND" => Command::Prepend,
             b"quit" | b"QUIT" => Command::Quit,
             b"replace" | b"REPLACE" => Command::Replace,
             b"set" | b"SET" => Command::Set,
+            b"touch" | b"TOUCH" => Command::Touch,
             _ => {
                 // TODO(bmartin): we can return an unknown command error here
                 return Err(nom::Err::Failure(nom::error::Error::new(
@@ -115,6 +149,13 @@ impl RequestParser {
     }
 
     pub fn parse_request<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Request> {
+        // binary requests start with a magic byte which never starts a text
+        // command, so both protocols are served on the same port
+        if input.first() == Some(&binary::REQUEST_MAGIC) {
+            let (input, request) = self.parse_binary(input)?;
+            return Ok((input, Request::Binary(request)));
+        }
+
         match self.parse_command(input)? {
             (input, Command::Add) => {
                 let (input, request) = self.parse_add(input)?;
@@ -144,6 +185,14 @@ impl RequestParser {
                 let (input, request) = self.parse_incr(input)?;
                 Ok((input, Request::Incr(request)))
             }
+            (input, Command::Gat) => {
+                let (input, request) = self.parse_gat(input)?;
+                Ok((input, Request::Gat(request)))
+            }
+            (input, Command::Gats) => {
+                let (input, request) = self.parse_gats(input)?;
+                Ok((input, Request::Gats(request)))
+            }
             (input, Command::Get) => {
                 let (input, request) = self.parse_get(input)?;
                 Ok((input, Request::Get(request)))
@@ -152,6 +201,26 @@ impl RequestParser {
                 let (input, request) = self.parse_gets(input)?;
                 Ok((input, Request::Gets(request)))
             }
+            (input, Command::MetaArithmetic) => {
+                let (input, request) = self.parse_meta_arithmetic(input)?;
+                Ok((input, Request::MetaArithmetic(request)))
+            }
+            (input, Command::MetaDelete) => {
+                let (input, request) = self.parse_meta_delete(input)?;
+                Ok((input, Request::MetaDelete(request)))
+            }
+            (input, Command::MetaGet) => {
+                let (input, request) = self.parse_meta_get(input)?;
+                Ok((input, Request::MetaGet(request)))
+            }
+            (input, Command::MetaNoop) => {
+                let (input, request) = self.parse_meta_noop(input)?;
+                Ok((input, Request::MetaNoop(request)))
+            }
+            (input, Command::MetaSet) => {
+                let (input, request) = self.parse_meta_set(input)?;
+                Ok((input, Request::MetaSet(request)))
+            }
             (input, Command::Prepend) => {
                 let (input, request) = self.parse_prepend(input)?;
                 Ok((input, Request::Prepend(request)))
@@ -168,6 +237,10 @@ impl RequestParser {
                 let (input, request) = self.parse_set(input)?;
                 Ok((input, Request::Set(request)))
             }
+            (input, Command::Touch) => {
+                let (input, request) = self.parse_touch(input)?;
+                Ok((input, Request::Touch(request)))
+            }
         }
     }
 }
@@ -191,6 +264,26 @@ impl Parse<Request> for RequestParser {
             Err(_) => Err(std::io::Error::from(std::io::ErrorKind::InvalidInput)),
         }
     }
+
+    fn parse_header(&self, buffer: &[u8], min: usize) -> Option<ParseHeader<Request>> {
+        // only the values of sets are read straight into storage
+        let (input, Command::Set) = self.parse_command(buffer).ok()? else {
+            return None;
+        };
+        let (input, (set, bytes)) = self.parse_set_header(input).ok()?;
+
+        if bytes < min || input.len() >= bytes + CRLF.len() {
+            return None;
+        }
+
+        SET.increment();
+        Some(ParseHeader::new(
+            Request::Set(set),
+            buffer.len() - input.len(),
+            bytes,
+            CRLF,
+        ))
+    }
 }
 
 impl Compose for Request {
@@ -198,17 +291,26 @@ impl Compose for Request {
         match self {
             Self::Add(r) => r.compose(session),
             Self::Append(r) => r.compose(session),
+            Self::Binary(r) => r.compose(session),
             Self::Cas(r) => r.compose(session),
             Self::Decr(r) => r.compose(session),
             Self::Delete(r) => r.compose(session),
             Self::FlushAll(r) => r.compose(session),
             Self::Incr(r) => r.compose(session),
+            Self::Gat(r) => r.compose(session),
+            Self::Gats(r) => r.compose(session),
             Self::Get(r) => r.compose(session),
             Self::Gets(r) => r.compose(session),
+            Self::MetaArithmetic(r) => r.compose(session),
+            Self::MetaDelete(r) => r.compose(session),
+            Self::MetaGet(r) => r.compose(session),
+            Self::MetaNoop(r) => r.compose(session),
+            Self::MetaSet(r) => r.compose(session),
             Self::Prepend(r) => r.compose(session),
             Self::Quit(r) => r.compose(session),
             Self::Replace(r) => r.compose(session),
             Self::Set(r) => r.compose(session),
+            Self::Touch(r) => r.compose(session),
         }
     }
 }
@@ -220,42 +322,347 @@ impl Klog for Request {
         match self {
             Self::Add(r) => r.klog(response),
             Self::Append(r) => r.klog(response),
+            Self::Binary(r) => r.klog(response),
             Self::Cas(r) => r.klog(response),
             Self::Decr(r) => r.klog(response),
             Self::Delete(r) => r.klog(response),
             Self::FlushAll(r) => r.klog(response),
             Self::Incr(r) => r.klog(response),
+            Self::Gat(r) => r.klog(response),
+            Self::Gats(r) => r.klog(response),
             Self::Get(r) => r.klog(response),
             Self::Gets(r) => r.klog(response),
+            Self::MetaArithmetic(r) => r.klog(response),
+            Self::MetaDelete(r) => r.klog(response),
+            Self::MetaGet(r) => r.klog(response),
+            Self::MetaNoop(r) => r.klog(response),
+            Self::MetaSet(r) => r.klog(response),
             Self::Prepend(r) => r.klog(response),
             Self::Quit(r) => r.klog(response),
             Self::Replace(r) => r.klog(response),
             Self::Set(r) => r.klog(response),
+            Self::Touch(r) => r.klog(response),
+        }
+    }
+}
+
+impl Timed for Request {
+    fn latencies(&self) -> &'static Latencies {
+        match self {
+            Self::Add(_) => &ADD_LATENCIES,
+            Self::Append(_) => &APPEND_LATENCIES,
+            Self::Binary(r) => r.request().latencies(),
+            Self::Cas(_) => &CAS_LATENCIES,
+            Self::Decr(_) => &DECR_LATENCIES,
+            Self::Delete(_) => &DELETE_LATENCIES,
+            Self::FlushAll(_) => &FLUSH_ALL_LATENCIES,
+            Self::Incr(_) => &INCR_LATENCIES,
+            Self::Gat(_) => &GAT_LATENCIES,
+            Self::Gats(_) => &GATS_LATENCIES,
+            Self::Get(_) => &GET_LATENCIES,
+            Self::Gets(_) => &GETS_LATENCIES,
+            Self::MetaArithmetic(_) => &META_ARITHMETIC_LATENCIES,
+            Self::MetaDelete(_) => &META_DELETE_LATENCIES,
+            Self::MetaGet(_) => &META_GET_LATENCIES,
+            Self::MetaNoop(_) => &META_NOOP_LATENCIES,
+            Self::MetaSet(_) => &META_SET_LATENCIES,
+            Self::Prepend(_) => &PREPEND_LATENCIES,
+            Self::Quit(_) => &QUIT_LATENCIES,
+            Self::Replace(_) => &REPLACE_LATENCIES,
+            Self::Set(_) => &SET_LATENCIES,
+            Self::Touch(_) => &TOUCH_LATENCIES,
+        }
+    }
+}
+
+impl Shard<Response> for Request {
+    fn shard_key(&self) -> Option<&[u8]> {
+        match self {
+            Self::Add(r) => Some(r.key()),
+            Self::Append(r) => Some(r.key()),
+            Self::Binary(r) => r.key(),
+            Self::Cas(r) => Some(r.key()),
+            Self::Decr(r) => Some(r.key()),
+            Self::Delete(r) => Some(r.key()),
+            Self::FlushAll(_) => None,
+            Self::Incr(r) => Some(r.key()),
+            Self::Gat(r) => r.keys.first().map(|key| key.as_ref()),
+            Self::Gats(r) => r.keys.first().map(|key| key.as_ref()),
+            Self::Get(r) => r.keys.first().map(|key| key.as_ref()),
+            Self::Gets(r) => r.keys.first().map(|key| key.as_ref()),
+            Self::MetaArithmetic(r) => Some(r.key()),
+            Self::MetaDelete(r) => Some(r.key()),
+            Self::MetaGet(r) => Some(r.key()),
+            Self::MetaNoop(_) => None,
+            Self::MetaSet(r) => Some(r.key()),
+            Self::Prepend(r) => Some(r.key()),
+            Self::Quit(_) => None,
+            Self::Replace(r) => Some(r.key()),
+            Self::Set(r) => Some(r.key()),
+            Self::Touch(r) => Some(r.key()),
         }
     }
+
+    fn split(&self, shard: &dyn Fn(&[u8]) -> usize) -> Option<Vec<(usize, Self)>> {
+        match self {
+            Self::Gat(r) => split_keys(&r.keys, shard).map(|parts| {
+                parts
+                    .map(|(id, keys)| (id, Self::Gat(Gat { ttl: r.ttl, keys })))
+                    .collect()
+            }),
+            Self::Gats(r) => split_keys(&r.keys, shard).map(|parts| {
+                parts
+                    .map(|(id, keys)| (id, Self::Gats(Gats { ttl: r.ttl, keys })))
+                    .collect()
+            }),
+            Self::Get(r) => split_keys(&r.keys, shard).map(|parts| {
+                parts
+                    .map(|(id, keys)| (id, Self::Get(Get { keys })))
+                    .collect()
+            }),
+            Self::Gets(r) => split_keys(&r.keys, shard).map(|parts| {
+                parts
+                    .map(|(id, keys)| (id, Self::Gets(Gets { keys })))
+                    .collect()
+            }),
+            _ => None,
+        }
+    }
+
+    fn merge(&self, responses: Vec<Response>, shard: &dyn Fn(&[u8]) -> usize) -> Response {
+        match self {
+            Self::Gat(r) => merge_values(&r.keys, responses, shard),
+            Self::Gats(r) => merge_values(&r.keys, responses, shard),
+            Self::Get(r) => merge_values(&r.keys, responses, shard),
+            Self::Gets(r) => merge_values(&r.keys, responses, shard),
+            _ => responses.into_iter().next().unwrap_or_else(Response::error),
+        }
+    }
+
+    // only gets are streamed, as they are the reads which may be for many
+    // keys and which do not change the items they read
+    fn chunks(&self, keys: usize) -> Option<Vec<Self>> {
+        match self {
+            Self::Get(r) => chunk_keys(&r.keys, keys)
+                .map(|chunks| chunks.map(|keys| Self::Get(Get { keys })).collect()),
+            Self::Gets(r) => chunk_keys(&r.keys, keys)
+                .map(|chunks| chunks.map(|keys| Self::Gets(Gets { keys })).collect()),
+            _ => None,
+        }
+    }
+
+    fn chunk_response(&self, response: Response, last: bool) -> Response {
+        let mut values = match response {
+            Response::Values(values) => values,
+            // the values of the chunks before it may already have been
+            // written, so a chunk which fails is answered as if none of its
+            // keys were found
+            _ => Values::new(Vec::new().into_boxed_slice()),
+        };
+        values.continued = !last;
+        Response::Values(values)
+    }
+
+    // only a get of one key may be answered from a copy, as gets must return
+    // the CAS value and the other reads may also change the item
+    fn hot_key(&self) -> Option<&[u8]> {
+        match self {
+            Self::Get(r) if r.keys.len() == 1 => Some(r.keys[0].as_ref()),
+            _ => None,
+        }
+    }
+
+    fn hot_copy(&self, response: &Response) -> Option<HotCopy> {
+        match (self.hot_key(), response) {
+            (Some(_), Response::Values(values)) if values.values.len() == 1 => {
+                values.values[0].hot_copy()
+            }
+            _ => None,
+        }
+    }
+
+    fn from_hot_copy(&self, copy: &HotCopy) -> Option<Response> {
+        self.hot_key()
+            .map(|key| Response::values(vec![Value::from_hot_copy(key, copy)].into_boxed_slice()))
+    }
+}
+
+// Only gets are served from datagrams, as the other requests either change the
+// storage or, like gat, would be executed again if a client retried them.
+impl Datagram for Request {
+    fn is_datagram(&self) -> bool {
+        matches!(self, Self::Get(_) | Self::Gets(_))
+    }
+}
+
+// Tracking keys for client-side caching is only implemented for the resp
+// protocol, but the keys written are given so that copies of the values of hot
+// keys are dropped once the keys change. Reads which may change the item, such
+// as touches and meta gets, count as writes.
+impl Track<Response> for Request {
+    fn writes(&self, f: &mut dyn FnMut(&[u8])) {
+        match self {
+            Self::Add(r) => f(r.key()),
+            Self::Append(r) => f(r.key()),
+            Self::Binary(r) => r.request.writes(f),
+            Self::Cas(r) => f(r.key()),
+            Self::Decr(r) => f(r.key()),
+            Self::Delete(r) => f(r.key()),
+            Self::Incr(r) => f(r.key()),
+            Self::Gat(r) => r.keys.iter().for_each(|key| f(key)),
+            Self::Gats(r) => r.keys.iter().for_each(|key| f(key)),
+            Self::MetaArithmetic(r) => f(r.key()),
+            Self::MetaDelete(r) => f(r.key()),
+            Self::MetaGet(r) => f(r.key()),
+            Self::MetaSet(r) => f(r.key()),
+            Self::Prepend(r) => f(r.key()),
+            Self::Replace(r) => f(r.key()),
+            Self::Set(r) => f(r.key()),
+            Self::Touch(r) => f(r.key()),
+            Self::FlushAll(_)
+            | Self::Get(_)
+            | Self::Gets(_)
+            | Self::MetaNoop(_)
+            | Self::Quit(_) => {}
+        }
+    }
+}
+
+// Storage commands with noreply are answered with nothing, even when they fail,
+// as with memcached.
+impl Quiet for Request {
+    fn quiet(&self) -> bool {
+        match self {
+            Self::Add(r) => r.noreply(),
+            Self::Append(r) => r.noreply(),
+            Self::Cas(r) => r.noreply(),
+            Self::Decr(r) => r.noreply(),
+            Self::Delete(r) => r.noreply(),
+            Self::Incr(r) => r.noreply(),
+            Self::Prepend(r) => r.noreply(),
+            Self::Replace(r) => r.noreply(),
+            Self::Set(r) => r.noreply(),
+            Self::Touch(r) => r.noreply(),
+            _ => false,
+        }
+    }
+}
+
+// Requests which wait past the deadline are failed with a server error, except
+// for binary requests, which are answered in the binary protocol, and those
+// which only end a pipeline or close the connection.
+impl Deadline<Response> for Request {
+    fn expired(&self) -> Option<Response> {
+        match self {
+            Self::Binary(_) | Self::MetaNoop(_) | Self::Quit(_) => None,
+            _ => Some(Response::server_error("deadline exceeded")),
+        }
+    }
+}
+
+/// Groups the keys of a multi-key request by shard, with the groups in order
+/// of the first key on each shard. Returns `None` if all keys are on the same
+/// shard.
+fn split_keys(
+    keys: &[Key],
+    shard: &dyn Fn(&[u8]) -> usize,
+) -> Option<impl Iterator<Item = (usize, Keys)>> {
+    let mut parts: Vec<(usize, Keys)> = Vec::new();
+    for key in keys {
+        let id = shard(key);
+        match parts.iter_mut().find(|(s, _)| *s == id) {
+            Some((_, keys)) => keys.push(key.clone()),
+            None => parts.push((id, [key.clone()].into_iter().collect())),
+        }
+    }
+
+    if parts.len() < 2 {
+        return None;
+    }
+
+    Some(parts.into_iter())
+}
+
+/// Splits the keys of a multi-key request into chunks of up to `len`
+/// consecutive keys. Returns `None` if there are no more than `len` keys.
+fn chunk_keys(keys: &[Key], len: usize) -> Option<impl Iterator<Item = Keys> + '_> {
+    if len == 0 || keys.len() <= len {
+        return None;
+    }
+
+    Some(
+        keys.chunks(len)
+            .map(|chunk| chunk.iter().cloned().collect()),
+    )
+}
+
+/// Reassembles the values for the keys of a multi-key request, in the order of
+/// the keys, from the responses to the groups of keys from `split_keys`. Each
+/// group receives one value for each of its keys. If the response for any
+/// group is not a set of values, it is returned in place of the whole
+/// response.
+fn merge_values(
+    keys: &[Key],
+    responses: Vec<Response>,
+    shard: &dyn Fn(&[u8]) -> usize,
+) -> Response {
+    let mut parts = Vec::with_capacity(responses.len());
+    for response in responses {
+        match response {
+            Response::Values(values) => parts.push(values.values.into_vec().into_iter()),
+            other => return other,
+        }
+    }
+
+    let mut shards: Vec<usize> = Vec::with_capacity(parts.len());
+    let mut values = Vec::with_capacity(keys.len());
+    for key in keys {
+        let id = shard(key);
+        let part = match shards.iter().position(|s| *s == id) {
+            Some(part) => part,
+            None => {
+                shards.push(id);
+                shards.len() - 1
+            }
+        };
+        if let Some(value) = parts.get_mut(part).and_then(|part| part.next()) {
+            values.push(value);
+        }
+    }
+
+    Response::values(values.into_boxed_slice())
 }
 
 #[derive(Debug, PartialEq, Eq)]
 pub enum Request {
     Add(Add),
     Append(Append),
+    Binary(Binary),
     Cas(Cas),
     Decr(Decr),
     Delete(Delete),
     FlushAll(FlushAll),
     Incr(Incr),
+    Gat(Gat),
+    Gats(Gats),
     Get(Get),
     Gets(Gets),
+    MetaArithmetic(MetaArithmetic),
+    MetaDelete(MetaDelete),
+    MetaGet(MetaGet),
+    MetaNoop(MetaNoop),
+    MetaSet(MetaSet),
     Prepend(Prepend),
     Quit(Quit),
     Replace(Replace),
     Set(Set),
+    Touch(Touch),
 }
 
 impl Request {
     pub fn add(key: Box<[u8]>, value: Box<[u8]>, flags: u32, ttl: Ttl, noreply: bool) -> Self {
         Self::Add(Add {
-            key,
+            key: key.into(),
             value,
             flags,
             ttl,
@@ -272,7 +679,7 @@ impl Request {
         noreply: bool,
     ) -> Self {
         Self::Cas(Cas {
-            key,
+            key: key.into(),
             value,
             flags,
             ttl,
@@ -283,27 +690,37 @@ impl Request {
 
     pub fn decr(key: Box<[u8]>, value: u64, noreply: bool) -> Self {
         Self::Decr(Decr {
-            key,
+            key: key.into(),
             value,
             noreply,
         })
     }
 
     pub fn delete(key: Box<[u8]>, noreply: bool) -> Self {
-        Self::Delete(Delete { key, noreply })
+        Self::Delete(Delete {
+            key: key.into(),
+            noreply,
+        })
     }
 
     pub fn get(keys: Box<[Box<[u8]>]>) -> Self {
-        Self::Get(Get { keys })
+        Self::Get(Get { keys: keys.into() })
     }
 
     pub fn gets(keys: Box<[Box<[u8]>]>) -> Self {
-        Self::Gets(Gets { keys })
+        Self::Gets(Gets { keys: keys.into() })
+    }
+
+    pub fn gat(ttl: Ttl, keys: Box<[Box<[u8]>]>) -> Self {
+        Self::Gat(Gat {
+            ttl,
+            keys: keys.into(),
+        })
     }
 
     pub fn incr(key: Box<[u8]>, value: u64, noreply: bool) -> Self {
         Self::Incr(Incr {
-            key,
+            key: key.into(),
             value,
             noreply,
         })
@@ -311,7 +728,7 @@ impl Request {
 
     pub fn replace(key: Box<[u8]>, value: Box<[u8]>, flags: u32, ttl: Ttl, noreply: bool) -> Self {
         Self::Replace(Replace {
-            key,
+            key: key.into(),
             value,
             flags,
             ttl,
@@ -321,13 +738,21 @@ impl Request {
 
     pub fn set(key: Box<[u8]>, value: Box<[u8]>, flags: u32, ttl: Ttl, noreply: bool) -> Self {
         Self::Set(Set {
-            key,
+            key: key.into(),
             value,
             flags,
             ttl,
             noreply,
         })
     }
+
+    pub fn touch(key: Box<[u8]>, ttl: Ttl, noreply: bool) -> Self {
+        Self::Touch(Touch {
+            key: key.into(),
+            ttl,
+            noreply,
+        })
+    }
 }
 
 impl Display for Request {
@@ -335,17 +760,26 @@ impl Display for Request {
         match self {
             Request::Add(_) => write!(f, "add"),
             Request::Append(_) => write!(f, "append"),
+            Request::Binary(r) => r.request().fmt(f),
             Request::Cas(_) => write!(f, "cas"),
             Request::Decr(_) => write!(f, "decr"),
             Request::Delete(_) => write!(f, "delete"),
             Request::FlushAll(_) => write!(f, "flush_all"),
             Request::Incr(_) => write!(f, "incr"),
+            Request::Gat(_) => write!(f, "gat"),
+            Request::Gats(_) => write!(f, "gats"),
             Request::Get(_) => write!(f, "get"),
             Request::Gets(_) => write!(f, "gets"),
+            Request::MetaArithmetic(_) => write!(f, "ma"),
+            Request::MetaDelete(_) => write!(f, "md"),
+            Request::MetaGet(_) => write!(f, "mg"),
+            Request::MetaNoop(_) => write!(f, "mn"),
+            Request::MetaSet(_) => write!(f, "ms"),
             Request::Prepend(_) => write!(f, "prepend"),
             Request::Quit(_) => write!(f, "quit"),
             Request::Replace(_) => write!(f, "replace"),
             Request::Set(_) => write!(f, "set"),
+            Request::Touch(_) => write!(f, "touch"),
         }
     }
 }
@@ -359,12 +793,20 @@ pub enum Command {
     Delete,
     FlushAll,
     Incr,
+    Gat,
+    Gats,
     Get,
     Gets,
+    MetaArithmetic,
+    MetaDelete,
+    MetaGet,
+    MetaNoop,
+    MetaSet,
     Prepend,
     Quit,
     Replace,
     Set,
+    Touch,
 }
 
 #[derive(Debug, PartialEq, Eq, Copy, Clone)]
@@ -0,0 +1,201 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Requests which changed storage are replicated as requests which leave the
+//! replica in the same state. Requests whose outcome depended on a cas value
+//! or on the presence of the item are replicated as their outcome, such as a
+//! successful `add` or `cas` as a `set`, since cas values are not the same on
+//! the replica, and a `gat` as a `touch` of each key it found. Ttls are written as a number of seconds, so replicas parse the
+//! stream with `TimeType::Delta`.
+
+use super::*;
+use protocol_common::Replicate;
+
+impl Replicate<Response> for Request {
+    fn replicate(&self, response: &Response, dst: &mut dyn BufMut) -> bool {
+        let hd = matches!(response, Response::Meta(meta) if meta.code() == MetaCode::Hd);
+
+        match (self, response) {
+            (Self::Binary(r), Response::Binary(response)) => {
+                return r.request().replicate(response.inner(), dst);
+            }
+            (Self::Set(r), Response::Stored(_)) => {
+                compose_set(dst, &r.key, r.flags, r.ttl, &r.value);
+            }
+            (Self::Add(r), Response::Stored(_)) => {
+                compose_set(dst, &r.key, r.flags, r.ttl, &r.value);
+            }
+            (Self::Replace(r), Response::Stored(_)) => {
+                compose_set(dst, &r.key, r.flags, r.ttl, &r.value);
+            }
+            (Self::Cas(r), Response::Stored(_)) => {
+                compose_set(dst, &r.key, r.flags, r.ttl, &r.value);
+            }
+            (Self::Append(r), Response::Stored(_)) => {
+                r.compose(dst);
+            }
+            (Self::Prepend(r), Response::Stored(_)) => {
+                r.compose(dst);
+            }
+            (Self::Incr(r), Response::Numeric(_)) => {
+                r.compose(dst);
+            }
+            (Self::Decr(r), Response::Numeric(_)) => {
+                r.compose(dst);
+            }
+            (Self::Delete(r), Response::Deleted(_)) => {
+                r.compose(dst);
+            }
+            (Self::Touch(r), Response::Touched(_)) => {
+                r.compose(dst);
+            }
+            (Self::Gat(r), Response::Values(values)) => {
+                compose_touches(dst, r.ttl, values);
+            }
+            (Self::Gats(r), Response::Values(values)) => {
+                compose_touches(dst, r.ttl, values);
+            }
+            (Self::MetaSet(r), _) if hd => {
+                let flags = replicated_flags(&r.flags, false);
+                compose_meta(dst, b"ms ", &r.key, Some(&r.value), &flags);
+            }
+            (Self::MetaDelete(r), _) if hd => {
+                let flags = replicated_flags(&r.flags, true);
+                compose_meta(dst, b"md ", &r.key, None, &flags);
+            }
+            (Self::MetaArithmetic(r), Response::Meta(meta))
+                if matches!(meta.code(), MetaCode::Hd | MetaCode::Va) =>
+            {
+                let flags = replicated_flags(&r.flags, false);
+                compose_meta(dst, b"ma ", &r.key, None, &flags);
+            }
+            _ => return false,
+        }
+
+        true
+    }
+}
+
+/// Writes a `set` of the item without asking for a reply.
+fn compose_set(dst: &mut dyn BufMut, key: &[u8], flags: u32, ttl: Ttl, value: &[u8]) {
+    dst.put_slice(b"set ");
+    dst.put_slice(key);
+    dst.put_slice(
+        format!(
+            " {} {} {} noreply\r\n",
+            flags,
+            ttl.get().unwrap_or(0),
+            value.len()
+        )
+        .as_bytes(),
+    );
+    dst.put_slice(value);
+    dst.put_slice(CRLF);
+}
+
+/// Writes a `touch` without asking for a reply for each key which was found
+/// by a get and touch.
+fn compose_touches(dst: &mut dyn BufMut, ttl: Ttl, values: &Values) {
+    for value in values.values().iter().filter(|value| value.len().is_some()) {
+        dst.put_slice(b"touch ");
+        dst.put_slice(value.key());
+        dst.put_slice(format!(" {} noreply\r\n", ttl.get().unwrap_or(0)).as_bytes());
+    }
+}
+
+/// Writes a meta request with the flags, and the value of a meta set.
+fn compose_meta(
+    dst: &mut dyn BufMut,
+    verb: &[u8],
+    key: &[u8],
+    value: Option<&[u8]>,
+    flags: &MetaFlags,
+) {
+    dst.put_slice(verb);
+    dst.put_slice(key);
+    if let Some(value) = value {
+        dst.put_slice(format!(" {}", value.len()).as_bytes());
+    }
+    flags.compose(dst);
+    dst.put_slice(CRLF);
+    if let Some(value) = value {
+        dst.put_slice(value);
+        dst.put_slice(CRLF);
+    }
+}
+
+/// The flags of a meta request as they are replicated. Flags which only shape
+/// the response are dropped, as is the compare cas, which already matched.
+/// Invalidation is kept for a delete, which marks the item stale, but on a set
+/// it only applies along with the compare cas.
+fn replicated_flags(flags: &MetaFlags, invalidate: bool) -> MetaFlags {
+    MetaFlags {
+        mode: flags.mode,
+        client_flags: flags.client_flags,
+        new_ttl: flags.new_ttl,
+        vivify: flags.vivify,
+        initial: flags.initial,
+        delta: flags.delta,
+        invalidate: flags.invalidate && invalidate,
+        quiet: true,
+        ..Default::default()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn replicate(request: &[u8], response: Response) -> Option<Vec<u8>> {
+        let parser = RequestParser::new();
+        let request = parser.parse(request).unwrap().into_inner();
+        let mut buf = Vec::new();
+        if request.replicate(&response, &mut buf) {
+            Some(buf)
+        } else {
+            None
+        }
+    }
+
+    #[test]
+    fn replicated() {
+        assert_eq!(
+            replicate(b"cas key 1 60 3 42\r\nabc\r\n", Response::stored(false)).unwrap(),
+            b"set key 1 60 3 noreply\r\nabc\r\n"
+        );
+        assert_eq!(
+            replicate(b"delete key\r\n", Response::deleted(false)).unwrap(),
+            b"delete key\r\n"
+        );
+        assert_eq!(
+            replicate(b"incr key 2\r\n", Response::numeric(3, false)).unwrap(),
+            b"incr key 2\r\n"
+        );
+        assert_eq!(
+            replicate(b"touch key 60\r\n", Response::touched(false)).unwrap(),
+            b"touch key 60\r\n"
+        );
+
+        // failed and read requests are not replicated
+        assert!(replicate(b"add key 0 0 1\r\na\r\n", Response::not_stored(false)).is_none());
+        assert!(replicate(b"delete key\r\n", Response::not_found(false)).is_none());
+        assert!(replicate(b"get key\r\n", Response::values(Box::new([]))).is_none());
+    }
+
+    #[test]
+    fn replicated_parses() {
+        // the stream is parsed by the replica as the same requests
+        let parser = RequestParser::new().time_type(TimeType::Delta);
+        let buf = replicate(b"set key 3 100 5\r\nvalue\r\n", Response::stored(false)).unwrap();
+        match parser.parse(&buf).unwrap().into_inner() {
+            Request::Set(set) => {
+                assert_eq!(set.key(), b"key");
+                assert_eq!(set.value(), b"value");
+                assert_eq!(set.flags(), 3);
+                assert_eq!(set.ttl().get(), Some(100));
+            }
+            other => panic!("unexpected request: {other:?}"),
+        }
+    }
+}
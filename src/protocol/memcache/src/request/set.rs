@@ -6,7 +6,7 @@ use super::*;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct Set {
-    pub(crate) key: Box<[u8]>,
+    pub(crate) key: Key,
     pub(crate) value: Box<[u8]>,
     pub(crate) flags: u32,
     pub(crate) ttl: Ttl,
@@ -38,6 +38,17 @@ impl Set {
 impl RequestParser {
     // this is to be called after parsing the command, so we do not match the verb
     pub(crate) fn parse_set_no_stats<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Set> {
+        let (input, (mut set, bytes)) = self.parse_set_header(input)?;
+        let (input, value) = take(bytes)(input)?;
+        let (input, _) = crlf(input)?;
+
+        set.value = value.to_owned().into_boxed_slice();
+        Ok((input, set))
+    }
+
+    // parses the header line of a set, returning the set with an empty value
+    // along with the length of the value which follows the header
+    pub(crate) fn parse_set_header<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], (Set, usize)> {
         let mut noreply = false;
 
         let (input, _) = space1(input)?;
@@ -77,18 +88,19 @@ impl RequestParser {
 
         let (input, _) = space0(input)?;
         let (input, _) = crlf(input)?;
-        let (input, value) = take(bytes)(input)?;
-        let (input, _) = crlf(input)?;
 
         Ok((
             input,
-            Set {
-                key: key.to_owned().into_boxed_slice(),
-                value: value.to_owned().into_boxed_slice(),
-                ttl,
-                flags,
-                noreply,
-            },
+            (
+                Set {
+                    key: Key::new(key),
+                    value: Box::default(),
+                    ttl,
+                    flags,
+                    noreply,
+                },
+                bytes,
+            ),
         ))
     }
 
@@ -160,7 +172,11 @@ impl Klog for Set {
                 return;
             }
         };
-        klog!(
+        klog_command!(
+            KlogRecord::new(KlogOp::Set, self.key(), code)
+                .value_len(self.value().len())
+                .response_len(len)
+                .ttl(self.ttl.get().unwrap_or(0)),
             "\"set {} {} {} {}\" {} {}",
             string_key(self.key()),
             self.flags(),
@@ -186,7 +202,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Set(Set {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     value: b"0".to_vec().into_boxed_slice(),
                     flags: 0,
                     ttl: Ttl::none(),
@@ -201,7 +217,7 @@ mod tests {
             Ok((
                 &b""[..],
                 Request::Set(Set {
-                    key: b"0".to_vec().into_boxed_slice(),
+                    key: b"0".into(),
                     value: b"0".to_vec().into_boxed_slice(),
                     flags: 0,
                     ttl: Ttl::none(),
@@ -210,4 +226,36 @@ mod tests {
             ))
         );
     }
+
+    #[test]
+    fn parse_header() {
+        let parser = RequestParser::new();
+
+        // a large value which has not been received in full
+        let header = parser
+            .parse_header(b"set coffee 1 0 8192\r\nstrong", 4096)
+            .expect("header not parsed");
+        assert_eq!(header.consumed(), 21);
+        assert_eq!(header.value(), 8192);
+        assert_eq!(header.trailer(), b"\r\n");
+        match header.into_inner() {
+            Request::Set(set) => {
+                assert_eq!(set.key(), b"coffee");
+                assert_eq!(set.flags(), 1);
+                assert!(set.value().is_empty());
+            }
+            _ => panic!("not a set"),
+        }
+
+        // small values and values which were received are parsed in full
+        assert!(parser.parse_header(b"set coffee 1 0 6\r\n", 4096).is_none());
+        assert!(parser
+            .parse_header(b"set coffee 1 0 6\r\nstrong\r\n", 0)
+            .is_none());
+
+        // as are other commands
+        assert!(parser
+            .parse_header(b"append coffee 1 0 8192\r\n", 4096)
+            .is_none());
+    }
 }
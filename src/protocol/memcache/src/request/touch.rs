@@ -0,0 +1,175 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct Touch {
+    pub(crate) key: Key,
+    pub(crate) ttl: Ttl,
+    pub(crate) noreply: bool,
+}
+
+impl Touch {
+    pub fn key(&self) -> &[u8] {
+        self.key.as_ref()
+    }
+
+    pub fn ttl(&self) -> Ttl {
+        self.ttl
+    }
+
+    pub fn noreply(&self) -> bool {
+        self.noreply
+    }
+}
+
+impl RequestParser {
+    // this is to be called after parsing the command, so we do not match the verb
+    pub(crate) fn parse_touch_no_stats<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Touch> {
+        let (input, _) = space1(input)?;
+
+        let (input, key) = key(input, self.max_key_len)?;
+
+        let key = match key {
+            Some(k) => k,
+            None => {
+                return Err(nom::Err::Failure(nom::error::Error::new(
+                    input,
+                    nom::error::ErrorKind::Tag,
+                )));
+            }
+        };
+
+        let (input, _) = space1(input)?;
+        let (mut input, ttl) = parse_ttl(input, self.time_type)?;
+
+        let mut noreply = false;
+
+        // if we have a space, we might have a noreply
+        if let Ok((i, _)) = space1(input) {
+            if i.len() > 7 && &i[0..7] == b"noreply" {
+                input = &i[7..];
+                noreply = true;
+            }
+        }
+
+        let (input, _) = space0(input)?;
+
+        let (input, _) = crlf(input)?;
+        Ok((
+            input,
+            Touch {
+                key: Key::new(key),
+                ttl,
+                noreply,
+            },
+        ))
+    }
+
+    // this is to be called after parsing the command, so we do not match the verb
+    pub fn parse_touch<'a>(&self, input: &'a [u8]) -> IResult<&'a [u8], Touch> {
+        match self.parse_touch_no_stats(input) {
+            Ok((input, request)) => {
+                TOUCH.increment();
+                Ok((input, request))
+            }
+            Err(e) => {
+                if !e.is_incomplete() {
+                    TOUCH.increment();
+                    TOUCH_EX.increment();
+                }
+                Err(e)
+            }
+        }
+    }
+}
+
+impl Compose for Touch {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        let verb = b"touch ";
+        let ttl = format!(" {}", self.ttl.get().unwrap_or(0)).into_bytes();
+        let header_end = if self.noreply {
+            " noreply\r\n".as_bytes()
+        } else {
+            "\r\n".as_bytes()
+        };
+
+        let size = verb.len() + self.key.len() + ttl.len() + header_end.len();
+
+        session.put_slice(verb);
+        session.put_slice(&self.key);
+        session.put_slice(&ttl);
+        session.put_slice(header_end);
+
+        size
+    }
+}
+
+impl Klog for Touch {
+    type Response = Response;
+
+    fn klog(&self, response: &Self::Response) {
+        let (code, len) = match response {
+            Response::Touched(ref res) => {
+                TOUCH_TOUCHED.increment();
+                (TOUCHED, res.len())
+            }
+            Response::NotFound(ref res) => {
+                TOUCH_NOT_FOUND.increment();
+                (NOT_FOUND, res.len())
+            }
+            _ => {
+                return;
+            }
+        };
+        klog_command!(
+            KlogRecord::new(KlogOp::Touch, self.key(), code).response_len(len),
+            "\"touch {} {}\" {} {}",
+            string_key(self.key()),
+            self.ttl.get().unwrap_or(0),
+            code,
+            len
+        );
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse() {
+        let parser = RequestParser::new();
+
+        // basic touch command
+        assert_eq!(
+            parser.parse_request(b"touch 0 60\r\n"),
+            Ok((
+                &b""[..],
+                Request::Touch(Touch {
+                    key: b"0".into(),
+                    ttl: Ttl::new(60, TimeType::Memcache),
+                    noreply: false,
+                })
+            ))
+        );
+
+        // noreply
+        assert_eq!(
+            parser.parse_request(b"touch 0 0 noreply\r\n"),
+            Ok((
+                &b""[..],
+                Request::Touch(Touch {
+                    key: b"0".into(),
+                    ttl: Ttl::none(),
+                    noreply: true,
+                })
+            ))
+        );
+
+        // the exptime is required
+        assert!(parser.parse_request(b"touch 0\r\n").is_err());
+    }
+}
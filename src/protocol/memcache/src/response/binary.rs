@@ -0,0 +1,308 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::values::Data;
+use super::*;
+
+/// The first byte of every binary response.
+const RESPONSE_MAGIC: u8 = 0x81;
+
+/// The length of the header of a binary response.
+const HEADER_LEN: usize = 24;
+
+/// The version which is returned to a binary version request.
+const VERSION: &[u8] = env!("CARGO_PKG_VERSION").as_bytes();
+
+/// The status of a binary response.
+#[derive(Debug, PartialEq, Eq, Copy, Clone)]
+pub enum Status {
+    NoError,
+    KeyNotFound,
+    KeyExists,
+    ValueTooLarge,
+    InvalidArguments,
+    ItemNotStored,
+    NonNumeric,
+    UnknownCommand,
+    OutOfMemory,
+    NotSupported,
+    InternalError,
+}
+
+impl Status {
+    pub fn as_u16(&self) -> u16 {
+        match self {
+            Self::NoError => 0x0000,
+            Self::KeyNotFound => 0x0001,
+            Self::KeyExists => 0x0002,
+            Self::ValueTooLarge => 0x0003,
+            Self::InvalidArguments => 0x0004,
+            Self::ItemNotStored => 0x0005,
+            Self::NonNumeric => 0x0006,
+            Self::UnknownCommand => 0x0081,
+            Self::OutOfMemory => 0x0082,
+            Self::NotSupported => 0x0083,
+            Self::InternalError => 0x0084,
+        }
+    }
+
+    /// The message which is returned as the value of an error response.
+    fn message(&self) -> &'static [u8] {
+        match self {
+            Self::NoError => b"",
+            Self::KeyNotFound => b"Not found",
+            Self::KeyExists => b"Data exists for key",
+            Self::ValueTooLarge => b"Too large",
+            Self::InvalidArguments => b"Invalid arguments",
+            Self::ItemNotStored => b"Not stored",
+            Self::NonNumeric => b"Non-numeric server-side value for incr or decr",
+            Self::UnknownCommand => b"Unknown command",
+            Self::OutOfMemory => b"Out of memory",
+            Self::NotSupported => b"Not supported",
+            Self::InternalError => b"Internal error",
+        }
+    }
+}
+
+/// The response to a binary request, which holds the response to the meta
+/// request that it was executed as.
+#[derive(Debug, PartialEq, Eq)]
+pub struct BinaryResponse {
+    opcode: Opcode,
+    opaque: u32,
+    key: Option<Box<[u8]>>,
+    inner: Box<Response>,
+}
+
+impl BinaryResponse {
+    pub fn new(request: &Binary, response: Response) -> Self {
+        Self {
+            opcode: request.opcode(),
+            opaque: request.opaque(),
+            key: request
+                .opcode()
+                .returns_key()
+                .then(|| request.key().unwrap_or(b"").to_owned().into_boxed_slice()),
+            inner: Box::new(response),
+        }
+    }
+
+    pub fn opcode(&self) -> Opcode {
+        self.opcode
+    }
+
+    /// The response to the request which the binary request was executed as.
+    pub fn inner(&self) -> &Response {
+        &self.inner
+    }
+
+    pub fn status(&self) -> Status {
+        if let Opcode::Unknown(_) = self.opcode {
+            return Status::UnknownCommand;
+        }
+
+        match &*self.inner {
+            Response::Meta(meta) => match meta.code() {
+                MetaCode::Hd | MetaCode::Va | MetaCode::Mn => Status::NoError,
+                MetaCode::En | MetaCode::Nf => Status::KeyNotFound,
+                MetaCode::Ex => Status::KeyExists,
+                // the binary protocol reports why a store was refused
+                MetaCode::Ns => match self.opcode {
+                    Opcode::Add | Opcode::AddQ => Status::KeyExists,
+                    Opcode::Replace | Opcode::ReplaceQ => Status::KeyNotFound,
+                    _ => Status::ItemNotStored,
+                },
+            },
+            Response::Hangup => Status::NoError,
+            Response::Error(_) if self.opcode.is_arithmetic() => Status::NonNumeric,
+            Response::Error(_) => Status::NotSupported,
+            Response::ClientError(_) => Status::InvalidArguments,
+            _ => Status::InternalError,
+        }
+    }
+
+    fn meta(&self) -> Option<&Meta> {
+        match &*self.inner {
+            Response::Meta(meta) => Some(meta),
+            _ => None,
+        }
+    }
+
+    /// The quiet opcodes only respond on a failure, except for the gets,
+    /// which only respond on a hit.
+    fn is_hidden(&self, status: Status) -> bool {
+        match self.opcode {
+            Opcode::QuitQ => true,
+            Opcode::GetQ | Opcode::GetKQ => status == Status::KeyNotFound,
+            opcode => opcode.is_quiet() && status == Status::NoError,
+        }
+    }
+
+    /// Composes everything but the value, returning the number of bytes.
+    fn compose_header(&self, session: &mut dyn BufMut, status: Status, value_len: usize) -> usize {
+        let meta = self.meta();
+        let success = status == Status::NoError;
+
+        // a get returns the client flags of the item as its extras
+        let flags;
+        let extras: &[u8] = if success && self.opcode.is_get() {
+            flags = meta.and_then(|m| m.flags).unwrap_or(0).to_be_bytes();
+            &flags
+        } else {
+            &[]
+        };
+        let key = self.key.as_deref().unwrap_or(b"");
+        let cas = meta.and_then(|m| m.cas).unwrap_or(0);
+        let body_len = extras.len() + key.len() + value_len;
+
+        let mut header = [0; HEADER_LEN];
+        header[0] = RESPONSE_MAGIC;
+        header[1] = self.opcode.as_byte();
+        header[2..4].copy_from_slice(&(key.len() as u16).to_be_bytes());
+        header[4] = extras.len() as u8;
+        header[6..8].copy_from_slice(&status.as_u16().to_be_bytes());
+        header[8..12].copy_from_slice(&(body_len as u32).to_be_bytes());
+        header[12..16].copy_from_slice(&self.opaque.to_be_bytes());
+        header[16..24].copy_from_slice(&cas.to_be_bytes());
+
+        session.put_slice(&header);
+        session.put_slice(extras);
+        session.put_slice(key);
+
+        HEADER_LEN + extras.len() + key.len()
+    }
+}
+
+impl Compose for BinaryResponse {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        let status = self.status();
+        if self.is_hidden(status) {
+            return 0;
+        }
+
+        // incr and decr return the new value as an integer rather than as
+        // the digits which are held by the meta response
+        let number;
+        let data = self.meta().and_then(|m| m.data.as_ref());
+        let value: &[u8] = if status != Status::NoError {
+            // a miss on a get which returns the key carries only the key
+            if self.opcode.returns_key() {
+                b""
+            } else {
+                status.message()
+            }
+        } else if self.opcode.is_get() {
+            data.map(|d| d.as_slice()).unwrap_or(b"")
+        } else if self.opcode.is_arithmetic() {
+            let value = data
+                .and_then(|d| std::str::from_utf8(d.as_slice()).ok())
+                .and_then(|v| v.parse::<u64>().ok())
+                .unwrap_or(0);
+            number = value.to_be_bytes();
+            &number
+        } else if self.opcode == Opcode::Version {
+            VERSION
+        } else {
+            b""
+        };
+
+        let size = self.compose_header(session, status, value.len());
+        session.put_slice(value);
+        size + value.len()
+    }
+
+    fn compose_vectored(&self, dst: &mut dyn Vectored) -> usize {
+        // the value of a get hit is handed to the destination by reference if
+        // it is shared, so that it can be written out from where it is held
+        if let Some(Data::Shared(data)) = self.meta().and_then(|m| m.data.as_ref()) {
+            let status = self.status();
+            if self.opcode.is_get() && status == Status::NoError && !self.is_hidden(status) {
+                let len = (**data).as_ref().len();
+                let size = self.compose_header(dst.buf_mut(), status, len);
+                dst.put_shared(data.clone());
+                return size + len;
+            }
+        }
+
+        self.compose(dst.buf_mut())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn request(opcode: u8, key: &[u8]) -> Binary {
+        let mut buffer = vec![0x80, opcode];
+        buffer.extend_from_slice(&(key.len() as u16).to_be_bytes());
+        buffer.extend_from_slice(&[0, 0, 0, 0]);
+        buffer.extend_from_slice(&(key.len() as u32).to_be_bytes());
+        buffer.extend_from_slice(&7_u32.to_be_bytes());
+        buffer.extend_from_slice(&[0; 8]);
+        buffer.extend_from_slice(key);
+
+        match RequestParser::new().parse_request(&buffer) {
+            Ok((_, Request::Binary(binary))) => binary,
+            _ => panic!("failed to parse binary request"),
+        }
+    }
+
+    fn compose(request: &Binary, response: Response) -> Vec<u8> {
+        let response = BinaryResponse::new(request, response);
+        let mut buffer = Vec::new();
+        assert_eq!(response.compose(&mut buffer), buffer.len());
+        buffer
+    }
+
+    #[test]
+    fn compose_get() {
+        let get = request(0x0c, b"key");
+        let flags = MetaFlags::default();
+        let hit = Meta::new(MetaCode::Hd, &flags, b"key")
+            .flags(3)
+            .cas(9)
+            .value(b"value");
+
+        let buffer = compose(&get, hit.into());
+        assert_eq!(buffer.len(), 24 + 4 + 3 + 5);
+        assert_eq!(&buffer[0..2], &[0x81, 0x0c]);
+        // key length, extras length and status
+        assert_eq!(&buffer[2..8], &[0, 3, 4, 0, 0, 0]);
+        assert_eq!(&buffer[8..12], &12_u32.to_be_bytes());
+        assert_eq!(&buffer[12..16], &7_u32.to_be_bytes());
+        assert_eq!(&buffer[16..24], &9_u64.to_be_bytes());
+        assert_eq!(&buffer[24..], b"\0\0\0\x03keyvalue");
+
+        // a miss returns the key without extras
+        let miss = Meta::new(MetaCode::En, &flags, b"key");
+        let buffer = compose(&get, miss.into());
+        assert_eq!(&buffer[4..8], &[0, 0, 0, 1]);
+        assert_eq!(&buffer[24..], b"key");
+    }
+
+    #[test]
+    fn quiet() {
+        let flags = MetaFlags::default();
+
+        // a quiet get hides a miss, but not a hit
+        let getq = request(0x09, b"key");
+        assert!(compose(&getq, Meta::new(MetaCode::En, &flags, b"key").into()).is_empty());
+        assert!(!compose(&getq, Meta::new(MetaCode::Hd, &flags, b"key").into()).is_empty());
+
+        // the other quiet opcodes hide a success, but not a failure
+        let deleteq = request(0x14, b"key");
+        assert!(compose(&deleteq, Meta::new(MetaCode::Hd, &flags, b"key").into()).is_empty());
+        let buffer = compose(&deleteq, Meta::new(MetaCode::Nf, &flags, b"key").into());
+        assert_eq!(&buffer[6..8], &[0, 1]);
+        assert_eq!(&buffer[24..], b"Not found");
+    }
+
+    #[test]
+    fn unknown() {
+        let unknown = request(0x20, b"");
+        let buffer = compose(&unknown, Meta::noop().into());
+        assert_eq!(buffer[1], 0x20);
+        assert_eq!(&buffer[6..8], &[0, 0x81]);
+    }
+}
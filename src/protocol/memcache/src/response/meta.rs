@@ -0,0 +1,311 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::values::Data;
+use super::*;
+use std::sync::Arc;
+
+/// The return code of a meta response.
+#[derive(Debug, PartialEq, Eq, Copy, Clone)]
+pub enum MetaCode {
+    /// `HD`: success, without a value.
+    Hd,
+    /// `VA`: success, followed by a value.
+    Va,
+    /// `EN`: the item was not found by a meta get.
+    En,
+    /// `NF`: the item was not found.
+    Nf,
+    /// `NS`: the item was not stored.
+    Ns,
+    /// `EX`: the compare cas did not match the item.
+    Ex,
+    /// `MN`: the response to a meta noop.
+    Mn,
+}
+
+impl MetaCode {
+    fn as_bytes(&self) -> &'static [u8] {
+        match self {
+            Self::Hd => b"HD",
+            Self::Va => b"VA",
+            Self::En => b"EN",
+            Self::Nf => b"NF",
+            Self::Ns => b"NS",
+            Self::Ex => b"EX",
+            Self::Mn => b"MN",
+        }
+    }
+}
+
+/// The response to a meta request. Parts of the item are only returned when
+/// they are set, which storage does for the flags of the request.
+#[derive(Debug, PartialEq, Eq)]
+pub struct Meta {
+    code: MetaCode,
+    quiet: bool,
+    key: Option<Box<[u8]>>,
+    opaque: Option<Box<[u8]>>,
+    pub(crate) cas: Option<u64>,
+    pub(crate) flags: Option<u32>,
+    size: Option<usize>,
+    ttl: Option<i64>,
+    win: bool,
+    stale: bool,
+    won: bool,
+    pub(crate) data: Option<Data>,
+}
+
+impl Meta {
+    /// Create a response with the code for a request with the provided flags
+    /// and key. The opaque token and, if requested, the key are returned.
+    pub fn new(code: MetaCode, request: &MetaFlags, key: &[u8]) -> Self {
+        Self {
+            code,
+            quiet: request.quiet(),
+            key: request
+                .return_key()
+                .then(|| key.to_owned().into_boxed_slice()),
+            opaque: request.opaque().map(|o| o.to_owned().into_boxed_slice()),
+            cas: None,
+            flags: None,
+            size: None,
+            ttl: None,
+            win: false,
+            stale: false,
+            won: false,
+            data: None,
+        }
+    }
+
+    /// Create the response to a meta noop.
+    pub fn noop() -> Self {
+        Self::new(MetaCode::Mn, &MetaFlags::default(), b"")
+    }
+
+    pub fn code(&self) -> MetaCode {
+        self.code
+    }
+
+    /// `c`: return the cas value of the item.
+    pub fn cas(mut self, cas: u64) -> Self {
+        self.cas = Some(cas);
+        self
+    }
+
+    /// `f`: return the client flags of the item.
+    pub fn flags(mut self, flags: u32) -> Self {
+        self.flags = Some(flags);
+        self
+    }
+
+    /// `s`: return the size of the item value.
+    pub fn size(mut self, size: usize) -> Self {
+        self.size = Some(size);
+        self
+    }
+
+    /// `t`: return the remaining ttl of the item in seconds, where `-1` means
+    /// the item does not expire.
+    pub fn ttl(mut self, ttl: i64) -> Self {
+        self.ttl = Some(ttl);
+        self
+    }
+
+    /// `W`: the client has won the right to recache the item.
+    pub fn win(mut self) -> Self {
+        self.win = true;
+        self
+    }
+
+    /// `X`: the item is stale.
+    pub fn stale(mut self) -> Self {
+        self.stale = true;
+        self
+    }
+
+    /// `Z`: the right to recache the item was already handed to another
+    /// client.
+    pub fn won(mut self) -> Self {
+        self.won = true;
+        self
+    }
+
+    /// Return the value, which turns the response into a `VA`.
+    pub fn value(mut self, data: &[u8]) -> Self {
+        self.code = MetaCode::Va;
+        self.data = Some(Data::Owned(data.to_owned().into_boxed_slice()));
+        self
+    }
+
+    /// Return a value which refers to data that is held elsewhere rather than
+    /// copying it. See [`Value::shared`].
+    pub fn shared<T: AsRef<[u8]> + Send + Sync + 'static>(mut self, data: T) -> Self {
+        self.code = MetaCode::Va;
+        self.data = Some(Data::Shared(Arc::new(data)));
+        self
+    }
+
+    /// Returns the length of the value, if there is one.
+    pub fn value_len(&self) -> Option<usize> {
+        self.data.as_ref().map(|d| d.as_slice().len())
+    }
+
+    pub fn is_win(&self) -> bool {
+        self.win
+    }
+
+    pub fn is_stale(&self) -> bool {
+        self.stale
+    }
+
+    /// In quiet mode a response is only written when it carries more than a
+    /// success or a miss, so that a client only reads back the responses
+    /// which need its attention.
+    fn is_hidden(&self) -> bool {
+        self.quiet
+            && matches!(self.code, MetaCode::Hd | MetaCode::En | MetaCode::Nf)
+            && self.cas.is_none()
+            && self.flags.is_none()
+            && self.size.is_none()
+            && self.ttl.is_none()
+            && !(self.win || self.stale || self.won)
+    }
+
+    /// Composes the response line, returning the number of bytes.
+    fn compose_header(&self, session: &mut dyn BufMut) -> usize {
+        let code = self.code.as_bytes();
+        session.put_slice(code);
+        let mut size = code.len();
+
+        // each numeric field is formatted on the stack and written out along
+        // with its flag
+        let fields = [
+            (
+                &b" "[..],
+                self.data
+                    .as_ref()
+                    .map(|d| Digits::new(d.as_slice().len() as u64)),
+            ),
+            (b" c", self.cas.map(Digits::new)),
+            (b" f", self.flags.map(|f| Digits::new(f as u64))),
+            (b" s", self.size.map(|s| Digits::new(s as u64))),
+            (b" t", self.ttl.map(Digits::signed)),
+        ];
+        for (prefix, digits) in fields {
+            if let Some(digits) = digits {
+                session.put_slice(prefix);
+                session.put_slice(digits.as_bytes());
+                size += prefix.len() + digits.len();
+            }
+        }
+
+        for (prefix, token) in [(b" k", &self.key), (b" O", &self.opaque)] {
+            if let Some(token) = token {
+                session.put_slice(prefix);
+                session.put_slice(token);
+                size += prefix.len() + token.len();
+            }
+        }
+
+        for (set, flag) in [(self.win, b" W"), (self.stale, b" X"), (self.won, b" Z")] {
+            if set {
+                session.put_slice(flag);
+                size += flag.len();
+            }
+        }
+
+        session.put_slice(CRLF);
+        size + CRLF.len()
+    }
+}
+
+impl Compose for Meta {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        if self.is_hidden() {
+            return 0;
+        }
+
+        let mut size = self.compose_header(session);
+
+        if let Some(data) = &self.data {
+            let data = data.as_slice();
+            session.put_slice(data);
+            session.put_slice(CRLF);
+            size += data.len() + CRLF.len();
+        }
+
+        size
+    }
+
+    fn compose_vectored(&self, dst: &mut dyn Vectored) -> usize {
+        // shared data is handed to the destination by reference, so that it
+        // can be written out directly from where it is held
+        if let Some(Data::Shared(data)) = &self.data {
+            let len = (**data).as_ref().len();
+            let size = self.compose_header(dst.buf_mut()) + len + CRLF.len();
+
+            dst.put_shared(data.clone());
+            dst.buf_mut().put_slice(CRLF);
+
+            size
+        } else {
+            self.compose(dst.buf_mut())
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn compose(response: &Meta) -> Vec<u8> {
+        let mut buf = Vec::new();
+        let len = response.compose(&mut buf);
+        assert_eq!(len, buf.len());
+        buf
+    }
+
+    #[test]
+    fn compose_meta() {
+        let parser = RequestParser::new();
+        let (_, flags) = parser.parse_meta_flags(b" k Oab\r\n", b"kOq").unwrap();
+
+        assert_eq!(
+            compose(&Meta::new(MetaCode::Hd, &flags, b"key")),
+            b"HD kkey Oab\r\n"
+        );
+
+        let response = Meta::new(MetaCode::Hd, &flags, b"key")
+            .cas(7)
+            .ttl(-1)
+            .value(b"value")
+            .win();
+        assert_eq!(compose(&response), b"VA 5 c7 t-1 kkey Oab W\r\nvalue\r\n");
+
+        assert_eq!(compose(&Meta::noop()), b"MN\r\n");
+    }
+
+    #[test]
+    fn quiet() {
+        let parser = RequestParser::new();
+        let (_, flags) = parser.parse_meta_flags(b" q\r\n", b"kOq").unwrap();
+
+        // responses which carry nothing but their code are hidden
+        assert!(compose(&Meta::new(MetaCode::Hd, &flags, b"key")).is_empty());
+        assert!(compose(&Meta::new(MetaCode::En, &flags, b"key")).is_empty());
+        assert!(compose(&Meta::new(MetaCode::Nf, &flags, b"key")).is_empty());
+
+        // failures, values and leases are always returned
+        assert_eq!(compose(&Meta::new(MetaCode::Ns, &flags, b"key")), b"NS\r\n");
+        assert_eq!(
+            compose(&Meta::new(MetaCode::Hd, &flags, b"key").value(b"1")),
+            b"VA 1\r\n1\r\n"
+        );
+        assert_eq!(
+            compose(&Meta::new(MetaCode::En, &flags, b"key").win()),
+            b"EN W\r\n"
+        );
+    }
+}
@@ -3,28 +3,34 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use crate::*;
-use protocol_common::{BufMut, Parse, ParseOk};
+use protocol_common::{BufMut, Digits, HotCopy, Parse, ParseOk, SharedBytes, Vectored};
 
+mod binary;
 mod client_error;
 mod deleted;
 mod error;
 mod exists;
+mod meta;
 mod not_found;
 mod not_stored;
 mod numeric;
 mod server_error;
 mod stored;
+mod touched;
 mod values;
 
+pub use binary::{BinaryResponse, Status};
 pub use client_error::ClientError;
 pub use deleted::Deleted;
 pub use error::Error;
 pub use exists::Exists;
+pub use meta::{Meta, MetaCode};
 pub use not_found::NotFound;
 pub use not_stored::NotStored;
 pub use numeric::Numeric;
 pub use server_error::ServerError;
 pub use stored::Stored;
+pub use touched::Touched;
 pub use values::{Value, Values};
 
 #[derive(Debug, PartialEq, Eq)]
@@ -39,6 +45,9 @@ pub enum Response {
     Values(Values),
     Numeric(Numeric),
     Deleted(Deleted),
+    Touched(Touched),
+    Meta(Meta),
+    Binary(BinaryResponse),
     Hangup,
 }
 
@@ -76,7 +85,7 @@ impl Response {
     }
 
     pub fn values(values: Box<[Value]>) -> Self {
-        Self::Values(Values { values })
+        Self::Values(Values::new(values))
     }
 
     pub fn hangup() -> Self {
@@ -90,6 +99,16 @@ impl Response {
     pub fn deleted(noreply: bool) -> Self {
         Self::Deleted(Deleted::new(noreply))
     }
+
+    pub fn touched(noreply: bool) -> Self {
+        Self::Touched(Touched::new(noreply))
+    }
+
+    /// Wraps the response to the request which a binary request was executed
+    /// as, so that it is composed in the binary protocol.
+    pub fn binary(request: &Binary, response: Response) -> Self {
+        Self::Binary(BinaryResponse::new(request, response))
+    }
 }
 
 impl From<Values> for Response {
@@ -98,6 +117,12 @@ impl From<Values> for Response {
     }
 }
 
+impl From<Meta> for Response {
+    fn from(other: Meta) -> Self {
+        Self::Meta(other)
+    }
+}
+
 impl Compose for Response {
     fn compose(&self, session: &mut dyn BufMut) -> usize {
         match self {
@@ -111,12 +136,29 @@ impl Compose for Response {
             Self::Values(e) => e.compose(session),
             Self::Numeric(e) => e.compose(session),
             Self::Deleted(e) => e.compose(session),
+            Self::Touched(e) => e.compose(session),
+            Self::Meta(e) => e.compose(session),
+            Self::Binary(e) => e.compose(session),
             Self::Hangup => 0,
         }
     }
 
+    fn compose_vectored(&self, dst: &mut dyn Vectored) -> usize {
+        match self {
+            Self::Values(e) => e.compose_vectored(dst),
+            Self::Meta(e) => e.compose_vectored(dst),
+            Self::Binary(e) => e.compose_vectored(dst),
+            _ => self.compose(dst.buf_mut()),
+        }
+    }
+
     fn should_hangup(&self) -> bool {
-        matches!(self, Self::Error(_) | Self::ClientError(_) | Self::Hangup)
+        match self {
+            // errors are returned as a status in the binary protocol, so only
+            // a quit closes the connection
+            Self::Binary(e) => matches!(e.inner(), Self::Hangup),
+            _ => matches!(self, Self::Error(_) | Self::ClientError(_) | Self::Hangup),
+        }
     }
 }
 
@@ -133,12 +175,13 @@ pub enum ResponseType {
     Empty,
     Numeric(u64),
     Deleted,
+    Touched,
 }
 
 pub struct ResponseParser {}
 
 pub(crate) fn response_type(input: &[u8]) -> IResult<&[u8], ResponseType> {
-    let (remaining, response_type_token) = take_till(|b| (b == b' ' || b == b'\r'))(input)?;
+    let (remaining, response_type_token) = token(input)?;
     let response_type = match response_type_token {
         b"ERROR" => ResponseType::Error,
         b"CLIENT_ERROR" => ResponseType::ClientError,
@@ -150,6 +193,7 @@ pub(crate) fn response_type(input: &[u8]) -> IResult<&[u8], ResponseType> {
         b"VALUE" => ResponseType::Values,
         b"END" => ResponseType::Empty,
         b"DELETED" => ResponseType::Deleted,
+        b"TOUCHED" => ResponseType::Touched,
         _ => {
             if let Ok(s) = std::str::from_utf8(response_type_token) {
                 if let Ok(value) = s.parse::<u64>() {
@@ -210,9 +254,7 @@ pub(crate) fn response(input: &[u8]) -> IResult<&[u8], Response> {
             let (input, _) = crlf(input)?;
             Ok((
                 input,
-                Response::Values(Values {
-                    values: Vec::new().into_boxed_slice(),
-                }),
+                Response::Values(Values::new(Vec::new().into_boxed_slice())),
             ))
         }
         // this is for numeric responses from incr/decr
@@ -225,6 +267,10 @@ pub(crate) fn response(input: &[u8]) -> IResult<&[u8], Response> {
             let (input, response) = deleted::parse(input)?;
             Ok((input, Response::Deleted(response)))
         }
+        (input, ResponseType::Touched) => {
+            let (input, response) = touched::parse(input)?;
+            Ok((input, Response::Touched(response)))
+        }
     }
 }
 
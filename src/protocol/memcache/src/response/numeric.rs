@@ -23,7 +23,7 @@ impl Numeric {
         if self.noreply {
             0
         } else {
-            format!("{}\r\n", self.value).len()
+            Digits::new(self.value).len() + CRLF.len()
         }
     }
 }
@@ -31,9 +31,10 @@ impl Numeric {
 impl Compose for Numeric {
     fn compose(&self, session: &mut dyn BufMut) -> usize {
         if !self.noreply {
-            let response = format!("{}\r\n", self.value).into_bytes();
-            session.put_slice(&response);
-            response.len()
+            let digits = Digits::new(self.value);
+            session.put_slice(digits.as_bytes());
+            session.put_slice(CRLF);
+            digits.len() + CRLF.len()
         } else {
             0
         }
@@ -0,0 +1,65 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+
+const MSG: &[u8] = b"TOUCHED\r\n";
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct Touched {
+    noreply: bool,
+}
+
+impl Touched {
+    pub fn new(noreply: bool) -> Self {
+        Self { noreply }
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    pub fn len(&self) -> usize {
+        if self.noreply {
+            0
+        } else {
+            MSG.len()
+        }
+    }
+}
+
+impl Compose for Touched {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        if !self.noreply {
+            session.put_slice(MSG);
+            MSG.len()
+        } else {
+            0
+        }
+    }
+}
+
+pub fn parse(input: &[u8]) -> IResult<&[u8], Touched> {
+    let (input, _) = space0(input)?;
+    let (input, _) = crlf(input)?;
+    Ok((input, Touched { noreply: false }))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parse() {
+        assert_eq!(
+            response(b"TOUCHED\r\n"),
+            Ok((&b""[..], Response::touched(false),))
+        );
+
+        assert_eq!(
+            response(b"TOUCHED \r\n"),
+            Ok((&b""[..], Response::touched(false),))
+        );
+    }
+}
@@ -3,15 +3,23 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use super::*;
+use std::sync::Arc;
 
 #[derive(Debug, PartialEq, Eq)]
 pub struct Values {
     pub(crate) values: Box<[Value]>,
+    // set for the values of a chunk of a streamed read other than the last,
+    // which are followed by the values of the next chunk rather than by the
+    // end of the response
+    pub(crate) continued: bool,
 }
 
 impl Values {
     pub fn new(values: Box<[Value]>) -> Self {
-        Self { values }
+        Self {
+            values,
+            continued: false,
+        }
     }
 
     pub fn values(&self) -> &[Value] {
@@ -24,7 +32,44 @@ pub struct Value {
     key: Box<[u8]>,
     flags: u32,
     cas: Option<u64>,
-    data: Option<Box<[u8]>>,
+    data: Option<Data>,
+}
+
+/// The data for a `Value`, which is either owned or a reference to bytes held
+/// elsewhere, such as in storage. Referenced data is written directly when the
+/// response is composed without first being copied into the response.
+pub(crate) enum Data {
+    Owned(Box<[u8]>),
+    Shared(SharedBytes),
+}
+
+impl Data {
+    pub(crate) fn as_slice(&self) -> &[u8] {
+        match self {
+            Self::Owned(data) => data,
+            Self::Shared(data) => (**data).as_ref(),
+        }
+    }
+}
+
+impl Clone for Data {
+    fn clone(&self) -> Self {
+        Self::Owned(self.as_slice().to_owned().into_boxed_slice())
+    }
+}
+
+impl PartialEq for Data {
+    fn eq(&self, other: &Self) -> bool {
+        self.as_slice() == other.as_slice()
+    }
+}
+
+impl Eq for Data {}
+
+impl std::fmt::Debug for Data {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        self.as_slice().fmt(f)
+    }
 }
 
 impl Value {
@@ -33,7 +78,24 @@ impl Value {
             key: key.to_owned().into_boxed_slice(),
             flags,
             cas,
-            data: Some(data.to_owned().into_boxed_slice()),
+            data: Some(Data::Owned(data.to_owned().into_boxed_slice())),
+        }
+    }
+
+    /// Create a `Value` which refers to data that is held elsewhere rather
+    /// than copying it. The data is borrowed until the `Value` is dropped, and
+    /// any session it is composed into has written it out.
+    pub fn shared<T: AsRef<[u8]> + Send + Sync + 'static>(
+        key: &[u8],
+        flags: u32,
+        cas: Option<u64>,
+        data: T,
+    ) -> Self {
+        Self {
+            key: key.to_owned().into_boxed_slice(),
+            flags,
+            cas,
+            data: Some(Data::Shared(Arc::new(data))),
         }
     }
 
@@ -52,27 +114,94 @@ impl Value {
 
     #[allow(clippy::len_without_is_empty)]
     pub fn len(&self) -> Option<usize> {
-        self.data.as_ref().map(|v| v.len())
+        self.data.as_ref().map(|v| v.as_slice().len())
     }
 
     pub fn value(&self) -> Option<&[u8]> {
-        self.data.as_ref().map(|v| v.as_ref())
+        self.data.as_ref().map(|v| v.as_slice())
+    }
+
+    /// Returns a copy of the data and flags of a value which was found. The
+    /// data is always copied, even if it is shared, as a copy may be kept for
+    /// long enough that it must not hold on to bytes in the storage.
+    pub(crate) fn hot_copy(&self) -> Option<HotCopy> {
+        let data = self.data.as_ref()?.as_slice();
+        Some(HotCopy {
+            data: Arc::new(data.to_owned().into_boxed_slice()),
+            flags: self.flags,
+        })
+    }
+
+    /// Create a `Value` for the key which refers to the data of the copy.
+    pub(crate) fn from_hot_copy(key: &[u8], copy: &HotCopy) -> Self {
+        Self {
+            key: key.to_owned().into_boxed_slice(),
+            flags: copy.flags,
+            cas: None,
+            data: Some(Data::Shared(copy.data.clone())),
+        }
     }
 }
 
+const VALUE: &[u8] = b"VALUE ";
+const END: &[u8] = b"END\r\n";
+
 impl Compose for Values {
     fn compose(&self, session: &mut dyn BufMut) -> usize {
-        let suffix = b"END\r\n";
-
-        let mut size = suffix.len();
+        let mut size = 0;
 
         for value in self.values.iter() {
             size += value.compose(session);
         }
-        session.put_slice(suffix);
+        if !self.continued {
+            session.put_slice(END);
+            size += END.len();
+        }
 
         size
     }
+
+    fn compose_vectored(&self, dst: &mut dyn Vectored) -> usize {
+        let mut size = 0;
+
+        for value in self.values.iter() {
+            size += value.compose_vectored(dst);
+        }
+        if !self.continued {
+            dst.buf_mut().put_slice(END);
+            size += END.len();
+        }
+
+        size
+    }
+}
+
+impl Value {
+    /// Composes everything before the data, returning the number of bytes.
+    fn compose_header(&self, len: usize, session: &mut dyn BufMut) -> usize {
+        let flags = Digits::new(self.flags as u64);
+        let len = Digits::new(len as u64);
+
+        // the header is written out in pieces, with the numeric fields
+        // formatted on the stack, rather than being built up first
+        session.put_slice(VALUE);
+        session.put_slice(&self.key);
+        session.put_u8(b' ');
+        session.put_slice(flags.as_bytes());
+        session.put_u8(b' ');
+        session.put_slice(len.as_bytes());
+        let mut size = VALUE.len() + self.key.len() + 2 + flags.len() + len.len();
+
+        if let Some(cas) = self.cas {
+            let cas = Digits::new(cas);
+            session.put_u8(b' ');
+            session.put_slice(cas.as_bytes());
+            size += 1 + cas.len();
+        }
+
+        session.put_slice(CRLF);
+        size + CRLF.len()
+    }
 }
 
 impl Compose for Value {
@@ -81,25 +210,31 @@ impl Compose for Value {
             return 0;
         }
 
-        let data = self.data.as_ref().unwrap();
-
-        let prefix = b"VALUE ";
-        let header_fields = if let Some(cas) = self.cas {
-            format!(" {} {} {}\r\n", self.flags, data.len(), cas).into_bytes()
-        } else {
-            format!(" {} {}\r\n", self.flags, data.len()).into_bytes()
-        };
+        let data = self.data.as_ref().unwrap().as_slice();
 
-        let size = prefix.len() + self.key.len() + header_fields.len() + data.len() + CRLF.len();
+        let size = self.compose_header(data.len(), session) + data.len() + CRLF.len();
 
-        session.put_slice(prefix);
-        session.put_slice(&self.key);
-        session.put_slice(&header_fields);
         session.put_slice(data);
         session.put_slice(CRLF);
 
         size
     }
+
+    fn compose_vectored(&self, dst: &mut dyn Vectored) -> usize {
+        // shared data is handed to the destination by reference, so that it
+        // can be written out directly from where it is held
+        if let Some(Data::Shared(data)) = &self.data {
+            let len = (**data).as_ref().len();
+            let size = self.compose_header(len, dst.buf_mut()) + len + CRLF.len();
+
+            dst.put_shared(data.clone());
+            dst.buf_mut().put_slice(CRLF);
+
+            size
+        } else {
+            self.compose(dst.buf_mut())
+        }
+    }
 }
 
 pub fn parse(input: &[u8]) -> IResult<&[u8], Values> {
@@ -107,7 +242,7 @@ pub fn parse(input: &[u8]) -> IResult<&[u8], Values> {
     let mut input = input;
     loop {
         let (i, _) = space1(input)?;
-        let (i, key) = take_till(|b| (b == b' ' || b == b'\r'))(i)?;
+        let (i, key) = token(i)?;
 
         let (i, _) = space1(i)?;
         let (i, flags) = parse_u32(i)?;
@@ -123,7 +258,7 @@ pub fn parse(input: &[u8]) -> IResult<&[u8], Values> {
         if let Ok((i, _)) = space1(input) {
             // we need to check to make sure we didn't stop because
             // of the CRLF
-            let (i, c) = take_till(|b| b == b'\r')(i)?;
+            let (i, c) = line(i)?;
             if !c.is_empty() {
                 // make sure it's a valid string
                 let c = std::str::from_utf8(c).map_err(|_| {
@@ -150,11 +285,11 @@ pub fn parse(input: &[u8]) -> IResult<&[u8], Values> {
             key: key.to_owned().into_boxed_slice(),
             flags,
             cas,
-            data: Some(data.to_owned().into_boxed_slice()),
+            data: Some(Data::Owned(data.to_owned().into_boxed_slice())),
         });
 
         // look for a space or the start of a CRLF
-        let (i, s) = take_till(|b| (b == b' ' || b == b'\r'))(i)?;
+        let (i, s) = token(i)?;
 
         // we should have found one of the following tokens
         match s {
@@ -179,12 +314,7 @@ pub fn parse(input: &[u8]) -> IResult<&[u8], Values> {
         }
     }
 
-    Ok((
-        input,
-        Values {
-            values: values.into_boxed_slice(),
-        },
-    ))
+    Ok((input, Values::new(values.into_boxed_slice())))
 }
 
 #[cfg(test)]
@@ -11,11 +11,19 @@ pub trait Storage {
     fn decr(&mut self, request: &Decr) -> Response;
     fn delete(&mut self, request: &Delete) -> Response;
     fn flush_all(&mut self, request: &FlushAll) -> Response;
+    fn gat(&mut self, request: &Gat) -> Response;
+    fn gats(&mut self, request: &Gats) -> Response;
     fn get(&mut self, request: &Get) -> Response;
     fn gets(&mut self, request: &Gets) -> Response;
     fn incr(&mut self, request: &Incr) -> Response;
+    fn meta_arithmetic(&mut self, request: &MetaArithmetic) -> Response;
+    fn meta_delete(&mut self, request: &MetaDelete) -> Response;
+    fn meta_get(&mut self, request: &MetaGet) -> Response;
+    fn meta_noop(&mut self, request: &MetaNoop) -> Response;
+    fn meta_set(&mut self, request: &MetaSet) -> Response;
     fn prepend(&mut self, request: &Prepend) -> Response;
     fn quit(&mut self, request: &Quit) -> Response;
     fn replace(&mut self, request: &Replace) -> Response;
     fn set(&mut self, request: &Set) -> Response;
+    fn touch(&mut self, request: &Touch) -> Response;
 }
@@ -45,9 +45,28 @@ where
     )
 }
 
+// consumes bytes up to the next space or carriage return, which delimit the
+// tokens of a command line, using a vectorized search for long tokens such as
+// keys. This is equivalent to `take_till` with a predicate matching either
+// byte.
+pub fn token(input: &[u8]) -> IResult<&[u8], &[u8]> {
+    match memchr::memchr2(b' ', b'\r', input) {
+        Some(len) => Ok((&input[len..], &input[..len])),
+        None => Err(nom::Err::Incomplete(nom::Needed::new(1))),
+    }
+}
+
+// consumes bytes up to the next carriage return
+pub fn line(input: &[u8]) -> IResult<&[u8], &[u8]> {
+    match memchr::memchr(b'\r', input) {
+        Some(len) => Ok((&input[len..], &input[..len])),
+        None => Err(nom::Err::Incomplete(nom::Needed::new(1))),
+    }
+}
+
 // parses a string that is binary safe and less than the max key length
 pub fn key(input: &[u8], max_len: usize) -> IResult<&[u8], Option<&[u8]>> {
-    let (i, key) = take_till(|b| (b == b' ' || b == b'\r'))(input).map_err(|e| {
+    let (i, key) = token(input).map_err(|e| {
         if let nom::Err::Incomplete(_) = e {
             if input.len() > max_len {
                 nom::Err::Failure(nom::error::Error::new(input, nom::error::ErrorKind::Tag))
@@ -73,30 +92,43 @@ pub fn key(input: &[u8], max_len: usize) -> IResult<&[u8], Option<&[u8]>> {
     }
 }
 
-pub fn parse_usize(input: &[u8]) -> IResult<&[u8], usize> {
-    let (input, value) = digit1(input)?;
+// decodes one or more digits [0-9] into an unsigned integer in a single pass,
+// without validating them as a string first. Values which overflow the type
+// are a failure. This has the same streaming semantics as `digit1`.
+fn parse_unsigned<T: TryFrom<u64>>(input: &[u8]) -> IResult<&[u8], T> {
+    let len = match input.iter().position(|b| !b.is_ascii_digit()) {
+        Some(0) => {
+            return Err(nom::Err::Error(nom::error::Error::new(
+                input,
+                ErrorKind::Digit,
+            )))
+        }
+        Some(len) => len,
+        None => return Err(nom::Err::Incomplete(nom::Needed::new(1))),
+    };
 
-    // SAFETY: we only matched digits [0-9] to produce the byte
-    // slice being transformed to a str here
-    let value = unsafe { std::str::from_utf8_unchecked(value) };
+    let (digits, input) = input.split_at(len);
 
-    let value = value.parse::<usize>().map_err(|_| {
-        nom::Err::Failure(nom::error::Error::new(input, nom::error::ErrorKind::Tag))
-    })?;
+    let overflow = || nom::Err::Failure(nom::error::Error::new(input, nom::error::ErrorKind::Tag));
+
+    let mut value: u64 = 0;
+    for digit in digits {
+        value = value
+            .checked_mul(10)
+            .and_then(|v| v.checked_add((digit - b'0') as u64))
+            .ok_or_else(overflow)?;
+    }
+
+    let value = T::try_from(value).map_err(|_| overflow())?;
     Ok((input, value))
 }
 
-pub fn parse_u64(input: &[u8]) -> IResult<&[u8], u64> {
-    let (input, value) = digit1(input)?;
-
-    // SAFETY: we only matched digits [0-9] to produce the byte
-    // slice being transformed to a str here
-    let value = unsafe { std::str::from_utf8_unchecked(value) };
+pub fn parse_usize(input: &[u8]) -> IResult<&[u8], usize> {
+    parse_unsigned(input)
+}
 
-    let value = value.parse::<u64>().map_err(|_| {
-        nom::Err::Failure(nom::error::Error::new(input, nom::error::ErrorKind::Tag))
-    })?;
-    Ok((input, value))
+pub fn parse_u64(input: &[u8]) -> IResult<&[u8], u64> {
+    parse_unsigned(input)
 }
 
 pub fn parse_i64(input: &[u8]) -> IResult<&[u8], i64> {
@@ -121,14 +153,42 @@ pub fn parse_ttl(input: &[u8], time_type: TimeType) -> IResult<&[u8], Ttl> {
 }
 
 pub fn parse_u32(input: &[u8]) -> IResult<&[u8], u32> {
-    let (input, value) = digit1(input)?;
+    parse_unsigned(input)
+}
 
-    // SAFETY: we only matched digits [0-9] to produce the byte
-    // slice being transformed to a str here
-    let value = unsafe { std::str::from_utf8_unchecked(value) };
+#[cfg(test)]
+mod tests {
+    use super::*;
 
-    let value = value.parse::<u32>().map_err(|_| {
-        nom::Err::Failure(nom::error::Error::new(input, nom::error::ErrorKind::Tag))
-    })?;
-    Ok((input, value))
+    #[test]
+    fn token() {
+        assert_eq!(super::token(b"key rest"), Ok((&b" rest"[..], &b"key"[..])));
+        assert_eq!(super::token(b"key\r\n"), Ok((&b"\r\n"[..], &b"key"[..])));
+        assert_eq!(super::token(b" key"), Ok((&b" key"[..], &b""[..])));
+        assert!(super::token(b"key").unwrap_err().is_incomplete());
+    }
+
+    #[test]
+    fn unsigned() {
+        assert_eq!(parse_u32(b"0 "), Ok((&b" "[..], 0)));
+        assert_eq!(
+            parse_u64(b"18446744073709551615\r\n"),
+            Ok((&b"\r\n"[..], u64::MAX))
+        );
+        assert_eq!(parse_usize(b"0042\r\n"), Ok((&b"\r\n"[..], 42)));
+
+        // values which overflow the type are a failure
+        assert!(matches!(
+            parse_u32(b"4294967296 "),
+            Err(nom::Err::Failure(_))
+        ));
+        assert!(matches!(
+            parse_u64(b"18446744073709551616 "),
+            Err(nom::Err::Failure(_))
+        ));
+
+        // there must be at least one digit, followed by some other byte
+        assert!(matches!(parse_u32(b"a"), Err(nom::Err::Error(_))));
+        assert!(parse_u32(b"123").unwrap_err().is_incomplete());
+    }
 }
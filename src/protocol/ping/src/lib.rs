@@ -29,6 +29,60 @@ mod stats {
     #[metric(name = "ping", description = "the number of ping requests")]
     pub static PING: Counter = Counter::new();
 
+    #[cfg(feature = "server")]
+    #[metric(
+        name = "ping_queue_latency",
+        description = "distribution of time spent waiting on queues for ping requests in nanoseconds"
+    )]
+    pub static PING_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+    #[cfg(feature = "server")]
+    #[metric(
+        name = "ping_execute_latency",
+        description = "distribution of time spent executing against storage for ping requests in nanoseconds"
+    )]
+    pub static PING_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+    #[cfg(feature = "server")]
+    #[metric(
+        name = "ping_write_latency",
+        description = "distribution of time spent writing out responses for ping requests in nanoseconds"
+    )]
+    pub static PING_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+    #[cfg(feature = "server")]
+    #[metric(
+        name = "ping_parse_cycles",
+        description = "cpu cycles spent parsing ping requests"
+    )]
+    pub static PING_PARSE_CYCLES: Counter = Counter::new();
+
+    #[cfg(feature = "server")]
+    #[metric(
+        name = "ping_execute_cycles",
+        description = "cpu cycles spent executing against storage for ping requests"
+    )]
+    pub static PING_EXECUTE_CYCLES: Counter = Counter::new();
+
+    #[cfg(feature = "server")]
+    #[metric(
+        name = "ping_compose_cycles",
+        description = "cpu cycles spent composing and sending responses for ping requests"
+    )]
+    pub static PING_COMPOSE_CYCLES: Counter = Counter::new();
+
+    #[cfg(feature = "server")]
+    pub static PING_LATENCIES: protocol_common::Latencies = protocol_common::Latencies {
+        queue: &PING_QUEUE_LATENCY,
+        execute: &PING_EXECUTE_LATENCY,
+        write: &PING_WRITE_LATENCY,
+        cycles: protocol_common::Cycles {
+            parse: &PING_PARSE_CYCLES,
+            execute: &PING_EXECUTE_CYCLES,
+            compose: &PING_COMPOSE_CYCLES,
+        },
+    };
+
     #[cfg(feature = "client")]
     #[metric(name = "pong", description = "the number of pong responses")]
     pub static PONG: Counter = Counter::new();
@@ -23,6 +23,42 @@ pub enum Request {
     Ping,
 }
 
+#[cfg(feature = "server")]
+impl protocol_common::Timed for Request {
+    fn latencies(&self) -> &'static protocol_common::Latencies {
+        match self {
+            Request::Ping => &crate::PING_LATENCIES,
+        }
+    }
+}
+
+// Ping requests have no key and may be answered by any shard.
+impl protocol_common::Shard<Response> for Request {}
+
+// pings do not change storage
+impl protocol_common::Replicate<Response> for Request {}
+
+// pings may be sent any number of times, but are only served over sessions
+impl protocol_common::Datagram for Request {}
+
+// pings are cheaper to answer than to fail, so they are always executed
+impl protocol_common::Deadline<Response> for Request {}
+
+// there are no keys to track
+impl protocol_common::Track<Response> for Request {}
+
+impl protocol_common::Quiet for Request {}
+
+// Ping responses arrive in the order of their requests, and a ping may be
+// sent any number of times.
+impl protocol_common::Correlate<Response> for Request {
+    fn hedge(&self) -> Option<Self> {
+        match self {
+            Request::Ping => Some(Request::Ping),
+        }
+    }
+}
+
 impl Klog for Request {
     type Response = Response;
 
@@ -0,0 +1,173 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Benchmarks of parsing RESP requests and responses, and of composing
+//! responses.
+
+use core::time::Duration;
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use protocol_resp::*;
+
+const DURATION: u64 = 10; // seconds
+
+// number of commands in a pipelined buffer
+const PIPELINE_DEPTH: usize = 16;
+
+const VALUE: &[u8; 64] = b"0123456789012345678901234567890123456789012345678901234567890123";
+
+// encodes a command as an array of bulk strings, as clients send them
+fn command(args: &[&[u8]]) -> Vec<u8> {
+    let mut buffer = format!("*{}\r\n", args.len()).into_bytes();
+    for arg in args {
+        buffer.extend_from_slice(format!("${}\r\n", arg.len()).as_bytes());
+        buffer.extend_from_slice(arg);
+        buffer.extend_from_slice(b"\r\n");
+    }
+    buffer
+}
+
+fn keys(n: usize) -> Vec<Vec<u8>> {
+    (0..n).map(|i| format!("key:{i:08}").into_bytes()).collect()
+}
+
+fn get(c: &mut Criterion) {
+    let parser = RequestParser::new();
+
+    let mut group = c.benchmark_group("request/get");
+    group.measurement_time(Duration::from_secs(DURATION));
+
+    let buffer = command(&[b"GET", b"key:00000000"]);
+    group.throughput(Throughput::Elements(1));
+    group.bench_function("single", |b| {
+        b.iter(|| parser.parse(black_box(&buffer)).unwrap())
+    });
+
+    // parse every command of a pipelined buffer, as a session does
+    let pipeline = buffer.repeat(PIPELINE_DEPTH);
+    group.throughput(Throughput::Elements(PIPELINE_DEPTH as u64));
+    group.bench_function("pipelined", |b| {
+        b.iter(|| {
+            let mut buffer = &pipeline[..];
+            while !buffer.is_empty() {
+                let request = parser.parse(black_box(buffer)).unwrap();
+                buffer = &buffer[request.consumed()..];
+            }
+        })
+    });
+}
+
+fn mget(c: &mut Criterion) {
+    let parser = RequestParser::new();
+
+    let mut group = c.benchmark_group("request/mget");
+    group.measurement_time(Duration::from_secs(DURATION));
+
+    for nkey in [1, 10, 100] {
+        let keys = keys(nkey);
+        let mut args: Vec<&[u8]> = vec![b"MGET"];
+        args.extend(keys.iter().map(|k| &k[..]));
+        let buffer = command(&args);
+
+        group.throughput(Throughput::Bytes(buffer.len() as u64));
+        group.bench_with_input(BenchmarkId::new("keys", nkey), &buffer, |b, buffer| {
+            b.iter(|| parser.parse(black_box(buffer)).unwrap())
+        });
+    }
+}
+
+fn hset(c: &mut Criterion) {
+    let parser = RequestParser::new();
+
+    let mut group = c.benchmark_group("request/hset");
+    group.measurement_time(Duration::from_secs(DURATION));
+
+    for nfield in [1, 10, 100] {
+        let fields = keys(nfield);
+        let mut args: Vec<&[u8]> = vec![b"HSET", b"hash"];
+        for field in &fields {
+            args.push(field);
+            args.push(VALUE);
+        }
+        let buffer = command(&args);
+
+        group.throughput(Throughput::Bytes(buffer.len() as u64));
+        group.bench_with_input(BenchmarkId::new("fields", nfield), &buffer, |b, buffer| {
+            b.iter(|| parser.parse(black_box(buffer)).unwrap())
+        });
+    }
+}
+
+fn set(c: &mut Criterion) {
+    let parser = RequestParser::new();
+
+    let mut group = c.benchmark_group("request/set");
+    group.measurement_time(Duration::from_secs(DURATION));
+
+    for size in [1, 100, 10_000] {
+        let value = vec![b'a'; size];
+        let buffer = command(&[b"SET", b"key:00000000", &value]);
+
+        group.throughput(Throughput::Bytes(buffer.len() as u64));
+        group.bench_with_input(BenchmarkId::new("value", size), &buffer, |b, buffer| {
+            b.iter(|| parser.parse(black_box(buffer)).unwrap())
+        });
+    }
+}
+
+// an LRANGE reply with the provided number of elements
+fn lrange_response(n: usize) -> Response {
+    Response::array((0..n).map(|_| Response::bulk_string(VALUE)).collect())
+}
+
+fn response(c: &mut Criterion) {
+    let parser = ResponseParser::default();
+
+    let mut group = c.benchmark_group("response/parse");
+    group.measurement_time(Duration::from_secs(DURATION));
+
+    for n in [1, 10, 100] {
+        let mut buffer = Vec::new();
+        lrange_response(n).compose(&mut buffer);
+
+        group.throughput(Throughput::Bytes(buffer.len() as u64));
+        group.bench_with_input(BenchmarkId::new("lrange", n), &buffer, |b, buffer| {
+            b.iter(|| parser.parse(black_box(buffer)).unwrap())
+        });
+    }
+}
+
+fn compose(c: &mut Criterion) {
+    let mut group = c.benchmark_group("response/compose");
+    group.measurement_time(Duration::from_secs(DURATION));
+
+    // the buffer is reused, as in a session, so only composing is measured
+    let mut buffer = Vec::with_capacity(1024 * 1024);
+
+    for size in [1, 100, 10_000] {
+        let response = Response::bulk_string(&vec![b'a'; size]);
+
+        group.throughput(Throughput::Bytes(size as u64));
+        group.bench_with_input(BenchmarkId::new("bulk_string", size), &response, |b, r| {
+            b.iter(|| {
+                buffer.clear();
+                r.compose(&mut buffer)
+            })
+        });
+    }
+
+    for n in [1, 10, 100] {
+        let response = lrange_response(n);
+
+        group.throughput(Throughput::Elements(n as u64));
+        group.bench_with_input(BenchmarkId::new("array", n), &response, |b, r| {
+            b.iter(|| {
+                buffer.clear();
+                r.compose(&mut buffer)
+            })
+        });
+    }
+}
+
+criterion_group!(benches, get, mget, hset, set, response, compose);
+criterion_main!(benches);
@@ -0,0 +1,2355 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Per-command histograms of the latency of each phase of request handling.
+//! See [`protocol_common::Latencies`] for the phases.
+
+use metriken::{metric, AtomicHistogram, Counter};
+use protocol_common::{Cycles, Latencies};
+
+/*
+ * BADD
+ */
+
+#[metric(
+    name = "badd_queue_latency",
+    description = "distribution of time spent waiting on queues for badd requests in nanoseconds"
+)]
+pub static BADD_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "badd_execute_latency",
+    description = "distribution of time spent executing against storage for badd requests in nanoseconds"
+)]
+pub static BADD_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "badd_write_latency",
+    description = "distribution of time spent writing out responses for badd requests in nanoseconds"
+)]
+pub static BADD_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "badd_parse_cycles",
+    description = "cpu cycles spent parsing badd requests"
+)]
+pub static BADD_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "badd_execute_cycles",
+    description = "cpu cycles spent executing against storage for badd requests"
+)]
+pub static BADD_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "badd_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for badd requests"
+)]
+pub static BADD_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static BADD_LATENCIES: Latencies = Latencies {
+    queue: &BADD_QUEUE_LATENCY,
+    execute: &BADD_EXECUTE_LATENCY,
+    write: &BADD_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &BADD_PARSE_CYCLES,
+        execute: &BADD_EXECUTE_CYCLES,
+        compose: &BADD_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * DEL
+ */
+
+#[metric(
+    name = "del_queue_latency",
+    description = "distribution of time spent waiting on queues for del requests in nanoseconds"
+)]
+pub static DEL_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "del_execute_latency",
+    description = "distribution of time spent executing against storage for del requests in nanoseconds"
+)]
+pub static DEL_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "del_write_latency",
+    description = "distribution of time spent writing out responses for del requests in nanoseconds"
+)]
+pub static DEL_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "del_parse_cycles",
+    description = "cpu cycles spent parsing del requests"
+)]
+pub static DEL_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "del_execute_cycles",
+    description = "cpu cycles spent executing against storage for del requests"
+)]
+pub static DEL_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "del_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for del requests"
+)]
+pub static DEL_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static DEL_LATENCIES: Latencies = Latencies {
+    queue: &DEL_QUEUE_LATENCY,
+    execute: &DEL_EXECUTE_LATENCY,
+    write: &DEL_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &DEL_PARSE_CYCLES,
+        execute: &DEL_EXECUTE_CYCLES,
+        compose: &DEL_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * GET
+ */
+
+#[metric(
+    name = "get_queue_latency",
+    description = "distribution of time spent waiting on queues for get requests in nanoseconds"
+)]
+pub static GET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "get_execute_latency",
+    description = "distribution of time spent executing against storage for get requests in nanoseconds"
+)]
+pub static GET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "get_write_latency",
+    description = "distribution of time spent writing out responses for get requests in nanoseconds"
+)]
+pub static GET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "get_parse_cycles",
+    description = "cpu cycles spent parsing get requests"
+)]
+pub static GET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "get_execute_cycles",
+    description = "cpu cycles spent executing against storage for get requests"
+)]
+pub static GET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "get_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for get requests"
+)]
+pub static GET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static GET_LATENCIES: Latencies = Latencies {
+    queue: &GET_QUEUE_LATENCY,
+    execute: &GET_EXECUTE_LATENCY,
+    write: &GET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &GET_PARSE_CYCLES,
+        execute: &GET_EXECUTE_CYCLES,
+        compose: &GET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HDEL
+ */
+
+#[metric(
+    name = "hdel_queue_latency",
+    description = "distribution of time spent waiting on queues for hdel requests in nanoseconds"
+)]
+pub static HDEL_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hdel_execute_latency",
+    description = "distribution of time spent executing against storage for hdel requests in nanoseconds"
+)]
+pub static HDEL_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hdel_write_latency",
+    description = "distribution of time spent writing out responses for hdel requests in nanoseconds"
+)]
+pub static HDEL_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hdel_parse_cycles",
+    description = "cpu cycles spent parsing hdel requests"
+)]
+pub static HDEL_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hdel_execute_cycles",
+    description = "cpu cycles spent executing against storage for hdel requests"
+)]
+pub static HDEL_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hdel_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hdel requests"
+)]
+pub static HDEL_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HDEL_LATENCIES: Latencies = Latencies {
+    queue: &HDEL_QUEUE_LATENCY,
+    execute: &HDEL_EXECUTE_LATENCY,
+    write: &HDEL_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HDEL_PARSE_CYCLES,
+        execute: &HDEL_EXECUTE_CYCLES,
+        compose: &HDEL_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HEXISTS
+ */
+
+#[metric(
+    name = "hexists_queue_latency",
+    description = "distribution of time spent waiting on queues for hexists requests in nanoseconds"
+)]
+pub static HEXISTS_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hexists_execute_latency",
+    description = "distribution of time spent executing against storage for hexists requests in nanoseconds"
+)]
+pub static HEXISTS_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hexists_write_latency",
+    description = "distribution of time spent writing out responses for hexists requests in nanoseconds"
+)]
+pub static HEXISTS_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hexists_parse_cycles",
+    description = "cpu cycles spent parsing hexists requests"
+)]
+pub static HEXISTS_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hexists_execute_cycles",
+    description = "cpu cycles spent executing against storage for hexists requests"
+)]
+pub static HEXISTS_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hexists_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hexists requests"
+)]
+pub static HEXISTS_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HEXISTS_LATENCIES: Latencies = Latencies {
+    queue: &HEXISTS_QUEUE_LATENCY,
+    execute: &HEXISTS_EXECUTE_LATENCY,
+    write: &HEXISTS_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HEXISTS_PARSE_CYCLES,
+        execute: &HEXISTS_EXECUTE_CYCLES,
+        compose: &HEXISTS_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HGET
+ */
+
+#[metric(
+    name = "hget_queue_latency",
+    description = "distribution of time spent waiting on queues for hget requests in nanoseconds"
+)]
+pub static HGET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hget_execute_latency",
+    description = "distribution of time spent executing against storage for hget requests in nanoseconds"
+)]
+pub static HGET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hget_write_latency",
+    description = "distribution of time spent writing out responses for hget requests in nanoseconds"
+)]
+pub static HGET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hget_parse_cycles",
+    description = "cpu cycles spent parsing hget requests"
+)]
+pub static HGET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hget_execute_cycles",
+    description = "cpu cycles spent executing against storage for hget requests"
+)]
+pub static HGET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hget_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hget requests"
+)]
+pub static HGET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HGET_LATENCIES: Latencies = Latencies {
+    queue: &HGET_QUEUE_LATENCY,
+    execute: &HGET_EXECUTE_LATENCY,
+    write: &HGET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HGET_PARSE_CYCLES,
+        execute: &HGET_EXECUTE_CYCLES,
+        compose: &HGET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HGETALL
+ */
+
+#[metric(
+    name = "hgetall_queue_latency",
+    description = "distribution of time spent waiting on queues for hgetall requests in nanoseconds"
+)]
+pub static HGETALL_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hgetall_execute_latency",
+    description = "distribution of time spent executing against storage for hgetall requests in nanoseconds"
+)]
+pub static HGETALL_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hgetall_write_latency",
+    description = "distribution of time spent writing out responses for hgetall requests in nanoseconds"
+)]
+pub static HGETALL_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hgetall_parse_cycles",
+    description = "cpu cycles spent parsing hgetall requests"
+)]
+pub static HGETALL_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hgetall_execute_cycles",
+    description = "cpu cycles spent executing against storage for hgetall requests"
+)]
+pub static HGETALL_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hgetall_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hgetall requests"
+)]
+pub static HGETALL_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HGETALL_LATENCIES: Latencies = Latencies {
+    queue: &HGETALL_QUEUE_LATENCY,
+    execute: &HGETALL_EXECUTE_LATENCY,
+    write: &HGETALL_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HGETALL_PARSE_CYCLES,
+        execute: &HGETALL_EXECUTE_CYCLES,
+        compose: &HGETALL_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HKEYS
+ */
+
+#[metric(
+    name = "hkeys_queue_latency",
+    description = "distribution of time spent waiting on queues for hkeys requests in nanoseconds"
+)]
+pub static HKEYS_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hkeys_execute_latency",
+    description = "distribution of time spent executing against storage for hkeys requests in nanoseconds"
+)]
+pub static HKEYS_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hkeys_write_latency",
+    description = "distribution of time spent writing out responses for hkeys requests in nanoseconds"
+)]
+pub static HKEYS_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hkeys_parse_cycles",
+    description = "cpu cycles spent parsing hkeys requests"
+)]
+pub static HKEYS_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hkeys_execute_cycles",
+    description = "cpu cycles spent executing against storage for hkeys requests"
+)]
+pub static HKEYS_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hkeys_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hkeys requests"
+)]
+pub static HKEYS_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HKEYS_LATENCIES: Latencies = Latencies {
+    queue: &HKEYS_QUEUE_LATENCY,
+    execute: &HKEYS_EXECUTE_LATENCY,
+    write: &HKEYS_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HKEYS_PARSE_CYCLES,
+        execute: &HKEYS_EXECUTE_CYCLES,
+        compose: &HKEYS_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HLEN
+ */
+
+#[metric(
+    name = "hlen_queue_latency",
+    description = "distribution of time spent waiting on queues for hlen requests in nanoseconds"
+)]
+pub static HLEN_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hlen_execute_latency",
+    description = "distribution of time spent executing against storage for hlen requests in nanoseconds"
+)]
+pub static HLEN_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hlen_write_latency",
+    description = "distribution of time spent writing out responses for hlen requests in nanoseconds"
+)]
+pub static HLEN_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hlen_parse_cycles",
+    description = "cpu cycles spent parsing hlen requests"
+)]
+pub static HLEN_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hlen_execute_cycles",
+    description = "cpu cycles spent executing against storage for hlen requests"
+)]
+pub static HLEN_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hlen_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hlen requests"
+)]
+pub static HLEN_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HLEN_LATENCIES: Latencies = Latencies {
+    queue: &HLEN_QUEUE_LATENCY,
+    execute: &HLEN_EXECUTE_LATENCY,
+    write: &HLEN_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HLEN_PARSE_CYCLES,
+        execute: &HLEN_EXECUTE_CYCLES,
+        compose: &HLEN_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HMGET
+ */
+
+#[metric(
+    name = "hmget_queue_latency",
+    description = "distribution of time spent waiting on queues for hmget requests in nanoseconds"
+)]
+pub static HMGET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hmget_execute_latency",
+    description = "distribution of time spent executing against storage for hmget requests in nanoseconds"
+)]
+pub static HMGET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hmget_write_latency",
+    description = "distribution of time spent writing out responses for hmget requests in nanoseconds"
+)]
+pub static HMGET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hmget_parse_cycles",
+    description = "cpu cycles spent parsing hmget requests"
+)]
+pub static HMGET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hmget_execute_cycles",
+    description = "cpu cycles spent executing against storage for hmget requests"
+)]
+pub static HMGET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hmget_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hmget requests"
+)]
+pub static HMGET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HMGET_LATENCIES: Latencies = Latencies {
+    queue: &HMGET_QUEUE_LATENCY,
+    execute: &HMGET_EXECUTE_LATENCY,
+    write: &HMGET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HMGET_PARSE_CYCLES,
+        execute: &HMGET_EXECUTE_CYCLES,
+        compose: &HMGET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HSET
+ */
+
+#[metric(
+    name = "hset_queue_latency",
+    description = "distribution of time spent waiting on queues for hset requests in nanoseconds"
+)]
+pub static HSET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hset_execute_latency",
+    description = "distribution of time spent executing against storage for hset requests in nanoseconds"
+)]
+pub static HSET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hset_write_latency",
+    description = "distribution of time spent writing out responses for hset requests in nanoseconds"
+)]
+pub static HSET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hset_parse_cycles",
+    description = "cpu cycles spent parsing hset requests"
+)]
+pub static HSET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hset_execute_cycles",
+    description = "cpu cycles spent executing against storage for hset requests"
+)]
+pub static HSET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hset_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hset requests"
+)]
+pub static HSET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HSET_LATENCIES: Latencies = Latencies {
+    queue: &HSET_QUEUE_LATENCY,
+    execute: &HSET_EXECUTE_LATENCY,
+    write: &HSET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HSET_PARSE_CYCLES,
+        execute: &HSET_EXECUTE_CYCLES,
+        compose: &HSET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HVALS
+ */
+
+#[metric(
+    name = "hvals_queue_latency",
+    description = "distribution of time spent waiting on queues for hvals requests in nanoseconds"
+)]
+pub static HVALS_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hvals_execute_latency",
+    description = "distribution of time spent executing against storage for hvals requests in nanoseconds"
+)]
+pub static HVALS_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hvals_write_latency",
+    description = "distribution of time spent writing out responses for hvals requests in nanoseconds"
+)]
+pub static HVALS_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hvals_parse_cycles",
+    description = "cpu cycles spent parsing hvals requests"
+)]
+pub static HVALS_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hvals_execute_cycles",
+    description = "cpu cycles spent executing against storage for hvals requests"
+)]
+pub static HVALS_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hvals_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hvals requests"
+)]
+pub static HVALS_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HVALS_LATENCIES: Latencies = Latencies {
+    queue: &HVALS_QUEUE_LATENCY,
+    execute: &HVALS_EXECUTE_LATENCY,
+    write: &HVALS_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HVALS_PARSE_CYCLES,
+        execute: &HVALS_EXECUTE_CYCLES,
+        compose: &HVALS_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HINCRBY
+ */
+
+#[metric(
+    name = "hincrby_queue_latency",
+    description = "distribution of time spent waiting on queues for hincrby requests in nanoseconds"
+)]
+pub static HINCRBY_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hincrby_execute_latency",
+    description = "distribution of time spent executing against storage for hincrby requests in nanoseconds"
+)]
+pub static HINCRBY_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hincrby_write_latency",
+    description = "distribution of time spent writing out responses for hincrby requests in nanoseconds"
+)]
+pub static HINCRBY_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hincrby_parse_cycles",
+    description = "cpu cycles spent parsing hincrby requests"
+)]
+pub static HINCRBY_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hincrby_execute_cycles",
+    description = "cpu cycles spent executing against storage for hincrby requests"
+)]
+pub static HINCRBY_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hincrby_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hincrby requests"
+)]
+pub static HINCRBY_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HINCRBY_LATENCIES: Latencies = Latencies {
+    queue: &HINCRBY_QUEUE_LATENCY,
+    execute: &HINCRBY_EXECUTE_LATENCY,
+    write: &HINCRBY_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HINCRBY_PARSE_CYCLES,
+        execute: &HINCRBY_EXECUTE_CYCLES,
+        compose: &HINCRBY_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * LINDEX
+ */
+
+#[metric(
+    name = "lindex_queue_latency",
+    description = "distribution of time spent waiting on queues for lindex requests in nanoseconds"
+)]
+pub static LINDEX_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lindex_execute_latency",
+    description = "distribution of time spent executing against storage for lindex requests in nanoseconds"
+)]
+pub static LINDEX_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lindex_write_latency",
+    description = "distribution of time spent writing out responses for lindex requests in nanoseconds"
+)]
+pub static LINDEX_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lindex_parse_cycles",
+    description = "cpu cycles spent parsing lindex requests"
+)]
+pub static LINDEX_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "lindex_execute_cycles",
+    description = "cpu cycles spent executing against storage for lindex requests"
+)]
+pub static LINDEX_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "lindex_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for lindex requests"
+)]
+pub static LINDEX_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static LINDEX_LATENCIES: Latencies = Latencies {
+    queue: &LINDEX_QUEUE_LATENCY,
+    execute: &LINDEX_EXECUTE_LATENCY,
+    write: &LINDEX_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &LINDEX_PARSE_CYCLES,
+        execute: &LINDEX_EXECUTE_CYCLES,
+        compose: &LINDEX_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * LLEN
+ */
+
+#[metric(
+    name = "llen_queue_latency",
+    description = "distribution of time spent waiting on queues for llen requests in nanoseconds"
+)]
+pub static LLEN_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "llen_execute_latency",
+    description = "distribution of time spent executing against storage for llen requests in nanoseconds"
+)]
+pub static LLEN_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "llen_write_latency",
+    description = "distribution of time spent writing out responses for llen requests in nanoseconds"
+)]
+pub static LLEN_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "llen_parse_cycles",
+    description = "cpu cycles spent parsing llen requests"
+)]
+pub static LLEN_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "llen_execute_cycles",
+    description = "cpu cycles spent executing against storage for llen requests"
+)]
+pub static LLEN_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "llen_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for llen requests"
+)]
+pub static LLEN_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static LLEN_LATENCIES: Latencies = Latencies {
+    queue: &LLEN_QUEUE_LATENCY,
+    execute: &LLEN_EXECUTE_LATENCY,
+    write: &LLEN_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &LLEN_PARSE_CYCLES,
+        execute: &LLEN_EXECUTE_CYCLES,
+        compose: &LLEN_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * LPOP
+ */
+
+#[metric(
+    name = "lpop_queue_latency",
+    description = "distribution of time spent waiting on queues for lpop requests in nanoseconds"
+)]
+pub static LPOP_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lpop_execute_latency",
+    description = "distribution of time spent executing against storage for lpop requests in nanoseconds"
+)]
+pub static LPOP_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lpop_write_latency",
+    description = "distribution of time spent writing out responses for lpop requests in nanoseconds"
+)]
+pub static LPOP_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lpop_parse_cycles",
+    description = "cpu cycles spent parsing lpop requests"
+)]
+pub static LPOP_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "lpop_execute_cycles",
+    description = "cpu cycles spent executing against storage for lpop requests"
+)]
+pub static LPOP_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "lpop_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for lpop requests"
+)]
+pub static LPOP_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static LPOP_LATENCIES: Latencies = Latencies {
+    queue: &LPOP_QUEUE_LATENCY,
+    execute: &LPOP_EXECUTE_LATENCY,
+    write: &LPOP_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &LPOP_PARSE_CYCLES,
+        execute: &LPOP_EXECUTE_CYCLES,
+        compose: &LPOP_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * RPOP
+ */
+
+#[metric(
+    name = "rpop_queue_latency",
+    description = "distribution of time spent waiting on queues for rpop requests in nanoseconds"
+)]
+pub static RPOP_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "rpop_execute_latency",
+    description = "distribution of time spent executing against storage for rpop requests in nanoseconds"
+)]
+pub static RPOP_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "rpop_write_latency",
+    description = "distribution of time spent writing out responses for rpop requests in nanoseconds"
+)]
+pub static RPOP_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "rpop_parse_cycles",
+    description = "cpu cycles spent parsing rpop requests"
+)]
+pub static RPOP_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "rpop_execute_cycles",
+    description = "cpu cycles spent executing against storage for rpop requests"
+)]
+pub static RPOP_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "rpop_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for rpop requests"
+)]
+pub static RPOP_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static RPOP_LATENCIES: Latencies = Latencies {
+    queue: &RPOP_QUEUE_LATENCY,
+    execute: &RPOP_EXECUTE_LATENCY,
+    write: &RPOP_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &RPOP_PARSE_CYCLES,
+        execute: &RPOP_EXECUTE_CYCLES,
+        compose: &RPOP_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * LRANGE
+ */
+
+#[metric(
+    name = "lrange_queue_latency",
+    description = "distribution of time spent waiting on queues for lrange requests in nanoseconds"
+)]
+pub static LRANGE_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lrange_execute_latency",
+    description = "distribution of time spent executing against storage for lrange requests in nanoseconds"
+)]
+pub static LRANGE_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lrange_write_latency",
+    description = "distribution of time spent writing out responses for lrange requests in nanoseconds"
+)]
+pub static LRANGE_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lrange_parse_cycles",
+    description = "cpu cycles spent parsing lrange requests"
+)]
+pub static LRANGE_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "lrange_execute_cycles",
+    description = "cpu cycles spent executing against storage for lrange requests"
+)]
+pub static LRANGE_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "lrange_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for lrange requests"
+)]
+pub static LRANGE_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static LRANGE_LATENCIES: Latencies = Latencies {
+    queue: &LRANGE_QUEUE_LATENCY,
+    execute: &LRANGE_EXECUTE_LATENCY,
+    write: &LRANGE_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &LRANGE_PARSE_CYCLES,
+        execute: &LRANGE_EXECUTE_CYCLES,
+        compose: &LRANGE_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * LPUSH
+ */
+
+#[metric(
+    name = "lpush_queue_latency",
+    description = "distribution of time spent waiting on queues for lpush requests in nanoseconds"
+)]
+pub static LPUSH_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lpush_execute_latency",
+    description = "distribution of time spent executing against storage for lpush requests in nanoseconds"
+)]
+pub static LPUSH_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lpush_write_latency",
+    description = "distribution of time spent writing out responses for lpush requests in nanoseconds"
+)]
+pub static LPUSH_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "lpush_parse_cycles",
+    description = "cpu cycles spent parsing lpush requests"
+)]
+pub static LPUSH_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "lpush_execute_cycles",
+    description = "cpu cycles spent executing against storage for lpush requests"
+)]
+pub static LPUSH_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "lpush_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for lpush requests"
+)]
+pub static LPUSH_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static LPUSH_LATENCIES: Latencies = Latencies {
+    queue: &LPUSH_QUEUE_LATENCY,
+    execute: &LPUSH_EXECUTE_LATENCY,
+    write: &LPUSH_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &LPUSH_PARSE_CYCLES,
+        execute: &LPUSH_EXECUTE_CYCLES,
+        compose: &LPUSH_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * RPUSH
+ */
+
+#[metric(
+    name = "rpush_queue_latency",
+    description = "distribution of time spent waiting on queues for rpush requests in nanoseconds"
+)]
+pub static RPUSH_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "rpush_execute_latency",
+    description = "distribution of time spent executing against storage for rpush requests in nanoseconds"
+)]
+pub static RPUSH_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "rpush_write_latency",
+    description = "distribution of time spent writing out responses for rpush requests in nanoseconds"
+)]
+pub static RPUSH_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "rpush_parse_cycles",
+    description = "cpu cycles spent parsing rpush requests"
+)]
+pub static RPUSH_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "rpush_execute_cycles",
+    description = "cpu cycles spent executing against storage for rpush requests"
+)]
+pub static RPUSH_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "rpush_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for rpush requests"
+)]
+pub static RPUSH_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static RPUSH_LATENCIES: Latencies = Latencies {
+    queue: &RPUSH_QUEUE_LATENCY,
+    execute: &RPUSH_EXECUTE_LATENCY,
+    write: &RPUSH_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &RPUSH_PARSE_CYCLES,
+        execute: &RPUSH_EXECUTE_CYCLES,
+        compose: &RPUSH_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * LTRIM
+ */
+
+#[metric(
+    name = "ltrim_queue_latency",
+    description = "distribution of time spent waiting on queues for ltrim requests in nanoseconds"
+)]
+pub static LTRIM_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "ltrim_execute_latency",
+    description = "distribution of time spent executing against storage for ltrim requests in nanoseconds"
+)]
+pub static LTRIM_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "ltrim_write_latency",
+    description = "distribution of time spent writing out responses for ltrim requests in nanoseconds"
+)]
+pub static LTRIM_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "ltrim_parse_cycles",
+    description = "cpu cycles spent parsing ltrim requests"
+)]
+pub static LTRIM_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "ltrim_execute_cycles",
+    description = "cpu cycles spent executing against storage for ltrim requests"
+)]
+pub static LTRIM_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "ltrim_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for ltrim requests"
+)]
+pub static LTRIM_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static LTRIM_LATENCIES: Latencies = Latencies {
+    queue: &LTRIM_QUEUE_LATENCY,
+    execute: &LTRIM_EXECUTE_LATENCY,
+    write: &LTRIM_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &LTRIM_PARSE_CYCLES,
+        execute: &LTRIM_EXECUTE_CYCLES,
+        compose: &LTRIM_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * SET
+ */
+
+#[metric(
+    name = "set_queue_latency",
+    description = "distribution of time spent waiting on queues for set requests in nanoseconds"
+)]
+pub static SET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "set_execute_latency",
+    description = "distribution of time spent executing against storage for set requests in nanoseconds"
+)]
+pub static SET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "set_write_latency",
+    description = "distribution of time spent writing out responses for set requests in nanoseconds"
+)]
+pub static SET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "set_parse_cycles",
+    description = "cpu cycles spent parsing set requests"
+)]
+pub static SET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "set_execute_cycles",
+    description = "cpu cycles spent executing against storage for set requests"
+)]
+pub static SET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "set_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for set requests"
+)]
+pub static SET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static SET_LATENCIES: Latencies = Latencies {
+    queue: &SET_QUEUE_LATENCY,
+    execute: &SET_EXECUTE_LATENCY,
+    write: &SET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &SET_PARSE_CYCLES,
+        execute: &SET_EXECUTE_CYCLES,
+        compose: &SET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * SADD
+ */
+
+#[metric(
+    name = "sadd_queue_latency",
+    description = "distribution of time spent waiting on queues for sadd requests in nanoseconds"
+)]
+pub static SADD_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sadd_execute_latency",
+    description = "distribution of time spent executing against storage for sadd requests in nanoseconds"
+)]
+pub static SADD_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sadd_write_latency",
+    description = "distribution of time spent writing out responses for sadd requests in nanoseconds"
+)]
+pub static SADD_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sadd_parse_cycles",
+    description = "cpu cycles spent parsing sadd requests"
+)]
+pub static SADD_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "sadd_execute_cycles",
+    description = "cpu cycles spent executing against storage for sadd requests"
+)]
+pub static SADD_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "sadd_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for sadd requests"
+)]
+pub static SADD_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static SADD_LATENCIES: Latencies = Latencies {
+    queue: &SADD_QUEUE_LATENCY,
+    execute: &SADD_EXECUTE_LATENCY,
+    write: &SADD_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &SADD_PARSE_CYCLES,
+        execute: &SADD_EXECUTE_CYCLES,
+        compose: &SADD_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * SREM
+ */
+
+#[metric(
+    name = "srem_queue_latency",
+    description = "distribution of time spent waiting on queues for srem requests in nanoseconds"
+)]
+pub static SREM_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "srem_execute_latency",
+    description = "distribution of time spent executing against storage for srem requests in nanoseconds"
+)]
+pub static SREM_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "srem_write_latency",
+    description = "distribution of time spent writing out responses for srem requests in nanoseconds"
+)]
+pub static SREM_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "srem_parse_cycles",
+    description = "cpu cycles spent parsing srem requests"
+)]
+pub static SREM_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "srem_execute_cycles",
+    description = "cpu cycles spent executing against storage for srem requests"
+)]
+pub static SREM_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "srem_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for srem requests"
+)]
+pub static SREM_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static SREM_LATENCIES: Latencies = Latencies {
+    queue: &SREM_QUEUE_LATENCY,
+    execute: &SREM_EXECUTE_LATENCY,
+    write: &SREM_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &SREM_PARSE_CYCLES,
+        execute: &SREM_EXECUTE_CYCLES,
+        compose: &SREM_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * SDIFF
+ */
+
+#[metric(
+    name = "sdiff_queue_latency",
+    description = "distribution of time spent waiting on queues for sdiff requests in nanoseconds"
+)]
+pub static SDIFF_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sdiff_execute_latency",
+    description = "distribution of time spent executing against storage for sdiff requests in nanoseconds"
+)]
+pub static SDIFF_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sdiff_write_latency",
+    description = "distribution of time spent writing out responses for sdiff requests in nanoseconds"
+)]
+pub static SDIFF_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sdiff_parse_cycles",
+    description = "cpu cycles spent parsing sdiff requests"
+)]
+pub static SDIFF_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "sdiff_execute_cycles",
+    description = "cpu cycles spent executing against storage for sdiff requests"
+)]
+pub static SDIFF_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "sdiff_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for sdiff requests"
+)]
+pub static SDIFF_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static SDIFF_LATENCIES: Latencies = Latencies {
+    queue: &SDIFF_QUEUE_LATENCY,
+    execute: &SDIFF_EXECUTE_LATENCY,
+    write: &SDIFF_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &SDIFF_PARSE_CYCLES,
+        execute: &SDIFF_EXECUTE_CYCLES,
+        compose: &SDIFF_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * SUNION
+ */
+
+#[metric(
+    name = "sunion_queue_latency",
+    description = "distribution of time spent waiting on queues for sunion requests in nanoseconds"
+)]
+pub static SUNION_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sunion_execute_latency",
+    description = "distribution of time spent executing against storage for sunion requests in nanoseconds"
+)]
+pub static SUNION_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sunion_write_latency",
+    description = "distribution of time spent writing out responses for sunion requests in nanoseconds"
+)]
+pub static SUNION_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sunion_parse_cycles",
+    description = "cpu cycles spent parsing sunion requests"
+)]
+pub static SUNION_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "sunion_execute_cycles",
+    description = "cpu cycles spent executing against storage for sunion requests"
+)]
+pub static SUNION_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "sunion_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for sunion requests"
+)]
+pub static SUNION_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static SUNION_LATENCIES: Latencies = Latencies {
+    queue: &SUNION_QUEUE_LATENCY,
+    execute: &SUNION_EXECUTE_LATENCY,
+    write: &SUNION_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &SUNION_PARSE_CYCLES,
+        execute: &SUNION_EXECUTE_CYCLES,
+        compose: &SUNION_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * SINTER
+ */
+
+#[metric(
+    name = "sinter_queue_latency",
+    description = "distribution of time spent waiting on queues for sinter requests in nanoseconds"
+)]
+pub static SINTER_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sinter_execute_latency",
+    description = "distribution of time spent executing against storage for sinter requests in nanoseconds"
+)]
+pub static SINTER_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sinter_write_latency",
+    description = "distribution of time spent writing out responses for sinter requests in nanoseconds"
+)]
+pub static SINTER_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sinter_parse_cycles",
+    description = "cpu cycles spent parsing sinter requests"
+)]
+pub static SINTER_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "sinter_execute_cycles",
+    description = "cpu cycles spent executing against storage for sinter requests"
+)]
+pub static SINTER_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "sinter_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for sinter requests"
+)]
+pub static SINTER_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static SINTER_LATENCIES: Latencies = Latencies {
+    queue: &SINTER_QUEUE_LATENCY,
+    execute: &SINTER_EXECUTE_LATENCY,
+    write: &SINTER_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &SINTER_PARSE_CYCLES,
+        execute: &SINTER_EXECUTE_CYCLES,
+        compose: &SINTER_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * SMEMBERS
+ */
+
+#[metric(
+    name = "smembers_queue_latency",
+    description = "distribution of time spent waiting on queues for smembers requests in nanoseconds"
+)]
+pub static SMEMBERS_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "smembers_execute_latency",
+    description = "distribution of time spent executing against storage for smembers requests in nanoseconds"
+)]
+pub static SMEMBERS_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "smembers_write_latency",
+    description = "distribution of time spent writing out responses for smembers requests in nanoseconds"
+)]
+pub static SMEMBERS_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "smembers_parse_cycles",
+    description = "cpu cycles spent parsing smembers requests"
+)]
+pub static SMEMBERS_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "smembers_execute_cycles",
+    description = "cpu cycles spent executing against storage for smembers requests"
+)]
+pub static SMEMBERS_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "smembers_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for smembers requests"
+)]
+pub static SMEMBERS_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static SMEMBERS_LATENCIES: Latencies = Latencies {
+    queue: &SMEMBERS_QUEUE_LATENCY,
+    execute: &SMEMBERS_EXECUTE_LATENCY,
+    write: &SMEMBERS_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &SMEMBERS_PARSE_CYCLES,
+        execute: &SMEMBERS_EXECUTE_CYCLES,
+        compose: &SMEMBERS_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * SISMEMBER
+ */
+
+#[metric(
+    name = "sismember_queue_latency",
+    description = "distribution of time spent waiting on queues for sismember requests in nanoseconds"
+)]
+pub static SISMEMBER_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sismember_execute_latency",
+    description = "distribution of time spent executing against storage for sismember requests in nanoseconds"
+)]
+pub static SISMEMBER_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sismember_write_latency",
+    description = "distribution of time spent writing out responses for sismember requests in nanoseconds"
+)]
+pub static SISMEMBER_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "sismember_parse_cycles",
+    description = "cpu cycles spent parsing sismember requests"
+)]
+pub static SISMEMBER_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "sismember_execute_cycles",
+    description = "cpu cycles spent executing against storage for sismember requests"
+)]
+pub static SISMEMBER_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "sismember_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for sismember requests"
+)]
+pub static SISMEMBER_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static SISMEMBER_LATENCIES: Latencies = Latencies {
+    queue: &SISMEMBER_QUEUE_LATENCY,
+    execute: &SISMEMBER_EXECUTE_LATENCY,
+    write: &SISMEMBER_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &SISMEMBER_PARSE_CYCLES,
+        execute: &SISMEMBER_EXECUTE_CYCLES,
+        compose: &SISMEMBER_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * DECRBY
+ */
+
+#[metric(
+    name = "decrby_queue_latency",
+    description = "distribution of time spent waiting on queues for decrby requests in nanoseconds"
+)]
+pub static DECRBY_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "decrby_execute_latency",
+    description = "distribution of time spent executing against storage for decrby requests in nanoseconds"
+)]
+pub static DECRBY_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "decrby_write_latency",
+    description = "distribution of time spent writing out responses for decrby requests in nanoseconds"
+)]
+pub static DECRBY_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "decrby_parse_cycles",
+    description = "cpu cycles spent parsing decrby requests"
+)]
+pub static DECRBY_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "decrby_execute_cycles",
+    description = "cpu cycles spent executing against storage for decrby requests"
+)]
+pub static DECRBY_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "decrby_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for decrby requests"
+)]
+pub static DECRBY_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static DECRBY_LATENCIES: Latencies = Latencies {
+    queue: &DECRBY_QUEUE_LATENCY,
+    execute: &DECRBY_EXECUTE_LATENCY,
+    write: &DECRBY_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &DECRBY_PARSE_CYCLES,
+        execute: &DECRBY_EXECUTE_CYCLES,
+        compose: &DECRBY_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * EXISTS
+ */
+
+#[metric(
+    name = "exists_queue_latency",
+    description = "distribution of time spent waiting on queues for exists requests in nanoseconds"
+)]
+pub static EXISTS_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "exists_execute_latency",
+    description = "distribution of time spent executing against storage for exists requests in nanoseconds"
+)]
+pub static EXISTS_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "exists_write_latency",
+    description = "distribution of time spent writing out responses for exists requests in nanoseconds"
+)]
+pub static EXISTS_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "exists_parse_cycles",
+    description = "cpu cycles spent parsing exists requests"
+)]
+pub static EXISTS_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "exists_execute_cycles",
+    description = "cpu cycles spent executing against storage for exists requests"
+)]
+pub static EXISTS_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "exists_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for exists requests"
+)]
+pub static EXISTS_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static EXISTS_LATENCIES: Latencies = Latencies {
+    queue: &EXISTS_QUEUE_LATENCY,
+    execute: &EXISTS_EXECUTE_LATENCY,
+    write: &EXISTS_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &EXISTS_PARSE_CYCLES,
+        execute: &EXISTS_EXECUTE_CYCLES,
+        compose: &EXISTS_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * EXPIRE
+ */
+
+#[metric(
+    name = "expire_queue_latency",
+    description = "distribution of time spent waiting on queues for expire requests in nanoseconds"
+)]
+pub static EXPIRE_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "expire_execute_latency",
+    description = "distribution of time spent executing against storage for expire requests in nanoseconds"
+)]
+pub static EXPIRE_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "expire_write_latency",
+    description = "distribution of time spent writing out responses for expire requests in nanoseconds"
+)]
+pub static EXPIRE_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "expire_parse_cycles",
+    description = "cpu cycles spent parsing expire requests"
+)]
+pub static EXPIRE_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "expire_execute_cycles",
+    description = "cpu cycles spent executing against storage for expire requests"
+)]
+pub static EXPIRE_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "expire_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for expire requests"
+)]
+pub static EXPIRE_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static EXPIRE_LATENCIES: Latencies = Latencies {
+    queue: &EXPIRE_QUEUE_LATENCY,
+    execute: &EXPIRE_EXECUTE_LATENCY,
+    write: &EXPIRE_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &EXPIRE_PARSE_CYCLES,
+        execute: &EXPIRE_EXECUTE_CYCLES,
+        compose: &EXPIRE_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * GETEX
+ */
+
+#[metric(
+    name = "getex_queue_latency",
+    description = "distribution of time spent waiting on queues for getex requests in nanoseconds"
+)]
+pub static GETEX_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "getex_execute_latency",
+    description = "distribution of time spent executing against storage for getex requests in nanoseconds"
+)]
+pub static GETEX_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "getex_write_latency",
+    description = "distribution of time spent writing out responses for getex requests in nanoseconds"
+)]
+pub static GETEX_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "getex_parse_cycles",
+    description = "cpu cycles spent parsing getex requests"
+)]
+pub static GETEX_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "getex_execute_cycles",
+    description = "cpu cycles spent executing against storage for getex requests"
+)]
+pub static GETEX_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "getex_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for getex requests"
+)]
+pub static GETEX_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static GETEX_LATENCIES: Latencies = Latencies {
+    queue: &GETEX_QUEUE_LATENCY,
+    execute: &GETEX_EXECUTE_LATENCY,
+    write: &GETEX_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &GETEX_PARSE_CYCLES,
+        execute: &GETEX_EXECUTE_CYCLES,
+        compose: &GETEX_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * INCRBY
+ */
+
+#[metric(
+    name = "incrby_queue_latency",
+    description = "distribution of time spent waiting on queues for incrby requests in nanoseconds"
+)]
+pub static INCRBY_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "incrby_execute_latency",
+    description = "distribution of time spent executing against storage for incrby requests in nanoseconds"
+)]
+pub static INCRBY_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "incrby_write_latency",
+    description = "distribution of time spent writing out responses for incrby requests in nanoseconds"
+)]
+pub static INCRBY_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "incrby_parse_cycles",
+    description = "cpu cycles spent parsing incrby requests"
+)]
+pub static INCRBY_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "incrby_execute_cycles",
+    description = "cpu cycles spent executing against storage for incrby requests"
+)]
+pub static INCRBY_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "incrby_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for incrby requests"
+)]
+pub static INCRBY_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static INCRBY_LATENCIES: Latencies = Latencies {
+    queue: &INCRBY_QUEUE_LATENCY,
+    execute: &INCRBY_EXECUTE_LATENCY,
+    write: &INCRBY_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &INCRBY_PARSE_CYCLES,
+        execute: &INCRBY_EXECUTE_CYCLES,
+        compose: &INCRBY_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * MGET
+ */
+
+#[metric(
+    name = "mget_queue_latency",
+    description = "distribution of time spent waiting on queues for mget requests in nanoseconds"
+)]
+pub static MGET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "mget_execute_latency",
+    description = "distribution of time spent executing against storage for mget requests in nanoseconds"
+)]
+pub static MGET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "mget_write_latency",
+    description = "distribution of time spent writing out responses for mget requests in nanoseconds"
+)]
+pub static MGET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "mget_parse_cycles",
+    description = "cpu cycles spent parsing mget requests"
+)]
+pub static MGET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "mget_execute_cycles",
+    description = "cpu cycles spent executing against storage for mget requests"
+)]
+pub static MGET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "mget_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for mget requests"
+)]
+pub static MGET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static MGET_LATENCIES: Latencies = Latencies {
+    queue: &MGET_QUEUE_LATENCY,
+    execute: &MGET_EXECUTE_LATENCY,
+    write: &MGET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &MGET_PARSE_CYCLES,
+        execute: &MGET_EXECUTE_CYCLES,
+        compose: &MGET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * MSET
+ */
+
+#[metric(
+    name = "mset_queue_latency",
+    description = "distribution of time spent waiting on queues for mset requests in nanoseconds"
+)]
+pub static MSET_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "mset_execute_latency",
+    description = "distribution of time spent executing against storage for mset requests in nanoseconds"
+)]
+pub static MSET_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "mset_write_latency",
+    description = "distribution of time spent writing out responses for mset requests in nanoseconds"
+)]
+pub static MSET_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "mset_parse_cycles",
+    description = "cpu cycles spent parsing mset requests"
+)]
+pub static MSET_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "mset_execute_cycles",
+    description = "cpu cycles spent executing against storage for mset requests"
+)]
+pub static MSET_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "mset_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for mset requests"
+)]
+pub static MSET_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static MSET_LATENCIES: Latencies = Latencies {
+    queue: &MSET_QUEUE_LATENCY,
+    execute: &MSET_EXECUTE_LATENCY,
+    write: &MSET_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &MSET_PARSE_CYCLES,
+        execute: &MSET_EXECUTE_CYCLES,
+        compose: &MSET_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * TTL
+ */
+
+#[metric(
+    name = "ttl_queue_latency",
+    description = "distribution of time spent waiting on queues for ttl requests in nanoseconds"
+)]
+pub static TTL_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "ttl_execute_latency",
+    description = "distribution of time spent executing against storage for ttl requests in nanoseconds"
+)]
+pub static TTL_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "ttl_write_latency",
+    description = "distribution of time spent writing out responses for ttl requests in nanoseconds"
+)]
+pub static TTL_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "ttl_parse_cycles",
+    description = "cpu cycles spent parsing ttl requests"
+)]
+pub static TTL_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "ttl_execute_cycles",
+    description = "cpu cycles spent executing against storage for ttl requests"
+)]
+pub static TTL_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "ttl_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for ttl requests"
+)]
+pub static TTL_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static TTL_LATENCIES: Latencies = Latencies {
+    queue: &TTL_QUEUE_LATENCY,
+    execute: &TTL_EXECUTE_LATENCY,
+    write: &TTL_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &TTL_PARSE_CYCLES,
+        execute: &TTL_EXECUTE_CYCLES,
+        compose: &TTL_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * SCAN
+ */
+
+#[metric(
+    name = "scan_queue_latency",
+    description = "distribution of time spent waiting on queues for scan requests in nanoseconds"
+)]
+pub static SCAN_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "scan_execute_latency",
+    description = "distribution of time spent executing against storage for scan requests in nanoseconds"
+)]
+pub static SCAN_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "scan_write_latency",
+    description = "distribution of time spent writing out responses for scan requests in nanoseconds"
+)]
+pub static SCAN_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "scan_parse_cycles",
+    description = "cpu cycles spent parsing scan requests"
+)]
+pub static SCAN_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "scan_execute_cycles",
+    description = "cpu cycles spent executing against storage for scan requests"
+)]
+pub static SCAN_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "scan_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for scan requests"
+)]
+pub static SCAN_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static SCAN_LATENCIES: Latencies = Latencies {
+    queue: &SCAN_QUEUE_LATENCY,
+    execute: &SCAN_EXECUTE_LATENCY,
+    write: &SCAN_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &SCAN_PARSE_CYCLES,
+        execute: &SCAN_EXECUTE_CYCLES,
+        compose: &SCAN_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * CLIENT
+ */
+
+#[metric(
+    name = "client_queue_latency",
+    description = "distribution of time spent waiting on queues for client requests in nanoseconds"
+)]
+pub static CLIENT_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "client_execute_latency",
+    description = "distribution of time spent executing against storage for client requests in nanoseconds"
+)]
+pub static CLIENT_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "client_write_latency",
+    description = "distribution of time spent writing out responses for client requests in nanoseconds"
+)]
+pub static CLIENT_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "client_parse_cycles",
+    description = "cpu cycles spent parsing client requests"
+)]
+pub static CLIENT_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "client_execute_cycles",
+    description = "cpu cycles spent executing against storage for client requests"
+)]
+pub static CLIENT_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "client_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for client requests"
+)]
+pub static CLIENT_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static CLIENT_LATENCIES: Latencies = Latencies {
+    queue: &CLIENT_QUEUE_LATENCY,
+    execute: &CLIENT_EXECUTE_LATENCY,
+    write: &CLIENT_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &CLIENT_PARSE_CYCLES,
+        execute: &CLIENT_EXECUTE_CYCLES,
+        compose: &CLIENT_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * HELLO
+ */
+
+#[metric(
+    name = "hello_queue_latency",
+    description = "distribution of time spent waiting on queues for hello requests in nanoseconds"
+)]
+pub static HELLO_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hello_execute_latency",
+    description = "distribution of time spent executing against storage for hello requests in nanoseconds"
+)]
+pub static HELLO_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hello_write_latency",
+    description = "distribution of time spent writing out responses for hello requests in nanoseconds"
+)]
+pub static HELLO_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "hello_parse_cycles",
+    description = "cpu cycles spent parsing hello requests"
+)]
+pub static HELLO_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hello_execute_cycles",
+    description = "cpu cycles spent executing against storage for hello requests"
+)]
+pub static HELLO_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "hello_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for hello requests"
+)]
+pub static HELLO_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static HELLO_LATENCIES: Latencies = Latencies {
+    queue: &HELLO_QUEUE_LATENCY,
+    execute: &HELLO_EXECUTE_LATENCY,
+    write: &HELLO_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &HELLO_PARSE_CYCLES,
+        execute: &HELLO_EXECUTE_CYCLES,
+        compose: &HELLO_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * ZADD
+ */
+
+#[metric(
+    name = "zadd_queue_latency",
+    description = "distribution of time spent waiting on queues for zadd requests in nanoseconds"
+)]
+pub static ZADD_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zadd_execute_latency",
+    description = "distribution of time spent executing against storage for zadd requests in nanoseconds"
+)]
+pub static ZADD_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zadd_write_latency",
+    description = "distribution of time spent writing out responses for zadd requests in nanoseconds"
+)]
+pub static ZADD_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zadd_parse_cycles",
+    description = "cpu cycles spent parsing zadd requests"
+)]
+pub static ZADD_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zadd_execute_cycles",
+    description = "cpu cycles spent executing against storage for zadd requests"
+)]
+pub static ZADD_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zadd_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for zadd requests"
+)]
+pub static ZADD_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static ZADD_LATENCIES: Latencies = Latencies {
+    queue: &ZADD_QUEUE_LATENCY,
+    execute: &ZADD_EXECUTE_LATENCY,
+    write: &ZADD_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &ZADD_PARSE_CYCLES,
+        execute: &ZADD_EXECUTE_CYCLES,
+        compose: &ZADD_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * ZINCRBY
+ */
+
+#[metric(
+    name = "zincrby_queue_latency",
+    description = "distribution of time spent waiting on queues for zincrby requests in nanoseconds"
+)]
+pub static ZINCRBY_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zincrby_execute_latency",
+    description = "distribution of time spent executing against storage for zincrby requests in nanoseconds"
+)]
+pub static ZINCRBY_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zincrby_write_latency",
+    description = "distribution of time spent writing out responses for zincrby requests in nanoseconds"
+)]
+pub static ZINCRBY_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zincrby_parse_cycles",
+    description = "cpu cycles spent parsing zincrby requests"
+)]
+pub static ZINCRBY_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zincrby_execute_cycles",
+    description = "cpu cycles spent executing against storage for zincrby requests"
+)]
+pub static ZINCRBY_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zincrby_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for zincrby requests"
+)]
+pub static ZINCRBY_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static ZINCRBY_LATENCIES: Latencies = Latencies {
+    queue: &ZINCRBY_QUEUE_LATENCY,
+    execute: &ZINCRBY_EXECUTE_LATENCY,
+    write: &ZINCRBY_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &ZINCRBY_PARSE_CYCLES,
+        execute: &ZINCRBY_EXECUTE_CYCLES,
+        compose: &ZINCRBY_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * ZRANGE
+ */
+
+#[metric(
+    name = "zrange_queue_latency",
+    description = "distribution of time spent waiting on queues for zrange requests in nanoseconds"
+)]
+pub static ZRANGE_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrange_execute_latency",
+    description = "distribution of time spent executing against storage for zrange requests in nanoseconds"
+)]
+pub static ZRANGE_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrange_write_latency",
+    description = "distribution of time spent writing out responses for zrange requests in nanoseconds"
+)]
+pub static ZRANGE_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrange_parse_cycles",
+    description = "cpu cycles spent parsing zrange requests"
+)]
+pub static ZRANGE_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zrange_execute_cycles",
+    description = "cpu cycles spent executing against storage for zrange requests"
+)]
+pub static ZRANGE_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zrange_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for zrange requests"
+)]
+pub static ZRANGE_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static ZRANGE_LATENCIES: Latencies = Latencies {
+    queue: &ZRANGE_QUEUE_LATENCY,
+    execute: &ZRANGE_EXECUTE_LATENCY,
+    write: &ZRANGE_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &ZRANGE_PARSE_CYCLES,
+        execute: &ZRANGE_EXECUTE_CYCLES,
+        compose: &ZRANGE_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * ZRANGEBYSCORE
+ */
+
+#[metric(
+    name = "zrangebyscore_queue_latency",
+    description = "distribution of time spent waiting on queues for zrangebyscore requests in nanoseconds"
+)]
+pub static ZRANGEBYSCORE_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrangebyscore_execute_latency",
+    description = "distribution of time spent executing against storage for zrangebyscore requests in nanoseconds"
+)]
+pub static ZRANGEBYSCORE_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrangebyscore_write_latency",
+    description = "distribution of time spent writing out responses for zrangebyscore requests in nanoseconds"
+)]
+pub static ZRANGEBYSCORE_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrangebyscore_parse_cycles",
+    description = "cpu cycles spent parsing zrangebyscore requests"
+)]
+pub static ZRANGEBYSCORE_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zrangebyscore_execute_cycles",
+    description = "cpu cycles spent executing against storage for zrangebyscore requests"
+)]
+pub static ZRANGEBYSCORE_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zrangebyscore_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for zrangebyscore requests"
+)]
+pub static ZRANGEBYSCORE_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static ZRANGEBYSCORE_LATENCIES: Latencies = Latencies {
+    queue: &ZRANGEBYSCORE_QUEUE_LATENCY,
+    execute: &ZRANGEBYSCORE_EXECUTE_LATENCY,
+    write: &ZRANGEBYSCORE_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &ZRANGEBYSCORE_PARSE_CYCLES,
+        execute: &ZRANGEBYSCORE_EXECUTE_CYCLES,
+        compose: &ZRANGEBYSCORE_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * ZRANK
+ */
+
+#[metric(
+    name = "zrank_queue_latency",
+    description = "distribution of time spent waiting on queues for zrank requests in nanoseconds"
+)]
+pub static ZRANK_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrank_execute_latency",
+    description = "distribution of time spent executing against storage for zrank requests in nanoseconds"
+)]
+pub static ZRANK_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrank_write_latency",
+    description = "distribution of time spent writing out responses for zrank requests in nanoseconds"
+)]
+pub static ZRANK_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrank_parse_cycles",
+    description = "cpu cycles spent parsing zrank requests"
+)]
+pub static ZRANK_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zrank_execute_cycles",
+    description = "cpu cycles spent executing against storage for zrank requests"
+)]
+pub static ZRANK_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zrank_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for zrank requests"
+)]
+pub static ZRANK_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static ZRANK_LATENCIES: Latencies = Latencies {
+    queue: &ZRANK_QUEUE_LATENCY,
+    execute: &ZRANK_EXECUTE_LATENCY,
+    write: &ZRANK_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &ZRANK_PARSE_CYCLES,
+        execute: &ZRANK_EXECUTE_CYCLES,
+        compose: &ZRANK_COMPOSE_CYCLES,
+    },
+};
+
+/*
+ * ZREM
+ */
+
+#[metric(
+    name = "zrem_queue_latency",
+    description = "distribution of time spent waiting on queues for zrem requests in nanoseconds"
+)]
+pub static ZREM_QUEUE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrem_execute_latency",
+    description = "distribution of time spent executing against storage for zrem requests in nanoseconds"
+)]
+pub static ZREM_EXECUTE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrem_write_latency",
+    description = "distribution of time spent writing out responses for zrem requests in nanoseconds"
+)]
+pub static ZREM_WRITE_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+#[metric(
+    name = "zrem_parse_cycles",
+    description = "cpu cycles spent parsing zrem requests"
+)]
+pub static ZREM_PARSE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zrem_execute_cycles",
+    description = "cpu cycles spent executing against storage for zrem requests"
+)]
+pub static ZREM_EXECUTE_CYCLES: Counter = Counter::new();
+
+#[metric(
+    name = "zrem_compose_cycles",
+    description = "cpu cycles spent composing and sending responses for zrem requests"
+)]
+pub static ZREM_COMPOSE_CYCLES: Counter = Counter::new();
+
+pub(crate) static ZREM_LATENCIES: Latencies = Latencies {
+    queue: &ZREM_QUEUE_LATENCY,
+    execute: &ZREM_EXECUTE_LATENCY,
+    write: &ZREM_WRITE_LATENCY,
+    cycles: Cycles {
+        parse: &ZREM_PARSE_CYCLES,
+        execute: &ZREM_EXECUTE_CYCLES,
+        compose: &ZREM_COMPOSE_CYCLES,
+    },
+};
@@ -5,6 +5,7 @@
 #[macro_use]
 extern crate logger;
 
+mod latency;
 mod message;
 mod request;
 mod response;
@@ -15,6 +16,7 @@ pub mod parse;
 
 pub use protocol_common::*;
 
+pub use crate::util::format_score;
 pub(crate) use crate::util::*;
 
 pub use crate::request::*;
@@ -29,14 +29,14 @@ impl Compose for Array {
     fn compose(&self, session: &mut dyn BufMut) -> usize {
         let mut len = 0;
         if let Some(values) = &self.inner {
-            let header = format!("*{}\r\n", values.len());
-            session.put_slice(header.as_bytes());
-            len += header.as_bytes().len();
+            let digits = Digits::new(values.len() as u64);
+            session.put_u8(b'*');
+            session.put_slice(digits.as_bytes());
+            session.put_slice(b"\r\n");
+            len += digits.len() + 3;
             for value in values {
                 len += value.compose(session);
             }
-            session.put_slice(b"\r\n");
-            len += 2;
         } else {
             // A null array is serialized as `*-1\r\n`.
             session.put_slice(b"*-1\r\n");
@@ -119,6 +119,20 @@ impl<'a> IntoIterator for &'a Array {
 mod tests {
     use super::*;
 
+    #[test]
+    fn compose() {
+        let array = Message::Array(Array {
+            inner: Some(vec![Message::bulk_string(b"HELLO"), Message::null()]),
+        });
+        let mut buf = Vec::new();
+        let len = array.compose(&mut buf);
+        assert_eq!(len, buf.len());
+        assert_eq!(buf, b"*2\r\n$5\r\nHELLO\r\n$-1\r\n");
+
+        // the composed array parses back without any trailing bytes
+        assert_eq!(message(&buf), Ok((&b""[..], array)));
+    }
+
     #[test]
     fn parse() {
         assert_eq!(
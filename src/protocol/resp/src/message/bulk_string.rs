@@ -56,11 +56,13 @@ impl TryInto<u64> for BulkString {
 impl Compose for BulkString {
     fn compose(&self, buf: &mut dyn BufMut) -> usize {
         if let Some(value) = &self.inner {
-            let header = format!("${}\r\n", value.len());
-            buf.put_slice(header.as_bytes());
+            let digits = Digits::new(value.len() as u64);
+            buf.put_u8(b'$');
+            buf.put_slice(digits.as_bytes());
+            buf.put_slice(b"\r\n");
             buf.put_slice(value);
             buf.put_slice(b"\r\n");
-            header.as_bytes().len() + value.len() + 2
+            digits.len() + value.len() + 5
         } else {
             // A null bulk string is serialized as `$-1\r\n`.
             buf.put_slice(b"$-1\r\n");
@@ -21,9 +21,11 @@ impl Integer {
 
 impl Compose for Integer {
     fn compose(&self, buf: &mut dyn BufMut) -> usize {
-        let data = format!(":{}\r\n", self.inner);
-        buf.put_slice(data.as_bytes());
-        data.as_bytes().len()
+        let digits = Digits::signed(self.inner);
+        buf.put_u8(b':');
+        buf.put_slice(digits.as_bytes());
+        buf.put_slice(b"\r\n");
+        digits.len() + 3
     }
 }
 
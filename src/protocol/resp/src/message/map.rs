@@ -0,0 +1,73 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use protocol_common::Compose;
+
+/// A RESP3 map, which is only sent to clients which asked for RESP3 with
+/// `HELLO 3`. It is encoded as its number of pairs prefixed with `%`, followed
+/// by each key and value in turn.
+#[derive(Debug, PartialEq, Eq)]
+pub struct Map {
+    pub(crate) inner: Vec<(Message, Message)>,
+}
+
+impl Map {
+    /// Get the number of pairs in the map.
+    pub fn len(&self) -> usize {
+        self.inner.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.inner.is_empty()
+    }
+}
+
+impl Compose for Map {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        let digits = Digits::new(self.inner.len() as u64);
+        session.put_u8(b'%');
+        session.put_slice(digits.as_bytes());
+        session.put_slice(b"\r\n");
+        let mut len = digits.len() + 3;
+        for (key, value) in &self.inner {
+            len += key.compose(session);
+            len += value.compose(session);
+        }
+        len
+    }
+}
+
+pub fn parse(input: &[u8]) -> IResult<&[u8], Map> {
+    let (input, len) = digit1(input)?;
+    let len = unsafe { std::str::from_utf8_unchecked(len).to_owned() };
+    let len = len
+        .parse::<usize>()
+        .map_err(|_| Err::Failure(nom::error::Error::new(input, nom::error::ErrorKind::Tag)))?;
+    let (mut input, _) = crlf(input)?;
+    let mut pairs = Vec::new();
+    for _ in 0..len {
+        let (i, key) = message(input)?;
+        let (i, value) = message(i)?;
+        pairs.push((key, value));
+        input = i;
+    }
+    Ok((input, Map { inner: pairs }))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn compose() {
+        let map = Message::map(vec![(Message::bulk_string(b"proto"), Message::integer(3))]);
+        let mut buf = Vec::new();
+        let len = map.compose(&mut buf);
+        assert_eq!(len, buf.len());
+        assert_eq!(buf, b"%1\r\n$5\r\nproto\r\n:3\r\n");
+
+        assert_eq!(message(&buf), Ok((&b""[..], map)));
+    }
+}
@@ -9,12 +9,16 @@ mod array;
 mod bulk_string;
 mod error;
 mod integer;
+mod map;
+mod push;
 mod simple_string;
 
 pub use array::Array;
 pub use bulk_string::BulkString;
 pub use error::Error;
 pub use integer::Integer;
+pub use map::Map;
+pub use push::Push;
 pub use simple_string::SimpleString;
 
 #[derive(Debug, PartialEq, Eq)]
@@ -24,6 +28,8 @@ pub enum Message {
     Error(Error),
     Integer(Integer),
     Array(Array),
+    Map(Map),
+    Push(Push),
 }
 
 impl Message {
@@ -50,6 +56,33 @@ impl Message {
     pub fn bulk_string(value: &[u8]) -> Self {
         Self::BulkString(BulkString::new(value))
     }
+
+    pub fn array(values: Vec<Message>) -> Self {
+        Self::Array(Array {
+            inner: Some(values),
+        })
+    }
+
+    pub fn null_array() -> Self {
+        Self::Array(Array::null())
+    }
+
+    pub fn map(pairs: Vec<(Message, Message)>) -> Self {
+        Self::Map(Map { inner: pairs })
+    }
+
+    /// Returns the push frame which tells a client tracking keys that the
+    /// keys have changed, or that all keys have if there are none.
+    pub fn invalidate(keys: &[&[u8]]) -> Self {
+        let keys = if keys.is_empty() {
+            Self::null()
+        } else {
+            Self::array(keys.iter().map(|key| Self::bulk_string(key)).collect())
+        };
+        Self::Push(Push {
+            inner: vec![Self::bulk_string(b"invalidate"), keys],
+        })
+    }
 }
 
 impl Compose for Message {
@@ -60,6 +93,8 @@ impl Compose for Message {
             Self::Error(e) => e.compose(buf),
             Self::Integer(i) => i.compose(buf),
             Self::Array(a) => a.compose(buf),
+            Self::Map(m) => m.compose(buf),
+            Self::Push(p) => p.compose(buf),
         }
     }
 }
@@ -71,6 +106,8 @@ pub enum MessageType {
     Integer,
     BulkString,
     Array,
+    Map,
+    Push,
 }
 
 #[derive(Default, Clone)]
@@ -84,6 +121,8 @@ pub(crate) fn message_type(input: &[u8]) -> IResult<&[u8], MessageType> {
         b":" => MessageType::Integer,
         b"$" => MessageType::BulkString,
         b"*" => MessageType::Array,
+        b"%" => MessageType::Map,
+        b">" => MessageType::Push,
         _ => {
             return Err(Err::Failure(nom::error::Error::new(
                 input,
@@ -116,6 +155,14 @@ pub(crate) fn message(input: &[u8]) -> IResult<&[u8], Message> {
             let (input, message) = array::parse(input)?;
             Ok((input, Message::Array(message)))
         }
+        (input, MessageType::Map) => {
+            let (input, message) = map::parse(input)?;
+            Ok((input, Message::Map(message)))
+        }
+        (input, MessageType::Push) => {
+            let (input, message) = push::parse(input)?;
+            Ok((input, Message::Push(message)))
+        }
     }
 }
 
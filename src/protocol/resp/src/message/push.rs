@@ -0,0 +1,75 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use protocol_common::Compose;
+
+/// A RESP3 push frame, which the server sends to a client outside of the
+/// responses to its requests, such as to invalidate keys the client tracks.
+/// It is encoded as an array which is prefixed with `>` instead of `*`.
+#[derive(Debug, PartialEq, Eq)]
+pub struct Push {
+    pub(crate) inner: Vec<Message>,
+}
+
+impl Push {
+    /// Get the number of items in the push frame.
+    pub fn len(&self) -> usize {
+        self.inner.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.inner.is_empty()
+    }
+}
+
+impl Compose for Push {
+    fn compose(&self, session: &mut dyn BufMut) -> usize {
+        let digits = Digits::new(self.inner.len() as u64);
+        session.put_u8(b'>');
+        session.put_slice(digits.as_bytes());
+        session.put_slice(b"\r\n");
+        let mut len = digits.len() + 3;
+        for value in &self.inner {
+            len += value.compose(session);
+        }
+        len
+    }
+}
+
+pub fn parse(input: &[u8]) -> IResult<&[u8], Push> {
+    let (input, len) = digit1(input)?;
+    let len = unsafe { std::str::from_utf8_unchecked(len).to_owned() };
+    let len = len
+        .parse::<usize>()
+        .map_err(|_| Err::Failure(nom::error::Error::new(input, nom::error::ErrorKind::Tag)))?;
+    let (mut input, _) = crlf(input)?;
+    let mut values = Vec::new();
+    for _ in 0..len {
+        let (i, value) = message(input)?;
+        values.push(value);
+        input = i;
+    }
+    Ok((input, Push { inner: values }))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn invalidate() {
+        let push = Message::invalidate(&[b"coffee".as_slice()]);
+        let mut buf = Vec::new();
+        let len = push.compose(&mut buf);
+        assert_eq!(len, buf.len());
+        assert_eq!(buf, b">2\r\n$10\r\ninvalidate\r\n*1\r\n$6\r\ncoffee\r\n");
+        assert_eq!(message(&buf), Ok((&b""[..], push)));
+
+        // invalidating every key sends a null in place of the keys
+        let mut buf = Vec::new();
+        Message::invalidate(&[]).compose(&mut buf);
+        assert_eq!(buf, b">2\r\n$10\r\ninvalidate\r\n$-1\r\n");
+    }
+}
@@ -70,6 +70,13 @@ impl<'a> Parser<'a> {
     }
 
     fn parse_len(&mut self) -> ParseResult<'a, usize> {
+        // lengths are almost always a few digits, which are decoded in the
+        // same pass that finds the CRLF
+        if let Some((len, consumed)) = decimal_line(self.data) {
+            self.data = &self.data[consumed..];
+            return Ok(len);
+        }
+
         self.try_parse(|p| {
             let text = p.parse_delimited_text()?;
             let text = std::str::from_utf8(text).map_err(|_| ParseError::invalid_number(text))?;
@@ -357,6 +364,24 @@ impl<'a, 'p> ArrayParser<'a, 'p> {
     }
 }
 
+/// Decodes a line made up only of digits and terminated by CRLF, returning the
+/// value and the number of bytes consumed including the CRLF. Returns `None`
+/// for anything else, including values which overflow, so that the caller can
+/// fall back to the general parser to produce the appropriate error.
+fn decimal_line(data: &[u8]) -> Option<(usize, usize)> {
+    let mut value: usize = 0;
+    for (i, byte) in data.iter().enumerate() {
+        match byte {
+            b'0'..=b'9' => {
+                value = value.checked_mul(10)?.checked_add((byte - b'0') as usize)?;
+            }
+            b'\r' if i > 0 && data.get(i + 1) == Some(&b'\n') => return Some((value, i + 2)),
+            _ => return None,
+        }
+    }
+    None
+}
+
 #[cfg(test)]
 mod tests {
     use bstr::BStr;
@@ -430,6 +455,26 @@ mod tests {
         Err(ParseError::InvalidNumber(Cow::Borrowed(b"aaa")))
     );
 
+    parse_test!(
+        bulk_string_long_len,
+        parse_bulk_string("$12\r\nTEST\r\nTEST\r\n\r\n"),
+        Ok(Some(b"TEST\r\nTEST\r\n"))
+    );
+
+    parse_test!(
+        bulk_string_overflow_len,
+        parse_bulk_string("$99999999999999999999\r\nTEST\r\n"),
+        Err(ParseError::InvalidNumber(Cow::Borrowed(
+            b"99999999999999999999"
+        )))
+    );
+
+    parse_test!(
+        bulk_string_len_incomplete,
+        parse_bulk_string("$12"),
+        Err(ParseError::Incomplete)
+    );
+
     parse_test!(
         bulk_string_invalid_nil,
         parse_bulk_string("$-2\r\n"),
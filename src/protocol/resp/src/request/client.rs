@@ -0,0 +1,114 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+
+#[metric(name = "client_tracking")]
+pub static CLIENT_TRACKING: Counter = Counter::new();
+
+#[metric(name = "client_tracking_ex")]
+pub static CLIENT_TRACKING_EX: Counter = Counter::new();
+
+/// Turns tracking of the keys read by the session on or off, with `CLIENT
+/// TRACKING ON|OFF`. While tracking is on, the session is sent an invalidation
+/// push frame once a key it has read is written, so that a client can serve
+/// reads from its own cache. Only the default mode is supported, so none of
+/// the options to redirect, broadcast, or opt in or out are accepted.
+#[derive(Debug, PartialEq, Eq)]
+pub struct ClientTracking {
+    enabled: bool,
+}
+
+impl TryFrom<Message> for ClientTracking {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() < 2 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let subcommand = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+        if !subcommand.eq_ignore_ascii_case(b"tracking") {
+            return Err(Error::new(ErrorKind::Other, "unknown subcommand"));
+        }
+
+        if array.len() > 1 {
+            return Err(Error::new(ErrorKind::Other, "unsupported option"));
+        }
+
+        let enabled = match take_bulk_string(&mut array)? {
+            Some(mode) if mode.eq_ignore_ascii_case(b"on") => true,
+            Some(mode) if mode.eq_ignore_ascii_case(b"off") => false,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        Ok(Self { enabled })
+    }
+}
+
+impl ClientTracking {
+    pub fn new(enabled: bool) -> Self {
+        Self { enabled }
+    }
+
+    pub fn enabled(&self) -> bool {
+        self.enabled
+    }
+}
+
+impl From<&ClientTracking> for Message {
+    fn from(value: &ClientTracking) -> Self {
+        let mode: &[u8] = if value.enabled() { b"ON" } else { b"OFF" };
+        Message::Array(Array {
+            inner: Some(vec![
+                Message::BulkString(BulkString::new(b"CLIENT")),
+                Message::BulkString(BulkString::new(b"TRACKING")),
+                Message::BulkString(BulkString::new(mode)),
+            ]),
+        })
+    }
+}
+
+impl Compose for ClientTracking {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser
+                .parse(b"client tracking on\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::ClientTracking(ClientTracking::new(true))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*3\r\n$6\r\nCLIENT\r\n$8\r\nTRACKING\r\n$3\r\nOFF\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::ClientTracking(ClientTracking::new(false))
+        );
+
+        assert!(parser.parse(b"client tracking on bcast\r\n").is_err());
+        assert!(parser.parse(b"client list\r\n").is_err());
+    }
+}
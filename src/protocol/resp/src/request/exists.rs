@@ -0,0 +1,105 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "exists")]
+pub static EXISTS: Counter = Counter::new();
+
+#[metric(name = "exists_ex")]
+pub static EXISTS_EX: Counter = Counter::new();
+
+/// Counts how many of the keys exist. A key which is repeated is counted each
+/// time it appears.
+#[derive(Debug, PartialEq, Eq)]
+pub struct Exists {
+    keys: Box<[Arc<[u8]>]>,
+}
+
+impl TryFrom<Message> for Exists {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() < 2 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+
+        let mut keys = Vec::with_capacity(array.len());
+        while let Some(key) = take_bulk_string(&mut array)? {
+            if key.is_empty() {
+                return Err(Error::new(ErrorKind::Other, "malformed command"));
+            }
+            keys.push(key);
+        }
+
+        Ok(Self {
+            keys: keys.into_boxed_slice(),
+        })
+    }
+}
+
+impl Exists {
+    pub fn new(keys: &[&[u8]]) -> Self {
+        Self {
+            keys: keys.iter().copied().map(From::from).collect(),
+        }
+    }
+
+    pub fn keys(&self) -> &[Arc<[u8]>] {
+        &self.keys
+    }
+}
+
+impl From<&Exists> for Message {
+    fn from(other: &Exists) -> Message {
+        let mut data = Vec::with_capacity(other.keys.len() + 1);
+        data.push(Message::bulk_string(b"EXISTS"));
+        data.extend(
+            other
+                .keys
+                .iter()
+                .map(|key| Message::BulkString(BulkString::from(key.clone()))),
+        );
+
+        Message::Array(Array { inner: Some(data) })
+    }
+}
+
+impl Compose for Exists {
+    fn compose(&self, buf: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(buf)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"exists a b a\r\n").unwrap().into_inner(),
+            Request::Exists(Exists::new(&[b"a", b"b", b"a"]))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*2\r\n$6\r\nEXISTS\r\n$1\r\na\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::Exists(Exists::new(&[b"a"]))
+        );
+    }
+}
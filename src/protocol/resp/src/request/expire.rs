@@ -0,0 +1,109 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "expire")]
+pub static EXPIRE: Counter = Counter::new();
+
+#[metric(name = "expire_ex")]
+pub static EXPIRE_EX: Counter = Counter::new();
+
+/// Sets the time in seconds until a key expires. A key with a TTL which is not
+/// positive is removed.
+#[derive(Debug, PartialEq, Eq)]
+pub struct Expire {
+    key: Arc<[u8]>,
+    seconds: i64,
+}
+
+impl TryFrom<Message> for Expire {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() != 3 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let key = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        if key.is_empty() {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let seconds = take_bulk_string_as_i64(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        Ok(Self { key, seconds })
+    }
+}
+
+impl Expire {
+    pub fn new(key: &[u8], seconds: i64) -> Self {
+        Self {
+            key: key.into(),
+            seconds,
+        }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+
+    pub fn seconds(&self) -> i64 {
+        self.seconds
+    }
+}
+
+impl From<&Expire> for Message {
+    fn from(value: &Expire) -> Self {
+        Message::Array(Array {
+            inner: Some(vec![
+                Message::BulkString(BulkString::new(b"EXPIRE")),
+                Message::BulkString(BulkString::new(value.key())),
+                Message::BulkString(BulkString::new(value.seconds().to_string().as_bytes())),
+            ]),
+        })
+    }
+}
+
+impl Compose for Expire {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"expire a 60\r\n").unwrap().into_inner(),
+            Request::Expire(Expire::new(b"a", 60))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*3\r\n$6\r\nEXPIRE\r\n$1\r\na\r\n$2\r\n-1\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::Expire(Expire::new(b"a", -1))
+        );
+
+        assert!(parser.parse(b"expire a\r\n").is_err());
+    }
+}
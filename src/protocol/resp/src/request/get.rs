@@ -88,7 +88,13 @@ impl Klog for Get {
             _ => (ResponseCode::Miss, 0),
         };
 
-        klog!("\"get {}\" {} {}", string_key(self.key()), code as u32, len);
+        klog_key!(
+            self.key(),
+            "\"get {}\" {} {}",
+            string_key(self.key()),
+            code as u32,
+            len
+        );
     }
 }
 #[cfg(test)]
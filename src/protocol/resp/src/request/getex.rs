@@ -0,0 +1,184 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use logger::klog;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "getex")]
+pub static GETEX: Counter = Counter::new();
+
+#[metric(name = "getex_ex")]
+pub static GETEX_EX: Counter = Counter::new();
+
+/// Gets the value of a key and sets or removes its expiry. Without any option
+/// the expiry of the key is left unchanged.
+#[derive(Debug, PartialEq, Eq)]
+pub struct GetEx {
+    key: Arc<[u8]>,
+    expire_time: Option<ExpireTime>,
+    persist: bool,
+}
+
+impl TryFrom<Message> for GetEx {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() < 2 || array.len() > 4 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let key = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        if key.is_empty() {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let mut expire_time = None;
+        let mut persist = false;
+
+        // at most one option may be provided
+        if let Some(token) = take_bulk_string_as_utf8(&mut array)? {
+            if token == "PERSIST" {
+                persist = true;
+            } else {
+                let n = take_bulk_string_as_u64(&mut array)?
+                    .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+                expire_time = Some(match token.as_str() {
+                    "EX" => ExpireTime::Seconds(n),
+                    "PX" => ExpireTime::Milliseconds(n),
+                    "EXAT" => ExpireTime::UnixSeconds(n),
+                    "PXAT" => ExpireTime::UnixMilliseconds(n),
+                    _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+                });
+            }
+        }
+
+        if !array.is_empty() {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        Ok(Self {
+            key,
+            expire_time,
+            persist,
+        })
+    }
+}
+
+impl GetEx {
+    pub fn new(key: &[u8], expire_time: Option<ExpireTime>, persist: bool) -> Self {
+        Self {
+            key: key.into(),
+            expire_time,
+            persist,
+        }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+
+    /// The new expiry of the key, if it is to be changed.
+    pub fn expire_time(&self) -> Option<ExpireTime> {
+        self.expire_time
+    }
+
+    /// Whether the expiry of the key is to be removed.
+    pub fn persist(&self) -> bool {
+        self.persist
+    }
+}
+
+impl From<&GetEx> for Message {
+    fn from(other: &GetEx) -> Message {
+        let mut v = vec![
+            Message::bulk_string(b"GETEX"),
+            Message::BulkString(BulkString::from(other.key.clone())),
+        ];
+
+        let option = match other.expire_time {
+            Some(ExpireTime::Seconds(s)) => Some(("EX", s)),
+            Some(ExpireTime::Milliseconds(ms)) => Some(("PX", ms)),
+            Some(ExpireTime::UnixSeconds(s)) => Some(("EXAT", s)),
+            Some(ExpireTime::UnixMilliseconds(ms)) => Some(("PXAT", ms)),
+            Some(ExpireTime::KeepTtl) | None => None,
+        };
+
+        if let Some((token, n)) = option {
+            v.push(Message::bulk_string(token.as_bytes()));
+            v.push(Message::bulk_string(format!("{n}").as_bytes()));
+        } else if other.persist {
+            v.push(Message::bulk_string(b"PERSIST"));
+        }
+
+        Message::Array(Array { inner: Some(v) })
+    }
+}
+
+impl Compose for GetEx {
+    fn compose(&self, buf: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(buf)
+    }
+}
+
+impl Klog for GetEx {
+    type Response = Response;
+
+    fn klog(&self, response: &Self::Response) {
+        let (code, len) = match response {
+            Message::BulkString(_) if *response == Response::null() => (ResponseCode::Miss, 0),
+            Message::BulkString(s) => (ResponseCode::Hit, s.len()),
+            _ => (ResponseCode::Miss, 0),
+        };
+
+        klog_key!(
+            self.key(),
+            "\"get {}\" {} {}",
+            string_key(self.key()),
+            code as u32,
+            len
+        );
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"getex a\r\n").unwrap().into_inner(),
+            Request::GetEx(GetEx::new(b"a", None, false))
+        );
+
+        assert_eq!(
+            parser.parse(b"getex a EX 60\r\n").unwrap().into_inner(),
+            Request::GetEx(GetEx::new(b"a", Some(ExpireTime::Seconds(60)), false))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*3\r\n$5\r\nGETEX\r\n$1\r\na\r\n$7\r\nPERSIST\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::GetEx(GetEx::new(b"a", None, true))
+        );
+
+        assert!(parser.parse(b"getex a EX\r\n").is_err());
+        assert!(parser.parse(b"getex a PERSIST EX 1\r\n").is_err());
+    }
+}
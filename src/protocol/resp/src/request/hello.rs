@@ -0,0 +1,94 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+
+#[metric(name = "hello")]
+pub static HELLO: Counter = Counter::new();
+
+#[metric(name = "hello_ex")]
+pub static HELLO_EX: Counter = Counter::new();
+
+/// Negotiates the version of the protocol, with `HELLO [protover]`. Clients
+/// which want push frames, such as to track keys, switch to RESP3 with it.
+/// Authentication and naming the connection are not supported.
+#[derive(Debug, PartialEq, Eq)]
+pub struct Hello {
+    protover: Option<u64>,
+}
+
+impl TryFrom<Message> for Hello {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() > 2 {
+            return Err(Error::new(ErrorKind::Other, "unsupported option"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let protover = take_bulk_string_as_u64(&mut array)?;
+
+        Ok(Self { protover })
+    }
+}
+
+impl Hello {
+    pub fn new(protover: Option<u64>) -> Self {
+        Self { protover }
+    }
+
+    /// The version of the protocol the client asked for, if any.
+    pub fn protover(&self) -> Option<u64> {
+        self.protover
+    }
+}
+
+impl From<&Hello> for Message {
+    fn from(value: &Hello) -> Self {
+        let mut inner = vec![Message::BulkString(BulkString::new(b"HELLO"))];
+        if let Some(protover) = value.protover() {
+            inner.push(Message::BulkString(BulkString::new(
+                protover.to_string().as_bytes(),
+            )));
+        }
+        Message::Array(Array { inner: Some(inner) })
+    }
+}
+
+impl Compose for Hello {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"hello\r\n").unwrap().into_inner(),
+            Request::Hello(Hello::new(None))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*2\r\n$5\r\nHELLO\r\n$1\r\n3\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::Hello(Hello::new(Some(3)))
+        );
+
+        assert!(parser.parse(b"hello 3 setname pelikan\r\n").is_err());
+    }
+}
@@ -0,0 +1,173 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "incrby")]
+pub static INCRBY: Counter = Counter::new();
+
+#[metric(name = "incrby_ex")]
+pub static INCRBY_EX: Counter = Counter::new();
+
+#[metric(name = "decrby")]
+pub static DECRBY: Counter = Counter::new();
+
+#[metric(name = "decrby_ex")]
+pub static DECRBY_EX: Counter = Counter::new();
+
+/// Adds to the integer stored at a key, which is treated as zero if the key
+/// does not exist.
+#[derive(Debug, PartialEq, Eq)]
+pub struct IncrBy {
+    key: Arc<[u8]>,
+    increment: i64,
+}
+
+/// Subtracts from the integer stored at a key, which is treated as zero if the
+/// key does not exist.
+#[derive(Debug, PartialEq, Eq)]
+pub struct DecrBy {
+    key: Arc<[u8]>,
+    decrement: i64,
+}
+
+/// Parses the key and integer argument of `INCRBY` and `DECRBY`.
+fn parse_arithmetic(other: Message) -> Result<(Arc<[u8]>, i64), Error> {
+    let array = match other {
+        Message::Array(array) => array,
+        _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+    };
+
+    let mut array = array.inner.unwrap();
+    if array.len() != 3 {
+        return Err(Error::new(ErrorKind::Other, "malformed command"));
+    }
+
+    let _command = take_bulk_string(&mut array)?;
+    let key = take_bulk_string(&mut array)?
+        .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+    if key.is_empty() {
+        return Err(Error::new(ErrorKind::Other, "malformed command"));
+    }
+
+    let value = take_bulk_string_as_i64(&mut array)?
+        .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+    Ok((key, value))
+}
+
+impl TryFrom<Message> for IncrBy {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let (key, increment) = parse_arithmetic(other)?;
+        Ok(Self { key, increment })
+    }
+}
+
+impl TryFrom<Message> for DecrBy {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let (key, decrement) = parse_arithmetic(other)?;
+        Ok(Self { key, decrement })
+    }
+}
+
+impl IncrBy {
+    pub fn new(key: &[u8], increment: i64) -> Self {
+        Self {
+            key: key.into(),
+            increment,
+        }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+
+    pub fn increment(&self) -> i64 {
+        self.increment
+    }
+}
+
+impl DecrBy {
+    pub fn new(key: &[u8], decrement: i64) -> Self {
+        Self {
+            key: key.into(),
+            decrement,
+        }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+
+    pub fn decrement(&self) -> i64 {
+        self.decrement
+    }
+}
+
+impl From<&IncrBy> for Message {
+    fn from(value: &IncrBy) -> Self {
+        Message::Array(Array {
+            inner: Some(vec![
+                Message::BulkString(BulkString::new(b"INCRBY")),
+                Message::BulkString(BulkString::new(value.key())),
+                Message::BulkString(BulkString::new(value.increment().to_string().as_bytes())),
+            ]),
+        })
+    }
+}
+
+impl From<&DecrBy> for Message {
+    fn from(value: &DecrBy) -> Self {
+        Message::Array(Array {
+            inner: Some(vec![
+                Message::BulkString(BulkString::new(b"DECRBY")),
+                Message::BulkString(BulkString::new(value.key())),
+                Message::BulkString(BulkString::new(value.decrement().to_string().as_bytes())),
+            ]),
+        })
+    }
+}
+
+impl Compose for IncrBy {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+impl Compose for DecrBy {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"incrby a 10\r\n").unwrap().into_inner(),
+            Request::IncrBy(IncrBy::new(b"a", 10))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*3\r\n$6\r\ndecrby\r\n$1\r\na\r\n$2\r\n-5\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::DecrBy(DecrBy::new(b"a", -5))
+        );
+
+        assert!(parser.parse(b"incrby a b\r\n").is_err());
+    }
+}
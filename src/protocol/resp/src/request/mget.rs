@@ -0,0 +1,130 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use logger::klog;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "mget")]
+pub static MGET: Counter = Counter::new();
+
+#[metric(name = "mget_ex")]
+pub static MGET_EX: Counter = Counter::new();
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct MultiGet {
+    keys: Box<[Arc<[u8]>]>,
+}
+
+impl TryFrom<Message> for MultiGet {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() < 2 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+
+        let mut keys = Vec::with_capacity(array.len());
+        while let Some(key) = take_bulk_string(&mut array)? {
+            if key.is_empty() {
+                return Err(Error::new(ErrorKind::Other, "malformed command"));
+            }
+            keys.push(key);
+        }
+
+        Ok(Self {
+            keys: keys.into_boxed_slice(),
+        })
+    }
+}
+
+impl MultiGet {
+    pub fn new(keys: &[&[u8]]) -> Self {
+        Self {
+            keys: keys.iter().copied().map(From::from).collect(),
+        }
+    }
+
+    pub fn keys(&self) -> &[Arc<[u8]>] {
+        &self.keys
+    }
+}
+
+impl From<&MultiGet> for Message {
+    fn from(other: &MultiGet) -> Message {
+        let mut data = Vec::with_capacity(other.keys.len() + 1);
+        data.push(Message::bulk_string(b"MGET"));
+        data.extend(
+            other
+                .keys
+                .iter()
+                .map(|key| Message::BulkString(BulkString::from(key.clone()))),
+        );
+
+        Message::Array(Array { inner: Some(data) })
+    }
+}
+
+impl Compose for MultiGet {
+    fn compose(&self, buf: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(buf)
+    }
+}
+
+impl Klog for MultiGet {
+    type Response = Response;
+
+    fn klog(&self, response: &Self::Response) {
+        // each key is logged as its own get, which matches how the keys of a
+        // multi-key memcache get are logged
+        let values = match response {
+            Message::Array(Array {
+                inner: Some(values),
+            }) if values.len() == self.keys.len() => values,
+            _ => return,
+        };
+
+        for (key, value) in self.keys.iter().zip(values.iter()) {
+            let (code, len) = match value {
+                Message::BulkString(BulkString { inner: Some(v) }) => (ResponseCode::Hit, v.len()),
+                _ => (ResponseCode::Miss, 0),
+            };
+
+            klog_key!(key, "\"get {}\" {} {}", string_key(key), code as u32, len);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"mget a b c\r\n").unwrap().into_inner(),
+            Request::MultiGet(MultiGet::new(&[b"a", b"b", b"c"]))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*3\r\n$4\r\nMGET\r\n$1\r\na\r\n$1\r\nb\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::MultiGet(MultiGet::new(&[b"a", b"b"]))
+        );
+
+        assert!(parser.parse(b"mget\r\n").is_err());
+    }
+}
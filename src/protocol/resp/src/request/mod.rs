@@ -2,6 +2,7 @@
 // Licensed under the Apache License, Version 2.0
 // http://www.apache.org/licenses/LICENSE-2.0
 
+use crate::latency::*;
 use crate::message::*;
 use crate::*;
 use logger::Klog;
@@ -14,9 +15,14 @@ use std::io::{Error, ErrorKind};
 use std::sync::Arc;
 
 mod badd;
+mod client;
 mod del;
+mod exists;
+mod expire;
 mod get;
+mod getex;
 mod hdel;
+mod hello;
 mod hexists;
 mod hget;
 mod hgetall;
@@ -26,15 +32,19 @@ mod hlen;
 mod hmget;
 mod hset;
 mod hvals;
+mod incrby;
 mod lindex;
 mod llen;
 mod lpop;
 mod lpush;
 mod lrange;
 mod ltrim;
+mod mget;
+mod mset;
 mod rpop;
 mod rpush;
 mod sadd;
+mod scan;
 mod sdiff;
 mod set;
 mod sinter;
@@ -42,6 +52,13 @@ mod sismember;
 mod smembers;
 mod srem;
 mod sunion;
+mod ttl;
+mod zadd;
+mod zincrby;
+mod zrange;
+mod zrangebyscore;
+mod zrank;
+mod zrem;
 
 pub use self::lindex::*;
 pub use self::llen::*;
@@ -58,9 +75,14 @@ pub use self::smembers::*;
 pub use self::srem::*;
 pub use self::sunion::*;
 pub use badd::*;
+pub use client::*;
 pub use del::*;
+pub use exists::*;
+pub use expire::*;
 pub use get::*;
+pub use getex::*;
 pub use hdel::*;
+pub use hello::*;
 pub use hexists::*;
 pub use hget::*;
 pub use hgetall::*;
@@ -70,8 +92,19 @@ pub use hlen::*;
 pub use hmget::*;
 pub use hset::*;
 pub use hvals::*;
+pub use incrby::*;
+pub use mget::*;
+pub use mset::*;
 pub use sadd::*;
+pub use scan::*;
 pub use set::*;
+pub use ttl::*;
+pub use zadd::*;
+pub use zincrby::*;
+pub use zrange::*;
+pub use zrangebyscore::*;
+pub use zrank::*;
+pub use zrem::*;
 
 /// response codes for klog
 /// matches Memcache protocol response codes for compatibility with existing tools
@@ -167,9 +200,15 @@ macro_rules! decl_request {
 decl_request! {
     pub enum Request {
         BtreeAdd(BtreeAdd) => "badd",
+        ClientTracking(ClientTracking) => "client",
+        DecrBy(DecrBy) => "decrby",
         Del(Del) => "del",
+        Exists(Exists) => "exists",
+        Expire(Expire) => "expire",
         Get(Get) => "get",
+        GetEx(GetEx) => "getex",
         HashDelete(HashDelete) => "hdel",
+        Hello(Hello) => "hello",
         HashExists(HashExists) => "hexists",
         HashGet(HashGet) => "hget",
         HashGetAll(HashGetAll) => "hgetall",
@@ -179,6 +218,7 @@ decl_request! {
         HashSet(HashSet) => "hset",
         HashValues(HashValues) => "hvals",
         HashIncrBy(HashIncrBy) => "hincrby",
+        IncrBy(IncrBy) => "incrby",
         ListIndex(ListIndex) => "lindex",
         ListLen(ListLen) => "llen",
         ListPop(ListPop) => "lpop",
@@ -187,6 +227,9 @@ decl_request! {
         ListPush(ListPush) => "lpush",
         ListPushBack(ListPushBack) => "rpush",
         ListTrim(ListTrim) => "ltrim",
+        MultiGet(MultiGet) => "mget",
+        MultiSet(MultiSet) => "mset",
+        Scan(Scan) => "scan",
         Set(Set) => "set",
         SetAdd(SetAdd) => "sadd",
         SetRem(SetRem) => "srem",
@@ -195,6 +238,13 @@ decl_request! {
         SetIntersect(SetIntersect) => "sinter",
         SetMembers(SetMembers) => "smembers",
         SetIsMember(SetIsMember) => "sismember",
+        SortedSetAdd(SortedSetAdd) => "zadd",
+        SortedSetIncrBy(SortedSetIncrBy) => "zincrby",
+        SortedSetRange(SortedSetRange) => "zrange",
+        SortedSetRangeByScore(SortedSetRangeByScore) => "zrangebyscore",
+        SortedSetRank(SortedSetRank) => "zrank",
+        SortedSetRem(SortedSetRem) => "zrem",
+        Ttl(Ttl) => "ttl",
     }
 }
 
@@ -213,21 +263,181 @@ impl Klog for Request {
     fn klog(&self, response: &Self::Response) {
         match self {
             Request::Get(r) => r.klog(response),
+            Request::GetEx(r) => r.klog(response),
+            Request::MultiGet(r) => r.klog(response),
             Request::Set(r) => r.klog(response),
             _ => (),
         }
     }
 }
 
+impl Timed for Request {
+    fn latencies(&self) -> &'static Latencies {
+        match self {
+            Self::BtreeAdd(_) => &BADD_LATENCIES,
+            Self::ClientTracking(_) => &CLIENT_LATENCIES,
+            Self::DecrBy(_) => &DECRBY_LATENCIES,
+            Self::Del(_) => &DEL_LATENCIES,
+            Self::Exists(_) => &EXISTS_LATENCIES,
+            Self::Expire(_) => &EXPIRE_LATENCIES,
+            Self::Get(_) => &GET_LATENCIES,
+            Self::GetEx(_) => &GETEX_LATENCIES,
+            Self::HashDelete(_) => &HDEL_LATENCIES,
+            Self::Hello(_) => &HELLO_LATENCIES,
+            Self::HashExists(_) => &HEXISTS_LATENCIES,
+            Self::HashGet(_) => &HGET_LATENCIES,
+            Self::HashGetAll(_) => &HGETALL_LATENCIES,
+            Self::HashKeys(_) => &HKEYS_LATENCIES,
+            Self::HashLength(_) => &HLEN_LATENCIES,
+            Self::HashMultiGet(_) => &HMGET_LATENCIES,
+            Self::HashSet(_) => &HSET_LATENCIES,
+            Self::HashValues(_) => &HVALS_LATENCIES,
+            Self::HashIncrBy(_) => &HINCRBY_LATENCIES,
+            Self::IncrBy(_) => &INCRBY_LATENCIES,
+            Self::ListIndex(_) => &LINDEX_LATENCIES,
+            Self::ListLen(_) => &LLEN_LATENCIES,
+            Self::ListPop(_) => &LPOP_LATENCIES,
+            Self::ListPopBack(_) => &RPOP_LATENCIES,
+            Self::ListRange(_) => &LRANGE_LATENCIES,
+            Self::ListPush(_) => &LPUSH_LATENCIES,
+            Self::ListPushBack(_) => &RPUSH_LATENCIES,
+            Self::ListTrim(_) => &LTRIM_LATENCIES,
+            Self::MultiGet(_) => &MGET_LATENCIES,
+            Self::MultiSet(_) => &MSET_LATENCIES,
+            Self::Scan(_) => &SCAN_LATENCIES,
+            Self::Set(_) => &SET_LATENCIES,
+            Self::SetAdd(_) => &SADD_LATENCIES,
+            Self::SetRem(_) => &SREM_LATENCIES,
+            Self::SetDiff(_) => &SDIFF_LATENCIES,
+            Self::SetUnion(_) => &SUNION_LATENCIES,
+            Self::SetIntersect(_) => &SINTER_LATENCIES,
+            Self::SetMembers(_) => &SMEMBERS_LATENCIES,
+            Self::SetIsMember(_) => &SISMEMBER_LATENCIES,
+            Self::SortedSetAdd(_) => &ZADD_LATENCIES,
+            Self::SortedSetIncrBy(_) => &ZINCRBY_LATENCIES,
+            Self::SortedSetRange(_) => &ZRANGE_LATENCIES,
+            Self::SortedSetRangeByScore(_) => &ZRANGEBYSCORE_LATENCIES,
+            Self::SortedSetRank(_) => &ZRANK_LATENCIES,
+            Self::SortedSetRem(_) => &ZREM_LATENCIES,
+            Self::Ttl(_) => &TTL_LATENCIES,
+        }
+    }
+}
+
+// Servers for this protocol execute every request on a single storage thread,
+// so requests are never routed between shards.
+impl Shard<Response> for Request {}
+
+// Replication is only implemented for the memcache protocol.
+impl Replicate<Response> for Request {}
+
+// Datagrams are only served for the memcache protocol.
+impl Datagram for Request {}
+
+// Every request is answered, as `CLIENT REPLY` is not supported.
+impl Quiet for Request {}
+
+impl Deadline<Response> for Request {
+    fn expired(&self) -> Option<Response> {
+        Some(Response::error("deadline exceeded"))
+    }
+}
+
+impl Track<Response> for Request {
+    fn tracking(&self) -> Option<(bool, Response)> {
+        match self {
+            Self::ClientTracking(r) => Some((r.enabled(), Response::simple_string("OK"))),
+            _ => None,
+        }
+    }
+
+    fn reads(&self, f: &mut dyn FnMut(&[u8])) {
+        match self {
+            Self::Exists(r) => r.keys().iter().for_each(|key| f(key)),
+            Self::Get(r) => f(r.key()),
+            Self::GetEx(r) => f(r.key()),
+            Self::HashExists(r) => f(r.key()),
+            Self::HashGet(r) => f(r.key()),
+            Self::HashGetAll(r) => f(r.key()),
+            Self::HashKeys(r) => f(r.key()),
+            Self::HashLength(r) => f(r.key()),
+            Self::HashMultiGet(r) => f(r.key()),
+            Self::HashValues(r) => f(r.key()),
+            Self::ListIndex(r) => f(r.key()),
+            Self::ListLen(r) => f(r.key()),
+            Self::ListRange(r) => f(r.key()),
+            Self::MultiGet(r) => r.keys().iter().for_each(|key| f(key)),
+            Self::SetDiff(r) => r.keys().iter().for_each(|key| f(key)),
+            Self::SetIntersect(r) => r.keys().iter().for_each(|key| f(key)),
+            Self::SetIsMember(r) => f(r.key()),
+            Self::SetMembers(r) => f(r.key()),
+            Self::SetUnion(r) => r.keys().iter().for_each(|key| f(key)),
+            Self::SortedSetRange(r) => f(r.key()),
+            Self::SortedSetRangeByScore(r) => f(r.key()),
+            Self::SortedSetRank(r) => f(r.key()),
+            Self::Ttl(r) => f(r.key()),
+            _ => {}
+        }
+    }
+
+    fn writes(&self, f: &mut dyn FnMut(&[u8])) {
+        match self {
+            Self::BtreeAdd(r) => f(r.outer_key()),
+            Self::DecrBy(r) => f(r.key()),
+            Self::Del(r) => r.keys().iter().for_each(|key| f(key)),
+            Self::Expire(r) => f(r.key()),
+            // a getex which changes the expiry changes the key as well
+            Self::GetEx(r) if r.expire_time().is_some() || r.persist() => f(r.key()),
+            Self::HashDelete(r) => f(r.key()),
+            Self::HashIncrBy(r) => f(r.key()),
+            Self::HashSet(r) => f(r.key()),
+            Self::IncrBy(r) => f(r.key()),
+            Self::ListPop(r) => f(r.key()),
+            Self::ListPopBack(r) => f(r.key()),
+            Self::ListPush(r) => f(r.key()),
+            Self::ListPushBack(r) => f(r.key()),
+            Self::ListTrim(r) => f(r.key()),
+            Self::MultiSet(r) => r.data().iter().for_each(|(key, _)| f(key)),
+            Self::Set(r) => f(r.key()),
+            Self::SetAdd(r) => f(r.key()),
+            Self::SetRem(r) => f(r.key()),
+            Self::SortedSetAdd(r) => f(r.key()),
+            Self::SortedSetIncrBy(r) => f(r.key()),
+            Self::SortedSetRem(r) => f(r.key()),
+            _ => {}
+        }
+    }
+
+    fn invalidate(keys: &[&[u8]]) -> Option<Response> {
+        Some(Response::invalidate(keys))
+    }
+}
+
 impl Request {
     pub fn del(keys: &[&[u8]]) -> Self {
         Self::Del(Del::new(keys))
     }
 
+    pub fn exists(keys: &[&[u8]]) -> Self {
+        Self::Exists(Exists::new(keys))
+    }
+
     pub fn get(key: &[u8]) -> Self {
         Self::Get(Get::new(key))
     }
 
+    pub fn multi_get(keys: &[&[u8]]) -> Self {
+        Self::MultiGet(MultiGet::new(keys))
+    }
+
+    pub fn multi_set(data: &[(&[u8], &[u8])]) -> Self {
+        Self::MultiSet(MultiSet::new(data))
+    }
+
+    pub fn scan(cursor: u64, pattern: Option<&[u8]>, count: Option<u64>) -> Self {
+        Self::Scan(Scan::new(cursor, pattern, count))
+    }
+
     pub fn hash_delete(key: &[u8], fields: &[&[u8]]) -> Self {
         Self::HashDelete(HashDelete::new(key, fields))
     }
@@ -0,0 +1,115 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "mset")]
+pub static MSET: Counter = Counter::new();
+
+#[metric(name = "mset_ex")]
+pub static MSET_EX: Counter = Counter::new();
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct MultiSet {
+    data: Box<[(Arc<[u8]>, Arc<[u8]>)]>,
+}
+
+impl TryFrom<Message> for MultiSet {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() < 3 || array.len() % 2 == 0 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+
+        let mut data = Vec::with_capacity(array.len() / 2);
+        while !array.is_empty() {
+            let key = take_bulk_string(&mut array)?
+                .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+            if key.is_empty() {
+                return Err(Error::new(ErrorKind::Other, "malformed command"));
+            }
+
+            let value = take_bulk_string(&mut array)?
+                .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+            data.push((key, value));
+        }
+
+        Ok(Self {
+            data: data.into_boxed_slice(),
+        })
+    }
+}
+
+impl MultiSet {
+    pub fn new(data: &[(&[u8], &[u8])]) -> Self {
+        Self {
+            data: data
+                .iter()
+                .map(|(key, value)| ((*key).into(), (*value).into()))
+                .collect(),
+        }
+    }
+
+    /// The key and value pairs, in the order they are stored.
+    pub fn data(&self) -> &[(Arc<[u8]>, Arc<[u8]>)] {
+        &self.data
+    }
+}
+
+impl From<&MultiSet> for Message {
+    fn from(other: &MultiSet) -> Message {
+        let mut data = Vec::with_capacity(other.data.len() * 2 + 1);
+        data.push(Message::bulk_string(b"MSET"));
+        for (key, value) in other.data.iter() {
+            data.push(Message::BulkString(BulkString::from(key.clone())));
+            data.push(Message::BulkString(BulkString::from(value.clone())));
+        }
+
+        Message::Array(Array { inner: Some(data) })
+    }
+}
+
+impl Compose for MultiSet {
+    fn compose(&self, buf: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(buf)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"mset a 1 b 2\r\n").unwrap().into_inner(),
+            Request::MultiSet(MultiSet::new(&[(b"a", b"1"), (b"b", b"2")]))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*3\r\n$4\r\nMSET\r\n$1\r\na\r\n$0\r\n\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::MultiSet(MultiSet::new(&[(b"a", b"")]))
+        );
+
+        // every key needs a value
+        assert!(parser.parse(b"mset a 1 b\r\n").is_err());
+    }
+}
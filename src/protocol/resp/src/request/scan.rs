@@ -0,0 +1,256 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "scan")]
+pub static SCAN: Counter = Counter::new();
+
+#[metric(name = "scan_ex")]
+pub static SCAN_EX: Counter = Counter::new();
+
+/// Returns some of the keys along with the cursor to continue from, starting
+/// with a cursor of zero, until a cursor of zero is returned. Keys may be
+/// filtered by a glob-style pattern, and the count is a hint of how much work
+/// is done for each step.
+#[derive(Debug, PartialEq, Eq)]
+pub struct Scan {
+    cursor: u64,
+    pattern: Option<Arc<[u8]>>,
+    count: Option<u64>,
+}
+
+impl TryFrom<Message> for Scan {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() < 2 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let cursor = take_bulk_string_as_u64(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        let mut pattern = None;
+        let mut count = None;
+
+        while let Some(token) = take_bulk_string(&mut array)? {
+            if token.eq_ignore_ascii_case(b"MATCH") {
+                pattern = Some(
+                    take_bulk_string(&mut array)?
+                        .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?,
+                );
+            } else if token.eq_ignore_ascii_case(b"COUNT") {
+                let n = take_bulk_string_as_u64(&mut array)?
+                    .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+                if n == 0 {
+                    return Err(Error::new(ErrorKind::Other, "malformed command"));
+                }
+                count = Some(n);
+            } else {
+                return Err(Error::new(ErrorKind::Other, "malformed command"));
+            }
+        }
+
+        Ok(Self {
+            cursor,
+            pattern,
+            count,
+        })
+    }
+}
+
+impl Scan {
+    pub fn new(cursor: u64, pattern: Option<&[u8]>, count: Option<u64>) -> Self {
+        Self {
+            cursor,
+            pattern: pattern.map(|pattern| pattern.into()),
+            count,
+        }
+    }
+
+    pub fn cursor(&self) -> u64 {
+        self.cursor
+    }
+
+    pub fn pattern(&self) -> Option<&[u8]> {
+        self.pattern.as_deref()
+    }
+
+    pub fn count(&self) -> Option<u64> {
+        self.count
+    }
+
+    /// Returns true if the key matches the pattern, or if there is none.
+    pub fn matches(&self, key: &[u8]) -> bool {
+        match &self.pattern {
+            Some(pattern) => glob(pattern, key),
+            None => true,
+        }
+    }
+}
+
+impl From<&Scan> for Message {
+    fn from(value: &Scan) -> Self {
+        let mut v = vec![
+            Message::bulk_string(b"SCAN"),
+            Message::bulk_string(value.cursor().to_string().as_bytes()),
+        ];
+
+        if let Some(pattern) = value.pattern() {
+            v.push(Message::bulk_string(b"MATCH"));
+            v.push(Message::bulk_string(pattern));
+        }
+
+        if let Some(count) = value.count() {
+            v.push(Message::bulk_string(b"COUNT"));
+            v.push(Message::bulk_string(count.to_string().as_bytes()));
+        }
+
+        Message::Array(Array { inner: Some(v) })
+    }
+}
+
+impl Compose for Scan {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+/// Matches a glob-style pattern as used by Redis, where `*` matches any bytes,
+/// `?` matches a single byte, `[...]` matches one of a set of bytes or ranges,
+/// negated by a leading `^`, and `\` escapes the byte which follows.
+fn glob(pattern: &[u8], key: &[u8]) -> bool {
+    let (mut p, mut k) = (0, 0);
+    // where to resume after the most recent `*`, which only has to be retried
+    // with one more byte consumed each time
+    let mut star: Option<(usize, usize)> = None;
+
+    while k < key.len() {
+        let matched = match pattern.get(p) {
+            Some(b'*') => {
+                star = Some((p, k));
+                p += 1;
+                continue;
+            }
+            Some(b'?') => Some(p + 1),
+            Some(b'[') => class(pattern, p, key[k]),
+            Some(b'\\') if p + 1 < pattern.len() => (pattern[p + 1] == key[k]).then_some(p + 2),
+            Some(byte) => (*byte == key[k]).then_some(p + 1),
+            None => None,
+        };
+
+        match (matched, star) {
+            (Some(next), _) => {
+                p = next;
+                k += 1;
+            }
+            (None, Some((star_p, star_k))) => {
+                star = Some((star_p, star_k + 1));
+                p = star_p + 1;
+                k = star_k + 1;
+            }
+            (None, None) => return false,
+        }
+    }
+
+    pattern[p..].iter().all(|byte| *byte == b'*')
+}
+
+/// Matches the byte against the class which starts at the `[` at `start`,
+/// returning the position which follows the class if it matches.
+fn class(pattern: &[u8], start: usize, byte: u8) -> Option<usize> {
+    let mut p = start + 1;
+    let negate = pattern.get(p) == Some(&b'^');
+    if negate {
+        p += 1;
+    }
+
+    let mut matched = false;
+    while p < pattern.len() && pattern[p] != b']' {
+        let mut low = pattern[p];
+        if low == b'\\' && p + 1 < pattern.len() {
+            p += 1;
+            low = pattern[p];
+        }
+
+        if p + 2 < pattern.len() && pattern[p + 1] == b'-' && pattern[p + 2] != b']' {
+            let high = pattern[p + 2];
+            let (low, high) = if low <= high {
+                (low, high)
+            } else {
+                (high, low)
+            };
+            matched |= low <= byte && byte <= high;
+            p += 3;
+        } else {
+            matched |= low == byte;
+            p += 1;
+        }
+    }
+
+    // an unterminated class runs to the end of the pattern
+    (matched != negate).then_some((p + 1).min(pattern.len()))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"scan 0\r\n").unwrap().into_inner(),
+            Request::Scan(Scan::new(0, None, None))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"scan 17 match user:* count 100\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::Scan(Scan::new(17, Some(b"user:*"), Some(100)))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*4\r\n$4\r\nSCAN\r\n$1\r\n0\r\n$5\r\nCOUNT\r\n$2\r\n10\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::Scan(Scan::new(0, None, Some(10)))
+        );
+
+        assert!(parser.parse(b"scan 0 count 0\r\n").is_err());
+        assert!(parser.parse(b"scan 0 match\r\n").is_err());
+        assert!(parser.parse(b"scan 0 type string\r\n").is_err());
+    }
+
+    #[test]
+    fn pattern() {
+        assert!(glob(b"*", b""));
+        assert!(glob(b"*", b"coffee"));
+        assert!(glob(b"co*ee", b"coffee"));
+        assert!(glob(b"c?ffee", b"coffee"));
+        assert!(!glob(b"c?ffee", b"cffee"));
+        assert!(glob(b"*e*e", b"coffee"));
+        assert!(!glob(b"*e*e*x", b"coffee"));
+        assert!(glob(b"[bc]offee", b"coffee"));
+        assert!(!glob(b"[^bc]offee", b"coffee"));
+        assert!(glob(b"[a-d]offee", b"coffee"));
+        assert!(!glob(b"[d-z]offee", b"coffee"));
+        assert!(glob(b"\\*", b"*"));
+        assert!(!glob(b"\\*", b"coffee"));
+        assert!(!glob(b"coffee", b"coffees"));
+    }
+}
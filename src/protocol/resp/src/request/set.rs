@@ -260,7 +260,8 @@ impl Klog for Set {
             _ => (ResponseCode::NotStored, 0),
         };
 
-        klog!(
+        klog_key!(
+            self.key(),
             "\"set {} {} {} {}\" {} {}",
             string_key(self.key()),
             FLAG,
@@ -29,7 +29,7 @@ impl TryFrom<Message> for SetRem {
         };
 
         let mut array = array.inner.unwrap();
-        if array.len() != 3 {
+        if array.len() < 3 {
             return Err(Error::new(ErrorKind::Other, "malformed command"));
         }
 
@@ -107,5 +107,10 @@ mod tests {
                 .into_inner(),
             Request::SetRem(SetRem::new(b"test", &[b"member"]))
         );
+
+        assert_eq!(
+            parser.parse(b"srem test a b\r\n").unwrap().into_inner(),
+            Request::SetRem(SetRem::new(b"test", &[b"a", b"b"]))
+        );
     }
 }
@@ -0,0 +1,95 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "ttl")]
+pub static TTL: Counter = Counter::new();
+
+#[metric(name = "ttl_ex")]
+pub static TTL_EX: Counter = Counter::new();
+
+/// Returns the time in seconds until a key expires, `-1` if the key does not
+/// expire, or `-2` if the key does not exist.
+#[derive(Debug, PartialEq, Eq)]
+pub struct Ttl {
+    key: Arc<[u8]>,
+}
+
+impl TryFrom<Message> for Ttl {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() != 2 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let key = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        if key.is_empty() {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        Ok(Self { key })
+    }
+}
+
+impl Ttl {
+    pub fn new(key: &[u8]) -> Self {
+        Self { key: key.into() }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+}
+
+impl From<&Ttl> for Message {
+    fn from(value: &Ttl) -> Self {
+        Message::Array(Array {
+            inner: Some(vec![
+                Message::BulkString(BulkString::new(b"TTL")),
+                Message::BulkString(BulkString::new(value.key())),
+            ]),
+        })
+    }
+}
+
+impl Compose for Ttl {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"ttl a\r\n").unwrap().into_inner(),
+            Request::Ttl(Ttl::new(b"a"))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*2\r\n$3\r\nTTL\r\n$1\r\na\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::Ttl(Ttl::new(b"a"))
+        );
+    }
+}
@@ -0,0 +1,224 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "zadd")]
+pub static ZADD: Counter = Counter::new();
+
+#[metric(name = "zadd_ex")]
+pub static ZADD_EX: Counter = Counter::new();
+
+/// Adds members to a sorted set, or updates their scores. `NX` only adds new
+/// members and `XX` only updates existing ones, `GT` and `LT` only update a
+/// score which increases or decreases, `CH` counts the members whose score
+/// changed along with those added, and `INCR` adds the score to that of a
+/// single member, as for `ZINCRBY`.
+#[derive(Debug, PartialEq)]
+pub struct SortedSetAdd {
+    key: Arc<[u8]>,
+    members: Vec<(f64, Arc<[u8]>)>,
+    nx: bool,
+    xx: bool,
+    gt: bool,
+    lt: bool,
+    ch: bool,
+    incr: bool,
+}
+
+// scores are never NaN
+impl Eq for SortedSetAdd {}
+
+impl TryFrom<Message> for SortedSetAdd {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() < 4 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let key = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        let mut request = Self::new(&key, &[]);
+
+        // options come before the first score
+        while let Some(Message::BulkString(BulkString { inner: Some(token) })) = array.first() {
+            let flag = match &token[..] {
+                t if t.eq_ignore_ascii_case(b"NX") => &mut request.nx,
+                t if t.eq_ignore_ascii_case(b"XX") => &mut request.xx,
+                t if t.eq_ignore_ascii_case(b"GT") => &mut request.gt,
+                t if t.eq_ignore_ascii_case(b"LT") => &mut request.lt,
+                t if t.eq_ignore_ascii_case(b"CH") => &mut request.ch,
+                t if t.eq_ignore_ascii_case(b"INCR") => &mut request.incr,
+                _ => break,
+            };
+            *flag = true;
+            array.remove(0);
+        }
+
+        if array.is_empty() || array.len() % 2 != 0 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        while !array.is_empty() {
+            let score = take_bulk_string_as_score(&mut array)?
+                .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+            let member = take_bulk_string(&mut array)?
+                .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+            request.members.push((score, member));
+        }
+
+        if (request.nx && (request.xx || request.gt || request.lt))
+            || (request.gt && request.lt)
+            || (request.incr && request.members.len() != 1)
+        {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        Ok(request)
+    }
+}
+
+impl SortedSetAdd {
+    pub fn new(key: &[u8], members: &[(f64, &[u8])]) -> Self {
+        Self {
+            key: key.into(),
+            members: members
+                .iter()
+                .map(|(score, member)| (*score, (*member).into()))
+                .collect(),
+            nx: false,
+            xx: false,
+            gt: false,
+            lt: false,
+            ch: false,
+            incr: false,
+        }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+
+    pub fn members(&self) -> &[(f64, Arc<[u8]>)] {
+        &self.members
+    }
+
+    /// Only new members are added.
+    pub fn nx(&self) -> bool {
+        self.nx
+    }
+
+    /// Only existing members are updated.
+    pub fn xx(&self) -> bool {
+        self.xx
+    }
+
+    /// Scores are only updated when they increase.
+    pub fn gt(&self) -> bool {
+        self.gt
+    }
+
+    /// Scores are only updated when they decrease.
+    pub fn lt(&self) -> bool {
+        self.lt
+    }
+
+    /// The response counts changed scores as well as added members.
+    pub fn ch(&self) -> bool {
+        self.ch
+    }
+
+    /// The score is added to the current score of the member.
+    pub fn incr(&self) -> bool {
+        self.incr
+    }
+}
+
+impl From<&SortedSetAdd> for Message {
+    fn from(value: &SortedSetAdd) -> Self {
+        let mut vals = Vec::with_capacity(value.members.len() * 2 + 8);
+
+        vals.push(Message::bulk_string(b"ZADD"));
+        vals.push(Message::bulk_string(value.key()));
+        for (set, flag) in [
+            (value.nx, "NX"),
+            (value.xx, "XX"),
+            (value.gt, "GT"),
+            (value.lt, "LT"),
+            (value.ch, "CH"),
+            (value.incr, "INCR"),
+        ] {
+            if set {
+                vals.push(Message::bulk_string(flag.as_bytes()));
+            }
+        }
+        for (score, member) in value.members() {
+            vals.push(Message::bulk_string(format_score(*score).as_bytes()));
+            vals.push(Message::bulk_string(member));
+        }
+
+        Message::Array(Array { inner: Some(vals) })
+    }
+}
+
+impl Compose for SortedSetAdd {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser
+                .parse(b"zadd key 1 a 2.5 b -inf c\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::SortedSetAdd(SortedSetAdd::new(
+                b"key",
+                &[(1.0, b"a"), (2.5, b"b"), (f64::NEG_INFINITY, b"c")]
+            ))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*4\r\n$4\r\nzadd\r\n$3\r\nkey\r\n$1\r\n1\r\n$1\r\na\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::SortedSetAdd(SortedSetAdd::new(b"key", &[(1.0, b"a")]))
+        );
+
+        if let Request::SortedSetAdd(request) = parser
+            .parse(b"zadd key xx gt ch 1 a\r\n")
+            .unwrap()
+            .into_inner()
+        {
+            assert!(request.xx() && request.gt() && request.ch());
+            assert!(!request.nx() && !request.lt() && !request.incr());
+        } else {
+            panic!("invalid parse result");
+        }
+
+        assert!(parser.parse(b"zadd key 1\r\n").is_err());
+        assert!(parser.parse(b"zadd key nan a\r\n").is_err());
+        assert!(parser.parse(b"zadd key nx xx 1 a\r\n").is_err());
+        assert!(parser.parse(b"zadd key incr 1 a 2 b\r\n").is_err());
+    }
+}
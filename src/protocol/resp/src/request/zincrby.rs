@@ -0,0 +1,116 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "zincrby")]
+pub static ZINCRBY: Counter = Counter::new();
+
+#[metric(name = "zincrby_ex")]
+pub static ZINCRBY_EX: Counter = Counter::new();
+
+#[derive(Debug, PartialEq)]
+pub struct SortedSetIncrBy {
+    key: Arc<[u8]>,
+    increment: f64,
+    member: Arc<[u8]>,
+}
+
+// increments are never NaN
+impl Eq for SortedSetIncrBy {}
+
+impl TryFrom<Message> for SortedSetIncrBy {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() != 4 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let key = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+        let increment = take_bulk_string_as_score(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+        let member = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        Ok(Self {
+            key,
+            increment,
+            member,
+        })
+    }
+}
+
+impl SortedSetIncrBy {
+    pub fn new(key: &[u8], increment: f64, member: &[u8]) -> Self {
+        Self {
+            key: key.into(),
+            increment,
+            member: member.into(),
+        }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+
+    pub fn increment(&self) -> f64 {
+        self.increment
+    }
+
+    pub fn member(&self) -> &[u8] {
+        &self.member
+    }
+}
+
+impl From<&SortedSetIncrBy> for Message {
+    fn from(value: &SortedSetIncrBy) -> Self {
+        Message::Array(Array {
+            inner: Some(vec![
+                Message::bulk_string(b"ZINCRBY"),
+                Message::bulk_string(value.key()),
+                Message::bulk_string(format_score(value.increment()).as_bytes()),
+                Message::bulk_string(value.member()),
+            ]),
+        })
+    }
+}
+
+impl Compose for SortedSetIncrBy {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"zincrby key 1.5 a\r\n").unwrap().into_inner(),
+            Request::SortedSetIncrBy(SortedSetIncrBy::new(b"key", 1.5, b"a"))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*4\r\n$7\r\nzincrby\r\n$3\r\nkey\r\n$2\r\n-2\r\n$1\r\na\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::SortedSetIncrBy(SortedSetIncrBy::new(b"key", -2.0, b"a"))
+        );
+    }
+}
@@ -0,0 +1,159 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "zrange")]
+pub static ZRANGE: Counter = Counter::new();
+
+#[metric(name = "zrange_ex")]
+pub static ZRANGE_EX: Counter = Counter::new();
+
+/// Returns the members of a sorted set within an inclusive range of ranks,
+/// which count back from the highest rank when negative. `REV` ranks the
+/// members from the highest score, and `WITHSCORES` returns each score after
+/// its member. Ranges by score are served by `ZRANGEBYSCORE`.
+#[derive(Debug, PartialEq, Eq)]
+pub struct SortedSetRange {
+    key: Arc<[u8]>,
+    start: i64,
+    stop: i64,
+    rev: bool,
+    with_scores: bool,
+}
+
+impl TryFrom<Message> for SortedSetRange {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() < 4 || array.len() > 6 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let key = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+        let start = take_bulk_string_as_i64(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+        let stop = take_bulk_string_as_i64(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        let mut rev = false;
+        let mut with_scores = false;
+        while let Some(token) = take_bulk_string(&mut array)? {
+            if token.eq_ignore_ascii_case(b"REV") {
+                rev = true;
+            } else if token.eq_ignore_ascii_case(b"WITHSCORES") {
+                with_scores = true;
+            } else {
+                return Err(Error::new(ErrorKind::Other, "malformed command"));
+            }
+        }
+
+        Ok(Self {
+            key,
+            start,
+            stop,
+            rev,
+            with_scores,
+        })
+    }
+}
+
+impl SortedSetRange {
+    pub fn new(key: &[u8], start: i64, stop: i64, rev: bool, with_scores: bool) -> Self {
+        Self {
+            key: key.into(),
+            start,
+            stop,
+            rev,
+            with_scores,
+        }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+
+    pub fn start(&self) -> i64 {
+        self.start
+    }
+
+    pub fn stop(&self) -> i64 {
+        self.stop
+    }
+
+    pub fn rev(&self) -> bool {
+        self.rev
+    }
+
+    pub fn with_scores(&self) -> bool {
+        self.with_scores
+    }
+}
+
+impl From<&SortedSetRange> for Message {
+    fn from(value: &SortedSetRange) -> Self {
+        let mut vals = vec![
+            Message::bulk_string(b"ZRANGE"),
+            Message::bulk_string(value.key()),
+            Message::bulk_string(value.start().to_string().as_bytes()),
+            Message::bulk_string(value.stop().to_string().as_bytes()),
+        ];
+        if value.rev() {
+            vals.push(Message::bulk_string(b"REV"));
+        }
+        if value.with_scores() {
+            vals.push(Message::bulk_string(b"WITHSCORES"));
+        }
+
+        Message::Array(Array { inner: Some(vals) })
+    }
+}
+
+impl Compose for SortedSetRange {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"zrange key 0 -1\r\n").unwrap().into_inner(),
+            Request::SortedSetRange(SortedSetRange::new(b"key", 0, -1, false, false))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"zrange key 0 9 rev withscores\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::SortedSetRange(SortedSetRange::new(b"key", 0, 9, true, true))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*4\r\n$6\r\nzrange\r\n$3\r\nkey\r\n$1\r\n0\r\n$1\r\n1\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::SortedSetRange(SortedSetRange::new(b"key", 0, 1, false, false))
+        );
+
+        assert!(parser.parse(b"zrange key 0 1 byscore\r\n").is_err());
+    }
+}
@@ -0,0 +1,240 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "zrangebyscore")]
+pub static ZRANGEBYSCORE: Counter = Counter::new();
+
+#[metric(name = "zrangebyscore_ex")]
+pub static ZRANGEBYSCORE_EX: Counter = Counter::new();
+
+/// A bound of a range of scores, which is inclusive unless it is written with
+/// a leading `(`.
+#[derive(Debug, PartialEq, Copy, Clone)]
+pub struct ScoreBound {
+    score: f64,
+    exclusive: bool,
+}
+
+// scores are never NaN
+impl Eq for ScoreBound {}
+
+impl ScoreBound {
+    pub fn new(score: f64, exclusive: bool) -> Self {
+        Self { score, exclusive }
+    }
+
+    fn parse(bytes: &[u8]) -> Result<Self, Error> {
+        match bytes.strip_prefix(b"(") {
+            Some(score) => Ok(Self::new(parse_score(score)?, true)),
+            None => Ok(Self::new(parse_score(bytes)?, false)),
+        }
+    }
+
+    pub fn score(&self) -> f64 {
+        self.score
+    }
+
+    pub fn exclusive(&self) -> bool {
+        self.exclusive
+    }
+
+    /// Returns true if the score is within this lower bound.
+    pub fn admits_above(&self, score: f64) -> bool {
+        score > self.score || (!self.exclusive && score == self.score)
+    }
+
+    /// Returns true if the score is within this upper bound.
+    pub fn admits_below(&self, score: f64) -> bool {
+        score < self.score || (!self.exclusive && score == self.score)
+    }
+
+    fn to_message(self) -> Message {
+        let score = format_score(self.score);
+        if self.exclusive {
+            Message::bulk_string(format!("({score}").as_bytes())
+        } else {
+            Message::bulk_string(score.as_bytes())
+        }
+    }
+}
+
+/// Returns the members of a sorted set with scores between `min` and `max`,
+/// from the lowest score. `WITHSCORES` returns each score after its member,
+/// and `LIMIT` skips `offset` members and returns at most `count` of the rest,
+/// or all of them when `count` is negative.
+#[derive(Debug, PartialEq, Eq)]
+pub struct SortedSetRangeByScore {
+    key: Arc<[u8]>,
+    min: ScoreBound,
+    max: ScoreBound,
+    with_scores: bool,
+    limit: Option<(u64, i64)>,
+}
+
+impl TryFrom<Message> for SortedSetRangeByScore {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() < 4 || array.len() > 8 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let key = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+        let min = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+        let max = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        let mut with_scores = false;
+        let mut limit = None;
+        while let Some(token) = take_bulk_string(&mut array)? {
+            if token.eq_ignore_ascii_case(b"WITHSCORES") {
+                with_scores = true;
+            } else if token.eq_ignore_ascii_case(b"LIMIT") {
+                let offset = take_bulk_string_as_u64(&mut array)?
+                    .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+                let count = take_bulk_string_as_i64(&mut array)?
+                    .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+                limit = Some((offset, count));
+            } else {
+                return Err(Error::new(ErrorKind::Other, "malformed command"));
+            }
+        }
+
+        Ok(Self {
+            key,
+            min: ScoreBound::parse(&min)?,
+            max: ScoreBound::parse(&max)?,
+            with_scores,
+            limit,
+        })
+    }
+}
+
+impl SortedSetRangeByScore {
+    pub fn new(
+        key: &[u8],
+        min: ScoreBound,
+        max: ScoreBound,
+        with_scores: bool,
+        limit: Option<(u64, i64)>,
+    ) -> Self {
+        Self {
+            key: key.into(),
+            min,
+            max,
+            with_scores,
+            limit,
+        }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+
+    pub fn min(&self) -> ScoreBound {
+        self.min
+    }
+
+    pub fn max(&self) -> ScoreBound {
+        self.max
+    }
+
+    pub fn with_scores(&self) -> bool {
+        self.with_scores
+    }
+
+    pub fn limit(&self) -> Option<(u64, i64)> {
+        self.limit
+    }
+}
+
+impl From<&SortedSetRangeByScore> for Message {
+    fn from(value: &SortedSetRangeByScore) -> Self {
+        let mut vals = vec![
+            Message::bulk_string(b"ZRANGEBYSCORE"),
+            Message::bulk_string(value.key()),
+            value.min().to_message(),
+            value.max().to_message(),
+        ];
+        if value.with_scores() {
+            vals.push(Message::bulk_string(b"WITHSCORES"));
+        }
+        if let Some((offset, count)) = value.limit() {
+            vals.push(Message::bulk_string(b"LIMIT"));
+            vals.push(Message::bulk_string(offset.to_string().as_bytes()));
+            vals.push(Message::bulk_string(count.to_string().as_bytes()));
+        }
+
+        Message::Array(Array { inner: Some(vals) })
+    }
+}
+
+impl Compose for SortedSetRangeByScore {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser
+                .parse(b"zrangebyscore key -inf (2.5\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::SortedSetRangeByScore(SortedSetRangeByScore::new(
+                b"key",
+                ScoreBound::new(f64::NEG_INFINITY, false),
+                ScoreBound::new(2.5, true),
+                false,
+                None
+            ))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"zrangebyscore key 1 +inf withscores limit 10 -1\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::SortedSetRangeByScore(SortedSetRangeByScore::new(
+                b"key",
+                ScoreBound::new(1.0, false),
+                ScoreBound::new(f64::INFINITY, false),
+                true,
+                Some((10, -1))
+            ))
+        );
+
+        assert!(parser.parse(b"zrangebyscore key a 1\r\n").is_err());
+        assert!(parser.parse(b"zrangebyscore key 0 1 limit 1\r\n").is_err());
+    }
+
+    #[test]
+    fn bounds() {
+        let min = ScoreBound::new(1.0, true);
+        assert!(!min.admits_above(1.0));
+        assert!(min.admits_above(1.5));
+        let max = ScoreBound::new(1.0, false);
+        assert!(max.admits_below(1.0));
+        assert!(!max.admits_below(1.5));
+    }
+}
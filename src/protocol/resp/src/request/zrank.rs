@@ -0,0 +1,100 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "zrank")]
+pub static ZRANK: Counter = Counter::new();
+
+#[metric(name = "zrank_ex")]
+pub static ZRANK_EX: Counter = Counter::new();
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct SortedSetRank {
+    key: Arc<[u8]>,
+    member: Arc<[u8]>,
+}
+
+impl TryFrom<Message> for SortedSetRank {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() != 3 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let key = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+        let member = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        Ok(Self { key, member })
+    }
+}
+
+impl SortedSetRank {
+    pub fn new(key: &[u8], member: &[u8]) -> Self {
+        Self {
+            key: key.into(),
+            member: member.into(),
+        }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+
+    pub fn member(&self) -> &[u8] {
+        &self.member
+    }
+}
+
+impl From<&SortedSetRank> for Message {
+    fn from(value: &SortedSetRank) -> Self {
+        Message::Array(Array {
+            inner: Some(vec![
+                Message::bulk_string(b"ZRANK"),
+                Message::bulk_string(value.key()),
+                Message::bulk_string(value.member()),
+            ]),
+        })
+    }
+}
+
+impl Compose for SortedSetRank {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"zrank key a\r\n").unwrap().into_inner(),
+            Request::SortedSetRank(SortedSetRank::new(b"key", b"a"))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*3\r\n$5\r\nzrank\r\n$3\r\nkey\r\n$1\r\na\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::SortedSetRank(SortedSetRank::new(b"key", b"a"))
+        );
+    }
+}
@@ -0,0 +1,106 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use super::*;
+use std::io::{Error, ErrorKind};
+use std::sync::Arc;
+
+#[metric(name = "zrem")]
+pub static ZREM: Counter = Counter::new();
+
+#[metric(name = "zrem_ex")]
+pub static ZREM_EX: Counter = Counter::new();
+
+#[derive(Debug, PartialEq, Eq)]
+pub struct SortedSetRem {
+    key: Arc<[u8]>,
+    members: Vec<Arc<[u8]>>,
+}
+
+impl TryFrom<Message> for SortedSetRem {
+    type Error = Error;
+
+    fn try_from(other: Message) -> Result<Self, Error> {
+        let array = match other {
+            Message::Array(array) => array,
+            _ => return Err(Error::new(ErrorKind::Other, "malformed command")),
+        };
+
+        let mut array = array.inner.unwrap();
+        if array.len() < 3 {
+            return Err(Error::new(ErrorKind::Other, "malformed command"));
+        }
+
+        let _command = take_bulk_string(&mut array)?;
+        let key = take_bulk_string(&mut array)?
+            .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?;
+
+        let mut members = Vec::with_capacity(array.len());
+        while !array.is_empty() {
+            members.push(
+                take_bulk_string(&mut array)?
+                    .ok_or_else(|| Error::new(ErrorKind::Other, "malformed command"))?,
+            );
+        }
+
+        Ok(Self { key, members })
+    }
+}
+
+impl SortedSetRem {
+    pub fn new(key: &[u8], members: &[&[u8]]) -> Self {
+        Self {
+            key: key.into(),
+            members: members.iter().copied().map(From::from).collect(),
+        }
+    }
+
+    pub fn key(&self) -> &[u8] {
+        &self.key
+    }
+
+    pub fn members(&self) -> &[Arc<[u8]>] {
+        &self.members
+    }
+}
+
+impl From<&SortedSetRem> for Message {
+    fn from(value: &SortedSetRem) -> Self {
+        let mut vals = Vec::with_capacity(value.members.len() + 2);
+
+        vals.push(Message::bulk_string(b"ZREM"));
+        vals.push(Message::bulk_string(value.key()));
+        vals.extend(value.members().iter().map(|m| Message::bulk_string(m)));
+
+        Message::Array(Array { inner: Some(vals) })
+    }
+}
+
+impl Compose for SortedSetRem {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        Message::from(self).compose(dst)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser() {
+        let parser = RequestParser::new();
+        assert_eq!(
+            parser.parse(b"zrem key a b\r\n").unwrap().into_inner(),
+            Request::SortedSetRem(SortedSetRem::new(b"key", &[b"a", b"b"]))
+        );
+
+        assert_eq!(
+            parser
+                .parse(b"*3\r\n$4\r\nzrem\r\n$3\r\nkey\r\n$1\r\na\r\n")
+                .unwrap()
+                .into_inner(),
+            Request::SortedSetRem(SortedSetRem::new(b"key", &[b"a"]))
+        );
+    }
+}
@@ -7,4 +7,45 @@ use crate::*;
 pub trait Storage {
     fn get(&mut self, request: &Get) -> Response;
     fn set(&mut self, request: &Set) -> Response;
+    fn multi_get(&mut self, request: &MultiGet) -> Response;
+    fn multi_set(&mut self, request: &MultiSet) -> Response;
+    fn del(&mut self, request: &Del) -> Response;
+    fn exists(&mut self, request: &Exists) -> Response;
+    fn incr_by(&mut self, request: &IncrBy) -> Response;
+    fn decr_by(&mut self, request: &DecrBy) -> Response;
+    fn expire(&mut self, request: &Expire) -> Response;
+    fn ttl(&mut self, request: &Ttl) -> Response;
+    fn scan(&mut self, request: &Scan) -> Response;
+    fn get_ex(&mut self, request: &GetEx) -> Response;
+    fn hash_delete(&mut self, request: &HashDelete) -> Response;
+    fn hash_exists(&mut self, request: &HashExists) -> Response;
+    fn hash_get(&mut self, request: &HashGet) -> Response;
+    fn hash_get_all(&mut self, request: &HashGetAll) -> Response;
+    fn hash_incrby(&mut self, request: &HashIncrBy) -> Response;
+    fn hash_keys(&mut self, request: &HashKeys) -> Response;
+    fn hash_length(&mut self, request: &HashLength) -> Response;
+    fn hash_multi_get(&mut self, request: &HashMultiGet) -> Response;
+    fn hash_set(&mut self, request: &HashSet) -> Response;
+    fn hash_values(&mut self, request: &HashValues) -> Response;
+    fn list_index(&mut self, request: &ListIndex) -> Response;
+    fn list_len(&mut self, request: &ListLen) -> Response;
+    fn list_pop(&mut self, request: &ListPop) -> Response;
+    fn list_pop_back(&mut self, request: &ListPopBack) -> Response;
+    fn list_range(&mut self, request: &ListRange) -> Response;
+    fn list_push(&mut self, request: &ListPush) -> Response;
+    fn list_push_back(&mut self, request: &ListPushBack) -> Response;
+    fn list_trim(&mut self, request: &ListTrim) -> Response;
+    fn set_add(&mut self, request: &SetAdd) -> Response;
+    fn set_rem(&mut self, request: &SetRem) -> Response;
+    fn set_diff(&mut self, request: &SetDiff) -> Response;
+    fn set_union(&mut self, request: &SetUnion) -> Response;
+    fn set_intersect(&mut self, request: &SetIntersect) -> Response;
+    fn set_members(&mut self, request: &SetMembers) -> Response;
+    fn set_is_member(&mut self, request: &SetIsMember) -> Response;
+    fn sorted_set_add(&mut self, request: &SortedSetAdd) -> Response;
+    fn sorted_set_incrby(&mut self, request: &SortedSetIncrBy) -> Response;
+    fn sorted_set_range(&mut self, request: &SortedSetRange) -> Response;
+    fn sorted_set_range_by_score(&mut self, request: &SortedSetRangeByScore) -> Response;
+    fn sorted_set_rank(&mut self, request: &SortedSetRank) -> Response;
+    fn sorted_set_rem(&mut self, request: &SortedSetRem) -> Response;
 }
@@ -79,3 +79,36 @@ pub fn take_bulk_string_as_i64(array: &mut Vec<Message>) -> Result<Option<i64>,
         )),
     }
 }
+
+/// Takes a sorted set score, which is a decimal floating point number or one
+/// of `inf`, `+inf` and `-inf`.
+pub fn take_bulk_string_as_score(array: &mut Vec<Message>) -> Result<Option<f64>, Error> {
+    match take_bulk_string(array)? {
+        Some(score) => parse_score(&score).map(Some),
+        None => Ok(None),
+    }
+}
+
+/// Parses a sorted set score. NaN is rejected, and negative zero is read as
+/// zero, so that scores are ordered as Redis orders them.
+pub fn parse_score(bytes: &[u8]) -> Result<f64, Error> {
+    std::str::from_utf8(bytes)
+        .ok()
+        .and_then(|s| s.parse::<f64>().ok())
+        .filter(|score| !score.is_nan())
+        .map(|score| score + 0.0)
+        .ok_or_else(|| Error::new(ErrorKind::Other, "bulk string is not a valid float"))
+}
+
+/// Formats a sorted set score as the shortest decimal which reads back as the
+/// same score, in exponent form when it is very large or very small, or as
+/// `inf` or `-inf`.
+pub fn format_score(score: f64) -> String {
+    if score.is_infinite() {
+        if score > 0.0 { "inf" } else { "-inf" }.to_string()
+    } else if score != 0.0 && !(1e-5..1e17).contains(&score.abs()) {
+        format!("{score:e}")
+    } else {
+        score.to_string()
+    }
+}
@@ -3,15 +3,32 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 //! A protocol crate for Thrift binary protocol.
+//!
+//! Messages are treated as opaque frames. Only the frame length and the header
+//! of the message within it are parsed, which gives the method name and
+//! sequence id without decoding the arguments. The frame is held as shared
+//! bytes so that it is relayed to the next session by reference rather than
+//! being copied again into its write buffer.
 
 use metriken::*;
 use protocol_common::BufMut;
 use protocol_common::Compose;
+use protocol_common::Correlate;
 use protocol_common::Parse;
 use protocol_common::ParseOk;
+use protocol_common::Shard;
+use protocol_common::SharedBytes;
+use protocol_common::Vectored;
+
+use std::ops::Range;
+use std::sync::Arc;
 
 const THRIFT_HEADER_LEN: usize = std::mem::size_of::<u32>();
 
+// the strict form of the message header starts with the protocol version
+const VERSION_MASK: u32 = 0xffff0000;
+const VERSION_1: u32 = 0x80010000;
+
 // Stats
 #[metric(name = "messages_parsed")]
 pub static MESSAGES_PARSED: Counter = Counter::new();
@@ -21,22 +38,96 @@ pub static MESSAGES_COMPOSED: Counter = Counter::new();
 
 /// An opaque Thrift message
 pub struct Message {
-    data: Box<[u8]>,
+    // the whole frame, including the length
+    frame: SharedBytes,
+    // the location of the method name within the frame, if the message header
+    // could be parsed
+    method: Option<Range<usize>>,
+    seq_id: Option<i32>,
 }
 
 #[allow(clippy::len_without_is_empty)]
 impl Message {
+    /// The length of the message, excluding the frame length.
     pub fn len(&self) -> usize {
-        self.data.len()
+        self.frame().len() - THRIFT_HEADER_LEN
+    }
+
+    /// The message, excluding the frame length.
+    pub fn data(&self) -> &[u8] {
+        &self.frame()[THRIFT_HEADER_LEN..]
+    }
+
+    /// The name of the method which is called, or replied to.
+    pub fn method(&self) -> Option<&[u8]> {
+        self.method.clone().map(|range| &self.frame()[range])
+    }
+
+    /// The sequence id which pairs a reply with its call.
+    pub fn seq_id(&self) -> Option<i32> {
+        self.seq_id
+    }
+
+    fn frame(&self) -> &[u8] {
+        (*self.frame).as_ref()
+    }
+}
+
+/// Reads a big-endian `i32` at the offset.
+fn read_i32(data: &[u8], offset: usize) -> Option<i32> {
+    let bytes = data.get(offset..offset.checked_add(4)?)?;
+    Some(i32::from_be_bytes([bytes[0], bytes[1], bytes[2], bytes[3]]))
+}
+
+/// Parses the header of a message in either the strict or the old form,
+/// returning the location of the method name and the sequence id.
+fn header(data: &[u8]) -> Option<(Range<usize>, i32)> {
+    let first = read_i32(data, 0)?;
+    if (first as u32) & VERSION_MASK == VERSION_1 {
+        // <version|type:4><name len:4><name><seq id:4>
+        let len = usize::try_from(read_i32(data, 4)?).ok()?;
+        let name = 8..8usize.checked_add(len)?;
+        let seq_id = read_i32(data, name.end)?;
+        Some((name, seq_id))
+    } else if first >= 0 {
+        // <name len:4><name><type:1><seq id:4>
+        let name = 4..4usize.checked_add(first as usize)?;
+        let seq_id = read_i32(data, name.end + 1)?;
+        Some((name, seq_id))
+    } else {
+        None
     }
 }
 
 impl Compose for Message {
     fn compose(&self, session: &mut dyn BufMut) -> usize {
         MESSAGES_COMPOSED.increment();
-        session.put_slice(&(self.data.len() as u32).to_be_bytes());
-        session.put_slice(&self.data);
-        std::mem::size_of::<u32>() + self.data.len()
+        session.put_slice(self.frame());
+        self.frame().len()
+    }
+
+    fn compose_vectored(&self, session: &mut dyn Vectored) -> usize {
+        MESSAGES_COMPOSED.increment();
+        session.put_shared(self.frame.clone());
+        self.frame().len()
+    }
+}
+
+// Replies carry the sequence id of their call, which allows a server to reply
+// to pipelined calls out of order.
+impl Correlate<Message> for Message {
+    fn answered_by(&self, reply: &Message) -> bool {
+        match (self.seq_id, reply.seq_id) {
+            (Some(call), Some(reply)) => call == reply,
+            _ => true,
+        }
+    }
+}
+
+// Calls are routed by their method name.
+impl Shard<Message> for Message {
+    fn shard_key(&self) -> Option<&[u8]> {
+        self.method()
     }
 }
 
@@ -70,10 +161,21 @@ impl Parse<Message> for MessageParser {
             Err(std::io::Error::from(std::io::ErrorKind::WouldBlock))
         } else {
             MESSAGES_PARSED.increment();
-            let data = buffer[THRIFT_HEADER_LEN..framed_len]
-                .to_vec()
-                .into_boxed_slice();
-            let message = Message { data };
+            // the frame is copied once out of the session buffer, which is
+            // reused as soon as the frame is consumed
+            let frame = &buffer[..framed_len];
+            let (method, seq_id) = match header(&frame[THRIFT_HEADER_LEN..]) {
+                Some((name, seq_id)) => (
+                    Some((name.start + THRIFT_HEADER_LEN)..(name.end + THRIFT_HEADER_LEN)),
+                    Some(seq_id),
+                ),
+                None => (None, None),
+            };
+            let message = Message {
+                frame: Arc::new(frame.to_vec()),
+                method,
+                seq_id,
+            };
             Ok(ParseOk::new(message, framed_len))
         }
     }
@@ -98,7 +200,53 @@ mod tests {
         let parsed = parsed.into_inner();
 
         assert_eq!(consumed, body.len() + THRIFT_HEADER_LEN);
-        assert_eq!(*parsed.data, body);
+        assert_eq!(parsed.data(), body);
+        assert_eq!(parsed.method(), None);
+
+        let mut composed = Vec::new();
+        parsed.compose(&mut composed);
+        assert_eq!(composed, message);
+    }
+
+    #[test]
+    fn parse_header() {
+        // a strict call of `ping` with sequence id 7, followed by an empty
+        // struct of arguments
+        let mut body = 0x80010001u32.to_be_bytes().to_vec();
+        body.extend_from_slice(&4u32.to_be_bytes());
+        body.extend_from_slice(b"ping");
+        body.extend_from_slice(&7i32.to_be_bytes());
+        body.push(0);
+
+        let mut message = (body.len() as u32).to_be_bytes().to_vec();
+        message.extend_from_slice(&body);
+
+        let parser = MessageParser::new(1024);
+        let parsed = parser
+            .parse(&message)
+            .expect("failed to parse")
+            .into_inner();
+        assert_eq!(parsed.method(), Some(&b"ping"[..]));
+        assert_eq!(parsed.seq_id(), Some(7));
+        assert_eq!(parsed.shard_key(), Some(&b"ping"[..]));
+        assert!(parsed.answered_by(&parsed));
+
+        // the same call in the old form
+        let mut body = 4u32.to_be_bytes().to_vec();
+        body.extend_from_slice(b"ping");
+        body.push(1);
+        body.extend_from_slice(&7i32.to_be_bytes());
+        body.push(0);
+
+        let mut message = (body.len() as u32).to_be_bytes().to_vec();
+        message.extend_from_slice(&body);
+
+        let parsed = parser
+            .parse(&message)
+            .expect("failed to parse")
+            .into_inner();
+        assert_eq!(parsed.method(), Some(&b"ping"[..]));
+        assert_eq!(parsed.seq_id(), Some(7));
     }
 }
 
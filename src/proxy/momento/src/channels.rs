@@ -0,0 +1,98 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! A pool of Momento clients, each with its own gRPC channel, which is shared
+//! by the client connections of every listener.
+//!
+//! A client connection leases the channel with the fewest connections on
+//! it, and every request on the connection is a stream on that channel. A
+//! new channel is only opened once each channel has its share of connections,
+//! so that busy listeners don't contend for the streams of one HTTP/2
+//! connection, while idle ones don't each pay for the setup of their own.
+
+use crate::*;
+use std::sync::{Arc, Mutex};
+
+#[metric(
+    name = "momento_channels",
+    description = "the number of gRPC channels which are open to Momento"
+)]
+pub static MOMENTO_CHANNELS: Gauge = Gauge::new();
+
+pub struct ChannelPool {
+    builder: SimpleCacheClientBuilder,
+    channels: Mutex<Vec<Channel>>,
+    connections_per_channel: usize,
+    max_channels: usize,
+}
+
+struct Channel {
+    client: SimpleCacheClient,
+    connections: Arc<AtomicUsize>,
+}
+
+/// A channel which is leased for a client connection, until it is dropped.
+pub struct Lease {
+    client: SimpleCacheClient,
+    connections: Arc<AtomicUsize>,
+}
+
+impl Lease {
+    pub fn client(&self) -> SimpleCacheClient {
+        self.client.clone()
+    }
+}
+
+impl Drop for Lease {
+    fn drop(&mut self) {
+        self.connections.fetch_sub(1, Ordering::Relaxed);
+    }
+}
+
+impl ChannelPool {
+    pub fn new(
+        builder: SimpleCacheClientBuilder,
+        connections_per_channel: usize,
+        max_channels: usize,
+    ) -> Self {
+        Self {
+            builder,
+            channels: Mutex::new(Vec::new()),
+            connections_per_channel,
+            max_channels,
+        }
+    }
+
+    /// Leases the channel with the fewest connections, opening another if
+    /// every channel has its share and there is room for one more.
+    pub fn lease(&self) -> Lease {
+        let mut channels = self.channels.lock().unwrap();
+
+        let least = channels
+            .iter()
+            .min_by_key(|channel| channel.connections.load(Ordering::Relaxed));
+        let channel = match least {
+            Some(channel)
+                if channel.connections.load(Ordering::Relaxed) < self.connections_per_channel
+                    || channels.len() >= self.max_channels =>
+            {
+                channel
+            }
+            _ => {
+                MOMENTO_CHANNELS.increment();
+                channels.push(Channel {
+                    client: self.builder.clone().build(),
+                    connections: Arc::new(AtomicUsize::new(0)),
+                });
+                channels.last().unwrap()
+            }
+        };
+
+        channel.connections.fetch_add(1, Ordering::Relaxed);
+        Lease {
+            client: channel.client.clone(),
+            connections: channel.connections.clone(),
+        }
+    }
+}
@@ -26,7 +26,8 @@ pub(crate) fn klog_1(
     status: Status,
     response_len: usize,
 ) {
-    klog!(
+    klog_key!(
+        key.as_ref(),
         "\"{} {}\" {} {}",
         command,
         EscapedStr::new(key),
@@ -42,7 +43,8 @@ pub(crate) fn klog_2(
     status: Status,
     response_len: usize,
 ) {
-    klog!(
+    klog_key!(
+        key.as_ref(),
         "\"{} {} {}\" {} {}",
         command,
         EscapedStr::new(key),
@@ -61,7 +63,8 @@ pub(crate) fn klog_7(
     status: Status,
     response_len: usize,
 ) {
-    klog!(
+    klog_key!(
+        key.as_ref(),
         "\"{} {} {} {} {}\" {} {}",
         command,
         EscapedStr::new(key),
@@ -81,7 +84,8 @@ pub fn klog_set(
     status: Status,
     response_len: usize,
 ) {
-    klog!(
+    klog_key!(
+        key.as_ref(),
         "\"set {} {} {} {}\" {} {}",
         EscapedStr::new(key),
         flags,
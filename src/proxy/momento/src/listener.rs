@@ -4,12 +4,14 @@
 
 use crate::*;
 use pelikan_net::{TCP_ACCEPT, TCP_CLOSE, TCP_CONN_CURR};
+use std::sync::Arc;
 
 pub(crate) async fn listener(
     listener: TcpListener,
-    client_builder: SimpleCacheClientBuilder,
+    channels: Arc<ChannelPool>,
     cache_name: String,
     protocol: Protocol,
+    near_cache: Option<Arc<NearCache>>,
 ) {
     // this acts as our listener thread and spawns tasks for each client
     loop {
@@ -17,23 +19,31 @@ pub(crate) async fn listener(
         if let Ok((socket, _)) = listener.accept().await {
             TCP_ACCEPT.increment();
 
-            let client = client_builder.clone().build();
+            // the channel is leased until the client disconnects
+            let lease = channels.lease();
+            let client = lease.client();
             let cache_name = cache_name.clone();
+            let near_cache = near_cache.clone();
 
             // spawn a task for managing requests for the client
             tokio::spawn(async move {
                 TCP_CONN_CURR.increment();
                 match protocol {
                     Protocol::Memcache => {
-                        crate::frontend::handle_memcache_client(socket, client, cache_name).await;
+                        crate::frontend::handle_memcache_client(
+                            socket, client, cache_name, near_cache,
+                        )
+                        .await;
                     }
                     Protocol::Resp => {
-                        crate::frontend::handle_resp_client(socket, client, cache_name).await;
+                        crate::frontend::handle_resp_client(socket, client, cache_name, near_cache)
+                            .await;
                     }
                 }
 
                 TCP_CONN_CURR.decrement();
                 TCP_CLOSE.increment();
+                drop(lease);
             });
         }
     }
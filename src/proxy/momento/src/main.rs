@@ -20,13 +20,17 @@ use pelikan_net::TCP_RECV_BYTE;
 use protocol_admin::*;
 use session::*;
 use std::borrow::{Borrow, BorrowMut};
+use std::collections::HashMap;
 use std::io::{Error, ErrorKind};
+use std::sync::Arc;
 use tokio::io::{AsyncReadExt, AsyncWriteExt};
 use tokio::net::TcpListener;
 use tokio::runtime::Builder;
 use tokio::time::timeout;
 
+use crate::channels::ChannelPool;
 use crate::error::{ProxyError, ProxyResult};
+use crate::near_cache::NearCache;
 
 pub const KB: usize = 1024;
 pub const MB: usize = 1024 * KB;
@@ -35,11 +39,15 @@ const S: u64 = 1_000_000_000; // one second in nanoseconds
 const US: u64 = 1_000; // one microsecond in nanoseconds
 
 mod admin;
+mod channels;
 mod error;
 mod frontend;
 mod klog;
 mod listener;
+mod near_cache;
+mod pipeline;
 mod protocol;
+mod singleflight;
 
 // NOTES:
 //
@@ -322,10 +330,12 @@ async fn spawn(
         std::process::exit(1);
     }
 
-    for i in 0..config.caches().len() {
-        let config = config.clone();
-        let client_builder = client_builder.clone();
+    // the listeners share a pool of channels for each default ttl, and the
+    // listeners for the same cache share its near cache
+    let mut channel_pools: HashMap<Duration, Arc<ChannelPool>> = HashMap::new();
+    let mut near_caches: HashMap<String, Option<Arc<NearCache>>> = HashMap::new();
 
+    for i in 0..config.caches().len() {
         let cache = config.caches().get(i).unwrap().clone();
         let addr = match cache.socket_addr() {
             Ok(v) => v,
@@ -340,6 +350,22 @@ async fn spawn(
             }
         };
         let ttl = cache.default_ttl();
+        let channels = match channel_pools.get(&ttl) {
+            Some(channels) => channels.clone(),
+            None => {
+                let client_builder = client_builder
+                    .clone()
+                    .default_ttl(ttl)
+                    .expect("bad default ttl");
+                let channels = Arc::new(ChannelPool::new(
+                    client_builder,
+                    config.connections_per_channel(),
+                    config.max_channels(),
+                ));
+                channel_pools.insert(ttl, channels.clone());
+                channels
+            }
+        };
 
         let tcp_listener = match std::net::TcpListener::bind(addr) {
             Ok(v) => {
@@ -367,9 +393,12 @@ async fn spawn(
             }
         };
 
-        tokio::spawn(async move {
-            let client_builder = client_builder.default_ttl(ttl).expect("bad default ttl");
+        let near_cache = near_caches
+            .entry(cache.cache_name())
+            .or_insert_with(|| NearCache::new(&cache))
+            .clone();
 
+        tokio::spawn(async move {
             info!(
                 "starting proxy frontend listener for cache `{}` on: {}",
                 cache.cache_name(),
@@ -379,9 +408,10 @@ async fn spawn(
                 TcpListener::from_std(tcp_listener).expect("could not convert to tokio listener");
             listener::listener(
                 tcp_listener,
-                client_builder,
+                channels,
                 cache.cache_name(),
                 cache.protocol(),
+                near_cache,
             )
             .await;
         });
@@ -391,8 +421,8 @@ async fn spawn(
     Ok(())
 }
 
-async fn do_read(
-    socket: &mut tokio::net::TcpStream,
+async fn do_read<R: tokio::io::AsyncRead + Unpin>(
+    socket: &mut R,
     buf: &mut Buffer,
 ) -> Result<NonZeroUsize, Error> {
     match socket.read(buf.borrow_mut()).await {
@@ -0,0 +1,256 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! A local cache of recently read and written items, which serves hot keys
+//! without a call to Momento.
+//!
+//! Items are only kept for a short time, which bounds how stale a value may
+//! be when it is changed by another client of the same Momento cache. Sets
+//! and deletes which pass through the proxy are written through, so that this
+//! proxy's own clients read their writes.
+//!
+//! Keys which were missing from Momento may also be remembered for a short
+//! time, so that repeated gets for keys which do not exist are answered
+//! without a call. A set or delete through the proxy forgets the key.
+
+use crate::*;
+use segcache::{Segcache, ShardedSegcache, Value};
+use std::collections::hash_map::DefaultHasher;
+use std::collections::HashMap;
+use std::hash::{Hash, Hasher};
+use std::sync::{Arc, Mutex};
+use std::time::Instant;
+
+/// The number of shards, each with its own lock, so that tasks on different
+/// threads rarely contend.
+const SHARDS: usize = 8;
+
+/// The fewest segments in each shard, so that small caches still evict a
+/// small fraction of their items at a time.
+const MIN_SEGMENTS: usize = 16;
+
+/// How often expired items are removed.
+const EXPIRE_INTERVAL: Duration = Duration::from_millis(100);
+
+#[metric(
+    name = "near_cache_hit",
+    description = "the number of gets which were served from the local cache"
+)]
+pub static NEAR_CACHE_HIT: Counter = Counter::new();
+
+#[metric(
+    name = "near_cache_miss",
+    description = "the number of gets which were not found in the local cache"
+)]
+pub static NEAR_CACHE_MISS: Counter = Counter::new();
+
+#[metric(
+    name = "negative_cache_hit",
+    description = "the number of gets which were answered as misses from the local cache"
+)]
+pub static NEGATIVE_CACHE_HIT: Counter = Counter::new();
+
+pub struct NearCache {
+    data: Option<ShardedSegcache>,
+    ttl: Duration,
+    misses: Option<Misses>,
+}
+
+impl NearCache {
+    /// Creates the local cache for a Momento cache, if it is enabled, and
+    /// starts a task which removes expired items from it.
+    pub fn new(config: &config::momento_proxy::Cache) -> Option<Arc<Self>> {
+        let data = config.near_cache_size().map(|size| {
+            let segment_size = (size / SHARDS / MIN_SEGMENTS).clamp(64 * KB, MB);
+            Segcache::builder()
+                .heap_size(size)
+                .segment_size(segment_size as i32)
+                .shards(SHARDS)
+                .build_sharded()
+                .expect("failed to create near cache")
+        });
+        let misses = config
+            .negative_cache_size()
+            .map(|size| Misses::new(size, config.negative_cache_ttl()));
+
+        if data.is_none() && misses.is_none() {
+            return None;
+        }
+
+        let cache = Arc::new(Self {
+            data,
+            ttl: config.near_cache_ttl(),
+            misses,
+        });
+
+        let expiring = cache.clone();
+        tokio::spawn(async move {
+            let mut interval = tokio::time::interval(EXPIRE_INTERVAL);
+            loop {
+                interval.tick().await;
+                if let Some(data) = &expiring.data {
+                    data.expire();
+                }
+                if let Some(misses) = &expiring.misses {
+                    misses.expire();
+                }
+            }
+        });
+
+        Some(cache)
+    }
+
+    /// Returns a copy of the value, if the key is in the cache.
+    pub fn get(&self, key: &[u8]) -> Option<Arc<[u8]>> {
+        let mut shard = self.data.as_ref()?.shard(key);
+        let value = shard.get(key).map(|item| match item.value() {
+            Value::Bytes(b) => Arc::from(b),
+            Value::U64(v) => Arc::from(v.to_string().as_bytes()),
+        });
+
+        if value.is_some() {
+            NEAR_CACHE_HIT.increment();
+        } else {
+            NEAR_CACHE_MISS.increment();
+        }
+
+        value
+    }
+
+    /// Stores the value, for no longer than the TTL of the local cache or the
+    /// TTL it was written with.
+    pub fn insert(&self, key: &[u8], value: &[u8], ttl: Option<Duration>) {
+        if let Some(misses) = &self.misses {
+            misses.remove(key);
+        }
+
+        let Some(data) = &self.data else {
+            return;
+        };
+        let ttl = ttl.map_or(self.ttl, |ttl| ttl.min(self.ttl));
+        let mut shard = data.shard(key);
+
+        // an item which can't be stored, or which expires too soon to be kept
+        // at the granularity of whole seconds, must not leave an old value
+        // behind
+        if ttl.as_secs() == 0 || shard.insert(key, value, None, ttl).is_err() {
+            shard.delete(key);
+        }
+    }
+
+    pub fn delete(&self, key: &[u8]) {
+        if let Some(misses) = &self.misses {
+            misses.remove(key);
+        }
+        if let Some(data) = &self.data {
+            data.shard(key).delete(key);
+        }
+    }
+
+    /// Returns true if the key was recently missing from Momento.
+    pub fn is_miss(&self, key: &[u8]) -> bool {
+        let miss = self
+            .misses
+            .as_ref()
+            .is_some_and(|misses| misses.contains(key));
+        if miss {
+            NEGATIVE_CACHE_HIT.increment();
+        }
+        miss
+    }
+
+    /// Remembers that the key was missing from Momento.
+    pub fn insert_miss(&self, key: &[u8]) {
+        if let Some(misses) = &self.misses {
+            misses.insert(key);
+        }
+    }
+}
+
+/// A bounded set of missing keys, each with the time it is forgotten. A bloom
+/// filter would be smaller, but it can't forget a key once it is set, and a
+/// false positive would hide a key which exists.
+struct Misses {
+    shards: Vec<Mutex<HashMap<Box<[u8]>, Instant>>>,
+    capacity: usize,
+    ttl: Duration,
+}
+
+impl Misses {
+    fn new(size: usize, ttl: Duration) -> Self {
+        Self {
+            shards: (0..SHARDS).map(|_| Mutex::new(HashMap::new())).collect(),
+            capacity: (size / SHARDS).max(1),
+            ttl,
+        }
+    }
+
+    fn shard(&self, key: &[u8]) -> &Mutex<HashMap<Box<[u8]>, Instant>> {
+        let mut hasher = DefaultHasher::new();
+        key.hash(&mut hasher);
+        &self.shards[hasher.finish() as usize % SHARDS]
+    }
+
+    fn contains(&self, key: &[u8]) -> bool {
+        self.shard(key)
+            .lock()
+            .unwrap()
+            .get(key)
+            .is_some_and(|expiry| *expiry > Instant::now())
+    }
+
+    /// Remembers the key, unless the shard is full of keys which have not yet
+    /// expired, in which case it is not worth evicting one to make room.
+    fn insert(&self, key: &[u8]) {
+        let now = Instant::now();
+        let mut shard = self.shard(key).lock().unwrap();
+        if shard.len() >= self.capacity {
+            shard.retain(|_, expiry| *expiry > now);
+            if shard.len() >= self.capacity {
+                return;
+            }
+        }
+        shard.insert(key.into(), now + self.ttl);
+    }
+
+    fn remove(&self, key: &[u8]) {
+        self.shard(key).lock().unwrap().remove(key);
+    }
+
+    fn expire(&self) {
+        let now = Instant::now();
+        for shard in &self.shards {
+            shard.lock().unwrap().retain(|_, expiry| *expiry > now);
+        }
+    }
+}
+
+/// Gets the value of the key from the local cache, if there is one and the
+/// key is in it, or else from Momento. A value read from Momento is kept in
+/// the local cache, as is a miss.
+pub async fn get(
+    near_cache: Option<&NearCache>,
+    client: &mut SimpleCacheClient,
+    cache_name: &str,
+    key: &[u8],
+) -> ProxyResult<crate::singleflight::Value> {
+    if let Some(cache) = near_cache {
+        if let Some(value) = cache.get(key) {
+            return Ok(Some(value));
+        }
+        if cache.is_miss(key) {
+            return Ok(None);
+        }
+    }
+
+    // concurrent gets for the same key share one call to the backend
+    let value = crate::singleflight::get(client, cache_name, key).await?;
+    if let Some(cache) = near_cache {
+        match &value {
+            Some(value) => cache.insert(key, value, None),
+            None => cache.insert_miss(key),
+        }
+    }
+    Ok(value)
+}
@@ -0,0 +1,210 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Pipelined requests of one client connection, which are sent to the backend
+//! concurrently rather than one round trip at a time.
+//!
+//! Up to `MAX_PIPELINE` requests of a connection are in flight at once. Their
+//! responses are written back in the order of the requests, and those which
+//! are ready together are written with one call. A request which touches a
+//! key of an earlier request still in flight, where either of them writes,
+//! waits for it to complete before it is sent, so a get which follows a set
+//! of the same key sees the new value. Requests after it wait as well, as the
+//! responses are in order anyway.
+
+use crate::*;
+use futures::stream::FuturesOrdered;
+use futures::{FutureExt, StreamExt};
+use session::Buf;
+use std::collections::hash_map::DefaultHasher;
+use std::collections::VecDeque;
+use std::future::Future;
+use std::hash::{Hash, Hasher};
+use tokio::io::AsyncWrite;
+
+/// The most requests of one connection which are in flight at once.
+const MAX_PIPELINE: usize = 32;
+
+/// The response to a request, and whether the connection should be closed
+/// once it has been written.
+pub(crate) struct Output {
+    pub response: Vec<u8>,
+    pub fatal: bool,
+}
+
+/// The keys which a request touches, and whether it writes any of them. The
+/// keys are kept as hashes, as a collision only makes a request wait.
+pub(crate) struct Access {
+    keys: Vec<u64>,
+    write: bool,
+}
+
+impl Access {
+    pub fn read<'a>(keys: impl IntoIterator<Item = &'a [u8]>) -> Self {
+        Self::new(keys, false)
+    }
+
+    pub fn write<'a>(keys: impl IntoIterator<Item = &'a [u8]>) -> Self {
+        Self::new(keys, true)
+    }
+
+    fn new<'a>(keys: impl IntoIterator<Item = &'a [u8]>, write: bool) -> Self {
+        let keys = keys
+            .into_iter()
+            .map(|key| {
+                let mut hasher = DefaultHasher::new();
+                key.hash(&mut hasher);
+                hasher.finish()
+            })
+            .collect();
+
+        Self { keys, write }
+    }
+
+    fn conflicts(&self, other: &Access) -> bool {
+        (self.write || other.write) && self.keys.iter().any(|key| other.keys.contains(key))
+    }
+}
+
+/// Serves the requests of a client connection until it closes. Each request
+/// is sent with `execute`, and a request which can't be parsed is answered
+/// with `malformed` before the connection is closed.
+pub(crate) async fn serve<Request, Parser, Execute, Fut>(
+    mut socket: tokio::net::TcpStream,
+    parser: Parser,
+    malformed: &[u8],
+    access: impl Fn(&Request) -> Access,
+    execute: Execute,
+) where
+    Parser: Parse<Request>,
+    Execute: Fn(Request) -> Fut,
+    Fut: Future<Output = Output>,
+{
+    let (mut reader, mut writer) = socket.split();
+
+    // initialize a buffer for incoming bytes from the client
+    let mut buf = Buffer::new(INITIAL_BUFFER_SIZE);
+
+    // the requests in flight, along with the keys they touch, in order
+    let mut in_flight = FuturesOrdered::new();
+    let mut accesses: VecDeque<Access> = VecDeque::new();
+
+    // a parsed request which waits for a conflicting one to complete
+    let mut waiting: Option<(Request, Access)> = None;
+
+    let mut response_buf = Vec::new();
+
+    // cleared once the client has closed its side, after which the requests
+    // already read are still answered
+    let mut reading = true;
+    // set once no more requests are sent, as one couldn't be parsed
+    let mut invalid = false;
+
+    loop {
+        // send as many requests as the window allows
+        while !invalid && in_flight.len() < MAX_PIPELINE {
+            let (request, access) = match waiting.take() {
+                Some(waiting) => waiting,
+                None => match parser.parse(buf.borrow()) {
+                    Ok(request) => {
+                        let consumed = request.consumed();
+                        let request = request.into_inner();
+                        buf.advance(consumed);
+
+                        let access = access(&request);
+                        (request, access)
+                    }
+                    Err(e) if e.kind() == ErrorKind::WouldBlock => break,
+                    Err(_) => {
+                        let borrowed_buf: &[u8] = buf.borrow();
+                        trace!("malformed request: {:?}", borrowed_buf);
+                        invalid = true;
+                        break;
+                    }
+                },
+            };
+
+            if accesses.iter().any(|other| access.conflicts(other)) {
+                waiting = Some((request, access));
+                break;
+            }
+
+            in_flight.push_back(execute(request));
+            accesses.push_back(access);
+        }
+
+        if in_flight.is_empty() && (invalid || !reading) {
+            break;
+        }
+
+        tokio::select! {
+            Some(output) = in_flight.next(), if !in_flight.is_empty() => {
+                // take every response which is ready, so they are written
+                // back together
+                let mut output: Output = output;
+                let mut fatal = false;
+                loop {
+                    accesses.pop_front();
+                    response_buf.extend_from_slice(&output.response);
+                    if output.fatal {
+                        fatal = true;
+                        break;
+                    }
+
+                    match in_flight.next().now_or_never() {
+                        Some(Some(next)) => output = next,
+                        _ => break,
+                    }
+                }
+
+                if flush(&mut writer, &response_buf).await.is_err() || fatal {
+                    return;
+                }
+                response_buf.clear();
+            }
+            result = do_read(&mut reader, &mut buf),
+                if reading && !invalid && waiting.is_none() && in_flight.len() < MAX_PIPELINE =>
+            {
+                if result.is_err() {
+                    reading = false;
+                }
+            }
+            else => break,
+        }
+    }
+
+    if invalid {
+        let _ = writer.write_all(malformed).await;
+    }
+}
+
+async fn flush<W: AsyncWrite + Unpin>(writer: &mut W, response_buf: &[u8]) -> Result<(), Error> {
+    if response_buf.is_empty() {
+        return Ok(());
+    }
+
+    if let Err(e) = writer.write_all(response_buf).await {
+        SESSION_SEND_EX.increment();
+        return Err(e);
+    }
+
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn conflicts() {
+        let get = Access::read([b"coffee".as_slice()]);
+        let set = Access::write([b"coffee".as_slice()]);
+        let other = Access::write([b"tea".as_slice()]);
+
+        assert!(!get.conflicts(&Access::read([b"coffee".as_slice()])));
+        assert!(get.conflicts(&set));
+        assert!(set.conflicts(&get));
+        assert!(!set.conflicts(&other));
+    }
+}
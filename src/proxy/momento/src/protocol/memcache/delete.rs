@@ -6,7 +6,8 @@ use protocol_memcache::*;
 pub async fn delete(
     client: &mut SimpleCacheClient,
     cache_name: &str,
-    socket: &mut tokio::net::TcpStream,
+    near_cache: Option<&NearCache>,
+    response_buf: &mut Vec<u8>,
     request: &protocol_memcache::Delete,
 ) -> Result<(), Error> {
     let key = request.key();
@@ -16,12 +17,17 @@ pub async fn delete(
         GET_EX.increment();
 
         // invalid key
-        let _ = socket.write_all(b"ERROR\r\n").await;
+        response_buf.extend_from_slice(b"ERROR\r\n");
         return Err(Error::from(ErrorKind::InvalidInput));
     }
 
     BACKEND_REQUEST.increment();
 
+    crate::singleflight::forget(cache_name, key);
+    if let Some(near_cache) = near_cache {
+        near_cache.delete(key);
+    }
+
     match timeout(Duration::from_millis(200), client.delete(cache_name, key)).await {
         Ok(Ok(_result)) => {
             // it appears we can't tell deleted from not found in the momento
@@ -37,11 +43,7 @@ pub async fn delete(
                 SESSION_SEND.increment();
                 SESSION_SEND_BYTE.add(8);
                 TCP_SEND_BYTE.add(8);
-                if let Err(e) = socket.write_all(b"DELETED\r\n").await {
-                    SESSION_SEND_EX.increment();
-                    // hangup if we can't send a response back
-                    return Err(e);
-                }
+                response_buf.extend_from_slice(b"DELETED\r\n");
             }
         }
         Ok(Err(e)) => {
@@ -57,11 +59,7 @@ pub async fn delete(
             SESSION_SEND_BYTE.add(message.len() as _);
             TCP_SEND_BYTE.add(message.len() as _);
 
-            if let Err(e) = socket.write_all(message.as_bytes()).await {
-                SESSION_SEND_EX.increment();
-                // hangup if we can't send a response back
-                return Err(e);
-            }
+            response_buf.extend_from_slice(message.as_bytes());
         }
         Err(_) => {
             // timeout
@@ -78,11 +76,7 @@ pub async fn delete(
             SESSION_SEND_BYTE.add(message.len() as _);
             TCP_SEND_BYTE.add(message.len() as _);
 
-            if let Err(e) = socket.write_all(message.as_bytes()).await {
-                SESSION_SEND_EX.increment();
-                // hangup if we can't send a response back
-                return Err(e);
-            }
+            response_buf.extend_from_slice(message.as_bytes());
         }
     }
 
@@ -4,15 +4,19 @@
 
 use crate::klog::{klog_1, Status};
 use crate::{Error, *};
-use momento::response::Get as GetResponse;
+use futures::stream::{self, StreamExt};
 use pelikan_net::*;
 use protocol_memcache::*;
 
+/// The most keys of a multi-key get which are fetched at once.
+const MAX_IN_FLIGHT: usize = 32;
+
 pub async fn get(
     client: &mut SimpleCacheClient,
     cache_name: &str,
-    socket: &mut tokio::net::TcpStream,
-    keys: &[Box<[u8]>],
+    near_cache: Option<&NearCache>,
+    response_buf: &mut Vec<u8>,
+    keys: &[Key],
 ) -> Result<(), Error> {
     // check if any of the keys are invalid before
     // sending the requests to the backend
@@ -21,57 +25,62 @@ pub async fn get(
             GET_EX.increment();
 
             // invalid key
-            let _ = socket.write_all(b"ERROR\r\n").await;
+            response_buf.extend_from_slice(b"ERROR\r\n");
             return Err(Error::from(ErrorKind::InvalidInput));
         }
     }
 
-    let mut response_buf = Vec::new();
-
-    for key in keys {
-        BACKEND_REQUEST.increment();
-
-        // we don't have a strict guarantee this function was called with memcache
-        // safe keys. This matters mostly for writing the response back to the client
-        // in a protocol compliant way.
-        let key = std::str::from_utf8(key);
-
-        // invalid keys will be treated as a miss
-        if key.is_err() {
-            continue;
-        }
-
-        // unwrap is safe now, rebind for convenience
-        let key = key.unwrap();
+    // we don't have a strict guarantee this function was called with memcache
+    // safe keys. This matters mostly for writing the response back to the client
+    // in a protocol compliant way. invalid keys will be treated as a miss
+    let keys = keys.iter().filter_map(|key| std::str::from_utf8(key).ok());
+
+    // the keys are fetched concurrently, each on its own clone of the client,
+    // and the results are taken in the order of the keys
+    let mut results = stream::iter(keys)
+        .map(|key| {
+            BACKEND_REQUEST.increment();
+            let mut client = client.clone();
+            async move {
+                let result =
+                    crate::near_cache::get(near_cache, &mut client, cache_name, key.as_bytes())
+                        .await;
+                (key, result)
+            }
+        })
+        .buffered(MAX_IN_FLIGHT);
 
-        match timeout(Duration::from_millis(200), client.get(cache_name, key)).await {
-            Ok(Ok(response)) => {
-                match response {
-                    GetResponse::Hit { value } => {
-                        GET_KEY_HIT.increment();
+    while let Some((key, result)) = results.next().await {
+        match result {
+            Ok(Some(value)) => {
+                GET_KEY_HIT.increment();
 
-                        let value: Vec<u8> = value.into();
+                let length = value.len();
 
-                        let length = value.len();
+                let item_header = format!("VALUE {key} 0 {length}\r\n");
 
-                        let item_header = format!("VALUE {key} 0 {length}\r\n");
+                klog_1(&"get", &key, Status::Hit, length);
 
-                        klog_1(&"get", &key, Status::Hit, length);
+                response_buf.extend_from_slice(item_header.as_bytes());
+                response_buf.extend_from_slice(&value);
+                response_buf.extend_from_slice(b"\r\n");
+            }
+            Ok(None) => {
+                GET_KEY_MISS.increment();
 
-                        response_buf.extend_from_slice(item_header.as_bytes());
-                        response_buf.extend_from_slice(&value);
-                        response_buf.extend_from_slice(b"\r\n");
-                    }
-                    GetResponse::Miss => {
-                        GET_KEY_MISS.increment();
+                // we don't write anything for a miss
 
-                        // we don't write anything for a miss
+                klog_1(&"get", &key, Status::Miss, 0);
+            }
+            Err(ProxyError::Timeout(_)) => {
+                // we had a timeout, incr stats and move on
+                // treating it as a miss
+                BACKEND_EX.increment();
+                BACKEND_EX_TIMEOUT.increment();
 
-                        klog_1(&"get", &key, Status::Miss, 0);
-                    }
-                }
+                klog_1(&"get", &key, Status::Timeout, 0);
             }
-            Ok(Err(e)) => {
+            Err(e) => {
                 // we got some error from the momento client
                 // log and incr stats and move on treating it
                 // as a miss
@@ -80,14 +89,6 @@ pub async fn get(
 
                 klog_1(&"get", &key, Status::ServerError, 0);
             }
-            Err(_) => {
-                // we had a timeout, incr stats and move on
-                // treating it as a miss
-                BACKEND_EX.increment();
-                BACKEND_EX_TIMEOUT.increment();
-
-                klog_1(&"get", &key, Status::Timeout, 0);
-            }
         }
     }
     response_buf.extend_from_slice(b"END\r\n");
@@ -95,9 +96,6 @@ pub async fn get(
     SESSION_SEND.increment();
     SESSION_SEND_BYTE.add(response_buf.len() as _);
     TCP_SEND_BYTE.add(response_buf.len() as _);
-    if let Err(e) = socket.write_all(&response_buf).await {
-        SESSION_SEND_EX.increment();
-        return Err(e);
-    }
+
     Ok(())
 }
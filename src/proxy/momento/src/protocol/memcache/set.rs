@@ -10,7 +10,8 @@ use protocol_memcache::*;
 pub async fn set(
     client: &mut SimpleCacheClient,
     cache_name: &str,
-    socket: &mut tokio::net::TcpStream,
+    near_cache: Option<&NearCache>,
+    response_buf: &mut Vec<u8>,
     request: &protocol_memcache::Set,
 ) -> Result<(), Error> {
     SET.increment();
@@ -20,13 +21,23 @@ pub async fn set(
 
     if value.is_empty() {
         error!("empty values are not supported by momento");
-        let _ = socket.write_all(b"ERROR\r\n").await;
+        response_buf.extend_from_slice(b"ERROR\r\n");
 
         return Err(Error::from(ErrorKind::InvalidInput));
     }
 
     BACKEND_REQUEST.increment();
 
+    // gets already in flight may return the old value, so later ones must not
+    // wait on them
+    crate::singleflight::forget(cache_name, key);
+
+    // the local copy is replaced once the set succeeds, and until then it
+    // must not be served
+    if let Some(near_cache) = near_cache {
+        near_cache.delete(key);
+    }
+
     let ttl = request
         .ttl()
         .get()
@@ -40,6 +51,9 @@ pub async fn set(
     {
         Ok(Ok(_result)) => {
             SET_STORED.increment();
+            if let Some(near_cache) = near_cache {
+                near_cache.insert(key, value, ttl);
+            }
             if request.noreply() {
                 klog_set(
                     &key,
@@ -61,11 +75,7 @@ pub async fn set(
                 SESSION_SEND.increment();
                 SESSION_SEND_BYTE.add(8);
                 TCP_SEND_BYTE.add(8);
-                if let Err(e) = socket.write_all(b"STORED\r\n").await {
-                    SESSION_SEND_EX.increment();
-                    // hangup if we can't send a response back
-                    return Err(e);
-                }
+                response_buf.extend_from_slice(b"STORED\r\n");
             }
         }
         Ok(Err(e)) => {
@@ -88,11 +98,7 @@ pub async fn set(
             SESSION_SEND_BYTE.add(message.len() as _);
             TCP_SEND_BYTE.add(message.len() as _);
 
-            if let Err(e) = socket.write_all(message.as_bytes()).await {
-                SESSION_SEND_EX.increment();
-                // hangup if we can't send a response back
-                return Err(e);
-            }
+            response_buf.extend_from_slice(message.as_bytes());
         }
         Err(_) => {
             // timeout
@@ -116,11 +122,7 @@ pub async fn set(
             SESSION_SEND_BYTE.add(message.len() as _);
             TCP_SEND_BYTE.add(message.len() as _);
 
-            if let Err(e) = socket.write_all(message.as_bytes()).await {
-                SESSION_SEND_EX.increment();
-                // hangup if we can't send a response back
-                return Err(e);
-            }
+            response_buf.extend_from_slice(message.as_bytes());
         }
     }
 
@@ -8,6 +8,7 @@ use super::update_method_metrics;
 pub async fn del(
     client: &mut SimpleCacheClient,
     cache_name: &str,
+    near_cache: Option<&NearCache>,
     response_buf: &mut Vec<u8>,
     req: &Del,
 ) -> ProxyResult {
@@ -15,6 +16,10 @@ pub async fn del(
 
     for key in keys {
         let mut client = client.clone();
+        crate::singleflight::forget(cache_name, key);
+        if let Some(near_cache) = near_cache {
+            near_cache.delete(key);
+        }
 
         update_method_metrics(&DEL, &DEL_EX, async move {
             match timeout(Duration::from_millis(200), client.delete(cache_name, key)).await {
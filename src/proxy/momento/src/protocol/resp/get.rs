@@ -4,7 +4,6 @@
 
 use crate::klog::{klog_1, Status};
 use crate::*;
-use momento::response::Get as GetResponse;
 use protocol_memcache::*;
 
 use super::update_method_metrics;
@@ -12,33 +11,30 @@ use super::update_method_metrics;
 pub async fn get(
     client: &mut SimpleCacheClient,
     cache_name: &str,
+    near_cache: Option<&NearCache>,
     response_buf: &mut Vec<u8>,
     key: &[u8],
 ) -> ProxyResult {
     update_method_metrics(&GET, &GET_EX, async move {
         GET_KEY.increment();
 
-        let response = match timeout(Duration::from_millis(200), client.get(cache_name, key)).await
-        {
-            Ok(Ok(r)) => r,
-            Ok(Err(e)) => {
-                GET_EX.increment();
-                klog_1(&"get", &key, Status::ServerError, 0);
-                return Err(ProxyError::from(e));
-            }
+        let value = match crate::near_cache::get(near_cache, client, cache_name, key).await {
+            Ok(value) => value,
             Err(e) => {
                 GET_EX.increment();
-                klog_1(&"get", &key, Status::Timeout, 0);
-                return Err(ProxyError::from(e));
+                let status = match e {
+                    ProxyError::Timeout(_) => Status::Timeout,
+                    _ => Status::ServerError,
+                };
+                klog_1(&"get", &key, status, 0);
+                return Err(e);
             }
         };
 
-        match response {
-            GetResponse::Hit { value } => {
+        match value {
+            Some(value) => {
                 GET_KEY_HIT.increment();
 
-                let value: Vec<u8> = value.into();
-
                 let item_header = format!("${}\r\n", value.len());
 
                 response_buf.extend_from_slice(item_header.as_bytes());
@@ -47,7 +43,7 @@ pub async fn get(
 
                 klog_1(&"get", &key, Status::Hit, value.len());
             }
-            GetResponse::Miss => {
+            None => {
                 GET_KEY_MISS.increment();
 
                 response_buf.extend_from_slice(b"$-1\r\n");
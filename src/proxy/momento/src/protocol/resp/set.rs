@@ -10,12 +10,14 @@ use protocol_resp::Set;
 
 use crate::error::{ProxyError, ProxyResult};
 use crate::klog::{klog_set, Status};
+use crate::near_cache::NearCache;
 
 use super::update_method_metrics;
 
 pub async fn set(
     client: &mut SimpleCacheClient,
     cache_name: &str,
+    near_cache: Option<&NearCache>,
     response_buf: &mut Vec<u8>,
     req: &Set,
 ) -> ProxyResult {
@@ -29,6 +31,11 @@ pub async fn set(
             None => None,
         };
 
+        crate::singleflight::forget(cache_name, req.key());
+        if let Some(near_cache) = near_cache {
+            near_cache.delete(req.key());
+        }
+
         let _response = match tokio::time::timeout(
             Duration::from_millis(200),
             client.set(cache_name, req.key(), req.value(), ttl),
@@ -61,6 +68,9 @@ pub async fn set(
         };
 
         SET_STORED.increment();
+        if let Some(near_cache) = near_cache {
+            near_cache.insert(req.key(), req.value(), ttl);
+        }
         klog_set(
             &req.key(),
             0,
@@ -0,0 +1,150 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Coalescing of concurrent gets for the same key.
+//!
+//! The first get for a key in a cache becomes the leader and makes the call to
+//! Momento. Gets for the same key which arrive while that call is in flight
+//! wait for its result instead of making calls of their own. A leader which
+//! fails shares nothing, and each waiting get then makes its own call so that
+//! it sees its own error.
+
+use crate::*;
+use momento::response::Get as GetResponse;
+use std::collections::HashMap;
+use std::sync::atomic::AtomicU64;
+use std::sync::{Arc, Mutex, OnceLock};
+use tokio::sync::watch;
+
+const TIMEOUT: Duration = Duration::from_millis(200);
+
+#[metric(
+    name = "backend_coalesced",
+    description = "the number of gets which were answered by a call to the backend for the same key which was already in flight"
+)]
+pub static BACKEND_COALESCED: Counter = Counter::new();
+
+/// The value of a key, or `None` if it was a miss.
+pub type Value = Option<Arc<[u8]>>;
+
+#[derive(Clone)]
+enum Flight {
+    Waiting,
+    Done(Value),
+}
+
+type Id = (String, Vec<u8>);
+
+/// The flights in progress, each with a sequence number so that a leader
+/// only removes its own flight.
+type Inflight = HashMap<Id, (u64, watch::Receiver<Flight>)>;
+
+fn inflight() -> &'static Mutex<Inflight> {
+    static INFLIGHT: OnceLock<Mutex<Inflight>> = OnceLock::new();
+    INFLIGHT.get_or_init(Default::default)
+}
+
+static SEQUENCE: AtomicU64 = AtomicU64::new(0);
+
+/// Removes the flight once the leader finishes, even if it is cancelled, and
+/// then shares the value with the gets which waited on it.
+struct Leader {
+    id: Id,
+    sequence: u64,
+    tx: watch::Sender<Flight>,
+    value: Option<Value>,
+}
+
+impl Drop for Leader {
+    fn drop(&mut self) {
+        let mut inflight = inflight().lock().unwrap();
+        if inflight.get(&self.id).map(|(sequence, _)| *sequence) == Some(self.sequence) {
+            inflight.remove(&self.id);
+        }
+        drop(inflight);
+
+        if let Some(value) = self.value.take() {
+            let _ = self.tx.send(Flight::Done(value));
+        }
+    }
+}
+
+/// Gets the value of the key, sharing a call to the backend with any other
+/// get for the same key which is in flight.
+pub async fn get(
+    client: &mut SimpleCacheClient,
+    cache_name: &str,
+    key: &[u8],
+) -> ProxyResult<Value> {
+    let id = (cache_name.to_owned(), key.to_vec());
+
+    let joined = {
+        let mut inflight = inflight().lock().unwrap();
+        match inflight.get(&id) {
+            Some((_, rx)) => Err(rx.clone()),
+            None => {
+                let sequence = SEQUENCE.fetch_add(1, Ordering::Relaxed);
+                let (tx, rx) = watch::channel(Flight::Waiting);
+                inflight.insert(id.clone(), (sequence, rx));
+                Ok(Leader {
+                    id,
+                    sequence,
+                    tx,
+                    value: None,
+                })
+            }
+        }
+    };
+
+    let mut rx = match joined {
+        Ok(mut leader) => {
+            let result = fetch(client, cache_name, key).await;
+            if let Ok(value) = &result {
+                leader.value = Some(value.clone());
+            }
+            return result;
+        }
+        Err(rx) => rx,
+    };
+
+    BACKEND_COALESCED.increment();
+
+    timeout(TIMEOUT, async {
+        loop {
+            if let Flight::Done(value) = &*rx.borrow_and_update() {
+                return Ok(value.clone());
+            }
+            if rx.changed().await.is_err() {
+                break;
+            }
+        }
+
+        // the leader failed, so make a call of our own
+        let response = client.get(cache_name, key).await?;
+        Ok(value(response))
+    })
+    .await?
+}
+
+/// Forgets a get which is in flight for a key which is being changed, so
+/// that later gets do not wait for a value which may be stale.
+pub fn forget(cache_name: &str, key: &[u8]) {
+    let id = (cache_name.to_owned(), key.to_vec());
+    inflight().lock().unwrap().remove(&id);
+}
+
+async fn fetch(client: &mut SimpleCacheClient, cache_name: &str, key: &[u8]) -> ProxyResult<Value> {
+    let response = timeout(TIMEOUT, client.get(cache_name, key)).await??;
+    Ok(value(response))
+}
+
+fn value(response: GetResponse) -> Value {
+    match response {
+        GetResponse::Hit { value } => {
+            let value: Vec<u8> = value.into();
+            Some(value.into())
+        }
+        GetResponse::Miss => None,
+    }
+}
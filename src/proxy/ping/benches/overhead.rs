@@ -0,0 +1,340 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Measures the overhead of the proxy. Requests are sent to pingserver both
+//! directly and through pingproxy, and to a thrift echo server both directly
+//! and through thriftproxy, across a few connection counts and pipeline
+//! depths. For each, the throughput and latency percentiles are reported
+//! along with the latency which the proxy adds.
+//!
+//! The servers and proxies run as their own processes, as they would be
+//! deployed. pingserver and thriftproxy are built by their own packages, so
+//! they must be built first with the same profile:
+//!
+//! ```text
+//! cargo build --release -p pelikan-pingserver -p thriftproxy
+//! cargo bench -p pingproxy --bench overhead
+//! ```
+
+use std::io::{Read, Write};
+use std::net::{SocketAddr, TcpListener, TcpStream};
+use std::path::{Path, PathBuf};
+use std::process::{Child, Command, Stdio};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+const CONNECTIONS: &[usize] = &[1, 4, 16];
+const DEPTHS: &[usize] = &[1, 8, 32];
+
+const WARMUP: Duration = Duration::from_millis(500);
+const DURATION: Duration = Duration::from_secs(2);
+
+const PINGSERVER: &str = "127.0.0.1:12321";
+const PINGPROXY: &str = "127.0.0.1:12322";
+const THRIFTSERVER: &str = "127.0.0.1:12331";
+const THRIFTPROXY: &str = "127.0.0.1:12332";
+
+/// A request and the response it is answered with. Each response has a fixed
+/// length, so a pipeline of them is read back by length alone.
+struct Protocol {
+    name: &'static str,
+    request: fn(u32) -> Vec<u8>,
+    response_len: usize,
+}
+
+const PING: Protocol = Protocol {
+    name: "ping",
+    request: ping,
+    response_len: 6,
+};
+
+const THRIFT: Protocol = Protocol {
+    name: "thrift",
+    request: thrift_call,
+    response_len: 21,
+};
+
+fn ping(_: u32) -> Vec<u8> {
+    b"PING\r\n".to_vec()
+}
+
+/// A framed, strict thrift call to `ping` without arguments. The echo server
+/// returns it as is, which the proxy pairs with the call by its sequence id.
+fn thrift_call(seq_id: u32) -> Vec<u8> {
+    let mut message = Vec::new();
+    message.extend_from_slice(&0x80010001u32.to_be_bytes());
+    message.extend_from_slice(&4u32.to_be_bytes());
+    message.extend_from_slice(b"ping");
+    message.extend_from_slice(&seq_id.to_be_bytes());
+    message.push(0);
+
+    let mut frame = (message.len() as u32).to_be_bytes().to_vec();
+    frame.extend_from_slice(&message);
+    frame
+}
+
+/// A child process which is killed when it is dropped.
+struct Process(Child);
+
+impl Drop for Process {
+    fn drop(&mut self) {
+        let _ = self.0.kill();
+        let _ = self.0.wait();
+    }
+}
+
+/// Finds a binary in the target directory which this benchmark is built in.
+fn binary(name: &str) -> PathBuf {
+    let path = Path::new(env!("CARGO_BIN_EXE_pelikan_pingproxy_rs")).with_file_name(name);
+    assert!(
+        path.exists(),
+        "{} was not found, build it first with: cargo build --release -p pelikan-pingserver -p thriftproxy",
+        path.display()
+    );
+    path
+}
+
+/// Launches the binary with the config, and waits for it to accept
+/// connections.
+fn launch(binary: &Path, config: &str, addr: &str) -> Process {
+    let file = std::env::temp_dir().join(format!(
+        "{}-{}.toml",
+        binary.file_name().unwrap().to_string_lossy(),
+        std::process::id()
+    ));
+    std::fs::write(&file, config).expect("failed to write config");
+
+    let process = Process(
+        Command::new(binary)
+            .arg(&file)
+            .stdout(Stdio::null())
+            .spawn()
+            .expect("failed to launch"),
+    );
+    wait_for(addr);
+    process
+}
+
+/// Waits for an address to accept connections. The duration is chosen to be
+/// longer than we'd expect startup to take in a slow ci environment.
+fn wait_for(addr: &str) {
+    let addr: SocketAddr = addr.parse().unwrap();
+    let start = Instant::now();
+    while TcpStream::connect_timeout(&addr, Duration::from_millis(100)).is_err() {
+        assert!(
+            start.elapsed() < Duration::from_secs(10),
+            "{addr} did not start"
+        );
+        std::thread::sleep(Duration::from_millis(100));
+    }
+}
+
+fn proxy_config(listen: &str, backend: &str, admin: u16) -> String {
+    format!(
+        r#"
+[admin]
+port = "{admin}"
+http_enabled = false
+
+[listener]
+address = "{listen}"
+
+[backend]
+poolsize = 4
+pipeline_depth = 32
+endpoints = ["{backend}"]
+
+[debug]
+log_level = "error"
+"#
+    )
+}
+
+fn pingserver_config() -> String {
+    let (host, port) = PINGSERVER.split_once(':').unwrap();
+    format!(
+        r#"
+[general]
+engine = "mio"
+protocol = "ascii"
+
+[metrics]
+
+[admin]
+port = "9999"
+http_enabled = false
+
+[server]
+host = "{host}"
+port = "{port}"
+
+[debug]
+log_level = "error"
+"#
+    )
+}
+
+/// Runs a thrift server on its own thread which returns each frame as is.
+fn thrift_echo() {
+    let listener = TcpListener::bind(THRIFTSERVER).expect("failed to bind");
+    std::thread::spawn(move || {
+        for stream in listener.incoming().flatten() {
+            std::thread::spawn(move || {
+                let _ = stream.set_nodelay(true);
+                let mut reader = &stream;
+                let mut writer = &stream;
+                let mut frame = Vec::new();
+                loop {
+                    let mut len = [0; 4];
+                    if reader.read_exact(&mut len).is_err() {
+                        return;
+                    }
+                    frame.clear();
+                    frame.extend_from_slice(&len);
+                    frame.resize(4 + u32::from_be_bytes(len) as usize, 0);
+                    if reader.read_exact(&mut frame[4..]).is_err()
+                        || writer.write_all(&frame).is_err()
+                    {
+                        return;
+                    }
+                }
+            });
+        }
+    });
+}
+
+struct Report {
+    throughput: f64,
+    // latencies in microseconds at each of the percentiles
+    percentiles: [f64; 3],
+}
+
+const PERCENTILES: [f64; 3] = [0.5, 0.99, 0.999];
+
+/// Sends pipelines of requests on each connection, waiting for every response
+/// to a pipeline before the next is sent. Each request in a pipeline shares
+/// the latency of the pipeline.
+fn run(protocol: &Protocol, addr: &str, connections: usize, depth: usize) -> Report {
+    let running = Arc::new(AtomicBool::new(true));
+    let recording = Arc::new(AtomicBool::new(false));
+
+    let workers: Vec<_> = (0..connections)
+        .map(|_| {
+            let mut stream = TcpStream::connect(addr).expect("failed to connect");
+            stream.set_nodelay(true).unwrap();
+            let pipeline: Vec<u8> = (0..depth as u32)
+                .flat_map(|seq_id| (protocol.request)(seq_id))
+                .collect();
+            let mut responses = vec![0; protocol.response_len * depth];
+            let running = running.clone();
+            let recording = recording.clone();
+
+            std::thread::spawn(move || {
+                let mut latencies = Vec::new();
+                while running.load(Ordering::Relaxed) {
+                    let start = Instant::now();
+                    stream.write_all(&pipeline).expect("failed to send");
+                    stream
+                        .read_exact(&mut responses)
+                        .expect("failed to receive");
+                    let latency = start.elapsed().as_nanos() as u64;
+                    if recording.load(Ordering::Relaxed) {
+                        latencies.extend(std::iter::repeat(latency).take(depth));
+                    }
+                }
+                latencies
+            })
+        })
+        .collect();
+
+    std::thread::sleep(WARMUP);
+    recording.store(true, Ordering::Relaxed);
+    std::thread::sleep(DURATION);
+    recording.store(false, Ordering::Relaxed);
+    running.store(false, Ordering::Relaxed);
+
+    let mut latencies: Vec<u64> = workers
+        .into_iter()
+        .flat_map(|worker| worker.join().unwrap())
+        .collect();
+    latencies.sort_unstable();
+
+    let percentile = |p: f64| {
+        let index = ((latencies.len() - 1) as f64 * p) as usize;
+        latencies[index] as f64 / 1000.0
+    };
+
+    Report {
+        throughput: latencies.len() as f64 / DURATION.as_secs_f64(),
+        percentiles: PERCENTILES.map(percentile),
+    }
+}
+
+fn main() {
+    // `cargo bench` passes `--bench`, and other arguments select what is run
+    let filter: Vec<String> = std::env::args()
+        .skip(1)
+        .filter(|arg| !arg.starts_with('-'))
+        .collect();
+
+    let _pingserver = launch(
+        &binary("pelikan_pingserver"),
+        &pingserver_config(),
+        PINGSERVER,
+    );
+    let _pingproxy = launch(
+        &binary("pelikan_pingproxy_rs"),
+        &proxy_config(PINGPROXY, PINGSERVER, 9997),
+        PINGPROXY,
+    );
+    thrift_echo();
+    let _thriftproxy = launch(
+        &binary("pelikan_thriftproxy_rs"),
+        &proxy_config(THRIFTPROXY, THRIFTSERVER, 9995),
+        THRIFTPROXY,
+    );
+
+    println!(
+        "{:<8} {:>5} {:>5} {:<7} {:>12} {:>10} {:>10} {:>10}",
+        "protocol", "conns", "depth", "target", "rps", "p50 (us)", "p99 (us)", "p99.9 (us)"
+    );
+
+    for (protocol, direct, proxied) in [
+        (PING, PINGSERVER, PINGPROXY),
+        (THRIFT, THRIFTSERVER, THRIFTPROXY),
+    ] {
+        if !filter.is_empty() && !filter.iter().any(|f| protocol.name.contains(f.as_str())) {
+            continue;
+        }
+
+        for connections in CONNECTIONS {
+            for depth in DEPTHS {
+                let direct = run(&protocol, direct, *connections, *depth);
+                let proxied = run(&protocol, proxied, *connections, *depth);
+
+                let added = [0, 1, 2].map(|i| proxied.percentiles[i] - direct.percentiles[i]);
+                for (target, throughput, percentiles) in [
+                    ("direct", Some(direct.throughput), direct.percentiles),
+                    ("proxied", Some(proxied.throughput), proxied.percentiles),
+                    ("added", None, added),
+                ] {
+                    let throughput = throughput
+                        .map_or_else(String::new, |throughput| format!("{throughput:.0}"));
+                    println!(
+                        "{:<8} {:>5} {:>5} {:<7} {:>12} {:>10.1} {:>10.1} {:>10.1}",
+                        protocol.name,
+                        connections,
+                        depth,
+                        target,
+                        throughput,
+                        percentiles[0],
+                        percentiles[1],
+                        percentiles[2]
+                    );
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,518 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Compares the cost of each of the pingserver frontends, to quantify the
+//! overhead of a protocol before choosing the transport for a new service.
+//!
+//! Each case launches the server binary with only its engine and protocol
+//! changed, and drives it with the same closed-loop load: `CONNECTIONS`
+//! connections, each with one ping in flight, for a warmup and then for
+//! `DURATION`. The throughput, the CPU time of the server process for each
+//! request and the latency percentiles seen by the client are reported for
+//! each case. The client shares the machine with the server, so the numbers
+//! are for comparing the cases with each other rather than absolute.
+//!
+//! The ascii protocol is served by both the mio workers of the core server and
+//! by tokio, which isolates the overhead of the runtime from that of the
+//! protocol. With `PINGSERVER_BENCH_MAX_OVERHEAD` set, the benchmark fails if
+//! the CPU time per request with tokio is more than that factor of the time
+//! with the mio workers, so it may be used as a regression test.
+//!
+//! The load may be changed with `PINGSERVER_BENCH_CONNECTIONS` and
+//! `PINGSERVER_BENCH_DURATION`, in seconds, and cases are picked by passing
+//! part of their names, e.g. `cargo bench --bench protocols -- ascii`.
+
+use bytes::Bytes;
+use metriken::histogram::Histogram;
+use tokio::io::{AsyncReadExt, AsyncWriteExt};
+use tokio::net::TcpStream;
+
+use std::net::{SocketAddr, TcpListener, UdpSocket};
+use std::path::{Path, PathBuf};
+use std::process::{Child, Command, Stdio};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+pub mod pingpong {
+    tonic::include_proto!("pingpong");
+}
+
+type Error = Box<dyn std::error::Error + Send + Sync>;
+
+const CONNECTIONS: usize = 16;
+const DURATION: Duration = Duration::from_secs(10);
+const WARMUP: Duration = Duration::from_secs(2);
+
+// the server gets one worker thread for every case, so that the cost of a
+// request is not spread differently across cores
+const SERVER_THREADS: usize = 1;
+
+// how long the server has to start listening
+const STARTUP_TIMEOUT: Duration = Duration::from_secs(10);
+
+const PERCENTILES: &[(&str, f64)] = &[("p50", 50.0), ("p90", 90.0), ("p99", 99.0), ("p999", 99.9)];
+
+#[derive(Clone, Copy, PartialEq)]
+enum Case {
+    MioAscii,
+    TokioAscii,
+    Grpc,
+    Http2,
+    Http3,
+}
+
+impl Case {
+    const ALL: [Case; 5] = [
+        Case::MioAscii,
+        Case::TokioAscii,
+        Case::Grpc,
+        Case::Http2,
+        Case::Http3,
+    ];
+
+    fn name(&self) -> &'static str {
+        match self {
+            Self::MioAscii => "ascii/mio",
+            Self::TokioAscii => "ascii/tokio",
+            Self::Grpc => "grpc/tokio",
+            Self::Http2 => "http2/tokio",
+            Self::Http3 => "http3/tokio",
+        }
+    }
+
+    fn engine(&self) -> &'static str {
+        match self {
+            Self::MioAscii => "mio",
+            _ => "tokio",
+        }
+    }
+
+    fn protocol(&self) -> &'static str {
+        match self {
+            Self::MioAscii | Self::TokioAscii => "ascii",
+            Self::Grpc => "grpc",
+            Self::Http2 => "http2",
+            Self::Http3 => "http3",
+        }
+    }
+}
+
+/// The paths of the self-signed certificate and key which the http3 server
+/// is configured with, both DER encoded.
+struct Tls {
+    certificate: PathBuf,
+    private_key: PathBuf,
+    der: Vec<u8>,
+}
+
+impl Tls {
+    fn generate(dir: &Path) -> Self {
+        let certified = rcgen::generate_simple_self_signed(vec!["localhost".to_string()])
+            .expect("failed to generate certificate");
+        let der = certified.cert.der().to_vec();
+
+        let certificate = dir.join("server.der");
+        let private_key = dir.join("server.key.der");
+        std::fs::write(&certificate, &der).expect("failed to write certificate");
+        std::fs::write(&private_key, certified.key_pair.serialize_der())
+            .expect("failed to write private key");
+
+        Self {
+            certificate,
+            private_key,
+            der,
+        }
+    }
+}
+
+fn free_port() -> u16 {
+    TcpListener::bind("127.0.0.1:0")
+        .and_then(|listener| listener.local_addr())
+        .expect("failed to find a free port")
+        .port()
+}
+
+/// A running server, which is killed when dropped.
+struct Server {
+    child: Child,
+    addr: SocketAddr,
+}
+
+impl Server {
+    fn launch(case: Case, dir: &Path, tls: &Tls) -> Self {
+        let port = match case {
+            // quic listens on udp, so the port must be free for udp as well
+            Case::Http3 => UdpSocket::bind("127.0.0.1:0")
+                .and_then(|socket| socket.local_addr())
+                .expect("failed to find a free port")
+                .port(),
+            _ => free_port(),
+        };
+
+        let mut config = format!(
+            "daemonize = false\n\
+            \n\
+            [general]\n\
+            engine = \"{}\"\n\
+            protocol = \"{}\"\n\
+            \n\
+            [metrics]\n\
+            interval = \"1s\"\n\
+            \n\
+            [admin]\n\
+            host = \"127.0.0.1\"\n\
+            port = \"{}\"\n\
+            http_enabled = false\n\
+            http_host = \"127.0.0.1\"\n\
+            http_port = \"{}\"\n\
+            \n\
+            [server]\n\
+            host = \"127.0.0.1\"\n\
+            port = \"{port}\"\n\
+            \n\
+            [worker]\n\
+            threads = {SERVER_THREADS}\n\
+            \n\
+            [debug]\n\
+            log_level = \"error\"\n",
+            case.engine(),
+            case.protocol(),
+            free_port(),
+            free_port(),
+        );
+        if case == Case::Http3 {
+            config.push_str(&format!(
+                "\n[tls]\ncertificate = \"{}\"\nprivate_key = \"{}\"\n",
+                tls.certificate.display(),
+                tls.private_key.display(),
+            ));
+        }
+
+        let path = dir.join(format!("{}.toml", case.protocol()));
+        std::fs::write(&path, config).expect("failed to write config");
+
+        let child = Command::new(env!("CARGO_BIN_EXE_pelikan_pingserver"))
+            .arg(&path)
+            .stdout(Stdio::null())
+            .spawn()
+            .expect("failed to launch pingserver");
+
+        Self {
+            child,
+            addr: SocketAddr::from(([127, 0, 0, 1], port)),
+        }
+    }
+
+    /// Returns the CPU time used by the server so far, where it is known.
+    fn cpu_time(&self) -> Option<Duration> {
+        let stat = std::fs::read_to_string(format!("/proc/{}/stat", self.child.id())).ok()?;
+        // the fields after the command, which may have spaces, start with the
+        // state, with the user and system time in ticks 11 and 12 after it
+        let mut fields = stat.rsplit_once(')')?.1.split_whitespace().skip(11);
+        let ticks: u64 =
+            fields.next()?.parse::<u64>().ok()? + fields.next()?.parse::<u64>().ok()?;
+        let hz = unsafe { libc::sysconf(libc::_SC_CLK_TCK) };
+        if hz <= 0 {
+            return None;
+        }
+        Some(Duration::from_secs_f64(ticks as f64 / hz as f64))
+    }
+}
+
+impl Drop for Server {
+    fn drop(&mut self) {
+        let _ = self.child.kill();
+        let _ = self.child.wait();
+    }
+}
+
+/// A connection to the server speaking the protocol of one of the cases.
+enum Client {
+    Ascii(TcpStream),
+    Grpc(pingpong::ping_client::PingClient<tonic::transport::Channel>),
+    Http2(h2::client::SendRequest<Bytes>, SocketAddr),
+    Http3(
+        h3::client::SendRequest<h3_quinn::OpenStreams, Bytes>,
+        SocketAddr,
+        // the endpoint must outlive the connection
+        quinn::Endpoint,
+    ),
+}
+
+impl Client {
+    async fn connect(case: Case, addr: SocketAddr, tls: &Tls) -> Result<Self, Error> {
+        match case {
+            Case::MioAscii | Case::TokioAscii => {
+                let stream = TcpStream::connect(addr).await?;
+                stream.set_nodelay(true)?;
+                Ok(Self::Ascii(stream))
+            }
+            Case::Grpc => {
+                let client =
+                    pingpong::ping_client::PingClient::connect(format!("http://{addr}")).await?;
+                Ok(Self::Grpc(client))
+            }
+            Case::Http2 => {
+                let stream = TcpStream::connect(addr).await?;
+                stream.set_nodelay(true)?;
+                let (sender, connection) = h2::client::handshake(stream).await?;
+                tokio::spawn(connection);
+                Ok(Self::Http2(sender, addr))
+            }
+            Case::Http3 => {
+                let mut roots = rustls::RootCertStore::empty();
+                roots.add(rustls::pki_types::CertificateDer::from(tls.der.clone()))?;
+                let mut config = rustls::ClientConfig::builder()
+                    .with_root_certificates(roots)
+                    .with_no_client_auth();
+                config.alpn_protocols = vec![b"h3".to_vec()];
+                let config = quinn::crypto::rustls::QuicClientConfig::try_from(config)?;
+
+                let mut endpoint = quinn::Endpoint::client("127.0.0.1:0".parse()?)?;
+                endpoint.set_default_client_config(quinn::ClientConfig::new(Arc::new(config)));
+                let connection = endpoint.connect(addr, "localhost")?.await?;
+
+                let (mut driver, sender) =
+                    h3::client::new(h3_quinn::Connection::new(connection)).await?;
+                tokio::spawn(async move {
+                    let _ = std::future::poll_fn(|cx| driver.poll_close(cx)).await;
+                });
+                Ok(Self::Http3(sender, addr, endpoint))
+            }
+        }
+    }
+
+    /// Sends a ping and waits for all of the response.
+    async fn ping(&mut self) -> Result<(), Error> {
+        match self {
+            Self::Ascii(stream) => {
+                let mut response = [0; 6];
+                stream.write_all(b"PING\r\n").await?;
+                stream.read_exact(&mut response).await?;
+                if &response != b"PONG\r\n" {
+                    return Err("unexpected response".into());
+                }
+            }
+            Self::Grpc(client) => {
+                client.ping(pingpong::PingRequest {}).await?;
+            }
+            Self::Http2(sender, addr) => {
+                let mut ready = sender.clone().ready().await?;
+                let (response, mut stream) =
+                    ready.send_request(grpc_request("http", *addr)?, false)?;
+                // an empty message is the five byte header of its length
+                stream.send_data(Bytes::from_static(&[0; 5]), true)?;
+
+                let mut body = response.await?.into_body();
+                while let Some(data) = body.data().await {
+                    let data = data?;
+                    body.flow_control().release_capacity(data.len())?;
+                }
+                body.trailers().await?;
+            }
+            Self::Http3(sender, addr, _) => {
+                let mut stream = sender.send_request(grpc_request("https", *addr)?).await?;
+                stream.send_data(Bytes::from_static(&[0; 5])).await?;
+                stream.finish().await?;
+
+                stream.recv_response().await?;
+                while stream.recv_data().await?.is_some() {}
+                stream.recv_trailers().await?;
+            }
+        }
+
+        Ok(())
+    }
+}
+
+fn grpc_request(scheme: &str, addr: SocketAddr) -> Result<http::Request<()>, Error> {
+    Ok(http::Request::builder()
+        .method("POST")
+        .uri(format!(
+            "{scheme}://localhost:{}/pingpong.Ping/Ping",
+            addr.port()
+        ))
+        .header("content-type", "application/grpc")
+        .header("te", "trailers")
+        .body(())?)
+}
+
+struct Report {
+    requests: u64,
+    elapsed: Duration,
+    cpu: Option<Duration>,
+    latency: Histogram,
+}
+
+impl Report {
+    fn cpu_per_request(&self) -> Option<Duration> {
+        self.cpu
+            .filter(|_| self.requests > 0)
+            .map(|cpu| Duration::from_secs_f64(cpu.as_secs_f64() / self.requests as f64))
+    }
+
+    fn print(&self, case: Case) {
+        let throughput = self.requests as f64 / self.elapsed.as_secs_f64();
+        let cpu = match self.cpu_per_request() {
+            Some(cpu) => format!("{:.2}us", cpu.as_nanos() as f64 / 1000.0),
+            None => "-".to_string(),
+        };
+
+        let mut line = format!(
+            "{:<12} {:>12.0} req/s  cpu/req {:>9}",
+            case.name(),
+            throughput,
+            cpu
+        );
+        let percentiles: Vec<f64> = PERCENTILES.iter().map(|(_, p)| *p).collect();
+        if let Ok(Some(result)) = self.latency.percentiles(&percentiles) {
+            for ((label, _), (_, bucket)) in PERCENTILES.iter().zip(result.iter()) {
+                line.push_str(&format!(
+                    "  {label} {:>8.1}us",
+                    bucket.end() as f64 / 1000.0
+                ));
+            }
+        }
+        println!("{line}");
+    }
+}
+
+fn new_histogram() -> Histogram {
+    // within 1/128 of the value, up to ~18s in ns
+    Histogram::new(7, 34).unwrap()
+}
+
+fn run(case: Case, dir: &Path, tls: &Arc<Tls>, connections: usize, duration: Duration) -> Report {
+    let server = Server::launch(case, dir, tls);
+    let addr = server.addr;
+
+    let runtime = tokio::runtime::Builder::new_multi_thread()
+        .enable_all()
+        .worker_threads(
+            connections.min(std::thread::available_parallelism().map_or(1, |n| n.get())),
+        )
+        .build()
+        .expect("failed to initialize tokio runtime");
+
+    runtime.block_on(async move {
+        // wait for the server to listen, which it may for udp before it has
+        // bound the socket, so connecting is tried until it works
+        let deadline = Instant::now() + STARTUP_TIMEOUT;
+        let mut clients = Vec::with_capacity(connections);
+        while clients.len() < connections {
+            match Client::connect(case, addr, tls).await {
+                Ok(client) => clients.push(client),
+                Err(e) if Instant::now() >= deadline => {
+                    panic!("failed to connect to {}: {e}", case.name());
+                }
+                Err(_) => tokio::time::sleep(Duration::from_millis(100)).await,
+            }
+        }
+
+        let start = Instant::now() + WARMUP;
+        let end = start + duration;
+
+        let tasks: Vec<_> = clients
+            .into_iter()
+            .map(|mut client| {
+                tokio::spawn(async move {
+                    let mut latency = new_histogram();
+                    let mut requests = 0;
+                    loop {
+                        let sent = Instant::now();
+                        if sent >= end {
+                            break;
+                        }
+                        client.ping().await.expect("request failed");
+                        if sent >= start {
+                            let _ = latency.increment(sent.elapsed().as_nanos() as u64);
+                            requests += 1;
+                        }
+                    }
+                    (requests, latency)
+                })
+            })
+            .collect();
+
+        tokio::time::sleep_until(start.into()).await;
+        let cpu_start = server.cpu_time();
+        tokio::time::sleep_until(end.into()).await;
+        let cpu_end = server.cpu_time();
+
+        let mut report = Report {
+            requests: 0,
+            elapsed: duration,
+            cpu: cpu_start.zip(cpu_end).map(|(start, end)| end - start),
+            latency: new_histogram(),
+        };
+        for task in tasks {
+            let (requests, latency) = task.await.expect("connection failed");
+            report.requests += requests;
+            report.latency = report.latency.checked_add(&latency).unwrap();
+        }
+
+        report
+    })
+}
+
+fn env_or<T: std::str::FromStr>(name: &str, default: T) -> T {
+    std::env::var(name)
+        .ok()
+        .and_then(|value| value.parse().ok())
+        .unwrap_or(default)
+}
+
+fn main() {
+    // cargo passes flags such as `--bench`, the rest filter the cases
+    let filters: Vec<String> = std::env::args()
+        .skip(1)
+        .filter(|arg| !arg.starts_with("--"))
+        .collect();
+
+    let connections = env_or("PINGSERVER_BENCH_CONNECTIONS", CONNECTIONS).max(1);
+    let duration = Duration::from_secs(env_or("PINGSERVER_BENCH_DURATION", DURATION.as_secs()));
+    let max_overhead: Option<f64> = std::env::var("PINGSERVER_BENCH_MAX_OVERHEAD")
+        .ok()
+        .and_then(|value| value.parse().ok());
+
+    let dir = std::env::temp_dir().join(format!("pingserver-bench-{}", std::process::id()));
+    std::fs::create_dir_all(&dir).expect("failed to create config directory");
+    let tls = Arc::new(Tls::generate(&dir));
+
+    println!(
+        "{connections} connections, {} seconds for each case",
+        duration.as_secs()
+    );
+
+    let mut mio = None;
+    let mut tokio = None;
+    for case in Case::ALL {
+        if !filters.is_empty() && !filters.iter().any(|f| case.name().contains(f.as_str())) {
+            continue;
+        }
+
+        let report = run(case, &dir, &tls, connections, duration);
+        report.print(case);
+
+        match case {
+            Case::MioAscii => mio = report.cpu_per_request(),
+            Case::TokioAscii => tokio = report.cpu_per_request(),
+            _ => {}
+        }
+    }
+
+    let _ = std::fs::remove_dir_all(&dir);
+
+    if let (Some(mio), Some(tokio)) = (mio, tokio) {
+        let overhead = tokio.as_secs_f64() / mio.as_secs_f64();
+        println!("tokio runtime overhead over the mio workers: {overhead:.2}x cpu/req");
+
+        if let Some(max) = max_overhead {
+            if overhead > max {
+                eprintln!("overhead of {overhead:.2}x is over the limit of {max:.2}x");
+                std::process::exit(1);
+            }
+        }
+    }
+}
@@ -5,7 +5,7 @@
 //! RDS is a work-in-progress RESP protocol server.
 
 use config::*;
-use entrystore::Seg;
+use entrystore::{Seg, SharedSeg};
 use logger::*;
 use protocol_resp::{Request, RequestParser, Response};
 use server::{Process, ProcessBuilder};
@@ -28,20 +28,28 @@ impl Rds {
         // initialize metrics
         common::metrics::init();
 
-        // initialize storage
-        let storage = Storage::new(&config)?;
-
         // initialize parser
         let parser = Parser::new();
 
-        // initialize process
-        let process_builder = ProcessBuilder::<Parser, Request, Response, Storage>::new(
-            &config, log_drain, parser, storage,
-        )?
-        .version(env!("CARGO_PKG_VERSION"));
+        // initialize storage and process, with multiple shards or partitions each worker
+        // thread executes requests against the shared storage directly
+        let process = if config.seg().shards() > 1 || !config.seg().partitions().is_empty() {
+            let storage = SharedSeg::new(&config)?;
+
+            ProcessBuilder::<Parser, Request, Response, SharedSeg>::shared(
+                &config, log_drain, parser, storage,
+            )?
+            .version(env!("CARGO_PKG_VERSION"))
+            .spawn()
+        } else {
+            let storage = Storage::new(&config)?;
 
-        // spawn threads
-        let process = process_builder.spawn();
+            ProcessBuilder::<Parser, Request, Response, Storage>::new(
+                &config, log_drain, parser, storage,
+            )?
+            .version(env!("CARGO_PKG_VERSION"))
+            .spawn()
+        };
 
         Ok(Self { process })
     }
@@ -19,6 +19,26 @@ pub fn tests() {
     // get and gets on a key that is not in the cache results in a miss
     test("get miss", &[("get 0\r\n", Some(RESP_NIL))]);
 
+    // hello answers with the properties of the server, as a map for RESP3,
+    // and refuses versions of the protocol which are not supported
+    test(
+        "hello",
+        &[
+            (
+                "hello 3\r\n",
+                Some("%7\r\n$6\r\nserver\r\n$7\r\npelikan\r\n"),
+            ),
+            (
+                "hello 2\r\n",
+                Some("*14\r\n$6\r\nserver\r\n$7\r\npelikan\r\n"),
+            ),
+            (
+                "hello 4\r\n",
+                Some("-NOPROTO unsupported protocol version\r\n"),
+            ),
+        ],
+    );
+
     // check that we can store and retrieve a key
     test(
         "set and get",
@@ -30,6 +50,113 @@ pub fn tests() {
         ],
     );
 
+    // check that multiple keys can be stored and retrieved at once
+    test(
+        "mset and mget",
+        &[
+            ("mset 1 one 2 two\r\n", Some(RESP_OK)),
+            (
+                "mget 1 3 2\r\n",
+                Some(&format!(
+                    "*3\r\n{}{RESP_NIL}{}",
+                    bulk_string("one"),
+                    bulk_string("two")
+                )),
+            ),
+            ("exists 1 2 3 1\r\n", Some(&integer(3))),
+            ("del 1 3\r\n", Some(&integer(1))),
+            ("exists 1 2\r\n", Some(&integer(1))),
+        ],
+    );
+
+    // check that integers can be incremented and decremented, where a key
+    // which does not exist is treated as zero
+    test(
+        "incrby and decrby",
+        &[
+            ("incrby 4 10\r\n", Some(&integer(10))),
+            ("incrby 4 5\r\n", Some(&integer(15))),
+            ("decrby 4 20\r\n", Some(&integer(-5))),
+            ("get 4\r\n", Some(&bulk_string("-5"))),
+        ],
+    );
+
+    // check that the expiry of a key can be changed and read back
+    test(
+        "expire and ttl",
+        &[
+            ("set 5 five\r\n", Some(RESP_OK)),
+            ("ttl 5\r\n", Some(&integer(-1))),
+            ("ttl 6\r\n", Some(&integer(-2))),
+            ("expire 6 60\r\n", Some(&integer(0))),
+            ("getex 5 EX 60\r\n", Some(&bulk_string("five"))),
+            ("getex 5 PERSIST\r\n", Some(&bulk_string("five"))),
+            ("ttl 5\r\n", Some(&integer(-1))),
+            ("expire 5 0\r\n", Some(&integer(1))),
+            ("get 5\r\n", Some(RESP_NIL)),
+        ],
+    );
+
+    // check that the fields of a hash can be stored and retrieved
+    test(
+        "hset and hget",
+        &[
+            ("hset 7 name alice age 30\r\n", Some(&integer(2))),
+            ("hget 7 name\r\n", Some(&bulk_string("alice"))),
+            ("hset 7 age 31\r\n", Some(&integer(0))),
+            ("hincrby 7 age 1\r\n", Some(&integer(32))),
+            ("hlen 7\r\n", Some(&integer(2))),
+            ("hdel 7 name\r\n", Some(&integer(1))),
+            ("hget 7 name\r\n", Some(RESP_NIL)),
+            (
+                "get 7\r\n",
+                Some("-WRONGTYPE Operation against a key holding the wrong kind of value\r\n"),
+            ),
+        ],
+    );
+
+    // check that elements can be pushed to and popped from either end of a
+    // list, and that an emptied list is removed
+    test(
+        "lpush and lrange",
+        &[
+            ("rpush 8 b c\r\n", Some(&integer(2))),
+            ("lpush 8 a\r\n", Some(&integer(3))),
+            (
+                "lrange 8 0 -1\r\n",
+                Some(&format!(
+                    "*3\r\n{}{}{}",
+                    bulk_string("a"),
+                    bulk_string("b"),
+                    bulk_string("c")
+                )),
+            ),
+            ("lindex 8 -1\r\n", Some(&bulk_string("c"))),
+            ("ltrim 8 1 -1\r\n", Some(RESP_OK)),
+            ("lpop 8\r\n", Some(&bulk_string("b"))),
+            ("rpop 8\r\n", Some(&bulk_string("c"))),
+            ("llen 8\r\n", Some(&integer(0))),
+            ("exists 8\r\n", Some(&integer(0))),
+        ],
+    );
+
+    // check that members can be added to sets and that sets can be combined
+    test(
+        "sadd and sinter",
+        &[
+            ("sadd 9 1 2 3\r\n", Some(&integer(3))),
+            ("sadd 10 2 three\r\n", Some(&integer(2))),
+            ("sismember 9 2\r\n", Some(&integer(1))),
+            ("sismember 10 3\r\n", Some(&integer(0))),
+            (
+                "sinter 9 10\r\n",
+                Some(&format!("*1\r\n{}", bulk_string("2"))),
+            ),
+            ("srem 10 2 three\r\n", Some(&integer(2))),
+            ("exists 10\r\n", Some(&integer(0))),
+        ],
+    );
+
     std::thread::sleep(Duration::from_millis(500));
 }
 
@@ -191,3 +318,7 @@ fn bulk_string(str: &str) -> String {
     let length = str.as_bytes().len();
     format!("${length}\r\n{str}\r\n")
 }
+
+fn integer(value: i64) -> String {
+    format!(":{value}\r\n")
+}
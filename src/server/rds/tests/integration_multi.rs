@@ -15,6 +15,8 @@ use crate::common::*;
 use config::{RdsConfig, WorkerConfig};
 use pelikan_rds::Rds;
 
+use std::io::{Read, Write};
+use std::net::TcpStream;
 use std::time::Duration;
 
 fn main() {
@@ -29,6 +31,8 @@ fn main() {
 
     tests();
 
+    tracking_tests();
+
     admin_tests();
 
     // shutdown server and join
@@ -37,3 +41,51 @@ fn main() {
 
     info!("passed!");
 }
+
+// a session which tracks the keys it reads is told once another session
+// writes one of them, and only the first time
+fn tracking_tests() {
+    info!("testing: client tracking");
+
+    let mut tracking = connect();
+    let mut writer = connect();
+
+    exchange(&mut tracking, "client tracking on\r\n", "+OK\r\n");
+    exchange(&mut tracking, "get tracked\r\n", "$-1\r\n");
+
+    exchange(&mut writer, "set tracked value\r\n", "+OK\r\n");
+    expect(
+        &mut tracking,
+        ">2\r\n$10\r\ninvalidate\r\n*1\r\n$7\r\ntracked\r\n",
+    );
+
+    // the key is no longer tracked until it is read again
+    exchange(&mut writer, "set tracked other\r\n", "+OK\r\n");
+    let mut buf = [0; 64];
+    assert!(tracking.read(&mut buf).is_err(), "unexpected push");
+
+    info!("status: passed\n");
+}
+
+fn connect() -> TcpStream {
+    let stream = TcpStream::connect("127.0.0.1:12321").expect("failed to connect");
+    stream
+        .set_read_timeout(Some(Duration::from_millis(250)))
+        .expect("failed to set read timeout");
+    stream
+}
+
+fn exchange(stream: &mut TcpStream, request: &str, response: &str) {
+    stream
+        .write_all(request.as_bytes())
+        .expect("failed to send request");
+    expect(stream, response);
+}
+
+fn expect(stream: &mut TcpStream, response: &str) {
+    let mut buf = vec![0; response.len()];
+    stream
+        .read_exact(&mut buf)
+        .expect("failed to read response");
+    assert_eq!(std::str::from_utf8(&buf).unwrap(), response);
+}
@@ -4,16 +4,25 @@
 
 //! Segcache is a cache implementation which used segment based storage and uses
 //! a subset of the Memcache protocol. Segment based storage allows us to
-//! perform efficient eager expiration of items.
+//! perform efficient eager expiration of items. The server port may instead
+//! speak a simple HTTP key-value protocol, see [`protocol_http`], or RESP, see
+//! [`protocol_resp`]. With more than one listener, each speaks its own
+//! protocol, and all of them share the same storage.
 
+use config::segcache::Protocol;
 use config::*;
-use entrystore::Seg;
+#[cfg(not(feature = "noop"))]
+use entrystore::{Seg, SharedSeg};
 use logger::*;
-use protocol_memcache::{Request, RequestParser, Response};
+use protocol_common::{
+    Compose, Datagram, Deadline, Execute, Parse, Quiet, Replicate, Shard, Timed, Track,
+};
+#[cfg(not(feature = "noop"))]
+use server::Reloader;
 use server::{Process, ProcessBuilder};
+use std::net::SocketAddr;
 
-type Parser = RequestParser;
-type Storage = Seg;
+mod protocols;
 
 /// This structure represents a running `Segcache` process.
 #[allow(dead_code)]
@@ -30,22 +39,101 @@ impl Segcache {
         // initialize metrics
         common::metrics::init();
 
-        // initialize storage
-        let storage = Storage::new(&config)?;
+        // take over the listeners of an older process being upgraded, which
+        // saves the storage restored below as it exits
+        server::inherit(&config)?;
 
-        // initialize parser
-        let parser = Parser::new()
-            .max_value_size(config.seg().segment_size() as usize)
+        // values must fit in a segment, unless they may be stored in chunks,
+        // which allows them up to half of the heap of a shard
+        let max_value_size = if config.seg().large_values() {
+            config.seg().heap_size() / config.seg().shards().max(1) / 2
+        } else {
+            config.seg().segment_size() as usize
+        };
+
+        let memcache_parser = protocol_memcache::RequestParser::new()
+            .max_value_size(max_value_size)
             .time_type(config.time().time_type());
 
-        // initialize process
-        let process_builder = ProcessBuilder::<Parser, Request, Response, Storage>::new(
-            &config, log_drain, parser, storage,
-        )?
-        .version(env!("CARGO_PKG_VERSION"));
+        // the addresses of the listeners besides the one for the server port
+        let listeners = config
+            .listeners()
+            .iter()
+            .map(|listener| {
+                listener
+                    .socket_addr()
+                    .map_err(|e| std::io::Error::new(std::io::ErrorKind::InvalidInput, e))
+            })
+            .collect::<Result<Vec<SocketAddr>, std::io::Error>>()?;
+
+        // initialize parser and process for the configured protocol, or for
+        // the protocol of each listener if there is more than one
+        let process = if !listeners.is_empty() {
+            // the replication stream is in the wire format of one protocol
+            let replication = config.replication();
+            if replication.listen().is_some() || replication.primary().is_some() {
+                return Err(std::io::Error::new(
+                    std::io::ErrorKind::InvalidInput,
+                    "replication is not supported with more than one listener",
+                ));
+            }
+
+            let protocols: Vec<Protocol> = std::iter::once(config.protocol())
+                .chain(
+                    config
+                        .listeners()
+                        .iter()
+                        .map(|listener| listener.protocol()),
+                )
+                .collect();
+            let parser = protocols::RequestParser::new(memcache_parser, &protocols);
+
+            spawn::<_, protocols::Request, protocols::Response>(
+                &config,
+                log_drain,
+                parser.clone(),
+                parser,
+                &listeners,
+            )?
+        } else {
+            match config.protocol() {
+                Protocol::Memcache => {
+                    // the stream from a primary carries ttls as a number of
+                    // seconds
+                    let replica_parser = memcache_parser.time_type(TimeType::Delta);
 
-        // spawn threads
-        let process = process_builder.spawn();
+                    spawn::<_, protocol_memcache::Request, protocol_memcache::Response>(
+                        &config,
+                        log_drain,
+                        memcache_parser,
+                        replica_parser,
+                        &listeners,
+                    )?
+                }
+                Protocol::Resp => {
+                    let parser = protocol_resp::RequestParser::new();
+
+                    spawn::<_, protocol_resp::Request, protocol_resp::Response>(
+                        &config,
+                        log_drain,
+                        parser.clone(),
+                        parser,
+                        &listeners,
+                    )?
+                }
+                Protocol::Http => {
+                    let parser = protocol_http::RequestParser::new();
+
+                    spawn::<_, protocol_http::ParseData, protocol_http::Response>(
+                        &config,
+                        log_drain,
+                        parser.clone(),
+                        parser,
+                        &listeners,
+                    )?
+                }
+            }
+        };
 
         Ok(Self { process })
     }
@@ -64,4 +152,124 @@ impl Segcache {
     }
 }
 
+/// Initializes storage and spawns the process. With multiple shards, or with
+/// partitions, each worker thread executes requests against the shared storage directly, while
+/// with multiple storage threads each owns one shard of the storage. The
+/// replica parser is used for the stream of writes from a primary, and the
+/// listeners are the addresses which are accepted on besides the server port.
+#[cfg(not(feature = "noop"))]
+fn spawn<Parser, Request, Response>(
+    config: &SegcacheConfig,
+    log_drain: Box<dyn Drain>,
+    parser: Parser,
+    replica_parser: Parser,
+    listeners: &[SocketAddr],
+) -> Result<Process, std::io::Error>
+where
+    Parser: 'static + Parse<Request> + Clone + Send,
+    Request: 'static
+        + Datagram
+        + Deadline<Response>
+        + Klog<Response = Response>
+        + Replicate<Response>
+        + Shard<Response>
+        + Quiet
+        + Timed
+        + Track<Response>
+        + Send,
+    Response: 'static + Compose + Send,
+    Seg: Execute<Request, Response>,
+    SharedSeg: Execute<Request, Response>,
+{
+    let process = if config.seg().shards() > 1 || !config.seg().partitions().is_empty() {
+        let storage = SharedSeg::new(config)?;
+
+        ProcessBuilder::<Parser, Request, Response, SharedSeg>::shared(
+            config, log_drain, parser, storage,
+        )?
+        .listen(config, listeners)?
+        .replication(config, replica_parser)?
+        .reloader(reloader(config))
+        .version(env!("CARGO_PKG_VERSION"))
+        .spawn()
+    } else if config.worker().storage_threads() > 1 {
+        let (router, storage) = Seg::shards(config, config.worker().storage_threads())?;
+
+        ProcessBuilder::<Parser, Request, Response, Seg>::sharded(
+            config, log_drain, parser, storage, router,
+        )?
+        .listen(config, listeners)?
+        .replication(config, replica_parser)?
+        .reloader(reloader(config))
+        .version(env!("CARGO_PKG_VERSION"))
+        .spawn()
+    } else {
+        let storage = Seg::new(config)?;
+
+        ProcessBuilder::<Parser, Request, Response, Seg>::new(config, log_drain, parser, storage)?
+            .listen(config, listeners)?
+            .replication(config, replica_parser)?
+            .reloader(reloader(config))
+            .version(env!("CARGO_PKG_VERSION"))
+            .spawn()
+    };
+
+    Ok(process)
+}
+
+/// Spawns the process with `Noop` storage, which answers every request with a
+/// canned response, so that the throughput of the process is that of the
+/// listener, the workers, and the parsing and composing of the protocol. The
+/// requests are still handed to a storage thread, as they are for a single
+/// instance of segcache storage, and replication is not started.
+#[cfg(feature = "noop")]
+fn spawn<Parser, Request, Response>(
+    config: &SegcacheConfig,
+    log_drain: Box<dyn Drain>,
+    parser: Parser,
+    _replica_parser: Parser,
+    listeners: &[SocketAddr],
+) -> Result<Process, std::io::Error>
+where
+    Parser: 'static + Parse<Request> + Clone + Send,
+    Request: 'static
+        + Datagram
+        + Deadline<Response>
+        + Klog<Response = Response>
+        + Replicate<Response>
+        + Shard<Response>
+        + Quiet
+        + Timed
+        + Track<Response>
+        + Send,
+    Response: 'static + Compose + Send,
+    entrystore::Noop: Execute<Request, Response>,
+{
+    let process = ProcessBuilder::<Parser, Request, Response, entrystore::Noop>::new(
+        config,
+        log_drain,
+        parser,
+        entrystore::Noop::new(),
+    )?
+    .listen(config, listeners)?
+    .version(env!("CARGO_PKG_VERSION"))
+    .spawn();
+
+    Ok(process)
+}
+
 common::metrics::test_no_duplicates!();
+
+/// Returns a reloader which reads the tunables from the file the config was
+/// loaded from.
+#[cfg(not(feature = "noop"))]
+fn reloader(config: &SegcacheConfig) -> Reloader {
+    let file = config.file().map(str::to_owned);
+    Box::new(move || match &file {
+        Some(file) => SegcacheConfig::load(file).map(|config| config.tunables()),
+        None => Err(std::io::Error::new(
+            std::io::ErrorKind::NotFound,
+            "config was not loaded from a file",
+        )),
+    })
+}
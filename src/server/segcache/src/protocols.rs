@@ -0,0 +1,430 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Requests and responses of any of the protocols which segcache speaks, so
+//! that one process with one storage can serve a different protocol on each
+//! of its listeners. The parser for a session is picked by the index of the
+//! listener which accepted it, and every request is executed against the
+//! storage with the implementation for its own protocol.
+
+use config::segcache::Protocol;
+use entrystore::{Seg, SharedSeg};
+use logger::Klog;
+use protocol_common::*;
+use std::sync::Arc;
+
+/// A request of any of the protocols.
+pub enum Request {
+    Memcache(protocol_memcache::Request),
+    Resp(protocol_resp::Request),
+    Http(protocol_http::ParseData),
+}
+
+/// A response of any of the protocols, which is always of the same protocol
+/// as its request.
+pub enum Response {
+    Memcache(protocol_memcache::Response),
+    Resp(protocol_resp::Response),
+    Http(protocol_http::Response),
+}
+
+#[derive(Clone)]
+enum Parser {
+    Memcache(protocol_memcache::RequestParser),
+    Resp(protocol_resp::RequestParser),
+    Http(protocol_http::RequestParser),
+}
+
+/// Parses the requests of the protocol of the listener which accepted the
+/// session.
+#[derive(Clone)]
+pub struct RequestParser {
+    parser: Parser,
+    // the parser for each listener, by its index
+    listeners: Arc<[Parser]>,
+}
+
+impl RequestParser {
+    /// Creates a parser for listeners which speak each of the protocols, in
+    /// the order of their indices, where requests for memcache are parsed
+    /// with the memcache parser which is given.
+    pub fn new(memcache: protocol_memcache::RequestParser, protocols: &[Protocol]) -> Self {
+        let listeners: Arc<[Parser]> = protocols
+            .iter()
+            .map(|protocol| match protocol {
+                Protocol::Memcache => Parser::Memcache(memcache),
+                Protocol::Resp => Parser::Resp(protocol_resp::RequestParser::new()),
+                Protocol::Http => Parser::Http(protocol_http::RequestParser::new()),
+            })
+            .collect();
+
+        Self {
+            parser: listeners[0].clone(),
+            listeners,
+        }
+    }
+}
+
+fn wrap<T>(
+    result: Result<ParseOk<T>, std::io::Error>,
+    f: impl Fn(T) -> Request,
+) -> Result<ParseOk<Request>, std::io::Error> {
+    result.map(|ok| {
+        let consumed = ok.consumed();
+        ParseOk::new(f(ok.into_inner()), consumed)
+    })
+}
+
+impl Parse<Request> for RequestParser {
+    fn parse(&self, buffer: &[u8]) -> Result<ParseOk<Request>, std::io::Error> {
+        match &self.parser {
+            Parser::Memcache(parser) => wrap(parser.parse(buffer), Request::Memcache),
+            Parser::Resp(parser) => wrap(parser.parse(buffer), Request::Resp),
+            Parser::Http(parser) => wrap(parser.parse(buffer), Request::Http),
+        }
+    }
+
+    fn parse_header(&self, buffer: &[u8], min: usize) -> Option<ParseHeader<Request>> {
+        match &self.parser {
+            Parser::Memcache(parser) => parser.parse_header(buffer, min).map(|header| {
+                let consumed = header.consumed();
+                let value = header.value();
+                let trailer = header.trailer();
+                ParseHeader::new(
+                    Request::Memcache(header.into_inner()),
+                    consumed,
+                    value,
+                    trailer,
+                )
+            }),
+            Parser::Resp(_) | Parser::Http(_) => None,
+        }
+    }
+
+    fn for_listener(&self, listener: usize) -> Self {
+        Self {
+            parser: self
+                .listeners
+                .get(listener)
+                .unwrap_or(&self.listeners[0])
+                .clone(),
+            listeners: self.listeners.clone(),
+        }
+    }
+}
+
+impl Compose for Response {
+    fn compose(&self, dst: &mut dyn BufMut) -> usize {
+        match self {
+            Self::Memcache(response) => response.compose(dst),
+            Self::Resp(response) => response.compose(dst),
+            Self::Http(response) => response.compose(dst),
+        }
+    }
+
+    fn compose_vectored(&self, dst: &mut dyn Vectored) -> usize {
+        match self {
+            Self::Memcache(response) => response.compose_vectored(dst),
+            Self::Resp(response) => response.compose_vectored(dst),
+            Self::Http(response) => response.compose_vectored(dst),
+        }
+    }
+
+    fn should_hangup(&self) -> bool {
+        match self {
+            Self::Memcache(response) => response.should_hangup(),
+            Self::Resp(response) => response.should_hangup(),
+            Self::Http(response) => response.should_hangup(),
+        }
+    }
+}
+
+impl Klog for Request {
+    type Response = Response;
+
+    fn klog(&self, response: &Response) {
+        match (self, response) {
+            (Self::Memcache(request), Response::Memcache(response)) => request.klog(response),
+            (Self::Resp(request), Response::Resp(response)) => request.klog(response),
+            (Self::Http(request), Response::Http(response)) => request.klog(response),
+            _ => {}
+        }
+    }
+}
+
+impl Timed for Request {
+    fn latencies(&self) -> &'static Latencies {
+        match self {
+            Self::Memcache(request) => request.latencies(),
+            Self::Resp(request) => request.latencies(),
+            Self::Http(request) => request.latencies(),
+        }
+    }
+}
+
+impl Datagram for Request {
+    fn is_datagram(&self) -> bool {
+        match self {
+            Self::Memcache(request) => request.is_datagram(),
+            Self::Resp(request) => request.is_datagram(),
+            Self::Http(request) => request.is_datagram(),
+        }
+    }
+}
+
+impl Deadline<Response> for Request {
+    fn expired(&self) -> Option<Response> {
+        match self {
+            Self::Memcache(request) => request.expired().map(Response::Memcache),
+            Self::Resp(request) => request.expired().map(Response::Resp),
+            Self::Http(request) => request.expired().map(Response::Http),
+        }
+    }
+}
+
+// Only resp sessions can turn tracking on, so every session which is told of
+// changed keys speaks resp.
+impl Track<Response> for Request {
+    fn tracking(&self) -> Option<(bool, Response)> {
+        match self {
+            Self::Resp(request) => request
+                .tracking()
+                .map(|(enabled, response)| (enabled, Response::Resp(response))),
+            _ => None,
+        }
+    }
+
+    fn reads(&self, f: &mut dyn FnMut(&[u8])) {
+        match self {
+            Self::Memcache(request) => request.reads(f),
+            Self::Resp(request) => request.reads(f),
+            Self::Http(request) => request.reads(f),
+        }
+    }
+
+    fn writes(&self, f: &mut dyn FnMut(&[u8])) {
+        match self {
+            Self::Memcache(request) => request.writes(f),
+            Self::Resp(request) => request.writes(f),
+            Self::Http(request) => request.writes(f),
+        }
+    }
+
+    fn invalidate(keys: &[&[u8]]) -> Option<Response> {
+        protocol_resp::Request::invalidate(keys).map(Response::Resp)
+    }
+}
+
+impl Quiet for Request {
+    fn quiet(&self) -> bool {
+        match self {
+            Self::Memcache(request) => request.quiet(),
+            Self::Resp(request) => request.quiet(),
+            Self::Http(request) => request.quiet(),
+        }
+    }
+}
+
+impl Replicate<Response> for Request {
+    fn replicate(&self, response: &Response, dst: &mut dyn BufMut) -> bool {
+        match (self, response) {
+            (Self::Memcache(request), Response::Memcache(response)) => {
+                request.replicate(response, dst)
+            }
+            (Self::Resp(request), Response::Resp(response)) => request.replicate(response, dst),
+            (Self::Http(request), Response::Http(response)) => request.replicate(response, dst),
+            _ => false,
+        }
+    }
+}
+
+impl Shard<Response> for Request {
+    fn shard_key(&self) -> Option<&[u8]> {
+        match self {
+            Self::Memcache(request) => request.shard_key(),
+            Self::Resp(request) => request.shard_key(),
+            Self::Http(request) => request.shard_key(),
+        }
+    }
+
+    fn split(&self, shard: &dyn Fn(&[u8]) -> usize) -> Option<Vec<(usize, Self)>> {
+        match self {
+            Self::Memcache(request) => request.split(shard).map(|parts| {
+                parts
+                    .into_iter()
+                    .map(|(id, part)| (id, Self::Memcache(part)))
+                    .collect()
+            }),
+            Self::Resp(request) => request.split(shard).map(|parts| {
+                parts
+                    .into_iter()
+                    .map(|(id, part)| (id, Self::Resp(part)))
+                    .collect()
+            }),
+            Self::Http(request) => request.split(shard).map(|parts| {
+                parts
+                    .into_iter()
+                    .map(|(id, part)| (id, Self::Http(part)))
+                    .collect()
+            }),
+        }
+    }
+
+    fn merge(&self, responses: Vec<Response>, shard: &dyn Fn(&[u8]) -> usize) -> Response {
+        // the responses to the parts of a request are of its own protocol
+        match self {
+            Self::Memcache(request) => Response::Memcache(
+                request.merge(
+                    responses
+                        .into_iter()
+                        .filter_map(|response| match response {
+                            Response::Memcache(response) => Some(response),
+                            _ => None,
+                        })
+                        .collect(),
+                    shard,
+                ),
+            ),
+            Self::Resp(request) => Response::Resp(
+                request.merge(
+                    responses
+                        .into_iter()
+                        .filter_map(|response| match response {
+                            Response::Resp(response) => Some(response),
+                            _ => None,
+                        })
+                        .collect(),
+                    shard,
+                ),
+            ),
+            Self::Http(request) => Response::Http(
+                request.merge(
+                    responses
+                        .into_iter()
+                        .filter_map(|response| match response {
+                            Response::Http(response) => Some(response),
+                            _ => None,
+                        })
+                        .collect(),
+                    shard,
+                ),
+            ),
+        }
+    }
+
+    fn hot_key(&self) -> Option<&[u8]> {
+        match self {
+            Self::Memcache(request) => request.hot_key(),
+            Self::Resp(request) => request.hot_key(),
+            Self::Http(request) => request.hot_key(),
+        }
+    }
+
+    fn hot_copy(&self, response: &Response) -> Option<HotCopy> {
+        match (self, response) {
+            (Self::Memcache(request), Response::Memcache(response)) => request.hot_copy(response),
+            (Self::Resp(request), Response::Resp(response)) => request.hot_copy(response),
+            (Self::Http(request), Response::Http(response)) => request.hot_copy(response),
+            _ => None,
+        }
+    }
+
+    fn from_hot_copy(&self, copy: &HotCopy) -> Option<Response> {
+        match self {
+            Self::Memcache(request) => request.from_hot_copy(copy).map(Response::Memcache),
+            Self::Resp(request) => request.from_hot_copy(copy).map(Response::Resp),
+            Self::Http(request) => request.from_hot_copy(copy).map(Response::Http),
+        }
+    }
+}
+
+/// Executes each request with the implementation for its own protocol.
+fn execute<S>(storage: &mut S, request: &Request) -> Response
+where
+    S: Execute<protocol_memcache::Request, protocol_memcache::Response>
+        + Execute<protocol_resp::Request, protocol_resp::Response>
+        + Execute<protocol_http::ParseData, protocol_http::Response>,
+{
+    match request {
+        Request::Memcache(request) => Response::Memcache(storage.execute(request)),
+        Request::Resp(request) => Response::Resp(storage.execute(request)),
+        Request::Http(request) => Response::Http(storage.execute(request)),
+    }
+}
+
+impl Execute<Request, Response> for Seg {
+    fn execute(&mut self, request: &Request) -> Response {
+        execute(self, request)
+    }
+
+    // only the values of memcache requests are read straight into storage
+
+    fn reserve(&mut self, request: &Request, len: usize) -> Option<usize> {
+        match request {
+            Request::Memcache(request) => memcache(self).reserve(request, len),
+            Request::Resp(_) | Request::Http(_) => None,
+        }
+    }
+
+    fn reserved(&mut self, id: usize) -> &mut [u8] {
+        memcache(self).reserved(id)
+    }
+
+    fn commit(&mut self, id: usize, request: &Request) -> Option<Response> {
+        match request {
+            Request::Memcache(request) => {
+                memcache(self).commit(id, request).map(Response::Memcache)
+            }
+            Request::Resp(_) | Request::Http(_) => None,
+        }
+    }
+
+    fn abort(&mut self, id: usize) {
+        memcache(self).abort(id)
+    }
+}
+
+/// Returns the storage as the storage for memcache requests alone.
+fn memcache(
+    storage: &mut Seg,
+) -> &mut impl Execute<protocol_memcache::Request, protocol_memcache::Response> {
+    storage
+}
+
+impl Execute<Request, Response> for SharedSeg {
+    fn execute(&mut self, request: &Request) -> Response {
+        execute(self, request)
+    }
+}
+
+#[cfg(feature = "noop")]
+impl Execute<Request, Response> for entrystore::Noop {
+    fn execute(&mut self, request: &Request) -> Response {
+        execute(self, request)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parser_for_listener() {
+        let parser = RequestParser::new(
+            protocol_memcache::RequestParser::new(),
+            &[Protocol::Memcache, Protocol::Resp],
+        );
+
+        let memcache = parser.for_listener(0);
+        let request = memcache.parse(b"get coffee\r\n").unwrap().into_inner();
+        assert!(matches!(request, Request::Memcache(_)));
+
+        let resp = parser.for_listener(1);
+        let request = resp
+            .parse(b"*2\r\n$3\r\nget\r\n$6\r\ncoffee\r\n")
+            .unwrap()
+            .into_inner();
+        assert!(matches!(request, Request::Resp(_)));
+    }
+}
@@ -31,6 +31,16 @@ pub fn tests() {
         ],
     );
 
+    // writes with noreply are answered with nothing, even if they fail
+    test(
+        "noreply",
+        &[
+            ("set quiet 0 0 1 noreply\r\n1\r\n", None),
+            ("add quiet 0 0 1 noreply\r\n2\r\n", None),
+            ("get quiet\r\n", Some("VALUE quiet 0 1\r\n1\r\nEND\r\n")),
+        ],
+    );
+
     test(
         "cas not_found",
         &[
@@ -195,11 +205,131 @@ pub fn tests() {
         ],
     );
 
-    // test unsupported commands
-    test("append", &[("append 7 0 0 1\r\n0\r\n", Some("ERROR\r\n"))]);
+    // test multi-key get, which may be split across storage shards
+    test(
+        "multi get",
+        &[
+            ("set 19 0 0 1\r\n1\r\n", Some("STORED\r\n")),
+            ("set 20 0 0 1\r\n2\r\n", Some("STORED\r\n")),
+            ("set 22 0 0 1\r\n4\r\n", Some("STORED\r\n")),
+            (
+                "get 19 20 21 22\r\n",
+                Some("VALUE 19 0 1\r\n1\r\nVALUE 20 0 1\r\n2\r\nVALUE 22 0 1\r\n4\r\nEND\r\n"),
+            ),
+        ],
+    );
+
+    // test the meta commands
+    test("meta get miss", &[("mg m1 v\r\n", Some("EN\r\n"))]);
+    test(
+        "meta set and get",
+        &[
+            ("ms m2 2 F5\r\nhi\r\n", Some("HD\r\n")),
+            ("mg m2 v f k\r\n", Some("VA 2 f5 km2\r\nhi\r\n")),
+            // add does not replace the key
+            ("ms m2 1 ME\r\n0\r\n", Some("NS\r\n")),
+            ("md m2\r\n", Some("HD\r\n")),
+            ("md m2\r\n", Some("NF\r\n")),
+        ],
+    );
+    test(
+        "meta quiet",
+        &[(
+            "ms m3 1 q\r\n1\r\nmg m3 v q\r\nmg m4 v q\r\nmn\r\n",
+            Some("VA 1\r\n1\r\nMN\r\n"),
+        )],
+    );
+    test(
+        "meta arithmetic",
+        &[
+            ("ma m5 v\r\n", Some("NF\r\n")),
+            // autovivify with an initial value
+            ("ma m5 N0 J10 v\r\n", Some("VA 2\r\n10\r\n")),
+            ("ma m5 D5 v\r\n", Some("VA 2\r\n15\r\n")),
+            ("ma m5 MD D20 v\r\n", Some("VA 1\r\n0\r\n")),
+        ],
+    );
+    test(
+        "meta vivify",
+        &[
+            // the first client to miss wins the right to fill the key
+            ("mg m6 v N30\r\n", Some("EN W\r\n")),
+            ("mg m6 v N30\r\n", Some("VA 0 Z\r\n\r\n")),
+            ("ms m6 1\r\n6\r\n", Some("HD\r\n")),
+            ("mg m6 v\r\n", Some("VA 1\r\n6\r\n")),
+        ],
+    );
+    test(
+        "meta invalidate",
+        &[
+            ("ms m7 1\r\n7\r\n", Some("HD\r\n")),
+            ("md m7 I\r\n", Some("HD\r\n")),
+            // a stale item is served while the first client recaches it
+            ("mg m7 v\r\n", Some("VA 1 W X\r\n7\r\n")),
+            ("mg m7 v\r\n", Some("VA 1 X Z\r\n7\r\n")),
+            ("ms m7 1\r\n8\r\n", Some("HD\r\n")),
+            ("mg m7 v\r\n", Some("VA 1\r\n8\r\n")),
+        ],
+    );
+
+    // binary requests are served on the same port, with quiet requests only
+    // responding when they have something to report
+    test_bytes(
+        "binary quiet pipeline",
+        &[
+            (
+                &binary(0x11, &[0, 0, 0, 5, 0, 0, 0, 0], b"b1", b"one", 1),
+                None,
+            ),
+            (&binary(0x0d, &[], b"b2", b"", 2), None),
+            (
+                &binary(0x0a, &[], b"", b"", 3),
+                Some(&binary_response(0x0a, 0, b"", 3)),
+            ),
+            (b"get b1\r\n", Some(b"VALUE b1 5 3\r\none\r\nEND\r\n")),
+        ],
+    );
+    test_bytes(
+        "binary errors",
+        &[
+            (
+                &binary(0x04, &[], b"b3", b"", 4),
+                Some(&binary_response(0x04, 0x0001, b"Not found", 4)),
+            ),
+            (
+                &binary(0x20, &[], b"", b"", 5),
+                Some(&binary_response(0x20, 0x0081, b"Unknown command", 5)),
+            ),
+        ],
+    );
+
+    test(
+        "append",
+        &[
+            ("append ap 0 0 1\r\n0\r\n", Some("NOT_STORED\r\n")),
+            ("set ap 3 0 3\r\nabc\r\n", Some("STORED\r\n")),
+            ("append ap 0 0 2\r\nde\r\n", Some("STORED\r\n")),
+            ("get ap\r\n", Some("VALUE ap 3 5\r\nabcde\r\nEND\r\n")),
+        ],
+    );
     test(
         "prepend",
-        &[("prepend 8 0 0 1\r\n0\r\n", Some("ERROR\r\n"))],
+        &[
+            ("prepend pp 0 0 1\r\n0\r\n", Some("NOT_STORED\r\n")),
+            ("set pp 0 0 2\r\n12\r\n", Some("STORED\r\n")),
+            ("prepend pp 0 0 1\r\n3\r\n", Some("STORED\r\n")),
+            ("incr pp 1\r\n", Some("313\r\n")),
+        ],
+    );
+    test(
+        "touch",
+        &[
+            ("touch tt 60\r\n", Some("NOT_FOUND\r\n")),
+            ("set tt 2 0 1\r\nt\r\n", Some("STORED\r\n")),
+            ("touch tt 60\r\n", Some("TOUCHED\r\n")),
+            ("gat 3600 tt\r\n", Some("VALUE tt 2 1\r\nt\r\nEND\r\n")),
+            ("gat 3600 missing\r\n", Some("END\r\n")),
+        ],
     );
 
     std::thread::sleep(Duration::from_millis(500));
@@ -208,6 +338,43 @@ pub fn tests() {
 // opens a new connection, operating on request + response pairs from the
 // provided data.
 fn test(name: &str, data: &[(&str, Option<&str>)]) {
+    let data: Vec<(&[u8], Option<&[u8]>)> = data
+        .iter()
+        .map(|(request, response)| (request.as_bytes(), response.map(|r| r.as_bytes())))
+        .collect();
+    test_bytes(name, &data)
+}
+
+// composes a binary request with the provided opcode, extras, key, value and
+// opaque
+fn binary(opcode: u8, extras: &[u8], key: &[u8], value: &[u8], opaque: u32) -> Vec<u8> {
+    let mut buf = vec![0x80, opcode];
+    buf.extend_from_slice(&(key.len() as u16).to_be_bytes());
+    buf.extend_from_slice(&[extras.len() as u8, 0, 0, 0]);
+    buf.extend_from_slice(&((extras.len() + key.len() + value.len()) as u32).to_be_bytes());
+    buf.extend_from_slice(&opaque.to_be_bytes());
+    buf.extend_from_slice(&[0; 8]);
+    buf.extend_from_slice(extras);
+    buf.extend_from_slice(key);
+    buf.extend_from_slice(value);
+    buf
+}
+
+// composes a binary response with the provided opcode, status, value and
+// opaque, which has no extras, key or cas
+fn binary_response(opcode: u8, status: u16, value: &[u8], opaque: u32) -> Vec<u8> {
+    let mut buf = vec![0x81, opcode, 0, 0, 0, 0];
+    buf.extend_from_slice(&status.to_be_bytes());
+    buf.extend_from_slice(&(value.len() as u32).to_be_bytes());
+    buf.extend_from_slice(&opaque.to_be_bytes());
+    buf.extend_from_slice(&[0; 8]);
+    buf.extend_from_slice(value);
+    buf
+}
+
+// opens a new connection, operating on request + response pairs of raw bytes
+// from the provided data.
+fn test_bytes(name: &str, data: &[(&[u8], Option<&[u8]>)]) {
     info!("testing: {}", name);
     debug!("connecting to server");
     let mut stream = TcpStream::connect("127.0.0.1:12321").expect("failed to connect");
@@ -220,7 +387,7 @@ fn test(name: &str, data: &[(&str, Option<&str>)]) {
 
     debug!("sending request");
     for (request, response) in data {
-        match stream.write(request.as_bytes()) {
+        match stream.write(request) {
             Ok(bytes) => {
                 if bytes == request.len() {
                     debug!("full request sent");
@@ -242,15 +409,15 @@ fn test(name: &str, data: &[(&str, Option<&str>)]) {
             if stream.read(&mut buf).is_err() {
                 std::thread::sleep(Duration::from_millis(500));
                 panic!("error reading response");
-            } else if response.as_bytes() != &buf[0..response.len()] {
-                error!("expected: {:?}", response.as_bytes());
+            } else if *response != &buf[0..response.len()] {
+                error!("expected: {:?}", response);
                 error!("received: {:?}", &buf[0..response.len()]);
                 std::thread::sleep(Duration::from_millis(500));
                 panic!("status: failed\n");
             } else {
                 debug!("correct response");
             }
-            assert_eq!(response.as_bytes(), &buf[0..response.len()]);
+            assert_eq!(*response, &buf[0..response.len()]);
         } else if let Err(e) = stream.read(&mut buf) {
             if e.kind() == std::io::ErrorKind::WouldBlock {
                 debug!("got no response");
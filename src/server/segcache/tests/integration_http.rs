@@ -0,0 +1,177 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! This test module runs a set of HTTP integration tests against an instance
+//! of Segcache which speaks the HTTP protocol on its server port.
+
+#[macro_use]
+extern crate logger;
+
+use config::segcache::Protocol;
+use config::SegcacheConfig;
+use pelikan_segcache_rs::Segcache;
+
+use std::io::{Read, Write};
+use std::net::TcpStream;
+use std::time::Duration;
+
+const KEEP_ALIVE: &str = "Connection: keep-alive\r\nKeep-Alive: timeout=60\r\n";
+
+fn main() {
+    debug!("launching http server");
+    let mut config = SegcacheConfig::default();
+    config.set_protocol(Protocol::Http);
+    let server = Segcache::new(config).expect("failed to launch segcache");
+
+    // wait for server to startup. duration is chosen to be longer than we'd
+    // expect startup to take in a slow ci environment.
+    std::thread::sleep(Duration::from_secs(10));
+
+    tests();
+
+    // shutdown server and join
+    info!("shutdown...");
+    server.shutdown();
+
+    info!("passed!");
+}
+
+fn tests() {
+    debug!("beginning tests");
+    println!();
+
+    // a key that is not in the cache results in a not found
+    test(
+        "get miss",
+        &[(
+            "GET /0 HTTP/1.1\r\n\r\n",
+            &format!("HTTP/1.1 404 Not Found\r\n{KEEP_ALIVE}\r\n"),
+        )],
+    );
+
+    // check that we can store, retrieve and remove a key over one connection
+    test(
+        "put and get",
+        &[
+            (
+                "PUT /1 HTTP/1.1\r\nContent-Length: 3\r\n\r\none",
+                &format!("HTTP/1.1 204 No Content\r\n{KEEP_ALIVE}\r\n"),
+            ),
+            (
+                "GET /1 HTTP/1.1\r\n\r\n",
+                &format!("HTTP/1.1 200 OK\r\n{KEEP_ALIVE}Content-Length: 3\r\n\r\none"),
+            ),
+            (
+                "DELETE /1 HTTP/1.1\r\n\r\n",
+                &format!("HTTP/1.1 204 No Content\r\n{KEEP_ALIVE}\r\n"),
+            ),
+            (
+                "GET /1 HTTP/1.1\r\n\r\n",
+                &format!("HTTP/1.1 404 Not Found\r\n{KEEP_ALIVE}\r\n"),
+            ),
+        ],
+    );
+
+    // check that pipelined requests are answered in order
+    test(
+        "pipelined",
+        &[(
+            "PUT /2 HTTP/1.1\r\nContent-Length: 3\r\n\r\ntwoGET /2 HTTP/1.1\r\n\r\n",
+            &format!(
+                "HTTP/1.1 204 No Content\r\n{KEEP_ALIVE}\r\n\
+                HTTP/1.1 200 OK\r\n{KEEP_ALIVE}Content-Length: 3\r\n\r\ntwo"
+            ),
+        )],
+    );
+
+    // check that a range of a large value can be read, that one beyond the
+    // end of the value is rejected, and that the connection persists
+    let value = "0123456789".repeat(200);
+    test(
+        "range",
+        &[
+            (
+                &format!(
+                    "PUT /3 HTTP/1.1\r\nContent-Length: {}\r\n\r\n{value}",
+                    value.len()
+                ),
+                &format!("HTTP/1.1 204 No Content\r\n{KEEP_ALIVE}\r\n"),
+            ),
+            (
+                "GET /3 HTTP/1.1\r\nRange: bytes=1995-\r\n\r\n",
+                &format!(
+                    "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 1995-1999/2000\r\n\
+                    {KEEP_ALIVE}Content-Length: 5\r\n\r\n56789"
+                ),
+            ),
+            (
+                "GET /3 HTTP/1.1\r\nRange: bytes=2000-2010\r\n\r\n",
+                &format!(
+                    "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */2000\r\n\
+                    {KEEP_ALIVE}\r\n"
+                ),
+            ),
+        ],
+    );
+
+    // check that the connection is closed when the client asks for it
+    test(
+        "connection close",
+        &[(
+            "GET /0 HTTP/1.1\r\nConnection: close\r\n\r\n",
+            "HTTP/1.1 404 Not Found\r\nConnection: close\r\n\r\n",
+        )],
+    );
+
+    std::thread::sleep(Duration::from_millis(500));
+}
+
+// opens a new connection, operating on request + response pairs from the
+// provided data. a response which closes the connection must be the last.
+fn test(name: &str, data: &[(&str, &str)]) {
+    info!("testing: {}", name);
+    debug!("connecting to server");
+    let mut stream = TcpStream::connect("127.0.0.1:12321").expect("failed to connect");
+    stream
+        .set_read_timeout(Some(Duration::from_millis(250)))
+        .expect("failed to set read timeout");
+    stream
+        .set_write_timeout(Some(Duration::from_millis(250)))
+        .expect("failed to set write timeout");
+
+    debug!("sending request");
+    for (request, response) in data {
+        if stream.write_all(request.as_bytes()).is_err() {
+            error!("error sending request");
+            panic!("status: failed\n");
+        }
+
+        let mut buf = vec![0; response.len()];
+        if stream.read_exact(&mut buf).is_err() {
+            std::thread::sleep(Duration::from_millis(500));
+            panic!("error reading response");
+        } else if response.as_bytes() != buf {
+            error!("sent (UTF-8): {:?}", request);
+            error!("expected (UTF-8): {:?}", response);
+            error!("received (UTF-8): {:?}", String::from_utf8_lossy(&buf));
+            std::thread::sleep(Duration::from_millis(500));
+            panic!("status: failed\n");
+        } else {
+            debug!("correct response");
+        }
+
+        if response.contains("Connection: close") {
+            let mut buf = [0; 1];
+            match stream.read(&mut buf) {
+                Ok(0) => debug!("connection closed"),
+                _ => {
+                    error!("expected the connection to be closed");
+                    std::thread::sleep(Duration::from_millis(500));
+                    panic!("status: failed\n");
+                }
+            }
+        }
+    }
+    info!("status: passed\n");
+}
@@ -0,0 +1,40 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! This test module runs the integration test suite against a sharded
+//! instance of Segcache with multiple storage threads.
+
+#[macro_use]
+extern crate logger;
+
+mod common;
+
+use crate::common::*;
+
+use config::{SegcacheConfig, WorkerConfig};
+use pelikan_segcache_rs::Segcache;
+
+use std::time::Duration;
+
+fn main() {
+    debug!("launching sharded server");
+    let mut config = SegcacheConfig::default();
+    config.worker_mut().set_threads(2);
+    config.worker_mut().set_storage_threads(4);
+    let server = Segcache::new(config).expect("failed to launch segcache");
+
+    // wait for server to startup. duration is chosen to be longer than we'd
+    // expect startup to take in a slow ci environment.
+    std::thread::sleep(Duration::from_secs(10));
+
+    tests();
+
+    admin_tests();
+
+    // shutdown server and join
+    info!("shutdown...");
+    server.shutdown();
+
+    info!("passed!");
+}
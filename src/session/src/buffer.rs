@@ -7,11 +7,29 @@ pub use bytes::{Buf, BufMut};
 
 use crate::*;
 use core::borrow::{Borrow, BorrowMut};
+use core::sync::atomic::{AtomicUsize, Ordering};
 use std::alloc::*;
 
 const KB: usize = 1024;
 const MB: usize = 1024 * KB;
 
+// The most bytes which the session buffers may hold in total, zero for none.
+static BUFFER_LIMIT: AtomicUsize = AtomicUsize::new(0);
+
+/// Sets the most bytes which the session buffers of all threads may hold in
+/// total. Past the limit, sessions are closed rather than growing their read
+/// buffers beyond their target size. A limit of zero disables it.
+pub fn set_buffer_limit(bytes: usize) {
+    BUFFER_LIMIT.store(bytes, Ordering::Relaxed);
+}
+
+/// Returns true if the session buffers hold at least as many bytes as the
+/// limit set with [`set_buffer_limit`].
+pub fn buffer_limit_reached() -> bool {
+    let limit = BUFFER_LIMIT.load(Ordering::Relaxed);
+    limit > 0 && SESSION_BUFFER_BYTE.value() >= limit as i64
+}
+
 /// A simple growable byte buffer, represented as a contiguous range of bytes
 pub struct Buffer {
     ptr: *mut u8,
@@ -47,13 +65,35 @@ impl Buffer {
         }
     }
 
+    /// Create an empty buffer which holds no memory. Memory for the
+    /// `target_size` is allocated when space is first reserved.
+    pub fn empty(target_size: usize) -> Self {
+        Self {
+            ptr: core::ptr::NonNull::dangling().as_ptr(),
+            cap: 0,
+            read_offset: 0,
+            write_offset: 0,
+            target_size: target_size.next_power_of_two(),
+        }
+    }
+
     /// Returns the current capacity of the buffer.
     pub fn capacity(&self) -> usize {
         self.cap
     }
 
+    /// Returns the size the buffer shrinks back down to when possible.
+    pub fn target_size(&self) -> usize {
+        self.target_size
+    }
+
     /// Reserve space for `amt` additional bytes.
     pub fn reserve(&mut self, amt: usize) {
+        // an empty buffer is allocated at the target size first
+        if self.cap == 0 {
+            *self = Buffer::new(self.target_size);
+        }
+
         // if the buffer is empty, reset the offsets
         if self.remaining() == 0 {
             self.read_offset = 0;
@@ -171,6 +211,11 @@ impl Buffer {
 impl Drop for Buffer {
     fn drop(&mut self) {
         SESSION_BUFFER_BYTE.sub(self.cap as _);
+
+        if self.cap > 0 {
+            let layout = Layout::array::<u8>(self.cap).unwrap();
+            unsafe { dealloc(self.ptr, layout) };
+        }
     }
 }
 
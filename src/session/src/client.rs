@@ -57,11 +57,11 @@ where
     /// response latencies can be determined. The latency will include any time
     /// that it takes to compose the message onto the session buffer, time to
     /// flush the session buffer, and any additional calls to flush which may be
-    /// required.
+    /// required. Shared bytes within the message are written out in place.
     pub fn send(&mut self, tx: Tx) -> Result<usize> {
         SESSION_SEND.increment();
         let now = Instant::now();
-        let size = tx.compose(&mut self.session);
+        let size = tx.compose_vectored(&mut self.session);
         self.pending.push_back((now, tx));
         Ok(size)
     }
@@ -96,6 +96,47 @@ where
         }
     }
 
+    /// Like `receive`, but pairs the message received from the server with the
+    /// oldest message awaiting a response which it answers, rather than the
+    /// oldest of all. Also returns the position of the message sent to the
+    /// server among those which were awaiting a response.
+    pub fn receive_matched(&mut self) -> Result<(usize, Tx, Rx)>
+    where
+        Tx: Correlate<Rx>,
+    {
+        let src: &[u8] = self.session.borrow();
+        match self.parser.parse(src) {
+            Ok(res) => {
+                SESSION_RECV.increment();
+                let now = Instant::now();
+                let consumed = res.consumed();
+                let msg = res.into_inner();
+                self.session.consume(consumed);
+                let index = self
+                    .pending
+                    .iter()
+                    .position(|(_, request)| request.answered_by(&msg))
+                    .ok_or_else(|| Error::from(ErrorKind::InvalidData))?;
+                let (timestamp, request) = self.pending.remove(index).unwrap();
+                let latency = now - timestamp;
+                let _ = REQUEST_LATENCY.increment(latency.as_nanos());
+                Ok((index, request, msg))
+            }
+            Err(e) => {
+                if e.kind() != ErrorKind::WouldBlock {
+                    SESSION_RECV_EX.increment();
+                }
+                Err(e)
+            }
+        }
+    }
+
+    /// Returns the number of messages which were sent and are awaiting a
+    /// response.
+    pub fn in_flight(&self) -> usize {
+        self.pending.len()
+    }
+
     /// Attempts to flush the session write buffer.
     pub fn flush(&mut self) -> Result<()> {
         self.session.flush()?;
@@ -112,6 +153,11 @@ where
         self.session.fill()
     }
 
+    /// Indicates if the underlying session is established.
+    pub fn is_established(&mut self) -> bool {
+        self.session.is_established()
+    }
+
     /// Returns the current event interest for this session.
     pub fn interest(&mut self) -> Interest {
         self.session.interest()
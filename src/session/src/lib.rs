@@ -14,10 +14,12 @@ extern crate log;
 
 mod buffer;
 mod client;
+mod pool;
 mod server;
 
 pub use buffer::*;
 pub use client::ClientSession;
+pub use pool::set_buffer_pool_size;
 pub use server::ServerSession;
 
 use clocksource::precise::Instant;
@@ -26,9 +28,10 @@ use core::fmt::Debug;
 use core::marker::PhantomData;
 use metriken::*;
 use pelikan_net::*;
-use protocol_common::{Compose, Parse};
+use protocol_common::{Compose, Correlate, Parse, ParseHeader, SharedBytes, Vectored};
 use std::collections::VecDeque;
-use std::io::{Error, ErrorKind, Read, Result, Write};
+use std::io::{Error, ErrorKind, IoSlice, Read, Result, Write};
+use std::net::SocketAddr;
 use std::os::unix::prelude::AsRawFd;
 
 #[metric(
@@ -37,6 +40,30 @@ use std::os::unix::prelude::AsRawFd;
 )]
 pub static SESSION_BUFFER_BYTE: Gauge = Gauge::new();
 
+#[metric(
+    name = "session_shed_buffer",
+    description = "number of sessions closed as their read buffers could not grow past the limit of the session buffers"
+)]
+pub static SESSION_SHED_BUFFER: Counter = Counter::new();
+
+#[metric(
+    name = "session_buffer_pool_hit",
+    description = "number of session buffers taken from the buffer pool"
+)]
+pub static SESSION_BUFFER_POOL_HIT: Counter = Counter::new();
+
+#[metric(
+    name = "session_buffer_pool_miss",
+    description = "number of session buffers allocated as the buffer pool was empty"
+)]
+pub static SESSION_BUFFER_POOL_MISS: Counter = Counter::new();
+
+#[metric(
+    name = "session_buffer_pool_byte",
+    description = "current size of the buffers held by the buffer pools in bytes"
+)]
+pub static SESSION_BUFFER_POOL_BYTE: Gauge = Gauge::new();
+
 #[metric(name = "session_recv", description = "number of reads from sessions")]
 pub static SESSION_RECV: Counter = Counter::new();
 
@@ -85,6 +112,13 @@ const BUFFER_MIN_FREE: usize = 4 * KB;
 // https://datatracker.ietf.org/doc/html/rfc5246#section-6.2.1
 const TARGET_READ_SIZE: usize = 16 * KB;
 
+// Shared bytes smaller than this are copied into the write buffer, as copying
+// them is cheaper than writing them out separately.
+const SHARED_WRITE_MIN: usize = 4 * KB;
+
+// The maximum number of buffers passed to each vectored write.
+const MAX_IOV: usize = 64;
+
 // The initial size of any queues which track pending requests and responses.
 // This is *not* a hard bound, but is used to size the initial allocations.
 const NUM_PENDING: usize = 256;
@@ -92,11 +126,30 @@ const NUM_PENDING: usize = 256;
 /// A `Session` is an underlying `Stream` with its read and write buffers. This
 /// abstraction allows the caller to efficiently read from the underlying stream
 /// by buffering the incoming bytes. It also allows for efficient writing by
-/// first buffering writes to the underlying stream.
+/// first buffering writes to the underlying stream. Large shared payloads are
+/// not buffered, instead they are referenced and written out in place along
+/// with the buffered bytes using vectored writes.
 pub struct Session {
     stream: Stream,
     read_buffer: Buffer,
     write_buffer: Buffer,
+    shared: VecDeque<SharedWrite>,
+    shared_pending: usize,
+    listener: usize,
+}
+
+/// Shared bytes which are written out once the first `at` bytes which are
+/// currently in the write buffer have been written.
+struct SharedWrite {
+    at: usize,
+    data: SharedBytes,
+    offset: usize,
+}
+
+impl SharedWrite {
+    fn remaining(&self) -> &[u8] {
+        &(*self.data).as_ref()[self.offset..]
+    }
 }
 
 impl AsRawFd for Session {
@@ -119,12 +172,33 @@ impl Session {
             stream,
             read_buffer,
             write_buffer,
+            shared: VecDeque::new(),
+            shared_pending: 0,
+            listener: 0,
         }
     }
 
+    /// Returns the index of the listener which accepted the `Session`, which
+    /// is zero unless the server has more than one listener.
+    pub fn listener(&self) -> usize {
+        self.listener
+    }
+
+    /// Returns the address of the remote peer, which is an error for a
+    /// `Session` over a Unix domain socket.
+    pub fn peer_addr(&self) -> Result<SocketAddr> {
+        self.stream.peer_addr()
+    }
+
+    /// Sets the index of the listener which accepted the `Session`, so that a
+    /// server with more than one listener can tell them apart.
+    pub fn set_listener(&mut self, listener: usize) {
+        self.listener = listener;
+    }
+
     /// Return the event `Interest`s for the `Session`.
     pub fn interest(&mut self) -> Interest {
-        if self.write_buffer.has_remaining() {
+        if self.write_pending() > 0 {
             self.stream.interest().add(Interest::WRITABLE)
         } else {
             self.stream.interest()
@@ -145,13 +219,33 @@ impl Session {
     /// would block. Returns the number of bytes read. `Ok(0)` indicates that
     /// the remote side has closed the stream.
     pub fn fill(&mut self) -> Result<usize> {
+        if self.read_buffer.capacity() == 0 {
+            self.read_buffer = pool::acquire();
+        }
+
         let mut read = 0;
 
         loop {
             let remaining_mut = self.read_buffer.remaining_mut();
 
-            // if the buffer has too little space available, expand it
+            // if the buffer has too little space available, expand it. Once
+            // the session buffers are at their limit, a buffer holding part of
+            // a request is not grown past its target size, and the session is
+            // closed instead
             if remaining_mut < BUFFER_MIN_FREE {
+                if self.read_buffer.remaining() > 0
+                    && self.read_buffer.capacity() >= self.read_buffer.target_size()
+                    && buffer_limit_reached()
+                {
+                    if read > 0 {
+                        return Ok(read);
+                    }
+                    SESSION_SHED_BUFFER.increment();
+                    return Err(Error::new(
+                        ErrorKind::OutOfMemory,
+                        "session buffer limit reached",
+                    ));
+                }
                 self.read_buffer.reserve(TARGET_READ_SIZE);
             }
 
@@ -200,19 +294,90 @@ impl Session {
         }
     }
 
+    /// Reads into `dst` instead of the read buffer, taking any bytes which are
+    /// already in the read buffer first, until `dst` is full or a read would
+    /// block. Returns the number of bytes read. `Ok(0)` for a non-empty `dst`
+    /// indicates that the remote side has closed the stream.
+    pub fn fill_into(&mut self, dst: &mut [u8]) -> Result<usize> {
+        let buffered: &[u8] = self.read_buffer.borrow();
+        let mut read = buffered.len().min(dst.len());
+        dst[..read].copy_from_slice(&buffered[..read]);
+        self.read_buffer.advance(read);
+
+        while read < dst.len() {
+            match self.stream.read(&mut dst[read..]) {
+                Ok(0) => return Ok(read),
+                Ok(n) => read += n,
+                Err(e) => match e.kind() {
+                    ErrorKind::WouldBlock => {
+                        if read == 0 {
+                            return Err(e);
+                        } else {
+                            return Ok(read);
+                        }
+                    }
+                    ErrorKind::Interrupted => {}
+                    _ => {
+                        return Err(e);
+                    }
+                },
+            }
+        }
+
+        Ok(read)
+    }
+
     /// Mark `amt` bytes as consumed from the read buffer.
     pub fn consume(&mut self, amt: usize) {
         self.read_buffer.advance(amt)
     }
 
-    /// Return the number of bytes currently in the write buffer.
+    /// Returns the read and write buffers to the buffer pool of the current
+    /// thread if they are empty, so that idle sessions do not hold on to them.
+    /// The buffers are taken back from the pool once they are needed. This has
+    /// no effect unless the pool is enabled with [`set_buffer_pool_size`].
+    pub fn release_buffers(&mut self) {
+        if !pool::enabled() {
+            return;
+        }
+
+        if self.read_buffer.capacity() > 0 && self.read_buffer.remaining() == 0 {
+            let target_size = self.read_buffer.target_size();
+            pool::release(std::mem::replace(
+                &mut self.read_buffer,
+                Buffer::empty(target_size),
+            ));
+        }
+
+        if self.write_buffer.capacity() > 0 && self.write_pending() == 0 {
+            let target_size = self.write_buffer.target_size();
+            pool::release(std::mem::replace(
+                &mut self.write_buffer,
+                Buffer::empty(target_size),
+            ));
+        }
+    }
+
+    /// Takes a write buffer from the pool if it was released.
+    fn acquire_write_buffer(&mut self) {
+        if self.write_buffer.capacity() == 0 {
+            self.write_buffer = pool::acquire();
+        }
+    }
+
+    /// Return the number of bytes currently pending write, both in the write
+    /// buffer and shared.
     pub fn write_pending(&self) -> usize {
-        self.write_buffer.remaining()
+        self.write_buffer.remaining() + self.shared_pending
     }
 
     /// Attempts to flush the `Session` to the underlying `Stream`. This may
     /// result in multiple calls
     pub fn flush(&mut self) -> Result<usize> {
+        if !self.shared.is_empty() {
+            return self.flush_vectored();
+        }
+
         let mut flushed = 0;
         while self.write_buffer.has_remaining() {
             match self.stream.write(self.write_buffer.borrow()) {
@@ -248,6 +413,96 @@ impl Session {
         Ok(flushed)
     }
 
+    /// Flushes the write buffer along with the shared bytes, which are written
+    /// in place, using vectored writes.
+    fn flush_vectored(&mut self) -> Result<usize> {
+        let mut flushed = 0;
+        while self.write_pending() > 0 {
+            let result = {
+                let buffer: &[u8] = self.write_buffer.borrow();
+                let mut slices = [IoSlice::new(&[]); MAX_IOV];
+                let mut count = 0;
+                let mut position = 0;
+
+                // interleave the buffered bytes with the shared bytes in order
+                for shared in self.shared.iter() {
+                    if count + 2 > MAX_IOV {
+                        break;
+                    }
+                    if shared.at > position {
+                        slices[count] = IoSlice::new(&buffer[position..shared.at]);
+                        count += 1;
+                        position = shared.at;
+                    }
+                    slices[count] = IoSlice::new(shared.remaining());
+                    count += 1;
+                }
+                if count < MAX_IOV && position < buffer.len() {
+                    slices[count] = IoSlice::new(&buffer[position..]);
+                    count += 1;
+                }
+
+                self.stream.write_vectored(&slices[..count])
+            };
+
+            match result {
+                Ok(amt) => {
+                    self.advance_vectored(amt);
+                    flushed += amt;
+                }
+                Err(e) => match e.kind() {
+                    ErrorKind::WouldBlock => {
+                        if flushed == 0 {
+                            return Err(e);
+                        }
+                        break;
+                    }
+                    ErrorKind::Interrupted => {}
+                    _ => {
+                        return Err(e);
+                    }
+                },
+            }
+        }
+
+        SESSION_SEND_BYTE.add(flushed as _);
+
+        Ok(flushed)
+    }
+
+    /// Marks `amt` bytes as written, consuming them from the write buffer and
+    /// the shared bytes in the order they were put.
+    fn advance_vectored(&mut self, mut amt: usize) {
+        while amt > 0 {
+            match self.shared.front_mut() {
+                Some(shared) if shared.at == 0 => {
+                    let remaining = shared.remaining().len();
+                    if amt >= remaining {
+                        amt -= remaining;
+                        self.shared_pending -= remaining;
+                        self.shared.pop_front();
+                    } else {
+                        shared.offset += amt;
+                        self.shared_pending -= amt;
+                        amt = 0;
+                    }
+                }
+                Some(shared) => {
+                    let buffered = amt.min(shared.at);
+                    self.write_buffer.advance(buffered);
+                    for shared in self.shared.iter_mut() {
+                        shared.at -= buffered;
+                    }
+                    amt -= buffered;
+                }
+                None => {
+                    self.write_buffer.advance(amt);
+                    amt = 0;
+                }
+            }
+        }
+    }
+
     pub fn do_handshake(&mut self) -> Result<()> {
         self.stream.do_handshake()
     }
@@ -319,6 +574,7 @@ unsafe impl BufMut for Session {
     }
 
     fn chunk_mut(&mut self) -> &mut UninitSlice {
+        self.acquire_write_buffer();
         self.write_buffer.chunk_mut()
     }
 
@@ -327,14 +583,37 @@ unsafe impl BufMut for Session {
     where
         Self: Sized,
     {
+        self.acquire_write_buffer();
         self.write_buffer.put(src)
     }
 
     fn put_slice(&mut self, src: &[u8]) {
+        self.acquire_write_buffer();
         self.write_buffer.put_slice(src)
     }
 }
 
+impl Vectored for Session {
+    fn buf_mut(&mut self) -> &mut dyn BufMut {
+        self
+    }
+
+    fn put_shared(&mut self, data: SharedBytes) {
+        let len = (*data).as_ref().len();
+        self.acquire_write_buffer();
+        if len < SHARED_WRITE_MIN {
+            self.write_buffer.put_slice((*data).as_ref());
+        } else {
+            self.shared.push_back(SharedWrite {
+                at: self.write_buffer.remaining(),
+                data,
+                offset: 0,
+            });
+            self.shared_pending += len;
+        }
+    }
+}
+
 impl event::Source for Session {
     fn register(&mut self, registry: &Registry, token: Token, interest: Interest) -> Result<()> {
         self.stream.register(registry, token, interest)
@@ -348,3 +627,91 @@ impl event::Source for Session {
         self.stream.deregister(registry)
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::Arc;
+
+    #[test]
+    fn flush_vectored() {
+        let listener = TcpListener::bind("127.0.0.1:0").expect("failed to bind");
+        let addr = listener.local_addr().expect("listener has no local addr");
+
+        let mut client = std::net::TcpStream::connect(addr).expect("failed to connect");
+        std::thread::sleep(std::time::Duration::from_millis(100));
+        let (stream, _) = listener.accept().expect("failed to accept");
+
+        let mut session = Session::from(stream);
+
+        // a large shared payload is referenced, a small one is copied
+        let large: SharedBytes = Arc::new(vec![b'a'; 2 * SHARED_WRITE_MIN]);
+        let small: SharedBytes = Arc::new(b"small".to_vec());
+
+        session.put_slice(b"VALUE ");
+        session.put_shared(large.clone());
+        session.put_slice(b"\r\n");
+        session.put_shared(small);
+        session.put_slice(b"END\r\n");
+
+        assert_eq!(session.shared.len(), 1);
+        assert_eq!(
+            session.write_pending(),
+            6 + 2 * SHARED_WRITE_MIN + 2 + 5 + 5
+        );
+
+        while session.write_pending() > 0 {
+            let _ = session.flush();
+        }
+
+        let mut expected = b"VALUE ".to_vec();
+        expected.extend_from_slice((*large).as_ref());
+        expected.extend_from_slice(b"\r\nsmallEND\r\n");
+
+        let mut received = vec![0; expected.len()];
+        client.read_exact(&mut received).expect("failed to read");
+        assert_eq!(received, expected);
+    }
+
+    #[test]
+    fn release_buffers() {
+        let listener = TcpListener::bind("127.0.0.1:0").expect("failed to bind");
+        let addr = listener.local_addr().expect("listener has no local addr");
+
+        let mut client = std::net::TcpStream::connect(addr).expect("failed to connect");
+        std::thread::sleep(std::time::Duration::from_millis(100));
+        let (stream, _) = listener.accept().expect("failed to accept");
+
+        set_buffer_pool_size(4);
+
+        let mut session = Session::from(stream);
+
+        // idle buffers are returned to the pool
+        session.release_buffers();
+        assert_eq!(session.read_buffer.capacity(), 0);
+        assert_eq!(session.write_buffer.capacity(), 0);
+        assert_eq!(pool::len(), 2);
+
+        // the write buffer is taken back when writing and is kept while the
+        // bytes are pending
+        session.put_slice(b"PONG\r\n");
+        assert_eq!(pool::len(), 1);
+        session.release_buffers();
+        assert_eq!(session.write_buffer.capacity(), TARGET_READ_SIZE);
+
+        while session.write_pending() > 0 {
+            let _ = session.flush();
+        }
+        session.release_buffers();
+        assert_eq!(pool::len(), 2);
+
+        // the read buffer is taken back when reading
+        client.write_all(b"PING\r\n").expect("failed to write");
+        std::thread::sleep(std::time::Duration::from_millis(100));
+        assert_eq!(session.fill().expect("failed to read"), 6);
+        assert_eq!(session.chunk(), b"PING\r\n");
+        assert_eq!(pool::len(), 1);
+
+        set_buffer_pool_size(0);
+    }
+}
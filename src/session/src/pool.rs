@@ -0,0 +1,75 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! A per-thread pool of session buffers.
+//!
+//! Idle sessions return their empty buffers to the pool of the thread which
+//! owns them, and take a buffer back out of the pool once they have bytes to
+//! read or write again. This bounds the buffer memory to roughly the number of
+//! active sessions rather than the number of connected sessions. The pool is
+//! disabled until a size is set with [`set_buffer_pool_size`].
+
+use crate::*;
+use core::cell::RefCell;
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+// The maximum number of buffers held by the pool of each thread.
+static POOL_SIZE: AtomicUsize = AtomicUsize::new(0);
+
+thread_local! {
+    static POOL: RefCell<Vec<Buffer>> = const { RefCell::new(Vec::new()) };
+}
+
+/// Sets the maximum number of idle buffers held by the buffer pool of each
+/// thread. A size of zero disables pooling, so sessions keep their buffers for
+/// as long as they are open.
+pub fn set_buffer_pool_size(buffers: usize) {
+    POOL_SIZE.store(buffers, Ordering::Relaxed);
+}
+
+/// Returns true if sessions should release their idle buffers.
+pub(crate) fn enabled() -> bool {
+    POOL_SIZE.load(Ordering::Relaxed) > 0
+}
+
+/// Takes a buffer of the default size from the pool, allocating a new buffer
+/// if the pool is empty.
+pub(crate) fn acquire() -> Buffer {
+    match POOL.with(|pool| pool.borrow_mut().pop()) {
+        Some(buffer) => {
+            SESSION_BUFFER_POOL_HIT.increment();
+            SESSION_BUFFER_POOL_BYTE.sub(buffer.capacity() as _);
+            buffer
+        }
+        None => {
+            SESSION_BUFFER_POOL_MISS.increment();
+            Buffer::new(TARGET_READ_SIZE)
+        }
+    }
+}
+
+/// Returns a buffer to the pool. The buffer is freed instead if the pool is
+/// full or if the buffer cannot be reused as a default sized buffer.
+pub(crate) fn release(mut buffer: Buffer) {
+    if buffer.target_size() != TARGET_READ_SIZE {
+        return;
+    }
+
+    // shrinks the buffer back to the target size
+    buffer.clear();
+
+    POOL.with(|pool| {
+        let mut pool = pool.borrow_mut();
+        if pool.len() < POOL_SIZE.load(Ordering::Relaxed) {
+            SESSION_BUFFER_POOL_BYTE.add(buffer.capacity() as _);
+            pool.push(buffer);
+        }
+    });
+}
+
+/// Returns the number of buffers held by the pool of the current thread.
+#[cfg(test)]
+pub(crate) fn len() -> usize {
+    POOL.with(|pool| pool.borrow().len())
+}
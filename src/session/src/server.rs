@@ -26,7 +26,7 @@ pub struct ServerSession<Parser, Tx, Rx> {
     // tracks the timestamps of any pending requests
     pending: VecDeque<Instant>,
     // tracks outstanding responses and the number of bytes remaining for each
-    outstanding: VecDeque<(Option<Instant>, usize)>,
+    outstanding: VecDeque<Outstanding>,
     // tracks the time the session buffer was last filled
     timestamp: Instant,
     // markers for the receive and transmit types
@@ -34,6 +34,17 @@ pub struct ServerSession<Parser, Tx, Rx> {
     _tx: PhantomData<Tx>,
 }
 
+/// A response which has been composed into the session but not yet flushed.
+struct Outstanding {
+    // the time the corresponding request was read, if known
+    timestamp: Option<Instant>,
+    // the number of bytes which remain to be flushed
+    remaining: usize,
+    // the time the response was composed and the histogram which records the
+    // time it takes to flush
+    write: Option<(Instant, &'static AtomicHistogram)>,
+}
+
 impl<Parser, Tx, Rx> AsRawFd for ServerSession<Parser, Tx, Rx> {
     fn as_raw_fd(&self) -> i32 {
         self.session.as_raw_fd()
@@ -84,13 +95,60 @@ where
         }
     }
 
+    /// Attempt to receive the header of a request with a value of at least
+    /// `min` bytes which is not yet in the session buffer in full, so that its
+    /// value may be read somewhere else with `fill_into`. The header is only
+    /// consumed from the session buffer if `accept` returns a value for it,
+    /// such as once room has been made for the value, and the latency of the
+    /// request is counted from when the header was read.
+    pub fn receive_header<T>(
+        &mut self,
+        min: usize,
+        accept: impl FnOnce(&ParseHeader<Rx>) -> Option<T>,
+    ) -> Option<(ParseHeader<Rx>, T)> {
+        let src: &[u8] = self.session.borrow();
+        let header = self.parser.parse_header(src, min)?;
+        let accepted = accept(&header)?;
+        self.pending.push_back(self.timestamp);
+        self.session.consume(header.consumed());
+        Some((header, accepted))
+    }
+
     /// Send a message to the session buffer.
     pub fn send(&mut self, tx: Tx) -> Result<usize> {
+        self.send_message(tx, None)
+    }
+
+    /// Send a message to the session buffer and record the time from now
+    /// until it has been flushed entirely into the `write` histogram.
+    pub fn send_timed(&mut self, tx: Tx, write: &'static AtomicHistogram) -> Result<usize> {
+        self.send_message(tx, Some(write))
+    }
+
+    /// Send a message to the session buffer which is not the response to any
+    /// request, such as one the server pushes to the client unprompted. The
+    /// latency of the requests still pending is not affected.
+    pub fn push(&mut self, tx: Tx) -> Result<usize> {
+        SESSION_SEND.increment();
+
+        let size = tx.compose_vectored(&mut self.session);
+        if size > 0 {
+            self.outstanding.push_back(Outstanding {
+                timestamp: None,
+                remaining: size,
+                write: None,
+            });
+        }
+
+        Ok(size)
+    }
+
+    fn send_message(&mut self, tx: Tx, write: Option<&'static AtomicHistogram>) -> Result<usize> {
         SESSION_SEND.increment();
 
         let timestamp = self.pending.pop_front();
 
-        let size = tx.compose(&mut self.session);
+        let size = tx.compose_vectored(&mut self.session);
 
         if size == 0 {
             // we have a zero sized response, increment heatmap now
@@ -102,7 +160,11 @@ where
         } else {
             // we have bytes in our response, we need to add it on the
             // outstanding response queue
-            self.outstanding.push_back((timestamp, size));
+            self.outstanding.push_back(Outstanding {
+                timestamp,
+                remaining: size,
+                write: write.map(|histogram| (Instant::now(), histogram)),
+            });
         }
 
         Ok(size)
@@ -121,16 +183,20 @@ where
 
         while amt > 0 {
             if let Some(mut front) = self.outstanding.pop_front() {
-                if front.1 > amt {
-                    front.1 -= amt;
+                if front.remaining > amt {
+                    front.remaining -= amt;
                     self.outstanding.push_front(front);
                     break;
                 } else {
-                    amt -= front.1;
-                    if let Some(ts) = front.0 {
+                    amt -= front.remaining;
+                    if let Some(ts) = front.timestamp {
                         let latency = now - ts;
                         let _ = REQUEST_LATENCY.increment(latency.as_nanos());
                     }
+                    if let Some((ts, histogram)) = front.write {
+                        let latency = now - ts;
+                        let _ = histogram.increment(latency.as_nanos());
+                    }
                 }
             } else {
                 break;
@@ -158,6 +224,12 @@ where
         self.session.write_pending()
     }
 
+    /// Returns any empty buffers to the buffer pool while the session is idle.
+    /// See `Session::release_buffers` for details.
+    pub fn release_buffers(&mut self) {
+        self.session.release_buffers()
+    }
+
     /// Reads from the underlying stream into the read buffer and returns the
     /// number of bytes read.
     pub fn fill(&mut self) -> Result<usize> {
@@ -178,11 +250,38 @@ where
         }
     }
 
+    /// Reads into `dst` instead of the read buffer, taking any bytes which are
+    /// already in the read buffer first, and returns the number of bytes
+    /// read. See `Session::fill_into` for details.
+    pub fn fill_into(&mut self, dst: &mut [u8]) -> Result<usize> {
+        SESSION_RECV.increment();
+        self.timestamp = Instant::now();
+
+        let buffered = self.session.remaining().min(dst.len());
+        match self.session.fill_into(dst) {
+            Ok(amt) => {
+                SESSION_RECV_BYTE.add((amt - buffered) as _);
+                Ok(amt)
+            }
+            Err(e) => {
+                if e.kind() != ErrorKind::WouldBlock {
+                    SESSION_RECV_EX.increment();
+                }
+                Err(e)
+            }
+        }
+    }
+
     /// Returns the current event interest for this session.
     pub fn interest(&mut self) -> Interest {
         self.session.interest()
     }
 
+    /// Indicates if the underlying session is still handshaking.
+    pub fn is_handshaking(&self) -> bool {
+        self.session.is_handshaking()
+    }
+
     /// Attempt to handshake the underlying session.
     pub fn do_handshake(&mut self) -> Result<()> {
         self.session.do_handshake()
@@ -2,7 +2,7 @@
 // Licensed under the Apache License, Version 2.0
 // http://www.apache.org/licenses/LICENSE-2.0
 
-use bloom::BloomFilter;
+use bloom::{BlockedBloomFilter, BloomFilter, RawBloomFilter};
 use criterion::{black_box, criterion_group, criterion_main, Criterion};
 
 const MB: usize = 1024 * 1024;
@@ -46,5 +46,28 @@ fn small_key(c: &mut Criterion) {
     });
 }
 
-criterion_group!(benches, small_key);
+fn raw_contains(c: &mut Criterion) {
+    // the filter is much larger than the cache so that each probe misses
+    c.bench_function("raw_contains", |b| {
+        let bloom = RawBloomFilter::new(MB * 512, 8);
+        let mut hash: u64 = 0;
+
+        b.iter(|| {
+            hash = hash.wrapping_add(0x9e3779b97f4a7c15);
+            bloom.contains(black_box(hash), black_box(hash.rotate_left(32)))
+        })
+    });
+
+    c.bench_function("blocked_contains", |b| {
+        let bloom = BlockedBloomFilter::new(MB * 512, 8);
+        let mut hash: u64 = 0;
+
+        b.iter(|| {
+            hash = hash.wrapping_add(0x9e3779b97f4a7c15);
+            bloom.contains(black_box(hash), black_box(hash.rotate_left(32)))
+        })
+    });
+}
+
+criterion_group!(benches, small_key, raw_contains);
 criterion_main!(benches);
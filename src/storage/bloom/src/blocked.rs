@@ -0,0 +1,296 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Filters which keep everything for a value within one cache line.
+//!
+//! The filter is divided into 64 byte blocks. The first hash of a value picks
+//! its block and the second picks its bits or counters within the block, so
+//! an insert or lookup touches a single cache line no matter how many hashes
+//! are used. The two hashes should be independent, as the block is picked
+//! from the high bits of the first hash.
+//!
+//! A lookup builds a mask of the bits for the value and compares it against
+//! the block one word at a time, which the compiler turns into a few vector
+//! instructions. The false positive rate is a little higher than that of a
+//! [`RawBloomFilter`] of the same size, as the bits of the values are not
+//! spread evenly across blocks.
+//!
+//! [`RawBloomFilter`]: crate::RawBloomFilter
+
+const BLOCK_WORDS: usize = 8;
+const BLOCK_BITS: usize = BLOCK_WORDS * u64::BITS as usize;
+
+// counters are four bits wide
+const COUNTER_BITS: usize = 4;
+const BLOCK_COUNTERS: usize = BLOCK_BITS / COUNTER_BITS;
+
+/// The largest value of a counter in a [`BlockedCountingFilter`].
+pub const COUNTER_MAX: u8 = (1 << COUNTER_BITS) - 1;
+
+#[derive(Clone, Copy, Default)]
+#[repr(C, align(64))]
+struct Block([u64; BLOCK_WORDS]);
+
+/// Returns the index of the block for the hash, spreading the hashes evenly
+/// across the blocks without a division.
+fn block_index(hash: u64, blocks: usize) -> usize {
+    ((hash as u128 * blocks as u128) >> 64) as usize
+}
+
+// odd multipliers which spread the second hash of a value into its positions
+// within a block
+const SALT: [u64; 8] = [
+    0x47b6137b44974d91,
+    0x8824ad5ba2b7289d,
+    0x705495c72df1424b,
+    0x9efc49475c6bfb31,
+    0x5c6bfb319efc4947,
+    0x2df1424b705495c7,
+    0xa2b7289d8824ad5b,
+    0x44974d9147b6137b,
+];
+
+/// Returns the positions within a block for the second hash of a value, each
+/// of which is `bits` wide. Each is the high bits of the hash multiplied by a
+/// different salt, which spreads the positions more evenly than the linear
+/// combinations used by the [`RawBloomFilter`](crate::RawBloomFilter) when
+/// they are confined to one block.
+fn positions(hash: u64, k: u64, bits: u32) -> impl Iterator<Item = usize> {
+    (0..k).map(move |i| {
+        let salt = SALT[(i % 8) as usize];
+        (hash.wrapping_add(i / 8).wrapping_mul(salt) >> (64 - bits)) as usize
+    })
+}
+
+/// A bloom filter where all the bits for a value are within one 64 byte block.
+#[derive(Clone)]
+pub struct BlockedBloomFilter {
+    blocks: Box<[Block]>,
+    k: u64,
+}
+
+impl BlockedBloomFilter {
+    /// Create a new bloom filter with `m` bits that stores `k` hashes for each
+    /// value inserted.
+    ///
+    /// Note that `m` will be rounded up to the next multiple of 512.
+    ///
+    /// # Panics
+    /// Panics if
+    /// - `m` is 0
+    /// - `k` is 0
+    /// - `k` > 512
+    pub fn new(m: usize, k: usize) -> Self {
+        assert_ne!(m, 0, "m must be greater than 0");
+        assert_ne!(k, 0, "k must be greater than 0");
+        assert!(k <= BLOCK_BITS, "k must be at most {BLOCK_BITS} (got {k})");
+
+        Self {
+            blocks: vec![Block::default(); m.div_ceil(BLOCK_BITS)].into_boxed_slice(),
+            k: k as u64,
+        }
+    }
+
+    /// Returns the mask of the bits within the block for the second hash.
+    fn mask(&self, hash2: u64) -> Block {
+        let mut mask = Block::default();
+        for bit in positions(hash2, self.k, BLOCK_BITS.trailing_zeros()) {
+            mask.0[bit / 64] |= 1 << (bit % 64);
+        }
+        mask
+    }
+
+    /// Insert the value corresponding to the two provided hashes.
+    pub fn insert(&mut self, hash1: u64, hash2: u64) {
+        let mask = self.mask(hash2);
+        let block = &mut self.blocks[block_index(hash1, self.blocks.len())];
+
+        for (word, mask) in block.0.iter_mut().zip(mask.0.iter()) {
+            *word |= mask;
+        }
+    }
+
+    /// Check whether this bloom filter contains the value corresponding
+    /// to these two hashes.
+    pub fn contains(&self, hash1: u64, hash2: u64) -> bool {
+        let mask = self.mask(hash2);
+        let block = &self.blocks[block_index(hash1, self.blocks.len())];
+
+        // every word is checked without branching so that the comparison is
+        // vectorized
+        block
+            .0
+            .iter()
+            .zip(mask.0.iter())
+            .fold(0, |missing, (word, mask)| missing | (mask & !word))
+            == 0
+    }
+
+    /// Erase all items from the bloom filter.
+    pub fn clear(&mut self) {
+        self.blocks.fill(Block::default());
+    }
+}
+
+/// A count-min sketch of four bit counters where all the counters for a value
+/// are within one 64 byte block. The counters saturate at [`COUNTER_MAX`] and
+/// may be aged by halving them, which suits estimating the recent frequency
+/// of values, such as for cache admission.
+#[derive(Clone)]
+pub struct BlockedCountingFilter {
+    blocks: Box<[Block]>,
+    k: u64,
+}
+
+impl BlockedCountingFilter {
+    /// Create a new filter with `m` counters that uses `k` counters for each
+    /// value.
+    ///
+    /// Note that `m` will be rounded up to the next multiple of 128.
+    ///
+    /// # Panics
+    /// Panics if
+    /// - `m` is 0
+    /// - `k` is 0
+    /// - `k` > 128
+    pub fn new(m: usize, k: usize) -> Self {
+        assert_ne!(m, 0, "m must be greater than 0");
+        assert_ne!(k, 0, "k must be greater than 0");
+        assert!(
+            k <= BLOCK_COUNTERS,
+            "k must be at most {BLOCK_COUNTERS} (got {k})"
+        );
+
+        Self {
+            blocks: vec![Block::default(); m.div_ceil(BLOCK_COUNTERS)].into_boxed_slice(),
+            k: k as u64,
+        }
+    }
+
+    fn counters(&self, hash2: u64) -> impl Iterator<Item = usize> {
+        positions(hash2, self.k, BLOCK_COUNTERS.trailing_zeros())
+    }
+
+    fn get(block: &Block, counter: usize) -> u8 {
+        let shift = (counter % 16) * COUNTER_BITS;
+        ((block.0[counter / 16] >> shift) as u8) & COUNTER_MAX
+    }
+
+    /// Returns the estimated count of the value corresponding to the two
+    /// provided hashes, which is never less than the number of times it was
+    /// incremented since the filter was cleared, unless it was aged or the
+    /// counters saturated.
+    pub fn estimate(&self, hash1: u64, hash2: u64) -> u8 {
+        let block = &self.blocks[block_index(hash1, self.blocks.len())];
+
+        self.counters(hash2)
+            .map(|counter| Self::get(block, counter))
+            .min()
+            .unwrap_or(0)
+    }
+
+    /// Increment the count of the value corresponding to the two provided
+    /// hashes. This is a conservative update, only the smallest of its
+    /// counters are increased.
+    pub fn increment(&mut self, hash1: u64, hash2: u64) {
+        let min = self.estimate(hash1, hash2);
+        if min >= COUNTER_MAX {
+            return;
+        }
+
+        let index = block_index(hash1, self.blocks.len());
+        let k = self.k;
+        let block = &mut self.blocks[index];
+
+        let mut incremented = 0u128;
+        for counter in positions(hash2, k, BLOCK_COUNTERS.trailing_zeros()) {
+            // a counter which is picked twice is increased once
+            if Self::get(block, counter) == min && incremented & (1 << counter) == 0 {
+                block.0[counter / 16] += 1 << ((counter % 16) * COUNTER_BITS);
+                incremented |= 1 << counter;
+            }
+        }
+    }
+
+    /// Halve all the counters, so that the estimates reflect recent counts.
+    pub fn age(&mut self) {
+        // the low bit of each counter is dropped as the words are shifted
+        const MASK: u64 = 0x7777_7777_7777_7777;
+
+        for block in self.blocks.iter_mut() {
+            for word in block.0.iter_mut() {
+                *word = (*word >> 1) & MASK;
+            }
+        }
+    }
+
+    /// Reset all the counters to zero.
+    pub fn clear(&mut self) {
+        self.blocks.fill(Block::default());
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn basic() {
+        let mut bloom = BlockedBloomFilter::new(1024, 4);
+
+        bloom.insert(0, 3);
+
+        assert!(bloom.contains(0, 3));
+    }
+
+    #[test]
+    fn missing() {
+        let mut bloom = BlockedBloomFilter::new(1024, 4);
+
+        bloom.insert(u64::MAX, 0x0123456789abcdef);
+
+        assert!(!bloom.contains(0, 0x0123456789abcdef));
+        assert!(!bloom.contains(u64::MAX, 0xfedcba9876543210));
+    }
+
+    #[test]
+    fn clear() {
+        let mut bloom = BlockedBloomFilter::new(1024, 8);
+
+        bloom.insert(0, 8);
+        bloom.insert(u64::MAX, 3);
+
+        assert!(bloom.contains(0, 8));
+        assert!(bloom.contains(u64::MAX, 3));
+
+        bloom.clear();
+
+        assert!(!bloom.contains(0, 8));
+        assert!(!bloom.contains(u64::MAX, 3));
+    }
+
+    #[test]
+    fn counting() {
+        let mut sketch = BlockedCountingFilter::new(1024, 4);
+
+        assert_eq!(sketch.estimate(0, 3), 0);
+
+        for _ in 0..3 {
+            sketch.increment(0, 3);
+        }
+        assert_eq!(sketch.estimate(0, 3), 3);
+
+        // counters saturate
+        for _ in 0..32 {
+            sketch.increment(0, 3);
+        }
+        assert_eq!(sketch.estimate(0, 3), COUNTER_MAX);
+
+        sketch.age();
+        assert_eq!(sketch.estimate(0, 3), COUNTER_MAX / 2);
+
+        sketch.clear();
+        assert_eq!(sketch.estimate(0, 3), 0);
+    }
+}
@@ -4,7 +4,7 @@
 
 //! This library contains an implementation of a bloom filter.
 //!
-//! There are two types exported by this library:
+//! There are four types exported by this library:
 //! - [`BloomFilter`] is a typed bloom filter that allows for inserting keys
 //!   and probabilistically checking whether they are present. This is what
 //!   you should use by default.
@@ -13,6 +13,13 @@
 //!   this if you need absolute control over how items are placed in the bloom
 //!   filter or if you need to store items with different types into the same
 //!   bloom filter.
+//! - [`BlockedBloomFilter`] is like the [`RawBloomFilter`] but keeps all the
+//!   bits for an element within one cache line, so a lookup costs a single
+//!   cache miss rather than _k_ of them. Use this on hot paths where a
+//!   slightly higher error rate is acceptable.
+//! - [`BlockedCountingFilter`] is a count-min sketch laid out the same way,
+//!   with small counters which may be aged, for estimating the frequency of
+//!   elements.
 //!
 //! # Choosing bloom filter parameters
 //! A bloom filter only has two parameters:
@@ -28,6 +35,10 @@
 //! - _m_ = -(_n_ ln _ε_) / (ln 2)<sup>2</sup>
 //!
 
+mod blocked;
+
+pub use blocked::{BlockedBloomFilter, BlockedCountingFilter, COUNTER_MAX};
+
 use std::hash::{Hash, Hasher};
 use std::marker::PhantomData;
 
@@ -6,22 +6,52 @@ use blake3::Hash;
 // use clocksource::{Instant, Nanoseconds, Seconds, UnixInstant};
 use core::ops::Range;
 use std::fs::{File, OpenOptions};
-use std::io::{Error, ErrorKind, Read, Seek, SeekFrom, Write};
+use std::io::{Error, ErrorKind};
+use std::os::unix::fs::FileExt;
 use std::path::Path;
 
 #[cfg(os = "linux")]
 use std::os::unix::fs::OpenOptionsExt;
 
 use memmap2::{MmapMut, MmapOptions};
+use metriken::{metric, Counter, Gauge};
+
+#[metric(
+    name = "datapool_load_byte",
+    description = "the number of bytes of datapool files which were read and verified on open"
+)]
+pub static DATAPOOL_LOAD_BYTE: Counter = Counter::new();
+
+#[metric(
+    name = "datapool_load_total_byte",
+    description = "the number of bytes of datapool files which were opened, which is the total that datapool_load_byte counts towards"
+)]
+pub static DATAPOOL_LOAD_TOTAL_BYTE: Gauge = Gauge::new();
 
 const PAGE_SIZE: usize = 4096;
-const HEADER_SIZE: usize = core::mem::size_of::<Header>();
+/// The number of bytes occupied by the header at the start of a file-backed
+/// datapool.
+pub const HEADER_SIZE: usize = core::mem::size_of::<Header>();
 const MAGIC: [u8; 8] = *b"PELIKAN!";
 
 // NOTE: this must be incremented if there are breaking changes to the on-disk
 // format
 const VERSION: u64 = 0;
 
+// the size of the steps in which a region is hashed, each step being hashed
+// across threads
+const HASH_STEP: usize = 1 << 30;
+
+/// Hashes the region with the tree mode of blake3, which splits the work
+/// across threads and gives the same hash as hashing it on one thread. The
+/// length of each step is passed to the provided function once it is hashed.
+fn hash_parallel(hasher: &mut blake3::Hasher, region: &[u8], mut progress: impl FnMut(usize)) {
+    for step in region.chunks(HASH_STEP) {
+        hasher.update_rayon(step);
+        progress(step.len());
+    }
+}
+
 /// The datapool trait defines the abstraction that each datapool implementation
 /// should conform to.
 #[allow(clippy::len_without_is_empty)]
@@ -36,11 +66,52 @@ pub trait Datapool: Send {
     /// This may be a no-op for datapools which cannot persist data.
     fn flush(&mut self) -> Result<(), std::io::Error>;
 
+    /// Marks a range of the data as changed, so that it is persisted by the
+    /// next checkpoint. This is a no-op for datapools which do not track
+    /// changes.
+    fn mark_dirty(&mut self, _range: Range<usize>) {}
+
+    /// Persists the data which was marked dirty since the last checkpoint or
+    /// flush. For datapools which do not track changes this is a flush.
+    fn checkpoint(&mut self) -> Result<(), std::io::Error> {
+        self.flush()
+    }
+
     fn len(&self) -> usize {
         self.as_slice().len()
     }
 }
 
+/// The size of the pages which back volatile in-memory storage. Larger pages
+/// need fewer TLB entries to cover the region and fewer faults to populate it.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub enum HugePages {
+    /// Regular pages.
+    #[default]
+    Disabled,
+    /// Transparent huge pages, which the kernel backs the region with where
+    /// it can, using regular pages for the rest.
+    Transparent,
+    /// 2MB pages from the hugetlb pool, falling back to transparent huge
+    /// pages if the pool does not have enough free pages.
+    Huge2M,
+    /// 1GB pages from the hugetlb pool, falling back to transparent huge
+    /// pages if the pool does not have enough free pages.
+    Huge1G,
+}
+
+impl HugePages {
+    /// Returns the log2 of the page size for pages from the hugetlb pool.
+    #[cfg(target_os = "linux")]
+    fn page_bits(self) -> Option<u8> {
+        match self {
+            Self::Huge2M => Some(21),
+            Self::Huge1G => Some(30),
+            _ => None,
+        }
+    }
+}
+
 /// Represents volatile in-memory storage.
 pub struct Memory {
     mmap: MmapMut,
@@ -49,21 +120,152 @@ pub struct Memory {
 
 impl Memory {
     pub fn create(size: usize) -> Result<Self, std::io::Error> {
-        // mmap an anonymous region
-        let mut mmap = MmapOptions::new().populate().len(size).map_anon()?;
+        Self::create_with(size, HugePages::Disabled, None)
+    }
 
-        // causes the mmap'd region to be prefaulted by writing a zero at the
-        // start of each page
-        let mut offset = 0;
-        while offset < size {
-            mmap[offset] = 0;
-            offset += PAGE_SIZE;
+    /// Create volatile in-memory storage with its pages placed on the provided
+    /// NUMA node where possible. Pages are allocated from other nodes once the
+    /// node runs out of free memory.
+    pub fn create_on_node(size: usize, node: usize) -> Result<Self, std::io::Error> {
+        Self::create_with(size, HugePages::Disabled, Some(node))
+    }
+
+    /// Create volatile in-memory storage backed by pages of the provided size,
+    /// and placed on the NUMA node if one is provided. The region is
+    /// prefaulted before it is returned.
+    pub fn create_with(
+        size: usize,
+        huge_pages: HugePages,
+        node: Option<usize>,
+    ) -> Result<Self, std::io::Error> {
+        // mmap an anonymous region, the pages must not be faulted in until
+        // the memory policy is set
+        let (mut mmap, page_size) = map_anon(size, huge_pages)?;
+
+        if let Some(node) = node {
+            set_preferred_node(&mut mmap, node)?;
         }
 
+        prefault(&mut mmap, page_size);
+
         Ok(Self { mmap, size })
     }
 }
 
+/// Maps an anonymous region of at least the provided size and returns it along
+/// with the size of the pages which back it.
+fn map_anon(size: usize, huge_pages: HugePages) -> Result<(MmapMut, usize), std::io::Error> {
+    // the length of a hugetlb mapping is rounded up to a whole number of pages,
+    // and the mapping fails if the pool does not have enough free pages
+    #[cfg(target_os = "linux")]
+    if let Some(bits) = huge_pages.page_bits() {
+        let page_size = 1 << bits;
+        let len = size.div_ceil(page_size) * page_size;
+        if let Ok(mmap) = MmapOptions::new().len(len).huge(Some(bits)).map_anon() {
+            return Ok((mmap, page_size));
+        }
+    }
+
+    let mmap = MmapOptions::new().len(size).map_anon()?;
+
+    if huge_pages != HugePages::Disabled {
+        advise_huge_pages(&mmap);
+    }
+
+    Ok((mmap, PAGE_SIZE))
+}
+
+/// Asks the kernel to back the region with transparent huge pages. This is a
+/// hint, so the region keeps its regular pages if it is not taken.
+#[cfg(target_os = "linux")]
+fn advise_huge_pages(mmap: &MmapMut) {
+    let _ = unsafe {
+        libc::madvise(
+            mmap.as_ptr() as *mut libc::c_void,
+            mmap.len(),
+            libc::MADV_HUGEPAGE,
+        )
+    };
+}
+
+#[cfg(not(target_os = "linux"))]
+fn advise_huge_pages(_mmap: &MmapMut) {}
+
+// regions smaller than this are prefaulted on the calling thread, as spawning
+// threads would take longer than faulting in the pages
+const PREFAULT_THREAD_MIN: usize = 1 << 30;
+
+/// Causes the region to be prefaulted by writing a zero at the start of each
+/// page. Large regions are split across threads, as the time taken is spent
+/// in the kernel zeroing pages, which otherwise happens one page at a time.
+fn prefault(region: &mut [u8], page_size: usize) {
+    let threads = std::thread::available_parallelism()
+        .map(|threads| threads.get())
+        .unwrap_or(1);
+
+    // each thread is given a whole number of pages
+    let chunk = (region.len() / threads).max(PREFAULT_THREAD_MIN);
+    let chunk = chunk.div_ceil(page_size) * page_size;
+
+    if chunk >= region.len() {
+        touch(region, page_size);
+        return;
+    }
+
+    std::thread::scope(|scope| {
+        for chunk in region.chunks_mut(chunk) {
+            scope.spawn(move || touch(chunk, page_size));
+        }
+    });
+}
+
+fn touch(region: &mut [u8], page_size: usize) {
+    let mut offset = 0;
+    while offset < region.len() {
+        region[offset] = 0;
+        offset += page_size;
+    }
+}
+
+/// Sets the memory policy of the region so that its pages are allocated on the
+/// provided NUMA node when possible.
+#[cfg(target_os = "linux")]
+fn set_preferred_node(mmap: &mut MmapMut, node: usize) -> Result<(), std::io::Error> {
+    const MPOL_PREFERRED: libc::c_int = 1;
+
+    let bits = 8 * core::mem::size_of::<libc::c_ulong>();
+    let mut nodemask: Vec<libc::c_ulong> = vec![0; node / bits + 1];
+    nodemask[node / bits] |= 1 << (node % bits);
+
+    // the kernel ignores the last bit of the mask, so the max node is one past
+    // the size of the mask
+    let ret = unsafe {
+        libc::syscall(
+            libc::SYS_mbind,
+            mmap.as_mut_ptr(),
+            mmap.len(),
+            MPOL_PREFERRED,
+            nodemask.as_ptr(),
+            nodemask.len() * bits + 1,
+            0,
+        )
+    };
+
+    if ret < 0 {
+        Err(Error::last_os_error())
+    } else {
+        Ok(())
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+fn set_preferred_node(_mmap: &mut MmapMut, _node: usize) -> Result<(), std::io::Error> {
+    Err(Error::new(
+        ErrorKind::Unsupported,
+        "numa placement is only supported on linux",
+    ))
+}
+
 impl Datapool for Memory {
     fn as_slice(&self) -> &[u8] {
         &self.mmap[..self.size]
@@ -165,6 +367,10 @@ impl Header {
     pub fn options(&self) -> u64 {
         self.options
     }
+
+    fn set_options(&mut self, options: u64) {
+        self.options = options;
+    }
 }
 
 /// Represents storage that primarily exists in a file. This is best used in
@@ -210,8 +416,8 @@ impl MmapFile {
             end: HEADER_SIZE + data_size,
         };
 
-        // mmap the file
-        let mmap = unsafe { MmapOptions::new().populate().map_mut(&file)? };
+        // mmap the file, the pages are faulted in as the data is hashed
+        let mmap = unsafe { MmapOptions::new().map_mut(&file)? };
 
         // load copy the header from the mmap'd file
         let mut header = [0; HEADER_SIZE];
@@ -238,8 +444,12 @@ impl MmapFile {
         hasher.update(header.as_bytes());
 
         // calculates the hash of the data region, as a side effect this
-        // prefaults all the pages
-        hasher.update(&mmap[data.start..data.end]);
+        // prefaults all the pages across threads. This covers every page in
+        // the file to match the region which is hashed on flush.
+        DATAPOOL_LOAD_TOTAL_BYTE.add((total_size - HEADER_SIZE) as _);
+        hash_parallel(&mut hasher, &mmap[HEADER_SIZE..total_size], |len| {
+            DATAPOOL_LOAD_BYTE.add(len as _);
+        });
 
         // finalize the hash
         let hash = hasher.finalize();
@@ -357,15 +567,8 @@ impl Datapool for MmapFile {
         // hash the header
         hasher.update(header.as_bytes());
 
-        // calculate the number of data pages to be copied
-        let data_pages = (self.mmap.len() - HEADER_SIZE) / PAGE_SIZE;
-
         // hash the data region
-        for page in 0..data_pages {
-            let start = page * PAGE_SIZE + HEADER_SIZE;
-            let end = start + PAGE_SIZE;
-            hasher.update(&self.mmap[start..end]);
-        }
+        hash_parallel(&mut hasher, &self.mmap[HEADER_SIZE..], |_| {});
 
         // finalize the hash
         let hash = hasher.finalize();
@@ -395,6 +598,13 @@ impl Datapool for MmapFile {
 /// local disk (eg: NVMe), but it is not strictly required. Unlike simply using
 /// mmap on the file, this ensures all the data is kept resident in-memory.
 ///
+/// The data is divided into chunks, each with its own checksum, which are
+/// written and verified in parallel. Changes to the data may be marked dirty
+/// so that a checkpoint writes only the chunks which changed, while a flush
+/// always writes all of them. The file holds the header, the data and then the
+/// table of chunk checksums, with the header checksum covering the header and
+/// the table.
+///
 /// This currently attempts to use `O_DIRECT` on Linux to avoid the page cache.
 /// No attempts are made to avoid similar pollution on other operating systems
 /// at this time. Further, there are situations in which even with `O_DIRECT`,
@@ -402,37 +612,108 @@ impl Datapool for MmapFile {
 /// made to detect, avoid, or handle this situation.
 pub struct FileBackedMemory {
     memory: Memory,
+    // the checksum of each chunk of the data, as it is in the file
+    checksums: Memory,
+    // a bit for each chunk which changed since it was last written
+    dirty: Vec<u64>,
     header: Box<[u8]>,
     file: File,
-    file_data: Range<usize>,
+    layout: Layout,
+    size: usize,
     user_version: u64,
 }
 
+// the size of the chunks which are tracked, written and checksummed on their
+// own, which must be a whole number of pages
+const CHUNK_SIZE: usize = 1 << 20;
+
+const CHECKSUM_SIZE: usize = 32;
+
+// set in the header options of a file with a table of chunk checksums
+const CHUNK_CHECKSUMS: u64 = 1;
+
+/// The regions of the file backing a `FileBackedMemory`, each of which is a
+/// whole number of pages.
+struct Layout {
+    data: Range<usize>,
+    checksums: Range<usize>,
+}
+
+impl Layout {
+    fn new(data_size: usize) -> Self {
+        let data_len = data_size.div_ceil(PAGE_SIZE) * PAGE_SIZE;
+        let chunks = data_len.div_ceil(CHUNK_SIZE);
+        let checksums_len = (chunks * CHECKSUM_SIZE).div_ceil(PAGE_SIZE) * PAGE_SIZE;
+
+        let data = Range {
+            start: HEADER_SIZE,
+            end: HEADER_SIZE + data_len,
+        };
+
+        let checksums = Range {
+            start: data.end,
+            end: data.end + checksums_len,
+        };
+
+        Self { data, checksums }
+    }
+
+    fn chunks(&self) -> usize {
+        (self.data.end - self.data.start).div_ceil(CHUNK_SIZE)
+    }
+
+    fn len(&self) -> usize {
+        self.checksums.end
+    }
+}
+
+/// Calls the function for each of the items, which are split evenly across
+/// threads. Every item is visited even if some fail, and the first error is
+/// returned.
+fn parallel<T: Send>(
+    items: &mut [T],
+    f: impl Fn(&mut T) -> Result<(), std::io::Error> + Sync,
+) -> Result<(), std::io::Error> {
+    let threads = std::thread::available_parallelism()
+        .map(|threads| threads.get())
+        .unwrap_or(1);
+
+    let per_thread = items.len().div_ceil(threads).max(1);
+
+    if per_thread >= items.len() {
+        return items.iter_mut().try_for_each(f);
+    }
+
+    let f = &f;
+
+    std::thread::scope(|scope| {
+        let handles: Vec<_> = items
+            .chunks_mut(per_thread)
+            .map(|items| scope.spawn(move || items.iter_mut().try_for_each(f)))
+            .collect();
+
+        let mut result = Ok(());
+        for handle in handles {
+            let r = handle.join().expect("datapool thread panicked");
+            if result.is_ok() {
+                result = r;
+            }
+        }
+        result
+    })
+}
+
 impl FileBackedMemory {
     pub fn open<T: AsRef<Path>>(
         path: T,
         data_size: usize,
         user_version: u64,
     ) -> Result<Self, std::io::Error> {
-        // we need the data size to be a whole number of pages for direct io
-        let pages = ((HEADER_SIZE + data_size) as f64 / PAGE_SIZE as f64).ceil() as usize;
-
-        // total size must be larger than the requested size to allow for the
-        // header
-        let file_total_size = Range {
-            start: 0,
-            end: pages * PAGE_SIZE,
-        };
+        let layout = Layout::new(data_size);
 
-        // data resides after a small header
-        let file_data = Range {
-            start: HEADER_SIZE,
-            end: HEADER_SIZE + data_size,
-        };
-
-        // create a new file with read and write access
+        // open an existing file with read and write access
         #[cfg(os = "linux")]
-        let mut file = OpenOptions::new()
+        let file = OpenOptions::new()
             .create_new(false)
             .custom_flags(libc::O_DIRECT)
             .read(true)
@@ -440,40 +721,20 @@ impl FileBackedMemory {
             .open(path)?;
 
         #[cfg(not(os = "linux"))]
-        let mut file = OpenOptions::new()
+        let file = OpenOptions::new()
             .create_new(false)
             .read(true)
             .write(true)
             .open(path)?;
 
         // make sure the file size matches the expected size
-        if file.metadata()?.len() != file_total_size.end as u64 {
+        if file.metadata()?.len() != layout.len() as u64 {
             return Err(Error::new(ErrorKind::Other, "filesize mismatch"));
         }
 
-        // calculate the page range for the data region
-        let data_pages = (file_data.end - file_data.start) / PAGE_SIZE;
-
-        // reserve memory for the data
-        let mut memory = Memory::create(data_size)?;
-
-        // seek to start of header
-        file.seek(SeekFrom::Start(0))?;
-
-        // prepare the header to read from disk
-        let mut header = [0; HEADER_SIZE];
-
         // read the header from disk
-        loop {
-            if file.read(&mut header[0..PAGE_SIZE])? == PAGE_SIZE {
-                break;
-            }
-            file.seek(SeekFrom::Start(0))?;
-        }
-
-        // create a new hasher to checksum the file content, including the
-        // header with a zero'd checksum
-        let mut hasher = blake3::Hasher::new();
+        let mut header = [0; HEADER_SIZE];
+        file.read_exact_at(&mut header, 0)?;
 
         // turn the raw header into the struct
         let header = unsafe { &mut *(header.as_ptr() as *mut Header) };
@@ -481,6 +742,10 @@ impl FileBackedMemory {
         // check the header
         header.check()?;
 
+        if header.options() & CHUNK_CHECKSUMS == 0 {
+            return Err(Error::new(ErrorKind::Other, "file has no chunk checksums"));
+        }
+
         // check the user version
         if header.user_version() != user_version {
             return Err(Error::new(ErrorKind::Other, "user version mismatch"));
@@ -490,44 +755,60 @@ impl FileBackedMemory {
         let file_checksum = header.checksum().to_owned();
         header.zero_checksum();
 
-        // hash the header with the zero'd checksum
-        hasher.update(header.as_bytes());
-
-        // seek to start of the data
-        file.seek(SeekFrom::Start(file_data.start as u64))?;
-
-        // read the data region from the file, copy it into memory and hash it
-        // in a single pass
-        for page in 0..data_pages {
-            // retry the read until a complete page is read
-            loop {
-                let start = page * PAGE_SIZE;
-                let end = start + PAGE_SIZE;
-
-                if file.read(&mut memory.as_mut_slice()[start..end])? == PAGE_SIZE {
-                    hasher.update(&memory.as_slice()[start..end]);
-                    break;
-                }
-                // if the read was incomplete, we seek back to the right spot in
-                // the file
-                file.seek(SeekFrom::Start((HEADER_SIZE + start) as u64))?;
-            }
-        }
+        // read the table of chunk checksums
+        let mut checksums = Memory::create(layout.checksums.end - layout.checksums.start)?;
+        file.read_exact_at(checksums.as_mut_slice(), layout.checksums.start as u64)?;
 
-        // finalize the hash
+        // the header checksum covers the header with a zero'd checksum and
+        // the table, which in turn covers the data
+        let mut hasher = blake3::Hasher::new();
+        hasher.update(header.as_bytes());
+        hasher.update(checksums.as_slice());
         let hash = hasher.finalize();
 
-        // compare the checksum agaianst what's in the header
         if file_checksum[0..32] != hash.as_bytes()[0..32] {
             return Err(Error::new(ErrorKind::Other, "checksum mismatch"));
         }
 
+        // reserve memory for the data
+        let mut memory = Memory::create(layout.data.end - layout.data.start)?;
+
+        // read each chunk into memory and check it against its checksum
+        let mut chunks: Vec<(usize, &mut [u8], &[u8])> = memory
+            .as_mut_slice()
+            .chunks_mut(CHUNK_SIZE)
+            .zip(checksums.as_slice().chunks(CHECKSUM_SIZE))
+            .enumerate()
+            .map(|(chunk, (data, checksum))| (chunk, data, checksum))
+            .collect();
+
+        let offset = layout.data.start;
+
+        DATAPOOL_LOAD_TOTAL_BYTE.add((layout.data.end - layout.data.start) as _);
+
+        parallel(&mut chunks, |(chunk, data, checksum)| {
+            file.read_exact_at(data, (offset + *chunk * CHUNK_SIZE) as u64)?;
+
+            if blake3::hash(data).as_bytes()[..] != checksum[..] {
+                return Err(Error::new(ErrorKind::Other, "checksum mismatch"));
+            }
+
+            DATAPOOL_LOAD_BYTE.add(data.len() as _);
+
+            Ok(())
+        })?;
+
+        drop(chunks);
+
         // return the loaded datapool
         Ok(Self {
             memory,
+            checksums,
+            dirty: vec![0; layout.chunks().div_ceil(64)],
             header: header.as_bytes().to_owned().into_boxed_slice(),
             file,
-            file_data,
+            layout,
+            size: data_size,
             user_version,
         })
     }
@@ -537,25 +818,11 @@ impl FileBackedMemory {
         data_size: usize,
         user_version: u64,
     ) -> Result<Self, std::io::Error> {
-        // we need the data size to be a whole number of pages for direct io
-        let pages = ((HEADER_SIZE + data_size) as f64 / PAGE_SIZE as f64).ceil() as usize;
-
-        // total size must be larger than the requested size to allow for the
-        // header
-        let file_total_size = Range {
-            start: 0,
-            end: pages * PAGE_SIZE,
-        };
-
-        // data resides after a small header
-        let file_data = Range {
-            start: HEADER_SIZE,
-            end: pages * PAGE_SIZE,
-        };
+        let layout = Layout::new(data_size);
 
         // create a new file with read and write access
         #[cfg(os = "linux")]
-        let mut file = OpenOptions::new()
+        let file = OpenOptions::new()
             .create_new(true)
             .custom_flags(libc::O_DIRECT)
             .read(true)
@@ -563,35 +830,41 @@ impl FileBackedMemory {
             .open(path)?;
 
         #[cfg(not(os = "linux"))]
-        let mut file = OpenOptions::new()
+        let file = OpenOptions::new()
             .create_new(true)
             .read(true)
             .write(true)
             .open(path)?;
 
         // grow the file to match the total size
-        file.set_len(file_total_size.end as u64)?;
-
-        // causes file to be zeroed out
-        for page in 0..pages {
-            loop {
-                if file.write(&[0; PAGE_SIZE])? == PAGE_SIZE {
-                    break;
-                }
-                file.seek(SeekFrom::Start((page * PAGE_SIZE) as u64))?;
-            }
-        }
-        file.sync_all()?;
+        file.set_len(layout.len() as u64)?;
 
-        let memory = Memory::create(data_size)?;
+        let memory = Memory::create(layout.data.end - layout.data.start)?;
+        let checksums = Memory::create(layout.checksums.end - layout.checksums.start)?;
 
-        Ok(Self {
+        let mut datapool = Self {
             memory,
+            checksums,
+            dirty: vec![0; layout.chunks().div_ceil(64)],
             header: vec![0; HEADER_SIZE].into_boxed_slice(),
             file,
-            file_data,
+            layout,
+            size: data_size,
             user_version,
-        })
+        };
+
+        // causes the data region of the file to be zeroed out and the table
+        // of checksums to match it. The header is left zero'd, so the file
+        // can't be opened until the first flush.
+        datapool.mark_all_dirty();
+        datapool.write_dirty()?;
+        datapool.file.write_all_at(
+            datapool.checksums.as_slice(),
+            datapool.layout.checksums.start as u64,
+        )?;
+        datapool.file.sync_all()?;
+
+        Ok(datapool)
     }
 
     pub fn header(&self) -> &Header {
@@ -613,65 +886,102 @@ impl FileBackedMemory {
     pub fn time_unix_ns(&self) -> clocksource::precise::UnixInstant {
         self.header().time_unix_ns
     }
+
+    fn mark_all_dirty(&mut self) {
+        self.dirty.fill(u64::MAX);
+    }
+
+    /// Writes each dirty chunk of the data to the file and updates its
+    /// checksum in the table, with the chunks split across threads.
+    fn write_dirty(&mut self) -> Result<(), std::io::Error> {
+        let dirty = &self.dirty;
+
+        let mut chunks: Vec<(usize, &[u8], &mut [u8])> = self
+            .memory
+            .as_slice()
+            .chunks(CHUNK_SIZE)
+            .zip(self.checksums.as_mut_slice().chunks_mut(CHECKSUM_SIZE))
+            .enumerate()
+            .filter(|(chunk, _)| dirty[chunk / 64] & (1 << (chunk % 64)) != 0)
+            .map(|(chunk, (data, checksum))| (chunk, data, checksum))
+            .collect();
+
+        let file = &self.file;
+        let offset = self.layout.data.start;
+
+        parallel(&mut chunks, |(chunk, data, checksum)| {
+            file.write_all_at(data, (offset + *chunk * CHUNK_SIZE) as u64)?;
+            checksum.copy_from_slice(blake3::hash(data).as_bytes());
+            Ok(())
+        })?;
+
+        drop(chunks);
+
+        self.dirty.fill(0);
+
+        Ok(())
+    }
 }
 
 impl Datapool for FileBackedMemory {
     fn as_slice(&self) -> &[u8] {
-        self.memory.as_slice()
+        &self.memory.as_slice()[..self.size]
     }
 
     fn as_mut_slice(&mut self) -> &mut [u8] {
-        self.memory.as_mut_slice()
+        &mut self.memory.as_mut_slice()[..self.size]
     }
 
     fn flush(&mut self) -> Result<(), std::io::Error> {
-        // initialize the hasher
-        let mut hasher = blake3::Hasher::new();
+        self.mark_all_dirty();
+        self.checkpoint()
+    }
+
+    fn mark_dirty(&mut self, range: Range<usize>) {
+        if range.start >= range.end {
+            return;
+        }
+
+        let end = range.end.min(self.size);
+        for chunk in (range.start / CHUNK_SIZE)..end.div_ceil(CHUNK_SIZE) {
+            self.dirty[chunk / 64] |= 1 << (chunk % 64);
+        }
+    }
+
+    fn checkpoint(&mut self) -> Result<(), std::io::Error> {
+        // write the dirty chunks and then the table with their new checksums
+        self.write_dirty()?;
+        self.file.write_all_at(
+            self.checksums.as_slice(),
+            self.layout.checksums.start as u64,
+        )?;
+
+        // the data and the table must be durable before the header which
+        // covers them is written
+        self.file.sync_data()?;
 
         // prepare the header
         let mut header = Header::new();
 
-        // set the user version
+        // set the user version and mark the file as having chunk checksums
         header.set_user_version(self.user_version);
+        header.set_options(CHUNK_CHECKSUMS);
 
-        // hash the header with a zero'd checksum
+        // hash the header with a zero'd checksum and the table of checksums
+        let mut hasher = blake3::Hasher::new();
         hasher.update(header.as_bytes());
-
-        // calculate the number of data pages to be copied
-        let data_pages = (self.file_data.end - self.file_data.start) / PAGE_SIZE;
-
-        // write the data region to the file and hash it in one pass
-        self.file.seek(SeekFrom::Start(HEADER_SIZE as u64))?;
-        for page in 0..data_pages {
-            loop {
-                let start = page * PAGE_SIZE;
-                let end = start + PAGE_SIZE;
-                if self.file.write(&self.memory.as_slice()[start..end])? == PAGE_SIZE {
-                    hasher.update(&self.memory.as_slice()[start..end]);
-                    break;
-                }
-                self.file
-                    .seek(SeekFrom::Start((HEADER_SIZE + start) as u64))?;
-            }
-        }
-
-        // finalize the hash
-        let hash = hasher.finalize();
+        hasher.update(self.checksums.as_slice());
 
         // set the checksum in the header to the calculated hash
-        header.set_checksum(hash);
+        header.set_checksum(hasher.finalize());
 
         // write the header to the file
-        self.file.seek(SeekFrom::Start(0))?;
-        loop {
-            if self.file.write(header.as_bytes())? == HEADER_SIZE {
-                break;
-            }
-            self.file.seek(SeekFrom::Start(0))?;
-        }
+        self.file.write_all_at(header.as_bytes(), 0)?;
 
         self.file.sync_all()?;
 
+        self.header.copy_from_slice(header.as_bytes());
+
         Ok(())
     }
 }
@@ -693,6 +1003,46 @@ mod tests {
         assert_eq!(datapool.len(), 2 * PAGE_SIZE);
     }
 
+    #[cfg(target_os = "linux")]
+    #[test]
+    fn memory_datapool_on_node() {
+        // node 0 exists on every linux host
+        let datapool = Memory::create_on_node(2 * PAGE_SIZE, 0).expect("failed to create pool");
+        assert_eq!(datapool.len(), 2 * PAGE_SIZE);
+    }
+
+    #[test]
+    fn memory_datapool_huge_pages() {
+        // hosts without free huge pages fall back to regular pages
+        for huge_pages in [HugePages::Transparent, HugePages::Huge2M, HugePages::Huge1G] {
+            let mut datapool = Memory::create_with(2 * PAGE_SIZE, huge_pages, None)
+                .expect("failed to create pool");
+            assert_eq!(datapool.len(), 2 * PAGE_SIZE);
+            datapool.as_mut_slice()[2 * PAGE_SIZE - 1] = 1;
+        }
+    }
+
+    #[test]
+    fn prefault_chunks() {
+        let mut region = vec![1; 4 * PAGE_SIZE + 1];
+        prefault(&mut region, PAGE_SIZE);
+        for (offset, byte) in region.iter().enumerate() {
+            assert_eq!(*byte, (offset % PAGE_SIZE != 0) as u8);
+        }
+    }
+
+    #[test]
+    fn hash_parallel_matches() {
+        let region: Vec<u8> = (0..(4 * PAGE_SIZE + 1)).map(|i| i as u8).collect();
+
+        let mut hasher = blake3::Hasher::new();
+        let mut hashed = 0;
+        hash_parallel(&mut hasher, &region, |len| hashed += len);
+
+        assert_eq!(hashed, region.len());
+        assert_eq!(hasher.finalize(), blake3::hash(&region));
+    }
+
     #[test]
     fn mmapfile_datapool() {
         let tempdir = TempDir::new().expect("failed to generate tempdir");
@@ -742,6 +1092,27 @@ mod tests {
         }
     }
 
+    #[test]
+    fn mmapfile_unaligned_size() {
+        let tempdir = TempDir::new().expect("failed to generate tempdir");
+        let mut path = tempdir.into_path();
+        path.push("mmap_test.data");
+
+        // the data size is not a whole number of pages, the trailing bytes of
+        // the last page must still be covered by the checksum on open
+        {
+            let mut datapool =
+                MmapFile::create(&path, PAGE_SIZE + 1, 0).expect("failed to create pool");
+            datapool.as_mut_slice()[PAGE_SIZE] = 0xFF;
+            datapool.flush().expect("failed to flush");
+        }
+
+        {
+            let datapool = MmapFile::open(&path, PAGE_SIZE + 1, 0).expect("failed to open pool");
+            assert_eq!(datapool.as_slice()[PAGE_SIZE], 0xFF);
+        }
+    }
+
     #[test]
     fn filebackedmemory_datapool() {
         let tempdir = TempDir::new().expect("failed to generate tempdir");
@@ -791,4 +1162,47 @@ mod tests {
             assert!(FileBackedMemory::open(&path, 2 * PAGE_SIZE, 1).is_err());
         }
     }
+
+    #[test]
+    fn filebackedmemory_checkpoint() {
+        let tempdir = TempDir::new().expect("failed to generate tempdir");
+        let mut path = tempdir.into_path();
+        path.push("mmap_test.data");
+
+        let size = 3 * CHUNK_SIZE + 1;
+
+        {
+            let mut datapool =
+                FileBackedMemory::create(&path, size, 0).expect("failed to create pool");
+            datapool.flush().expect("failed to flush");
+
+            // only the changes which are marked dirty are written
+            datapool.as_mut_slice()[CHUNK_SIZE] = 0xAA;
+            datapool.as_mut_slice()[3 * CHUNK_SIZE] = 0xBB;
+            datapool.mark_dirty(CHUNK_SIZE..(CHUNK_SIZE + 1));
+            datapool.as_mut_slice()[0] = 0xCC;
+            datapool.mark_dirty((3 * CHUNK_SIZE)..size);
+            datapool.checkpoint().expect("failed to checkpoint");
+        }
+
+        {
+            let datapool = FileBackedMemory::open(&path, size, 0).expect("failed to open pool");
+            assert_eq!(datapool.len(), size);
+            assert_eq!(datapool.as_slice()[CHUNK_SIZE], 0xAA);
+            assert_eq!(datapool.as_slice()[3 * CHUNK_SIZE], 0xBB);
+            assert_eq!(datapool.as_slice()[0], 0);
+        }
+
+        // a chunk which does not match its checksum fails to open
+        {
+            let file = OpenOptions::new()
+                .write(true)
+                .open(&path)
+                .expect("failed to open file");
+            file.write_all_at(&[0xFF], (HEADER_SIZE + 2 * CHUNK_SIZE) as u64)
+                .expect("failed to write");
+        }
+
+        assert!(FileBackedMemory::open(&path, size, 0).is_err());
+    }
 }
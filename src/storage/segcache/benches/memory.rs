@@ -0,0 +1,155 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Measures how much memory `Segcache` holds per byte of live payload (key and
+//! value) for a range of item sizes, segment sizes, hashtable sizes, and
+//! overflow factors, and breaks the overhead down into the hashtable, segment
+//! headers, item headers, dead bytes, and unused bytes.
+//!
+//! Usage:
+//!
+//! ```text
+//! cargo bench --bench memory -- [heap size in MB]
+//! ```
+//!
+//! Each cache is filled with distinct keys up to about 90% of its heap, and
+//! half of the keys are then overwritten in a random order, which leaves dead
+//! bytes behind in the segments the items were first written to, as in a
+//! cache serving updates.
+
+use rand::rngs::SmallRng;
+use rand::{Rng, SeedableRng};
+use segcache::*;
+
+use std::time::Duration;
+
+pub const KB: usize = 1024;
+pub const MB: usize = 1024 * KB;
+
+const KEY_SIZE: usize = 16;
+
+// the share of the heap filled with distinct keys
+const FILL: f64 = 0.9;
+
+const VALUE_SIZES: [usize; 5] = [16, 64, 256, 1024, 4096];
+const SEGMENT_SIZES: [usize; 3] = [256 * KB, MB, 8 * MB];
+const HASH_POWERS: [u8; 2] = [16, 20];
+const OVERFLOW_FACTORS: [f64; 2] = [0.0, 1.0];
+
+fn heap_size() -> usize {
+    // cargo passes `--bench` to benchmarks, so flags are skipped
+    std::env::args()
+        .skip(1)
+        .find(|arg| !arg.starts_with("--"))
+        .map(|v| v.parse::<usize>().expect("invalid heap size"))
+        .unwrap_or(64)
+        * MB
+}
+
+fn key(id: usize) -> [u8; KEY_SIZE] {
+    let mut key = [0; KEY_SIZE];
+    key.copy_from_slice(format!("{id:0>width$}", width = KEY_SIZE).as_bytes());
+    key
+}
+
+fn run(heap_size: usize, value_size: usize, segment_size: usize, hash_power: u8, overflow: f64) {
+    let mut cache = Segcache::builder()
+        .hash_power(hash_power)
+        .max_hash_power(hash_power)
+        .overflow_factor(overflow)
+        .heap_size(heap_size)
+        .segment_size(segment_size as i32)
+        .eviction(Policy::Random)
+        .build()
+        .expect("failed to create cache");
+
+    let value = vec![0; value_size];
+    let payload_size = KEY_SIZE + value_size;
+
+    let nkey = ((heap_size as f64 * FILL) as usize) / payload_size;
+    let mut failures = 0;
+
+    for id in 0..nkey {
+        if cache
+            .insert(&key(id), &value[..], None, Duration::ZERO)
+            .is_err()
+        {
+            failures += 1;
+        }
+    }
+
+    let mut rng = SmallRng::seed_from_u64(0);
+    for _ in 0..(nkey / 2) {
+        let id = rng.gen_range(0..nkey);
+        if cache
+            .insert(&key(id), &value[..], None, Duration::ZERO)
+            .is_err()
+        {
+            failures += 1;
+        }
+    }
+
+    let usage = cache.memory_usage();
+    let payload = usage.items * payload_size;
+    let total = usage.total();
+
+    // each share is relative to the total memory of the cache
+    let share = |bytes: usize| 100.0 * bytes as f64 / total as f64;
+
+    println!(
+        "{:>6} {:>6} {:>4} {:>5.1} {:>9} {:>7.3} {:>6.1} {:>6.1} {:>6.1} {:>6.1} {:>6.1} {:>6.1} {:>6.1} {:>8}",
+        value_size,
+        segment_size / KB,
+        hash_power,
+        overflow,
+        usage.items,
+        if payload > 0 {
+            total as f64 / payload as f64
+        } else {
+            f64::INFINITY
+        },
+        share(payload),
+        share(usage.hashtable),
+        share(usage.segment_headers),
+        share(usage.item_headers()),
+        // padding and the alignment of items
+        share(usage.live.saturating_sub(usage.item_headers() + payload)),
+        share(usage.dead()),
+        share(usage.heap - usage.written),
+        failures,
+    );
+}
+
+fn main() {
+    let heap_size = heap_size();
+
+    println!("heap size: {} MB, key size: {} B", heap_size / MB, KEY_SIZE);
+    println!(
+        "{:>6} {:>6} {:>4} {:>5} {:>9} {:>7} {:>6} {:>6} {:>6} {:>6} {:>6} {:>6} {:>6} {:>8}",
+        "value",
+        "seg KB",
+        "hp",
+        "of",
+        "items",
+        "B/B",
+        "data%",
+        "hash%",
+        "seg%",
+        "ihdr%",
+        "pad%",
+        "dead%",
+        "free%",
+        "failures"
+    );
+
+    for value_size in VALUE_SIZES {
+        for segment_size in SEGMENT_SIZES {
+            for hash_power in HASH_POWERS {
+                for overflow in OVERFLOW_FACTORS {
+                    run(heap_size, value_size, segment_size, hash_power, overflow);
+                }
+            }
+        }
+    }
+}
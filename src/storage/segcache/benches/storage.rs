@@ -0,0 +1,498 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Runs a `bench_storage` workload (see `legacy/benchmarks/bench_storage.c`)
+//! against `Segcache`, so the Rust and legacy storage engines can be compared
+//! on the same workload.
+//!
+//! Usage:
+//!
+//! ```text
+//! cargo bench --bench storage -- <workload>
+//! ```
+//!
+//! The workload is a `bench_storage` config file, with one `name: value` option
+//! per line. The entries and the stream of keys and operations are generated
+//! from the `seed` option with the same generator and distributions as
+//! `bench_storage`, so both runners see the very same requests, and results are
+//! reported in the same format. Of the storage options, `seg_size`,
+//! `hash_power` and `seg_evict_opt` are used, and the others are ignored. As
+//! with the legacy seg backend, the heap is sized to hold twice the entries.
+//!
+//! When `nthread` is above one, the cache is split into as many shards, with
+//! each thread sending its requests to the shard owning the key.
+
+use segcache::*;
+
+use std::collections::HashMap;
+use std::time::{Duration, Instant};
+
+// keys are formatted into a buffer of this size, with a terminating NUL, as in
+// bench_storage where the key buffer is the size of a `size_t`
+const KEY_SIZE: usize = std::mem::size_of::<usize>();
+
+// room for the header and padding of each item, used to size the heap
+const ITEM_OVERHEAD: usize = 16;
+
+const PERCENTILES: [f64; 4] = [50.0, 90.0, 99.0, 99.9];
+
+const OPS: [&str; 3] = ["get", "put", "rem"];
+
+const GET: usize = 0;
+const PUT: usize = 1;
+const REM: usize = 2;
+
+#[derive(Copy, Clone, PartialEq, Eq)]
+enum Distribution {
+    Uniform,
+    Zipf,
+    Hotspot,
+}
+
+impl Distribution {
+    fn parse(name: &str) -> Option<Self> {
+        match name {
+            "uniform" => Some(Self::Uniform),
+            "zipf" => Some(Self::Zipf),
+            "hotspot" => Some(Self::Hotspot),
+            _ => None,
+        }
+    }
+}
+
+/// The options of a workload, with the defaults of `bench_storage`.
+struct Workload {
+    entry_min_size: usize,
+    entry_max_size: usize,
+    nentries: usize,
+    nops: usize,
+    pct_get: u64,
+    pct_put: u64,
+    nthread: usize,
+    key_dist: Distribution,
+    size_dist: Distribution,
+    zipf_theta: f64,
+    hotspot_pct_key: usize,
+    hotspot_pct_op: u64,
+    latency: bool,
+    seed: u64,
+    seg_size: usize,
+    hash_power: u8,
+    policy: Policy,
+}
+
+fn usage() -> ! {
+    eprintln!("usage: cargo bench --bench storage -- <workload>");
+    std::process::exit(1);
+}
+
+fn parse<T: std::str::FromStr>(options: &HashMap<String, String>, name: &str, default: T) -> T {
+    match options.get(name) {
+        Some(value) => value.parse().unwrap_or_else(|_| {
+            eprintln!("invalid value for {name}: {value}");
+            std::process::exit(1);
+        }),
+        None => default,
+    }
+}
+
+fn workload() -> Workload {
+    // cargo passes `--bench` to benchmarks, so flags are skipped
+    let path = std::env::args()
+        .skip(1)
+        .find(|arg| !arg.starts_with("--"))
+        .unwrap_or_else(|| usage());
+    let config = std::fs::read_to_string(&path).expect("failed to read workload");
+
+    let mut options = HashMap::new();
+    for line in config.lines() {
+        let line = line.split('#').next().unwrap_or("").trim();
+        if let Some((name, value)) = line.split_once(':') {
+            options.insert(name.trim().to_string(), value.trim().to_string());
+        }
+    }
+
+    let key_dist = options.get("key_dist").map(|v| v.as_str());
+    let size_dist = options.get("size_dist").map(|v| v.as_str());
+    let (Some(key_dist), Some(size_dist)) = (
+        Distribution::parse(key_dist.unwrap_or("uniform")),
+        Distribution::parse(size_dist.unwrap_or("uniform")),
+    ) else {
+        eprintln!("unknown key or size distribution");
+        std::process::exit(1);
+    };
+
+    let policy = match parse(&options, "seg_evict_opt", 5) {
+        0 => Policy::None,
+        1 => Policy::Random,
+        2 => Policy::Fifo,
+        3 => Policy::Cte,
+        4 => Policy::Util,
+        5 => Policy::Merge {
+            max: 8,
+            merge: 4,
+            compact: 2,
+        },
+        _ => {
+            eprintln!("unknown seg_evict_opt");
+            std::process::exit(1);
+        }
+    };
+
+    let workload = Workload {
+        entry_min_size: parse(&options, "entry_min_size", 64),
+        entry_max_size: parse(&options, "entry_max_size", 64),
+        nentries: parse(&options, "nentries", 1000),
+        nops: parse(&options, "nops", 100000),
+        pct_get: parse(&options, "pct_get", 80),
+        pct_put: parse(&options, "pct_put", 10),
+        nthread: parse(&options, "nthread", 1),
+        key_dist,
+        size_dist,
+        zipf_theta: parse(&options, "zipf_theta", 0.99),
+        hotspot_pct_key: parse(&options, "hotspot_pct_key", 20),
+        hotspot_pct_op: parse(&options, "hotspot_pct_op", 80),
+        // booleans are "yes" or "no", as in ccommon options
+        latency: options.get("latency").map(|v| v.as_str()) != Some("no"),
+        seed: parse(&options, "seed", 1234),
+        seg_size: parse(&options, "seg_size", 1024 * 1024),
+        hash_power: parse(&options, "hash_power", 16),
+        policy,
+    };
+
+    let pct_rem: u64 = parse(&options, "pct_rem", 10);
+
+    if workload.entry_min_size <= KEY_SIZE {
+        eprintln!("entry_min_size must larger than {KEY_SIZE}");
+        std::process::exit(1);
+    }
+    if workload.pct_get + workload.pct_put + pct_rem != 100 {
+        eprintln!("pct_get, pct_put and pct_rem must add up to 100");
+        std::process::exit(1);
+    }
+    if workload.nthread == 0 || workload.size_dist == Distribution::Hotspot {
+        eprintln!("nthread must be at least 1, and size_dist uniform or zipf");
+        std::process::exit(1);
+    }
+    if (workload.key_dist == Distribution::Zipf || workload.size_dist == Distribution::Zipf)
+        && (workload.zipf_theta <= 0.0 || workload.zipf_theta >= 1.0)
+    {
+        eprintln!("zipf_theta must be in (0, 1)");
+        std::process::exit(1);
+    }
+
+    workload
+}
+
+/// splitmix64, as used by `bench_storage`.
+struct Rng {
+    state: u64,
+}
+
+impl Rng {
+    fn new(seed: u64) -> Self {
+        Self { state: seed }
+    }
+
+    fn next(&mut self) -> u64 {
+        self.state = self.state.wrapping_add(0x9e3779b97f4a7c15);
+        let mut z = self.state;
+        z = (z ^ (z >> 30)).wrapping_mul(0xbf58476d1ce4e5b9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94d049bb133111eb);
+        z ^ (z >> 31)
+    }
+
+    /// A value in `[min, max]`.
+    fn range(&mut self, min: u64, max: u64) -> u64 {
+        self.next() % (max - min + 1) + min
+    }
+
+    /// A value in `[0, 1)`.
+    fn float(&mut self) -> f64 {
+        (self.next() >> 11) as f64 * (1.0 / (1u64 << 53) as f64)
+    }
+}
+
+/// Zipf distribution over `[0, n)`, sampled as in `bench_storage`.
+struct Zipf {
+    n: usize,
+    theta: f64,
+    alpha: f64,
+    zetan: f64,
+    eta: f64,
+}
+
+impl Zipf {
+    fn new(n: usize, theta: f64) -> Self {
+        let zeta2 = 1.0 + 0.5f64.powf(theta);
+        let mut zetan = 0.0;
+        for i in 1..=n {
+            zetan += 1.0 / (i as f64).powf(theta);
+        }
+
+        Self {
+            n,
+            theta,
+            alpha: 1.0 / (1.0 - theta),
+            zetan,
+            eta: (1.0 - (2.0 / n as f64).powf(1.0 - theta)) / (1.0 - zeta2 / zetan),
+        }
+    }
+
+    fn next(&self, rng: &mut Rng) -> usize {
+        let u = rng.float();
+        let uz = u * self.zetan;
+
+        if uz < 1.0 {
+            return 0;
+        }
+        if uz < 1.0 + 0.5f64.powf(self.theta) {
+            return 1.min(self.n - 1);
+        }
+
+        let v = (self.n as f64 * (self.eta * u - self.eta + 1.0).powf(self.alpha)) as usize;
+        v.min(self.n - 1)
+    }
+}
+
+struct Entry {
+    key: Vec<u8>,
+    value: Vec<u8>,
+}
+
+// mirrors `benchmark_entry_create()`, where the key is the id truncated to fit
+// its buffer, and the value is NUL-terminated within the rest of the entry
+fn entry(id: usize, size: usize) -> Entry {
+    let mut key = id.to_string().into_bytes();
+    key.truncate(KEY_SIZE - 1);
+
+    Entry {
+        key,
+        value: vec![b'a'; size - KEY_SIZE - 1],
+    }
+}
+
+fn entries(workload: &Workload, rng: &mut Rng) -> Vec<Entry> {
+    let min = workload.entry_min_size;
+    let max = min.max(workload.entry_max_size);
+    let zipf = (workload.size_dist == Distribution::Zipf)
+        .then(|| Zipf::new(max - min + 1, workload.zipf_theta));
+
+    (1..=workload.nentries)
+        .map(|id| {
+            let size = match &zipf {
+                Some(zipf) => min + zipf.next(rng),
+                None => rng.range(min as u64, max as u64) as usize,
+            };
+            entry(id, size)
+        })
+        .collect()
+}
+
+struct Keys {
+    dist: Distribution,
+    zipf: Option<Zipf>,
+    nentries: usize,
+    nhot: usize,
+    pct_op: u64,
+}
+
+impl Keys {
+    fn new(workload: &Workload) -> Self {
+        Self {
+            dist: workload.key_dist,
+            zipf: (workload.key_dist == Distribution::Zipf)
+                .then(|| Zipf::new(workload.nentries, workload.zipf_theta)),
+            nentries: workload.nentries,
+            nhot: (workload.nentries * workload.hotspot_pct_key / 100).max(1),
+            pct_op: workload.hotspot_pct_op,
+        }
+    }
+
+    // mirrors `benchmark_next_key()`, including the order of the draws
+    fn next(&self, rng: &mut Rng) -> usize {
+        let n = self.nentries as u64;
+        let hot = self.nhot as u64;
+
+        match self.dist {
+            Distribution::Uniform => rng.range(0, n - 1) as usize,
+            Distribution::Zipf => self.zipf.as_ref().unwrap().next(rng),
+            Distribution::Hotspot => {
+                if hot == n || rng.range(0, 99) < self.pct_op {
+                    rng.range(0, hot - 1) as usize
+                } else {
+                    rng.range(hot, n - 1) as usize
+                }
+            }
+        }
+    }
+}
+
+#[derive(Default)]
+struct Worker {
+    nfail: [usize; 3],
+    latency: [Vec<u32>; 3],
+}
+
+fn run(
+    cache: &ShardedSegcache,
+    workload: &Workload,
+    entries: &[Entry],
+    keys: &Keys,
+    seed: u64,
+    nops: usize,
+) -> Worker {
+    let mut rng = Rng::new(seed);
+    let mut worker = Worker::default();
+
+    for _ in 0..nops {
+        let entry = &entries[keys.next(&mut rng)];
+        let pct = rng.range(0, 99);
+        let op = if pct < workload.pct_get {
+            GET
+        } else if pct < workload.pct_get + workload.pct_put {
+            PUT
+        } else {
+            REM
+        };
+
+        let start = Instant::now();
+        let ok = {
+            let mut shard = cache.shard(&entry.key);
+            match op {
+                GET => shard.get(&entry.key).is_some(),
+                PUT => shard
+                    .insert(&entry.key, &entry.value[..], None, Duration::ZERO)
+                    .is_ok(),
+                _ => shard.delete(&entry.key),
+            }
+        };
+        if workload.latency {
+            let ns = start.elapsed().as_nanos().min(u32::MAX as u128) as u32;
+            worker.latency[op].push(ns);
+        }
+
+        // gets and removes of removed entries fail, and are still counted
+        if !ok {
+            worker.nfail[op] += 1;
+        }
+    }
+
+    worker
+}
+
+fn main() {
+    let workload = workload();
+
+    let mut rng = Rng::new(workload.seed);
+    let entries = entries(&workload, &mut rng);
+    let keys = Keys::new(&workload);
+
+    let seg_size = workload.seg_size;
+    let shards = workload.nthread.next_power_of_two();
+    let heap = (2 * workload.nentries * (workload.entry_max_size + ITEM_OVERHEAD))
+        .div_ceil(seg_size)
+        * seg_size
+        + (workload.nthread + 2) * shards * seg_size;
+    let mut hash_power = workload.hash_power;
+    while (1usize << hash_power) < 2 * workload.nentries / shards {
+        hash_power += 1;
+    }
+
+    let cache = Segcache::builder()
+        .heap_size(heap)
+        .segment_size(seg_size as i32)
+        .hash_power(hash_power)
+        .eviction(workload.policy)
+        .shards(shards)
+        .build_sharded()
+        .expect("failed to create cache");
+
+    for entry in &entries {
+        cache
+            .shard(&entry.key)
+            .insert(&entry.key, &entry.value[..], None, Duration::ZERO)
+            .expect("failed to populate cache");
+    }
+
+    let usage = cache.memory_usage();
+    let payload: usize = entries.iter().map(|e| e.key.len() + e.value.len()).sum();
+    println!(
+        "memory: {} B of heap and {} B of metadata for {} B of payload, {:.6} B per payload byte",
+        usage.used,
+        usage.metadata(),
+        payload,
+        (usage.used + usage.metadata()) as f64 / payload as f64
+    );
+
+    let start = Instant::now();
+    let workers: Vec<Worker> = std::thread::scope(|s| {
+        let handles: Vec<_> = (0..workload.nthread)
+            .map(|i| {
+                // operations are split evenly, the first thread takes the
+                // remainder
+                let nops = workload.nops / workload.nthread
+                    + if i == 0 {
+                        workload.nops % workload.nthread
+                    } else {
+                        0
+                    };
+                let seed = workload.seed + i as u64 + 1;
+                let (cache, workload, entries, keys) = (&cache, &workload, &entries, &keys);
+                s.spawn(move || run(cache, workload, entries, keys, seed, nops))
+            })
+            .collect();
+        handles.into_iter().map(|h| h.join().unwrap()).collect()
+    });
+    let elapsed = start.elapsed();
+
+    println!("total benchmark runtime: {:.6} s", elapsed.as_secs_f64());
+    println!(
+        "throughput: {:.6} ops/s with {} thread(s)",
+        workload.nops as f64 / elapsed.as_secs_f64(),
+        workload.nthread
+    );
+    println!(
+        "average operation latency: {:.6} ns",
+        elapsed.as_nanos() as f64 * workload.nthread as f64 / workload.nops as f64
+    );
+
+    for (op, name) in OPS.iter().enumerate() {
+        let nfail: usize = workers.iter().map(|w| w.nfail[op]).sum();
+        if nfail > 0 {
+            println!("{name} failed {nfail} times");
+        }
+    }
+
+    if !workload.latency {
+        return;
+    }
+
+    for (op, name) in OPS.iter().enumerate() {
+        let mut latency: Vec<u32> = workers
+            .iter()
+            .flat_map(|w| w.latency[op].iter().copied())
+            .collect();
+        if latency.is_empty() {
+            continue;
+        }
+        latency.sort_unstable();
+
+        let at = |p: f64| {
+            let rank = ((p / 100.0) * latency.len() as f64).ceil().max(1.0) as usize;
+            latency[rank.min(latency.len()) - 1]
+        };
+
+        println!(
+            "Latency p50, p90, p99, p99.9, max for {} ({} samples): {}, {}, {}, {}, {} ns",
+            name,
+            latency.len(),
+            at(PERCENTILES[0]),
+            at(PERCENTILES[1]),
+            at(PERCENTILES[2]),
+            at(PERCENTILES[3]),
+            latency[latency.len() - 1],
+        );
+    }
+}
@@ -0,0 +1,339 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Replays a cache trace against `Segcache` once for each eviction policy and
+//! reports the miss ratio, throughput, and memory efficiency over the course of
+//! the trace, which makes it possible to compare policies (and changes to
+//! admission or eviction) on a realistic workload.
+//!
+//! Traces are CSV files in the format of the Twitter production cache traces
+//! (<https://github.com/twitter/cache-trace>), with one request per line:
+//!
+//! ```text
+//! timestamp,anonymized key,key size,value size,client id,operation,TTL
+//! ```
+//!
+//! Usage:
+//!
+//! ```text
+//! cargo bench --bench trace -- <trace> [heap size in MB] [max requests]
+//! ```
+//!
+//! Keys are padded to their original size and values are filled in with their
+//! original size, so the memory footprint matches the one seen in production.
+//! The trace is replayed as fast as possible, and TTLs run on the wall clock,
+//! so items only expire during a replay if their TTL is shorter than the time
+//! the replay takes.
+//!
+//! Memory efficiency is the number of bytes held by live items relative to
+//! the size of the heap, as tracked by the `item_current_bytes` metric, and is
+//! only reported when the `metrics` feature is enabled.
+
+use segcache::*;
+
+use std::fs::File;
+use std::io::{BufRead, BufReader};
+use std::time::{Duration, Instant};
+
+pub const MB: usize = 1024 * 1024;
+
+// the number of times the progress of a replay is reported
+const REPORTS: usize = 20;
+
+const KEY_SIZE_MAX: usize = 255;
+
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+enum Op {
+    Get,
+    Set,
+    Delete,
+    Incr,
+    Decr,
+}
+
+struct Request {
+    timestamp: u64,
+    key: Vec<u8>,
+    value_size: usize,
+    op: Op,
+    ttl: Duration,
+}
+
+struct Config {
+    trace: String,
+    heap_size: usize,
+    max_requests: usize,
+}
+
+fn config() -> Config {
+    // cargo passes `--bench` to benchmarks, so flags are skipped
+    let args: Vec<String> = std::env::args()
+        .skip(1)
+        .filter(|arg| !arg.starts_with("--"))
+        .collect();
+
+    if args.is_empty() {
+        eprintln!("usage: cargo bench --bench trace -- <trace> [heap size in MB] [max requests]");
+        std::process::exit(1);
+    }
+
+    let heap_size = args
+        .get(1)
+        .map(|v| v.parse::<usize>().expect("invalid heap size"))
+        .unwrap_or(64)
+        * MB;
+    let max_requests = args
+        .get(2)
+        .map(|v| v.parse::<usize>().expect("invalid max requests"))
+        .unwrap_or(usize::MAX);
+
+    Config {
+        trace: args[0].clone(),
+        heap_size,
+        max_requests,
+    }
+}
+
+// Parses one line of the trace. Operations which do not map to a cache
+// operation, and malformed lines, are skipped.
+fn parse(line: &str) -> Option<Request> {
+    let mut fields = line.split(',');
+
+    let timestamp = fields.next()?.parse().ok()?;
+    let key = fields.next()?;
+    let key_size: usize = fields.next()?.parse().ok()?;
+    let value_size = fields.next()?.parse().ok()?;
+    let _client = fields.next()?;
+    let op = match fields.next()? {
+        "get" | "gets" => Op::Get,
+        "set" | "add" | "replace" | "cas" | "append" | "prepend" => Op::Set,
+        "delete" => Op::Delete,
+        "incr" => Op::Incr,
+        "decr" => Op::Decr,
+        _ => return None,
+    };
+    let ttl = Duration::from_secs(fields.next()?.trim().parse().ok()?);
+
+    // anonymized keys may be shorter than the original ones, pad them so that
+    // items take the same amount of memory
+    let mut key = key.as_bytes().to_vec();
+    let size = key_size.min(KEY_SIZE_MAX);
+    if key.len() < size {
+        key.resize(size, b'_');
+    }
+    if key.is_empty() || key.len() > KEY_SIZE_MAX {
+        return None;
+    }
+
+    Some(Request {
+        timestamp,
+        key,
+        value_size,
+        op,
+        ttl,
+    })
+}
+
+fn load(config: &Config) -> Vec<Request> {
+    let file = File::open(&config.trace).expect("failed to open trace");
+
+    let mut requests = Vec::new();
+    let mut skipped = 0;
+
+    for line in BufReader::new(file).lines() {
+        if requests.len() >= config.max_requests {
+            break;
+        }
+        let line = line.expect("failed to read trace");
+        match parse(&line) {
+            Some(request) => requests.push(request),
+            None => skipped += 1,
+        }
+    }
+
+    println!(
+        "trace: {} requests loaded, {} lines skipped",
+        requests.len(),
+        skipped
+    );
+
+    requests
+}
+
+// bytes held by live items in all caches, if metrics are enabled
+fn live_bytes() -> Option<i64> {
+    for metric in &metriken::metrics() {
+        if metric.name() == "item_current_bytes" {
+            if let Some(metriken::Value::Gauge(value)) = metric.value() {
+                return Some(value);
+            }
+        }
+    }
+    None
+}
+
+#[derive(Default)]
+struct Stats {
+    requests: usize,
+    gets: usize,
+    misses: usize,
+    set_failures: usize,
+    elapsed: Duration,
+}
+
+impl Stats {
+    fn miss_ratio(&self) -> f64 {
+        if self.gets == 0 {
+            0.0
+        } else {
+            self.misses as f64 / self.gets as f64
+        }
+    }
+
+    fn throughput(&self) -> f64 {
+        self.requests as f64 / self.elapsed.as_secs_f64() / 1_000_000.0
+    }
+}
+
+fn replay(config: &Config, requests: &[Request], values: &[u8], policy: Policy) {
+    let mut cache = Segcache::builder()
+        .hash_power(20)
+        .max_hash_power(26)
+        .heap_size(config.heap_size)
+        .segment_size(MB as i32)
+        .eviction(policy)
+        .build()
+        .expect("failed to create cache");
+
+    // metrics are global, and account for the items of the caches replayed
+    // before which have not been freed yet
+    let baseline = live_bytes();
+
+    let interval = (requests.len() / REPORTS).max(1);
+
+    let mut total = Stats::default();
+    let mut efficiency = Vec::new();
+
+    println!("\npolicy: {policy:?}");
+    println!(
+        "{:>12} {:>12} {:>10} {:>10} {:>10}",
+        "timestamp", "requests", "miss ratio", "Mops/s", "mem eff"
+    );
+
+    for chunk in requests.chunks(interval) {
+        let mut window = Stats::default();
+        let start = Instant::now();
+
+        for request in chunk {
+            match request.op {
+                Op::Get => {
+                    window.gets += 1;
+                    if cache.get(&request.key).is_none() {
+                        window.misses += 1;
+                    }
+                }
+                Op::Set => {
+                    let value = &values[..request.value_size.min(values.len())];
+                    if cache
+                        .insert(&request.key, value, None, request.ttl)
+                        .is_err()
+                    {
+                        window.set_failures += 1;
+                    }
+                }
+                Op::Delete => {
+                    cache.delete(&request.key);
+                }
+                Op::Incr => {
+                    let _ = cache.wrapping_add(&request.key, 1);
+                }
+                Op::Decr => {
+                    let _ = cache.saturating_sub(&request.key, 1);
+                }
+            }
+        }
+
+        window.elapsed = start.elapsed();
+        window.requests = chunk.len();
+
+        let eff = live_bytes()
+            .zip(baseline)
+            .map(|(bytes, baseline)| (bytes - baseline) as f64 / config.heap_size as f64);
+
+        println!(
+            "{:>12} {:>12} {:>10.4} {:>10.2} {:>10}",
+            chunk[chunk.len() - 1].timestamp,
+            total.requests + window.requests,
+            window.miss_ratio(),
+            window.throughput(),
+            eff.map(|e| format!("{e:.4}"))
+                .unwrap_or_else(|| "n/a".to_string()),
+        );
+
+        if let Some(eff) = eff {
+            efficiency.push(eff);
+        }
+
+        total.requests += window.requests;
+        total.gets += window.gets;
+        total.misses += window.misses;
+        total.set_failures += window.set_failures;
+        total.elapsed += window.elapsed;
+    }
+
+    let mean_efficiency = if efficiency.is_empty() {
+        "n/a".to_string()
+    } else {
+        format!(
+            "{:.4}",
+            efficiency.iter().sum::<f64>() / efficiency.len() as f64
+        )
+    };
+
+    println!(
+        "total: miss ratio {:.4} ({} of {} gets) throughput {:.2} Mops/s \
+        mean mem eff {} set failures {}",
+        total.miss_ratio(),
+        total.misses,
+        total.gets,
+        total.throughput(),
+        mean_efficiency,
+        total.set_failures,
+    );
+}
+
+fn main() {
+    let config = config();
+    let requests = load(&config);
+
+    if requests.is_empty() {
+        return;
+    }
+
+    // values larger than a segment never fit, so a segment worth of value is
+    // enough for all requests
+    let values = vec![0; MB];
+
+    for policy in [
+        Policy::Random,
+        Policy::RandomFifo,
+        Policy::Fifo,
+        Policy::Cte,
+        Policy::Util,
+        Policy::Score {
+            samples: 16,
+            hits: 100,
+            age: 25,
+            ttl: 25,
+        },
+        Policy::S3Fifo,
+        Policy::Merge {
+            max: 8,
+            merge: 4,
+            compact: 2,
+        },
+    ] {
+        replay(&config, &requests, &values, policy);
+    }
+}
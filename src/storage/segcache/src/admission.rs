@@ -0,0 +1,167 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! An optional TinyLFU admission filter for inserts.
+//!
+//! Every key which is read or written is counted by the filter. The first
+//! access to a key only sets its bits in a bloom filter, the doorkeeper, so
+//! that keys which are accessed once do not occupy the count-min sketch which
+//! tracks the frequency of all other keys. The counts are halved and the
+//! doorkeeper is cleared after every window of accesses so that the estimates
+//! reflect recent popularity.
+//!
+//! When the cache has no free segments, an insert of a new key is only
+//! admitted if the key has been accessed at least the threshold number of
+//! times within the window. This keeps one-hit-wonder writes from evicting
+//! items which are more likely to be read.
+//!
+//! Both the doorkeeper and the sketch keep everything for a key within one
+//! cache line, so recording an access costs one miss in each.
+
+#[cfg(feature = "metrics")]
+use crate::metrics::*;
+
+use ahash::RandomState;
+use bloom::{BlockedBloomFilter, BlockedCountingFilter};
+use core::hash::{BuildHasher, Hasher};
+
+/// Keys must be accessed at least this many times before they are admitted
+/// under eviction pressure by default.
+pub const DEFAULT_ADMISSION_THRESHOLD: u8 = 1;
+
+// number of counters for each key in the count-min sketch
+const SKETCH_DEPTH: usize = 4;
+
+/// The admission filter state.
+pub(crate) struct Admission {
+    hash_builder: RandomState,
+    doorkeeper: BlockedBloomFilter,
+    sketch: BlockedCountingFilter,
+    window: usize,
+    accesses: usize,
+    threshold: u8,
+}
+
+impl Admission {
+    /// Create a new admission filter which tracks the frequency of keys over
+    /// a window of `window` accesses and admits keys which have been accessed
+    /// at least `threshold` times.
+    pub fn new(window: usize, threshold: u8) -> Self {
+        let window = window.max(64);
+        let width = window.next_power_of_two();
+
+        // NOTE: these seeds must differ from those used by the `HashTable` and
+        // the `ShardedSegcache` so that the estimates are independent of the
+        // bucket and shard selection
+        let hash_builder = RandomState::with_seeds(
+            0x6a09e667f3bcc908,
+            0x3c6ef372fe94f82b,
+            0x1f83d9abfb41bd6b,
+            0x5be0cd19137e2179,
+        );
+
+        Self {
+            hash_builder,
+            // 8 bits per key and 4 hashes gives roughly a 2% false positive
+            // rate when the window is full
+            doorkeeper: BlockedBloomFilter::new(width * 8, 4),
+            // counters saturate at 15, as only small frequencies matter
+            sketch: BlockedCountingFilter::new(width * SKETCH_DEPTH, SKETCH_DEPTH),
+            window,
+            accesses: 0,
+            threshold,
+        }
+    }
+
+    /// Returns the pair of hashes for the key.
+    fn hash(&self, key: &[u8]) -> (u64, u64) {
+        let mut hasher = self.hash_builder.build_hasher();
+        hasher.write(key);
+        let hash = hasher.finish();
+        // the block is picked from the high bits of the first hash, so the
+        // second must be made from the low bits to be independent of it
+        (hash, hash.rotate_left(32))
+    }
+
+    /// Returns the estimated number of accesses to the key within the window.
+    fn estimate(&self, hash1: u64, hash2: u64) -> u8 {
+        if !self.doorkeeper.contains(hash1, hash2) {
+            return 0;
+        }
+
+        1 + self.sketch.estimate(hash1, hash2)
+    }
+
+    /// Counts an access to the key.
+    pub fn record(&mut self, key: &[u8]) {
+        let (hash1, hash2) = self.hash(key);
+        self.increment(hash1, hash2);
+    }
+
+    fn increment(&mut self, hash1: u64, hash2: u64) {
+        if !self.doorkeeper.contains(hash1, hash2) {
+            self.doorkeeper.insert(hash1, hash2);
+        } else {
+            self.sketch.increment(hash1, hash2);
+        }
+
+        self.accesses += 1;
+        if self.accesses >= self.window {
+            self.reset();
+        }
+    }
+
+    /// Ages the estimates by halving the counts and clearing the doorkeeper.
+    fn reset(&mut self) {
+        self.sketch.age();
+        self.doorkeeper.clear();
+        self.accesses = 0;
+
+        #[cfg(feature = "metrics")]
+        ADMISSION_RESET.increment();
+    }
+
+    /// Counts a write of the key and returns whether a new item for the key
+    /// should be admitted when the cache is under eviction pressure. The
+    /// frequency is estimated before this write is counted, so a rejected key
+    /// will be admitted once it has been accessed enough times.
+    pub fn admit(&mut self, key: &[u8]) -> bool {
+        let (hash1, hash2) = self.hash(key);
+        let admit = self.estimate(hash1, hash2) >= self.threshold;
+        self.increment(hash1, hash2);
+        admit
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn admit() {
+        let mut admission = Admission::new(1024, 2);
+
+        // the key is admitted after it has been seen twice
+        assert!(!admission.admit(b"coffee"));
+        admission.record(b"coffee");
+        assert!(admission.admit(b"coffee"));
+
+        // other keys are unaffected
+        assert!(!admission.admit(b"tea"));
+    }
+
+    #[test]
+    fn reset() {
+        let mut admission = Admission::new(64, 1);
+
+        admission.record(b"coffee");
+        assert!(admission.admit(b"coffee"));
+
+        // the doorkeeper is cleared once the window is full
+        for i in 0..64 {
+            admission.record(format!("{i}").as_bytes());
+        }
+        assert!(!admission.admit(b"coffee"));
+    }
+}
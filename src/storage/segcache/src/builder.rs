@@ -4,14 +4,40 @@
 
 //! A builder for configuring a new [`Segcache`] instance.
 
+use crate::compaction::Compaction;
+use crate::namespace::Namespaces;
+use crate::stale::{Stale, DEFAULT_LEASE_TTL};
+use crate::touch::Touched;
 use crate::*;
-use std::path::Path;
+use datatier::{Datapool, MmapFile, HEADER_SIZE};
+use std::path::{Path, PathBuf};
 
 /// A builder that is used to construct a new [`Segcache`] instance.
 pub struct Builder {
     hash_power: u8,
+    max_hash_power: u8,
     overflow_factor: f64,
     segments_builder: SegmentsBuilder,
+    shards: usize,
+    partitions: Vec<(String, Vec<u8>, Builder)>,
+    metadata_path: Option<PathBuf>,
+    admission: Option<usize>,
+    admission_threshold: u8,
+    mrc: Option<usize>,
+    free_reserve: usize,
+    compact_threshold: f64,
+    large_values: bool,
+    stale_grace: std::time::Duration,
+    lease_ttl: std::time::Duration,
+    namespaces: bool,
+    exact_ttls: Vec<u32>,
+    huge_pages: HugePages,
+    #[cfg(feature = "compression")]
+    compression: Option<i32>,
+    #[cfg(feature = "compression")]
+    compression_threshold: usize,
+    #[cfg(feature = "key-prefixes")]
+    key_prefixes: Vec<Vec<u8>>,
 }
 
 // Defines the default parameters
@@ -19,8 +45,29 @@ impl Default for Builder {
     fn default() -> Self {
         Self {
             hash_power: 16,
+            max_hash_power: 0,
             overflow_factor: 0.0,
             segments_builder: SegmentsBuilder::default(),
+            shards: 1,
+            partitions: Vec::new(),
+            metadata_path: None,
+            admission: None,
+            admission_threshold: DEFAULT_ADMISSION_THRESHOLD,
+            mrc: None,
+            free_reserve: 0,
+            compact_threshold: 0.0,
+            large_values: false,
+            stale_grace: std::time::Duration::ZERO,
+            lease_ttl: DEFAULT_LEASE_TTL,
+            namespaces: false,
+            exact_ttls: Vec::new(),
+            huge_pages: HugePages::Disabled,
+            #[cfg(feature = "compression")]
+            compression: None,
+            #[cfg(feature = "compression")]
+            compression_threshold: DEFAULT_COMPRESSION_THRESHOLD,
+            #[cfg(feature = "key-prefixes")]
+            key_prefixes: Vec::new(),
         }
     }
 }
@@ -48,6 +95,26 @@ impl Builder {
         self
     }
 
+    /// Specify the maximum hash power the hashtable may grow to. When the
+    /// hashtable runs out of room for an item, it doubles in size and the
+    /// existing entries are migrated incrementally as part of inserts and
+    /// expiration. Values which do not exceed the hash power disable growth,
+    /// which is the default.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    ///
+    /// // start with a small hashtable which can grow to hold ~1.8M items
+    /// let cache = Segcache::builder()
+    ///     .hash_power(16)
+    ///     .max_hash_power(21)
+    ///     .build();
+    /// ```
+    pub fn max_hash_power(mut self, hash_power: u8) -> Self {
+        self.max_hash_power = hash_power;
+        self
+    }
+
     /// Specify an overflow factor which is used to scale the hashtable and
     /// provide additional capacity for chaining item buckets. A factor of 1.0
     /// will result in a hash table that is 100% larger.
@@ -139,12 +206,455 @@ impl Builder {
     ///
     /// # Panics
     ///
-    /// This will panic if the file already exists
+    /// This will panic if the file already exists, unless a metadata path is
+    /// also provided.
     pub fn datapool_path<T: AsRef<Path>>(mut self, path: Option<T>) -> Self {
         self.segments_builder = self.segments_builder.datapool_path(path);
         self
     }
 
+    /// Specify a NUMA node to place the heap on, typically the node of the
+    /// thread which accesses the cache. The pages of the heap are allocated
+    /// from other nodes once the node runs out of free memory. This has no
+    /// effect when a datapool path is provided. By default, the heap is placed
+    /// by the default memory policy of the thread which builds the cache.
+    pub fn numa_node(mut self, node: Option<usize>) -> Self {
+        self.segments_builder = self.segments_builder.numa_node(node);
+        self
+    }
+
+    /// Specify the size of the pages which back the heap and the hashtable.
+    /// Huge pages cover the heap with fewer TLB entries, which avoids a TLB
+    /// miss on most random reads of a large cache, and take fewer faults to
+    /// prefault at startup. Pages from the hugetlb pool must be reserved by
+    /// the host, and transparent huge pages are used instead when there are
+    /// not enough of them. This has no effect on the heap when a datapool
+    /// path is provided. By default, regular pages are used.
+    ///
+    /// ```
+    /// use segcache::{HugePages, Segcache};
+    ///
+    /// let cache = Segcache::builder()
+    ///     .huge_pages(HugePages::Transparent)
+    ///     .build()
+    ///     .expect("failed to create cache");
+    /// ```
+    pub fn huge_pages(mut self, huge_pages: HugePages) -> Self {
+        self.huge_pages = huge_pages;
+        self.segments_builder = self.segments_builder.huge_pages(huge_pages);
+        self
+    }
+
+    /// Specify a file which is used to save the hashtable, segment headers,
+    /// and TTL buckets when [`Segcache::persist`] is called. This requires a
+    /// datapool path. If the metadata and datapool files exist when the cache
+    /// is built, the cache is restored from them. Otherwise, or if they do not
+    /// match the configuration, any existing files are removed and the cache
+    /// starts empty. The metadata file is consumed by a restore so that it is
+    /// never applied to a datapool which has since been modified.
+    pub fn metadata_path<T: AsRef<Path>>(mut self, path: Option<T>) -> Self {
+        self.metadata_path = path.map(|p| p.as_ref().to_owned());
+        self
+    }
+
+    /// Specify a file to hold a flash tier of segments beneath the heap. Items
+    /// which are evicted from the heap are moved into the flash tier and are
+    /// moved back into the heap when they are read. The file should be on
+    /// fast storage, such as an NVMe drive, and is replaced when the cache is
+    /// built unless the cache is restored from a metadata file. The flash tier
+    /// is disabled by default.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    ///
+    /// const MB: usize = 1024 * 1024;
+    ///
+    /// let dir = tempfile::tempdir().expect("failed to create tempdir");
+    ///
+    /// // back a 64MB heap with a 256MB flash tier
+    /// let cache = Segcache::builder()
+    ///     .heap_size(64 * MB)
+    ///     .flash_path(Some(dir.path().join("flash")))
+    ///     .flash_size(256 * MB)
+    ///     .build();
+    /// ```
+    pub fn flash_path<T: AsRef<Path>>(mut self, path: Option<T>) -> Self {
+        self.segments_builder = self.segments_builder.flash_path(path);
+        self
+    }
+
+    /// Specify the size of the flash tier in bytes. This has no effect unless
+    /// a flash path or node is provided.
+    pub fn flash_size(mut self, bytes: usize) -> Self {
+        self.segments_builder = self.segments_builder.flash_size(bytes);
+        self
+    }
+
+    /// Specify a NUMA node on which to hold the flash tier in memory when no
+    /// flash path is provided. This suits a CXL memory expander, which adds
+    /// memory on a node without cores that is larger and slower than local
+    /// memory. The tier is lost on a restart, so it is not saved by
+    /// [`Segcache::persist`], and its items are removed when the cache is
+    /// persisted.
+    pub fn flash_node(mut self, node: Option<usize>) -> Self {
+        self.segments_builder = self.segments_builder.flash_node(node);
+        self
+    }
+
+    /// Specify the age past which merge eviction moves a segment into the
+    /// flash tier whole, rather than merging its items into a younger
+    /// segment. Items which are read from the tier are moved back into the
+    /// heap, so the heap is left holding the new and recently read items. By
+    /// default, only the items which eviction would drop are moved into the
+    /// tier. This has no effect without a flash tier.
+    ///
+    /// ```
+    /// use segcache::{Policy, Segcache};
+    /// use std::time::Duration;
+    ///
+    /// const MB: usize = 1024 * 1024;
+    ///
+    /// // hold a 256MB tier on NUMA node 0, and move segments into it once
+    /// // they are an hour old
+    /// let cache = Segcache::builder()
+    ///     .heap_size(64 * MB)
+    ///     .eviction(Policy::Merge { max: 8, merge: 4, compact: 2 })
+    ///     .flash_node(Some(0))
+    ///     .flash_size(256 * MB)
+    ///     .flash_age(Duration::from_secs(3600))
+    ///     .build();
+    /// ```
+    pub fn flash_age(mut self, age: std::time::Duration) -> Self {
+        let age = Duration::from_secs(std::cmp::min(u32::MAX as u64, age.as_secs()) as u32);
+        self.segments_builder = self
+            .segments_builder
+            .flash_age(Some(age).filter(|age| age.as_secs() > 0));
+        self
+    }
+
+    /// Specify the number of free segments which [`Segcache::maintain`]
+    /// keeps in reserve by evicting ahead of writes. Inserts which would
+    /// otherwise evict a segment inline can instead take one from the
+    /// reserve, which moves the cost of eviction out of the request path. The
+    /// default of zero leaves all eviction to inserts.
+    pub fn free_reserve(mut self, segments: usize) -> Self {
+        self.free_reserve = segments;
+        self
+    }
+
+    /// Specify the occupancy, as a fraction of the segment size, at or below
+    /// which adjacent segments of a TTL bucket are merged by
+    /// [`Segcache::maintain`], returning the segments which are emptied to the
+    /// free queue. This reclaims the memory of segments whose items were
+    /// mostly overwritten or deleted without waiting for them to be evicted.
+    /// Each call does a bounded amount of work. The default of zero disables
+    /// background compaction.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    ///
+    /// let cache = Segcache::builder()
+    ///     .compact_threshold(0.25)
+    ///     .build()
+    ///     .expect("failed to create cache");
+    /// ```
+    pub fn compact_threshold(mut self, ratio: f64) -> Self {
+        self.compact_threshold = ratio;
+        self
+    }
+
+    /// Enable the storage of values which are too large to fit in a segment by
+    /// splitting them into chunks, which are stored as items of their own and
+    /// assembled again when read. This allows the segment size to be chosen
+    /// for the typical item rather than the largest. Values may take up to
+    /// half of the heap. When disabled, which is the default, such values are
+    /// rejected as oversized.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder()
+    ///     .segment_size(64 * 1024)
+    ///     .large_values(true)
+    ///     .build()
+    ///     .expect("failed to create cache");
+    ///
+    /// let value = vec![0; 256 * 1024];
+    /// assert!(cache.insert(b"coffee", &value, None, Duration::ZERO).is_ok());
+    /// assert_eq!(cache.get(b"coffee").unwrap().value(), value.as_slice());
+    /// ```
+    pub fn large_values(mut self, enabled: bool) -> Self {
+        self.large_values = enabled;
+        self
+    }
+
+    /// Specify a grace period for which items are kept once they expire, and
+    /// may still be read as stale with [`Segcache::get_stale`] while a client
+    /// which holds the lease for the key recomputes them. Segments are held
+    /// for the grace period beyond their expiry, which takes up heap that
+    /// would otherwise be free. The default of zero expires items right away.
+    pub fn stale_grace(mut self, grace: std::time::Duration) -> Self {
+        self.stale_grace = grace;
+        self
+    }
+
+    /// Specify how long a lease granted by [`Segcache::lease`] is held for if
+    /// the key is not stored in the meantime. The default is 30 seconds.
+    pub fn lease_ttl(mut self, ttl: std::time::Duration) -> Self {
+        self.lease_ttl = ttl;
+        self
+    }
+
+    /// Enable namespaces, which allow all the keys with a prefix to be
+    /// invalidated at once with [`Segcache::invalidate_prefix`]. Each item
+    /// then holds a 32 bit generation, and reads look its key up by the
+    /// length of each invalidated prefix. Namespaces are disabled by default.
+    pub fn namespaces(mut self, enabled: bool) -> Self {
+        self.namespaces = enabled;
+        self
+    }
+
+    /// Specify TTLs which are each given a ttl bucket of their own, such as
+    /// those a workload clusters around. Items are otherwise held in segments
+    /// with the shortest TTL of a bucket which covers a range of TTLs, so
+    /// they may expire early, by up to 9 hours for the longest TTLs, and
+    /// share segments with items of other TTLs. Items with an exact TTL are
+    /// kept for their full TTL in segments which only hold items of that TTL.
+    /// TTLs are rounded down to the second.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder()
+    ///     .exact_ttls(&[Duration::from_secs(300), Duration::from_secs(86400)])
+    ///     .build()
+    ///     .expect("failed to create cache");
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::from_secs(300));
+    /// let item = cache.get(b"coffee").expect("didn't get item back");
+    /// assert!(cache.ttl(&item).unwrap() >= Duration::from_secs(299));
+    /// ```
+    pub fn exact_ttls(mut self, ttls: &[std::time::Duration]) -> Self {
+        self.exact_ttls = ttls
+            .iter()
+            .map(|ttl| std::cmp::min(u32::MAX as u64, ttl.as_secs()) as u32)
+            .collect();
+        self
+    }
+
+    /// Enable a TinyLFU admission filter which tracks the frequency of keys
+    /// over a window of the provided number of reads and writes. Once the
+    /// cache has no free segments, inserts of new keys which have not been
+    /// accessed at least the admission threshold number of times within the
+    /// window are dropped, so that items which are written once and never
+    /// read do not cause the eviction of more popular items. The window
+    /// should be at least the number of items the cache is expected to hold.
+    /// Admission is disabled by default.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    ///
+    /// // admit keys which were accessed once before within the last 1M
+    /// // accesses
+    /// let cache = Segcache::builder()
+    ///     .admission(Some(1024 * 1024))
+    ///     .admission_threshold(1)
+    ///     .build();
+    /// ```
+    pub fn admission(mut self, window: Option<usize>) -> Self {
+        self.admission = window;
+        self
+    }
+
+    /// Specify the number of accesses within the window which are required
+    /// for a new key to be admitted while the cache is full. This has no
+    /// effect unless admission is enabled.
+    pub fn admission_threshold(mut self, accesses: u8) -> Self {
+        self.admission_threshold = accesses;
+        self
+    }
+
+    /// Returns a new admission filter if admission is enabled.
+    fn admission_filter(&self) -> Option<Admission> {
+        self.admission
+            .map(|window| Admission::new(window, self.admission_threshold))
+    }
+
+    /// Enable an online estimate of the miss ratio curve, which tracks up to
+    /// the provided number of keys sampled by their hash to estimate the hit
+    /// ratio the cache would have at other heap sizes. A few thousand keys are
+    /// enough for an estimate within a few percent. The estimate is disabled
+    /// by default.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder()
+    ///     .mrc(Some(8192))
+    ///     .build()
+    ///     .expect("failed to create cache");
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    /// assert!(cache.get(b"coffee").is_some());
+    ///
+    /// let curve = cache.miss_ratio_curve(&[1024 * 1024]).unwrap();
+    /// assert_eq!(curve.points[0].1, 1.0);
+    /// ```
+    pub fn mrc(mut self, keys: Option<usize>) -> Self {
+        self.mrc = keys;
+        self
+    }
+
+    /// Returns a new miss ratio curve estimator if it is enabled.
+    fn mrc_estimator(&self) -> Option<Mrc> {
+        self.mrc
+            .map(|keys| Mrc::new(self.segments_builder.heap_size, keys))
+    }
+
+    /// Enable compression of item values using zstd at the provided
+    /// compression level. Values are compressed as they are written if they
+    /// are at least the compression threshold in size and are decompressed
+    /// when read. Compression is disabled by default.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    ///
+    /// // compress values of 1KB or more using the default zstd level
+    /// let cache = Segcache::builder()
+    ///     .compression(Some(3))
+    ///     .compression_threshold(1024)
+    ///     .build();
+    /// ```
+    #[cfg(feature = "compression")]
+    pub fn compression(mut self, level: Option<i32>) -> Self {
+        self.compression = level;
+        self
+    }
+
+    /// Specify the minimum size of a value in bytes for it to be compressed.
+    /// This has no effect unless compression is enabled. Smaller values tend
+    /// to compress poorly and cost more to decompress than they save.
+    #[cfg(feature = "compression")]
+    pub fn compression_threshold(mut self, bytes: usize) -> Self {
+        self.compression_threshold = bytes;
+        self
+    }
+
+    /// Returns a new value compressor if compression is enabled.
+    #[cfg(feature = "compression")]
+    fn compressor(&self) -> Result<Option<Compressor>, std::io::Error> {
+        self.compression
+            .map(|level| Compressor::new(level, self.compression_threshold))
+            .transpose()
+    }
+
+    /// Register prefixes which are shared by many keys, such as
+    /// `service:v3:user:`. Items whose key starts with one of them hold a one
+    /// byte id in place of the longest such prefix. Prefixes are registered
+    /// for every cache in the process when the cache is built, and at most 255
+    /// prefixes of 2 to 255 bytes may be registered. A cache which is restored
+    /// must be built with the same prefixes as when it was saved.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    ///
+    /// let mut cache = Segcache::builder()
+    ///     .key_prefixes(&[b"service:v3:user:"])
+    ///     .build()
+    ///     .expect("failed to create cache");
+    ///
+    /// let key = b"service:v3:user:42:profile";
+    /// assert!(cache.insert(key, b"coffee", None, std::time::Duration::ZERO).is_ok());
+    /// assert_eq!(cache.get(key).unwrap().key(), key);
+    /// ```
+    #[cfg(feature = "key-prefixes")]
+    pub fn key_prefixes<T: AsRef<[u8]>>(mut self, prefixes: &[T]) -> Self {
+        self.key_prefixes = prefixes.iter().map(|p| p.as_ref().to_vec()).collect();
+        self
+    }
+
+    /// Registers the key prefixes, returning an error if one can't be
+    /// registered.
+    #[cfg(feature = "key-prefixes")]
+    fn register_prefixes(&self) -> Result<(), std::io::Error> {
+        for prefix in &self.key_prefixes {
+            if crate::prefix::register(prefix).is_none() {
+                return Err(std::io::Error::new(
+                    std::io::ErrorKind::InvalidInput,
+                    "key prefix could not be registered",
+                ));
+            }
+        }
+        Ok(())
+    }
+
+    /// Specify the number of shards to use when building a
+    /// [`ShardedSegcache`]. The heap and hashtable are divided evenly between
+    /// the shards. The number of shards must be a power of two and has no
+    /// effect on [`Builder::build`].
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    ///
+    /// const MB: usize = 1024 * 1024;
+    ///
+    /// // create a cache with a 256MB heap split across 8 shards
+    /// let cache = Segcache::builder()
+    ///     .heap_size(256 * MB)
+    ///     .shards(8)
+    ///     .build_sharded();
+    /// ```
+    pub fn shards(mut self, shards: usize) -> Self {
+        assert!(
+            shards.is_power_of_two(),
+            "number of shards must be a power of two"
+        );
+        self.shards = shards;
+        self
+    }
+
+    /// Add a named partition which holds the keys that start with the prefix,
+    /// when building a [`ShardedSegcache`]. The partition is built from its
+    /// own builder, so it has its own heap, hashtable, ttl buckets, eviction
+    /// policy, and shards, and the items of one partition never evict those
+    /// of another. A key belongs to the partition with the longest matching
+    /// prefix, and keys which match none belong to the default partition that
+    /// is built from this builder. Partitions have no effect on
+    /// [`Builder::build`].
+    ///
+    /// ```
+    /// use segcache::{Policy, Segcache};
+    ///
+    /// const MB: usize = 1024 * 1024;
+    ///
+    /// // keys starting with `session:` are kept in their own 16MB heap
+    /// let cache = Segcache::builder()
+    ///     .heap_size(64 * MB)
+    ///     .partition(
+    ///         "sessions",
+    ///         b"session:",
+    ///         Segcache::builder().heap_size(16 * MB).eviction(Policy::Fifo),
+    ///     )
+    ///     .build_sharded()
+    ///     .expect("failed to create cache");
+    ///
+    /// assert_eq!(cache.router().partition_index(b"session:1"), 1);
+    /// assert_eq!(cache.router().partition_index(b"user:1"), 0);
+    /// ```
+    pub fn partition(mut self, name: &str, prefix: &[u8], builder: Builder) -> Self {
+        assert!(!prefix.is_empty(), "partition prefix must not be empty");
+        assert!(
+            builder.partitions.is_empty(),
+            "partitions may not be nested"
+        );
+        self.partitions
+            .push((name.to_string(), prefix.to_vec(), builder));
+        self
+    }
+
     /// Consumes the builder and returns a fully-allocated `Segcache` instance.
     ///
     /// ```
@@ -159,15 +669,226 @@ impl Builder {
     ///     .eviction(Policy::Random).build();
     /// ```
     pub fn build(self) -> Result<Segcache, std::io::Error> {
-        let hashtable = HashTable::new(self.hash_power, self.overflow_factor);
+        // prefixes are registered ahead of any restore, so that the items
+        // which are restored have the ids they were saved with
+        #[cfg(feature = "key-prefixes")]
+        self.register_prefixes()?;
+
+        if let Some(metadata_path) = &self.metadata_path {
+            let datapool_path = self
+                .segments_builder
+                .datapool_path
+                .as_ref()
+                .ok_or_else(|| {
+                    std::io::Error::new(
+                        std::io::ErrorKind::InvalidInput,
+                        "metadata path requires a datapool path",
+                    )
+                })?;
+
+            if metadata_path.exists() {
+                let restored = self.restore(metadata_path);
+                std::fs::remove_file(metadata_path)?;
+                match restored {
+                    Ok(cache) => {
+                        info!("restored cache from: {:?}", metadata_path);
+                        return Ok(cache);
+                    }
+                    Err(e) => {
+                        warn!("failed to restore cache from {:?}: {}", metadata_path, e);
+                    }
+                }
+            }
+
+            // without valid metadata the datapool contents can't be used
+            if datapool_path.exists() {
+                std::fs::remove_file(datapool_path)?;
+            }
+        }
+
+        // the flash tier is only restored along with the metadata
+        if let Some(flash_path) = &self.segments_builder.flash_path {
+            if flash_path.exists() {
+                std::fs::remove_file(flash_path)?;
+            }
+        }
+
+        #[cfg(feature = "compression")]
+        let compressor = self.compressor()?;
+        let hashtable = HashTable::new(self.hash_power, self.overflow_factor, self.huge_pages)
+            .max_power(self.max_hash_power);
+        let admission = self.admission_filter();
+        let mrc = self.mrc_estimator();
         let segments = self.segments_builder.build()?;
-        let ttl_buckets = TtlBuckets::default();
+        let ttl_buckets = TtlBuckets::with_exact(&self.exact_ttls);
+
+        Ok(Segcache {
+            hashtable,
+            segments,
+            ttl_buckets,
+            time: Instant::now(),
+            metadata_path: self.metadata_path,
+            admission,
+            mrc,
+            access: AccessStats::default(),
+            free_reserve: self.free_reserve,
+            compaction: Compaction::new(self.compact_threshold),
+            large_values: self.large_values,
+            large_id: rng().gen(),
+            touched: Touched::new(),
+            stale: Stale::new(self.stale_grace, self.lease_ttl),
+            namespaces: Namespaces::new(self.namespaces),
+            #[cfg(feature = "compression")]
+            compressor,
+        })
+    }
+
+    /// Restores a `Segcache` from the metadata file and the existing datapool
+    /// file.
+    fn restore(&self, metadata_path: &Path) -> Result<Segcache, std::io::Error> {
+        // the metadata size is determined by the saved hashtable, so it is
+        // taken from the size of the file
+        let size = (std::fs::metadata(metadata_path)?.len() as usize)
+            .checked_sub(HEADER_SIZE)
+            .ok_or_else(|| std::io::Error::new(std::io::ErrorKind::Other, "metadata too small"))?;
+        let metadata = MmapFile::open(metadata_path, size, crate::VERSION)?;
+        let mut reader = MetadataReader::new(metadata.as_slice())?;
+
+        let hashtable = HashTable::new(self.hash_power, self.overflow_factor, self.huge_pages)
+            .max_power(self.max_hash_power)
+            .restore(&mut reader)?;
+        let segments = self.segments_builder.clone().restore(&mut reader)?;
+        let ttl_buckets = TtlBuckets::restore(&mut reader, &self.exact_ttls)?;
 
         Ok(Segcache {
             hashtable,
             segments,
             ttl_buckets,
             time: Instant::now(),
+            metadata_path: self.metadata_path.clone(),
+            admission: self.admission_filter(),
+            mrc: self.mrc_estimator(),
+            access: AccessStats::default(),
+            free_reserve: self.free_reserve,
+            compaction: Compaction::new(self.compact_threshold),
+            large_values: self.large_values,
+            // restored chunks keep their ids, so new ones start elsewhere
+            large_id: rng().gen(),
+            touched: Touched::new(),
+            stale: Stale::new(self.stale_grace, self.lease_ttl),
+            namespaces: Namespaces::new(self.namespaces),
+            #[cfg(feature = "compression")]
+            compressor: self.compressor()?,
         })
     }
+
+    /// Consumes the builder and returns a fully-allocated [`ShardedSegcache`]
+    /// instance. Each shard receives an equal fraction of the heap, the
+    /// hashtable, the flash tier, and the admission window. If a datapool,
+    /// flash, or metadata path
+    /// is provided, each shard uses its own files with the shard index
+    /// appended to the path. The shards of each partition added with
+    /// [`Builder::partition`] follow those of the default partition.
+    ///
+    /// ```
+    /// use segcache::{Policy, Segcache};
+    ///
+    /// const MB: usize = 1024 * 1024;
+    ///
+    /// let cache = Segcache::builder()
+    ///     .heap_size(64 * MB)
+    ///     .segment_size(1 * MB as i32)
+    ///     .hash_power(16)
+    ///     .shards(4)
+    ///     .eviction(Policy::Random).build_sharded();
+    /// ```
+    pub fn build_sharded(mut self) -> Result<ShardedSegcache, std::io::Error> {
+        let mut partitions = vec![Partition {
+            name: DEFAULT_PARTITION.to_string(),
+            prefix: Box::new([]),
+            shards: 0..self.shards,
+        }];
+        let mut shards = Vec::with_capacity(self.shards);
+
+        for (name, prefix, builder) in std::mem::take(&mut self.partitions) {
+            if partitions
+                .iter()
+                .any(|p| p.name == name || *p.prefix == *prefix)
+            {
+                return Err(std::io::Error::new(
+                    std::io::ErrorKind::InvalidInput,
+                    format!("duplicate partition: {name}"),
+                ));
+            }
+            let start = self.shards + shards.len();
+            let (_, partition) = builder.build_sharded()?.into_shards();
+            partitions.push(Partition {
+                name,
+                prefix: prefix.into_boxed_slice(),
+                shards: start..(start + partition.len()),
+            });
+            shards.extend(partition);
+        }
+
+        let mut default = self.build_shards()?;
+        default.append(&mut shards);
+
+        Ok(ShardedSegcache::new(default, partitions))
+    }
+
+    /// Builds the shards of the default partition.
+    fn build_shards(self) -> Result<Vec<Segcache>, std::io::Error> {
+        let shard_bits = self.shards.trailing_zeros() as u8;
+        let hash_power = self.hash_power.saturating_sub(shard_bits).max(3);
+        let heap_size = self.segments_builder.heap_size / self.shards;
+        let flash_size = self.segments_builder.flash_size / self.shards;
+
+        let shard_path = |path: &Option<PathBuf>, id: usize| {
+            path.as_ref().map(|path| {
+                let mut path = path.clone().into_os_string();
+                path.push(format!(".{id}"));
+                PathBuf::from(path)
+            })
+        };
+
+        let mut shards = Vec::with_capacity(self.shards);
+        for id in 0..self.shards {
+            let builder = Builder {
+                hash_power,
+                max_hash_power: self.max_hash_power.saturating_sub(shard_bits),
+                overflow_factor: self.overflow_factor,
+                segments_builder: self
+                    .segments_builder
+                    .clone()
+                    .heap_size(heap_size)
+                    .datapool_path(shard_path(&self.segments_builder.datapool_path, id))
+                    .flash_path(shard_path(&self.segments_builder.flash_path, id))
+                    .flash_size(flash_size),
+                shards: 1,
+                partitions: Vec::new(),
+                metadata_path: shard_path(&self.metadata_path, id),
+                admission: self.admission.map(|window| window / self.shards),
+                admission_threshold: self.admission_threshold,
+                mrc: self.mrc.map(|keys| keys / self.shards),
+                free_reserve: self.free_reserve.div_ceil(self.shards),
+                compact_threshold: self.compact_threshold,
+                large_values: self.large_values,
+                stale_grace: self.stale_grace,
+                lease_ttl: self.lease_ttl,
+                namespaces: self.namespaces,
+                exact_ttls: self.exact_ttls.clone(),
+                huge_pages: self.huge_pages,
+                #[cfg(feature = "compression")]
+                compression: self.compression,
+                #[cfg(feature = "compression")]
+                compression_threshold: self.compression_threshold,
+                #[cfg(feature = "key-prefixes")]
+                key_prefixes: self.key_prefixes.clone(),
+            };
+
+            shards.push(builder.build()?);
+        }
+
+        Ok(shards)
+    }
 }
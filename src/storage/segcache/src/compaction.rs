@@ -0,0 +1,142 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Background compaction of segments which updates and deletes have left
+//! mostly empty.
+//!
+//! Segments are otherwise only compacted as a side effect of merge eviction,
+//! or of a removal which takes a segment below the compact ratio of the merge
+//! policy. Segments whose items were overwritten or deleted keep holding their
+//! memory until they expire or the cache is under eviction pressure. With a
+//! compaction threshold, each call to [`Segcache::maintain`] continues a sweep
+//! over the segment chains of the TTL buckets, merging adjacent segments which
+//! are each at most the threshold full into the first of them and returning
+//! the others to the free queue. A pass examines a bounded number of segments
+//! and merges at most once, which limits the work done between batches of
+//! requests. Compaction is disabled by default.
+
+use crate::*;
+use core::num::NonZeroU32;
+
+// the most segments examined by a single pass
+const COMPACT_SCAN_SEGMENTS: usize = 64;
+
+// the most merges done by a single pass
+const COMPACT_MERGES: usize = 1;
+
+/// The fragmentation threshold along with the position of the sweep.
+pub(crate) struct Compaction {
+    threshold: f64,
+    // the index of the ttl bucket which is being swept
+    bucket: usize,
+    // the segment of that bucket to continue from, or its head if none
+    next: Option<NonZeroU32>,
+}
+
+impl Compaction {
+    pub(crate) fn new(threshold: f64) -> Self {
+        Self {
+            threshold: threshold.clamp(0.0, 1.0),
+            bucket: 0,
+            next: None,
+        }
+    }
+}
+
+impl Segcache {
+    /// Continues the sweep for adjacent segments to compact, returning the
+    /// number of segments which were freed.
+    pub(crate) fn compact(&mut self) -> usize {
+        // the sweep waits for flushed segments to be reclaimed, see
+        // `Segments::remove_at`
+        if self.compaction.threshold <= 0.0 || self.segments.is_flushing() {
+            return 0;
+        }
+
+        let max_bytes = (self.compaction.threshold * self.segments.segment_size() as f64) as i32;
+        let buckets = self.ttl_buckets.buckets.len();
+        let free = self.segments.free();
+
+        let mut scanned = 0;
+        let mut merges = 0;
+        let mut swept = 0;
+        while scanned < COMPACT_SCAN_SEGMENTS && merges < COMPACT_MERGES && swept <= buckets {
+            let bucket = self.compaction.bucket;
+
+            // the sweep restarts from the head of the bucket if the segment it
+            // was to continue from has since been freed or reused elsewhere
+            let id = match self.compaction.next {
+                Some(id) if self.in_bucket(id, bucket) => Some(id),
+                _ => self.ttl_buckets.buckets[bucket].head(),
+            };
+            let Some(id) = id else {
+                self.next_bucket();
+                swept += 1;
+                continue;
+            };
+            scanned += 1;
+
+            let (sparse, next) = self.sparse(id, max_bytes);
+            let next_sparse = next.map(|next| self.sparse(next, max_bytes).0);
+
+            if sparse && next_sparse == Some(true) {
+                usdt!(compact_begin, id.get());
+                let _result = self.segments.merge_compact(id, &mut self.hashtable);
+                usdt!(compact_end, id.get(), _result.is_ok() as u8);
+                merges += 1;
+
+                // the ttl bucket must not point to any of the segments which
+                // were merged away, and the sweep goes on after the segments
+                // which could not be merged into this one
+                let segment = self.segments.get_mut(id).ok();
+                let ttl = segment.as_ref().map(|segment| segment.ttl());
+                self.compaction.next = segment.and_then(|segment| segment.next_seg());
+                if let Some(ttl) = ttl {
+                    self.ttl_buckets.get_mut_bucket(ttl).set_next_to_merge(None);
+                }
+            } else {
+                self.compaction.next = next;
+            }
+
+            if self.compaction.next.is_none() {
+                self.next_bucket();
+                swept += 1;
+            }
+        }
+
+        let freed = self.segments.free().saturating_sub(free);
+
+        #[cfg(feature = "metrics")]
+        SEGMENT_COMPACT_BACKGROUND.add(freed as _);
+
+        freed
+    }
+
+    /// Returns whether the segment can be merged and is at most `max_bytes`
+    /// full, along with the segment after it in its chain.
+    fn sparse(&mut self, id: NonZeroU32, max_bytes: i32) -> (bool, Option<NonZeroU32>) {
+        match self.segments.get_mut(id) {
+            Ok(segment) => (
+                segment.can_evict() && segment.live_bytes() <= max_bytes,
+                segment.next_seg(),
+            ),
+            Err(_) => (false, None),
+        }
+    }
+
+    /// Returns whether the segment is linked into the ttl bucket.
+    fn in_bucket(&mut self, id: NonZeroU32, bucket: usize) -> bool {
+        match self.segments.get_mut(id) {
+            Ok(segment) => {
+                segment.accessible() && self.ttl_buckets.get_bucket_index(segment.ttl()) == bucket
+            }
+            Err(_) => false,
+        }
+    }
+
+    fn next_bucket(&mut self) {
+        self.compaction.bucket = (self.compaction.bucket + 1) % self.ttl_buckets.buckets.len();
+        self.compaction.next = None;
+    }
+}
@@ -0,0 +1,106 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Optional compression of item values using zstd.
+//!
+//! Values are compressed as they are written into a segment, which keeps the
+//! segment layout unchanged: items remain addressable by their offset and are
+//! copied as-is by eviction and compaction. Only values which are at least the
+//! configured threshold and which shrink when compressed are stored in their
+//! compressed form, all others are stored as-is. Compressed values are marked
+//! in the item header and are decompressed when read.
+
+#[cfg(feature = "metrics")]
+use crate::metrics::*;
+
+use core::cell::RefCell;
+
+/// Values smaller than this are not worth compressing by default.
+pub const DEFAULT_COMPRESSION_THRESHOLD: usize = 512;
+
+thread_local! {
+    // reuse the decompression context, as allocating one is much more
+    // expensive than decompressing a typical value
+    static DECOMPRESSOR: RefCell<Option<zstd::bulk::Decompressor<'static>>> = const { RefCell::new(None) };
+}
+
+/// Compresses values for storage.
+pub(crate) struct Compressor {
+    compressor: zstd::bulk::Compressor<'static>,
+    threshold: usize,
+}
+
+impl Compressor {
+    /// Create a new compressor which compresses values of at least `threshold`
+    /// bytes at the provided zstd compression level.
+    pub fn new(level: i32, threshold: usize) -> Result<Self, std::io::Error> {
+        Ok(Self {
+            compressor: zstd::bulk::Compressor::new(level)?,
+            threshold,
+        })
+    }
+
+    /// Returns the compressed form of the value if it should be stored
+    /// compressed. Returns `None` if the value is below the threshold or does
+    /// not compress.
+    pub fn compress(&mut self, value: &[u8]) -> Option<Vec<u8>> {
+        if value.len() < self.threshold {
+            return None;
+        }
+
+        #[cfg(feature = "metrics")]
+        ITEM_COMPRESS_ATTEMPT.increment();
+
+        let compressed = self.compressor.compress(value).ok()?;
+        if compressed.len() >= value.len() {
+            return None;
+        }
+
+        #[cfg(feature = "metrics")]
+        {
+            ITEM_COMPRESS.increment();
+            ITEM_COMPRESS_BYTES_IN.add(value.len() as _);
+            ITEM_COMPRESS_BYTES_OUT.add(compressed.len() as _);
+        }
+
+        Some(compressed)
+    }
+}
+
+/// Decompresses a value which was compressed by a [`Compressor`].
+///
+/// # Panics
+///
+/// Panics if the data is not a valid zstd frame, which indicates that the
+/// segment data has become corrupted.
+pub(crate) fn decompress(data: &[u8]) -> Box<[u8]> {
+    #[cfg(feature = "metrics")]
+    let start = clocksource::precise::Instant::now();
+
+    let len = zstd::zstd_safe::get_frame_content_size(data)
+        .ok()
+        .flatten()
+        .expect("compressed value is corrupt") as usize;
+
+    let value = DECOMPRESSOR.with(|decompressor| {
+        let mut decompressor = decompressor.borrow_mut();
+        if decompressor.is_none() {
+            *decompressor =
+                Some(zstd::bulk::Decompressor::new().expect("failed to create zstd decompressor"));
+        }
+        decompressor
+            .as_mut()
+            .unwrap()
+            .decompress(data, len)
+            .expect("compressed value is corrupt")
+    });
+
+    #[cfg(feature = "metrics")]
+    {
+        ITEM_DECOMPRESS.increment();
+        let _ = ITEM_DECOMPRESS_LATENCY.increment(start.elapsed().as_nanos());
+    }
+
+    value.into_boxed_slice()
+}
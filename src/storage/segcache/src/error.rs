@@ -25,4 +25,10 @@ pub enum SegcacheError {
     DataCorrupted,
     #[error("item is not numeric")]
     NotNumeric,
+    #[error("item cannot be written in place")]
+    NotWritable,
+    #[error("item cannot be ingested")]
+    NotIngestible,
+    #[error("item expired before it was committed")]
+    Expired,
 }
@@ -0,0 +1,77 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The ghost set of S3-FIFO eviction, which remembers the keys of the items
+//! recently evicted from the small queue by the hash of the key.
+
+use std::collections::HashSet;
+
+// the fewest keys the ghost set is sized for
+const GHOST_MIN: usize = 1024;
+
+/// The hashes of the keys recently evicted from the small queue. They are
+/// held in two generations of half the capacity each, and the older is
+/// dropped once the newer is full, so that the set holds up to the capacity
+/// without tracking the age of each key.
+#[derive(Default)]
+pub(crate) struct Ghost {
+    capacity: usize,
+    current: HashSet<u64>,
+    previous: HashSet<u64>,
+}
+
+impl Ghost {
+    /// Sets the number of keys the ghost set holds, which is intended to be
+    /// the number of items in the main queue.
+    pub(crate) fn set_capacity(&mut self, capacity: usize) {
+        self.capacity = capacity.max(GHOST_MIN);
+    }
+
+    /// Remembers the hash of an evicted key.
+    pub(crate) fn insert(&mut self, hash: u64) {
+        if self.current.len() >= self.capacity / 2 {
+            std::mem::swap(&mut self.current, &mut self.previous);
+            self.current.clear();
+        }
+        self.current.insert(hash);
+    }
+
+    /// Forgets the hash of a key, returns true if it was a ghost.
+    pub(crate) fn remove(&mut self, hash: u64) -> bool {
+        self.current.remove(&hash) | self.previous.remove(&hash)
+    }
+
+    pub(crate) fn clear(&mut self) {
+        self.current.clear();
+        self.previous.clear();
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn generations() {
+        let mut ghost = Ghost::default();
+        ghost.set_capacity(0);
+
+        // keys are held until two generations have been filled after them
+        for hash in 0..GHOST_MIN as u64 {
+            ghost.insert(hash);
+        }
+        assert!(ghost.remove(0));
+        assert!(!ghost.remove(0));
+        assert!(ghost.remove(GHOST_MIN as u64 - 1));
+
+        for hash in GHOST_MIN as u64..2 * GHOST_MIN as u64 {
+            ghost.insert(hash);
+        }
+        assert!(!ghost.remove(1));
+        assert!(ghost.remove(2 * GHOST_MIN as u64 - 1));
+
+        ghost.clear();
+        assert!(!ghost.remove(2 * GHOST_MIN as u64 - 2));
+    }
+}
@@ -15,18 +15,26 @@ use crate::segments::*;
 use crate::Random;
 use crate::*;
 
+mod ghost;
 mod policy;
 
+pub(crate) use ghost::Ghost;
 pub use policy::Policy;
 
+// the most segments sampled by scoring eviction
+const SCORE_SAMPLES_MAX: usize = 64;
+
 /// The `Eviction` struct is used to rank and return segments for eviction. It
-/// implements eviction strategies corresponding to the `Policy`.
+/// implements eviction strategies corresponding to the `Policy`, and holds the
+/// optional flash tier which evicted items are moved into.
 pub struct Eviction {
     policy: Policy,
     last_update_time: Instant,
     ranked_segs: Box<[Option<NonZeroU32>]>,
     index: usize,
     rng: Box<Random>,
+    flash: Option<Flash>,
+    ghost: Ghost,
 }
 
 impl Eviction {
@@ -44,14 +52,49 @@ impl Eviction {
             ranked_segs,
             index: 0,
             rng: Box::new(rng()),
+            flash: None,
+            ghost: Ghost::default(),
         }
     }
 
+    /// Sets the flash tier which evicted items are moved into.
+    pub(crate) fn with_flash(mut self, flash: Option<Flash>) -> Self {
+        self.flash = flash;
+        self
+    }
+
+    /// Returns the flash tier, if there is one.
+    #[inline]
+    pub(crate) fn flash(&self) -> Option<&Flash> {
+        self.flash.as_ref()
+    }
+
+    /// Returns the flash tier mutably, if there is one.
+    #[inline]
+    pub(crate) fn flash_mut(&mut self) -> Option<&mut Flash> {
+        self.flash.as_mut()
+    }
+
+    /// Returns the ghost set of S3-FIFO eviction.
+    #[inline]
+    pub(crate) fn ghost_mut(&mut self) -> &mut Ghost {
+        &mut self.ghost
+    }
+
     #[inline]
     pub fn policy(&self) -> Policy {
         self.policy
     }
 
+    /// Changes the eviction policy. Segments are ranked again for the new
+    /// policy before the next eviction.
+    pub fn set_policy(&mut self, policy: Policy) {
+        self.policy = policy;
+        self.ranked_segs.fill(None);
+        self.index = 0;
+        self.ghost.clear();
+    }
+
     /// Returns the segment id of the least valuable segment
     pub fn least_valuable_seg(&mut self) -> Option<NonZeroU32> {
         let index = self.index;
@@ -72,7 +115,12 @@ impl Eviction {
     pub fn should_rerank(&mut self) -> bool {
         let now = Instant::now();
         match self.policy {
-            Policy::None | Policy::Random | Policy::RandomFifo | Policy::Merge { .. } => false,
+            Policy::None
+            | Policy::Random
+            | Policy::RandomFifo
+            | Policy::Score { .. }
+            | Policy::S3Fifo
+            | Policy::Merge { .. } => false,
             Policy::Fifo | Policy::Cte | Policy::Util => {
                 if self.ranked_segs[0].is_none()
                     || (now - self.last_update_time).as_secs() > 1
@@ -90,7 +138,12 @@ impl Eviction {
     pub fn rerank(&mut self, headers: &[SegmentHeader]) {
         let mut ids: Vec<NonZeroU32> = headers.iter().map(|h| h.id()).collect();
         match self.policy {
-            Policy::None | Policy::Random | Policy::RandomFifo | Policy::Merge { .. } => {
+            Policy::None
+            | Policy::Random
+            | Policy::RandomFifo
+            | Policy::Score { .. }
+            | Policy::S3Fifo
+            | Policy::Merge { .. } => {
                 return;
             }
             Policy::Fifo { .. } => {
@@ -124,6 +177,79 @@ impl Eviction {
         self.index = 0;
     }
 
+    /// Returns the segment with the lowest score among those sampled at
+    /// random for scoring eviction, or `None` if none of the sampled segments
+    /// can be evicted.
+    pub(crate) fn score_seg(&mut self, headers: &[SegmentHeader]) -> Option<NonZeroU32> {
+        let (samples, hits, age, ttl) = match self.policy {
+            Policy::Score {
+                samples,
+                hits,
+                age,
+                ttl,
+            } => (samples.clamp(1, SCORE_SAMPLES_MAX), hits, age, ttl),
+            _ => return None,
+        };
+
+        let now = Instant::now();
+
+        // the live bytes, hit rate, age and time to expiry of each candidate
+        let mut candidates = [(0, 0.0, 0.0, 0.0, 0.0); SCORE_SAMPLES_MAX];
+        let mut n = 0;
+        for _ in 0..samples {
+            let header = &headers[self.random() as usize % headers.len()];
+            if !header.can_evict() {
+                continue;
+            }
+            let since = max(
+                (now - max(header.create_at(), header.merge_at())).as_secs(),
+                1,
+            ) as f64;
+            let expire_at = header.create_at() + header.ttl();
+            let expiry = if expire_at > now {
+                (expire_at - now).as_secs() as f64
+            } else {
+                0.0
+            };
+            candidates[n] = (
+                header.id().get(),
+                header.live_bytes().max(0) as f64,
+                header.hits() as f64 / since,
+                since,
+                expiry,
+            );
+            n += 1;
+        }
+        let candidates = &candidates[..n];
+
+        let mut highest = (0.0_f64, 0.0_f64, 0.0_f64, 0.0_f64);
+        for (_, live, rate, since, expiry) in candidates {
+            highest.0 = highest.0.max(*live);
+            highest.1 = highest.1.max(*rate);
+            highest.2 = highest.2.max(*since);
+            highest.3 = highest.3.max(*expiry);
+        }
+        let relative = |value: f64, highest: f64| {
+            if highest > 0.0 {
+                value / highest
+            } else {
+                0.0
+            }
+        };
+
+        candidates
+            .iter()
+            .map(|(id, live, rate, since, expiry)| {
+                let score = relative(*live, highest.0)
+                    + relative(*rate, highest.1) * hits as f64 / 100.0
+                    - relative(*since, highest.2) * age as f64 / 100.0
+                    + relative(*expiry, highest.3) * ttl as f64 / 100.0;
+                (*id, score)
+            })
+            .min_by(|a, b| a.1.total_cmp(&b.1))
+            .and_then(|(id, _)| NonZeroU32::new(id))
+    }
+
     fn compare_fifo(lhs: &SegmentHeader, rhs: &SegmentHeader) -> Ordering {
         if !lhs.can_evict() {
             Ordering::Greater
@@ -31,6 +31,38 @@ pub enum Policy {
     /// of live bytes. This strategy should cause the smallest impact to the
     /// number of live bytes held in the cache.
     Util,
+    /// Sampled scoring eviction. Scores a few random segments and evicts the
+    /// one with the lowest score, which keeps the cost of each eviction
+    /// bounded by the number of samples rather than the number of segments.
+    /// A segment scores its live bytes, plus its hits per second since it was
+    /// created or last merged into and its time to expiry, each weighted by
+    /// the provided percentage, less its age since then, also weighted. Each
+    /// term is relative to the highest among the samples, so a weight of 100
+    /// makes a term count as much as the live bytes.
+    Score {
+        /// The number of segments sampled for each eviction, at most 64.
+        samples: usize,
+        /// The weight of the hit rate, in percent of that of the live bytes.
+        hits: u32,
+        /// The weight of the age, in percent of that of the live bytes.
+        age: u32,
+        /// The weight of the time to expiry, in percent of that of the live
+        /// bytes.
+        ttl: u32,
+    },
+    /// S3-FIFO eviction, expressed in terms of segments. Segments which have
+    /// not yet been through an eviction pass are probationary and form the
+    /// small queue, while the rest form the main queue. While the small queue
+    /// holds at least a tenth of the segments in use, its oldest segments are
+    /// merged into the first of them, which keeps only the items read since
+    /// they were written and then joins the main queue. The keys of the other
+    /// items are remembered in a ghost set, and an item whose key is a ghost
+    /// is kept on its first pass as it was recently evicted and then written
+    /// again. Otherwise, the oldest segment of the main queue is evicted with
+    /// a frequency based merge, or is evicted whole if it can't be merged.
+    /// This quickly evicts items which are written once and never read,
+    /// without moving items on reads.
+    S3Fifo,
     /// Merge eviction is a unique feature in segcache. It tries to retain items
     /// which have the biggest positive effect on hitrate.
     /// At its core, the idea is to take sequential segments in a chain,
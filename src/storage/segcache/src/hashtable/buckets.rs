@@ -0,0 +1,88 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! The allocation which holds the buckets of a table. Buckets are allocated
+//! on the heap unless huge pages are requested, in which case they are held
+//! in an anonymous mapping so that a random lookup in a large table does not
+//! take a TLB miss for each 4KB page it touches.
+
+use super::{HashBucket, N_BUCKET_SLOT};
+use core::ops::{Deref, DerefMut};
+use datatier::{Datapool, HugePages, Memory};
+
+pub(super) enum Buckets {
+    Heap(Box<[HashBucket]>),
+    Mapped(Memory, usize),
+}
+
+impl Buckets {
+    /// Allocates the provided number of empty buckets. Buckets are allocated
+    /// on the heap if the mapping for huge pages cannot be created.
+    pub(super) fn new(len: usize, huge_pages: HugePages) -> Self {
+        if huge_pages != HugePages::Disabled {
+            let size = len * core::mem::size_of::<HashBucket>();
+            if let Ok(memory) = Memory::create_with(size, huge_pages, None) {
+                return Self::Mapped(memory, len);
+            }
+        }
+
+        let mut data = Vec::with_capacity(0);
+        data.reserve_exact(len);
+        data.resize(len, HashBucket::new());
+        Self::Heap(data.into_boxed_slice())
+    }
+}
+
+impl Deref for Buckets {
+    type Target = [HashBucket];
+
+    fn deref(&self) -> &[HashBucket] {
+        match self {
+            Self::Heap(data) => data,
+            // safety: the mapping is page aligned, large enough to hold the
+            // buckets, and zeroed by the kernel, which is an empty bucket
+            Self::Mapped(memory, len) => unsafe {
+                core::slice::from_raw_parts(memory.as_slice().as_ptr() as *const HashBucket, *len)
+            },
+        }
+    }
+}
+
+impl DerefMut for Buckets {
+    fn deref_mut(&mut self) -> &mut [HashBucket] {
+        match self {
+            Self::Heap(data) => data,
+            // safety: see above
+            Self::Mapped(memory, len) => unsafe {
+                core::slice::from_raw_parts_mut(
+                    memory.as_mut_slice().as_mut_ptr() as *mut HashBucket,
+                    *len,
+                )
+            },
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn mapped() {
+        // hosts without huge pages fall back to regular pages or the heap
+        for huge_pages in [
+            HugePages::Disabled,
+            HugePages::Transparent,
+            HugePages::Huge2M,
+        ] {
+            let mut buckets = Buckets::new(1000, huge_pages);
+            assert_eq!(buckets.len(), 1000);
+            assert!(buckets
+                .iter()
+                .all(|bucket| bucket.data == [0; N_BUCKET_SLOT]));
+            buckets[999].data[N_BUCKET_SLOT - 1] = 1;
+            assert_eq!(buckets[999].data[N_BUCKET_SLOT - 1], 1);
+        }
+    }
+}
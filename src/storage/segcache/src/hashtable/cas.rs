@@ -0,0 +1,104 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! CAS values for each item slot, held beside the buckets.
+//!
+//! The CAS value of a chain is held in its bucket info and is changed by
+//! every write to any of its items, so a write to one key fails a `cas` for
+//! each of the other keys in the chain with `Exists`, though none of them
+//! changed. With the `item-cas` feature, each item slot is paired with the CAS
+//! value of its item, which only its own writes change. The CAS value of the
+//! chain is still changed by every write, and the item which was written is
+//! given the new value, so no two writes in a chain give the same value and a
+//! key which is removed and stored again does not get back the value it had.
+//! The array adds half to the size of the hashtable. Without the feature, the
+//! CAS value of an item is that of its chain as before and the array takes no
+//! memory.
+//!
+//! A CAS value is written whenever an item info is written to a slot, and
+//! moves with the item info when the hashtable grows.
+
+#[cfg(feature = "item-cas")]
+use super::N_BUCKET_SLOT;
+
+#[cfg(feature = "item-cas")]
+pub(super) struct CasValues {
+    data: Box<[u32]>,
+}
+
+#[cfg(not(feature = "item-cas"))]
+pub(super) struct CasValues;
+
+#[cfg(feature = "item-cas")]
+impl CasValues {
+    /// Allocates the CAS values for the provided number of buckets.
+    pub(super) fn new(buckets: usize) -> Self {
+        Self {
+            data: vec![0; buckets * N_BUCKET_SLOT].into_boxed_slice(),
+        }
+    }
+
+    /// Returns the CAS value of the item in the slot, whose index counts the
+    /// slots of all preceding buckets, within a chain which has the CAS value
+    /// provided.
+    #[inline]
+    pub(super) fn get(&self, slot: usize, _chain: u32) -> u32 {
+        self.data[slot]
+    }
+
+    /// Sets the CAS value of the item in the slot.
+    #[inline]
+    pub(super) fn set(&mut self, slot: usize, cas: u32) {
+        self.data[slot] = cas;
+    }
+
+    /// Returns the CAS values of all slots, to be saved with the buckets.
+    pub(super) fn as_slice(&self) -> &[u32] {
+        &self.data
+    }
+
+    /// A mutable variant of `as_slice()`, to restore the saved CAS values.
+    pub(super) fn as_mut_slice(&mut self) -> &mut [u32] {
+        &mut self.data
+    }
+}
+
+#[cfg(not(feature = "item-cas"))]
+impl CasValues {
+    pub(super) fn new(_buckets: usize) -> Self {
+        Self
+    }
+
+    #[inline]
+    pub(super) fn get(&self, _slot: usize, chain: u32) -> u32 {
+        chain
+    }
+
+    #[inline]
+    pub(super) fn set(&mut self, _slot: usize, _cas: u32) {}
+
+    pub(super) fn as_slice(&self) -> &[u32] {
+        &[]
+    }
+
+    pub(super) fn as_mut_slice(&mut self) -> &mut [u32] {
+        &mut []
+    }
+}
+
+#[cfg(all(test, feature = "item-cas"))]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn cas_values() {
+        let mut cas = CasValues::new(2);
+
+        // each slot holds its own value, whatever the value of its chain
+        cas.set(N_BUCKET_SLOT + 1, 7);
+        assert_eq!(cas.get(N_BUCKET_SLOT + 1, 3), 7);
+        assert_eq!(cas.get(1, 3), 0);
+        assert_eq!(cas.as_slice().len(), 2 * N_BUCKET_SLOT);
+    }
+}
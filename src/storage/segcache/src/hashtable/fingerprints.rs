@@ -0,0 +1,130 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! More bits of the hash for each item slot, held beside the buckets.
+//!
+//! With a 12 bit tag, about one in every 4096 tag comparisons matches an item
+//! with a different key, which is only found to be a different key once the
+//! item is read from its segment. That is a random read of memory which has
+//! usually left the cache, and for a lookup which misses it is the only read
+//! of a segment. With the `fingerprints` feature, each item slot is paired
+//! with another 16 bits of the hash of its key, and a slot whose tag matches
+//! but whose fingerprint does not is skipped without reading its item. The
+//! fingerprints of a bucket are held together, so the fingerprints of four
+//! buckets share a cacheline, and the array adds a quarter to the size of the
+//! hashtable. Without the feature, every tag match is read from its segment
+//! as before and the array takes no memory.
+//!
+//! A fingerprint is written whenever an item info is written to an empty slot
+//! or replaces the item info for the same key. Removing an item clears its
+//! item info, and the stale fingerprint is never compared, as the cleared
+//! item info matches no tag.
+
+use super::HashBucket;
+#[cfg(feature = "fingerprints")]
+use super::N_BUCKET_SLOT;
+
+/// The bits of the hash held in the fingerprint. These are below the tag, and
+/// are above the bits which select the bucket for tables of up to 2^39 slots.
+#[cfg(feature = "fingerprints")]
+const FINGERPRINT_SHIFT: u64 = 36;
+
+/// Calculate a fingerprint from the hash value
+#[cfg(feature = "fingerprints")]
+#[inline]
+const fn fingerprint_from_hash(hash: u64) -> u16 {
+    (hash >> FINGERPRINT_SHIFT) as u16
+}
+
+#[cfg(feature = "fingerprints")]
+pub(super) struct Fingerprints {
+    data: Box<[u16]>,
+}
+
+#[cfg(not(feature = "fingerprints"))]
+pub(super) struct Fingerprints;
+
+#[cfg(feature = "fingerprints")]
+impl Fingerprints {
+    /// Allocates the fingerprints for the provided number of buckets.
+    pub(super) fn new(buckets: usize) -> Self {
+        Self {
+            data: vec![0; buckets * N_BUCKET_SLOT].into_boxed_slice(),
+        }
+    }
+
+    /// Returns false if the key whose hash is provided is certainly not the
+    /// key of the item in the slot, whose index counts the slots of all
+    /// preceding buckets.
+    #[inline]
+    pub(super) fn matches(&self, slot: usize, hash: u64) -> bool {
+        self.data[slot] == fingerprint_from_hash(hash)
+    }
+
+    /// Sets the fingerprint for the slot to that of the hash.
+    #[inline]
+    pub(super) fn set(&mut self, slot: usize, hash: u64) {
+        self.data[slot] = fingerprint_from_hash(hash);
+    }
+
+    /// Returns the fingerprints of all slots, to be saved with the buckets.
+    pub(super) fn as_slice(&self) -> &[u16] {
+        &self.data
+    }
+
+    /// A mutable variant of `as_slice()`, to restore the saved fingerprints.
+    pub(super) fn as_mut_slice(&mut self) -> &mut [u16] {
+        &mut self.data
+    }
+}
+
+#[cfg(not(feature = "fingerprints"))]
+impl Fingerprints {
+    pub(super) fn new(_buckets: usize) -> Self {
+        Self
+    }
+
+    #[inline]
+    pub(super) fn matches(&self, _slot: usize, _hash: u64) -> bool {
+        true
+    }
+
+    #[inline]
+    pub(super) fn set(&mut self, _slot: usize, _hash: u64) {}
+
+    pub(super) fn as_slice(&self) -> &[u16] {
+        &[]
+    }
+
+    pub(super) fn as_mut_slice(&mut self) -> &mut [u16] {
+        &mut []
+    }
+}
+
+/// Returns the index of the slot which holds the item info, counting the
+/// slots of all preceding buckets of the table which starts at `base`.
+#[inline]
+pub(super) fn slot_index(base: *const HashBucket, item_info: &u64) -> usize {
+    (item_info as *const u64 as usize - base as usize) / core::mem::size_of::<u64>()
+}
+
+#[cfg(all(test, feature = "fingerprints"))]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn fingerprints() {
+        let mut fingerprints = Fingerprints::new(2);
+        let hash = 0x0123_4567_89AB_CDEF;
+
+        fingerprints.set(N_BUCKET_SLOT + 1, hash);
+        assert!(fingerprints.matches(N_BUCKET_SLOT + 1, hash));
+
+        // hashes which differ only in the bits of the tag or the bucket share
+        // a fingerprint, those which differ in the fingerprint bits do not
+        assert!(fingerprints.matches(N_BUCKET_SLOT + 1, hash ^ (1 << 63) ^ 1));
+        assert!(!fingerprints.matches(N_BUCKET_SLOT + 1, hash ^ (1 << FINGERPRINT_SHIFT)));
+        assert!(!fingerprints.matches(1, hash));
+    }
+}
@@ -8,7 +8,7 @@
 //! Bucket Info:
 //! ```text
 //! ┌──────────────────────────────┬──────┬──────┬──────────────┐
-//! │             CAS              │ ---- │CHAIN │  TIMESTAMP   │
+//! │             CAS              │FLAGS │CHAIN │  TIMESTAMP   │
 //! │                              │      │ LEN  │              │
 //! │            32 bit            │8 bit │8 bit │    16 bit    │
 //! │                              │      │ LEN  │              │
@@ -26,6 +26,9 @@
 //! │0       11│12  19│20                  43│44              63│
 //! └──────────┴──────┴──────────────────────┴──────────────────┘
 //! ```
+//!
+//! The split between the segment id and the offset is chosen at compile time,
+//! see [`OFFSET_BITS`]. The tag and frequency keep their width.
 
 use super::*;
 
@@ -35,6 +38,9 @@ pub(crate) const BUCKET_CHAIN_LEN_MASK: u64 = 0x0000_0000_00FF_0000;
 pub(crate) const TS_MASK: u64 = 0x0000_0000_0000_FFFF;
 /// A mask to get the bits containing the CAS value from the bucket info
 pub(crate) const CAS_MASK: u64 = 0xFFFF_FFFF_0000_0000;
+/// A flag in the bucket info which marks a bucket of the previous table as
+/// migrated while the hashtable is growing
+pub(crate) const BUCKET_MIGRATED: u64 = 0x0000_0000_0100_0000;
 
 /// Number of bits to shift the bucket info masked with the chain length mask
 /// to get the actual chain length
@@ -45,34 +51,62 @@ pub(crate) const CAS_BIT_SHIFT: u64 = 32;
 
 // item info
 
+/// Number of bits of the item info which hold the tag
+const TAG_BITS: u64 = 12;
+/// Number of bits of the item info which hold the frequency
+const FREQ_BITS: u64 = 8;
+
+/// Number of bits of the item info which hold the offset within the segment.
+/// Each additional bit doubles the largest segment, and halves the number of
+/// segments which can be addressed.
+#[cfg(not(feature = "large-segments"))]
+pub(crate) const OFFSET_BITS: u64 = 20;
+#[cfg(feature = "large-segments")]
+pub(crate) const OFFSET_BITS: u64 = 24;
+
+/// Number of bits of the item info which hold the segment id
+const SEG_ID_BITS: u64 = 64 - TAG_BITS - FREQ_BITS - OFFSET_BITS;
+
 /// A mask to get the bits containing the item tag from the item info
-pub(crate) const TAG_MASK: u64 = 0xFFF0_0000_0000_0000;
+pub(crate) const TAG_MASK: u64 = !0 << (64 - TAG_BITS);
 /// A mask to get the bits containing the item frequency from the item info
-pub(crate) const FREQ_MASK: u64 = 0x000F_F000_0000_0000;
+pub(crate) const FREQ_MASK: u64 = ((1 << FREQ_BITS) - 1) << FREQ_BIT_SHIFT;
 /// A mask to get the bits containing the containing segment id from the item
 /// info
-pub(crate) const SEG_ID_MASK: u64 = 0x0000_0FFF_FFF0_0000;
+pub(crate) const SEG_ID_MASK: u64 = ((1 << SEG_ID_BITS) - 1) << SEG_ID_BIT_SHIFT;
 /// A mask to get the bits containing the offset within the containing segment
 /// from the item info
-pub(crate) const OFFSET_MASK: u64 = 0x0000_0000_000F_FFFF;
+pub(crate) const OFFSET_MASK: u64 = (1 << OFFSET_BITS) - 1;
 
 /// Number of bits to shift the item info masked with the frequency mask to get
 /// the actual item frequency
-pub(crate) const FREQ_BIT_SHIFT: u64 = 44;
+pub(crate) const FREQ_BIT_SHIFT: u64 = SEG_ID_BIT_SHIFT + SEG_ID_BITS;
 /// Number of bits to shift the item info masked with the segment id mask to get
 /// the actual segment id
-pub(crate) const SEG_ID_BIT_SHIFT: u64 = 20;
+pub(crate) const SEG_ID_BIT_SHIFT: u64 = OFFSET_BITS;
 /// Offset alignment in bits, this value results in 8byte alignment within the
 /// segment
 pub(crate) const OFFSET_UNIT_IN_BIT: u64 = 3;
 
+/// The number of segments which can be addressed by the item info, including
+/// the id zero, which is not used
+pub(crate) const MAX_SEGMENTS: usize = 1 << SEG_ID_BITS;
+/// The largest segment whose items can all be addressed by the item info
+pub(crate) const MAX_SEGMENT_SIZE: usize = 1 << (OFFSET_BITS + OFFSET_UNIT_IN_BIT);
+
 /// Mask to get the item info without the frequency smoothing bit set
-pub(crate) const CLEAR_FREQ_SMOOTH_MASK: u64 = 0xFFF7_FFFF_FFFF_FFFF;
+pub(crate) const CLEAR_FREQ_SMOOTH_MASK: u64 = !(0x80 << FREQ_BIT_SHIFT);
 
 /// Mask to get the lower 16 bits from a timestamp
 pub(crate) const PROC_TS_MASK: u32 = 0x0000_FFFF;
 
+// NOTE: buckets are aligned to their size so that each probe touches as few
+// cachelines as possible and the vectorized tag comparison operates on aligned
+// data. A wide bucket fills the pair of cachelines which is fetched together
+// by the adjacent line prefetcher.
 #[derive(Copy, Clone)]
+#[cfg_attr(not(feature = "wide-buckets"), repr(C, align(64)))]
+#[cfg_attr(feature = "wide-buckets", repr(C, align(128)))]
 pub(crate) struct HashBucket {
     pub(super) data: [u64; N_BUCKET_SLOT],
 }
@@ -83,6 +117,108 @@ impl HashBucket {
             data: [0; N_BUCKET_SLOT],
         }
     }
+
+    /// Compares the tag against every slot in the bucket and returns a bitmask
+    /// with bit `n` set if the tag of slot `n` matches. The caller is
+    /// responsible for ignoring slots which do not contain item info, such as
+    /// the bucket info or a pointer to the next bucket in the chain.
+    #[inline]
+    pub fn tag_matches(&self, tag: u64) -> u32 {
+        #[cfg(all(target_arch = "x86_64", target_feature = "avx2"))]
+        {
+            // SAFETY: the avx2 target feature is enabled for this build
+            unsafe { self.tag_matches_avx2(tag) }
+        }
+
+        #[cfg(all(target_arch = "x86_64", not(target_feature = "avx2")))]
+        {
+            // SAFETY: sse2 is always available on x86_64
+            unsafe { self.tag_matches_sse2(tag) }
+        }
+
+        #[cfg(target_arch = "aarch64")]
+        {
+            // SAFETY: neon is always available on aarch64
+            unsafe { self.tag_matches_neon(tag) }
+        }
+
+        #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+        {
+            self.tag_matches_scalar(tag)
+        }
+    }
+
+    #[allow(dead_code)]
+    #[inline]
+    fn tag_matches_scalar(&self, tag: u64) -> u32 {
+        let mut matches = 0;
+        for (slot, item_info) in self.data.iter().enumerate() {
+            if get_tag(*item_info) == tag {
+                matches |= 1 << slot;
+            }
+        }
+        matches
+    }
+
+    #[cfg(all(target_arch = "x86_64", target_feature = "avx2"))]
+    #[inline]
+    unsafe fn tag_matches_avx2(&self, tag: u64) -> u32 {
+        use core::arch::x86_64::*;
+
+        let ptr = self.data.as_ptr() as *const __m256i;
+        let mask = _mm256_set1_epi64x(TAG_MASK as i64);
+        let tag = _mm256_set1_epi64x(tag as i64);
+
+        let mut matches = 0;
+        for quad in 0..(N_BUCKET_SLOT / 4) {
+            let slots = _mm256_and_si256(_mm256_load_si256(ptr.add(quad)), mask);
+            let eq = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(slots, tag))) as u32;
+            matches |= eq << (quad * 4);
+        }
+        matches
+    }
+
+    #[cfg(all(target_arch = "x86_64", not(target_feature = "avx2")))]
+    #[inline]
+    unsafe fn tag_matches_sse2(&self, tag: u64) -> u32 {
+        use core::arch::x86_64::*;
+
+        // sse2 lacks a 64bit compare, but the tag lives entirely within the
+        // upper 32 bits of each slot. We compare 32bit lanes and only consider
+        // the result for the upper half of each slot.
+        let ptr = self.data.as_ptr() as *const __m128i;
+        let mask = _mm_set1_epi64x(TAG_MASK as i64);
+        let tag = _mm_set1_epi64x(tag as i64);
+
+        let mut matches = 0;
+        for pair in 0..(N_BUCKET_SLOT / 2) {
+            let slots = _mm_and_si128(_mm_load_si128(ptr.add(pair)), mask);
+            let eq = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(slots, tag))) as u32;
+            // bit 1 and bit 3 correspond to the upper halves of the two slots
+            matches |= (((eq >> 1) & 1) | ((eq >> 2) & 2)) << (pair * 2);
+        }
+        matches
+    }
+
+    #[cfg(target_arch = "aarch64")]
+    #[inline]
+    unsafe fn tag_matches_neon(&self, tag: u64) -> u32 {
+        use core::arch::aarch64::*;
+
+        let ptr = self.data.as_ptr();
+        let mask = vdupq_n_u64(TAG_MASK);
+        let tag = vdupq_n_u64(tag);
+
+        let mut matches = 0;
+        for pair in 0..(N_BUCKET_SLOT / 2) {
+            let slots = vandq_u64(vld1q_u64(ptr.add(pair * 2)), mask);
+            let eq = vceqq_u64(slots, tag);
+            let lo = (vgetq_lane_u64(eq, 0) & 1) as u32;
+            let hi = (vgetq_lane_u64(eq, 1) & 1) as u32;
+            matches |= (lo | (hi << 1)) << (pair * 2);
+        }
+        matches
+    }
 }
 
 /// Calculate a item's tag from the hash value
@@ -144,3 +280,44 @@ pub const fn chain_len(bucket_info: u64) -> u64 {
 pub const fn build_item_info(tag: u64, seg_id: NonZeroU32, offset: u64) -> u64 {
     tag | ((seg_id.get() as u64) << SEG_ID_BIT_SHIFT) | (offset >> OFFSET_UNIT_IN_BIT)
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn tag_matches() {
+        let mut rng = thread_rng();
+
+        for _ in 0..1000 {
+            let mut bucket = HashBucket::new();
+            let tag = tag_from_hash(rng.gen::<u64>());
+            for slot in 0..N_BUCKET_SLOT {
+                // mix slots with the same tag, a different tag, and empty slots
+                bucket.data[slot] = match rng.gen::<u64>() % 3 {
+                    0 => tag | (rng.gen::<u64>() & !TAG_MASK),
+                    1 => rng.gen::<u64>(),
+                    _ => 0,
+                };
+            }
+            assert_eq!(bucket.tag_matches(tag), bucket.tag_matches_scalar(tag));
+        }
+    }
+
+    #[test]
+    fn item_info() {
+        // the fields fill the item info without overlapping
+        assert_eq!(TAG_MASK ^ FREQ_MASK ^ SEG_ID_MASK ^ OFFSET_MASK, !0);
+        assert_eq!(TAG_MASK | FREQ_MASK | SEG_ID_MASK | OFFSET_MASK, !0);
+
+        let tag = tag_from_hash(!0);
+        let seg_id = NonZeroU32::new((MAX_SEGMENTS - 1) as u32).unwrap();
+        let offset = (MAX_SEGMENT_SIZE - 8) as u64;
+
+        let item_info = build_item_info(tag, seg_id, offset);
+        assert_eq!(get_tag(item_info), tag);
+        assert_eq!(get_seg_id(item_info), Some(seg_id));
+        assert_eq!(get_offset(item_info), offset);
+        assert_eq!(get_freq(item_info), 0);
+    }
+}
@@ -0,0 +1,247 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Copies of small items held beside the buckets.
+//!
+//! A lookup which finds its item reads the item from its segment to compare
+//! the key, and for an item with a value of a few bytes, such as a counter or
+//! a flag, that read of memory which has usually left the cache is most of
+//! the cost of the lookup. With the `inline-values` feature, each item slot is
+//! paired with room for a copy of an item whose key, value and optional data
+//! fit in 16 bytes, and a lookup which finds a copy of the item which the slot
+//! holds takes the key, value and optional data from the copy without reading
+//! the segment. Each copy takes half a cacheline, so the copies take four
+//! times the memory of the buckets. Without the feature, every item is read
+//! from its segment as before and the copies take no memory.
+//!
+//! Copies are made as items are read from their segments, and a copy is only
+//! used while the slot holds the item info it was made from and the CAS value
+//! of the item is the one it was made with. Every write of an item, whether
+//! by storing a new item or by writing to one in place, changes its CAS value,
+//! which is that of its chain unless items have their own, so a copy is never
+//! used once the item has changed. Copies are
+//! neither made nor used while the hashtable grows, as an item may be found
+//! in either table, and they are not saved with the hashtable.
+
+use super::*;
+
+#[cfg(feature = "inline-values")]
+const INLINE_BYTES: usize = 16;
+
+// set in the flags of a copy of a numeric value
+#[cfg(feature = "inline-values")]
+const INLINE_NUMERIC: u8 = 1;
+
+/// A copy of a small item.
+#[cfg(feature = "inline-values")]
+#[derive(Copy, Clone, Default)]
+#[repr(C, align(32))]
+pub(crate) struct Inline {
+    // the item info of the slot, without the frequency, and the CAS value of
+    // the item when the copy was made. An item info of zero is never valid,
+    // so an empty copy is never used
+    item_info: u64,
+    cas: u32,
+    klen: u8,
+    vlen: u8,
+    olen: u8,
+    flags: u8,
+    // the key, followed by the value and then the optional data
+    bytes: [u8; INLINE_BYTES],
+}
+
+/// Without the feature, no copy is ever made.
+#[cfg(not(feature = "inline-values"))]
+#[derive(Copy, Clone)]
+pub(crate) struct Inline;
+
+#[cfg(feature = "inline-values")]
+impl Inline {
+    /// Returns a copy of the item which the item info refers to, unless it
+    /// does not fit or is stored in a form which is read with the help of
+    /// other items, such as a large or compressed value.
+    fn copy(item_info: u64, cas: u32, item: &RawItem) -> Option<Self> {
+        if item.is_large() || item.is_chunk() || item.is_compressed() {
+            return None;
+        }
+
+        let key = item.key();
+        let optional = item.optional().unwrap_or(&[]);
+        let numeric;
+        let (value, flags) = match item.value() {
+            Value::Bytes(value) => (value, 0),
+            Value::U64(value) => {
+                numeric = value.to_ne_bytes();
+                (&numeric[..], INLINE_NUMERIC)
+            }
+        };
+        if key.len() + value.len() + optional.len() > INLINE_BYTES {
+            return None;
+        }
+
+        let mut inline = Self {
+            item_info: clear_freq(item_info),
+            cas,
+            klen: key.len() as u8,
+            vlen: value.len() as u8,
+            olen: optional.len() as u8,
+            flags,
+            bytes: [0; INLINE_BYTES],
+        };
+        let (k, rest) = inline.bytes.split_at_mut(key.len());
+        let (v, o) = rest.split_at_mut(value.len());
+        k.copy_from_slice(&key);
+        v.copy_from_slice(value);
+        o[..optional.len()].copy_from_slice(optional);
+
+        Some(inline)
+    }
+
+    /// Borrow the key of the copy
+    pub(crate) fn key(&self) -> &[u8] {
+        &self.bytes[..self.klen as usize]
+    }
+
+    /// Borrow the value of the copy
+    pub(crate) fn value(&self) -> Value {
+        let start = self.klen as usize;
+        let value = &self.bytes[start..(start + self.vlen as usize)];
+        if self.flags & INLINE_NUMERIC != 0 {
+            let mut bytes = [0; 8];
+            bytes.copy_from_slice(value);
+            Value::U64(u64::from_ne_bytes(bytes))
+        } else {
+            Value::Bytes(value)
+        }
+    }
+
+    /// Borrow the optional data of the copy
+    pub(crate) fn optional(&self) -> Option<&[u8]> {
+        if self.olen == 0 {
+            return None;
+        }
+        let start = self.klen as usize + self.vlen as usize;
+        Some(&self.bytes[start..(start + self.olen as usize)])
+    }
+}
+
+#[cfg(not(feature = "inline-values"))]
+impl Inline {
+    pub(crate) fn key(&self) -> &[u8] {
+        &[]
+    }
+
+    pub(crate) fn value(&self) -> Value {
+        Value::Bytes(&[])
+    }
+
+    pub(crate) fn optional(&self) -> Option<&[u8]> {
+        None
+    }
+}
+
+/// The copies of the items, one for each slot of the table.
+#[cfg(feature = "inline-values")]
+pub(super) struct Inlines {
+    data: Box<[Inline]>,
+}
+
+#[cfg(not(feature = "inline-values"))]
+pub(super) struct Inlines;
+
+#[cfg(feature = "inline-values")]
+impl Inlines {
+    /// Allocates empty copies for the provided number of buckets.
+    pub(super) fn new(buckets: usize) -> Self {
+        Self {
+            data: vec![Inline::default(); buckets * N_BUCKET_SLOT].into_boxed_slice(),
+        }
+    }
+
+    /// Returns the copy held for the slot, whose index counts the slots of
+    /// all preceding buckets, if it is a copy of the item with the key which
+    /// the item info refers to, made while the item had the CAS value.
+    #[inline]
+    pub(super) fn get(&self, slot: usize, item_info: u64, cas: u32, key: &[u8]) -> Option<Inline> {
+        let inline = &self.data[slot];
+        (inline.item_info == clear_freq(item_info) && inline.cas == cas && inline.key() == key)
+            .then_some(*inline)
+    }
+
+    /// Replaces the copy held for the slot with a copy of the item, if it
+    /// fits.
+    #[inline]
+    pub(super) fn fill(&mut self, slot: usize, item_info: u64, cas: u32, item: &RawItem) {
+        if let Some(inline) = Inline::copy(item_info, cas, item) {
+            self.data[slot] = inline;
+        }
+    }
+
+    /// Returns the number of bytes held by the copies.
+    pub(super) fn size(&self) -> usize {
+        core::mem::size_of_val(&*self.data)
+    }
+}
+
+#[cfg(not(feature = "inline-values"))]
+impl Inlines {
+    pub(super) fn new(_buckets: usize) -> Self {
+        Self
+    }
+
+    #[inline]
+    pub(super) fn get(
+        &self,
+        _slot: usize,
+        _item_info: u64,
+        _cas: u32,
+        _key: &[u8],
+    ) -> Option<Inline> {
+        None
+    }
+
+    #[inline]
+    pub(super) fn fill(&mut self, _slot: usize, _item_info: u64, _cas: u32, _item: &RawItem) {}
+
+    pub(super) fn size(&self) -> usize {
+        0
+    }
+}
+
+#[cfg(all(test, feature = "inline-values"))]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn inline() {
+        assert_eq!(core::mem::size_of::<Inline>(), 32);
+
+        let mut inlines = Inlines::new(1);
+        let item_info = 0x0123_4567_89AB_CDEF;
+
+        // an empty copy is never used
+        assert!(inlines.get(1, item_info, 7, b"").is_none());
+
+        inlines.data[1] = Inline {
+            item_info: clear_freq(item_info),
+            cas: 7,
+            klen: 3,
+            vlen: 2,
+            olen: 1,
+            flags: 0,
+            bytes: *b"keyvo\0\0\0\0\0\0\0\0\0\0\0",
+        };
+        let inline = inlines.get(1, item_info, 7, b"key").unwrap();
+        assert_eq!(inline.key(), b"key");
+        assert_eq!(inline.value(), b"vo");
+        assert_eq!(inline.optional(), Some(&b"\0"[..]));
+
+        // the frequency of the item info may change, other bits may not, and
+        // neither may the CAS value or the key
+        assert!(inlines.get(1, item_info ^ FREQ_MASK, 7, b"key").is_some());
+        assert!(inlines.get(1, item_info ^ 1, 7, b"key").is_none());
+        assert!(inlines.get(1, item_info, 8, b"key").is_none());
+        assert!(inlines.get(1, item_info, 7, b"kez").is_none());
+    }
+}
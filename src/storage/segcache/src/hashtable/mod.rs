@@ -64,23 +64,65 @@
 //! This works out so that we have capacity to store 7 items for every bucket
 //! allocated to a chain.
 //!
+//! The geometry is chosen at compile time. With the `wide-buckets` feature,
+//! buckets are 128 bytes with 16 slots. A table of the same power has half as
+//! many buckets, each of which holds 15 items rather than 7, so fewer buckets
+//! are chained, at the cost of a second cacheline for each probe. With the `large-segments` feature, item info
+//! spends 4 more bits on the offset within the segment, which raises the
+//! largest segment from 8MB to 128MB and lowers the number of segments from
+//! 2^24 to 2^20. With the `fingerprints` feature, each item slot is paired
+//! with 16 more bits of the hash, so that most tag matches for other keys are
+//! rejected without reading the item, see the fingerprints module. With the
+//! `inline-values` feature, small items are copied beside their slots and
+//! lookups of them are answered without reading the segment, see the inline
+//! module. With the `item-cas` feature, each item slot is paired with a CAS
+//! value of its own, so that a write to one key does not fail a `cas` for the
+//! other keys in its chain, see the cas module. Caches of different
+//! geometries do not restore each other.
+//!
 
 // hashtable
 
 /// The number of slots within each bucket
-const N_BUCKET_SLOT: usize = 8;
+#[cfg(not(feature = "wide-buckets"))]
+pub(crate) const N_BUCKET_SLOT: usize = 8;
+#[cfg(feature = "wide-buckets")]
+pub(crate) const N_BUCKET_SLOT: usize = 16;
+
+/// A component of the layout version for the geometry, so that a cache saved
+/// with one geometry is not restored with another
+pub(crate) const GEOMETRY_VERSION: u64 = ((N_BUCKET_SLOT as u64 / 8 - 1)
+    | ((OFFSET_BITS - 20) / 4) << 1
+    | (cfg!(feature = "fingerprints") as u64) << 2
+    | (cfg!(feature = "item-cas") as u64) << 3)
+    << 32;
 
 /// Maximum number of buckets in a chain. Must be <= 255.
 const MAX_CHAIN_LEN: u64 = 16;
 
+/// Maximum number of item slots across a full bucket chain
+const MAX_CHAIN_ITEMS: usize = N_BUCKET_SLOT * (MAX_CHAIN_LEN as usize + 1);
+
+/// Number of additional buckets migrated on each insert while growing
+const INSERT_MIGRATE_BUCKETS: usize = 4;
+
 use crate::*;
-use ahash::RandomState;
 use core::marker::PhantomData;
 use core::num::NonZeroU32;
+use datatier::HugePages;
 
+mod buckets;
+mod cas;
+mod fingerprints;
 mod hash_bucket;
+mod inline;
 
+use buckets::Buckets;
+use cas::CasValues;
+use fingerprints::{slot_index, Fingerprints};
 pub(crate) use hash_bucket::*;
+pub(crate) use inline::Inline;
+use inline::Inlines;
 
 #[derive(Debug)]
 struct IterState {
@@ -93,10 +135,9 @@ struct IterState {
 }
 
 impl IterState {
-    fn new(hashtable: &HashTable, hash: u64) -> Self {
-        let bucket_id = (hash & hashtable.mask) as usize;
-        let buckets_len = hashtable.data.len();
-        let bucket = hashtable.data[bucket_id];
+    fn new(data: &[HashBucket], bucket_id: usize) -> Self {
+        let buckets_len = data.len();
+        let bucket = data[bucket_id];
         let chain_len = chain_len(bucket.data[0]) as usize;
 
         Self {
@@ -133,9 +174,15 @@ struct IterMut<'a> {
 
 impl<'a> IterMut<'a> {
     fn new(hashtable: &'a mut HashTable, hash: u64) -> Self {
-        let state = IterState::new(hashtable, hash);
+        let (data, bucket_id) = hashtable.table_mut(hash);
+
+        Self::from_table(data, bucket_id)
+    }
 
-        let ptr = hashtable.data.as_mut_ptr();
+    fn from_table(data: &'a mut [HashBucket], bucket_id: usize) -> Self {
+        let state = IterState::new(data, bucket_id);
+
+        let ptr = data.as_mut_ptr();
 
         Self {
             ptr,
@@ -191,20 +238,73 @@ impl<'a> Iterator for IterMut<'a> {
 /// of [`HashBucket`]s which are used to store item info and metadata.
 #[repr(C)]
 pub(crate) struct HashTable {
-    hash_builder: Box<RandomState>,
-    power: u64,
+    pub(crate) power: u64,
     mask: u64,
-    data: Box<[HashBucket]>,
+    data: Buckets,
+    fingerprints: Fingerprints,
+    cas: CasValues,
+    inlines: Inlines,
     started: Instant,
     next_to_chain: u64,
-    _pad: [u8; 8],
+    resize: Box<Resize>,
+}
+
+/// State used to grow the hashtable. While growing, the table which preceded
+/// the current one is retained and its buckets are incrementally migrated
+/// into the current table.
+struct Resize {
+    max_power: u64,
+    overflow_factor: f64,
+    huge_pages: HugePages,
+    previous: Option<PreviousTable>,
+}
+
+/// The table which is being migrated while the hashtable grows.
+struct PreviousTable {
+    mask: u64,
+    data: Buckets,
+    fingerprints: Fingerprints,
+    cas: CasValues,
+    /// The next primary bucket to be migrated
+    cursor: usize,
+}
+
+/// Allocates the buckets for a table, returning the buckets, their
+/// fingerprints and CAS values, the mask, and the id of the first overflow
+/// bucket.
+fn allocate(
+    power: u64,
+    overflow_factor: f64,
+    huge_pages: HugePages,
+) -> (Buckets, Fingerprints, CasValues, u64, u64) {
+    let slots = 1_u64 << power;
+    let buckets = slots / N_BUCKET_SLOT as u64;
+    let mask = buckets - 1;
+
+    let total_buckets = (buckets as f64 * (1.0 + overflow_factor)).ceil() as usize;
+
+    let data = Buckets::new(total_buckets, huge_pages);
+    debug!(
+        "hashtable has: {} primary slots across {} primary buckets and {} total buckets",
+        slots, buckets, total_buckets,
+    );
+
+    (
+        data,
+        Fingerprints::new(total_buckets),
+        CasValues::new(total_buckets),
+        mask,
+        buckets,
+    )
 }
 
 impl HashTable {
     /// Creates a new hashtable with a specified power and overflow factor. The
     /// hashtable will have the capacity to store up to
-    /// `7 * 2^(power - 3) * (1 + overflow_factor)` items.
-    pub fn new(power: u8, overflow_factor: f64) -> HashTable {
+    /// `7 * 2^(power - 3) * (1 + overflow_factor)` items with the default
+    /// geometry of 8 slots per bucket. The buckets are
+    /// backed by huge pages if requested and available.
+    pub fn new(power: u8, overflow_factor: f64, huge_pages: HugePages) -> HashTable {
         if overflow_factor < 0.0 {
             panic!("hashtable overflow factor must be >= 0.0");
         }
@@ -214,50 +314,417 @@ impl HashTable {
             panic!("hashtable overflow factor must be <= {}", MAX_CHAIN_LEN);
         }
 
-        let slots = 1_u64 << power;
-        let buckets = slots / 8;
-        let mask = buckets - 1;
-
-        let total_buckets = (buckets as f64 * (1.0 + overflow_factor)).ceil() as usize;
-
-        let mut data = Vec::with_capacity(0);
-        data.reserve_exact(total_buckets);
-        data.resize(total_buckets, HashBucket::new());
-        debug!(
-            "hashtable has: {} primary slots across {} primary buckets and {} total buckets",
-            slots, buckets, total_buckets,
-        );
-
-        let hash_builder = RandomState::with_seeds(
-            0xbb8c484891ec6c86,
-            0x0522a25ae9c769f9,
-            0xeed2797b9571bc75,
-            0x4feb29c1fbbd59d0,
-        );
+        let (data, fingerprints, cas, mask, next_to_chain) =
+            allocate(power.into(), overflow_factor, huge_pages);
+        let inlines = Inlines::new(data.len());
 
-        Self {
-            hash_builder: Box::new(hash_builder),
+        let table = Self {
             power: power.into(),
             mask,
-            data: data.into_boxed_slice(),
+            data,
+            fingerprints,
+            cas,
+            inlines,
             started: Instant::now(),
-            next_to_chain: buckets,
-            _pad: [0; 8],
+            next_to_chain,
+            resize: Box::new(Resize {
+                max_power: power.into(),
+                overflow_factor,
+                huge_pages,
+                previous: None,
+            }),
+        };
+        table.account(0);
+        table
+    }
+
+    /// Allows the hashtable to grow up to the provided power. Each time the
+    /// hashtable runs out of room for a bucket chain it doubles in size, and
+    /// the buckets are then migrated incrementally. A power which is not
+    /// larger than the current power disables growth.
+    pub fn max_power(mut self, power: u8) -> Self {
+        self.resize.max_power = self.power.max(power.into());
+        self
+    }
+
+    /// Returns true if the hashtable is currently migrating buckets from the
+    /// previous table.
+    pub fn is_resizing(&self) -> bool {
+        self.resize.previous.is_some()
+    }
+
+    /// Returns the buckets and the primary bucket id which currently hold the
+    /// chain for the hash. While growing, chains which have not yet been
+    /// migrated remain in the previous table.
+    #[inline]
+    fn table(&self, hash: u64) -> (&[HashBucket], usize) {
+        let (data, _, _, id) = self.table_parts(hash);
+        (data, id)
+    }
+
+    /// A mutable variant of `table()`
+    #[inline]
+    fn table_mut(&mut self, hash: u64) -> (&mut [HashBucket], usize) {
+        let (data, _, _, id) = self.table_parts_mut(hash);
+        (data, id)
+    }
+
+    /// As `table()`, along with the fingerprints and CAS values of the same
+    /// table
+    #[inline]
+    fn table_parts(&self, hash: u64) -> (&[HashBucket], &Fingerprints, &CasValues, usize) {
+        if let Some(previous) = &self.resize.previous {
+            let id = (hash & previous.mask) as usize;
+            if previous.data[id].data[0] & BUCKET_MIGRATED == 0 {
+                return (
+                    &previous.data[..],
+                    &previous.fingerprints,
+                    &previous.cas,
+                    id,
+                );
+            }
+        }
+        (
+            &self.data[..],
+            &self.fingerprints,
+            &self.cas,
+            (hash & self.mask) as usize,
+        )
+    }
+
+    /// A mutable variant of `table_parts()`
+    #[inline]
+    fn table_parts_mut(
+        &mut self,
+        hash: u64,
+    ) -> (&mut [HashBucket], &mut Fingerprints, &mut CasValues, usize) {
+        if let Some(previous) = &mut self.resize.previous {
+            let id = (hash & previous.mask) as usize;
+            if previous.data[id].data[0] & BUCKET_MIGRATED == 0 {
+                return (
+                    &mut previous.data[..],
+                    &mut previous.fingerprints,
+                    &mut previous.cas,
+                    id,
+                );
+            }
+        }
+        (
+            &mut self.data[..],
+            &mut self.fingerprints,
+            &mut self.cas,
+            (hash & self.mask) as usize,
+        )
+    }
+
+    /// Returns the CAS value of the item in the slot of the chain for the
+    /// hash, whose index counts the slots of all preceding buckets
+    #[inline]
+    fn item_cas(&self, hash: u64, slot: usize) -> u32 {
+        let (data, _, cas, id) = self.table_parts(hash);
+        cas.get(slot, get_cas(data[id].data[0]))
+    }
+
+    /// Changes the CAS value of the chain for the hash, as is done for every
+    /// write to one of its items, and gives the new value to the item in the
+    /// slot which was written, if provided. Returns the new value.
+    #[inline]
+    fn bump_chain_cas(&mut self, hash: u64, slot: Option<usize>) -> u32 {
+        let (data, _, cas, id) = self.table_parts_mut(hash);
+        data[id].data[0] = data[id].data[0].wrapping_add(1 << CAS_BIT_SHIFT);
+        let value = get_cas(data[id].data[0]);
+        if let Some(slot) = slot {
+            cas.set(slot, value);
+        }
+        value
+    }
+
+    /// Returns the bucket info for the chain which holds the hash
+    #[inline]
+    fn bucket_info(&self, hash: u64) -> u64 {
+        let (data, id) = self.table(hash);
+        data[id].data[0]
+    }
+
+    /// Returns a mutable reference to the bucket info for the chain which
+    /// holds the hash
+    #[inline]
+    fn bucket_info_mut(&mut self, hash: u64) -> &mut u64 {
+        let (data, id) = self.table_mut(hash);
+        &mut data[id].data[0]
+    }
+
+    /// Starts growing the hashtable by doubling the number of buckets. Returns
+    /// false if the hashtable is already at its maximum size or has not yet
+    /// finished migrating from a previous resize.
+    fn grow(&mut self) -> bool {
+        if self.resize.previous.is_some() || self.power >= self.resize.max_power {
+            return false;
+        }
+
+        #[cfg(feature = "metrics")]
+        HASH_RESIZE.increment();
+
+        let before = self.size();
+        let power = self.power + 1;
+        let (data, fingerprints, cas, mask, next_to_chain) =
+            allocate(power, self.resize.overflow_factor, self.resize.huge_pages);
+
+        self.resize.previous = Some(PreviousTable {
+            mask: self.mask,
+            data: std::mem::replace(&mut self.data, data),
+            fingerprints: std::mem::replace(&mut self.fingerprints, fingerprints),
+            cas: std::mem::replace(&mut self.cas, cas),
+            cursor: 0,
+        });
+        self.inlines = Inlines::new(self.data.len());
+        self.power = power;
+        self.mask = mask;
+        self.next_to_chain = next_to_chain;
+        self.account(before);
+
+        true
+    }
+
+    /// Migrates up to `count` buckets from the previous table while growing.
+    /// Once all buckets have been migrated, the previous table is freed.
+    pub fn migrate(&mut self, count: usize, ttl_buckets: &mut TtlBuckets, segments: &mut Segments) {
+        for _ in 0..count {
+            let id = match &mut self.resize.previous {
+                Some(previous) if previous.cursor <= previous.mask as usize => {
+                    previous.cursor += 1;
+                    previous.cursor - 1
+                }
+                Some(_) => {
+                    debug!("hashtable resize complete, power: {}", self.power);
+                    let before = self.size();
+                    self.resize.previous = None;
+                    self.account(before);
+                    return;
+                }
+                None => {
+                    return;
+                }
+            };
+
+            self.migrate_bucket(id, ttl_buckets, segments);
+        }
+    }
+
+    /// Migrates the bucket of the previous table which holds the hash, if it
+    /// has not been migrated already.
+    fn migrate_hash(&mut self, hash: u64, ttl_buckets: &mut TtlBuckets, segments: &mut Segments) {
+        if let Some(previous) = &self.resize.previous {
+            let id = (hash & previous.mask) as usize;
+            self.migrate_bucket(id, ttl_buckets, segments);
+        }
+    }
+
+    /// Moves the chain for a primary bucket of the previous table into the
+    /// current table. Because the current table is twice the size, the items
+    /// are split between two primary buckets of the current table. Items for
+    /// which there is no room are removed from the cache.
+    fn migrate_bucket(&mut self, id: usize, ttl_buckets: &mut TtlBuckets, segments: &mut Segments) {
+        let previous = match &mut self.resize.previous {
+            Some(previous) => previous,
+            None => {
+                return;
+            }
+        };
+
+        let bucket_info = previous.data[id].data[0];
+        if bucket_info & BUCKET_MIGRATED != 0 {
+            return;
+        }
+
+        #[cfg(feature = "metrics")]
+        HASH_MIGRATE.increment();
+
+        // items keep their CAS values as they move
+        let chain_cas = get_cas(bucket_info);
+        let base = previous.data.as_ptr();
+        let mut items = [(0, 0); MAX_CHAIN_ITEMS];
+        let mut count = 0;
+        for item_info in IterMut::from_table(&mut previous.data, id) {
+            if *item_info != 0 {
+                let cas = previous.cas.get(slot_index(base, item_info), chain_cas);
+                items[count] = (*item_info, cas);
+                count += 1;
+            }
+        }
+
+        previous.data[id].data[0] = BUCKET_MIGRATED;
+
+        // both destination buckets inherit the CAS and timestamp
+        let split = previous.mask as usize + 1;
+        for new_id in [id, id + split] {
+            self.data[new_id].data[0] = bucket_info & (CAS_MASK | TS_MASK);
+        }
+
+        let mut dropped = [0; MAX_CHAIN_ITEMS];
+        let mut ndropped = 0;
+        for (item_info, cas) in &items[0..count] {
+            let hash = self.hash(&segments.get_item(*item_info).unwrap().key());
+            if !self.place(hash, *item_info, *cas) {
+                dropped[ndropped] = *item_info;
+                ndropped += 1;
+            }
+        }
+
+        for item_info in &dropped[0..ndropped] {
+            #[cfg(feature = "metrics")]
+            HASH_MIGRATE_EX.increment();
+
+            let _ = segments.remove_item(*item_info, ttl_buckets, self);
+        }
+    }
+
+    /// Stores the item info and the CAS value of its item in the first empty
+    /// slot of the chain for the hash, extending the chain if necessary.
+    /// Returns false if there is no room.
+    fn place(&mut self, hash: u64, insert_item_info: u64, insert_cas: u32) -> bool {
+        let (data, fingerprints, cas, id) = self.table_parts_mut(hash);
+        let base = data.as_ptr();
+        for item_info in IterMut::from_table(data, id) {
+            if *item_info == 0 {
+                *item_info = insert_item_info;
+                let slot = slot_index(base, item_info);
+                fingerprints.set(slot, hash);
+                cas.set(slot, insert_cas);
+                return true;
+            }
+        }
+
+        self.chain(hash, insert_item_info, insert_cas)
+    }
+
+    /// Extends the chain for the hash with a new bucket from the overflow area
+    /// and stores the item info and the CAS value of its item in it. Returns
+    /// false if the chain is at its maximum length or there are no more
+    /// overflow buckets.
+    fn chain(&mut self, hash: u64, insert_item_info: u64, insert_cas: u32) -> bool {
+        let mut bucket_id = (hash & self.mask) as usize;
+        let chain_len = chain_len(self.data[bucket_id].data[0]);
+
+        if chain_len < MAX_CHAIN_LEN && (self.next_to_chain as usize) < self.data.len() {
+            // we need to chase through the buckets to get the id of the last
+            // bucket in the chain
+            for _ in 0..chain_len {
+                bucket_id = self.data[bucket_id].data[N_BUCKET_SLOT - 1] as usize;
+            }
+
+            let next_id = self.next_to_chain as usize;
+            self.next_to_chain += 1;
+
+            self.data[next_id].data[0] = self.data[bucket_id].data[N_BUCKET_SLOT - 1];
+            self.data[next_id].data[1] = insert_item_info;
+            self.fingerprints.set(next_id * N_BUCKET_SLOT + 1, hash);
+            self.cas.set(next_id * N_BUCKET_SLOT + 1, insert_cas);
+            self.data[bucket_id].data[N_BUCKET_SLOT - 1] = next_id as u64;
+
+            self.data[(hash & self.mask) as usize].data[0] += 0x0000_0000_0001_0000;
+
+            true
+        } else {
+            false
         }
     }
 
     /// Lookup an item by key and return it
     pub fn get(&mut self, key: &[u8], time: Instant, segments: &mut Segments) -> Option<Item> {
         let hash = self.hash(key);
-        let tag = tag_from_hash(hash);
-        let bucket_id = hash & self.mask;
+        self.get_with_hash(hash, key, time, segments)
+    }
+
+    /// Lookup an item by key and the hash of the key, as returned by
+    /// [`storage_types::hash_key`], and return it
+    pub fn get_hashed(
+        &mut self,
+        key: &[u8],
+        hash: u64,
+        time: Instant,
+        segments: &mut Segments,
+    ) -> Option<Item> {
+        #[cfg(feature = "metrics")]
+        HASH_LOOKUP.increment();
+
+        self.get_with_hash(hash, key, time, segments)
+    }
+
+    /// Lookup multiple items by key and the hash of each key. The lookups are
+    /// performed in waves so that the memory accesses for each key overlap:
+    /// the buckets for all keys are prefetched, then the candidate items are
+    /// prefetched, and finally each lookup is resolved. The results are in the
+    /// same order as the keys, and there must be a hash for each key.
+    pub fn get_many_hashed<K: AsRef<[u8]>>(
+        &mut self,
+        keys: &[K],
+        hashes: &[u64],
+        time: Instant,
+        segments: &mut Segments,
+    ) -> Vec<Option<Item>> {
+        debug_assert_eq!(keys.len(), hashes.len());
+
+        #[cfg(feature = "metrics")]
+        HASH_LOOKUP.add(keys.len() as _);
+
+        for hash in hashes.iter() {
+            let (data, id) = self.table(*hash);
+            prefetch(&data[id]);
+        }
+
+        for hash in hashes.iter() {
+            let (data, fingerprints, _, id) = self.table_parts(*hash);
+            let bucket = &data[id];
+            let tag = tag_from_hash(*hash);
+
+            // only the first candidate in the primary bucket is prefetched,
+            // this covers the common case without walking the chain
+            let mut candidates = bucket.tag_matches(tag) & !1;
+            while candidates != 0 {
+                let slot = candidates.trailing_zeros() as usize;
+                candidates &= candidates - 1;
+                if fingerprints.matches(id * N_BUCKET_SLOT + slot, *hash) {
+                    segments.prefetch_item(bucket.data[slot]);
+                    break;
+                }
+            }
+        }
 
-        let bucket_info = self.data[bucket_id as usize].data[0];
+        keys.iter()
+            .zip(hashes)
+            .map(|(key, hash)| self.get_with_hash(*hash, key.as_ref(), time, segments))
+            .collect()
+    }
+
+    /// Prefetch the bucket for the key, so that a lookup of the key which
+    /// follows shortly after does not stall on the memory access. This is not
+    /// counted as a lookup.
+    pub fn prefetch(&self, key: &[u8]) {
+        self.prefetch_hashed(storage_types::hash_key(key));
+    }
+
+    /// Prefetch the bucket for the hash of a key, as for
+    /// [`HashTable::prefetch`].
+    pub fn prefetch_hashed(&self, hash: u64) {
+        let (data, id) = self.table(hash);
+        prefetch(&data[id]);
+    }
+
+    /// Lookup an item using a previously calculated hash of the key.
+    fn get_with_hash(
+        &mut self,
+        hash: u64,
+        key: &[u8],
+        time: Instant,
+        segments: &mut Segments,
+    ) -> Option<Item> {
+        let bucket_info = self.bucket_info(hash);
 
         let curr_ts = (time - self.started).as_secs() & PROC_TS_MASK;
 
         if curr_ts != get_ts(bucket_info) as u32 {
-            self.data[bucket_id as usize].data[0] = (bucket_info & !TS_MASK) | (curr_ts as u64);
+            *self.bucket_info_mut(hash) = (bucket_info & !TS_MASK) | (curr_ts as u64);
 
             let iter = IterMut::new(self, hash);
             for item_info in iter {
@@ -265,39 +732,39 @@ impl HashTable {
             }
         }
 
-        let iter = IterMut::new(self, hash);
+        let (id, slot, current_item, inline) = self.probe(hash, key, segments)?;
 
-        for item_info in iter {
-            if get_tag(*item_info) == tag {
-                let current_item = segments.get_item(*item_info).unwrap();
-                if current_item.key() != key {
-                    #[cfg(feature = "metrics")]
-                    HASH_TAG_COLLISION.increment();
-                } else {
-                    // update item frequency
-                    let mut freq = get_freq(*item_info);
-                    if freq < 127 {
-                        let rand = thread_rng().gen::<u64>();
-                        if freq <= 16 || rand % freq == 0 {
-                            freq = ((freq + 1) | 0x80) << FREQ_BIT_SHIFT;
-                        } else {
-                            freq = (freq | 0x80) << FREQ_BIT_SHIFT;
-                        }
-                        *item_info = (*item_info & !FREQ_MASK) | freq;
-                    }
+        // update item frequency
+        let item_info = &mut self.table_mut(hash).0[id].data[slot];
+        let mut freq = get_freq(*item_info);
+        if freq < 127 {
+            let rand = thread_rng().gen::<u64>();
+            if freq <= 16 || rand % freq == 0 {
+                freq = ((freq + 1) | 0x80) << FREQ_BIT_SHIFT;
+            } else {
+                freq = (freq | 0x80) << FREQ_BIT_SHIFT;
+            }
+            *item_info = (*item_info & !FREQ_MASK) | freq;
+        }
+        let item_info = *item_info;
+        segments.record_hit(item_info);
 
-                    let item = Item::new(
-                        current_item,
-                        get_cas(self.data[(hash & self.mask) as usize].data[0]),
-                    );
-                    item.check_magic();
+        let cas = self.item_cas(hash, id * N_BUCKET_SLOT + slot);
+        if let Some(inline) = inline {
+            return Some(Item::with_inline(current_item, cas, inline));
+        }
 
-                    return Some(item);
-                }
-            }
+        // a small item which was read from its segment is copied beside its
+        // slot, so that the next lookup of it need not read the segment
+        if !self.is_resizing() && segments.in_memory(item_info) {
+            self.inlines
+                .fill(id * N_BUCKET_SLOT + slot, item_info, cas, &current_item);
         }
 
-        None
+        let item = Item::new(current_item, cas);
+        item.check_magic();
+
+        Some(item)
     }
 
     /// Lookup an item by key and return it without incrementing the item
@@ -306,26 +773,94 @@ impl HashTable {
     pub fn get_no_freq_incr(&mut self, key: &[u8], segments: &mut Segments) -> Option<Item> {
         let hash = self.hash(key);
 
-        let iter = IterMut::new(self, hash);
+        let (id, slot, current_item, _) = self.probe(hash, key, segments)?;
+
+        let item = Item::new(current_item, self.item_cas(hash, id * N_BUCKET_SLOT + slot));
+        item.check_magic();
 
+        Some(item)
+    }
+
+    /// Walks the bucket chain for the hash, comparing the tag against all
+    /// slots of each bucket at once. Only slots with a matching tag and
+    /// fingerprint have their item key compared. Returns the bucket id and slot of the matching item
+    /// info along with the item itself, and the copy of the item which was
+    /// compared instead of reading the item, if there is one.
+    fn probe(
+        &self,
+        hash: u64,
+        key: &[u8],
+        segments: &mut Segments,
+    ) -> Option<(usize, usize, RawItem, Option<Inline>)> {
         let tag = tag_from_hash(hash);
+        let resizing = self.is_resizing();
 
-        for item_info in iter {
-            if get_tag(*item_info) == tag {
-                let current_item = segments.get_item(*item_info).unwrap();
-                if current_item.key() != key {
+        let (data, fingerprints, cas_values, mut bucket_id) = self.table_parts(hash);
+        let chain_cas = get_cas(data[bucket_id].data[0]);
+        let chain_len = chain_len(data[bucket_id].data[0]);
+
+        // slot 0 of the first bucket holds the bucket info
+        let mut exclude = 1;
+
+        for chain_idx in 0..=chain_len {
+            let bucket = &data[bucket_id];
+
+            // unless this is the last bucket in the chain, the final slot holds
+            // the id of the next bucket
+            if chain_idx < chain_len {
+                exclude |= 1 << (N_BUCKET_SLOT - 1);
+            }
+
+            let mut candidates = bucket.tag_matches(tag) & !exclude;
+
+            while candidates != 0 {
+                let slot = candidates.trailing_zeros() as usize;
+                candidates &= candidates - 1;
+
+                if !fingerprints.matches(bucket_id * N_BUCKET_SLOT + slot, hash) {
+                    #[cfg(feature = "metrics")]
+                    HASH_FINGERPRINT_REJECT.increment();
+                    continue;
+                }
+
+                // a flash segment is only read if its filter may hold the key
+                if !segments.may_hold(bucket.data[slot], hash) {
+                    #[cfg(feature = "metrics")]
+                    FLASH_FILTER_SKIP.increment();
+                    continue;
+                }
+
+                // the items of flushed segments are missing until the
+                // segments are reclaimed
+                if segments.is_flushed(bucket.data[slot]) {
+                    continue;
+                }
+
+                // a copy of the item beside the slot is compared in place of
+                // the item, which is then not read from its segment
+                if !resizing && segments.in_memory(bucket.data[slot]) {
+                    let index = bucket_id * N_BUCKET_SLOT + slot;
+                    let cas = cas_values.get(index, chain_cas);
+                    if let Some(inline) = self.inlines.get(index, bucket.data[slot], cas, key) {
+                        #[cfg(feature = "metrics")]
+                        HASH_INLINE_HIT.increment();
+
+                        let current_item = segments.get_item(bucket.data[slot]).unwrap();
+                        return Some((bucket_id, slot, current_item, Some(inline)));
+                    }
+                }
+
+                let current_item = segments.get_item(bucket.data[slot]).unwrap();
+                if !current_item.key_eq(key) {
                     #[cfg(feature = "metrics")]
                     HASH_TAG_COLLISION.increment();
                 } else {
-                    let item = Item::new(
-                        current_item,
-                        get_cas(self.data[(hash & self.mask) as usize].data[0]),
-                    );
-                    item.check_magic();
-
-                    return Some(item);
+                    return Some((bucket_id, slot, current_item, None));
                 }
             }
+
+            bucket_id = bucket.data[N_BUCKET_SLOT - 1] as usize;
+            exclude = 0;
         }
 
         None
@@ -417,34 +952,53 @@ impl HashTable {
         #[cfg(feature = "metrics")]
         HASH_INSERT.increment();
 
-        let hash = self.hash(item.key());
+        let key = item.key();
+        let hash = self.hash(&key);
         let tag = tag_from_hash(hash);
 
         // check the item magic
         item.check_magic();
 
+        // while growing, the chain for this item must be migrated before it is
+        // modified, and we make some progress on migrating the other buckets
+        if self.is_resizing() {
+            self.migrate_hash(hash, ttl_buckets, segments);
+            self.migrate(INSERT_MIGRATE_BUCKETS, ttl_buckets, segments);
+        }
+
         let mut insert_item_info = build_item_info(tag, seg, offset);
 
         let mut removed: Option<u64> = None;
 
-        let iter = IterMut::new(self, hash);
+        // the item is given the CAS value which the chain has once the insert
+        // has changed it
+        let (data, fingerprints, cas, id) = self.table_parts_mut(hash);
+        let base = data.as_ptr();
+        let insert_cas = get_cas(data[id].data[0]).wrapping_add(1);
 
-        for item_info in iter {
+        for item_info in IterMut::from_table(data, id) {
+            let slot = slot_index(base, item_info);
             if get_tag(*item_info) != tag {
                 if insert_item_info != 0 && *item_info == 0 {
                     // found a blank slot
                     *item_info = insert_item_info;
+                    fingerprints.set(slot, hash);
+                    cas.set(slot, insert_cas);
                     insert_item_info = 0;
                 }
                 continue;
             }
-            if segments.get_item(*item_info).unwrap().key() != item.key() {
+            if !fingerprints.matches(slot, hash) {
+                #[cfg(feature = "metrics")]
+                HASH_FINGERPRINT_REJECT.increment();
+            } else if !segments.get_item(*item_info).unwrap().key_eq(&key) {
                 #[cfg(feature = "metrics")]
                 HASH_TAG_COLLISION.increment();
             } else {
                 // update existing key
                 removed = Some(*item_info);
                 *item_info = insert_item_info;
+                cas.set(slot, insert_cas);
                 insert_item_info = 0;
                 break;
             }
@@ -457,31 +1011,21 @@ impl HashTable {
             let _ = segments.remove_item(removed_item, ttl_buckets, self);
         }
 
-        if insert_item_info != 0 {
-            let mut bucket_id = (hash & self.mask) as usize;
-            let chain_len = chain_len(self.data[bucket_id].data[0]);
-
-            if chain_len < MAX_CHAIN_LEN && (self.next_to_chain as usize) < self.data.len() {
-                // we need to chase through the buckets to get the id of the last
-                // bucket in the chain
-                for _ in 0..chain_len {
-                    bucket_id = self.data[bucket_id].data[N_BUCKET_SLOT - 1] as usize;
-                }
-
-                let next_id = self.next_to_chain as usize;
-                self.next_to_chain += 1;
+        if insert_item_info != 0 && self.chain(hash, insert_item_info, insert_cas) {
+            insert_item_info = 0;
+        }
 
-                self.data[next_id].data[0] = self.data[bucket_id].data[N_BUCKET_SLOT - 1];
-                self.data[next_id].data[1] = insert_item_info;
+        // if there was no room, try to grow the hashtable. The migration of the
+        // chain for this item splits it, which frees up some room.
+        if insert_item_info != 0 && self.grow() {
+            self.migrate_hash(hash, ttl_buckets, segments);
+            if self.place(hash, insert_item_info, insert_cas) {
                 insert_item_info = 0;
-                self.data[bucket_id].data[N_BUCKET_SLOT - 1] = next_id as u64;
-
-                self.data[(hash & self.mask) as usize].data[0] += 0x0000_0000_0001_0000;
             }
         }
 
         if insert_item_info == 0 {
-            self.data[(hash & self.mask) as usize].data[0] += 1 << CAS_BIT_SHIFT;
+            self.bump_chain_cas(hash, None);
             Ok(())
         } else {
             #[cfg(feature = "metrics")]
@@ -507,14 +1051,24 @@ impl HashTable {
     ) -> Result<(), SegcacheError> {
         let hash = self.hash(key);
         let tag = tag_from_hash(hash);
-        let bucket_id = hash & self.mask;
 
-        let iter = IterMut::new(self, hash);
+        let (data, fingerprints, _, id) = self.table_parts_mut(hash);
+        let base = data.as_ptr();
 
-        for item_info in iter {
+        for item_info in IterMut::from_table(data, id) {
             if get_tag(*item_info) == tag {
+                let slot = slot_index(base, item_info);
+                if !fingerprints.matches(slot, hash) {
+                    #[cfg(feature = "metrics")]
+                    HASH_FINGERPRINT_REJECT.increment();
+
+                    continue;
+                }
+                if segments.is_flushed(*item_info) {
+                    continue;
+                }
                 let item = segments.get_item(*item_info).unwrap();
-                if item.key() != key {
+                if !item.key_eq(key) {
                     #[cfg(feature = "metrics")]
                     HASH_TAG_COLLISION.increment();
                 } else {
@@ -530,8 +1084,8 @@ impl HashTable {
                         *item_info = (*item_info & !FREQ_MASK) | freq;
                     }
 
-                    if cas == get_cas(self.data[bucket_id as usize].data[0]) {
-                        self.data[bucket_id as usize].data[0] += 1 << CAS_BIT_SHIFT;
+                    if cas == self.item_cas(hash, slot) {
+                        self.bump_chain_cas(hash, Some(slot));
                         return Ok(());
                     } else {
                         return Err(SegcacheError::Exists);
@@ -543,6 +1097,21 @@ impl HashTable {
         Err(SegcacheError::NotFound)
     }
 
+    /// Updates the CAS value for the item with the key and the chain which
+    /// holds it, as is done for a write to an item in place, and returns the
+    /// new CAS value
+    pub(crate) fn bump_cas(&mut self, key: &[u8], segments: &mut Segments) -> u32 {
+        let hash = self.hash(key);
+        // the slot of the item is only needed if it has its own CAS value
+        let slot = if cfg!(feature = "item-cas") {
+            self.probe(hash, key, segments)
+                .map(|(id, slot, _, _)| id * N_BUCKET_SLOT + slot)
+        } else {
+            None
+        };
+        self.bump_chain_cas(hash, slot)
+    }
+
     /// Removes the item with the given key
     pub fn delete(
         &mut self,
@@ -553,14 +1122,25 @@ impl HashTable {
         let hash = self.hash(key);
         let tag = tag_from_hash(hash);
 
-        let iter = IterMut::new(self, hash);
+        let (data, fingerprints, _, id) = self.table_parts_mut(hash);
+        let base = data.as_ptr();
 
         let mut removed: Option<u64> = None;
 
-        for item_info in iter {
+        for item_info in IterMut::from_table(data, id) {
             if get_tag(*item_info) == tag {
+                if !fingerprints.matches(slot_index(base, item_info), hash) {
+                    #[cfg(feature = "metrics")]
+                    HASH_FINGERPRINT_REJECT.increment();
+
+                    continue;
+                }
+                // a flushed item is left for its segment to be reclaimed
+                if segments.is_flushed(*item_info) {
+                    continue;
+                }
                 let item = segments.get_item(*item_info).unwrap();
-                if item.key() != key {
+                if !item.key_eq(key) {
                     #[cfg(feature = "metrics")]
                     HASH_TAG_COLLISION.increment();
 
@@ -640,13 +1220,226 @@ impl HashTable {
         false
     }
 
+    /// Returns the number of bytes held by the buckets, their fingerprints and
+    /// CAS values, and the copies of small items, including the buckets,
+    /// fingerprints and CAS values of the previous table while the hashtable
+    /// is growing.
+    pub(crate) fn size(&self) -> usize {
+        let buckets = self.data.len()
+            + self
+                .resize
+                .previous
+                .as_ref()
+                .map(|previous| previous.data.len())
+                .unwrap_or(0);
+        let fingerprints = self.fingerprints.as_slice().len()
+            + self
+                .resize
+                .previous
+                .as_ref()
+                .map(|previous| previous.fingerprints.as_slice().len())
+                .unwrap_or(0);
+        let cas = self.cas.as_slice().len()
+            + self
+                .resize
+                .previous
+                .as_ref()
+                .map(|previous| previous.cas.as_slice().len())
+                .unwrap_or(0);
+
+        buckets * core::mem::size_of::<HashBucket>()
+            + fingerprints * core::mem::size_of::<u16>()
+            + cas * core::mem::size_of::<u32>()
+            + self.inlines.size()
+    }
+
+    /// Adds the change in size since it was `before` to the gauge of the
+    /// memory held by hashtables, so that it follows allocations and frees.
+    #[inline]
+    fn account(&self, before: usize) {
+        #[cfg(feature = "metrics")]
+        HASH_TABLE_BYTES.add(self.size() as i64 - before as i64);
+        #[cfg(not(feature = "metrics"))]
+        let _ = before;
+    }
+
+    /// Returns the size of the current table and how many of its overflow
+    /// buckets have been chained.
+    pub(crate) fn info(&self) -> crate::HashtableInfo {
+        let primary = (self.mask + 1) as usize;
+        crate::HashtableInfo {
+            power: self.power as u8,
+            item_slots: primary * (N_BUCKET_SLOT - 1),
+            overflow_used: self.next_to_chain as usize - primary,
+            overflow_buckets: self.data.len() - primary,
+        }
+    }
+
+    /// Returns the number of bytes needed to save the hashtable metadata.
+    pub(crate) fn metadata_size(&self) -> usize {
+        4 * core::mem::size_of::<u64>()
+            + core::mem::size_of::<u32>()
+            + self.data.len() * core::mem::size_of::<HashBucket>()
+            + self.fingerprints.as_slice().len() * core::mem::size_of::<u16>()
+            + self.cas.as_slice().len() * core::mem::size_of::<u32>()
+    }
+
+    /// Saves the hashtable into the metadata. The hashtable must not be in the
+    /// middle of growing.
+    pub(crate) fn save(&self, writer: &mut MetadataWriter) -> Result<(), std::io::Error> {
+        assert!(!self.is_resizing(), "cannot save hashtable while resizing");
+
+        writer.put_u64(self.power)?;
+        writer.put_u64(self.mask)?;
+        writer.put_u64(self.next_to_chain)?;
+        writer.put_instant(self.started)?;
+        writer.put_u64(self.data.len() as u64)?;
+        for bucket in self.data.iter() {
+            for slot in bucket.data.iter() {
+                writer.put_u64(*slot)?;
+            }
+        }
+        for fingerprint in self.fingerprints.as_slice() {
+            writer.put_u16(*fingerprint)?;
+        }
+        for cas in self.cas.as_slice() {
+            writer.put_u32(*cas)?;
+        }
+
+        Ok(())
+    }
+
+    /// Replaces the contents of the hashtable with the saved metadata. The
+    /// saved hashtable may be larger than this one if it had grown, in which
+    /// case the maximum power is raised to match.
+    pub(crate) fn restore(mut self, reader: &mut MetadataReader) -> Result<Self, std::io::Error> {
+        let invalid = || std::io::Error::new(std::io::ErrorKind::Other, "invalid hashtable");
+
+        let power = reader.get_u64()?;
+        let mask = reader.get_u64()?;
+        let next_to_chain = reader.get_u64()?;
+        let started = reader.get_instant()?;
+        let buckets = reader.get_u64()?;
+
+        if !(N_BUCKET_SLOT.trailing_zeros() as u64..64).contains(&power)
+            || mask != (1 << power) / N_BUCKET_SLOT as u64 - 1
+            || buckets <= mask
+            || next_to_chain > buckets
+        {
+            return Err(invalid());
+        }
+
+        let mut data = Buckets::new(buckets as usize, self.resize.huge_pages);
+        for bucket in data.iter_mut() {
+            for slot in bucket.data.iter_mut() {
+                *slot = reader.get_u64()?;
+            }
+        }
+        let mut fingerprints = Fingerprints::new(buckets as usize);
+        for fingerprint in fingerprints.as_mut_slice() {
+            *fingerprint = reader.get_u16()?;
+        }
+        let mut cas = CasValues::new(buckets as usize);
+        for cas in cas.as_mut_slice() {
+            *cas = reader.get_u32()?;
+        }
+
+        let before = self.size();
+        self.power = power;
+        self.mask = mask;
+        self.next_to_chain = next_to_chain;
+        self.started = started;
+        self.data = data;
+        self.fingerprints = fingerprints;
+        self.cas = cas;
+        self.inlines = Inlines::new(buckets as usize);
+        self.resize.max_power = self.resize.max_power.max(power);
+        self.resize.previous = None;
+        self.account(before);
+
+        Ok(self)
+    }
+
+    /// Visits the items held in up to `count` primary buckets, starting at the
+    /// cursor, and returns the cursor to continue from, which is zero once the
+    /// whole table has been visited. Buckets are visited in the order of their
+    /// reversed bits, as with the `SCAN` of Redis, so that every item which is
+    /// held throughout a scan is visited even if the table grows between calls.
+    /// Items may be visited more than once.
+    pub(crate) fn scan<F: FnMut(RawItem)>(
+        &self,
+        mut cursor: u64,
+        count: usize,
+        segments: &mut Segments,
+        mut f: F,
+    ) -> u64 {
+        let mut item_infos = Vec::new();
+
+        for _ in 0..count.max(1) {
+            // chains not yet migrated from the previous table are visited
+            // there
+            if let Some(previous) = &self.resize.previous {
+                let id = (cursor & previous.mask) as usize;
+                if previous.data[id].data[0] & BUCKET_MIGRATED == 0 {
+                    chain_items(&previous.data, id, &mut item_infos);
+                }
+            }
+            chain_items(&self.data, (cursor & self.mask) as usize, &mut item_infos);
+
+            cursor |= !self.mask;
+            cursor = cursor.reverse_bits().wrapping_add(1).reverse_bits();
+            if cursor == 0 {
+                break;
+            }
+        }
+
+        for item_info in item_infos {
+            if segments.is_flushed(item_info) {
+                continue;
+            }
+            if let Some(item) = segments.get_item(item_info) {
+                f(item);
+            }
+        }
+
+        cursor
+    }
+
     /// Internal function used to calculate a hash value for a key
-    fn hash(&self, key: &[u8]) -> u64 {
+    pub(crate) fn hash(&self, key: &[u8]) -> u64 {
         #[cfg(feature = "metrics")]
         HASH_LOOKUP.increment();
 
-        let mut hasher = self.hash_builder.build_hasher();
-        hasher.write(key);
-        hasher.finish()
+        storage_types::hash_key(key)
+    }
+}
+
+impl Drop for HashTable {
+    fn drop(&mut self) {
+        #[cfg(feature = "metrics")]
+        HASH_TABLE_BYTES.sub(self.size() as _);
+    }
+}
+
+/// Appends the item info of each occupied slot in the chain of the primary
+/// bucket.
+fn chain_items(data: &[HashBucket], mut bucket_id: usize, item_infos: &mut Vec<u64>) {
+    let chain_len = chain_len(data[bucket_id].data[0]) as usize;
+
+    for chain_idx in 0..=chain_len {
+        let bucket = &data[bucket_id];
+
+        // slot 0 of the first bucket holds the bucket info, and unless this is
+        // the last bucket in the chain, the final slot holds the id of the next
+        let first = if chain_idx == 0 { 1 } else { 0 };
+        let last = if chain_idx < chain_len {
+            N_BUCKET_SLOT - 1
+        } else {
+            N_BUCKET_SLOT
+        };
+
+        item_infos.extend(bucket.data[first..last].iter().filter(|v| **v != 0));
+
+        bucket_id = bucket.data[N_BUCKET_SLOT - 1] as usize;
     }
 }
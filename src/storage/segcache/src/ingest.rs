@@ -0,0 +1,236 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Values which are written straight into the segment which holds them.
+//!
+//! A value which arrives over the network would otherwise be received in full
+//! into a buffer before it is copied into a segment. Instead, the item can be
+//! reserved as soon as the length of its value is known, and the value is then
+//! written into the reserved space as it arrives. The item is linked into the
+//! hashtable once it is committed, until which it is not visible to readers.
+//!
+//! The segment which holds the item is pinned until the item is committed or
+//! aborted, so that it is neither evicted, merged, nor reused meanwhile. It may
+//! still expire or be cleared, in which case the item is lost and the commit
+//! fails. Values are stored as they are written, so they are not compressed,
+//! and keys are not checked against an admission filter. A cache configured
+//! with either does not take values this way.
+
+use crate::segcache::RESERVE_RETRIES;
+use crate::*;
+use core::ptr::NonNull;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+/// An item which has been reserved for a value that is yet to be written. It
+/// should be passed back to [`Segcache::commit`] once the value has been
+/// written, or to [`Segcache::abort`] otherwise. An `Ingest` which is dropped
+/// instead leaves its space in the segment allocated until the segment is
+/// evicted or expires.
+pub struct Ingest {
+    reserved: ReservedItem,
+    len: usize,
+    create_at: Instant,
+    refcount: NonNull<AtomicU32>,
+}
+
+// SAFETY: the reserved item lives in a segment which is pinned by the refcount
+// and which is not reused while pinned. The item is not linked into the
+// hashtable, so its value is only accessed through this `Ingest`. If the
+// segments are dropped while pinned, the memory is leaked rather than freed.
+unsafe impl Send for Ingest {}
+
+impl Ingest {
+    /// Returns the memory for the value, which is to be written in full before
+    /// the item is committed.
+    pub fn value_mut(&mut self) -> &mut [u8] {
+        let mut item = self.reserved.item();
+        // SAFETY: the segment is pinned and the value was allocated with the
+        // item, see above
+        unsafe { std::slice::from_raw_parts_mut(item.value_ptr(), self.len) }
+    }
+
+    /// Returns the length of the value.
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Returns true if the value is empty.
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+}
+
+impl Drop for Ingest {
+    fn drop(&mut self) {
+        // SAFETY: see above, the refcount outlives the pin
+        unsafe { self.refcount.as_ref() }.fetch_sub(1, Ordering::Release);
+    }
+}
+
+impl Segcache {
+    /// Reserves an item for a value of `len` bytes, which is written through
+    /// the returned [`Ingest`] and stored by [`Segcache::commit`]. Returns
+    /// `NotIngestible` if the cache compresses values or has an admission
+    /// filter, and `ItemOversized` if the item does not fit a segment, in
+    /// which case the value should be stored with [`Segcache::insert`].
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// let mut ingest = cache
+    ///     .ingest(b"coffee", 6, None, Duration::ZERO)
+    ///     .expect("failed to reserve");
+    /// ingest.value_mut().copy_from_slice(b"strong");
+    ///
+    /// // the item is only visible once it is committed
+    /// assert!(cache.get(b"coffee").is_none());
+    /// cache.commit(ingest).expect("failed to commit");
+    ///
+    /// let item = cache.get(b"coffee").expect("didn't get item back");
+    /// assert_eq!(item.value(), b"strong");
+    /// ```
+    pub fn ingest(
+        &mut self,
+        key: &[u8],
+        len: usize,
+        optional: Option<&[u8]>,
+        ttl: std::time::Duration,
+    ) -> Result<Ingest, SegcacheError> {
+        #[cfg(feature = "compression")]
+        if self.compressor.is_some() {
+            return Err(SegcacheError::NotIngestible);
+        }
+        if self.admission.is_some() {
+            return Err(SegcacheError::NotIngestible);
+        }
+
+        let optional = optional.unwrap_or(&[]);
+
+        let stamp = self.namespaces.stamp();
+        let stamp_size = if stamp.is_some() { STAMP_SIZE } else { 0 };
+        let size =
+            (((ITEM_HDR_SIZE + key_size(key) + len + optional.len() + stamp_size) >> 3) + 1) << 3;
+
+        // the length of a value is held in 24 bits
+        if len >> 24 != 0 {
+            return Err(SegcacheError::ItemOversized { size });
+        }
+
+        if let Some(mrc) = &mut self.mrc {
+            mrc.access(key, Some(size), false);
+        }
+
+        let ttl = Duration::from_secs(std::cmp::min(u32::MAX as u64, ttl.as_secs()) as u32);
+
+        let mut retries = RESERVE_RETRIES;
+        let mut reserved = loop {
+            match self.ttl_buckets.reserve(ttl, size, &mut self.segments) {
+                Ok(reserved) => break reserved,
+                Err(TtlBucketsError::ItemOversized { size }) => {
+                    return Err(SegcacheError::ItemOversized { size });
+                }
+                Err(TtlBucketsError::NoFreeSegments) => {
+                    if self
+                        .segments
+                        .evict(&mut self.ttl_buckets, &mut self.hashtable)
+                        .is_ok()
+                    {
+                        continue;
+                    }
+                }
+            }
+            if retries == 0 {
+                #[cfg(feature = "metrics")]
+                {
+                    SEGMENT_REQUEST.increment();
+                    SEGMENT_REQUEST_FAILURE.increment();
+                }
+
+                return Err(SegcacheError::NoFreeSegments);
+            }
+            retries -= 1;
+        };
+
+        reserved.define_uninit(key, len, optional, stamp);
+
+        let create_at = self
+            .segments
+            .get_mut(reserved.seg())
+            .map(|segment| segment.create_at())
+            .map_err(|_| SegcacheError::NoFreeSegments)?;
+        let refcount = NonNull::from(self.segments.pin_segment(reserved.seg()));
+
+        Ok(Ingest {
+            reserved,
+            len,
+            create_at,
+            refcount,
+        })
+    }
+
+    /// Links an item whose value was written through the [`Ingest`] into the
+    /// hashtable, replacing any item with the same key. Returns `Expired` if
+    /// the segment which holds the item expired or was cleared meanwhile.
+    pub fn commit(&mut self, ingest: Ingest) -> Result<(), SegcacheError> {
+        if !self.is_held(&ingest) {
+            return Err(SegcacheError::Expired);
+        }
+
+        let reserved = &ingest.reserved;
+        let item = reserved.item();
+
+        // a new value for the key replaces any deadline set by a touch, and
+        // ends the lease to recompute it
+        let key = item.key();
+        self.touched.remove(&key);
+        self.release(&key);
+
+        if self
+            .hashtable
+            .insert(
+                item,
+                reserved.seg(),
+                reserved.offset() as u64,
+                &mut self.ttl_buckets,
+                &mut self.segments,
+            )
+            .is_err()
+        {
+            let _ = self.segments.remove_at(
+                reserved.seg(),
+                reserved.offset(),
+                &mut self.ttl_buckets,
+                &mut self.hashtable,
+            );
+            Err(SegcacheError::HashTableInsertEx)
+        } else {
+            self.access.inserts += 1;
+            Ok(())
+        }
+    }
+
+    /// Releases the item reserved by the [`Ingest`] without storing it.
+    pub fn abort(&mut self, ingest: Ingest) {
+        if self.is_held(&ingest) {
+            let _ = self.segments.remove_at(
+                ingest.reserved.seg(),
+                ingest.reserved.offset(),
+                &mut self.ttl_buckets,
+                &mut self.hashtable,
+            );
+        }
+    }
+
+    /// Returns true if the segment the item was reserved in still holds it,
+    /// rather than having expired or been cleared since.
+    fn is_held(&mut self, ingest: &Ingest) -> bool {
+        self.segments
+            .get_mut(ingest.reserved.seg())
+            .map(|segment| segment.accessible() && segment.create_at() == ingest.create_at)
+            .unwrap_or(false)
+    }
+}
@@ -18,20 +18,27 @@
 //!
 //! Flags:
 //! ```text
-//! ┌──────────────┬──────────────┬──────────────────────────────┐
-//! │    TYPED?    │   PADDING    │             OLEN             │
-//! │              │              │                              │
-//! │    1 bit     │    1 bit     │            6 bit             │
-//! │              │              │                              │
-//! │      64      │      65      │  66                      71  │
-//! └──────────────┴──────────────┴──────────────────────────────┘
+//! ┌──────────────┬──────────────┬──────────────┬───────────────────────┐
+//! │    TYPED?    │ COMPRESSED?  │   STAMPED?   │         OLEN          │
+//! │              │              │              │                       │
+//! │    1 bit     │    1 bit     │    1 bit     │         5 bit         │
+//! │              │              │              │                       │
+//! │      64      │      65      │      66      │  67               71  │
+//! └──────────────┴──────────────┴──────────────┴───────────────────────┘
 //! ```
+//!
+//! A stamped item holds the namespace generation it was written in, which
+//! follows the optional data. With the `key-prefixes` feature, every item holds
+//! a prefix id ahead of its key, see the prefix module.
 
 // item constants
 
 /// The size of the item header in bytes
 pub const ITEM_HDR_SIZE: usize = std::mem::size_of::<crate::item::ItemHeader>();
 
+/// The size of the namespace generation held by stamped items in bytes
+pub const STAMP_SIZE: usize = std::mem::size_of::<u32>();
+
 #[cfg(feature = "magic")]
 /// The magic bytes to store at the start of the item
 pub const ITEM_MAGIC: u32 = 0xDECAFBAD;
@@ -62,22 +69,34 @@ const TYPE_SHIFT: u32 = 24;
 // olen/del/typed
 /// A mask to get the optional data length in bytes from the item header's flags
 /// field
-const OLEN_MASK: u8 = 0b00111111;
+const OLEN_MASK: u8 = 0b00011111;
 /// A mask to get the bit indicating the item value should be treated as a
 /// typed value from the item header's flags field
 const TYPED_MASK: u8 = 0b10000000;
+/// A mask to get the bit indicating the item value is stored compressed from
+/// the item header's flags field
+const COMPRESSED_MASK: u8 = 0b01000000;
+/// A mask to get the bit indicating the item holds a namespace generation
+/// from the item header's flags field
+const STAMPED_MASK: u8 = 0b00100000;
 
 use core::convert::TryFrom;
 
-#[derive(Copy, Clone, Debug)]
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
 pub(super) enum ValueType {
     U64,
+    /// The manifest of a large value which is stored as a series of chunks
+    Large,
+    /// One of the chunks of a large value
+    Chunk,
 }
 
 impl ValueType {
     pub fn len(&self) -> u32 {
         (match self {
             Self::U64 => std::mem::size_of::<u64>(),
+            // the length of byte values is set along with the value
+            Self::Large | Self::Chunk => 0,
         }) as u32
     }
 }
@@ -87,6 +106,8 @@ impl TryFrom<u8> for ValueType {
     fn try_from(other: u8) -> Result<Self, <Self as TryFrom<u8>>::Error> {
         match other {
             0 => Ok(Self::U64),
+            1 => Ok(Self::Large),
+            2 => Ok(Self::Chunk),
             _ => Err(()),
         }
     }
@@ -97,6 +118,8 @@ impl Into<u8> for ValueType {
     fn into(self) -> u8 {
         match self {
             Self::U64 => 0,
+            Self::Large => 1,
+            Self::Chunk => 2,
         }
     }
 }
@@ -112,7 +135,7 @@ pub struct ItemHeader {
     #[cfg(feature = "magic")]
     magic: u32,
     len: u32,  // packs vlen:24 klen:8
-    flags: u8, // packs is_num:1, deleted:1, olen:6
+    flags: u8, // packs typed:1, compressed:1, stamped:1, olen:5
 }
 
 impl ItemHeader {
@@ -165,6 +188,18 @@ impl ItemHeader {
         self.flags & TYPED_MASK != 0
     }
 
+    /// Is the item value stored compressed?
+    #[inline]
+    pub fn is_compressed(&self) -> bool {
+        self.flags & COMPRESSED_MASK != 0
+    }
+
+    /// Does the item hold the namespace generation it was written in?
+    #[inline]
+    pub fn is_stamped(&self) -> bool {
+        self.flags & STAMPED_MASK != 0
+    }
+
     pub(super) fn value_type(&self) -> Option<ValueType> {
         if self.is_typed() {
             if let Ok(t) = ValueType::try_from((self.len >> TYPE_SHIFT) as u8) {
@@ -187,6 +222,16 @@ impl ItemHeader {
         }
     }
 
+    /// Marks an item which was defined with a byte value as a typed value of
+    /// the provided type, keeping the value length. Since the type takes the
+    /// upper byte of the length field, the value length must fit in 16 bits.
+    pub(super) fn retype(&mut self, value_type: ValueType) {
+        debug_assert!(self.vlen() <= u16::MAX as u32);
+        self.set_typed(true);
+        let value_type: u8 = value_type.into();
+        self.len = (self.len & !TYPE_MASK) | ((value_type as u32) << TYPE_SHIFT);
+    }
+
     /// Set the key length by changing just the low byte
     #[inline]
     pub fn set_klen(&mut self, len: u8) {
@@ -213,6 +258,23 @@ impl ItemHeader {
         }
     }
 
+    /// Mark the item value as compressed
+    #[cfg(feature = "compression")]
+    #[inline]
+    pub fn set_compressed(&mut self, compressed: bool) {
+        if compressed {
+            self.flags |= COMPRESSED_MASK;
+        } else {
+            self.flags &= !COMPRESSED_MASK;
+        }
+    }
+
+    /// Mark the item as holding a namespace generation
+    #[inline]
+    pub fn set_stamped(&mut self) {
+        self.flags |= STAMPED_MASK;
+    }
+
     pub fn init(&mut self) {
         #[cfg(feature = "magic")]
         self.set_magic();
@@ -236,6 +298,8 @@ impl std::fmt::Debug for ItemHeader {
             .field("klen", &self.klen())
             .field("vlen", &self.vlen())
             .field("type", &self.value_type())
+            .field("compressed", &self.is_compressed())
+            .field("stamped", &self.is_stamped())
             .field("olen", &self.olen())
             .finish()
     }
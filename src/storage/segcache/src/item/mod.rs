@@ -5,16 +5,20 @@
 //! Items are the base unit of data stored within the cache.
 
 mod header;
+mod pinned;
 mod raw;
 mod reserved;
 
 #[cfg(any(feature = "magic", feature = "debug"))]
 pub(crate) use header::ITEM_MAGIC_SIZE;
 
+use crate::hashtable::Inline;
 use crate::SegcacheError;
 use crate::Value;
+use std::sync::Arc;
 
-pub(crate) use header::{ItemHeader, ITEM_HDR_SIZE};
+pub(crate) use header::{ItemHeader, ITEM_HDR_SIZE, STAMP_SIZE};
+pub use pinned::PinnedItem;
 pub(crate) use raw::RawItem;
 pub(crate) use reserved::ReservedItem;
 
@@ -22,12 +26,85 @@ pub(crate) use reserved::ReservedItem;
 pub struct Item {
     cas: u32,
     raw: RawItem,
+    // the value of a large item, which is assembled from its chunks as it is
+    // read
+    large: Option<Arc<[u8]>>,
+    // the copy of a small item held beside its slot in the hashtable, which
+    // the key, value and optional data are read from in place of the segment
+    inline: Option<Inline>,
+    // the value of a compressed item, which is decompressed on first access
+    #[cfg(feature = "compression")]
+    decompressed: core::cell::OnceCell<Box<[u8]>>,
+    // the key of an item which holds a prefix id, which is reassembled from
+    // the prefix and the rest of the key
+    #[cfg(feature = "key-prefixes")]
+    key: Option<Box<[u8]>>,
 }
 
 impl Item {
     /// Creates a new `Item` from its parts
     pub(crate) fn new(raw: RawItem, cas: u32) -> Self {
-        Item { cas, raw }
+        Item {
+            #[cfg(feature = "key-prefixes")]
+            key: match raw.key() {
+                std::borrow::Cow::Owned(key) => Some(key.into_boxed_slice()),
+                std::borrow::Cow::Borrowed(_) => None,
+            },
+            ..Self::parts(raw, cas, None)
+        }
+    }
+
+    /// Creates a new `Item` which is read from a copy of the item held by the
+    /// hashtable
+    pub(crate) fn with_inline(raw: RawItem, cas: u32, inline: Inline) -> Self {
+        Self::parts(raw, cas, Some(inline))
+    }
+
+    /// Creates a new `Item` from its parts, with the key read as it is held
+    fn parts(raw: RawItem, cas: u32, inline: Option<Inline>) -> Self {
+        Item {
+            cas,
+            raw,
+            large: None,
+            inline,
+            #[cfg(feature = "compression")]
+            decompressed: core::cell::OnceCell::new(),
+            #[cfg(feature = "key-prefixes")]
+            key: None,
+        }
+    }
+
+    /// Returns true if the item is read from a copy held by the hashtable
+    /// rather than from its segment
+    pub(crate) fn is_inline(&self) -> bool {
+        self.inline.is_some()
+    }
+
+    /// Returns the underlying `RawItem`
+    pub(crate) fn raw(&self) -> RawItem {
+        self.raw
+    }
+
+    /// Sets the value of a large item, which was assembled from its chunks
+    pub(crate) fn set_large(&mut self, value: Arc<[u8]>) {
+        self.large = Some(value);
+    }
+
+    /// Returns the assembled value of a large item
+    pub(crate) fn large(&self) -> Option<&Arc<[u8]>> {
+        self.large.as_ref()
+    }
+
+    /// Borrow the value as it is stored, which is compressed for compressed
+    /// items
+    fn stored(&self) -> Value {
+        if let Some(inline) = &self.inline {
+            return inline.value();
+        }
+        match &self.large {
+            Some(value) => Value::Bytes(value),
+            None => self.raw.value(),
+        }
     }
 
     /// If the `magic` or `debug` features are enabled, this allows for checking
@@ -43,12 +120,41 @@ impl Item {
 
     /// Borrow the item key
     pub fn key(&self) -> &[u8] {
-        self.raw.key()
+        #[cfg(feature = "key-prefixes")]
+        if let Some(key) = &self.key {
+            return key;
+        }
+        match &self.inline {
+            Some(inline) => inline.key(),
+            None => match self.raw.key() {
+                std::borrow::Cow::Borrowed(key) => key,
+                // only items which hold a prefix id are reassembled, and
+                // their key is kept by the item
+                std::borrow::Cow::Owned(_) => unreachable!(),
+            },
+        }
     }
 
-    /// Borrow the item value
+    /// Borrow the item value. If the value is stored compressed, it is
+    /// decompressed on the first call and the result is reused by later calls.
     pub fn value(&self) -> Value {
-        self.raw.value()
+        #[cfg(feature = "compression")]
+        if self.is_compressed() {
+            let value = self.decompressed.get_or_init(|| match self.stored() {
+                Value::Bytes(compressed) => crate::decompress(compressed),
+                Value::U64(_) => unreachable!("numeric values are never compressed"),
+            });
+            return Value::Bytes(value);
+        }
+
+        self.stored()
+    }
+
+    /// Returns true if the value is stored compressed, in which case `value()`
+    /// returns a decompressed copy rather than borrowing the segment memory.
+    pub fn is_compressed(&self) -> bool {
+        // copies are only made of items which are not compressed
+        self.inline.is_none() && self.raw.is_compressed()
     }
 
     /// CAS value for the item
@@ -58,18 +164,30 @@ impl Item {
 
     /// Borrow the optional data
     pub fn optional(&self) -> Option<&[u8]> {
-        self.raw.optional()
+        match &self.inline {
+            Some(inline) => inline.optional(),
+            None => self.raw.optional(),
+        }
+    }
+
+    /// Overwrite part of the value in place. Returns an error if the value is
+    /// numeric or compressed, or if the bytes do not fit within the value.
+    pub(crate) fn overwrite(&mut self, offset: usize, bytes: &[u8]) -> Result<(), SegcacheError> {
+        self.inline = None;
+        self.raw.overwrite(offset, bytes)
     }
 
     /// Perform a wrapping addition on the value. Returns an error if the item
     /// is not a numeric type.
     pub fn wrapping_add(&mut self, rhs: u64) -> Result<(), SegcacheError> {
+        self.inline = None;
         self.raw.wrapping_add(rhs)
     }
 
     /// Perform a saturating subtraction on the value. Returns an error if the
     /// item is not a numeric type.
     pub fn saturating_sub(&mut self, rhs: u64) -> Result<(), SegcacheError> {
+        self.inline = None;
         self.raw.saturating_sub(rhs)
     }
 }
@@ -83,6 +201,19 @@ impl std::fmt::Debug for Item {
     }
 }
 
+/// Returns the number of bytes which the key takes in an item
+#[inline]
+pub(crate) fn key_size(key: &[u8]) -> usize {
+    #[cfg(feature = "key-prefixes")]
+    {
+        crate::prefix::stored_len(key)
+    }
+    #[cfg(not(feature = "key-prefixes"))]
+    {
+        key.len()
+    }
+}
+
 pub fn size_of(value: &Value) -> usize {
     match value {
         Value::Bytes(v) => v.len(),
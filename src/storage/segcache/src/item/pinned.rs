@@ -0,0 +1,73 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! An item which holds a read reference on its segment.
+
+use crate::item::*;
+use core::ops::Deref;
+use core::ptr::NonNull;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+/// An [`Item`] which holds a read reference on the segment which contains it,
+/// similar to `seg_r_ref` in the C implementation. While the reference is
+/// held, the segment data is not moved by merging and the segment is not
+/// reused, so the item can be read after the cache has been borrowed again
+/// or from another thread. The item may still be removed from the cache, in
+/// which case this continues to refer to the removed value.
+///
+/// References should be short-lived, such as for the duration of writing a
+/// response, as pinned segments cannot be reclaimed by eviction.
+pub struct PinnedItem {
+    item: Item,
+    refcount: NonNull<AtomicU32>,
+}
+
+// SAFETY: the item data and the refcount live in the segments of the cache.
+// The data is not mutated while the segment is pinned and the refcount is only
+// accessed atomically. If the segments are dropped while pinned, the memory is
+// leaked rather than freed.
+unsafe impl Send for PinnedItem {}
+
+// SAFETY: as above, a shared reference only permits reads of the item data
+// which is not mutated while pinned.
+unsafe impl Sync for PinnedItem {}
+
+impl PinnedItem {
+    /// Creates a new `PinnedItem` from an item and the refcount of its segment
+    /// which has already been incremented.
+    pub(crate) fn new(item: Item, refcount: &AtomicU32) -> Self {
+        Self {
+            item,
+            refcount: NonNull::from(refcount),
+        }
+    }
+
+    /// Carries over the assembled value of a large item
+    pub(crate) fn set_large(&mut self, value: std::sync::Arc<[u8]>) {
+        self.item.set_large(value);
+    }
+}
+
+impl Deref for PinnedItem {
+    type Target = Item;
+
+    fn deref(&self) -> &Item {
+        &self.item
+    }
+}
+
+impl Drop for PinnedItem {
+    fn drop(&mut self) {
+        // SAFETY: see above, the refcount outlives the pin
+        unsafe { self.refcount.as_ref() }.fetch_sub(1, Ordering::Release);
+    }
+}
+
+impl std::fmt::Debug for PinnedItem {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        f.debug_struct("PinnedItem")
+            .field("item", &self.item)
+            .finish()
+    }
+}
@@ -11,6 +11,7 @@ use super::header::ValueType;
 use crate::item::*;
 use crate::SegcacheError;
 use crate::Value;
+use std::borrow::Cow;
 
 /// The raw byte-level representation of an item
 #[repr(C)]
@@ -42,14 +43,55 @@ impl RawItem {
         Self { data: ptr }
     }
 
+    /// Returns a pointer to the start of the item
+    pub(crate) fn as_ptr(&self) -> *const u8 {
+        self.data
+    }
+
     /// Returns the key length
     #[inline]
     pub(crate) fn klen(&self) -> u8 {
         self.header().klen()
     }
 
-    /// Borrow the key
-    pub(crate) fn key(&self) -> &[u8] {
+    /// Returns the key. With the `key-prefixes` feature, the key of an item
+    /// which holds a prefix id is reassembled into a new buffer.
+    pub(crate) fn key(&self) -> Cow<'_, [u8]> {
+        let prefix = self.prefix();
+        if prefix.is_empty() {
+            Cow::Borrowed(self.suffix())
+        } else {
+            Cow::Owned([prefix, self.suffix()].concat())
+        }
+    }
+
+    /// Returns true if the item has the provided key, which is compared in
+    /// parts so that no buffer is needed for a key with a prefix
+    #[inline]
+    pub(crate) fn key_eq(&self, key: &[u8]) -> bool {
+        let prefix = self.prefix();
+        let suffix = self.suffix();
+        key.len() == prefix.len() + suffix.len()
+            && key.starts_with(prefix)
+            && &key[prefix.len()..] == suffix
+    }
+
+    /// Returns the shared prefix of the key, which is empty unless the item
+    /// holds a prefix id
+    #[inline]
+    fn prefix(&self) -> &'static [u8] {
+        #[cfg(feature = "key-prefixes")]
+        {
+            crate::prefix::get(unsafe { *self.data.add(self.prefix_offset()) })
+        }
+        #[cfg(not(feature = "key-prefixes"))]
+        {
+            &[]
+        }
+    }
+
+    /// Borrow the key as it is stored, which follows any shared prefix
+    fn suffix(&self) -> &[u8] {
         unsafe {
             let ptr = self.data.add(self.key_offset());
             let len = self.klen() as usize;
@@ -78,7 +120,51 @@ impl RawItem {
             Some(ValueType::U64) => Value::U64(u64::from_be_bytes([
                 bytes[0], bytes[1], bytes[2], bytes[3], bytes[4], bytes[5], bytes[6], bytes[7],
             ])),
-            None => Value::Bytes(bytes),
+            Some(ValueType::Large) | Some(ValueType::Chunk) | None => Value::Bytes(bytes),
+        }
+    }
+
+    /// Returns true if the item is the manifest of a large value, whose value
+    /// is held in chunks
+    #[inline]
+    pub(crate) fn is_large(&self) -> bool {
+        self.header().value_type() == Some(ValueType::Large)
+    }
+
+    /// Returns true if the item is one of the chunks of a large value
+    #[inline]
+    pub(crate) fn is_chunk(&self) -> bool {
+        self.header().value_type() == Some(ValueType::Chunk)
+    }
+
+    /// Marks the item as the manifest of a large value, this must be called
+    /// after the item is defined
+    pub(crate) fn set_large(&mut self) {
+        unsafe {
+            (*self.header_mut()).retype(ValueType::Large);
+        }
+    }
+
+    /// Marks the item as a chunk of a large value, this must be called after
+    /// the item is defined
+    pub(crate) fn set_chunk(&mut self) {
+        unsafe {
+            (*self.header_mut()).retype(ValueType::Chunk);
+        }
+    }
+
+    /// Returns true if the value is stored compressed
+    #[inline]
+    pub(crate) fn is_compressed(&self) -> bool {
+        self.header().is_compressed()
+    }
+
+    /// Marks the value as being stored compressed, this must be called after
+    /// the item is defined
+    #[cfg(feature = "compression")]
+    pub(crate) fn set_compressed(&mut self) {
+        unsafe {
+            (*self.header_mut()).set_compressed(true);
         }
     }
 
@@ -101,21 +187,78 @@ impl RawItem {
         }
     }
 
+    /// Returns the namespace generation the item was written in, if it holds
+    /// one
+    #[inline]
+    pub(crate) fn stamp(&self) -> Option<u32> {
+        if !self.header().is_stamped() {
+            return None;
+        }
+        let mut bytes = [0; STAMP_SIZE];
+        unsafe {
+            std::ptr::copy_nonoverlapping(
+                self.data.add(self.stamp_offset()),
+                bytes.as_mut_ptr(),
+                STAMP_SIZE,
+            );
+        }
+        Some(u32::from_be_bytes(bytes))
+    }
+
+    /// Returns the length of the namespace generation held by the item
+    #[inline]
+    fn slen(&self) -> usize {
+        if self.header().is_stamped() {
+            STAMP_SIZE
+        } else {
+            0
+        }
+    }
+
+    /// Returns the length of the prefix id held by the item
+    #[inline]
+    fn plen(&self) -> usize {
+        #[cfg(feature = "key-prefixes")]
+        {
+            crate::prefix::PREFIX_ID_SIZE
+        }
+        #[cfg(not(feature = "key-prefixes"))]
+        {
+            0
+        }
+    }
+
     /// Check the header magic bytes
     #[inline]
     pub(crate) fn check_magic(&self) {
         self.header().check_magic()
     }
 
-    /// Copy data into the item
-    pub(crate) fn define(&mut self, key: &[u8], value: Value, optional: &[u8]) {
+    /// Copy data into the item, along with the namespace generation it is
+    /// written in if one is provided. With the `key-prefixes` feature, the key
+    /// is held as the id of its longest registered prefix and the rest of it.
+    pub(crate) fn define(&mut self, key: &[u8], value: Value, optional: &[u8], stamp: Option<u32>) {
+        #[cfg(feature = "key-prefixes")]
+        let (id, key) = crate::prefix::split(key);
         unsafe {
             (*self.header_mut()).init();
+            (*self.header_mut()).set_olen(optional.len() as u8);
+            if let Some(stamp) = stamp {
+                (*self.header_mut()).set_stamped();
+                std::ptr::copy_nonoverlapping(
+                    stamp.to_be_bytes().as_ptr(),
+                    self.data.add(self.stamp_offset()),
+                    STAMP_SIZE,
+                );
+            }
+            #[cfg(feature = "key-prefixes")]
+            {
+                *self.data.add(self.prefix_offset()) = id;
+            }
         }
         match value {
             Value::Bytes(value) => unsafe {
                 (*self.header_mut()).set_type(None);
-                (*self.header_mut()).set_olen(optional.len() as u8);
                 std::ptr::copy_nonoverlapping(
                     optional.as_ptr(),
                     self.data.add(self.optional_offset()),
@@ -136,7 +279,6 @@ impl RawItem {
             },
             Value::U64(value) => unsafe {
                 (*self.header_mut()).set_type(Some(ValueType::U64));
-                (*self.header_mut()).set_olen(optional.len() as u8);
                 std::ptr::copy_nonoverlapping(
                     optional.as_ptr(),
                     self.data.add(self.optional_offset()),
@@ -158,16 +300,49 @@ impl RawItem {
         }
     }
 
+    /// Copy the key and optional data into the item, along with the namespace
+    /// generation it is written in if one is provided, and set the length of
+    /// its value. The value itself is left to be written in place.
+    pub(crate) fn define_uninit(
+        &mut self,
+        key: &[u8],
+        vlen: usize,
+        optional: &[u8],
+        stamp: Option<u32>,
+    ) {
+        self.define(key, Value::Bytes(&[]), optional, stamp);
+        unsafe {
+            (*self.header_mut()).set_vlen(vlen as u32);
+        }
+    }
+
+    /// Returns a pointer to the start of the value
+    pub(crate) fn value_ptr(&mut self) -> *mut u8 {
+        unsafe { self.data.add(self.value_offset()) }
+    }
+
     // Gets the offset to the optional data
     #[inline]
     fn optional_offset(&self) -> usize {
         ITEM_HDR_SIZE
     }
 
+    // Gets the offset to the namespace generation
+    #[inline]
+    fn stamp_offset(&self) -> usize {
+        self.optional_offset() + self.olen() as usize
+    }
+
+    // Gets the offset to the prefix id
+    #[inline]
+    fn prefix_offset(&self) -> usize {
+        self.stamp_offset() + self.slen()
+    }
+
     // Gets the offset to the key
     #[inline]
     fn key_offset(&self) -> usize {
-        self.optional_offset() + self.olen() as usize
+        self.prefix_offset() + self.plen()
     }
 
     // Gets the offset to the value
@@ -178,12 +353,93 @@ impl RawItem {
 
     /// Returns item size, rounded up for alignment
     pub(crate) fn size(&self) -> usize {
-        (((ITEM_HDR_SIZE + self.olen() as usize + self.klen() as usize + self.vlen() as usize)
+        (((ITEM_HDR_SIZE
+            + self.olen() as usize
+            + self.slen()
+            + self.plen()
+            + self.klen() as usize
+            + self.vlen() as usize)
+            >> 3)
+            + 1)
+            << 3
+    }
+
+    /// Returns the item size, rounded up for alignment, once the value has
+    /// grown by some number of bytes
+    pub(crate) fn size_with(&self, bytes: usize) -> usize {
+        (((ITEM_HDR_SIZE
+            + self.olen() as usize
+            + self.slen()
+            + self.plen()
+            + self.klen() as usize
+            + self.vlen() as usize
+            + bytes)
             >> 3)
             + 1)
             << 3
     }
 
+    /// Returns true if the value may be extended in place by some number of
+    /// bytes, which requires it to be plain bytes, rather than numeric,
+    /// compressed, or part of a large value, and the longer value to fit the
+    /// 24 bit value length.
+    pub(crate) fn is_extensible(&self, bytes: usize) -> bool {
+        self.header().value_type().is_none()
+            && !self.is_compressed()
+            && (self.vlen() as usize + bytes) >> 24 == 0
+    }
+
+    /// Extends a byte value in place by appending the bytes, or by prepending
+    /// them if `front` is set.
+    ///
+    /// # Safety
+    ///
+    /// The segment must have room reserved for the larger item, which is done
+    /// by `Segments::grow`.
+    pub(crate) unsafe fn extend(&mut self, bytes: &[u8], front: bool) {
+        let vlen = self.vlen() as usize;
+        let value = self.data.add(self.value_offset());
+        if front {
+            std::ptr::copy(value, value.add(bytes.len()), vlen);
+            std::ptr::copy_nonoverlapping(bytes.as_ptr(), value, bytes.len());
+        } else {
+            std::ptr::copy_nonoverlapping(bytes.as_ptr(), value.add(vlen), bytes.len());
+        }
+        (*self.header_mut()).set_vlen((vlen + bytes.len()) as u32);
+    }
+
+    /// Overwrites part of a byte value in place. Returns an error if the value
+    /// is numeric or compressed, or if the bytes do not fit within the value.
+    pub(crate) fn overwrite(&mut self, offset: usize, bytes: &[u8]) -> Result<(), SegcacheError> {
+        if self.header().value_type().is_some() || self.is_compressed() {
+            return Err(SegcacheError::NotWritable);
+        }
+        match offset.checked_add(bytes.len()) {
+            Some(end) if end <= self.vlen() as usize => unsafe {
+                std::ptr::copy_nonoverlapping(
+                    bytes.as_ptr(),
+                    self.data.add(self.value_offset() + offset),
+                    bytes.len(),
+                );
+                Ok(())
+            },
+            _ => Err(SegcacheError::NotWritable),
+        }
+    }
+
+    /// Writes a new numeric value in place. The item must hold a numeric
+    /// value, as its length is not changed.
+    pub(crate) fn set_u64(&mut self, value: u64) {
+        debug_assert!(matches!(self.value(), Value::U64(_)));
+        unsafe {
+            std::ptr::copy_nonoverlapping(
+                value.to_be_bytes().as_ptr(),
+                self.data.add(self.value_offset()),
+                core::mem::size_of::<u64>(),
+            );
+        }
+    }
+
     pub(crate) fn wrapping_add(&mut self, rhs: u64) -> Result<(), SegcacheError> {
         match self.value() {
             Value::U64(v) => unsafe {
@@ -24,9 +24,34 @@ impl ReservedItem {
         Self { item, seg, offset }
     }
 
-    /// Store the key, value, and optional data into the item
-    pub fn define(&mut self, key: &[u8], value: Value, optional: &[u8]) {
-        self.item.define(key, value, optional)
+    /// Store the key, value, and optional data into the item, along with the
+    /// namespace generation it is written in if one is provided
+    pub fn define(&mut self, key: &[u8], value: Value, optional: &[u8], stamp: Option<u32>) {
+        self.item.define(key, value, optional, stamp)
+    }
+
+    /// Store the key and optional data into the item, along with the
+    /// namespace generation it is written in if one is provided, leaving room
+    /// for a value of `vlen` bytes which is written in place
+    pub fn define_uninit(&mut self, key: &[u8], vlen: usize, optional: &[u8], stamp: Option<u32>) {
+        self.item.define_uninit(key, vlen, optional, stamp)
+    }
+
+    /// Mark the value which was stored by `define` as compressed
+    #[cfg(feature = "compression")]
+    pub fn set_compressed(&mut self) {
+        self.item.set_compressed()
+    }
+
+    /// Mark the item which was stored by `define` as the manifest of a large
+    /// value
+    pub fn set_large(&mut self) {
+        self.item.set_large()
+    }
+
+    /// Mark the item which was stored by `define` as a chunk of a large value
+    pub fn set_chunk(&mut self) {
+        self.item.set_chunk()
     }
 
     /// Get the `RawItem` that backs the `ReservedItem`
@@ -0,0 +1,355 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Storage of values which are too large to fit within a segment, so that the
+//! segment size can be chosen for the common small items rather than the rare
+//! large ones.
+//!
+//! A large value is split into chunks which are each stored as an item of
+//! their own, under a key made from an id for the value and the index of the
+//! chunk. The item for the key of the value holds a manifest of the id, the
+//! length of the value, and the number of chunks. Items are marked as a
+//! manifest or a chunk by their value type, so chunks are never returned by
+//! key, and the manifest is replaced by the assembled value when it is read.
+//!
+//! The chunks and the manifest are stored with the same ttl and are evicted
+//! like any other item. If any chunk has been evicted, the value is treated as
+//! missing and whatever remains of it is removed. Chunks of a value which is
+//! replaced by a small value are left to be evicted or expired.
+
+use crate::*;
+use std::sync::Arc;
+
+// chunks are typed items, which limits them to a 16 bit value length
+const CHUNK_MAX: usize = u16::MAX as usize;
+
+// the key of a chunk is a marker byte, the id of the value, and the index of
+// the chunk. The marker keeps chunk keys out of the way of text protocol keys.
+const CHUNK_KEY_LEN: usize = 1 + 8 + 4;
+const CHUNK_KEY_MARKER: u8 = 0;
+
+// the manifest is the id of the value, its length, and the number of chunks
+const MANIFEST_LEN: usize = 8 + 8 + 4;
+
+struct Manifest {
+    id: u64,
+    len: usize,
+    chunks: u32,
+}
+
+impl Manifest {
+    fn parse(value: Value) -> Option<Self> {
+        match value {
+            Value::Bytes(v) if v.len() == MANIFEST_LEN => Some(Self {
+                id: u64::from_be_bytes(v[0..8].try_into().unwrap()),
+                len: u64::from_be_bytes(v[8..16].try_into().unwrap()) as usize,
+                chunks: u32::from_be_bytes(v[16..20].try_into().unwrap()),
+            }),
+            _ => None,
+        }
+    }
+
+    fn compose(&self) -> [u8; MANIFEST_LEN] {
+        let mut manifest = [0; MANIFEST_LEN];
+        manifest[0..8].copy_from_slice(&self.id.to_be_bytes());
+        manifest[8..16].copy_from_slice(&(self.len as u64).to_be_bytes());
+        manifest[16..20].copy_from_slice(&self.chunks.to_be_bytes());
+        manifest
+    }
+
+    fn chunk_key(&self, index: u32) -> [u8; CHUNK_KEY_LEN] {
+        let mut key = [CHUNK_KEY_MARKER; CHUNK_KEY_LEN];
+        key[1..9].copy_from_slice(&self.id.to_be_bytes());
+        key[9..13].copy_from_slice(&index.to_be_bytes());
+        key
+    }
+}
+
+impl Segcache {
+    /// Returns the length of the chunks a large value is split into. Chunks
+    /// are kept to at most half of a segment, so that a chunk never wastes
+    /// more than half of the segment at the tail of its ttl bucket.
+    fn chunk_len(&self) -> usize {
+        let overhead = ITEM_HDR_SIZE + CHUNK_KEY_LEN + 16;
+        ((self.segments.segment_size() as usize / 2).saturating_sub(overhead) & !7).min(CHUNK_MAX)
+    }
+
+    /// Stores a value which does not fit in a segment as a series of chunks
+    /// followed by its manifest. Returns an error if the value is too large to
+    /// be held in the cache along with other items.
+    pub(crate) fn store_large(
+        &mut self,
+        key: &[u8],
+        value: &[u8],
+        optional: Option<&[u8]>,
+        ttl: std::time::Duration,
+        compressed: bool,
+    ) -> Result<(), SegcacheError> {
+        let chunk_len = self.chunk_len();
+        let capacity = self.segments.cap() as usize * self.segments.segment_size() as usize;
+        if chunk_len == 0 || value.len() > capacity / 2 {
+            return Err(SegcacheError::ItemOversized { size: value.len() });
+        }
+
+        self.large_id = self.large_id.wrapping_add(1);
+        let manifest = Manifest {
+            id: self.large_id,
+            len: value.len(),
+            chunks: value.len().div_ceil(chunk_len) as u32,
+        };
+
+        // the chunks of a large value the key held before are removed rather
+        // than being left to eviction
+        self.remove_large(key);
+
+        for (index, chunk) in value.chunks(chunk_len).enumerate() {
+            let chunk_key = manifest.chunk_key(index as u32);
+            if let Err(e) = self.store_as(
+                &chunk_key,
+                Value::Bytes(chunk),
+                None,
+                ttl,
+                false,
+                Layout::Chunk,
+            ) {
+                self.remove_chunks(&manifest, index as u32);
+                return Err(e);
+            }
+        }
+
+        let result = self.store_as(
+            key,
+            Value::Bytes(&manifest.compose()),
+            optional,
+            ttl,
+            compressed,
+            Layout::Large,
+        );
+
+        match result {
+            Ok(()) => {
+                #[cfg(feature = "metrics")]
+                {
+                    ITEM_LARGE_STORE.increment();
+                    ITEM_LARGE_CHUNK.add(manifest.chunks as _);
+                }
+            }
+            Err(_) => self.remove_chunks(&manifest, manifest.chunks),
+        }
+
+        result
+    }
+
+    /// Replaces the manifest of a large value with the value assembled from
+    /// its chunks, which are looked up with or without increasing their
+    /// frequency. Items which are not large are returned as they are, except
+    /// for chunks, which are not visible by key. Returns `None`, and removes
+    /// what remains of the value, if any of its chunks are missing.
+    pub(crate) fn assemble(&mut self, item: Item, incr: bool) -> Option<Item> {
+        // copies are only made of items which are neither large nor chunks
+        if item.is_inline() {
+            return Some(item);
+        }
+        let raw = item.raw();
+        if raw.is_chunk() {
+            return None;
+        }
+        if !raw.is_large() || item.large().is_some() {
+            return Some(item);
+        }
+
+        let manifest = Manifest::parse(raw.value())?;
+        let mut value = Vec::with_capacity(manifest.len);
+
+        for index in 0..manifest.chunks {
+            let chunk_key = manifest.chunk_key(index);
+            let chunk = if incr {
+                self.hashtable
+                    .get(&chunk_key, self.time, &mut self.segments)
+            } else {
+                self.hashtable
+                    .get_no_freq_incr(&chunk_key, &mut self.segments)
+            };
+
+            match chunk.map(|chunk| chunk.raw()) {
+                Some(chunk) if chunk.is_chunk() => {
+                    if let Value::Bytes(bytes) = chunk.value() {
+                        value.extend_from_slice(bytes);
+                    }
+                }
+                _ => break,
+            }
+        }
+
+        if value.len() != manifest.len {
+            #[cfg(feature = "metrics")]
+            ITEM_LARGE_MISSING.increment();
+
+            let key = raw.key().to_vec();
+            self.remove_large(&key);
+            self.hashtable
+                .delete(&key, &mut self.ttl_buckets, &mut self.segments);
+            return None;
+        }
+
+        let mut item = item;
+        item.set_large(Arc::from(value));
+        Some(item)
+    }
+
+    /// Removes the chunks of the large value held by the key, if it holds
+    /// one. The manifest itself is left in place.
+    pub(crate) fn remove_large(&mut self, key: &[u8]) {
+        let manifest = match self.hashtable.get_no_freq_incr(key, &mut self.segments) {
+            Some(item) if item.raw().is_large() => Manifest::parse(item.raw().value()),
+            _ => None,
+        };
+
+        if let Some(manifest) = manifest {
+            self.remove_chunks(&manifest, manifest.chunks);
+        }
+    }
+
+    /// Removes the first chunks of a large value
+    fn remove_chunks(&mut self, manifest: &Manifest, chunks: u32) {
+        for index in 0..chunks {
+            self.hashtable.delete(
+                &manifest.chunk_key(index),
+                &mut self.ttl_buckets,
+                &mut self.segments,
+            );
+        }
+    }
+}
+
+/// How the value of an item is laid out, which for values too large for a
+/// segment is as a manifest and a series of chunks.
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub(crate) enum Layout {
+    Whole,
+    Large,
+    Chunk,
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::Duration;
+
+    fn cache() -> Segcache {
+        Segcache::builder()
+            .segment_size(4096)
+            .heap_size(4096 * 64)
+            .large_values(true)
+            .build()
+            .expect("failed to create cache")
+    }
+
+    fn value(len: usize) -> Vec<u8> {
+        (0..len).map(|i| i as u8).collect()
+    }
+
+    #[test]
+    fn oversized() {
+        // without large values, items which don't fit a segment are rejected
+        let mut cache = Segcache::builder()
+            .segment_size(4096)
+            .heap_size(4096 * 64)
+            .build()
+            .expect("failed to create cache");
+        assert!(matches!(
+            cache.insert(b"large", &value(10_000), None, Duration::ZERO),
+            Err(SegcacheError::ItemOversized { .. })
+        ));
+    }
+
+    #[test]
+    fn round_trip() {
+        let mut cache = cache();
+        let large = value(10_000);
+
+        assert!(cache
+            .insert(b"large", &large, Some(b"flag"), Duration::ZERO)
+            .is_ok());
+        let item = cache.get(b"large").expect("didn't get item back");
+        assert_eq!(item.value(), large.as_slice());
+        assert_eq!(item.optional(), Some(b"flag".as_slice()));
+
+        // the value survives being pinned and read without a frequency bump
+        let pinned = cache.pin(&item);
+        assert_eq!(pinned.value(), large.as_slice());
+        let item = cache
+            .get_no_freq_incr(b"large")
+            .expect("didn't get item back");
+        assert_eq!(item.value(), large.as_slice());
+
+        let items = cache.get_many(&[b"large".as_slice(), b"small"]);
+        assert_eq!(
+            items[0].as_ref().expect("didn't get item back").value(),
+            large.as_slice()
+        );
+        assert!(items[1].is_none());
+
+        // numeric operations and writes in place don't apply to large values
+        assert_eq!(
+            cache.wrapping_add(b"large", 1).err(),
+            Some(SegcacheError::NotNumeric)
+        );
+    }
+
+    #[test]
+    fn replace_and_delete() {
+        let mut cache = cache();
+        let items = cache.items();
+
+        assert!(cache
+            .insert(b"large", &value(10_000), None, Duration::ZERO)
+            .is_ok());
+        assert!(cache.items() > items + 1);
+
+        // replacing the value removes the chunks of the old one
+        let replacement = value(20_000);
+        assert!(cache
+            .insert(b"large", &replacement, None, Duration::ZERO)
+            .is_ok());
+        assert_eq!(
+            cache.get(b"large").expect("didn't get item back").value(),
+            replacement.as_slice()
+        );
+        let chunks = replacement.len().div_ceil(cache.chunk_len());
+        assert_eq!(cache.items(), items + chunks + 1);
+
+        assert!(cache.delete(b"large"));
+        assert!(cache.get(b"large").is_none());
+        assert_eq!(cache.items(), items);
+    }
+
+    #[test]
+    fn missing_chunk() {
+        let mut cache = cache();
+        let large = value(10_000);
+        assert!(cache.insert(b"large", &large, None, Duration::ZERO).is_ok());
+
+        // chunks are not visible by key, and the value is missing without them
+        let manifest = {
+            let item = cache.get_no_freq_incr(b"large").unwrap();
+            Manifest::parse(item.raw().value()).unwrap()
+        };
+        let chunk_key = manifest.chunk_key(1);
+        assert!(cache.get(&chunk_key).is_none());
+        assert!(cache.delete(&chunk_key));
+
+        assert!(cache.get(b"large").is_none());
+        assert!(cache.get_no_freq_incr(b"large").is_none());
+    }
+
+    #[test]
+    fn too_large() {
+        let mut cache = cache();
+        assert!(matches!(
+            cache.insert(b"large", &value(4096 * 48), None, Duration::ZERO),
+            Err(SegcacheError::ItemOversized { .. })
+        ));
+    }
+}
@@ -19,13 +19,18 @@
 //! * low metadata overhead
 //!
 //! Non-goals:
-//! * not designed for concurrent access
+//! * not designed for fine-grained concurrent access, a [`ShardedSegcache`]
+//!   may be used to partition the keyspace across independently locked
+//!   instances
 //!
 
 // macro includes
 #[macro_use]
 extern crate log;
 
+#[macro_use]
+mod usdt;
+
 // external crate includes
 use clocksource::coarse::{Duration, Instant};
 
@@ -34,20 +39,43 @@ use core::hash::{BuildHasher, Hasher};
 use std::convert::TryInto;
 
 // NOTE: this represents the versioning of the internal data layout and must be
-// incremented when breaking changes are made to the datastructures
-const VERSION: u64 = 0;
+// incremented when breaking changes are made to the datastructures. The upper
+// bits identify the geometry of the hashtable and whether items hold a prefix
+// id, which are zero for the default
+const VERSION: u64 = hashtable::GEOMETRY_VERSION | (cfg!(feature = "key-prefixes") as u64) << 40;
 
 // submodules
+mod admission;
 mod builder;
+mod compaction;
+#[cfg(feature = "compression")]
+mod compression;
 mod error;
 mod eviction;
 mod hashtable;
+mod ingest;
 mod item;
+mod large;
+mod memory;
+mod metadata;
+mod mrc;
+mod namespace;
+mod partition;
+mod prefetch;
+#[cfg(feature = "key-prefixes")]
+mod prefix;
 mod rand;
+mod scan;
 mod segcache;
+mod segment_stats;
 mod segments;
+mod sharded;
+mod sizing;
+mod stale;
+mod touch;
 mod ttl_buckets;
 mod value;
+mod warm;
 
 #[cfg(feature = "metrics")]
 mod metrics;
@@ -58,16 +86,36 @@ mod tests;
 
 // publicly exported items from submodules
 pub use crate::segcache::Segcache;
+pub use admission::DEFAULT_ADMISSION_THRESHOLD;
 pub use builder::Builder;
+#[cfg(feature = "compression")]
+pub use compression::DEFAULT_COMPRESSION_THRESHOLD;
+pub use datatier::HugePages;
 pub use error::SegcacheError;
 pub use eviction::Policy;
-pub use item::Item;
+pub use ingest::Ingest;
+pub use item::{Item, PinnedItem};
+pub use memory::MemoryUsage;
+pub use mrc::{MissRatioCurve, MRC_SIZES};
+pub use partition::{AccessStats, PartitionStats, DEFAULT_PARTITION};
+pub use segment_stats::{SegmentInfo, SegmentStats, TtlBucketInfo, UTILIZATION_BUCKETS};
+pub use sharded::{Router, ShardedSegcache};
+pub use sizing::{mean_item_size, HashtableInfo, Sizing};
+pub use storage_types::hash_key;
 pub use value::Value;
+pub use warm::{Export, Record, Records};
 
 // items from submodules which are imported for convenience to the crate level
+pub(crate) use crate::admission::*;
+#[cfg(feature = "compression")]
+pub(crate) use crate::compression::*;
+pub(crate) use crate::mrc::*;
+pub(crate) use crate::partition::*;
+pub(crate) use crate::prefetch::*;
 pub(crate) use crate::rand::*;
 pub(crate) use hashtable::*;
 pub(crate) use item::*;
+pub(crate) use metadata::*;
 pub(crate) use segments::*;
 pub(crate) use ttl_buckets::*;
 
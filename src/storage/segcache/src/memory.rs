@@ -0,0 +1,63 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! A breakdown of the memory held by a cache.
+
+/// The memory used by a [`crate::Segcache`], as returned by
+/// [`crate::Segcache::memory_usage`]. All sizes are in bytes, and only cover
+/// the segments held in memory.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct MemoryUsage {
+    /// Size of the hashtable, including the previous table while it grows.
+    pub hashtable: usize,
+    /// Size of the segment headers.
+    pub segment_headers: usize,
+    /// Size of the heap holding the segments.
+    pub heap: usize,
+    /// Size of the segments which were written to since they were last reset.
+    pub used: usize,
+    /// Bytes written into segments since they were last reset. These are the
+    /// live bytes and the dead bytes of items which were replaced or removed.
+    pub written: usize,
+    /// Bytes of the live items, including their headers and padding.
+    pub live: usize,
+    /// Number of live items.
+    pub items: usize,
+    /// Size of the header of each item.
+    pub item_header: usize,
+}
+
+impl MemoryUsage {
+    /// Adds the usage of another cache, such as another shard.
+    pub(crate) fn add(&mut self, other: &MemoryUsage) {
+        self.hashtable += other.hashtable;
+        self.segment_headers += other.segment_headers;
+        self.heap += other.heap;
+        self.used += other.used;
+        self.written += other.written;
+        self.live += other.live;
+        self.items += other.items;
+        self.item_header = other.item_header;
+    }
+
+    /// Total memory of the cache: the heap and all of the metadata.
+    pub fn total(&self) -> usize {
+        self.hashtable + self.segment_headers + self.heap
+    }
+
+    /// Bytes of the metadata kept outside of the heap.
+    pub fn metadata(&self) -> usize {
+        self.hashtable + self.segment_headers
+    }
+
+    /// Bytes of the headers of the live items.
+    pub fn item_headers(&self) -> usize {
+        self.items * self.item_header
+    }
+
+    /// Bytes written into segments which are no longer live.
+    pub fn dead(&self) -> usize {
+        self.written.saturating_sub(self.live)
+    }
+}
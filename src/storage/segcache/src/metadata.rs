@@ -0,0 +1,151 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Encoding of the cache metadata which is saved on graceful shutdown so that
+//! the cache can be restored on startup without rescanning the segments.
+//!
+//! The metadata consists of the hashtable, the segment headers, and the TTL
+//! buckets. The fields are encoded as little-endian integers in a fixed order
+//! and stored in a separate datapool file, which provides versioning and a
+//! checksum. Timestamps are recorded as their age at the time of shutdown and
+//! are rebased onto the clock of the restoring process, with the time spent
+//! down added to each age so that items continue to expire on schedule.
+
+use crate::*;
+use core::num::NonZeroU32;
+use std::io::{Error, ErrorKind};
+use std::time::{SystemTime, UNIX_EPOCH};
+
+/// Encoded size of the metadata preamble.
+pub(crate) const PREAMBLE_SIZE: usize = 8;
+
+/// Returns the current unix time in seconds.
+fn unix_secs() -> u64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_secs())
+        .unwrap_or(0)
+}
+
+fn truncated() -> Error {
+    Error::new(ErrorKind::UnexpectedEof, "metadata is truncated")
+}
+
+/// Sequentially encodes metadata into a byte buffer.
+pub(crate) struct MetadataWriter<'a> {
+    buffer: &'a mut [u8],
+    position: usize,
+    now: Instant,
+}
+
+impl<'a> MetadataWriter<'a> {
+    /// Creates a new writer over the buffer and writes the preamble.
+    pub fn new(buffer: &'a mut [u8]) -> Result<Self, Error> {
+        let mut writer = Self {
+            buffer,
+            position: 0,
+            now: Instant::now(),
+        };
+        writer.put_u64(unix_secs())?;
+        Ok(writer)
+    }
+
+    fn put(&mut self, bytes: &[u8]) -> Result<(), Error> {
+        let end = self.position + bytes.len();
+        self.buffer
+            .get_mut(self.position..end)
+            .ok_or_else(truncated)?
+            .copy_from_slice(bytes);
+        self.position = end;
+        Ok(())
+    }
+
+    pub fn put_u16(&mut self, value: u16) -> Result<(), Error> {
+        self.put(&value.to_le_bytes())
+    }
+
+    pub fn put_u32(&mut self, value: u32) -> Result<(), Error> {
+        self.put(&value.to_le_bytes())
+    }
+
+    pub fn put_u64(&mut self, value: u64) -> Result<(), Error> {
+        self.put(&value.to_le_bytes())
+    }
+
+    pub fn put_seg_id(&mut self, id: Option<NonZeroU32>) -> Result<(), Error> {
+        self.put_u32(id.map(|id| id.get()).unwrap_or(0))
+    }
+
+    /// Writes an instant as its age in seconds.
+    pub fn put_instant(&mut self, instant: Instant) -> Result<(), Error> {
+        let age = if instant < self.now {
+            (self.now - instant).as_secs()
+        } else {
+            0
+        };
+        self.put_u32(age)
+    }
+}
+
+/// Sequentially decodes metadata which was encoded by a [`MetadataWriter`].
+pub(crate) struct MetadataReader<'a> {
+    buffer: &'a [u8],
+    position: usize,
+    now: Instant,
+    downtime: u32,
+}
+
+impl<'a> MetadataReader<'a> {
+    /// Creates a new reader over the buffer and reads the preamble.
+    pub fn new(buffer: &'a [u8]) -> Result<Self, Error> {
+        let mut reader = Self {
+            buffer,
+            position: 0,
+            now: Instant::now(),
+            downtime: 0,
+        };
+        let saved = reader.get_u64()?;
+        reader.downtime = unix_secs().saturating_sub(saved).min(u32::MAX as u64) as u32;
+        Ok(reader)
+    }
+
+    fn get<const N: usize>(&mut self) -> Result<[u8; N], Error> {
+        let end = self.position + N;
+        let bytes = self
+            .buffer
+            .get(self.position..end)
+            .ok_or_else(truncated)?
+            .try_into()
+            .map_err(|_| truncated())?;
+        self.position = end;
+        Ok(bytes)
+    }
+
+    pub fn get_u16(&mut self) -> Result<u16, Error> {
+        self.get().map(u16::from_le_bytes)
+    }
+
+    pub fn get_u32(&mut self) -> Result<u32, Error> {
+        self.get().map(u32::from_le_bytes)
+    }
+
+    pub fn get_u64(&mut self) -> Result<u64, Error> {
+        self.get().map(u64::from_le_bytes)
+    }
+
+    pub fn get_seg_id(&mut self) -> Result<Option<NonZeroU32>, Error> {
+        self.get_u32().map(NonZeroU32::new)
+    }
+
+    /// Reads an instant which was written as its age, accounting for the time
+    /// which has elapsed since the metadata was written. Returns an error if
+    /// the instant cannot be represented by the current clock, which may
+    /// happen if the host has been rebooted.
+    pub fn get_instant(&mut self) -> Result<Instant, Error> {
+        let age = self.get_u32()?.saturating_add(self.downtime);
+        self.now
+            .checked_sub(Duration::from_secs(age))
+            .ok_or_else(|| Error::new(ErrorKind::Other, "timestamp predates clock"))
+    }
+}
@@ -13,6 +13,12 @@ use metriken::*;
 )]
 pub static SEGMENT_REQUEST: Counter = Counter::new();
 
+#[metric(
+    name = "segment_free_pinned",
+    description = "number of free segments skipped because they were still pinned"
+)]
+pub static SEGMENT_FREE_PINNED: Counter = Counter::new();
+
 #[metric(
     name = "segment_request_failure",
     description = "number of segment allocation attempts which failed"
@@ -28,12 +34,30 @@ pub static SEGMENT_REQUEST_SUCCESS: Counter = Counter::new();
 #[metric(name = "segment_evict", description = "number of segments evicted")]
 pub static SEGMENT_EVICT: Counter = Counter::new();
 
+#[metric(
+    name = "segment_evict_background",
+    description = "number of segments evicted by background maintenance"
+)]
+pub static SEGMENT_EVICT_BACKGROUND: Counter = Counter::new();
+
+#[metric(
+    name = "segment_compact_background",
+    description = "number of segments freed by background compaction"
+)]
+pub static SEGMENT_COMPACT_BACKGROUND: Counter = Counter::new();
+
 #[metric(
     name = "segment_evict_ex",
     description = "number of exceptions while evicting segments"
 )]
 pub static SEGMENT_EVICT_EX: Counter = Counter::new();
 
+#[metric(
+    name = "segment_evict_probation",
+    description = "number of eviction passes over the probationary segments of s3-fifo eviction"
+)]
+pub static SEGMENT_EVICT_PROBATION: Counter = Counter::new();
+
 #[metric(
     name = "segment_return",
     description = "total number of segments returned to the free pool"
@@ -52,12 +76,24 @@ pub static SEGMENT_MERGE: Counter = Counter::new();
 )]
 pub static SEGMENT_CLEAR: Counter = Counter::new();
 
+#[metric(
+    name = "segment_reclaim",
+    description = "total number of flushed segments reclaimed in the background"
+)]
+pub static SEGMENT_RECLAIM: Counter = Counter::new();
+
 #[metric(
     name = "segment_expire",
     description = "total number of segments expired"
 )]
 pub static SEGMENT_EXPIRE: Counter = Counter::new();
 
+#[metric(
+    name = "segment_expired_bytes",
+    description = "current number of live bytes held in segments past their expiry"
+)]
+pub static SEGMENT_EXPIRED_BYTES: Gauge = Gauge::new();
+
 #[metric(
     name = "clear_time",
     description = "amount of time, in nanoseconds, spent clearing segments"
@@ -85,6 +121,58 @@ pub static SEGMENT_FREE: Gauge = Gauge::new();
 )]
 pub static SEGMENT_CURRENT: Gauge = Gauge::new();
 
+// flash tier related
+#[metric(
+    name = "flash_segment_current",
+    description = "current total number of flash segments"
+)]
+pub static FLASH_SEGMENT_CURRENT: Gauge = Gauge::new();
+
+#[metric(
+    name = "flash_segment_evict",
+    description = "number of flash segments evicted to make room for new items"
+)]
+pub static FLASH_SEGMENT_EVICT: Counter = Counter::new();
+
+#[metric(
+    name = "flash_segment_expire",
+    description = "number of flash segments expired"
+)]
+pub static FLASH_SEGMENT_EXPIRE: Counter = Counter::new();
+
+#[metric(
+    name = "flash_segment_aged",
+    description = "number of segments moved from memory into flash whole as they aged past the threshold"
+)]
+pub static FLASH_SEGMENT_AGED: Counter = Counter::new();
+
+#[metric(
+    name = "flash_demote",
+    description = "number of items moved from memory into flash"
+)]
+pub static FLASH_DEMOTE: Counter = Counter::new();
+
+#[metric(
+    name = "flash_demote_bytes",
+    description = "number of bytes moved from memory into flash"
+)]
+pub static FLASH_DEMOTE_BYTES: Counter = Counter::new();
+
+#[metric(name = "flash_hit", description = "number of items read from flash")]
+pub static FLASH_HIT: Counter = Counter::new();
+
+#[metric(
+    name = "flash_promote",
+    description = "number of items moved from flash back into memory"
+)]
+pub static FLASH_PROMOTE: Counter = Counter::new();
+
+#[metric(
+    name = "flash_filter_skip",
+    description = "number of reads of flash items skipped as the bloom filter of their segment did not hold the key"
+)]
+pub static FLASH_FILTER_SKIP: Counter = Counter::new();
+
 // hash table related
 #[metric(
     name = "hash_tag_collision",
@@ -92,6 +180,18 @@ pub static SEGMENT_CURRENT: Gauge = Gauge::new();
 )]
 pub static HASH_TAG_COLLISION: Counter = Counter::new();
 
+#[metric(
+    name = "hash_inline_hit",
+    description = "number of lookups answered from a copy of the item beside its slot"
+)]
+pub static HASH_INLINE_HIT: Counter = Counter::new();
+
+#[metric(
+    name = "hash_fingerprint_reject",
+    description = "number of tag matches rejected by their fingerprint without reading the item"
+)]
+pub static HASH_FINGERPRINT_REJECT: Counter = Counter::new();
+
 #[metric(
     name = "hash_insert",
     description = "number of inserts into the hash table"
@@ -116,6 +216,24 @@ pub static HASH_REMOVE: Counter = Counter::new();
 )]
 pub static HASH_LOOKUP: Counter = Counter::new();
 
+#[metric(
+    name = "hash_resize",
+    description = "number of times the hash table has started growing"
+)]
+pub static HASH_RESIZE: Counter = Counter::new();
+
+#[metric(
+    name = "hash_migrate",
+    description = "number of buckets migrated while growing the hash table"
+)]
+pub static HASH_MIGRATE: Counter = Counter::new();
+
+#[metric(
+    name = "hash_migrate_ex",
+    description = "number of items dropped during migration due to capacity"
+)]
+pub static HASH_MIGRATE_EX: Counter = Counter::new();
+
 // item related
 #[metric(
     name = "item_allocate",
@@ -147,6 +265,18 @@ pub static ITEM_EXPIRE: Counter = Counter::new();
 )]
 pub static ITEM_EVICT: Counter = Counter::new();
 
+#[metric(
+    name = "item_promote",
+    description = "number of probationary items kept by s3-fifo eviction"
+)]
+pub static ITEM_PROMOTE: Counter = Counter::new();
+
+#[metric(
+    name = "item_ghost_hit",
+    description = "number of probationary items kept as their key was recently evicted"
+)]
+pub static ITEM_GHOST_HIT: Counter = Counter::new();
+
 #[metric(
     name = "item_compacted",
     description = "number of items which have been compacted"
@@ -159,6 +289,129 @@ pub static ITEM_COMPACTED: Counter = Counter::new();
 )]
 pub static ITEM_RELINK: Counter = Counter::new();
 
+#[metric(
+    name = "item_export",
+    description = "number of items exported for warming a peer"
+)]
+pub static ITEM_EXPORT: Counter = Counter::new();
+
+#[metric(
+    name = "item_import",
+    description = "number of items imported from the export of a peer"
+)]
+pub static ITEM_IMPORT: Counter = Counter::new();
+
+#[metric(
+    name = "item_large_store",
+    description = "number of values stored in chunks as they are too large for a segment"
+)]
+pub static ITEM_LARGE_STORE: Counter = Counter::new();
+
+#[metric(
+    name = "item_large_chunk",
+    description = "number of chunks stored for large values"
+)]
+pub static ITEM_LARGE_CHUNK: Counter = Counter::new();
+
+#[metric(
+    name = "item_large_missing",
+    description = "number of large values read after one of their chunks was evicted"
+)]
+pub static ITEM_LARGE_MISSING: Counter = Counter::new();
+
+#[metric(
+    name = "item_touch",
+    description = "number of items given a new ttl by a touch without being copied"
+)]
+pub static ITEM_TOUCH: Counter = Counter::new();
+
+#[metric(
+    name = "item_touch_copy",
+    description = "number of touches of values stored in chunks, which are copied"
+)]
+pub static ITEM_TOUCH_COPY: Counter = Counter::new();
+
+#[metric(
+    name = "item_touch_relocate",
+    description = "number of touched items moved to another ttl bucket as their segment expired"
+)]
+pub static ITEM_TOUCH_RELOCATE: Counter = Counter::new();
+
+#[metric(
+    name = "item_touch_expire",
+    description = "number of touched items removed on read once their deadline had passed"
+)]
+pub static ITEM_TOUCH_EXPIRE: Counter = Counter::new();
+
+#[metric(
+    name = "item_stale",
+    description = "number of items read as stale within the grace period after they expired"
+)]
+pub static ITEM_STALE: Counter = Counter::new();
+
+#[metric(
+    name = "lease_grant",
+    description = "number of leases granted to recompute an item"
+)]
+pub static LEASE_GRANT: Counter = Counter::new();
+
+#[metric(
+    name = "lease_held",
+    description = "number of leases refused as they were held by another client"
+)]
+pub static LEASE_HELD: Counter = Counter::new();
+
+#[metric(
+    name = "namespace_invalidate",
+    description = "number of key prefixes invalidated"
+)]
+pub static NAMESPACE_INVALIDATE: Counter = Counter::new();
+
+#[metric(
+    name = "item_namespace_expire",
+    description = "number of items removed on read as a prefix of their key was invalidated"
+)]
+pub static ITEM_NAMESPACE_EXPIRE: Counter = Counter::new();
+
+#[metric(name = "scan", description = "number of steps taken by key scans")]
+pub static SCAN: Counter = Counter::new();
+
+#[metric(
+    name = "scan_key",
+    description = "number of keys returned by key scans"
+)]
+pub static SCAN_KEY: Counter = Counter::new();
+
+#[metric(
+    name = "item_update_inplace",
+    description = "number of appends, prepends, and numeric updates made to items in place"
+)]
+pub static ITEM_UPDATE_INPLACE: Counter = Counter::new();
+
+#[metric(
+    name = "item_update_copy",
+    description = "number of appends, prepends, and numeric updates made by storing a copy of the item"
+)]
+pub static ITEM_UPDATE_COPY: Counter = Counter::new();
+
+#[metric(
+    name = "hash_table_bytes",
+    description = "current number of bytes allocated for the hashtable, including the previous table while it grows"
+)]
+pub static HASH_TABLE_BYTES: Gauge = Gauge::new();
+
+#[metric(
+    name = "segment_heap_bytes",
+    description = "current number of bytes allocated for the heap of segments in memory"
+)]
+pub static SEGMENT_HEAP_BYTES: Gauge = Gauge::new();
+
+#[metric(
+    name = "segment_header_bytes",
+    description = "current number of bytes allocated for the segment headers"
+)]
+pub static SEGMENT_HEADER_BYTES: Gauge = Gauge::new();
+
 #[metric(name = "item_current", description = "current number of live items")]
 pub static ITEM_CURRENT: Gauge = Gauge::new();
 
@@ -176,3 +429,125 @@ pub static ITEM_DEAD: Gauge = Gauge::new();
     description = "current number of dead bytes for storing items"
 )]
 pub static ITEM_DEAD_BYTES: Gauge = Gauge::new();
+
+// admission related
+#[metric(
+    name = "admission_reject",
+    description = "number of inserts dropped by the admission filter"
+)]
+pub static ADMISSION_REJECT: Counter = Counter::new();
+
+#[metric(
+    name = "admission_reset",
+    description = "number of times the admission filter frequencies were aged"
+)]
+pub static ADMISSION_RESET: Counter = Counter::new();
+
+// compression related
+#[cfg(feature = "compression")]
+#[metric(
+    name = "item_compress_attempt",
+    description = "number of item values which were considered for compression"
+)]
+pub static ITEM_COMPRESS_ATTEMPT: Counter = Counter::new();
+
+#[cfg(feature = "compression")]
+#[metric(
+    name = "item_compress",
+    description = "number of item values which were stored compressed"
+)]
+pub static ITEM_COMPRESS: Counter = Counter::new();
+
+#[cfg(feature = "compression")]
+#[metric(
+    name = "item_compress_bytes_in",
+    description = "number of uncompressed bytes of item values which were stored compressed"
+)]
+pub static ITEM_COMPRESS_BYTES_IN: Counter = Counter::new();
+
+#[cfg(feature = "compression")]
+#[metric(
+    name = "item_compress_bytes_out",
+    description = "number of compressed bytes of item values which were stored compressed, the ratio to item_compress_bytes_in is the compression ratio"
+)]
+pub static ITEM_COMPRESS_BYTES_OUT: Counter = Counter::new();
+
+#[cfg(feature = "compression")]
+#[metric(
+    name = "item_decompress",
+    description = "number of item values which were decompressed on read"
+)]
+pub static ITEM_DECOMPRESS: Counter = Counter::new();
+
+#[cfg(feature = "compression")]
+#[metric(
+    name = "item_decompress_latency",
+    description = "distribution of the time taken to decompress item values in nanoseconds"
+)]
+pub static ITEM_DECOMPRESS_LATENCY: AtomicHistogram = AtomicHistogram::new(7, 32);
+
+// miss ratio curve estimation
+#[metric(
+    name = "mrc_hit_ratio_25",
+    description = "estimated hit ratio of a cache 25% of the heap size, in parts per million"
+)]
+pub static MRC_HIT_RATIO_25: Gauge = Gauge::new();
+
+#[metric(
+    name = "mrc_hit_ratio_50",
+    description = "estimated hit ratio of a cache 50% of the heap size, in parts per million"
+)]
+pub static MRC_HIT_RATIO_50: Gauge = Gauge::new();
+
+#[metric(
+    name = "mrc_hit_ratio_75",
+    description = "estimated hit ratio of a cache 75% of the heap size, in parts per million"
+)]
+pub static MRC_HIT_RATIO_75: Gauge = Gauge::new();
+
+#[metric(
+    name = "mrc_hit_ratio_100",
+    description = "estimated hit ratio of a cache of the heap size, in parts per million"
+)]
+pub static MRC_HIT_RATIO_100: Gauge = Gauge::new();
+
+#[metric(
+    name = "mrc_hit_ratio_150",
+    description = "estimated hit ratio of a cache 150% of the heap size, in parts per million"
+)]
+pub static MRC_HIT_RATIO_150: Gauge = Gauge::new();
+
+#[metric(
+    name = "mrc_hit_ratio_200",
+    description = "estimated hit ratio of a cache 200% of the heap size, in parts per million"
+)]
+pub static MRC_HIT_RATIO_200: Gauge = Gauge::new();
+
+#[metric(
+    name = "mrc_hit_ratio_400",
+    description = "estimated hit ratio of a cache 400% of the heap size, in parts per million"
+)]
+pub static MRC_HIT_RATIO_400: Gauge = Gauge::new();
+
+/// The hit ratio gauges, in the order of `MRC_SIZES`.
+pub static MRC_HIT_RATIO: [&Gauge; 7] = [
+    &MRC_HIT_RATIO_25,
+    &MRC_HIT_RATIO_50,
+    &MRC_HIT_RATIO_75,
+    &MRC_HIT_RATIO_100,
+    &MRC_HIT_RATIO_150,
+    &MRC_HIT_RATIO_200,
+    &MRC_HIT_RATIO_400,
+];
+
+#[metric(
+    name = "mrc_sample_rate",
+    description = "share of keys sampled for the miss ratio curve, in parts per million"
+)]
+pub static MRC_SAMPLE_RATE: Gauge = Gauge::new();
+
+#[metric(
+    name = "mrc_keys",
+    description = "number of sampled keys tracked for the miss ratio curve"
+)]
+pub static MRC_KEYS: Gauge = Gauge::new();
@@ -0,0 +1,363 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! An optional online estimate of the miss ratio curve, the hit ratio the
+//! cache would have at other sizes, using fixed-size SHARDS.
+//!
+//! Keys are sampled by their hash, so every access to a sampled key is seen.
+//! The reuse distance of each read of a sampled key, the bytes of the distinct
+//! sampled items accessed since its previous access scaled by the sampling
+//! rate, is the smallest LRU cache which would hold the item. A histogram of
+//! the distances gives the hit ratio at any size.
+//!
+//! At most a fixed number of keys are tracked. Once more are sampled, the key
+//! with the largest hash is dropped and the sampling rate is lowered to its
+//! hash, so the memory used is fixed while the rate adapts to the number of
+//! keys. The histogram is rescaled whenever the rate is lowered, and halved
+//! after each window of reads so that it follows changes in the workload.
+//!
+//! The distances are those of an ideal LRU cache of items, which segcache
+//! approximates, so the estimate does not include the effects of ttls,
+//! segment fragmentation, or the eviction policy.
+
+#[cfg(feature = "metrics")]
+use crate::metrics::*;
+
+use ahash::RandomState;
+use core::hash::BuildHasher;
+use std::collections::{BinaryHeap, HashMap};
+
+/// The sizes, in percent of the heap size, which the estimate is published
+/// for as metrics.
+pub const MRC_SIZES: [usize; 7] = [25, 50, 75, 100, 150, 200, 400];
+
+// number of histogram buckets per heap size of reuse distance
+const BUCKETS_PER_HEAP: usize = 64;
+
+// reuse distances up to this many times the heap size are counted
+const MAX_HEAPS: usize = 8;
+
+// the metrics are updated after this many reads of sampled keys
+#[cfg(feature = "metrics")]
+const PUBLISH_INTERVAL: u64 = 1024;
+
+/// The hit ratio which a cache of each size is estimated to have.
+#[derive(Clone, Debug, PartialEq)]
+pub struct MissRatioCurve {
+    /// Pairs of a cache size in bytes and the estimated hit ratio of an LRU
+    /// cache of that size, in order of size.
+    pub points: Vec<(usize, f64)>,
+    /// The share of keys which are sampled.
+    pub sample_rate: f64,
+    /// The number of keys which are tracked.
+    pub keys: usize,
+}
+
+/// A sampled key, and the time and size of its last access.
+struct Entry {
+    time: usize,
+    size: usize,
+}
+
+/// The estimator state.
+pub(crate) struct Mrc {
+    hash_builder: RandomState,
+    heap_size: usize,
+    max_keys: usize,
+    /// keys whose hash is below this are sampled
+    threshold: u64,
+    keys: HashMap<u64, Entry>,
+    /// the hashes of the tracked keys, to find the largest
+    hashes: BinaryHeap<u64>,
+    /// the size of the item last accessed at each time, summed by a fenwick
+    /// tree
+    sizes: Vec<u64>,
+    /// the next time, times are renumbered once all are used
+    now: usize,
+    /// the weight of the reads of each bucket of reuse distance
+    histogram: Vec<f64>,
+    /// the weight of the reads of keys which were not tracked, or were
+    /// beyond the largest distance
+    cold: f64,
+    reads: u64,
+    window: u64,
+}
+
+impl Mrc {
+    /// Create a new estimator for a cache of `heap_size` bytes which tracks up
+    /// to `max_keys` sampled keys.
+    pub fn new(heap_size: usize, max_keys: usize) -> Self {
+        let max_keys = max_keys.max(64);
+
+        // NOTE: these seeds must differ from those used by the `HashTable`,
+        // the admission filter, and the `ShardedSegcache`, so that sampled keys
+        // are spread across buckets and shards
+        let hash_builder = RandomState::with_seeds(
+            0x428a2f98d728ae22,
+            0x7137449123ef65cd,
+            0xb5c0fbcfec4d3b2f,
+            0xe9b5dba58189dbbc,
+        );
+
+        // each tracked key holds one time, and twice as many times as keys
+        // are kept so that renumbering them is amortized
+        let capacity = 2 * max_keys;
+
+        Self {
+            hash_builder,
+            heap_size: heap_size.max(1),
+            max_keys,
+            threshold: u64::MAX,
+            keys: HashMap::with_capacity(max_keys + 1),
+            hashes: BinaryHeap::with_capacity(max_keys + 1),
+            sizes: vec![0; capacity + 1],
+            now: 0,
+            histogram: vec![0.0; BUCKETS_PER_HEAP * MAX_HEAPS],
+            cold: 0.0,
+            reads: 0,
+            window: 16 * max_keys as u64,
+        }
+    }
+
+    /// The share of keys which are sampled.
+    fn rate(&self) -> f64 {
+        self.threshold as f64 / u64::MAX as f64
+    }
+
+    /// Records an access to the key. Reads pass the size of the item if it
+    /// was found, writes pass the size of the new item.
+    pub fn access(&mut self, key: &[u8], size: Option<usize>, read: bool) {
+        let hash = self.hash_builder.hash_one(key);
+        if hash >= self.threshold {
+            return;
+        }
+
+        let previous = self.keys.get(&hash).map(|entry| (entry.time, entry.size));
+        let distance = previous.map(|(time, _)| {
+            // the bytes of the items accessed since, each counted at their last
+            // access, as they would be in an LRU cache
+            let bytes = self.prefix(self.now) - self.prefix(time + 1);
+            (bytes as f64 / self.rate()) as usize
+        });
+
+        if read {
+            match distance {
+                Some(distance) => {
+                    let bucket = distance * BUCKETS_PER_HEAP / self.heap_size;
+                    match self.histogram.get_mut(bucket) {
+                        Some(weight) => *weight += 1.0,
+                        None => self.cold += 1.0,
+                    }
+                }
+                None => self.cold += 1.0,
+            }
+            self.reads += 1;
+            if self.reads % self.window == 0 {
+                self.decay();
+            }
+            #[cfg(feature = "metrics")]
+            if self.reads % PUBLISH_INTERVAL == 0 {
+                self.publish();
+            }
+        }
+
+        // a miss on a tracked key keeps the size it was last seen with
+        let size = match (size, previous) {
+            (Some(size), _) => size,
+            (None, Some((_, size))) => size,
+            (None, None) => return,
+        };
+
+        if let Some((time, size)) = previous {
+            self.update(time, -(size as i64));
+        } else {
+            self.hashes.push(hash);
+        }
+
+        if self.now == self.sizes.len() - 1 {
+            self.compact();
+        }
+        let time = self.now;
+        self.now += 1;
+        self.update(time, size as i64);
+        self.keys.insert(hash, Entry { time, size });
+
+        if self.hashes.len() > 2 * self.max_keys {
+            // drop the hashes of keys which were removed
+            self.hashes = self.keys.keys().copied().collect();
+        }
+        while self.keys.len() > self.max_keys {
+            self.lower_threshold();
+        }
+    }
+
+    /// Stops tracking the key, so that its next access is a miss, as it is
+    /// for the cache.
+    pub fn remove(&mut self, key: &[u8]) {
+        let hash = self.hash_builder.hash_one(key);
+        if hash >= self.threshold {
+            return;
+        }
+        if let Some(entry) = self.keys.remove(&hash) {
+            self.update(entry.time, -(entry.size as i64));
+        }
+    }
+
+    /// The estimated hit ratio of an LRU cache of each size.
+    pub fn curve(&self, sizes: &[usize]) -> MissRatioCurve {
+        let total: f64 = self.histogram.iter().sum::<f64>() + self.cold;
+        let points = sizes
+            .iter()
+            .map(|size| {
+                if total == 0.0 {
+                    return (*size, 0.0);
+                }
+                let buckets = (size * BUCKETS_PER_HEAP / self.heap_size).min(self.histogram.len());
+                let hits: f64 = self.histogram[..buckets].iter().sum();
+                (*size, hits / total)
+            })
+            .collect();
+
+        MissRatioCurve {
+            points,
+            sample_rate: self.rate(),
+            keys: self.keys.len(),
+        }
+    }
+
+    /// The sizes which are published as metrics, in bytes.
+    pub fn sizes(&self) -> Vec<usize> {
+        MRC_SIZES
+            .iter()
+            .map(|percent| self.heap_size * percent / 100)
+            .collect()
+    }
+
+    #[cfg(feature = "metrics")]
+    fn publish(&self) {
+        let curve = self.curve(&self.sizes());
+        for (gauge, (_, ratio)) in MRC_HIT_RATIO.iter().zip(curve.points) {
+            gauge.set((ratio * 1_000_000.0) as i64);
+        }
+        MRC_SAMPLE_RATE.set((curve.sample_rate * 1_000_000.0) as i64);
+        MRC_KEYS.set(curve.keys as i64);
+    }
+
+    /// Drops the tracked key with the largest hash and lowers the sampling
+    /// rate to exclude it, rescaling the histogram to the new rate.
+    fn lower_threshold(&mut self) {
+        while let Some(hash) = self.hashes.pop() {
+            // keys which were removed are skipped
+            let entry = match self.keys.remove(&hash) {
+                Some(entry) => entry,
+                None => continue,
+            };
+            self.update(entry.time, -(entry.size as i64));
+
+            let rate = self.rate();
+            self.threshold = hash;
+            let scale = self.rate() / rate;
+            for weight in self.histogram.iter_mut() {
+                *weight *= scale;
+            }
+            self.cold *= scale;
+            return;
+        }
+    }
+
+    /// Halves the histogram so that recent reads outweigh older ones.
+    fn decay(&mut self) {
+        for weight in self.histogram.iter_mut() {
+            *weight /= 2.0;
+        }
+        self.cold /= 2.0;
+    }
+
+    /// Renumbers the times of the tracked keys from zero, keeping their order,
+    /// once every time has been used.
+    fn compact(&mut self) {
+        let mut live: Vec<(usize, u64, usize)> = self
+            .keys
+            .iter()
+            .map(|(hash, entry)| (entry.time, *hash, entry.size))
+            .collect();
+        live.sort_unstable();
+
+        self.sizes.iter_mut().for_each(|size| *size = 0);
+        self.now = 0;
+        for (_, hash, size) in live {
+            let time = self.now;
+            self.now += 1;
+            self.update(time, size as i64);
+            if let Some(entry) = self.keys.get_mut(&hash) {
+                entry.time = time;
+            }
+        }
+    }
+
+    /// Adds to the size at the time.
+    fn update(&mut self, time: usize, delta: i64) {
+        let mut i = time + 1;
+        while i < self.sizes.len() {
+            self.sizes[i] = self.sizes[i].wrapping_add(delta as u64);
+            i += i & i.wrapping_neg();
+        }
+    }
+
+    /// The sum of the sizes at times before `time`.
+    fn prefix(&self, time: usize) -> u64 {
+        let mut sum = 0u64;
+        let mut i = time;
+        while i > 0 {
+            sum = sum.wrapping_add(self.sizes[i]);
+            i -= i & i.wrapping_neg();
+        }
+        sum
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn cyclic() {
+        // a loop over 100 items of 100 bytes hits only once they all fit
+        let mut mrc = Mrc::new(10_000, 1024);
+        for _ in 0..20 {
+            for i in 0..100 {
+                let key = format!("{i}");
+                if mrc
+                    .keys
+                    .contains_key(&mrc.hash_builder.hash_one(key.as_bytes()))
+                {
+                    mrc.access(key.as_bytes(), Some(100), true);
+                } else {
+                    mrc.access(key.as_bytes(), None, true);
+                    mrc.access(key.as_bytes(), Some(100), false);
+                }
+            }
+        }
+
+        let curve = mrc.curve(&[5_000, 20_000]);
+        assert_eq!(curve.sample_rate, 1.0);
+        assert_eq!(curve.points[0].1, 0.0);
+        assert!(curve.points[1].1 > 0.9);
+    }
+
+    #[test]
+    fn fixed_size() {
+        let mut mrc = Mrc::new(1 << 30, 64);
+        for i in 0..100_000 {
+            let key = format!("{i}");
+            mrc.access(key.as_bytes(), Some(100), false);
+        }
+        assert!(mrc.keys.len() <= 64);
+        assert!(mrc.rate() < 0.01);
+
+        mrc.remove(b"0");
+        let curve = mrc.curve(&mrc.sizes());
+        assert_eq!(curve.points.len(), MRC_SIZES.len());
+    }
+}
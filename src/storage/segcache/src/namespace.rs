@@ -0,0 +1,246 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Invalidation of all the keys which share a prefix, without deleting them.
+//!
+//! When namespaces are enabled, each item is stamped with the generation it
+//! was written in, which is held after its optional data. Invalidating a
+//! prefix starts a new generation and records it for the prefix, which takes
+//! a single table insert however many keys share the prefix. Items with the
+//! prefix which were stamped in an earlier generation are treated as missing
+//! by reads, which remove them, and are otherwise reclaimed as their segments
+//! are evicted or expire.
+//!
+//! A prefix is dropped from the table once every segment is newer than its
+//! invalidation, as no item which it applies to can remain. Generations start
+//! from the wall clock, so that a cache restored from its metadata does not
+//! reuse the generations of the items it holds.
+
+use crate::*;
+use std::collections::{BTreeSet, HashMap};
+
+// the prefixes are swept for those which no longer apply to any item each
+// time their number doubles since the last sweep
+const SWEEP_MIN: usize = 1024;
+
+/// The current generation and the prefixes which have been invalidated, with
+/// the generation and time of their invalidation.
+pub(crate) struct Namespaces {
+    enabled: bool,
+    generation: u32,
+    prefixes: HashMap<Box<[u8]>, (u32, Instant)>,
+    // the lengths of the prefixes, so a key is only looked up by those
+    lens: BTreeSet<usize>,
+    sweep_at: usize,
+}
+
+impl Namespaces {
+    pub(crate) fn new(enabled: bool) -> Self {
+        Self {
+            enabled,
+            generation: unix_secs(),
+            prefixes: HashMap::new(),
+            lens: BTreeSet::new(),
+            sweep_at: SWEEP_MIN,
+        }
+    }
+
+    /// Returns the generation new items are stamped with, if namespaces are
+    /// enabled.
+    #[inline]
+    pub(crate) fn stamp(&self) -> Option<u32> {
+        self.enabled.then_some(self.generation)
+    }
+
+    /// Returns true if a prefix of the key was invalidated after the item was
+    /// stamped.
+    #[inline]
+    pub(crate) fn is_invalidated(&self, key: &[u8], stamp: Option<u32>) -> bool {
+        if self.prefixes.is_empty() {
+            return false;
+        }
+        let stamp = match stamp {
+            Some(stamp) => stamp,
+            None => return false,
+        };
+
+        self.lens
+            .iter()
+            .take_while(|len| **len <= key.len())
+            .filter_map(|len| self.prefixes.get(&key[..*len]))
+            .any(|(generation, _)| stamp < *generation)
+    }
+
+    pub(crate) fn clear(&mut self) {
+        self.prefixes.clear();
+        self.lens.clear();
+        self.sweep_at = SWEEP_MIN;
+    }
+}
+
+impl Segcache {
+    /// Invalidates every item whose key starts with the prefix, which are
+    /// then treated as missing. This takes constant time, as the items are
+    /// removed as they are read or their segments are reclaimed. Items stored
+    /// after the invalidation are not affected. Returns false, without
+    /// invalidating any items, unless the cache was built with namespaces
+    /// enabled.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder()
+    ///     .namespaces(true)
+    ///     .build()
+    ///     .expect("failed to create cache");
+    ///
+    /// cache.insert(b"user:1:name", b"alice", None, Duration::ZERO);
+    /// cache.insert(b"user:2:name", b"bob", None, Duration::ZERO);
+    ///
+    /// assert!(cache.invalidate_prefix(b"user:1:"));
+    /// assert!(cache.get(b"user:1:name").is_none());
+    /// assert!(cache.get(b"user:2:name").is_some());
+    ///
+    /// cache.insert(b"user:1:name", b"carol", None, Duration::ZERO);
+    /// assert!(cache.get(b"user:1:name").is_some());
+    /// ```
+    pub fn invalidate_prefix(&mut self, prefix: &[u8]) -> bool {
+        if !self.namespaces.enabled {
+            return false;
+        }
+
+        #[cfg(feature = "metrics")]
+        NAMESPACE_INVALIDATE.increment();
+
+        let namespaces = &mut self.namespaces;
+        namespaces.generation = namespaces.generation.wrapping_add(1).max(unix_secs());
+        namespaces
+            .prefixes
+            .insert(prefix.into(), (namespaces.generation, Instant::now()));
+        namespaces.lens.insert(prefix.len());
+
+        if namespaces.prefixes.len() >= namespaces.sweep_at {
+            self.sweep_namespaces();
+        }
+
+        true
+    }
+
+    /// Returns true if the item was invalidated along with a prefix of its
+    /// key.
+    #[inline]
+    pub(crate) fn is_invalidated(&self, item: &Item) -> bool {
+        // the stamp is only read from the item when there are prefixes to
+        // check it against
+        !self.namespaces.prefixes.is_empty()
+            && self
+                .namespaces
+                .is_invalidated(item.key(), item.raw().stamp())
+    }
+
+    /// Drops the prefixes which were invalidated before the oldest segment
+    /// was created, as they no longer apply to any item. Items in the flash
+    /// tier may be older than any segment in memory, so prefixes are kept
+    /// while there is one.
+    fn sweep_namespaces(&mut self) {
+        if self.segments.has_flash() {
+            self.namespaces.sweep_at = self.namespaces.prefixes.len() * 2;
+            return;
+        }
+
+        let mut oldest = None;
+        for bucket in self.ttl_buckets.buckets.iter() {
+            if let Some(segment) = bucket.head().and_then(|id| self.segments.get_mut(id).ok()) {
+                let create_at = segment.create_at();
+                oldest = Some(oldest.map_or(create_at, |oldest: Instant| oldest.min(create_at)));
+            }
+        }
+
+        let namespaces = &mut self.namespaces;
+        match oldest {
+            Some(oldest) => namespaces
+                .prefixes
+                .retain(|_, (_, invalidated_at)| *invalidated_at >= oldest),
+            None => namespaces.prefixes.clear(),
+        }
+        namespaces.lens = namespaces
+            .prefixes
+            .keys()
+            .map(|prefix| prefix.len())
+            .collect();
+        namespaces.sweep_at = (namespaces.prefixes.len() * 2).max(SWEEP_MIN);
+    }
+}
+
+/// Returns the seconds since the unix epoch.
+fn unix_secs() -> u32 {
+    std::time::SystemTime::now()
+        .duration_since(std::time::UNIX_EPOCH)
+        .map(|elapsed| std::cmp::min(u32::MAX as u64, elapsed.as_secs()) as u32)
+        .unwrap_or(0)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::Duration;
+
+    fn cache() -> Segcache {
+        Segcache::builder()
+            .segment_size(4096)
+            .heap_size(4096 * 64)
+            .namespaces(true)
+            .build()
+            .expect("failed to create cache")
+    }
+
+    #[test]
+    fn invalidate() {
+        let mut cache = cache();
+        for key in [
+            &b"user:1:name"[..],
+            b"user:1:mail",
+            b"user:12:name",
+            b"team:1",
+        ] {
+            assert!(cache
+                .insert(key, b"value", Some(b"flag"), Duration::ZERO)
+                .is_ok());
+        }
+
+        // only the keys with the prefix are missing, and are removed as they
+        // are read
+        assert!(cache.invalidate_prefix(b"user:1:"));
+        assert!(cache.get(b"user:1:name").is_none());
+        assert!(cache.get_no_freq_incr(b"user:1:mail").is_none());
+        assert_eq!(cache.items(), 2);
+        let item = cache.get(b"user:12:name").unwrap();
+        assert_eq!(item.optional(), Some(b"flag".as_slice()));
+        assert!(cache.get(b"team:1").is_some());
+
+        // items stored after the invalidation are kept
+        assert!(cache
+            .insert(b"user:1:name", b"new", Some(b"flag"), Duration::ZERO)
+            .is_ok());
+        let item = cache.get(b"user:1:name").unwrap();
+        assert_eq!(item.value(), b"new");
+        assert_eq!(item.optional(), Some(b"flag".as_slice()));
+
+        // and an empty prefix invalidates every item
+        assert!(cache.invalidate_prefix(b""));
+        assert!(cache.get(b"user:1:name").is_none());
+        assert!(cache.get(b"team:1").is_none());
+    }
+
+    #[test]
+    fn disabled() {
+        let mut cache = Segcache::builder().build().expect("failed to create cache");
+        assert!(cache
+            .insert(b"user:1:name", b"value", None, Duration::ZERO)
+            .is_ok());
+        assert!(!cache.invalidate_prefix(b"user:"));
+        assert!(cache.get(b"user:1:name").is_some());
+    }
+}
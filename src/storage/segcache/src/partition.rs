@@ -0,0 +1,72 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Named partitions of a [`crate::ShardedSegcache`], selected by key prefix,
+//! and the counters which are kept for each of them.
+//!
+//! Each partition is a set of shards built from its own [`crate::Builder`],
+//! so that tenants sharing a process each have their own heap, ttl buckets,
+//! and eviction policy, and one tenant's writes never evict another's items.
+
+use crate::MemoryUsage;
+use std::ops::Range;
+
+/// The name of the partition which holds the keys that match no prefix.
+pub const DEFAULT_PARTITION: &str = "default";
+
+/// Counts of the operations on a [`crate::Segcache`], as returned by
+/// [`crate::Segcache::access_stats`].
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct AccessStats {
+    /// Number of keys looked up.
+    pub gets: u64,
+    /// Number of keys looked up which were found.
+    pub hits: u64,
+    /// Number of items stored.
+    pub inserts: u64,
+    /// Number of keys deleted.
+    pub deletes: u64,
+}
+
+impl AccessStats {
+    /// Adds the counts of another cache, such as another shard.
+    pub(crate) fn add(&mut self, other: &AccessStats) {
+        self.gets += other.gets;
+        self.hits += other.hits;
+        self.inserts += other.inserts;
+        self.deletes += other.deletes;
+    }
+
+    /// Number of keys looked up which were not found.
+    pub fn misses(&self) -> u64 {
+        self.gets - self.hits
+    }
+}
+
+/// The state of one partition, as returned by
+/// [`crate::ShardedSegcache::partitions`].
+#[derive(Clone, Debug)]
+pub struct PartitionStats {
+    /// The name of the partition.
+    pub name: String,
+    /// The prefix of the keys held by the partition, empty for the default
+    /// partition.
+    pub prefix: Vec<u8>,
+    /// The indices of the shards of the partition.
+    pub shards: Range<usize>,
+    /// The operations on the shards of the partition.
+    pub access: AccessStats,
+    /// The memory held by the shards of the partition.
+    pub usage: MemoryUsage,
+}
+
+/// A partition as laid out in a [`crate::ShardedSegcache`].
+#[derive(Clone, Debug)]
+pub(crate) struct Partition {
+    pub name: String,
+    pub prefix: Box<[u8]>,
+    /// the indices of the shards, a power of two which starts after the
+    /// shards of the partitions before it
+    pub shards: Range<usize>,
+}
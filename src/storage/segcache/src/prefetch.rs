@@ -0,0 +1,27 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Software prefetching helpers which are used to overlap the memory accesses
+//! for batched operations.
+
+/// Issue a hint to bring the cacheline containing `ptr` into all levels of
+/// the cache. This never dereferences the pointer and is a no-op on
+/// architectures without a supported prefetch instruction.
+#[inline(always)]
+pub(crate) fn prefetch<T>(ptr: *const T) {
+    #[cfg(target_arch = "x86_64")]
+    // SAFETY: prefetch is only a hint and does not access the memory
+    unsafe {
+        core::arch::x86_64::_mm_prefetch(ptr as *const i8, core::arch::x86_64::_MM_HINT_T0);
+    }
+
+    #[cfg(target_arch = "aarch64")]
+    // SAFETY: prefetch is only a hint and does not access the memory
+    unsafe {
+        core::arch::asm!("prfm pldl1keep, [{0}]", in(reg) ptr, options(nostack, readonly, preserves_flags));
+    }
+
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+    let _ = ptr;
+}
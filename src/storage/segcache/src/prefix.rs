@@ -0,0 +1,127 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Optional compression of shared key prefixes.
+//!
+//! Keys often share a long prefix, such as `service:v3:user:`, which for small
+//! values is most of the item. With the `key-prefixes` feature, such prefixes
+//! may be registered with [`crate::Builder::key_prefixes`]. Every item then
+//! holds a prefix id in a byte ahead of its key. An item whose key starts with
+//! a registered prefix holds the id of the longest such prefix and only the
+//! rest of its key. Other items hold a zero id and their whole key.
+//!
+//! Ids are assigned in the order prefixes are first registered and are shared
+//! by every cache in the process, so an item can be read without reference to
+//! the cache which holds it. Prefixes are never unregistered and at most 255
+//! may be registered. A saved cache must be restored with the same prefixes,
+//! registered in the same order.
+//!
+//! Lookups compare the parts of the stored key with the key they are given,
+//! so they do not reassemble the key. Eviction, compaction and other paths
+//! which need the whole key, such as to hash it, reassemble it into a buffer.
+
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Mutex, OnceLock};
+
+/// The size of the prefix id held by each item in bytes
+pub const PREFIX_ID_SIZE: usize = std::mem::size_of::<u8>();
+
+/// The most prefixes which may be registered
+pub const MAX_PREFIXES: usize = u8::MAX as usize;
+
+// the registered prefixes, the prefix with id `n` is held at index `n - 1`
+static PREFIXES: [OnceLock<&'static [u8]>; MAX_PREFIXES] =
+    [const { OnceLock::new() }; MAX_PREFIXES];
+
+// the number of registered prefixes, which is only raised once the prefix is
+// set so that readers never see an unset prefix
+static REGISTERED: AtomicUsize = AtomicUsize::new(0);
+
+// serializes registration
+static REGISTER: Mutex<()> = Mutex::new(());
+
+/// Registers a prefix, returning its id. A prefix which is already registered
+/// keeps its id. Returns `None` if the prefix is too short to save any space
+/// or if the most prefixes are already registered.
+pub(crate) fn register(prefix: &[u8]) -> Option<u8> {
+    if prefix.len() <= PREFIX_ID_SIZE || prefix.len() > u8::MAX as usize {
+        return None;
+    }
+
+    let _guard = REGISTER.lock().unwrap_or_else(|e| e.into_inner());
+    let registered = REGISTERED.load(Ordering::Acquire);
+    if let Some(index) = PREFIXES[..registered]
+        .iter()
+        .position(|p| p.get().copied() == Some(prefix))
+    {
+        return Some(index as u8 + 1);
+    }
+    if registered == MAX_PREFIXES {
+        return None;
+    }
+
+    let prefix: &'static [u8] = Box::leak(Box::<[u8]>::from(prefix));
+    let _ = PREFIXES[registered].set(prefix);
+    REGISTERED.store(registered + 1, Ordering::Release);
+    Some(registered as u8 + 1)
+}
+
+/// Splits a key into the id of the longest registered prefix it starts with
+/// and the rest of the key. Keys which start with no registered prefix have a
+/// zero id and are returned whole. The rest of the key is never empty, as an
+/// empty key marks the end of the items in a segment.
+#[inline]
+pub(crate) fn split(key: &[u8]) -> (u8, &[u8]) {
+    let registered = REGISTERED.load(Ordering::Acquire);
+    let mut split = (0, key);
+    for (index, prefix) in PREFIXES[..registered].iter().enumerate() {
+        if let Some(rest) = prefix.get().and_then(|p| key.strip_prefix(*p)) {
+            if !rest.is_empty() && rest.len() < split.1.len() {
+                split = (index as u8 + 1, rest);
+            }
+        }
+    }
+    split
+}
+
+/// Returns the prefix with the provided id, which is empty for the zero id or
+/// for an id which is not registered
+#[inline]
+pub(crate) fn get(id: u8) -> &'static [u8] {
+    match id {
+        0 => &[],
+        id => PREFIXES[id as usize - 1].get().copied().unwrap_or(&[]),
+    }
+}
+
+/// Returns the number of bytes which the key takes in an item, including its
+/// prefix id
+#[inline]
+pub(crate) fn stored_len(key: &[u8]) -> usize {
+    PREFIX_ID_SIZE + split(key).1.len()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn split_longest() {
+        let short = register(b"prefix-test:").unwrap();
+        let long = register(b"prefix-test:user:").unwrap();
+        assert_eq!(register(b"prefix-test:"), Some(short));
+        assert_eq!(register(b"p"), None);
+
+        assert_eq!(split(b"prefix-test:user:42"), (long, &b"42"[..]));
+        assert_eq!(split(b"prefix-test:item:42"), (short, &b"item:42"[..]));
+        assert_eq!(split(b"other:42"), (0, &b"other:42"[..]));
+
+        // the rest of the key is never empty
+        assert_eq!(split(b"prefix-test:user:"), (short, &b"user:"[..]));
+
+        assert_eq!(get(long), b"prefix-test:user:");
+        assert_eq!(get(0), b"");
+        assert_eq!(stored_len(b"prefix-test:user:42"), 3);
+    }
+}
@@ -0,0 +1,163 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Iteration over the keys in the cache in bounded steps.
+//!
+//! A scan holds no state between steps, as the cursor which is returned by
+//! each step encodes the position of the next primary bucket. Each step only
+//! visits a bounded number of buckets, so that a scan of a large cache does
+//! not hold up other requests. As with the `SCAN` of Redis, a key which is
+//! held for the whole scan is returned at least once, and may be returned
+//! more than once if the hashtable grows during the scan.
+
+use crate::*;
+
+impl Segcache {
+    /// Appends the keys held in up to `count` buckets of the hashtable,
+    /// starting at the cursor, and returns the cursor for the next step. A
+    /// scan starts with a cursor of zero and has finished once a cursor of
+    /// zero is returned. Each bucket holds a handful of keys, so a step may
+    /// return more or fewer keys than the count, including none.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    /// cache.insert(b"tea", b"green", None, Duration::ZERO);
+    ///
+    /// let mut keys = Vec::new();
+    /// let mut cursor = 0;
+    /// loop {
+    ///     cursor = cache.scan(cursor, 100, &mut keys);
+    ///     if cursor == 0 {
+    ///         break;
+    ///     }
+    /// }
+    /// keys.sort();
+    /// assert_eq!(keys, vec![b"coffee".to_vec().into(), b"tea".to_vec().into()]);
+    /// ```
+    pub fn scan(&mut self, cursor: u64, count: usize, keys: &mut Vec<Box<[u8]>>) -> u64 {
+        #[cfg(feature = "metrics")]
+        SCAN.increment();
+
+        #[cfg(feature = "metrics")]
+        let len = keys.len();
+
+        let cursor = self.scan_items(cursor, count, |item| keys.push(item.key().into()));
+
+        #[cfg(feature = "metrics")]
+        SCAN_KEY.add((keys.len() - len) as _);
+
+        cursor
+    }
+
+    /// Calls `f` with each of the live items held in up to `count` buckets of
+    /// the hashtable, starting at the cursor, and returns the cursor for the
+    /// next step, as for [`Segcache::scan`]. This is used to sum up the
+    /// items of the cache in the background without copying their keys.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    ///
+    /// let mut bytes = 0;
+    /// let mut cursor = 0;
+    /// loop {
+    ///     cursor = cache.scan_items(cursor, 100, |item| bytes += item.key().len());
+    ///     if cursor == 0 {
+    ///         break;
+    ///     }
+    /// }
+    /// assert_eq!(bytes, 6);
+    /// ```
+    pub fn scan_items<F: FnMut(&Item)>(&mut self, cursor: u64, count: usize, mut f: F) -> u64 {
+        let mut items = Vec::new();
+        let cursor = self
+            .hashtable
+            .scan(cursor, count, &mut self.segments, |raw| {
+                // the chunks of large values are not keys of their own
+                if !raw.is_chunk() {
+                    items.push(Item::new(raw, 0));
+                }
+            });
+
+        let now = Instant::now();
+        for item in items {
+            if self.is_invalidated(&item) {
+                continue;
+            }
+            let live = match self.touched.deadline(item.key()) {
+                Some(Some(deadline)) => deadline > now,
+                Some(None) => true,
+                None => !self.is_stale(&item),
+            };
+            if live {
+                f(&item);
+            }
+        }
+
+        cursor
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::collections::HashSet;
+    use std::time::Duration;
+
+    #[test]
+    fn scan() {
+        let mut cache = Segcache::builder()
+            .segment_size(4096)
+            .heap_size(4096 * 256)
+            .hash_power(10)
+            .build()
+            .expect("failed to create cache");
+
+        let mut expected = HashSet::new();
+        for i in 0..200 {
+            let key = format!("key{i}");
+            assert!(cache
+                .insert(key.as_bytes(), b"value", None, Duration::ZERO)
+                .is_ok());
+            expected.insert(key.into_bytes().into_boxed_slice());
+        }
+
+        // every key is returned over the steps of a scan
+        let mut keys = Vec::new();
+        let mut cursor = 0;
+        let mut steps = 0;
+        loop {
+            cursor = cache.scan(cursor, 4, &mut keys);
+            steps += 1;
+            if cursor == 0 {
+                break;
+            }
+        }
+        assert!(steps > 1);
+        let keys: HashSet<Box<[u8]>> = keys.into_iter().collect();
+        assert_eq!(keys, expected);
+
+        // and deleted keys are not
+        cache.delete(b"key0");
+        let mut keys = Vec::new();
+        let mut cursor = 0;
+        loop {
+            cursor = cache.scan(cursor, 1000, &mut keys);
+            if cursor == 0 {
+                break;
+            }
+        }
+        assert_eq!(keys.len(), 199);
+        assert!(!keys.iter().any(|key| &**key == b"key0"));
+    }
+}
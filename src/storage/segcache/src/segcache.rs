@@ -4,11 +4,25 @@
 
 //! Core datastructure
 
+use crate::compaction::Compaction;
+use crate::large::Layout;
+use crate::namespace::Namespaces;
+use crate::stale::Stale;
+use crate::touch::Touched;
 use crate::Value;
 use crate::*;
+use datatier::{Datapool, MmapFile};
 use std::cmp::min;
+use std::path::PathBuf;
 
-const RESERVE_RETRIES: usize = 3;
+pub(crate) const RESERVE_RETRIES: usize = 3;
+
+// number of hashtable buckets to migrate on each call to expire while the
+// hashtable is growing
+const EXPIRE_MIGRATE_BUCKETS: usize = 256;
+
+// number of flushed segments to reclaim on each call to expire
+const EXPIRE_RECLAIM_SEGMENTS: usize = 16;
 
 /// A pre-allocated key-value store with eager expiration. It uses a
 /// segment-structured design that stores data in fixed-size segments, grouping
@@ -19,6 +33,19 @@ pub struct Segcache {
     pub(crate) segments: Segments,
     pub(crate) ttl_buckets: TtlBuckets,
     pub(crate) time: Instant,
+    pub(crate) metadata_path: Option<PathBuf>,
+    pub(crate) admission: Option<Admission>,
+    pub(crate) mrc: Option<Mrc>,
+    pub(crate) access: AccessStats,
+    pub(crate) free_reserve: usize,
+    pub(crate) compaction: Compaction,
+    pub(crate) large_values: bool,
+    pub(crate) large_id: u64,
+    pub(crate) touched: Touched,
+    pub(crate) stale: Stale,
+    pub(crate) namespaces: Namespaces,
+    #[cfg(feature = "compression")]
+    pub(crate) compressor: Option<Compressor>,
 }
 
 impl Segcache {
@@ -57,6 +84,89 @@ impl Segcache {
         self.segments.items()
     }
 
+    /// Returns a breakdown of the memory held by the `Segcache` instance, which
+    /// can be used to find the overhead of the hashtable and headers, and the
+    /// bytes lost to items which were replaced or removed. This walks all the
+    /// segment headers.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    /// assert_eq!(cache.memory_usage().items, 0);
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    /// let usage = cache.memory_usage();
+    /// assert_eq!(usage.items, 1);
+    /// assert!(usage.live > usage.item_headers());
+    /// assert_eq!(usage.dead(), 0);
+    /// ```
+    pub fn memory_usage(&self) -> MemoryUsage {
+        let mut usage = MemoryUsage {
+            hashtable: self.hashtable.size(),
+            ..Default::default()
+        };
+        self.segments.memory_usage(&mut usage);
+        usage
+    }
+
+    /// Returns a snapshot of the state of each segment held in memory, such as
+    /// its age, live bytes, and the number of merges into it, from which the
+    /// state of each ttl bucket and the utilization of the segments can be
+    /// found, along with the occupancy of the hashtable. This walks all the
+    /// segment headers.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    /// assert!(cache.segment_stats().ttl_buckets().is_empty());
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    /// let stats = cache.segment_stats();
+    /// let buckets = stats.ttl_buckets();
+    /// assert_eq!(buckets.len(), 1);
+    /// assert_eq!(buckets[0].live_items, 1);
+    /// assert_eq!(stats.free(), stats.segments.len() - 1);
+    /// ```
+    pub fn segment_stats(&self) -> SegmentStats {
+        let mut stats = self.segments.segment_stats();
+        stats.hashtable = self.hashtable.info();
+        stats
+    }
+
+    /// Returns the estimated hit ratio of an LRU cache of each of the sizes,
+    /// in bytes, over the recent reads. This is only available if the cache
+    /// was built with [`Builder::mrc`]. Estimates for the sizes in
+    /// [`MRC_SIZES`], in percent of the heap size, are also published as
+    /// metrics.
+    pub fn miss_ratio_curve(&self, sizes: &[usize]) -> Option<MissRatioCurve> {
+        self.mrc.as_ref().map(|mrc| mrc.curve(sizes))
+    }
+
+    /// Returns the number of lookups, hits, inserts, and deletes since the
+    /// cache was created.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    /// cache.get(b"coffee");
+    /// cache.get(b"tea");
+    ///
+    /// let access = cache.access_stats();
+    /// assert_eq!(access.inserts, 1);
+    /// assert_eq!(access.gets, 2);
+    /// assert_eq!(access.misses(), 1);
+    /// ```
+    pub fn access_stats(&self) -> AccessStats {
+        self.access
+    }
+
     /// Get the item in the `Segcache` with the provided key
     ///
     /// ```
@@ -71,7 +181,256 @@ impl Segcache {
     /// assert_eq!(item.value(), b"strong");
     /// ```
     pub fn get(&mut self, key: &[u8]) -> Option<Item> {
-        self.hashtable.get(key, self.time, &mut self.segments)
+        self.get_hashed(key, hash_key(key))
+    }
+
+    /// Get the item in the `Segcache` with the provided key, using the hash of
+    /// the key from [`hash_key`] rather than hashing it again. This allows the
+    /// key to be hashed once, such as when a request is parsed.
+    ///
+    /// ```
+    /// use segcache::{hash_key, Segcache};
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    ///
+    /// let hash = hash_key(b"coffee");
+    /// cache.prefetch_hashed(hash);
+    /// let item = cache.get_hashed(b"coffee", hash).expect("didn't get item back");
+    /// assert_eq!(item.value(), b"strong");
+    /// ```
+    pub fn get_hashed(&mut self, key: &[u8], hash: u64) -> Option<Item> {
+        if let Some(admission) = &mut self.admission {
+            admission.record(key);
+        }
+
+        let item = self
+            .hashtable
+            .get_hashed(key, hash, self.time, &mut self.segments)
+            .and_then(|item| self.unexpired(item))
+            .and_then(|item| self.assemble(item, true));
+        if let Some(mrc) = &mut self.mrc {
+            mrc.access(key, item.as_ref().map(|item| item.raw().size()), true);
+        }
+        self.access.gets += 1;
+        self.access.hits += item.is_some() as u64;
+
+        let item = item?;
+        if !self.segments.in_flash(&item) {
+            return Some(item);
+        }
+
+        let pinned = self.pin(&item);
+        self.promote(pinned);
+        self.get_no_freq_incr(key)
+    }
+
+    /// Prefetch the hashtable bucket for a key which is about to be looked up
+    /// or written. Prefetching every key of a batch of requests before
+    /// executing them allows the memory accesses to overlap.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    ///
+    /// cache.prefetch(b"coffee");
+    /// cache.prefetch(b"tea");
+    /// assert!(cache.get(b"coffee").is_some());
+    /// assert!(cache.get(b"tea").is_none());
+    /// ```
+    pub fn prefetch(&self, key: &[u8]) {
+        self.hashtable.prefetch(key);
+    }
+
+    /// Prefetch the hashtable bucket for a key by the hash of the key from
+    /// [`hash_key`], as for [`Segcache::prefetch`].
+    pub fn prefetch_hashed(&self, hash: u64) {
+        self.hashtable.prefetch_hashed(hash);
+    }
+
+    /// Get the items in the `Segcache` for multiple keys. This is equivalent
+    /// to calling `get` for each key, but the lookups are batched so that
+    /// their memory accesses overlap. The results are in the same order as the
+    /// keys.
+    ///
+    /// ```
+    /// use segcache::{Policy, Segcache};
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    /// cache.insert(b"tea", b"green", None, Duration::ZERO);
+    ///
+    /// let items = cache.get_many(&[b"coffee".as_slice(), b"juice", b"tea"]);
+    /// assert_eq!(items[0].as_ref().expect("didn't get item back").value(), b"strong");
+    /// assert!(items[1].is_none());
+    /// assert_eq!(items[2].as_ref().expect("didn't get item back").value(), b"green");
+    /// ```
+    pub fn get_many<K: AsRef<[u8]>>(&mut self, keys: &[K]) -> Vec<Option<Item>> {
+        let hashes: Vec<u64> = keys.iter().map(|key| hash_key(key.as_ref())).collect();
+        self.get_many_hashed(keys, &hashes)
+    }
+
+    /// Get the items in the `Segcache` for multiple keys along with the hash
+    /// of each key from [`hash_key`], as for [`Segcache::get_many`]. There must
+    /// be a hash for each key.
+    pub fn get_many_hashed<K: AsRef<[u8]>>(
+        &mut self,
+        keys: &[K],
+        hashes: &[u64],
+    ) -> Vec<Option<Item>> {
+        if let Some(admission) = &mut self.admission {
+            for key in keys {
+                admission.record(key.as_ref());
+            }
+        }
+
+        let mut items = self
+            .hashtable
+            .get_many_hashed(keys, hashes, self.time, &mut self.segments);
+        for item in items.iter_mut() {
+            if let Some(found) = item.take() {
+                *item = self
+                    .unexpired(found)
+                    .and_then(|found| self.assemble(found, true));
+            }
+        }
+        self.access.gets += keys.len() as u64;
+        self.access.hits += items.iter().flatten().count() as u64;
+        if let Some(mrc) = &mut self.mrc {
+            for (key, item) in keys.iter().zip(items.iter()) {
+                mrc.access(
+                    key.as_ref(),
+                    item.as_ref().map(|item| item.raw().size()),
+                    true,
+                );
+            }
+        }
+        if !items
+            .iter()
+            .flatten()
+            .any(|item| self.segments.in_flash(item))
+        {
+            return items;
+        }
+
+        // pin all of the flash items first, as promoting one item may cause
+        // the flash segment holding another to be reused
+        let pinned: Vec<PinnedItem> = items
+            .iter()
+            .flatten()
+            .filter(|item| self.segments.in_flash(item))
+            .map(|item| self.pin(item))
+            .collect();
+        for item in pinned {
+            self.promote(item);
+        }
+
+        keys.iter()
+            .map(|key| self.get_no_freq_incr(key.as_ref()))
+            .collect()
+    }
+
+    /// Moves an item which was read from the flash tier back into memory, as
+    /// it is likely to be read again. The item is pinned so that it can't be
+    /// overwritten while it is copied. If the item can't be promoted, it
+    /// remains in the flash tier.
+    fn promote(&mut self, item: PinnedItem) {
+        #[cfg(feature = "metrics")]
+        FLASH_HIT.increment();
+
+        // an expired item is left to be removed by expiration, as a zero ttl
+        // would instead keep it forever
+        let ttl = self.segments.flash_ttl(&item);
+        if ttl.as_secs() == 0 {
+            return;
+        }
+
+        let ttl = std::time::Duration::from_secs(ttl.as_secs() as u64);
+        if self
+            .insert(item.key(), item.value(), item.optional(), ttl)
+            .is_ok()
+        {
+            #[cfg(feature = "metrics")]
+            FLASH_PROMOTE.increment();
+        }
+    }
+
+    /// Pins an item which was returned by this cache. The returned
+    /// [`PinnedItem`] keeps the item readable after the cache has been
+    /// borrowed again, without copying the item, until it is dropped. This is
+    /// intended for handing values to another thread or holding them while a
+    /// response is written.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the item was not returned by this cache.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    ///
+    /// let item = cache.get(b"coffee").expect("didn't get item back");
+    /// let pinned = cache.pin(&item);
+    ///
+    /// // the pinned item remains valid even once the key is overwritten
+    /// cache.insert(b"coffee", b"decaf", None, Duration::ZERO);
+    /// assert_eq!(pinned.value(), b"strong");
+    /// ```
+    pub fn pin(&self, item: &Item) -> PinnedItem {
+        let mut pinned = self.segments.pin(item);
+        if let Some(value) = item.large() {
+            pinned.set_large(value.clone());
+        }
+        pinned
+    }
+
+    /// Returns the time until an item which was returned by this cache
+    /// expires. Items are expired along with the segment which holds them, so
+    /// this may be shorter than the TTL the item was stored with. Returns
+    /// `None` for items held in the longest TTL bucket, which is where items
+    /// stored without a TTL are held.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the item was not returned by this cache.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    /// cache.insert(b"coffee", b"strong", None, Duration::from_secs(60));
+    /// cache.insert(b"tea", b"green", None, Duration::ZERO);
+    ///
+    /// let item = cache.get(b"coffee").expect("didn't get item back");
+    /// assert!(cache.ttl(&item).unwrap() <= Duration::from_secs(60));
+    ///
+    /// let item = cache.get(b"tea").expect("didn't get item back");
+    /// assert!(cache.ttl(&item).is_none());
+    /// ```
+    pub fn ttl(&self, item: &Item) -> Option<std::time::Duration> {
+        if let Some(ttl) = self.touched_ttl(item) {
+            return ttl;
+        }
+        if let Some(ttl) = self.segments.segment_ttl(item) {
+            if self.ttl_buckets.is_longest(ttl) {
+                return None;
+            }
+        }
+        Some(std::time::Duration::from_secs(
+            self.segments.ttl(item).as_secs() as u64,
+        ))
     }
 
     /// Get the item in the `Segcache` with the provided key without
@@ -84,11 +443,15 @@ impl Segcache {
     /// assert!(cache.get_no_freq_incr(b"coffee").is_none());
     /// ```
     pub fn get_no_freq_incr(&mut self, key: &[u8]) -> Option<Item> {
-        self.hashtable.get_no_freq_incr(key, &mut self.segments)
+        let item = self.hashtable.get_no_freq_incr(key, &mut self.segments)?;
+        let item = self.unexpired(item)?;
+        self.assemble(item, false)
     }
 
     /// Insert a new item into the cache. May return an error indicating that
-    /// the insert was not successful.
+    /// the insert was not successful. If the cache was built with an admission
+    /// filter, new items for infrequently accessed keys are dropped without an
+    /// error while the cache is full, as if they were evicted immediately.
     /// ```
     /// use segcache::{Policy, Segcache};
     /// use std::time::Duration;
@@ -113,11 +476,101 @@ impl Segcache {
     ) -> Result<(), SegcacheError> {
         let value: Value = value.into();
 
+        // once there are no free segments, storing a new item will cause
+        // eviction, so new keys must first pass the admission filter. Keys
+        // which are already present are always admitted so that a stale value
+        // is never left in place of the new one.
+        if let Some(admission) = &mut self.admission {
+            if !admission.admit(key)
+                && self.segments.free() == 0
+                && self
+                    .hashtable
+                    .get_no_freq_incr(key, &mut self.segments)
+                    .is_none()
+            {
+                #[cfg(feature = "metrics")]
+                ADMISSION_REJECT.increment();
+
+                return Ok(());
+            }
+        }
+
+        // values which compress are stored in their compressed form
+        #[cfg(feature = "compression")]
+        let compressed = match (&mut self.compressor, &value) {
+            (Some(compressor), Value::Bytes(v)) => compressor.compress(v),
+            _ => None,
+        };
+        #[cfg(feature = "compression")]
+        let value = match &compressed {
+            Some(compressed) => Value::Bytes(compressed),
+            None => value,
+        };
+
+        #[cfg(feature = "compression")]
+        let compressed = compressed.is_some();
+        #[cfg(not(feature = "compression"))]
+        let compressed = false;
+
+        self.store(key, value, optional, ttl, compressed)
+    }
+
+    /// Stores the item in a segment and links it into the hashtable, evicting
+    /// if there are no free segments. The value is stored as it is, and is
+    /// marked as compressed if `compressed` is set.
+    pub(crate) fn store(
+        &mut self,
+        key: &[u8],
+        value: Value,
+        optional: Option<&[u8]>,
+        ttl: std::time::Duration,
+        compressed: bool,
+    ) -> Result<(), SegcacheError> {
+        self.store_as(key, value, optional, ttl, compressed, Layout::Whole)
+    }
+
+    /// Stores the item as with `store`, marking it with the layout of its
+    /// value. Values which don't fit in a segment are stored in chunks if the
+    /// cache was built with large values enabled.
+    pub(crate) fn store_as(
+        &mut self,
+        key: &[u8],
+        value: Value,
+        optional: Option<&[u8]>,
+        ttl: std::time::Duration,
+        compressed: bool,
+        layout: Layout,
+    ) -> Result<(), SegcacheError> {
+        // only builds with compression can have compressed values
+        #[cfg(not(feature = "compression"))]
+        let _ = compressed;
+
+        // the ttl as requested, for storing the value in chunks if it turns
+        // out to be too large for a segment
+        let requested_ttl = ttl;
+
+        // a new value for the key replaces any deadline set by a touch, and
+        // ends the lease to recompute it
+        self.touched.remove(key);
+        self.release(key);
+
         // default optional data is empty
         let optional = optional.unwrap_or(&[]);
 
         // calculate size for item
-        let size = (((ITEM_HDR_SIZE + key.len() + size_of(&value) + optional.len()) >> 3) + 1) << 3;
+        let stamp_size = match (layout, self.namespaces.stamp()) {
+            (Layout::Whole | Layout::Large, Some(_)) => STAMP_SIZE,
+            _ => 0,
+        };
+        let size =
+            (((ITEM_HDR_SIZE + key_size(key) + size_of(&value) + optional.len() + stamp_size)
+                >> 3)
+                + 1)
+                << 3;
+
+        if let Some(mrc) = &mut self.mrc {
+            mrc.access(key, Some(size), false);
+        }
 
         let ttl = Duration::from_secs(min(u32::MAX as u64, ttl.as_secs()) as u32);
 
@@ -125,17 +578,34 @@ impl Segcache {
         let mut retries = RESERVE_RETRIES;
         let reserved;
         loop {
-            match self
-                .ttl_buckets
-                .get_mut_bucket(ttl)
-                .reserve(size, &mut self.segments)
-            {
+            match self.ttl_buckets.reserve(ttl, size, &mut self.segments) {
                 Ok(mut reserved_item) => {
-                    reserved_item.define(key, value, optional);
+                    // the chunks of a large value are read through its
+                    // manifest, which holds the stamp
+                    let stamp = match layout {
+                        Layout::Chunk => None,
+                        Layout::Whole | Layout::Large => self.namespaces.stamp(),
+                    };
+                    reserved_item.define(key, value, optional, stamp);
+                    #[cfg(feature = "compression")]
+                    if compressed {
+                        reserved_item.set_compressed();
+                    }
+                    match layout {
+                        Layout::Whole => {}
+                        Layout::Large => reserved_item.set_large(),
+                        Layout::Chunk => reserved_item.set_chunk(),
+                    }
                     reserved = reserved_item;
                     break;
                 }
                 Err(TtlBucketsError::ItemOversized { size }) => {
+                    if let (true, Layout::Whole, Value::Bytes(value)) =
+                        (self.large_values, layout, value)
+                    {
+                        let optional = (!optional.is_empty()).then_some(optional);
+                        return self.store_large(key, value, optional, requested_ttl, compressed);
+                    }
                     return Err(SegcacheError::ItemOversized { size });
                 }
                 Err(TtlBucketsError::NoFreeSegments) => {
@@ -191,6 +661,7 @@ impl Segcache {
             );
             Err(SegcacheError::HashTableInsertEx)
         } else {
+            self.access.inserts += 1;
             Ok(())
         }
     }
@@ -257,8 +728,19 @@ impl Segcache {
     /// ```
     // TODO(bmartin): a result would be better here
     pub fn delete(&mut self, key: &[u8]) -> bool {
-        self.hashtable
-            .delete(key, &mut self.ttl_buckets, &mut self.segments)
+        if let Some(mrc) = &mut self.mrc {
+            mrc.remove(key);
+        }
+        if self.large_values {
+            self.remove_large(key);
+        }
+        self.touched.remove(key);
+        self.release(key);
+        let deleted = self
+            .hashtable
+            .delete(key, &mut self.ttl_buckets, &mut self.segments);
+        self.access.deletes += deleted as u64;
+        deleted
     }
 
     /// Loops through the TTL Buckets to handle eager expiration, returns the
@@ -284,14 +766,217 @@ impl Segcache {
     /// ```
     pub fn expire(&mut self) -> usize {
         self.time = Instant::now();
-        self.ttl_buckets
-            .expire(&mut self.hashtable, &mut self.segments)
+
+        // expiration is called periodically, so it is also used to drive the
+        // migration of hashtable buckets when the hashtable is growing
+        self.hashtable.migrate(
+            EXPIRE_MIGRATE_BUCKETS,
+            &mut self.ttl_buckets,
+            &mut self.segments,
+        );
+
+        // touched items are taken from their segments before they expire and
+        // stored again under the time remaining until their deadline
+        let mut expired = 0;
+        if self.ttl_buckets.is_due() {
+            let touched = self.take_touched();
+            expired += self.ttl_buckets.expire(
+                &mut self.hashtable,
+                &mut self.segments,
+                self.stale.grace(),
+            );
+            self.restore_touched(&touched);
+        }
+
+        expired
+            + self.ttl_buckets.reclaim(
+                &mut self.hashtable,
+                &mut self.segments,
+                EXPIRE_RECLAIM_SEGMENTS,
+            )
+            + self.segments.expire_flash(&mut self.hashtable)
     }
 
+    /// Performs background maintenance by evicting segments until the number
+    /// of free segments reaches the reserve which the cache was built with,
+    /// and by compacting mostly empty segments if the cache was built with a
+    /// compaction threshold. This is intended to be called periodically,
+    /// outside of the handling of requests, so that inserts can take a free
+    /// segment instead of evicting one themselves. Returns the number of
+    /// segments evicted or freed by compaction.
+    ///
+    /// ```
+    /// use segcache::{Policy, Segcache};
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder()
+    ///     .heap_size(64 * 4096)
+    ///     .segment_size(4096)
+    ///     .eviction(Policy::Fifo)
+    ///     .free_reserve(4)
+    ///     .build()
+    ///     .expect("failed to create cache");
+    ///
+    /// // with free segments available, there is nothing to do
+    /// assert_eq!(cache.maintain(), 0);
+    ///
+    /// // fill the cache so that all segments are in use
+    /// for i in 0..2048 {
+    ///     let key = format!("{i}");
+    ///     let _ = cache.insert(key.as_bytes(), &[0; 128][..], None, Duration::ZERO);
+    /// }
+    ///
+    /// // maintenance evicts segments to restore the reserve
+    /// assert!(cache.maintain() > 0);
+    /// ```
+    pub fn maintain(&mut self) -> usize {
+        let mut evicted = 0;
+        while self.segments.free() < self.free_reserve {
+            if self
+                .segments
+                .evict(&mut self.ttl_buckets, &mut self.hashtable)
+                .is_err()
+            {
+                break;
+            }
+            evicted += 1;
+        }
+
+        #[cfg(feature = "metrics")]
+        SEGMENT_EVICT_BACKGROUND.add(evicted as _);
+
+        evicted + self.compact()
+    }
+
+    /// Changes the eviction policy of the cache while it holds items, which
+    /// applies from the next eviction. Items already in the cache are kept.
+    ///
+    /// ```
+    /// use segcache::{Policy, Segcache};
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    /// cache.set_eviction(Policy::Fifo);
+    /// ```
+    pub fn set_eviction(&mut self, policy: Policy) {
+        self.segments.set_policy(policy);
+    }
+
+    /// Removes all items from the cache in constant time. The items are
+    /// treated as missing from then on, and the segments which hold them are
+    /// freed a few at a time by [`Segcache::expire`], or as they are needed
+    /// for new items. Unlike [`Segcache::clear`], this does not stall the
+    /// caller for the time it takes to free every segment. Items in the flash
+    /// tier are removed by the next call to expire.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    /// cache.flush();
+    /// assert!(cache.get(b"coffee").is_none());
+    ///
+    /// // items stored after the flush are kept
+    /// cache.insert(b"coffee", b"decaf", None, Duration::ZERO);
+    /// assert_eq!(cache.get(b"coffee").expect("not found").value(), b"decaf");
+    /// ```
+    pub fn flush(&mut self) {
+        self.time = Instant::now();
+        self.touched.clear();
+        self.stale.clear();
+        self.namespaces.clear();
+        self.segments.start_flush();
+    }
+
+    /// Removes all items from the cache and frees every segment before it
+    /// returns, returning the number of segments cleared. See
+    /// [`Segcache::flush`] for a variant which takes constant time.
     pub fn clear(&mut self) -> usize {
         self.time = Instant::now();
+        self.touched.clear();
+        self.stale.clear();
+        self.namespaces.clear();
         self.ttl_buckets
             .clear(&mut self.hashtable, &mut self.segments)
+            + self.segments.clear_flash(&mut self.hashtable)
+    }
+
+    /// Persists the cache so that it may be restored by a later instance
+    /// which is built with the same configuration. The segment data is flushed
+    /// to the datapool file and the hashtable, segment headers, and TTL
+    /// buckets are written to the metadata file. This is intended to be called
+    /// as part of a graceful shutdown, and does nothing if the cache was not
+    /// built with a metadata path.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let dir = tempfile::tempdir().expect("failed to create tempdir");
+    /// let builder = || {
+    ///     Segcache::builder()
+    ///         .datapool_path(Some(dir.path().join("datapool")))
+    ///         .metadata_path(Some(dir.path().join("metadata")))
+    /// };
+    ///
+    /// let mut cache = builder().build().expect("failed to create cache");
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    /// cache.persist().expect("failed to persist cache");
+    /// drop(cache);
+    ///
+    /// let mut cache = builder().build().expect("failed to restore cache");
+    /// let item = cache.get(b"coffee").expect("didn't get item back");
+    /// assert_eq!(item.value(), b"strong");
+    /// ```
+    pub fn persist(&mut self) -> Result<(), std::io::Error> {
+        let path = match &self.metadata_path {
+            Some(path) => path,
+            None => return Ok(()),
+        };
+
+        // a flash tier held in memory is not saved, so its items are removed
+        // before the hashtable which refers to them is saved
+        if self.segments.has_volatile_flash() {
+            self.segments.clear_flash(&mut self.hashtable);
+        }
+
+        // finish any resize so only the current table needs to be saved
+        while self.hashtable.is_resizing() {
+            self.hashtable
+                .migrate(usize::MAX, &mut self.ttl_buckets, &mut self.segments);
+        }
+
+        // and free any flushed segments, as the flush epoch is not saved
+        self.ttl_buckets
+            .reclaim(&mut self.hashtable, &mut self.segments, usize::MAX);
+
+        // the data is flushed first, the metadata is only valid once the data
+        // it refers to is durable
+        self.segments.flush()?;
+
+        let size = PREAMBLE_SIZE
+            + self.hashtable.metadata_size()
+            + self.segments.metadata_size()
+            + self.ttl_buckets.metadata_size();
+
+        if path.exists() {
+            std::fs::remove_file(path)?;
+        }
+
+        let mut metadata = MmapFile::create(path, size, crate::VERSION)?;
+        {
+            let mut writer = MetadataWriter::new(metadata.as_mut_slice())?;
+            self.hashtable.save(&mut writer)?;
+            self.segments.save(&mut writer)?;
+            self.ttl_buckets.save(&mut writer)?;
+        }
+        metadata.flush()?;
+
+        debug!("persisted {} bytes of metadata to {:?}", size, path);
+
+        Ok(())
     }
 
     /// Checks the integrity of all segments
@@ -305,27 +990,176 @@ impl Segcache {
         }
     }
 
-    /// Perform a wrapping addition on the value stored at the supplied key.
-    /// Returns an error if the key is invalid, the item is not found, or the
-    /// stored value is not a numeric type.
-    pub fn wrapping_add(&mut self, key: &[u8], rhs: u64) -> Result<Item, SegcacheError> {
+    /// Overwrite part of the value stored at the supplied key in place, which
+    /// keeps the TTL of the item. This allows a change that does not alter the
+    /// size of a value to be made without storing a new copy of the item.
+    /// Returns an error if the item is not found, or if its value cannot be
+    /// written in place because it is numeric, compressed, held in flash or
+    /// referenced by a pinned item, or because the bytes do not fit within it.
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// cache.insert(b"drink", b"coffee", None, Duration::ZERO);
+    /// cache.overwrite(b"drink", 1, b"ak").expect("failed to overwrite");
+    /// let item = cache.get(b"drink").expect("didn't get item back");
+    /// assert_eq!(item.value(), b"cakfee");
+    ///
+    /// assert!(cache.overwrite(b"drink", 5, b"ee").is_err());
+    /// ```
+    pub fn overwrite(
+        &mut self,
+        key: &[u8],
+        offset: usize,
+        bytes: &[u8],
+    ) -> Result<(), SegcacheError> {
         let mut item = self
             .hashtable
-            .get(key, self.time, &mut self.segments)
+            .get_no_freq_incr(key, &mut self.segments)
+            .and_then(|item| self.unexpired(item))
             .ok_or(SegcacheError::NotFound)?;
-        item.wrapping_add(rhs)?;
-        Ok(item)
+        if self.segments.is_pinned(&item) {
+            return Err(SegcacheError::NotWritable);
+        }
+        item.overwrite(offset, bytes)?;
+        // copies of the item held by the hashtable are made with the CAS
+        // value, so changing it keeps them from being read
+        self.hashtable.bump_cas(key, &mut self.segments);
+        Ok(())
+    }
+
+    /// Appends the bytes to the value stored at the supplied key. The value
+    /// is extended in place if its item is the last written to its segment
+    /// and the segment has room for it to grow, and is otherwise stored again
+    /// as a copy with the same ttl and optional data. Returns an error if the
+    /// item is not found or the stored value is numeric.
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// cache.insert(b"drink", b"coffee", None, Duration::ZERO);
+    /// cache.append(b"drink", b" with milk").expect("failed to append");
+    /// cache.prepend(b"drink", b"iced ").expect("failed to prepend");
+    /// let item = cache.get(b"drink").expect("didn't get item back");
+    /// assert_eq!(item.value(), b"iced coffee with milk");
+    /// ```
+    pub fn append(&mut self, key: &[u8], bytes: &[u8]) -> Result<(), SegcacheError> {
+        self.extend(key, bytes, false)
+    }
+
+    /// Prepends the bytes to the value stored at the supplied key, in place
+    /// when possible as for `append`. Returns an error if the item is not
+    /// found or the stored value is numeric.
+    pub fn prepend(&mut self, key: &[u8], bytes: &[u8]) -> Result<(), SegcacheError> {
+        self.extend(key, bytes, true)
+    }
+
+    fn extend(&mut self, key: &[u8], bytes: &[u8], front: bool) -> Result<(), SegcacheError> {
+        let item = self
+            .hashtable
+            .get_no_freq_incr(key, &mut self.segments)
+            .and_then(|item| self.unexpired(item))
+            .ok_or(SegcacheError::NotFound)?;
+
+        let mut raw = item.raw();
+        if raw.is_extensible(bytes.len()) && self.segments.grow(&item, bytes.len()) {
+            // this is safe because the segment now has room for the larger
+            // item
+            unsafe { raw.extend(bytes, front) };
+            self.hashtable.bump_cas(key, &mut self.segments);
+
+            #[cfg(feature = "metrics")]
+            ITEM_UPDATE_INPLACE.increment();
+
+            return Ok(());
+        }
+
+        let item = self.assemble(item, false).ok_or(SegcacheError::NotFound)?;
+        let value = match item.value() {
+            Value::Bytes(value) => {
+                let mut extended = Vec::with_capacity(value.len() + bytes.len());
+                if front {
+                    extended.extend_from_slice(bytes);
+                    extended.extend_from_slice(value);
+                } else {
+                    extended.extend_from_slice(value);
+                    extended.extend_from_slice(bytes);
+                }
+                extended
+            }
+            Value::U64(_) => return Err(SegcacheError::NotNumeric),
+        };
+
+        self.store_copy(key, &item, Value::Bytes(&value))
+    }
+
+    /// Perform a wrapping addition on the value stored at the supplied key.
+    /// The counter is updated in place, unless its item is held in the flash
+    /// tier or referenced by a pinned item, in which case the new value is
+    /// stored as a copy with the same ttl and optional data. Returns an error
+    /// if the key is invalid, the item is not found, or the stored value is
+    /// not a numeric type.
+    pub fn wrapping_add(&mut self, key: &[u8], rhs: u64) -> Result<Item, SegcacheError> {
+        self.update_numeric(key, |v| v.wrapping_add(rhs))
     }
 
     /// Perform a saturating subtraction on the value stored at the supplied
-    /// key. Returns an error if the key is invalid, the item is not found, or
-    /// the stored value is not a numeric type.
+    /// key, in place when possible as for `wrapping_add`. Returns an error if
+    /// the key is invalid, the item is not found, or the stored value is not
+    /// a numeric type.
     pub fn saturating_sub(&mut self, key: &[u8], rhs: u64) -> Result<Item, SegcacheError> {
-        let mut item = self
+        self.update_numeric(key, |v| v.saturating_sub(rhs))
+    }
+
+    fn update_numeric(
+        &mut self,
+        key: &[u8],
+        update: impl Fn(u64) -> u64,
+    ) -> Result<Item, SegcacheError> {
+        let item = self
             .hashtable
             .get(key, self.time, &mut self.segments)
+            .and_then(|item| self.unexpired(item))
             .ok_or(SegcacheError::NotFound)?;
-        item.saturating_sub(rhs)?;
-        Ok(item)
+        let value = match item.value() {
+            Value::U64(value) => update(value),
+            Value::Bytes(_) => return Err(SegcacheError::NotNumeric),
+        };
+
+        if !self.segments.is_pinned(&item) {
+            item.raw().set_u64(value);
+            let cas = self.hashtable.bump_cas(key, &mut self.segments);
+
+            #[cfg(feature = "metrics")]
+            ITEM_UPDATE_INPLACE.increment();
+
+            return Ok(Item::new(item.raw(), cas));
+        }
+
+        self.store_copy(key, &item, Value::U64(value))?;
+        self.hashtable
+            .get_no_freq_incr(key, &mut self.segments)
+            .ok_or(SegcacheError::NotFound)
+    }
+
+    /// Stores a new value for an item which cannot be updated in place,
+    /// keeping its ttl and optional data.
+    fn store_copy(&mut self, key: &[u8], item: &Item, value: Value) -> Result<(), SegcacheError> {
+        // an item close to expiry keeps at least a second, since a zero ttl
+        // would store the copy without any expiry at all
+        let ttl = self
+            .ttl(item)
+            .map(|ttl| ttl.max(std::time::Duration::from_secs(1)))
+            .unwrap_or(std::time::Duration::ZERO);
+        let optional = item.optional().map(|optional| optional.to_vec());
+
+        #[cfg(feature = "metrics")]
+        ITEM_UPDATE_COPY.increment();
+
+        self.insert(key, value, optional.as_deref(), ttl)
     }
 }
@@ -0,0 +1,118 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! A snapshot of the state of the segments of a cache.
+
+use crate::HashtableInfo;
+use std::collections::BTreeMap;
+
+/// The number of buckets of [`SegmentStats::utilization`], each covering an
+/// equal share of the segment size.
+pub const UTILIZATION_BUCKETS: usize = 10;
+
+/// The state of a segment at the time of a [`SegmentStats`] snapshot.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub struct SegmentInfo {
+    /// The id of the segment.
+    pub id: u32,
+    /// The TTL of the segment, and of its ttl bucket, in seconds.
+    pub ttl: u32,
+    /// Seconds since the segment was taken from the free queue.
+    pub age: u32,
+    /// Seconds since the segment was last merged into, or taken from the free
+    /// queue.
+    pub merge_age: u32,
+    /// Bytes written into the segment since it was last reset.
+    pub write_offset: usize,
+    /// Bytes of the live items, including their headers and padding.
+    pub live_bytes: usize,
+    /// Number of live items.
+    pub live_items: usize,
+    /// Number of merges into the segment since it was taken from the free
+    /// queue.
+    pub merges: u16,
+    /// Whether items in the segment may be read.
+    pub accessible: bool,
+    /// Whether the segment may be evicted.
+    pub evictable: bool,
+}
+
+impl SegmentInfo {
+    /// Whether the segment is on the free queue rather than in a ttl bucket.
+    pub fn is_free(&self) -> bool {
+        !self.accessible && !self.evictable
+    }
+}
+
+/// The segments of a ttl bucket, summed up.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct TtlBucketInfo {
+    /// The TTL of the bucket in seconds.
+    pub ttl: u32,
+    /// Number of segments in the bucket.
+    pub segments: usize,
+    /// Bytes written into the segments of the bucket.
+    pub written: usize,
+    /// Bytes of the live items of the bucket.
+    pub live_bytes: usize,
+    /// Number of live items in the bucket.
+    pub live_items: usize,
+    /// Number of merges into the segments of the bucket.
+    pub merges: usize,
+}
+
+/// The state of every segment held in memory by a [`crate::Segcache`], as
+/// returned by [`crate::Segcache::segment_stats`], which can be used to see
+/// how fragmented the segments are and to tune the segment size and the
+/// eviction policy.
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct SegmentStats {
+    /// Size of each segment in bytes.
+    pub segment_size: usize,
+    /// Every segment, in the order of their ids.
+    pub segments: Vec<SegmentInfo>,
+    /// The occupancy of the hashtable.
+    pub hashtable: HashtableInfo,
+}
+
+impl SegmentStats {
+    /// Number of segments on the free queue.
+    pub fn free(&self) -> usize {
+        self.segments.iter().filter(|s| s.is_free()).count()
+    }
+
+    /// The segments of each ttl bucket which holds any, in the order of their
+    /// TTL.
+    pub fn ttl_buckets(&self) -> Vec<TtlBucketInfo> {
+        let mut buckets: BTreeMap<u32, TtlBucketInfo> = BTreeMap::new();
+        for segment in self.segments.iter().filter(|s| !s.is_free()) {
+            let bucket = buckets.entry(segment.ttl).or_insert(TtlBucketInfo {
+                ttl: segment.ttl,
+                ..Default::default()
+            });
+            bucket.segments += 1;
+            bucket.written += segment.write_offset;
+            bucket.live_bytes += segment.live_bytes;
+            bucket.live_items += segment.live_items;
+            bucket.merges += segment.merges as usize;
+        }
+        buckets.into_values().collect()
+    }
+
+    /// A histogram of the share of each segment held by live items, over the
+    /// segments in ttl buckets. Bucket `i` counts the segments which are at
+    /// least `i / UTILIZATION_BUCKETS` and less than `(i + 1) /
+    /// UTILIZATION_BUCKETS` live, the last bucket also counts full segments.
+    pub fn utilization(&self) -> [usize; UTILIZATION_BUCKETS] {
+        let mut histogram = [0; UTILIZATION_BUCKETS];
+        if self.segment_size == 0 {
+            return histogram;
+        }
+        for segment in self.segments.iter().filter(|s| !s.is_free()) {
+            let bucket = segment.live_bytes * UTILIZATION_BUCKETS / self.segment_size;
+            histogram[bucket.min(UTILIZATION_BUCKETS - 1)] += 1;
+        }
+        histogram
+    }
+}
@@ -8,14 +8,22 @@ use crate::eviction::*;
 use crate::item::*;
 use crate::segments::*;
 
+use datatier::HugePages;
 use std::path::{Path, PathBuf};
 
 /// The `SegmentsBuilder` allows for the configuration of the segment storage.
+#[derive(Clone)]
 pub(crate) struct SegmentsBuilder {
-    pub(super) heap_size: usize,
+    pub(crate) heap_size: usize,
     pub(super) segment_size: i32,
     pub(super) evict_policy: Policy,
-    pub(super) datapool_path: Option<PathBuf>,
+    pub(crate) datapool_path: Option<PathBuf>,
+    pub(crate) numa_node: Option<usize>,
+    pub(crate) huge_pages: HugePages,
+    pub(crate) flash_path: Option<PathBuf>,
+    pub(crate) flash_size: usize,
+    pub(crate) flash_node: Option<usize>,
+    pub(crate) flash_age: Option<Duration>,
 }
 
 impl Default for SegmentsBuilder {
@@ -25,6 +33,12 @@ impl Default for SegmentsBuilder {
             heap_size: 64 * 1024 * 1024,
             evict_policy: Policy::Random,
             datapool_path: None,
+            numa_node: None,
+            huge_pages: HugePages::Disabled,
+            flash_path: None,
+            flash_size: 0,
+            flash_node: None,
+            flash_age: None,
         }
     }
 }
@@ -70,8 +84,56 @@ impl SegmentsBuilder {
         self
     }
 
+    /// Specify a NUMA node on which to place the heap when it is held in
+    /// memory.
+    pub fn numa_node(mut self, node: Option<usize>) -> Self {
+        self.numa_node = node;
+        self
+    }
+
+    /// Specify the size of the pages which back the heap when it is held in
+    /// memory.
+    pub fn huge_pages(mut self, huge_pages: HugePages) -> Self {
+        self.huge_pages = huge_pages;
+        self
+    }
+
+    /// Specify a file to be created for a flash tier of segments, which holds
+    /// items after they are evicted from the heap.
+    pub fn flash_path<T: AsRef<Path>>(mut self, path: Option<T>) -> Self {
+        self.flash_path = path.map(|p| p.as_ref().to_owned());
+        self
+    }
+
+    /// Specify the size in bytes of the flash tier. The size will be divided
+    /// by the segment size to determine the number of flash segments.
+    pub fn flash_size(mut self, bytes: usize) -> Self {
+        self.flash_size = bytes;
+        self
+    }
+
+    /// Specify a NUMA node, such as that of a CXL memory expander, on which
+    /// to hold the flash tier in memory when no flash path is provided.
+    pub fn flash_node(mut self, node: Option<usize>) -> Self {
+        self.flash_node = node;
+        self
+    }
+
+    /// Specify the age past which merge eviction moves a segment into the
+    /// flash tier whole, rather than merging its items into younger segments.
+    pub fn flash_age(mut self, age: Option<Duration>) -> Self {
+        self.flash_age = age;
+        self
+    }
+
     /// Construct the [`Segments`] from the builder
     pub fn build(self) -> Result<Segments, std::io::Error> {
         Segments::from_builder(self)
     }
+
+    /// Construct the [`Segments`] from the builder by opening the existing
+    /// datapool file and restoring the segment headers from the metadata.
+    pub fn restore(self, reader: &mut MetadataReader) -> Result<Segments, std::io::Error> {
+        Segments::restore(self, reader)
+    }
 }
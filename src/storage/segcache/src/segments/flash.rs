@@ -0,0 +1,503 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! A second tier of segments which is backed by a file, typically on flash
+//! storage, and which holds items after they are evicted from memory.
+//!
+//! Flash segments are numbered after the in-memory segments, so the hashtable
+//! refers to items in either tier in the same way. Evicted items are appended
+//! to the current flash segment and relinked in the hashtable. When the
+//! current segment is full, the next segment in the ring is cleared, evicting
+//! its items from the cache entirely, and writing continues there. This keeps
+//! writes to the file sequential and segment-sized.
+//!
+//! Flash segments are not part of the TTL buckets. Each flash segment expires
+//! at the earliest expiry of the segments its items were moved from, so items
+//! may expire early but never late.
+//!
+//! Each flash segment has a bloom filter in memory of the hashes of the keys
+//! written to it, which is cleared along with the segment and rebuilt when the
+//! tier is restored. A lookup checks the filter before reading an item from a
+//! flash segment, so that a key which only shares its tag with an item there
+//! is a miss without reading from the file.
+//!
+//! The tier may instead be held in memory on a NUMA node, such as the node of
+//! a CXL memory expander which extends the host with slower, far memory. The
+//! tier is then lost on a restart, so its items are removed before the cache
+//! is persisted. With an age set, merge eviction moves a segment which is
+//! older than the age into the tier whole, so that the heap holds the new and
+//! recently read items and only reads of the cold ones go to far memory.
+
+use crate::segments::*;
+use bloom::BlockedBloomFilter;
+use core::mem::ManuallyDrop;
+use core::num::NonZeroU32;
+use datatier::*;
+use std::path::Path;
+
+// the size of the bloom filter of each flash segment, which allows for items
+// as small as 64 bytes with a false positive rate of around 2%
+const FILTER_BYTES_PER_BIT: usize = 8;
+const FILTER_HASHES: usize = 4;
+
+/// Returns the pair of bloom filter hashes for the hash of a key. The block of
+/// the filter is picked from the bits below the tag, as keys which collide in
+/// the hashtable share their tag and bucket bits.
+fn filter_hashes(hash: u64) -> (u64, u64) {
+    (hash.rotate_left(12), hash)
+}
+
+/// The flash tier, which is a ring of segments backed by a file.
+pub(crate) struct Flash {
+    /// Headers for the flash segments
+    headers: Box<[SegmentHeader]>,
+    /// Bloom filters of the hashes of the keys in each flash segment
+    filters: Box<[BlockedBloomFilter]>,
+    /// The file backed segment data, which is leaked instead of dropped if any
+    /// segments are still pinned
+    data: ManuallyDrop<Box<dyn Datapool>>,
+    /// Segment size in bytes
+    segment_size: i32,
+    /// Number of in-memory segments, flash segment ids follow on from these
+    base: u32,
+    /// Index of the segment which items are currently moved into
+    current: u32,
+    /// True if the tier is held in memory, and so not restored
+    volatile: bool,
+    /// Age past which merge eviction moves in-memory segments into the tier
+    age: Option<Duration>,
+}
+
+impl Flash {
+    /// Creates a new flash tier in a file at the provided path. The number of
+    /// segments is determined by the size, and the segment ids start after the
+    /// `base` in-memory segments.
+    pub fn create<T: AsRef<Path>>(
+        path: T,
+        size: usize,
+        segment_size: i32,
+        base: u32,
+    ) -> Result<Self, std::io::Error> {
+        let segments = Self::segments(size, segment_size, base)?;
+
+        let data: Box<dyn Datapool> = Box::new(MmapFile::create(
+            path,
+            segments * segment_size as usize,
+            crate::VERSION,
+        )?);
+
+        Ok(Self::with_data(data, segments, segment_size, base, false))
+    }
+
+    /// Creates a new flash tier held in memory on the provided NUMA node. The
+    /// number of segments is determined by the size, and the segment ids start
+    /// after the `base` in-memory segments.
+    pub fn create_on_node(
+        size: usize,
+        segment_size: i32,
+        base: u32,
+        node: usize,
+    ) -> Result<Self, std::io::Error> {
+        let segments = Self::segments(size, segment_size, base)?;
+
+        let data: Box<dyn Datapool> = Box::new(Memory::create_on_node(
+            segments * segment_size as usize,
+            node,
+        )?);
+
+        debug!("flash segments held in memory on NUMA node: {}", node);
+
+        Ok(Self::with_data(data, segments, segment_size, base, true))
+    }
+
+    /// Initializes the flash segments in the data.
+    fn with_data(
+        mut data: Box<dyn Datapool>,
+        segments: usize,
+        segment_size: i32,
+        base: u32,
+        volatile: bool,
+    ) -> Self {
+        let mut headers = Vec::with_capacity(0);
+        headers.reserve_exact(segments);
+        for idx in 0..segments {
+            // safety: ids start after the in-memory segments so are non-zero
+            let id = unsafe { NonZeroU32::new_unchecked(base + idx as u32 + 1) };
+            let mut header = SegmentHeader::new(id);
+
+            let begin = segment_size as usize * idx;
+            let end = begin + segment_size as usize;
+            Segment::from_raw_parts(&mut header, &mut data.as_mut_slice()[begin..end]).init();
+
+            headers.push(header);
+        }
+
+        debug!("flash segments: {}", segments);
+
+        #[cfg(feature = "metrics")]
+        FLASH_SEGMENT_CURRENT.set(segments as _);
+
+        Self {
+            headers: headers.into_boxed_slice(),
+            filters: Self::filters(segments, segment_size),
+            data: ManuallyDrop::new(data),
+            segment_size,
+            base,
+            current: 0,
+            volatile,
+            age: None,
+        }
+    }
+
+    /// Restores the flash tier from the metadata saved on a graceful shutdown
+    /// by opening the existing file at the provided path.
+    pub fn restore<T: AsRef<Path>>(
+        path: T,
+        size: usize,
+        segment_size: i32,
+        base: u32,
+        reader: &mut MetadataReader,
+    ) -> Result<Self, std::io::Error> {
+        let segments = Self::segments(size, segment_size, base)?;
+
+        let current = reader.get_u32()?;
+        if reader.get_u32()? as usize != segments || current as usize >= segments {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::Other,
+                "flash configuration does not match saved segments",
+            ));
+        }
+
+        let mut headers = Vec::with_capacity(0);
+        headers.reserve_exact(segments);
+        for idx in 0..segments {
+            // safety: ids start after the in-memory segments so are non-zero
+            let id = unsafe { NonZeroU32::new_unchecked(base + idx as u32 + 1) };
+            headers.push(SegmentHeader::restore(id, reader)?);
+        }
+
+        let data: Box<dyn Datapool> = Box::new(MmapFile::open(
+            path,
+            segments * segment_size as usize,
+            crate::VERSION,
+        )?);
+
+        #[cfg(feature = "metrics")]
+        FLASH_SEGMENT_CURRENT.set(segments as _);
+
+        let mut flash = Self {
+            headers: headers.into_boxed_slice(),
+            filters: Self::filters(segments, segment_size),
+            data: ManuallyDrop::new(data),
+            segment_size,
+            base,
+            current,
+            volatile: false,
+            age: None,
+        };
+
+        // the filters are rebuilt from the keys of the items in each segment,
+        // see `recycle` for the segments which must not be scanned
+        for idx in 0..segments {
+            if flash.headers[idx].write_offset() > start_offset() {
+                let begin = segment_size as usize * idx;
+                let end = begin + segment_size as usize;
+                let mut segment = Segment::from_raw_parts(
+                    &mut flash.headers[idx],
+                    &mut flash.data.as_mut_slice()[begin..end],
+                );
+                let filter = &mut flash.filters[idx];
+                segment.keys(|key| {
+                    let (hash1, hash2) = filter_hashes(storage_types::hash_key(key));
+                    filter.insert(hash1, hash2);
+                });
+            }
+        }
+
+        Ok(flash)
+    }
+
+    /// Returns an empty bloom filter for each flash segment.
+    fn filters(segments: usize, segment_size: i32) -> Box<[BlockedBloomFilter]> {
+        let bits = segment_size as usize / FILTER_BYTES_PER_BIT;
+        vec![BlockedBloomFilter::new(bits, FILTER_HASHES); segments].into_boxed_slice()
+    }
+
+    /// Sets the age past which merge eviction moves in-memory segments into
+    /// the tier whole.
+    pub fn with_age(mut self, age: Option<Duration>) -> Self {
+        self.age = age;
+        self
+    }
+
+    /// Returns true if the tier is held in memory, so its items are lost
+    /// when the cache is restarted.
+    pub fn is_volatile(&self) -> bool {
+        self.volatile
+    }
+
+    /// Returns true if the in-memory segment is older than the age past which
+    /// it is moved into the tier whole.
+    pub fn is_aged(&self, segment: &Segment) -> bool {
+        self.age
+            .map(|age| segment.create_at() + age <= Instant::now())
+            .unwrap_or(false)
+    }
+
+    /// Returns the number of flash segments for the size, checking that they
+    /// can be addressed by the hashtable.
+    fn segments(size: usize, segment_size: i32, base: u32) -> Result<usize, std::io::Error> {
+        let segments = size / segment_size as usize;
+        if segments == 0 || base as usize + segments >= MAX_SEGMENTS {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::InvalidInput,
+                "flash size must hold at least one segment and in total there must be fewer segments than the hashtable can address",
+            ));
+        }
+        Ok(segments)
+    }
+
+    /// Returns the number of bytes needed to save the flash metadata.
+    pub fn metadata_size(&self) -> usize {
+        2 * core::mem::size_of::<u32>() + self.headers.len() * SegmentHeader::METADATA_SIZE
+    }
+
+    /// Saves the flash segment headers into the metadata.
+    pub fn save(&self, writer: &mut MetadataWriter) -> Result<(), std::io::Error> {
+        writer.put_u32(self.current)?;
+        writer.put_u32(self.headers.len() as u32)?;
+        for header in self.headers.iter() {
+            header.save(writer)?;
+        }
+        Ok(())
+    }
+
+    /// Flushes the segment data to the file.
+    pub fn flush(&mut self) -> Result<(), std::io::Error> {
+        self.data.flush()
+    }
+
+    /// Returns true if the segment id refers to a flash segment.
+    #[inline]
+    pub fn contains(&self, id: NonZeroU32) -> bool {
+        id.get() > self.base && ((id.get() - self.base) as usize) <= self.headers.len()
+    }
+
+    /// Returns a mutable `Segment` view for the flash segment at the index.
+    fn segment(&mut self, idx: usize) -> Segment {
+        let begin = self.segment_size as usize * idx;
+        let end = begin + self.segment_size as usize;
+        let segment = Segment::from_raw_parts(
+            &mut self.headers[idx],
+            &mut self.data.as_mut_slice()[begin..end],
+        );
+        segment.check_magic();
+        segment
+    }
+
+    /// Returns a mutable `Segment` view for the flash segment with the id.
+    pub fn get_mut(&mut self, id: NonZeroU32) -> Result<Segment, SegmentsError> {
+        if self.contains(id) {
+            Ok(self.segment((id.get() - self.base) as usize - 1))
+        } else {
+            Err(SegmentsError::BadSegmentId)
+        }
+    }
+
+    /// Returns the index of the flash segment which holds the item, if any.
+    fn index_of(&self, item: &Item) -> Option<usize> {
+        let base = self.data.as_slice().as_ptr() as usize;
+        let offset = (item.raw().as_ptr() as usize).checked_sub(base)?;
+        let idx = offset / self.segment_size as usize;
+        if idx < self.headers.len() {
+            Some(idx)
+        } else {
+            None
+        }
+    }
+
+    /// Returns false if the flash segment with the id definitely does not hold
+    /// an item with the key for the hash, as returned by
+    /// [`storage_types::hash_key`].
+    #[inline]
+    pub fn may_hold(&self, id: NonZeroU32, hash: u64) -> bool {
+        if !self.contains(id) {
+            return false;
+        }
+        let (hash1, hash2) = filter_hashes(hash);
+        self.filters[(id.get() - self.base) as usize - 1].contains(hash1, hash2)
+    }
+
+    /// Returns true if the item is held in a flash segment.
+    pub fn holds(&self, item: &Item) -> bool {
+        self.index_of(item).is_some()
+    }
+
+    /// Pins the item if it is held in a flash segment.
+    pub fn pin(&self, item: &Item) -> Option<PinnedItem> {
+        let idx = self.index_of(item)?;
+        Some(PinnedItem::new(
+            Item::new(item.raw(), item.cas()),
+            self.headers[idx].pin(),
+        ))
+    }
+
+    /// Returns the time until the flash segment holding the item expires.
+    pub fn ttl(&self, item: &Item) -> Duration {
+        let now = Instant::now();
+        match self.index_of(item).map(|idx| &self.headers[idx]) {
+            Some(header) if header.create_at() + header.ttl() > now => {
+                header.create_at() + header.ttl() - now
+            }
+            _ => Duration::from_secs(0),
+        }
+    }
+
+    /// Moves the live item at the offset in the in-memory segment into the
+    /// flash tier. Returns false if the item could not be moved, in which case
+    /// it remains in the source segment.
+    pub fn demote(&mut self, src: &mut Segment, offset: usize, hashtable: &mut HashTable) -> bool {
+        let item = src.get_item_at(offset).unwrap();
+        let size = item.size();
+        let (hash1, hash2) = filter_hashes(storage_types::hash_key(&item.key()));
+
+        let current = self.current as usize;
+        if self.headers[current].write_offset() as usize + size >= self.segment_size as usize
+            && !self.advance(hashtable)
+        {
+            return false;
+        }
+
+        let expire_at = src.create_at() + src.ttl();
+
+        let mut dst = self.segment(self.current as usize);
+        if !src.move_item(offset, &mut dst, hashtable) {
+            return false;
+        }
+        self.filters[self.current as usize].insert(hash1, hash2);
+
+        // the flash segment expires with the earliest of its items
+        let create_at = dst.create_at();
+        if dst.live_items() == 1 || expire_at < create_at + dst.ttl() {
+            if expire_at > create_at {
+                dst.set_ttl(expire_at - create_at);
+            } else {
+                dst.set_ttl(Duration::from_secs(0));
+            }
+        }
+
+        #[cfg(feature = "metrics")]
+        {
+            FLASH_DEMOTE.increment();
+            FLASH_DEMOTE_BYTES.add(size as _);
+        }
+
+        true
+    }
+
+    /// Moves on to the next unpinned segment in the ring, clearing it so that
+    /// items can be written into it. Returns false if all segments are pinned.
+    fn advance(&mut self, hashtable: &mut HashTable) -> bool {
+        let segments = self.headers.len();
+        for i in 1..=segments {
+            let idx = (self.current as usize + i) % segments;
+            if self.headers[idx].is_pinned() {
+                continue;
+            }
+
+            let mut segment = self.segment(idx);
+            if segment.live_items() > 0 {
+                #[cfg(feature = "metrics")]
+                FLASH_SEGMENT_EVICT.increment();
+            }
+            recycle(&mut segment, hashtable, false);
+            self.filters[idx].clear();
+
+            self.current = idx as u32;
+            return true;
+        }
+
+        false
+    }
+
+    /// Expires any flash segments which have reached their expiry or which
+    /// were created before the flush time. Returns the number of segments
+    /// expired.
+    pub fn expire(&mut self, hashtable: &mut HashTable, flush_at: Instant) -> usize {
+        let now = Instant::now();
+        let mut expired = 0;
+        for idx in 0..self.headers.len() {
+            let header = &self.headers[idx];
+            if header.live_items() > 0
+                && (header.create_at() + header.ttl() <= now || header.create_at() < flush_at)
+            {
+                let mut segment = self.segment(idx);
+                recycle(&mut segment, hashtable, true);
+                self.filters[idx].clear();
+
+                #[cfg(feature = "metrics")]
+                FLASH_SEGMENT_EXPIRE.increment();
+
+                expired += 1;
+            }
+        }
+        expired
+    }
+
+    /// Removes all items from the flash tier, returning the number of segments
+    /// which held items.
+    pub fn clear(&mut self, hashtable: &mut HashTable) -> usize {
+        let mut cleared = 0;
+        for idx in 0..self.headers.len() {
+            let mut segment = self.segment(idx);
+            if segment.live_items() > 0 {
+                cleared += 1;
+            }
+            recycle(&mut segment, hashtable, false);
+            self.filters[idx].clear();
+        }
+        cleared
+    }
+
+    /// Returns the number of live items in the flash tier.
+    #[cfg(any(test, feature = "debug"))]
+    pub fn items(&self) -> usize {
+        self.headers.iter().map(|h| h.live_items() as usize).sum()
+    }
+}
+
+/// Returns the write offset of a flash segment which holds no items.
+fn start_offset() -> i32 {
+    if cfg!(feature = "magic") {
+        core::mem::size_of_val(&SEG_MAGIC) as i32
+    } else {
+        0
+    }
+}
+
+/// Removes all items from the flash segment and initializes it so that items
+/// can be written into it again.
+fn recycle(segment: &mut Segment, hashtable: &mut HashTable, expire: bool) {
+    // a segment which has not been written to since it was initialized must
+    // not be scanned, as it may still contain stale item data
+    if segment.write_offset() > start_offset() {
+        segment.clear(hashtable, expire);
+    } else {
+        segment.set_accessible(false);
+    }
+    segment.init();
+}
+
+impl Drop for Flash {
+    fn drop(&mut self) {
+        // see `Segments`, pinned items must remain readable so the data is
+        // leaked if the flash tier is dropped while they are outstanding
+        if self.headers.iter().any(|h| h.is_pinned()) {
+            warn!("flash segments dropped while pinned, leaking segment data");
+            core::mem::forget(core::mem::take(&mut self.headers));
+        } else {
+            unsafe { ManuallyDrop::drop(&mut self.data) };
+        }
+    }
+}
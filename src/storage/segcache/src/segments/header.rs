@@ -15,19 +15,20 @@
 //! │   PREV SEG   │   NEXT SEG   │  CREATE AT   │   MERGE AT   │
 //! │              │              │              │              │
 //! │    32 bit    │    32 bit    │    32 bit    │    32 bit    │
-//! ├──────────────┼──┬──┬────────┴──────────────┴──────────────┤
-//! │     TTL      │  │  │               PADDING                │   Accessible
-//! │              │  │◀─┼──────────────────────────────────────┼──    8 bit
-//! │    32 bit    │8b│8b│                80 bit                │
-//! ├──────────────┴──┴──┴──────────────────────────────────────┤    Evictable
-//! │                          PADDING                          │      8 bit
-//! │                                                           │
-//! │                          128 bit                          │
-//! └───────────────────────────────────────────────────────────┘
+//! ├──────────────┼──────────────┼──┬──┬────┬─┴──────────────┤
+//! │     TTL      │  READ REFS   │  │  │MERG│     EPOCH      │   Accessible
+//! │              │              │  │◀─┼────┼────────────────┼──    8 bit
+//! │    32 bit    │    32 bit    │8b│8b│16b │     32 bit     │
+//! ├──────────────┼──────────────┴──┴──┴────┴────────────────┤    Evictable
+//! │     HITS     │                  PADDING                   │      8 bit
+//! │              │                                            │
+//! │    32 bit    │                   96 bit                   │
+//! └──────────────┴────────────────────────────────────────────┘
 //! ```
 
 use super::SEG_MAGIC;
 use core::num::NonZeroU32;
+use core::sync::atomic::{AtomicU32, Ordering};
 
 use crate::*;
 
@@ -56,11 +57,22 @@ pub struct SegmentHeader {
     merge_at: Instant,
     /// The TTL of the segment in seconds
     ttl: u32,
+    /// The number of outstanding pinned references to items in this segment
+    r_refcount: AtomicU32,
     /// Is the segment accessible?
     accessible: bool,
     /// Is the segment evictable?
     evictable: bool,
-    _pad: [u8; 25],
+    /// The number of times other segments were merged into this one since
+    /// it was created
+    merges: u16,
+    /// The flush epoch of the segments when the segment was created, the
+    /// segment and its items are flushed once the epoch has moved on
+    epoch: u32,
+    /// The number of reads of items in the segment since it was created or
+    /// last merged into, which scoring eviction counts as its hits
+    hits: u32,
+    _pad: [u8; 12],
 }
 
 impl SegmentHeader {
@@ -76,9 +88,13 @@ impl SegmentHeader {
             create_at: now,
             ttl: 0,
             merge_at: now,
+            r_refcount: AtomicU32::new(0),
             accessible: false,
             evictable: false,
-            _pad: [0; 25],
+            merges: 0,
+            epoch: 0,
+            hits: 0,
+            _pad: [0; 12],
         }
     }
 
@@ -98,6 +114,7 @@ impl SegmentHeader {
         self.live_items = 0;
         self.create_at = now;
         self.merge_at = now;
+        self.merges = 0;
         self.accessible = true;
     }
 
@@ -253,6 +270,19 @@ impl SegmentHeader {
     /// Update the created time
     pub fn mark_created(&mut self) {
         self.create_at = Instant::now();
+        self.merges = 0;
+    }
+
+    #[inline]
+    /// Returns the flush epoch in which the segment was created
+    pub fn epoch(&self) -> u32 {
+        self.epoch
+    }
+
+    #[inline]
+    /// Sets the flush epoch in which the segment was created
+    pub fn set_epoch(&mut self, epoch: u32) {
+        self.epoch = epoch;
     }
 
     #[inline]
@@ -265,13 +295,90 @@ impl SegmentHeader {
     /// Update the created time
     pub fn mark_merged(&mut self) {
         self.merge_at = Instant::now();
+        self.hits = 0;
+    }
+
+    #[inline]
+    /// Returns the number of reads of items in the segment since it was
+    /// created or last merged into
+    pub fn hits(&self) -> u32 {
+        self.hits
+    }
+
+    #[inline]
+    /// Count a read of an item in the segment
+    pub fn incr_hits(&mut self) {
+        self.hits = self.hits.saturating_add(1);
+    }
+
+    #[inline]
+    /// Count a merge into the segment
+    pub fn incr_merges(&mut self) {
+        self.merges = self.merges.saturating_add(1);
+    }
+
+    #[inline]
+    /// Returns the number of merges into the segment since it was created
+    pub fn merges(&self) -> u16 {
+        self.merges
+    }
+
+    /// Takes a read reference on the segment, which prevents the segment data
+    /// from being moved or reused until the returned counter is decremented.
+    #[inline]
+    pub fn pin(&self) -> &AtomicU32 {
+        self.r_refcount.fetch_add(1, Ordering::Relaxed);
+        &self.r_refcount
+    }
+
+    /// Returns true if there are outstanding read references on the segment.
+    #[inline]
+    pub fn is_pinned(&self) -> bool {
+        self.r_refcount.load(Ordering::Acquire) != 0
     }
 
     #[inline]
     /// Can the segment be evicted?
     pub fn can_evict(&self) -> bool {
         self.evictable()
+            && !self.is_pinned()
             && self.next_seg().is_some()
             && (self.create_at() + self.ttl()) >= (Instant::now() + SEG_MATURE_TIME)
     }
+
+    /// The number of bytes needed to save a header into the metadata.
+    pub(crate) const METADATA_SIZE: usize = 9 * core::mem::size_of::<u32>();
+
+    /// Saves the header into the metadata.
+    pub(crate) fn save(&self, writer: &mut MetadataWriter) -> Result<(), std::io::Error> {
+        writer.put_u32(self.write_offset as u32)?;
+        writer.put_u32(self.live_bytes as u32)?;
+        writer.put_u32(self.live_items as u32)?;
+        writer.put_seg_id(self.prev_seg)?;
+        writer.put_seg_id(self.next_seg)?;
+        writer.put_instant(self.create_at)?;
+        writer.put_instant(self.merge_at)?;
+        writer.put_u32(self.ttl)?;
+        writer.put_u32(self.accessible as u32 | (self.evictable as u32) << 1)
+    }
+
+    /// Restores a header with the provided id from the metadata.
+    pub(crate) fn restore(
+        id: NonZeroU32,
+        reader: &mut MetadataReader,
+    ) -> Result<Self, std::io::Error> {
+        let mut header = Self::new(id);
+        header.write_offset = reader.get_u32()? as i32;
+        header.live_bytes = reader.get_u32()? as i32;
+        header.live_items = reader.get_u32()? as i32;
+        header.prev_seg = reader.get_seg_id()?;
+        header.next_seg = reader.get_seg_id()?;
+        header.create_at = reader.get_instant()?;
+        header.merge_at = reader.get_instant()?;
+        header.ttl = reader.get_u32()?;
+        let flags = reader.get_u32()?;
+        header.accessible = flags & 0b01 != 0;
+        header.evictable = flags & 0b10 != 0;
+        Ok(header)
+    }
 }
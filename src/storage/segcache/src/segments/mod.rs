@@ -10,6 +10,7 @@ const SEG_MAGIC: u64 = 0xBADC0FFEEBADCAFE;
 
 mod builder;
 mod error;
+mod flash;
 mod header;
 mod segment;
 #[allow(clippy::module_inception)]
@@ -17,6 +18,7 @@ mod segments;
 
 pub(crate) use builder::SegmentsBuilder;
 pub(crate) use error::SegmentsError;
+pub(crate) use flash::Flash;
 pub(crate) use header::SegmentHeader;
 pub(crate) use segment::Segment;
 pub(crate) use segments::Segments;
@@ -3,6 +3,7 @@
 // http://www.apache.org/licenses/LICENSE-2.0
 
 use super::{SegmentHeader, SegmentsError};
+use crate::eviction::Ghost;
 use crate::*;
 use core::num::NonZeroU32;
 
@@ -106,7 +107,7 @@ impl<'a> Segment<'a> {
                 break;
             }
 
-            let deleted = !hashtable.is_item_at(item.key(), self.id(), offset as u64);
+            let deleted = !hashtable.is_item_at(&item.key(), self.id(), offset as u64);
             if !deleted {
                 count += 1;
             }
@@ -207,10 +208,17 @@ impl<'a> Segment<'a> {
         self.header.create_at()
     }
 
+    /// Returns the flush epoch in which the segment was created
+    #[inline]
+    pub fn epoch(&self) -> u32 {
+        self.header.epoch()
+    }
+
     /// Mark that the segment has been merged
     #[inline]
     pub fn mark_merged(&mut self) {
-        self.header.mark_merged()
+        self.header.mark_merged();
+        self.header.incr_merges();
     }
 
     /// Return the previous segment's id. This will be a segment before it in a
@@ -357,7 +365,8 @@ impl<'a> Segment<'a> {
             let item_size = item.size();
 
             // don't copy deleted items
-            let deleted = !hashtable.is_item_at(item.key(), self.id(), read_offset as u64);
+            let key = item.key();
+            let deleted = !hashtable.is_item_at(&key, self.id(), read_offset as u64);
             if deleted {
                 #[cfg(feature = "metrics")]
                 {
@@ -379,7 +388,7 @@ impl<'a> Segment<'a> {
 
                 if hashtable
                     .relink_item(
-                        item.key(),
+                        &key,
                         self.id(),
                         self.id(),
                         read_offset as u64,
@@ -456,7 +465,8 @@ impl<'a> Segment<'a> {
             let write_offset = target.write_offset() as usize;
 
             // skip deleted items and ones that won't fit in the target segment
-            let deleted = !hashtable.is_item_at(item.key(), self.id(), read_offset as u64);
+            let key = item.key();
+            let deleted = !hashtable.is_item_at(&key, self.id(), read_offset as u64);
             if deleted || write_offset + item_size >= target.data.len() {
                 read_offset += item_size;
                 continue;
@@ -467,7 +477,7 @@ impl<'a> Segment<'a> {
 
             if hashtable
                 .relink_item(
-                    item.key(),
+                    &key,
                     self.id(),
                     target.id(),
                     read_offset as u64,
@@ -511,6 +521,193 @@ impl<'a> Segment<'a> {
         Ok(())
     }
 
+    /// Moves the live item at the offset into the target segment and relinks
+    /// it in the hashtable. Returns false if the item does not fit in the
+    /// target or could not be relinked, in which case it is left in place.
+    pub(crate) fn move_item(
+        &mut self,
+        offset: usize,
+        target: &mut Segment,
+        hashtable: &mut HashTable,
+    ) -> bool {
+        let item = self.get_item_at(offset).unwrap();
+        item.check_magic();
+
+        let item_size = item.size();
+        let write_offset = target.write_offset() as usize;
+        if write_offset + item_size >= target.data.len() {
+            return false;
+        }
+
+        if hashtable
+            .relink_item(
+                &item.key(),
+                self.id(),
+                target.id(),
+                offset as u64,
+                write_offset as u64,
+            )
+            .is_err()
+        {
+            return false;
+        }
+
+        // the segments are distinct, so we can use nonoverlapping copy
+        unsafe {
+            std::ptr::copy_nonoverlapping(
+                self.data.as_ptr().add(offset),
+                target.data.as_mut_ptr().add(write_offset),
+                item_size,
+            );
+        }
+        self.remove_item_at(offset);
+        target.header.incr_live_items();
+        target.header.incr_live_bytes(item_size as i32);
+        target.set_write_offset(write_offset as i32 + item_size as i32);
+
+        // removing the item from this segment decremented the current items,
+        // but it is still current in the target, see `copy_into`
+        #[cfg(feature = "metrics")]
+        {
+            ITEM_CURRENT.increment();
+            ITEM_CURRENT_BYTES.add(item_size as _);
+        }
+
+        true
+    }
+
+    /// Moves all live items into the flash tier. Any items which can't be
+    /// moved are left in this segment.
+    pub(crate) fn demote(&mut self, hashtable: &mut HashTable, flash: &mut Flash) {
+        let max_offset = self.max_item_offset();
+        let mut offset = if cfg!(feature = "magic") {
+            std::mem::size_of_val(&SEG_MAGIC)
+        } else {
+            0
+        };
+
+        while offset <= max_offset {
+            let item = self.get_item_at(offset).unwrap();
+            if item.klen() == 0 && self.live_items() == 0 {
+                break;
+            }
+
+            item.check_magic();
+
+            let item_size = item.size();
+            if hashtable.is_item_at(&item.key(), self.id(), offset as u64)
+                && !flash.demote(self, offset, hashtable)
+            {
+                // the flash tier can't take any more items right now
+                break;
+            }
+            offset += item_size;
+        }
+    }
+
+    /// Appends the records of the live items selected by the export, with
+    /// the provided ttl in seconds.
+    pub(crate) fn export(
+        &mut self,
+        hashtable: &mut HashTable,
+        export: &Export,
+        ttl: u32,
+        dst: &mut Vec<u8>,
+    ) {
+        let max_offset = self.max_item_offset();
+        let mut offset = if cfg!(feature = "magic") {
+            std::mem::size_of_val(&SEG_MAGIC)
+        } else {
+            0
+        };
+
+        while offset < max_offset {
+            let item = self.get_item_at(offset).unwrap();
+            if item.klen() == 0 {
+                break;
+            }
+
+            item.check_magic();
+
+            let item_size = item.size();
+
+            // values stored in chunks are not exported
+            let large = item.is_large() || item.is_chunk();
+
+            let key = item.key();
+            if let Some(freq) = hashtable.get_freq(&key, self, offset as u64) {
+                if !large && export.selects(hashtable.hash(&key), freq) {
+                    crate::warm::write_record(
+                        dst,
+                        &key,
+                        item.value(),
+                        item.optional(),
+                        ttl,
+                        item.is_compressed(),
+                    );
+
+                    #[cfg(feature = "metrics")]
+                    ITEM_EXPORT.increment();
+                }
+            }
+            offset += item_size;
+        }
+    }
+
+    /// Appends the keys of the live items in the segment which are selected
+    /// by the filter.
+    pub(crate) fn live_keys(
+        &mut self,
+        hashtable: &mut HashTable,
+        filter: impl Fn(&[u8]) -> bool,
+        dst: &mut Vec<Box<[u8]>>,
+    ) {
+        let max_offset = self.max_item_offset();
+        let mut offset = if cfg!(feature = "magic") {
+            std::mem::size_of_val(&SEG_MAGIC)
+        } else {
+            0
+        };
+
+        while offset < max_offset {
+            let item = self.get_item_at(offset).unwrap();
+            if item.klen() == 0 {
+                break;
+            }
+
+            item.check_magic();
+
+            let key = item.key();
+            if filter(&key) && hashtable.is_item_at(&key, self.id(), offset as u64) {
+                dst.push(key.into());
+            }
+            offset += item.size();
+        }
+    }
+
+    /// Calls the function with the key of each item written to the segment,
+    /// including items which have since been removed.
+    pub(crate) fn keys(&mut self, mut f: impl FnMut(&[u8])) {
+        let max_offset = self.max_item_offset();
+        let mut offset = if cfg!(feature = "magic") {
+            std::mem::size_of_val(&SEG_MAGIC)
+        } else {
+            0
+        };
+
+        while offset < max_offset {
+            let item = self.get_item_at(offset).unwrap();
+            if item.klen() == 0 {
+                break;
+            }
+
+            item.check_magic();
+
+            f(&item.key());
+            offset += item.size();
+        }
+    }
+
     /// This is used as part of segment merging, it removes items from the
     /// segment based on a cutoff frequency and target ratio. Since the cutoff
     /// frequency is adjusted, it is returned as the result.
@@ -519,6 +716,7 @@ impl<'a> Segment<'a> {
         hashtable: &mut HashTable,
         cutoff_freq: f64,
         target_ratio: f64,
+        mut flash: Option<&mut Flash>,
     ) -> f64 {
         let max_offset = self.max_item_offset();
         let mut offset = if cfg!(feature = "magic") {
@@ -549,7 +747,8 @@ impl<'a> Segment<'a> {
 
             let item_size = item.size();
 
-            let deleted = !hashtable.is_item_at(item.key(), self.id(), offset as u64);
+            let key = item.key();
+            let deleted = !hashtable.is_item_at(&key, self.id(), offset as u64);
             if deleted {
                 // do we need to evict again here? Why is that done in the C code?
                 offset += item_size;
@@ -569,8 +768,7 @@ impl<'a> Segment<'a> {
                 trace!("cutoff adj to: {}", cutoff);
             }
 
-            let item_frequency =
-                hashtable.get_freq(item.key(), self, offset as u64).unwrap() as f64;
+            let item_frequency = hashtable.get_freq(&key, self, offset as u64).unwrap() as f64;
             let weighted_frequency = item_frequency / (item_size as f64 / mean_size);
 
             if cutoff >= 0.0001
@@ -585,7 +783,13 @@ impl<'a> Segment<'a> {
                     weighted_frequency,
                     cutoff
                 );
-                if !hashtable.evict(item.key(), offset.try_into().unwrap(), self) {
+                // items are moved to the flash tier if there is one, and are
+                // otherwise evicted
+                let demoted = flash
+                    .as_deref_mut()
+                    .map(|flash| flash.demote(self, offset, hashtable))
+                    .unwrap_or(false);
+                if !demoted && !hashtable.evict(&key, offset.try_into().unwrap(), self) {
                     // this *shouldn't* happen, but to keep header integrity, we
                     // warn and remove the item even if it wasn't in the
                     // hashtable
@@ -612,6 +816,66 @@ impl<'a> Segment<'a> {
         cutoff
     }
 
+    /// This is used as part of S3-FIFO eviction, it keeps the items which
+    /// were read since they were written, or whose key is a ghost as it was
+    /// recently evicted by an earlier pass. The other items are evicted, or
+    /// moved to the flash tier if there is one, and their keys become ghosts.
+    pub(crate) fn prune_probation(
+        &mut self,
+        hashtable: &mut HashTable,
+        ghost: &mut Ghost,
+        mut flash: Option<&mut Flash>,
+    ) {
+        let max_offset = self.max_item_offset();
+        let mut offset = if cfg!(feature = "magic") {
+            std::mem::size_of_val(&SEG_MAGIC)
+        } else {
+            0
+        };
+
+        while offset <= max_offset {
+            let item = self.get_item_at(offset).unwrap();
+            if item.klen() == 0 && self.live_items() == 0 {
+                break;
+            }
+
+            item.check_magic();
+
+            let item_size = item.size();
+
+            let key = item.key();
+            if !hashtable.is_item_at(&key, self.id(), offset as u64) {
+                offset += item_size;
+                continue;
+            }
+
+            let hash = hashtable.hash(&key);
+            let read = hashtable.get_freq(&key, self, offset as u64).unwrap_or(0) > 0;
+
+            if read || ghost.remove(hash) {
+                #[cfg(feature = "metrics")]
+                {
+                    ITEM_PROMOTE.increment();
+                    if !read {
+                        ITEM_GHOST_HIT.increment();
+                    }
+                }
+            } else {
+                let demoted = flash
+                    .as_deref_mut()
+                    .map(|flash| flash.demote(self, offset, hashtable))
+                    .unwrap_or(false);
+                if !demoted && !hashtable.evict(&key, offset.try_into().unwrap(), self) {
+                    warn!("unlinked item was present in segment");
+                    self.remove_item_at(offset);
+                }
+                ghost.insert(hash);
+            }
+
+            offset += item_size;
+        }
+    }
+
     /// Remove all items from the segment, unlinking them from the hashtable.
     /// If expire is true, this is treated as an expiration option. Otherwise it
     /// is treated as an eviction.
@@ -648,13 +912,14 @@ impl<'a> Segment<'a> {
                 bytes += item.size();
             }
 
-            let deleted = !hashtable.is_item_at(item.key(), self.id(), offset as u64);
+            let key = item.key();
+            let deleted = !hashtable.is_item_at(&key, self.id(), offset as u64);
             if !deleted {
                 trace!("evicting from hashtable");
                 let removed = if expire {
-                    hashtable.expire(item.key(), offset.try_into().unwrap(), self)
+                    hashtable.expire(&key, offset.try_into().unwrap(), self)
                 } else {
-                    hashtable.evict(item.key(), offset.try_into().unwrap(), self)
+                    hashtable.evict(&key, offset.try_into().unwrap(), self)
                 };
                 if !removed {
                     // this *shouldn't* happen, but to keep header integrity, we
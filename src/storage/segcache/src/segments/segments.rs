@@ -5,17 +5,24 @@
 use crate::eviction::*;
 use crate::item::*;
 use crate::segments::*;
+use core::mem::ManuallyDrop;
 use core::num::NonZeroU32;
+use core::sync::atomic::AtomicU32;
 use datatier::*;
 
+// the small queue of S3-FIFO eviction is evicted from while it holds at least
+// one in this many of the segments in use
+const S3FIFO_SMALL_RATIO: usize = 10;
+
 /// `Segments` contain all items within the cache. This struct is a collection
 /// of individual `Segment`s which are represented by a `SegmentHeader` and a
 /// subslice of bytes from a contiguous heap allocation.
 pub(crate) struct Segments {
     /// Pointer to slice of headers
     headers: Box<[SegmentHeader]>,
-    /// Pointer to raw data
-    data: Box<dyn Datapool>,
+    /// Pointer to raw data, which is leaked instead of dropped if any segments
+    /// are still pinned
+    data: ManuallyDrop<Box<dyn Datapool>>,
     /// Segment size in bytes
     segment_size: i32,
     /// Number of free segments
@@ -26,6 +33,11 @@ pub(crate) struct Segments {
     free_q: Option<NonZeroU32>,
     /// Time last flushed
     flush_at: Instant,
+    /// The current flush epoch, segments created in an earlier epoch are
+    /// flushed
+    epoch: u32,
+    /// Whether flushed segments may remain to be reclaimed
+    flushing: bool,
     /// Eviction configuration and state
     evict: Box<Eviction>,
 }
@@ -43,9 +55,13 @@ impl Segments {
         );
 
         assert!(
-            segments < (1 << 24), // we use just 24 bits to store the seg id
+            segments < MAX_SEGMENTS, // the seg id has a fixed number of bits
             "heap size requires too many segments, reduce heap size or increase segment size"
         );
+        assert!(
+            segment_size as usize <= MAX_SEGMENT_SIZE,
+            "segment size is too large for the offsets held by the hashtable"
+        );
 
         let evict_policy = builder.evict_policy;
 
@@ -54,7 +70,7 @@ impl Segments {
         let mut headers = Vec::with_capacity(0);
         headers.reserve_exact(segments);
         for id in 0..segments {
-            // safety: we start iterating from 1 and seg id is constrained to < 2^24
+            // safety: we start iterating from 1 and seg id is constrained to < MAX_SEGMENTS
             let header = SegmentHeader::new(unsafe { NonZeroU32::new_unchecked(id as u32 + 1) });
             headers.push(header);
         }
@@ -69,9 +85,30 @@ impl Segments {
         let mut data: Box<dyn Datapool> = if let Some(file) = builder.datapool_path {
             Box::new(MmapFile::create(file, heap_size, crate::VERSION)?)
         } else {
-            Box::new(Memory::create(heap_size)?)
+            Box::new(Memory::create_with(
+                heap_size,
+                builder.huge_pages,
+                builder.numa_node,
+            )?)
         };
 
+        let flash = match (builder.flash_path, builder.flash_node) {
+            (Some(path), _) => Some(Flash::create(
+                path,
+                builder.flash_size,
+                segment_size,
+                segments as u32,
+            )?),
+            (None, Some(node)) => Some(Flash::create_on_node(
+                builder.flash_size,
+                segment_size,
+                segments as u32,
+                node,
+            )?),
+            (None, None) => None,
+        }
+        .map(|flash| flash.with_age(builder.flash_age));
+
         for idx in 0..segments {
             let begin = segment_size as usize * idx;
             let end = begin + segment_size as usize;
@@ -91,6 +128,8 @@ impl Segments {
         {
             SEGMENT_CURRENT.set(segments as _);
             SEGMENT_FREE.set(segments as _);
+            SEGMENT_HEAP_BYTES.add(heap_size as _);
+            SEGMENT_HEADER_BYTES.add((headers.len() * core::mem::size_of::<SegmentHeader>()) as _);
         }
 
         Ok(Self {
@@ -99,20 +138,217 @@ impl Segments {
             cap: segments as u32,
             free: segments as u32,
             free_q: NonZeroU32::new(1),
-            data,
+            data: ManuallyDrop::new(data),
             flush_at: Instant::now(),
-            evict: Box::new(Eviction::new(segments, evict_policy)),
+            epoch: 0,
+            flushing: false,
+            evict: Box::new(Eviction::new(segments, evict_policy).with_flash(flash)),
+        })
+    }
+
+    /// Restores the `Segments` from the metadata saved on a graceful shutdown
+    /// by opening the existing datapool file from the builder. The heap and
+    /// segment sizes from the builder must match the saved segments.
+    pub(super) fn restore(
+        builder: SegmentsBuilder,
+        reader: &mut MetadataReader,
+    ) -> Result<Self, std::io::Error> {
+        let invalid = || std::io::Error::new(std::io::ErrorKind::Other, "invalid segments");
+
+        let segment_size = builder.segment_size;
+        let segments = builder.heap_size / (builder.segment_size as usize);
+        let heap_size = segments * segment_size as usize;
+
+        let path = builder.datapool_path.ok_or_else(invalid)?;
+
+        if reader.get_u32()? as i32 != segment_size || reader.get_u32()? as usize != segments {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::Other,
+                "segment configuration does not match saved segments",
+            ));
+        }
+
+        let free = reader.get_u32()?;
+        let free_q = reader.get_seg_id()?;
+        let flush_at = reader.get_instant()?;
+
+        if free as usize > segments || free_q.map(|id| id.get() as usize > segments) == Some(true) {
+            return Err(invalid());
+        }
+
+        let mut headers = Vec::with_capacity(0);
+        headers.reserve_exact(segments);
+        for id in 0..segments {
+            // safety: we start iterating from 1 and seg id is constrained to < MAX_SEGMENTS
+            let id = unsafe { NonZeroU32::new_unchecked(id as u32 + 1) };
+            headers.push(SegmentHeader::restore(id, reader)?);
+        }
+        let headers = headers.into_boxed_slice();
+
+        let flash = match (reader.get_u32()? != 0, builder.flash_path) {
+            (true, Some(path)) => Some(Flash::restore(
+                path,
+                builder.flash_size,
+                segment_size,
+                segments as u32,
+                reader,
+            )?),
+            // a tier held in memory is not saved, and starts empty
+            (false, None) => match builder.flash_node {
+                Some(node) => Some(Flash::create_on_node(
+                    builder.flash_size,
+                    segment_size,
+                    segments as u32,
+                    node,
+                )?),
+                None => None,
+            },
+            _ => {
+                return Err(std::io::Error::new(
+                    std::io::ErrorKind::Other,
+                    "flash configuration does not match saved segments",
+                ));
+            }
+        }
+        .map(|flash| flash.with_age(builder.flash_age));
+
+        let data: Box<dyn Datapool> = Box::new(MmapFile::open(path, heap_size, crate::VERSION)?);
+
+        #[cfg(feature = "metrics")]
+        {
+            SEGMENT_CURRENT.set(segments as _);
+            SEGMENT_FREE.set(free as _);
+            SEGMENT_HEAP_BYTES.add(heap_size as _);
+            SEGMENT_HEADER_BYTES.add((headers.len() * core::mem::size_of::<SegmentHeader>()) as _);
+        }
+
+        Ok(Self {
+            headers,
+            segment_size,
+            cap: segments as u32,
+            free,
+            free_q,
+            data: ManuallyDrop::new(data),
+            flush_at,
+            epoch: 0,
+            flushing: false,
+            evict: Box::new(Eviction::new(segments, builder.evict_policy).with_flash(flash)),
         })
     }
 
+    /// Adds the memory held by the segments in memory to the usage.
+    pub(crate) fn memory_usage(&self, usage: &mut crate::MemoryUsage) {
+        usage.segment_headers += self.headers.len() * core::mem::size_of::<SegmentHeader>();
+        usage.heap += self.cap as usize * self.segment_size as usize;
+        // the magic bytes are written to every segment when it is reset
+        let reset_offset = if cfg!(feature = "magic") {
+            core::mem::size_of_val(&super::SEG_MAGIC) as i32
+        } else {
+            0
+        };
+        for header in self.headers.iter() {
+            if header.write_offset() > reset_offset {
+                usage.used += self.segment_size as usize;
+            }
+            usage.written += header.write_offset() as usize;
+            usage.live += header.live_bytes() as usize;
+            usage.items += header.live_items() as usize;
+        }
+        usage.item_header = ITEM_HDR_SIZE;
+    }
+
+    /// Returns a snapshot of the state of each segment held in memory.
+    pub(crate) fn segment_stats(&self) -> crate::SegmentStats {
+        let now = Instant::now();
+        let age = |instant: Instant| {
+            if instant < now {
+                (now - instant).as_secs()
+            } else {
+                0
+            }
+        };
+        let segments = self
+            .headers
+            .iter()
+            .map(|header| crate::SegmentInfo {
+                id: header.id().get(),
+                ttl: header.ttl().as_secs(),
+                age: age(header.create_at()),
+                merge_age: age(header.merge_at()),
+                write_offset: header.write_offset() as usize,
+                live_bytes: header.live_bytes() as usize,
+                live_items: header.live_items() as usize,
+                merges: header.merges(),
+                accessible: header.accessible(),
+                evictable: header.evictable(),
+            })
+            .collect();
+
+        crate::SegmentStats {
+            segment_size: self.segment_size as usize,
+            segments,
+            ..Default::default()
+        }
+    }
+
+    /// Returns the number of bytes needed to save the segments metadata.
+    pub(crate) fn metadata_size(&self) -> usize {
+        6 * core::mem::size_of::<u32>()
+            + self.headers.len() * SegmentHeader::METADATA_SIZE
+            + self.saved_flash().map(|f| f.metadata_size()).unwrap_or(0)
+    }
+
+    /// Returns the flash tier if it is saved with the metadata, which it is
+    /// unless it is held in memory.
+    fn saved_flash(&self) -> Option<&Flash> {
+        self.evict.flash().filter(|f| !f.is_volatile())
+    }
+
+    /// Saves the segment headers, free queue, and any flash segment headers
+    /// into the metadata.
+    pub(crate) fn save(&self, writer: &mut MetadataWriter) -> Result<(), std::io::Error> {
+        writer.put_u32(self.segment_size as u32)?;
+        writer.put_u32(self.cap)?;
+        writer.put_u32(self.free)?;
+        writer.put_seg_id(self.free_q)?;
+        writer.put_instant(self.flush_at)?;
+        for header in self.headers.iter() {
+            header.save(writer)?;
+        }
+        writer.put_u32(self.saved_flash().is_some() as u32)?;
+        if let Some(flash) = self.saved_flash() {
+            flash.save(writer)?;
+        }
+        Ok(())
+    }
+
+    /// Flushes the segment data to the datapool and the flash file.
+    pub(crate) fn flush(&mut self) -> Result<(), std::io::Error> {
+        self.data.flush()?;
+        if let Some(flash) = self.evict.flash_mut() {
+            flash.flush()?;
+        }
+        Ok(())
+    }
+
     /// Return the size of each segment in bytes
     #[inline]
     pub fn segment_size(&self) -> i32 {
         self.segment_size
     }
 
+    /// Changes the eviction policy.
+    pub(crate) fn set_policy(&mut self, policy: Policy) {
+        debug!("eviction policy: {:?}", policy);
+        self.evict.set_policy(policy);
+    }
+
+    /// Returns the number of segments held in memory
+    pub(crate) fn cap(&self) -> u32 {
+        self.cap
+    }
+
     /// Returns the number of free segments
-    #[cfg(test)]
     pub fn free(&self) -> usize {
         self.free as usize
     }
@@ -127,6 +363,240 @@ impl Segments {
         self.flush_at = instant;
     }
 
+    /// Flushes every segment in memory by starting a new flush epoch, and the
+    /// flash tier by marking it flushed now. The items of the flushed segments
+    /// are treated as missing until their segments are reclaimed.
+    pub(crate) fn start_flush(&mut self) {
+        self.epoch = self.epoch.wrapping_add(1);
+        self.flushing = true;
+        self.flush_at = Instant::now();
+    }
+
+    /// Marks that every flushed segment has been reclaimed.
+    pub(crate) fn finish_flush(&mut self) {
+        self.flushing = false;
+    }
+
+    /// Returns true if flushed segments may remain to be reclaimed.
+    #[inline]
+    pub(crate) fn is_flushing(&self) -> bool {
+        self.flushing
+    }
+
+    /// Returns true if the segment in memory was created before the last
+    /// flush and has yet to be reclaimed.
+    #[inline]
+    pub(crate) fn is_flushed_segment(&self, id: NonZeroU32) -> bool {
+        self.flushing
+            && id.get() <= self.cap
+            && self.headers[id.get() as usize - 1].epoch() != self.epoch
+    }
+
+    /// Returns true if the item info refers to an item of a flushed segment,
+    /// which is to be treated as missing.
+    #[inline]
+    pub(crate) fn is_flushed(&self, item_info: u64) -> bool {
+        self.flushing && get_seg_id(item_info).is_some_and(|id| self.is_flushed_segment(id))
+    }
+
+    /// Returns true if the item info refers to an item of a segment in memory,
+    /// rather than one on flash.
+    #[inline]
+    pub(crate) fn in_memory(&self, item_info: u64) -> bool {
+        get_seg_id(item_info).is_some_and(|id| id.get() <= self.cap)
+    }
+
+    /// Counts a read of the item in its segment, if the segment is in memory.
+    #[inline]
+    pub(crate) fn record_hit(&mut self, item_info: u64) {
+        if let Some(id) = get_seg_id(item_info).filter(|id| id.get() <= self.cap) {
+            self.headers[id.get() as usize - 1].incr_hits();
+        }
+    }
+
+    /// Takes a read reference on the segment which contains the item,
+    /// returning a `PinnedItem` which releases the reference when dropped.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the item is not stored within these segments.
+    pub(crate) fn pin(&self, item: &Item) -> PinnedItem {
+        if let Some(pinned) = self.evict.flash().and_then(|f| f.pin(item)) {
+            return pinned;
+        }
+
+        let base = self.data.as_slice().as_ptr() as usize;
+        let offset = (item.raw().as_ptr() as usize).wrapping_sub(base);
+        let id = offset / self.segment_size as usize;
+        assert!(id < self.cap as usize, "item is not within the segments");
+
+        PinnedItem::new(Item::new(item.raw(), item.cas()), self.headers[id].pin())
+    }
+
+    /// Takes a read reference on the in-memory segment, which keeps it from
+    /// being evicted, merged, or reused until the returned counter is
+    /// decremented.
+    pub(crate) fn pin_segment(&self, id: NonZeroU32) -> &AtomicU32 {
+        self.headers[id.get() as usize - 1].pin()
+    }
+
+    /// Returns true if there is a flash tier.
+    pub(crate) fn has_flash(&self) -> bool {
+        self.evict.flash().is_some()
+    }
+
+    /// Returns true if there is a flash tier held in memory, whose items are
+    /// lost when the cache is restarted.
+    pub(crate) fn has_volatile_flash(&self) -> bool {
+        self.evict.flash().map(|f| f.is_volatile()).unwrap_or(false)
+    }
+
+    /// Returns true if the item is held in the flash tier.
+    pub(crate) fn in_flash(&self, item: &Item) -> bool {
+        self.evict.flash().map(|f| f.holds(item)).unwrap_or(false)
+    }
+
+    /// Returns true if the segment which holds an item has outstanding read
+    /// references. Items in the flash tier are always treated as pinned, as
+    /// they are only read through copies of their data.
+    pub(crate) fn is_pinned(&self, item: &Item) -> bool {
+        self.in_flash(item) || self.header_of(item).is_pinned()
+    }
+
+    /// Reserves room for the value of an item to grow by some number of bytes
+    /// in place. This is only possible for the last item written to a segment
+    /// which has room for the larger item, and which is neither held in the
+    /// flash tier nor pinned. Returns false if the item must be copied instead.
+    pub(crate) fn grow(&mut self, item: &Item, bytes: usize) -> bool {
+        if self.is_pinned(item) {
+            return false;
+        }
+
+        let base = self.data.as_slice().as_ptr() as usize;
+        let offset = (item.raw().as_ptr() as usize).wrapping_sub(base);
+        let id = offset / self.segment_size as usize;
+        let offset = offset % self.segment_size as usize;
+
+        let size = item.raw().size();
+        let grown = item.raw().size_with(bytes);
+        let header = &mut self.headers[id];
+        if header.write_offset() as usize != offset + size
+            || offset + grown > self.segment_size as usize
+        {
+            return false;
+        }
+
+        let delta = (grown - size) as i32;
+        header.incr_write_offset(delta);
+        header.incr_live_bytes(delta);
+
+        #[cfg(feature = "metrics")]
+        ITEM_CURRENT_BYTES.add(delta as _);
+
+        true
+    }
+
+    /// Returns the time until an item in the flash tier expires.
+    pub(crate) fn flash_ttl(&self, item: &Item) -> Duration {
+        self.evict
+            .flash()
+            .map(|f| f.ttl(item))
+            .unwrap_or(Duration::from_secs(0))
+    }
+
+    /// Returns the time until an item expires. Items share the expiry of the
+    /// segment which holds them, so this is the remaining lifetime of that
+    /// segment.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the item is not stored within these segments.
+    pub(crate) fn ttl(&self, item: &Item) -> Duration {
+        if self.in_flash(item) {
+            return self.flash_ttl(item);
+        }
+
+        let header = self.header_of(item);
+        let now = Instant::now();
+        if header.create_at() + header.ttl() > now {
+            header.create_at() + header.ttl() - now
+        } else {
+            Duration::from_secs(0)
+        }
+    }
+
+    /// Returns the TTL of the in-memory segment which holds an item, which is
+    /// that of its TTL bucket. Flash segments hold items from many buckets, so
+    /// this returns `None` for items held in flash.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the item is not stored within these segments.
+    pub(crate) fn segment_ttl(&self, item: &Item) -> Option<Duration> {
+        if self.in_flash(item) {
+            return None;
+        }
+
+        Some(self.header_of(item).ttl())
+    }
+
+    fn header_of(&self, item: &Item) -> &SegmentHeader {
+        let base = self.data.as_slice().as_ptr() as usize;
+        let offset = (item.raw().as_ptr() as usize).wrapping_sub(base);
+        let id = offset / self.segment_size as usize;
+        assert!(id < self.cap as usize, "item is not within the segments");
+
+        &self.headers[id]
+    }
+
+    /// Expires any segments in the flash tier which have reached their expiry
+    /// or were created before the last flush. Returns the number of segments
+    /// expired.
+    pub(crate) fn expire_flash(&mut self, hashtable: &mut HashTable) -> usize {
+        let flush_at = self.flush_at;
+        self.evict
+            .flash_mut()
+            .map(|f| f.expire(hashtable, flush_at))
+            .unwrap_or(0)
+    }
+
+    /// Removes all items from the flash tier, returning the number of
+    /// segments which held items.
+    pub(crate) fn clear_flash(&mut self, hashtable: &mut HashTable) -> usize {
+        self.evict
+            .flash_mut()
+            .map(|f| f.clear(hashtable))
+            .unwrap_or(0)
+    }
+
+    /// Prefetch the start of the item referenced by the item info. This does
+    /// not access the item data.
+    pub(crate) fn prefetch_item(&self, item_info: u64) {
+        if let Some(seg_id) = get_seg_id(item_info) {
+            let seg_id = seg_id.get();
+            if seg_id <= self.cap {
+                let offset = self.segment_size() as usize * (seg_id as usize - 1)
+                    + get_offset(item_info) as usize;
+                prefetch(self.data.as_slice().as_ptr().wrapping_add(offset));
+            }
+        }
+    }
+
+    /// Returns false if the item info refers to a flash segment which
+    /// definitely does not hold an item with the key for the hash, so that the
+    /// item need not be read to compare its key.
+    #[inline]
+    pub(crate) fn may_hold(&self, item_info: u64, hash: u64) -> bool {
+        match get_seg_id(item_info) {
+            Some(id) if id.get() > self.cap => self
+                .evict
+                .flash()
+                .map(|flash| flash.may_hold(id, hash))
+                .unwrap_or(false),
+            _ => true,
+        }
+    }
+
     /// Retrieve a `RawItem` from the segment id and offset encoded in the
     /// item info.
     pub(crate) fn get_item(&mut self, item_info: u64) -> Option<RawItem> {
@@ -144,7 +614,14 @@ impl Segments {
     ) -> Option<RawItem> {
         let seg_id = seg_id.map(|v| v.get())?;
         trace!("getting item from: seg: {} offset: {}", seg_id, offset);
-        assert!(seg_id <= self.cap);
+
+        if seg_id > self.cap {
+            let flash = self.evict.flash_mut();
+            assert!(flash.is_some());
+            // safety: seg_id is greater than the cap, so it is non-zero
+            let id = unsafe { NonZeroU32::new_unchecked(seg_id) };
+            return flash.unwrap().get_mut(id).unwrap().get_item_at(offset);
+        }
 
         let seg_begin = self.segment_size() as usize * (seg_id as usize - 1);
         let seg_end = seg_begin + self.segment_size() as usize;
@@ -163,7 +640,7 @@ impl Segments {
         hashtable: &mut HashTable,
         expire: bool,
     ) -> Result<(), ()> {
-        let mut segment = self.get_mut(id).unwrap();
+        let (mut segment, flash) = self.get_mut_with_flash(id).unwrap();
         if segment.next_seg().is_none() && !expire {
             Err(())
         } else {
@@ -172,6 +649,11 @@ impl Segments {
             assert!(segment.evictable(), "segment was not evictable");
             segment.set_evictable(false);
             segment.set_accessible(false);
+            if !expire {
+                if let Some(flash) = flash {
+                    segment.demote(hashtable, flash);
+                }
+            }
             segment.clear(hashtable, expire);
             Ok(())
         }
@@ -184,6 +666,23 @@ impl Segments {
         &mut self,
         ttl_buckets: &mut TtlBuckets,
         hashtable: &mut HashTable,
+    ) -> Result<(), SegmentsError> {
+        // segments which were flushed are freed before any segment which
+        // holds live items
+        if self.is_flushing() && ttl_buckets.reclaim(hashtable, self, 1) > 0 {
+            return Ok(());
+        }
+
+        usdt!(evict_begin, self.free());
+        let result = self.evict_by_policy(ttl_buckets, hashtable);
+        usdt!(evict_end, result.is_ok() as u8, self.free());
+        result
+    }
+
+    fn evict_by_policy(
+        &mut self,
+        ttl_buckets: &mut TtlBuckets,
+        hashtable: &mut HashTable,
     ) -> Result<(), SegmentsError> {
         #[cfg(feature = "metrics")]
         let now = Instant::now();
@@ -207,7 +706,10 @@ impl Segments {
                     let ttl_bucket = &mut ttl_buckets.buckets[bucket_id];
                     if let Some(first_seg) = ttl_bucket.head() {
                         let start = ttl_bucket.next_to_merge().unwrap_or(first_seg);
-                        match self.merge_evict(start, hashtable) {
+                        usdt!(merge_begin, start.get());
+                        let result = self.merge_evict(start, hashtable);
+                        usdt!(merge_end, start.get(), result.is_ok() as u8);
+                        match result {
                             Ok(next_to_merge) => {
                                 debug!("merged ttl_bucket: {} seg: {}", bucket_id, start);
                                 ttl_bucket.set_next_to_merge(next_to_merge);
@@ -236,6 +738,22 @@ impl Segments {
 
                 Err(SegmentsError::NoEvictableSegments)
             }
+            Policy::S3Fifo => {
+                #[cfg(feature = "metrics")]
+                SEGMENT_EVICT.increment();
+
+                let result = self.s3fifo_evict(ttl_buckets, hashtable);
+
+                #[cfg(feature = "metrics")]
+                {
+                    if result.is_err() {
+                        SEGMENT_EVICT_EX.increment();
+                    }
+                    EVICT_TIME.add(now.elapsed().as_nanos() as _);
+                }
+
+                result
+            }
             Policy::None => {
                 #[cfg(feature = "metrics")]
                 EVICT_TIME.add(now.elapsed().as_nanos() as _);
@@ -282,8 +800,21 @@ impl Segments {
         }
     }
 
-    /// Returns a mutable `Segment` view for the segment with the specified id
+    /// Returns a mutable `Segment` view for the segment with the specified id,
+    /// which may be either an in-memory or a flash segment
     pub(crate) fn get_mut(&mut self, id: NonZeroU32) -> Result<Segment, SegmentsError> {
+        if id.get() > self.cap && self.evict.flash().is_some() {
+            return self.evict.flash_mut().unwrap().get_mut(id);
+        }
+        self.get_mut_with_flash(id).map(|(segment, _)| segment)
+    }
+
+    /// Returns a mutable `Segment` view for the in-memory segment with the
+    /// specified id along with the flash tier, if there is one.
+    fn get_mut_with_flash(
+        &mut self,
+        id: NonZeroU32,
+    ) -> Result<(Segment, Option<&mut Flash>), SegmentsError> {
         let id = id.get() as usize - 1;
         if id < self.headers.len() {
             let header = self.headers.get_mut(id).unwrap();
@@ -295,7 +826,7 @@ impl Segments {
 
             let segment = Segment::from_raw_parts(header, seg_data);
             segment.check_magic();
-            Ok(segment)
+            Ok((segment, self.evict.flash_mut()))
         } else {
             Err(SegmentsError::BadSegmentId)
         }
@@ -308,6 +839,16 @@ impl Segments {
         a: NonZeroU32,
         b: NonZeroU32,
     ) -> Result<(Segment, Segment), SegmentsError> {
+        self.get_mut_pair_with_flash(a, b).map(|(a, b, _)| (a, b))
+    }
+
+    /// Gets a mutable `Segment` view for two in-memory segments along with the
+    /// flash tier, if there is one.
+    fn get_mut_pair_with_flash(
+        &mut self,
+        a: NonZeroU32,
+        b: NonZeroU32,
+    ) -> Result<(Segment, Segment, Option<&mut Flash>), SegmentsError> {
         if a == b {
             Err(SegmentsError::BadSegmentId)
         } else {
@@ -354,7 +895,7 @@ impl Segments {
 
                 segment_a.check_magic();
                 segment_b.check_magic();
-                Ok((segment_a, segment_b))
+                Ok((segment_a, segment_b, self.evict.flash_mut()))
             }
         }
     }
@@ -422,26 +963,45 @@ impl Segments {
         if self.free == 0 {
             None
         } else {
+            #[cfg(feature = "metrics")]
+            SEGMENT_REQUEST.increment();
+
+            assert!(self.free_q.is_some());
+
+            // segments which are still pinned may be read by another thread,
+            // so we take the first segment from the queue which is not pinned
+            let mut prev = None;
+            let mut id = self.free_q;
+            while let Some(current) = id {
+                if !self.headers[current.get() as usize - 1].is_pinned() {
+                    break;
+                }
+
+                #[cfg(feature = "metrics")]
+                SEGMENT_FREE_PINNED.increment();
+
+                prev = id;
+                id = self.headers[current.get() as usize - 1].next_seg();
+            }
+
+            let id_idx = id?.get() as usize - 1;
+
             #[cfg(feature = "metrics")]
             {
-                SEGMENT_REQUEST.increment();
                 SEGMENT_REQUEST_SUCCESS.increment();
                 SEGMENT_FREE.decrement();
             }
 
             self.free -= 1;
-            let id = self.free_q;
-            assert!(id.is_some());
-
-            let id_idx = id.unwrap().get() as usize - 1;
 
-            if let Some(next) = self.headers[id_idx].next_seg() {
-                self.free_q = Some(next);
-                // this is not really necessary
-                let next = &mut self.headers[next.get() as usize - 1];
-                next.set_prev_seg(None);
+            let next = self.headers[id_idx].next_seg();
+            if let Some(prev) = prev {
+                self.headers[prev.get() as usize - 1].set_next_seg(next);
             } else {
-                self.free_q = None;
+                self.free_q = next;
+            }
+            if let Some(next) = next {
+                self.headers[next.get() as usize - 1].set_prev_seg(prev);
             }
 
             #[cfg(not(feature = "magic"))]
@@ -458,6 +1018,7 @@ impl Segments {
 
             self.headers[id_idx].mark_created();
             self.headers[id_idx].mark_merged();
+            self.headers[id_idx].set_epoch(self.epoch);
 
             id
         }
@@ -510,6 +1071,19 @@ impl Segments {
 
                 None
             }
+            Policy::Score { .. } => {
+                if let Some(id) = self.evict.score_seg(&self.headers) {
+                    return Some(id);
+                }
+
+                // none of the samples can be evicted, so take the first
+                // segment which can, as for random eviction
+                let start = self.evict.random() % self.cap;
+                (0..self.cap)
+                    .map(|i| (start + i) % self.cap)
+                    .find(|idx| self.headers[*idx as usize].can_evict())
+                    .and_then(|idx| NonZeroU32::new(idx + 1))
+            }
             _ => {
                 if self.evict.should_rerank() {
                     self.evict.rerank(&self.headers);
@@ -549,6 +1123,13 @@ impl Segments {
         ttl_buckets: &mut TtlBuckets,
         hashtable: &mut HashTable,
     ) -> Result<(), SegmentsError> {
+        // items in flash segments are only removed, the flash segments are
+        // reused in order and are never merged or freed
+        if let Some(flash) = self.evict.flash_mut().filter(|f| f.contains(seg_id)) {
+            flash.get_mut(seg_id)?.remove_item_at(offset);
+            return Ok(());
+        }
+
         // remove the item
         {
             let mut segment = self.get_mut(seg_id)?;
@@ -573,6 +1154,12 @@ impl Segments {
             }
         }
 
+        // while flushed segments remain, a merge could move items between a
+        // flushed segment and one which is not, so none is done
+        if self.is_flushing() {
+            return Ok(());
+        }
+
         // for merge eviction, we check if the segment is now below the target
         // ratio which serves as a low watermark for occupancy. if it is, we do
         // a no-evict merge (compaction only, no-pruning)
@@ -611,7 +1198,9 @@ impl Segments {
 
                 // if the next segment is empty enough, proceed to merge compaction
                 if next_ratio <= target_ratio {
-                    let _ = self.merge_compact(seg_id, hashtable);
+                    usdt!(compact_begin, seg_id.get());
+                    let _result = self.merge_compact(seg_id, hashtable);
+                    usdt!(compact_end, seg_id.get(), _result.is_ok() as u8);
                     // we need to make sure the ttl bucket doesn't have a pointer to
                     // any of the segments we removed through merging.
                     let ttl_bucket = ttl_buckets.get_mut_bucket(self.headers[id_idx].ttl());
@@ -637,7 +1226,7 @@ impl Segments {
             debug!("{} items in segment {} segment: {:?}", count, id, segment);
             total += segment.live_items() as usize;
         }
-        total
+        total + self.evict.flash().map(|f| f.items()).unwrap_or(0)
     }
 
     #[cfg(test)]
@@ -763,11 +1352,11 @@ impl Segments {
 
         // prune and compact target segment
         {
-            let mut dst = self.get_mut(start)?;
+            let (mut dst, flash) = self.get_mut_with_flash(start)?;
             let dst_old_size = dst.live_bytes();
 
             trace!("prune merge with cutoff: {}", cutoff);
-            cutoff = dst.prune(hashtable, cutoff, target_ratio);
+            cutoff = dst.prune(hashtable, cutoff, target_ratio, flash);
             trace!("cutoff is now: {}", cutoff);
 
             dst.compact(hashtable)?;
@@ -798,7 +1387,23 @@ impl Segments {
                 return Ok(None); // this causes the next_to_merge to reset
             }
 
-            let (mut dst, mut src) = self.get_mut_pair(dst_id, src_id)?;
+            let (mut dst, mut src, mut flash) = self.get_mut_pair_with_flash(dst_id, src_id)?;
+
+            // a source which has aged past the threshold of the flash tier is
+            // moved into it whole, and the target is left to younger items
+            if let Some(flash) = flash.as_deref_mut().filter(|f| f.is_aged(&src)) {
+                trace!("moving aged source segment into flash");
+                src.demote(hashtable, flash);
+                next_id = src.next_seg();
+                src.clear(hashtable, false);
+                self.push_free(src_id);
+                merged += 1;
+
+                #[cfg(feature = "metrics")]
+                FLASH_SEGMENT_AGED.increment();
+
+                continue;
+            }
 
             let dst_start_size = dst.live_bytes();
             let src_start_size = src.live_bytes();
@@ -809,7 +1414,7 @@ impl Segments {
             }
 
             trace!("pruning source segment");
-            cutoff = src.prune(hashtable, cutoff, target_ratio);
+            cutoff = src.prune(hashtable, cutoff, target_ratio, flash.as_deref_mut());
 
             trace!(
                 "src {}: {} bytes -> {} bytes",
@@ -830,6 +1435,10 @@ impl Segments {
             );
 
             next_id = src.next_seg();
+            // anything which did not fit into the target is moved to flash
+            if let Some(flash) = flash {
+                src.demote(hashtable, flash);
+            }
             src.clear(hashtable, false);
             self.push_free(src_id);
             merged += 1;
@@ -838,7 +1447,169 @@ impl Segments {
         Ok(next_id)
     }
 
-    fn merge_compact(
+    /// Evicts for S3-FIFO eviction until a segment is freed. A pass over the
+    /// small queue may keep every item it looks at, in which case the next
+    /// pass looks at the segments which follow. Returns an error if no
+    /// segment could be freed.
+    fn s3fifo_evict(
+        &mut self,
+        ttl_buckets: &mut TtlBuckets,
+        hashtable: &mut HashTable,
+    ) -> Result<(), SegmentsError> {
+        for _ in 0..self.evict.max_merge() {
+            let free = self.free;
+
+            // the oldest evictable segment of each queue, by the time it was
+            // created for the small queue and by the time it joined the main
+            // queue otherwise, along with the size of the queues
+            let mut small: Option<&SegmentHeader> = None;
+            let mut main: Option<&SegmentHeader> = None;
+            let mut probationary = 0;
+            let mut main_items = 0;
+            for header in self.headers.iter().filter(|h| h.accessible()) {
+                let probation = header.merges() == 0;
+                if probation {
+                    probationary += 1;
+                } else {
+                    main_items += header.live_items() as usize;
+                }
+                if !header.can_evict() {
+                    continue;
+                }
+                if probation {
+                    if small.map_or(true, |s| header.create_at() < s.create_at()) {
+                        small = Some(header);
+                    }
+                } else if main.map_or(true, |m| header.merge_at() < m.merge_at()) {
+                    main = Some(header);
+                }
+            }
+            let used = (self.cap - self.free) as usize;
+            let (small, main) = match (small.map(|h| h.id()), main.map(|h| h.id())) {
+                (Some(small), Some(_)) if probationary * S3FIFO_SMALL_RATIO >= used => {
+                    (Some(small), None)
+                }
+                (Some(small), None) => (Some(small), None),
+                (_, Some(main)) => (None, Some(main)),
+                (None, None) => break,
+            };
+
+            if let Some(id) = small {
+                self.evict.ghost_mut().set_capacity(main_items);
+                self.probation_evict(id, ttl_buckets, hashtable)?;
+            } else if let Some(id) = main {
+                if self.merge_evict(id, hashtable).is_err() {
+                    self.clear_segment(id, hashtable, false)
+                        .map_err(|_| SegmentsError::EvictFailure)?;
+                    self.unlink_evicted(id, ttl_buckets);
+                }
+            }
+
+            if self.free > free {
+                return Ok(());
+            }
+        }
+
+        Err(SegmentsError::NoEvictableSegments)
+    }
+
+    /// Evicts from the small queue of S3-FIFO, starting with the oldest
+    /// probationary segment. The items which are kept are merged into it
+    /// along with those of the probationary segments which follow it in the
+    /// chain, which are freed, and the segment then joins the main queue. The
+    /// segment is also freed if none of its items were kept.
+    fn probation_evict(
+        &mut self,
+        start: NonZeroU32,
+        ttl_buckets: &mut TtlBuckets,
+        hashtable: &mut HashTable,
+    ) -> Result<(), SegmentsError> {
+        #[cfg(feature = "metrics")]
+        SEGMENT_EVICT_PROBATION.increment();
+
+        // the ghost set is taken while segments of this are borrowed
+        let mut ghost = std::mem::take(self.evict.ghost_mut());
+        let result = self.probation_merge(start, hashtable, &mut ghost);
+        *self.evict.ghost_mut() = ghost;
+        result?;
+
+        let empty = self
+            .get_mut(start)
+            .map(|s| s.live_items() == 0 && s.can_evict())?;
+        if empty {
+            self.clear_segment(start, hashtable, false)
+                .map_err(|_| SegmentsError::EvictFailure)?;
+            self.unlink_evicted(start, ttl_buckets);
+        }
+
+        Ok(())
+    }
+
+    fn probation_merge(
+        &mut self,
+        start: NonZeroU32,
+        hashtable: &mut HashTable,
+        ghost: &mut Ghost,
+    ) -> Result<(), SegmentsError> {
+        let max_merge = self.evict.max_merge();
+        let stop_bytes = (self.evict.stop_ratio() * self.segment_size() as f64) as i32;
+
+        {
+            let (mut dst, flash) = self.get_mut_with_flash(start)?;
+            dst.prune_probation(hashtable, ghost, flash);
+            dst.compact(hashtable)?;
+            dst.mark_merged();
+        }
+
+        let mut next_id = self.get_mut(start).map(|s| s.next_seg())?;
+        let mut merged = 1;
+
+        while let Some(src_id) = next_id {
+            if merged >= max_merge {
+                break;
+            }
+
+            let src_idx = src_id.get() as usize - 1;
+            if src_idx >= self.headers.len()
+                || self.headers[src_idx].merges() != 0
+                || !self.headers[src_idx].can_evict()
+            {
+                break;
+            }
+
+            let (mut dst, mut src, mut flash) = self.get_mut_pair_with_flash(start, src_id)?;
+            if dst.live_bytes() >= stop_bytes {
+                break;
+            }
+
+            src.prune_probation(hashtable, ghost, flash.as_deref_mut());
+            let _ = src.copy_into(&mut dst, hashtable);
+
+            next_id = src.next_seg();
+            // anything which did not fit into the target is moved to flash
+            if let Some(flash) = flash {
+                src.demote(hashtable, flash);
+            }
+            src.clear(hashtable, false);
+            self.push_free(src_id);
+            merged += 1;
+        }
+
+        Ok(())
+    }
+
+    /// Frees a segment which was cleared by eviction, relinking the head of
+    /// its ttl bucket if it was the head.
+    fn unlink_evicted(&mut self, id: NonZeroU32, ttl_buckets: &mut TtlBuckets) {
+        let id_idx = id.get() as usize - 1;
+        if self.headers[id_idx].prev_seg().is_none() {
+            let ttl_bucket = ttl_buckets.get_mut_bucket(self.headers[id_idx].ttl());
+            ttl_bucket.set_head(self.headers[id_idx].next_seg());
+        }
+        self.push_free(id);
+    }
+
+    pub(crate) fn merge_compact(
         &mut self,
         start: NonZeroU32,
         hashtable: &mut HashTable,
@@ -946,3 +1717,24 @@ impl Segments {
         Ok(next_id)
     }
 }
+
+impl Drop for Segments {
+    fn drop(&mut self) {
+        if self.headers.iter().any(|header| header.is_pinned()) {
+            // items may still be read through outstanding pins, so the memory
+            // must outlive them
+            warn!("leaking segments which are still pinned");
+            std::mem::forget(std::mem::take(&mut self.headers));
+        } else {
+            #[cfg(feature = "metrics")]
+            {
+                SEGMENT_HEAP_BYTES.sub((self.cap as usize * self.segment_size as usize) as _);
+                SEGMENT_HEADER_BYTES
+                    .sub((self.headers.len() * core::mem::size_of::<SegmentHeader>()) as _);
+            }
+
+            // SAFETY: the datapool is not accessed again after this
+            unsafe { ManuallyDrop::drop(&mut self.data) };
+        }
+    }
+}
@@ -0,0 +1,420 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! A concurrent wrapper which partitions the keyspace across multiple
+//! independent [`Segcache`] instances.
+//!
+//! Each shard owns its own hashtable, segments, and TTL buckets and is
+//! protected by its own lock. Keys are routed to a shard using a hash which is
+//! independent from the one used within the shard hashtables, so the bucket
+//! distribution within each shard is unaffected by routing. Threads operating
+//! on keys which map to different shards proceed without contention.
+//!
+//! The shards may also be divided into partitions, see [`Builder::partition`].
+//! A key is routed to the partition with the longest prefix of the key, and
+//! then by its hash to one of that partition's shards.
+
+use crate::*;
+
+use ahash::RandomState;
+use parking_lot::{Mutex, MutexGuard};
+
+// the cursor of a scan holds the index of the shard being scanned above the
+// cursor within the shard, which is far smaller than this
+const SCAN_SHARD_SHIFT: u32 = 48;
+
+/// A concurrent, sharded [`Segcache`]. This type is `Sync` and is intended to
+/// be shared between threads, for instance by wrapping it in an `Arc`.
+pub struct ShardedSegcache {
+    router: Router,
+    shards: Box<[Mutex<Segcache>]>,
+    partitions: Box<[Partition]>,
+}
+
+/// Maps keys to the index of the shard which owns them. A `Router` may be
+/// kept after a [`ShardedSegcache`] is broken up into its shards with
+/// [`ShardedSegcache::into_shards`], so that the shards can be owned by
+/// different threads while keys are routed exactly as before.
+#[derive(Clone)]
+pub struct Router {
+    hash_builder: RandomState,
+    mask: usize,
+    /// the partitions other than the default, longest prefix first
+    routes: Box<[Route]>,
+    shards: usize,
+}
+
+#[derive(Clone)]
+struct Route {
+    prefix: Box<[u8]>,
+    offset: usize,
+    mask: usize,
+    partition: usize,
+}
+
+impl Router {
+    /// Creates a new `Router` for the provided number of shards, which must be
+    /// a non-zero power of two.
+    pub fn new(shards: usize) -> Self {
+        assert!(
+            shards.is_power_of_two(),
+            "number of shards must be a power of two"
+        );
+
+        // NOTE: these seeds must differ from those used by the `HashTable` so
+        // that routing does not bias the bucket selection within a shard
+        let hash_builder = RandomState::with_seeds(
+            0x3c6ef372fe94f82b,
+            0xa54ff53a5f1d36f1,
+            0x510e527fade682d1,
+            0x9b05688c2b3e6c1f,
+        );
+
+        Self {
+            hash_builder,
+            mask: shards - 1,
+            routes: Box::new([]),
+            shards,
+        }
+    }
+
+    /// Creates a `Router` for the partitions, the first of which is the
+    /// default partition.
+    pub(crate) fn with_partitions(partitions: &[Partition]) -> Self {
+        let mut router = Self::new(partitions[0].shards.len());
+
+        let mut routes: Vec<Route> = partitions
+            .iter()
+            .enumerate()
+            .skip(1)
+            .map(|(partition, p)| Route {
+                prefix: p.prefix.clone(),
+                offset: p.shards.start,
+                mask: p.shards.len() - 1,
+                partition,
+            })
+            .collect();
+        routes.sort_by(|a, b| b.prefix.len().cmp(&a.prefix.len()));
+
+        router.routes = routes.into_boxed_slice();
+        router.shards = partitions.last().map(|p| p.shards.end).unwrap_or(0);
+        router
+    }
+
+    /// Returns the number of shards, across all partitions.
+    pub fn shards(&self) -> usize {
+        self.shards
+    }
+
+    /// Returns the index of the shard which owns the provided key.
+    pub fn shard_index(&self, key: &[u8]) -> usize {
+        let mut hasher = self.hash_builder.build_hasher();
+        hasher.write(key);
+        let hash = hasher.finish() as usize;
+
+        for route in self.routes.iter() {
+            if key.starts_with(&route.prefix) {
+                return route.offset + (hash & route.mask);
+            }
+        }
+        hash & self.mask
+    }
+
+    /// Returns the index of the partition which owns the provided key, in the
+    /// order of [`ShardedSegcache::partitions`]. Keys which match no prefix
+    /// belong to the default partition, at index zero.
+    pub fn partition_index(&self, key: &[u8]) -> usize {
+        self.routes
+            .iter()
+            .find(|route| key.starts_with(&route.prefix))
+            .map(|route| route.partition)
+            .unwrap_or(0)
+    }
+}
+
+impl ShardedSegcache {
+    /// Creates a new `ShardedSegcache` from a collection of shards and the
+    /// partitions they are divided into, the first of which is the default
+    /// partition. The number of shards of each partition must be a non-zero
+    /// power of two.
+    pub(crate) fn new(shards: Vec<Segcache>, partitions: Vec<Partition>) -> Self {
+        Self {
+            router: Router::with_partitions(&partitions),
+            shards: shards.into_iter().map(Mutex::new).collect(),
+            partitions: partitions.into_boxed_slice(),
+        }
+    }
+
+    /// Returns the number of shards.
+    pub fn shards(&self) -> usize {
+        self.shards.len()
+    }
+
+    /// Returns the index of the shard which owns the provided key.
+    pub fn shard_index(&self, key: &[u8]) -> usize {
+        self.router.shard_index(key)
+    }
+
+    /// Returns the `Router` which maps keys to shards.
+    pub fn router(&self) -> &Router {
+        &self.router
+    }
+
+    /// Breaks the cache up into its shards, which are returned in order of
+    /// their index, along with the `Router` which maps keys to them. This
+    /// allows each shard to be owned by a single thread, with requests for a
+    /// key sent to the thread which owns its shard, instead of sharing all of
+    /// the shards behind locks.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let cache = Segcache::builder().shards(4).build_sharded().expect("failed to create cache");
+    /// let (router, mut shards) = cache.into_shards();
+    /// assert_eq!(shards.len(), 4);
+    ///
+    /// let shard = &mut shards[router.shard_index(b"coffee")];
+    /// shard.insert(b"coffee", b"strong", None, Duration::ZERO);
+    /// assert!(shard.get(b"coffee").is_some());
+    /// ```
+    pub fn into_shards(self) -> (Router, Vec<Segcache>) {
+        let shards = self
+            .shards
+            .into_vec()
+            .into_iter()
+            .map(Mutex::into_inner)
+            .collect();
+        (self.router, shards)
+    }
+
+    /// Locks and returns the shard which owns the provided key. All operations
+    /// on the key should be performed through the returned guard. Any `Item`s
+    /// borrowed from the shard are only valid while the guard is held.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let cache = Segcache::builder().shards(4).build_sharded().expect("failed to create cache");
+    ///
+    /// cache.shard(b"coffee").insert(b"coffee", b"strong", None, Duration::ZERO);
+    ///
+    /// let mut shard = cache.shard(b"coffee");
+    /// let item = shard.get(b"coffee").expect("didn't get item back");
+    /// assert_eq!(item.value(), b"strong");
+    /// ```
+    pub fn shard(&self, key: &[u8]) -> MutexGuard<'_, Segcache> {
+        self.shards[self.shard_index(key)].lock()
+    }
+
+    /// Scans the keys of each shard in turn, locking only the shard which is
+    /// being scanned. The cursor holds the index of the shard along with the
+    /// cursor within it. See [`Segcache::scan`] for details.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let cache = Segcache::builder().shards(4).build_sharded().expect("failed to create cache");
+    /// cache.shard(b"coffee").insert(b"coffee", b"strong", None, Duration::ZERO);
+    ///
+    /// let mut keys = Vec::new();
+    /// let mut cursor = 0;
+    /// loop {
+    ///     cursor = cache.scan(cursor, 100, &mut keys);
+    ///     if cursor == 0 {
+    ///         break;
+    ///     }
+    /// }
+    /// assert_eq!(keys, vec![b"coffee".to_vec().into()]);
+    /// ```
+    pub fn scan(&self, cursor: u64, count: usize, keys: &mut Vec<Box<[u8]>>) -> u64 {
+        let index = (cursor >> SCAN_SHARD_SHIFT) as usize;
+        let shard = match self.shards.get(index) {
+            Some(shard) => shard,
+            None => return 0,
+        };
+
+        let next = shard
+            .lock()
+            .scan(cursor & ((1 << SCAN_SHARD_SHIFT) - 1), count, keys);
+        debug_assert!(next >> SCAN_SHARD_SHIFT == 0);
+
+        if next != 0 {
+            ((index as u64) << SCAN_SHARD_SHIFT) | next
+        } else if index + 1 < self.shards.len() {
+            ((index + 1) as u64) << SCAN_SHARD_SHIFT
+        } else {
+            0
+        }
+    }
+
+    /// Calls `f` with the live items of each shard in turn, locking only the
+    /// shard which is being scanned. The cursor is that of
+    /// [`ShardedSegcache::scan`]. See [`Segcache::scan_items`] for details.
+    pub fn scan_items<F: FnMut(&Item)>(&self, cursor: u64, count: usize, f: F) -> u64 {
+        let index = (cursor >> SCAN_SHARD_SHIFT) as usize;
+        let shard = match self.shards.get(index) {
+            Some(shard) => shard,
+            None => return 0,
+        };
+
+        let next = shard
+            .lock()
+            .scan_items(cursor & ((1 << SCAN_SHARD_SHIFT) - 1), count, f);
+        debug_assert!(next >> SCAN_SHARD_SHIFT == 0);
+
+        if next != 0 {
+            ((index as u64) << SCAN_SHARD_SHIFT) | next
+        } else if index + 1 < self.shards.len() {
+            ((index + 1) as u64) << SCAN_SHARD_SHIFT
+        } else {
+            0
+        }
+    }
+
+    /// Invalidates every item whose key starts with the prefix across all of
+    /// the shards. Returns false unless the cache was built with namespaces
+    /// enabled. See [`Segcache::invalidate_prefix`] for details.
+    pub fn invalidate_prefix(&self, prefix: &[u8]) -> bool {
+        self.shards.iter().fold(true, |enabled, shard| {
+            shard.lock().invalidate_prefix(prefix) && enabled
+        })
+    }
+
+    /// Handles eager expiration across all shards, returning the number of
+    /// segments expired. Shards which are currently locked by another thread
+    /// are skipped, as they will be expired by a later call.
+    pub fn expire(&self) -> usize {
+        self.shards
+            .iter()
+            .filter_map(|shard| shard.try_lock())
+            .map(|mut shard| shard.expire())
+            .sum()
+    }
+
+    /// Performs background maintenance on all shards, returning the number of
+    /// segments evicted or freed by compaction. See [`Segcache::maintain`] for
+    /// details. As with `expire`, shards which are currently locked are
+    /// skipped.
+    pub fn maintain(&self) -> usize {
+        self.shards
+            .iter()
+            .filter_map(|shard| shard.try_lock())
+            .map(|mut shard| shard.maintain())
+            .sum()
+    }
+
+    /// Changes the eviction policy of the shards of the default partition,
+    /// which are all of the shards when there are no other partitions. See
+    /// [`Segcache::set_eviction`] for details.
+    pub fn set_eviction(&self, policy: Policy) {
+        let shards = match self.partitions.first() {
+            Some(partition) => &self.shards[partition.shards.clone()],
+            None => &self.shards[..],
+        };
+        for shard in shards {
+            shard.lock().set_eviction(policy);
+        }
+    }
+
+    /// Removes all items from every shard in constant time, see
+    /// [`Segcache::flush`].
+    pub fn flush(&self) {
+        for shard in self.shards.iter() {
+            shard.lock().flush();
+        }
+    }
+
+    /// Removes all items from every shard, returning the number of segments
+    /// cleared.
+    pub fn clear(&self) -> usize {
+        self.shards.iter().map(|shard| shard.lock().clear()).sum()
+    }
+
+    /// Persists every shard so that the cache may be restored by a later
+    /// instance. See [`Segcache::persist`] for details.
+    pub fn persist(&self) -> Result<(), std::io::Error> {
+        for shard in self.shards.iter() {
+            shard.lock().persist()?;
+        }
+        Ok(())
+    }
+
+    /// Returns the memory held by all of the shards. See
+    /// [`Segcache::memory_usage`] for details.
+    pub fn memory_usage(&self) -> MemoryUsage {
+        let mut usage = MemoryUsage::default();
+        for shard in self.shards.iter() {
+            usage.add(&shard.lock().memory_usage());
+        }
+        usage
+    }
+
+    /// Returns the counters and the memory usage of each partition, the default
+    /// partition first and then in the order they were added to the builder.
+    /// Each shard is locked only while its own counters are read.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// const MB: usize = 1024 * 1024;
+    ///
+    /// let cache = Segcache::builder()
+    ///     .heap_size(8 * MB)
+    ///     .partition("sessions", b"session:", Segcache::builder().heap_size(2 * MB))
+    ///     .build_sharded()
+    ///     .expect("failed to create cache");
+    ///
+    /// cache.shard(b"session:1").insert(b"session:1", b"alice", None, Duration::ZERO);
+    /// assert!(cache.shard(b"session:1").get(b"session:1").is_some());
+    ///
+    /// let partitions = cache.partitions();
+    /// assert_eq!(partitions[1].name, "sessions");
+    /// assert_eq!(partitions[1].access.hits, 1);
+    /// assert_eq!(partitions[1].usage.items, 1);
+    /// assert_eq!(partitions[0].usage.items, 0);
+    /// ```
+    pub fn partitions(&self) -> Vec<PartitionStats> {
+        self.partitions
+            .iter()
+            .map(|partition| {
+                let mut access = AccessStats::default();
+                let mut usage = MemoryUsage::default();
+                for shard in &self.shards[partition.shards.clone()] {
+                    let shard = shard.lock();
+                    access.add(&shard.access_stats());
+                    usage.add(&shard.memory_usage());
+                }
+                PartitionStats {
+                    name: partition.name.clone(),
+                    prefix: partition.prefix.to_vec(),
+                    shards: partition.shards.clone(),
+                    access,
+                    usage,
+                }
+            })
+            .collect()
+    }
+
+    /// Returns a snapshot of the segments of each shard, in the order of the
+    /// shards. See [`Segcache::segment_stats`] for details. Each shard is
+    /// locked only while its own snapshot is taken.
+    pub fn segment_stats(&self) -> Vec<SegmentStats> {
+        self.shards
+            .iter()
+            .map(|shard| shard.lock().segment_stats())
+            .collect()
+    }
+
+    /// Gets a count of items across all shards. This is an expensive
+    /// operation and is only enabled for tests and builds with the `debug`
+    /// feature enabled.
+    #[cfg(any(test, feature = "debug"))]
+    pub fn items(&self) -> usize {
+        self.shards.iter().map(|shard| shard.lock().items()).sum()
+    }
+}
@@ -0,0 +1,138 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Sizing of the hashtable and the segments for the items a heap holds.
+//!
+//! A hashtable sized for fewer items than the heap holds runs into long
+//! overflow chains, and then evicts items to make room in them, while one
+//! sized for more items than it holds wastes memory. Segments which are small
+//! for the items spread them over many segment headers, and segments which
+//! are large for the heap leave few of them to evict and merge. The sizing is
+//! derived from the heap size and the mean size of the key, value and
+//! optional data of an item: either as expected before the cache is built, or
+//! as measured from the items of a [`SegmentStats`] snapshot.
+
+use crate::*;
+
+// the share of the item slots of the primary buckets which the items are
+// expected to fill, leaving room for keys which hash unevenly
+const HASH_LOAD: f64 = 0.75;
+
+// the number of times the hashtable may double if the items turn out to be
+// smaller than expected
+const HASH_GROWTH: u8 = 2;
+
+// the largest hash power which is derived
+const MAX_HASH_POWER: u8 = 40;
+
+// segments are sized to hold about this many items of the mean size, as long
+// as the heap is split into at least MIN_SEGMENTS of them
+const SEGMENT_ITEMS: usize = 1024;
+const MIN_SEGMENTS: usize = 64;
+const MIN_SEGMENT_SIZE: usize = 64 * 1024;
+
+/// The hash power, the hash power the hashtable may grow to, and the segment
+/// size for a heap of items of a mean size.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub struct Sizing {
+    pub hash_power: u8,
+    pub max_hash_power: u8,
+    pub segment_size: i32,
+}
+
+impl Sizing {
+    /// Returns the sizing for a heap of `heap_size` bytes filled with items
+    /// whose key, value and optional data are `item_size` bytes on average.
+    ///
+    /// ```
+    /// use segcache::Sizing;
+    ///
+    /// const MB: usize = 1024 * 1024;
+    ///
+    /// let small = Sizing::new(1024 * MB, 64);
+    /// let large = Sizing::new(1024 * MB, 4096);
+    ///
+    /// // smaller items need more slots, and fit into smaller segments
+    /// assert!(small.hash_power > large.hash_power);
+    /// assert!(small.segment_size < large.segment_size);
+    /// assert!(small.max_hash_power > small.hash_power);
+    /// ```
+    pub fn new(heap_size: usize, item_size: usize) -> Self {
+        let item_size = (((ITEM_HDR_SIZE + item_size) >> 3) + 1) << 3;
+        let items = (heap_size / item_size).max(1);
+
+        // the first slot of each bucket holds the bucket info rather than an
+        // item, and the hash power counts all slots
+        let slots = items as f64 / HASH_LOAD * N_BUCKET_SLOT as f64 / (N_BUCKET_SLOT - 1) as f64;
+        let min_power = N_BUCKET_SLOT.trailing_zeros().max(3) as u8;
+        let hash_power = (slots.log2().ceil() as u8).clamp(min_power, MAX_HASH_POWER);
+
+        let mut segment_size = (item_size * SEGMENT_ITEMS)
+            .next_power_of_two()
+            .clamp(MIN_SEGMENT_SIZE, MAX_SEGMENT_SIZE);
+        while segment_size > MIN_SEGMENT_SIZE && heap_size / segment_size < MIN_SEGMENTS {
+            segment_size /= 2;
+        }
+        while segment_size < MAX_SEGMENT_SIZE && heap_size / segment_size >= MAX_SEGMENTS {
+            segment_size *= 2;
+        }
+
+        Self {
+            hash_power,
+            max_hash_power: hash_power.saturating_add(HASH_GROWTH).min(MAX_HASH_POWER),
+            segment_size: segment_size.min(i32::MAX as usize) as i32,
+        }
+    }
+}
+
+/// Returns the mean size of the key, value and optional data of `live_items`
+/// items which take `live_bytes` bytes including their headers, as found in
+/// [`SegmentInfo`], or `None` if there are none.
+pub fn mean_item_size(live_bytes: usize, live_items: usize) -> Option<usize> {
+    (live_items > 0).then(|| (live_bytes / live_items).saturating_sub(ITEM_HDR_SIZE))
+}
+
+/// The occupancy of the hashtable at the time of a [`SegmentStats`] snapshot.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct HashtableInfo {
+    /// The current hash power, which is the log2 of the number of slots of
+    /// the primary buckets.
+    pub power: u8,
+    /// Number of slots of the primary buckets which can hold items.
+    pub item_slots: usize,
+    /// Number of overflow buckets which have been chained to primary buckets
+    /// since the table was allocated.
+    pub overflow_used: usize,
+    /// Number of overflow buckets allocated.
+    pub overflow_buckets: usize,
+}
+
+impl SegmentStats {
+    /// Returns the mean size of the key, value and optional data of the live
+    /// items, or `None` if there are none.
+    pub fn item_size(&self) -> Option<usize> {
+        let (bytes, items) = self.segments.iter().fold((0, 0), |(bytes, items), s| {
+            (bytes + s.live_bytes, items + s.live_items)
+        });
+        mean_item_size(bytes, items)
+    }
+
+    /// Returns the live items per item slot of the primary buckets, which is
+    /// above 1.0 once items spill into overflow buckets.
+    pub fn hash_load(&self) -> f64 {
+        if self.hashtable.item_slots == 0 {
+            return 0.0;
+        }
+        let items: usize = self.segments.iter().map(|s| s.live_items).sum();
+        items as f64 / self.hashtable.item_slots as f64
+    }
+
+    /// Returns the sizing for the heap of the snapshot and the mean size of
+    /// its live items, or `None` if there are none. A hash power above the
+    /// current one means that the hashtable is small for the items.
+    pub fn sizing(&self) -> Option<Sizing> {
+        self.item_size()
+            .map(|item_size| Sizing::new(self.segment_size * self.segments.len(), item_size))
+    }
+}
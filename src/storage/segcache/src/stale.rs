@@ -0,0 +1,216 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Serving of items which have recently expired, and leases which let one
+//! client at a time recompute them.
+//!
+//! Segments are kept for a grace period after they expire. Items within them
+//! are treated as missing by reads, but may still be read as stale, so that
+//! the clients of a hot key which has just expired can keep being served the
+//! old value while a single client recomputes it. That client is the one
+//! which is granted the lease for the key, and the other clients are refused
+//! one until it is stored, deleted, or the lease expires.
+//!
+//! Leases are kept by the hash of their key, so that the table stays small,
+//! and a collision only delays the recompute of another key until the lease
+//! expires. The grace period is disabled by default.
+
+use crate::*;
+use std::collections::HashMap;
+
+/// The default time a lease is held for.
+pub(crate) const DEFAULT_LEASE_TTL: std::time::Duration = std::time::Duration::from_secs(30);
+
+// expired leases are swept each time their number doubles since the last
+// sweep
+const SWEEP_MIN: usize = 1024;
+
+/// The stale grace period along with the leases which are held.
+pub(crate) struct Stale {
+    grace: Duration,
+    lease_ttl: Duration,
+    leases: HashMap<u64, Instant>,
+    sweep_at: usize,
+}
+
+impl Stale {
+    pub(crate) fn new(grace: std::time::Duration, lease_ttl: std::time::Duration) -> Self {
+        let secs = |d: std::time::Duration| std::cmp::min(u32::MAX as u64, d.as_secs()) as u32;
+        Self {
+            grace: Duration::from_secs(secs(grace)),
+            lease_ttl: Duration::from_secs(secs(lease_ttl).max(1)),
+            leases: HashMap::new(),
+            sweep_at: SWEEP_MIN,
+        }
+    }
+
+    /// Returns the grace period segments are kept for once they expire.
+    #[inline]
+    pub(crate) fn grace(&self) -> Duration {
+        self.grace
+    }
+
+    pub(crate) fn clear(&mut self) {
+        self.leases.clear();
+        self.sweep_at = SWEEP_MIN;
+    }
+}
+
+impl Segcache {
+    /// Returns the item with the key if it has expired within the stale grace
+    /// period, without increasing its frequency. Items which have not expired
+    /// are returned by [`Segcache::get`] instead.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder()
+    ///     .stale_grace(Duration::from_secs(60))
+    ///     .build()
+    ///     .expect("failed to create cache");
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::from_secs(1));
+    /// assert!(cache.get_stale(b"coffee").is_none());
+    ///
+    /// std::thread::sleep(Duration::from_secs(2));
+    /// assert!(cache.get(b"coffee").is_none());
+    /// let item = cache.get_stale(b"coffee").expect("didn't get item back");
+    /// assert_eq!(item.value(), b"strong");
+    /// ```
+    pub fn get_stale(&mut self, key: &[u8]) -> Option<Item> {
+        if self.stale.grace.as_secs() == 0 {
+            return None;
+        }
+
+        let item = self.hashtable.get_no_freq_incr(key, &mut self.segments)?;
+        if self.touched.deadline(key).is_some()
+            || !self.is_stale(&item)
+            || self.is_invalidated(&item)
+        {
+            return None;
+        }
+
+        #[cfg(feature = "metrics")]
+        ITEM_STALE.increment();
+
+        self.assemble(item, false)
+    }
+
+    /// Grants the lease to recompute the item for the key, which is held
+    /// until the key is stored or deleted, or the lease expires. Returns
+    /// `false` if the lease is held by another client.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// assert!(cache.lease(b"coffee"));
+    /// assert!(!cache.lease(b"coffee"));
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    /// assert!(cache.lease(b"coffee"));
+    /// ```
+    pub fn lease(&mut self, key: &[u8]) -> bool {
+        let hash = self.hashtable.hash(key);
+        let now = Instant::now();
+
+        if let Some(expire_at) = self.stale.leases.get(&hash) {
+            if *expire_at > now {
+                #[cfg(feature = "metrics")]
+                LEASE_HELD.increment();
+
+                return false;
+            }
+        }
+
+        #[cfg(feature = "metrics")]
+        LEASE_GRANT.increment();
+
+        self.stale.leases.insert(hash, now + self.stale.lease_ttl);
+        if self.stale.leases.len() >= self.stale.sweep_at {
+            self.stale.leases.retain(|_, expire_at| *expire_at > now);
+            self.stale.sweep_at = (self.stale.leases.len() * 2).max(SWEEP_MIN);
+        }
+
+        true
+    }
+
+    /// Drops the lease for the key, which is done when it is written.
+    #[inline]
+    pub(crate) fn release(&mut self, key: &[u8]) {
+        if !self.stale.leases.is_empty() {
+            let hash = self.hashtable.hash(key);
+            self.stale.leases.remove(&hash);
+        }
+    }
+
+    /// Returns true if the item has expired but is still held for the stale
+    /// grace period.
+    #[inline]
+    pub(crate) fn is_stale(&self, item: &Item) -> bool {
+        self.stale.grace.as_secs() != 0 && self.segments.ttl(item).as_secs() == 0
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::Duration;
+
+    fn cache() -> Segcache {
+        Segcache::builder()
+            .segment_size(4096)
+            .heap_size(4096 * 64)
+            .stale_grace(Duration::from_secs(60))
+            .lease_ttl(Duration::from_secs(60))
+            .build()
+            .expect("failed to create cache")
+    }
+
+    #[test]
+    fn stale() {
+        let mut cache = cache();
+        assert!(cache
+            .insert(b"coffee", b"strong", None, Duration::from_secs(1))
+            .is_ok());
+        std::thread::sleep(Duration::from_secs(2));
+        cache.expire();
+
+        // the expired item is kept for the grace period, but only as stale
+        assert!(cache.get(b"coffee").is_none());
+        assert!(cache.get_no_freq_incr(b"coffee").is_none());
+        assert_eq!(cache.get_stale(b"coffee").unwrap().value(), b"strong");
+
+        // and is replaced by a new value
+        assert!(cache
+            .insert(b"coffee", b"fresh", None, Duration::from_secs(60))
+            .is_ok());
+        assert!(cache.get_stale(b"coffee").is_none());
+        assert_eq!(cache.get(b"coffee").unwrap().value(), b"fresh");
+    }
+
+    #[test]
+    fn lease() {
+        let mut cache = cache();
+
+        // a lease is granted once until the key is written
+        assert!(cache.lease(b"coffee"));
+        assert!(!cache.lease(b"coffee"));
+        assert!(cache.lease(b"tea"));
+        assert!(cache
+            .insert(b"coffee", b"strong", None, Duration::ZERO)
+            .is_ok());
+        assert!(cache.lease(b"coffee"));
+
+        // or deleted
+        cache.delete(b"coffee");
+        assert!(cache.lease(b"coffee"));
+
+        cache.clear();
+        assert!(cache.lease(b"tea"));
+    }
+}
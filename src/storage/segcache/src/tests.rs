@@ -20,7 +20,10 @@ fn sizes() {
     assert_eq!(std::mem::size_of::<Segments>(), 64);
     assert_eq!(std::mem::size_of::<SegmentHeader>(), 64);
 
+    #[cfg(not(feature = "wide-buckets"))]
     assert_eq!(std::mem::size_of::<HashBucket>(), 64);
+    #[cfg(feature = "wide-buckets")]
+    assert_eq!(std::mem::size_of::<HashBucket>(), 128);
     assert_eq!(std::mem::size_of::<HashTable>(), 64);
 
     assert_eq!(std::mem::size_of::<crate::ttl_buckets::TtlBucket>(), 64);
@@ -79,6 +82,24 @@ fn get() {
     assert_eq!(item.value(), b"strong", "item is: {item:?}");
 }
 
+#[cfg(target_os = "linux")]
+#[test]
+fn numa_node() {
+    let ttl = Duration::ZERO;
+
+    // node 0 exists on every linux host
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 64)
+        .numa_node(Some(0))
+        .build()
+        .expect("failed to create cache");
+    assert!(cache.insert(b"coffee", b"strong", None, ttl).is_ok());
+
+    let item = cache.get(b"coffee").unwrap();
+    assert_eq!(item.value(), b"strong", "item is: {item:?}");
+}
+
 #[test]
 fn cas() {
     let ttl = Duration::ZERO;
@@ -107,6 +128,111 @@ fn cas() {
     assert_eq!(cache.cas(b"coffee", b"iced", None, ttl, item.cas()), Ok(()));
 }
 
+#[cfg(feature = "item-cas")]
+#[test]
+fn item_cas() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let segments = 64;
+    let heap_size = segments * segment_size as usize;
+
+    // with a single bucket, every key shares its chain
+    let mut cache = Segcache::builder()
+        .segment_size(segment_size)
+        .heap_size(heap_size)
+        .hash_power(3)
+        .max_hash_power(8)
+        .build()
+        .expect("failed to create cache");
+
+    assert!(cache.insert(b"coffee", b"hot", None, ttl).is_ok());
+    assert!(cache.insert(b"counter", 0_u64, None, ttl).is_ok());
+    let coffee = cache.get(b"coffee").unwrap().cas();
+    let counter = cache.get(b"counter").unwrap().cas();
+
+    // writes to one key leave the CAS value of the other as it was
+    assert!(cache.insert(b"tea", b"green", None, ttl).is_ok());
+    assert!(cache.wrapping_add(b"counter", 1).is_ok());
+    assert_eq!(cache.get(b"coffee").unwrap().cas(), coffee);
+    assert_ne!(cache.get(b"counter").unwrap().cas(), counter);
+
+    // a key which is stored again does not get back a value it had
+    let tea = cache.get(b"tea").unwrap().cas();
+    assert!(cache.delete(b"tea"));
+    assert!(cache.insert(b"tea", b"black", None, ttl).is_ok());
+    assert!(cache.get(b"tea").unwrap().cas() > tea);
+
+    // items keep their values as the hashtable grows
+    for i in 0..100 {
+        let key = format!("key{i}");
+        assert!(cache.insert(key.as_bytes(), b"value", None, ttl).is_ok());
+    }
+    assert!(cache.hashtable.power > 3);
+    assert_eq!(cache.get(b"coffee").unwrap().cas(), coffee);
+    assert_eq!(cache.cas(b"coffee", b"iced", None, ttl, coffee), Ok(()));
+    assert_eq!(
+        cache.cas(b"coffee", b"hot", None, ttl, coffee),
+        Err(SegcacheError::Exists)
+    );
+}
+
+#[cfg(feature = "key-prefixes")]
+#[test]
+fn key_prefixes() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let segments = 64;
+    let heap_size = segments * segment_size as usize;
+
+    let mut cache = Segcache::builder()
+        .segment_size(segment_size)
+        .heap_size(heap_size)
+        .eviction(Policy::Fifo)
+        .key_prefixes(&[b"test:prefixes:user:"])
+        .build()
+        .expect("failed to create cache");
+
+    let prefixed = b"test:prefixes:user:1";
+    let plain = b"test:prefixez:user:1";
+    assert!(cache.insert(prefixed, b"coffee", None, ttl).is_ok());
+    assert!(cache.insert(plain, b"coffee", None, ttl).is_ok());
+
+    // the key is whole when read, though the item holds less of it
+    let item = cache.get(prefixed).unwrap();
+    assert_eq!(item.key(), prefixed);
+    assert!(item.raw().size() < cache.get(plain).unwrap().raw().size());
+    assert_eq!(cache.get(plain).unwrap().key(), plain);
+
+    // keys which only share part of the prefix are told apart
+    assert!(cache.get(b"test:prefixes:user:2").is_none());
+    assert!(cache.get(b"test:prefixes:user:").is_none());
+
+    let mut keys = Vec::new();
+    let mut cursor = 0;
+    loop {
+        cursor = cache.scan(cursor, 16, &mut keys);
+        if cursor == 0 {
+            break;
+        }
+    }
+    keys.sort();
+    assert_eq!(keys, vec![prefixed.to_vec().into(), plain.to_vec().into()]);
+
+    assert!(cache.delete(prefixed));
+    assert!(cache.get(prefixed).is_none());
+
+    // items which are evicted are found in the hashtable by their whole key
+    for i in 0..4096 {
+        let key = format!("test:prefixes:user:{i}");
+        assert!(cache
+            .insert(key.as_bytes(), [0_u8; 256].as_slice(), None, ttl)
+            .is_ok());
+    }
+    let key = b"test:prefixes:user:4095";
+    assert_eq!(cache.get(key).unwrap().key(), key);
+    assert_eq!(cache.items(), cache.segments.items());
+}
+
 #[test]
 fn overwrite() {
     let ttl = Duration::ZERO;
@@ -361,6 +487,9 @@ fn expiration() {
     assert_eq!(cache.items(), 2);
     assert_eq!(cache.segments.free(), segments - 2);
 
+    // and expiration is not due again until the first segment expires
+    assert!(!cache.ttl_buckets.is_due());
+
     // wait and expire again
     std::thread::sleep(std::time::Duration::from_secs(5));
     cache.expire();
@@ -409,6 +538,50 @@ fn clear() {
     assert!(cache.get(b"coffee").is_none());
 }
 
+#[test]
+fn flush() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let segments = 64;
+    let heap_size = segments * segment_size as usize;
+
+    let mut cache = Segcache::builder()
+        .segment_size(segment_size)
+        .heap_size(heap_size)
+        .build()
+        .expect("failed to create cache");
+
+    for i in 0..256 {
+        let key = format!("{i}");
+        assert!(cache
+            .insert(key.as_bytes(), &[0; 64][..], None, ttl)
+            .is_ok());
+    }
+    let used = segments - cache.segments.free();
+    assert!(used > 1);
+
+    // the flush frees no segment, but the items are gone at once
+    cache.flush();
+    assert_eq!(cache.segments.free(), segments - used);
+    for i in 0..256 {
+        let key = format!("{i}");
+        assert!(cache.get(key.as_bytes()).is_none());
+        assert!(!cache.delete(key.as_bytes()));
+    }
+
+    // items stored after the flush go to new segments and are kept
+    assert!(cache.insert(b"coffee", b"strong", None, ttl).is_ok());
+    assert_eq!(cache.get(b"coffee").expect("not found").value(), b"strong");
+
+    // and the flushed segments are reclaimed by expiration
+    while cache.segments.is_flushing() {
+        cache.expire();
+    }
+    assert_eq!(cache.segments.free(), segments - 1);
+    assert_eq!(cache.items(), 1);
+    assert_eq!(cache.get(b"coffee").expect("not found").value(), b"strong");
+}
+
 #[test]
 fn wrapping_add() {
     let ttl = Duration::ZERO;
@@ -448,6 +621,124 @@ fn wrapping_add() {
     assert_eq!(item.value(), 2, "item is: {item:?}");
 }
 
+#[test]
+fn overwrite_in_place() {
+    let ttl = Duration::ZERO;
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 64)
+        .build()
+        .expect("failed to create cache");
+
+    assert_eq!(
+        cache.overwrite(b"coffee", 0, b"weak"),
+        Err(SegcacheError::NotFound)
+    );
+
+    assert!(cache.insert(b"coffee", b"strong", None, ttl).is_ok());
+    assert!(cache.overwrite(b"coffee", 2, b"ri").is_ok());
+    assert_eq!(cache.get(b"coffee").unwrap().value(), b"string");
+
+    // the bytes must fit within the existing value
+    assert_eq!(
+        cache.overwrite(b"coffee", 4, b"ing"),
+        Err(SegcacheError::NotWritable)
+    );
+
+    // numeric values are only changed through arithmetic
+    assert!(cache.insert(b"tea", 1, None, ttl).is_ok());
+    assert_eq!(
+        cache.overwrite(b"tea", 0, b"a"),
+        Err(SegcacheError::NotWritable)
+    );
+
+    // a pinned value may be read concurrently, so it is never changed
+    let item = cache.get(b"coffee").unwrap();
+    let pinned = cache.pin(&item);
+    assert_eq!(
+        cache.overwrite(b"coffee", 0, b"S"),
+        Err(SegcacheError::NotWritable)
+    );
+    drop(pinned);
+    assert!(cache.overwrite(b"coffee", 0, b"S").is_ok());
+    assert_eq!(cache.get(b"coffee").unwrap().value(), b"String");
+}
+
+#[test]
+fn append_prepend() {
+    let ttl = Duration::ZERO;
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 64)
+        .build()
+        .expect("failed to create cache");
+
+    assert_eq!(cache.append(b"coffee", b"!"), Err(SegcacheError::NotFound));
+
+    // the last item written to a segment grows in place, which changes its
+    // cas value but keeps it at the same address
+    assert!(cache
+        .insert(b"coffee", b"strong", Some(b"flag"), ttl)
+        .is_ok());
+    let item = cache.get(b"coffee").unwrap();
+    assert!(cache.append(b"coffee", b" and hot").is_ok());
+    assert!(cache.prepend(b"coffee", b"very ").is_ok());
+    let extended = cache.get(b"coffee").unwrap();
+    assert_eq!(extended.value(), b"very strong and hot");
+    assert_eq!(extended.optional(), Some(b"flag".as_slice()));
+    assert_eq!(extended.raw().as_ptr(), item.raw().as_ptr());
+    assert_ne!(extended.cas(), item.cas());
+
+    // once another item follows it, the item is stored again as a copy
+    assert!(cache.insert(b"tea", b"green", None, ttl).is_ok());
+    assert!(cache.append(b"coffee", b"!").is_ok());
+    let copied = cache.get(b"coffee").unwrap();
+    assert_eq!(copied.value(), b"very strong and hot!");
+    assert_eq!(copied.optional(), Some(b"flag".as_slice()));
+    assert_ne!(copied.raw().as_ptr(), item.raw().as_ptr());
+    assert_eq!(cache.items(), 2);
+
+    // a pinned value may be read concurrently, so it is copied as well
+    let pinned = cache.pin(&copied);
+    assert!(cache.prepend(b"coffee", b"a ").is_ok());
+    assert_eq!(pinned.value(), b"very strong and hot!");
+    assert_eq!(
+        cache.get(b"coffee").unwrap().value(),
+        b"a very strong and hot!"
+    );
+    drop(pinned);
+
+    // numeric values are only changed through arithmetic
+    assert!(cache.insert(b"cups", 1, None, ttl).is_ok());
+    assert_eq!(cache.append(b"cups", b"0"), Err(SegcacheError::NotNumeric));
+}
+
+#[test]
+fn numeric_pinned() {
+    let ttl = Duration::ZERO;
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 64)
+        .build()
+        .expect("failed to create cache");
+
+    assert!(cache.insert(b"cups", 1, Some(b"flag"), ttl).is_ok());
+
+    // counters are updated in place, unless pinned by a concurrent reader
+    let item = cache.wrapping_add(b"cups", 1).unwrap();
+    assert_eq!(item.value(), 2);
+    let pinned = cache.pin(&item);
+    let updated = cache.wrapping_add(b"cups", 1).unwrap();
+    assert_eq!(updated.value(), 3);
+    assert_eq!(updated.optional(), Some(b"flag".as_slice()));
+    assert_eq!(pinned.value(), 2);
+    drop(pinned);
+
+    let updated = cache.saturating_sub(b"cups", 5).unwrap();
+    assert_eq!(updated.value(), 0);
+    assert_eq!(cache.items(), 1);
+}
+
 #[test]
 fn saturating_sub() {
     let ttl = Duration::ZERO;
@@ -731,3 +1022,1122 @@ fn fuzz_2() {
     let _ = cache.insert(&[1], &[3, 0, 1], None, Duration::from_secs(0));
     let _ = cache.insert(&[1], &[3, 4, 2], None, Duration::from_secs(114));
 }
+
+#[test]
+fn sharded() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let segments = 64;
+    let heap_size = segments * segment_size as usize;
+
+    let cache = std::sync::Arc::new(
+        Segcache::builder()
+            .segment_size(segment_size)
+            .heap_size(heap_size)
+            .shards(4)
+            .build_sharded()
+            .expect("failed to create cache"),
+    );
+    assert_eq!(cache.shards(), 4);
+    assert_eq!(cache.items(), 0);
+
+    let threads: Vec<_> = (0..4)
+        .map(|t| {
+            let cache = cache.clone();
+            std::thread::spawn(move || {
+                for i in 0..100 {
+                    let key = format!("{t}:{i}");
+                    assert!(cache
+                        .shard(key.as_bytes())
+                        .insert(key.as_bytes(), key.as_bytes(), None, ttl)
+                        .is_ok());
+                }
+            })
+        })
+        .collect();
+
+    for thread in threads {
+        thread.join().expect("thread panicked");
+    }
+
+    assert_eq!(cache.items(), 400);
+
+    for t in 0..4 {
+        for i in 0..100 {
+            let key = format!("{t}:{i}");
+            let mut shard = cache.shard(key.as_bytes());
+            let item = shard.get(key.as_bytes()).expect("didn't get item back");
+            assert_eq!(item.value(), *key.as_bytes());
+        }
+    }
+
+    assert!(cache.shard(b"0:0").delete(b"0:0"));
+    assert_eq!(cache.items(), 399);
+
+    cache.clear();
+    assert_eq!(cache.items(), 0);
+}
+
+#[test]
+fn into_shards() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let heap_size = 64 * segment_size as usize;
+
+    let cache = Segcache::builder()
+        .segment_size(segment_size)
+        .heap_size(heap_size)
+        .shards(4)
+        .build_sharded()
+        .expect("failed to create cache");
+
+    for i in 0..100 {
+        let key = format!("{i}");
+        assert!(cache
+            .shard(key.as_bytes())
+            .insert(key.as_bytes(), key.as_bytes(), None, ttl)
+            .is_ok());
+    }
+
+    // every key is found in the shard the router maps it to
+    let (router, mut shards) = cache.into_shards();
+    assert_eq!(router.shards(), 4);
+    assert_eq!(shards.len(), 4);
+    assert_eq!(
+        shards.iter_mut().map(|shard| shard.items()).sum::<usize>(),
+        100
+    );
+
+    for i in 0..100 {
+        let key = format!("{i}");
+        let shard = &mut shards[router.shard_index(key.as_bytes())];
+        let item = shard.get(key.as_bytes()).expect("didn't get item back");
+        assert_eq!(item.value(), *key.as_bytes());
+    }
+}
+
+#[test]
+fn partitions() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+
+    let cache = Segcache::builder()
+        .segment_size(segment_size)
+        .heap_size(64 * segment_size as usize)
+        .shards(2)
+        .partition(
+            "a",
+            b"a:",
+            Segcache::builder()
+                .segment_size(segment_size)
+                .heap_size(8 * segment_size as usize)
+                .shards(2),
+        )
+        .partition(
+            "ab",
+            b"a:b:",
+            Segcache::builder()
+                .segment_size(segment_size)
+                .heap_size(16 * segment_size as usize),
+        )
+        .build_sharded()
+        .expect("failed to create cache");
+    assert_eq!(cache.shards(), 5);
+
+    let router = cache.router();
+    for i in 0..100 {
+        assert!(router.shard_index(format!("{i}").as_bytes()) < 2);
+        assert!((2..4).contains(&router.shard_index(format!("a:{i}").as_bytes())));
+        assert_eq!(router.shard_index(format!("a:b:{i}").as_bytes()), 4);
+    }
+    assert_eq!(router.partition_index(b"a:b:c"), 2);
+    assert_eq!(router.partition_index(b"a:c"), 1);
+    assert_eq!(router.partition_index(b"b:c"), 0);
+
+    // filling one partition does not evict the items of another
+    for i in 0..100 {
+        let key = format!("a:b:{i}");
+        let _ = cache
+            .shard(key.as_bytes())
+            .insert(key.as_bytes(), b"", None, ttl);
+    }
+    let value = [0; 1024];
+    for i in 0..1000 {
+        let key = format!("a:{i}");
+        let _ = cache
+            .shard(key.as_bytes())
+            .insert(key.as_bytes(), &value[..], None, ttl);
+    }
+    for i in 0..100 {
+        let key = format!("a:b:{i}");
+        assert!(cache.shard(key.as_bytes()).get(key.as_bytes()).is_some());
+    }
+
+    let partitions = cache.partitions();
+    assert_eq!(partitions.len(), 3);
+    assert_eq!(partitions[0].name, DEFAULT_PARTITION);
+    assert_eq!(partitions[1].shards, 2..4);
+    assert_eq!(partitions[1].usage.heap, 8 * segment_size as usize);
+    assert!(partitions[1].usage.items < 1000);
+    assert_eq!(partitions[2].access.hits, 100);
+    assert_eq!(partitions[2].usage.items, 100);
+
+    // partitions must be unique
+    assert!(Segcache::builder()
+        .partition("a", b"a:", Segcache::builder())
+        .partition("a", b"b:", Segcache::builder())
+        .build_sharded()
+        .is_err());
+}
+
+#[test]
+fn get_many() {
+    let ttl = Duration::ZERO;
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 64)
+        .hash_power(8)
+        .overflow_factor(1.0)
+        .build()
+        .expect("failed to create cache");
+
+    let keys: Vec<String> = (0..200).map(|i| format!("key:{i}")).collect();
+
+    for key in keys.iter().step_by(2) {
+        assert!(cache
+            .insert(key.as_bytes(), key.as_bytes(), None, ttl)
+            .is_ok());
+    }
+
+    let items = cache.get_many(&keys);
+    assert_eq!(items.len(), keys.len());
+    for (i, (key, item)) in keys.iter().zip(items.iter()).enumerate() {
+        if i % 2 == 0 {
+            let item = item.as_ref().expect("didn't get item back");
+            assert_eq!(item.value(), *key.as_bytes());
+        } else {
+            assert!(item.is_none());
+        }
+    }
+}
+
+#[test]
+fn hashtable_grow() {
+    let ttl = Duration::ZERO;
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 64)
+        .hash_power(6)
+        .max_hash_power(12)
+        .overflow_factor(0.0)
+        .build()
+        .expect("failed to create cache");
+
+    // far more items than fit into the initial 8 buckets
+    let keys: Vec<String> = (0..1000).map(|i| format!("{i}")).collect();
+    for key in keys.iter() {
+        assert!(cache
+            .insert(key.as_bytes(), key.as_bytes(), None, ttl)
+            .is_ok());
+        assert!(cache.get(key.as_bytes()).is_some());
+    }
+    assert!(cache.hashtable.power > 6);
+
+    // drive the migration until complete
+    while cache.hashtable.is_resizing() {
+        cache.expire();
+    }
+
+    let mut found = 0;
+    for key in keys.iter() {
+        if let Some(item) = cache.get(key.as_bytes()) {
+            assert_eq!(item.value(), *key.as_bytes());
+            found += 1;
+        }
+    }
+    assert_eq!(found, cache.items());
+    assert!(found > 900);
+}
+
+#[test]
+fn persist_restore() {
+    let ttl = Duration::ZERO;
+    let dir = tempfile::tempdir().expect("failed to create tempdir");
+    let datapool = dir.path().join("datapool");
+    let metadata = dir.path().join("metadata");
+
+    let builder = |heap_size| {
+        Segcache::builder()
+            .segment_size(4096)
+            .heap_size(heap_size)
+            .hash_power(6)
+            .max_hash_power(12)
+            .overflow_factor(0.0)
+            .datapool_path(Some(&datapool))
+            .metadata_path(Some(&metadata))
+    };
+
+    let keys: Vec<String> = (0..1000).map(|i| format!("{i}")).collect();
+
+    let (items, power) = {
+        let mut cache = builder(4096 * 64).build().expect("failed to create cache");
+        for key in keys.iter() {
+            assert!(cache
+                .insert(key.as_bytes(), key.as_bytes(), None, ttl)
+                .is_ok());
+        }
+        assert!(cache.delete(b"0"));
+        cache.persist().expect("failed to persist cache");
+        assert!(!cache.hashtable.is_resizing());
+        (cache.items(), cache.hashtable.power)
+    };
+
+    // the cache is restored with the same contents, including the grown table
+    {
+        let mut cache = builder(4096 * 64).build().expect("failed to restore cache");
+        assert!(!metadata.exists());
+        assert_eq!(cache.hashtable.power, power);
+        assert_eq!(cache.items(), items);
+        assert!(cache.get(b"0").is_none());
+
+        let mut found = 0;
+        for key in keys.iter() {
+            if let Some(item) = cache.get(key.as_bytes()) {
+                assert_eq!(item.value(), *key.as_bytes());
+                found += 1;
+            }
+        }
+        assert_eq!(found, items);
+
+        // the restored cache remains writable
+        assert!(cache.insert(b"coffee", b"strong", None, ttl).is_ok());
+        assert_eq!(
+            cache.get(b"coffee").map(|i| i.value() == b"strong"),
+            Some(true)
+        );
+        cache.persist().expect("failed to persist cache");
+    }
+
+    // a mismatched configuration results in an empty cache
+    {
+        let mut cache = builder(4096 * 32).build().expect("failed to create cache");
+        assert!(!metadata.exists());
+        assert_eq!(cache.items(), 0);
+        assert!(cache.get(b"coffee").is_none());
+    }
+
+    // without metadata the cache also starts empty
+    {
+        let mut cache = builder(4096 * 64).build().expect("failed to create cache");
+        assert_eq!(cache.items(), 0);
+    }
+}
+
+#[test]
+fn pinned_item() {
+    let ttl = Duration::ZERO;
+    let value = [0xA5_u8; 1024];
+
+    for policy in [
+        Policy::Random,
+        Policy::Fifo,
+        Policy::S3Fifo,
+        Policy::Merge {
+            max: 8,
+            merge: 4,
+            compact: 2,
+        },
+    ] {
+        let mut cache = Segcache::builder()
+            .segment_size(4096)
+            .heap_size(4096 * 16)
+            .eviction(policy)
+            .build()
+            .expect("failed to create cache");
+
+        assert!(cache.insert(b"pinned", &value[..], None, ttl).is_ok());
+        let item = cache.get(b"pinned").expect("didn't get item back");
+        let pinned = cache.pin(&item);
+
+        // overwrite the cache many times over, the pinned segment must not be
+        // compacted or reused
+        for i in 0..1000 {
+            let key = format!("{i}");
+            let _ = cache.insert(key.as_bytes(), &[i as u8; 1024][..], None, ttl);
+        }
+        assert_eq!(pinned.value(), value);
+        assert_eq!(pinned.key(), b"pinned");
+
+        // once unpinned, all segments are available again
+        drop(pinned);
+        let mut inserted = 0;
+        for i in 0..1000 {
+            let key = format!("{i}");
+            if cache
+                .insert(key.as_bytes(), &[0; 1024][..], None, ttl)
+                .is_ok()
+            {
+                inserted += 1;
+            }
+        }
+        assert!(inserted > 900);
+    }
+}
+
+#[test]
+fn pinned_item_outlives_cache() {
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 16)
+        .build()
+        .expect("failed to create cache");
+
+    assert!(cache
+        .insert(b"coffee", b"strong", None, Duration::ZERO)
+        .is_ok());
+    let item = cache.get(b"coffee").expect("didn't get item back");
+    let pinned = cache.pin(&item);
+
+    // the segments are leaked rather than freed while pinned
+    drop(cache);
+    assert_eq!(pinned.value(), b"strong");
+}
+
+#[cfg(feature = "compression")]
+#[test]
+fn compression() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let segments = 16;
+
+    let mut cache = Segcache::builder()
+        .segment_size(segment_size as i32)
+        .heap_size(segments * segment_size)
+        .compression(Some(3))
+        .compression_threshold(64)
+        .build()
+        .expect("failed to create cache");
+
+    // a compressible value is stored compressed and read back intact
+    let value = b"{\"drink\":\"coffee\",\"style\":\"strong\"}".repeat(32);
+    assert!(cache
+        .insert(b"json", &value[..], Some(b"flag"), ttl)
+        .is_ok());
+    let item = cache.get(b"json").expect("didn't get item back");
+    assert!(item.is_compressed());
+    assert_eq!(item.value(), value[..]);
+    assert_eq!(item.optional(), Some(&b"flag"[..]));
+
+    // values below the threshold are stored as-is
+    assert!(cache.insert(b"small", &value[0..32], None, ttl).is_ok());
+    let item = cache.get(b"small").expect("didn't get item back");
+    assert!(!item.is_compressed());
+    assert_eq!(item.value(), value[0..32]);
+
+    // values which do not compress are stored as-is
+    let mut state = 0x9E3779B97F4A7C15_u64;
+    let random: Vec<u8> = (0..1024)
+        .map(|_| {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            state as u8
+        })
+        .collect();
+    assert!(cache.insert(b"random", &random[..], None, ttl).is_ok());
+    let item = cache.get(b"random").expect("didn't get item back");
+    assert!(!item.is_compressed());
+    assert_eq!(item.value(), random[..]);
+
+    // numeric values are never compressed
+    assert!(cache.insert(b"number", 42_u64, None, ttl).is_ok());
+    let item = cache
+        .wrapping_add(b"number", 1)
+        .expect("failed to increment");
+    assert!(!item.is_compressed());
+    assert_eq!(item.value(), 43);
+    assert!(cache.wrapping_add(b"json", 1).is_err());
+
+    // pinned compressed items are decompressed on read
+    let item = cache.get(b"json").expect("didn't get item back");
+    let pinned = cache.pin(&item);
+    assert_eq!(pinned.value(), value[..]);
+
+    // the cache holds many more compressible values than fit uncompressed,
+    // which would otherwise fail to insert as eviction is disabled
+    let mut cache = Segcache::builder()
+        .segment_size(segment_size as i32)
+        .heap_size(segments * segment_size)
+        .compression(Some(3))
+        .build()
+        .expect("failed to create cache");
+    for i in 0..(segments * 4) {
+        let key = format!("{i}");
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+    }
+    for i in 0..(segments * 4) {
+        let key = format!("{i}");
+        let item = cache.get(key.as_bytes()).expect("didn't get item back");
+        assert_eq!(item.value(), value[..]);
+    }
+}
+
+#[test]
+fn flash() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let dir = tempfile::tempdir().expect("failed to create tempdir");
+    let datapool = dir.path().join("datapool");
+    let metadata = dir.path().join("metadata");
+    let flash = dir.path().join("flash");
+
+    let keys: Vec<String> = (0..1000).map(|i| format!("{i:04}")).collect();
+    let value = [b'x'; 64];
+
+    for policy in [
+        Policy::Fifo,
+        Policy::Merge {
+            max: 8,
+            merge: 4,
+            compact: 2,
+        },
+    ] {
+        // the heap only holds a fraction of the items, the rest are in flash
+        let mut cache = Segcache::builder()
+            .segment_size(segment_size as i32)
+            .heap_size(16 * segment_size)
+            .flash_path(Some(&flash))
+            .flash_size(64 * segment_size)
+            .eviction(policy)
+            .build()
+            .expect("failed to create cache");
+        for key in keys.iter() {
+            assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+        }
+        assert_eq!(cache.items(), keys.len());
+
+        // every item can be read, promoting items back into the heap
+        for key in keys.iter() {
+            let item = cache.get(key.as_bytes()).expect("didn't get item back");
+            assert_eq!(item.key(), key.as_bytes());
+            assert_eq!(item.value(), value[..]);
+        }
+        let items = cache.get_many(&keys);
+        assert!(items.iter().all(|item| item.is_some()));
+        assert_eq!(cache.items(), keys.len());
+
+        // deleted items are removed from flash
+        assert!(cache.delete(keys[0].as_bytes()));
+        assert!(cache.get(keys[0].as_bytes()).is_none());
+        assert_eq!(cache.items(), keys.len() - 1);
+
+        // clearing the cache also clears flash
+        cache.clear();
+        assert_eq!(cache.items(), 0);
+    }
+
+    // a small flash tier drops items once it is full
+    let mut cache = Segcache::builder()
+        .segment_size(segment_size as i32)
+        .heap_size(16 * segment_size)
+        .flash_path(Some(&flash))
+        .flash_size(2 * segment_size)
+        .eviction(Policy::Fifo)
+        .build()
+        .expect("failed to create cache");
+    for key in keys.iter() {
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+    }
+    let items = cache.items();
+    assert!(items < keys.len());
+    let mut found = 0;
+    for key in keys.iter() {
+        if let Some(item) = cache.get_no_freq_incr(key.as_bytes()) {
+            assert_eq!(item.value(), value[..]);
+            found += 1;
+        }
+    }
+    assert_eq!(found, items);
+    drop(cache);
+
+    // flash is persisted and restored along with the heap
+    let builder = || {
+        Segcache::builder()
+            .segment_size(segment_size as i32)
+            .heap_size(16 * segment_size)
+            .datapool_path(Some(&datapool))
+            .metadata_path(Some(&metadata))
+            .flash_path(Some(&flash))
+            .flash_size(64 * segment_size)
+            .eviction(Policy::Fifo)
+    };
+    {
+        let mut cache = builder().build().expect("failed to create cache");
+        for key in keys.iter() {
+            assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+        }
+        cache.persist().expect("failed to persist cache");
+    }
+    {
+        let mut cache = builder().build().expect("failed to restore cache");
+        assert_eq!(cache.items(), keys.len());
+        for key in keys.iter() {
+            let item = cache.get(key.as_bytes()).expect("didn't get item back");
+            assert_eq!(item.value(), value[..]);
+        }
+    }
+
+    // a cache restored without flash starts empty
+    {
+        let mut cache = Segcache::builder()
+            .segment_size(segment_size as i32)
+            .heap_size(16 * segment_size)
+            .datapool_path(Some(&datapool))
+            .metadata_path(Some(&metadata))
+            .eviction(Policy::Fifo)
+            .build()
+            .expect("failed to create cache");
+        assert_eq!(cache.items(), 0);
+    }
+}
+
+#[cfg(target_os = "linux")]
+#[test]
+fn flash_node() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let dir = tempfile::tempdir().expect("failed to create tempdir");
+    let datapool = dir.path().join("datapool");
+    let metadata = dir.path().join("metadata");
+
+    let keys: Vec<String> = (0..1000).map(|i| format!("{i:04}")).collect();
+    let value = [b'x'; 64];
+
+    let builder = || {
+        Segcache::builder()
+            .segment_size(segment_size as i32)
+            .heap_size(16 * segment_size)
+            .datapool_path(Some(&datapool))
+            .metadata_path(Some(&metadata))
+            .flash_node(Some(0))
+            .flash_size(64 * segment_size)
+            .flash_age(std::time::Duration::from_secs(1))
+            .eviction(Policy::Merge {
+                max: 8,
+                merge: 4,
+                compact: 2,
+            })
+    };
+
+    // the segments of the first half of the items age past the threshold
+    // before the rest are written, and are moved into the tier whole
+    let mut cache = builder().build().expect("failed to create cache");
+    let (old, new) = keys.split_at(keys.len() / 2);
+    for key in old.iter() {
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+    }
+    std::thread::sleep(std::time::Duration::from_secs(2));
+    for key in new.iter() {
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+    }
+    assert_eq!(cache.items(), keys.len());
+    for key in keys.iter() {
+        let item = cache
+            .get_no_freq_incr(key.as_bytes())
+            .expect("didn't get item back");
+        assert_eq!(item.value(), value[..]);
+    }
+
+    // the tier is not saved, so only the items in the heap are restored
+    cache.persist().expect("failed to persist cache");
+    let items = cache.items();
+    assert!(items < keys.len());
+    drop(cache);
+
+    let mut cache = builder().build().expect("failed to restore cache");
+    assert_eq!(cache.items(), items);
+    let mut found = 0;
+    for key in keys.iter() {
+        if let Some(item) = cache.get_no_freq_incr(key.as_bytes()) {
+            assert_eq!(item.value(), value[..]);
+            found += 1;
+        }
+    }
+    assert_eq!(found, items);
+}
+
+#[test]
+fn admission() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let value = [b'x'; 64];
+
+    let mut cache = Segcache::builder()
+        .segment_size(segment_size as i32)
+        .heap_size(16 * segment_size)
+        .eviction(Policy::Fifo)
+        .admission(Some(64 * 1024))
+        .build()
+        .expect("failed to create cache");
+
+    // new keys are admitted while there are free segments
+    let mut i = 0;
+    while cache.segments.free() > 0 {
+        let key = format!("hot{i}");
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+        i += 1;
+    }
+    let hot = i;
+    let items = cache.items();
+    assert_eq!(items, hot);
+
+    // once the cache is full, keys which were never accessed are dropped
+    for i in 0..1000 {
+        let key = format!("cold{i}");
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+        assert!(cache.get_no_freq_incr(key.as_bytes()).is_none());
+    }
+    assert_eq!(cache.items(), items);
+    for i in 0..hot {
+        let key = format!("hot{i}");
+        assert!(cache.get(key.as_bytes()).is_some());
+    }
+
+    // a key which missed on a read is admitted
+    assert!(cache.get(b"coffee").is_none());
+    assert!(cache.insert(b"coffee", b"strong", None, ttl).is_ok());
+    assert_eq!(
+        cache.get(b"coffee").map(|i| i.value() == b"strong"),
+        Some(true)
+    );
+
+    // as is a key which was dropped once before
+    assert!(cache.insert(b"tea", b"green", None, ttl).is_ok());
+    assert!(cache.get_no_freq_incr(b"tea").is_none());
+    assert!(cache.insert(b"tea", b"green", None, ttl).is_ok());
+    assert!(cache.get_no_freq_incr(b"tea").is_some());
+
+    // existing keys are always updated
+    assert!(cache.insert(b"hot0", b"new", None, ttl).is_ok());
+    assert_eq!(cache.get(b"hot0").map(|i| i.value() == b"new"), Some(true));
+}
+
+#[test]
+fn maintain() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let value = [b'x'; 64];
+
+    let mut cache = Segcache::builder()
+        .segment_size(segment_size as i32)
+        .heap_size(16 * segment_size)
+        .eviction(Policy::Merge {
+            max: 8,
+            merge: 4,
+            compact: 2,
+        })
+        .free_reserve(2)
+        .build()
+        .expect("failed to create cache");
+
+    // nothing is evicted while the reserve is available
+    assert_eq!(cache.maintain(), 0);
+    assert_eq!(cache.segments.free(), 16);
+
+    // once inserts run the cache out of free segments, maintenance restores
+    // the reserve so later inserts do not have to evict
+    for i in 0..1000 {
+        let key = format!("{i}");
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+        cache.maintain();
+        assert!(cache.segments.free() >= 2);
+    }
+    assert!(cache.items() < 1000);
+
+    // the reserve has no effect on caches which do not evict
+    let mut cache = Segcache::builder()
+        .segment_size(segment_size as i32)
+        .heap_size(16 * segment_size)
+        .eviction(Policy::None)
+        .free_reserve(2)
+        .build()
+        .expect("failed to create cache");
+    for i in 0..1000 {
+        let key = format!("{i}");
+        let _ = cache.insert(key.as_bytes(), &value[..], None, ttl);
+    }
+    assert_eq!(cache.maintain(), 0);
+}
+
+#[test]
+fn compact_threshold() {
+    let ttl = Duration::ZERO;
+    let segment_size = 4096;
+    let value = [b'x'; 64];
+
+    let build = |threshold| {
+        Segcache::builder()
+            .segment_size(segment_size as i32)
+            .heap_size(16 * segment_size)
+            .eviction(Policy::None)
+            .compact_threshold(threshold)
+            .build()
+            .expect("failed to create cache")
+    };
+
+    // deleting three of every four items leaves the segments mostly empty
+    let fill = |cache: &mut Segcache| {
+        for i in 0..400 {
+            let key = format!("{i}");
+            assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+        }
+        for i in (0..400).filter(|i| i % 4 != 0) {
+            let key = format!("{i}");
+            assert!(cache.delete(key.as_bytes()));
+        }
+    };
+
+    // without a threshold, the segments are left as they are
+    let mut cache = build(0.0);
+    fill(&mut cache);
+    let free = cache.segments.free();
+    assert_eq!(cache.maintain(), 0);
+    assert_eq!(cache.segments.free(), free);
+
+    // with a threshold, maintenance merges them and frees the rest
+    let mut cache = build(0.3);
+    fill(&mut cache);
+    let free = cache.segments.free();
+    let freed: usize = (0..64).map(|_| cache.maintain()).sum();
+    assert!(freed > 0);
+    assert_eq!(cache.segments.free(), free + freed);
+
+    // and the items which were kept are still there
+    assert_eq!(cache.items(), 100);
+    for i in 0..400 {
+        let key = format!("{i}");
+        let item = cache.get(key.as_bytes());
+        if i % 4 == 0 {
+            assert_eq!(item.expect("didn't get item back").value(), value[..]);
+        } else {
+            assert!(item.is_none());
+        }
+    }
+}
+
+#[test]
+fn item_ttl() {
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 16)
+        .build()
+        .expect("failed to create cache");
+
+    // the remaining ttl is rounded down to the ttl bucket of the item
+    assert!(cache
+        .insert(b"short", b"value", None, Duration::from_secs(60))
+        .is_ok());
+    let item = cache.get(b"short").expect("didn't get item back");
+    let ttl = cache.ttl(&item).expect("item has no ttl");
+    assert!(ttl <= Duration::from_secs(60));
+    assert!(ttl >= Duration::from_secs(50));
+
+    // items without a ttl are held in the longest ttl bucket
+    assert!(cache
+        .insert(b"long", b"value", None, Duration::ZERO)
+        .is_ok());
+    let item = cache.get(b"long").expect("didn't get item back");
+    assert_eq!(cache.ttl(&item), None);
+}
+
+#[test]
+fn segment_stats() {
+    let segment_size = 4096;
+    let mut cache = Segcache::builder()
+        .segment_size(segment_size)
+        .heap_size(4096 * 16)
+        .build()
+        .expect("failed to create cache");
+
+    let stats = cache.segment_stats();
+    assert_eq!(stats.segments.len(), 16);
+    assert_eq!(stats.free(), 16);
+    assert!(stats.ttl_buckets().is_empty());
+    assert_eq!(stats.utilization().iter().sum::<usize>(), 0);
+
+    // about a quarter of a segment in one ttl bucket, and a few items in
+    // another
+    let value = [0; 100];
+    for i in 0..8 {
+        let key = format!("{i}");
+        assert!(cache
+            .insert(key.as_bytes(), &value[..], None, Duration::ZERO)
+            .is_ok());
+    }
+    for i in 0..2 {
+        let key = format!("short{i}");
+        assert!(cache
+            .insert(key.as_bytes(), &value[..], None, Duration::from_secs(60))
+            .is_ok());
+    }
+
+    let stats = cache.segment_stats();
+    assert_eq!(stats.segment_size, segment_size as usize);
+    assert_eq!(stats.free(), 14);
+
+    let buckets = stats.ttl_buckets();
+    assert_eq!(buckets.len(), 2);
+    assert_eq!(buckets.iter().map(|b| b.segments).sum::<usize>(), 2);
+    assert_eq!(buckets.iter().map(|b| b.live_items).sum::<usize>(), 10);
+    assert!(buckets[0].ttl < buckets[1].ttl);
+    assert_eq!(buckets[0].live_items, 2);
+    assert_eq!(buckets[1].live_items, 8);
+
+    assert_eq!(cache.memory_usage().items, 10);
+
+    let utilization = stats.utilization();
+    assert_eq!(utilization.iter().sum::<usize>(), 2);
+    assert_eq!(utilization[0], 1);
+    assert_eq!(utilization[2], 1);
+
+    for segment in stats.segments.iter().filter(|s| !s.is_free()) {
+        assert!(segment.accessible && segment.evictable);
+        assert_eq!(segment.merges, 0);
+    }
+}
+
+#[test]
+fn sizing() {
+    let heap_size = 16 * 1024 * 1024;
+    let mut cache = Segcache::builder()
+        .hash_power(10)
+        .heap_size(heap_size)
+        .build()
+        .expect("failed to create cache");
+
+    let stats = cache.segment_stats();
+    assert_eq!(stats.hashtable.power, 10);
+    assert_eq!(
+        stats.hashtable.item_slots,
+        (1 << 10) / N_BUCKET_SLOT * (N_BUCKET_SLOT - 1)
+    );
+    assert_eq!(stats.hashtable.overflow_used, 0);
+    assert!(stats.sizing().is_none());
+
+    let value = [0; 100];
+    for i in 0..512 {
+        let key = format!("{i:04}");
+        assert!(cache
+            .insert(key.as_bytes(), &value[..], None, Duration::ZERO)
+            .is_ok());
+    }
+
+    // the items are the size of the key and the value, and the hashtable is
+    // far too small for a heap of them
+    let stats = cache.segment_stats();
+    let item_size = stats.item_size().expect("no items");
+    assert!((104..112).contains(&item_size), "item size {item_size}");
+    assert!(stats.hash_load() > 0.5);
+    let sizing = stats.sizing().expect("no sizing");
+    assert_eq!(sizing, Sizing::new(heap_size, item_size));
+    assert!(sizing.hash_power > 10);
+}
+
+#[test]
+fn export_import() {
+    let builder = || {
+        Segcache::builder()
+            .segment_size(4096)
+            .heap_size(4096 * 64)
+            .hash_power(16)
+    };
+
+    let mut cache = builder().build().expect("failed to create cache");
+    let value = [0x7; 100];
+    for i in 0..100 {
+        let key = format!("key{i}");
+        assert!(cache
+            .insert(key.as_bytes(), &value[..], Some(b"opt"), Duration::ZERO)
+            .is_ok());
+    }
+    assert!(cache
+        .insert(b"short", &value[..], None, Duration::from_secs(60))
+        .is_ok());
+    assert!(cache.insert(b"number", 42, None, Duration::ZERO).is_ok());
+    assert!(cache.delete(b"key0"));
+
+    // read some of the keys so that they can be selected by frequency
+    for _ in 0..8 {
+        for i in 1..10 {
+            let key = format!("key{i}");
+            assert!(cache.get(key.as_bytes()).is_some());
+        }
+    }
+
+    let export = |cache: &mut Segcache, mut export: Export| {
+        let mut data = Vec::new();
+        while !cache.export(&mut export, &mut data) {}
+        data
+    };
+
+    // every live item is exported and can be read from the peer
+    let data = export(&mut cache, Export::default());
+    assert_eq!(Records::new(&data).count(), 101);
+
+    let mut peer = builder().build().expect("failed to create cache");
+    assert_eq!(peer.import(&data, &|_| true).unwrap(), 101);
+    assert!(peer.get(b"key0").is_none());
+    let item = peer.get(b"key1").expect("didn't get item back");
+    assert_eq!(item.value(), value);
+    assert_eq!(item.optional(), Some(&b"opt"[..]));
+    assert_eq!(peer.ttl(&item), None);
+    let item = peer.get(b"short").expect("didn't get item back");
+    let ttl = peer.ttl(&item).expect("item has no ttl");
+    assert!(ttl > Duration::ZERO && ttl <= Duration::from_secs(60));
+    let item = peer.get(b"number").expect("didn't get item back");
+    assert_eq!(item.value(), Value::U64(42));
+
+    // the filter selects the keys which are stored
+    let mut peer = builder().build().expect("failed to create cache");
+    assert_eq!(peer.import(&data, &|key| key == b"key1").unwrap(), 1);
+    assert!(peer.get(b"key2").is_none());
+
+    // the ranges of key hashes partition the items
+    let low = export(&mut cache, Export::new(0..=u64::MAX / 2, 0));
+    let high = export(&mut cache, Export::new(u64::MAX / 2 + 1..=u64::MAX, 0));
+    assert_eq!(
+        Records::new(&low).count() + Records::new(&high).count(),
+        101
+    );
+    assert!(!low.is_empty() && !high.is_empty());
+
+    // only the keys which were read are at least the minimum frequency
+    let hot = export(&mut cache, Export::new(0..=u64::MAX, 1));
+    let keys: Vec<&[u8]> = Records::new(&hot).map(|r| r.unwrap().key).collect();
+    assert!(!keys.is_empty());
+    assert!(keys
+        .iter()
+        .all(|key| key.starts_with(b"key") && key.len() == 4));
+
+    // a malformed export is an error
+    let mut peer = builder().build().expect("failed to create cache");
+    assert!(peer.import(&data[..data.len() - 1], &|_| true).is_err());
+}
+
+#[test]
+fn s3fifo() {
+    let ttl = Duration::ZERO;
+    let value = [0xA5_u8; 256];
+
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 64)
+        .eviction(Policy::S3Fifo)
+        .build()
+        .expect("failed to create cache");
+
+    // items which are read after they are written are kept by eviction
+    for i in 0..8 {
+        let key = format!("hot{i}");
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+        assert!(cache.get(key.as_bytes()).is_some());
+    }
+
+    // while those which are only written are evicted
+    for i in 0..10_000 {
+        let key = format!("cold{i}");
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+    }
+    assert!(cache.get(b"cold0").is_none());
+    for i in 0..8 {
+        let key = format!("hot{i}");
+        assert!(cache.get(key.as_bytes()).is_some(), "evicted: {key}");
+    }
+}
+
+#[test]
+fn score() {
+    let ttl = Duration::ZERO;
+    let value = [0xA5_u8; 256];
+
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 64)
+        .eviction(Policy::Score {
+            samples: 64,
+            hits: 1000,
+            age: 0,
+            ttl: 0,
+        })
+        .build()
+        .expect("failed to create cache");
+
+    for i in 0..8 {
+        let key = format!("hot{i}");
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+    }
+
+    // the segment whose items are read keeps its score above those which
+    // are only written, so it is never the lowest scored segment sampled
+    for i in 0..10_000 {
+        let key = format!("cold{i}");
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+        if i % 100 == 0 {
+            for i in 0..8 {
+                let key = format!("hot{i}");
+                assert!(cache.get(key.as_bytes()).is_some(), "evicted: {key}");
+            }
+        }
+    }
+    assert!(cache.get(b"cold0").is_none());
+}
+
+#[test]
+fn ingest() {
+    let ttl = Duration::ZERO;
+    let value = [0xA5_u8; 1024];
+
+    let mut cache = Segcache::builder()
+        .segment_size(4096)
+        .heap_size(4096 * 64)
+        .eviction(Policy::Random)
+        .build()
+        .expect("failed to create cache");
+
+    // the segment of an item being written is not evicted meanwhile
+    let mut ingest = cache
+        .ingest(b"coffee", value.len(), Some(&[1, 2, 3, 4]), ttl)
+        .expect("failed to reserve");
+    for i in 0..1024 {
+        let key = format!("key{i}");
+        assert!(cache.insert(key.as_bytes(), &value[..], None, ttl).is_ok());
+    }
+    ingest.value_mut().copy_from_slice(&value);
+    assert!(cache.get(b"coffee").is_none());
+    assert!(cache.commit(ingest).is_ok());
+
+    let item = cache.get(b"coffee").expect("didn't get item back");
+    assert_eq!(item.value(), value);
+    assert_eq!(item.optional(), Some(&[1, 2, 3, 4][..]));
+
+    // an aborted item is not stored
+    let ingest = cache
+        .ingest(b"tea", value.len(), None, ttl)
+        .expect("failed to reserve");
+    cache.abort(ingest);
+    assert!(cache.get(b"tea").is_none());
+
+    // nor is one whose segment was cleared before it was committed
+    let ingest = cache
+        .ingest(b"tea", value.len(), None, ttl)
+        .expect("failed to reserve");
+    cache.clear();
+    assert_eq!(cache.commit(ingest), Err(SegcacheError::Expired));
+    assert!(cache.get(b"tea").is_none());
+
+    // values which do not fit a segment are inserted instead
+    assert!(matches!(
+        cache.ingest(b"tea", 8192, None, ttl),
+        Err(SegcacheError::ItemOversized { .. })
+    ));
+}
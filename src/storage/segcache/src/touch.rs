@@ -0,0 +1,364 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Changes to the ttl of items which avoid copying them.
+//!
+//! An item expires along with the segment which holds it, so giving it a new
+//! ttl would otherwise mean storing a copy in a segment of another ttl bucket.
+//! Instead, the deadline from a touch is recorded for the key and the item is
+//! left where it is. Reads treat the item as missing once its deadline has
+//! passed, and when the segment which holds it expires before the deadline,
+//! the item is moved into the ttl bucket for the time remaining. A key which is
+//! touched on every request is then copied at most once per ttl, rather than
+//! on every touch.
+//!
+//! The deadline of a key is dropped when the key is written or deleted.
+//! Deadlines are not saved with the metadata, so restored items expire with
+//! their segments. Values which are stored in chunks, whose chunks expire on
+//! their own, are copied on each touch.
+
+use crate::*;
+use std::collections::HashMap;
+
+// the deadlines are swept for keys which are no longer held, such as those of
+// evicted items, each time their number doubles since the last sweep
+const SWEEP_MIN: usize = 1024;
+
+/// The deadlines of touched items by key, where `None` is a deadline for an
+/// item which no longer expires.
+pub(crate) struct Touched {
+    deadlines: HashMap<Box<[u8]>, Option<Instant>>,
+    sweep_at: usize,
+}
+
+impl Touched {
+    pub(crate) fn new() -> Self {
+        Self {
+            deadlines: HashMap::new(),
+            sweep_at: SWEEP_MIN,
+        }
+    }
+
+    /// Returns the deadline set by a touch of the key, if it has one.
+    #[inline]
+    pub(crate) fn deadline(&self, key: &[u8]) -> Option<Option<Instant>> {
+        if self.deadlines.is_empty() {
+            return None;
+        }
+        self.deadlines.get(key).copied()
+    }
+
+    /// Drops the deadline of the key, which is done when it is written.
+    #[inline]
+    pub(crate) fn remove(&mut self, key: &[u8]) {
+        if !self.deadlines.is_empty() {
+            self.deadlines.remove(key);
+        }
+    }
+
+    pub(crate) fn clear(&mut self) {
+        self.deadlines.clear();
+        self.sweep_at = SWEEP_MIN;
+    }
+}
+
+impl Segcache {
+    /// Sets a new ttl for the item with the key, and returns the item. A ttl
+    /// of zero means the item no longer expires. The item is not copied, as
+    /// its new deadline is applied on read and it is only moved once the
+    /// segment which holds it expires. Returns an error if the item is not
+    /// found.
+    ///
+    /// ```
+    /// use segcache::Segcache;
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    ///
+    /// cache.insert(b"coffee", b"strong", None, Duration::from_secs(60));
+    /// cache.touch(b"coffee", Duration::from_secs(3600)).expect("failed to touch");
+    /// let item = cache.get(b"coffee").expect("didn't get item back");
+    /// assert!(cache.ttl(&item).unwrap() > Duration::from_secs(60));
+    ///
+    /// cache.touch(b"coffee", Duration::ZERO).expect("failed to touch");
+    /// assert!(cache.ttl(&item).is_none());
+    /// ```
+    pub fn touch(&mut self, key: &[u8], ttl: std::time::Duration) -> Result<Item, SegcacheError> {
+        let item = self.get(key).ok_or(SegcacheError::NotFound)?;
+
+        // the chunks of a large value expire on their own, so it is stored
+        // again with the new ttl
+        if item.raw().is_large() {
+            let value = match item.value() {
+                Value::Bytes(value) => value.to_vec(),
+                Value::U64(_) => unreachable!("large values are never numeric"),
+            };
+            let optional = item.optional().map(|optional| optional.to_vec());
+
+            #[cfg(feature = "metrics")]
+            ITEM_TOUCH_COPY.increment();
+
+            self.insert(key, value.as_slice(), optional.as_deref(), ttl)?;
+            return self.get_no_freq_incr(key).ok_or(SegcacheError::NotFound);
+        }
+
+        let ttl = Duration::from_secs(std::cmp::min(u32::MAX as u64, ttl.as_secs()) as u32);
+        let deadline = if ttl.as_secs() == 0 {
+            None
+        } else {
+            Some(Instant::now() + ttl)
+        };
+
+        #[cfg(feature = "metrics")]
+        ITEM_TOUCH.increment();
+
+        // an item which already expires with its segment needs no deadline
+        let longest = self
+            .segments
+            .segment_ttl(&item)
+            .map(|ttl| self.ttl_buckets.is_longest(ttl))
+            .unwrap_or(false);
+        if deadline.is_none() && longest {
+            self.touched.remove(key);
+            return Ok(item);
+        }
+
+        self.touched.deadlines.insert(key.into(), deadline);
+        if self.touched.deadlines.len() >= self.touched.sweep_at {
+            self.sweep_touched();
+        }
+
+        Ok(item)
+    }
+
+    /// Returns the time remaining until the deadline set by a touch of the
+    /// item, with `Some(None)` for an item which no longer expires, or `None`
+    /// if the item has not been touched.
+    pub(crate) fn touched_ttl(&self, item: &Item) -> Option<Option<std::time::Duration>> {
+        let deadline = self.touched.deadline(item.key())?;
+        let now = Instant::now();
+        Some(deadline.map(|deadline| {
+            if deadline > now {
+                std::time::Duration::from_secs((deadline - now).as_secs() as u64)
+            } else {
+                std::time::Duration::from_secs(0)
+            }
+        }))
+    }
+
+    /// Returns the item unless the deadline set by a touch has passed or it
+    /// was invalidated along with a prefix of its key, in which case the item
+    /// is removed, or it is only held as stale.
+    #[inline]
+    pub(crate) fn unexpired(&mut self, item: Item) -> Option<Item> {
+        if self.is_invalidated(&item) {
+            #[cfg(feature = "metrics")]
+            ITEM_NAMESPACE_EXPIRE.increment();
+
+            let key = item.key().to_vec();
+            self.delete(&key);
+            return None;
+        }
+
+        match self.touched.deadline(item.key()) {
+            Some(Some(deadline)) if deadline <= Instant::now() => {
+                #[cfg(feature = "metrics")]
+                ITEM_TOUCH_EXPIRE.increment();
+
+                let key = item.key().to_vec();
+                self.delete(&key);
+                None
+            }
+            Some(_) => Some(item),
+            None if self.is_stale(&item) => None,
+            None => Some(item),
+        }
+    }
+
+    /// Returns records of the touched items of the segments which are about
+    /// to expire, for which the deadline has not yet passed, with the time
+    /// remaining as their ttl. They are copied out rather than stored right
+    /// away, as the tail segment of their new ttl bucket may be among those
+    /// which are about to expire.
+    pub(crate) fn take_touched(&mut self) -> Vec<u8> {
+        let now = Instant::now();
+        let mut records = Vec::new();
+        if self.touched.deadlines.is_empty() {
+            return records;
+        }
+
+        let flush_at = self.segments.flush_at();
+        let mut keys = Vec::new();
+
+        for bucket in self.ttl_buckets.buckets.iter() {
+            let mut next = bucket.head();
+            while let Some(id) = next {
+                let mut segment = match self.segments.get_mut(id) {
+                    Ok(segment) => segment,
+                    Err(_) => break,
+                };
+
+                // items of segments created before a flush are not kept
+                if segment.create_at() >= flush_at {
+                    if segment.create_at() + segment.ttl() > now {
+                        break;
+                    }
+                    let touched = &self.touched;
+                    segment.live_keys(
+                        &mut self.hashtable,
+                        |key| touched.deadline(key).is_some(),
+                        &mut keys,
+                    );
+                }
+
+                next = segment.next_seg();
+            }
+        }
+
+        for key in keys {
+            let ttl = match self.touched.deadline(&key) {
+                Some(None) => Some(0),
+                Some(Some(deadline)) if deadline > now => {
+                    Some((deadline - now).as_secs().max(1) as u32)
+                }
+                _ => None,
+            };
+            self.touched.remove(&key);
+
+            if let (Some(ttl), Some(item)) = (
+                ttl,
+                self.hashtable
+                    .get_no_freq_incr(&key, &mut self.segments)
+                    .filter(|item| {
+                        !self
+                            .namespaces
+                            .is_invalidated(item.key(), item.raw().stamp())
+                    }),
+            ) {
+                crate::warm::write_record(
+                    &mut records,
+                    &key,
+                    item.raw().value(),
+                    item.optional(),
+                    ttl,
+                    item.is_compressed(),
+                );
+            }
+        }
+
+        records
+    }
+
+    /// Stores the touched items taken from the segments which have expired.
+    pub(crate) fn restore_touched(&mut self, records: &[u8]) {
+        for record in Records::new(records).flatten() {
+            let optional = (!record.optional.is_empty()).then_some(record.optional);
+            let ttl = std::time::Duration::from_secs(record.ttl as u64);
+
+            #[allow(unused_variables)]
+            let stored = self.store(record.key, record.value, optional, ttl, record.compressed);
+
+            #[cfg(feature = "metrics")]
+            if stored.is_ok() {
+                ITEM_TOUCH_RELOCATE.increment();
+            }
+        }
+    }
+
+    /// Drops the deadlines which have passed or whose keys are no longer
+    /// held, such as those of evicted items.
+    fn sweep_touched(&mut self) {
+        let now = Instant::now();
+        let hashtable = &mut self.hashtable;
+        let segments = &mut self.segments;
+
+        self.touched.deadlines.retain(|key, deadline| {
+            deadline.map(|deadline| deadline > now).unwrap_or(true)
+                && hashtable.get_no_freq_incr(key, segments).is_some()
+        });
+        self.touched.sweep_at = (self.touched.deadlines.len() * 2).max(SWEEP_MIN);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::Duration;
+
+    fn cache() -> Segcache {
+        Segcache::builder()
+            .segment_size(4096)
+            .heap_size(4096 * 64)
+            .build()
+            .expect("failed to create cache")
+    }
+
+    #[test]
+    fn touch() {
+        let mut cache = cache();
+        assert_eq!(
+            cache.touch(b"coffee", Duration::from_secs(60)).err(),
+            Some(SegcacheError::NotFound)
+        );
+
+        // the item is left in place with a new deadline
+        assert!(cache
+            .insert(b"coffee", b"strong", None, Duration::from_secs(60))
+            .is_ok());
+        let item = cache.get(b"coffee").unwrap();
+        let touched = cache.touch(b"coffee", Duration::from_secs(7200)).unwrap();
+        assert_eq!(touched.raw().as_ptr(), item.raw().as_ptr());
+        assert!(cache.ttl(&item).unwrap() > Duration::from_secs(3600));
+
+        // and no longer expires with a zero ttl
+        assert!(cache.touch(b"coffee", Duration::ZERO).is_ok());
+        assert!(cache.ttl(&item).is_none());
+
+        // writing the key drops the deadline
+        assert!(cache
+            .insert(b"coffee", b"weak", None, Duration::from_secs(60))
+            .is_ok());
+        let item = cache.get(b"coffee").unwrap();
+        assert!(cache.ttl(&item).unwrap() <= Duration::from_secs(60));
+        assert_eq!(cache.items(), 1);
+    }
+
+    #[test]
+    fn deadline() {
+        let mut cache = cache();
+
+        // an item touched to a shorter ttl is missing once its deadline passes
+        assert!(cache
+            .insert(b"coffee", b"strong", None, Duration::ZERO)
+            .is_ok());
+        assert!(cache.touch(b"coffee", Duration::from_secs(1)).is_ok());
+        assert!(cache.get(b"coffee").is_some());
+        std::thread::sleep(Duration::from_secs(2));
+        assert!(cache.get(b"coffee").is_none());
+        assert_eq!(cache.items(), 0);
+    }
+
+    #[test]
+    fn relocate() {
+        let mut cache = cache();
+
+        // an item touched past the expiry of its segment is moved as the
+        // segment expires
+        assert!(cache
+            .insert(b"coffee", b"strong", None, Duration::from_secs(1))
+            .is_ok());
+        assert!(cache
+            .insert(b"tea", b"green", None, Duration::from_secs(1))
+            .is_ok());
+        assert!(cache.touch(b"coffee", Duration::from_secs(60)).is_ok());
+        std::thread::sleep(Duration::from_secs(2));
+        cache.expire();
+
+        assert!(cache.get(b"tea").is_none());
+        let item = cache.get(b"coffee").expect("didn't get item back");
+        assert_eq!(item.value(), b"strong");
+        assert!(cache.ttl(&item).unwrap() > Duration::from_secs(1));
+        assert!(cache.touched.deadline(b"coffee").is_none());
+    }
+}
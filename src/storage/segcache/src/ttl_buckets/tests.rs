@@ -89,3 +89,29 @@ fn bucket_index() {
         1023
     );
 }
+
+#[test]
+fn exact_bucket_index() {
+    // ttls of zero, beyond the range, or which are already the ttl of a
+    // bucket are ignored
+    let ttl_buckets = TtlBuckets::with_exact(&[86_400, 60, 300, 60, 0, 57, 8_388_608]);
+    assert_eq!(ttl_buckets.buckets.len(), 1027);
+
+    // exact ttls have buckets of their own after the others, sorted by ttl
+    assert_eq!(ttl_buckets.get_bucket_index(Duration::from_secs(60)), 1024);
+    assert_eq!(ttl_buckets.get_bucket_index(Duration::from_secs(300)), 1025);
+    assert_eq!(
+        ttl_buckets.get_bucket_index(Duration::from_secs(86_400)),
+        1026
+    );
+    for (idx, ttl) in [(1024, 60), (1025, 300), (1026, 86_400)] {
+        assert_eq!(ttl_buckets.buckets[idx].ttl(), ttl);
+    }
+
+    // neighbouring ttls are still held by the other buckets
+    assert_eq!(ttl_buckets.get_bucket_index(Duration::from_secs(57)), 7);
+    assert_eq!(ttl_buckets.get_bucket_index(Duration::from_secs(61)), 7);
+    assert_eq!(ttl_buckets.get_bucket_index(Duration::from_secs(0)), 1023);
+    assert!(ttl_buckets.is_longest(Duration::from_secs(8_388_608)));
+    assert!(!ttl_buckets.is_longest(Duration::from_secs(86_400)));
+}
@@ -55,6 +55,11 @@ impl TtlBucket {
         }
     }
 
+    /// Returns the TTL of the segments of the `TtlBucket` in seconds.
+    pub(super) fn ttl(&self) -> i32 {
+        self.ttl
+    }
+
     /// Returns the segment ID of the head of the `TtlBucket`.
     pub fn head(&self) -> Option<NonZeroU32> {
         self.head
@@ -76,9 +81,44 @@ impl TtlBucket {
         self.next_to_merge = next;
     }
 
-    /// Expire segments from this TtlBucket, returns the number of segments
-    /// expired.
-    pub(super) fn expire(&mut self, hashtable: &mut HashTable, segments: &mut Segments) -> usize {
+    /// The number of bytes needed to save a `TtlBucket` into the metadata.
+    pub(crate) const METADATA_SIZE: usize = 5 * core::mem::size_of::<u32>();
+
+    /// Saves the segment chain of the `TtlBucket` into the metadata.
+    pub(super) fn save(&self, writer: &mut MetadataWriter) -> Result<(), std::io::Error> {
+        writer.put_seg_id(self.head)?;
+        writer.put_seg_id(self.tail)?;
+        writer.put_u32(self.ttl as u32)?;
+        writer.put_u32(self.nseg as u32)?;
+        writer.put_seg_id(self.next_to_merge)
+    }
+
+    /// Restores the segment chain of the `TtlBucket` from the metadata. The
+    /// saved bucket must cover the same TTL as this one.
+    pub(super) fn restore(&mut self, reader: &mut MetadataReader) -> Result<(), std::io::Error> {
+        let head = reader.get_seg_id()?;
+        let tail = reader.get_seg_id()?;
+        if reader.get_u32()? as i32 != self.ttl {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::Other,
+                "ttl bucket does not match saved ttl bucket",
+            ));
+        }
+        self.head = head;
+        self.tail = tail;
+        self.nseg = reader.get_u32()? as i32;
+        self.next_to_merge = reader.get_seg_id()?;
+        Ok(())
+    }
+
+    /// Expire segments from this TtlBucket which expired at least the grace
+    /// period ago, returns the number of segments expired.
+    pub(super) fn expire(
+        &mut self,
+        hashtable: &mut HashTable,
+        segments: &mut Segments,
+        grace: Duration,
+    ) -> usize {
         if self.head.is_none() {
             return 0;
         }
@@ -89,9 +129,8 @@ impl TtlBucket {
         loop {
             let seg_id = self.head;
             if let Some(seg_id) = seg_id {
-                let flush_at = segments.flush_at();
                 let mut segment = segments.get_mut(seg_id).unwrap();
-                if segment.create_at() + segment.ttl() <= ts || segment.create_at() < flush_at {
+                if segment.create_at() + segment.ttl() + grace <= ts {
                     if let Some(next) = segment.next_seg() {
                         self.head = Some(next);
                     } else {
@@ -114,6 +153,59 @@ impl TtlBucket {
         }
     }
 
+    /// Returns the time at which the head segment of this TtlBucket is due to
+    /// be expired, if it has one.
+    pub(super) fn expire_at(&self, segments: &mut Segments, grace: Duration) -> Option<Instant> {
+        let segment = segments.get_mut(self.head?).ok()?;
+        Some(segment.create_at() + segment.ttl() + grace)
+    }
+
+    /// Returns the bytes of the live items in the segments of this TtlBucket
+    /// which have expired but are still held, such as for the stale grace
+    /// period.
+    #[cfg(feature = "metrics")]
+    pub(super) fn expired_bytes(&self, segments: &mut Segments) -> i64 {
+        let now = Instant::now();
+        let mut bytes = 0;
+        let mut next = self.head;
+        while let Some(id) = next {
+            let segment = match segments.get_mut(id) {
+                Ok(segment) => segment,
+                Err(_) => break,
+            };
+            if segment.create_at() + segment.ttl() > now {
+                break;
+            }
+            bytes += segment.live_bytes() as i64;
+            next = segment.next_seg();
+        }
+        bytes
+    }
+
+    /// Frees the head segment of this TtlBucket if it was created before the
+    /// last flush, returns true if it was freed.
+    pub(super) fn reclaim(&mut self, hashtable: &mut HashTable, segments: &mut Segments) -> bool {
+        let seg_id = match self.head {
+            Some(seg_id) if segments.is_flushed_segment(seg_id) => seg_id,
+            _ => return false,
+        };
+
+        let mut segment = segments.get_mut(seg_id).unwrap();
+        if let Some(next) = segment.next_seg() {
+            self.head = Some(next);
+        } else {
+            self.head = None;
+            self.tail = None;
+        }
+        if self.next_to_merge == Some(seg_id) {
+            self.next_to_merge = None;
+        }
+        segment.clear(hashtable, true);
+        segments.push_free(seg_id);
+
+        true
+    }
+
     /// Clear segments from this TtlBucket, returns the number of segments
     /// expired.
     pub(super) fn clear(&mut self, hashtable: &mut HashTable, segments: &mut Segments) -> usize {
@@ -151,6 +243,7 @@ impl TtlBucket {
     /// return and error. It is up to the caller to handle the error and retry.
     fn try_expand(&mut self, segments: &mut Segments) -> Result<(), TtlBucketsError> {
         if let Some(id) = segments.pop_free() {
+            usdt!(segment_alloc, id.get(), self.ttl);
             {
                 if let Some(tail_id) = self.tail {
                     let mut tail = segments.get_mut(tail_id).unwrap();
@@ -196,7 +289,9 @@ impl TtlBucket {
         }
 
         loop {
-            if let Some(id) = self.tail {
+            // a flushed tail segment takes no more items, which would be lost
+            // along with it
+            if let Some(id) = self.tail.filter(|id| !segments.is_flushed_segment(*id)) {
                 if let Ok(mut segment) = segments.get_mut(id) {
                     if !segment.accessible() {
                         continue;
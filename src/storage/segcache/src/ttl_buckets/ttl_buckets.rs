@@ -16,6 +16,13 @@
 //! * TTLs beyond 8_388_608s (~97 days) and TTLs of 0 are all treated as the max
 //!   TTL.
 //!
+//! Items are held in segments with the shortest TTL of their bucket, so they
+//! may expire up to a bucket width early, and items with TTLs which differ by
+//! up to that width share segments. Exact TTLs may be given for the TTLs a
+//! workload clusters around, which are then each held in a bucket of their own
+//! following the ones above, so that their items are kept for their full TTL
+//! and segments hold items of that TTL alone.
+//!
 //! See the
 //! [Segcache paper](https://www.usenix.org/system/files/nsdi21-yang.pdf) for
 //! more detail.
@@ -42,15 +49,32 @@ const TTL_BOUNDARY_3: i32 = 1 << (TTL_BUCKET_INTERVAL_N_BIT_3 + N_BUCKET_PER_STE
 const MAX_N_TTL_BUCKET: usize = N_BUCKET_PER_STEP * 4;
 const MAX_TTL_BUCKET_IDX: usize = MAX_N_TTL_BUCKET - 1;
 
+// TTLs from here on are treated as the max TTL
+const MAX_TTL: u64 = 1 << (TTL_BUCKET_INTERVAL_N_BIT_4 + N_BUCKET_PER_STEP_N_BIT);
+
 pub struct TtlBuckets {
     pub(crate) buckets: Box<[TtlBucket]>,
-    pub(crate) last_expired: Instant,
+    // the earliest time at which the head segment of a bucket is due to
+    // expire, which may be earlier than the actual time but never later
+    next_expire: Instant,
+    // the sorted TTLs which have a bucket of their own
+    exact: Box<[u32]>,
+    // the bucket which the reclamation of flushed segments continues from
+    reclaim: usize,
 }
 
 impl TtlBuckets {
     /// Create a new set of `TtlBuckets` which cover the full range of TTLs. See
     /// the module-level documentation for how the range of TTLs are stored.
     pub fn new() -> Self {
+        Self::with_exact(&[])
+    }
+
+    /// Create a new set of `TtlBuckets` which cover the full range of TTLs,
+    /// with a bucket of its own for each of the exact TTLs in seconds. Exact
+    /// TTLs of zero or beyond the range of the buckets, and those which are
+    /// already the TTL of a bucket, are ignored.
+    pub fn with_exact(ttls: &[u32]) -> Self {
         let intervals = [
             TTL_BUCKET_INTERVAL_1,
             TTL_BUCKET_INTERVAL_2,
@@ -58,8 +82,16 @@ impl TtlBuckets {
             TTL_BUCKET_INTERVAL_4,
         ];
 
+        let mut exact: Vec<u32> = ttls
+            .iter()
+            .copied()
+            .filter(|ttl| *ttl != 0 && (*ttl as u64) < MAX_TTL)
+            .collect();
+        exact.sort_unstable();
+        exact.dedup();
+
         let mut buckets = Vec::with_capacity(0);
-        buckets.reserve_exact(intervals.len() * N_BUCKET_PER_STEP);
+        buckets.reserve_exact(intervals.len() * N_BUCKET_PER_STEP + exact.len());
 
         for interval in &intervals {
             for j in 0..N_BUCKET_PER_STEP {
@@ -69,12 +101,20 @@ impl TtlBuckets {
             }
         }
 
+        // the segments of a bucket are found by their TTL, so an exact TTL
+        // which is already the TTL of a bucket is served by that bucket
+        exact.retain(|ttl| buckets.iter().all(|bucket| bucket.ttl() != *ttl as i32));
+        for ttl in exact.iter() {
+            buckets.push(TtlBucket::new(*ttl as i32));
+        }
+
         let buckets = buckets.into_boxed_slice();
-        let last_expired = Instant::now();
 
         Self {
             buckets,
-            last_expired,
+            next_expire: Instant::now(),
+            exact: exact.into_boxed_slice(),
+            reclaim: 0,
         }
     }
 
@@ -82,7 +122,9 @@ impl TtlBuckets {
     pub(crate) fn get_bucket_index(&self, ttl: Duration) -> usize {
         let ttl = ttl.as_secs() as i32;
         if ttl <= 0 {
-            self.buckets.len() - 1
+            MAX_TTL_BUCKET_IDX
+        } else if let Ok(idx) = self.exact.binary_search(&(ttl as u32)) {
+            MAX_N_TTL_BUCKET + idx
         } else if ttl & !(TTL_BOUNDARY_1 - 1) == 0 {
             (ttl >> TTL_BUCKET_INTERVAL_N_BIT_1) as usize
         } else if ttl & !(TTL_BOUNDARY_2 - 1) == 0 {
@@ -99,6 +141,12 @@ impl TtlBuckets {
         }
     }
 
+    /// Returns true if the TTL falls within the last `TtlBucket`, which is
+    /// also where items without a TTL are held.
+    pub(crate) fn is_longest(&self, ttl: Duration) -> bool {
+        self.get_bucket_index(ttl) == MAX_TTL_BUCKET_IDX
+    }
+
     // TODO(bmartin): confirm handling for negative TTLs here...
     /// Get a mutable reference to the `TtlBucket` for the given TTL.
     pub(crate) fn get_mut_bucket(&mut self, ttl: Duration) -> &mut TtlBucket {
@@ -109,25 +157,77 @@ impl TtlBuckets {
         unsafe { self.buckets.get_unchecked_mut(index) }
     }
 
-    pub(crate) fn expire(&mut self, hashtable: &mut HashTable, segments: &mut Segments) -> usize {
-        let now = Instant::now();
+    /// Reserve space for an item with the specified size in bytes in the
+    /// `TtlBucket` for the given TTL. See [`TtlBucket::reserve`] for details.
+    pub(crate) fn reserve(
+        &mut self,
+        ttl: Duration,
+        size: usize,
+        segments: &mut Segments,
+    ) -> Result<ReservedItem, TtlBucketsError> {
+        let bucket = self.get_mut_bucket(ttl);
+        let empty = bucket.head().is_none();
+        let reserved = bucket.reserve(size, segments);
 
-        if now == self.last_expired {
+        // a segment which becomes the head of an empty bucket may expire
+        // before the heads of the other buckets
+        if empty {
+            let expire_at = Instant::now() + Duration::from_secs(bucket.ttl() as u32);
+            if expire_at < self.next_expire {
+                self.next_expire = expire_at;
+            }
+        }
+
+        reserved
+    }
+
+    /// Returns true if the head segment of a bucket may have expired, so that
+    /// expiration has work to do.
+    #[inline]
+    pub(crate) fn is_due(&self) -> bool {
+        Instant::now() >= self.next_expire
+    }
+
+    /// Expires the segments of each bucket which expired at least the grace
+    /// period ago, returns the number of segments expired. Nothing is done
+    /// until the earliest time a head segment is due to expire, which is then
+    /// found again from the heads which remain.
+    pub(crate) fn expire(
+        &mut self,
+        hashtable: &mut HashTable,
+        segments: &mut Segments,
+        grace: Duration,
+    ) -> usize {
+        if !self.is_due() {
             return 0;
-        } else {
-            self.last_expired = now;
         }
 
         let start = Instant::now();
         let mut expired = 0;
+        let mut next_expire = start + Duration::from_secs(MAX_TTL as u32);
         for bucket in self.buckets.iter_mut() {
-            expired += bucket.expire(hashtable, segments);
+            expired += bucket.expire(hashtable, segments, grace);
+            if let Some(expire_at) = bucket.expire_at(segments, grace) {
+                if expire_at < next_expire {
+                    next_expire = expire_at;
+                }
+            }
         }
+        self.next_expire = next_expire;
         let duration = start.elapsed();
         debug!("expired: {} segments in {:?}", expired, duration);
 
         #[cfg(feature = "metrics")]
-        EXPIRE_TIME.add(duration.as_nanos() as _);
+        {
+            EXPIRE_TIME.add(duration.as_nanos() as _);
+
+            let held: i64 = self
+                .buckets
+                .iter()
+                .map(|bucket| bucket.expired_bytes(segments))
+                .sum();
+            SEGMENT_EXPIRED_BYTES.set(held);
+        }
 
         expired
     }
@@ -139,6 +239,8 @@ impl TtlBuckets {
             cleared += bucket.clear(hashtable, segments);
         }
         segments.set_flush_at(Instant::now());
+        segments.finish_flush();
+        self.next_expire = Instant::now();
         let duration = start.elapsed();
         debug!("expired: {} segments in {:?}", cleared, duration);
 
@@ -147,6 +249,79 @@ impl TtlBuckets {
 
         cleared
     }
+
+    /// Frees up to `count` of the segments which were created before the last
+    /// flush, returns the number of segments freed. Segments are appended to
+    /// the chain of their bucket as they are created, so the flushed segments
+    /// of a bucket are the ones at its head. Each call continues from the
+    /// bucket the previous one stopped at, and the flush is finished once a
+    /// call has found no flushed segment in any bucket.
+    pub(crate) fn reclaim(
+        &mut self,
+        hashtable: &mut HashTable,
+        segments: &mut Segments,
+        count: usize,
+    ) -> usize {
+        if !segments.is_flushing() {
+            return 0;
+        }
+
+        let mut reclaimed = 0;
+        let mut clean = 0;
+        while reclaimed < count {
+            if self.buckets[self.reclaim].reclaim(hashtable, segments) {
+                reclaimed += 1;
+                clean = 0;
+                continue;
+            }
+
+            clean += 1;
+            if clean >= self.buckets.len() {
+                segments.finish_flush();
+                break;
+            }
+            self.reclaim = (self.reclaim + 1) % self.buckets.len();
+        }
+
+        #[cfg(feature = "metrics")]
+        SEGMENT_RECLAIM.add(reclaimed as _);
+
+        reclaimed
+    }
+
+    /// Returns the number of bytes needed to save the `TtlBuckets` metadata.
+    pub(crate) fn metadata_size(&self) -> usize {
+        core::mem::size_of::<u32>() + self.buckets.len() * TtlBucket::METADATA_SIZE
+    }
+
+    /// Saves the segment chains of all `TtlBucket`s into the metadata.
+    pub(crate) fn save(&self, writer: &mut MetadataWriter) -> Result<(), std::io::Error> {
+        writer.put_u32(self.buckets.len() as u32)?;
+        for bucket in self.buckets.iter() {
+            bucket.save(writer)?;
+        }
+        Ok(())
+    }
+
+    /// Creates a new set of `TtlBuckets` with the exact TTLs and with the
+    /// segment chains restored from the metadata, which must have been saved
+    /// with the same exact TTLs.
+    pub(crate) fn restore(
+        reader: &mut MetadataReader,
+        exact: &[u32],
+    ) -> Result<Self, std::io::Error> {
+        let mut ttl_buckets = Self::with_exact(exact);
+        if reader.get_u32()? as usize != ttl_buckets.buckets.len() {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::Other,
+                "invalid ttl buckets",
+            ));
+        }
+        for bucket in ttl_buckets.buckets.iter_mut() {
+            bucket.restore(reader)?;
+        }
+        Ok(ttl_buckets)
+    }
 }
 
 impl Default for TtlBuckets {
@@ -0,0 +1,37 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Static tracepoints (USDT probes) on the eviction and allocation paths,
+//! enabled with the `usdt` feature. Each probe is a `nop` and an ELF note
+//! which tracers use to find it, so it costs next to nothing until a tracer
+//! attaches, for example:
+//!
+//! ```text
+//! bpftrace -e 'usdt:./pelikan_segcache_rs:segcache:evict_begin { @s[tid] = nsecs; }
+//!     usdt:./pelikan_segcache_rs:segcache:evict_end /@s[tid]/ {
+//!         @evict_ns = hist(nsecs - @s[tid]); delete(@s[tid]); }'
+//! ```
+//!
+//! Without the feature probes compile to nothing and their arguments are not
+//! evaluated. The probes, in the `segcache` provider, are:
+//!
+//! * `evict_begin(free)` and `evict_end(ok, free)` around each eviction, with
+//!   the number of free segments
+//! * `merge_begin(seg)` and `merge_end(seg, ok)` around each merge eviction,
+//!   starting at the given segment
+//! * `compact_begin(seg)` and `compact_end(seg, ok)` around each merge
+//!   compaction of segments emptied by removals
+//! * `segment_alloc(seg, ttl)` when a ttl bucket takes a free segment
+
+#[cfg(feature = "usdt")]
+macro_rules! usdt {
+    ($name:ident $(, $arg:expr)* $(,)?) => {
+        probe::probe!(segcache, $name $(, $arg)*)
+    };
+}
+
+#[cfg(not(feature = "usdt"))]
+macro_rules! usdt {
+    ($name:ident $(, $arg:expr)* $(,)?) => {};
+}
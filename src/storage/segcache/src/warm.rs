@@ -0,0 +1,275 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+//! Export of the items of a cache and their import into another, which is used
+//! to warm a new cache from a peer instead of starting cold.
+//!
+//! The export walks the segments in order, a few at a time, and writes each
+//! live item it selects as a record holding the key, value, optional data, and
+//! remaining ttl. Items are selected by the hash of their key, which is the
+//! hash used by the hashtable and is the same for every cache, and by their
+//! frequency, so that a peer may take only a range of the keys or only those
+//! which are read often. The import stores each record directly into a segment
+//! without admission or compression, which has already been done by the peer.
+//!
+//! Values which are too large for a segment, and so are stored in chunks, are
+//! not exported.
+//!
+//! The export is not a snapshot. Items which are moved by eviction or written
+//! while the export is in progress may be exported twice or not at all.
+
+use crate::*;
+use core::num::NonZeroU32;
+use std::ops::RangeInclusive;
+
+// the number of segments exported by each call to export
+const EXPORT_SEGMENTS: u32 = 16;
+
+// each record is a header of the flags, the key length, the optional data
+// length, the value length, and the ttl in seconds, followed by the key, the
+// optional data, and the value
+const RECORD_HEADER: usize = 1 + 1 + 1 + 4 + 4;
+const FLAG_NUMERIC: u8 = 0x01;
+const FLAG_COMPRESSED: u8 = 0x02;
+
+/// Selects the items exported by [`Segcache::export`] and tracks how far the
+/// export has progressed through the segments.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct Export {
+    hashes: RangeInclusive<u64>,
+    min_freq: u8,
+    next: u32,
+}
+
+impl Export {
+    /// Creates an export of the items whose key hashes fall in the range and
+    /// whose frequency is at least the minimum.
+    pub fn new(hashes: RangeInclusive<u64>, min_freq: u8) -> Self {
+        Self {
+            hashes,
+            min_freq,
+            next: 0,
+        }
+    }
+
+    /// The range of key hashes which are exported.
+    pub fn hashes(&self) -> &RangeInclusive<u64> {
+        &self.hashes
+    }
+
+    /// The minimum frequency of the items which are exported.
+    pub fn min_freq(&self) -> u8 {
+        self.min_freq
+    }
+
+    pub(crate) fn selects(&self, hash: u64, freq: u64) -> bool {
+        self.hashes.contains(&hash) && freq >= self.min_freq as u64
+    }
+}
+
+impl Default for Export {
+    /// Exports every item.
+    fn default() -> Self {
+        Self::new(0..=u64::MAX, 0)
+    }
+}
+
+/// Appends the record for an item.
+pub(crate) fn write_record(
+    dst: &mut Vec<u8>,
+    key: &[u8],
+    value: Value,
+    optional: Option<&[u8]>,
+    ttl: u32,
+    compressed: bool,
+) {
+    let optional = optional.unwrap_or(&[]);
+
+    let mut flags = 0;
+    if compressed {
+        flags |= FLAG_COMPRESSED;
+    }
+    if matches!(value, Value::U64(_)) {
+        flags |= FLAG_NUMERIC;
+    }
+
+    dst.push(flags);
+    dst.push(key.len() as u8);
+    dst.push(optional.len() as u8);
+    dst.extend_from_slice(&(value.len() as u32).to_be_bytes());
+    dst.extend_from_slice(&ttl.to_be_bytes());
+    dst.extend_from_slice(key);
+    dst.extend_from_slice(optional);
+    match value {
+        Value::Bytes(v) => dst.extend_from_slice(v),
+        Value::U64(v) => dst.extend_from_slice(&v.to_be_bytes()),
+    }
+}
+
+/// One item read from an export.
+pub struct Record<'a> {
+    pub key: &'a [u8],
+    /// The value as it is stored, which is compressed if `compressed` is set.
+    pub value: Value<'a>,
+    /// The optional data, which is empty if there is none.
+    pub optional: &'a [u8],
+    /// The remaining ttl in seconds, zero if the item does not expire.
+    pub ttl: u32,
+    pub compressed: bool,
+}
+
+/// Reads the records of an export in order.
+pub struct Records<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> Records<'a> {
+    pub fn new(data: &'a [u8]) -> Self {
+        Self { data }
+    }
+
+    fn invalid() -> std::io::Error {
+        std::io::Error::new(std::io::ErrorKind::InvalidData, "invalid export record")
+    }
+}
+
+impl<'a> Iterator for Records<'a> {
+    type Item = Result<Record<'a>, std::io::Error>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.data.is_empty() {
+            return None;
+        }
+
+        if self.data.len() < RECORD_HEADER {
+            self.data = &[];
+            return Some(Err(Self::invalid()));
+        }
+
+        let flags = self.data[0];
+        let klen = self.data[1] as usize;
+        let olen = self.data[2] as usize;
+        let vlen = u32::from_be_bytes(self.data[3..7].try_into().unwrap()) as usize;
+        let ttl = u32::from_be_bytes(self.data[7..11].try_into().unwrap());
+
+        let len = RECORD_HEADER + klen + olen + vlen;
+        let numeric = flags & FLAG_NUMERIC != 0;
+        if klen == 0 || self.data.len() < len || (numeric && vlen != 8) {
+            self.data = &[];
+            return Some(Err(Self::invalid()));
+        }
+
+        let (record, rest) = self.data.split_at(len);
+        self.data = rest;
+
+        let (key, record) = record[RECORD_HEADER..].split_at(klen);
+        let (optional, value) = record.split_at(olen);
+        let value = if numeric {
+            Value::U64(u64::from_be_bytes(value.try_into().unwrap()))
+        } else {
+            Value::Bytes(value)
+        };
+
+        Some(Ok(Record {
+            key,
+            value,
+            optional,
+            ttl,
+            compressed: flags & FLAG_COMPRESSED != 0,
+        }))
+    }
+}
+
+impl Segcache {
+    /// Appends the records of the items selected by the export from the next
+    /// few segments held in memory, and advances the export past them. Returns
+    /// true once every segment has been exported. Items held in the flash tier
+    /// are not exported.
+    ///
+    /// ```
+    /// use segcache::{Export, Segcache};
+    /// use std::time::Duration;
+    ///
+    /// let mut cache = Segcache::builder().build().expect("failed to create cache");
+    /// cache.insert(b"coffee", b"strong", None, Duration::ZERO);
+    ///
+    /// let mut export = Export::default();
+    /// let mut data = Vec::new();
+    /// while !cache.export(&mut export, &mut data) {}
+    ///
+    /// let mut peer = Segcache::builder().build().expect("failed to create cache");
+    /// assert_eq!(peer.import(&data, &|_| true).unwrap(), 1);
+    /// let item = peer.get(b"coffee").expect("didn't get item back");
+    /// assert_eq!(item.value(), b"strong");
+    /// ```
+    pub fn export(&mut self, export: &mut Export, dst: &mut Vec<u8>) -> bool {
+        let segments = self.segments.cap();
+        let end = export.next.saturating_add(EXPORT_SEGMENTS).min(segments);
+        let now = Instant::now();
+
+        while export.next < end {
+            export.next += 1;
+
+            // this is safe because the ids start from 1
+            let id = unsafe { NonZeroU32::new_unchecked(export.next) };
+            let mut segment = match self.segments.get_mut(id) {
+                Ok(segment) => segment,
+                Err(_) => continue,
+            };
+            if !segment.accessible() || segment.live_items() == 0 {
+                continue;
+            }
+
+            // items in the longest ttl bucket may not have a ttl at all, so
+            // they are exported without one, and expired segments are skipped
+            let ttl = if self.ttl_buckets.is_longest(segment.ttl()) {
+                0
+            } else if segment.create_at() + segment.ttl() > now {
+                (segment.create_at() + segment.ttl() - now).as_secs().max(1)
+            } else {
+                continue;
+            };
+
+            segment.export(&mut self.hashtable, export, ttl, dst);
+        }
+
+        export.next >= segments
+    }
+
+    /// Stores the items of an export from a peer whose keys are accepted by
+    /// the filter, replacing any items with the same keys, and returns the
+    /// number of items stored. Items are stored even if they would be rejected
+    /// by admission. Returns an error if the export is malformed, in which
+    /// case the items before the malformed record have been stored.
+    pub fn import(
+        &mut self,
+        data: &[u8],
+        filter: &dyn Fn(&[u8]) -> bool,
+    ) -> Result<usize, std::io::Error> {
+        let mut imported = 0;
+
+        for record in Records::new(data) {
+            let record = record?;
+
+            // compressed values can only be read back with compression
+            if !filter(record.key) || (record.compressed && !cfg!(feature = "compression")) {
+                continue;
+            }
+
+            let optional = (!record.optional.is_empty()).then_some(record.optional);
+            let ttl = std::time::Duration::from_secs(record.ttl as u64);
+            if self
+                .store(record.key, record.value, optional, ttl, record.compressed)
+                .is_ok()
+            {
+                imported += 1;
+            }
+        }
+
+        #[cfg(feature = "metrics")]
+        ITEM_IMPORT.add(imported as _);
+
+        Ok(imported)
+    }
+}
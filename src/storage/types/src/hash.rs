@@ -0,0 +1,42 @@
+// Copyright 2025 Pelikan Foundation LLC.
+// Licensed under the Apache License, Version 2.0
+// http://www.apache.org/licenses/LICENSE-2.0
+
+use ahash::RandomState;
+use core::hash::{BuildHasher, Hasher};
+use std::sync::OnceLock;
+
+/// Returns the hash which storage uses to place a key. A request may hash its
+/// keys as they are parsed and hand the hash to storage along with the key,
+/// so that a key is hashed once however many times it is used.
+///
+/// NOTE: the hash is fixed, as items which are saved along with it must be
+/// found by the same hash when they are restored.
+#[inline]
+pub fn hash_key(key: &[u8]) -> u64 {
+    static HASH_BUILDER: OnceLock<RandomState> = OnceLock::new();
+
+    let mut hasher = HASH_BUILDER
+        .get_or_init(|| {
+            RandomState::with_seeds(
+                0xbb8c484891ec6c86,
+                0x0522a25ae9c769f9,
+                0xeed2797b9571bc75,
+                0x4feb29c1fbbd59d0,
+            )
+        })
+        .build_hasher();
+    hasher.write(key);
+    hasher.finish()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn stable() {
+        assert_eq!(hash_key(b"coffee"), hash_key(b"coffee".to_vec().as_slice()));
+        assert_ne!(hash_key(b"coffee"), hash_key(b"tea"));
+    }
+}
@@ -2,6 +2,10 @@
 // Licensed under the Apache License, Version 2.0
 // http://www.apache.org/licenses/LICENSE-2.0
 
+mod hash;
+
+pub use hash::hash_key;
+
 #[derive(PartialEq, Eq)]
 pub enum Value<'a> {
     Bytes(&'a [u8]),